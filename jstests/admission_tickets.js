@@ -0,0 +1,52 @@
+// User operations take a read or write ticket before locking, from pools sized by the
+// concurrentReadTickets and concurrentWriteTickets parameters.
+
+var t = db.jstests_admission_tickets;
+t.drop();
+
+var tickets = db.serverStatus().globalLock.tickets;
+printjson(tickets);
+["read", "write"].forEach(function(kind) {
+    var pool = tickets[kind];
+    assert(pool, "missing " + kind + " tickets");
+    assert.eq(pool.totalTickets, pool.out + pool.available, tojson(pool));
+    assert.gte(pool.queued, 0);
+    assert.gte(pool.waitMicros, 0);
+});
+
+var original = db.adminCommand({getParameter: 1, concurrentReadTickets: 1,
+                                 concurrentWriteTickets: 1});
+assert.commandWorked(original);
+
+assert.commandFailed(db.adminCommand({setParameter: 1, concurrentReadTickets: 0}));
+assert.commandFailed(db.adminCommand({setParameter: 1, concurrentWriteTickets: "x"}));
+
+try {
+    // A single ticket of each kind still lets operations through, one at a time.
+    assert.commandWorked(db.adminCommand({setParameter: 1, concurrentReadTickets: 1}));
+    assert.commandWorked(db.adminCommand({setParameter: 1, concurrentWriteTickets: 1}));
+    assert.eq(1, db.serverStatus().globalLock.tickets.read.totalTickets);
+
+    for (var i = 0; i < 100; i++) {
+        t.insert({_id: i});
+    }
+    assert.eq(100, t.find().itcount());
+
+    var s = startParallelShell("for (var i = 100; i < 200; i++) { " +
+                               "    db.jstests_admission_tickets.insert({_id: i}); " +
+                               "    db.jstests_admission_tickets.findOne({_id: i}); " +
+                               "}");
+    for (var i = 0; i < 100; i++) {
+        t.findOne({_id: i});
+    }
+    s();
+    assert.eq(200, t.count());
+}
+finally {
+    assert.commandWorked(db.adminCommand(
+        {setParameter: 1, concurrentReadTickets: original.concurrentReadTickets}));
+    assert.commandWorked(db.adminCommand(
+        {setParameter: 1, concurrentWriteTickets: original.concurrentWriteTickets}));
+}
+
+t.drop();
@@ -0,0 +1,40 @@
+// When an index holds every field a pipeline needs, the initial cursor uses a covered plan and
+// still produces the same results.
+
+var t = db.jstests_aggregation_covered_projection;
+t.drop();
+
+for (var i = 0; i < 20; i++) {
+    t.save({_id: i, a: i % 4, b: i, c: 'x'});
+}
+t.ensureIndex({a: 1, b: 1});
+
+function cursorPlan(pipeline) {
+    var explained = t.runCommand("aggregate", {pipeline: pipeline, explain: true});
+    printjson({input: pipeline, output: explained});
+    assert("stages" in explained);
+    assert("$cursor" in explained.stages[0]);
+    return explained.stages[0]["$cursor"].plan;
+}
+
+// Only indexed fields are needed.
+var covered = [{$match: {a: {$gte: 1}}},
+               {$group: {_id: "$a", total: {$sum: "$b"}}},
+               {$sort: {_id: 1}}];
+assert.eq(true, cursorPlan(covered).indexOnly);
+assert.eq([{_id: 1, total: 45}, {_id: 2, total: 50}, {_id: 3, total: 55}],
+          t.aggregate(covered).toArray());
+
+// Needing _id, which isn't in the index, requires fetching.
+var needsId = [{$match: {a: 1}}, {$project: {a: 1, b: 1}}];
+assert.eq(false, cursorPlan(needsId).indexOnly);
+assert.eq(5, t.aggregate(needsId).toArray().length);
+
+// As does a field outside the index.
+var needsC = [{$match: {a: 1}}, {$project: {_id: 0, b: 1, c: 1}}];
+assert.eq(false, cursorPlan(needsC).indexOnly);
+assert.eq({b: 1, c: 'x'}, t.aggregate(needsC).toArray()[0]);
+
+// Multikey fields can't be covered.
+t.save({_id: 20, a: [1, 2], b: 20});
+assert.eq(false, cursorPlan(covered).indexOnly);
@@ -0,0 +1,82 @@
+// $incrementalGroup folds only the documents added since its last run into the group states
+// saved in its 'into' collection, and returns the same results as a plain $group over everything.
+
+load('jstests/aggregation/extras/utils.js');
+
+var t = db.jstests_aggregation_incremental_group;
+var states = db.jstests_aggregation_incremental_group_states;
+t.drop();
+states.drop();
+
+var group = {_id: "$k",
+             n: {$sum: 1},
+             total: {$sum: "$v"},
+             avg: {$avg: "$v"},
+             lo: {$min: "$v"},
+             hi: {$max: "$v"},
+             all: {$push: "$v"}};
+
+function insertRange(from, to) {
+    for (var i = from; i < to; i++) {
+        t.insert({_id: i, k: i % 3, v: i * 2});
+    }
+}
+
+function sorted(results) {
+    return results.sort(function(a, b) { return a._id - b._id; });
+}
+
+function check(expectedRead) {
+    var full = sorted(t.aggregate({$group: group}).toArray());
+    var incremental = sorted(t.aggregate({$incrementalGroup: {into: states.getName(),
+                                                              group: group}}).toArray());
+    assert.eq(full, incremental);
+
+    // One state per group, plus the position of the last document read.
+    assert.eq(full.length + 1, states.count());
+    assert.eq(expectedRead, states.findOne({_id: "$incrementalGroup"}).position);
+}
+
+insertRange(0, 10);
+check(9);
+
+insertRange(10, 25);
+check(24);
+
+// Nothing new: the saved states are unchanged.
+check(24);
+
+// Documents at or below the saved position are never read again.
+t.remove({_id: {$lt: 5}});
+insertRange(25, 26);
+var incremental = t.aggregate({$incrementalGroup: {into: states.getName(), group: group}});
+var counts = incremental.toArray().map(function(doc) { return doc.n; });
+assert.eq(26, Array.sum(counts));
+
+// Only $match may come first; it is applied together with the new-document range.
+states.drop();
+var matched = sorted(t.aggregate({$match: {k: 1}},
+                                 {$incrementalGroup: {into: states.getName(),
+                                                      group: group}}).toArray());
+assert.eq(sorted(t.aggregate({$match: {k: 1}}, {$group: group}).toArray()), matched);
+
+assertErrorCode(t, [{$project: {k: 1}}, {$incrementalGroup: {into: states.getName(),
+                                                             group: group}}], 17359);
+assertErrorCode(t, [{$incrementalGroup: {group: group}}], 17358);
+
+// trackBy picks another ascending field, read in natural order from a capped collection.
+var capped = db.jstests_aggregation_incremental_group_capped;
+capped.drop();
+states.drop();
+db.createCollection(capped.getName(), {capped: true, size: 100000});
+for (var i = 0; i < 10; i++) {
+    capped.insert({ts: i, k: i % 2, v: i});
+}
+var spec = {$incrementalGroup: {into: states.getName(), trackBy: "ts", group: group}};
+capped.aggregate(spec);
+for (var i = 10; i < 15; i++) {
+    capped.insert({ts: i, k: i % 2, v: i});
+}
+assert.eq(sorted(capped.aggregate({$group: group}).toArray()),
+          sorted(capped.aggregate(spec).toArray()));
+assert.eq(14, states.findOne({_id: "$incrementalGroup"}).position);
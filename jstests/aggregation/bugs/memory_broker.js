@@ -0,0 +1,42 @@
+// Spilling stages report their memory to a process-wide broker, which makes them spill before
+// their own limits once spillableMemoryLimitBytes is exceeded.
+
+var t = db.jstests_aggregation_memory_broker;
+t.drop();
+
+var pad = new Array(500).join("x");
+for (var i = 0; i < 5000; i++) {
+    t.insert({_id: i, k: i % 1000, pad: pad});
+}
+
+var stats = db.serverStatus().memoryBroker;
+assert(stats, "missing memoryBroker section");
+assert("totalBytes" in stats);
+assert("sortBytes" in stats);
+assert("groupBytes" in stats);
+assert("earlySpills" in stats);
+
+var pipeline = [{$group: {_id: "$k", pads: {$push: "$pad"}}}, {$sort: {_id: 1}}];
+var expected = t.aggregate(pipeline).toArray();
+assert.eq(1000, expected.length);
+
+var original = db.adminCommand({getParameter: 1,
+                                spillableMemoryLimitBytes: 1}).spillableMemoryLimitBytes;
+
+// Any consumer holding more than the minimum grant is now over the global budget.
+assert.commandWorked(db.adminCommand({setParameter: 1, spillableMemoryLimitBytes: 1}));
+try {
+    var before = db.serverStatus().memoryBroker.earlySpills;
+    var results = t.aggregate(pipeline, {allowDiskUse: true}).toArray();
+    assert.eq(expected, results);
+    assert.gt(db.serverStatus().memoryBroker.earlySpills, before);
+}
+finally {
+    assert.commandWorked(db.adminCommand({setParameter: 1,
+                                          spillableMemoryLimitBytes: original}));
+}
+
+// Nothing is held once the operations are done.
+assert.eq(0, db.serverStatus().memoryBroker.totalBytes);
+
+t.drop();
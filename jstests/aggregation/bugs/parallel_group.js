@@ -0,0 +1,39 @@
+// $group gives the same results when its input is grouped by several threads.
+
+var t = db.jstests_aggregation_parallel_group;
+t.drop();
+
+for (var i = 0; i < 5000; i++) {
+    t.save({_id: i, a: i % 37, b: i, c: i % 5});
+}
+
+function runGroup(spec) {
+    return t.aggregate([{$group: spec}, {$sort: {_id: 1}}]).toArray();
+}
+
+var specs = [{_id: "$a", sum: {$sum: "$b"}, avg: {$avg: "$b"}, min: {$min: "$b"}, max: {$max: "$b"}},
+             {_id: "$a", cs: {$addToSet: "$c"}},
+             {_id: null, count: {$sum: 1}},
+             // order dependent accumulators are always grouped on one thread
+             {_id: "$a", first: {$first: "$b"}, last: {$last: "$b"}, all: {$push: "$c"}}];
+
+var original = db.adminCommand({getParameter: 1, aggregationGroupThreads: 1});
+assert.commandWorked(original);
+
+var expected = specs.map(runGroup);
+assert.commandWorked(db.adminCommand({setParameter: 1, aggregationGroupThreads: 4}));
+try {
+    for (var i = 0; i < specs.length; i++) {
+        var result = runGroup(specs[i]);
+        result.forEach(function(doc) { if (doc.cs) doc.cs.sort(); });
+        expected[i].forEach(function(doc) { if (doc.cs) doc.cs.sort(); });
+        assert.eq(expected[i], result, tojson(specs[i]));
+    }
+
+    // errors raised while grouping are reported
+    assert.throws(function() { runGroup({_id: "$a", x: {$sum: {$add: ["$b", "x"]}}}); });
+}
+finally {
+    db.adminCommand({setParameter: 1,
+                     aggregationGroupThreads: original.aggregationGroupThreads});
+}
@@ -205,8 +205,30 @@ assert.eq(db.ts1.find().itcount(), outCollection.find().itcount());
 assert.eq(db.ts1.find().sort({_id:1}).toArray(),
           outCollection.find().sort({_id:1}).toArray());
 
-// Make sure we error out if $out collection is sharded
-assertErrorCode(db.outCollection, [{$out: db.ts1.getName()}], 17017);
+// $out to a sharded collection: each shard fills, then swaps in, its own part of the output
+var shardedOut = db.ts1_sharded_out;
+shardedOut.drop();
+shardedAggTest.adminCommand({shardcollection: shardedOut.getFullName(), key: {counter: 1}});
+shardedAggTest.adminCommand({split: shardedOut.getFullName(), middle: {counter: nItems / 2}});
+var otherShard = shardedAggTest.getOther(shardedAggTest.getServer("aggShard"));
+shardedAggTest.adminCommand({moveChunk: shardedOut.getFullName(),
+                             find: {counter: 0},
+                             to: otherShard.name});
+shardedOut.insert({_id: "replaced", counter: 1});
+
+aggregateOrdered(db.ts1, [{$match: {counter: {$mod: [100, 0]}}},
+                          {$project: {_id: 0, counter: 1, number: 1}},
+                          {$out: shardedOut.getName()}]);
+assert.eq(nItems / 100, shardedOut.count());
+assert.eq(0, shardedOut.count({_id: "replaced"}));
+assert.eq(nItems / 200, shardedOut.find({counter: {$lte: nItems / 2}}).itcount());
+shardedAggTest.shard0.getDB("aggShard").getCollectionNames().forEach(function(name) {
+    assert(!/^tmp\.agg_out/.test(name), name);
+});
+
+// Each output document needs the output's shard key
+assertErrorCode(db.ts1, [{$project: {_id: 0, number: 1}}, {$out: shardedOut.getName()}], 17346);
+assert.eq(nItems / 100, shardedOut.count());
 
 db.literal.save({dollar:false});
 
@@ -1478,6 +1478,29 @@ var authCommandsLib = {
                 { runOnDb: secondDbName, roles: {} }
             ]
         },
+        {
+            testname: "parallelCollectionScan",
+            command: {parallelCollectionScan: "coll", numCursors: 1},
+            skipSharded: true,
+            setup: function (db) { db.coll.save( {} ); },
+            teardown: function (db) { db.coll.drop(); },
+            testcases: [
+                {
+                    runOnDb: firstDbName,
+                    roles: roles_readWrite,
+                    privileges: [
+                        { resource: {db: firstDbName, collection: "coll"}, actions: ["find"] }
+                    ]
+                },
+                {
+                    runOnDb: secondDbName,
+                    roles: roles_readWriteAny,
+                    privileges: [
+                        { resource: {db: secondDbName, collection: "coll"}, actions: ["find"] }
+                    ]
+                }
+            ]
+        },
         {
             testname: "ping",
             command: {ping: 1},
@@ -0,0 +1,57 @@
+// The inserts of a write command hold back the keys of non-unique indexes and insert them in key
+// order at the end of each group.  A key that fails then undoes its document and those after it.
+
+var coll = db.batch_insert_index_keys;
+coll.drop();
+coll.ensureIndex({a: 1});
+coll.ensureIndex({b: 1});
+
+var bigKey = new Array(2000).join("x");
+
+function docs(n, badPositions) {
+    var result = [];
+    for (var i = 0; i < n; i++) {
+        var doc = {_id: i, a: i, b: [i, -i]};
+        if (badPositions.indexOf(i) >= 0) {
+            doc.a = bigKey;
+        }
+        result.push(doc);
+    }
+    return result;
+}
+
+function checkIndexes(expectedCount) {
+    assert.eq(expectedCount, coll.count());
+    assert.eq(expectedCount, coll.find().hint({a: 1}).itcount());
+    assert.eq(expectedCount, coll.find({b: {$gte: 0}}).hint({b: 1}).itcount());
+    assert(coll.validate(true).valid, tojson(coll.validate(true)));
+}
+
+// Increasing keys, several groups
+var result = coll.runCommand({insert: coll.getName(), documents: docs(500, []), ordered: true});
+assert.commandWorked(result);
+assert.eq(500, result.n);
+checkIndexes(500);
+assert.eq([3, 4], coll.find({a: {$gt: 2, $lt: 5}}, {_id: 0, a: 1}).hint({a: 1}).toArray()
+                      .map(function(doc) { return doc.a; }));
+assert(coll.find({b: -7}).hint({b: 1}).explain().isMultiKey);
+
+// Ordered: stops at the document whose key can't be indexed
+coll.remove({});
+result = coll.runCommand({insert: coll.getName(), documents: docs(20, [10]), ordered: true});
+assert.eq(10, result.n, tojson(result));
+assert.eq(1, result.writeErrors.length, tojson(result));
+assert.eq(10, result.writeErrors[0].index, tojson(result));
+checkIndexes(10);
+
+// Unordered: the documents after a failed one are retried
+coll.remove({});
+result = coll.runCommand({insert: coll.getName(), documents: docs(20, [5, 12]), ordered: false});
+assert.eq(18, result.n, tojson(result));
+assert.eq(2, result.writeErrors.length, tojson(result));
+assert.eq(5, result.writeErrors[0].index, tojson(result));
+assert.eq(12, result.writeErrors[1].index, tojson(result));
+checkIndexes(18);
+assert.eq(0, coll.find({_id: {$in: [5, 12]}}).itcount());
+
+coll.drop();
@@ -0,0 +1,53 @@
+// benchRun reports latency percentiles for every kind of operation it ran and, when asked, the
+// operations of each second of the run; with opsPerSecond it starts them at a fixed rate
+
+var t = db.bench_test_percentiles;
+t.drop();
+
+t.insert( { _id : 1 , x : 1 } );
+
+var benchArgs = { ops : [ { op : "findOne" , ns : t.getFullName() , query : { _id : 1 } } ,
+                          { op : "update" , ns : t.getFullName() , query : { _id : 1 } ,
+                            update : { $inc : { x : 1 } } } ] ,
+                  parallel : 2 , seconds : 2 , host : db.getMongo().host };
+
+if (jsTest.options().auth) {
+    benchArgs['db'] = 'admin';
+    benchArgs['username'] = jsTest.options().adminUser;
+    benchArgs['password'] = jsTest.options().adminPassword;
+}
+
+var checkPercentiles = function( res, name ) {
+    var p = res[name + "LatencyPercentilesMicros"];
+    assert( p , name + " " + tojson( res ) );
+    assert.lte( p.p50 , p.p90 , name );
+    assert.lte( p.p90 , p.p99 , name );
+    assert.lte( p.p99 , p.p999 , name );
+    assert.lte( p.p999 , p.max , name );
+};
+
+var res = benchRun( benchArgs );
+checkPercentiles( res , "findOne" );
+checkPercentiles( res , "update" );
+assert.eq( undefined , res.insertLatencyPercentilesMicros , tojson( res ) );
+assert.eq( undefined , res.timeSeries , tojson( res ) );
+
+// 100 operations per second, reported for each second
+benchArgs['opsPerSecond'] = 100;
+benchArgs['timeSeries'] = true;
+res = benchRun( benchArgs );
+checkPercentiles( res , "findOne" );
+assert( res.timeSeries.length >= 2 , tojson( res ) );
+
+var total = 0;
+res.timeSeries.forEach( function( s ) {
+    if ( s.findOne ) {
+        total += s.findOne.ops;
+        assert.lte( s.findOne.latencyAverageMicros , s.findOne.latencyMaxMicros , tojson( s ) );
+    }
+    if ( s.update )
+        total += s.update.ops;
+} );
+// the rate holds the run to about 200 operations, where an unthrottled one does far more
+assert.gt( total , 100 , tojson( res.timeSeries ) );
+assert.lt( total , 400 , tojson( res.timeSeries ) );
@@ -0,0 +1,40 @@
+// The database write lock taken by inserts, updates and removes is accounted against their
+// collection too, and reported per collection by serverStatus({collectionLocks: 1}).
+
+var a = db.jstests_collection_locks_a;
+var b = db.jstests_collection_locks_b;
+a.drop();
+b.drop();
+
+for (var i = 0; i < 100; i++) {
+    a.insert({_id: i, x: i});
+}
+a.update({}, {$inc: {x: 1}}, false, true);
+a.remove({x: {$lt: 50}});
+b.insert({_id: 0});
+assert.eq(null, db.getLastError());
+
+// Not reported unless asked for.
+assert(!("collectionLocks" in db.serverStatus()));
+
+var stats = db.serverStatus({collectionLocks: 1}).collectionLocks;
+printjson(stats);
+[a, b].forEach(function(coll) {
+    var s = stats[coll.getFullName()];
+    assert(s, "no lock stats for " + coll.getFullName());
+    assert("w" in s.timeLockedMicros, tojson(s));
+    assert("timeAcquiringMicros" in s, tojson(s)); // "w" only once some wait registered
+});
+
+// The write commands take the same lock.
+var before = stats[a.getFullName()].timeLockedMicros.w;
+assert.commandWorked(db.runCommand({insert: a.getName(), documents: [{_id: 1000}]}));
+var after = db.serverStatus({collectionLocks: 1}).collectionLocks[a.getFullName()];
+assert.gte(after.timeLockedMicros.w, before);
+
+// Dropped collections are forgotten.
+a.drop();
+stats = db.serverStatus({collectionLocks: 1}).collectionLocks;
+assert(!(a.getFullName() in stats), tojson(stats));
+assert(b.getFullName() in stats, tojson(stats));
+b.drop();
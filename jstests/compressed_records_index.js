@@ -0,0 +1,42 @@
+// Indexed reads and updates of a collection with compressed records have to decompress the
+// documents they fetch, like a collection scan does.
+
+var t = db.compressed_records_index;
+t.drop();
+
+db.createCollection(t.getName());
+assert.commandWorked(db.runCommand({collMod: t.getName(), compressRecords: true}));
+t.ensureIndex({a: 1});
+
+// big and repetitive enough to be stored compressed
+var pad = new Array(2048).join("x");
+for (var i = 0; i < 50; i++) {
+    t.insert({_id: i, a: i, pad: pad});
+}
+db.getLastError();
+
+var compression = t.stats().compression;
+assert.eq(50, compression.compressed, tojson(compression));
+
+var doc = t.find({a: 7}).hint({a: 1}).next();
+assert.eq(7, doc._id);
+assert.eq(pad, doc.pad);
+
+assert.eq(10, t.find({a: {$gte: 10, $lt: 20}}).hint({a: 1}).itcount());
+assert.eq(5, t.find({a: {$lt: 5}}, {pad: 1}).hint({a: 1}).toArray().length);
+
+// an update that finds its document through the index
+t.update({a: 3}, {$set: {b: 1}});
+assert.isnull(db.getLastError());
+doc = t.findOne({_id: 3});
+assert.eq(1, doc.b);
+assert.eq(pad, doc.pad);
+
+t.update({a: {$gte: 40}}, {$inc: {a: 100}}, false, true);
+assert.isnull(db.getLastError());
+assert.eq(10, t.find({a: {$gte: 140}}).hint({a: 1}).itcount());
+
+t.remove({a: {$lt: 10}});
+assert.isnull(db.getLastError());
+assert.eq(40, t.find().hint({a: 1}).itcount());
+assert(t.validate(true).valid);
@@ -0,0 +1,48 @@
+// With enableCostBasedPlanSelection, a plan that index histograms estimate to read orders of
+// magnitude less than the others runs without a race.  Results must be the same either way.
+
+var t = db.cost_based_plan_selection;
+t.drop();
+
+for (var i = 0; i < 10000; i++) {
+    t.insert({a: i % 2, b: i, c: i % 100});
+}
+t.ensureIndex({a: 1});
+t.ensureIndex({b: 1});
+t.ensureIndex({c: 1});
+db.getLastError();
+
+function setCostBased(on) {
+    assert.commandWorked(db.adminCommand({setParameter: 1, enableCostBasedPlanSelection: on}));
+}
+
+var queries = [{a: 1, b: 5},
+               {a: 0, b: {$gte: 100, $lt: 110}},
+               {a: 1, c: 7},
+               {b: {$gte: 5000}, c: 7},
+               {a: 1, b: {$in: [3, 5, 7]}, c: {$gte: 0}}];
+
+setCostBased(false);
+var expected = queries.map(function(q) { return t.find(q).sort({_id: 1}).toArray(); });
+
+setCostBased(true);
+try {
+    for (var i = 0; i < queries.length; i++) {
+        assert.eq(expected[i], t.find(queries[i]).sort({_id: 1}).toArray(), tojson(queries[i]));
+    }
+
+    // b: 5 is one key against 5000 for a: 1.
+    var explain = t.find({a: 1, b: 5}).explain();
+    assert.eq("BtreeCursor b_1", explain.cursor, tojson(explain));
+    assert.eq(1, explain.n);
+
+    // Writes make the histograms go stale and get rebuilt.
+    for (var i = 0; i < 2000; i++) {
+        t.update({b: i}, {$set: {a: 1}});
+    }
+    db.getLastError();
+    assert.eq(t.find({a: 1, b: 5}).hint({$natural: 1}).itcount(), t.find({a: 1, b: 5}).itcount());
+}
+finally {
+    setCostBased(false);
+}
@@ -0,0 +1,35 @@
+// Counts answered from index keys alone agree with counting the documents.
+
+var t = db.count_index_only;
+t.drop();
+
+for (var i = 0; i < 300; i++) {
+    t.insert({a: i % 30, b: i % 7, c: [i, i + 1], d: i});
+}
+db.getLastError();
+
+var queries = [
+    {a: 5},
+    {a: {$gt: 5}},
+    {a: {$gte: 5, $lt: 10}},
+    {a: {$in: [1, 3, 100]}},
+    {a: {$in: [1, 3]}, b: {$gt: 2}},
+    {a: 4, b: {$lte: 3}},
+    {a: {$lt: 0}},
+    {c: {$gt: 150}},
+    {c: {$in: [10, 11, 12]}},
+    {d: {$gt: 250}, a: {$gt: 25}},
+];
+
+var expected = queries.map(function(q) { return t.find(q).itcount(); });
+
+t.ensureIndex({a: 1, b: 1});
+t.ensureIndex({c: 1});
+t.ensureIndex({d: -1});
+
+for (var i = 0; i < queries.length; i++) {
+    assert.eq(expected[i], t.find(queries[i]).count(), tojson(queries[i]));
+    assert.eq(Math.min(Math.max(expected[i] - 2, 0), 3),
+              t.find(queries[i]).skip(2).limit(3).count(true),
+              "skip/limit " + tojson(queries[i]));
+}
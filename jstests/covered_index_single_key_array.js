@@ -0,0 +1,35 @@
+// A field that holds an array makes an index multikey even when the array comes to a single key,
+// so that a covered query does not return the key in place of the array.
+
+t = db.jstests_covered_index_single_key_array;
+
+function check( doc ) {
+    t.drop();
+    t.ensureIndex( { a : 1 , b : 1 } );
+    t.save( doc );
+    assert( t.find( { a : 5 } ).hint( { a : 1 , b : 1 } ).explain().isMultiKey , tojson( doc ) );
+
+    var found = t.find( { a : 5 } , { _id : 0 , a : 1 } ).hint( { a : 1 , b : 1 } ).toArray();
+    assert.eq( 1 , found.length , tojson( doc ) );
+    assert.eq( doc.a , found[0].a , tojson( doc ) );
+}
+
+check( { a : [ 5 ] , b : 1 } );
+check( { a : [ 5 , 5.0 ] , b : 1 } );
+check( { a : [ 5 , NumberLong( 5 ) ] , b : 1 } );
+
+// the same when the index is built over existing documents
+t.drop();
+t.save( { a : [ 5 ] , b : 1 } );
+t.ensureIndex( { a : 1 , b : 1 } );
+assert( t.find( { a : 5 } ).hint( { a : 1 , b : 1 } ).explain().isMultiKey );
+assert.eq( [ 5 ] , t.findOne( { a : 5 } , { _id : 0 , a : 1 } ).a );
+
+// and after an update puts an array in
+t.drop();
+t.ensureIndex( { a : 1 , b : 1 } );
+t.save( { _id : 1 , a : 5 , b : 1 } );
+assert( !t.find( { a : 5 } ).hint( { a : 1 , b : 1 } ).explain().isMultiKey );
+t.update( { _id : 1 } , { $set : { a : [ 5 ] } } );
+assert( t.find( { a : 5 } ).hint( { a : 1 , b : 1 } ).explain().isMultiKey );
+assert.eq( [ 5 ] , t.findOne( { a : 5 } , { _id : 0 , a : 1 } ).a );
@@ -0,0 +1,37 @@
+// Dropping a collection only kills the cursors open on that collection; cursors on its siblings
+// (including one whose name extends the dropped one's) and in other databases keep working.
+
+var a = db.jstests_cursorc;
+var b = db.jstests_cursorc_b;
+var other = db.getSiblingDB("jstests_cursorc_other").jstests_cursorc;
+a.drop();
+b.drop();
+other.drop();
+
+for (var i = 0; i < 200; i++) {
+    a.insert({i: i});
+    b.insert({i: i});
+    other.insert({i: i});
+}
+
+function openCursor(coll) {
+    var c = coll.find().batchSize(2);
+    assert(c.hasNext());
+    c.next();
+    return c;
+}
+
+var ca = openCursor(a);
+var cb = openCursor(b);
+var cother = openCursor(other);
+var open = db.serverStatus().cursors.totalOpen;
+assert.lte(3, open);
+
+a.drop();
+
+assert.throws(function() { ca.itcount(); });
+assert.eq(199, cb.itcount());
+assert.eq(199, cother.itcount());
+assert.gt(open, db.serverStatus().cursors.totalOpen);
+
+other.getDB().dropDatabase();
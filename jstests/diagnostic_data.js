@@ -0,0 +1,25 @@
+// getDiagnosticData returns the latest sample of the diagnostic data capture thread.
+
+var admin = db.getSiblingDB("admin");
+
+// the first sample is taken at startup, but give the thread a moment if this is a new server
+var res;
+assert.soon(function() {
+    res = admin.runCommand({getDiagnosticData: 1});
+    assert.commandWorked(res);
+    return res.data.serverStatus !== undefined;
+}, "no diagnostic data sample");
+
+assert(res.enabled, tojson(res));
+var sample = res.data;
+assert.lte(sample.start, sample.end, tojson(sample));
+assert.eq(1, sample.serverStatus.ok, tojson(sample.serverStatus));
+assert(sample.serverStatus.opcounters, tojson(sample.serverStatus));
+assert(sample.serverStatus.locks, tojson(sample.serverStatus));
+
+// samples keep coming
+assert.soon(function() {
+    var next = admin.runCommand({getDiagnosticData: 1});
+    assert.commandWorked(next);
+    return next.data.start > sample.start;
+}, "no new diagnostic data sample");
@@ -0,0 +1,36 @@
+// A restarted mongod finds every database it had, drops leftover temp collections, and reports
+// how far its background walk of the databases has got.
+
+var baseDir = "jstests_disk_restart_many_dbs";
+var numDBs = 30;
+var port = allocatePorts( 1 )[ 0 ];
+
+var m = startMongodTest( port, baseDir, false, { nohttpinterface : "", bind_ip : "127.0.0.1" } );
+for ( var i = 0; i < numDBs; i++ ) {
+    var d = m.getDB( "restart_many_dbs_" + i );
+    d.c.insert( { _id : i } );
+    d.c.ensureIndex( { a : 1 } );
+}
+var tmpDB = m.getDB( "restart_many_dbs_0" );
+assert.commandWorked( tmpDB.runCommand( { create : "tmp", temp : true } ) );
+stopMongod( port );
+
+m = startMongoProgram( "mongod", "--port", port, "--dbpath", MongoRunner.dataPath + baseDir,
+                       "--nohttpinterface", "--bind_ip", "127.0.0.1" );
+
+var metrics;
+assert.soon( function() {
+    metrics = m.getDB( "admin" ).serverStatus().metrics.startup;
+    return metrics.databasesChecked == metrics.databasesTotal;
+}, "databases not all checked" );
+assert.lte( numDBs, metrics.databasesTotal, tojson( metrics ) );
+
+for ( var i = 0; i < numDBs; i++ ) {
+    var d = m.getDB( "restart_many_dbs_" + i );
+    assert.eq( { _id : i }, d.c.findOne(), "db " + i );
+    assert.eq( 2, d.c.getIndexes().length, "db " + i );
+}
+assert.eq( null, m.getDB( "restart_many_dbs_0" ).system.namespaces.findOne(
+    { name : "restart_many_dbs_0.tmp" } ) );
+
+stopMongod( port );
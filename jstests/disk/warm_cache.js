@@ -0,0 +1,30 @@
+// With warmCacheSnapshotSecs set, mongod writes the pages it has in memory to warm_cache.bson
+// and reads them back in when it's restarted.
+
+var baseDir = "jstests_disk_warm_cache";
+var dbpath = MongoRunner.dataPath + baseDir + "/";
+var port = allocatePorts( 1 )[ 0 ];
+
+var m = startMongodTest( port, baseDir, false, { nohttpinterface : "", bind_ip : "127.0.0.1",
+                                                 setParameter : "warmCacheSnapshotSecs=1" } );
+var t = m.getDB( "test" ).warm_cache;
+for ( var i = 0; i < 1000; i++ ) {
+    t.insert( { _id : i, s : new Array( 1000 ).join( "x" ) } );
+}
+assert.eq( null, m.getDB( "test" ).getLastError() );
+
+assert.soon( function() {
+    return m.getDB( "admin" ).serverStatus().metrics.warmCache.snapshots > 0;
+}, "no snapshot written" );
+assert( listFiles( dbpath ).some( function( f ) { return /warm_cache\.bson$/.test( f.name ); } ),
+        "warm_cache.bson missing" );
+stopMongod( port );
+
+m = startMongoProgram( "mongod", "--port", port, "--dbpath", dbpath, "--nohttpinterface",
+                       "--bind_ip", "127.0.0.1" );
+assert.soon( function() {
+    return m.getDB( "admin" ).serverStatus().metrics.warmCache.pagesRestored > 0;
+}, "no pages read back" );
+assert.eq( 1000, m.getDB( "test" ).warm_cache.count() );
+
+stopMongod( port );
@@ -0,0 +1,52 @@
+// explain's 'stats' tree shows each stage's counters, and with planStageTiming their cycles.
+
+var t = db.explain_stage_stats;
+t.drop();
+t.ensureIndex({a: 1});
+for (var i = 0; i < 100; i++) {
+    t.insert({a: i, b: i % 10});
+}
+assert.eq(null, db.getLastError());
+
+var admin = db.getSiblingDB("admin");
+
+function findStage(stats, type) {
+    if (stats.type == type) {
+        return stats;
+    }
+    for (var i = 0; i < stats.children.length; i++) {
+        var found = findStage(stats.children[i], type);
+        if (found) {
+            return found;
+        }
+    }
+    return null;
+}
+
+// Without timing there are counters but no cycles
+assert.commandWorked(admin.runCommand({setParameter: 1, planStageTiming: false}));
+var explain = t.find({a: {$gte: 50}}).sort({b: 1}).hint({a: 1}).explain(true);
+var sort = findStage(explain.stats, "SORT");
+assert(sort, tojson(explain.stats));
+assert.eq(50, sort.advanced, tojson(sort));
+assert.gt(sort.memUsage, 0, tojson(sort));
+assert.eq(undefined, sort.cycles, tojson(sort));
+var ixscan = findStage(explain.stats, "IXSCAN");
+assert.eq(50, ixscan.advanced, tojson(ixscan));
+
+assert.commandWorked(admin.runCommand({setParameter: 1, planStageTiming: true}));
+try {
+    explain = t.find({a: {$gte: 50}}).sort({b: 1}).hint({a: 1}).explain(true);
+    sort = findStage(explain.stats, "SORT");
+    var fetch = findStage(explain.stats, "FETCH");
+    assert.gt(sort.cycles, 0, tojson(explain.stats));
+    assert.gt(fetch.cycles, 0, tojson(explain.stats));
+    // a stage's time includes its children's
+    assert.gte(sort.cycles, fetch.cycles, tojson(explain.stats));
+    assert.lte(sort.selfCycles, sort.cycles, tojson(sort));
+}
+finally {
+    admin.runCommand({setParameter: 1, planStageTiming: false});
+}
+
+t.drop();
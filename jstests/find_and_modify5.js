@@ -0,0 +1,70 @@
+// findAndModify finds, modifies and returns the images of one document in a single pass: check
+// positional updates, sorts, and that the images returned are those of the document modified.
+
+t = db.find_and_modify5;
+t.drop();
+
+for (var i = 0; i < 10; i++) {
+    t.insert({ _id: i, pri: i % 3, items: [ { k: "a", n: 0 }, { k: "b", n: 0 } ], state: "ready" });
+}
+
+// positional update with a query on an array, returning the new image
+var doc = t.findAndModify({ query: { "items.k": "b", state: "ready" },
+                            sort: { pri: -1, _id: 1 },
+                            update: { $inc: { "items.$.n": 1 }, $set: { state: "taken" } },
+                            new: true });
+assert.eq(2, doc._id);
+assert.eq([ { k: "a", n: 0 }, { k: "b", n: 1 } ], doc.items);
+assert.eq("taken", doc.state);
+assert.eq(doc, t.findOne({ _id: 2 }));
+
+// the old image is the document before the update, even when it is updated in place
+doc = t.findAndModify({ query: { state: "ready" },
+                        sort: { pri: -1, _id: 1 },
+                        update: { $inc: { "items.1.n": 5 } } });
+assert.eq(5, doc._id);
+assert.eq(0, doc.items[1].n);
+assert.eq(5, t.findOne({ _id: 5 }).items[1].n);
+
+// a document which has to move is still returned as updated, with a projection
+var big = new Array(4096).join("x");
+doc = t.findAndModify({ query: { state: "ready", pri: 0 },
+                        sort: { _id: -1 },
+                        update: { $set: { state: "taken", pad: big } },
+                        fields: { pad: 0 },
+                        new: true });
+assert.eq(9, doc._id);
+assert.eq("taken", doc.state);
+assert.eq(undefined, doc.pad);
+assert.eq(big, t.findOne({ _id: 9 }).pad);
+
+// a queue: take the ready documents in priority order until there are none left
+var taken = [];
+while ((doc = t.findAndModify({ query: { state: "ready" },
+                                sort: { pri: 1, _id: 1 },
+                                update: { $set: { state: "taken" } },
+                                new: true })) != null) {
+    assert.eq("taken", doc.state);
+    taken.push(doc._id);
+}
+assert.eq([ 0, 3, 6, 1, 4, 7, 5, 8 ], taken);
+assert.eq(0, t.count({ state: "ready" }));
+
+// remove with a sort returns the document removed
+doc = t.findAndModify({ query: { state: "taken" }, sort: { _id: -1 }, remove: true });
+assert.eq(9, doc._id);
+assert.eq(null, t.findOne({ _id: 9 }));
+assert.eq(9, t.count());
+
+// nothing matches
+assert.eq(null, t.findAndModify({ query: { state: "none" }, update: { $set: { x: 1 } } }));
+assert.eq(null, t.findAndModify({ query: { state: "none" }, remove: true }));
+
+// upsert with a sort
+var res = t.runCommand("findAndModify", { query: { _id: 20, state: "new" }, sort: { pri: 1 },
+                                          update: { $set: { pri: 5 } }, upsert: true,
+                                          new: true });
+assert.commandWorked(res);
+assert.eq({ _id: 20, state: "new", pri: 5 }, res.value);
+assert.eq(false, res.lastErrorObject.updatedExisting);
+assert.eq(20, res.lastErrorObject.upserted);
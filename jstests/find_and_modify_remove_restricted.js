@@ -0,0 +1,35 @@
+// findAndModify's remove refuses the collections a plain remove does, without removing or
+// logging anything.
+
+t = db.find_and_modify_remove_restricted;
+t.drop();
+
+// capped
+db.createCollection( t.getName() , { capped : true , size : 4096 } );
+t.insert( { _id : 1 , x : 1 } );
+t.insert( { _id : 2 , x : 2 } );
+
+res = db.runCommand( { findAndModify : t.getName() , query : { x : 1 } , remove : true } );
+assert.commandFailed( res );
+assert.eq( 10101 , res.code , tojson( res ) );
+assert.eq( 2 , t.count() );
+assert.eq( 1 , t.find( { x : 1 } ).itcount() );
+
+// findAndModify's updates still work there
+ret = t.findAndModify( { query : { x : 2 } , update : { $inc : { x : 1 } } , new : true } );
+assert.eq( 3 , ret.x );
+
+// system
+t.drop();
+t.ensureIndex( { x : 1 } );
+indexes = db.system.indexes.count();
+
+res = db.runCommand( { findAndModify : "system.indexes" ,
+                       query : { ns : t.getFullName() } ,
+                       remove : true } );
+assert.commandFailed( res );
+assert.eq( 12050 , res.code , tojson( res ) );
+assert.eq( indexes , db.system.indexes.count() );
+assert.eq( 2 , t.getIndexes().length );
+
+t.drop();
@@ -0,0 +1,64 @@
+// A text search sorted by score with a limit finds the same top documents, with the same scores,
+// as one without, while reading fewer index keys.
+
+var t = db.fts_topk;
+t.drop();
+
+var words = ["apple", "banana", "cherry", "grape", "lemon", "mango", "peach", "plum"];
+Random.setRandomSeed();
+for (var i = 0; i < 2000; i++) {
+    var text = [];
+    var n = 1 + Random.randInt(30);
+    for (var j = 0; j < n; j++) {
+        text.push(words[Random.randInt(words.length)]);
+    }
+    t.insert({_id: i, title: words[Random.randInt(words.length)], body: text.join(" "),
+              even: i % 2 == 0});
+}
+t.ensureIndex({title: "text", body: "text"}, {weights: {title: 5}});
+assert.eq(null, db.getLastError());
+
+var byScore = {score: {$meta: "textScore"}};
+
+function check(query, limit) {
+    var all = t.find(query, byScore).sort(byScore).toArray();
+    var top = t.find(query, byScore).sort(byScore).limit(limit).toArray();
+    assert.eq(Math.min(limit, all.length), top.length, tojson(query));
+    for (var i = 0; i < top.length; i++) {
+        // Documents tied on score may come in either order
+        assert.close(all[i].score, top[i].score, tojson(query) + " result " + i);
+    }
+    var topIds = {};
+    top.forEach(function(doc) { topIds[doc._id] = doc.score; });
+    all.forEach(function(doc) {
+        if (topIds[doc._id] !== undefined) {
+            assert.close(doc.score, topIds[doc._id], tojson(query) + " _id " + doc._id);
+        }
+    });
+}
+
+check({$text: {$search: "apple"}}, 10);
+check({$text: {$search: "apple banana cherry"}}, 10);
+check({$text: {$search: "apple banana cherry grape lemon mango peach plum"}}, 5);
+check({$text: {$search: "apple apple"}}, 3);
+check({$text: {$search: "plum peach"}}, 5000);
+check({$text: {$search: "apple peach"}, even: true}, 20);
+check({$text: {$search: "apple \"banana cherry\""}}, 10);
+check({$text: {$search: "apple banana -cherry"}}, 10);
+check({$text: {$search: "nothing"}}, 10);
+
+// Fewer keys are read than there are documents with the terms
+var explain = t.find({$text: {$search: "apple banana"}}, byScore).sort(byScore).limit(5).explain();
+var fullExplain = t.find({$text: {$search: "apple banana"}}, byScore).sort(byScore).explain();
+assert.lt(explain.nscanned, fullExplain.nscanned, tojson(explain));
+
+// The text command limits the same way
+var res = t.runCommand("text", {search: "cherry grape", limit: 7});
+assert.commandWorked(res);
+var expected = t.find({$text: {$search: "cherry grape"}}, byScore).sort(byScore).toArray();
+assert.eq(7, res.results.length);
+for (var i = 0; i < res.results.length; i++) {
+    assert.close(expected[i].score, res.results[i].score);
+}
+
+t.drop();
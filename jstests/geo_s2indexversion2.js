@@ -0,0 +1,78 @@
+// A 2dsphere index keyed by integer cell ids (2dsphereIndexVersion 2) answers queries just as
+// one keyed by cell id strings does.
+
+var v1 = db.geo_s2indexversion1;
+var v2 = db.geo_s2indexversion2;
+v1.drop();
+v2.drop();
+
+Random.setRandomSeed();
+for (var i = 0; i < 2000; i++) {
+    // Points all over the globe, so that every face of the cube is covered
+    var doc = {_id: i,
+               geo: {type: "Point",
+                     coordinates: [Random.rand() * 360 - 180, Random.rand() * 180 - 90]}};
+    v1.insert(doc);
+    v2.insert(doc);
+}
+v1.insert({_id: "poly",
+           geo: {type: "Polygon", coordinates: [[[-10, -10], [10, -10], [10, 10], [-10, -10]]]}});
+v2.insert({_id: "poly",
+           geo: {type: "Polygon", coordinates: [[[-10, -10], [10, -10], [10, 10], [-10, -10]]]}});
+
+v1.ensureIndex({geo: "2dsphere"});
+assert.eq(null, db.getLastError());
+v2.ensureIndex({geo: "2dsphere"}, {"2dsphereIndexVersion": 2});
+assert.eq(null, db.getLastError());
+
+// Keys of a version 2 index are numbers
+var keys = v2.find({_id: 0}).hint({geo: "2dsphere"}).returnKey().toArray();
+assert.eq("number", typeof keys[0].geo, tojson(keys));
+
+function ids(cursor) {
+    return cursor.toArray().map(function(doc) { return doc._id; });
+}
+
+function checkSame(query) {
+    var expected = ids(v1.find(query).sort({_id: 1}));
+    var actual = ids(v2.find(query).sort({_id: 1}));
+    assert.eq(expected, actual, tojson(query));
+    return actual.length;
+}
+
+var boxes = [[[-180, -90], [180, -90], [180, 90], [-180, 90], [-180, -90]],
+             [[-5, -5], [5, -5], [5, 5], [-5, 5], [-5, -5]],
+             [[100, 40], [140, 40], [140, 80], [100, 80], [100, 40]],
+             [[-179, -60], [-120, -60], [-120, -10], [-179, -10], [-179, -60]]];
+var found = 0;
+for (var i = 0; i < boxes.length; i++) {
+    var poly = {type: "Polygon", coordinates: [boxes[i]]};
+    found += checkSame({geo: {$geoWithin: {$geometry: poly}}});
+    found += checkSame({geo: {$geoIntersects: {$geometry: poly}}});
+}
+assert.gt(found, 0);
+checkSame({geo: {$geoIntersects: {$geometry: {type: "Point", coordinates: [1, 1]}}}});
+checkSame({geo: {$geoWithin: {$centerSphere: [[50, 50], 0.2]}}});
+
+// $near returns the same points in the same order
+var near = {geo: {$near: {$geometry: {type: "Point", coordinates: [30, 30]}}}};
+assert.eq(ids(v1.find(near).limit(200)), ids(v2.find(near).limit(200)));
+var res1 = db.runCommand({geoNear: v1.getName(), near: {type: "Point", coordinates: [-70, 10]},
+                          spherical: true, num: 100});
+var res2 = db.runCommand({geoNear: v2.getName(), near: {type: "Point", coordinates: [-70, 10]},
+                          spherical: true, num: 100});
+assert.commandWorked(res2);
+assert.eq(res1.results.map(function(r) { return r.obj._id; }),
+          res2.results.map(function(r) { return r.obj._id; }));
+
+// Unknown versions are refused
+var bad = db.geo_s2indexversion3;
+bad.drop();
+bad.insert({geo: {type: "Point", coordinates: [0, 0]}});
+bad.ensureIndex({geo: "2dsphere"}, {"2dsphereIndexVersion": 3});
+assert(db.getLastError());
+assert.eq(1, bad.getIndexes().length);
+
+v1.drop();
+v2.drop();
+bad.drop();
@@ -0,0 +1,39 @@
+// $near grows its search annulus with the density of the points it finds and skips points it
+// has already placed.  Whatever the density, every point comes back once, nearest first.
+t = db.geo_s2near_density;
+t.drop();
+t.ensureIndex({geo: "2dsphere"});
+
+// A dense cluster around the origin, then sparse points out to a few hundred kilometers
+var n = 0;
+for (var i = 0; i < 30; i++) {
+    for (var j = 0; j < 30; j++) {
+        t.insert({_id: n++, geo: {type: "Point", coordinates: [i * 0.0001, j * 0.0001]}});
+    }
+}
+for (var i = 1; i <= 100; i++) {
+    t.insert({_id: n++, geo: {type: "Point", coordinates: [i * 0.03, -i * 0.02]}});
+}
+assert.eq(null, db.getLastError());
+
+var origin = {type: "Point", coordinates: [0, 0]};
+var res = db.runCommand({geoNear: t.getName(), near: origin, spherical: true, num: n});
+assert.commandWorked(res);
+assert.eq(n, res.results.length);
+
+var seen = {};
+for (var i = 0; i < res.results.length; i++) {
+    var id = res.results[i].obj._id;
+    assert(!seen[id], "returned twice: " + id);
+    seen[id] = true;
+    if (i > 0) {
+        assert.lte(res.results[i - 1].dis, res.results[i].dis);
+    }
+}
+
+// A $near cursor agrees, and $maxDistance cuts it off
+assert.eq(n, t.find({geo: {$near: {$geometry: origin}}}).itcount());
+var within = res.results.filter(function(r) { return r.dis <= 100000; }).length;
+assert.eq(within, t.find({geo: {$near: {$geometry: origin, $maxDistance: 100000}}}).itcount());
+
+t.drop();
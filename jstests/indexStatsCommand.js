@@ -59,10 +59,18 @@ function textWithIndexVersion(version) {
         assert(isObject(data.fillRatio));
         assert.neq(data.fillRatio, null);
         checkStats(data.fillRatio);
+
+        assert(isObject(data.prefixRatio));
+        assert.neq(data.prefixRatio, null);
+        checkStats(data.prefixRatio);
+        assert.gte(data.prefixRatio.min, 0);
+        assert.lte(data.prefixRatio.max, 1);
     }
 
     assert(isObject(result.overall));
     checkAreaStats(result.overall);
+    // only 13 distinct keys, so neighbors in a bucket are mostly identical
+    assert.gt(result.overall.prefixRatio.mean, 0.5);
 
     assert(result.perLevel instanceof Array);
     for (var i = 0; i < result.perLevel.length; ++i) {
@@ -86,3 +94,12 @@ function textWithIndexVersion(version) {
 }
 
 [0, 1].map(textWithIndexVersion);
+
+// a hashtable index has no btree to walk
+t.ensureIndex({i: "hashtable"}, {name: "test_i_hashtable"});
+result = t.indexStats({index: "test_i_hashtable"});
+if (!result["bad cmd"]) {
+    assert.commandFailed(result);
+    assert(result.errmsg.match(/not a btree/));
+}
+t.dropIndex("test_i_hashtable");
@@ -0,0 +1,88 @@
+// A hashtable index finds the same documents as a collection scan for equality and $in, while
+// its buckets split, overflow and empty out underneath it.
+
+var t = db.index_hashtable;
+t.drop();
+
+// start empty, so that every bucket and directory slot comes from a split
+t.ensureIndex({u: "hashtable"});
+assert.eq(null, db.getLastError());
+
+for (var i = 0; i < 20000; i++) {
+    // u: 7 has far more records than fit in a bucket
+    t.insert({_id: i, u: (i % 10 == 0) ? 7 : "user" + i, n: i});
+}
+t.insert({_id: "missing"});
+assert.eq(null, db.getLastError());
+
+function check(name) {
+    var keys = ["user1", "user19999", "nobody", 7, null];
+    for (var k = 0; k < keys.length; k++) {
+        var q = {u: keys[k]};
+        assert.eq(t.find(q).hint({$natural: 1}).itcount(),
+                  t.find(q).hint({u: "hashtable"}).itcount(), name + " " + tojson(q));
+    }
+
+    var q = {u: {$in: ["user3", "user5", 7, "nobody"]}};
+    assert.eq(t.find(q).hint({$natural: 1}).itcount(),
+              t.find(q).hint({u: "hashtable"}).itcount(), name + " " + tojson(q));
+
+    // with no usable bounds the whole index is walked
+    assert.eq(t.count(), t.find().hint({u: "hashtable"}).itcount(), name);
+
+    var v = t.validate(true);
+    assert(v.valid, name + " " + tojson(v));
+    assert.eq(t.count(), v.keysPerIndex[t.getFullName() + ".$u_hashtable"], name + " " + tojson(v));
+}
+check("after inserts");
+
+// the planner picks it for equality
+var explain = t.find({u: "user1"}).explain();
+assert.eq("BtreeCursor u_hashtable", explain.cursor, tojson(explain));
+assert.eq(1, explain.n);
+
+t.update({n: {$lt: 1000}}, {$set: {u: "moved"}}, false, true);
+t.remove({u: 7, n: {$gte: 10000}});
+// grow some documents so that they move
+t.update({n: {$gte: 2000, $lt: 2100}}, {$set: {pad: new Array(512).join("x")}}, false, true);
+assert.eq(null, db.getLastError());
+check("after updates");
+
+// nothing is returned twice across getMores, whether looking up or walking
+var ids = {};
+t.find({u: 7}).hint({u: "hashtable"}).batchSize(10).forEach(function(doc) {
+    assert(!ids[doc._id], "dup " + doc._id);
+    ids[doc._id] = true;
+});
+ids = {};
+var n = 0;
+t.find().hint({u: "hashtable"}).batchSize(100).forEach(function(doc) {
+    assert(!ids[doc._id], "dup " + doc._id);
+    ids[doc._id] = true;
+    n++;
+});
+assert.eq(t.count(), n);
+
+// built over existing documents, in the foreground and the background
+t.dropIndex({u: "hashtable"});
+t.ensureIndex({u: "hashtable"});
+assert.eq(null, db.getLastError());
+check("foreground build");
+
+t.dropIndex({u: "hashtable"});
+t.ensureIndex({u: "hashtable"}, {background: true});
+assert.eq(null, db.getLastError());
+check("background build");
+
+// whole values only
+t.insert({u: [1, 2]});
+assert(db.getLastError());
+
+// a hashtable index is single field, not unique and uses the default seed
+t.dropIndexes();
+t.ensureIndex({u: "hashtable", n: 1});
+assert(db.getLastError());
+t.ensureIndex({u: "hashtable"}, {unique: true});
+assert(db.getLastError());
+t.ensureIndex({u: "hashtable"}, {seed: 5});
+assert(db.getLastError());
@@ -0,0 +1,46 @@
+// Plans that intersect single field indexes must return what the collection scan does, whether
+// the intersection is hashed or sorted by DiskLoc, and whichever plan wins.
+
+var t = db.index_intersection;
+t.drop();
+
+for (var i = 0; i < 3000; i++) {
+    t.insert({a: i % 10, b: i % 11, c: i % 13, d: [i % 7, i % 5]});
+}
+t.ensureIndex({a: 1});
+t.ensureIndex({b: 1});
+t.ensureIndex({c: 1});
+t.ensureIndex({d: 1});
+db.getLastError();
+
+function setIntersection(on) {
+    assert.commandWorked(db.adminCommand({setParameter: 1, enableIndexIntersection: on}));
+}
+
+var queries = [{a: 3, b: 4},
+               {a: 3, b: 4, c: 5},
+               {a: {$gt: 7}, b: 2},
+               {a: {$in: [1, 2]}, b: {$lte: 3}, c: {$ne: 6}},
+               {a: 1, d: 3},
+               {d: 2, d: 4},
+               {a: 5, $or: [{b: 1}, {c: 2}]},
+               {$or: [{a: 1}, {b: 1}], $or: [{c: 1}, {d: 1}]}];
+
+function check() {
+    for (var i = 0; i < queries.length; i++) {
+        var q = queries[i];
+        var expected = t.find(q).hint({$natural: 1}).sort({_id: 1}).toArray();
+        assert.eq(expected, t.find(q).sort({_id: 1}).toArray(), tojson(q));
+        assert.eq(expected.length, t.find(q).itcount(), tojson(q));
+    }
+}
+
+setIntersection(true);
+try {
+    check();
+    setIntersection(false);
+    check();
+}
+finally {
+    setIntersection(true);
+}
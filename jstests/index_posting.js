@@ -0,0 +1,68 @@
+// A posting index answers the same queries as a regular index on the field, in the same order,
+// across inserts, updates and removes that split and empty its blocks.
+
+var t = db.index_posting;
+t.drop();
+
+var statuses = ["new", "active", "done", 5, null];
+for (var i = 0; i < 3000; i++) {
+    t.insert({_id: i, status: statuses[i % statuses.length], n: i});
+}
+// and an index built over existing documents
+t.ensureIndex({status: "posting"});
+assert.eq(null, db.getLastError());
+
+function check() {
+    for (var s = 0; s < statuses.length; s++) {
+        var q = {status: statuses[s]};
+        assert.eq(t.find(q).hint({$natural: 1}).itcount(),
+                  t.find(q).hint({status: "posting"}).itcount(), tojson(q));
+    }
+
+    var q = {status: {$in: ["new", "done"]}};
+    assert.eq(t.find(q).hint({$natural: 1}).itcount(),
+              t.find(q).hint({status: "posting"}).itcount(), tojson(q));
+
+    q = {status: {$gt: "b", $lt: "e"}};
+    assert.eq(t.find(q).hint({$natural: 1}).itcount(),
+              t.find(q).hint({status: "posting"}).itcount(), tojson(q));
+
+    q = {status: {$ne: "active"}};
+    assert.eq(t.find(q).hint({$natural: 1}).itcount(),
+              t.find(q).hint({status: "posting"}).itcount(), tojson(q));
+
+    var v = t.validate(true);
+    assert(v.valid, tojson(v));
+    assert.eq(t.count(), v.keysPerIndex[t.getFullName() + ".$status_posting"], tojson(v));
+}
+check();
+
+// writes go through the blocks one record at a time
+for (var i = 3000; i < 4000; i++) {
+    t.insert({_id: i, status: statuses[i % statuses.length], n: i});
+}
+t.update({n: {$lt: 1000}}, {$set: {status: "active"}}, false, true);
+t.remove({_id: {$gte: 3500}});
+// grow some documents so that they move
+t.update({n: {$gte: 2000, $lt: 2100}}, {$set: {pad: new Array(512).join("x")}}, false, true);
+assert.eq(null, db.getLastError());
+check();
+
+// nothing is returned twice across getMores
+var ids = {};
+t.find({status: "active"}).hint({status: "posting"}).batchSize(10).forEach(function(doc) {
+    assert(!ids[doc._id], "dup " + doc._id);
+    ids[doc._id] = true;
+});
+
+// emptying a value drops its blocks
+t.remove({status: "done"});
+assert.eq(0, t.find({status: "done"}).hint({status: "posting"}).itcount());
+check();
+
+// a posting index is single field and not unique
+t.dropIndexes();
+t.ensureIndex({status: "posting", n: 1});
+assert(db.getLastError());
+t.ensureIndex({status: "posting"}, {unique: true});
+assert(db.getLastError());
@@ -0,0 +1,38 @@
+// Skip scans over a compound index whose first field has no predicate.
+
+var t = db.index_skip_scan;
+t.drop();
+
+for (var i = 0; i < 1000; i++) {
+    t.insert({a: i % 4, b: i % 100, c: i});
+}
+db.getLastError();
+
+var queries = [
+    {b: 5},
+    {b: {$gt: 95}},
+    {b: {$in: [3, 50, 500]}},
+    {b: {$gte: 10, $lt: 12}, c: {$gt: 500}},
+    {b: 5, c: {$mod: [2, 1]}},
+];
+
+var expected = queries.map(function(q) { return t.find(q).sort({c: 1}).toArray(); });
+
+t.ensureIndex({a: 1, b: 1});
+
+var old = db.adminCommand({setParameter: 1, enableIndexSkipScan: true}).was;
+
+for (var i = 0; i < queries.length; i++) {
+    var q = queries[i];
+    assert.eq(expected[i], t.find(q).sort({c: 1}).toArray(), tojson(q));
+
+    // Forcing the index must seek between the four values of 'a' rather than read every key.
+    var explain = t.find(q).hint({a: 1, b: 1}).explain();
+    assert.eq(expected[i].length, explain.n, tojson(q));
+    assert.gt(1000, explain.nscanned, tojson(q));
+}
+
+// The skip scan competes with the collection scan and wins when there are few prefixes.
+assert.eq("BtreeCursor a_1_b_1", t.find({b: 5}).explain().cursor);
+
+db.adminCommand({setParameter: 1, enableIndexSkipScan: old});
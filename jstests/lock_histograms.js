@@ -0,0 +1,32 @@
+// serverStatus reports a histogram of lock acquisition times per lock and mode.
+
+var t = db.jstests_lock_histograms;
+t.drop();
+for (var i = 0; i < 100; i++) {
+    t.insert({_id: i});
+}
+t.find().itcount();
+
+function total(histograms, mode) {
+    var n = 0;
+    (histograms[mode] || []).forEach(function(bucket) {
+        assert.gt(bucket.count, 0, tojson(bucket));
+        assert.gt(bucket.upTo, 0, tojson(bucket));
+        n += bucket.count;
+    });
+    return n;
+}
+
+var locks = db.serverStatus().locks;
+printjson(locks["."]);
+
+var global = locks["."].acquireHistogramMicros;
+assert(global, "no histograms for the global lock");
+assert.gt(total(global, "w"), 0);
+assert.gt(total(global, "r"), 0);
+
+var mine = locks[db.getName()].acquireHistogramMicros;
+assert(mine, "no histograms for " + db.getName());
+assert.gt(total(mine, "w"), 0);
+
+t.drop();
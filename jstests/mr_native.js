@@ -0,0 +1,62 @@
+// Common sum-by-key map and reduce functions run without JS, and give the same results as the
+// equivalent functions that do.
+
+var t = db.mr_native;
+t.drop();
+
+for (var i = 0; i < 1000; i++) {
+    t.save({_id: i, k: i % 7, s: "s" + (i % 3), v: i, d: {n: i % 2 ? 0.5 : NumberInt(2)}});
+}
+// documents that the native mapper hands to JS
+t.save({_id: 1000, k: [1, 2], v: 1});
+t.save({_id: 1001, k: 3, v: NumberLong(5)});
+t.save({_id: 1002, v: 4});
+t.save({_id: 1003, k: 4});
+t.save({_id: 1004, k: 5, v: "x"});
+
+function results(map, reduce, options) {
+    options = Object.extend({out: {inline: 1}}, options || {});
+    var res = t.mapReduce(map, reduce, options);
+    var x = {};
+    res.results.forEach(function(z) { x[tojson(z._id)] = z.value; });
+    return x;
+}
+
+// The comments keep these from being recognized, so they always run in JS.
+function checkSame(map, reduce, jsMap, jsReduce, options) {
+    var expected = results(jsMap, jsReduce, options);
+    assert.eq(expected, results(map, reduce, options));
+    return expected;
+}
+
+var sumReduce = function(key, values) { return Array.sum(values); };
+var jsSumReduce = function(key, values) { /* js */ return Array.sum(values); };
+
+var byK = checkSame(function() { emit(this.k, this.v); }, sumReduce,
+                    function() { /* js */ emit(this.k, this.v); }, jsSumReduce);
+assert.eq(71071, byK["0"]);
+
+checkSame(function() { emit(this.s, 1); }, sumReduce,
+          function() { /* js */ emit(this.s, 1); }, jsSumReduce);
+checkSame(function() { emit(this.k, this.d.n); }, sumReduce,
+          function() { /* js */ emit(this.k, this.d.n); }, jsSumReduce);
+
+// jsMode is ignored by the native mapper but still used with a native reducer
+checkSame(function() { emit(this.k, this.v); }, sumReduce,
+          function() { /* js */ emit(this.k, this.v); }, jsSumReduce, {jsMode: true});
+checkSame(function() { /* js */ emit(this.k, this.v); }, sumReduce,
+          function() { /* js */ emit(this.k, this.v); }, jsSumReduce, {jsMode: true});
+
+// finalize, query and scope
+var options = {query: {k: {$lt: 5}},
+               scope: {scale: 10},
+               finalize: function(key, value) { return value * scale; }};
+checkSame(function() { emit(this.k, 2); }, sumReduce,
+          function() { /* js */ emit(this.k, 2); }, jsSumReduce, options);
+
+// output to a collection
+var out = t.mapReduce(function() { emit(this.k, 1); }, sumReduce, {out: "mr_native_out"});
+assert.eq(1005, Array.sum(out.find().toArray().map(function(z) { return z.value; })));
+out.drop();
+
+t.drop();
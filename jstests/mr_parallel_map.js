@@ -0,0 +1,71 @@
+// With mapReduceMapThreads set, the JS map function runs on several threads and mapReduce gives
+// the same results as mapping on one.
+
+var t = db.mr_parallel_map;
+t.drop();
+
+for (var i = 0; i < 5000; i++) {
+    t.save({_id: i, k: i % 13, tags: ["a" + (i % 3), "b" + (i % 5)]});
+}
+
+// not a form that runs natively
+function map() {
+    for (var i = 0; i < this.tags.length; i++) {
+        emit(this.tags[i], {count: 1, ids: this._id % 2});
+    }
+}
+
+function reduce(key, values) {
+    var res = {count: 0, ids: 0};
+    values.forEach(function(v) {
+        res.count += v.count;
+        res.ids += v.ids;
+    });
+    return res;
+}
+
+function results(options) {
+    var res = t.mapReduce(map, reduce, Object.extend({out: {inline: 1}}, options || {}));
+    var x = {};
+    res.results.forEach(function(z) { x[z._id] = z.value; });
+    return {values: x, counts: res.counts};
+}
+
+var original = db.adminCommand({getParameter: 1, mapReduceMapThreads: 1}).mapReduceMapThreads;
+var serial = results();
+
+assert.commandWorked(db.adminCommand({setParameter: 1, mapReduceMapThreads: 4}));
+try {
+    var parallel = results();
+    assert.eq(serial.values, parallel.values);
+    assert.eq(serial.counts, parallel.counts);
+
+    // query and limit are applied before the documents reach the threads
+    assert.eq(results({query: {k: 1}, limit: 100}).values,
+              (function() {
+                  assert.commandWorked(db.adminCommand({setParameter: 1,
+                                                        mapReduceMapThreads: 1}));
+                  var res = results({query: {k: 1}, limit: 100}).values;
+                  assert.commandWorked(db.adminCommand({setParameter: 1,
+                                                        mapReduceMapThreads: 4}));
+                  return res;
+              })());
+
+    // output to a collection
+    var out = t.mapReduce(map, reduce, {out: "mr_parallel_map_out"});
+    assert.eq(8, out.find().count());
+    out.drop();
+
+    // an error in one of the threads fails the command
+    var res = db.runCommand({mapreduce: t.getName(),
+                             map: function() { if (this._id == 4321) throw "bad doc"; },
+                             reduce: reduce,
+                             out: {inline: 1}});
+    assert.commandFailed(res);
+    assert.neq(-1, tojson(res).indexOf("bad doc"));
+}
+finally {
+    assert.commandWorked(db.adminCommand({setParameter: 1, mapReduceMapThreads: original}));
+}
+
+t.drop();
@@ -0,0 +1,51 @@
+// mapReduce output to a collection spills its intermediate tuples to sorted temp files and
+// merges them for the final reduce.
+
+var t = db.mr_spill;
+t.drop();
+
+// enough distinct keys to fill the in memory map several times
+var pad = new Array(200).join("x");
+for (var i = 0; i < 20000; i++) {
+    t.save({_id: i, k: i % 5000, pad: pad});
+}
+
+function map() {
+    emit(this.k, {count: 1, pad: this.pad.length});
+}
+
+function reduce(key, values) {
+    var res = {count: 0, pad: 0};
+    values.forEach(function(v) {
+        res.count += v.count;
+        res.pad += v.pad;
+    });
+    return res;
+}
+
+var original = db.adminCommand({getParameter: 1,
+                                mapReduceSpillMaxMemoryBytes: 1}).mapReduceSpillMaxMemoryBytes;
+
+// a small budget so the spilled tuples are written to several sorted runs
+assert.commandWorked(db.adminCommand({setParameter: 1, mapReduceSpillMaxMemoryBytes: 64 * 1024}));
+try {
+    var out = t.mapReduce(map, reduce, {out: "mr_spill_out"});
+    assert.eq(20000, out.counts.input);
+    assert.eq(20000, out.counts.emit);
+    assert.eq(5000, out.counts.output);
+    out.find().forEach(function(z) {
+        assert.eq({count: 4, pad: 4 * 199}, z.value, tojson(z));
+    });
+    out.drop();
+
+    // no intermediate collection is left behind
+    db.getCollectionNames().forEach(function(name) {
+        assert.eq(-1, name.indexOf("tmp.mr"), name);
+    });
+}
+finally {
+    assert.commandWorked(db.adminCommand({setParameter: 1,
+                                          mapReduceSpillMaxMemoryBytes: original}));
+}
+
+t.drop();
@@ -0,0 +1,47 @@
+// The cursors handed back by parallelCollectionScan cover the collection between them, each
+// document exactly once.
+
+var t = db.parallel_collection_scan;
+t.drop();
+
+assert.commandFailed(db.runCommand({parallelCollectionScan: t.getName(), numCursors: 2}));
+
+// enough data for several extents
+var s = "";
+while (s.length < 10000)
+    s += ".";
+for (var i = 0; i < 8000; i++) {
+    t.insert({_id: i, s: s});
+}
+db.getLastError();
+
+assert.commandFailed(db.runCommand({parallelCollectionScan: t.getName(), numCursors: 0}));
+assert.commandFailed(db.runCommand({parallelCollectionScan: t.getName(), numCursors: "x"}));
+
+function drain(numCursors) {
+    var res = db.runCommand({parallelCollectionScan: t.getName(), numCursors: numCursors});
+    assert.commandWorked(res);
+    assert.lte(res.cursors.length, numCursors);
+
+    var seen = {};
+    var total = 0;
+    res.cursors.forEach(function(c) {
+        var cursor = new DBCommandCursor(db.getMongo(), {ok: 1, cursor: c.cursor});
+        while (cursor.hasNext()) {
+            var id = cursor.next()._id;
+            assert(!seen[id], "duplicate " + id);
+            seen[id] = true;
+            total++;
+        }
+    });
+    assert.eq(t.count(), total, "numCursors: " + numCursors);
+    return res.cursors.length;
+}
+
+assert.eq(1, drain(1));
+assert.lt(1, drain(4));
+drain(1000);
+
+// the ranges still add up once part of the collection has been removed
+t.remove({_id: {$gte: 7000}});
+drain(3);
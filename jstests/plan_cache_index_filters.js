@@ -0,0 +1,69 @@
+// Index filters restrict the indexes the planner considers for a query shape.
+
+var t = db.plan_cache_index_filters;
+t.drop();
+
+for (var i = 0; i < 1000; i++) {
+    t.insert({a: i % 10, b: i});
+}
+t.ensureIndex({a: 1});
+t.ensureIndex({b: 1});
+t.ensureIndex({a: 1, b: 1});
+db.getLastError();
+
+function listFilters() {
+    var res = t.runCommand("planCacheListFilters");
+    assert.commandWorked(res);
+    return res.filters;
+}
+
+assert.eq(0, listFilters().length);
+
+// b: 5 is the obvious choice; the filter only leaves {a: 1}.
+var query = {a: 3, b: 5};
+assert.neq("BtreeCursor a_1", t.find(query).explain().cursor);
+assert.commandWorked(t.runCommand("planCacheSetFilter", {query: query, indexes: [{a: 1}]}));
+
+var filters = listFilters();
+assert.eq(1, filters.length, tojson(filters));
+assert.eq({a: 1}, filters[0].indexes[0]);
+
+// Same shape, different values: filtered.  Results are unchanged.
+var explain = t.find({a: 7, b: 17}).explain();
+assert.eq("BtreeCursor a_1", explain.cursor, tojson(explain));
+assert.eq(1, explain.n);
+assert.eq(1, t.find(query).itcount());
+
+// A different shape isn't, and neither is a hinted query.
+assert.neq("BtreeCursor a_1", t.find({a: 3, b: 5}).sort({b: 1}).explain().cursor);
+assert.eq("BtreeCursor b_1", t.find(query).hint({b: 1}).explain().cursor);
+
+// Indexes in the filter that don't exist leave only the collection scan.
+assert.commandWorked(t.runCommand("planCacheSetFilter", {query: query, indexes: [{c: 1}]}));
+assert.eq(1, listFilters().length);
+assert.eq("BasicCursor", t.find(query).explain().cursor);
+
+// Bad arguments.
+assert.commandFailed(t.runCommand("planCacheSetFilter", {query: query}));
+assert.commandFailed(t.runCommand("planCacheSetFilter", {query: query, indexes: []}));
+assert.commandFailed(t.runCommand("planCacheSetFilter", {query: query, indexes: ["a_1"]}));
+assert.commandFailed(t.runCommand("planCacheSetFilter", {indexes: [{a: 1}]}));
+assert.commandFailed(t.runCommand("planCacheSetFilter", {query: {$bogus: 1}, indexes: [{a: 1}]}));
+
+// Clearing one shape, then all of them.
+assert.commandWorked(t.runCommand("planCacheSetFilter",
+                                  {query: {b: 1}, sort: {a: 1}, indexes: [{b: 1}]}));
+assert.eq(2, listFilters().length);
+assert.commandWorked(t.runCommand("planCacheClearFilters", {query: {a: 1, b: 1}}));
+assert.commandFailed(t.runCommand("planCacheClearFilters", {query: {a: 1, b: 1}}));
+assert.eq(1, listFilters().length);
+assert.neq("BasicCursor", t.find(query).explain().cursor);
+
+assert.commandWorked(t.runCommand("planCacheClearFilters"));
+assert.eq(0, listFilters().length);
+
+// Filters go with the collection.
+assert.commandWorked(t.runCommand("planCacheSetFilter", {query: query, indexes: [{a: 1}]}));
+t.drop();
+t.insert({a: 1});
+assert.eq(0, listFilters().length);
@@ -0,0 +1,48 @@
+// planCacheListQueryShapes lists what the plan cache of a collection holds, and the cache keeps
+// one entry per query shape.
+
+var t = db.plan_cache_list_shapes;
+t.drop();
+
+for (var i = 0; i < 100; i++) {
+    t.insert({a: i, b: i % 10});
+}
+t.ensureIndex({a: 1});
+t.ensureIndex({b: 1});
+db.getLastError();
+
+function listShapes() {
+    var res = db.runCommand({planCacheListQueryShapes: t.getName()});
+    assert.commandWorked(res);
+    return res;
+}
+
+// A new index clears the cache.
+assert.eq(0, listShapes().shapes.length);
+
+// Two indexes are usable so the plan is picked by racing them, and the winner is cached.
+assert.eq(1, t.find({a: {$gte: 50}, b: 5}).itcount());
+assert.eq(5, t.find({a: {$gte: 50}, b: 5}).sort({a: 1}).itcount());
+
+var res = listShapes();
+printjson(res);
+assert.eq(2, res.stats.entries);
+assert.eq(res.shapes.length, res.stats.entries);
+assert.lte(res.stats.bytes, res.stats.maxBytes);
+
+// The most recently used shape is listed first.
+assert.eq({a: 1}, res.shapes[0].sort);
+assert.eq({}, res.shapes[1].sort);
+
+// Same shape, different values: no new entry, and it counts as a hit.
+var hits = res.stats.hits;
+t.find({a: {$gte: 10}, b: 3}).itcount();
+res = listShapes();
+assert.eq(2, res.stats.entries);
+assert.lt(hits, res.stats.hits);
+assert.eq({}, res.shapes[0].sort);
+
+assert.commandFailed(db.runCommand({planCacheListQueryShapes: "plan_cache_list_shapes_missing"}));
+
+t.ensureIndex({c: 1});
+assert.eq(0, listShapes().shapes.length);
@@ -0,0 +1,35 @@
+// profiler entries for requests off the wire say how long the request took to read, and
+// serverStatus keeps a histogram of those times and of the replies'
+
+// special db so that it can be run in parallel tests
+var stddb = db;
+var db = db.getSisterDB("profile5");
+
+try {
+    db.dropDatabase();
+    assert.commandWorked( db.runCommand( {profile:2} ) );
+
+    db.profile5.insert( {a: new Array(64 * 1024).join("x")} );
+    assert.eq( 1, db.profile5.find().itcount() );
+
+    assert.commandWorked( db.runCommand( {profile:0} ) );
+
+    var entry = db.system.profile.findOne( {op: "query", ns: "profile5.profile5"} );
+    assert( entry, "no profile entry" );
+    assert( entry.recvMicros >= 0, tojson( entry ) );
+
+    var timing = db.serverStatus().network.timing;
+    assert( timing, "no network timing" );
+    ["recvMicros", "replyMicros"].forEach( function( name ) {
+        var total = 0;
+        timing[name].forEach( function( bucket ) {
+            assert.gt( bucket.micros, 0, tojson( timing ) );
+            total += bucket.count;
+        } );
+        assert.gt( total, 0, name );
+    } );
+}
+finally {
+    db.dropDatabase();
+    db = stddb;
+}
@@ -0,0 +1,40 @@
+// the inserts of a write command are applied, and profiled, in groups rather than one by one
+
+// special db so that it can be run in parallel tests
+var stddb = db;
+var db = db.getSisterDB("profile6");
+
+try {
+    db.dropDatabase();
+    db.createCollection( "profile6" );
+    assert.commandWorked( db.runCommand( {profile:2} ) );
+
+    var docs = [];
+    for ( var i = 0; i < 10; i++ ) {
+        docs.push( {_id: i} );
+    }
+    var res = db.runCommand( {insert: "profile6", documents: docs} );
+    assert.commandWorked( res );
+    assert.eq( 10, res.n, tojson( res ) );
+
+    // a failed insert ends its group, and an unordered batch carries on past it
+    docs = [ {_id: 10}, {_id: 0}, {_id: 11} ];
+    res = db.runCommand( {insert: "profile6", documents: docs, ordered: false} );
+    assert.commandWorked( res );
+    assert.eq( 2, res.n, tojson( res ) );
+    assert.eq( 1, res.writeErrors.length, tojson( res ) );
+    assert.eq( 1, res.writeErrors[0].index, tojson( res ) );
+
+    assert.commandWorked( db.runCommand( {profile:0} ) );
+    assert.eq( 12, db.profile6.count() );
+
+    var inserts = db.system.profile.find( {op: "insert", ns: "profile6.profile6"} ).toArray();
+    assert.eq( 3, inserts.length, tojson( inserts ) );
+    assert.eq( 10, inserts[0].ninserted, tojson( inserts ) );
+    assert.eq( 1, inserts[1].ninserted, tojson( inserts ) );
+    assert.eq( 1, inserts[2].ninserted, tojson( inserts ) );
+}
+finally {
+    db.dropDatabase();
+    db = stddb;
+}
@@ -0,0 +1,65 @@
+// queryShapeStats aggregates the cost of queries by shape when trackQueryShapes is set.
+
+var coll = db.query_shape_stats;
+coll.drop();
+coll.ensureIndex({a: 1});
+for (var i = 0; i < 300; i++) {
+    coll.insert({a: i, b: i % 10});
+}
+assert.eq(null, db.getLastError());
+
+var admin = db.getSiblingDB("admin");
+
+function shapesOf(collection) {
+    var res = admin.runCommand({queryShapeStats: 1});
+    assert.commandWorked(res);
+    return res.shapes.filter(function(shape) { return shape.ns == collection.getFullName(); });
+}
+
+// Nothing is recorded while tracking is off
+assert.commandWorked(admin.runCommand({setParameter: 1, trackQueryShapes: false}));
+assert.commandWorked(admin.runCommand({queryShapeStats: 1, reset: true}));
+coll.find({a: 5}).itcount();
+assert.eq(0, shapesOf(coll).length);
+
+assert.commandWorked(admin.runCommand({setParameter: 1, trackQueryShapes: true}));
+try {
+    // Values don't matter to the shape
+    for (var i = 0; i < 10; i++) {
+        assert.eq(1, coll.find({a: i}).itcount());
+    }
+    // A collection scan, with a getMore
+    assert.eq(30, coll.find({b: 3}).batchSize(10).itcount());
+
+    var shapes = shapesOf(coll);
+    assert.eq(2, shapes.length, tojson(shapes));
+
+    var byA = shapes.filter(function(shape) { return shape.example.a !== undefined; })[0];
+    assert.eq(10, byA.count, tojson(byA));
+    assert.eq(10, byA.nreturned, tojson(byA));
+    assert.eq(10, byA.docsExamined, tojson(byA));
+    assert.gte(byA.totalMicros, byA.maxMicros, tojson(byA));
+    assert.gte(byA.micros.p99, byA.micros.p50, tojson(byA));
+    assert.gte(byA.maxMicros, byA.micros.p99, tojson(byA));
+
+    var byB = shapes.filter(function(shape) { return shape.example.b !== undefined; })[0];
+    assert.gt(byB.count, 1, tojson(byB));
+    assert.eq(30, byB.nreturned, tojson(byB));
+    assert.eq(300, byB.docsExamined, tojson(byB));
+
+    // Fewer shapes are kept than the limit
+    assert.commandWorked(admin.runCommand({setParameter: 1, queryShapeStatsMaxShapes: 1}));
+    coll.find({a: 1, b: 1}).itcount();
+    shapes = shapesOf(coll);
+    assert.eq(1, shapes.length, tojson(shapes));
+    assert.eq({a: 1, b: 1}, shapes[0].example);
+
+    assert.commandWorked(admin.runCommand({queryShapeStats: 1, reset: true}));
+    assert.eq(0, shapesOf(coll).length);
+}
+finally {
+    admin.runCommand({setParameter: 1, queryShapeStatsMaxShapes: 1000});
+    admin.runCommand({setParameter: 1, trackQueryShapes: false});
+}
+
+coll.drop();
@@ -0,0 +1,37 @@
+// Multi-deletes remove documents in batches, each index removing the keys of a whole batch in
+// key order.  Check that every key goes, whatever the index order or number of keys per document.
+
+t = db.jstests_removed;
+t.drop();
+
+t.ensureIndex( { a:1 } );
+t.ensureIndex( { b:-1, a:1 } );
+t.ensureIndex( { c:1 } );
+
+for( i = 0; i < 1000; ++i ) {
+    // several documents share each key, and c makes the third index multikey
+    t.insert( { a:i % 37, b:i % 11, c:[ i, i + 1, i % 7 ], d:i } );
+}
+assert( !db.getLastError() );
+
+// remove more than one batch, leaving the documents with odd d
+t.remove( { d:{ $mod:[ 2, 0 ] } } );
+assert( !db.getLastError() );
+assert.eq( 500, t.count() );
+
+assert.eq( 500, t.find().hint( { a:1 } ).itcount() );
+assert.eq( 500, t.find().hint( { b:-1, a:1 } ).itcount() );
+assert.eq( 500, t.find( { c:{ $gte:0 } } ).hint( { c:1 } ).itcount() );
+assert.eq( 0, t.find( { d:{ $mod:[ 2, 0 ] } } ).hint( { a:1 } ).itcount() );
+
+var res = t.validate( true );
+assert( res.valid, tojson( res ) );
+assert.eq( 500, res.keysPerIndex[ t.getFullName() + ".$a_1" ], tojson( res ) );
+assert.eq( 500, res.keysPerIndex[ t.getFullName() + ".$b_-1_a_1" ], tojson( res ) );
+
+// and the rest
+t.remove( { a:{ $gte:0 } } );
+assert( !db.getLastError() );
+assert.eq( 0, t.count() );
+assert.eq( 0, t.find( { c:{ $gte:0 } } ).hint( { c:1 } ).itcount() );
+assert( t.validate( true ).valid );
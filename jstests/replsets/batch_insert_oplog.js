@@ -0,0 +1,65 @@
+// The inserts of a batch write command are logged to the oplog in groups; check that every
+// applied insert, and only those, gets its entry, in order, and that they replicate
+
+var rst = new ReplSetTest({ name: "batch_insert_oplog", nodes: 2, oplogSize: 2 });
+rst.startSet();
+rst.initiate();
+
+var primary = rst.getPrimary();
+var coll = primary.getDB("test").batch_insert_oplog;
+var oplog = primary.getDB("local").oplog.rs;
+
+coll.insert({ _id: 100 });
+assert.eq(null, coll.getDB().getLastError());
+
+// spans several groups, with a duplicate key in the middle
+var docs = [];
+for (var i = 0; i < 300; i++) {
+    docs.push({ _id: i, x: i });
+}
+
+var lastTs = oplog.find().sort({ $natural: -1 }).limit(1).next().ts;
+var result = coll.runCommand({ insert: coll.getName(), documents: docs, ordered: false,
+                               writeConcern: { w: 2, wtimeout: 60000 } });
+printjson(result);
+assert.eq(1, result.ok);
+assert.eq(299, result.n);
+assert.eq(1, result.writeErrors.length);
+assert.eq(100, result.writeErrors[0].index);
+
+var entries = oplog.find({ ts: { $gt: lastTs } }).sort({ $natural: 1 }).toArray();
+assert.eq(299, entries.length);
+var expected = 0;
+for (var i = 0; i < entries.length; i++) {
+    if (expected == 100)
+        expected++;
+    assert.eq("i", entries[i].op);
+    assert.eq(coll.getFullName(), entries[i].ns);
+    assert.eq(expected, entries[i].o._id);
+    if (i > 0)
+        assert.gt(bsonWoCompare({ ts: entries[i].ts }, { ts: entries[i - 1].ts }), 0);
+    expected++;
+}
+
+// an ordered batch stops at the duplicate, with what came before it logged
+coll.remove({ _id: { $gte: 200 } });
+assert.eq(null, coll.getDB().getLastError());
+lastTs = oplog.find().sort({ $natural: -1 }).limit(1).next().ts;
+docs = [];
+for (var i = 150; i < 250; i++) {
+    docs.push({ _id: i + 100 });
+}
+docs.push({ _id: 0 });
+docs.push({ _id: 1000 });
+result = coll.runCommand({ insert: coll.getName(), documents: docs,
+                           writeConcern: { w: 2, wtimeout: 60000 } });
+printjson(result);
+assert.eq(100, result.n);
+assert.eq(100, oplog.count({ ts: { $gt: lastTs } }));
+
+rst.awaitReplication();
+var secondary = rst.getSecondary().getDB("test").batch_insert_oplog;
+assert.eq(coll.count(), secondary.count());
+assert.eq(0, secondary.count({ _id: 1000 }));
+
+rst.stopSet();
@@ -0,0 +1,33 @@
+// Initial sync clones several databases at once; check that each arrives whole, indexes
+// included, however many cloning threads there are
+
+[1, 3].forEach(function(threads) {
+    var rs = new ReplSetTest({name: "initial_sync_parallel", nodes: 1});
+    rs.startSet();
+    rs.initiate();
+    var primary = rs.getMaster();
+
+    var nDbs = 6;
+    for (var d = 0; d < nDbs; d++) {
+        var db = primary.getDB("isp" + d);
+        for (var i = 0; i < 2000; i++) {
+            db.c.insert({_id: i, x: i % 100});
+        }
+        db.c.ensureIndex({x: 1});
+        assert.eq(null, db.getLastError());
+    }
+
+    var secondary = rs.add({setParameter: "initialSyncCloneThreads=" + threads});
+    rs.reInitiate();
+    rs.awaitSecondaryNodes();
+    rs.awaitReplication();
+    secondary.setSlaveOk();
+
+    for (var d = 0; d < nDbs; d++) {
+        var db = secondary.getDB("isp" + d);
+        assert.eq(2000, db.c.count(), "db " + d + " with " + threads + " threads");
+        assert(db.system.indexes.findOne({key: {x: 1}}), "db " + d + " index");
+    }
+
+    rs.stopSet();
+});
@@ -88,4 +88,18 @@ assert.eq(testDB.serverStatus().metrics.getLastError.wtime.num, startNum + 2);
 
 printjson(primary.getDB("test").serverStatus().metrics);
 
+// The secondary's prefetcher skips the indexes an update doesn't change keys in, and counts
+// the records it found in memory or asked the OS to read in
+testDB.b.ensureIndex({x: 1});
+for (x = 0; x < 100; x++) { testDB.b.insert({_id: x, x: x}) }
+testDB.getLastError(2);
+var preload = secondary.getDB("test").serverStatus().metrics.repl.preload;
+testDB.b.update({}, {$set: {y: 1}}, false, true);
+testDB.getLastError(2);
+var preloadAfter = secondary.getDB("test").serverStatus().metrics.repl.preload;
+printjson(preloadAfter);
+assert.eq(preload.indexesSkipped + 100, preloadAfter.indexesSkipped, "indexes not skipped");
+assert.eq(preload.docsInMemory + preload.docsHinted + 100,
+          preloadAfter.docsInMemory + preloadAfter.docsHinted, "records not prefetched");
+
 rt.stopSet();
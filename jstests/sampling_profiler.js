@@ -0,0 +1,44 @@
+// samplingProfile folds the stacks sampled while samplingProfilerHz is set, for flamegraph.pl.
+
+var admin = db.getSiblingDB("admin");
+var coll = db.sampling_profiler;
+
+assert.commandFailed(admin.runCommand({setParameter: 1, samplingProfilerHz: -1}));
+assert.commandFailed(admin.runCommand({setParameter: 1, samplingProfilerHz: 100000}));
+
+if (!_isWindows()) {
+    coll.drop();
+    for (var i = 0; i < 100; i++) {
+        coll.insert({_id: i});
+    }
+    assert.eq(null, db.getLastError());
+
+    assert.commandWorked(admin.runCommand({samplingProfile: 1, reset: true}));
+    assert.commandWorked(admin.runCommand({setParameter: 1, samplingProfilerHz: 1000}));
+    try {
+        var queryLine = new RegExp("^query;" + coll.getFullName() + ";.* \\d+$");
+        var res;
+        assert.soon(function() {
+            coll.find({$where: "for (var i = 0; i < 10000; i++) {} return true;"}).itcount();
+            res = admin.runCommand({samplingProfile: 1});
+            assert.commandWorked(res);
+            return res.folded.some(function(line) { return queryLine.test(line); });
+        }, "no sample of the query", 60 * 1000);
+
+        assert.eq(1000, res.hz);
+        assert.gt(res.samples, 0);
+        res.folded.forEach(function(line) {
+            assert(/^[^;]+;[^;]+(;[^;]+)* \d+$/.test(line), line);
+        });
+
+        // a reset leaves only the samples taken after it
+        res = admin.runCommand({samplingProfile: 1, reset: true});
+        assert.commandWorked(admin.runCommand({setParameter: 1, samplingProfilerHz: 0}));
+        res = admin.runCommand({samplingProfile: 1});
+        assert.lt(res.samples, 50, tojson(res));
+    }
+    finally {
+        admin.runCommand({setParameter: 1, samplingProfilerHz: 0});
+    }
+    coll.drop();
+}
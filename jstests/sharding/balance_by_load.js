@@ -0,0 +1,65 @@
+//
+// Tests that with balanceByLoad set, the balancer moves chunks off a shard serving most of the
+// operations even though both shards hold as many chunks
+//
+
+var st = new ShardingTest({ shards: 2, mongos: 1, other: { separateConfig: true } });
+st.stopBalancer();
+
+var mongos = st.s0;
+var config = mongos.getDB("config");
+var coll = mongos.getCollection("foo.bar");
+
+[st.shard0, st.shard1].forEach(function(shard) {
+    assert.commandWorked(shard.adminCommand({ setParameter: 1, trackChunkLoad: true }));
+});
+
+assert.commandWorked(mongos.adminCommand({ enableSharding: coll.getDB() + "" }));
+var busy = st.getServer(coll.getDB() + "");
+var idle = st.getOther(busy);
+assert.commandWorked(mongos.adminCommand({ shardCollection: coll + "", key: { _id: 1 } }));
+
+// four chunks on each shard
+for (var i = 1; i < 8; i++) {
+    assert.commandWorked(mongos.adminCommand({ split: coll + "", middle: { _id: i * 100 } }));
+}
+for (var i = 4; i < 8; i++) {
+    assert.commandWorked(mongos.adminCommand({ moveChunk: coll + "", find: { _id: i * 100 },
+                                               to: idle.shardName }));
+}
+
+for (var i = 0; i < 800; i++) {
+    coll.insert({ _id: i });
+}
+assert.eq(null, coll.getDB().getLastError());
+
+// the shards count reads of their chunks
+coll.find({ _id: { $lt: 100 } }).itcount();
+var load = busy.adminCommand({ getChunkLoad: coll + "" });
+assert.commandWorked(load);
+assert(load.tracking);
+assert.eq(1, load.chunks.length, tojson(load));
+assert.eq(100, load.chunks[0].reads, tojson(load));
+
+// read the chunks of the busy shard, the first ones the most
+for (var round = 0; round < 20; round++) {
+    for (var i = 0; i < 4; i++) {
+        for (var j = 0; j < 4 - i; j++) {
+            coll.find({ _id: { $gte: i * 100, $lt: (i + 1) * 100 } }).itcount();
+        }
+    }
+}
+
+assert.eq(4, config.chunks.count({ ns: coll + "", shard: busy.shardName }));
+
+config.settings.update({ _id: "balancer" }, { $set: { balanceByLoad: true } }, true);
+st.startBalancer();
+
+assert.soon(function() {
+    return config.changelog.count({ what: /moveChunk.commit/, "details.from": busy.shardName }) > 0;
+}, "no chunk moved off the busy shard", 5 * 60 * 1000);
+
+st.stopBalancer();
+assert.eq(800, coll.find().itcount());
+
+st.stop();
@@ -0,0 +1,65 @@
+//
+// Tests benchRunDistributed, driving load on a sharded collection from two agent mongods and
+// merging their results
+//
+
+var st = new ShardingTest({ shards: 2, mongos: 1, other: { separateConfig: true } });
+st.stopBalancer();
+
+var mongos = st.s0;
+var coll = mongos.getCollection("foo.bar");
+assert.commandWorked(mongos.adminCommand({ enableSharding: coll.getDB() + "" }));
+assert.commandWorked(mongos.adminCommand({ shardCollection: coll + "", key: { _id: 1 } }));
+assert.commandWorked(mongos.adminCommand({ split: coll + "", middle: { _id: 50 } }));
+assert.commandWorked(mongos.adminCommand({ moveChunk: coll + "", find: { _id: 50 },
+                                           to: st.getOther(st.getServer(coll.getDB() + ""))
+                                                   .shardName }));
+for (var i = 0; i < 100; i++) {
+    coll.insert({ _id: i, x: 0 });
+}
+assert.eq(null, coll.getDB().getLastError());
+
+var agents = [ MongoRunner.runMongod({}), MongoRunner.runMongod({}) ];
+
+var res = benchRunDistributed({ ops: [ { op: "findOne", ns: coll + "",
+                                         query: { _id: { "#RAND_INT": [ 0, 100 ] } } },
+                                       { op: "update", ns: coll + "",
+                                         query: { _id: { "#RAND_INT": [ 0, 100 ] } },
+                                         update: { $inc: { x: 1 } } } ],
+                                parallel: 2,
+                                seconds: 2,
+                                host: mongos.host,
+                                timeSeries: true },
+                              agents);
+printjson(res);
+
+assert.eq(2, res.agents.length);
+assert.eq(0, res.errCount);
+
+// every agent did some of the work, and handed its histograms over for merging
+var numFindOnes = 0;
+res.agents.forEach(function(agentRes) {
+    assert.gt(agentRes.findOneLatencyPercentilesMicros.max, 0, tojson(agentRes));
+    assert.eq(undefined, agentRes.findOneLatencyHistogramMicros);
+});
+res.timeSeries.forEach(function(s) {
+    if (s.findOne)
+        numFindOnes += s.findOne.ops;
+});
+assert.gt(numFindOnes, 0);
+
+var p = res.findOneLatencyPercentilesMicros;
+assert.lte(p.p50, p.p99, tojson(p));
+assert.lte(p.p99, p.max, tojson(p));
+assert.eq(Math.max(res.agents[0].findOneLatencyPercentilesMicros.max,
+                   res.agents[1].findOneLatencyPercentilesMicros.max),
+          p.max);
+
+// the updates all went through mongos
+var numUpdates = 0;
+coll.find().forEach(function(doc) { numUpdates += doc.x; });
+assert.gt(numUpdates, 0);
+assert.gt(res.update, 0, tojson(res));
+
+agents.forEach(function(agent) { MongoRunner.stopMongod(agent); });
+st.stop();
@@ -0,0 +1,37 @@
+//
+// Tests that migrations report how long the donor spent in the critical section
+//
+
+var st = new ShardingTest({ shards: 2, mongos: 1, other: { separateConfig: true } });
+st.stopBalancer();
+
+var mongos = st.s0;
+var admin = mongos.getDB("admin");
+var config = mongos.getDB("config");
+var coll = mongos.getCollection("foo.bar");
+
+assert.commandWorked(admin.runCommand({ enableSharding: coll.getDB() + "" }));
+var from = st.getServer(coll.getDB() + "");
+var to = st.getOther(from);
+assert.commandWorked(admin.runCommand({ shardCollection: coll + "", key: { _id: 1 } }));
+
+for (var i = 0; i < 1000; i++) {
+    coll.insert({ _id: i });
+}
+assert.eq(null, coll.getDB().getLastError());
+
+assert.commandWorked(from.adminCommand({ setParameter: 1, migrateCatchUpRounds: 5,
+                                         migrateCatchUpMaxPendingMods: 10 }));
+assert.commandWorked(admin.runCommand({ moveChunk: coll + "", find: { _id: 0 },
+                                        to: to.shardName, _waitForDelete: true }));
+
+var commit = config.changelog.findOne({ what: "moveChunk.commit", ns: coll + "" });
+printjson(commit);
+assert.neq(null, commit);
+assert.gte(commit.details.criticalSectionMillis, 0);
+assert.gte(commit.details.catchUpRounds, 0);
+assert.lte(commit.details.catchUpRounds, 5);
+
+assert.eq(1000, coll.find().itcount());
+
+st.stop();
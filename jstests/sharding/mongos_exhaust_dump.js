@@ -0,0 +1,39 @@
+// mongodump through mongos streams collections with exhaust queries; check that every batch
+// arrives, for both a sharded and an unsharded collection
+
+var st = new ShardingTest({ name: "mongos_exhaust_dump", shards: 2, mongos: 1 });
+var mongos = st.s0;
+var db = mongos.getDB("exhaust");
+
+assert.gte(db.adminCommand("ismaster").maxWireVersion, 3);
+
+st.adminCommand({ enablesharding: "exhaust" });
+st.adminCommand({ shardcollection: "exhaust.sharded", key: { _id: 1 } });
+st.adminCommand({ split: "exhaust.sharded", middle: { _id: 5000 } });
+st.adminCommand({ movechunk: "exhaust.sharded", find: { _id: 5000 },
+                  to: st.getOther(st.getServer("exhaust")).name });
+
+// enough data for many batches of each collection
+var pad = new Array(1024).join("x");
+for (var i = 0; i < 10000; i++) {
+    db.sharded.insert({ _id: i, pad: pad });
+    db.unsharded.insert({ _id: i, pad: pad });
+}
+assert.eq(null, db.getLastError());
+
+var dumpdir = MongoRunner.dataDir + "/mongos_exhaust_dump/";
+resetDbpath(dumpdir);
+assert.eq(0, runMongoProgram("mongodump", "--host", mongos.host, "--db", "exhaust",
+                             "--out", dumpdir));
+
+// restore under another name and compare
+assert.eq(0, runMongoProgram("mongorestore", "--host", mongos.host, "--db", "restored",
+                             dumpdir + "exhaust"));
+var restored = mongos.getDB("restored");
+["sharded", "unsharded"].forEach(function(name) {
+    assert.eq(10000, restored[name].count(), name);
+    assert.eq(0, restored[name].find({ pad: { $ne: pad } }).itcount(), name);
+    assert.eq(9999, restored[name].find().sort({ _id: -1 }).limit(1).next()._id, name);
+});
+
+st.stop();
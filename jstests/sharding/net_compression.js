@@ -0,0 +1,33 @@
+// Tests that mongos and the shards compress the messages between them with netCompression on
+
+var st = new ShardingTest({shards: 1, mongos: 1,
+                           other: {shardOptions: {setParameter: "netCompression=true"},
+                                   mongosOptions: {setParameter: "netCompression=true"}}});
+
+var coll = st.s.getDB("test").net_compression;
+var padding = new Array(10000).join("compressible ");
+for (var i = 0; i < 100; i++) {
+    coll.insert({_id: i, padding: padding});
+}
+assert.eq(null, st.s.getDB("test").getLastError());
+
+// big enough replies come back compressed, and intact
+var docs = coll.find().sort({_id: 1}).toArray();
+assert.eq(100, docs.length);
+for (var i = 0; i < docs.length; i++) {
+    assert.eq(i, docs[i]._id);
+    assert.eq(padding, docs[i].padding);
+}
+
+var shardStats = st.shard0.getDB("admin").serverStatus().network.compression;
+printjson(shardStats);
+assert.gt(shardStats.bytesIn, 0);
+assert.gt(shardStats.bytesOut, 0);
+assert.gt(shardStats.uncompressedBytesOut, shardStats.bytesOut);
+
+var mongosStats = st.s.getDB("admin").serverStatus().network.compression;
+printjson(mongosStats);
+assert.gt(mongosStats.bytesIn, 0);
+assert.gt(mongosStats.uncompressedBytesIn, mongosStats.bytesIn);
+
+st.stop();
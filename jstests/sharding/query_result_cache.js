@@ -0,0 +1,69 @@
+// Query results of collections named in queryResultCacheNamespaces are cached in mongos; check
+// that repeated queries hit, and that writes and drops through mongos are seen right away
+
+var st = new ShardingTest({ name: "query_result_cache", shards: 2, mongos: 1 });
+var mongos = st.s0;
+var db = mongos.getDB("cache");
+
+st.adminCommand({ enablesharding: "cache" });
+st.adminCommand({ shardcollection: "cache.ref", key: { _id: 1 } });
+st.adminCommand({ split: "cache.ref", middle: { _id: 50 } });
+st.adminCommand({ movechunk: "cache.ref", find: { _id: 50 },
+                  to: st.getOther(st.getServer("cache")).name });
+
+for (var i = 0; i < 100; i++) {
+    db.ref.insert({ _id: i, x: i % 10 });
+    db.unsharded.insert({ _id: i, x: i % 10 });
+}
+assert.eq(null, db.getLastError());
+
+function stats() {
+    return db.serverStatus().queryResultCache;
+}
+
+// nothing is cached until asked for
+assert.eq(10, db.ref.find({ x: 3 }).itcount());
+assert.eq(10, db.ref.find({ x: 3 }).itcount());
+assert.eq(0, stats().hits);
+
+assert.commandWorked(db.adminCommand({ setParameter: 1,
+                                       queryResultCacheNamespaces: "cache.ref,cache.unsharded",
+                                       queryResultCacheMaxAgeMillis: 60 * 60 * 1000 }));
+assert.eq("cache.ref,cache.unsharded",
+          db.adminCommand({ getParameter: 1, queryResultCacheNamespaces: 1 })
+            .queryResultCacheNamespaces);
+
+["ref", "unsharded"].forEach(function(name) {
+    var before = stats();
+    assert.eq(10, db[name].find({ x: 3 }).itcount(), name);
+    assert.eq(10, db[name].find({ x: 3 }).itcount(), name);
+    assert.eq(10, db[name].find({ x: 3 }).sort({ _id: 1 }).itcount(), name);
+    var after = stats();
+    assert.eq(before.hits + 1, after.hits, name);
+    assert.eq(before.inserts + 2, after.inserts, name);
+
+    // a write through this mongos is seen by the next query
+    db[name].insert({ _id: 1000, x: 3 });
+    assert.eq(null, db.getLastError());
+    assert.eq(11, db[name].find({ x: 3 }).itcount(), name);
+    db[name].update({ _id: 1000 }, { $set: { x: 4 } });
+    assert.eq(null, db.getLastError());
+    assert.eq(10, db[name].find({ x: 3 }).itcount(), name);
+    assert.gt(stats().invalidations, after.invalidations, name);
+
+    // a result that doesn't fit in the first batch leaves a cursor and isn't cached
+    var inserts = stats().inserts;
+    assert.eq(101, db[name].find().batchSize(2).itcount(), name);
+    assert.eq(inserts, stats().inserts, name);
+});
+
+// so is a drop
+assert.eq(10, db.ref.find({ x: 5 }).itcount());
+db.ref.drop();
+assert.eq(0, db.ref.find({ x: 5 }).itcount());
+
+assert.commandWorked(db.adminCommand({ setParameter: 1, queryResultCacheNamespaces: "" }));
+assert.eq(0, stats().entries);
+assert.commandFailed(db.adminCommand({ setParameter: 1, queryResultCacheNamespaces: "nodot" }));
+
+st.stop();
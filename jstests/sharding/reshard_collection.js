@@ -0,0 +1,87 @@
+//
+// Tests changing the shard key of a collection with reshardCollection, with writes going on
+//
+
+var st = new ShardingTest({ shards: 2, mongos: 1, other: { separateConfig: true } });
+st.stopBalancer();
+
+var mongos = st.s0;
+var admin = mongos.getDB("admin");
+var config = mongos.getDB("config");
+var shards = config.shards.find().toArray();
+var db = mongos.getDB("foo");
+var coll = db.bar;
+
+assert.commandWorked(admin.runCommand({ enableSharding: "foo" }));
+printjson(admin.runCommand({ movePrimary: "foo", to: shards[0]._id }));
+assert.commandWorked(admin.runCommand({ shardCollection: coll + "", key: { _id: 1 } }));
+assert.commandWorked(admin.runCommand({ split: coll + "", middle: { _id: 0 } }));
+assert.commandWorked(admin.runCommand({ moveChunk: coll + "", find: { _id: 0 },
+                                        to: shards[1]._id, _waitForDelete: true }));
+
+var numDocs = 2000;
+for (var i = -numDocs / 2; i < numDocs / 2; i++) {
+    coll.insert({ _id: i, k: (i * 7919) % numDocs, x: i });
+}
+assert.eq(null, db.getLastError());
+coll.ensureIndex({ x: 1 });
+assert.eq(null, db.getLastError());
+
+// an orphan is not copied
+var shard0Coll = st.shard0.getCollection(coll + "");
+shard0Coll.insert({ _id: numDocs, k: -5000, x: -1 });
+assert.eq(null, shard0Coll.getDB().getLastError());
+
+// bad requests
+assert.commandFailed(admin.runCommand({ reshardCollection: coll + "", key: { _id: 1 } }));
+assert.commandFailed(admin.runCommand({ reshardCollection: "foo.unsharded", key: { k: 1 } }));
+assert.commandFailed(admin.runCommand({ reshardCollection: coll + "", key: { k: -1 } }));
+
+// writes going on meanwhile
+var join = startParallelShell("db = db.getSiblingDB('foo');" +
+                              "for (var i = 0; i < 500; i++) {" +
+                              "    db.bar.insert({ _id: 'p' + i, k: i, x: i });" +
+                              "    assert.eq(null, db.getLastError());" +
+                              "    db.bar.update({ _id: i }, { $inc: { x: 1000000 } });" +
+                              "    assert.eq(null, db.getLastError());" +
+                              "}", st.s0.port);
+
+var res = admin.runCommand({ reshardCollection: coll + "", key: { k: 1 } });
+printjson(res);
+assert.commandWorked(res);
+join();
+
+var collDoc = config.collections.findOne({ _id: coll + "" });
+assert.eq({ k: 1 }, collDoc.key, tojson(collDoc));
+assert(!collDoc.dropped);
+assert.eq(0, config.chunks.count({ ns: coll + "", "min.k": { $exists: false } }));
+assert.eq(0, config.chunks.count({ ns: /tmp\.reshard/ }));
+assert(config.collections.findOne({ _id: "foo.tmp.reshard.bar" }).dropped);
+
+// everything is there once, and the writes made meanwhile too
+assert.eq(numDocs + 500, coll.find().itcount());
+assert.eq(0, coll.find({ k: -5000 }).itcount());
+assert.eq(500, coll.find({ _id: /^p/ }).itcount());
+assert.eq(500, coll.find({ x: { $gte: 1000000 } }).itcount());
+assert.eq(2, coll.getIndexes().filter(function(idx) {
+    return friendlyEqual(idx.key, { k: 1 }) || friendlyEqual(idx.key, { x: 1 });
+}).length);
+
+// the collection is routed by the new key from now on
+coll.insert({ _id: "after", k: 123456, x: 0 });
+assert.eq(null, db.getLastError());
+coll.update({ k: 123456 }, { $set: { x: 1 } });
+assert.eq(null, db.getLastError());
+assert.eq(1, coll.findOne({ k: 123456 }).x);
+
+st.startBalancer();
+assert.soon(function() {
+    var counts = shards.map(function(shard) {
+        return config.chunks.count({ ns: coll + "", shard: shard._id });
+    });
+    return counts[0] > 0 && counts[1] > 0;
+}, "balancer did not spread the resharded collection", 5 * 60 * 1000);
+st.stopBalancer();
+assert.eq(numDocs + 501, coll.find().itcount());
+
+st.stop();
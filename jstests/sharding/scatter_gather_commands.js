@@ -0,0 +1,38 @@
+// collStats, dataSize and distinct fan out to every shard at once; check their merged results and
+// that mongos reports how long each shard took
+
+var st = new ShardingTest({ name: "scatter_gather_commands", shards: 2, mongos: 1 });
+var mongos = st.s0;
+var db = mongos.getDB("scatter");
+
+st.adminCommand({ enablesharding: "scatter" });
+st.adminCommand({ shardcollection: "scatter.coll", key: { _id: 1 } });
+st.adminCommand({ split: "scatter.coll", middle: { _id: 50 } });
+st.adminCommand({ movechunk: "scatter.coll", find: { _id: 50 },
+                  to: st.getOther(st.getServer("scatter")).name });
+
+for (var i = 0; i < 100; i++) {
+    db.coll.insert({ _id: i, x: i % 7 });
+}
+assert.eq(null, db.getLastError());
+
+var stats = db.coll.stats();
+assert.eq(100, stats.count);
+assert.eq(2, Object.keys(stats.shards).length);
+
+var size = db.runCommand({ dataSize: "scatter.coll", keyPattern: { _id: 1 },
+                           min: { _id: MinKey }, max: { _id: MaxKey } });
+assert.commandWorked(size);
+assert.eq(100, size.numObjects);
+
+assert.eq([0, 1, 2, 3, 4, 5, 6], db.coll.distinct("x").sort());
+assert.eq([0, 6], db.coll.distinct("x", { _id: { $gte: 90, $lt: 92 } }).sort());
+
+var latency = mongos.getDB("admin").serverStatus().shardLatency;
+printjson(latency);
+assert.eq(2, Object.keys(latency).length);
+for (var host in latency) {
+    assert.gt(latency[host].num, 0, host);
+}
+
+st.stop();
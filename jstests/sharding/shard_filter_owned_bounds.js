@@ -0,0 +1,47 @@
+//
+// Tests that a shard filters out orphaned documents whether or not an index scan's bounds lie
+// wholly inside the chunks the shard owns
+//
+
+var st = new ShardingTest({ shards: 2, mongos: 1, other: { separateConfig: true } });
+st.stopBalancer();
+
+var mongos = st.s0;
+var admin = mongos.getDB("admin");
+var shards = mongos.getCollection("config.shards").find().toArray();
+var coll = mongos.getCollection("foo.bar");
+
+assert.commandWorked(admin.runCommand({ enableSharding: coll.getDB() + "" }));
+printjson(admin.runCommand({ movePrimary: coll.getDB() + "", to: shards[0]._id }));
+assert.commandWorked(admin.runCommand({ shardCollection: coll + "", key: { _id: 1 } }));
+assert.commandWorked(admin.runCommand({ split: coll + "", middle: { _id: 0 } }));
+assert.commandWorked(admin.runCommand({ moveChunk: coll + "", find: { _id: 0 },
+                                        to: shards[1]._id, _waitForDelete: true }));
+
+for (var i = -50; i < 50; i++) coll.insert({ _id: i, x: i });
+assert.eq(null, coll.getDB().getLastError());
+
+// orphans on shard0, in the chunk shard1 owns
+var shard0Coll = st.shard0.getCollection(coll + "");
+for (var i = 100; i < 110; i++) shard0Coll.insert({ _id: i, x: i });
+assert.eq(null, shard0Coll.getDB().getLastError());
+assert.eq(60, shard0Coll.count());
+
+// bounds owned by shard0
+assert.eq(50, coll.find({ _id: { $lt: 0 } }).itcount());
+assert.eq(10, coll.find({ _id: { $gte: -20, $lt: -10 } }).sort({ _id: -1 }).itcount());
+assert.eq(2, coll.find({ _id: { $in: [-5, -3] } }).itcount());
+
+// bounds reaching into the orphaned range
+assert.eq(20, coll.find({ _id: { $gte: -10, $lt: 10 } }).itcount());
+assert.eq(50, coll.find({ _id: { $gte: 0 } }).itcount());
+assert.eq(0, coll.find({ _id: { $gte: 100 } }).itcount());
+assert.eq(1, coll.find({ _id: { $in: [-5, 105] } }).itcount());
+
+// no index on the shard key
+assert.eq(100, coll.find({ x: { $gte: -100 } }).itcount());
+coll.ensureIndex({ x: 1 });
+assert.eq(null, coll.getDB().getLastError());
+assert.eq(50, coll.find({ x: { $gte: 0 } }).itcount());
+
+st.stop();
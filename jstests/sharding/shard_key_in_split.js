@@ -0,0 +1,40 @@
+// mongos sends each shard only the shard key $in values that can match there; check queries over
+// values on several shards still return everything, with other predicates, sorts and wrappers
+
+var st = new ShardingTest({ name: "shard_key_in_split", shards: 3, mongos: 1 });
+var mongos = st.s0;
+var coll = mongos.getCollection("test.coll");
+
+st.adminCommand({ enablesharding: "test" });
+st.adminCommand({ shardcollection: "test.coll", key: { x: 1 } });
+st.adminCommand({ split: "test.coll", middle: { x: 10 } });
+st.adminCommand({ split: "test.coll", middle: { x: 20 } });
+var primary = st.getServer("test").name;
+var others = st._shardNames.filter(function(name) { return name != primary; });
+st.adminCommand({ movechunk: "test.coll", find: { x: 10 }, to: others[0] });
+st.adminCommand({ movechunk: "test.coll", find: { x: 20 }, to: others[1] });
+
+for (var i = 0; i < 30; i++) {
+    coll.insert({ x: i, y: i % 2 });
+}
+assert.eq(null, coll.getDB().getLastError());
+
+var values = [1, 5, 12, 13, 25, 29, 100];
+assert.eq(6, coll.find({ x: { $in: values } }).itcount());
+assert.eq([1, 5, 12, 13, 25, 29],
+          coll.find({ x: { $in: values } }).sort({ x: 1 }).toArray().map(function(d) {
+              return d.x;
+          }));
+assert.eq(3, coll.find({ x: { $in: values }, y: 1 }).itcount());
+assert.eq(29, coll.find({ $query: { x: { $in: values } }, $orderby: { x: -1 } }).next().x);
+assert.eq(6, coll.count({ x: { $in: values } }));
+
+// values of mixed numeric types still find their chunks
+assert.eq(3, coll.find({ x: { $in: [NumberLong(2), 12.0, NumberInt(22)] } }).itcount());
+
+// a regex can't be placed, so that query goes out whole
+coll.insert({ x: "abc" });
+assert.eq(null, coll.getDB().getLastError());
+assert.eq(2, coll.find({ x: { $in: [/^a/, 3] } }).itcount());
+
+st.stop();
@@ -0,0 +1,45 @@
+// A sharded cursor whose batch fills up stays open without mongos fetching ahead from the shards;
+// check sorted queries with limits and batch sizes still return exactly the right documents
+
+var st = new ShardingTest({ name: "sorted_limit_full_batch", shards: 2, mongos: 1 });
+var mongos = st.s0;
+var coll = mongos.getCollection("test.coll");
+
+st.adminCommand({ enablesharding: "test" });
+st.adminCommand({ shardcollection: "test.coll", key: { _id: 1 } });
+st.adminCommand({ split: "test.coll", middle: { _id: 50 } });
+st.adminCommand({ movechunk: "test.coll", find: { _id: 50 },
+                  to: st.getOther(st.getServer("test")).name });
+
+for (var i = 0; i < 100; i++) {
+    coll.insert({ _id: i, x: 99 - i });
+}
+assert.eq(null, coll.getDB().getLastError());
+
+var docs = coll.find().sort({ x: 1 }).limit(10).toArray();
+assert.eq(10, docs.length);
+for (var i = 0; i < 10; i++) {
+    assert.eq(i, docs[i].x);
+}
+
+// batches which end exactly at the end of the results
+[10, 20, 25, 50, 100].forEach(function(batchSize) {
+    var cursor = coll.find().sort({ x: -1 }).batchSize(batchSize);
+    var n = 0;
+    var last = 100;
+    while (cursor.hasNext()) {
+        var doc = cursor.next();
+        assert.lt(doc.x, last, "batch size " + batchSize);
+        last = doc.x;
+        n++;
+    }
+    assert.eq(100, n, "batch size " + batchSize);
+});
+
+// skip and limit together
+docs = coll.find().sort({ x: 1 }).skip(45).limit(10).toArray();
+assert.eq(10, docs.length);
+assert.eq(45, docs[0].x);
+assert.eq(54, docs[9].x);
+
+st.stop();
@@ -0,0 +1,53 @@
+// A background index build that bulk loads from sorted keys has to end up with the writes made
+// while it was scanning: inserts, in place updates, moves and removes.
+
+var coll = db.index_bg_bulkload;
+coll.drop();
+db.index_bg_bulkload_results.drop();
+
+var N = 100000;
+for (var i = 0; i < N; i++) {
+    coll.insert({_id: i, a: i % 1000, b: (i % 10 == 0) ? [i, i + 1] : i});
+}
+db.getLastError();
+
+var join = startParallelShell("db.index_bg_bulkload.ensureIndex({a: 1, b: 1}, {background: true});" +
+                              "db.index_bg_bulkload_results.insert(db.runCommand({getlasterror: 1}));");
+
+print("Writing while the index is built");
+Random.setRandomSeed();
+for (var i = 0; i < 20000; i++) {
+    var id = Random.randInt(N);
+    var r = Random.rand();
+    if (r < .25) {
+        coll.insert({_id: N + i, a: Random.randInt(1000), b: [i, -i]});
+    }
+    else if (r < .5) {
+        coll.update({_id: id}, {$set: {a: Random.randInt(1000)}});
+    }
+    else if (r < .75) {
+        // grows the document so that it moves
+        coll.update({_id: id}, {$set: {pad: new Array(256).join("x")}});
+    }
+    else {
+        coll.remove({_id: id});
+    }
+}
+db.getLastError();
+
+join();
+
+var result = db.index_bg_bulkload_results.findOne();
+printjson(result);
+assert.eq(null, result.err);
+
+assert.eq(2, coll.getIndexes().length);
+assert(coll.validate(true).valid);
+
+// the index and the collection agree, overall and by value
+var all = {a: {$gte: 0}};
+assert.eq(coll.find(all).hint({$natural: 1}).itcount(), coll.find(all).hint({a: 1, b: 1}).itcount());
+for (var v = 0; v < 1000; v += 97) {
+    assert.eq(coll.find({a: v}).hint({$natural: 1}).itcount(),
+              coll.find({a: v}).hint({a: 1, b: 1}).itcount(), "a: " + v);
+}
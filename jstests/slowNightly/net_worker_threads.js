@@ -0,0 +1,44 @@
+// Tests serving connections from a pool of network worker threads (netWorkerThreads)
+
+var mongo = MongoRunner.runMongod({setParameter: "netWorkerThreads=4"});
+var db = mongo.getDB("test");
+var coll = db.net_worker_threads;
+coll.drop();
+
+var numConns = 50;
+var conns = [];
+for (var i = 0; i < numConns; i++) {
+    conns.push(new Mongo(db.getMongo().host));
+}
+
+// each connection keeps its own getLastError state while sharing the workers
+for (var round = 0; round < 5; round++) {
+    for (var i = 0; i < numConns; i++) {
+        var c = conns[i].getDB("test").net_worker_threads;
+        c.insert({conn: i, round: round, pad: new Array(1000 * (i % 5)).join("x")});
+        assert.eq(null, conns[i].getDB("test").getLastError());
+    }
+}
+
+for (var i = 0; i < numConns; i++) {
+    assert.eq(5, conns[i].getDB("test").net_worker_threads.find({conn: i}).itcount());
+}
+assert.eq(numConns * 5, coll.count());
+
+// a message bigger than the first chunk the poll thread waits for
+var big = new Array(4 * 1024 * 1024).join("y");
+conns[0].getDB("test").net_worker_threads.insert({big: big});
+assert.eq(null, conns[0].getDB("test").getLastError());
+assert.eq(big.length, coll.findOne({big: {$exists: true}}).big.length);
+
+// closed connections give back their tickets
+var before = db.serverStatus().connections.current;
+for (var i = 0; i < numConns; i++) {
+    conns[i] = null;
+}
+gc();
+assert.soon(function() {
+    return db.serverStatus().connections.current < before;
+}, "connections weren't closed", 60000);
+
+MongoRunner.stopMongod(mongo);
@@ -0,0 +1,57 @@
+/**
+ * The TTL monitor deletes expired documents in batches of ttlDeleteBatchSize, oldest first,
+ * paced to ttlMaxDeletesPerSecond, and reports on its last pass.  Run passes every second, check
+ * that a descending ttl index expires only the dates past it and that the rate limit holds.
+ */
+
+var admin = db.getSiblingDB("admin");
+var old = admin.runCommand({ getParameter: 1, ttlMonitorSleepSecs: 1, ttlDeleteBatchSize: 1,
+                             ttlMaxDeletesPerSecond: 1 });
+assert.commandWorked(old);
+
+var t = db.ttl_batched;
+t.drop();
+
+var now = (new Date()).getTime();
+
+// 300 documents an hour or more past expiry, 10 not yet expired
+for (var i = 0; i < 300; i++) {
+    t.insert({ x: new Date(now - 2 * 3600 * 1000 - i * 1000) });
+}
+for (var i = 0; i < 10; i++) {
+    t.insert({ x: new Date(now) });
+}
+t.insert({ x: true });  // non-date values don't expire
+t.insert({ x: [ 1, 2 ] });
+assert.eq(null, db.getLastError());
+
+assert.commandWorked(admin.runCommand({ setParameter: 1, ttlMonitorSleepSecs: 1,
+                                        ttlDeleteBatchSize: 7,
+                                        ttlMaxDeletesPerSecond: 100 }));
+
+var start = new Date();
+t.ensureIndex({ x: -1 }, { expireAfterSeconds: 3600 });
+
+assert.soon(function() {
+    return t.count() == 12;
+}, "TTL index on x didn't delete", 60 * 1000);
+var elapsed = new Date() - start;
+
+// at 100 a second, 300 deletes take at least about 3 seconds
+assert.lte(2500, elapsed, "TTL deletes weren't paced");
+assert.eq(10, t.count({ x: { $type: 9 } }));
+assert.eq(1, t.count({ x: true }));
+
+var ttl = db.serverStatus().metrics.ttl;
+printjson(ttl);
+assert.lte(300, ttl.deletedDocuments);
+assert.lte(1, ttl.passTime.num);
+assert.eq("number", typeof ttl.lastPass.deletedDocuments, tojson(ttl));
+assert.eq("number", typeof ttl.lastPass.millis, tojson(ttl));
+assert.eq("number", typeof ttl.lastPass.maxLagMillis, tojson(ttl));
+
+assert.commandWorked(admin.runCommand({ setParameter: 1,
+                                        ttlMonitorSleepSecs: old.ttlMonitorSleepSecs,
+                                        ttlDeleteBatchSize: old.ttlDeleteBatchSize,
+                                        ttlMaxDeletesPerSecond: old.ttlMaxDeletesPerSecond }));
+t.drop();
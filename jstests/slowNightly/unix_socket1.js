@@ -11,6 +11,9 @@ if ( ! _isWindows() ) {
     sockdb = sock.getDB(db.getName())
     assert( sockdb.runCommand('ping').ok );
 
+    // connections over the socket are counted separately
+    assert.gte( sockdb.serverStatus().connections.totalCreatedUnixSocket, 1 );
+
     // test unix socket path
     var ports = allocatePorts(1);
     var path = MongoRunner.dataDir + "/sockpath";
@@ -21,6 +24,7 @@ if ( ! _isWindows() ) {
     var sock2 = new Mongo(path+"/mongodb-"+ports[0]+".sock");
     sockdb2 = sock2.getDB(db.getName())
     assert( sockdb2.runCommand('ping').ok );
+    assert.eq( 1, sockdb2.serverStatus().connections.totalCreatedUnixSocket );
 } else {
     print("Not testing unix sockets on Windows");
 }
@@ -0,0 +1,39 @@
+// A sort on an index suffix under $in on its prefix, or under an $or of index-ordered branches, is
+// answered by merging per-point index scans rather than by a blocking sort.
+
+var t = db.sort_merge_in;
+t.drop();
+
+for (var i = 0; i < 100; i++) {
+    t.insert({a: i % 5, b: 100 - i, c: i % 7, d: i});
+}
+t.ensureIndex({a: 1, b: 1});
+t.ensureIndex({c: 1, b: -1});
+db.getLastError();
+
+function checkSorted(cursor, field, dir) {
+    var docs = cursor.toArray();
+    for (var i = 1; i < docs.length; i++) {
+        assert.lte(0, dir * (docs[i][field] - docs[i - 1][field]), tojson(docs));
+    }
+    return docs.length;
+}
+
+function checkNoBlockingSort(query, sort, hint) {
+    var explain = t.find(query).sort(sort).hint(hint).explain();
+    assert(!explain.scanAndOrder, tojson(explain));
+}
+
+assert.eq(60, checkSorted(t.find({a: {$in: [4, 0, 2]}}).sort({b: 1}), "b", 1));
+assert.eq(60, checkSorted(t.find({a: {$in: [4, 0, 2]}}).sort({b: -1}), "b", -1));
+checkNoBlockingSort({a: {$in: [4, 0, 2]}}, {b: 1}, {a: 1, b: 1});
+
+// With a limit, the merge stops early.
+var top = t.find({a: {$in: [1, 3]}}).sort({b: 1}).limit(3).toArray();
+assert.eq([2, 4, 7], top.map(function(doc) { return doc.b; }));
+
+// Each $or branch provides the sort, one of them only in reverse.
+var orQuery = {$or: [{a: 1}, {c: {$in: [2, 5]}}]};
+var n = t.find(orQuery).itcount();
+assert.eq(n, checkSorted(t.find(orQuery).sort({b: 1}), "b", 1));
+assert.eq(n, checkSorted(t.find(orQuery).sort({b: -1}), "b", -1));
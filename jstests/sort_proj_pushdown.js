@@ -0,0 +1,51 @@
+// A blocking sort under a simple projection only buffers the fields it needs; the results must
+// be the same as projecting the whole document.
+
+var t = db.sort_proj_pushdown;
+t.drop();
+
+var big = new Array(4096).join("x");
+for (var i = 0; i < 200; i++) {
+    t.insert({_id: i, a: i % 13, b: {c: 200 - i}, d: i, pad: big});
+}
+t.ensureIndex({d: 1});
+db.getLastError();
+
+function check(query, proj, sort) {
+    var expected = t.find(query).sort(sort).toArray().map(function(doc) {
+        var out = {};
+        for (var f in proj) {
+            if (proj[f] && f in doc) {
+                out[f] = doc[f];
+            }
+        }
+        if (!("_id" in proj) || proj._id) {
+            out._id = doc._id;
+        }
+        return out;
+    });
+    var actual = t.find(query, proj).sort(sort).toArray();
+    assert.eq(expected.length, actual.length, tojson([query, proj, sort]));
+    for (var i = 0; i < actual.length; i++) {
+        assert.eq(sortedKeys(expected[i]), sortedKeys(actual[i]), tojson([query, proj, sort]));
+    }
+}
+
+function sortedKeys(doc) {
+    var out = [];
+    for (var f in doc) {
+        out.push(f + ":" + tojson(doc[f]));
+    }
+    return out.sort();
+}
+
+// The sort fields aren't all in the projection.
+check({d: {$gt: 20}}, {a: 1}, {a: 1, d: -1});
+check({d: {$gt: 20}}, {a: 1, _id: 0}, {"b.c": 1});
+check({d: {$lt: 150}, pad: {$exists: true}}, {b: 1}, {a: -1, _id: 1});
+
+// With a limit the sort keeps only the top results.
+assert.eq([{_id: 0}, {_id: 13}],
+          t.find({d: {$gte: 0}}, {_id: 1}).sort({a: 1, d: 1}).limit(2).toArray());
+assert.eq([{_id: 195}, {_id: 182}],
+          t.find({d: {$gte: 0}}, {_id: 1}).sort({a: 1, d: -1}).limit(2).toArray());
@@ -0,0 +1,59 @@
+// splitVector with 'sampled' estimates split points from the upper levels of the index; check
+// that they are ordered, within the range and close in number to the ones a full scan finds
+
+var f = db.jstests_splitvector_sampled;
+f.drop();
+f.ensureIndex({ x: 1 });
+
+var numDocs = 200000;
+var pad = new Array(100).join("x");
+for (var i = 0; i < numDocs; i++) {
+    f.insert({ x: i, pad: pad });
+}
+assert.eq(null, db.getLastError());
+
+var ns = f.getFullName();
+var checkSplitKeys = function(keys, min, max, msg) {
+    for (var i = 0; i < keys.length; i++) {
+        assert.eq(["x"], Object.keySet(keys[i]), msg + " " + i);
+        assert.gt(keys[i].x, min, msg + " " + i);
+        assert.lt(keys[i].x, max, msg + " " + i);
+        if (i > 0)
+            assert.gt(keys[i].x, keys[i - 1].x, msg + " " + i);
+    }
+};
+
+var scanned = db.runCommand({ splitVector: ns, keyPattern: { x: 1 }, maxChunkSize: 1 });
+var sampled = db.runCommand({ splitVector: ns, keyPattern: { x: 1 }, maxChunkSize: 1,
+                              sampled: true });
+assert.commandWorked(scanned);
+assert.commandWorked(sampled);
+printjson({ scanned: scanned.splitKeys.length, sampled: sampled.splitKeys.length });
+checkSplitKeys(sampled.splitKeys, -1, numDocs, "whole");
+assert.gt(sampled.splitKeys.length, scanned.splitKeys.length / 2);
+assert.lt(sampled.splitKeys.length, scanned.splitKeys.length * 2);
+
+// a sub-range, with a cap on the number of split points
+var bounded = db.runCommand({ splitVector: ns, keyPattern: { x: 1 }, maxChunkSize: 1,
+                              min: { x: 50000 }, max: { x: 150000 }, maxSplitPoints: 3,
+                              sampled: true });
+assert.commandWorked(bounded);
+assert.eq(3, bounded.splitKeys.length);
+checkSplitKeys(bounded.splitKeys, 50000, 150000, "bounded");
+
+// forcing picks one key near the middle
+var forced = db.runCommand({ splitVector: ns, keyPattern: { x: 1 }, force: true,
+                             min: { x: 0 }, max: { x: 100000 }, sampled: true });
+assert.commandWorked(forced);
+assert.eq(1, forced.splitKeys.length);
+assert.gt(forced.splitKeys[0].x, 25000);
+assert.lt(forced.splitKeys[0].x, 75000);
+
+// a range too small to sample still finds nothing to split
+f.drop();
+f.ensureIndex({ x: 1 });
+f.insert({ x: 1 });
+var small = db.runCommand({ splitVector: ns, keyPattern: { x: 1 }, maxChunkSize: 1,
+                            sampled: true });
+assert.commandWorked(small);
+assert.eq(0, small.splitKeys.length);
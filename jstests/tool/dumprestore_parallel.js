@@ -0,0 +1,40 @@
+// Dumps several collections at once, reading the large one in _id ranges, into snappy
+// compressed files, and checks that mongorestore brings all of it back
+
+t = new ToolTest( "dumprestore_parallel" );
+
+t.startDB( "foo" );
+db = t.db;
+
+var pad = new Array( 1024 ).join( "x" );
+for ( var i = 0; i < 5000; i++ ) {
+    db.big.insert( { _id : i , pad : pad } );
+}
+for ( var c = 0; c < 5; c++ ) {
+    for ( var i = 0; i < 100; i++ ) {
+        db.getCollection( "small" + c ).insert( { _id : i , c : c } );
+    }
+}
+db.small0.ensureIndex( { c : 1 } );
+assert.eq( null , db.getLastError() );
+
+t.runTool( "dump" , "--out" , t.ext , "--numParallelCollections" , "3" ,
+           "--numRangePartitions" , "4" , "--rangePartitionMinMB" , "1" , "--compress" );
+
+var files = listFiles( t.ext + "/" + db.getName() ).map( function( f ) { return f.baseName; } );
+assert.contains( "big.bson.snappy" , files , tojson( files ) );
+assert.contains( "small0.metadata.json" , files , tojson( files ) );
+assert.contains( "system.indexes.bson" , files , tojson( files ) );
+
+db.dropDatabase();
+t.runTool( "restore" , "--dir" , t.ext );
+
+assert.eq( 5000 , db.big.count() , "big" );
+assert.eq( 4999 , db.big.find().sort( { _id : -1 } ).limit( 1 ).next()._id );
+assert.eq( pad , db.big.findOne( { _id : 2500 } ).pad );
+for ( var c = 0; c < 5; c++ ) {
+    assert.eq( 100 , db.getCollection( "small" + c ).count( { c : c } ) , "small" + c );
+}
+assert.eq( 2 , db.small0.getIndexes().length , "indexes" );
+
+t.stop();
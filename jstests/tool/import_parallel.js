@@ -0,0 +1,38 @@
+// Imports with several parsing threads and insert connections, and checks that every row
+// arrives once and that duplicate keys are not reported as a failure
+
+t = new ToolTest( "import_parallel" );
+
+c = t.startDB( "foo" );
+
+for ( var i = 0; i < 20000; i++ ) {
+    c.insert( { _id : i , x : i % 10 , s : "row " + i } );
+}
+assert.eq( null , c.getDB().getLastError() );
+
+t.runTool( "export" , "--out" , t.extFile , "-d" , t.baseName , "-c" , "foo" );
+c.drop();
+
+var workers = [ "--numDecodingWorkers" , "4" , "--numInsertionWorkers" , "3" ];
+var ret = t.runTool.apply( t , [ "import" , "--file" , t.extFile , "-d" , t.baseName ,
+                                 "-c" , "foo" ].concat( workers ) );
+assert.eq( 0 , ret , "import" );
+assert.eq( 20000 , c.count() , "after import" );
+assert.eq( 2000 , c.count( { x : 3 } ) , "after import" );
+assert.eq( "row 12345" , c.findOne( { _id : 12345 } ).s );
+
+// every document is there already
+ret = t.runTool.apply( t , [ "import" , "--file" , t.extFile , "-d" , t.baseName ,
+                             "-c" , "foo" ].concat( workers ) );
+assert.eq( 0 , ret , "import of duplicates" );
+assert.eq( 20000 , c.count() , "after importing duplicates" );
+
+// rows spanning lines and a header line
+c.drop();
+t.runTool.apply( t , [ "import" , "--file" , "jstests/tool/data/csvimport1.csv" ,
+                       "-d" , t.baseName , "-c" , "foo" , "--type" , "csv" ,
+                       "--headerline" ].concat( workers ) );
+assert.eq( 5 , c.count() , "csv" );
+assert.eq( 1 , c.count( { a : 3 , c : "" } ) , "csv" );
+
+t.stop();
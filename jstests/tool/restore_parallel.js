@@ -0,0 +1,36 @@
+// Restores several collections at once, each over more than one insert connection, and
+// checks that every document and index comes back
+
+t = new ToolTest( "restore_parallel" );
+
+t.startDB( "foo" );
+db = t.db;
+
+for ( var c = 0; c < 4; c++ ) {
+    var coll = db.getCollection( "coll" + c );
+    for ( var i = 0; i < 3000; i++ ) {
+        coll.insert( { _id : i , a : i % 7 , b : "b" + i , c : c } );
+    }
+    coll.ensureIndex( { a : 1 } );
+    coll.ensureIndex( { b : 1 } , { unique : true } );
+    coll.ensureIndex( { a : 1 , b : -1 } );
+}
+assert.eq( null , db.getLastError() );
+
+t.runTool( "dump" , "--out" , t.ext );
+db.dropDatabase();
+
+t.runTool( "restore" , "--dir" , t.ext , "--numParallelCollections" , "3" ,
+           "--numInsertionWorkersPerCollection" , "2" );
+
+for ( var c = 0; c < 4; c++ ) {
+    var coll = db.getCollection( "coll" + c );
+    assert.eq( 3000 , coll.count() , coll.getName() );
+    assert.eq( 3000 , coll.count( { c : c } ) , coll.getName() );
+    assert.eq( 4 , coll.getIndexes().length , coll.getName() );
+    assert.eq( 1 , coll.find( { b : "b1234" } ).hint( { b : 1 } ).itcount() , coll.getName() );
+    assert.eq( 429 , coll.find( { a : 3 } ).hint( { a : 1 , b : -1 } ).itcount() ,
+               coll.getName() );
+}
+
+t.stop();
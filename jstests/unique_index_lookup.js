@@ -0,0 +1,42 @@
+// An equality on the field of a unique index is answered by a direct btree lookup.  It must return
+// the same documents as the planned query.
+
+var t = db.unique_index_lookup;
+t.drop();
+
+t.ensureIndex({email: 1}, {unique: true});
+t.ensureIndex({"a.b": 1}, {unique: true});
+for (var i = 0; i < 100; i++) {
+    t.insert({_id: i, email: "user" + i + "@example.com", a: {b: i}, n: i});
+}
+t.insert({_id: 100, email: 5, a: [{b: 100}, {b: 101}]});
+t.insert({_id: 101, email: {x: 1}});
+assert.eq(null, db.getLastError());
+
+function setLookup(on) {
+    assert.commandWorked(db.adminCommand({setParameter: 1, enableUniqueIndexLookup: on}));
+}
+
+var queries = [{email: "user7@example.com"},
+               {email: "nobody@example.com"},
+               {email: 5},
+               {email: 5.0},
+               {email: {x: 1}},
+               {"a.b": 42},
+               {"a.b": 101}];
+
+setLookup(false);
+var expected = queries.map(function(q) { return t.find(q, {_id: 1, n: 1}).toArray(); });
+
+setLookup(true);
+try {
+    for (var i = 0; i < queries.length; i++) {
+        assert.eq(expected[i], t.find(queries[i], {_id: 1, n: 1}).toArray(), tojson(queries[i]));
+        assert.eq(expected[i].length, t.find(queries[i]).count(), tojson(queries[i]));
+    }
+    assert.eq(1, t.find({email: "user7@example.com"}).itcount());
+    assert.eq(7, t.findOne({email: "user7@example.com"}).n);
+}
+finally {
+    setLookup(true);
+}
@@ -0,0 +1,50 @@
+// An update that has to rewrite a document only regenerates the keys of the indexes over the
+// fields it changed.
+
+var t = db.update_index_keygen_skip;
+t.drop();
+
+t.ensureIndex({a: 1});
+t.ensureIndex({b: 1, c: 1});
+t.ensureIndex({"d.e": 1});
+
+for (var i = 0; i < 10; i++) {
+    t.insert({_id: i, a: i, b: i, c: i, d: {e: i}, x: 0});
+}
+db.getLastError();
+
+function skipped() {
+    return db.serverStatus().metrics.index.keyGenerationsSkipped;
+}
+
+// changes a, so not in place: _id, {b: 1, c: 1} and {"d.e": 1} keep their keys
+var before = skipped();
+t.update({_id: 1}, {$set: {a: 100}});
+assert.isnull(db.getLastError());
+assert.eq(3, skipped() - before);
+
+// changes d.e, which {"d.e": 1} has to see
+before = skipped();
+t.update({_id: 2}, {$set: {d: {e: 200}}, $inc: {x: 1}});
+assert.isnull(db.getLastError());
+assert.eq(3, skipped() - before);
+
+// a replacement touches everything
+before = skipped();
+t.update({_id: 3}, {a: 3, b: 300, c: 3, d: {e: 3}});
+assert.isnull(db.getLastError());
+assert.eq(0, skipped() - before);
+
+// grows and moves the document, which reindexes it under every index
+before = skipped();
+t.update({_id: 4}, {$set: {c: 400, pad: new Array(1024).join("x")}});
+assert.isnull(db.getLastError());
+assert.eq(0, skipped() - before);
+
+assert.eq(1, t.find({a: 100}).hint({a: 1}).itcount());
+assert.eq(1, t.find({"d.e": 200}).hint({"d.e": 1}).itcount());
+assert.eq(0, t.find({"d.e": 2}).hint({"d.e": 1}).itcount());
+assert.eq(1, t.find({b: 300}).hint({b: 1, c: 1}).itcount());
+assert.eq(1, t.find({b: 4, c: 400}).hint({b: 1, c: 1}).itcount());
+assert.eq(1, t.find({_id: 4, pad: {$exists: true}}).itcount());
+assert(t.validate(true).valid);
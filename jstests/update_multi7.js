@@ -0,0 +1,34 @@
+// a multi-update over the whole collection, or over _id alone, walks the _id index; documents
+// which grow and move while it runs are still updated exactly once
+
+t = db.update_multi7;
+t.drop();
+
+var n = 2000;
+for ( var i = 0; i < n; i++ ) {
+    // out of _id order on disk
+    t.insert( { _id : ( i * 7919 ) % n , x : 0 } );
+}
+assert.eq( null , db.getLastError() );
+
+// every document grows enough to move
+var pad = new Array( 1024 ).join( "x" );
+t.update( {} , { $inc : { x : 1 } , $set : { pad : pad } } , false , true );
+var res = db.getLastErrorObj();
+assert.eq( n , res.n , tojson( res ) );
+assert.eq( n , t.count( { x : 1 } ) , "all once" );
+
+// a range of _id
+t.update( { _id : { $gte : 500 , $lt : 1500 } } , { $inc : { x : 1 } , $set : { pad : pad + pad } } ,
+          false , true );
+res = db.getLastErrorObj();
+assert.eq( 1000 , res.n , tojson( res ) );
+assert.eq( 1000 , t.count( { x : 2 } ) , "range once" );
+assert.eq( 1000 , t.count( { x : 1 } ) , "rest untouched" );
+
+// other queries keep their index, and still update each document once
+t.ensureIndex( { x : 1 } );
+t.update( { x : 2 } , { $inc : { x : 1 } , $set : { pad : pad + pad + pad } } , false , true );
+res = db.getLastErrorObj();
+assert.eq( 1000 , res.n , tojson( res ) );
+assert.eq( 1000 , t.count( { x : 3 } ) );
@@ -0,0 +1,38 @@
+// The parallel record scan of validate should add up to the same totals as the serial one.
+
+t = db.validate_parallel;
+t.drop();
+
+// small extents so there are plenty of them to hand out
+db.createCollection( t.getName(), { size: 8192 } );
+for ( var i = 0; i < 5000; i++ ) {
+    t.insert( { _id: i, x: "abcdefghijklmnopqrstuvwxyz".substring( i % 26 ) } );
+}
+// leave some holes in the deleted lists too
+t.remove( { _id: { $mod: [ 7, 0 ] } } );
+assert.isnull( db.getLastError() );
+
+var serial = t.validate( true );
+assert( serial.valid, tojson( serial ) );
+
+var parallel = db.runCommand( { validate: t.getName(), full: true, parallel: 4 } );
+assert.commandWorked( parallel );
+assert( parallel.valid, tojson( parallel ) );
+assert.eq( 4, parallel.parallel );
+
+[ "objectsFound", "invalidObjects", "nQuantizedSize", "nPowerOf2QuantizedSize",
+  "bytesWithHeaders", "bytesWithoutHeaders", "bytesBson", "deletedCount",
+  "deletedSize" ].forEach( function( f ) {
+    assert.eq( serial[f], parallel[f], f );
+} );
+
+// capped collections keep to the serial scan
+db.validate_parallel_capped.drop();
+db.createCollection( "validate_parallel_capped", { capped: true, size: 100000 } );
+db.validate_parallel_capped.insert( { a: 1 } );
+var capped = db.runCommand( { validate: "validate_parallel_capped", parallel: 4 } );
+assert( capped.valid, tojson( capped ) );
+assert.eq( undefined, capped.parallel );
+
+db.validate_parallel_capped.drop();
+t.drop();
@@ -0,0 +1,24 @@
+// In a $where function 'this' and 'obj' are the same document, and changes to it aren't saved.
+
+t = db.where5;
+t.drop();
+
+for ( var i = 0; i < 100; i++ )
+    t.save( { _id : i , x : i % 10 , sub : { y : i } } );
+
+assert.eq( 10 , t.find( { $where : "obj.x == 3" } ).itcount() , "A" );
+assert.eq( 10 , t.find( { $where : function() { return obj.x == 3 && this.x == 3; } } ).itcount() ,
+           "B" );
+assert.eq( 100 , t.find( { $where : function() { return this === obj; } } ).itcount() , "C" );
+assert.eq( 1 , t.find( { $where : function() { return obj.sub.y == 42; } } ).itcount() , "D" );
+
+// Changes made by the function go no further than the function
+var modify = function() { this.x = 100; obj.z = 1; return true; };
+assert.eq( 100 , t.find( { $where : modify } ).itcount() , "E" );
+assert.eq( 10 , t.find( { x : 3 } ).itcount() , "F" );
+assert.eq( 0 , t.find( { z : { $exists : true } } ).itcount() , "G" );
+
+// Many different functions, more than a scope is reused for
+for ( var i = 0; i < 150; i++ )
+    assert.eq( 1 , t.find( { $where : "this._id == " + i % 100 + " && " + i + " >= 0" } ).itcount() ,
+               "H" + i );
@@ -929,9 +929,16 @@ dodouble:
     }
 
     // used by jsonString()
-    inline std::string escape( const std::string& s , bool escape_slash=false) {
-        StringBuilder ret;
-        for ( std::string::const_iterator i = s.begin(); i != s.end(); ++i ) {
+    inline void escape( StringBuilder& ret, const StringData& s, bool escape_slash=false ) {
+        const char* const end = s.rawData() + s.size();
+        const char* run = s.rawData();
+        for ( const char* i = run; i != end; ++i ) {
+            // Most characters need no escaping, so copy them a run at a time.
+            if ( static_cast<unsigned char>( *i ) > 0x1f &&
+                 *i != '"' && *i != '\\' && *i != '/' )
+                continue;
+            ret << StringData( run, i - run );
+            run = i + 1;
             switch ( *i ) {
             case '"':
                 ret << "\\\"";
@@ -968,6 +975,12 @@ dodouble:
                 }
             }
         }
+        ret << StringData( run, end - run );
+    }
+
+    inline std::string escape( const std::string& s , bool escape_slash=false) {
+        StringBuilder ret;
+        escape( ret, s, escape_slash );
         return ret.str();
     }
 
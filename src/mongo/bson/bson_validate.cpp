@@ -15,7 +15,7 @@
  *    limitations under the License.
  */
 
-#include <deque>
+#include <vector>
 
 #include "mongo/bson/bson_validate.h"
 #include "mongo/bson/oid.h"
@@ -43,17 +43,26 @@ namespace mongo {
             }
 
             Status readCString( StringData* out ) {
-                const void* x = memchr( _buffer + _position, 0, _maxLength - _position );
-                if ( !x )
-                    return Status( ErrorCodes::InvalidBSON, "no end of c-string" );
-                uint64_t len = static_cast<uint64_t>( static_cast<const char*>(x) - ( _buffer + _position ) );
-
-                StringData data( _buffer + _position, len );
-                _position += len + 1;
+                const char* start = _buffer + _position;
+                const char* end = _buffer + _maxLength;
+                const char* x = start;
+
+                // Field names are almost always short, so look at the first few bytes inline
+                // before paying for a call into memchr, which is vectorized by the C library.
+                const char* inlineEnd = end - start > kInlineScan ? start + kInlineScan : end;
+                while ( x < inlineEnd && *x )
+                    ++x;
+                if ( x == inlineEnd ) {
+                    x = static_cast<const char*>( memchr( x, 0, end - x ) );
+                    if ( !x )
+                        return Status( ErrorCodes::InvalidBSON, "no end of c-string" );
+                }
+                uint64_t len = static_cast<uint64_t>( x - start );
 
                 if ( out ) {
-                    *out = data;
+                    *out = StringData( start, len );
                 }
+                _position += len + 1;
                 return Status::OK();
             }
 
@@ -62,20 +71,17 @@ namespace mongo {
                 if ( !readNumber<int>( &sz ) )
                     return Status( ErrorCodes::InvalidBSON, "invalid bson" );
 
-                if ( out ) {
-                    *out = StringData( _buffer + _position, sz );
-                }
-
-                if ( !skip( sz - 1 ) )
-                    return Status( ErrorCodes::InvalidBSON, "invalid bson" );
-
-                char c;
-                if ( !readNumber<char>( &c ) )
+                // One check covers both the length and the terminator.
+                if ( sz < 1 || _position + sz > _maxLength )
                     return Status( ErrorCodes::InvalidBSON, "invalid bson" );
 
-                if ( c != 0 )
+                if ( _buffer[_position + sz - 1] != 0 )
                     return Status( ErrorCodes::InvalidBSON, "not null terminate string" );
 
+                if ( out ) {
+                    *out = StringData( _buffer + _position, sz - 1 );
+                }
+                _position += sz;
                 return Status::OK();
             }
 
@@ -89,6 +95,8 @@ namespace mongo {
             }
 
         private:
+            static const ptrdiff_t kInlineScan = 16;
+
             const char* _buffer;
             uint64_t _position;
             uint64_t _maxLength;
@@ -127,6 +135,41 @@ namespace mongo {
             int _startPosition;
         };
 
+        /**
+         * Stack of the objects being validated.  Nearly every document fits in the inline frames,
+         * so validating one does not touch the heap; deeper nesting spills into a vector.
+         */
+        class ValidationFrameStack {
+        public:
+            ValidationFrameStack() : _size(0) {}
+
+            ValidationObjectFrame* push() {
+                if (_size < kInlineFrames)
+                    return &_inline[_size++];
+                ++_size;
+                _overflow.push_back(ValidationObjectFrame());
+                return &_overflow.back();
+            }
+
+            void pop() {
+                if (_size-- > kInlineFrames)
+                    _overflow.pop_back();
+            }
+
+            ValidationObjectFrame* back() {
+                return _size > kInlineFrames ? &_overflow.back() : &_inline[_size - 1];
+            }
+
+            bool empty() const { return _size == 0; }
+
+        private:
+            static const size_t kInlineFrames = 32;
+
+            ValidationObjectFrame _inline[kInlineFrames];
+            std::vector<ValidationObjectFrame> _overflow;
+            size_t _size;
+        };
+
         Status validateElementInfo(Buffer* buffer, ValidationState::State* nextState) {
             Status status = Status::OK();
 
@@ -179,7 +222,8 @@ namespace mongo {
                 status = buffer->readUTF8String( NULL );
                 if ( !status.isOK() )
                     return status;
-                buffer->skip( sizeof(OID) );
+                if ( !buffer->skip( sizeof(OID) ) )
+                    return Status( ErrorCodes::InvalidBSON, "invalid bson" );
                 return Status::OK();
 
             case RegEx:
@@ -222,15 +266,14 @@ namespace mongo {
         }
 
         Status validateBSONIterative(Buffer* buffer) {
-            std::deque<ValidationObjectFrame> frames;
+            ValidationFrameStack frames;
             ValidationObjectFrame* curr = NULL;
             ValidationState::State state = ValidationState::BeginObj;
 
             while (state != ValidationState::Done) {
                 switch (state) {
                 case ValidationState::BeginObj:
-                    frames.push_back(ValidationObjectFrame());
-                    curr = &frames.back();
+                    curr = frames.push();
                     curr->setStartPosition(buffer->position());
                     curr->setIsCodeWithScope(false);
                     if (!buffer->readNumber<int>(&curr->expectedSize)) {
@@ -251,12 +294,12 @@ namespace mongo {
                         return Status( ErrorCodes::InvalidBSON,
                                        "bson length doesn't match what we found" );
                     }
-                    frames.pop_back();
+                    frames.pop();
                     if (frames.empty()) {
                         state = ValidationState::Done;
                     }
                     else {
-                        curr = &frames.back();
+                        curr = frames.back();
                         if (curr->isCodeWithScope())
                             state = ValidationState::EndCodeWScope;
                         else
@@ -265,8 +308,7 @@ namespace mongo {
                     break;
                 }
                 case ValidationState::BeginCodeWScope: {
-                    frames.push_back(ValidationObjectFrame());
-                    curr = &frames.back();
+                    curr = frames.push();
                     curr->setStartPosition(buffer->position());
                     curr->setIsCodeWithScope(true);
                     if ( !buffer->readNumber<int>( &curr->expectedSize ) )
@@ -283,10 +325,10 @@ namespace mongo {
                         return Status( ErrorCodes::InvalidBSON,
                                        "bson length for CodeWScope doesn't match what we found" );
                     }
-                    frames.pop_back();
+                    frames.pop();
                     if (frames.empty())
                         return Status(ErrorCodes::InvalidBSON, "unnested CodeWScope");
-                    curr = &frames.back();
+                    curr = frames.back();
                     state = ValidationState::WithinObj;
                     break;
                 }
@@ -213,4 +213,42 @@ namespace {
         ASSERT_NOT_OK(validateBSON(x.objdata(), x.objsize() / 2));
     }
 
+    TEST(BSONValidateFast, DeeplyNestedObject) {
+        // Nest deeper than the validator keeps frames for inline.
+        BSONObj deep = BSON( "a" << 1 );
+        for ( int i = 0; i < 100; i++ ) {
+            deep = BSON( "x" << deep << "y" << "str" );
+        }
+        ASSERT_OK(validateBSON(deep.objdata(), deep.objsize()));
+        ASSERT_NOT_OK(validateBSON(deep.objdata(), deep.objsize() / 2));
+        ASSERT_NOT_OK(validateBSON(deep.objdata(), deep.objsize() - 1));
+    }
+
+    TEST(BSONValidateFast, LongFieldName) {
+        std::string name( 1000, 'f' );
+        BSONObj x = BSON( name << 1 << "a" << 2 );
+        ASSERT_OK(validateBSON(x.objdata(), x.objsize()));
+        // Cut off in the middle of the long field name.
+        ASSERT_NOT_OK(validateBSON(x.objdata(), 500));
+    }
+
+    TEST(BSONValidateFast, StringLength) {
+        BSONObj x = BSON( "a" << "abc" );
+        ASSERT_OK(validateBSON(x.objdata(), x.objsize()));
+
+        // The string length sits after the type byte and "a\0".
+        std::string copy( x.objdata(), x.objsize() );
+        int* len = reinterpret_cast<int*>( &copy[4 + 1 + 2] );
+        ASSERT_EQUALS( 4, *len );
+
+        *len = 0;
+        ASSERT_NOT_OK(validateBSON(copy.data(), copy.size()));
+        *len = -1;
+        ASSERT_NOT_OK(validateBSON(copy.data(), copy.size()));
+        *len = 3;
+        ASSERT_NOT_OK(validateBSON(copy.data(), copy.size()));
+        *len = 1000;
+        ASSERT_NOT_OK(validateBSON(copy.data(), copy.size()));
+    }
+
 }
@@ -151,6 +151,7 @@ namespace mongo {
             @param pretty if true we try to add some lf's and indentation
         */
         std::string jsonString( JsonStringFormat format = Strict, int pretty = 0 ) const;
+        void jsonString( StringBuilder& s, JsonStringFormat format = Strict, int pretty = 0 ) const;
 
         /** note: addFields always adds _id even if not specified */
         int addFields(BSONObj& from, std::set<std::string>& fields); /* returns n added */
@@ -0,0 +1,93 @@
+/* Copyright 2013 10gen Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/mutable/damage_vector.h"
+
+#include <algorithm>
+
+namespace mongo {
+namespace mutablebson {
+
+    namespace {
+
+        void addDamage(size_t offset, size_t size, DamageVector* damages) {
+            damages->push_back(DamageEvent());
+            damages->back().sourceOffset = offset;
+            damages->back().targetOffset = offset;
+            damages->back().size = size;
+        }
+
+    } // namespace
+
+    size_t computeDamages(const char* oldData, size_t oldSize,
+                          const char* newData, size_t newSize,
+                          size_t minGap,
+                          DamageVector* damages) {
+        damages->clear();
+
+        const size_t common = std::min(oldSize, newSize);
+        size_t covered = 0;
+
+        // End of the last event, or 0 if there is none yet.
+        size_t lastEnd = 0;
+
+        size_t i = 0;
+        while (i < common) {
+            if (oldData[i] == newData[i]) {
+                ++i;
+                continue;
+            }
+
+            // A change starts at 'i'. Extend it over later changes until an unchanged run of
+            // at least 'minGap' bytes, or the end of the common prefix.
+            const size_t start = i;
+            size_t end = i + 1;
+            size_t j = end;
+            while (j < common) {
+                if (oldData[j] != newData[j]) {
+                    end = ++j;
+                    continue;
+                }
+                if (j + 1 - end >= minGap)
+                    break;
+                ++j;
+            }
+
+            addDamage(start, end - start, damages);
+            covered += end - start;
+            lastEnd = end;
+            i = j;
+        }
+
+        // Bytes past the end of the old data are always written. Fold them into the last
+        // event when it reaches the end of the common prefix, or nearly so.
+        if (newSize > common) {
+            if (!damages->empty() && (lastEnd == common || common - lastEnd < minGap)) {
+                damages->back().size += newSize - lastEnd;
+                covered += newSize - lastEnd;
+            }
+            else {
+                addDamage(common, newSize - common, damages);
+                covered += newSize - common;
+            }
+        }
+
+        return covered;
+    }
+
+} // namespace mutablebson
+} // namespace mongo
@@ -15,8 +15,11 @@
 
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
+#include "mongo/platform/cstdint.h"
+
 namespace mongo {
 namespace mutablebson {
 
@@ -39,5 +42,18 @@ namespace mutablebson {
 
     typedef std::vector<DamageEvent> DamageVector;
 
+    /**
+     * Fills 'damages' with events that turn the 'oldSize' bytes at 'oldData' into the 'newSize'
+     * bytes at 'newData': target offsets are into the old data and source offsets into the new
+     * data, so the target buffer must have room for 'newSize' bytes. An unchanged run shorter
+     * than 'minGap' bytes between two changes is written over rather than splitting the event.
+     *
+     * Returns the number of bytes covered by the events.
+     */
+    size_t computeDamages(const char* oldData, size_t oldSize,
+                          const char* newData, size_t newSize,
+                          size_t minGap,
+                          DamageVector* damages);
+
 } // namespace mutablebson
 } // namespace mongo
@@ -0,0 +1,129 @@
+/* Copyright 2013 10gen Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/mutable/damage_vector.h"
+
+#include <cstring>
+#include <string>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using mongo::BSONObj;
+    using mongo::fromjson;
+    using namespace mongo::mutablebson;
+
+    // Applies the damages between 'from' and 'to' to a copy of 'from' that has room for 'to',
+    // and checks that the result is 'to'.
+    size_t checkDamages(const std::string& from, const std::string& to, size_t minGap,
+                        DamageVector* damages) {
+        const size_t covered = computeDamages(from.data(), from.size(),
+                                              to.data(), to.size(),
+                                              minGap, damages);
+        std::string target(from);
+        if (target.size() < to.size())
+            target.resize(to.size(), '\0');
+
+        size_t total = 0;
+        for (DamageVector::const_iterator it = damages->begin(); it != damages->end(); ++it) {
+            ASSERT_LESS_THAN_OR_EQUALS(it->targetOffset + it->size, target.size());
+            std::memcpy(&target[it->targetOffset], to.data() + it->sourceOffset, it->size);
+            total += it->size;
+        }
+        ASSERT_EQUALS(covered, total);
+        ASSERT_EQUALS(to, target.substr(0, to.size()));
+        return covered;
+    }
+
+    std::string bytes(const BSONObj& obj) {
+        return std::string(obj.objdata(), obj.objsize());
+    }
+
+    TEST(ComputeDamages, Identical) {
+        DamageVector damages;
+        ASSERT_EQUALS(0U, checkDamages("abcdef", "abcdef", 4, &damages));
+        ASSERT_TRUE(damages.empty());
+    }
+
+    TEST(ComputeDamages, SingleChange) {
+        DamageVector damages;
+        ASSERT_EQUALS(2U, checkDamages("abcdef", "abXYef", 4, &damages));
+        ASSERT_EQUALS(1U, damages.size());
+        ASSERT_EQUALS(2U, damages[0].targetOffset);
+    }
+
+    TEST(ComputeDamages, ShortGapIsMerged) {
+        DamageVector damages;
+        ASSERT_EQUALS(5U, checkDamages("abcdefgh", "aXcdeYgh", 4, &damages));
+        ASSERT_EQUALS(1U, damages.size());
+    }
+
+    TEST(ComputeDamages, LongGapIsSplit) {
+        DamageVector damages;
+        ASSERT_EQUALS(2U, checkDamages("abcdefghij", "aXcdefghYj", 4, &damages));
+        ASSERT_EQUALS(2U, damages.size());
+    }
+
+    TEST(ComputeDamages, ZeroGapMergesAdjacentChanges) {
+        DamageVector damages;
+        ASSERT_EQUALS(3U, checkDamages("abcdef", "aXYZef", 0, &damages));
+        ASSERT_EQUALS(1U, damages.size());
+    }
+
+    TEST(ComputeDamages, Grow) {
+        DamageVector damages;
+        ASSERT_EQUALS(3U, checkDamages("abc", "abcdef", 4, &damages));
+        ASSERT_EQUALS(1U, damages.size());
+        ASSERT_EQUALS(6U, checkDamages("abc", "Xbcdef", 4, &damages));
+        ASSERT_EQUALS(1U, damages.size());
+        ASSERT_EQUALS(4U, checkDamages("abc", "Xbcdef", 1, &damages));
+        ASSERT_EQUALS(2U, damages.size());
+        ASSERT_EQUALS(4U, checkDamages("abcdefghij", "Xbcdefghijklm", 4, &damages));
+        ASSERT_EQUALS(2U, damages.size());
+    }
+
+    TEST(ComputeDamages, Shrink) {
+        DamageVector damages;
+        ASSERT_EQUALS(0U, checkDamages("abcdef", "abc", 4, &damages));
+        ASSERT_TRUE(damages.empty());
+        ASSERT_EQUALS(1U, checkDamages("abcdef", "aXc", 4, &damages));
+    }
+
+    TEST(ComputeDamages, PushOntoTrailingArray) {
+        const BSONObj from = fromjson("{_id: 1, name: 'some counter', n: 2, hist: [1, 2]}");
+        const BSONObj to = fromjson("{_id: 1, name: 'some counter', n: 3, hist: [1, 2, 3]}");
+
+        // The document size, the counter, the array size and the new array element.
+        DamageVector damages;
+        const size_t covered = checkDamages(bytes(from), bytes(to), 4, &damages);
+        ASSERT_EQUALS(4U, damages.size());
+        ASSERT_LESS_THAN(covered, static_cast<size_t>(to.objsize()) / 2);
+    }
+
+    TEST(ComputeDamages, SetShorterString) {
+        const BSONObj from = fromjson("{_id: 1, s: 'a longer string', t: 'tail'}");
+        const BSONObj to = fromjson("{_id: 1, s: 'short', t: 'tail'}");
+
+        DamageVector damages;
+        checkDamages(bytes(from), bytes(to), 4, &damages);
+        ASSERT_FALSE(damages.empty());
+    }
+
+} // namespace
@@ -146,6 +146,15 @@ namespace mongo {
         /* assume ownership of the buffer - you must then free() it */
         void decouple() { data = 0; }
 
+        /** take ownership of 'buf', of 'bufSize' bytes, allocated with this builder's allocator.
+            the builder must not currently own a buffer. */
+        void adopt(char* buf, int bufSize) {
+            verify( data == 0 );
+            data = buf;
+            size = bufSize;
+            l = 0;
+        }
+
         void appendUChar(unsigned char j) {
             *((unsigned char*)grow(sizeof(unsigned char))) = j;
         }
@@ -320,6 +329,9 @@ namespace mongo {
 
         std::string str() const { return std::string(_buf.data, _buf.l); }
 
+        /** view of the current string, valid until the builder is next modified */
+        StringData stringData() const { return StringData(_buf.data, _buf.l); }
+
         /** size of current string */
         int len() const { return _buf.l; }
 
@@ -0,0 +1,262 @@
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/client/bulk_operation_builder.h"
+
+#include <algorithm>
+
+#include "mongo/base/owned_pointer_vector.h"
+#include "mongo/db/dbmessage.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/util/net/message.h"
+
+namespace mongo {
+
+    struct BulkOperationBuilder::Batch {
+        Batch( BatchedCommandRequest::BatchType type ) : request( type ), bytes( 0 ) {
+        }
+
+        BatchedCommandRequest request;
+        std::vector<BSONObj> writeOps;
+        // for each write op, the index of its operation
+        std::vector<int> indexes;
+        int bytes;
+    };
+
+    namespace {
+
+        // Room for the array index and type of each write op in the command
+        const int kWriteOpOverheadBytes = 16;
+
+        // THROWS
+        void sayCommand( DBClientBase* conn, const std::string& dbName, const BSONObj& cmdObj ) {
+            Message toSend;
+
+            // see query.h for the protocol we are using here.
+            BufBuilder bufB;
+            bufB.appendNum( 0 ); // command/query options
+            bufB.appendStr( dbName + ".$cmd" ); // write command ns
+            bufB.appendNum( 0 ); // ntoskip (0 for command)
+            bufB.appendNum( 1 ); // ntoreturn (1 for command)
+            cmdObj.appendSelfToBufBuilder( bufB );
+            toSend.setData( dbQuery, bufB.buf(), bufB.len() );
+
+            conn->say( toSend );
+        }
+
+        // THROWS
+        BSONObj recvCommandReply( DBClientBase* conn ) {
+            Message toRecv;
+            if ( !conn->recv( toRecv ) ) {
+                // Confusingly, socket exceptions here are written to the log, not thrown.
+                uasserted( 17385, "error receiving write command response, "
+                           "possible socket exception - see logs" );
+            }
+
+            // A query result is returned from commands
+            QueryResult* recvdQuery = reinterpret_cast<QueryResult*>( toRecv.singleData() );
+            return BSONObj( recvdQuery->data() ).getOwned();
+        }
+
+        bool errorIndexLess( const WriteErrorDetail* a, const WriteErrorDetail* b ) {
+            return a->getIndex() < b->getIndex();
+        }
+
+        bool upsertIndexLess( const BatchedUpsertDetail* a, const BatchedUpsertDetail* b ) {
+            return a->getIndex() < b->getIndex();
+        }
+    }
+
+    BulkOperationBuilder::BulkOperationBuilder( DBClientBase* conn,
+                                                const StringData& ns,
+                                                bool ordered ) :
+        _conn( conn ),
+        _dbName( nsToDatabase( ns ) ),
+        _collName( nsToCollectionSubstring( ns ).toString() ),
+        _ordered( ordered ) {
+    }
+
+    void BulkOperationBuilder::insert( const BSONObj& doc ) {
+        _ops.push_back( Op( BatchedCommandRequest::BatchType_Insert,
+                            doc.getOwned(),
+                            _ops.size() ) );
+    }
+
+    void BulkOperationBuilder::update( const BSONObj& query,
+                                       const BSONObj& updateObj,
+                                       bool upsert,
+                                       bool multi ) {
+        _ops.push_back( Op( BatchedCommandRequest::BatchType_Update,
+                            BSON( "q" << query << "u" << updateObj <<
+                                  "upsert" << upsert << "multi" << multi ),
+                            _ops.size() ) );
+    }
+
+    void BulkOperationBuilder::remove( const BSONObj& query, bool justOne ) {
+        _ops.push_back( Op( BatchedCommandRequest::BatchType_Delete,
+                            BSON( "q" << query << "limit" << ( justOne ? 1 : 0 ) ),
+                            _ops.size() ) );
+    }
+
+    void BulkOperationBuilder::makeBatches( const BSONObj& writeConcern,
+                                            std::vector<Batch*>* batches ) const {
+
+        // Unordered operations may run in any order, so all those of a kind share batches
+        std::vector<const Op*> ops;
+        const BatchedCommandRequest::BatchType types[] = {
+            BatchedCommandRequest::BatchType_Insert,
+            BatchedCommandRequest::BatchType_Update,
+            BatchedCommandRequest::BatchType_Delete
+        };
+        for ( size_t t = 0; t < ( _ordered ? 1 : 3 ); ++t ) {
+            for ( std::vector<Op>::const_iterator it = _ops.begin(); it != _ops.end(); ++it ) {
+                if ( _ordered || it->type == types[t] )
+                    ops.push_back( &*it );
+            }
+        }
+
+        Batch* batch = NULL;
+        for ( std::vector<const Op*>::const_iterator it = ops.begin(); it != ops.end(); ++it ) {
+            const Op& op = **it;
+            int opBytes = op.obj.objsize() + kWriteOpOverheadBytes;
+
+            if ( batch == NULL || batch->request.getBatchType() != op.type ||
+                 batch->writeOps.size() == kMaxWriteBatchSize ||
+                 ( !batch->writeOps.empty() && batch->bytes + opBytes > BSONObjMaxUserSize ) ) {
+                batch = new Batch( op.type );
+                batches->push_back( batch );
+            }
+
+            batch->writeOps.push_back( op.obj );
+            batch->indexes.push_back( op.index );
+            batch->bytes += opBytes;
+        }
+
+        for ( std::vector<Batch*>::iterator it = batches->begin(); it != batches->end(); ++it ) {
+            BatchedCommandRequest& request = ( *it )->request;
+            request.setNS( _collName );
+            request.setWriteOps( ( *it )->writeOps );
+            request.setOrdered( _ordered );
+            if ( !writeConcern.isEmpty() )
+                request.setWriteConcern( writeConcern );
+        }
+    }
+
+    void BulkOperationBuilder::execute( const BSONObj& writeConcern,
+                                        BatchedCommandResponse* response ) {
+
+        OwnedPointerVector<Batch> batchesOwned;
+        std::vector<Batch*>& batches = batchesOwned.mutableVector();
+        makeBatches( writeConcern, &batches );
+        _ops.clear();
+
+        response->clear();
+        response->setOk( 1 );
+
+        long long n = 0;
+        long long nModified = 0;
+        bool sawModified = false;
+        OwnedPointerVector<WriteErrorDetail> errorsOwned;
+        std::vector<WriteErrorDetail*>& errors = errorsOwned.mutableVector();
+        OwnedPointerVector<BatchedUpsertDetail> upsertsOwned;
+        std::vector<BatchedUpsertDetail*>& upserts = upsertsOwned.mutableVector();
+
+        // Pipelining needs recv(), which only a plain connection offers.  Ordered batches can't
+        // be pipelined, since a failure stops the ones after it.
+        const bool pipeline = !_ordered && dynamic_cast<DBClientConnection*>( _conn ) != NULL;
+        size_t numSent = 0;
+
+        for ( size_t i = 0; i < batches.size(); ++i ) {
+            const Batch& batch = *batches[i];
+
+            BSONObj reply;
+            if ( pipeline ) {
+                // Keep the next command on the wire while the server works on this one
+                while ( numSent < batches.size() && numSent <= i + 1 ) {
+                    sayCommand( _conn, _dbName, batches[numSent]->request.toBSON() );
+                    ++numSent;
+                }
+                reply = recvCommandReply( _conn );
+            }
+            else {
+                _conn->runCommand( _dbName, batch.request.toBSON(), reply );
+            }
+
+            BatchedCommandResponse batchResponse;
+            string errMsg;
+            if ( !batchResponse.parseBSON( reply, &errMsg ) || !batchResponse.isValid( &errMsg ) ) {
+                batchResponse.clear();
+                batchResponse.setOk( 0 );
+                batchResponse.setErrCode( ErrorCodes::FailedToParse );
+                batchResponse.setErrMessage( string( str::stream() << "bad write command reply "
+                                                                   << reply
+                                                                   << causedBy( errMsg ) ) );
+            }
+
+            if ( batchResponse.getOk() != 1 ) {
+                response->setOk( 0 );
+                response->setErrCode( batchResponse.isErrCodeSet() ?
+                                      batchResponse.getErrCode() : ErrorCodes::UnknownError );
+                response->setErrMessage( batchResponse.getErrMessage() );
+                if ( _ordered )
+                    break;
+                continue;
+            }
+
+            n += batchResponse.getN();
+            if ( batchResponse.isNDocsModified() ) {
+                nModified += batchResponse.getNDocsModified();
+                sawModified = true;
+            }
+
+            for ( size_t e = 0; e < batchResponse.sizeErrDetails(); ++e ) {
+                const WriteErrorDetail* batchError = batchResponse.getErrDetailsAt( e );
+                auto_ptr<WriteErrorDetail> error( new WriteErrorDetail );
+                batchError->cloneTo( error.get() );
+                error->setIndex( batch.indexes[batchError->getIndex()] );
+                errors.push_back( error.release() );
+            }
+
+            for ( size_t u = 0; u < batchResponse.sizeUpsertDetails(); ++u ) {
+                const BatchedUpsertDetail* batchUpsert = batchResponse.getUpsertDetailsAt( u );
+                auto_ptr<BatchedUpsertDetail> upsert( new BatchedUpsertDetail );
+                batchUpsert->cloneTo( upsert.get() );
+                upsert->setIndex( batch.indexes[batchUpsert->getIndex()] );
+                upserts.push_back( upsert.release() );
+            }
+
+            if ( batchResponse.isWriteConcernErrorSet() )
+                response->setWriteConcernError( *batchResponse.getWriteConcernError() );
+
+            if ( _ordered && batchResponse.isErrDetailsSet() )
+                break;
+        }
+
+        // Unordered replies come back grouped by kind of operation
+        std::stable_sort( errors.begin(), errors.end(), errorIndexLess );
+        std::stable_sort( upserts.begin(), upserts.end(), upsertIndexLess );
+
+        response->setN( n );
+        if ( sawModified )
+            response->setNDocsModified( nModified );
+        if ( !errors.empty() )
+            response->setErrDetails( errors );
+        if ( !upserts.empty() )
+            response->setUpsertDetails( upserts );
+    }
+
+} // namespace mongo
@@ -0,0 +1,111 @@
+/** @file bulk_operation_builder.h */
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/client/dbclientinterface.h"
+#include "mongo/s/write_ops/batched_command_request.h"
+#include "mongo/s/write_ops/batched_command_response.h"
+
+namespace mongo {
+
+    /**
+     * Collects inserts, updates and deletes on one collection and sends them as write commands,
+     * as few as the server limits allow.
+     *
+     * Ordered operations are sent in the order they were added, a command per run of operations
+     * of the same kind, and stop at the first one which fails.  Unordered operations are grouped
+     * by kind whatever their order, all of them are attempted, and on a plain connection their
+     * commands are pipelined: the next one is sent before the reply to the previous one is read.
+     *
+     * Needs a server which supports write commands.
+     *
+     * Example:
+     *     BulkOperationBuilder bulk( &conn, "test.foo", false );
+     *     bulk.insert( BSON( "_id" << 1 ) );
+     *     bulk.update( BSON( "_id" << 2 ), BSON( "$set" << BSON( "x" << 1 ) ), true );
+     *     bulk.remove( BSON( "x" << 3 ) );
+     *
+     *     BatchedCommandResponse response;
+     *     bulk.execute( BSON( "w" << 1 ), &response );
+     */
+    class BulkOperationBuilder {
+        MONGO_DISALLOW_COPYING(BulkOperationBuilder);
+    public:
+        /** Most operations in a write command, as the server accepts them. */
+        static const size_t kMaxWriteBatchSize = 1000;
+
+        /**
+         * Operations on the collection "ns", to be sent on "conn", which must outlive this.
+         */
+        BulkOperationBuilder( DBClientBase* conn, const StringData& ns, bool ordered );
+
+        void insert( const BSONObj& doc );
+
+        void update( const BSONObj& query,
+                     const BSONObj& updateObj,
+                     bool upsert = false,
+                     bool multi = false );
+
+        void remove( const BSONObj& query, bool justOne = false );
+
+        /** Number of operations added since the last execute(). */
+        size_t size() const { return _ops.size(); }
+
+        /**
+         * Sends the operations added, with "writeConcern", and clears them.
+         *
+         * "response" gets the results of all the commands sent: "n" and "nModified" summed,
+         * write errors and upserted ids with the index at which their operation was added, and
+         * the last write concern error.  A command which failed as a whole leaves its error code
+         * and message at the top level of "response", with "ok" 0.
+         *
+         * @throws DBException if the connection fails
+         */
+        void execute( const BSONObj& writeConcern, BatchedCommandResponse* response );
+
+    private:
+        struct Op {
+            Op( BatchedCommandRequest::BatchType type, const BSONObj& obj, int index ) :
+                type( type ), obj( obj ), index( index ) {
+            }
+
+            BatchedCommandRequest::BatchType type;
+            // the document inserted, or the update or delete statement
+            BSONObj obj;
+            // position among the operations added
+            int index;
+        };
+
+        struct Batch;
+
+        /** Splits the operations into batches, in the order to send them. */
+        void makeBatches( const BSONObj& writeConcern, std::vector<Batch*>* batches ) const;
+
+        DBClientBase* _conn;
+        const std::string _dbName;
+        const std::string _collName;
+        const bool _ordered;
+        std::vector<Op> _ops;
+    };
+
+} // namespace mongo
@@ -24,6 +24,7 @@
 #include "mongo/client/dbclient_rs.h"
 #include "mongo/client/syncclusterconnection.h"
 #include "mongo/s/shard.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -42,6 +43,8 @@ namespace mongo {
     }
 
     void PoolForHost::done( DBConnectionPool * pool, DBClientBase * c ) {
+        checkedIn();
+
         if (c->isFailed()) {
             reportBadConnectionAt(c->getSockCreationMicroSec());
             pool->onDestroy(c);
@@ -57,6 +60,42 @@ namespace mongo {
         }
     }
 
+    void PoolForHost::checkOut( mongo::mutex::scoped_lock& lk ) {
+        if ( maxInUsePerHost > 0 && _checkedOut >= maxInUsePerHost ) {
+            _waiting++;
+            _numWaits++;
+            Timer t;
+            bool timedOut = false;
+            while ( _checkedOut >= maxInUsePerHost && maxInUsePerHost > 0 ) {
+                int leftMillis = maxWaitTimeMillis - t.millis();
+                if ( leftMillis <= 0 ||
+                        !_connectionReturned.timed_wait( lk.boost(),
+                                boost::posix_time::milliseconds( leftMillis ) ) ) {
+                    timedOut = _checkedOut >= maxInUsePerHost && maxInUsePerHost > 0;
+                    break;
+                }
+            }
+            _waiting--;
+            _waitTimeMicros += t.micros();
+
+            if ( timedOut ) {
+                _numWaitTimeouts++;
+                uasserted( 17379, str::stream() << "timed out after " << maxWaitTimeMillis
+                                                << "ms waiting for one of the "
+                                                << _checkedOut << " connections in use to "
+                                                << _hostName );
+            }
+        }
+
+        _checkedOut++;
+    }
+
+    void PoolForHost::checkedIn() {
+        if ( _checkedOut > 0 )
+            _checkedOut--;
+        _connectionReturned.notify_one();
+    }
+
     void PoolForHost::reportBadConnectionAt(uint64_t microSec) {
         if (microSec != DBClientBase::INVALID_SOCK_CREATION_TIME &&
                 microSec > _minValidCreationTimeMicroSec) {
@@ -127,17 +166,24 @@ namespace mongo {
     void PoolForHost::getStaleConnections( vector<DBClientBase*>& stale ) {
         time_t now = time(0);
 
+        // the top of the stack is the most recently used connection
         vector<StoredConnection> all;
         while ( ! _pool.empty() ) {
             StoredConnection c = _pool.top();
             _pool.pop();
             
-            if ( c.ok( now ) )
-                all.push_back( c );
-            else
+            if ( ! c.ok( now ) )
+                stale.push_back( c.conn );
+            else if ( idleTimeoutSecs > 0 && (int)all.size() >= minIdlePerHost &&
+                      now - c.when > idleTimeoutSecs )
                 stale.push_back( c.conn );
+            else
+                all.push_back( c );
         }
 
+        // push back in reverse to keep the order of use
+        std::reverse( all.begin(), all.end() );
+
         for ( size_t i=0; i<all.size(); i++ ) {
             _pool.push( all[i] );
         }
@@ -167,6 +213,10 @@ namespace mongo {
     }
 
     unsigned PoolForHost::_maxPerHost = 50;
+    int PoolForHost::maxInUsePerHost = 0;
+    int PoolForHost::maxWaitTimeMillis = 30 * 1000;
+    int PoolForHost::idleTimeoutSecs = 0;
+    int PoolForHost::minIdlePerHost = 0;
 
     // ------ DBConnectionPool ------
 
@@ -183,9 +233,15 @@ namespace mongo {
         scoped_lock L(_mutex);
         PoolForHost& p = _pools[PoolKey(ident,socketTimeout)];
         p.initializeHostName(ident);
+        p.checkOut( L );
         return p.get( this , socketTimeout );
     }
 
+    void DBConnectionPool::_cancelCreate( const string& ident , double socketTimeout ) {
+        scoped_lock L(_mutex);
+        _pools[PoolKey(ident,socketTimeout)].checkedIn();
+    }
+
     DBClientBase* DBConnectionPool::_finishCreate( const string& host , double socketTimeout , DBClientBase* conn ) {
         {
             scoped_lock L(_mutex);
@@ -199,7 +255,7 @@ namespace mongo {
             onHandedOut( conn );
         }
         catch ( std::exception & ) {
-            delete conn;
+            discard( host , conn );
             throw;
         }
 
@@ -213,14 +269,22 @@ namespace mongo {
                 onHandedOut( c );
             }
             catch ( std::exception& ) {
-                delete c;
+                discard( url.toString() , c );
                 throw;
             }
             return c;
         }
 
         string errmsg;
-        c = url.connect( errmsg, socketTimeout );
+        try {
+            c = url.connect( errmsg, socketTimeout );
+        }
+        catch ( std::exception& ) {
+            _cancelCreate( url.toString() , socketTimeout );
+            throw;
+        }
+        if ( ! c )
+            _cancelCreate( url.toString() , socketTimeout );
         uassert( 13328 ,  _name + ": connect failed " + url.toString() + " : " + errmsg , c );
 
         return _finishCreate( url.toString() , socketTimeout , c );
@@ -233,7 +297,7 @@ namespace mongo {
                 onHandedOut( c );
             }
             catch ( std::exception& ) {
-                delete c;
+                discard( host , c );
                 throw;
             }
             return c;
@@ -241,11 +305,21 @@ namespace mongo {
 
         string errmsg;
         ConnectionString cs = ConnectionString::parse( host , errmsg );
+        if ( ! cs.isValid() )
+            _cancelCreate( host , socketTimeout );
         uassert( 13071 , (string)"invalid hostname [" + host + "]" + errmsg , cs.isValid() );
 
-        c = cs.connect( errmsg, socketTimeout );
-        if ( ! c )
+        try {
+            c = cs.connect( errmsg, socketTimeout );
+        }
+        catch ( std::exception& ) {
+            _cancelCreate( host , socketTimeout );
+            throw;
+        }
+        if ( ! c ) {
+            _cancelCreate( host , socketTimeout );
             throw SocketException( SocketException::CONNECT_ERROR , host , 11002 , str::stream() << _name << " error: " << errmsg );
+        }
         return _finishCreate( host , socketTimeout , c );
     }
 
@@ -254,6 +328,17 @@ namespace mongo {
         _pools[PoolKey(host,c->getSoTimeout())].done(this,c);
     }
 
+    void DBConnectionPool::discard(const string& host, DBClientBase *c) {
+        if ( ! c )
+            return;
+
+        {
+            scoped_lock L(_mutex);
+            _pools[PoolKey(host,c->getSoTimeout())].checkedIn();
+        }
+        delete c;
+    }
+
 
     DBConnectionPool::~DBConnectionPool() {
         // connection closing is handled by ~PoolForHost
@@ -322,6 +407,11 @@ namespace mongo {
 
         int avail = 0;
         long long created = 0;
+        int inUse = 0;
+        int waiting = 0;
+        long long numWaits = 0;
+        long long numWaitTimeouts = 0;
+        long long waitTimeMillis = 0;
 
 
         map<ConnectionString::ConnectionType,long long> createdByType;
@@ -340,10 +430,20 @@ namespace mongo {
                 BSONObjBuilder temp( bb.subobjStart( s ) );
                 temp.append( "available" , i->second.numAvailable() );
                 temp.appendNumber( "created" , i->second.numCreated() );
+                temp.append( "inUse" , i->second.numInUse() );
+                temp.append( "waiting" , i->second.numWaiting() );
+                temp.appendNumber( "numWaits" , i->second.numWaits() );
+                temp.appendNumber( "numWaitTimeouts" , i->second.numWaitTimeouts() );
+                temp.appendNumber( "waitTimeMillis" , i->second.waitTimeMillis() );
                 temp.done();
 
                 avail += i->second.numAvailable();
                 created += i->second.numCreated();
+                inUse += i->second.numInUse();
+                waiting += i->second.numWaiting();
+                numWaits += i->second.numWaits();
+                numWaitTimeouts += i->second.numWaitTimeouts();
+                waitTimeMillis += i->second.waitTimeMillis();
 
                 long long& x = createdByType[i->second.type()];
                 x += i->second.numCreated();
@@ -379,6 +479,11 @@ namespace mongo {
 
         b.append( "totalAvailable" , avail );
         b.appendNumber( "totalCreated" , created );
+        b.append( "totalInUse" , inUse );
+        b.append( "totalWaiting" , waiting );
+        b.appendNumber( "totalNumWaits" , numWaits );
+        b.appendNumber( "totalNumWaitTimeouts" , numWaitTimeouts );
+        b.appendNumber( "totalWaitTimeMillis" , waitTimeMillis );
     }
 
     bool DBConnectionPool::serverNameCompare::operator()( const string& a , const string& b ) const{
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <boost/thread/condition.hpp>
 #include <stack>
 
 #include "mongo/util/background.h"
@@ -35,18 +36,29 @@ namespace mongo {
     class PoolForHost {
     public:
         PoolForHost()
-            : _created(0), _minValidCreationTimeMicroSec(0) {}
+            : _created(0), _minValidCreationTimeMicroSec(0), _checkedOut(0), _waiting(0),
+              _numWaits(0), _numWaitTimeouts(0), _waitTimeMicros(0) {}
 
         PoolForHost( const PoolForHost& other ) {
             verify(other._pool.size() == 0);
             _created = other._created;
             _minValidCreationTimeMicroSec = other._minValidCreationTimeMicroSec;
+            _checkedOut = other._checkedOut;
+            _waiting = other._waiting;
+            _numWaits = other._numWaits;
+            _numWaitTimeouts = other._numWaitTimeouts;
+            _waitTimeMicros = other._waitTimeMicros;
             verify( _created == 0 );
         }
 
         ~PoolForHost();
 
         int numAvailable() const { return (int)_pool.size(); }
+        int numInUse() const { return _checkedOut; }
+        int numWaiting() const { return _waiting; }
+        long long numWaits() const { return _numWaits; }
+        long long numWaitTimeouts() const { return _numWaitTimeouts; }
+        long long waitTimeMillis() const { return _waitTimeMicros / 1000; }
 
         void createdOne( DBClientBase * base );
         long long numCreated() const { return _created; }
@@ -63,8 +75,27 @@ namespace mongo {
 
         void done( DBConnectionPool * pool , DBClientBase * c );
 
+        /**
+         * Blocks while maxInUsePerHost connections are handed out, until one comes back
+         * or maxWaitTimeMillis passes (uasserts then). Then counts one more connection
+         * as handed out, which the caller must give back through done or checkedIn.
+         *
+         * @param lk the lock of the owning DBConnectionPool, released while waiting
+         */
+        void checkOut( mongo::mutex::scoped_lock& lk );
+
+        /**
+         * Counts a connection handed out by checkOut as given back without going through
+         * done, e.g. because it failed to connect or was deleted by its user.
+         */
+        void checkedIn();
+
         void flush();
         
+        /**
+         * Moves out the pooled connections that are disconnected, or that stayed unused for
+         * longer than idleTimeoutSecs beyond the minIdlePerHost most recently used ones.
+         */
         void getStaleConnections( vector<DBClientBase*>& stale );
 
         /**
@@ -86,6 +117,16 @@ namespace mongo {
 
         static void setMaxPerHost( unsigned max ) { _maxPerHost = max; }
         static unsigned getMaxPerHost() { return _maxPerHost; }
+
+        // Limits for every pool, exported as server parameters in shardconnection.cpp.
+        // Max connections to a host handed out at once, 0 for no limit.
+        static int maxInUsePerHost;
+        // Max time a get waits for one of those connections to come back.
+        static int maxWaitTimeMillis;
+        // Pooled connections unused for longer than this are closed, 0 to keep them.
+        static int idleTimeoutSecs;
+        // Number of pooled connections per host kept open regardless of idleTimeoutSecs.
+        static int minIdlePerHost;
     private:
 
         struct StoredConnection {
@@ -104,6 +145,16 @@ namespace mongo {
         uint64_t _minValidCreationTimeMicroSec;
         ConnectionString::ConnectionType _type;
 
+        // connections handed out and not given back yet
+        int _checkedOut;
+
+        // threads blocked in checkOut, and what they waited overall
+        int _waiting;
+        long long _numWaits;
+        long long _numWaitTimeouts;
+        long long _waitTimeMicros;
+        boost::condition _connectionReturned;
+
         static unsigned _maxPerHost;
     };
 
@@ -151,6 +202,12 @@ namespace mongo {
 
         void release(const string& host, DBClientBase *c);
 
+        /**
+         * Deletes a connection obtained from get which is not fit to return to the pool,
+         * freeing its place for other users of the host.
+         */
+        void discard(const string& host, DBClientBase *c);
+
         void addHook( DBConnectionHook * hook ); // we take ownership
         void appendInfo( BSONObjBuilder& b );
 
@@ -187,6 +244,9 @@ namespace mongo {
         DBClientBase* _get( const string& ident , double socketTimeout );
 
         DBClientBase* _finishCreate( const string& ident , double socketTimeout, DBClientBase* conn );
+
+        // gives back the place checked out by _get for a connection that was never created
+        void _cancelCreate( const string& ident , double socketTimeout );
         
         struct PoolKey {
             PoolKey( const std::string& i , double t ) : ident( i ) , timeout( t ) {}
@@ -290,7 +350,7 @@ namespace mongo {
             a bad state.  Destructor will do this too, but it is verbose.
         */
         void kill() {
-            delete _conn;
+            pool.discard(_host, _conn);
             _conn = 0;
         }
 
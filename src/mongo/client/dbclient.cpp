@@ -31,6 +31,7 @@
 #include "mongo/s/stale_exception.h"  // for RecvStaleConfigException
 #include "mongo/util/assert_util.h"
 #include "mongo/util/md5.hpp"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/net/ssl_options.h"
 
@@ -51,8 +52,9 @@ namespace mongo {
         if( s.find( '$' ) == 0 ) _type = CUSTOM;
 
         {
+            // a leading '/' starts the path of a unix domain socket, not an empty set name
             string::size_type idx = s.find( '/' );
-            if ( idx != string::npos ) {
+            if ( idx != string::npos && idx != 0 ) {
                 _setName = s.substr( 0 , idx );
                 s = s.substr( idx + 1 );
                 if( _type != CUSTOM ) _type = SET;
@@ -911,10 +913,39 @@ namespace mongo {
         int sslModeVal = sslGlobalParams.sslMode.load();
         if (sslModeVal == SSLGlobalParams::SSLMode_preferSSL ||
             sslModeVal == SSLGlobalParams::SSLMode_requireSSL) {
-            return p->secure( sslManager(), _server.host() );
+            if ( !p->secure( sslManager(), _server.host() ) )
+                return false;
         }
 #endif
 
+        if ( messageCompressionEnabled )
+            return _negotiateCompression( errmsg );
+
+        return true;
+    }
+
+    bool DBClientConnection::_negotiateCompression( string& errmsg ) {
+        BSONObjBuilder cmd;
+        cmd.append( "isMaster", 1 );
+        appendCompressionOffer( &cmd );
+
+        BSONObj info;
+        try {
+            if ( !runCommand( "admin", cmd.obj(), info ) ) {
+                // not worth failing the connection over
+                LOG(1) << "isMaster failed on " << _serverString << ", not compressing: "
+                       << info << endl;
+                return true;
+            }
+        }
+        catch ( const DBException& e ) {
+            errmsg = str::stream() << "couldn't connect to server " << _serverString
+                                   << ", isMaster failed: " << e.toString();
+            _failed = true;
+            return false;
+        }
+
+        p->setCompressor( compressorFromReply( info ) );
         return true;
     }
 
@@ -19,6 +19,8 @@
 
 #include "mongo/client/dbclient_rs.h"
 
+#include <algorithm>
+#include <boost/thread/thread.hpp>
 #include <fstream>
 #include <memory>
 
@@ -32,6 +34,7 @@
 #include "mongo/db/json.h"
 #include "mongo/util/background.h"
 #include "mongo/util/concurrency/mutex.h" // for StaticObserver
+#include "mongo/util/net/socket_poll.h"
 #include "mongo/util/scopeguard.h"
 #include "mongo/util/timer.h"
 
@@ -65,7 +68,8 @@ namespace mongo {
         ReplicaSetMonitorWatcher():
             _monitorMutex("ReplicaSetMonitorWatcher::_safego"),
             _started(false),
-            _stopRequested(false) {
+            _stopRequested(false),
+            _checkRequested(false) {
         }
 
         ~ReplicaSetMonitorWatcher() {
@@ -101,6 +105,16 @@ namespace mongo {
             _stopRequestedCV.notify_one();
         }
 
+        /**
+         * Wakes the monitoring thread up to check the sets now instead of at the end of
+         * its current sleep. Does not wait for the check.
+         */
+        void requestCheck() {
+            scoped_lock sl( _monitorMutex );
+            _checkRequested = true;
+            _stopRequestedCV.notify_one();
+        }
+
     protected:
         void run() {
             log() << "starting" << endl;
@@ -123,6 +137,11 @@ namespace mongo {
                     }
                 }
 
+                {
+                    scoped_lock sl( _monitorMutex );
+                    _checkRequested = false;
+                }
+
                 try {
                     ReplicaSetMonitor::checkAll();
                 }
@@ -138,16 +157,20 @@ namespace mongo {
                     break;
                 }
 
-                _stopRequestedCV.timed_wait(sl.boost(), boost::posix_time::seconds(10));
+                if (!_checkRequested) {
+                    _stopRequestedCV.timed_wait(sl.boost(), boost::posix_time::seconds(10));
+                }
             }
         }
 
-        // protects _started, _stopRequested
+        // protects _started, _stopRequested, _checkRequested
         mongo::mutex _monitorMutex;
         bool _started;
 
+        // also signalled by requestCheck
         boost::condition _stopRequestedCV;
         bool _stopRequested;
+        bool _checkRequested;
     } replicaSetMonitorWatcher;
 
     static StaticObserver staticObserver;
@@ -352,36 +375,49 @@ namespace mongo {
     }
 
     /**
-     * @return the connection associated with the monitor node. Will also attempt
-     *     to establish connection if NULL or broken in background.
-     * Can still return NULL if reconnect failed.
+     * A single isMaster round trip to a replica set member. ReplicaSetMonitor::_probeNodes
+     * runs one per member on its own thread, so a slow or dead member only delays its own
+     * reply.
      */
-    shared_ptr<DBClientConnection> _getConnWithRefresh( ReplicaSetMonitor::Node& node ) {
-        if ( node.conn.get() == NULL || !node.conn->isStillConnected() ) {
-
-            // Note: This constructor only works with MASTER connections
-            ConnectionString connStr( node.addr );
-            string errmsg;
+    struct NodeProbe {
+        NodeProbe( const HostAndPort& a, const shared_ptr<DBClientConnection>& c )
+            : addr( a ), conn( c ), ok( false ), millis( 0 ) {
+        }
 
+        /**
+         * (Re)connects first if the monitor connection is NULL or broken.
+         */
+        void run() {
             try {
-                DBClientBase* conn = connStr.connect( errmsg,
-                                                      ReplicaSetMonitor::SOCKET_TIMEOUT_SECS );
-                if ( conn == NULL ) {
-                    node.ok = false;
-                    node.conn.reset();
-                }
-                else {
-                    node.conn.reset( dynamic_cast<DBClientConnection*>( conn ) );
+                if ( conn.get() == NULL || !conn->isStillConnected() ) {
+                    // Note: This constructor only works with MASTER connections
+                    ConnectionString connStr( addr );
+                    conn.reset( dynamic_cast<DBClientConnection*>(
+                            connStr.connect( error, ReplicaSetMonitor::SOCKET_TIMEOUT_SECS ) ) );
+                    if ( conn.get() == NULL )
+                        return;
                 }
+
+                Timer t;
+                bool isMaster;
+                conn->isMaster( isMaster, &reply );
+                millis = t.millis();
+                ok = true;
             }
-            catch ( const AssertionException& ) {
-                node.ok = false;
-                node.conn.reset();
+            catch ( const std::exception& e ) {
+                error = e.what();
             }
         }
 
-        return node.conn;
-    }
+        HostAndPort addr;
+        shared_ptr<DBClientConnection> conn;
+
+        // whether isMaster got a reply, which is then in reply
+        bool ok;
+        BSONObj reply;
+        int millis;
+        string error;
+    };
 
     // --------------------------------
     // ----- ReplicaSetMonitor ---------
@@ -405,8 +441,9 @@ namespace mongo {
     ReplicaSetMonitor::ReplicaSetMonitor( const string& name , const vector<HostAndPort>& servers )
         : _lock( "ReplicaSetMonitor instance" ),
           _checkConnectionLock( "ReplicaSetMonitor check connection lock" ),
+          _refreshing( false ), _refreshGeneration( 0 ),
           _name( name ), _master(-1),
-          _nextSlave(0), _failedChecks(0),
+          _nextSlave(0), _failedChecks(0), _nextSecondaryRead(0),
           _localThresholdMillis(serverGlobalParams.defaultLocalThresholdMillis) {
 
         uassert( 13642 , "need at least 1 node for a replica set" , servers.size() > 0 );
@@ -569,14 +606,20 @@ namespace mongo {
     
 
     void ReplicaSetMonitor::notifyFailure( const HostAndPort& server ) {
-        scoped_lock lk( _lock );
-        
-        if ( _master >= 0 && _master < (int)_nodes.size() ) {
-            if ( server == _nodes[_master].addr ) {
-                _nodes[_master].ok = false; 
-                _master = -1;
+        {
+            scoped_lock lk( _lock );
+
+            if ( _master < 0 || _master >= (int)_nodes.size() ||
+                    server != _nodes[_master].addr ) {
+                return;
             }
+
+            _nodes[_master].ok = false;
+            _master = -1;
         }
+
+        // find the new primary in the background, callers only wait for it in getMaster
+        replicaSetMonitorWatcher.requestCheck();
     }
 
 
@@ -589,7 +632,7 @@ namespace mongo {
                 return _nodes[_master].addr;
         }
         
-        _check();
+        _refresh( true );
 
         scoped_lock lk( _lock );
         uassert( 10009 , str::stream() << "ReplicaSetMonitor no master found for set: " << _name , _master >= 0 );
@@ -679,11 +722,16 @@ namespace mongo {
      * notify the monitor that server has failed
      */
     void ReplicaSetMonitor::notifySlaveFailure( const HostAndPort& server ) {
-        scoped_lock lk( _lock );
-        int x = _find_inlock( server );
-        if ( x >= 0 ) {
+        {
+            scoped_lock lk( _lock );
+            int x = _find_inlock( server );
+            if ( x < 0 )
+                return;
+
             _nodes[x].ok = false;
         }
+
+        replicaSetMonitorWatcher.requestCheck();
     }
 
     NodeDiff ReplicaSetMonitor::_getHostDiff_inlock( const BSONObj& hostList ){
@@ -830,8 +878,35 @@ namespace mongo {
             string& maybePrimary, bool verbose, int nodesOffset ) {
 
         verify( conn );
+
+        BSONObj o;
+        int commandTime;
+        try {
+            Timer t;
+            bool isMaster;
+            conn->isMaster( isMaster, &o );
+            commandTime = t.millis();
+        }
+        catch ( std::exception& e ) {
+            LOG( verbose ? 0 : 1 ) << "ReplicaSetMonitor::_checkConnection: caught exception "
+                             << conn->toString() << ' ' << e.what() << endl;
+
+            if ( nodesOffset >= 0 ) {
+                scoped_lock lk( _lock );
+                if ( _checkConnMatch_inlock( conn, nodesOffset ) )
+                    _nodes[nodesOffset].ok = false;
+            }
+            return false;
+        }
+
+        return _applyIsMaster( conn, o, commandTime, maybePrimary, verbose, nodesOffset );
+    }
+
+    bool ReplicaSetMonitor::_applyIsMaster( DBClientConnection* conn, const BSONObj& o,
+            int commandTime, string& maybePrimary, bool verbose, int nodesOffset ) {
+
         scoped_lock lk( _checkConnectionLock );
-        bool isMaster = false;
+        bool isMaster = o["ismaster"].trueValue();
         bool changed = false;
         bool errorOccured = false;
 
@@ -848,10 +923,6 @@ namespace mongo {
         }
         
         try {
-            Timer t;
-            BSONObj o;
-            conn->isMaster( isMaster, &o );
-
             if ( o["setName"].type() != String || o["setName"].String() != _name ) {
                 warning() << "node: " << conn->getServerAddress()
                           << " isn't a part of set: " << _name
@@ -864,7 +935,6 @@ namespace mongo {
 
                 return false;
             }
-            int commandTime = t.millis();
 
             if ( nodesOffset >= 0 ) {
                 scoped_lock lk( _lock );
@@ -880,7 +950,7 @@ namespace mongo {
 
                 node.hidden = o["hidden"].trueValue();
                 node.secondary = o["secondary"].trueValue();
-                node.ismaster = o["ismaster"].trueValue();
+                node.ismaster = isMaster;
                 node.ok = node.secondary || node.ismaster;
 
                 node.lastIsMaster = o.copy();
@@ -929,41 +999,85 @@ namespace mongo {
         return isMaster;
     }
 
-    void ReplicaSetMonitor::_check() {
-        LOG(1) <<  "_check : " << getServerAddress() << endl;
+    int ReplicaSetMonitor::_probeNodes( set<string>* probed, bool verbose, int* newMaster ) {
+        vector<NodeProbe> probes;
+        {
+            scoped_lock lk( _lock );
+            for ( unsigned i = 0; i < _nodes.size(); i++ ) {
+                if ( probed->insert( _nodes[i].addr.toString() ).second )
+                    probes.push_back( NodeProbe( _nodes[i].addr, _nodes[i].conn ) );
+            }
+        }
 
-        int newMaster = -1;
-        shared_ptr<DBClientConnection> nodeConn;
+        if ( probes.size() == 1 ) {
+            probes[0].run();
+        }
+        else if ( ! probes.empty() ) {
+            boost::thread_group threads;
+            unsigned started = 0;
+            try {
+                for ( ; started < probes.size(); started++ ) {
+                    threads.create_thread( boost::bind( &NodeProbe::run, &probes[started] ) );
+                }
+            }
+            catch ( const boost::thread_resource_error& ) {
+                // out of threads, probe the rest from here
+                for ( unsigned i = started; i < probes.size(); i++ ) {
+                    probes[i].run();
+                }
+            }
+            threads.join_all();
+        }
 
-        for ( int retry = 0; retry < 2; retry++ ) {
-            for ( unsigned i = 0; /* should not check while outside of lock! */ ; i++ ) {
-                {
-                    scoped_lock lk( _lock );
-                    if ( i >= _nodes.size() ) break;
-                    nodeConn = _getConnWithRefresh(_nodes[i]);
-                    if (nodeConn.get() == NULL) continue;
+        for ( unsigned i = 0; i < probes.size(); i++ ) {
+            NodeProbe& probe = probes[i];
+            int nodeOffset;
+            {
+                scoped_lock lk( _lock );
+                // an earlier reply may have changed the host list
+                nodeOffset = _find_inlock( probe.addr.toString() );
+                if ( nodeOffset < 0 )
+                    continue;
+
+                Node& node = _nodes[nodeOffset];
+                node.conn = probe.conn;
+                if ( ! probe.ok ) {
+                    node.ok = false;
+                    LOG( verbose ? 0 : 1 ) << "ReplicaSetMonitor::_check: could not check "
+                                           << probe.addr << " in replica set " << _name
+                                           << ": " << probe.error << endl;
+                    continue;
                 }
+            }
 
-                string maybePrimary;
-                if ( _checkConnection( nodeConn.get(), maybePrimary, retry, i ) ) {
-                    scoped_lock lk( _lock );
-                    if ( _checkConnMatch_inlock( nodeConn.get(), i )) {
-                        newMaster = i;
-                        if ( newMaster != _master ) {
-                            log() << "Primary for replica set " << _name
-                                  << " changed to " << _nodes[newMaster].addr << endl;
-                        }
-                        _master = i;
-                    }
-                    else {
-                        /*
-                         * Somebody modified _nodes and most likely set the new
-                         * _master, so try again.
-                         */
-                        break;
+            string maybePrimary;
+            if ( _applyIsMaster( probe.conn.get(), probe.reply, probe.millis, maybePrimary,
+                                 verbose, nodeOffset ) ) {
+                scoped_lock lk( _lock );
+                if ( _checkConnMatch_inlock( probe.conn.get(), nodeOffset ) ) {
+                    *newMaster = nodeOffset;
+                    if ( nodeOffset != _master ) {
+                        log() << "Primary for replica set " << _name
+                              << " changed to " << _nodes[nodeOffset].addr << endl;
                     }
+                    _master = nodeOffset;
                 }
             }
+        }
+
+        return probes.size();
+    }
+
+    void ReplicaSetMonitor::_check() {
+        LOG(1) <<  "_check : " << getServerAddress() << endl;
+
+        int newMaster = -1;
+
+        for ( int retry = 0; retry < 2; retry++ ) {
+            // members that the replies add to the host list are probed in further rounds
+            set<string> probed;
+            while ( _probeNodes( &probed, retry, &newMaster ) > 0 ) {
+            }
             
             if ( newMaster >= 0 )
                 return;
@@ -995,6 +1109,32 @@ namespace mongo {
         }
     }
 
+    void ReplicaSetMonitor::_refresh( bool wait ) {
+        {
+            scoped_lock lk( _lock );
+            if ( _refreshing ) {
+                // Another thread is already probing the members: use the view it builds
+                // rather than sending every member a second isMaster.
+                const unsigned long long generation = _refreshGeneration;
+                while ( wait && generation == _refreshGeneration ) {
+                    _refreshDone.wait( lk.boost() );
+                }
+                return;
+            }
+            _refreshing = true;
+        }
+
+        ON_BLOCK_EXIT_OBJ( *this, &ReplicaSetMonitor::_endRefresh );
+        _check();
+    }
+
+    void ReplicaSetMonitor::_endRefresh() {
+        scoped_lock lk( _lock );
+        _refreshing = false;
+        _refreshGeneration++;
+        _refreshDone.notify_all();
+    }
+
     void ReplicaSetMonitor::check() {
         bool isNodeEmpty = false;
 
@@ -1014,7 +1154,7 @@ namespace mongo {
         }
 
         // we either have no master, or the current is dead
-        _check();
+        _refresh( true );
     }
 
     int ReplicaSetMonitor::_find( const string& server ) const {
@@ -1091,7 +1231,7 @@ namespace mongo {
                                 << _name << endl;
 
             // mimic checkMaster behavior, which refreshes the local view of the replica set
-            _check();
+            _refresh( true );
 
             tags->reset();
             scoped_lock lk(_lock);
@@ -1102,6 +1242,58 @@ namespace mongo {
         return candidate;
     }
 
+    HostAndPort ReplicaSetMonitor::selectOtherSecondary(ReadPreference preference,
+                                                        const TagSet& tags,
+                                                        const HostAndPort& exclude) {
+        std::vector<Node> nodes;
+        int localThresholdMillis;
+        {
+            scoped_lock lk(_lock);
+            nodes = _nodes;
+            localThresholdMillis = _localThresholdMillis;
+        }
+
+        for (vector<Node>::iterator iter = nodes.begin(); iter != nodes.end(); ++iter) {
+            if (iter->ismaster || iter->addr == exclude) {
+                iter->ok = false;
+            }
+        }
+
+        TagSet tagsCopy(tags);
+        HostAndPort lastHost;
+        bool isPrimarySelected = false;
+        return ReplicaSetMonitor::selectNode(nodes, preference, &tagsCopy, localThresholdMillis,
+                                             &lastHost, &isPrimarySelected);
+    }
+
+    void ReplicaSetMonitor::noteSecondaryReadMicros(long long micros) {
+        scoped_lock lk(_lock);
+        if (_secondaryReadMicros.size() < kSecondaryReadSamples) {
+            _secondaryReadMicros.push_back(micros);
+        }
+        else {
+            _secondaryReadMicros[_nextSecondaryRead] = micros;
+        }
+        _nextSecondaryRead = (_nextSecondaryRead + 1) % kSecondaryReadSamples;
+    }
+
+    long long ReplicaSetMonitor::secondaryReadPercentileMicros(int percentile) const {
+        std::vector<long long> samples;
+        {
+            scoped_lock lk(_lock);
+            samples = _secondaryReadMicros;
+        }
+
+        // too few to say what is unusually slow
+        if (samples.size() < 20)
+            return -1;
+
+        const size_t rank = std::min(samples.size() - 1,
+                                     samples.size() * std::max(percentile, 0) / 100);
+        std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+        return samples[rank];
+    }
+
     // static
     HostAndPort ReplicaSetMonitor::selectNode(const std::vector<Node>& nodes,
                                               ReadPreference preference,
@@ -1249,8 +1441,9 @@ namespace mongo {
             }
         }
 
-        // Check everything to get the first data
-        _check();
+        // Check everything to get the first data. Don't wait on a refresh another thread is
+        // running, since that one already probes the hosts added above and we hold _setsLock.
+        _refresh( false );
     }
 
     bool ReplicaSetMonitor::isAnyNodeOk() const {
@@ -1366,6 +1559,14 @@ namespace mongo {
 
     const size_t DBClientReplicaSet::MAX_RETRY = 3;
 
+    const size_t ReplicaSetMonitor::kSecondaryReadSamples = 256;
+
+    bool DBClientReplicaSet::hedgedReads = false;
+    int DBClientReplicaSet::hedgedReadsPercentile = 95;
+    int DBClientReplicaSet::hedgedReadsMinDelayMillis = 5;
+    Counter64 DBClientReplicaSet::hedgedReadsSent;
+    Counter64 DBClientReplicaSet::hedgedReadsWon;
+
     DBClientReplicaSet::DBClientReplicaSet( const string& name , const vector<HostAndPort>& servers, double so_timeout )
         : _setName( name ), _so_timeout( so_timeout ) {
         ReplicaSetMonitor::createIfNeeded( name, servers );
@@ -1942,6 +2143,19 @@ namespace mongo {
                         _lazyState._lastOp = lastOp;
                         _lazyState._secondaryQueryOk = true;
                         _lazyState._lastClient = conn;
+
+                        _lazyState._hedgeReadPref.reset();
+                        _lazyState._hedgeMessage.clear();
+                        if (hedgedReads && conn != _master.get()) {
+                            _lazyState._sentMicros = curTimeMicros64();
+                            if (readPref->pref == ReadPreference_Nearest ||
+                                readPref->pref == ReadPreference_SecondaryPreferred) {
+                                string scratch;
+                                _lazyState._hedgeReadPref = readPref;
+                                _lazyState._hedgeMessage.assign(toSend.contiguousData(&scratch),
+                                                                toSend.size());
+                            }
+                        }
                     }
                     catch ( const DBException& DBExcep ) {
                         StringBuilder errMsgBuilder;
@@ -1990,7 +2204,16 @@ namespace mongo {
 
         // TODO: It would be nice if we could easily wrap a conn error as a result error
         try {
-            return _lazyState._lastClient->recv( m );
+            if ( ! _lazyState._hedgeMessage.empty() )
+                _hedgeRead();
+
+            bool ok = _lazyState._lastClient->recv( m );
+            if ( ok && _lazyState._sentMicros ) {
+                _getMonitor()->noteSecondaryReadMicros( curTimeMicros64() -
+                                                        _lazyState._sentMicros );
+                _lazyState._sentMicros = 0;
+            }
+            return ok;
         }
         catch( DBException& e ){
             log() << "could not receive data from " << _lazyState._lastClient->toString() << causedBy( e ) << endl;
@@ -1998,6 +2221,85 @@ namespace mongo {
         }
     }
 
+    void DBClientReplicaSet::_hedgeRead() {
+        string message;
+        message.swap( _lazyState._hedgeMessage );
+        shared_ptr<ReadPreferenceSetting> readPref = _lazyState._hedgeReadPref;
+        _lazyState._hedgeReadPref.reset();
+
+        DBClientConnection* first = _lazyState._lastClient;
+        if ( ! isPollSupported() || first != _lastSlaveOkConn.get() )
+            return;
+
+        ReplicaSetMonitorPtr monitor = _getMonitor();
+        const long long percentileMicros =
+            monitor->secondaryReadPercentileMicros( hedgedReadsPercentile );
+        if ( percentileMicros < 0 )
+            return;
+
+        // wait out the delay for the first node's answer
+        const long long delayMicros = std::max( percentileMicros,
+                                                hedgedReadsMinDelayMillis * 1000LL );
+        const long long waitedMicros = curTimeMicros64() - _lazyState._sentMicros;
+        const int waitMillis = static_cast<int>( ( delayMicros - waitedMicros + 999 ) / 1000 );
+        pollfd fds[2];
+        fds[0].fd = first->port().psock->rawFD();
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        if ( waitMillis <= 0 || socketPoll( fds, 1, waitMillis ) != 0 ) {
+            // answered (or failed, which recv() will report)
+            return;
+        }
+
+        HostAndPort otherHost = monitor->selectOtherSecondary( readPref->pref, readPref->tags,
+                                                               _lastSlaveOkHost );
+        if ( otherHost.empty() )
+            return;
+
+        auto_ptr<DBClientConnection> other;
+        try {
+            string errmsg;
+            other.reset( dynamic_cast<DBClientConnection*>(
+                    ConnectionString( otherHost ).connect( errmsg, _so_timeout ) ) );
+            if ( other.get() == NULL ) {
+                LOG( 1 ) << "dbclient_rs couldn't connect to " << otherHost
+                         << " to hedge a read: " << errmsg << endl;
+                return;
+            }
+            other->setReplSetClientCallback( this );
+            _auth( other.get() );
+
+            char* buf = static_cast<char*>( malloc( message.size() ) );
+            memcpy( buf, message.data(), message.size() );
+            Message toSend( buf, true );
+            other->say( toSend );
+        }
+        catch ( const DBException& e ) {
+            LOG( 1 ) << "dbclient_rs couldn't hedge a read to " << otherHost << causedBy( e )
+                     << endl;
+            return;
+        }
+        hedgedReadsSent.increment();
+
+        LOG( 3 ) << "dbclient_rs hedging read to " << _lastSlaveOkHost << " with " << otherHost
+                 << " after " << delayMicros << " micros" << endl;
+
+        fds[0].revents = 0;
+        fds[1].fd = other->port().psock->rawFD();
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        const int timeoutMillis = _so_timeout > 0 ? static_cast<int>( _so_timeout * 1000 ) : -1;
+        if ( socketPoll( fds, 2, timeoutMillis ) <= 0 || fds[0].revents || ! fds[1].revents )
+            return; // the first node stays, and closing 'other' abandons its query
+
+        // the second node answered first: it takes the place of the first, whose connection is
+        // closed to abandon the query it is still running
+        hedgedReadsWon.increment();
+        _lastSlaveOkConn.reset( other.release() );
+        _lastSlaveOkHost = otherHost;
+        _lazyState._lastClient = _lastSlaveOkConn.get();
+    }
+
     void DBClientReplicaSet::checkResponse( const char* data, int nReturned, bool* retry, string* targetHost ){
 
         // For now, do exactly as we did before, so as not to break things.  In general though, we
@@ -21,9 +21,11 @@
 
 #include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
 #include <set>
 #include <utility>
 
+#include "mongo/base/counter.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/util/net/hostandport.h"
 
@@ -180,6 +182,28 @@ namespace mongo {
                                        TagSet* tags,
                                        bool* isPrimarySelected);
 
+        /**
+         * Selects a secondary other than 'exclude' that is compatible with the preference and
+         * tags, for the second request of a hedged read. Unlike selectAndCheckNode, never
+         * returns the primary, and doesn't refresh the view of the set or move the round robin.
+         *
+         * @return the host object of the node selected, or an empty host if there is none.
+         */
+        HostAndPort selectOtherSecondary(ReadPreference preference,
+                                         const TagSet& tags,
+                                         const HostAndPort& exclude);
+
+        /**
+         * Records how long a read from a secondary of this set took to be answered.
+         */
+        void noteSecondaryReadMicros(long long micros);
+
+        /**
+         * @return the given percentile of the recent secondary read times, in microseconds, or
+         *     -1 if too few reads have been seen to tell.
+         */
+        long long secondaryReadPercentileMicros(int percentile) const;
+
         /**
          * Creates a new ReplicaSetMonitor, if it doesn't already exist.
          */
@@ -302,10 +326,31 @@ namespace mongo {
 
         /**
          * Checks all connections from the host list and sets the current
-         * master.
+         * master. The members are probed in parallel.
          */
         void _check();
 
+        /**
+         * Runs _check unless another thread is already doing so, in which case this
+         * waits for that refresh to finish (if wait is true) and uses its result instead
+         * of probing the members a second time.
+         */
+        void _refresh( bool wait );
+        void _endRefresh();
+
+        /**
+         * Sends isMaster to every member of _nodes whose address is not in probed yet,
+         * in parallel, and applies the replies. Members discovered from the replies are
+         * left for the next call.
+         *
+         * @param probed IN/OUT addresses already probed during this _check
+         * @param verbose
+         * @param newMaster OUT set to the index of the primary if one replied
+         *
+         * @return the number of members probed
+         */
+        int _probeNodes(set<string>* probed, bool verbose, int* newMaster);
+
         /**
          * Add array of hosts to host list. Doesn't do anything if hosts are
          * already in host list.
@@ -330,6 +375,16 @@ namespace mongo {
         bool _checkConnection( DBClientConnection* conn, string& maybePrimary,
                 bool verbose, int nodesOffset );
 
+        /**
+         * Applies an isMaster reply obtained from conn to _nodes[nodesOffset] and adds
+         * the hosts it lists, as _checkConnection does once its command returned.
+         *
+         * @param commandTime how long the isMaster command took, in millis
+         * @return true if the reply is from the primary of this set
+         */
+        bool _applyIsMaster( DBClientConnection* conn, const BSONObj& o, int commandTime,
+                string& maybePrimary, bool verbose, int nodesOffset );
+
         /**
          * Save the seed list for the current set into the _seedServers map
          * Should only be called if you're already holding _setsLock and this
@@ -371,15 +426,20 @@ namespace mongo {
         mutable mongo::mutex _lock;
 
         /**
-         * "Synchronizes" the _checkConnection method. Should ideally be one mutex per
-         * connection object being used. The purpose of this lock is to make sure that
-         * the reply from the connection the lock holder got is the actual response
-         * to what it sent.
+         * Serializes applying isMaster replies to the host list (_applyIsMaster). The
+         * isMaster commands themselves run without it: every member connection is only
+         * used by the single thread running _check (see _refresh).
          *
          * Deadlock WARNING: never acquire this while holding _lock
          */
         mutable mongo::mutex  _checkConnectionLock;
 
+        // true while a thread is running _check through _refresh (protected by _lock)
+        bool _refreshing;
+        // bumped each time a refresh ends, signalled on _refreshDone (protected by _lock)
+        unsigned long long _refreshGeneration;
+        boost::condition _refreshDone;
+
         string _name;
 
         /**
@@ -395,6 +455,12 @@ namespace mongo {
         // The number of consecutive times the set has been checked and every member in the set was down.
         int _failedChecks;
 
+        // How long recent secondary reads took, in microseconds, kept as a ring of at most
+        // kSecondaryReadSamples (protected by _lock)
+        static const size_t kSecondaryReadSamples;
+        std::vector<long long> _secondaryReadMicros;
+        size_t _nextSecondaryRead;
+
         static mongo::mutex _setsLock; // protects _seedServers and _sets
 
         // set name to seed list.
@@ -531,6 +597,21 @@ namespace mongo {
                                       const BSONObj& queryObj,
                                       int queryOptions );
 
+        /**
+         * Hedged reads: a nearest or secondaryPreferred query sent to a secondary with say()
+         * that is still unanswered after the hedgedReadsPercentile of the set's recent secondary
+         * reads (and at least hedgedReadsMinDelayMillis) is sent to a second eligible secondary
+         * as well. recv() returns whichever answer comes first, and closes the connection of
+         * the other, which abandons its query. Off unless hedgedReads is set.
+         */
+        static bool hedgedReads;
+        static int hedgedReadsPercentile;
+        static int hedgedReadsMinDelayMillis;
+
+        // second requests sent, and how many of them were answered first
+        static Counter64 hedgedReadsSent;
+        static Counter64 hedgedReadsWon;
+
     protected:
         /** Authorize.  Authorizes all nodes as needed
         */
@@ -577,6 +658,13 @@ namespace mongo {
 
         void _auth( DBClientConnection * conn );
 
+        /**
+         * Waits for the answer to the query sent last, and sends it to a second secondary if it
+         * takes longer than the hedging delay.  If the second one answers first, it becomes the
+         * last slaveOk connection and the first is closed.
+         */
+        void _hedgeRead();
+
         /**
          * Maximum number of retries to make for auto-retry logic when performing a slave ok
          * operation.
@@ -619,12 +707,19 @@ namespace mongo {
         class LazyState {
         public:
             LazyState() :
-                _lastClient( NULL ), _lastOp( -1 ), _secondaryQueryOk( false ), _retries( 0 ) {}
+                _lastClient( NULL ), _lastOp( -1 ), _secondaryQueryOk( false ), _retries( 0 ),
+                _sentMicros( 0 ) {}
             DBClientConnection* _lastClient;
             int _lastOp;
             bool _secondaryQueryOk;
             int _retries;
 
+            // with hedged reads on: when a secondary read was sent, and for one that may be
+            // hedged, its read preference and a copy of the message (empty otherwise)
+            unsigned long long _sentMicros;
+            boost::shared_ptr<ReadPreferenceSetting> _hedgeReadPref;
+            std::string _hedgeMessage;
+
         } _lazyState;
 
     };
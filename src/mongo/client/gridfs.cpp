@@ -21,6 +21,7 @@
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/smart_ptr.hpp>
+#include <boost/thread/thread.hpp>
 #include <fcntl.h>
 #include <fstream>
 #include <utility>
@@ -30,6 +31,7 @@
 #endif
 
 #include "mongo/client/dbclientcursor.h"
+#include "mongo/util/queue.h"
 
 #ifndef MIN
 #define MIN(a,b) ( (a) < (b) ? (a) : (b) )
@@ -40,6 +42,189 @@ namespace mongo {
 
     const unsigned DEFAULT_CHUNK_SIZE = 256 * 1024;
 
+    // most chunk data sent in one insert message
+    const int MAX_INSERT_BATCH_BYTES = 16 * 1024 * 1024;
+
+    namespace {
+
+        /**
+         * Inserts the chunks of a file being stored. With more than one chunk in flight, a
+         * second thread sends them, batching the chunks queued meanwhile into one insert,
+         * so that reading the file and sending it overlap.
+         */
+        class ChunkInserter : boost::noncopyable {
+        public:
+            ChunkInserter( DBClientBase& client , const string& ns , unsigned maxInFlight )
+                : _client( client ) , _ns( ns ) , _queue( maxInFlight + 1 ) ,
+                  _errorMutex( "GridFS chunk inserter" ) , _failed( false ) {
+                if ( maxInFlight > 1 ) {
+                    _thread.reset( new boost::thread( boost::bind( &ChunkInserter::_run ,
+                                                                   this ) ) );
+                }
+            }
+
+            ~ChunkInserter() {
+                if ( _thread ) {
+                    // storing the file failed before finish, the thread still drains the queue
+                    _queue.push( BSONObj() );
+                    _thread->join();
+                }
+            }
+
+            void add( const BSONObj& chunk ) {
+                if ( ! _thread ) {
+                    _client.insert( _ns , chunk );
+                    return;
+                }
+
+                _checkError();
+                _queue.push( chunk );
+            }
+
+            /**
+             * Waits for the queued chunks to be sent.
+             */
+            void finish() {
+                if ( ! _thread )
+                    return;
+
+                _queue.push( BSONObj() );
+                _thread->join();
+                _thread.reset();
+                _checkError();
+            }
+
+        private:
+            void _run() {
+                bool done = false;
+                while ( ! done ) {
+                    vector<BSONObj> batch;
+                    int batchBytes = 0;
+                    BSONObj chunk = _queue.blockingPop();
+                    while ( true ) {
+                        // an empty object marks the end of the file
+                        if ( chunk.isEmpty() ) {
+                            done = true;
+                            break;
+                        }
+
+                        batch.push_back( chunk );
+                        batchBytes += chunk.objsize();
+                        if ( batchBytes >= MAX_INSERT_BATCH_BYTES || ! _queue.tryPop( chunk ) )
+                            break;
+                    }
+
+                    if ( batch.empty() )
+                        continue;
+
+                    {
+                        scoped_lock lk( _errorMutex );
+                        if ( _failed )
+                            continue;
+                    }
+
+                    try {
+                        _client.insert( _ns , batch );
+                    }
+                    catch ( const std::exception& e ) {
+                        scoped_lock lk( _errorMutex );
+                        _failed = true;
+                        _error = e.what();
+                    }
+                }
+            }
+
+            void _checkError() {
+                scoped_lock lk( _errorMutex );
+                uassert( 17380 , "error inserting GridFS chunks: " + _error , ! _failed );
+            }
+
+            DBClientBase& _client;
+            const string _ns;
+            BlockingQueue<BSONObj> _queue;
+            boost::scoped_ptr<boost::thread> _thread;
+
+            mongo::mutex _errorMutex; // protects _failed, _error
+            bool _failed;
+            string _error;
+        };
+
+    } // namespace
+
+    /**
+     * Runs the query for the chunks of a file on a second thread, keeping a bounded number
+     * of them fetched ahead of the ones GridFileReader consumed.
+     */
+    class GridFileFetcher : boost::noncopyable {
+    public:
+        GridFileFetcher( DBClientBase& client , const string& ns , const BSONObj& query ,
+                         unsigned maxInFlight )
+            : _queue( maxInFlight + 1 ) , _mutex( "GridFileFetcher" ) , _stop( false ) ,
+              _failed( false ) {
+            _thread.reset( new boost::thread( boost::bind( &GridFileFetcher::_run , this ,
+                                                           boost::ref( client ) , ns ,
+                                                           query ) ) );
+        }
+
+        ~GridFileFetcher() {
+            {
+                scoped_lock lk( _mutex );
+                _stop = true;
+            }
+
+            // make room in case the thread waits to queue a chunk
+            while ( ! _thread->timed_join( boost::posix_time::milliseconds( 10 ) ) ) {
+                BSONObj discarded;
+                _queue.tryPop( discarded );
+            }
+        }
+
+        /**
+         * @return the next chunk fetched, empty after the last one
+         */
+        BSONObj next() {
+            BSONObj chunk = _queue.blockingPop();
+            if ( chunk.isEmpty() ) {
+                scoped_lock lk( _mutex );
+                uassert( 17381 , "error reading GridFS chunks: " + _error , ! _failed );
+            }
+            return chunk;
+        }
+
+    private:
+        void _run( DBClientBase& client , const string& ns , const BSONObj& query ) {
+            try {
+                auto_ptr<DBClientCursor> cursor = client.query( ns , query );
+                uassert( 17382 , "could not query GridFS chunks from " + ns , cursor.get() );
+
+                while ( cursor->more() ) {
+                    BSONObj chunk = cursor->nextSafe().getOwned();
+                    {
+                        scoped_lock lk( _mutex );
+                        if ( _stop )
+                            return;
+                    }
+                    _queue.push( chunk );
+                }
+            }
+            catch ( const std::exception& e ) {
+                scoped_lock lk( _mutex );
+                _failed = true;
+                _error = e.what();
+            }
+
+            _queue.push( BSONObj() );
+        }
+
+        BlockingQueue<BSONObj> _queue;
+        boost::scoped_ptr<boost::thread> _thread;
+
+        mongo::mutex _mutex; // protects _stop, _failed, _error
+        bool _stop;
+        bool _failed;
+        string _error;
+    };
+
     GridFSChunk::GridFSChunk( BSONObj o ) {
         _data = o;
     }
@@ -57,6 +242,7 @@ namespace mongo {
         _filesNS = dbName + "." + prefix + ".files";
         _chunksNS = dbName + "." + prefix + ".chunks";
         _chunkSize = DEFAULT_CHUNK_SIZE;
+        _maxChunksInFlight = 1;
 
         client.ensureIndex( _filesNS , BSON( "filename" << 1 ) );
         client.ensureIndex( _chunksNS , BSON( "files_id" << 1 << "n" << 1 ) , /*unique=*/true );
@@ -75,6 +261,14 @@ namespace mongo {
         return _chunkSize;
     }
 
+    void GridFS::setMaxChunksInFlight(unsigned int n) {
+        _maxChunksInFlight = std::max(n, 1U);
+    }
+
+    unsigned int GridFS::getMaxChunksInFlight() const {
+        return _maxChunksInFlight;
+    }
+
     BSONObj GridFS::storeFile( const char* data , size_t length , const string& remoteName , const string& contentType) {
         char const * const end = data + length;
 
@@ -82,15 +276,17 @@ namespace mongo {
         id.init();
         BSONObj idObj = BSON("_id" << id);
 
+        ChunkInserter inserter( _client , _chunksNS , _maxChunksInFlight );
         int chunkNumber = 0;
         while (data < end) {
             int chunkLen = MIN(_chunkSize, (unsigned)(end-data));
             GridFSChunk c(idObj, chunkNumber, data, chunkLen);
-            _client.insert( _chunksNS.c_str() , c._data );
+            inserter.add( c._data );
 
             chunkNumber++;
             data += chunkLen;
         }
+        inserter.finish();
 
         return insertFile(remoteName, id, length, contentType);
     }
@@ -110,6 +306,7 @@ namespace mongo {
         id.init();
         BSONObj idObj = BSON("_id" << id);
 
+        ChunkInserter inserter( _client , _chunksNS , _maxChunksInFlight );
         int chunkNumber = 0;
         gridfs_offset length = 0;
         while (!feof(fd)) {
@@ -126,16 +323,18 @@ namespace mongo {
             }
 
             GridFSChunk c(idObj, chunkNumber, buf, chunkLen);
-            _client.insert( _chunksNS.c_str() , c._data );
+            delete[] buf;
+            inserter.add( c._data );
 
             length += chunkLen;
             chunkNumber++;
-            delete[] buf;
         }
 
         if (fd != stdin)
             fclose( fd );
 
+        inserter.finish();
+
         return insertFile((remoteName.empty() ? fileName : remoteName), id, length, contentType);
     }
 
@@ -228,13 +427,10 @@ namespace mongo {
     }
 
     gridfs_offset GridFile::write( ostream & out ) const {
-        _exists();
-
-        const int num = getNumChunks();
-
-        for ( int i=0; i<num; i++ ) {
-            GridFSChunk c = getChunk( i );
+        GridFileReader reader( *this );
+        GridFSChunk c( (BSONObj()) );
 
+        while ( reader.nextChunk( &c ) ) {
             int len;
             const char * data = c.data( len );
             out.write( data , len );
@@ -258,4 +454,75 @@ namespace mongo {
         uassert( 10015 ,  "doesn't exists" , exists() );
     }
 
+    GridFileReader::GridFileReader( const GridFile& file )
+        : _file( file ) , _numChunks( 0 ) , _nextChunkNum( 0 ) , _pos( NULL ) , _left( 0 ) {
+        _file._exists();
+        _numChunks = _file.getNumChunks();
+        if ( _numChunks == 0 )
+            return;
+
+        BSONObjBuilder b;
+        b.appendAs( _file._obj["_id"] , "files_id" );
+        BSONObj query = Query( b.obj() ).sort( BSON( "n" << 1 ) ).obj;
+
+        const GridFS* grid = _file._grid;
+        if ( grid->_maxChunksInFlight > 1 ) {
+            _fetcher.reset( new GridFileFetcher( grid->_client , grid->_chunksNS , query ,
+                                                 grid->_maxChunksInFlight ) );
+        }
+        else {
+            _cursor = grid->_client.query( grid->_chunksNS , query );
+            uassert( 17396 , "could not query GridFS chunks from " + grid->_chunksNS ,
+                     _cursor.get() );
+        }
+    }
+
+    GridFileReader::~GridFileReader() {
+    }
+
+    BSONObj GridFileReader::_nextChunkObj() {
+        BSONObj chunk;
+        if ( _fetcher )
+            chunk = _fetcher->next();
+        else if ( _cursor->more() )
+            chunk = _cursor->nextSafe().getOwned();
+
+        uassert( 17383 ,
+                 str::stream() << "missing chunk " << _nextChunkNum << " of GridFS file "
+                               << _file.getFilename() ,
+                 ! chunk.isEmpty() && chunk["n"].numberInt() == _nextChunkNum );
+        _nextChunkNum++;
+        return chunk;
+    }
+
+    bool GridFileReader::nextChunk( GridFSChunk* chunk ) {
+        if ( _nextChunkNum >= _numChunks )
+            return false;
+
+        *chunk = GridFSChunk( _nextChunkObj() );
+        _left = 0;
+        return true;
+    }
+
+    int GridFileReader::read( char* buf , int len ) {
+        int copied = 0;
+        while ( copied < len ) {
+            if ( _left == 0 ) {
+                if ( _nextChunkNum >= _numChunks )
+                    break;
+
+                _current = _nextChunkObj();
+                _pos = _current["data"].binDataClean( _left );
+                continue;
+            }
+
+            int n = MIN( _left , len - copied );
+            memcpy( buf + copied , _pos , n );
+            copied += n;
+            _pos += n;
+            _left -= n;
+        }
+        return copied;
+    }
+
 }
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <boost/scoped_ptr.hpp>
+
 #include "mongo/bson/bsonelement.h"
 #include "mongo/bson/bsonobj.h"
 #include "mongo/client/dbclientinterface.h"
@@ -27,6 +29,7 @@ namespace mongo {
 
     class GridFS;
     class GridFile;
+    class GridFileFetcher;
 
     class GridFSChunk {
     public:
@@ -70,6 +73,16 @@ namespace mongo {
 
         unsigned int getChunkSize() const;
 
+        /**
+         * Sets how many chunks storeFile may have read ahead of the ones inserted, and
+         * reading a GridFile may have fetched ahead of the ones consumed. Above 1 (the
+         * default), the chunks are inserted or fetched by a second thread using the
+         * client connection, so the client must be usable from another thread, which
+         * DBDirectClient is not, and must not be used while the transfer runs.
+         */
+        void setMaxChunksInFlight(unsigned int n);
+        unsigned int getMaxChunksInFlight() const;
+
         /**
          * puts the file reference by fileName into the db
          * @param fileName local filename relative to process
@@ -126,11 +139,13 @@ namespace mongo {
         string _filesNS;
         string _chunksNS;
         unsigned int _chunkSize;
+        unsigned int _maxChunksInFlight;
 
         // insert fileobject. All chunks must be in DB.
         BSONObj insertFile(const string& name, const OID& id, gridfs_offset length, const string& contentType);
 
         friend class GridFile;
+        friend class GridFileReader;
     };
 
     /**
@@ -201,5 +216,47 @@ namespace mongo {
         BSONObj        _obj;
 
         friend class GridFS;
+        friend class GridFileReader;
     };
+    /**
+       streams the content of a GridFile in order
+
+       The chunks are read with a single cursor rather than one query each. With
+       GridFS::setMaxChunksInFlight above 1, they are fetched ahead of the reads on
+       another thread.
+     */
+    class GridFileReader : boost::noncopyable {
+    public:
+        explicit GridFileReader( const GridFile& file );
+        ~GridFileReader();
+
+        /**
+         * copies up to len bytes of the file into buf
+         * @return the number of bytes copied, 0 at the end of the file
+         */
+        int read( char* buf , int len );
+
+        /**
+         * @return false at the end of the file, otherwise sets chunk to the next chunk
+         */
+        bool nextChunk( GridFSChunk* chunk );
+
+    private:
+        BSONObj _nextChunkObj();
+
+        GridFile _file;
+        int _numChunks;
+        int _nextChunkNum;
+
+        // used when reading from this thread
+        auto_ptr<DBClientCursor> _cursor;
+        // used when reading ahead
+        boost::scoped_ptr<GridFileFetcher> _fetcher;
+
+        // what read has not returned yet of the current chunk
+        BSONObj _current;
+        const char* _pos;
+        int _left;
+    };
+
 }
@@ -807,6 +807,32 @@ namespace mongo {
         }
     }
     
+    /**
+     * The query to send 'shard': the spec's own, unless its filter has a shard key $in with
+     * values that can only match on other shards.
+     */
+    static BSONObj queryForShard( const QuerySpec& qSpec,
+                                  const ChunkManagerPtr& manager,
+                                  const Shard& shard ) {
+        BSONObj restricted;
+        if ( ! manager || ! manager->restrictInToShard( qSpec.filter(), shard, &restricted ) )
+            return qSpec.query();
+
+        bool hasDollar;
+        if ( ! Query::isComplex( qSpec.query(), &hasDollar ) )
+            return restricted;
+
+        const char* filterField = hasDollar ? "$query" : "query";
+        BSONObjBuilder b;
+        BSONForEach( e, qSpec.query() ) {
+            if ( str::equals( e.fieldName(), filterField ) )
+                b.append( filterField, restricted );
+            else
+                b.append( e );
+        }
+        return b.obj();
+    }
+
     void ParallelSortClusteredCursor::startInit() {
 
         bool returnPartial = ( _qSpec.options() & QueryOption_PartialResults );
@@ -946,7 +972,9 @@ namespace mongo {
                     // or if the number of shards to query is > 1
                     if( ( isVersioned() && ! primary ) || _qShards.size() > 1 ){
 
-                        state->cursor.reset( new DBClientCursor( state->conn->get(), ns, _qSpec.query(),
+                        BSONObj query = isCommand() ? _qSpec.query() :
+                                                      queryForShard( _qSpec, manager, shard );
+                        state->cursor.reset( new DBClientCursor( state->conn->get(), ns, query,
                                                                  isCommand() ? 1 : 0, // nToReturn (0 if query indicates multi)
                                                                  0, // nToSkip
                                                                  // Does this need to be a ptr?
@@ -1707,7 +1735,8 @@ namespace mongo {
     // -----------------
 
     Future::CommandResult::CommandResult( const string& server , const string& db , const BSONObj& cmd , int options , DBClientBase * conn )
-        :_server(server) ,_db(db) , _options(options), _cmd(cmd) ,_conn(conn) ,_done(false)
+        :_server(server) ,_db(db) , _options(options), _cmd(cmd) ,_conn(conn) ,_done(false),
+         _millis(0)
     {
         init();
     }
@@ -1727,12 +1756,14 @@ namespace mongo {
             else {
                 _done = true; // we set _done first because even if there is an error we're done
                 _ok = _conn->runCommand( _db , _cmd , _res , _options );
+                _millis = _timer.millis();
             }
         }
         catch ( std::exception& e ) {
             error() << "Future::spawnCommand (part 1) exception: " << e.what() << endl;
             _ok = false;
             _done = true;
+            _millis = _timer.millis();
         }
     }
 
@@ -1806,6 +1837,7 @@ namespace mongo {
         }
 
         _done = true;
+        _millis = _timer.millis();
         return _ok;
     }
 
@@ -27,6 +27,7 @@
 #include "mongo/s/shard.h"
 #include "mongo/s/stale_exception.h"  // for StaleConfigException
 #include "mongo/util/concurrency/mvar.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -430,6 +431,12 @@ namespace mongo {
                 return _res;
             }
 
+            /** milliseconds from spawning the command until its reply (or failure) came back */
+            int millis() const {
+                verify( _done );
+                return _millis;
+            }
+
             /**
                blocks until command is done
                returns ok()
@@ -454,6 +461,9 @@ namespace mongo {
             bool _ok;
             bool _done;
 
+            Timer _timer;
+            int _millis;
+
             friend class Future;
         };
 
@@ -35,6 +35,7 @@
  */
 
 using boost::scoped_ptr;
+using mongo::BSONObj;
 using mongo::DBClientBase;
 using mongo::FailPoint;
 using mongo::ScopedDbConnection;
@@ -218,6 +219,10 @@ namespace mongo_test {
             delete _dummyServer;
 
             mongo::PoolForHost::setMaxPerHost(_maxPoolSizePerHost);
+            mongo::PoolForHost::maxInUsePerHost = 0;
+            mongo::PoolForHost::maxWaitTimeMillis = 30 * 1000;
+            mongo::PoolForHost::idleTimeoutSecs = 0;
+            mongo::PoolForHost::minIdlePerHost = 0;
         }
 
     protected:
@@ -271,6 +276,18 @@ namespace mongo_test {
             }
         }
 
+        static void releaseAfter(ScopedDbConnection* conn, int millis) {
+            mongo::sleepmillis(millis);
+            conn->done();
+            delete conn;
+        }
+
+        static BSONObj getPoolStats() {
+            mongo::BSONObjBuilder builder;
+            mongo::pool.appendInfo(builder);
+            return builder.obj();
+        }
+
     private:
         static void runServer(mongo::MessageServer* server) {
             server->setupSockets();
@@ -402,4 +419,75 @@ namespace mongo_test {
 
         conn1Again.done();
     }
+
+    TEST_F(DummyServerFixture, MaxInUseTimesOut) {
+        mongo::PoolForHost::maxInUsePerHost = 2;
+        mongo::PoolForHost::maxWaitTimeMillis = 100;
+
+        ScopedDbConnection conn1(TARGET_HOST);
+        ScopedDbConnection conn2(TARGET_HOST);
+        ASSERT_THROWS(ScopedDbConnection conn3(TARGET_HOST), mongo::UserException);
+
+        BSONObj stats = getPoolStats();
+        ASSERT_EQUALS(2, stats["totalInUse"].numberInt());
+        ASSERT_EQUALS(1, stats["totalNumWaitTimeouts"].numberLong());
+
+        // a connection given back makes room again
+        DBClientBase* conn1Ptr = conn1.get();
+        conn1.done();
+        ScopedDbConnection conn3(TARGET_HOST);
+        ASSERT_EQUALS(conn1Ptr, conn3.get());
+
+        // and so does one that gets killed
+        conn2.kill();
+        ScopedDbConnection conn4(TARGET_HOST);
+
+        conn3.done();
+        conn4.done();
+        ASSERT_EQUALS(0, getPoolStats()["totalInUse"].numberInt());
+    }
+
+    TEST_F(DummyServerFixture, MaxInUseWaitsForRelease) {
+        mongo::PoolForHost::maxInUsePerHost = 1;
+        mongo::PoolForHost::maxWaitTimeMillis = 30 * 1000;
+
+        ScopedDbConnection* conn1 = new ScopedDbConnection(TARGET_HOST);
+        DBClientBase* conn1Ptr = conn1->get();
+        boost::thread releaser(boost::bind(&releaseAfter, conn1, 200));
+
+        ScopedDbConnection conn2(TARGET_HOST);
+        releaser.join();
+        ASSERT_EQUALS(conn1Ptr, conn2.get());
+        conn2.done();
+
+        BSONObj stats = getPoolStats();
+        ASSERT_EQUALS(1, stats["totalNumWaits"].numberLong());
+        ASSERT_EQUALS(0, stats["totalNumWaitTimeouts"].numberLong());
+        ASSERT_GREATER_THAN(stats["totalWaitTimeMillis"].numberLong(), 100);
+    }
+
+    TEST_F(DummyServerFixture, IdleConnectionsPruned) {
+        mongo::PoolForHost::idleTimeoutSecs = 1;
+        mongo::PoolForHost::minIdlePerHost = 1;
+
+        ScopedDbConnection conn1(TARGET_HOST);
+        ScopedDbConnection conn2(TARGET_HOST);
+        ScopedDbConnection conn3(TARGET_HOST);
+        DBClientBase* conn3Ptr = conn3.get();
+        conn1.done();
+        conn2.done();
+        conn3.done();
+
+        mongo::pool.taskDoWork();
+        ASSERT_EQUALS(3, getPoolStats()["totalAvailable"].numberInt());
+
+        mongo::sleepsecs(2);
+        mongo::pool.taskDoWork();
+        ASSERT_EQUALS(1, getPoolStats()["totalAvailable"].numberInt());
+
+        // the most recently used connection is the one kept
+        ScopedDbConnection conn4(TARGET_HOST);
+        ASSERT_EQUALS(conn3Ptr, conn4.get());
+        conn4.done();
+    }
 }
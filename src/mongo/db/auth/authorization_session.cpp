@@ -84,6 +84,7 @@ namespace {
         if (replacedUser) {
             getAuthorizationManager().releaseUser(replacedUser);
         }
+        _invalidateCachedActions();
 
         return Status::OK();
     }
@@ -101,6 +102,7 @@ namespace {
         if (removedUser) {
             getAuthorizationManager().releaseUser(removedUser);
         }
+        _invalidateCachedActions();
     }
 
     UserSet::NameIterator AuthorizationSession::getAuthenticatedUserNames() {
@@ -121,6 +123,7 @@ namespace {
 
     void AuthorizationSession::grantInternalAuthorization() {
         _authenticatedUsers.add(internalSecurity.user);
+        _invalidateCachedActions();
     }
 
     Status AuthorizationSession::checkAuthForQuery(const NamespaceString& ns,
@@ -275,22 +278,44 @@ namespace {
 
     bool AuthorizationSession::isAuthorizedForActionsOnResource(const ResourcePattern& resource,
                                                                 ActionType action) {
+        if (resource.isExactNamespacePattern()) {
+            return isAuthorizedForActionsOnNamespace(resource.ns(), action);
+        }
         return isAuthorizedForPrivilege(Privilege(resource, action));
     }
 
     bool AuthorizationSession::isAuthorizedForActionsOnResource(const ResourcePattern& resource,
                                                                 const ActionSet& actions) {
+        if (resource.isExactNamespacePattern()) {
+            return isAuthorizedForActionsOnNamespace(resource.ns(), actions);
+        }
         return isAuthorizedForPrivilege(Privilege(resource, actions));
     }
 
     bool AuthorizationSession::isAuthorizedForActionsOnNamespace(const NamespaceString& ns,
                                                                  ActionType action) {
-        return isAuthorizedForPrivilege(Privilege(ResourcePattern::forExactNamespace(ns), action));
+        if (_externalState->shouldIgnoreAuthChecks())
+            return true;
+
+        ActionSet userActions;
+        if (!_getActionsOnNamespace(ns, &userActions)) {
+            return _isAuthorizedForPrivilege(
+                    Privilege(ResourcePattern::forExactNamespace(ns), action));
+        }
+        return userActions.contains(action);
     }
 
     bool AuthorizationSession::isAuthorizedForActionsOnNamespace(const NamespaceString& ns,
                                                                 const ActionSet& actions) {
-        return isAuthorizedForPrivilege(Privilege(ResourcePattern::forExactNamespace(ns), actions));
+        if (_externalState->shouldIgnoreAuthChecks())
+            return true;
+
+        ActionSet userActions;
+        if (!_getActionsOnNamespace(ns, &userActions)) {
+            return _isAuthorizedForPrivilege(
+                    Privilege(ResourcePattern::forExactNamespace(ns), actions));
+        }
+        return userActions.isSupersetOf(actions);
     }
 
     static const int resourceSearchListCapacity = 5;
@@ -403,6 +428,7 @@ namespace {
                     // Success! Replace the old User object with the updated one.
                     fassert(17067, _authenticatedUsers.replaceAt(it, updatedUser) == user);
                     authMan.releaseUser(user);
+                    _invalidateCachedActions();
                     LOG(1) << "Updated session cache of user information for " << name;
                     break;
                 }
@@ -410,6 +436,7 @@ namespace {
                     // User does not exist anymore; remove it from _authenticatedUsers.
                     fassert(17068, _authenticatedUsers.removeAt(it) == user);
                     authMan.releaseUser(user);
+                    _invalidateCachedActions();
                     log() << "Removed deleted user " << name <<
                         " from session cache of user information.";
                     continue;  // No need to advance "it" in this case.
@@ -452,6 +479,7 @@ namespace {
                     if (user != updatedUser) {
                         LOG(1) << "Updated session cache for V1 user " << name;
                         fassert(17226, _authenticatedUsers.replaceAt(it, updatedUser) == user);
+                        _invalidateCachedActions();
                     }
                     getAuthorizationManager().releaseUser(user);
                     user = updatedUser;
@@ -475,4 +503,48 @@ namespace {
         return false;
     }
 
+    // A session touching more namespaces than this starts over.
+    static const size_t maxCachedNamespaces = 256;
+
+    bool AuthorizationSession::_getActionsOnNamespace(const NamespaceString& ns,
+                                                      ActionSet* actionsOut) {
+        NamespaceActionsMap::const_iterator cached = _namespaceActions.find(ns.ns());
+        if (cached != _namespaceActions.end()) {
+            *actionsOut = cached->second;
+            return true;
+        }
+
+        for (UserSet::iterator it = _authenticatedUsers.begin();
+                it != _authenticatedUsers.end(); ++it) {
+            User* user = *it;
+            if (user->getSchemaVersion() == AuthorizationManager::schemaVersion24 &&
+                !user->hasProbedV1(ns.db())) {
+                return false;
+            }
+        }
+
+        ResourcePattern resourceSearchList[resourceSearchListCapacity];
+        const int resourceSearchListLength = buildResourceSearchList(
+                ResourcePattern::forExactNamespace(ns), resourceSearchList);
+
+        ActionSet actions;
+        for (UserSet::iterator it = _authenticatedUsers.begin();
+                it != _authenticatedUsers.end(); ++it) {
+            for (int i = 0; i < resourceSearchListLength; ++i) {
+                actions.addAllActionsFromSet((*it)->getActionsForResource(resourceSearchList[i]));
+            }
+        }
+
+        if (_namespaceActions.size() >= maxCachedNamespaces) {
+            _namespaceActions.clear();
+        }
+        _namespaceActions[ns.ns()] = actions;
+        *actionsOut = actions;
+        return true;
+    }
+
+    void AuthorizationSession::_invalidateCachedActions() {
+        _namespaceActions.clear();
+    }
+
 } // namespace mongo
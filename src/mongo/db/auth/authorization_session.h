@@ -41,6 +41,7 @@
 #include "mongo/db/auth/user_name.h"
 #include "mongo/db/auth/user_set.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/platform/unordered_map.h"
 
 namespace mongo {
 
@@ -191,10 +192,27 @@ namespace mongo {
         // lock on the admin database (to update out-of-date user privilege information).
         bool _isAuthorizedForPrivilege(const Privilege& privilege);
 
+        // Returns in *actionsOut all the actions the authenticated users may take on 'ns', from
+        // _namespaceActions if it's there.  Returns false if V1 users have yet to be probed for
+        // the privileges they have on the namespace's database, which only
+        // _isAuthorizedForPrivilege() does.
+        bool _getActionsOnNamespace(const NamespaceString& ns, ActionSet* actionsOut);
+
+        // Forgets what was worked out from the users in _authenticatedUsers.  Called whenever a
+        // user is added, removed or replaced.
+        void _invalidateCachedActions();
+
         scoped_ptr<AuthzSessionExternalState> _externalState;
 
         // All Users who have been authenticated on this connection
         UserSet _authenticatedUsers;
+
+        // The actions the Users in _authenticatedUsers may take on each namespace checked
+        // lately, so that checking one again is a single lookup.  A User's privileges never
+        // change; when the AuthorizationManager's users are out of date it marks them invalid,
+        // and _refreshUserInfoAsNeeded() replaces them here, which empties this.
+        typedef unordered_map<std::string, ActionSet> NamespaceActionsMap;
+        NamespaceActionsMap _namespaceActions;
     };
 
 } // namespace mongo
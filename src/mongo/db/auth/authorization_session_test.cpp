@@ -375,6 +375,56 @@ namespace {
         ASSERT_FALSE(authzSession->lookupUser(UserName("spencer", "test")));
     }
 
+    TEST_F(AuthorizationSessionTest, NamespaceChecksFollowUserChanges) {
+        const NamespaceString testFoo("test.foo");
+        ASSERT_FALSE(authzSession->isAuthorizedForActionsOnNamespace(testFoo, ActionType::find));
+
+        ASSERT_OK(managerState->insertPrivilegeDocument("admin",
+                BSON("user" << "spencer" <<
+                     "db" << "test" <<
+                     "credentials" << BSON("MONGODB-CR" << "a") <<
+                     "roles" << BSON_ARRAY(BSON("role" << "read" <<
+                                                "db" << "test"))),
+                BSONObj()));
+        ASSERT_OK(managerState->insertPrivilegeDocument("admin",
+                BSON("user" << "andy" <<
+                     "db" << "other" <<
+                     "credentials" << BSON("MONGODB-CR" << "a") <<
+                     "roles" << BSON_ARRAY(BSON("role" << "readWriteAnyDatabase" <<
+                                                "db" << "admin"))),
+                BSONObj()));
+
+        // Adding a user counts at once, for namespaces already checked too
+        ASSERT_OK(authzSession->addAndAuthorizeUser(UserName("spencer", "test")));
+        ASSERT_TRUE(authzSession->isAuthorizedForActionsOnNamespace(testFoo, ActionType::find));
+        ASSERT_FALSE(authzSession->isAuthorizedForActionsOnNamespace(testFoo,
+                                                                    ActionType::insert));
+
+        // Actions are granted by any of the users, and by any resource matching the namespace
+        ASSERT_OK(authzSession->addAndAuthorizeUser(UserName("andy", "other")));
+        ActionSet findAndInsert;
+        findAndInsert.addAction(ActionType::find);
+        findAndInsert.addAction(ActionType::insert);
+        ASSERT_TRUE(authzSession->isAuthorizedForActionsOnNamespace(testFoo, findAndInsert));
+        ASSERT_FALSE(authzSession->isAuthorizedForActionsOnNamespace(
+                            NamespaceString("test.system.users"), ActionType::insert));
+
+        authzSession->logoutDatabase("other");
+        ASSERT_FALSE(authzSession->isAuthorizedForActionsOnNamespace(testFoo, findAndInsert));
+        ASSERT_TRUE(authzSession->isAuthorizedForActionsOnNamespace(testFoo, ActionType::find));
+
+        // A user whose privileges changed is noticed at the start of the next request
+        int ignored;
+        managerState->remove(
+                AuthorizationManager::usersCollectionNamespace,
+                BSONObj(),
+                BSONObj(),
+                &ignored);
+        authzManager->invalidateUserByName(UserName("spencer", "test"));
+        authzSession->startRequest();
+        ASSERT_FALSE(authzSession->isAuthorizedForActionsOnNamespace(testFoo, ActionType::find));
+    }
+
     TEST_F(AuthorizationSessionTest, UseOldUserInfoInFaceOfConnectivityProblems) {
         // Add a readWrite user
         ASSERT_OK(managerState->insertPrivilegeDocument("admin",
@@ -33,7 +33,10 @@ namespace mongo {
         _name(name),
         _schemaVersion(AuthorizationManager::schemaVersion26Final),
         _refCount(0),
-        _isValid(1) {}
+        _isValid(1),
+        _memoryUsage(MemoryUsage::kAuthUserCache) {
+        _updateMemoryUsage();
+    }
 
     User::~User() {
         dassert(_refCount == 0);
@@ -78,11 +81,13 @@ namespace mongo {
         result->_probedDatabases = _probedDatabases;
         result->_credentials = _credentials;
         result->_schemaVersion = _schemaVersion;
+        result->_updateMemoryUsage();
         return result.release();
     }
 
     void User::setCredentials(const CredentialData& credentials) {
         _credentials = credentials;
+        _updateMemoryUsage();
     }
 
     void User::setRoles(RoleNameIterator roles) {
@@ -90,6 +95,7 @@ namespace mongo {
         while (roles.more()) {
             _roles.insert(roles.next());
         }
+        _updateMemoryUsage();
     }
 
     void User::setPrivileges(const PrivilegeVector& privileges) {
@@ -98,10 +104,12 @@ namespace mongo {
             const Privilege& privilege = privileges[i];
             _privileges[privilege.getResourcePattern()] = privilege;
         }
+        _updateMemoryUsage();
     }
 
     void User::addRole(const RoleName& roleName) {
         _roles.insert(roleName);
+        _updateMemoryUsage();
     }
 
     void User::addRoles(const std::vector<RoleName>& roles) {
@@ -119,6 +127,7 @@ namespace mongo {
             dassert(it->first == privilegeToAdd.getResourcePattern());
             it->second.addActions(privilegeToAdd.getActions());
         }
+        _updateMemoryUsage();
     }
 
     void User::addPrivileges(const PrivilegeVector& privileges) {
@@ -136,6 +145,7 @@ namespace mongo {
         dassert(_schemaVersion == AuthorizationManager::schemaVersion24);
         if (!hasProbedV1(dbname))
             _probedDatabases.push_back(dbname.toString());
+        _updateMemoryUsage();
     }
 
     bool User::hasProbedV1(const StringData& dbname) const {
@@ -143,6 +153,19 @@ namespace mongo {
         return sequenceContains(_probedDatabases, dbname);
     }
 
+    void User::_updateMemoryUsage() {
+        // hash table nodes cost about two pointers each on top of what they hold
+        const size_t nodeOverhead = 2 * sizeof(void*);
+        size_t bytes = sizeof(User) + _name.getFullName().size() +
+                       _credentials.password.size() +
+                       _privileges.size() * (sizeof(ResourcePattern) + sizeof(Privilege) +
+                                             nodeOverhead) +
+                       _roles.size() * (sizeof(RoleName) + nodeOverhead);
+        for (size_t i = 0; i < _probedDatabases.size(); ++i)
+            bytes += sizeof(std::string) + _probedDatabases[i].size();
+        _memoryUsage.set(bytes);
+    }
+
     void User::invalidate() {
         _isValid.store(0);
     }
@@ -26,6 +26,7 @@
 #include "mongo/platform/atomic_word.h"
 #include "mongo/platform/unordered_map.h"
 #include "mongo/platform/unordered_set.h"
+#include "mongo/util/memory_usage.h"
 
 namespace mongo {
 
@@ -194,6 +195,12 @@ namespace mongo {
 
     private:
 
+        /**
+         * Reports an estimate of the memory held by this user to the memory usage accounting.
+         * Called whenever its roles, privileges or credentials change.
+         */
+        void _updateMemoryUsage();
+
         UserName _name;
 
         // Maps resource name to privilege on that resource
@@ -218,6 +225,8 @@ namespace mongo {
         // meaningfully read by the AuthorizationManager, as _refCount is guarded by the AM's _lock
         uint32_t _refCount;
         AtomicUInt32 _isValid; // Using as a boolean
+
+        MemoryUsageTracker _memoryUsage;
     };
 
 } // namespace mongo
@@ -0,0 +1,122 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/bson_field_index.h"
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    BSONFieldIndex::BSONFieldIndex() : _mask(0) {
+    }
+
+    void BSONFieldIndex::build(const BSONObj& obj) {
+        _obj = obj;
+        _buckets.clear();
+        _mask = 0;
+
+        int numFields = 0;
+        BSONObjIterator countIt(obj);
+        while (countIt.more()) {
+            countIt.next();
+            ++numFields;
+        }
+        if (numFields < kMinFields) {
+            return;
+        }
+
+        // Keep the table at most half full.
+        size_t numBuckets = 1;
+        while (numBuckets < 2U * static_cast<size_t>(numFields)) {
+            numBuckets <<= 1;
+        }
+        _buckets.assign(numBuckets, -1);
+        _mask = numBuckets - 1;
+
+        const char* base = obj.objdata();
+        BSONObjIterator it(obj);
+        while (it.more()) {
+            BSONElement e = it.next();
+            StringData name(e.fieldName(), e.fieldNameSize() - 1);
+            size_t bucket = StringData::Hasher()(name) & _mask;
+            while (-1 != _buckets[bucket]) {
+                // Like getField, the first of several fields with the same name is the one found.
+                BSONElement other(base + _buckets[bucket]);
+                if (name == StringData(other.fieldName(), other.fieldNameSize() - 1)) {
+                    break;
+                }
+                bucket = (bucket + 1) & _mask;
+            }
+            if (-1 == _buckets[bucket]) {
+                _buckets[bucket] = e.rawdata() - base;
+            }
+        }
+    }
+
+    void BSONFieldIndex::clear() {
+        _obj = BSONObj();
+        _buckets.clear();
+        _mask = 0;
+    }
+
+    BSONElement BSONFieldIndex::getField(const StringData& name) const {
+        if (_buckets.empty()) {
+            return _obj.getField(name);
+        }
+
+        const char* base = _obj.objdata();
+        size_t bucket = StringData::Hasher()(name) & _mask;
+        while (-1 != _buckets[bucket]) {
+            BSONElement e(base + _buckets[bucket]);
+            if (name == StringData(e.fieldName(), e.fieldNameSize() - 1)) {
+                return e;
+            }
+            bucket = (bucket + 1) & _mask;
+        }
+        return BSONElement();
+    }
+
+    BSONElement BSONFieldIndex::getFieldDotted(const StringData& name) const {
+        // As BSONObj::getFieldDotted, but with the top-level lookups hashed.
+        BSONElement e = getField(name);
+        if (e.eoo()) {
+            size_t dot_offset = name.find('.');
+            if (dot_offset != string::npos) {
+                BSONElement left = getField(name.substr(0, dot_offset));
+                if (Object != left.type() && Array != left.type()) {
+                    return BSONElement();
+                }
+                BSONObj sub = left.embeddedObject();
+                return sub.isEmpty() ? BSONElement()
+                                     : sub.getFieldDotted(name.substr(dot_offset + 1));
+            }
+        }
+        return e;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,92 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonelement.h"
+#include "mongo/bson/bsonobj.h"
+
+namespace mongo {
+
+    /**
+     * A hash table from the top-level field names of one BSONObj to the offsets of their
+     * elements, so that looking up many fields of a large document doesn't scan it from the
+     * start each time.  Documents with only a few fields aren't worth hashing and are scanned as
+     * usual.
+     *
+     * The index refers into the object's buffer, which must outlive it and not change.
+     */
+    class BSONFieldIndex {
+        MONGO_DISALLOW_COPYING(BSONFieldIndex);
+    public:
+        BSONFieldIndex();
+
+        /**
+         * Indexes the fields of 'obj', replacing whatever was indexed before.
+         */
+        void build(const BSONObj& obj);
+
+        void clear();
+
+        /**
+         * Whether the index was built for the buffer of 'obj'.
+         */
+        bool isBuiltFor(const BSONObj& obj) const {
+            return !_obj.isEmpty() && obj.objdata() == _obj.objdata()
+                && obj.objsize() == _obj.objsize();
+        }
+
+        /**
+         * Same as getField on the indexed object.
+         */
+        BSONElement getField(const StringData& name) const;
+
+        /**
+         * Same as getFieldDotted on the indexed object.  Only its top-level fields are hashed.
+         */
+        BSONElement getFieldDotted(const StringData& name) const;
+
+        /**
+         * Objects with fewer fields than this are not hashed.
+         */
+        static const int kMinFields = 16;
+
+    private:
+        BSONObj _obj;
+
+        // Offsets into _obj's buffer, or -1 for an empty bucket.  Open addressing with linear
+        // probing.  Empty if _obj has too few fields to hash.
+        std::vector<int> _buckets;
+        size_t _mask;
+    };
+
+}  // namespace mongo
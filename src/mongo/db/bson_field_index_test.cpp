@@ -0,0 +1,95 @@
+/**
+ *    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/db/bson_field_index.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace {
+
+    using mongo::BSONElement;
+    using mongo::BSONFieldIndex;
+    using mongo::BSONObj;
+    using mongo::BSONObjBuilder;
+    using mongo::fromjson;
+
+    namespace str = mongoutils::str;
+
+    void assertSameAsObj(const BSONObj& obj, const BSONFieldIndex& index, const char* name) {
+        BSONElement expected = obj.getFieldDotted(name);
+        BSONElement actual = index.getFieldDotted(name);
+        ASSERT_EQUALS(expected.eoo(), actual.eoo());
+        if (!expected.eoo()) {
+            ASSERT_EQUALS(expected.rawdata(), actual.rawdata());
+        }
+
+        expected = obj.getField(name);
+        actual = index.getField(name);
+        ASSERT_EQUALS(expected.eoo(), actual.eoo());
+        if (!expected.eoo()) {
+            ASSERT_EQUALS(expected.rawdata(), actual.rawdata());
+        }
+    }
+
+    TEST(BSONFieldIndex, ManyFields) {
+        BSONObjBuilder bob;
+        for (int i = 0; i < 200; ++i) {
+            bob.append(std::string(str::stream() << "f" << i), i);
+        }
+        bob.append("sub", fromjson("{a: {b: 1}, c: [1, {d: 2}]}"));
+        bob.append("arr", fromjson("{'0': 5, '1': {x: 6}}"));
+        bob.append("a.b", 7);
+        bob.append("f7", "duplicate");
+        BSONObj obj = bob.obj();
+
+        BSONFieldIndex index;
+        index.build(obj);
+        ASSERT(index.isBuiltFor(obj));
+
+        const char* names[] = { "f0", "f7", "f150", "f199", "f200", "sub", "sub.a", "sub.a.b",
+                                "sub.c", "sub.c.1.d", "sub.x", "arr.1.x", "a.b", "f1.x", "" };
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+            assertSameAsObj(obj, index, names[i]);
+        }
+        ASSERT_EQUALS(7, index.getField("f7").numberInt());
+    }
+
+    TEST(BSONFieldIndex, FewFields) {
+        BSONObj obj = fromjson("{a: 1, b: {c: 2}}");
+        BSONFieldIndex index;
+        index.build(obj);
+        ASSERT(index.isBuiltFor(obj));
+        assertSameAsObj(obj, index, "a");
+        assertSameAsObj(obj, index, "b.c");
+        assertSameAsObj(obj, index, "z");
+    }
+
+    TEST(BSONFieldIndex, BuiltForOneBuffer) {
+        BSONObj obj = fromjson("{a: 1}");
+        BSONObj other = fromjson("{a: 1}");
+        BSONFieldIndex index;
+        ASSERT(!index.isBuiltFor(obj));
+        index.build(obj);
+        ASSERT(index.isBuiltFor(obj));
+        ASSERT(!index.isBuiltFor(other));
+        index.clear();
+        ASSERT(!index.isBuiltFor(obj));
+    }
+
+} // namespace
@@ -46,6 +46,7 @@
 #include "mongo/db/pdfile.h"
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/stats/counters.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/server.h"
 #include "mongo/util/startup_test.h"
 
@@ -755,6 +756,11 @@ namespace mongo {
      */
 
     bool guessIncreasing = false;
+
+    // Bumped whenever a bucket of any btree splits or is freed, as either may leave a
+    // BtreeRightEdge pointing at a bucket which is no longer the right-most one.
+    static AtomicUInt32 btreeShapeEra( 1 );
+
     template< class V >
     bool BtreeBucket<V>::find(const IndexDetails& idx, const Key& key, const DiskLoc &rl, 
                               const Ordering &order, int& pos, bool assertIfDup) const {
@@ -845,6 +851,7 @@ namespace mongo {
 
     template< class V >
     void BtreeBucket<V>::deallocBucket(const DiskLoc thisLoc, const IndexDetails &id) {
+        btreeShapeEra.fetchAndAdd( 1 );
 #if 0
         // as a temporary defensive measure, we zap the whole bucket, AND don't truly delete
         // it (meaning it is ineligible for reuse).
@@ -1370,6 +1377,7 @@ namespace mongo {
     template< class V >
     void BtreeBucket<V>::split(const DiskLoc thisLoc, int keypos, const DiskLoc recordLoc, const Key& key, const Ordering& order, const DiskLoc lchild, const DiskLoc rchild, IndexDetails& idx) {
         this->assertWritable();
+        btreeShapeEra.fetchAndAdd( 1 );
 
         if ( split_debug )
             out() << "    " << thisLoc.toString() << ".split" << endl;
@@ -1514,6 +1522,36 @@ namespace mongo {
         return DiskLoc();
     }
 
+    template< class V >
+    void BtreeBucket<V>::inBucketRun(int keyOfs, int direction, int max, vector<int>* ofs) const {
+        int adj = direction < 0 ? 1 : 0;
+        for ( int i = keyOfs; i >= 0 && i < this->n && static_cast<int>( ofs->size() ) < max; ) {
+            if ( this->k(i).isUsed() )
+                ofs->push_back( i );
+            int ko = i + direction;
+            // same test as advance(): a child in between means leaving the bucket
+            if ( !this->childForPos(ko+adj).isNull() )
+                break;
+            i = ko;
+        }
+    }
+
+    template< class V >
+    DiskLoc BtreeBucket<V>::siblingBucket(const DiskLoc& thisLoc, int direction) const {
+        if ( this->parent.isNull() )
+            return DiskLoc();
+        const BtreeBucket *p = BTREE(this->parent);
+        for ( int i = 0; i <= p->n; i++ ) {
+            if ( p->childForPos(i) == thisLoc ) {
+                int s = i + direction;
+                if ( s < 0 || s > p->n )
+                    return DiskLoc();
+                return p->childForPos(s);
+            }
+        }
+        return DiskLoc();
+    }
+
     template< class V >
     DiskLoc BtreeBucket<V>::locate(const IndexDetails& idx, const DiskLoc& thisLoc, const BSONObj& key, const Ordering &order, int& pos, bool& found, const DiskLoc &recordLoc, int direction) const {
         KeyOwned k(key);
@@ -1825,6 +1863,107 @@ namespace mongo {
         return x;
     }
 
+    template< class V >
+    bool BtreeBucket<V>::coversKey(const DiskLoc thisLoc, const Key& key,
+                                   const DiskLoc recordLoc, const Ordering &order) const {
+        if ( this->n == 0 )
+            return false;
+
+        KeyNode first = keyNode( 0 );
+        int x = key.woCompare( first.key, order );
+        if ( x < 0 || ( x == 0 && recordLoc.compare( first.recordLoc ) <= 0 ) )
+            return false;
+
+        KeyNode last = keyNode( this->n - 1 );
+        x = key.woCompare( last.key, order );
+        if ( x < 0 || ( x == 0 && recordLoc.compare( last.recordLoc ) < 0 ) )
+            return true;
+
+        // past our last key: the bound is the parent key after the first ancestor which is
+        // not its parent's rightmost child
+        DiskLoc loc = thisLoc;
+        const BtreeBucket *b = this;
+        while ( !b->isHead() ) {
+            const BtreeBucket *p = BTREE( b->parent );
+            if ( !( p->nextChild == loc ) ) {
+                KeyNode bound = p->keyNode( b->indexInParent( loc ) );
+                x = key.woCompare( bound.key, order );
+                return x < 0 || ( x == 0 && recordLoc.compare( bound.recordLoc ) < 0 );
+            }
+            loc = b->parent;
+            b = p;
+        }
+        return true;
+    }
+
+    template< class V >
+    void BtreeBucket<V>::bt_insertHinted(const DiskLoc thisLoc, DiskLoc* hint,
+                                         const DiskLoc recordLoc, const BSONObj& _key,
+                                         const Ordering &order, IndexDetails& idx) const {
+        KeyOwned key(_key);
+
+        if ( !hint->isNull() && key.dataSize() <= getKeyMax() ) {
+            const BtreeBucket *b = hint->btree<V>();
+            int bytesNeeded = key.dataSize() + sizeof(_KeyNode);
+            if ( bytesNeeded <= b->emptySize && b->coversKey( *hint, key, recordLoc, order ) ) {
+                int pos;
+                bool found = b->find( idx, key, recordLoc, order, pos, false );
+                if ( !found && b->childForPos( pos ).isNull() ) {
+                    b->insertHere( *hint, pos, recordLoc, key, order, DiskLoc(), DiskLoc(), idx );
+                    return;
+                }
+            }
+        }
+
+        bt_insert( thisLoc, recordLoc, _key, order, true, idx );
+
+        // the root may have changed
+        int pos;
+        bool found;
+        *hint = BTREE( idx.head )->locate( idx, idx.head, key, order, pos, found, recordLoc );
+    }
+
+    template< class V >
+    int BtreeBucket<V>::bt_insertAppend(const DiskLoc thisLoc, BtreeRightEdge* edge,
+                                        const DiskLoc recordLoc, const BSONObj& _key,
+                                        const Ordering &order, bool dupsAllowed,
+                                        IndexDetails& idx) const {
+        bool stale = edge->leaf.isNull() || edge->head != thisLoc ||
+                     edge->era != btreeShapeEra.load();
+
+        if ( !stale ) {
+            // Sorting after the greatest key in the btree, 'key' can't be a duplicate
+            KeyOwned key(_key);
+            const BtreeBucket *leaf = BTREE( edge->leaf );
+            int bytesNeeded = key.dataSize() + sizeof(_KeyNode);
+            if ( leaf->n > 0 &&
+                 key.dataSize() <= getKeyMax() &&
+                 bytesNeeded <= leaf->emptySize &&
+                 key.woCompare( leaf->keyNode( leaf->n - 1 ).key, order ) > 0 ) {
+                leaf->insertHere( edge->leaf, leaf->n, recordLoc, key, order,
+                                  DiskLoc(), DiskLoc(), idx );
+                return 0;
+            }
+        }
+
+        int x = bt_insert( thisLoc, recordLoc, _key, order, dupsAllowed, idx );
+
+        if ( stale || edge->era != btreeShapeEra.load() ) {
+            // the root may have changed too
+            unsigned era = btreeShapeEra.load();
+            DiskLoc loc = idx.head;
+            DiskLoc next = BTREE( loc )->nextChild;
+            while ( !next.isNull() ) {
+                loc = next;
+                next = BTREE( loc )->nextChild;
+            }
+            edge->head = idx.head;
+            edge->leaf = loc;
+            edge->era = era;
+        }
+        return x;
+    }
+
     template< class V >
     void BtreeBucket<V>::shape(stringstream& ss) const {
         this->_shape(0, ss);
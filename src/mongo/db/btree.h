@@ -606,6 +606,19 @@ namespace mongo {
 
     class IndexDetails;
 
+    /**
+     * The right-most leaf of a btree, kept between inserts so that keys sorting after all the
+     * others, as ObjectIds and timestamps do, can be appended to it without descending from the
+     * root.  Good only while the head is the same and no bucket of any btree has been split or
+     * freed since, see BtreeBucket::bt_insertAppend().
+     */
+    struct BtreeRightEdge {
+        BtreeRightEdge() : era( 0 ) { }
+        DiskLoc head;
+        DiskLoc leaf;
+        unsigned era;
+    };
+
     /**
      * This class adds functionality for manipulating buckets that are assembled
      * in a tree.  The requirements for const and non const functions and
@@ -713,6 +726,27 @@ namespace mongo {
                       const BSONObj& key, const Ordering &order, bool dupsAllowed,
                       IndexDetails& idx, bool toplevel = true) const;
 
+        /**
+         * bt_insert() with dups allowed, for runs of keys inserted in ascending index order.
+         * 'hint' is a bucket returned by an earlier call, or null.  When 'key' falls within
+         * the range of the hint bucket and fits in it without a split, it is inserted there
+         * directly instead of descending from the root at thisLoc.  Otherwise it is inserted
+         * as bt_insert() would, and 'hint' is set to the bucket which got it.
+         */
+        void bt_insertHinted(const DiskLoc thisLoc, DiskLoc* hint, const DiskLoc recordLoc,
+                             const BSONObj& key, const Ordering &order,
+                             IndexDetails& idx) const;
+
+        /**
+         * bt_insert() for an index whose keys tend to increase.  If 'edge' still holds the
+         * right-most leaf and 'key' sorts after its last key and fits in it, 'key' is appended
+         * there directly.  Otherwise it is inserted as bt_insert() does, after which 'edge' is
+         * set up again if 'key' went to the end of the btree.
+         */
+        int bt_insertAppend(const DiskLoc thisLoc, BtreeRightEdge* edge, const DiskLoc recordLoc,
+                            const BSONObj& key, const Ordering &order, bool dupsAllowed,
+                            IndexDetails& idx) const;
+
         /**
          * Preconditions:
          *  - 'key' has a valid schema for this index, and may have objsize() > KeyMax.
@@ -751,6 +785,19 @@ namespace mongo {
          */
         DiskLoc advance(const DiskLoc& thisLoc, int& keyOfs, int direction, const char *caller) const;
 
+        /**
+         * The keys advance() steps through from keyOfs without leaving this bucket, i.e. until
+         * it would descend into a child or run off the end.  Offsets of the used ones are
+         * appended to 'ofs', keyOfs itself first, at most 'max' of them.
+         */
+        void inBucketRun(int keyOfs, int direction, int max, vector<int>* ofs) const;
+
+        /**
+         * @return our parent's child on the 'direction' side of us, which a scan reaches after
+         *         the parent key between us, or null if there is none.  Reads the parent.
+         */
+        DiskLoc siblingBucket(const DiskLoc& thisLoc, int direction) const;
+
         /** Advance in specified direction to the specified key */
         void advanceTo(DiskLoc &thisLoc, int &keyOfs, const BSONObj &keyBegin, int keyBeginLen, bool afterKey, const vector< const BSONElement * > &keyEnd, const vector< bool > &keyEndInclusive, const Ordering &order, int direction ) const;
 
@@ -960,6 +1007,13 @@ namespace mongo {
                         const DiskLoc recordLoc, const Key& key, const Ordering &order,
                         const DiskLoc lchild, const DiskLoc rchild, IndexDetails &idx) const;
 
+        /**
+         * @return true if 'key'/'recordLoc' sort after the first key of this bucket and before
+         * the key bounding this bucket's subtree on the right, if any.
+         */
+        bool coversKey(const DiskLoc thisLoc, const Key& key, const DiskLoc recordLoc,
+                       const Ordering &order) const;
+
         /** bt_insert() is basically just a wrapper around this. */
         int _insert(const DiskLoc thisLoc, const DiskLoc recordLoc,
                     const Key& key, const Ordering &order, bool dupsAllowed,
@@ -42,6 +42,7 @@
 #include "mongo/db/json.h"
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/query/runner_yield_policy.h"
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/stats/counters.h"
 
@@ -55,7 +56,8 @@ namespace mongo {
         idx(_idx),
         n(0),
         order( idx.keyPattern() ),
-        ordering( Ordering::make(idx.keyPattern()) ) {
+        ordering( Ordering::make(idx.keyPattern()) ),
+        yieldPolicy(NULL) {
         first = cur = BtreeBucket<V>::addBucket(idx);
         b = cur.btreemod<V>();
         committed = false;
@@ -71,11 +73,20 @@ namespace mongo {
 
     template<class V>
     void BtreeBuilder<V>::mayCommitProgressDurably() {
-        if ( getDur().commitIfNeeded() ) {
+        if ( getDur().commitIfNeeded() || mayYield() ) {
             b = cur.btreemod<V>();
         }
     }
 
+    template<class V>
+    bool BtreeBuilder<V>::mayYield() {
+        if ( yieldPolicy == NULL || !yieldPolicy->shouldYield() )
+            return false;
+        // the private view may be remapped while we don't hold the lock
+        yieldPolicy->yield();
+        return true;
+    }
+
     template<class V>
     void BtreeBuilder<V>::addKey(BSONObj& _key, DiskLoc loc) {
 
@@ -131,7 +142,7 @@ namespace mongo {
             while( !xloc.isNull() ) {
                 killCurrentOp.checkForInterrupt( !mayInterrupt );
 
-                if ( getDur().commitIfNeeded() ) {
+                if ( getDur().commitIfNeeded() || mayYield() ) {
                     b = cur.btreemod<V>();
                     up = upLoc.btreemod<V>();
                 }
@@ -32,6 +32,8 @@
 
 namespace mongo {
 
+    class RunnerYieldPolicy;
+
     /**
      * build btree from the bottom up
      */
@@ -54,9 +56,13 @@ namespace mongo {
         DiskLoc cur, first;
         BtreeBucket<V> *b;
 
+        RunnerYieldPolicy* yieldPolicy;
+
         void newBucket();
         void buildNextLevel(DiskLoc loc, bool mayInterrupt);
         void mayCommitProgressDurably();
+        /** @return true if we yielded, and bucket pointers have to be fetched again */
+        bool mayYield();
 
     public:
         BtreeBuilder(bool _dupsAllowed, IndexDetails& _idx);
@@ -73,6 +79,13 @@ namespace mongo {
          */
         void commit(bool mayInterrupt);
 
+        /**
+         * Yield the lock from addKey() and commit() whenever 'policy' says to.  Only for a tree
+         * nobody else reads or writes until the build is done with it, such as that of a
+         * background bulk load, whose writers go to an IndexDeltaLog.
+         */
+        void setYieldPolicy(RunnerYieldPolicy* policy) { yieldPolicy = policy; }
+
         unsigned long long getn() { return n; }
     };
 
@@ -34,10 +34,13 @@
 #include <algorithm>
 #include <list>
 
+#include "mongo/base/counter.h"
 #include "mongo/db/clientcursor.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/db.h"
 #include "mongo/db/json.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/hashtab.h"
@@ -57,6 +60,18 @@
                         ^cappedFirstDeletedInCurExtent()
                    ^cappedLastDelRecLastExtent()
  ^cappedListOfAllDeletedRecords()
+
+ once the collection has looped, capExtent is a ring segment with a single write gap:
+
+ -----------------------------
+ r r r r r r d d d d r r r r r
+           ^ ^       ^
+      newest gap     oldest
+
+ records are appended at the front of the gap and the oldest records, which start where
+ the gap ends, are evicted by growing the gap over them.  cappedMergeIntoWriteGap() does
+ that in place, and compact() then finds nothing to merge, so the steady state does no
+ deleted list traffic beyond the gap itself.
 */
 
 //#define DDD(x) log() << "cap.cpp debug:" << x << endl;
@@ -64,6 +79,13 @@
 
 namespace mongo {
 
+    // lets the ring fast path be turned off if the layout ever needs debugging
+    MONGO_EXPORT_SERVER_PARAMETER(cappedWriteGapFastPath, bool, true);
+
+    static Counter64 cappedGapMerges;
+    static ServerStatusMetricField<Counter64> displayCappedGapMerges( "record.capped.gapMerges",
+                                                                       &cappedGapMerges );
+
     /* combine adjacent deleted records *for the current extent* of the capped collection
 
        this is O(n^2) but we call it for capped tables where typically n==1 or 2!
@@ -72,20 +94,31 @@ namespace mongo {
     void NamespaceDetails::compact() {
         DDD( "NamespaceDetails::compact enter" );
         verify( isCapped() );
-        
+
         vector<DiskLoc> drecs;
-        
-        // Pull out capExtent's DRs from deletedList
+
         DiskLoc i = cappedFirstDeletedInCurExtent();
         for (; !i.isNull() && inCapExtent( i ); i = i.drec()->nextDeleted() ) {
             DDD( "\t" << i );
             drecs.push_back( i );
         }
 
-        getDur().writingDiskLoc( cappedFirstDeletedInCurExtent() ) = i;
-        
         std::sort( drecs.begin(), drecs.end() );
         DDD( "\t drecs.size(): " << drecs.size() );
+        verify( !drecs.empty() );
+
+        // the usual case once the ring is running: cappedMergeIntoWriteGap() already merged
+        // the last delete, so leave the list alone rather than rewriting it.
+        bool anyAdjacent = false;
+        for ( size_t k = 1; k < drecs.size() && !anyAdjacent; k++ ) {
+            anyAdjacent = drecs[k-1].a() == drecs[k].a() &&
+                drecs[k-1].getOfs() + drecs[k-1].drec()->lengthWithHeaders() == drecs[k].getOfs();
+        }
+        if ( !anyAdjacent )
+            return;
+
+        // Pull out capExtent's DRs from deletedList
+        getDur().writingDiskLoc( cappedFirstDeletedInCurExtent() ) = i;
 
         vector<DiskLoc>::const_iterator j = drecs.begin();
         verify( j != drecs.end() );
@@ -116,6 +149,62 @@ namespace mongo {
 
     }
 
+    bool NamespaceDetails::cappedMergeIntoWriteGap( const DiskLoc& dl, int lengthWithHeaders ) {
+        verify( isCapped() );
+        if ( !cappedWriteGapFastPath )
+            return false;
+
+        // still laying out fresh extents, addDeletedRec() appends in that mode
+        if ( !cappedLastDelRecLastExtent().isValid() )
+            return false;
+
+        if ( !inCapExtent( dl ) )
+            return false;
+
+        // find the deleted records of capExtent that end where 'dl' starts and start where it
+        // ends.  there are normally just the gap and maybe a sliver at the end of the extent.
+        DiskLoc before;
+        DiskLoc after;
+        DiskLoc* afterLink = NULL;
+        for ( DiskLoc* link = &cappedFirstDeletedInCurExtent();
+              !link->isNull() && inCapExtent( *link );
+              link = &link->drec()->nextDeleted() ) {
+            DiskLoc d = *link;
+            if ( d.getOfs() + d.drec()->lengthWithHeaders() == dl.getOfs() ) {
+                before = d;
+            }
+            else if ( dl.getOfs() + lengthWithHeaders == d.getOfs() ) {
+                after = d;
+                afterLink = link;
+            }
+        }
+
+        if ( !before.isNull() ) {
+            // evicting the oldest record, which starts where the gap ends
+            int len = lengthWithHeaders;
+            if ( !after.isNull() ) {
+                len += after.drec()->lengthWithHeaders();
+                getDur().writingDiskLoc( *afterLink ) = after.drec()->nextDeleted();
+            }
+            getDur().writingInt( before.drec()->lengthWithHeaders() ) += len;
+        }
+        else if ( !after.isNull() ) {
+            // the newest record, right before the gap (cappedTruncateAfter)
+            DiskLoc next = after.drec()->nextDeleted();
+            int len = after.drec()->lengthWithHeaders() + lengthWithHeaders;
+            DeletedRecord* d = getDur().writing( dl.drec() );
+            d->lengthWithHeaders() = len;
+            d->nextDeleted() = next;
+            getDur().writingDiskLoc( *afterLink ) = dl;
+        }
+        else {
+            return false;
+        }
+
+        cappedGapMerges.increment();
+        return true;
+    }
+
     DiskLoc &NamespaceDetails::cappedFirstDeletedInCurExtent() {
         if ( cappedLastDelRecLastExtent().isNull() )
             return cappedListOfAllDeletedRecords();
@@ -495,6 +584,7 @@ namespace mongo {
         t->_reservedA = 0;
         t->_extraOffset = 0;
         // indexBuildInProgress preserve 0
+        memset(t->_multikeyPaths, 0, sizeof(t->_multikeyPaths));
         memset(t->_reserved, 0, sizeof(t->_reserved));
 
         // Reset all existing extents and recreate the deleted list.
@@ -0,0 +1,95 @@
+// collection_lookup_cache.h
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#pragma once
+
+#include <string>
+
+#include "mongo/base/string_data.h"
+
+namespace mongo {
+
+    class Collection;
+    class Database;
+
+    /**
+     * The last few collections a client looked up with Database::getCollection, so that
+     * looking one up again takes a string compare rather than a lock and a map lookup.
+     *
+     * Each entry remembers the collection epoch (Database::collectionEpoch()) it was added at.
+     * The epoch moves on whenever any Collection object is deleted, by a drop, a rename or a
+     * database close, which makes every entry stale at once.  Only the client's own thread
+     * uses the cache, so it has no locking of its own.
+     */
+    class CollectionLookupCache {
+    public:
+        CollectionLookupCache() : _next( 0 ) {}
+
+        /**
+         * @return the collection cached for 'ns' in 'db', if it was cached at 'epoch', or NULL
+         */
+        Collection* get( const Database* db, const StringData& ns,
+                         unsigned long long epoch ) const {
+            for ( int i = 0; i < NumEntries; i++ ) {
+                const Entry& e = _entries[i];
+                if ( e.db == db && e.epoch == epoch && ns == e.ns )
+                    return e.collection;
+            }
+            return NULL;
+        }
+
+        /** caches 'collection' as 'ns' in 'db', as of 'epoch', replacing the oldest entry */
+        void add( const Database* db, const StringData& ns, Collection* collection,
+                  unsigned long long epoch ) {
+            Entry& e = _entries[_next];
+            _next = ( _next + 1 ) % NumEntries;
+            e.db = db;
+            e.ns.assign( ns.rawData(), ns.size() );
+            e.collection = collection;
+            e.epoch = epoch;
+        }
+
+    private:
+        enum { NumEntries = 4 };
+
+        struct Entry {
+            Entry() : db( NULL ), collection( NULL ), epoch( 0 ) {}
+            const Database* db;
+            std::string ns;
+            Collection* collection;
+            unsigned long long epoch;
+        };
+
+        Entry _entries[NumEntries];
+        int _next;
+    };
+
+}
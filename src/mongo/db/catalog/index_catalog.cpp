@@ -30,8 +30,10 @@
 
 #include "mongo/db/catalog/index_catalog.h"
 
+#include <set>
 #include <vector>
 
+#include "mongo/base/owned_pointer_vector.h"
 #include "mongo/db/audit.h"
 #include "mongo/db/background.h"
 #include "mongo/db/catalog/index_create.h"
@@ -43,13 +45,16 @@
 #include "mongo/db/index/btree_access_method_internal.h"
 #include "mongo/db/index/fts_access_method.h"
 #include "mongo/db/index/hash_access_method.h"
+#include "mongo/db/index/hash_table_access_method.h"
 #include "mongo/db/index/haystack_access_method.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/index/posting_access_method.h"
 #include "mongo/db/index/s2_access_method.h"
 #include "mongo/db/index_names.h"
 #include "mongo/db/keypattern.h"
 #include "mongo/db/ops/delete.h"
+#include "mongo/db/pdfile_private.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/rs.h" // this is ugly
 #include "mongo/db/structure/collection.h"
@@ -270,6 +275,135 @@ namespace mongo {
 
     }
 
+    Status IndexCatalog::createIndexes( const vector<BSONObj>& specs, bool mayInterrupt ) {
+
+        // which of these can share a scan
+        vector<BSONObj> together;
+        for ( size_t i = 0; i < specs.size(); i++ ) {
+            const BSONObj& spec = specs[i];
+            if ( spec["dropDups"].trueValue() ||
+                 ( !inDBRepair && spec["background"].trueValue() ) ) {
+                Status s = createIndex( spec, mayInterrupt );
+                if ( !s.isOK() && s.code() != ErrorCodes::IndexAlreadyExists )
+                    return s;
+            }
+            else {
+                together.push_back( spec );
+            }
+        }
+
+        if ( together.size() == 1 ) {
+            Status s = createIndex( together[0], mayInterrupt );
+            if ( !s.isOK() && s.code() != ErrorCodes::IndexAlreadyExists )
+                return s;
+            return Status::OK();
+        }
+
+        // same steps as createIndex(), for each spec in turn, then one build for all of
+        // them.  the blocks drop whatever isn't finished if we return early or throw.
+        Database* db = _collection->_database;
+        OwnedPointerVector<IndexBuildBlock> blocks;
+        vector<string> names;
+        BSONArrayBuilder allSpecs;
+
+        for ( size_t i = 0; i < together.size(); i++ ) {
+            BSONObj spec = together[i];
+
+            Status status = okToAddIndex( spec );
+            if ( status.code() == ErrorCodes::IndexAlreadyExists )
+                continue;
+            if ( !status.isOK() )
+                return status;
+
+            spec = fixIndexSpec( spec );
+
+            // we double check with new index spec.  this also catches duplicates within 'specs',
+            // as the ones before are already in progress
+            status = okToAddIndex( spec );
+            if ( status.code() == ErrorCodes::IndexAlreadyExists )
+                continue;
+            if ( !status.isOK() )
+                return status;
+
+            string pluginName = IndexNames::findPluginName( spec["key"].Obj() );
+            if ( pluginName.size() ) {
+                Status s = _upgradeDatabaseMinorVersionIfNeeded( pluginName );
+                if ( !s.isOK() )
+                    return s;
+            }
+
+            Collection* systemIndexes = db->getCollection( db->_indexesName );
+            if ( !systemIndexes ) {
+                systemIndexes = db->createCollection( db->_indexesName, false, NULL, false );
+                verify( systemIndexes );
+            }
+
+            StatusWith<DiskLoc> loc = systemIndexes->insertDocument( spec, false );
+            if ( !loc.isOK() )
+                return loc.getStatus();
+            verify( !loc.getValue().isNull() );
+
+            string idxName = spec["name"].valuestr();
+            names.push_back( idxName );
+            allSpecs.append( spec );
+
+            blocks.mutableVector().push_back( new IndexBuildBlock( this, idxName, loc.getValue() ) );
+            verify( blocks.vector().back()->indexDetails() );
+        }
+
+        if ( names.empty() )
+            return Status::OK();
+
+        const BSONObj description = BSON( "indexes" << allSpecs.arr() );
+        if ( mayInterrupt ) {
+            cc().curop()->setQuery( description );
+        }
+
+        try {
+            OwnedPointerVector<IndexDescriptor> descs;
+            for ( size_t i = 0; i < names.size(); i++ ) {
+                int idxNo = _details->findIndexByName( names[i], true );
+                verify( idxNo >= 0 );
+                IndexDetails* id = &_details->idx(idxNo);
+                descs.mutableVector().push_back(
+                    new IndexDescriptor( _collection, idxNo, id, id->info.obj().getOwned() ) );
+            }
+
+            buildIndexes( _collection, descs.vector(), mayInterrupt );
+
+            for ( size_t i = 0; i < blocks.size(); i++ )
+                blocks.vector()[i]->success();
+        }
+        catch (DBException& e) {
+            log() << "index build failed."
+                  << " specs: " << description
+                  << " error: " << e;
+
+            // in case we got any access methods or something like that
+            // TEMP until IndexDescriptor has to direct refs
+            for ( size_t i = 0; i < names.size(); i++ ) {
+                int idxNo = _details->findIndexByName( names[i], true );
+                verify( idxNo >= 0 );
+                _deleteCacheEntry( idxNo );
+            }
+
+            ErrorCodes::Error codeToUse = ErrorCodes::fromInt( e.getCode() );
+            if ( codeToUse == ErrorCodes::UnknownError )
+                return Status( ErrorCodes::InternalError, e.what(), e.getCode() );
+            return Status( codeToUse, e.what() );
+        }
+
+        // in case we got any access methods or something like that
+        // TEMP until IndexDescriptor has to direct refs
+        for ( size_t i = 0; i < names.size(); i++ ) {
+            int idxNo = _details->findIndexByName( names[i], true );
+            verify( idxNo >= 0 );
+            _deleteCacheEntry( idxNo );
+        }
+
+        return Status::OK();
+    }
+
     IndexCatalog::IndexBuildBlock::IndexBuildBlock( IndexCatalog* catalog,
                                                     const StringData& indexName,
                                                     const DiskLoc& loc )
@@ -774,8 +908,8 @@ namespace mongo {
         return Status::OK();
     }
 
-    void IndexCatalog::markMultikey( IndexDescriptor* idx, bool isMultikey ) {
-        if ( _details->setIndexIsMultikey( idx->_indexNumber, isMultikey ) )
+    void IndexCatalog::markMultikey( IndexDescriptor* idx, bool isMultikey, unsigned fields ) {
+        if ( _details->setIndexIsMultikey( idx->_indexNumber, isMultikey, fields ) )
             _collection->infoCache()->clearQueryCache();
     }
 
@@ -869,6 +1003,7 @@ namespace mongo {
         string type = _getAccessMethodName(desc->keyPattern());
 
         if (IndexNames::HASHED == type ||
+            IndexNames::POSTING == type ||
             IndexNames::GEO_2DSPHERE == type ||
             IndexNames::TEXT == type ||
             IndexNames::GEO_HAYSTACK == type ||
@@ -899,6 +1034,12 @@ namespace mongo {
         if (IndexNames::HASHED == type) {
             newlyCreated = new HashAccessMethod(desc);
         }
+        else if (IndexNames::POSTING == type) {
+            newlyCreated = new PostingAccessMethod(desc);
+        }
+        else if (IndexNames::HASH_TABLE == type) {
+            newlyCreated = new HashTableAccessMethod(desc);
+        }
         else if (IndexNames::GEO_2DSPHERE == type) {
             newlyCreated = new S2AccessMethod(desc);
         }
@@ -943,6 +1084,22 @@ namespace mongo {
         return iam->insert(obj, loc, options, &inserted);
     }
 
+    bool IndexCatalog::_deferIndexRecord( int idxNo, const BSONObj& obj, const DiskLoc &loc,
+                                          std::vector< std::pair<BSONObj, DiskLoc> >* keys ) {
+        IndexDescriptor* desc = getDescriptor( idxNo );
+        verify(desc);
+        IndexAccessMethod* iam = getIndex( desc );
+        verify(iam);
+
+        InsertDeleteOptions options;
+        options.logIfError = false;
+        options.dupsAllowed =
+            ignoreUniqueIndex( desc->getOnDisk() ) ||
+            ( !KeyPattern::isIdKeyPattern(desc->keyPattern()) && !desc->unique() );
+
+        return iam->getKeysForBulkInsert(obj, loc, options, keys);
+    }
+
     Status IndexCatalog::_unindexRecord( int idxNo, const BSONObj& obj, const DiskLoc &loc, bool logIfError ) {
         IndexDescriptor* desc = getDescriptor( idxNo );
         verify( desc );
@@ -964,10 +1121,16 @@ namespace mongo {
     }
 
 
-    void IndexCatalog::indexRecord( const BSONObj& obj, const DiskLoc &loc ) {
+    void IndexCatalog::indexRecord( const BSONObj& obj, const DiskLoc &loc,
+                                    DeferredIndexInserts* deferred ) {
+
+        if ( deferred )
+            deferred->_keys.resize( numIndexesTotal() );
 
         for ( int i = 0; i < numIndexesTotal(); i++ ) {
             try {
+                if ( deferred && _deferIndexRecord( i, obj, loc, &deferred->_keys[i] ) )
+                    continue;
                 Status s = _indexRecord( i, obj, loc );
                 uassert(s.location(), s.reason(), s.isOK() );
             }
@@ -975,6 +1138,15 @@ namespace mongo {
 
                 LOG(2) << "IndexCatalog::indexRecord failed: " << ae;
 
+                if ( deferred ) {
+                    // this document's keys are the last ones held for each index
+                    for ( size_t j = 0; j < deferred->_keys.size(); j++ ) {
+                        std::vector< std::pair<BSONObj, DiskLoc> >& keys = deferred->_keys[j];
+                        while ( !keys.empty() && keys.back().second == loc )
+                            keys.pop_back();
+                    }
+                }
+
                 for ( int j = 0; j <= i; j++ ) {
                     try {
                         _unindexRecord( j, obj, loc, false );
@@ -988,6 +1160,38 @@ namespace mongo {
             }
         }
 
+        if ( deferred )
+            deferred->_locs.push_back( loc );
+    }
+
+    Status IndexCatalog::flushDeferredInserts( DeferredIndexInserts* deferred,
+                                               size_t* firstFailed ) {
+        std::set<DiskLoc> failed;
+        Status ret = Status::OK();
+        *firstFailed = 0;
+
+        for ( size_t i = 0; i < deferred->_keys.size(); i++ ) {
+            std::vector< std::pair<BSONObj, DiskLoc> >& keys = deferred->_keys[i];
+            if ( keys.empty() )
+                continue;
+
+            IndexAccessMethod* iam = getIndex( getDescriptor( i ) );
+            Status s = iam->insertKeysSorted( &keys, &failed );
+            if ( ret.isOK() )
+                ret = s;
+            keys.clear();
+        }
+
+        if ( failed.empty() )
+            return ret;
+
+        for ( size_t i = 0; i < deferred->_locs.size(); i++ ) {
+            if ( failed.count( deferred->_locs[i] ) ) {
+                *firstFailed = i;
+                break;
+            }
+        }
+        return ret;
     }
 
     void IndexCatalog::unindexRecord( const BSONObj& obj, const DiskLoc& loc, bool noWarn ) {
@@ -1001,6 +1205,27 @@ namespace mongo {
 
     }
 
+    void IndexCatalog::unindexRecords( const std::vector< std::pair<BSONObj, DiskLoc> >& docs,
+                                       bool noWarn ) {
+        int numIndices = numIndexesTotal();
+
+        for ( int i = 0; i < numIndices; i++ ) {
+            IndexDescriptor* desc = getDescriptor( i );
+            verify( desc );
+            IndexAccessMethod* iam = getIndex( desc );
+            verify( iam );
+
+            InsertDeleteOptions options;
+            options.logIfError = !noWarn;
+
+            Status status = iam->removeBulk( docs, options, NULL );
+            if ( !status.isOK() ) {
+                problem() << "Couldn't unindex " << docs.size() << " records from "
+                          << desc->indexNamespace() << " status: " << status.toString();
+            }
+        }
+    }
+
     Status IndexCatalog::checkNoIndexConflicts( const BSONObj &obj ) {
         for ( int idxNo = 0; idxNo < numIndexesTotal(); idxNo++ ) {
             if( !_details->idx(idxNo).unique() )
@@ -32,6 +32,7 @@
 
 #include <vector>
 
+#include "mongo/base/disallow_copying.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/jsobj.h"
 
@@ -46,6 +47,33 @@ namespace mongo {
     class BtreeAccessMethod;
     class BtreeBasedAccessMethod;
 
+    /**
+     * Index keys held back while a group of documents is inserted under one lock, so that
+     * IndexCatalog::flushDeferredInserts() can insert them index by index in key order.
+     */
+    class DeferredIndexInserts {
+        MONGO_DISALLOW_COPYING( DeferredIndexInserts );
+    public:
+        DeferredIndexInserts() { }
+
+        bool empty() const { return _locs.empty(); }
+
+        /** the documents whose keys are held, in the order they were inserted */
+        const std::vector<DiskLoc>& locs() const { return _locs; }
+
+        void clear() {
+            _locs.clear();
+            _keys.clear();
+        }
+
+    private:
+        friend class IndexCatalog;
+
+        std::vector<DiskLoc> _locs;
+        // ( key, document ) pairs, by index number
+        std::vector< std::vector< std::pair<BSONObj, DiskLoc> > > _keys;
+    };
+
     /**
      * how many: 1 per Collection
      * lifecycle: attached to a Collection
@@ -130,6 +158,15 @@ namespace mongo {
 
         Status createIndex( BSONObj spec, bool mayInterrupt );
 
+        /**
+         * Create the indexes described by 'specs'.  Specs for indexes that already exist are
+         * skipped.  Foreground indexes without dropDups are built together in a single scan of
+         * the collection; if that build fails, none of them are created.  Anything else is built
+         * on its own with createIndex().
+         * @return the first error, if any
+         */
+        Status createIndexes( const vector<BSONObj>& specs, bool mayInterrupt );
+
         Status okToAddIndex( const BSONObj& spec ) const;
 
         Status dropAllIndexes( bool includingIdIndex );
@@ -149,7 +186,9 @@ namespace mongo {
          */
         BSONObj prepOneUnfinishedIndex();
 
-        void markMultikey( IndexDescriptor* idx, bool isMultikey = true );
+        // 'fields' are the key pattern fields that had more than one value, see
+        // NamespaceDetails::multikeyFields
+        void markMultikey( IndexDescriptor* idx, bool isMultikey = true, unsigned fields = ~0u );
 
         // --- these probably become private?
 
@@ -173,11 +212,31 @@ namespace mongo {
 
         // ----- data modifiers ------
 
-        // this throws for now
-        void indexRecord( const BSONObj& obj, const DiskLoc &loc );
+        /**
+         * this throws for now
+         * indexes which can take keys in bulk put them in 'deferred', if given, rather than in
+         * the index, until flushDeferredInserts()
+         */
+        void indexRecord( const BSONObj& obj, const DiskLoc &loc,
+                          DeferredIndexInserts* deferred = NULL );
+
+        /**
+         * inserts the keys held in 'deferred' and drops them from it
+         * if some can't be inserted, returns an error and sets 'firstFailed' to the position in
+         * deferred->locs() of the first document they belong to
+         * the documents from there on may be partly indexed, for the caller to delete
+         */
+        Status flushDeferredInserts( DeferredIndexInserts* deferred, size_t* firstFailed );
 
         void unindexRecord( const BSONObj& obj, const DiskLoc& loc, bool noWarn );
 
+        /**
+         * unindexes each ( document, location ) pair in docs
+         * each index removes the keys of all of them together, see IndexAccessMethod::removeBulk
+         */
+        void unindexRecords( const std::vector< std::pair<BSONObj, DiskLoc> >& docs,
+                             bool noWarn );
+
         /**
          * checks all unique indexes and checks for conflicts
          * should not throw
@@ -229,6 +288,8 @@ namespace mongo {
         void _checkMagic() const;
 
         Status _indexRecord( int idxNo, const BSONObj& obj, const DiskLoc &loc );
+        bool _deferIndexRecord( int idxNo, const BSONObj& obj, const DiskLoc &loc,
+                                std::vector< std::pair<BSONObj, DiskLoc> >* keys );
         Status _unindexRecord( int idxNo, const BSONObj& obj, const DiskLoc &loc, bool logIfError );
 
         /**
@@ -38,6 +38,8 @@
 #include "mongo/db/extsort.h"
 #include "mongo/db/storage/index_details.h"
 #include "mongo/db/index/btree_based_builder.h"
+#include "mongo/db/index/extendible_hash.h"
+#include "mongo/db/index_names.h"
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/pdfile_private.h"
@@ -46,11 +48,16 @@
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/util/processinfo.h"
 
 namespace mongo {
 
+    // build non unique background indexes with the external sorter and a delta log rather than
+    // one insert into the live tree at a time, see BtreeBasedBuilder::bulkLoadInBackground
+    MONGO_EXPORT_SERVER_PARAMETER(backgroundIndexBulkLoad, bool, true);
+
     /**
      * Add the provided (obj, dl) pair to the provided index.
      */
@@ -70,6 +77,49 @@ namespace mongo {
         uassertStatusOK( ret );
     }
 
+    static bool isHashTable( IndexDescriptor* idx ) {
+        return IndexNames::HASH_TABLE == IndexNames::findPluginName( idx->keyPattern() );
+    }
+
+    /** an empty index, a hashtable one sized for the collection as it is now */
+    static DiskLoc makeEmptyIndex( Collection* collection, IndexDescriptor* idx ) {
+        if ( isHashTable( idx ) )
+            return ExtendibleHash::create( idx->getOnDisk(), collection->numRecords() );
+        return BtreeBasedBuilder::makeEmptyIndex( idx->getOnDisk() );
+    }
+
+    /**
+     * A hashtable index has no key order to sort into, so a foreground build sizes the table
+     * for the collection up front and puts each document straight in.
+     */
+    static unsigned long long fastBuildHashTable( Collection* collection,
+                                                  IndexDescriptor* idx,
+                                                  bool mayInterrupt ) {
+        getDur().writingDiskLoc( idx->getOnDisk().head ) = makeEmptyIndex( collection, idx );
+
+        ProgressMeterHolder pm( cc().curop()->setMessage( "index: (1/1) hashing keys",
+                                                          "Index: (1/1) Hashing Progress",
+                                                          collection->numRecords(),
+                                                          10 ) );
+
+        auto_ptr<Runner> runner( InternalPlanner::collectionScan( collection->ns().ns() ) );
+        unsigned long long n = 0;
+        BSONObj obj;
+        DiskLoc loc;
+        Runner::RunnerState state;
+        while ( Runner::RUNNER_ADVANCED == ( state = runner->getNext( &obj, &loc ) ) ) {
+            RARELY killCurrentOp.checkForInterrupt( !mayInterrupt );
+            addKeysToIndex( collection, idx, obj, loc );
+            n++;
+            pm.hit();
+            getDur().commitIfNeeded();
+        }
+        uassert( 17338, "Internal error reading docs from collection",
+                 Runner::RUNNER_EOF == state );
+        pm.finished();
+        return n;
+    }
+
     //
     // Bulk index building
     //
@@ -81,7 +131,7 @@ namespace mongo {
             : BackgroundOperation(ns) {
         }
 
-        unsigned long long go( Collection* collection, IndexDescriptor* idx );
+        unsigned long long go( Collection* collection, IndexDescriptor* idx, bool mayInterrupt );
 
     private:
         unsigned long long addExistingToIndex( Collection* collection,
@@ -102,7 +152,8 @@ namespace mongo {
 
     };
 
-    unsigned long long BackgroundIndexBuildJob::go( Collection* collection, IndexDescriptor* idx) {
+    unsigned long long BackgroundIndexBuildJob::go( Collection* collection, IndexDescriptor* idx,
+                                                    bool mayInterrupt ) {
 
         string ns = collection->ns().ns();
 
@@ -113,8 +164,19 @@ namespace mongo {
         prep( ns );
 
         try {
-            idx->getOnDisk().head.writing() = BtreeBasedBuilder::makeEmptyIndex( idx->getOnDisk() );
-            unsigned long long n = addExistingToIndex( collection, idx );
+            idx->getOnDisk().head.writing() = makeEmptyIndex( collection, idx );
+            // a unique index has to refuse dups as they are inserted, and dropDups has to act on
+            // them, so those still go into the live tree one document at a time.  So do posting
+            // and hashtable indexes, whose replayed writes would have to go through the access
+            // method
+            unsigned long long n;
+            string pluginName = IndexNames::findPluginName( idx->keyPattern() );
+            if ( backgroundIndexBulkLoad && !idx->unique() && !idx->dropDups() &&
+                 !KeyPattern::isIdKeyPattern( idx->keyPattern() ) &&
+                 IndexNames::POSTING != pluginName && IndexNames::HASH_TABLE != pluginName )
+                n = BtreeBasedBuilder::bulkLoadInBackground( collection, idx, mayInterrupt );
+            else
+                n = addExistingToIndex( collection, idx );
             // idx may point at an invalid index entry at this point
             done( ns );
             return n;
@@ -243,16 +305,58 @@ namespace mongo {
         verify( Lock::isWriteLocked( ns ) );
 
         if( inDBRepair || !idxInfo["background"].trueValue() ) {
-            n = BtreeBasedBuilder::fastBuildIndex( collection, idx, mayInterrupt );
+            if ( isHashTable( idx ) )
+                n = fastBuildHashTable( collection, idx, mayInterrupt );
+            else
+                n = BtreeBasedBuilder::fastBuildIndex( collection, idx, mayInterrupt );
             verify( !idx->getHead().isNull() );
         }
         else {
             BackgroundIndexBuildJob j( ns );
-            n = j.go( collection, idx );
+            n = j.go( collection, idx, mayInterrupt );
         }
         MONGO_TLOG(0) << "build index done.  scanned " << n << " total records. "
                       << t.millis() / 1000.0 << " secs" << endl;
     }
 
+    // throws DBException
+    void buildIndexes( Collection* collection,
+                       const std::vector<IndexDescriptor*>& idxs,
+                       bool mayInterrupt ) {
+
+        string ns = collection->ns().ns(); // our copy
+
+        for ( size_t i = 0; i < idxs.size(); i++ ) {
+            const BSONObj& idxInfo = idxs[i]->infoObj();
+            verify( inDBRepair || !idxInfo["background"].trueValue() );
+
+            MONGO_TLOG(0) << "build index on: " << ns
+                          << " properties: " << idxs[i]->toString() << endl;
+
+            audit::logCreateIndex( currentClient.get(), &idxInfo, idxs[i]->indexName(), ns );
+        }
+
+        Timer t;
+
+        verify( Lock::isWriteLocked( ns ) );
+
+        // hashtable indexes can't share the sorted scan, they get one each
+        vector<IndexDescriptor*> btrees;
+        unsigned long long n = 0;
+        for ( size_t i = 0; i < idxs.size(); i++ ) {
+            if ( isHashTable( idxs[i] ) )
+                n = fastBuildHashTable( collection, idxs[i], mayInterrupt );
+            else
+                btrees.push_back( idxs[i] );
+        }
+        if ( !btrees.empty() )
+            n = BtreeBasedBuilder::fastBuildIndexes( collection, btrees, mayInterrupt );
+        for ( size_t i = 0; i < idxs.size(); i++ )
+            verify( !idxs[i]->getHead().isNull() );
+
+        MONGO_TLOG(0) << "build " << idxs.size() << " indexes done.  scanned " << n
+                      << " total records. " << t.millis() / 1000.0 << " secs" << endl;
+    }
+
 }  // namespace mongo
 
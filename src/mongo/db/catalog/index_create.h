@@ -31,6 +31,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace mongo {
     class Collection;
@@ -43,4 +44,10 @@ namespace mongo {
                        IndexDescriptor* idx,
                        bool mayInterrupt );
 
+    // Build several foreground indexes with one scan of the collection.
+    // None of them may be background or dropDups indexes.
+    void buildIndexes( Collection* collection,
+                       const std::vector<IndexDescriptor*>& idxs,
+                       bool mayInterrupt );
+
 } // namespace mongo
@@ -172,6 +172,30 @@ namespace mongo {
         setThreadName( origThreadName.rawData() );
     }
 
+    Client* Client::detachFromThread() {
+        Client* c = currentClient.release();
+        verify( c );
+        c->_lastError = mongo::lastError.release();
+        c->_shardedConnectionInfo = ShardedConnectionInfo::detach();
+        return c;
+    }
+
+    void Client::attachToThread( Client* c ) {
+        verify( currentClient.get() == 0 );
+        currentClient.reset( c );
+        mongo::lastError.reset( c->_lastError );
+        c->_lastError = 0;
+        ShardedConnectionInfo::attach( c->_shardedConnectionInfo );
+        c->_shardedConnectionInfo = 0;
+
+        setThreadName( c->_desc.c_str() );
+#ifndef _WIN32
+        stringstream temp;
+        temp << hex << showbase << pthread_self();
+        c->_threadId = temp.str();
+#endif
+    }
+
 
     Client::Client(const string& desc, AbstractMessagingPort *p) :
         ClientBasic(p),
@@ -179,7 +203,9 @@ namespace mongo {
         _shutdown(false),
         _desc(desc),
         _god(0),
-        _lastOp(0)
+        _lastOp(0),
+        _lastError(0),
+        _shardedConnectionInfo(0)
     {
         _hasWrittenThisPass = false;
         _pageFaultRetryableSection = 0;
@@ -196,6 +222,8 @@ namespace mongo {
 
     Client::~Client() {
         _god = 0;
+        delete _lastError;
+        delete _shardedConnectionInfo;
 
         // Because both Client object pointers and logging infrastructure are stored in Thread
         // Specific Pointers and because we do not explicitly control the order in which TSPs are
@@ -564,6 +592,7 @@ namespace mongo {
         exhaust = false;
 
         nscanned = -1;
+        nscannedObjects = -1;
         idhack = false;
         scanAndOrder = false;
         nupdated = -1;
@@ -581,6 +610,8 @@ namespace mongo {
         executionTime = 0;
         nreturned = -1;
         responseLength = -1;
+        recvMicros = -1;
+        queryShape.clear();
     }
 
 
@@ -613,6 +644,7 @@ namespace mongo {
         OPDEBUG_TOSTRING_HELP_BOOL( exhaust );
 
         OPDEBUG_TOSTRING_HELP( nscanned );
+        OPDEBUG_TOSTRING_HELP( nscannedObjects );
         OPDEBUG_TOSTRING_HELP_BOOL( idhack );
         OPDEBUG_TOSTRING_HELP_BOOL( scanAndOrder );
         OPDEBUG_TOSTRING_HELP( nmoved );
@@ -643,6 +675,7 @@ namespace mongo {
         OPDEBUG_TOSTRING_HELP( nreturned );
         if ( responseLength > 0 )
             s << " reslen:" << responseLength;
+        OPDEBUG_TOSTRING_HELP( recvMicros );
         s << " " << executionTime << "ms";
         
         return s.str();
@@ -706,6 +739,7 @@ namespace mongo {
         OPDEBUG_APPEND_BOOL( exhaust );
 
         OPDEBUG_APPEND_NUMBER( nscanned );
+        OPDEBUG_APPEND_NUMBER( nscannedObjects );
         OPDEBUG_APPEND_BOOL( idhack );
         OPDEBUG_APPEND_BOOL( scanAndOrder );
         OPDEBUG_APPEND_BOOL( moved );
@@ -727,6 +761,7 @@ namespace mongo {
 
         OPDEBUG_APPEND_NUMBER( nreturned );
         OPDEBUG_APPEND_NUMBER( responseLength );
+        OPDEBUG_APPEND_NUMBER( recvMicros );
         b.append( "millis" , executionTime );
 
         return true;
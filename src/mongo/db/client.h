@@ -38,6 +38,7 @@
 
 #include "mongo/pch.h"
 
+#include "mongo/db/catalog/collection_lookup_cache.h"
 #include "mongo/db/client_basic.h"
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/lasterror.h"
@@ -59,6 +60,7 @@ namespace mongo {
     class AbstractMessagingPort;
     class LockCollectionForReading;
     class PageFaultRetryableSection;
+    class ShardedConnectionInfo;
 
     TSP_DECLARE(Client, currentClient)
 
@@ -92,6 +94,17 @@ namespace mongo {
          */
         static void resetThread( const StringData& origThreadName );
 
+        /**
+         * Takes the current thread's Client (with its LastError and sharding version info) off
+         * the thread without deleting them, so that a connection's next request can run on
+         * another thread.
+         * @return the detached Client
+         */
+        static Client* detachFromThread();
+
+        /** Makes 'c', detached with detachFromThread(), the current thread's Client again. */
+        static void attachToThread( Client* c );
+
         /** this has to be called as the client goes away, but before thread termination
          *  @return true if anything was done
          */
@@ -131,6 +144,8 @@ namespace mongo {
 
         LockState& lockState() { return _ls; }
 
+        CollectionLookupCache& collectionLookupCache() { return _collectionLookupCache; }
+
     private:
         Client(const std::string& desc, AbstractMessagingPort *p = 0);
         friend class CurOp;
@@ -149,6 +164,12 @@ namespace mongo {
         PageFaultRetryableSection *_pageFaultRetryableSection;
 
         LockState _ls;
+
+        CollectionLookupCache _collectionLookupCache;
+
+        // the thread's per-connection state while we're detached from it, see detachFromThread()
+        LastError* _lastError;
+        ShardedConnectionInfo* _shardedConnectionInfo;
         
         friend class PageFaultRetryableSection; // TEMP
         friend class NoPageFaultsAllowed; // TEMP
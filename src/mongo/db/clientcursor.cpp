@@ -55,7 +55,15 @@
 
 namespace mongo {
 
-    ClientCursor::CCById ClientCursor::clientCursorsById;
+    struct ClientCursor::CCShard {
+        CCShard() : mutex("ClientCursor::CCShard") { }
+        SimpleMutex mutex;
+        CCById cursors;
+    };
+
+    ClientCursor::CCShard* ClientCursor::clientCursorShards( new CCShard[NumShards] );
+    AtomicUInt32 ClientCursor::numOpenCursors;
+    ClientCursor::CCByNs ClientCursor::clientCursorsByNs;
     boost::recursive_mutex& ClientCursor::ccmutex( *(new boost::recursive_mutex()) );
     long long ClientCursor::numberTimedOut = 0;
     set<Runner*> ClientCursor::nonCachedRunners;
@@ -65,7 +73,8 @@ namespace mongo {
                                   const NamespaceDetails* nsd,
                                   const DiskLoc& dl ); // from s/d_logic.h
 
-    ClientCursor::ClientCursor(Runner* runner, int qopts, const BSONObj query) {
+    ClientCursor::ClientCursor(Runner* runner, int qopts, const BSONObj query)
+        : _memoryUsage(MemoryUsage::kCursors) {
         _runner.reset(runner);
         _ns = runner->ns();
         _query = query;
@@ -75,7 +84,8 @@ namespace mongo {
 
     ClientCursor::ClientCursor(const string& ns)
         : _ns(ns),
-          _queryOptions(QueryOption_NoCursorTimeout) {
+          _queryOptions(QueryOption_NoCursorTimeout),
+          _memoryUsage(MemoryUsage::kCursors) {
 
         init();
     }
@@ -89,8 +99,11 @@ namespace mongo {
 
         _idleAgeMillis = 0;
         _leftoverMaxTimeMicros = 0;
+        _keysExamined = 0;
+        _docsExamined = 0;
         _pinValue = 0;
         _pos = 0;
+        _memoryUsage.set(sizeof(ClientCursor) + _ns.size() + _query.objsize());
         
         Lock::assertAtLeastReadLocked(_ns);
 
@@ -102,7 +115,13 @@ namespace mongo {
 
         recursive_scoped_lock lock(ccmutex);
         _cursorid = allocCursorId_inlock();
-        clientCursorsById.insert( make_pair(_cursorid, this) );
+        {
+            CCShard& shard = shardFor(_cursorid);
+            SimpleMutex::scoped_lock lk(shard.mutex);
+            shard.cursors.insert( make_pair(_cursorid, this) );
+        }
+        clientCursorsByNs[_ns].insert(this);
+        numOpenCursors.fetchAndAdd(1);
     }
 
     ClientCursor::~ClientCursor() {
@@ -114,7 +133,18 @@ namespace mongo {
 
         {
             recursive_scoped_lock lock(ccmutex);
-            clientCursorsById.erase(_cursorid);
+            {
+                // may already be gone if we're being erased
+                CCShard& shard = shardFor(_cursorid);
+                SimpleMutex::scoped_lock lk(shard.mutex);
+                shard.cursors.erase(_cursorid);
+            }
+            CCByNs::iterator i = clientCursorsByNs.find(_ns);
+            verify(i != clientCursorsByNs.end());
+            i->second.erase(this);
+            if (i->second.empty())
+                clientCursorsByNs.erase(i);
+            numOpenCursors.fetchAndSubtract(1);
 
             // defensive:
             _cursorid = INVALID_CURSOR_ID;
@@ -123,14 +153,18 @@ namespace mongo {
         }
     }
 
+    // static
+    ClientCursor::CCShard& ClientCursor::shardFor(CursorId id) {
+        return clientCursorShards[id & (NumShards - 1)];
+    }
+
     // static
     void ClientCursor::assertNoCursors() {
         recursive_scoped_lock lock(ccmutex);
-        if (clientCursorsById.size() > 0) {
+        if (!clientCursorsByNs.empty()) {
             log() << "ERROR clientcursors exist but should not at this point" << endl;
-            ClientCursor *cc = clientCursorsById.begin()->second;
+            ClientCursor *cc = *clientCursorsByNs.begin()->second.begin();
             log() << "first one: " << cc->_cursorid << ' ' << cc->_ns << endl;
-            clientCursorsById.clear();
             verify(false);
         }
     }
@@ -162,21 +196,28 @@ namespace mongo {
             }
         }
 
-        // Look at all cached ClientCursor(s).  The CC may have a Runner, a Cursor, or nothing (see
-        // sharding_block.h).
-        CCById::const_iterator it = clientCursorsById.begin();
-        while (it != clientCursorsById.end()) {
-            ClientCursor* cc = it->second;
+        // Look at the cached ClientCursor(s) over 'ns'.  The CC may have a Runner, a Cursor, or
+        // nothing (see sharding_block.h).  Collect them first as deleting one changes
+        // clientCursorsByNs.
+        vector<ClientCursor*> cursors;
+        for (CCByNs::const_iterator i = clientCursorsByNs.lower_bound(ns.toString());
+             i != clientCursorsByNs.end() && StringData(i->first).startsWith(ns);
+             ++i) {
+            if (!isDB && i->first != ns)
+                break;
+            cursors.insert(cursors.end(), i->second.begin(), i->second.end());
+        }
+
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            ClientCursor* cc = cursors[i];
 
             // Aggregation cursors don't have their lifetime bound to the underlying collection.
             if (cc->isAggCursor) {
-                ++it;
                 continue;
             }
 
             // We're only interested in cursors over one db.
             if (cc->_db != db) {
-                ++it;
                 continue;
             }
 
@@ -184,41 +225,34 @@ namespace mongo {
             // the set of active cursor IDs in ClientCursor is used as representation of query
             // state.  See sharding_block.h.  TODO(greg,hk): Move this out.
             if (NULL == cc->_runner.get()) {
-                ++it;
                 continue;
             }
 
-            bool shouldDelete = false;
+            if (!isDB && cc->_runner->ns() != ns) {
+                continue;
+            }
 
             // We will only delete CCs with runners that are not actively in use.  The runners that
-            // are actively in use are instead kill()-ed.
-            if (NULL != cc->_runner.get()) {
-                if (isDB || cc->_runner->ns() == ns) {
-                    // If there is a pinValue >= 100, somebody is actively using the CC and we do
-                    // not delete it.  Instead we notify the holder that we killed it.  The holder
-                    // will then delete the CC.
-                    if (cc->_pinValue >= 100) {
-                        cc->_runner->kill();
-                    }
-                    else {
-                        // pinvalue is <100, so there is nobody actively holding the CC.  We can
-                        // safely delete it as nobody is holding the CC.
-                        shouldDelete = true;
-                    }
+            // are actively in use are instead kill()-ed.  The pin value is checked under the
+            // shard's mutex so that nobody can pin the CC between the check and the delete.
+            bool shouldDelete = false;
+            {
+                CCShard& shard = shardFor(cc->_cursorid);
+                SimpleMutex::scoped_lock lk(shard.mutex);
+                if (cc->_pinValue >= 100) {
+                    // Somebody is actively using the CC and we do not delete it.  Instead we
+                    // notify the holder that we killed it.  The holder will then delete the CC.
+                    cc->_runner->kill();
+                }
+                else {
+                    // Nobody is holding the CC, so we can safely delete it.
+                    shard.cursors.erase(cc->_cursorid);
+                    shouldDelete = true;
                 }
             }
 
             if (shouldDelete) {
-                ClientCursor* toDelete = it->second;
-                CursorId id = toDelete->cursorid();
-                delete toDelete;
-                // We're not following the usual paradigm of saving it, ++it, and deleting the saved
-                // 'it' because deleting 'it' might invalidate the next thing in clientCursorsById.
-                // TODO: Why?
-                it = clientCursorsById.upper_bound(id);
-            }
-            else {
-                ++it;
+                delete cc;
             }
         }
     }
@@ -248,17 +282,18 @@ namespace mongo {
             }
         }
 
-        // TODO: This requires optimization.  We walk through *all* CCs and send the delete to every
-        // CC open on the db we're deleting from.  We could:
-        // 1. Map from ns to open runners,
-        // 2. Map from ns -> (a map of DiskLoc -> runners who care about that DL)
-        //
-        // We could also queue invalidations somehow and have them processed later in the runner's
-        // read locks.
-        for (CCById::const_iterator it = clientCursorsById.begin(); it != clientCursorsById.end();
+        // TODO: We send the delete to every CC open on the collection.  We could map from
+        // ns -> (a map of DiskLoc -> runners who care about that DL), or queue invalidations
+        // somehow and have them processed later in the runner's read locks.
+        CCByNs::const_iterator cursors = clientCursorsByNs.find(ns.toString());
+        if (cursors == clientCursorsByNs.end()) {
+            return;
+        }
+        for (set<ClientCursor*>::const_iterator it = cursors->second.begin();
+             it != cursors->second.end();
              ++it) {
 
-            ClientCursor* cc = it->second;
+            ClientCursor* cc = *it;
             // We're only interested in cursors over one db.
             if (cc->_db != db) { continue; }
             if (NULL == cc->_runner.get()) { continue; }
@@ -364,21 +399,20 @@ namespace mongo {
         // two passes so that we don't need to readlock unless we really do some timeouts
         // we assume here that incrementing _idleAgeMillis outside readlock is ok.
         {
-            recursive_scoped_lock lock(ccmutex);
-            {
-                unsigned sz = clientCursorsById.size();
-                static time_t last;
-                if( sz >= 100000 ) { 
-                    if( time(0) - last > 300 ) {
-                        last = time(0);
-                        log() << "warning number of open cursors is very large: " << sz << endl;
-                    }
+            unsigned sz = numCursors();
+            static time_t last;
+            if( sz >= 100000 ) { 
+                if( time(0) - last > 300 ) {
+                    last = time(0);
+                    log() << "warning number of open cursors is very large: " << sz << endl;
                 }
             }
-            for ( CCById::iterator i = clientCursorsById.begin(); i != clientCursorsById.end();  ) {
-                CCById::iterator j = i;
-                i++;
-                if( j->second->shouldTimeout( millis ) ) {
+        }
+        for ( int s = 0; s < NumShards; s++ ) {
+            CCShard& shard = clientCursorShards[s];
+            SimpleMutex::scoped_lock lk(shard.mutex);
+            for ( CCById::iterator i = shard.cursors.begin(); i != shard.cursors.end(); ++i ) {
+                if( i->second->shouldTimeout( millis ) ) {
                     foundSomeToTimeout = true;
                 }
             }
@@ -388,21 +422,31 @@ namespace mongo {
             Lock::GlobalRead lk;
 
             recursive_scoped_lock cclock(ccmutex);
-            CCById::const_iterator it = clientCursorsById.begin();
-            while (it != clientCursorsById.end()) {
-                ClientCursor* cc = it->second;
-                if( cc->shouldTimeout(0) ) {
+            for ( int s = 0; s < NumShards; s++ ) {
+                // take the timed out cursors out of the shard so they can't be pinned any more,
+                // and delete them once we've let go of its mutex
+                vector<ClientCursor*> toDelete;
+                {
+                    CCShard& shard = clientCursorShards[s];
+                    SimpleMutex::scoped_lock shardLock(shard.mutex);
+                    CCById::iterator it = shard.cursors.begin();
+                    while (it != shard.cursors.end()) {
+                        if( it->second->shouldTimeout(0) ) {
+                            toDelete.push_back(it->second);
+                            shard.cursors.erase(it++);
+                        }
+                        else {
+                            ++it;
+                        }
+                    }
+                }
+
+                for ( size_t i = 0; i < toDelete.size(); i++ ) {
+                    ClientCursor* cc = toDelete[i];
                     numberTimedOut++;
                     LOG(1) << "killing old cursor " << cc->_cursorid << ' ' << cc->_ns
                            << " idle:" << cc->idleTime() << "ms\n";
-                    ClientCursor* toDelete = it->second;
-                    CursorId id = toDelete->cursorid();
-                    // This is what winds up removing it from the map.
-                    delete toDelete;
-                    it = clientCursorsById.upper_bound(id);
-                }
-                else {
-                    ++it;
+                    delete cc;
                 }
             }
         }
@@ -415,18 +459,21 @@ namespace mongo {
     }
 
     void ClientCursor::appendStats( BSONObjBuilder& result ) {
-        recursive_scoped_lock lock(ccmutex);
-        result.appendNumber("totalOpen", clientCursorsById.size() );
+        result.appendNumber("totalOpen", (int) numCursors());
         result.appendNumber("clientCursors_size", (int) numCursors());
         result.appendNumber("timedOut" , numberTimedOut);
         unsigned pinned = 0;
         unsigned notimeout = 0;
-        for ( CCById::iterator i = clientCursorsById.begin(); i != clientCursorsById.end(); i++ ) {
-            unsigned p = i->second->_pinValue;
-            if( p >= 100 )
-                pinned++;
-            else if( p > 0 )
-                notimeout++;
+        for ( int s = 0; s < NumShards; s++ ) {
+            CCShard& shard = clientCursorShards[s];
+            SimpleMutex::scoped_lock lk(shard.mutex);
+            for ( CCById::iterator i = shard.cursors.begin(); i != shard.cursors.end(); i++ ) {
+                unsigned p = i->second->_pinValue;
+                if( p >= 100 )
+                    pinned++;
+                else if( p > 0 )
+                    notimeout++;
+            }
         }
         if( pinned ) 
             result.append("pinned", pinned);
@@ -462,7 +509,11 @@ namespace mongo {
 
             if ( x < 0 ) { x *= -1; }
 
-            if ( ts != cursorGenTSLast || ClientCursor::find_inlock(x, false) == 0 )
+            if ( ts != cursorGenTSLast )
+                break;
+
+            SimpleMutex::scoped_lock lk(shardFor(x).mutex);
+            if ( find_inlock(x, false) == 0 )
                 break;
         }
 
@@ -472,8 +523,9 @@ namespace mongo {
 
     // static
     ClientCursor* ClientCursor::find_inlock(CursorId id, bool warn) {
-        CCById::iterator it = clientCursorsById.find(id);
-        if ( it == clientCursorsById.end() ) {
+        CCById& cursors = shardFor(id).cursors;
+        CCById::iterator it = cursors.find(id);
+        if ( it == cursors.end() ) {
             if ( warn ) {
                 OCCASIONALLY out() << "ClientCursor::find(): cursor not found in map '" << id
                     << "' (ok after a drop)" << endl;
@@ -486,15 +538,19 @@ namespace mongo {
     void ClientCursor::find( const string& ns , set<CursorId>& all ) {
         recursive_scoped_lock lock(ccmutex);
 
-        for ( CCById::iterator i=clientCursorsById.begin(); i!=clientCursorsById.end(); ++i ) {
-            if ( i->second->_ns == ns )
-                all.insert( i->first );
+        CCByNs::const_iterator cursors = clientCursorsByNs.find(ns);
+        if ( cursors == clientCursorsByNs.end() )
+            return;
+        for ( set<ClientCursor*>::const_iterator i = cursors->second.begin();
+              i != cursors->second.end();
+              ++i ) {
+            all.insert( (*i)->_cursorid );
         }
     }
 
     // static
     ClientCursor* ClientCursor::find(CursorId id, bool warn) {
-        recursive_scoped_lock lock(ccmutex);
+        SimpleMutex::scoped_lock lk(shardFor(id).mutex);
         ClientCursor *c = find_inlock(id, warn);
         // if this asserts, your code was not thread safe - you either need to set no timeout
         // for the cursor or keep a ClientCursor::Pointer in scope for it.
@@ -503,17 +559,28 @@ namespace mongo {
     }
 
     void ClientCursor::_erase_inlock(ClientCursor* cursor) {
-        // Must not have an active ClientCursor::Pin.
-        massert( 16089,
-                str::stream() << "Cannot kill active cursor " << cursor->cursorid(),
-                cursor->_pinValue < 100 );
+        {
+            // Must not have an active ClientCursor::Pin.  Taking the cursor out of its shard
+            // keeps anyone from pinning it before it is deleted.
+            CCShard& shard = shardFor(cursor->_cursorid);
+            SimpleMutex::scoped_lock lk(shard.mutex);
+            massert( 16089,
+                    str::stream() << "Cannot kill active cursor " << cursor->cursorid(),
+                    cursor->_pinValue < 100 );
+            shard.cursors.erase(cursor->_cursorid);
+        }
 
         delete cursor;
     }
 
     bool ClientCursor::erase(CursorId id) {
+        // holding ccmutex keeps the cursor from being deleted under us
         recursive_scoped_lock lock(ccmutex);
-        ClientCursor* cursor = find_inlock(id);
+        ClientCursor* cursor;
+        {
+            SimpleMutex::scoped_lock lk(shardFor(id).mutex);
+            cursor = find_inlock(id);
+        }
         if (!cursor) { return false; }
         _erase_inlock(cursor);
         return true;
@@ -534,7 +601,7 @@ namespace mongo {
     bool ClientCursor::eraseIfAuthorized(CursorId id) {
         NamespaceString ns;
         {
-            recursive_scoped_lock lock(ccmutex);
+            SimpleMutex::scoped_lock lk(shardFor(id).mutex);
             ClientCursor* cursor = find_inlock(id);
             if (!cursor) {
                 audit::logKillCursorsAuthzCheck(
@@ -563,7 +630,11 @@ namespace mongo {
         // of 2 invariants: that the cursor ID won't be re-used in a short period of time, and that
         // the namespace associated with a cursor cannot change.
         recursive_scoped_lock lock(ccmutex);
-        ClientCursor* cursor = find_inlock(id);
+        ClientCursor* cursor;
+        {
+            SimpleMutex::scoped_lock lk(shardFor(id).mutex);
+            cursor = find_inlock(id);
+        }
         if (!cursor) {
             // Cursor was deleted in another thread since we found it earlier in this function.
             return false;
@@ -613,7 +684,7 @@ namespace mongo {
     //
 
     ClientCursorPin::ClientCursorPin(long long cursorid) : _cursorid( INVALID_CURSOR_ID ) {
-        recursive_scoped_lock lock( ClientCursor::ccmutex );
+        SimpleMutex::scoped_lock lk( ClientCursor::shardFor( cursorid ).mutex );
         ClientCursor *cursor = ClientCursor::find_inlock( cursorid, true );
         if (NULL != cursor) {
             uassert( 12051, "clientcursor already in use? driver problem?",
@@ -629,7 +700,8 @@ namespace mongo {
         if ( _cursorid == INVALID_CURSOR_ID ) {
             return;
         }
-        ClientCursor *cursor = c();
+        SimpleMutex::scoped_lock lk( ClientCursor::shardFor( _cursorid ).mutex );
+        ClientCursor *cursor = ClientCursor::find_inlock( _cursorid );
         _cursorid = INVALID_CURSOR_ID;
         if ( cursor ) {
             verify( cursor->_pinValue >= 100 );
@@ -39,10 +39,12 @@
 #include "mongo/db/matcher.h"
 #include "mongo/db/projection.h"
 #include "mongo/db/query/runner.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/s/collection_metadata.h"
 #include "mongo/util/net/message.h"
 #include "mongo/util/background.h"
 #include "mongo/util/elapsed_tracker.h"
+#include "mongo/util/memory_usage.h"
 
 namespace mongo {
 
@@ -125,7 +127,7 @@ namespace mongo {
         // ClientCursor creation/deletion.
         //
 
-        static unsigned numCursors() { return clientCursorsById.size(); }
+        static unsigned numCursors() { return numOpenCursors.load(); }
         static void find( const string& ns , set<CursorId>& all );
         static ClientCursor* find(CursorId id, bool warn = true);
 
@@ -199,6 +201,19 @@ namespace mongo {
         void incPos(int n) { _pos += n; }
         void setPos(int n) { _pos = n; }
 
+        // Shape of the query, empty unless its getMores go to queryShapeStats.
+        const std::string& queryShape() const { return _queryShape; }
+        void setQueryShape(const std::string& shape) { _queryShape = shape; }
+
+        // Keys and documents the runner had examined when the last batch was returned, so that
+        // each getMore counts only its own.
+        long long keysExamined() const { return _keysExamined; }
+        long long docsExamined() const { return _docsExamined; }
+        void setExamined(long long keys, long long docs) {
+            _keysExamined = keys;
+            _docsExamined = docs;
+        }
+
         //
         // Yielding that is DEPRECATED.  Will be removed when we use runners and they yield
         // internally.
@@ -252,10 +267,20 @@ namespace mongo {
         friend struct ClientCursorYieldLock;
         friend class CmdCursorInfo;
 
-        // A map from the CursorId to the ClientCursor behind it.
-        // TODO: Consider making this per-connection.
+        // A map from the CursorId to the ClientCursor behind it, split into NumShards shards by
+        // the low (random) bits of the id.  Looking up and pinning a cursor on getMore only takes
+        // its shard's mutex; the pin value of a cursor is protected by that mutex as well.
         typedef map<CursorId, ClientCursor*> CCById;
-        static CCById clientCursorsById;
+        struct CCShard;
+        static const int NumShards = 16;
+        static CCShard* clientCursorShards;
+        static CCShard& shardFor(CursorId id);
+        static AtomicUInt32 numOpenCursors;
+
+        // The cursors open on each namespace, so invalidation only visits the cursors of the
+        // collection (or database) concerned.
+        typedef map<string, set<ClientCursor*> > CCByNs;
+        static CCByNs clientCursorsByNs;
 
         // A list of NON-CACHED runners.  Any runner that yields must be put into this map before
         // yielding in order to be notified of invalidation and namespace deletion.  Before the
@@ -267,7 +292,8 @@ namespace mongo {
         // How many cursors have timed out?
         static long long numberTimedOut;
 
-        // This must be held when modifying any static member.
+        // This must be held when creating or deleting a ClientCursor and when modifying any static
+        // member other than the id shards.  It is taken before a shard's mutex, never after.
         static boost::recursive_mutex& ccmutex;
 
         /**
@@ -284,13 +310,13 @@ namespace mongo {
 
         /**
          * Find the ClientCursor with the provided ID.  Optionally warn if it's not found.
-         * Assumes ccmutex is held.
+         * Assumes the mutex of the id's shard is held.
          */
-
         static ClientCursor* find_inlock(CursorId id, bool warn = true);
 
         /**
          * Delete the ClientCursor with the provided ID.  masserts if the cursor is pinned.
+         * Assumes ccmutex is held, but not the cursor's shard mutex.
          */
         static void _erase_inlock(ClientCursor* cursor);
 
@@ -331,6 +357,10 @@ namespace mongo {
         // TODO: Document.
         uint64_t _leftoverMaxTimeMicros;
 
+        std::string _queryShape;
+        long long _keysExamined;
+        long long _docsExamined;
+
         // For chunks that are being migrated, there is a period of time when that chunks data is in
         // two shards, the donor and the receiver one. That data is picked up by a cursor on the
         // receiver side, even before the migration was decided.  The CollectionMetadata allow one
@@ -344,6 +374,9 @@ namespace mongo {
 
         // The new world: a runner.
         scoped_ptr<Runner> _runner;
+
+        // Counts this cursor in the process-wide memory usage accounting.
+        MemoryUsageTracker _memoryUsage;
     };
 
     /**
@@ -0,0 +1,127 @@
+// bench_commands.cpp
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+/*
+ * Defines commands that run benchRun activities from the server, so that a shell can drive load
+ * from many hosts at once (see benchRunDistributed() in the shell).
+ */
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/init.h"
+#include "mongo/base/status.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/scripting/bench.h"
+
+namespace mongo {
+
+    // Testing only, enabled via command-line.
+    class CmdBenchRunStart : public Command {
+    public:
+        CmdBenchRunStart() : Command("benchRunStart") {}
+        virtual LockType locktype() const { return NONE; }
+        virtual bool slaveOk() const { return true; }
+        virtual bool adminOnly() const { return true; }
+        // No auth needed because it only works when enabled via command line.
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {}
+        virtual void help( stringstream& help ) const {
+            help << "start a benchRun activity from this server, returning its id\n"
+                 << "{ benchRunStart : { ops : [...], host : ..., parallel : ..., ... } }";
+        }
+
+        bool run( const string& db,
+                  BSONObj& cmdObj,
+                  int options, string& errmsg,
+                  BSONObjBuilder& result,
+                  bool fromRepl = false ) {
+            if ( cmdObj.firstElement().type() != Object ) {
+                errmsg = "benchRunStart takes the benchRun options";
+                return false;
+            }
+
+            BenchRunner* runner = BenchRunner::createWithConfig( cmdObj.firstElement().Obj() );
+            runner->start();
+            result.append( "id", runner->oid().toString() );
+            return true;
+        }
+    };
+
+    // Testing only, enabled via command-line.
+    class CmdBenchRunFinish : public Command {
+    public:
+        CmdBenchRunFinish() : Command("benchRunFinish") {}
+        virtual LockType locktype() const { return NONE; }
+        virtual bool slaveOk() const { return true; }
+        virtual bool adminOnly() const { return true; }
+        // No auth needed because it only works when enabled via command line.
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {}
+        virtual void help( stringstream& help ) const {
+            help << "stop a benchRun activity started by benchRunStart and return its results\n"
+                 << "{ benchRunFinish : <id> }";
+        }
+
+        bool run( const string& db,
+                  BSONObj& cmdObj,
+                  int options, string& errmsg,
+                  BSONObjBuilder& result,
+                  bool fromRepl = false ) {
+            BSONElement id = cmdObj.firstElement();
+            if ( id.type() != String || id.valuestrsize() != 25 ) {
+                errmsg = "benchRunFinish takes the id returned by benchRunStart";
+                return false;
+            }
+
+            BenchRunner* runner = BenchRunner::get( OID( id.String() ) );
+            if ( ! runner ) {
+                errmsg = str::stream() << "no benchRun with id " << id.String();
+                return false;
+            }
+
+            result.append( "results", BenchRunner::finish( runner ) );
+            return true;
+        }
+    };
+
+    MONGO_INITIALIZER(RegisterBenchRunCmds)(InitializerContext* context) {
+        if (Command::testCommandsEnabled) {
+            // Leaked intentionally: a Command registers itself when constructed.
+            new CmdBenchRunStart();
+            new CmdBenchRunFinish();
+        }
+        return Status::OK();
+    }
+}
@@ -239,12 +239,13 @@ namespace mongo {
             }
 
             for ( list<BSONObj>::iterator i=all.begin(); i!=all.end(); i++ ) {
-                BSONObj o = *i;
-                LOG(1) << "reIndex ns: " << toDeleteNs << " index: " << o << endl;
-                Status s = collection->getIndexCatalog()->createIndex( o, false );
-                if ( !s.isOK() )
-                    return appendCommandStatus( result, s );
+                LOG(1) << "reIndex ns: " << toDeleteNs << " index: " << *i << endl;
             }
+            // rebuild them all with a single scan of the collection
+            s = collection->getIndexCatalog()->createIndexes(
+                vector<BSONObj>( all.begin(), all.end() ), false );
+            if ( !s.isOK() )
+                return appendCommandStatus( result, s );
 
             result.append( "nIndexes" , (int)all.size() );
             result.appendArray( "indexes" , b.obj() );
@@ -34,13 +34,14 @@
 
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/commands.h"
-#include "mongo/db/dbhelpers.h"
-#include "mongo/db/instance.h"
 #include "mongo/db/pagefault.h"
+#include "mongo/db/projection.h"
+#include "mongo/db/query/get_runner.h"
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/ops/update.h"
 #include "mongo/db/ops/update_lifecycle_impl.h"
-#include "mongo/db/queryutil.h"
+#include "mongo/db/repl/oplog.h"
+#include "mongo/db/structure/collection.h"
 
 namespace mongo {
 
@@ -64,15 +65,18 @@ namespace mongo {
                                            std::vector<Privilege>* out) {
             find_and_modify::addPrivilegesRequiredForFindAndModify(this, dbname, cmdObj, out);
         }
-        /* this will eventually replace run,  once sort is handled */
-        bool runNoDirectClient( const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool) {
-            verify( cmdObj["sort"].eoo() );
 
+        virtual bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool) {
             string ns = dbname + '.' + cmdObj.firstElement().valuestr();
 
             BSONObj query = cmdObj.getObjectField("query");
             BSONObj fields = cmdObj.getObjectField("fields");
             BSONObj update = cmdObj.getObjectField("update");
+
+            BSONObj sort;
+            BSONElement sortElt = cmdObj["sort"];
+            if ( !sortElt.eoo() )
+                sort = sortElt.embeddedObjectUserCheck();
             
             bool upsert = cmdObj["upsert"].trueValue();
             bool returnNew = cmdObj["new"].trueValue();
@@ -96,17 +100,16 @@ namespace mongo {
             PageFaultRetryableSection s;
             while ( 1 ) {
                 try {
-                    return runNoDirectClient( ns , 
-                                              query , fields , update , 
-                                              upsert , returnNew , remove , 
-                                              result , errmsg );
+                    BSONObjBuilder b;
+                    runOnce( ns , query , fields , update , sort ,
+                             upsert , returnNew , remove , b );
+                    result.appendElements( b.done() );
+                    return true;
                 }
                 catch ( PageFaultException& e ) {
                     e.touch();
                 }
             }
-
-                    
         }
 
         void _appendHelper( BSONObjBuilder& result , const BSONObj& doc , bool found , const BSONObj& fields ) {
@@ -126,265 +129,109 @@ namespace mongo {
                 
         }
 
-        bool runNoDirectClient( const string& ns , 
-                                const BSONObj& queryOriginal , const BSONObj& fields , const BSONObj& update , 
-                                bool upsert , bool returnNew , bool remove ,
-                                BSONObjBuilder& result , string& errmsg ) {
-            
-            
-            Lock::DBWrite lk( ns );
-            Client::Context cx( ns );
-
-            BSONObj doc;
-            bool found = Helpers::findOne( ns.c_str() , queryOriginal , doc );
-
-            BSONObj queryModified = queryOriginal;
-            if ( found && doc["_id"].type() && ! isSimpleIdQuery( queryOriginal ) ) {
-                // we're going to re-write the query to be more efficient
-                // we have to be a little careful because of positional operators
-                // maybe we can pass this all through eventually, but right now isn't an easy way
-                
-                bool hasPositionalUpdate = false;
-                {
-                    // if the update has a positional piece ($)
-                    // then we need to pull all query parts in
-                    // so here we check for $
-                    // a little hacky
-                    BSONObjIterator i( update );
-                    while ( i.more() ) {
-                        const BSONElement& elem = i.next();
-                        
-                        if ( elem.fieldName()[0] != '$' || elem.type() != Object )
-                            continue;
+        /**
+         * Removes the first document matching query in sort order, which it copies to *doc.
+         * The document found is removed right away, without looking it up again.
+         * @return false if there was none
+         */
+        bool _removeFirst( const string& ns , const BSONObj& query , const BSONObj& sort ,
+                           BSONObj* doc ) {
+            Collection* collection = cc().database()->getCollection( ns );
+            assertCanDeleteFrom( ns, collection ? collection->details() : NULL );
+            if ( !collection )
+                return false;
 
-                        BSONObjIterator j( elem.Obj() );
-                        while ( j.more() ) {
-                            if ( str::contains( j.next().fieldName(), ".$" ) ) {
-                                hasPositionalUpdate = true;
-                                break;
-                            }
-                        }
-                    }
-                }
+            CanonicalQuery* cq;
+            uassertStatusOK( CanonicalQuery::canonicalize( ns, query, sort, BSONObj(), &cq ) );
 
-                BSONObjBuilder b( queryOriginal.objsize() + 10 );
-                b.append( doc["_id"] );
-                
-                bool addedAtomic = false;
+            Runner* rawRunner;
+            uassertStatusOK( getRunner( cq, &rawRunner ) );
+            auto_ptr<Runner> runner( rawRunner );
 
-                BSONObjIterator i( queryOriginal );
-                while ( i.more() ) {
-                    const BSONElement& elem = i.next();
+            BSONObj obj;
+            DiskLoc loc;
+            if ( Runner::RUNNER_ADVANCED != runner->getNext( &obj, &loc ) )
+                return false;
+            *doc = obj.getOwned();
 
-                    if ( str::equals( "_id" , elem.fieldName() ) ) {
-                        // we already do _id
-                        continue;
-                    }
-                    
-                    if ( ! hasPositionalUpdate ) {
-                        // if there is a dotted field, accept we may need more query parts
-                        continue;
-                    }
-                    
-                    if ( ! addedAtomic ) {
-                        b.appendBool( "$atomic" , true );
-                        addedAtomic = true;
-                    }
+            // log only once the delete is done, so a failed one never reaches the secondaries
+            collection->deleteDocument( loc );
 
-                    b.append( elem );
-                }
-                queryModified = b.obj();
+            BSONElement idElt;
+            if ( doc->getObjectID( idElt ) ) {
+                BSONObjBuilder bob;
+                bob.append( idElt );
+                bool replJustOne = true;
+                logOp( "d", ns.c_str(), bob.done(), 0, &replJustOne );
+            }
+            else {
+                problem() << "deleted object without id, not logging" << endl;
             }
+            return true;
+        }
+
+        /**
+         * The document is found, modified and its images taken in one pass: a remove deletes
+         * the document its query finds, and an update has the update code keep the document it
+         * changed as it was and as it became, so that neither looks it up a second time.
+         */
+        void runOnce( const string& ns ,
+                      const BSONObj& query , const BSONObj& fields , const BSONObj& update ,
+                      const BSONObj& sort ,
+                      bool upsert , bool returnNew , bool remove ,
+                      BSONObjBuilder& result ) {
+            
+            Lock::DBWrite lk( ns );
+            Client::Context cx( ns );
 
             if ( remove ) {
+                BSONObj doc;
+                bool found = _removeFirst( ns , query , sort , &doc );
                 _appendHelper( result , doc , found , fields );
                 if ( found ) {
-                    deleteObjects( ns , queryModified , true , true );
                     BSONObjBuilder le( result.subobjStart( "lastErrorObject" ) );
                     le.appendNumber( "n" , 1 );
                     le.done();
                 }
+                return;
             }
-            else {
-                // update
-                if ( ! found && ! upsert ) {
-                    // didn't have it, and am not upserting
-                    _appendHelper( result , doc , found , fields );
-                }
-                else {
-                    // we found it or we're updating
-                    
-                    if ( ! returnNew ) {
-                        _appendHelper( result , doc , found , fields );
-                    }
-                    
-                    const NamespaceString requestNs(ns);
-                    UpdateRequest request(requestNs);
-
-                    request.setQuery(queryModified);
-                    request.setUpdates(update);
-                    request.setUpsert(upsert);
-                    request.setUpdateOpLog();
-                    // TODO(greg) We need to send if we are ignoring
-                    // the shard version below, but for now no
-                    UpdateLifecycleImpl updateLifecycle(false, requestNs);
-                    request.setLifecycle(&updateLifecycle);
-                    UpdateResult res = mongo::update(request, &cc().curop()->debug());
-
-                    LOG(3) << "update result: "  << res ;
-                    if ( returnNew ) {
-                        if ( !res.upserted.isEmpty() ) {
-                            BSONElement upsertedElem = res.upserted[kUpsertedFieldName];
-                            LOG(3) << "using new _id to get new doc: "
-                                   << upsertedElem;
-                            queryModified = upsertedElem.wrap("_id");
-                        }
-                        else if ( queryModified["_id"].type() ) {
-                            // we do this so that if the update changes the fields, it still matches
-                            queryModified = queryModified["_id"].wrap();
-                        }
-
-                        LOG(3) << "using modified query to return the new doc: " << queryModified;
-                        if ( ! Helpers::findOne( ns.c_str() , queryModified , doc ) ) {
-                            errmsg = str::stream() << "can't find object after modification  " 
-                                                   << " ns: " << ns 
-                                                   << " queryModified: " << queryModified 
-                                                   << " queryOriginal: " << queryOriginal;
-                            log() << errmsg << endl;
-                            return false;
-                        }
-                        _appendHelper( result , doc , true , fields );
-                    }
-                    
-                    BSONObjBuilder le( result.subobjStart( "lastErrorObject" ) );
-                    le.appendBool( "updatedExisting" , res.existing );
-                    le.appendNumber( "n" , res.numMatched );
-                    if ( !res.upserted.isEmpty() ) {
-                        le.append( res.upserted[kUpsertedFieldName] );
-                    }
-                    le.done();
-                    
-                }
-            }
-            
-            return true;
-        }
-        
-        virtual bool run(const string& dbname, BSONObj& cmdObj, int x, string& errmsg, BSONObjBuilder& result, bool y) {
-            static DBDirectClient db;
-
-            if ( cmdObj["sort"].eoo() )
-                return runNoDirectClient( dbname , cmdObj , x, errmsg , result, y );
-
-            string ns = dbname + '.' + cmdObj.firstElement().valuestr();
-
-            BSONObj origQuery = cmdObj.getObjectField("query"); // defaults to {}
-            Query q (origQuery);
-            BSONElement sort = cmdObj["sort"];
-            if (!sort.eoo())
-                q.sort(sort.embeddedObjectUserCheck());
-
-            bool upsert = cmdObj["upsert"].trueValue();
-
-            BSONObj fieldsHolder (cmdObj.getObjectField("fields"));
-            const BSONObj* fields = (fieldsHolder.isEmpty() ? NULL : &fieldsHolder);
 
-            Projection projection;
-            if (fields) {
-                projection.init(fieldsHolder);
-                if (!projection.includeID())
-                    fields = NULL; // do projection in post-processing
+            const NamespaceString requestNs(ns);
+            UpdateRequest request(requestNs);
+
+            request.setQuery(query);
+            request.setUpdates(update);
+            request.setSort(sort);
+            request.setUpsert(upsert);
+            request.setUpdateOpLog();
+            request.setStoreResultDocs();
+            // TODO(greg) We need to send if we are ignoring
+            // the shard version below, but for now no
+            UpdateLifecycleImpl updateLifecycle(false, requestNs);
+            request.setLifecycle(&updateLifecycle);
+            UpdateResult res = mongo::update(request, &cc().curop()->debug());
+
+            LOG(3) << "update result: "  << res ;
+            if ( res.numMatched == 0 ) {
+                // didn't have it, and am not upserting
+                _appendHelper( result , BSONObj() , false , fields );
+                return;
             }
 
-            BSONObj out = db.findOne(ns, q, fields);
-            if (out.isEmpty()) {
-                if (!upsert) {
-                    result.appendNull("value");
-                    return true;
-                }
-
-                BSONElement update = cmdObj["update"];
-                uassert(13329, "upsert mode requires update field", !update.eoo());
-                uassert(13330, "upsert mode requires query field", !origQuery.isEmpty());
-                db.update(ns, origQuery, update.embeddedObjectUserCheck(), true);
-
-                BSONObj gle = db.getLastErrorDetailed(dbname);
-                result.append("lastErrorObject", gle);
-                if (gle["err"].type() == String) {
-                    errmsg = gle["err"].String();
-                    return false;
-                }
-
-                if (cmdObj["new"].trueValue()) {
-                    BSONObjBuilder bob;
-                    BSONElement _id = gle[kUpsertedFieldName];
-                    if (!_id.eoo())
-                        bob.appendAs(_id, "_id");
-                    else
-                        bob.appendAs(origQuery["_id"], "_id");
-
-                    out = db.findOne(ns, bob.done(), fields);
-                }
-
+            if ( returnNew ) {
+                _appendHelper( result , res.newDoc , true , fields );
             }
             else {
-
-                if (cmdObj["remove"].trueValue()) {
-                    uassert(12515, "can't remove and update", cmdObj["update"].eoo());
-                    db.remove(ns, QUERY("_id" << out["_id"]), 1);
-
-                    BSONObj gle = db.getLastErrorDetailed(dbname);
-                    result.append("lastErrorObject", gle);
-                    if (gle["err"].type() == String) {
-                        errmsg = gle["err"].String();
-                        return false;
-                    }
-
-                }
-                else {   // update
-
-                    BSONElement queryId = origQuery["_id"];
-                    if (queryId.eoo() || getGtLtOp(queryId) != BSONObj::Equality) {
-                        // need to include original query for $ positional operator
-
-                        BSONObjBuilder b;
-                        b.append(out["_id"]);
-                        BSONObjIterator it(origQuery);
-                        while (it.more()) {
-                            BSONElement e = it.next();
-                            if (strcmp(e.fieldName(), "_id"))
-                                b.append(e);
-                        }
-                        q = Query(b.obj());
-                    }
-
-                    if (q.isComplex()) // update doesn't work with complex queries
-                        q = Query(q.getFilter().getOwned());
-
-                    BSONElement update = cmdObj["update"];
-                    uassert(12516, "must specify remove or update", !update.eoo());
-                    db.update(ns, q, update.embeddedObjectUserCheck());
-
-                    BSONObj gle = db.getLastErrorDetailed(dbname);
-                    result.append("lastErrorObject", gle);
-                    if (gle["err"].type() == String) {
-                        errmsg = gle["err"].String();
-                        return false;
-                    }
-
-                    if (cmdObj["new"].trueValue())
-                        out = db.findOne(ns, QUERY("_id" << out["_id"]), fields);
-                }
+                _appendHelper( result , res.oldDoc , res.existing , fields );
             }
 
-            if (!fieldsHolder.isEmpty() && !fields){
-                // we need to run projection but haven't yet
-                out = projection.transform(out);
+            BSONObjBuilder le( result.subobjStart( "lastErrorObject" ) );
+            le.appendBool( "updatedExisting" , res.existing );
+            le.appendNumber( "n" , res.numMatched );
+            if ( !res.upserted.isEmpty() ) {
+                le.append( res.upserted[kUpsertedFieldName] );
             }
-
-            result.append("value", out);
-
-            return true;
+            le.done();
         }
     } cmdFindAndModify;
 
@@ -34,6 +34,7 @@
 #include "mongo/db/commands.h"
 #include "mongo/db/db.h"
 #include "mongo/db/storage/index_details.h"
+#include "mongo/db/index_names.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/namespace_details.h"
@@ -79,6 +80,7 @@ namespace mongo {
         SummaryEstimators<double, quantiles> bsonRatio;
         SummaryEstimators<double, quantiles> fillRatio;
         SummaryEstimators<double, quantiles> keyNodeRatio;
+        SummaryEstimators<double, quantiles> prefixRatio;
         SummaryEstimators<unsigned int, quantiles> keyCount;
         SummaryEstimators<unsigned int, quantiles> usedKeyCount;
 
@@ -96,10 +98,11 @@ namespace mongo {
          * @param usedKeyCount number of used (non-empty) keys in the bucket
          * @param bucket current bucket
          * @param keyNodeBytes size (number of bytes) of a KeyNode
+         * @param prefixRatio fraction of the key data that repeats the start of the previous key
          */
         template<class Version>
         void addStats(int keyCount, int usedKeyCount, const BtreeBucket<Version>* bucket,
-                      int keyNodeBytes) {
+                      int keyNodeBytes, double prefixRatio) {
             this->numBuckets++;
             this->keyCount << keyCount;
             this->usedKeyCount << usedKeyCount;
@@ -108,6 +111,7 @@ namespace mongo {
                     (static_cast<double>(keyNodeBytes * keyCount) / bucket->bodySize());
             this->fillRatio <<
                     (1.0 - static_cast<double>(bucket->getEmptySize()) / bucket->bodySize());
+            this->prefixRatio << prefixRatio;
         }
 
         void appendTo(BSONObjBuilder& builder) const {
@@ -128,7 +132,8 @@ namespace mongo {
                     << "usedKeyCount" << usedKeyCount.statisticSummaryToBSONObj()
                     << "bsonRatio" << bsonRatio.statisticSummaryToBSONObj()
                     << "keyNodeRatio" << keyNodeRatio.statisticSummaryToBSONObj()
-                    << "fillRatio" << fillRatio.statisticSummaryToBSONObj();
+                    << "fillRatio" << fillRatio.statisticSummaryToBSONObj()
+                    << "prefixRatio" << prefixRatio.statisticSummaryToBSONObj();
         }
     };
 
@@ -276,11 +281,18 @@ namespace mongo {
 
             const _KeyNode* firstKeyNode = NULL;
             const _KeyNode* lastKeyNode = NULL;
+            long long keyBytes = 0;
+            long long sharedPrefixBytes = 0;
             for (int i = 0; i < keyCount; i++ ) {
                 const _KeyNode& kn = bucket->k(i);
 
                 if (kn.isUsed()) {
                     ++usedKeyCount;
+                    if (lastKeyNode != NULL) {
+                        sharedPrefixBytes += sharedPrefix(KeyNode(*bucket, *lastKeyNode).key,
+                                                          KeyNode(*bucket, kn).key);
+                    }
+                    keyBytes += KeyNode(*bucket, kn).key.dataSize();
                     if (i == 0) {
                         firstKeyNode = &kn;
                     }
@@ -295,6 +307,10 @@ namespace mongo {
 
             killCurrentOp.checkForInterrupt();
 
+            // how much per bucket prefix compression of the keys could save
+            const double prefixRatio =
+                    keyBytes ? static_cast<double>(sharedPrefixBytes) / keyBytes : 0;
+
             if (parentIsExpanded) {
                 // stats for the children of this bucket have been added in the recursive calls,
                 // avoid including the current bucket in the stats for its subtree
@@ -306,9 +322,10 @@ namespace mongo {
             // the entire tree
             for (unsigned int d = 0; d < expandedAncestors.size(); ++d) {
                 AreaStats& nodeStats = _stats.nodeAt(d, expandedAncestors[d]);
-                nodeStats.addStats(keyCount, usedKeyCount, bucket, sizeof(_KeyNode));
+                nodeStats.addStats(keyCount, usedKeyCount, bucket, sizeof(_KeyNode), prefixRatio);
             }
-            _stats.wholeTree.addStats(keyCount, usedKeyCount, bucket, sizeof(_KeyNode));
+            _stats.wholeTree.addStats(keyCount, usedKeyCount, bucket, sizeof(_KeyNode),
+                                      prefixRatio);
 
             if (parentIsExpanded) {
                 NodeInfo nodeInfo;
@@ -335,11 +352,22 @@ namespace mongo {
                 _stats.perLevel.push_back(AreaStats());
             verify(_stats.perLevel.size() > depth);
             AreaStats& level = _stats.perLevel[depth];
-            level.addStats(keyCount, usedKeyCount, bucket, sizeof(_KeyNode));
+            level.addStats(keyCount, usedKeyCount, bucket, sizeof(_KeyNode), prefixRatio);
 
             return true;
         } 
 
+        /** @return number of leading bytes of b's key data that are the same as a's */
+        static int sharedPrefix(const Key& a, const Key& b) {
+            const char* p = a.data();
+            const char* q = b.data();
+            const int len = std::min(a.dataSize(), b.dataSize());
+            int n = 0;
+            while (n < len && p[n] == q[n])
+                n++;
+            return n;
+        }
+
         vector<int> _expandNodes;
         BtreeStats _stats;
     };
@@ -371,6 +399,13 @@ namespace mongo {
             return false;
         }
 
+        const string pluginName = IndexNames::findPluginName(details->keyPattern());
+        if (!IndexNames::isBtreeBased(pluginName)) {
+            errmsg = str::stream() << "the requested index is a " << pluginName << " index, "
+                                   << "not a btree";
+            return false;
+        }
+
         result << "index" << details->indexName()
                << "version" << details->version()
                << "isIdIndex" << details->isIdIndex()
@@ -434,6 +469,9 @@ namespace mongo {
      *               (same structure as keyCount)
      *           fillRatio: <stats about how full is the bucket body (bson objects + KeyNodes)>
      *               (same structure as keyCount)
+     *           prefixRatio: <stats about the fraction of a bucket's key data that repeats the
+     *                         start of the previous key, i.e. what prefix compression would save>
+     *               (same structure as keyCount)
      *       },
      *       perLevel: [ (statistics aggregated per depth)
      *           (one element with the same structure as 'overall' for each btree level,
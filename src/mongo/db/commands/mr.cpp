@@ -30,6 +30,9 @@
 
 #include "mongo/pch.h"
 
+#include <boost/thread/thread.hpp>
+#include "pcrecpp.h"
+
 #include "mongo/db/commands/mr.h"
 
 #include "mongo/client/connpool.h"
@@ -47,6 +50,7 @@
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/range_preserver.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/s/collection_metadata.h"
@@ -61,6 +65,12 @@ namespace mongo {
 
         AtomicUInt Config::JOB_NUMBER;
 
+        // number of threads running the JS map function of a mapReduce, each with its own Scope
+        MONGO_EXPORT_SERVER_PARAMETER(mapReduceMapThreads, int, 1);
+
+        // memory the Sorter holding spilled tuples may use before writing a sorted run to disk
+        MONGO_EXPORT_SERVER_PARAMETER(mapReduceSpillMaxMemoryBytes, int, 32 * 1024 * 1024);
+
         JSFunction::JSFunction( const std::string& type , const BSONElement& e ) {
             _type = type;
             _code = e._asCode();
@@ -70,7 +80,11 @@ namespace mongo {
         }
 
         void JSFunction::init( State * state ) {
-            _scope = state->scope();
+            init( state->scope() );
+        }
+
+        void JSFunction::init( Scope * scope ) {
+            _scope = scope;
             verify( _scope );
             _scope->init( &_wantedScope );
 
@@ -238,6 +252,176 @@ namespace mongo {
             _reduce( x , key , endSizeEstimate );
         }
 
+        namespace {
+        // a field path as written after 'this.' in JS, e.g. a.b
+#define MR_JS_PATH "[A-Za-z_$][\\w$]*(?:\\.[A-Za-z_$][\\w$]*)*"
+#define MR_JS_FUNCTION "\\s*function(?:\\s+[A-Za-z_$][\\w$]*)?\\s*"
+
+        const pcrecpp::RE nativeSumMap(
+                "^" MR_JS_FUNCTION "\\(\\s*\\)\\s*\\{\\s*"
+                "emit\\s*\\(\\s*this\\.(" MR_JS_PATH ")\\s*,\\s*"
+                "(?:this\\.(" MR_JS_PATH ")|(-?(?:0|[1-9]\\d*)(?:\\.\\d*)?(?:[eE][-+]?\\d+)?))"
+                "\\s*\\)\\s*;?\\s*\\}\\s*$");
+
+        const pcrecpp::RE nativeSumReduce(
+                "^" MR_JS_FUNCTION "\\(\\s*[A-Za-z_$][\\w$]*\\s*,\\s*([A-Za-z_$][\\w$]*)\\s*\\)"
+                "\\s*\\{\\s*return\\s+Array\\.sum\\s*\\(\\s*\\1\\s*\\)\\s*;?\\s*\\}\\s*$");
+
+#undef MR_JS_FUNCTION
+#undef MR_JS_PATH
+
+        // largest magnitude a JS Date can hold, in millis
+        const long long maxJSDate = 8640000000000000LL;
+
+        /**
+         * @return true if JS would turn 'e' into an emit key of the same type and value, once
+         * NumberInt is converted to a double like any other JS number
+         */
+        bool isNativeKey( const BSONElement& e ) {
+            switch ( e.type() ) {
+            case String:
+            case jstOID:
+            case Bool:
+            case jstNULL:
+            case NumberDouble:
+            case NumberInt:
+                return true;
+            case Date: {
+                const long long millis = e.date().asInt64();
+                return millis >= -maxJSDate && millis <= maxJSDate;
+            }
+            default:
+                return false;
+            }
+        }
+        }
+
+        NativeSumMapper* NativeSumMapper::make( const BSONElement& code ) {
+            // CodeWScope may change what emit means
+            if ( code.type() != Code && code.type() != String )
+                return NULL;
+
+            string keyPath;
+            string valuePath;
+            string constant;
+            if ( ! nativeSumMap.FullMatch( code.valuestr() , &keyPath , &valuePath , &constant ) )
+                return NULL;
+
+            return new NativeSumMapper( code , keyPath , valuePath ,
+                                        constant.empty() ? 0 : strtod( constant.c_str() , NULL ) );
+        }
+
+        NativeSumMapper::NativeSumMapper( const BSONElement& code , const string& keyPath ,
+                                          const string& valuePath , double constant )
+            : _js( code ) , _state( NULL ) , _keyPath( keyPath ) , _valuePath( valuePath ) ,
+              _constant( constant ) {
+        }
+
+        void NativeSumMapper::init( State * state ) {
+            _js.init( state );
+            _state = state;
+        }
+
+        /**
+         * Emits {"0": key, "1": value} just as fast_emit would receive it from the JS function
+         */
+        void NativeSumMapper::map( const BSONObj& o ) {
+            const BSONElement key = o.getFieldDotted( _keyPath );
+            double value = _constant;
+            bool native = isNativeKey( key );
+            if ( native && ! _valuePath.empty() ) {
+                const BSONElement e = o.getFieldDotted( _valuePath );
+                native = e.type() == NumberDouble || e.type() == NumberInt;
+                value = e.numberDouble();
+            }
+
+            if ( ! native ) {
+                _js.map( o );
+                return;
+            }
+
+            BSONObjBuilder b( key.size() + 16 );
+            if ( key.type() == NumberInt )
+                b.append( "0" , key.numberDouble() );
+            else
+                b.appendAs( key , "0" );
+            b.append( "1" , value );
+            BSONObj tuple = b.obj();
+
+            if ( tuple.objsize() >= BSONObjMaxUserSize / 2 ) {
+                // let fast_emit() report it
+                _js.map( o );
+                return;
+            }
+
+            _state->emit( tuple );
+        }
+
+        NativeSumReducer* NativeSumReducer::make( const BSONElement& code ) {
+            if ( code.type() != Code && code.type() != String )
+                return NULL;
+            if ( ! nativeSumReduce.FullMatch( code.valuestr() ) )
+                return NULL;
+            return new NativeSumReducer( code );
+        }
+
+        void NativeSumReducer::init( State * state ) {
+            _js.init( state );
+        }
+
+        bool NativeSumReducer::_sum( const BSONList& tuples , double* sum ) {
+            for ( unsigned i = 0; i < tuples.size(); i++ ) {
+                BSONObjIterator it( tuples[i] );
+                it.next();
+                const BSONElement value = it.next();
+                if ( value.type() != NumberDouble )
+                    return false;
+                *sum = i ? *sum + value._numberDouble() : value._numberDouble();
+            }
+            return true;
+        }
+
+        BSONObj NativeSumReducer::reduce( const BSONList& tuples ) {
+            if ( tuples.size() <= 1 )
+                return tuples[0];
+
+            double sum;
+            if ( ! _sum( tuples , &sum ) ) {
+                const long long before = _js.numReduces;
+                BSONObj res = _js.reduce( tuples );
+                numReduces += _js.numReduces - before;
+                return res;
+            }
+            ++numReduces;
+
+            BSONObjBuilder b;
+            b.appendAs( tuples[0].firstElement() , "0" );
+            b.append( "1" , sum );
+            return b.obj();
+        }
+
+        BSONObj NativeSumReducer::finalReduce( const BSONList& tuples , Finalizer * finalizer ) {
+            double sum;
+            if ( tuples.size() == 1 || ! _sum( tuples , &sum ) ) {
+                const long long before = _js.numReduces;
+                BSONObj res = _js.finalReduce( tuples , finalizer );
+                numReduces += _js.numReduces - before;
+                return res;
+            }
+            ++numReduces;
+
+            BSONObjBuilder b;
+            b.appendAs( tuples[0].firstElement() , "_id" );
+            b.append( "value" , sum );
+            BSONObj res = b.obj();
+
+            if ( finalizer ) {
+                res = finalizer->finalize( res );
+            }
+
+            return res;
+        }
+
         Config::Config( const string& _dbname , const BSONObj& cmdObj )
         {
             dbname = _dbname;
@@ -272,7 +456,6 @@ namespace mongo {
                         << cmdObj.firstElement().String()
                         << "_"
                         << JOB_NUMBER++;
-                incLong = tempNamespace + "_inc";
             }
 
             {
@@ -281,8 +464,30 @@ namespace mongo {
                 if ( cmdObj["scope"].type() == Object )
                     scopeSetup = cmdObj["scope"].embeddedObjectUserCheck();
 
-                mapper.reset( new JSMapper( cmdObj["map"] ) );
-                reducer.reset( new JSReducer( cmdObj["reduce"] ) );
+                // common map and reduce functions run natively, unless scope redefines Array
+                // (emit is always installed after scope)
+                const bool allowNative = ! scopeSetup.hasField( "Array" );
+
+                mapThreads = 1;
+
+                if ( allowNative )
+                    mapper.reset( NativeSumMapper::make( cmdObj["map"] ) );
+                if ( mapper ) {
+                    // the native mapper emits into the C++ map, not the JS one
+                    jsMode = false;
+                }
+                else {
+                    mapper.reset( new JSMapper( cmdObj["map"] ) );
+                    // in jsMode everything stays in the one JS scope
+                    if ( ! jsMode )
+                        mapThreads = std::max( 1 , mapReduceMapThreads );
+                    mapFunction = cmdObj["map"].wrap();
+                }
+
+                if ( allowNative )
+                    reducer.reset( NativeSumReducer::make( cmdObj["reduce"] ) );
+                if ( ! reducer )
+                    reducer.reset( new JSReducer( cmdObj["reduce"] ) );
                 if ( cmdObj["finalize"].type() && cmdObj["finalize"].trueValue() )
                     finalizer.reset( new JSFinalizer( cmdObj["finalize"] ) );
 
@@ -315,17 +520,12 @@ namespace mongo {
         }
 
         /**
-         * Clean up the temporary and incremental collections
+         * Clean up the temporary collection
          */
         void State::dropTempCollections() {
             _db.dropCollection(_config.tempNamespace);
             // Always forget about temporary namespaces, so we don't cache lots of them
             ShardConnection::forgetNS( _config.tempNamespace );
-            if (_useIncremental) {
-                _db.dropCollection(_config.incLong);
-                ShardConnection::forgetNS( _config.incLong );
-            }
-
         }
 
         /**
@@ -336,33 +536,6 @@ namespace mongo {
                 return;
 
             dropTempCollections();
-            if (_useIncremental) {
-                // Create the inc collection and make sure we have index on "0" key.
-                Client::WriteContext incCtx( _config.incLong );
-                Collection* incColl = incCtx.ctx().db()->getCollection( _config.incLong );
-                if ( !incColl ) {
-                    const BSONObj options = BSON( "autoIndexId" << false << "temp" << true );
-                    incColl = incCtx.ctx().db()->createCollection( _config.incLong, false,
-                                                                   &options, true );
-                    // Log the createCollection operation.
-                    BSONObjBuilder b;
-                    b.append( "create", nsToCollectionSubstring( _config.incLong ));
-                    b.appendElements( options );
-                    string logNs = nsToDatabase( _config.incLong ) + ".$cmd";
-                    logOp( "c", logNs.c_str(), b.obj() );
-                }
-
-                BSONObj indexSpec = BSON( "key" << BSON( "0" << 1 ) << "ns" << _config.incLong
-                                          << "name" << "_temp_0" );
-                Status status = incColl->getIndexCatalog()->createIndex( indexSpec, false );
-                // Log the createIndex operation.
-                string logNs = nsToDatabase( _config.incLong ) + ".system.indexes";
-                logOp( "i", logNs.c_str(), indexSpec );
-                if ( !status.isOK() ) {
-                    uasserted( 17305 , str::stream() << "createIndex failed for mr incLong ns: " <<
-                            _config.incLong << " err: " << status.code() );
-                }
-            }
 
             vector<BSONObj> indexesToInsert;
 
@@ -641,29 +814,29 @@ namespace mongo {
         }
 
         /**
-         * Insert doc into the inc collection
+         * Add tuple to the spill Sorter, which writes to temp files as it fills up
          */
-        void State::_insertToInc( BSONObj& o ) {
+        void State::_insertToSpill( const BSONObj& o ) {
             verify( _onDisk );
 
-            Client::WriteContext ctx( _config.incLong );
-            Collection* coll = ctx.ctx().db()->getCollection( _config.incLong );
-            if ( !coll )
-                uasserted(13631, str::stream() << "attempted to insert into nonexistent"
-                                                  " collection during a mr operation." <<
-                                                  " collection expected: " << _config.incLong );
+            if ( ! _spill ) {
+                SortOptions opts;
+                opts.maxMemoryUsageBytes = mapReduceSpillMaxMemoryBytes;
+                opts.extSortAllowed = true;
+                opts.tempDir = storageGlobalParams.dbpath + "/_tmp";
+                _spill.reset( TupleSorter::make( opts , TupleSorterCmp() ) );
+            }
 
-            coll->insertDocument( o, true );
-            logOp( "i", _config.incLong.c_str(), o );
-            getDur().commitIfNeeded();
+            _spill->add( o.getOwned() , BSONObj() );
+            _numSpilled++;
         }
 
         State::State(const Config& c) :
                 _config(c),
-                _useIncremental(true),
                 _size(0),
                 _dupCount(0),
-                _numEmits(0) {
+                _numEmits(0),
+                _numSpilled(0) {
             _temp.reset( new InMemory() );
             _onDisk = _config.outputOptions.outType != Config::INMEMORY;
         }
@@ -917,97 +1090,43 @@ namespace mongo {
                 return;
             }
 
-            // use index on "0" to pull sorted data
+            // everything is in the spill Sorter, pull it back sorted by key
             verify( _temp->size() == 0 );
-            BSONObj sortKey = BSON( "0" << 1 );
-
-            {
-                Client::WriteContext incCtx( _config.incLong );
-                Collection* incColl = incCtx.ctx().db()->getCollection( _config.incLong );
-
-                bool foundIndex = false;
-                IndexCatalog::IndexIterator ii =
-                    incColl->getIndexCatalog()->getIndexIterator( true );
-                // Iterate over incColl's indexes.
-                while ( ii.more() ) {
-                    IndexDescriptor* currIndex = ii.next();
-                    BSONObj x = currIndex->infoObj();
-                    if ( sortKey.woCompare( x["key"].embeddedObject() ) == 0 ) {
-                        foundIndex = true;
-                        break;
-                    }
-                }
-
-                verify( foundIndex );
-            }
-
-            Client::ReadContext ctx( _config.incLong );
-
-            BSONObj prev;
-            BSONList all;
 
             verify(pm == op->setMessage("m/r: (3/3) final reduce to collection",
                                         "M/R: (3/3) Final Reduce Progress",
-                                        _db.count(_config.incLong, BSONObj(), QueryOption_SlaveOk)));
-
-            CanonicalQuery* cq;
-            verify(CanonicalQuery::canonicalize(_config.incLong, BSONObj(), sortKey, BSONObj(), &cq).isOK());
+                                        _numSpilled));
 
-            Runner* rawRunner;
-            verify(getRunner(cq, &rawRunner, QueryPlannerParams::NO_TABLE_SCAN).isOK());
+            if ( ! _spill ) {
+                // nothing was emitted
+                pm.finished();
+                return;
+            }
 
-            auto_ptr<Runner> runner(rawRunner);
-            auto_ptr<DeregisterEvenIfUnderlyingCodeThrows> safety;
-            ClientCursor::registerRunner(runner.get());
-            runner->setYieldPolicy(Runner::YIELD_AUTO);
-            safety.reset(new DeregisterEvenIfUnderlyingCodeThrows(runner.get()));
+            scoped_ptr<TupleSorter::Iterator> sorted( _spill->done() );
+            _spill.reset();
 
-            // iterate over all sorted objects
-            BSONObj o;
-            Runner::RunnerState state;
-            while (Runner::RUNNER_ADVANCED == (state = runner->getNext(&o, NULL))) {
+            BSONList all;
+            while ( sorted->more() ) {
+                const BSONObj o = sorted->next().first.getOwned();
                 pm.hit();
 
-                if ( o.woSortOrder( prev , sortKey ) == 0 ) {
-                    // object is same as previous, add to array
-                    all.push_back( o );
-                    if ( pm->hits() % 100 == 0 ) {
-                        killCurrentOp.checkForInterrupt();
-                    }
-                    continue;
-                }
-
-                runner->saveState();
-                auto_ptr<dbtempreleasecond> yield(new dbtempreleasecond());
-
-                try {
-                    // reduce a finalize array
+                if ( ! all.empty() && TupleSorterCmp()( make_pair( o , BSONObj() ) ,
+                                                        make_pair( all[0] , BSONObj() ) ) != 0 ) {
+                    // reduce and finalize the previous key
                     finalReduce( all );
+                    all.clear();
+                    killCurrentOp.checkForInterrupt();
                 }
-                catch (...) {
-                    yield.reset();
-                    throw;
+                else if ( pm->hits() % 100 == 0 ) {
+                    killCurrentOp.checkForInterrupt();
                 }
 
-                all.clear();
-                prev = o;
                 all.push_back( o );
-
-                yield.reset();
-                if (!runner->restoreState()) {
-                    break;
-                }
-
-                killCurrentOp.checkForInterrupt();
             }
 
-            {
-                dbtempreleasecond tl;
-                if ( ! tl.unlocked() )
-                    warning() << "map/reduce can't temp release" << endl;
-                // reduce and finalize last array
-                finalReduce( all );
-            }
+            // reduce and finalize last array
+            finalReduce( all );
 
             pm.finished();
         }
@@ -1036,8 +1155,8 @@ namespace mongo {
                 if ( all.size() == 1 ) {
                     // only 1 value for this key
                     if ( _onDisk ) {
-                        // this key has low cardinality, so just write to collection
-                        _insertToInc( *(all.begin()) );
+                        // this key has low cardinality, so just spill it
+                        _insertToSpill( *(all.begin()) );
                     }
                     else {
                         // add to new map
@@ -1057,27 +1176,41 @@ namespace mongo {
         }
 
         /**
-         * Dumps the entire in memory map to the inc collection.
+         * Dumps the entire in memory map to the spill Sorter.
          */
-        void State::dumpToInc() {
+        void State::dumpToSpill() {
             if ( ! _onDisk )
                 return;
 
-            Lock::DBWrite kl(_config.incLong);
-
             for ( InMemory::iterator i=_temp->begin(); i!=_temp->end(); i++ ) {
                 BSONList& all = i->second;
                 if ( all.size() < 1 )
                     continue;
 
                 for ( BSONList::iterator j=all.begin(); j!=all.end(); j++ )
-                    _insertToInc( *j );
+                    _insertToSpill( *j );
             }
             _temp->clear();
             _size = 0;
 
         }
 
+        void State::map( const BSONObj& o ) {
+            if ( _config.mapThreads <= 1 ) {
+                _config.mapper->map( o );
+                return;
+            }
+
+            if ( ! _parallelMapper )
+                _parallelMapper.reset( new ParallelMapper( this , _config.mapThreads ) );
+            _parallelMapper->map( o );
+        }
+
+        void State::finishMap() {
+            if ( _parallelMapper )
+                _parallelMapper->finish();
+        }
+
         /**
          * Adds object to in memory map
          */
@@ -1129,32 +1262,188 @@ namespace mongo {
 
                 // if size is still high, or values are not reducing well, dump
                 if ( _onDisk && (_size > _config.maxInMemSize || _size > oldSize / 2) ) {
-                    dumpToInc();
-                    LOG(1) << "  MR - dumping to db" << endl;
+                    dumpToSpill();
+                    LOG(1) << "  MR - spilling to disk" << endl;
                 }
             }
         }
 
         /**
-         * emit that will be called by js function
+         * checks the arguments of a JS emit() and returns them as a (key, value) tuple
          */
-        BSONObj fast_emit( const BSONObj& args, void* data ) {
+        static BSONObj emitArgsToTuple( const BSONObj& args ) {
             uassert( 10077 , "fast_emit takes 2 args" , args.nFields() == 2 );
             uassert( 13069 , "an emit can't be more than half max bson size" , args.objsize() < ( BSONObjMaxUserSize / 2 ) );
-            
+
+            if ( args.firstElement().type() != Undefined )
+                return args;
+
+            BSONObjBuilder b( args.objsize() );
+            b.appendNull( "" );
+            BSONObjIterator i( args );
+            i.next();
+            b.append( i.next() );
+            return b.obj();
+        }
+
+        /**
+         * emit that will be called by js function
+         */
+        BSONObj fast_emit( const BSONObj& args, void* data ) {
             State* state = (State*) data;
-            if ( args.firstElement().type() == Undefined ) {
-                BSONObjBuilder b( args.objsize() );
-                b.appendNull( "" );
-                BSONObjIterator i( args );
-                i.next();
-                b.append( i.next() );
-                state->emit( b.obj() );
+            state->emit( emitArgsToTuple( args ) );
+            return BSONObj();
+        }
+
+        /**
+         * One map thread of a ParallelMapper.
+         * The Scope is set up by the constructor, on the command's thread, so it is registered
+         * with the operation and gets killed along with it.
+         */
+        class ParallelMapper::Worker : boost::noncopyable {
+        public:
+            Worker( const Config& config , const string& scopeType ,
+                    BlockingQueue<Batch>* queue )
+                : _scope( globalScriptEngine->getPooledScope( config.dbname , scopeType ) )
+                , _func( "_map" , config.mapFunction.firstElement() )
+                , _params( config.mapParams )
+                , _queue( queue ) {
+
+                if ( ! config.scopeSetup.isEmpty() )
+                    _scope->init( &config.scopeSetup );
+                _func.init( _scope.get() );
+                _scope->injectNative( "emit" , emit , this );
+
+                // this thread has no Client to run queries with
+                _scope->rename( "db" , "____db____" );
             }
-            else {
-                state->emit( args );
+
+            ~Worker() {
+                DESTRUCTOR_GUARD( _scope->rename( "____db____" , "db" ); );
+            }
+
+            void start() {
+                _thread.reset( new boost::thread( boost::bind( &Worker::run , this ) ) );
+            }
+
+            void join() {
+                if ( _thread )
+                    _thread->join();
+            }
+
+            /** the first error this thread hit, if any */
+            const string& error() const { return _error; }
+
+            InMemory& emitted() { return _emitted; }
+
+        private:
+            void run() {
+                while ( Batch batch = _queue->blockingPop() ) {
+                    // after an error keep draining so map() never blocks on a full queue
+                    if ( ! _error.empty() )
+                        continue;
+
+                    try {
+                        for ( BSONList::const_iterator i = batch->begin(); i != batch->end();
+                                ++i ) {
+                            if ( _scope->invoke( _func.func() , &_params , &*i , 0 , true ) )
+                                uasserted( 17394 , str::stream() << "map invoke failed: "
+                                                                << _scope->getError() );
+                        }
+                    }
+                    catch ( const DBException& e ) {
+                        _error = e.toString();
+                    }
+                    catch ( const std::exception& e ) {
+                        _error = e.what();
+                    }
+                }
+            }
+
+            static BSONObj emit( const BSONObj& args , void* data ) {
+                Worker* worker = static_cast<Worker*>( data );
+                BSONObj tuple = emitArgsToTuple( args );
+                worker->_emitted[tuple].push_back( tuple );
+                return BSONObj();
+            }
+
+            auto_ptr<Scope> _scope;
+            JSFunction _func;
+            BSONObj _params;
+            BlockingQueue<Batch>* _queue;
+            scoped_ptr<boost::thread> _thread;
+            InMemory _emitted;
+            string _error;
+        };
+
+        // documents handed to a map thread at a time
+        static const size_t parallelMapBatchSize = 100;
+
+        ParallelMapper::ParallelMapper( State* state , int numThreads )
+            : _state( state ) , _queue( numThreads * 2 ) , _stopped( false ) {
+            // the same pool State::init() takes its scope from
+            const string scopeType = "mapreduce" + ClientBasic::getCurrent()
+                    ->getAuthorizationSession()->getAuthenticatedUserNamesToken();
+
+            for ( int i = 0; i < numThreads; i++ ) {
+                _workers.push_back( boost::shared_ptr<Worker>(
+                        new Worker( state->config() , scopeType , &_queue ) ) );
+            }
+            for ( size_t i = 0; i < _workers.size(); i++ )
+                _workers[i]->start();
+        }
+
+        ParallelMapper::~ParallelMapper() {
+            DESTRUCTOR_GUARD( _stopThreads(); );
+        }
+
+        void ParallelMapper::map( const BSONObj& o ) {
+            if ( ! _batch ) {
+                _batch.reset( new BSONList() );
+                _batch->reserve( parallelMapBatchSize );
+            }
+
+            // the caller's lock may be yielded before a thread gets to it
+            _batch->push_back( o.getOwned() );
+            if ( _batch->size() >= parallelMapBatchSize )
+                _queueBatch();
+        }
+
+        void ParallelMapper::_queueBatch() {
+            if ( _batch ) {
+                _queue.push( _batch );
+                _batch.reset();
+            }
+        }
+
+        void ParallelMapper::_stopThreads() {
+            if ( _stopped )
+                return;
+            _stopped = true;
+
+            for ( size_t i = 0; i < _workers.size(); i++ )
+                _queue.push( Batch() );
+            for ( size_t i = 0; i < _workers.size(); i++ )
+                _workers[i]->join();
+        }
+
+        void ParallelMapper::finish() {
+            _queueBatch();
+            _stopThreads();
+
+            for ( size_t i = 0; i < _workers.size(); i++ ) {
+                uassert( 17363 , str::stream() << "map thread failed: " << _workers[i]->error() ,
+                         _workers[i]->error().empty() );
+            }
+
+            for ( size_t i = 0; i < _workers.size(); i++ ) {
+                InMemory& emitted = _workers[i]->emitted();
+                for ( InMemory::iterator j = emitted.begin(); j != emitted.end(); ++j ) {
+                    for ( BSONList::iterator k = j->second.begin(); k != j->second.end(); ++k )
+                        _state->emit( *k );
+                }
+                emitted.clear();
             }
-            return BSONObj();
         }
 
         /**
@@ -1301,8 +1590,9 @@ namespace mongo {
                         Timer mt;
                         // go through each doc
                         BSONObj o;
-                        Runner::RunnerState state;
-                        while (Runner::RUNNER_ADVANCED == (state = runner->getNext(&o, NULL))) {
+                        Runner::RunnerState runnerState;
+                        while (Runner::RUNNER_ADVANCED ==
+                                   (runnerState = runner->getNext(&o, NULL))) {
                             // check to see if this is a new object we don't own yet
                             // because of a chunk migration
                             if ( collMetadata ) {
@@ -1314,7 +1604,7 @@ namespace mongo {
 
                             // do map
                             if ( config.verbose ) mt.reset();
-                            config.mapper->map( o );
+                            state.map( o );
                             if ( config.verbose ) mapTime += mt.micros();
 
                             num++;
@@ -1327,6 +1617,7 @@ namespace mongo {
                                 break;
                         }
                     }
+                    state.finishMap();
                     pm.finished();
 
                     killCurrentOp.checkForInterrupt();
@@ -1345,8 +1636,9 @@ namespace mongo {
                     // do reduce in memory
                     // this will be the last reduce needed for inline mode
                     state.reduceInMemory();
-                    // if not inline: dump the in memory map to inc collection, all data is on disk
-                    state.dumpToInc();
+                    // if not inline: dump the in memory map to the spill Sorter, so all data is
+                    // there
+                    state.dumpToSpill();
                     // final reduce
                     state.finalReduce( op , pm );
                     inReduce += rt.micros();
@@ -1429,10 +1721,6 @@ namespace mongo {
                 State state(config);
                 state.init();
 
-                // no need for incremental collection because records are already sorted
-                state._useIncremental = false;
-                config.incLong = config.tempNamespace;
-
                 BSONObj shardCounts = cmdObj["shardCounts"].embeddedObjectUserCheck();
                 BSONObj counts = cmdObj["counts"].embeddedObjectUserCheck();
 
@@ -1563,3 +1851,6 @@ namespace mongo {
 
 }
 
+
+#include "mongo/db/sorter/sorter.cpp"
+MONGO_CREATE_SORTER(mongo::BSONObj, mongo::BSONObj, mongo::mr::TupleSorterCmp);
@@ -38,7 +38,9 @@
 #include "mongo/db/curop.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/sorter/sorter.h"
 #include "mongo/scripting/engine.h"
+#include "mongo/util/queue.h"
 
 namespace mongo {
 
@@ -97,6 +99,8 @@ namespace mongo {
             virtual ~JSFunction() {}
 
             virtual void init( State * state );
+            /** compiles the function in 'scope' rather than the State's scope */
+            void init( Scope * scope );
 
             Scope * scope() const { return _scope; }
             ScriptingFunction func() const { return _func; }
@@ -151,6 +155,61 @@ namespace mongo {
 
         };
 
+        // ------------  native implementations -----------
+
+        /**
+         * Runs map functions of the form
+         *     function() { emit(this.<key path>, <number> or this.<value path>); }
+         * without calling into JS. Documents for which the JS function wouldn't emit a plain
+         * key and number (missing fields, arrays, NumberLong, ...) still go through it.
+         */
+        class NativeSumMapper : public Mapper {
+        public:
+            /** @return a mapper for 'code', or NULL if it isn't of the form above */
+            static NativeSumMapper* make( const BSONElement& code );
+
+            virtual void map( const BSONObj& o );
+            virtual void init( State * state );
+
+        private:
+            NativeSumMapper( const BSONElement& code , const string& keyPath ,
+                             const string& valuePath , double constant );
+
+            JSMapper _js;
+            State * _state;
+            string _keyPath;
+            string _valuePath; // empty when every emit uses _constant
+            double _constant;
+        };
+
+        /**
+         * Runs reduce functions of the form
+         *     function(key, values) { return Array.sum(values); }
+         * without calling into JS when every value is a double, which is what JS emits for
+         * numbers. Anything else goes through the JS function.
+         */
+        class NativeSumReducer : public Reducer {
+        public:
+            /** @return a reducer for 'code', or NULL if it isn't of the form above */
+            static NativeSumReducer* make( const BSONElement& code );
+
+            virtual void init( State * state );
+
+            virtual BSONObj reduce( const BSONList& tuples );
+            virtual BSONObj finalReduce( const BSONList& tuples , Finalizer * finalizer );
+
+        private:
+            NativeSumReducer( const BSONElement& code ) : _js( code ) {}
+
+            /**
+             * Adds up the values left to right, as Array.sum does.
+             * @return false if a value isn't a double
+             */
+            static bool _sum( const BSONList& tuples , double* sum );
+
+            JSReducer _js;
+        };
+
         // -----------------
 
 
@@ -164,6 +223,20 @@ namespace mongo {
 
         typedef map< BSONObj,BSONList,TupleKeyCmp > InMemory; // from key to list of tuples
 
+        /**
+         * Orders tuples spilled to disk by key. The tuple is the Sorter key; the value is empty.
+         */
+        class TupleSorterCmp {
+        public:
+            typedef std::pair<BSONObj, BSONObj> Data;
+            int operator()( const Data& l, const Data& r ) const {
+                // keys of emit(undefined, ...) are named "" rather than "0"
+                return l.first.firstElement().woCompare( r.first.firstElement() , false );
+            }
+        };
+
+        typedef Sorter<BSONObj, BSONObj> TupleSorter;
+
         /**
          * holds map/reduce config information
          */
@@ -194,8 +267,11 @@ namespace mongo {
             BSONObj mapParams;
             BSONObj scopeSetup;
 
+            // threads mapping in parallel, each running mapFunction in its own Scope
+            int mapThreads;
+            BSONObj mapFunction; // { map : <code> }
+
             // output tables
-            string incLong;
             string tempNamespace;
 
             enum OutputType {
@@ -228,6 +304,35 @@ namespace mongo {
             static AtomicUInt JOB_NUMBER;
         }; // end MRsetup
 
+        /**
+         * Maps documents on several threads, each with its own Scope running the JS map function
+         * and emitting into its own in memory map. finish() merges those maps into State.
+         */
+        class ParallelMapper : boost::noncopyable {
+        public:
+            ParallelMapper( State* state , int numThreads );
+            ~ParallelMapper();
+
+            /** queues a copy of 'o' to be mapped by one of the threads */
+            void map( const BSONObj& o );
+
+            /** waits until everything queued is mapped, then emits the results into State */
+            void finish();
+
+        private:
+            class Worker;
+            typedef boost::shared_ptr<BSONList> Batch;
+
+            void _queueBatch();
+            void _stopThreads();
+
+            State* _state;
+            vector< boost::shared_ptr<Worker> > _workers;
+            BlockingQueue<Batch> _queue; // a NULL batch stops a thread
+            Batch _batch; // filled by map()
+            bool _stopped;
+        };
+
         /**
          * stores information about intermediate map reduce state
          * controls flow of data from map->reduce->finalize->output
@@ -246,6 +351,16 @@ namespace mongo {
 
             // ---- map stage ----
 
+            /**
+             * maps a document, on one of the map threads if there are several
+             */
+            void map( const BSONObj& o );
+
+            /**
+             * waits for the map threads, if any, and emits what they mapped
+             */
+            void finishMap();
+
             /**
              * stages on in in-memory storage
              */
@@ -263,11 +378,10 @@ namespace mongo {
             void reduceInMemory();
 
             /**
-             * transfers in memory storage to temp collection
+             * transfers in memory storage to the spill Sorter
              */
-            void dumpToInc();
-            void insertToInc( BSONObj& o );
-            void _insertToInc( BSONObj& o );
+            void dumpToSpill();
+            void _insertToSpill( const BSONObj& o );
 
             // ------ reduce stage -----------
 
@@ -322,7 +436,6 @@ namespace mongo {
 
             const Config& _config;
             DBDirectClient _db;
-            bool _useIncremental;   // use an incremental collection
 
         protected:
 
@@ -337,11 +450,17 @@ namespace mongo {
 
             long long _numEmits;
 
+            // tuples dumped from _temp, sorted into temp files, when not INMEMORY
+            scoped_ptr<TupleSorter> _spill;
+            long long _numSpilled;
+
             bool _jsMode;
             ScriptingFunction _reduceAll;
             ScriptingFunction _reduceAndEmit;
             ScriptingFunction _reduceAndFinalize;
             ScriptingFunction _reduceAndFinalizeAndInsert;
+
+            scoped_ptr<ParallelMapper> _parallelMapper; // created by the first map()
         };
 
         BSONObj fast_emit( const BSONObj& args, void* data );
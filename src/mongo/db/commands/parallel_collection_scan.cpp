@@ -0,0 +1,121 @@
+// parallel_collection_scan.cpp
+
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/client.h"
+#include "mongo/db/clientcursor.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/database.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/query/internal_plans.h"
+#include "mongo/db/structure/collection.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    /**
+     * Hands back several cursors over disjoint ranges of a collection's extents, which between
+     * them return every document once.  Clients drain them with getMore, concurrently if they
+     * like, to read a large collection with more than one thread.
+     */
+    class ParallelCollectionScanCmd : public Command {
+    public:
+        // more than this and the ranges get too small to be worth a cursor each
+        static const int MaxCursors = 10000;
+
+        ParallelCollectionScanCmd() : Command("parallelCollectionScan") {}
+
+        virtual bool slaveOk() const { return false; }
+        virtual bool slaveOverrideOk() const { return true; }
+        virtual LockType locktype() const { return READ; }
+
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::find);
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+        }
+
+        virtual void help( stringstream &help ) const {
+            help << "{ parallelCollectionScan : 'collection name' , numCursors : 4 }\n"
+                 << "returns up to numCursors cursors which together cover the collection";
+        }
+
+        bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result,
+                 bool fromRepl ) {
+
+            string ns = parseNs(dbname, cmdObj);
+
+            BSONElement numCursorsElem = cmdObj["numCursors"];
+            uassert(17339, "numCursors has to be a number", numCursorsElem.isNumber());
+            int numCursors = numCursorsElem.numberInt();
+            uassert(17340, str::stream() << "numCursors has to be between 1 and " << MaxCursors,
+                    numCursors >= 1 && numCursors <= MaxCursors);
+
+            Collection* collection = cc().database()->getCollection( ns );
+            if ( !collection ) {
+                errmsg = "ns not found";
+                return false;
+            }
+
+            std::vector<Runner*> runners;
+            InternalPlanner::parallelCollectionScan(collection, numCursors, &runners);
+
+            BSONArrayBuilder cursors(result.subarrayStart("cursors"));
+            for (size_t i = 0; i < runners.size(); ++i) {
+                // Nothing is read until the cursor is getMore'd.
+                runners[i]->saveState();
+
+                // The ClientCursor takes ownership of the runner, and is inserted into the
+                // global map by its ctor.
+                ClientCursor* cursor = new ClientCursor(runners[i]);
+
+                BSONObjBuilder entry(cursors.subobjStart());
+                BSONObjBuilder cursorObj(entry.subobjStart("cursor"));
+                cursorObj.append("id", cursor->cursorid());
+                cursorObj.append("ns", ns);
+                cursorObj.append("firstBatch", BSONArray());
+                cursorObj.done();
+                entry.done();
+            }
+            cursors.done();
+
+            return true;
+        }
+    } parallelCollectionScanCmd;
+
+}  // namespace mongo
@@ -57,6 +57,8 @@ namespace {
         PipelineRunner(intrusive_ptr<Pipeline> pipeline)
             : _pipeline(pipeline)
             , _includeMetaData(_pipeline->getContext()->inShard) // send metadata to merger
+            , _batchPos(0)
+            , _eof(false)
         {}
 
         virtual RunnerState getNext(BSONObj* objOut, DiskLoc* dlOut) {
@@ -113,22 +115,38 @@ namespace {
 
     private:
         boost::optional<BSONObj> getNextBson() {
-            if (boost::optional<Document> next = _pipeline->output()->getNext()) {
-                if (_includeMetaData) {
-                    return next->toBsonWithMetaData();
-                }
-                else {
-                    return next->toBson();
+            if (_batchPos == _batch.size()) {
+                // Pull the pipeline's output a block at a time, but only when the client asks for
+                // more, so a batch never holds more than kBatchSize unconverted Documents.
+                _batch.clear();
+                _batchPos = 0;
+                if (_eof
+                    || !_pipeline->output()->getNextBatch(&_batch, DocumentSource::kBatchSize)) {
+                    _eof = true;
+                    return boost::none;
                 }
             }
 
-            return boost::none;
+            // Release each Document as soon as it has been converted.
+            Document next;
+            next.swap(_batch[_batchPos++]);
+            if (_includeMetaData) {
+                return next.toBsonWithMetaData();
+            }
+            else {
+                return next.toBson();
+            }
         }
 
         // Things in the _stash sould be returned before pulling items from _pipeline.
         const intrusive_ptr<Pipeline> _pipeline;
         vector<BSONObj> _stash;
         const bool _includeMetaData;
+
+        // Output pulled from _pipeline but not yet returned; _batchPos is the next to return.
+        vector<Document> _batch;
+        size_t _batchPos;
+        bool _eof;
     };
 }
 
@@ -0,0 +1,315 @@
+// plan_cache_commands.cpp
+
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#include <string>
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/database.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/query_settings.h"
+#include "mongo/db/structure/collection.h"
+
+namespace mongo {
+
+    namespace {
+
+        /**
+         * Canonicalize the query shape given by the 'query', 'sort' and 'projection' fields of
+         * 'cmdObj'.  Only 'query' is required.
+         */
+        Status canonicalizeShape(const string& ns, const BSONObj& cmdObj, CanonicalQuery** out) {
+            BSONElement queryElt = cmdObj["query"];
+            if (Object != queryElt.type()) {
+                return Status(ErrorCodes::BadValue, "required field query must be an object");
+            }
+
+            BSONObj shape[2];
+            const char* fields[2] = { "sort", "projection" };
+            for (int i = 0; i < 2; ++i) {
+                BSONElement elt = cmdObj[fields[i]];
+                if (elt.eoo()) {
+                    continue;
+                }
+                if (Object != elt.type()) {
+                    return Status(ErrorCodes::BadValue,
+                                  str::stream() << "optional field " << fields[i]
+                                                << " must be an object");
+                }
+                shape[i] = elt.Obj();
+            }
+
+            return CanonicalQuery::canonicalize(ns, queryElt.Obj(), shape[0], shape[1], out);
+        }
+
+        bool getCollection(const string& ns, Collection** out, string& errmsg) {
+            *out = cc().database()->getCollection( ns );
+            if ( !*out ) {
+                errmsg = "ns not found";
+                return false;
+            }
+            return true;
+        }
+
+    }  // namespace
+
+    /**
+     * Lists the query shapes in a collection's plan cache, most recently used first, along with
+     * the cache's memory use, limits and hit, miss and eviction counters.
+     */
+    class PlanCacheListQueryShapesCmd : public Command {
+    public:
+        PlanCacheListQueryShapesCmd() : Command("planCacheListQueryShapes") {}
+
+        virtual bool slaveOk() const { return true; }
+        virtual LockType locktype() const { return READ; }
+
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::collStats);
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+        }
+
+        virtual void help( stringstream &help ) const {
+            help << "{ planCacheListQueryShapes : 'collection name' }\n"
+                 << "lists the query shapes in the collection's plan cache";
+        }
+
+        bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result,
+                 bool fromRepl ) {
+
+            string ns = parseNs(dbname, cmdObj);
+
+            Collection* collection;
+            if ( !getCollection( ns, &collection, errmsg ) ) {
+                return false;
+            }
+
+            PlanCache* cache = collection->infoCache()->getPlanCache();
+
+            BSONArrayBuilder shapes(result.subarrayStart("shapes"));
+            cache->appendShapes(&shapes);
+            shapes.done();
+
+            BSONObjBuilder stats(result.subobjStart("stats"));
+            cache->appendStats(&stats);
+            stats.done();
+
+            return true;
+        }
+    } planCacheListQueryShapesCmd;
+
+    /**
+     * Restricts the indexes the planner considers for one query shape of a collection, and
+     * drops the shape's cached plan so the next query plans with the filter.  The indexes are
+     * given by key pattern and need not exist yet.
+     */
+    class PlanCacheSetFilterCmd : public Command {
+    public:
+        PlanCacheSetFilterCmd() : Command("planCacheSetFilter") {}
+
+        virtual bool slaveOk() const { return true; }
+        virtual LockType locktype() const { return READ; }
+
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::planCacheIndexFilter);
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+        }
+
+        virtual void help( stringstream &help ) const {
+            help << "{ planCacheSetFilter : 'collection name', query : {...}, sort : {...}, "
+                 << "projection : {...}, indexes : [ {key pattern}, ... ] }\n"
+                 << "restricts queries of the given shape to the listed indexes";
+        }
+
+        bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result,
+                 bool fromRepl ) {
+
+            string ns = parseNs(dbname, cmdObj);
+
+            Collection* collection;
+            if ( !getCollection( ns, &collection, errmsg ) ) {
+                return false;
+            }
+
+            BSONElement indexesElt = cmdObj["indexes"];
+            if ( Array != indexesElt.type() || indexesElt.Obj().isEmpty() ) {
+                errmsg = "required field indexes must be a non-empty array of key patterns";
+                return false;
+            }
+            vector<BSONObj> indexKeyPatterns;
+            BSONObjIterator it( indexesElt.Obj() );
+            while ( it.more() ) {
+                BSONElement elt = it.next();
+                if ( Object != elt.type() || elt.Obj().isEmpty() ) {
+                    errmsg = "each index must be given by its key pattern";
+                    return false;
+                }
+                indexKeyPatterns.push_back( elt.Obj() );
+            }
+
+            CanonicalQuery* rawQuery;
+            Status status = canonicalizeShape( ns, cmdObj, &rawQuery );
+            if ( !status.isOK() ) {
+                return appendCommandStatus( result, status );
+            }
+            auto_ptr<CanonicalQuery> query( rawQuery );
+            if ( !shouldCacheQuery( *query ) ) {
+                errmsg = "index filters are not applied to this query shape";
+                return false;
+            }
+
+            collection->infoCache()->getQuerySettings()->setAllowedIndices( *query,
+                                                                            indexKeyPatterns );
+            collection->infoCache()->getPlanCache()->remove( getPlanCacheKey( *query ) );
+
+            return true;
+        }
+    } planCacheSetFilterCmd;
+
+    /**
+     * Removes the index filter of one query shape if one is given, or all of a collection's
+     * index filters otherwise.
+     */
+    class PlanCacheClearFiltersCmd : public Command {
+    public:
+        PlanCacheClearFiltersCmd() : Command("planCacheClearFilters") {}
+
+        virtual bool slaveOk() const { return true; }
+        virtual LockType locktype() const { return READ; }
+
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::planCacheIndexFilter);
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+        }
+
+        virtual void help( stringstream &help ) const {
+            help << "{ planCacheClearFilters : 'collection name', query : {...}, sort : {...}, "
+                 << "projection : {...} }\n"
+                 << "removes the index filter of the given query shape, or all index filters "
+                 << "if no query is given";
+        }
+
+        bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result,
+                 bool fromRepl ) {
+
+            string ns = parseNs(dbname, cmdObj);
+
+            Collection* collection;
+            if ( !getCollection( ns, &collection, errmsg ) ) {
+                return false;
+            }
+
+            QuerySettings* querySettings = collection->infoCache()->getQuerySettings();
+            PlanCache* cache = collection->infoCache()->getPlanCache();
+
+            if ( cmdObj["query"].eoo() ) {
+                querySettings->clearAllowedIndices();
+                cache->clear();
+                return true;
+            }
+
+            CanonicalQuery* rawQuery;
+            Status status = canonicalizeShape( ns, cmdObj, &rawQuery );
+            if ( !status.isOK() ) {
+                return appendCommandStatus( result, status );
+            }
+            auto_ptr<CanonicalQuery> query( rawQuery );
+
+            PlanCacheKey key = getPlanCacheKey( *query );
+            if ( !querySettings->removeAllowedIndices( key ) ) {
+                errmsg = "no index filter for this query shape";
+                return false;
+            }
+            cache->remove( key );
+
+            return true;
+        }
+    } planCacheClearFiltersCmd;
+
+    /**
+     * Lists a collection's index filters with their query shapes.
+     */
+    class PlanCacheListFiltersCmd : public Command {
+    public:
+        PlanCacheListFiltersCmd() : Command("planCacheListFilters") {}
+
+        virtual bool slaveOk() const { return true; }
+        virtual LockType locktype() const { return READ; }
+
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::collStats);
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+        }
+
+        virtual void help( stringstream &help ) const {
+            help << "{ planCacheListFilters : 'collection name' }\n"
+                 << "lists the index filters of the collection's query shapes";
+        }
+
+        bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result,
+                 bool fromRepl ) {
+
+            string ns = parseNs(dbname, cmdObj);
+
+            Collection* collection;
+            if ( !getCollection( ns, &collection, errmsg ) ) {
+                return false;
+            }
+
+            BSONArrayBuilder filters(result.subarrayStart("filters"));
+            collection->infoCache()->getQuerySettings()->appendAllowedIndices(&filters);
+            filters.done();
+
+            return true;
+        }
+    } planCacheListFiltersCmd;
+
+}  // namespace mongo
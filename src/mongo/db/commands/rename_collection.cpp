@@ -293,14 +293,11 @@ namespace mongo {
                 if ( !targetColl )
                     targetColl = ctx.db()->getCollection( target );
 
-                for ( vector<BSONObj>::iterator it = copiedIndexes.begin();
-                                                it != copiedIndexes.end(); ++it ) {
-                    Status s = targetColl->getIndexCatalog()->createIndex( *it, true );
-                    if ( !s.isOK() ) {
-                        indexSuccessful = false;
-                        errmsg = s.toString();
-                        break;
-                    }
+                // one scan of the copied documents for all the indexes
+                Status s = targetColl->getIndexCatalog()->createIndexes( copiedIndexes, true );
+                if ( !s.isOK() ) {
+                    indexSuccessful = false;
+                    errmsg = s.toString();
                 }
 
                 // If indexes were unsuccessful, drop the target collection and return false.
@@ -40,7 +40,9 @@
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/platform/process_id.h"
+#include "mongo/util/buffer_pool.h"
 #include "mongo/util/net/listen.h"
+#include "mongo/util/numa.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/ramlog.h"
 #include "mongo/util/version.h"
@@ -276,6 +278,8 @@ namespace mongo {
                 bb.append( "current" , Listener::globalTicketHolder.used() );
                 bb.append( "available" , Listener::globalTicketHolder.available() );
                 bb.append( "totalCreated" , Listener::globalConnectionNumber.load() );
+                bb.append( "totalCreatedUnixSocket" ,
+                           Listener::globalUnixSocketConnectionNumber.load() );
                 return bb.obj();
             }
 
@@ -329,6 +333,48 @@ namespace mongo {
                 
         } network;
 
+        class Numa : public ServerStatusSection {
+        public:
+            Numa() : ServerStatusSection( "numa" ){}
+            virtual bool includeByDefault() const { return numa::enabled(); }
+
+            BSONObj generateSection(const BSONElement& configElement) const {
+                BSONObjBuilder b;
+                b.appendBool( "enabled" , numa::enabled() );
+                b.append( "nodes" , numa::numNodes() );
+
+                // page allocations are counted by the kernel for the whole machine: 'other'
+                // ones were made for a thread on another node, and are then accessed remotely
+                unsigned long long totalLocal = 0;
+                unsigned long long totalOther = 0;
+                BSONArrayBuilder nodes( b.subarrayStart( "perNode" ) );
+                for ( int i = 0; i < numa::numNodes(); i++ ) {
+                    BSONObjBuilder n( nodes.subobjStart() );
+                    n.appendNumber( "threadsPlaced" ,
+                                    static_cast<long long>( numa::threadsPlaced( i ) ) );
+                    unsigned long long local, other;
+                    if ( numa::allocationCounts( i, &local, &other ) ) {
+                        n.appendNumber( "localPages" , static_cast<long long>( local ) );
+                        n.appendNumber( "otherPages" , static_cast<long long>( other ) );
+                        totalLocal += local;
+                        totalOther += other;
+                    }
+                    n.done();
+                }
+                nodes.done();
+
+                if ( totalLocal + totalOther > 0 )
+                    b.append( "remoteRatio" ,
+                              static_cast<double>( totalOther ) / ( totalLocal + totalOther ) );
+                b.appendNumber( "interleavedRanges" ,
+                                static_cast<long long>( numa::interleavedRanges() ) );
+                b.appendNumber( "interleaveFailures" ,
+                                static_cast<long long>( numa::interleaveFailures() ) );
+                return b.obj();
+            }
+
+        } numaSection;
+
         class MemBase : public ServerStatusMetric {
         public:
             MemBase() : ServerStatusMetric(".mem.bits") {}
@@ -350,6 +396,22 @@ namespace mongo {
 
             }
         } memBase;
+
+        ServerStatusMetricField<Counter64> displayBufferPoolHits( "buffers.pool.hits",
+                                                                  &BufferPool::hits );
+        ServerStatusMetricField<Counter64> displayBufferPoolMisses( "buffers.pool.misses",
+                                                                    &BufferPool::misses );
+
+        // the fraction of pooled allocations that reused a cached buffer
+        class BufferPoolReuseRate : public ServerStatusMetric {
+        public:
+            BufferPoolReuseRate() : ServerStatusMetric( "buffers.pool.reuseRate" ) {}
+            virtual void appendAtLeaf( BSONObjBuilder& b ) const {
+                const long long hits = BufferPool::hits.get();
+                const long long total = hits + BufferPool::misses.get();
+                b.append( _leafName, total ? double(hits) / total : 0.0 );
+            }
+        } displayBufferPoolReuseRate;
     }
 
 }
@@ -35,10 +35,152 @@
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/query/runner.h"
 #include "mongo/db/storage/extent.h"
+#include "mongo/db/storage/extent_manager.h"
+#include "mongo/db/storage/record_compression.h"
 #include "mongo/db/structure/collection.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/work_stealing_pool.h"
 
 namespace mongo {
 
+    namespace {
+
+        // only this many record locations are kept to cross check against the deleted lists
+        const int MaxRecsToCheck = 1000000;
+
+        const int MaxParallel = 64;
+
+        /** what the record scan adds up, per extent when scanning in parallel */
+        struct RecordScanTotals {
+            RecordScanTotals()
+                : n( 0 ), nInvalid( 0 ), nQuantizedSize( 0 ), nPowerOf2QuantizedSize( 0 ),
+                  len( 0 ), nlen( 0 ), bsonLen( 0 ) {}
+
+            void add( const RecordScanTotals& other ) {
+                n += other.n;
+                nInvalid += other.nInvalid;
+                nQuantizedSize += other.nQuantizedSize;
+                nPowerOf2QuantizedSize += other.nPowerOf2QuantizedSize;
+                len += other.len;
+                nlen += other.nlen;
+                bsonLen += other.bsonLen;
+                for ( set<DiskLoc>::const_iterator i = other.recs.begin();
+                      i != other.recs.end() && recs.size() < static_cast<size_t>( MaxRecsToCheck );
+                      ++i ) {
+                    recs.insert( *i );
+                }
+                if ( error.empty() )
+                    error = other.error;
+            }
+
+            int n;
+            int nInvalid;
+            long long nQuantizedSize;
+            long long nPowerOf2QuantizedSize;
+            long long len;
+            long long nlen;
+            long long bsonLen;
+            set<DiskLoc> recs;
+            string error; // exception from a parallel extent scan
+        };
+
+        /**
+         * the checks done on every record.  doesn't use cc(), so can run on a worker thread
+         * while the command's thread holds the lock.  'recsKept' counts the locations kept
+         * in every RecordScanTotals of the scan, so MaxRecsToCheck bounds them all together.
+         */
+        void checkRecord( const string& ns, const DiskLoc& cl, Record* r, bool full,
+                          AtomicInt32* recsKept, RecordScanTotals* t ) {
+            t->n++;
+            if ( recsKept->loadRelaxed() < MaxRecsToCheck &&
+                 recsKept->fetchAndAdd( 1 ) < MaxRecsToCheck )
+                t->recs.insert( cl );
+
+            t->len += r->lengthWithHeaders();
+            t->nlen += r->netLength();
+
+            if ( r->lengthWithHeaders() ==
+                    NamespaceDetails::quantizeAllocationSpace
+                        ( r->lengthWithHeaders() ) ) {
+                // Count the number of records having a size consistent with
+                // the quantizeAllocationSpace quantization implementation.
+                ++t->nQuantizedSize;
+            }
+
+            if ( r->lengthWithHeaders() ==
+                    NamespaceDetails::quantizePowerOf2AllocationSpace
+                        ( r->lengthWithHeaders() - 1 ) ) {
+                // Count the number of records having a size consistent with the
+                // quantizePowerOf2AllocationSpace quantization implementation.
+                // Because of SERVER-8311, power of 2 quantization is not idempotent and
+                // r->lengthWithHeaders() - 1 must be checked instead of the record
+                // length itself.
+                ++t->nPowerOf2QuantizedSize;
+            }
+
+            if (full){
+                const char* data = r->dataNoThrowing();
+                const bool compressed = RecordCompression::isCompressed( data );
+                BSONObj obj;
+                try {
+                    obj = RecordCompression::toBSON( data );
+                }
+                catch ( DBException& ex ) {
+                    t->nInvalid++;
+                    log() << ( compressed ? "Invalid compressed record" : "Invalid bson" )
+                          << " detected in " << ns << " at " << cl << ": " << ex.what() << endl;
+                    return;
+                }
+                if (!obj.isValid() || !obj.valid()){ // both fast and deep checks
+                    t->nInvalid++;
+                    if (strcmp("_id", obj.firstElementFieldName()) == 0){
+                        try {
+                            obj.firstElement().validate(); // throws on error
+                            log() << "Invalid bson detected in " << ns << " with _id: " << obj.firstElement().toString(false) << endl;
+                        }
+                        catch(...){
+                            log() << "Invalid bson detected in " << ns << " with corrupt _id" << endl;
+                        }
+                    }
+                    else {
+                        log() << "Invalid bson detected in " << ns << " and couldn't find _id" << endl;
+                    }
+                }
+                else {
+                    t->bsonLen += obj.objsize();
+                }
+            }
+        }
+
+        /** check every record in one extent */
+        void scanExtent( const string* ns, const ExtentManager* em, DiskLoc extLoc, bool full,
+                         const AtomicUInt32* cancelled, AtomicInt32* recsKept,
+                         RecordScanTotals* t ) {
+            try {
+                Extent* e = em->getExtent( extLoc );
+                DiskLoc cl = e->firstRecord;
+                while ( !cl.isNull() && !cancelled->loadRelaxed() ) {
+                    checkRecord( *ns, cl, em->recordFor( cl ), full, recsKept, t );
+                    cl = em->getNextRecordInExtent( cl );
+                }
+            }
+            catch ( const DBException& ex ) {
+                t->error = str::stream() << "exception scanning extent " << extLoc.toString()
+                                         << ": " << ex.what();
+            }
+        }
+
+        /** a pool task: scan extents 'first', 'first' + 'step', ... */
+        void scanExtents( const string* ns, const ExtentManager* em,
+                          const vector<DiskLoc>* extents, size_t first, size_t step, bool full,
+                          const AtomicUInt32* cancelled, AtomicInt32* recsKept,
+                          vector<RecordScanTotals>* perExtent ) {
+            for ( size_t i = first; i < extents->size(); i += step )
+                scanExtent( ns, em, (*extents)[i], full, cancelled, recsKept, &(*perExtent)[i] );
+        }
+
+    }
+
     class ValidateCmd : public Command {
     public:
         ValidateCmd() : Command( "validate" ) {}
@@ -48,7 +190,8 @@ namespace mongo {
         }
 
         virtual void help(stringstream& h) const { h << "Validate contents of a namespace by scanning its data structures for correctness.  Slow.\n"
-                                                        "Add full:true option to do a more thorough check"; }
+                                                        "Add full:true option to do a more thorough check\n"
+                                                        "Add parallel:<n> to check records on n threads (not capped collections)"; }
 
         virtual LockType locktype() const { return READ; }
         virtual void addRequiredPrivileges(const std::string& dbname,
@@ -58,7 +201,7 @@ namespace mongo {
             actions.addAction(ActionType::validate);
             out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
         }
-        //{ validate: "collectionnamewithoutthedbpart" [, scandata: <bool>] [, full: <bool> } */
+        //{ validate: "collectionnamewithoutthedbpart" [, scandata: <bool>] [, full: <bool>] [, parallel: <int>] } */
 
         bool run(const string& dbname , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
             string ns = dbname + "." + cmdObj.firstElement().valuestrsafe();
@@ -85,6 +228,49 @@ namespace mongo {
         }
 
     private:
+        /**
+         * Check the records of every extent in 'nThreads' tasks on the shared WorkStealingPool.
+         * The tasks only do pointer arithmetic on the mapping, which can't go away under the
+         * read lock we hold, so they don't need locks or a Client of their own.
+         */
+        void parallelScan(const string& ns,
+                          Collection* collection,
+                          bool full,
+                          int nThreads,
+                          RecordScanTotals* totals) {
+            const ExtentManager* em = &cc().database()->getExtentManager();
+            NamespaceDetails* nsd = collection->details();
+
+            vector<DiskLoc> extents;
+            for ( DiskLoc e = nsd->firstExtent(); !e.isNull(); e = em->getExtent( e )->xnext )
+                extents.push_back( e );
+
+            vector<RecordScanTotals> perExtent( extents.size() );
+            AtomicUInt32 cancelled;
+            AtomicInt32 recsKept;
+            {
+                TaskGroup tasks( WorkStealingPool::shared() );
+                for ( int i = 0; i < nThreads; i++ ) {
+                    tasks.schedule( boost::bind( scanExtents, &ns, em, &extents, i, nThreads,
+                                                 full, &cancelled, &recsKept, &perExtent ) );
+                }
+
+                // stay interruptible while the tasks run
+                while ( tasks.pending() > 0 ) {
+                    if ( *killCurrentOp.checkForInterruptNoAssert() ) {
+                        cancelled.store( 1 );
+                        break;
+                    }
+                    sleepmillis( 10 );
+                }
+                tasks.join();
+            }
+            killCurrentOp.checkForInterrupt();
+
+            for ( size_t i = 0; i < perExtent.size(); i++ )
+                totals->add( perExtent[i] );
+        }
+
         void validateNS(const string& ns,
                         Collection* collection,
                         const BSONObj& cmdObj,
@@ -215,85 +401,50 @@ namespace mongo {
                     valid = false;
                 }
 
-                set<DiskLoc> recs;
+                RecordScanTotals totals;
+                const set<DiskLoc>& recs = totals.recs;
                 if( scanData ) {
-                    int n = 0;
-                    int nInvalid = 0;
-                    long long nQuantizedSize = 0;
-                    long long nPowerOf2QuantizedSize = 0;
-                    long long len = 0;
-                    long long nlen = 0;
-                    long long bsonLen = 0;
                     int outOfOrder = 0;
-                    DiskLoc cl_last;
-
-                    DiskLoc cl;
-                    Runner::RunnerState state;
-                    auto_ptr<Runner> runner(InternalPlanner::collectionScan(ns));
-                    while (Runner::RUNNER_ADVANCED == (state = runner->getNext(NULL, &cl))) {
-                        n++;
-
-                        if ( n < 1000000 )
-                            recs.insert(cl);
-                        if ( nsd->isCapped() ) {
-                            if ( cl < cl_last )
-                                outOfOrder++;
-                            cl_last = cl;
-                        }
 
-                        Record *r = cl.rec();
-                        len += r->lengthWithHeaders();
-                        nlen += r->netLength();
-                        
-                        if ( r->lengthWithHeaders() ==
-                                NamespaceDetails::quantizeAllocationSpace
-                                    ( r->lengthWithHeaders() ) ) {
-                            // Count the number of records having a size consistent with
-                            // the quantizeAllocationSpace quantization implementation.
-                            ++nQuantizedSize;
+                    // capped order is checked along the way, so capped collections are only
+                    // ever scanned serially
+                    int parallel = cmdObj["parallel"].numberInt();
+                    if ( parallel > 1 && !nsd->isCapped() ) {
+                        parallelScan( ns, collection, full, std::min( parallel, MaxParallel ),
+                                      &totals );
+                        if ( !totals.error.empty() ) {
+                            errors << totals.error;
+                            valid = false;
                         }
+                        result.append( "parallel", std::min( parallel, MaxParallel ) );
+                    }
+                    else {
+                        DiskLoc cl_last;
+                        AtomicInt32 recsKept;
+
+                        DiskLoc cl;
+                        Runner::RunnerState state;
+                        auto_ptr<Runner> runner(InternalPlanner::collectionScan(ns));
+                        while (Runner::RUNNER_ADVANCED == (state = runner->getNext(NULL, &cl))) {
+                            if ( nsd->isCapped() ) {
+                                if ( cl < cl_last )
+                                    outOfOrder++;
+                                cl_last = cl;
+                            }
 
-                        if ( r->lengthWithHeaders() ==
-                                NamespaceDetails::quantizePowerOf2AllocationSpace
-                                    ( r->lengthWithHeaders() - 1 ) ) {
-                            // Count the number of records having a size consistent with the
-                            // quantizePowerOf2AllocationSpace quantization implementation.
-                            // Because of SERVER-8311, power of 2 quantization is not idempotent and
-                            // r->lengthWithHeaders() - 1 must be checked instead of the record
-                            // length itself.
-                            ++nPowerOf2QuantizedSize;
+                            checkRecord( ns, cl, cl.rec(), full, &recsKept, &totals );
                         }
-
-                        if (full){
-                            BSONObj obj = BSONObj::make(r);
-                            if (!obj.isValid() || !obj.valid()){ // both fast and deep checks
-                                valid = false;
-                                if (nInvalid == 0) // only log once;
-                                    errors << "invalid bson object detected (see logs for more info)";
-
-                                nInvalid++;
-                                if (strcmp("_id", obj.firstElementFieldName()) == 0){
-                                    try {
-                                        obj.firstElement().validate(); // throws on error
-                                        log() << "Invalid bson detected in " << ns << " with _id: " << obj.firstElement().toString(false) << endl;
-                                    }
-                                    catch(...){
-                                        log() << "Invalid bson detected in " << ns << " with corrupt _id" << endl;
-                                    }
-                                }
-                                else {
-                                    log() << "Invalid bson detected in " << ns << " and couldn't find _id" << endl;
-                                }
-                            }
-                            else {
-                                bsonLen += obj.objsize();
-                            }
+                        if (Runner::RUNNER_EOF != state) {
+                            // TODO: more descriptive logging.
+                            warning() << "Internal error while reading collection " << ns << endl;
                         }
                     }
-                    if (Runner::RUNNER_EOF != state) {
-                        // TODO: more descriptive logging.
-                        warning() << "Internal error while reading collection " << ns << endl;
+
+                    if ( totals.nInvalid ) {
+                        valid = false;
+                        errors << "invalid bson object detected (see logs for more info)";
                     }
+
                     if ( nsd->isCapped() && !nsd->capLooped() ) {
                         result.append("cappedOutOfOrder", outOfOrder);
                         if ( outOfOrder > 1 ) {
@@ -301,19 +452,19 @@ namespace mongo {
                             errors << "too many out of order records";
                         }
                     }
-                    result.append("objectsFound", n);
+                    result.append("objectsFound", totals.n);
 
                     if (full) {
-                        result.append("invalidObjects", nInvalid);
+                        result.append("invalidObjects", totals.nInvalid);
                     }
 
-                    result.appendNumber("nQuantizedSize", nQuantizedSize);
-                    result.appendNumber("nPowerOf2QuantizedSize", nPowerOf2QuantizedSize);
-                    result.appendNumber("bytesWithHeaders", len);
-                    result.appendNumber("bytesWithoutHeaders", nlen);
+                    result.appendNumber("nQuantizedSize", totals.nQuantizedSize);
+                    result.appendNumber("nPowerOf2QuantizedSize", totals.nPowerOf2QuantizedSize);
+                    result.appendNumber("bytesWithHeaders", totals.len);
+                    result.appendNumber("bytesWithoutHeaders", totals.nlen);
 
                     if (full) {
-                        result.appendNumber("bytesBson", bsonLen);
+                        result.appendNumber("bytesBson", totals.bsonLen);
                     }
                 }
 
@@ -28,6 +28,7 @@
 
 #include "mongo/db/commands/write_commands/batch_executor.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "mongo/base/error_codes.h"
@@ -40,12 +41,15 @@
 #include "mongo/db/ops/update.h"
 #include "mongo/db/ops/update_lifecycle_impl.h"
 #include "mongo/db/pagefault.h"
+#include "mongo/db/prefetch.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/replication_server_status.h"
 #include "mongo/db/stats/counters.h"
+#include "mongo/db/structure/collection.h"
 #include "mongo/db/write_concern.h"
 #include "mongo/s/collection_metadata.h"
 #include "mongo/s/d_logic.h"
+#include "mongo/s/d_reshard.h"
 #include "mongo/s/shard_key_pattern.h"
 #include "mongo/s/write_ops/write_error_detail.h"
 #include "mongo/s/write_ops/batched_upsert_detail.h"
@@ -59,7 +63,8 @@ namespace mongo {
                                             Client* client,
                                             OpCounters* opCounters,
                                             LastError* le )
-        : _defaultWriteConcern(wc), _client( client ), _opCounters( opCounters ), _le( le ) {
+        : _defaultWriteConcern(wc), _client( client ), _opCounters( opCounters ), _le( le ),
+          _deferredInsertLog( NULL ), _deferredIndexInserts( NULL ), _insertsFaulted( false ) {
     }
 
     static bool buildWCError( const Status& wcStatus,
@@ -94,6 +99,14 @@ namespace mongo {
 
         Timer commandTimer;
 
+        // Versioned writes to a collection being cut over to a new shard key would only be
+        // turned away as stale, so hold them off here, outside the locks, for a while.
+        const BatchedRequestMetadata* requestMetadata = request.getMetadata();
+        if ( shardingState.enabled() && requestMetadata &&
+                requestMetadata->isShardVersionSet() ) {
+            waitTillNotInReshardingCriticalSection( request.getTargetingNS(), 30 );
+        }
+
         WriteStats stats;
         std::auto_ptr<WriteErrorDetail> error( new WriteErrorDetail );
         bool verbose = request.isVerboseWC();
@@ -103,13 +116,32 @@ namespace mongo {
         size_t numBatchItems = request.sizeWriteOps();
         size_t numItemErrors = 0;
         bool staleBatch = false;
-        for ( size_t i = 0; i < numBatchItems; i++ ) {
+
+        // Plain inserts are applied in groups under one lock, so that their oplog entries are
+        // written together.  Index builds still go one at a time.
+        const bool groupInserts =
+            request.getBatchType() == BatchedCommandRequest::BatchType_Insert &&
+            nsToCollectionSubstring( request.getNS() ) != "system.indexes";
+
+        size_t i = 0;
+        while ( i < numBatchItems ) {
 
             BSONObj upsertedID = BSONObj();
-            if ( applyWriteItem( BatchItemRef( &request, i ),
-                                 &stats,
-                                 &upsertedID,
-                                 error.get() ) ) {
+            bool itemSuccess;
+            if ( groupInserts ) {
+                // Moves 'i' past the inserts applied, or to the one that failed
+                itemSuccess = applyInsertGroup( request, &i, &stats, error.get() );
+                if ( itemSuccess )
+                    continue;
+            }
+            else {
+                itemSuccess = applyWriteItem( BatchItemRef( &request, i ),
+                                              &stats,
+                                              &upsertedID,
+                                              error.get() );
+            }
+
+            if ( itemSuccess ) {
 
                 // In case updates turned out to be upserts, the callers may be interested
                 // in learning what _id was used for that document.
@@ -139,6 +171,7 @@ namespace mongo {
 
                 error.reset( new WriteErrorDetail );
             }
+            i++;
         }
 
         // Send opTime in response
@@ -235,6 +268,50 @@ namespace mongo {
             return 0;
         }
 
+        // Starts 'childOp', the operation for a single write item.
+        void startItemOp( Client* client, CurOp& childOp, int opCode, const string& ns ) {
+            HostAndPort remote =
+                client->hasRemote() ? client->getRemote() : HostAndPort( "0.0.0.0", 0 );
+
+            // TODO Modify CurOp "wrapped" constructor to take an opcode, so calling .reset()
+            // is unneeded
+            childOp.reset( remote, opCode );
+
+            childOp.ensureStarted();
+            childOp.debug().ns = ns;
+        }
+
+        // Finishes the write item's 'childOp', recording its stats and logging and profiling
+        // it as needed.
+        void finishItemOp( Client* client, CurOp& childOp, int opCode ) {
+            OpDebug& opDebug = childOp.debug();
+
+            childOp.done();
+
+            opDebug.executionTime = childOp.totalTimeMillis();
+            opDebug.recordStats();
+
+            // Log operation if running with at least "-v", or if exceeds slow threshold.
+            if (logger::globalLogDomain()->shouldLog(logger::LogSeverity::Debug(1))
+                 || opDebug.executionTime >
+                    serverGlobalParams.slowMS + childOp.getExpectedLatencyMs()) {
+
+                MONGO_TLOG(1) << opDebug.report( childOp ) << endl;
+            }
+
+            // TODO Log operation if logLevel >= 3 and assertion thrown (as assembleResponse()
+            // does).
+
+            // Save operation to system.profile if shouldDBProfile().
+            if ( childOp.shouldDBProfile( opDebug.executionTime ) ) {
+                profile( *client, opCode, childOp );
+            }
+        }
+
+        // Inserts applied together by applyInsertGroup(), by count and by size
+        const size_t kMaxInsertGroupSize = 64;
+        const int kMaxInsertGroupBytes = 1024 * 1024;
+
     } // namespace
 
     bool WriteBatchExecutor::applyWriteItem( const BatchItemRef& itemRef,
@@ -258,54 +335,165 @@ namespace mongo {
             try {
                 // Execute the write item as a child operation of the current operation.
                 CurOp childOp( _client, _client->curop() );
-
-                HostAndPort remote =
-                    _client->hasRemote() ? _client->getRemote() : HostAndPort( "0.0.0.0", 0 );
-
-                // TODO Modify CurOp "wrapped" constructor to take an opcode, so calling .reset()
-                // is unneeded
-                childOp.reset( remote, getOpCode( request.getBatchType() ) );
-
-                childOp.ensureStarted();
-                OpDebug& opDebug = childOp.debug();
-                opDebug.ns = ns;
+                startItemOp( _client, childOp, getOpCode( request.getBatchType() ), ns );
                 {
                     Lock::DBWrite dbLock( ns );
+                    Lock::CollectionLockStats lockStats( dbLock, ns );
                     Client::Context ctx( ns,
                                          storageGlobalParams.dbpath, // TODO: better constructor?
                                          false /* don't check version here */);
 
                     opSuccess = doWrite( ns, ctx, itemRef, &childOp, stats, upsertedID, error );
                 }
-                childOp.done();
-                //itemTimeMicros = childOp.totalTimeMicros();
+                finishItemOp( _client, childOp, getOpCode( request.getBatchType() ) );
+                break;
+            }
+            catch ( PageFaultException& e ) {
+                e.touch();
+            }
+        }
 
-                opDebug.executionTime = childOp.totalTimeMillis();
-                opDebug.recordStats();
+        return opSuccess;
+    }
 
-                // Log operation if running with at least "-v", or if exceeds slow threshold.
-                if (logger::globalLogDomain()->shouldLog(logger::LogSeverity::Debug(1))
-                     || opDebug.executionTime >
-                        serverGlobalParams.slowMS + childOp.getExpectedLatencyMs()) {
+    bool WriteBatchExecutor::applyInsertGroup( const BatchedCommandRequest& request,
+                                               size_t* index,
+                                               WriteStats* stats,
+                                               WriteErrorDetail* error ) {
+        const string& ns = request.getNS();
+        const size_t end = std::min( request.sizeWriteOps(), *index + kMaxInsertGroupSize );
 
-                    MONGO_TLOG(1) << opDebug.report( childOp ) << endl;
-                }
+        // Once one group has faulted the collection is likely not in memory, so rather than
+        // fault again holding the write lock, read the pages in beforehand.
+        if ( _insertsFaulted )
+            prefetchInsertGroup( request, *index, end );
 
-                // TODO Log operation if logLevel >= 3 and assertion thrown (as assembleResponse()
-                // does).
+        PageFaultRetryableSection s;
+        while ( true ) {
+            try {
+                Lock::DBWrite dbLock( ns );
+                Lock::CollectionLockStats lockStats( dbLock, ns );
+                Client::Context ctx( ns,
+                                     storageGlobalParams.dbpath, // TODO: better constructor?
+                                     false /* don't check version here */);
 
-                // Save operation to system.profile if shouldDBProfile().
-                if ( childOp.shouldDBProfile( opDebug.executionTime ) ) {
-                    profile( *_client, getOpCode( request.getBatchType() ), childOp );
+                // The group is one operation, as an OP_INSERT of several documents is
+                CurOp childOp( _client, _client->curop() );
+                startItemOp( _client, childOp, dbInsert, ns );
+
+                std::vector<BSONObj> toLog;
+                DeferredIndexInserts deferredIndexes;
+                const size_t groupStart = *index;
+                bool opSuccess = true;
+                int groupBytes = 0;
+
+                _deferredInsertLog = &toLog;
+                _deferredIndexInserts = &deferredIndexes;
+                try {
+                    while ( opSuccess && *index < end && groupBytes < kMaxInsertGroupBytes ) {
+                        // Clear operation's LastError before starting.
+                        _le->reset( true );
+
+                        BSONObj upsertedID;
+                        opSuccess = doWrite( ns,
+                                             ctx,
+                                             BatchItemRef( &request, *index ),
+                                             &childOp,
+                                             stats,
+                                             &upsertedID,
+                                             error );
+
+                        if ( opSuccess ) {
+                            groupBytes += request.getInsertRequest()->getDocumentsAt( *index )
+                                .objsize();
+                            ++*index;
+                        }
+                    }
                 }
-                break;
+                catch ( ... ) {
+                    // The inserts already applied have to be indexed and reach the oplog
+                    // before the lock is released, whatever stopped the group.  Should that
+                    // fail, the retry of a page fault resumes with the insert undone.
+                    _deferredInsertLog = NULL;
+                    _deferredIndexInserts = NULL;
+                    WriteErrorDetail flushError;
+                    flushInsertGroupIndexes( ns, ctx, &deferredIndexes, groupStart, index,
+                                             &toLog, stats, &flushError );
+                    logInsertOps( ns.c_str(), toLog );
+                    childOp.debug().ninserted = toLog.size();
+                    finishItemOp( _client, childOp, dbInsert );
+                    throw;
+                }
+                _deferredInsertLog = NULL;
+                _deferredIndexInserts = NULL;
+                if ( !flushInsertGroupIndexes( ns, ctx, &deferredIndexes, groupStart, index,
+                                               &toLog, stats, error ) ) {
+                    opSuccess = false;
+                }
+                logInsertOps( ns.c_str(), toLog );
+                getDur().commitIfNeeded();
+
+                childOp.debug().ninserted = toLog.size();
+                finishItemOp( _client, childOp, dbInsert );
+
+                return opSuccess;
             }
             catch ( PageFaultException& e ) {
+                // Resumes with the insert that faulted
+                _insertsFaulted = true;
                 e.touch();
             }
         }
+    }
 
-        return opSuccess;
+    bool WriteBatchExecutor::flushInsertGroupIndexes( const string& ns,
+                                                      Client::Context& ctx,
+                                                      DeferredIndexInserts* deferred,
+                                                      size_t groupStart,
+                                                      size_t* index,
+                                                      std::vector<BSONObj>* toLog,
+                                                      WriteStats* stats,
+                                                      WriteErrorDetail* error ) {
+        if ( deferred->empty() )
+            return true;
+
+        // The inserts are already applied, so there is no going back to fault pages in
+        NoPageFaultsAllowed npfa;
+
+        Collection* collection = ctx.db()->getCollection( ns );
+        size_t firstFailed;
+        Status status = collection->flushDeferredInserts( deferred, &firstFailed );
+        if ( status.isOK() )
+            return true;
+
+        // Any error of a later insert is superseded by this one
+        dassert( firstFailed < toLog->size() );
+        stats->numInserted -= static_cast<int>( toLog->size() - firstFailed );
+        toLog->resize( firstFailed );
+        *index = groupStart + firstFailed;
+
+        error->clear();
+        error->setErrCode( status.code() );
+        error->setErrMessage( status.reason() );
+        return false;
+    }
+
+    void WriteBatchExecutor::prefetchInsertGroup( const BatchedCommandRequest& request,
+                                                  size_t begin,
+                                                  size_t end ) {
+        const string& ns = request.getNS();
+        Lock::DBRead lk( ns );
+        Client::Context ctx( ns,
+                             storageGlobalParams.dbpath,
+                             false /* the inserts check the version themselves */ );
+
+        Collection* collection = ctx.db()->getCollection( ns );
+        if ( !collection )
+            return;
+
+        for ( size_t i = begin; i < end; ++i ) {
+            prefetchAllIndexPages( collection, request.getInsertRequest()->getDocumentsAt( i ) );
+        }
     }
 
     static void toBatchedError( const UserException& ex, WriteErrorDetail* error ) {
@@ -373,7 +561,8 @@ namespace mongo {
                     metadata ? metadata->getShardVersion() : ChunkVersion::UNSHARDED();
 
                 if ( !requestMetadata->getShardVersion() //
-                    .isWriteCompatibleWith( shardVersion ) ) {
+                        .isWriteCompatibleWith( shardVersion )
+                    || inReshardingCriticalSection( targetingNS ) ) {
 
                     buildStaleError( requestMetadata->getShardVersion(), shardVersion, error );
                     return false;
@@ -513,14 +702,22 @@ namespace mongo {
 
             const BSONObj& toInsert = fixed.getValue().isEmpty() ? insertOp : fixed.getValue();
 
-            StatusWith<DiskLoc> status = collection->insertDocument( toInsert, true );
-            logOp( "i", ns.c_str(), insertOp );
-            getDur().commitIfNeeded();
+            StatusWith<DiskLoc> status = collection->insertDocument( toInsert,
+                                                                     true,
+                                                                     _deferredIndexInserts );
             if ( !status.isOK() ) {
                 error->setErrMessage( status.getStatus().toString() );
                 error->setErrCode( status.getStatus().code() );
                 return false;
             }
+            if ( _deferredInsertLog ) {
+                // Logged, and committed, with the rest of the group by applyInsertGroup()
+                _deferredInsertLog->push_back( insertOp );
+            }
+            else {
+                logOp( "i", ns.c_str(), insertOp );
+                getDur().commitIfNeeded();
+            }
             _le->nObjects = 1; // TODO Replace after implementing LastError::recordInsert().
             opDebug.ninserted = 1;
             stats->numInserted++;
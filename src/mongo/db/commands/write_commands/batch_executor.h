@@ -29,6 +29,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/db/client.h"
@@ -42,6 +43,7 @@ namespace mongo {
 
     class BSONObjBuilder;
     class CurOp;
+    class DeferredIndexInserts;
     class OpCounters;
     class OpDebug;
     struct LastError;
@@ -95,6 +97,40 @@ namespace mongo {
                              BSONObj* upsertedID,
                              WriteErrorDetail* error );
 
+        /**
+         * Issues the inserts of 'request' from '*index' on, a group of them at a time under a
+         * single lock, and logs them to the oplog together.  Returns true and moves '*index'
+         * past the group if every insert was issued; otherwise returns false, leaving '*index'
+         * at the insert that failed, and populates 'error'.
+         */
+        bool applyInsertGroup( const BatchedCommandRequest& request,
+                               size_t* index,
+                               WriteStats* stats,
+                               WriteErrorDetail* error );
+
+        /**
+         * Inserts the index keys held in 'deferred' for the group of inserts applied from
+         * 'groupStart' on.  If some can't be, the inserts from the first one they belong to on
+         * are undone: they are dropped from 'toLog' and 'stats', '*index' is moved back to that
+         * insert, and 'error' is populated.  Returns false in that case.
+         */
+        bool flushInsertGroupIndexes( const string& ns,
+                                      Client::Context& ctx,
+                                      DeferredIndexInserts* deferred,
+                                      size_t groupStart,
+                                      size_t* index,
+                                      std::vector<BSONObj>* toLog,
+                                      WriteStats* stats,
+                                      WriteErrorDetail* error );
+
+        /**
+         * Reads in, under a read lock, the index pages that the inserts of 'request' from
+         * 'begin' to 'end' will walk.
+         */
+        void prefetchInsertGroup( const BatchedCommandRequest& request,
+                                  size_t begin,
+                                  size_t end );
+
         //
         // Helpers to issue underlying write.
         // Returns true iff write item was issued sucessfully and increments stats, populates error
@@ -146,6 +182,20 @@ namespace mongo {
         // Not owned here.
         LastError* _le;
 
+        // Set while applyInsertGroup() holds the lock across several inserts, which doInsert()
+        // then queues here for the oplog rather than logging one at a time.
+        // Not owned here.
+        std::vector<BSONObj>* _deferredInsertLog;
+
+        // Set along with _deferredInsertLog, to hold back the keys of the group's inserts for
+        // indexes that can take them in bulk, in key order.
+        // Not owned here.
+        DeferredIndexInserts* _deferredIndexInserts;
+
+        // Whether an insert group has page faulted, after which the groups that follow are
+        // prefetched before taking the write lock.
+        bool _insertsFaulted;
+
     };
 
 } // namespace mongo
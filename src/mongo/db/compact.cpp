@@ -48,6 +48,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/storage/record_compression.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/util/concurrency/task.h"
 #include "mongo/util/timer.h"
@@ -112,6 +113,13 @@ namespace mongo {
                         nrecords++;
                         unsigned sz = objOld.objsize();
 
+                        // compressed records are copied as they are
+                        const char* data = objOld.objdata();
+                        if ( RecordCompression::isCompressed( recOld->data() ) ) {
+                            data = recOld->data();
+                            sz = RecordCompression::storedSize( data );
+                        }
+
                         oldObjSize += sz;
                         oldObjSizeWithPadding += recOld->netLength();
 
@@ -141,7 +149,7 @@ namespace mongo {
                         datasize += recNew->netLength();
                         recNew = (Record *) getDur().writingPtr(recNew, lenWHdr);
                         addRecordToRecListInExtent(recNew, loc);
-                        memcpy(recNew->data(), objOld.objdata(), sz);
+                        memcpy(recNew->data(), data, sz);
                     }
                     else { 
                         if( ++skipped <= 10 )
@@ -90,6 +90,7 @@ namespace mongo {
 
         // debugging/profile info
         long long nscanned;
+        long long nscannedObjects;
         bool idhack;         // indicates short circuited code path on an update to make the update faster
         bool scanAndOrder;   // scanandorder query plan aspect was used
         long long  nupdated; // number of records updated (including no-ops)
@@ -109,6 +110,10 @@ namespace mongo {
         int executionTime;
         int nreturned;
         int responseLength;
+        long long recvMicros;    // reading the request off the wire, for one from a client
+
+        // plan cache key of a query or getMore whose cost goes to queryShapeStats, else empty
+        std::string queryShape;
     };
 
     /**
@@ -193,6 +198,7 @@ namespace mongo {
         void reset();
         void reset( const HostAndPort& remote, int op );
         void markCommand() { _command = true; }
+        bool isCommand() const { return _command; }
         OpDebug& debug()           { return _debug; }
         int profileLevel() const   { return _dbprofile; }
         const char * getNS() const { return _ns; }
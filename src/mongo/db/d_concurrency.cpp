@@ -39,12 +39,14 @@
 #include "mongo/db/dur.h"
 #include "mongo/db/lockstat.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/server.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/concurrency/mapsf.h"
 #include "mongo/util/concurrency/qlock.h"
 #include "mongo/util/concurrency/rwlock.h"
 #include "mongo/util/concurrency/threadlocal.h"
+#include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/stacktrace.h"
 
 // oplog locking
@@ -89,6 +91,95 @@ namespace mongo {
     // perhaps move this elsewhere as this could be used in mongos and this file is for mongod
     HLMutex::HLMutex(const char *name) : SimpleMutex(name) { }
 
+    /* Admission control: a user connection's outermost lock first takes a read ('r', 'R') or
+       write ('w', 'W') ticket, so that however many connections there are, at most this many
+       of each are queued on or holding the locks below.  Tickets are given back across a
+       TempRelease.  Internal threads (replication, journaling, TTL...) don't take tickets, so
+       they can't be starved by user operations.
+    */
+    class AdmissionTickets : boost::noncopyable {
+    public:
+        AdmissionTickets(int n) : _holder(n) { }
+
+        void acquire() {
+            if ( _holder.tryAcquire() )
+                return;
+            _queued.fetchAndAdd(1);
+            Timer t;
+            _holder.waitForTicket();
+            _queued.fetchAndSubtract(1);
+            _waits.fetchAndAdd(1);
+            _waitMicros.fetchAndAdd(t.micros());
+        }
+
+        void release() { _holder.release(); }
+
+        TicketHolder& holder() { return _holder; }
+
+        BSONObj report() const {
+            BSONObjBuilder b;
+            b.append( "out" , _holder.used() );
+            b.append( "available" , _holder.available() );
+            b.append( "totalTickets" , _holder.outof() );
+            b.append( "queued" , _queued.load() );
+            b.append( "waits" , _waits.load() );
+            b.append( "waitMicros" , _waitMicros.load() );
+            return b.obj();
+        }
+
+    private:
+        TicketHolder _holder;
+        AtomicInt32 _queued;
+        AtomicInt64 _waits;
+        AtomicInt64 _waitMicros;
+    };
+
+    static AdmissionTickets& readTickets = *new AdmissionTickets(128);
+    static AdmissionTickets& writeTickets = *new AdmissionTickets(128);
+
+    class TicketsParameter : public ServerParameter {
+    public:
+        TicketsParameter( const string& name, AdmissionTickets* tickets )
+            : ServerParameter( ServerParameterSet::getGlobal(), name ),
+              _tickets( tickets ) {
+        }
+
+        virtual void append( BSONObjBuilder& b, const string& name ) {
+            b.append( name, _tickets->holder().outof() );
+        }
+
+        virtual Status set( const BSONElement& newValueElement ) {
+            if ( !newValueElement.isNumber() )
+                return Status( ErrorCodes::BadValue, name() + " has to be a number" );
+            return set( newValueElement.numberInt() );
+        }
+
+        virtual Status setFromString( const string& str ) {
+            int num;
+            Status status = parseNumberFromString( str, &num );
+            if ( !status.isOK() )
+                return status;
+            return set( num );
+        }
+
+        Status set( int n ) {
+            if ( n < 1 )
+                return Status( ErrorCodes::BadValue, name() + " has to be at least 1" );
+            if ( !_tickets->holder().resize( n ) ) {
+                return Status( ErrorCodes::BadValue, str::stream()
+                               << "can't set " << name() << " to " << n << " while "
+                               << _tickets->holder().used() << " tickets are out" );
+            }
+            return Status::OK();
+        }
+
+    private:
+        AdmissionTickets* _tickets;
+    };
+
+    TicketsParameter readTicketsParameter( "concurrentReadTickets", &readTickets );
+    TicketsParameter writeTicketsParameter( "concurrentWriteTickets", &writeTickets );
+
     /* dbname->lock
        Currently these are never deleted - will linger if db was closed. (that should be fine.)
        We don't put the lock inside the Database object as those can come and go with open and 
@@ -100,6 +191,15 @@ namespace mongo {
     typedef mapsf< StringMap<WrapperForRWLock*> > DBLocksMap;
     static DBLocksMap dblocks;
 
+    /* full ns->lock stats, for Lock::CollectionLockStats.  Bounded, and entries go when their
+       collection or database is dropped, as temp collections come and go all the time.
+    */
+    typedef StringMap<LockStat*> CollectionLockStatsMap;
+    static SimpleMutex collectionLockStatsMutex("collectionLockStats");
+    static CollectionLockStatsMap collectionLockStatsMap;
+    static const size_t MaxCollectionLockStats = 1000;
+    static LockStat collectionLockStatsOverflow; // collections written once the map was full
+
     /* we don't want to touch dblocks too much as a mutex is involved.  thus party for that, 
        this is here...
     */
@@ -122,6 +222,8 @@ namespace mongo {
     public:
         LockStat stats;
 
+        WrapperForQLock() : stats(true) { }
+
         void lock_r() { 
             verify( threadState() == 0 );
             lockState().lockedStart( 'r' );
@@ -299,29 +401,52 @@ namespace mongo {
 
 
     Lock::ScopedLock::ScopedLock( char type ) 
-        : _type(type), _stat(0) {
+        : _collectionStats(0), _type(type), _stat(0), _acquireMicros(0), _tickets(0) {
         LockState& ls = lockState();
         ls.enterScopedLock( this );
+        if ( ls.recursiveCount() == 1 )
+            acquireTicket();
     }
     Lock::ScopedLock::~ScopedLock() { 
+        releaseTicket();
         LockState& ls = lockState();
         int prevCount = ls.recursiveCount();
         Lock::ScopedLock* what = ls.leaveScopedLock();
         fassert( 16171 , prevCount != 1 || what == this );
     }
+
+    void Lock::ScopedLock::acquireTicket() {
+        if ( !cc().hasRemote() )
+            return;
+        AdmissionTickets* tickets = ( _type == 'r' || _type == 'R' ) ? &readTickets
+                                                                     : &writeTickets;
+        tickets->acquire();
+        _tickets = tickets;
+    }
+
+    void Lock::ScopedLock::releaseTicket() {
+        if ( !_tickets )
+            return;
+        _tickets->release();
+        _tickets = 0;
+    }
     
     long long Lock::ScopedLock::acquireFinished( LockStat* stat ) {
         long long acquisitionTime = _timer.micros();
         _timer.reset();
         _stat = stat;
+        _acquireMicros = acquisitionTime;
         cc().curop()->lockStat().recordAcquireTimeMicros( _type , acquisitionTime );
         return acquisitionTime;
     }
 
     void Lock::ScopedLock::tempRelease() {
         long long micros = _timer.micros();
+        if ( _collectionStats )
+            _collectionStats->record( 0, micros );
         _tempRelease();
         _pbws_lk.tempRelease();
+        releaseTicket();
         _recordTime( micros ); // might as well do after we unlock
     }
 
@@ -340,6 +465,7 @@ namespace mongo {
     }
     
     void Lock::ScopedLock::relock() {
+        acquireTicket();
         _pbws_lk.relock();
         _relock();
         resetTime();
@@ -744,6 +870,78 @@ namespace mongo {
         _weLocked = ls.otherLock();
     }
 
+    Lock::CollectionLockStats::CollectionLockStats( ScopedLock& lk, const StringData& ns )
+        : _lk(lk), _ns(ns.toString()) {
+        _recording = !lockState().isW() && lockState().recursiveCount() == 1;
+        if( _recording ) {
+            record( _lk.acquireMicros(), 0 );
+            _lk._collectionStats = this;
+        }
+    }
+
+    Lock::CollectionLockStats::~CollectionLockStats() {
+        if( _recording ) {
+            // up to here; the lock records its own time as it goes, after us
+            _lk._collectionStats = 0;
+            record( 0, _lk._timer.micros() );
+        }
+    }
+
+    void Lock::CollectionLockStats::record( long long acquireMicros, long long heldMicros ) {
+        SimpleMutex::scoped_lock lk(collectionLockStatsMutex);
+        LockStat* stat;
+        CollectionLockStatsMap::const_iterator i = collectionLockStatsMap.find(_ns);
+        if( i != collectionLockStatsMap.end() ) {
+            stat = i->second;
+        }
+        else if( collectionLockStatsMap.size() < MaxCollectionLockStats ) {
+            stat = new LockStat();
+            collectionLockStatsMap[_ns] = stat;
+        }
+        else {
+            stat = &collectionLockStatsOverflow;
+        }
+        if( acquireMicros )
+            stat->recordAcquireTimeMicros( 'w', acquireMicros );
+        if( heldMicros )
+            stat->recordLockTimeMicros( 'w', heldMicros );
+    }
+
+    void Lock::collectionDropped( const StringData& ns ) {
+        SimpleMutex::scoped_lock lk(collectionLockStatsMutex);
+        CollectionLockStatsMap::const_iterator i = collectionLockStatsMap.find(ns);
+        if( i == collectionLockStatsMap.end() )
+            return;
+        delete i->second;
+        collectionLockStatsMap.erase(ns);
+    }
+
+    void Lock::databaseDropped( const StringData& db ) {
+        SimpleMutex::scoped_lock lk(collectionLockStatsMutex);
+        vector<string> dropped;
+        for( CollectionLockStatsMap::const_iterator i = collectionLockStatsMap.begin();
+             i != collectionLockStatsMap.end(); ++i ) {
+            if( nsToDatabaseSubstring(i->first) == db )
+                dropped.push_back(i->first);
+        }
+        for( size_t i = 0; i < dropped.size(); i++ ) {
+            delete collectionLockStatsMap.find(dropped[i])->second;
+            collectionLockStatsMap.erase(dropped[i]);
+        }
+    }
+
+    BSONObj Lock::collectionLockStats() {
+        BSONObjBuilder b;
+        SimpleMutex::scoped_lock lk(collectionLockStatsMutex);
+        for( CollectionLockStatsMap::const_iterator i = collectionLockStatsMap.begin();
+             i != collectionLockStatsMap.end(); ++i ) {
+            b.append(i->first, i->second->report());
+        }
+        if( collectionLockStatsMap.size() >= MaxCollectionLockStats )
+            b.append("$other", collectionLockStatsOverflow.report());
+        return b.obj();
+    }
+
     Lock::DBWrite::UpgradeToExclusive::UpgradeToExclusive() {
         fassert( 16187, lockState().threadState() == 'w' );
 
@@ -847,6 +1045,13 @@ namespace mongo {
                 ttt.done();
             }
 
+            {
+                BSONObjBuilder ttt( t.subobjStart( "tickets" ) );
+                ttt.append( "read" , readTickets.report() );
+                ttt.append( "write" , writeTickets.report() );
+                ttt.done();
+            }
+
             return t.obj();
         }
 
@@ -876,4 +1081,17 @@ namespace mongo {
 
     } lockStatsServerStatusSection;
 
+    class CollectionLockStatsServerStatusSection : public ServerStatusSection {
+    public:
+        CollectionLockStatsServerStatusSection() : ServerStatusSection( "collectionLocks" ){}
+
+        // up to one entry per collection, so only on request
+        virtual bool includeByDefault() const { return false; }
+
+        BSONObj generateSection( const BSONElement& configElement ) const {
+            return Lock::collectionLockStats();
+        }
+
+    } collectionLockStatsServerStatusSection;
+
 }
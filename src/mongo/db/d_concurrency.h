@@ -44,6 +44,7 @@ namespace mongo {
 
     class WrapperForRWLock;
     class LockState;
+    class AdmissionTickets;
 
     class Lock : boost::noncopyable { 
     public:
@@ -64,8 +65,13 @@ namespace mongo {
         
         static LockStat* globalLockStat();
         static LockStat* nestableLockStat( Nestable db );
+        static BSONObj collectionLockStats();
+        /** forget a collection's Lock::CollectionLockStats, called when it goes away */
+        static void collectionDropped( const StringData& ns );
+        static void databaseDropped( const StringData& db );
 
         class ScopedLock;
+        class CollectionLockStats;
 
         // note: avoid TempRelease when possible. not a good thing.
         struct TempRelease {
@@ -109,6 +115,11 @@ namespace mongo {
             /** @return micros since we started acquiring */
             long long acquireFinished( LockStat* stat );
 
+            /** @return how long the last acquireFinished() call waited */
+            long long acquireMicros() const { return _acquireMicros; }
+
+            char type() const { return _type; }
+
             // Accrue elapsed lock time since last we called reset
             void recordTime();
             // Start recording a new period, starting now()
@@ -122,6 +133,9 @@ namespace mongo {
             void tempRelease(); // TempRelease class calls these
             void relock();
 
+            friend class CollectionLockStats;
+            CollectionLockStats* _collectionStats; // also gets our lock time, if set
+
         protected:
             virtual void _tempRelease() = 0;
             virtual void _relock() = 0;
@@ -133,6 +147,11 @@ namespace mongo {
             Timer _timer;
             char _type;      // 'r','w','R','W'
             LockStat* _stat; // the stat for the relevant lock to increment when we're done
+            long long _acquireMicros;
+
+            void acquireTicket();
+            void releaseTicket();
+            AdmissionTickets* _tickets; // held by the outermost lock of a user connection
         };
 
         // note that for these classes recursive locking is ok if the recursive locking "makes sense"
@@ -205,6 +224,28 @@ namespace mongo {
             bool _nested;
         };
 
+        /**
+         * Records the acquire and lock time of 'lk', a database write lock taken to write the
+         * one collection 'ns', against that collection as well, for serverStatus'
+         * collectionLocks.  It locks nothing itself: there are no collection locks, the
+         * database lock stays exclusive as extent allocation, the namespace index and the
+         * journal are shared by all of a database's collections.
+         * Nested in another lock, or under W, it records nothing: the outer lock's time covers it.
+         */
+        class CollectionLockStats : boost::noncopyable {
+        public:
+            CollectionLockStats(ScopedLock& lk, const StringData& ns);
+            ~CollectionLockStats();
+
+        private:
+            friend class ScopedLock;
+            void record( long long acquireMicros, long long heldMicros );
+
+            ScopedLock& _lk;
+            const string _ns;
+            bool _recording;
+        };
+
         // lock this database for reading. do not shared_lock globally first, that is handledin herein. 
         class DBRead : public ScopedLock {
             void lockTop(LockState&);
@@ -38,6 +38,7 @@
 #include "mongo/db/audit.h"
 #include "mongo/db/auth/auth_index_d.h"
 #include "mongo/db/background.h"
+#include "mongo/db/client.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/database_holder.h"
 #include "mongo/db/storage/index_details.h"
@@ -51,11 +52,13 @@
 
 namespace mongo {
 
+    AtomicUInt64 Database::_collectionEpoch( 1 );
 
     Database::~Database() {
         verify( Lock::isW() );
         _magic = 0;
 
+        _collectionEpoch.fetchAndAdd( 1 );
         for ( CollectionMap::iterator i = _collections.begin(); i != _collections.end(); ++i ) {
             delete i->second;
         }
@@ -313,6 +316,7 @@ namespace mongo {
 
         ClientCursor::invalidate( fullns );
         Top::global.collectionDropped( fullns );
+        Lock::collectionDropped( fullns );
 
         Status s = _dropNS( fullns );
 
@@ -351,6 +355,7 @@ namespace mongo {
         if ( it == _collections.end() )
             return;
 
+        _collectionEpoch.fetchAndAdd( 1 );
         delete it->second;
         _collections.erase( it );
     }
@@ -358,8 +363,21 @@ namespace mongo {
     Collection* Database::getCollection( const StringData& ns ) {
         verify( _name == nsToDatabaseSubstring( ns ) );
 
+        // Collections are only deleted under the database's write lock, so a collection this
+        // client looked up since the last deletion is still good
+        Client* client = currentClient.get();
+        if ( client ) {
+            Collection* cached = client->collectionLookupCache().get( this, ns,
+                                                                      collectionEpoch() );
+            if ( cached )
+                return cached;
+        }
+
         scoped_lock lk( _collectionLock );
 
+        // read under _collectionLock, as deletions move it on under it
+        const unsigned long long epoch = collectionEpoch();
+
         string myns = ns.toString();
 
         CollectionMap::const_iterator it = _collections.find( myns );
@@ -374,6 +392,8 @@ namespace mongo {
                     }
                     verify( details == it->second->_details );
                 }
+                if ( client )
+                    client->collectionLookupCache().add( this, ns, it->second, epoch );
                 return it->second;
             }
         }
@@ -385,6 +405,8 @@ namespace mongo {
 
         Collection* c = new Collection( ns, details, this );
         _collections[myns] = c;
+        if ( client )
+            client->collectionLookupCache().add( this, ns, c, epoch );
         return c;
     }
 
@@ -441,6 +463,7 @@ namespace mongo {
         }
 
         Top::global.collectionDropped( fromNS.toString() );
+        Lock::collectionDropped( fromNS );
 
         return Status::OK();
     }
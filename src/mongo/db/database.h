@@ -34,6 +34,7 @@
 #include "mongo/db/storage/extent_manager.h"
 #include "mongo/db/storage/record.h"
 #include "mongo/db/storage_options.h"
+#include "mongo/platform/atomic_word.h"
 
 namespace mongo {
 
@@ -139,6 +140,13 @@ namespace mongo {
          */
         Collection* getCollection( const StringData& ns );
 
+        /**
+         * Moves on whenever a Collection object of any database is deleted, so that
+         * Collection pointers cached at an older epoch are known to be stale.
+         * See CollectionLookupCache.
+         */
+        static unsigned long long collectionEpoch() { return _collectionEpoch.load(); }
+
         Collection* getOrCreateCollection( const StringData& ns );
 
         Status renameCollection( const StringData& fromNS, const StringData& toNS, bool stayTemp );
@@ -220,6 +228,8 @@ namespace mongo {
         CollectionMap _collections;
         mutex _collectionLock;
 
+        static AtomicUInt64 _collectionEpoch;
+
         friend class Collection;
         friend class NamespaceDetails;
         friend class IndexDetails;
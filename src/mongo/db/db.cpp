@@ -49,6 +49,7 @@
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/dbwebserver.h"
 #include "mongo/db/dur.h"
+#include "mongo/db/free_space_monitor.h"
 #include "mongo/db/index_names.h"
 #include "mongo/db/index_rebuilder.h"
 #include "mongo/db/initialize_server_global_state.h"
@@ -65,11 +66,15 @@
 #include "mongo/db/repl/replication_server_status.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/restapi.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/startup_warnings.h"
 #include "mongo/db/stats/counters.h"
+#include "mongo/db/stats/diagnostic_capture.h"
+#include "mongo/db/stats/sampling_profiler.h"
 #include "mongo/db/stats/snapshots.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/db/ttl.h"
+#include "mongo/db/warm_cache.h"
 #include "mongo/platform/process_id.h"
 #include "mongo/s/d_writeback.h"
 #include "mongo/scripting/engine.h"
@@ -82,6 +87,7 @@
 #include "mongo/util/net/message_server.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/ntservice.h"
+#include "mongo/util/numa.h"
 #include "mongo/util/options_parser/startup_options.h"
 #include "mongo/util/ramlog.h"
 #include "mongo/util/stacktrace.h"
@@ -204,7 +210,13 @@ namespace mongo {
                 }
 
                 if ( dbresponse.response ) {
-                    port->reply(m, *dbresponse.response, dbresponse.responseTo);
+                    if( dbresponse.exhaustNS.empty() ) {
+                        port->replyPipelined(m, *dbresponse.response, dbresponse.responseTo);
+                    }
+                    else {
+                        // the next batch answers this reply's id, which say() sets
+                        port->reply(m, *dbresponse.response, dbresponse.responseTo);
+                    }
                     if( dbresponse.exhaustNS.size() > 0 ) {
                         MsgData *header = dbresponse.response->header();
                         QueryResult *qr = (QueryResult *) header;
@@ -232,6 +244,12 @@ namespace mongo {
                 }
                 break;
             }
+
+            // the op's own log line went out before its reply did
+            if ( port->lastReplyMicros() > serverGlobalParams.slowMS * 1000LL ) {
+                log() << "slow reply to " << port->remote() << ": "
+                      << port->lastReplyMicros() / 1000 << "ms" << endl;
+            }
         }
 
         virtual void disconnected( AbstractMessagingPort* p ) {
@@ -239,6 +257,21 @@ namespace mongo {
             if( c ) c->shutdown();
         }
 
+        virtual bool supportsWorkerPool() const { return true; }
+
+        virtual void* detach( AbstractMessagingPort* p , bool closing ) {
+            Client* c = Client::detachFromThread();
+            if ( closing ) {
+                delete c;
+                return 0;
+            }
+            return c;
+        }
+
+        virtual void attach( AbstractMessagingPort* p , void* state ) {
+            Client::attachToThread( static_cast<Client*>( state ) );
+        }
+
     };
 
     void logStartup() {
@@ -320,38 +353,21 @@ namespace mongo {
         return repairDatabase( dbName.c_str(), errmsg );
     }
 
-    void checkForIdIndexes( Database* db ) {
-
-        if ( db->name() == "local") {
-            // we do not need an _id index on anything in the local database
-            return;
-        }
-
-        list<string> collections;
-        db->namespaceIndex().getNamespaces( collections );
-
-        // for each collection, ensure there is a $_id_ index
-        for (list<string>::iterator i = collections.begin(); i != collections.end(); ++i) {
-            const string& collectionName = *i;
-            NamespaceString ns( collectionName );
-            if ( ns.isSystem() )
-                continue;
-
-            Collection* coll = db->getCollection( collectionName );
-            if ( !coll )
-                continue;
-
-            if ( coll->getIndexCatalog()->findIdIndex() )
-                continue;
-
-            log() << "WARNING: the collection '" << *i
-                  << "' lacks a unique index on _id."
-                  << " This index is needed for replication to function properly"
-                  << startupWarningsLog;
-            log() << "\t To fix this, on the primary run 'db." << i->substr(i->find('.')+1)
-                  << ".createIndex({_id: 1}, {unique: true})'"
-                  << startupWarningsLog;
-        }
+    /**
+     * Reads the header of the first datafile of 'dbName' into 'header' without opening the
+     * database.  Returns false if the file can't be read.
+     */
+    static bool readDataFileHeader(const string& dbName, DataFileHeader* header) {
+        boost::filesystem::path fullName(storageGlobalParams.dbpath);
+        if (storageGlobalParams.directoryperdb)
+            fullName /= dbName;
+        fullName /= dbName + ".0";
+
+        std::ifstream file(fullName.string().c_str(), std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            return false;
+        file.read(reinterpret_cast<char*>(header), DataFileHeader::HeaderSize);
+        return file.gcount() == DataFileHeader::HeaderSize;
     }
 
     // ran at startup.
@@ -362,20 +378,36 @@ namespace mongo {
         Lock::GlobalWrite lk;
         vector< string > dbNames;
         getDatabaseNames( dbNames );
+        Timer t;
         for ( vector< string >::iterator i = dbNames.begin(); i != dbNames.end(); ++i ) {
             string dbName = *i;
             LOG(1) << "\t" << dbName << endl;
 
+            const size_t checked = i - dbNames.begin();
+            if (checked > 0 && checked % 1000 == 0) {
+                log() << "checked " << checked << " of " << dbNames.size() << " databases in "
+                      << t.millis() << "ms" << endl;
+            }
+
+            const bool clearTmp = shouldClearNonLocalTmpCollections || dbName == "local";
+
+            // Most databases need nothing but a look at their version, which doesn't need
+            // them opened.  Collections lacking an _id index are reported by the index
+            // rebuilder, which walks every collection anyway.
+            if (!clearTmp && !mongodGlobalParams.repair) {
+                DataFileHeader header;
+                if (readDataFileHeader(dbName, &header) &&
+                        header.version == PDFILE_VERSION &&
+                        header.versionMinor == PDFILE_VERSION_MINOR_24_AND_NEWER) {
+                    continue;
+                }
+            }
+
             Client::Context ctx( dbName );
             DataFile *p = ctx.db()->getFile( 0 );
             DataFileHeader *h = p->getHeader();
 
-            if ( replSettings.usingReplSets() ) {
-                // we only care about the _id index if we are in a replset
-                checkForIdIndexes(ctx.db());
-            }
-
-            if (shouldClearNonLocalTmpCollections || dbName == "local")
+            if (clearTmp)
                 ctx.db()->clearTmpCollections();
 
             if (!h->isCurrentVersion() || mongodGlobalParams.repair) {
@@ -438,6 +470,7 @@ namespace mongo {
         }
 
         LOG(1) << "done repairDatabases" << endl;
+        log() << "checked " << dbNames.size() << " databases in " << t.millis() << "ms" << endl;
 
         if (mongodGlobalParams.upgrade) {
             log() << "finished checking dbs" << endl;
@@ -629,6 +662,10 @@ namespace mongo {
 #endif // __linux__
     }
 
+    // pin connection threads to NUMA nodes and interleave the data files, instead of running
+    // under numactl --interleave=all
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(numaPlacement, bool, false);
+
     void _initAndListen(int listenPort ) {
 
         Client::initThread("initandlisten");
@@ -646,6 +683,8 @@ namespace mongo {
             l << ( is32bit ? " 32" : " 64" ) << "-bit host=" << getHostNameCached() << endl;
         }
         DEV log() << "_DEBUG build (which is slower)" << endl;
+        if (numaPlacement)
+            numa::enable();
         logStartupWarnings();
 #if defined(_WIN32)
         printTargetMinOS();
@@ -724,6 +763,7 @@ namespace mongo {
         srand((unsigned) (curTimeMicros() ^ startupSrandTimer.micros()));
 
         snapshotThread.go();
+        startDiagnosticDataCapture();
         d.clientCursorMonitor.go();
         PeriodicTask::startRunningPeriodicTasks();
         if (missingRepl) {
@@ -733,6 +773,13 @@ namespace mongo {
             startTTLBackgroundJob();
         }
 
+        startFreeSpaceMonitor();
+
+        startWarmCacheRestore();
+        startWarmCacheSnapshots();
+
+        startSamplingProfiler();
+
 #ifndef _WIN32
         mongo::signalForkSuccess();
 #endif
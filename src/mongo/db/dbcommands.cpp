@@ -1036,6 +1036,11 @@ namespace mongo {
                 result.append( "capped" , collection->isCapped() );
                 result.appendNumber( "max" , nsd->maxCappedDocs() );
             }
+            else {
+                collection->getRecordStore()->appendFreeListStats( &result );
+                collection->getRecordStore()->appendCompressionStats( &result );
+                collection->getRecordStore()->appendPaddingStats( &result );
+            }
 
             if ( verbose )
                 result.appendArray( "extents" , extents.arr() );
@@ -1054,6 +1059,8 @@ namespace mongo {
             help << 
                 "Sets collection options.\n"
                 "Example: { collMod: 'foo', usePowerOf2Sizes:true }\n"
+                "Example: { collMod: 'foo', scanReadahead:false }\n"
+                "Example: { collMod: 'foo', compressRecords:true }\n"
                 "Example: { collMod: 'foo', index: {keyPattern: {a: 1}, expireAfterSeconds: 600} }";
         }
         virtual void addRequiredPrivileges(const std::string& dbname,
@@ -1097,6 +1104,41 @@ namespace mongo {
                         result.appendBool( "usePowerOf2Sizes_new", newPowerOf2 );
                     }
                 }
+                else if ( str::equals( "scanReadahead", e.fieldName() ) ) {
+                    bool oldReadahead = !nsd->isUserFlagSet(NamespaceDetails::Flag_NoScanReadahead);
+                    bool newReadahead = e.trueValue();
+
+                    if ( oldReadahead != newReadahead ) {
+                        result.appendBool( "scanReadahead_old", oldReadahead );
+
+                        newReadahead ? nsd->clearUserFlag( NamespaceDetails::Flag_NoScanReadahead ) :
+                                       nsd->setUserFlag( NamespaceDetails::Flag_NoScanReadahead );
+                        nsd->syncUserFlags( ns ); // must keep system.namespaces up-to-date
+
+                        result.appendBool( "scanReadahead_new", newReadahead );
+                    }
+                }
+                else if ( str::equals( "compressRecords", e.fieldName() ) ) {
+                    bool oldCompress = nsd->isUserFlagSet(NamespaceDetails::Flag_CompressRecords);
+                    bool newCompress = e.trueValue();
+
+                    if ( newCompress && ( nsd->isCapped() || NamespaceString( ns ).isSystem() ) ) {
+                        errmsg = "compressRecords is not supported for capped or system collections";
+                        ok = false;
+                        continue;
+                    }
+
+                    if ( oldCompress != newCompress ) {
+                        // existing records stay as they are, readers handle both
+                        result.appendBool( "compressRecords_old", oldCompress );
+
+                        newCompress ? nsd->setUserFlag( NamespaceDetails::Flag_CompressRecords ) :
+                                      nsd->clearUserFlag( NamespaceDetails::Flag_CompressRecords );
+                        nsd->syncUserFlags( ns ); // must keep system.namespaces up-to-date
+
+                        result.appendBool( "compressRecords_new", newCompress );
+                    }
+                }
                 else if ( str::equals( "index", e.fieldName() ) ) {
                     BSONObj indexObj = e.Obj();
                     BSONObj keyPattern = indexObj.getObjectField( "keyPattern" );
@@ -51,6 +51,7 @@
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/write_concern.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/s/d_logic.h"
@@ -296,6 +297,11 @@ namespace mongo {
         return findShardKeyIndexPattern_inlock( ns, shardKeyPattern, indexPattern );
     }
 
+    // How many documents removeRange deletes under each write lock, and the most it deletes per
+    // second (0 for no limit), e.g. to keep chunk cleanup from swamping disks and secondaries.
+    MONGO_EXPORT_SERVER_PARAMETER(removeRangeBatchSize, int, 100);
+    MONGO_EXPORT_SERVER_PARAMETER(removeRangeMaxDocsPerSecond, int, 0);
+
     long long Helpers::removeRange( const KeyRange& range,
                                     bool maxInclusive,
                                     bool secondaryThrottle,
@@ -340,7 +346,12 @@ namespace mongo {
         
         long long millisWaitingForReplication = 0;
 
-        while ( 1 ) {
+        // read once, so that a change made while we run doesn't skew the throttle
+        const int batchSize = std::max( 1, removeRangeBatchSize );
+        const int maxDocsPerSecond = removeRangeMaxDocsPerSecond;
+
+        bool done = false;
+        while ( !done ) {
             // Scoping for write lock.
             {
                 Client::WriteContext ctx(ns);
@@ -350,20 +361,24 @@ namespace mongo {
                 IndexDescriptor* desc =
                     collection->getIndexCatalog()->findIndexByKeyPattern( indexKeyPattern.toBSON() );
 
-                auto_ptr<Runner> runner(InternalPlanner::indexScan(desc, min, max,
-                                                                   maxInclusive,
-                                                                   InternalPlanner::FORWARD,
-                                                                   InternalPlanner::IXSCAN_FETCH));
-
-                runner->setYieldPolicy(Runner::YIELD_AUTO);
-
-                DiskLoc rloc;
-                BSONObj obj;
-                Runner::RunnerState state;
-                // This may yield so we cannot touch nsd after this.
-                state = runner->getNext(&obj, &rloc);
-                runner.reset();
-                if (Runner::RUNNER_EOF == state) { break; }
+                // The batch is read without yielding, so its locations stay valid until it is
+                // deleted under the same lock.
+                vector< pair<DiskLoc, BSONObj> > batch;
+                {
+                    auto_ptr<Runner> runner(
+                            InternalPlanner::indexScan(desc, min, max,
+                                                       maxInclusive,
+                                                       InternalPlanner::FORWARD,
+                                                       InternalPlanner::IXSCAN_FETCH));
+
+                    DiskLoc rloc;
+                    BSONObj obj;
+                    while ( (int)batch.size() < batchSize &&
+                            Runner::RUNNER_ADVANCED == runner->getNext(&obj, &rloc) ) {
+                        batch.push_back( make_pair( rloc, obj.getOwned() ) );
+                    }
+                }
+                if ( batch.empty() ) break;
 
                 if ( onlyRemoveOrphanedDocs ) {
                     // Do a final check in the write lock to make absolutely sure that our
@@ -377,31 +392,47 @@ namespace mongo {
                     // In write lock, so will be the most up-to-date version
                     CollectionMetadataPtr metadataNow = shardingState.getCollectionMetadata( ns );
 
-                    bool docIsOrphan;
-                    if ( metadataNow ) {
-                        KeyPattern kp( metadataNow->getKeyPattern() );
-                        BSONObj key = kp.extractSingleKey( obj );
-                        docIsOrphan = !metadataNow->keyBelongsToMe( key )
-                            && !metadataNow->keyIsPending( key );
-                    }
-                    else {
-                        docIsOrphan = false;
-                    }
-
-                    if ( !docIsOrphan ) {
-                        warning() << "aborting migration cleanup for chunk " << min << " to " << max
-                                  << ( metadataNow ? (string) " at document " + obj.toString() : "" )
-                                  << ", collection " << ns << " has changed " << endl;
-                        break;
+                    for ( size_t i = 0; i < batch.size(); i++ ) {
+                        const BSONObj& obj = batch[i].second;
+
+                        bool docIsOrphan;
+                        if ( metadataNow ) {
+                            KeyPattern kp( metadataNow->getKeyPattern() );
+                            BSONObj key = kp.extractSingleKey( obj );
+                            docIsOrphan = !metadataNow->keyBelongsToMe( key )
+                                && !metadataNow->keyIsPending( key );
+                        }
+                        else {
+                            docIsOrphan = false;
+                        }
+
+                        if ( !docIsOrphan ) {
+                            warning() << "aborting migration cleanup for chunk "
+                                      << min << " to " << max
+                                      << ( metadataNow ?
+                                           (string) " at document " + obj.toString() : "" )
+                                      << ", collection " << ns << " has changed " << endl;
+
+                            // the documents before it are still removed
+                            batch.resize( i );
+                            done = true;
+                            break;
+                        }
                     }
                 }
 
-                if ( callback )
-                    callback->goingToDelete( obj );
+                if ( callback ) {
+                    for ( size_t i = 0; i < batch.size(); i++ )
+                        callback->goingToDelete( batch[i].second );
+                }
 
-                logOp("d", ns.c_str(), obj["_id"].wrap(), 0, 0, fromMigrate);
-                c.database()->getCollection( ns )->deleteDocument( rloc );
-                numDeleted++;
+                // in disk order, rather than key order, to touch each extent once
+                std::sort( batch.begin(), batch.end() );
+                for ( size_t i = 0; i < batch.size(); i++ ) {
+                    logOp("d", ns.c_str(), batch[i].second["_id"].wrap(), 0, 0, fromMigrate);
+                    collection->deleteDocument( batch[i].first );
+                    numDeleted++;
+                }
             }
 
             Timer secondaryThrottleTime;
@@ -414,7 +445,16 @@ namespace mongo {
             }
             
             if ( ! Lock::isLocked() ) {
-                int micros = ( 2 * Client::recommendedYieldMicros() ) - secondaryThrottleTime.micros();
+                long long micros =
+                    ( 2 * Client::recommendedYieldMicros() ) - secondaryThrottleTime.micros();
+
+                // hold the rate of deletion to at most maxDocsPerSecond overall
+                if ( maxDocsPerSecond > 0 ) {
+                    long long behind = numDeleted * 1000000LL / maxDocsPerSecond -
+                                       rangeRemoveTimer.micros();
+                    micros = std::max( micros, behind );
+                }
+
                 if ( micros > 0 ) {
                     LOG(1) << "Helpers::removeRangeUnlocked going to sleep for " << micros << " micros" << endl;
                     sleepmicros( micros );
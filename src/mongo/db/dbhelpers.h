@@ -145,7 +145,9 @@ namespace mongo {
          *
          * Returns -1 when no usable index exists
          *
-         * Does oplog the individual document deletions.
+         * Does oplog the individual document deletions. Documents are removed in batches of
+         * removeRangeBatchSize per write lock, in disk order within a batch, at no more than
+         * removeRangeMaxDocsPerSecond when that is set.
          * // TODO: Refactor this mechanism, it is growing too large
          */
         static long long removeRange( const KeyRange& range,
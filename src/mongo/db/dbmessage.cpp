@@ -19,6 +19,8 @@
 
 #include "mongo/db/dbmessage.h"
 
+#include "mongo/util/buffer_pool.h"
+
 namespace mongo {
 
     string Message::toString() const {
@@ -60,7 +62,7 @@ namespace mongo {
                       int nReturned, int startingFrom,
                       long long cursorId 
                       ) {
-        BufBuilder b(32768);
+        PooledBufBuilder b(sizeof(QueryResult) + size);
         b.skip(sizeof(QueryResult));
         b.appendBuf(data, size);
         QueryResult *qr = (QueryResult *) b.buf();
@@ -91,7 +93,7 @@ namespace mongo {
     }
 
     void replyToQuery( int queryResultFlags, Message& response, const BSONObj& resultObj ) {
-        BufBuilder bufBuilder;
+        PooledBufBuilder bufBuilder( sizeof( QueryResult ) + resultObj.objsize() );
         bufBuilder.skip( sizeof( QueryResult ));
         bufBuilder.appendBuf( reinterpret_cast< void *>(
                 const_cast< char* >( resultObj.objdata() )), resultObj.objsize() );
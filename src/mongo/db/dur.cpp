@@ -64,6 +64,16 @@
      on the next write lock acquisition for dbMutex:    // see MongoMutex::_acquiredWriteLock()
        REMAPPRIVATEVIEW()
 
+   pipelining:
+
+     with journalPipelineDataFileWrites (the default) the commit thread doesn't do
+     WRITETODATAFILES itself in the limited locks version.  it hands the section to the
+     DataFileWriter thread and goes on to the next commit, so commit N's writes to the shared
+     view overlap commit N+1's PREPLOGBUFFER and WRITETOJOURNAL.  there is at most one section
+     in flight: handing over N+1 first waits for N.  anything that needs the shared view to
+     be up to date -- REMAPPRIVATEVIEW, the full groupCommit(), syncDataAndTruncateJournal()
+     -- drains the writer first, in groupCommitMutex.
+
      @see https://docs.google.com/drawings/edit?id=1TklsmZzm7ohIZkwgeK6rMvsdaR13KjtJYMsfLr175Zc
 */
 
@@ -79,8 +89,10 @@
 #include "mongo/db/dur_journal.h"
 #include "mongo/db/dur_recover.h"
 #include "mongo/db/dur_stats.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/server.h"
+#include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/concurrency/race.h"
 #include "mongo/util/mongoutils/hash.h"
 #include "mongo/util/mongoutils/str.h"
@@ -108,6 +120,7 @@ namespace mongo {
         CommitJob& commitJob = *(new CommitJob()); // don't destroy
 
         Stats stats;
+        DbJournalStats dbJournalStats;
 
         void Stats::S::reset() {
             memset(this, 0, sizeof(*this));
@@ -145,6 +158,27 @@ namespace mongo {
             return ss.str();
         }
 
+        void Stats::S::noteCommit(unsigned bytes, unsigned long long micros) {
+            int i = 0;
+            for( unsigned kb = bytes / 4096; kb && i < SizeBuckets - 1; kb >>= 1 )
+                i++;
+            _commitSizeHistogram[i]++;
+
+            i = 0;
+            for( unsigned long long ms = micros / 1000; ms && i < LatencyBuckets - 1; ms >>= 1 )
+                i++;
+            _commitLatencyHistogram[i]++;
+        }
+
+        /** { "<4": n, "<8": n, ..., ">=X": n } with bounds 'first' << i */
+        static BSONObj histogramObj(const unsigned* h, int n, unsigned first) {
+            BSONObjBuilder b;
+            for( int i = 0; i < n - 1; i++ )
+                b.appendNumber( string( str::stream() << '<' << ( first << i ) ), (long long) h[i] );
+            b.appendNumber( string( str::stream() << ">=" << ( first << ( n - 1 ) ) ), (long long) h[n - 1] );
+            return b.obj();
+        }
+
         //int getAgeOutJournalFiles();
         BSONObj Stats::S::_asObj() {
             BSONObjBuilder b;
@@ -155,18 +189,49 @@ namespace mongo {
                        "compression" << _journaledBytes / (_uncompressedBytes+1.0) <<
                        "commitsInWriteLock" << _commitsInWriteLock <<
                        "earlyCommits" << _earlyCommits << 
+                       "pipelinedCommits" << _pipelinedCommits <<
+                       "parallelWriteToDataFiles" << _parallelWriteToDataFiles <<
+                       "coalescedWrites" << _coalescedWrites <<
+                       "coalescedBytesSaved" << _coalescedBytesSaved <<
                        "timeMs" <<
                        BSON( "dt" << _dtMillis <<
                              "prepLogBuffer" << (unsigned) (_prepLogBufferMicros/1000) <<
                              "writeToJournal" << (unsigned) (_writeToJournalMicros/1000) <<
                              "writeToDataFiles" << (unsigned) (_writeToDataFilesMicros/1000) <<
-                             "remapPrivateView" << (unsigned) (_remapPrivateViewMicros/1000)
+                             "remapPrivateView" << (unsigned) (_remapPrivateViewMicros/1000) <<
+                             "pipelineWait" << (unsigned) (_pipelineWaitMicros/1000) <<
+                             "remapPrivateViewMax" << (unsigned) (_remapPrivateViewMaxMicros/1000)
                            );
+            b << "remaps" << _remaps <<
+                 "remappedMB" << _remappedBytes / 1000000.0;
+            b << "idleSkips" << _idleSkips <<
+                 "requestedCommits" << _requestedCommits <<
+                 "commitSizeKB" << histogramObj( _commitSizeHistogram, SizeBuckets, 4 ) <<
+                 "commitLatencyMs" << histogramObj( _commitLatencyHistogram, LatencyBuckets, 1 );
             if (storageGlobalParams.journalCommitInterval != 0)
                 b << "journalCommitIntervalMs" << storageGlobalParams.journalCommitInterval;
             return b.obj();
         }
 
+        void DbJournalStats::note(const map<string, unsigned long long>& bytesByDb) {
+            scoped_lock lk(_m);
+            for( map<string, unsigned long long>::const_iterator i = bytesByDb.begin(); i != bytesByDb.end(); ++i ) {
+                Counts& c = _dbs[i->first];
+                c.bytes += i->second;
+                c.commits++;
+            }
+        }
+
+        BSONObj DbJournalStats::asObj() const {
+            scoped_lock lk(_m);
+            BSONObjBuilder b;
+            for( map<string, Counts>::const_iterator i = _dbs.begin(); i != _dbs.end(); ++i ) {
+                b.append(i->first, BSON( "journaledMB" << i->second.bytes / 1000000.0 <<
+                                         "commits" << i->second.commits ));
+            }
+            return b.obj();
+        }
+
         BSONObj Stats::asObj() {
             return other()->_asObj();
         }
@@ -216,7 +281,11 @@ namespace mongo {
         }
 
         bool DurableImpl::awaitCommit() {
-            commitJob._notify.awaitBeyondNow();
+            // same as _notify.awaitBeyondNow(), but get our place in line before waking the
+            // commit thread so the commit it starts is sure to count for us
+            NotifyAll::When w = commitJob._notify.now();
+            commitJob.requestCommit();
+            commitJob._notify.waitFor(w + 1);
             return true;
         }
 
@@ -515,36 +584,52 @@ namespace mongo {
                 privateMapBytes = 0;
             }
 
-            unsigned ntodo = (unsigned) (sz * fraction);
+            // only the chunks written since they were last remapped need it.  we do the same
+            // fraction of those each pass as we used to do of whole files, so the work is spread
+            // over about 2 seconds of passes however big the mapped set is.
+            unsigned long long dirty = 0;
+            for( set<MongoFile*>::iterator i = files.begin(); i != files.end(); i++ ) {
+                if( (*i)->isDurableMappedFile() )
+                    dirty += ((DurableMappedFile*) *i)->dirtyChunks();
+            }
+            if( dirty == 0 )
+                return;
+
+            unsigned long long ntodo = (unsigned long long) (dirty * fraction);
             if( ntodo < 1 ) ntodo = 1;
-            if( ntodo > sz ) ntodo = sz;
+            if( ntodo > dirty ) ntodo = dirty;
 
             const set<MongoFile*>::iterator b = files.begin();
             const set<MongoFile*>::iterator e = files.end();
             set<MongoFile*>::iterator i = b;
             // skip to our starting position
-            for( unsigned x = 0; x < startAt; x++ ) {
+            for( unsigned x = 0; x < startAt % sz; x++ ) {
                 i++;
-                if( i == e ) i = b;
             }
             unsigned startedAt = startAt;
-            startAt = (startAt + ntodo) % sz; // mark where to start next time
 
             Timer t;
-            for( unsigned x = 0; x < ntodo; x++ ) {
+            unsigned long long done = 0;
+            for( unsigned x = 0; x < sz && done < ntodo; x++ ) {
                 dassert( i != e );
                 if( (*i)->isDurableMappedFile() ) {
                     DurableMappedFile *mmf = (DurableMappedFile*) *i;
                     verify(mmf);
                     if( mmf->willNeedRemap() ) {
-                        mmf->willNeedRemap() = false;
-                        mmf->remapThePrivateView();
+                        done += mmf->remapDirtyChunks( (unsigned) min( ntodo - done,
+                                                                       (unsigned long long) 0xffffffff ) );
                     }
+                }
+                // a file we didn't finish is where we start next time
+                if( done < ntodo ) {
                     i++;
                     if( i == e ) i = b;
+                    startAt++;
                 }
             }
-            LOG(2) << "journal REMAPPRIVATEVIEW done startedAt: " << startedAt << " n:" << ntodo << ' ' << t.millis() << "ms" << endl;
+            startAt %= sz;
+            stats.curr->_remappedBytes += done * DurableMappedFile::RemapChunkSize;
+            LOG(2) << "journal REMAPPRIVATEVIEW done startedAt: " << startedAt << " chunks:" << done << " of " << dirty << ' ' << t.millis() << "ms" << endl;
         }
 
         /** We need to remap the private views periodically. otherwise they would become very large.
@@ -553,17 +638,134 @@ namespace mongo {
         void REMAPPRIVATEVIEW() {
             Timer t;
             _REMAPPRIVATEVIEW();
-            stats.curr->_remapPrivateViewMicros += t.micros();
+            unsigned long long m = t.micros();
+            stats.curr->_remapPrivateViewMicros += m;
+            stats.curr->_remaps++;
+            if( m > stats.curr->_remapPrivateViewMaxMicros )
+                stats.curr->_remapPrivateViewMaxMicros = m;
         }
 
-        // this is a pseudo-local variable in the groupcommit functions 
+        MONGO_EXPORT_SERVER_PARAMETER(journalPipelineDataFileWrites, bool, true);
+
+        // these are pseudo-local variables in the groupcommit functions 
         // below.  however we don't truly do that so that we don't have to 
-        // reallocate, and more importantly regrow it, on every single commit.
+        // reallocate, and more importantly regrow them, on every single commit.
+        // there are two so one can be prepared while the DataFileWriter has the other.
         static AlignedBuilder __theBuilder(4 * 1024 * 1024);
+        static AlignedBuilder __theOtherBuilder(4 * 1024 * 1024);
+
+        /** Applies journaled sections to the data files on its own thread so the commit thread
+            can go on with the next group commit.  See "pipelining" at the top of this file.
+        */
+        class DataFileWriter : boost::noncopyable {
+        public:
+            DataFileWriter() : _m("dataFileWriter"), _free(&__theBuilder), _job(0), _busy(false) {}
+
+            void start() {
+                boost::thread t( boost::bind( &DataFileWriter::run, this ) );
+            }
+
+            /** the builder to prepare the next section in.  call in groupCommitMutex */
+            AlignedBuilder& builder() { return *_free; }
+
+            /** apply 'ab' to the data files in the background, after anything handed over earlier */
+            void hand(const JSectHeader& h, AlignedBuilder& ab) {
+                drain();
+                scoped_lock lk(_m);
+                _h = h;
+                _job = &ab;
+                _free = ( &ab == &__theBuilder ) ? &__theOtherBuilder : &__theBuilder;
+                _posted.notify_all();
+            }
+
+            /** wait until whatever was handed over is in the data files.  call in groupCommitMutex */
+            void drain() {
+                JSectHeader h;
+                AlignedBuilder* ab = 0;
+                {
+                    scoped_lock lk(_m);
+                    if( !_job )
+                        return;
+                    if( !_busy ) {
+                        // not picked up yet: do it here rather than wait, we may be holding
+                        // the files lock exclusively (closeAllFiles)
+                        h = _h;
+                        ab = _job;
+                        _busy = true;
+                    }
+                    else {
+                        Timer t;
+                        while( _job )
+                            _done.wait(lk.boost());
+                        stats.curr->_pipelineWaitMicros += t.micros();
+                        return;
+                    }
+                }
+                apply(h, *ab);
+            }
+
+        private:
+            void run() {
+                Client::initThread("journalDataFileWriter");
+                while( 1 ) {
+                    {
+                        scoped_lock lk(_m);
+                        while( !_job || _busy )
+                            _posted.wait(lk.boost());
+                    }
+
+                    // files can't close under us once we have claimed the section.  taken
+                    // before claiming so drain() never waits on us while we wait on it.
+                    LockMongoFilesShared lkFiles;
+                    JSectHeader h;
+                    AlignedBuilder* ab;
+                    {
+                        scoped_lock lk(_m);
+                        if( !_job || _busy )
+                            continue; // drain() did it
+                        h = _h;
+                        ab = _job;
+                        _busy = true;
+                    }
+                    apply(h, *ab);
+                }
+            }
+
+            void apply(const JSectHeader& h, AlignedBuilder& ab) {
+                try {
+                    unsigned abLen = ab.len();
+                    WRITETODATAFILES(h, ab);
+                    verify( abLen == ab.len() ); // check no one touched the builder meanwhile
+                    ab.reset();
+                }
+                catch(DBException& e ) {
+                    log() << "dbexception in DataFileWriter causing immediate shutdown: " << e.toString() << endl;
+                    mongoAbort("dfw1");
+                }
+                catch(std::exception& e) {
+                    log() << "exception in DataFileWriter causing immediate shutdown: " << e.what() << endl;
+                    mongoAbort("dfw2");
+                }
+
+                scoped_lock lk(_m);
+                _job = 0;
+                _busy = false;
+                _done.notify_all();
+            }
+
+            mongo::mutex _m;
+            boost::condition _posted;
+            boost::condition _done;
+            AlignedBuilder* _free; // the builder the writer doesn't have
+            JSectHeader _h;
+            AlignedBuilder* _job;  // handed over and not yet applied
+            bool _busy;            // someone is applying _job
+        };
+
+        static DataFileWriter& dataFileWriter = *(new DataFileWriter()); // don't destroy
 
         static bool _groupCommitWithLimitedLocks() {
             unspoolWriteIntents(); // in case we were doing some writing ourself (likely impossible with limitedlocks version)
-            AlignedBuilder &ab = __theBuilder;
 
             verify( ! Lock::isLocked() );
 
@@ -574,7 +776,9 @@ namespace mongo {
             scoped_ptr<Lock::GlobalRead> lk1( new Lock::GlobalRead() );
 
             SimpleMutex::scoped_lock lk2(commitJob.groupCommitMutex);
+            AlignedBuilder &ab = dataFileWriter.builder();
 
+            Timer commitTimer;
             commitJob.commitingBegin(); // increments the commit epoch for getlasterror j:true
 
             if( !commitJob.hasWritten() ) {
@@ -607,11 +811,20 @@ namespace mongo {
             // data is now in the journal, which is sufficient for acknowledging getLastError.
             // (ok to crash after that)
             commitJob.committingNotifyCommitted();
+            stats.curr->noteCommit(abLen, commitTimer.micros());
+
+            if( journalPipelineDataFileWrites ) {
+                // overlap applying this section with preparing and journaling the next one
+                dataFileWriter.hand(h, ab);
+                stats.curr->_pipelinedCommits++;
+                return true;
+            }
 
             // note the higher-up-the-chain locking of filesLockedFsync is important here, 
             // as we are not in Lock::GlobalRead anymore. private view readers won't see 
             // anything as we do this, but external viewers of the datafiles will see them 
             // mutating.
+            dataFileWriter.drain(); // in case the parameter was just turned off
             WRITETODATAFILES(h, ab);
             verify( abLen == ab.len() ); // check again wasn't modded
             ab.reset();
@@ -655,13 +868,16 @@ namespace mongo {
             unspoolWriteIntents(); // in case we were doing some writing ourself
 
             {
-                AlignedBuilder &ab = __theBuilder;
-
                 // we need to make sure two group commits aren't running at the same time
                 // (and we are only read locked in the dbMutex, so it could happen -- while 
                 // there is only one dur thread, "early commits" can be done by other threads)
                 SimpleMutex::scoped_lock lk(commitJob.groupCommitMutex);
 
+                // the previous section has to be in the data files before this one, and before
+                // REMAPPRIVATEVIEW below
+                dataFileWriter.drain();
+                AlignedBuilder &ab = dataFileWriter.builder();
+
                 commitJob.commitingBegin();
 
                 if( !commitJob.hasWritten() ) {
@@ -669,6 +885,7 @@ namespace mongo {
                     commitJob.committingNotifyCommitted();
                 }
                 else {
+                    Timer commitTimer;
                     JSectHeader h;
                     PREPLOGBUFFER(h,ab);
 
@@ -680,6 +897,7 @@ namespace mongo {
                     // data is now in the journal, which is sufficient for acknowledging getLastError.
                     // (ok to crash after that)
                     commitJob.committingNotifyCommitted();
+                    stats.curr->noteCommit(ab.len(), commitTimer.micros());
 
                     WRITETODATAFILES(h, ab);
                     debugValidateAllMapsMatch();
@@ -809,6 +1027,10 @@ namespace mongo {
             catch(...) {
             }
 
+            // how long a group commit takes, smoothed.  a lone j:true waiter waits about this
+            // long for company before we commit, so concurrent writers share an fsync
+            unsigned long long commitMicros = 0;
+
             while( !inShutdown() ) {
                 RACECHECK
 
@@ -823,19 +1045,41 @@ namespace mongo {
                 try {
                     stats.rotate();
 
-                    // commit sooner if one or more getLastError j:true is pending
-                    sleepmillis(oneThird);
-                    for( unsigned i = 1; i <= 2; i++ ) {
-                        if( commitJob._notify.nWaiting() )
+                    // commit at least every ms, sooner if a getLastError j:true is waiting or a
+                    // lot has been written
+                    bool requested = false;
+                    Timer sleepTimer;
+                    while( !requested ) {
+                        unsigned slept = sleepTimer.millis();
+                        if( slept >= ms )
                             break;
+                        requested = commitJob.waitForCommitRequest( min(oneThird, ms - slept) );
                         if( commitJob.bytes() > UncommittedBytesLimit / 2  )
                             break;
-                        sleepmillis(oneThird);
                     }
-                                        
+
+                    if( requested ) {
+                        stats.curr->_requestedCommits++;
+                        // commit right away once waiters accumulate; for a lone one, hold the
+                        // door open for about one commit's time (but never longer than the old
+                        // fixed wait of a third of the interval).  a second request ends it.
+                        unsigned wait = (unsigned) min( commitMicros / 1000,
+                                                        (unsigned long long) oneThird );
+                        if( wait && commitJob._notify.nWaiting() < 2 )
+                            commitJob.waitForCommitRequest(wait);
+                    }
+                    else if( !commitJob.hasWritten() ) {
+                        // idle: don't even take the locks.  nobody is waiting, and the next
+                        // write still gets committed within an interval.
+                        stats.curr->_idleSkips++;
+                        continue;
+                    }
+
                     //DEV log() << "privateMapBytes=" << privateMapBytes << endl;
 
+                    Timer commitTimer;
                     durThreadGroupCommit();
+                    commitMicros = ( commitMicros * 7 + commitTimer.micros() ) / 8;
                 }
                 catch(std::exception& e) {
                     log() << "exception in durThread causing immediate shutdown: " << e.what() << endl;
@@ -892,6 +1136,7 @@ namespace mongo {
 
             preallocateFiles();
 
+            dataFileWriter.start();
             boost::thread t(durThread);
         }
 
@@ -903,6 +1148,7 @@ namespace mongo {
             // (dbMutex) locks. This line waits for that to complete if already underway.
             {
                 SimpleMutex::scoped_lock lk(commitJob.groupCommitMutex);
+                dataFileWriter.drain();
             }
 
             commitNow();
@@ -920,7 +1166,10 @@ namespace mongo {
             BSONObj generateSection(const BSONElement& configElement) const {
                 if (!storageGlobalParams.dur)
                     return BSONObj();
-                return dur::stats.asObj();
+                BSONObjBuilder b;
+                b.appendElements(dur::stats.asObj());
+                b.append("dbs", dbJournalStats.asObj());
+                return b.obj();
             }
                 
         } durSSS;
@@ -54,8 +54,14 @@ namespace mongo {
             if( !commitJob._hasWritten )
                 commitJob._hasWritten = true;
 
+            if( !intents.empty() && intents.back().contains(x) ) {
+                // rewriting what we just declared, e.g. a field updated repeatedly in a loop
+                return;
+            }
+
             if( intents.size() == N ) {
-                if ( !condense() ) {
+                // keep spooling locally unless merging gets us less than a quarter of the room back
+                if ( !condense() || intents.size() > N - N / 4 ) {
                     unspool();
                 }
             }
@@ -69,9 +75,7 @@ namespace mongo {
             if ( intents.size() == 0 )
                 return;
 
-            for( unsigned j = 0; j < intents.size(); j++ ) {
-                commitJob.note(intents[j].start(), intents[j].length());
-            }
+            commitJob.note(intents);
 
 #if( CHECK_SPOOLING )
             nSpooled.signedAdd( -1 * static_cast<int>(intents.size()) );
@@ -81,27 +85,35 @@ namespace mongo {
         }
 
         bool ThreadLocalIntents::condense() {
-            std::sort( intents.begin(), intents.end() );
+            if ( intents.size() < 2 )
+                return false;
 
-            bool didAnything = false;
+            std::sort( intents.begin(), intents.end() );
 
-            for ( unsigned x = 0; x < intents.size() - 1 ; x++ ) {
-                if ( intents[x].overlaps( intents[x+1] ) ) {
-                    intents[x].absorb( intents[x+1] );
-                    intents.erase( intents.begin() + x + 1 );
-                    x--;
-                    didAnything = true;
-#if( CHECK_SPOOLING )
-                    nSpooled.signedAdd(-1);
-#endif
+            // merge in place.  sorted by end pointer, so anything overlapping the intent being built
+            // up is next to it
+            unsigned out = 0;
+            for ( unsigned x = 1; x < intents.size(); x++ ) {
+                if ( intents[out].overlaps( intents[x] ) ) {
+                    intents[out].absorb( intents[x] );
+                }
+                else {
+                    intents[++out] = intents[x];
                 }
             }
+            out++;
 
+            bool didAnything = out < intents.size();
+#if( CHECK_SPOOLING )
+            nSpooled.signedAdd( -1 * static_cast<int>(intents.size() - out) );
+#endif
+            intents.resize( out );
             return didAnything;
         }
 
         void ThreadLocalIntents::unspool() {
             if ( intents.size() ) {
+                condense(); // outside the lock
                 SimpleMutex::scoped_lock lk(commitJob.groupCommitMutex);
                 _unspool();
             }
@@ -203,15 +215,38 @@ namespace mongo {
             _nSinceCommitIfNeededCall = 0;
         }
 
+        void CommitJob::requestCommit() {
+            scoped_lock lk(_requestMutex);
+            _commitRequested = true;
+            _requestCV.notify_one();
+        }
+
+        bool CommitJob::waitForCommitRequest(unsigned millis) {
+            scoped_lock lk(_requestMutex);
+            if( !_commitRequested )
+                _requestCV.timed_wait(lk.boost(), boost::posix_time::milliseconds(millis));
+            bool requested = _commitRequested;
+            _commitRequested = false;
+            return requested;
+        }
+
         CommitJob::CommitJob() : 
             groupCommitMutex("groupCommit"),
-            _hasWritten(false)
+            _hasWritten(false),
+            _requestMutex("commitRequest"),
+            _commitRequested(false)
         { 
             _commitNumber = 0;
             _bytes = 0;
             _nSinceCommitIfNeededCall = 0;
         }
 
+        void CommitJob::note(const vector<WriteIntent>& intents) {
+            for( vector<WriteIntent>::const_iterator i = intents.begin(); i != intents.end(); ++i ) {
+                note(i->start(), i->length());
+            }
+        }
+
         void CommitJob::note(void* p, int len) {
             groupCommitMutex.dassertLocked();
 
@@ -67,9 +67,11 @@ namespace mongo {
         };
 
         /** try to remember things we have already marked for journaling.  false negatives are ok if infrequent -
-            we will just log them twice.
+            we will just log them twice.  false positives are not: a write intent would be lost.  so this is an
+            exact cache (Prime sets of Ways entries, most recently set first) rather than something like a bloom
+            filter.
         */
-        template<int Prime>
+        template<int Prime, int Ways>
         class Already : boost::noncopyable {
         public:
             Already() { clear(); }
@@ -80,28 +82,33 @@ namespace mongo {
             */
             bool checkAndSet(void* p, int len) {
                 unsigned x = mongoutils::hashPointer(p);
-                pair<void*, int>& nd = nodes[x % N];
-                if( nd.first == p ) {
-                    if( nd.second < len ) {
-                        nd.second = len;
-                        return false; // haven't indicated this len yet
+                pair<void*, int>* set = nodes[x % N];
+                for( int i = 0; i < Ways; i++ ) {
+                    pair<void*, int>& nd = set[i];
+                    if( nd.first == p ) {
+                        if( nd.second < len ) {
+                            nd.second = len;
+                            return false; // haven't indicated this len yet
+                        }
+                        return true; // already indicated
                     }
-                    return true; // already indicated
                 }
-                nd.first = p;
-                nd.second = len;
-                return false; // a new set
+                // a new set.  the least recently set entry falls off the end
+                memmove(set + 1, set, (Ways - 1) * sizeof(set[0]));
+                set[0].first = p;
+                set[0].second = len;
+                return false;
             }
         private:
-            enum { N = Prime }; // this should be small the idea is that it fits in the cpu cache easily
-            pair<void*,int> nodes[N];
+            enum { N = Prime }; // big enough for a large update, small enough to stay mostly in cache
+            pair<void*,int> nodes[N][Ways];
         };
 
         /** our record of pending/uncommitted write intents */
         class IntentsAndDurOps : boost::noncopyable {
         public:
             vector<WriteIntent> _intents;
-            Already<127> _alreadyNoted;
+            Already<1021, 4> _alreadyNoted;
             vector< shared_ptr<DurOp> > _durOps; // all the ops other than basic writes
 
             /** reset the IntentsAndDurOps structure (empties all the above) */
@@ -116,10 +123,14 @@ namespace mongo {
             #endif
         };
 
-        /** so we don't have to lock the groupCommitMutex too often */
+        /** so we don't have to lock the groupCommitMutex too often.  a thread keeps its intents to
+            itself until it releases its write lock (or its buffer fills up), merges them without any
+            lock, and then hands them over under a single acquisition of the groupCommitMutex.
+        */
         class ThreadLocalIntents {
-            enum { N = 21 };
+            enum { N = 256 };
             std::vector<dur::WriteIntent> intents;
+            /** sort and merge overlapping intents.  @return true if that freed up some room */
             bool condense();
         public:
             ThreadLocalIntents() : intents(N) { intents.clear(); }
@@ -143,6 +154,8 @@ namespace mongo {
 
             /** record/note an intent to write */
             void note(void* p, int len);
+            /** note() a thread's worth of intents */
+            void note(const vector<WriteIntent>& intents);
             // only called by : 
             friend class ThreadLocalIntents;
 
@@ -178,6 +191,15 @@ namespace mongo {
                 _committingReset();
             }
 
+        public:
+            /** wake the commit thread, for a getlasterror j:true waiter.  threadsafe */
+            void requestCommit();
+
+            /** for the commit thread: sleep for up to 'millis', less if requestCommit() is called.
+                @return true if a commit was requested since the last call
+            */
+            bool waitForCommitRequest(unsigned millis);
+
         public:
             /** we check how much written and if it is getting to be a lot, we commit sooner. */
             size_t bytes() const { return _bytes; }
@@ -197,6 +219,9 @@ namespace mongo {
             NotifyAll::When _commitNumber;
             IntentsAndDurOps _intentsAndDurOps;
             size_t _bytes;
+            mongo::mutex _requestMutex;
+            boost::condition _requestCV;
+            bool _commitRequested;
         public:
             NotifyAll _notify;                  // for getlasterror fsync:true acknowledgements
             unsigned _nSinceCommitIfNeededCall; // for asserts and debugging
@@ -41,6 +41,7 @@
 #include "mongo/db/dur_journalformat.h"
 #include "mongo/db/dur_journalimpl.h"
 #include "mongo/db/dur_stats.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/platform/random.h"
 #include "mongo/server.h"
@@ -64,6 +65,10 @@ namespace mongo {
 
 
     namespace dur {
+        // on linux, journal writes of big group commits keep up to this many 1MB writes in flight
+        // at once.  1 for plain synchronous writes
+        MONGO_EXPORT_STARTUP_SERVER_PARAMETER(journalWriteQueueDepth, int, 8);
+
         // Rotate after reaching this data size in a journal (j._<n>) file
         // We use a smaller size for 32 bit as the journal is mmapped during recovery (only)
         // Note if you take a set of datafiles, including journal files, from 32->64 or vice-versa, it must 
@@ -532,6 +537,8 @@ namespace mongo {
             }
 
             _curLogFile = new LogFile(fname.string());
+            if( journalWriteQueueDepth > 1 )
+                _curLogFile->useAsyncIO(journalWriteQueueDepth);
             _nextFileNumber++;
             {
                 JHeader h(fname.string());
@@ -43,6 +43,7 @@
 #include "mongo/db/dur_journal.h"
 #include "mongo/db/dur_journalimpl.h"
 #include "mongo/db/dur_stats.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/server.h"
 #include "mongo/util/alignedbuilder.h"
 #include "mongo/util/mongoutils/hash.h"
@@ -71,8 +72,30 @@ namespace mongo {
             return f;
         }
 
+        /** basic write bytes journaled for each database in one group commit */
+        class DbWriteTally : boost::noncopyable {
+        public:
+            DbWriteTally() : _cur(0) { }
+            void add(const RelativePath& p, unsigned len) {
+                // intents are sorted by address, so the database rarely changes from one to the next
+                if( _cur == 0 || p != _curPath ) {
+                    _curPath = p;
+                    const string& s = p.toString();
+                    size_t slash = s.find_last_of("/\\"); // directoryperdb: "<db>/<db>"
+                    _cur = &_bytes[slash == string::npos ? s : s.substr(slash + 1)];
+                }
+                *_cur += len;
+            }
+            const map<string, unsigned long long>& bytes() const { return _bytes; }
+        private:
+            map<string, unsigned long long> _bytes;
+            RelativePath _curPath;
+            unsigned long long *_cur;
+        };
+
         /** put the basic write operation into the buffer (bb) to be journaled */
-        static void prepBasicWrite_inlock(AlignedBuilder&bb, const WriteIntent *i, RelativePath& lastDbPath) {
+        static void prepBasicWrite_inlock(AlignedBuilder&bb, const WriteIntent *i, RelativePath& lastDbPath,
+                                          DbWriteTally& tally) {
             size_t ofs = 1;
             DurableMappedFile *mmf = findMMF_inlock(i->start(), /*out*/ofs);
 
@@ -108,6 +131,8 @@ namespace mongo {
                 bb.appendStr(lastDbPath.toString());
             }
             bb.appendStruct(e);
+            tally.add(mmf->relativePath(), e.len);
+            mmf->noteDirty(ofs, e.len); // so REMAPPRIVATEVIEW only needs to touch these chunks
 #if defined(_EXPERIMENTAL)
             i->ofsInJournalBuffer = bb.len();
 #endif
@@ -122,12 +147,27 @@ namespace mongo {
                 // mappings, but better to be safe.
 
                 WriteIntent next ((char*)i->start() + e.len, i->length() - e.len);
-                prepBasicWrite_inlock(bb, &next, lastDbPath);
+                prepBasicWrite_inlock(bb, &next, lastDbPath, tally);
             }
         }
 
         void assertNothingSpooled();
 
+        /** @return true if 'next' lies in the same private view as 'last'.  two data files can be
+            mapped back to back, and an entry merged across them would be cut at the first one's
+            end.  'lastMmf' caches the view of 'last', 0 until looked up.
+        */
+        static bool sameView_inlock(const WriteIntent& last, const WriteIntent& next,
+                                    DurableMappedFile*& lastMmf) {
+            size_t ofs;
+            if( lastMmf == 0 )
+                lastMmf = privateViews.find_inlock(last.start(), ofs);
+            return lastMmf != 0 && privateViews.find_inlock(next.start(), ofs) == lastMmf;
+        }
+
+        // neighboring write intents at most this far apart are journaled as one entry
+        MONGO_EXPORT_SERVER_PARAMETER(journalCoalesceGapBytes, int, sizeof(JEntry));
+
         /** basic write ops / write intents.  note there is no particular order to these : if we have
             two writes to the same location during the group commit interval, it is likely
             (although not assured) that it is journaled here once.
@@ -138,25 +178,44 @@ namespace mongo {
             // each time events switch to a different database we journal a JDbContext
             // switches will be rare as we sort by memory location first and we batch commit.
             RelativePath lastDbPath;
+            DbWriteTally tally;
 
             assertNothingSpooled();
             const vector<WriteIntent>& _intents = commitJob.getIntentsSorted();
             verify( !_intents.empty() );
 
+            // a gap this small costs less to journal than the JEntry header of another entry.
+            // never a page or more, so a merged intent can't span unmapped memory.
+            const size_t maxGap = std::max(0, std::min(journalCoalesceGapBytes, 4095));
+
             WriteIntent last;
+            DurableMappedFile *lastMmf = 0; // the view 'last' is in, once looked up
             for( vector<WriteIntent>::const_iterator i = _intents.begin(); i != _intents.end(); i++ ) { 
                 if( i->start() < last.end() ) { 
                     // overlaps
                     last.absorb(*i);
                 }
+                else if( i != _intents.begin() &&
+                         (size_t) ((char*)i->start() - (char*)last.end()) <= maxGap &&
+                         sameView_inlock(last, *i, lastMmf) ) {
+                    // adjacent or nearly so, e.g. the pieces of a btree bucket split.  journal the
+                    // bytes in between (unchanged, but harmless to replay) rather than another entry
+                    long long gap = (char*)i->start() - (char*)last.end();
+                    last = WriteIntent(last.start(), (char*)i->end() - (char*)last.start());
+                    stats.curr->_coalescedWrites++;
+                    stats.curr->_coalescedBytesSaved += (long long) sizeof(JEntry) - gap;
+                }
                 else { 
                     // discontinuous
                     if( i != _intents.begin() )
-                        prepBasicWrite_inlock(bb, &last, lastDbPath);
+                        prepBasicWrite_inlock(bb, &last, lastDbPath, tally);
                     last = *i;
+                    lastMmf = 0;
                 }
             }
-            prepBasicWrite_inlock(bb, &last, lastDbPath);
+            prepBasicWrite_inlock(bb, &last, lastDbPath, tally);
+
+            dbJournalStats.note(tally.bytes());
         }
 
         static void resetLogBuffer(/*out*/JSectHeader& h, AlignedBuilder& bb) {
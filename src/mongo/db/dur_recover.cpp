@@ -48,11 +48,13 @@
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/storage/durable_mapped_file.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/util/bufreader.h"
 #include "mongo/util/checksum.h"
 #include "mongo/util/compress.h"
 #include "mongo/util/concurrency/race.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/startup_test.h"
 
@@ -115,13 +117,21 @@ namespace mongo {
             const bool _doDurOps;
             string _uncompressed;
         public:
-            JournalSectionIterator(const JSectHeader& h, const void *compressed, unsigned compressedLen, bool doDurOpsRecovering) :
+            /** @param decompressed if not null, 'compressed' already uncompressed by a prefetch
+                                       thread.  taken over (swapped out) by the iterator.
+            */
+            JournalSectionIterator(const JSectHeader& h, const void *compressed, unsigned compressedLen, bool doDurOpsRecovering,
+                                   string* decompressed = 0) :
                 _h(h),
                 _lastDbName(0)
                 , _doDurOps(doDurOpsRecovering)
             {
                 verify( doDurOpsRecovering );
-                bool ok = uncompress((const char *)compressed, compressedLen, &_uncompressed);
+                bool ok = true;
+                if( decompressed )
+                    _uncompressed.swap(*decompressed);
+                else
+                    ok = uncompress((const char *)compressed, compressedLen, &_uncompressed);
                 if( !ok ) { 
                     // it should always be ok (i think?) as there is a previous check to see that the JSectFooter is ok
                     log() << "couldn't uncompress journal section" << endl;
@@ -266,7 +276,7 @@ namespace mongo {
             return mmf;
         }
 
-        void RecoveryJob::write(Last& last, const ParsedJournalEntry& entry) {
+        char* RecoveryJob::destination(Last& last, const ParsedJournalEntry& entry) {
             //TODO(mathias): look into making some of these dasserts
             verify(entry.e);
             verify(entry.dbName);
@@ -277,14 +287,83 @@ namespace mongo {
             if ((entry.e->ofs + entry.e->len) <= mmf->length()) {
                 verify(mmf->view_write());
                 verify(entry.e->srcData());
+                return (char*)mmf->view_write() + entry.e->ofs;
+            }
+
+            massert(13622, "Trying to write past end of file in WRITETODATAFILES", _recovering);
+            return 0;
+        }
 
-                void* dest = (char*)mmf->view_write() + entry.e->ofs;
+        void RecoveryJob::write(Last& last, const ParsedJournalEntry& entry) {
+            char* dest = destination(last, entry);
+            if( dest ) {
                 memcpy(dest, entry.e->srcData(), entry.e->len);
                 stats.curr->_writeToDataFilesBytes += entry.e->len;
             }
+        }
+
+        // threads to apply the basic writes of big sections with.  1 for the old serial behavior
+        MONGO_EXPORT_STARTUP_SERVER_PARAMETER(journalWriteToDataFilesThreads, int, 2);
+
+        /** a basic write resolved to where it goes in the shared view */
+        struct DataFileCopy { /*copyable*/
+            char* dest;
+            const char* src;
+            unsigned len;
+            unsigned seq;  // position in the section: overlapping writes go in this order
+
+            bool operator<(const DataFileCopy& r) const {
+                return dest < r.dest || ( dest == r.dest && seq < r.seq );
+            }
+            static bool bySeq(const DataFileCopy& a, const DataFileCopy& b) {
+                return a.seq < b.seq;
+            }
+        };
+
+        namespace {
+            // below this much it isn't worth handing the copies out
+            const unsigned long long MinParallelCopyBytes = 1024 * 1024;
+
+            /** a worker's share: ranges that don't overlap anyone else's */
+            void copyPartition(vector<DataFileCopy>* copies, size_t begin, size_t end) {
+                vector<DataFileCopy>::iterator b = copies->begin() + begin;
+                vector<DataFileCopy>::iterator e = copies->begin() + end;
+                std::sort(b, e, DataFileCopy::bySeq);
+                for( ; b != e; ++b )
+                    memcpy(b->dest, b->src, b->len);
+            }
+        }
+
+        void RecoveryJob::applyCopies(vector<DataFileCopy>& copies, unsigned long long bytes) {
+            int nThreads = journalWriteToDataFilesThreads;
+            if( nThreads <= 1 || bytes < MinParallelCopyBytes || copies.size() < 2 ) {
+                for( vector<DataFileCopy>::const_iterator i = copies.begin(); i != copies.end(); ++i )
+                    memcpy(i->dest, i->src, i->len);
+            }
             else {
-                massert(13622, "Trying to write past end of file in WRITETODATAFILES", _recovering);
+                // partition by address range.  a cut only goes where nothing before it overlaps
+                // what comes after, so each worker can apply its share in section order on its own.
+                std::sort(copies.begin(), copies.end());
+                static ThreadPool* pool = new ThreadPool(nThreads); // we are in _mx
+                unsigned long long share = bytes / nThreads + 1;
+                unsigned long long inPartition = 0;
+                const char* maxEnd = 0;
+                size_t begin = 0;
+                for( size_t i = 0; i < copies.size(); i++ ) {
+                    if( inPartition >= share && copies[i].dest >= maxEnd ) {
+                        pool->schedule(copyPartition, &copies, begin, i);
+                        begin = i;
+                        inPartition = 0;
+                    }
+                    inPartition += copies[i].len;
+                    maxEnd = std::max<const char*>(maxEnd, copies[i].dest + copies[i].len);
+                }
+                pool->schedule(copyPartition, &copies, begin, copies.size());
+                pool->join();
+                stats.curr->_parallelWriteToDataFiles++;
             }
+            stats.curr->_writeToDataFilesBytes += bytes;
+            copies.clear();
         }
 
         void RecoveryJob::applyEntry(Last& last, const ParsedJournalEntry& entry, bool apply, bool dump) {
@@ -357,15 +436,44 @@ namespace mongo {
                 log() << "BEGIN section" << endl;
 
             Last last;
-            for( vector<ParsedJournalEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i ) {
-                applyEntry(last, *i, apply, dump);
+            if( !apply || dump ) {
+                for( vector<ParsedJournalEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i ) {
+                    applyEntry(last, *i, apply, dump);
+                }
+            }
+            else {
+                // collect the basic writes so applyCopies() can spread big batches over threads.
+                // DurOps still go one at a time, in order, after the writes before them.
+                static vector<DataFileCopy> copies;
+                unsigned long long bytes = 0;
+                for( vector<ParsedJournalEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i ) {
+                    if( i->e ) {
+                        char* dest = destination(last, *i);
+                        if( !dest )
+                            continue;
+                        DataFileCopy c;
+                        c.dest = dest;
+                        c.src = i->e->srcData();
+                        c.len = i->e->len;
+                        c.seq = copies.size();
+                        copies.push_back(c);
+                        bytes += c.len;
+                    }
+                    else {
+                        applyCopies(copies, bytes);
+                        bytes = 0;
+                        applyEntry(last, *i, apply, dump);
+                    }
+                }
+                applyCopies(copies, bytes);
             }
 
             if( dump )
                 log() << "END section" << endl;
         }
 
-        void RecoveryJob::processSection(const JSectHeader *h, const void *p, unsigned len, const JSectFooter *f) {
+        void RecoveryJob::processSection(const JSectHeader *h, const void *p, unsigned len, const JSectFooter *f,
+                                         string* decompressed) {
             LockMongoFilesShared lkFiles; // for RecoveryJob::Last
             scoped_lock lk(_mx);
             RACECHECK
@@ -390,7 +498,7 @@ namespace mongo {
 
             auto_ptr<JournalSectionIterator> i;
             if( _recovering ) {
-                i = auto_ptr<JournalSectionIterator>(new JournalSectionIterator(*h, p, len, _recovering));
+                i = auto_ptr<JournalSectionIterator>(new JournalSectionIterator(*h, p, len, _recovering, decompressed));
             }
             else { 
                 i = auto_ptr<JournalSectionIterator>(new JournalSectionIterator(*h, /*after header*/p, /*w/out header*/len));
@@ -428,6 +536,108 @@ namespace mongo {
             applyEntries(entries);
         }
 
+        // threads to decompress upcoming journal sections with during recovery.  1 for the old
+        // serial behavior
+        MONGO_EXPORT_STARTUP_SERVER_PARAMETER(journalRecoveryDecompressThreads, int, 2);
+
+        /** a section of a journal file on its way to processSection() */
+        struct PendingSection {
+            PendingSection() : h(0), data(0), dataLen(0), f(0), decompressed(false) { }
+            const JSectHeader *h;
+            const char *data;     // compressed, points into the mmap'd journal file
+            unsigned dataLen;
+            const JSectFooter *f;
+            string uncompressed;
+            bool decompressed;    // uncompressed is valid
+        };
+
+        namespace {
+            // how far ahead of the apply the prefetch threads may get
+            const size_t MaxPrefetchSections = 16;
+            const unsigned long long MaxPrefetchBytes = 64 * 1024 * 1024;
+
+            /** runs on the prefetch threads.  uses nothing but the read only journal mapping */
+            void decompressSection(PendingSection* s) {
+                // on failure processSection() tries again and reports the error in order
+                s->decompressed = uncompress(s->data, s->dataLen, &s->uncompressed);
+            }
+        }
+
+        /** read the next section header of a journal file, without looking at its contents
+            @return false at the end of the file. *lastFile is set if the file ended abruptly or
+                    a section of some other file (a preallocated or reused file) follows, i.e.
+                    this is the last journal file that was written to.
+        */
+        bool RecoveryJob::nextSection(BufReader& br, unsigned long long fileId, PendingSection* s, bool* lastFile) {
+            try {
+                if( br.atEof() )
+                    return false;
+                JSectHeader h;
+                br.peek(h);
+                if( h.fileId != fileId ) {
+                    if (debug || (storageGlobalParams.durOptions &
+                                  StorageGlobalParams::DurDumpJournal)) {
+                        log() << "Ending processFileBuffer at differing fileId want:" << fileId << " got:" << h.fileId << endl;
+                        log() << "  sect len:" << h.sectionLen() << " seqnum:" << h.seqNumber << endl;
+                    }
+                    *lastFile = true;
+                    return false;
+                }
+                unsigned slen = h.sectionLen();
+                unsigned dataLen = slen - sizeof(JSectHeader) - sizeof(JSectFooter);
+                const char *hdr = (const char *) br.skip(h.sectionLenWithPadding());
+                s->h = (const JSectHeader*) hdr;
+                s->data = hdr + sizeof(JSectHeader);
+                s->dataLen = dataLen;
+                s->f = (const JSectFooter*) (s->data + dataLen);
+                return true;
+            }
+            catch( BufReader::eof& ) {
+                if (storageGlobalParams.durOptions & StorageGlobalParams::DurDumpJournal)
+                    log() << "ABRUPT END" << endl;
+                *lastFile = true; // abrupt end
+                return false;
+            }
+        }
+
+        void RecoveryJob::processSections(vector<PendingSection>& batch) {
+            int nThreads = journalRecoveryDecompressThreads;
+            if( nThreads > 1 && batch.size() > 1 ) {
+                static ThreadPool* pool = new ThreadPool(nThreads); // only go() gets here
+                for( size_t i = 0; i < batch.size(); i++ ) {
+                    // no point decompressing what processSection() is going to skip
+                    if( _lastDataSyncedFromLastRun > batch[i].h->seqNumber + ExtraKeepTimeMs )
+                        continue;
+                    pool->schedule(decompressSection, &batch[i]);
+                }
+                pool->join();
+            }
+
+            for( size_t i = 0; i < batch.size(); i++ ) {
+                PendingSection& s = batch[i];
+                processSection(s.h, s.data, s.dataLen, s.f, s.decompressed ? &s.uncompressed : 0);
+                noteProgress(s.h->sectionLenWithPadding());
+
+                // ctrl c check
+                killCurrentOp.checkForInterrupt(false);
+            }
+        }
+
+        void RecoveryJob::noteProgress(unsigned long long bytes) {
+            _bytesDone += bytes;
+            unsigned long long now = curTimeMillis64();
+            if( now - _lastProgressLogMillis < ProgressLogIntervalMillis || _bytesTotal == 0 )
+                return;
+            _lastProgressLogMillis = now;
+
+            unsigned long long done = std::min(_bytesDone, _bytesTotal);
+            unsigned long long elapsed = now - _startMillis;
+            unsigned long long remainingSecs = done ? elapsed * (_bytesTotal - done) / done / 1000 : 0;
+            log() << "recover progress: " << done * 100 / _bytesTotal << "% of "
+                  << _bytesTotal / (1024 * 1024) << "MB of journal, about "
+                  << remainingSecs << " seconds remaining" << endl;
+        }
+
         /** apply a specific journal file, that is already mmap'd
             @param p start of the memory mapped file
             @return true if this is detected to be the last file (ends abruptly)
@@ -465,36 +675,33 @@ namespace mongo {
                     }
                 }
 
-                // read sections
-                while ( !br.atEof() ) {
-                    JSectHeader h;
-                    br.peek(h);
-                    if( h.fileId != fileId ) {
-                        if (debug || (storageGlobalParams.durOptions &
-                                      StorageGlobalParams::DurDumpJournal)) {
-                            log() << "Ending processFileBuffer at differing fileId want:" << fileId << " got:" << h.fileId << endl;
-                            log() << "  sect len:" << h.sectionLen() << " seqnum:" << h.seqNumber << endl;
-                        }
-                        return true;
+                // read sections.  they are decompressed a batch at a time on the prefetch
+                // threads, then applied one at a time in journal order.
+                vector<PendingSection> batch;
+                unsigned long long batchBytes = 0;
+                bool lastFile = false;
+                bool more = true;
+                while( more ) {
+                    PendingSection s;
+                    more = nextSection(br, fileId, &s, &lastFile);
+                    if( more ) {
+                        batch.push_back(s);
+                        batchBytes += s.dataLen;
+                    }
+                    if( !batch.empty() &&
+                        ( !more || batch.size() >= MaxPrefetchSections || batchBytes >= MaxPrefetchBytes ) ) {
+                        processSections(batch);
+                        batch.clear();
+                        batchBytes = 0;
                     }
-                    unsigned slen = h.sectionLen();
-                    unsigned dataLen = slen - sizeof(JSectHeader) - sizeof(JSectFooter);
-                    const char *hdr = (const char *) br.skip(h.sectionLenWithPadding());
-                    const char *data = hdr + sizeof(JSectHeader);
-                    const char *footer = data + dataLen;
-                    processSection((const JSectHeader*) hdr, data, dataLen, (const JSectFooter*) footer);
-
-                    // ctrl c check
-                    killCurrentOp.checkForInterrupt(false);
                 }
+                return lastFile; // false if non-abrupt end
             }
             catch( BufReader::eof& ) {
                 if (storageGlobalParams.durOptions & StorageGlobalParams::DurDumpJournal)
                     log() << "ABRUPT END" << endl;
                 return true; // abrupt end
             }
-
-            return false; // non-abrupt end
         }
 
         /** apply a specific journal file */
@@ -527,6 +734,18 @@ namespace mongo {
             _lastDataSyncedFromLastRun = journalReadLSN();
             log() << "recover lsn: " << _lastDataSyncedFromLastRun << endl;
 
+            _bytesTotal = 0;
+            for( unsigned i = 0; i != files.size(); ++i ) {
+                try {
+                    _bytesTotal += boost::filesystem::file_size( files[i].string() );
+                }
+                catch(...) {
+                    // processFile() will report it
+                }
+            }
+            _bytesDone = 0;
+            _startMillis = _lastProgressLogMillis = curTimeMillis64();
+
             for( unsigned i = 0; i != files.size(); ++i ) {
                 bool abruptEnd = processFile(files[i]);
                 if( abruptEnd && i+1 < files.size() ) {
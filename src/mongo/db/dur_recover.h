@@ -38,10 +38,13 @@
 #include "mongo/util/file.h"
 
 namespace mongo {
+    class BufReader;
     class DurableMappedFile;
 
     namespace dur {
         struct ParsedJournalEntry;
+        struct DataFileCopy;
+        struct PendingSection;
 
         /** call go() to execute a recovery from existing journal files.
          */
@@ -57,21 +60,34 @@ namespace mongo {
             } last;        
         public:
             RecoveryJob() : _lastDataSyncedFromLastRun(0), 
+                _bytesTotal(0), _bytesDone(0), _startMillis(0), _lastProgressLogMillis(0),
                 _mx("recovery"), _recovering(false) { _lastSeqMentionedInConsoleLog = 1; }
             void go(vector<boost::filesystem::path>& files);
             ~RecoveryJob();
 
-            /** @param data data between header and footer. compressed if recovering. */
-            void processSection(const JSectHeader *h, const void *data, unsigned len, const JSectFooter *f);
+            /** @param data data between header and footer. compressed if recovering.
+                @param decompressed if not null, data already uncompressed.  swapped out.
+            */
+            void processSection(const JSectHeader *h, const void *data, unsigned len, const JSectFooter *f,
+                                string* decompressed = 0);
 
             void close(); // locks and calls _close()
 
             static RecoveryJob & get() { return _instance; }
         private:
             void write(Last& last, const ParsedJournalEntry& entry); // actually writes to the file
+            /** @return where in the shared view a basic write goes, null to skip it */
+            char* destination(Last& last, const ParsedJournalEntry& entry);
+            /** do the copies collected by applyEntries(), in parallel when there are enough */
+            void applyCopies(vector<DataFileCopy>& copies, unsigned long long bytes);
             void applyEntry(Last& last, const ParsedJournalEntry& entry, bool apply, bool dump);
             void applyEntries(const vector<ParsedJournalEntry> &entries);
             bool processFileBuffer(const void *, unsigned len);
+            bool nextSection(BufReader& br, unsigned long long fileId, PendingSection* s, bool* lastFile);
+            /** decompress a batch of sections in parallel, then apply them in order */
+            void processSections(vector<PendingSection>& batch);
+            /** count journal bytes processed, and now and then log how far along we are */
+            void noteProgress(unsigned long long bytes);
             bool processFile(boost::filesystem::path journalfile);
             void _close(); // doesn't lock
             DurableMappedFile* getDurableMappedFile(const ParsedJournalEntry& entry);
@@ -80,6 +96,13 @@ namespace mongo {
 
             unsigned long long _lastDataSyncedFromLastRun;
             unsigned long long _lastSeqMentionedInConsoleLog;
+
+            // for the progress log line
+            static const unsigned long long ProgressLogIntervalMillis = 10000;
+            unsigned long long _bytesTotal;
+            unsigned long long _bytesDone;
+            unsigned long long _startMillis;
+            unsigned long long _lastProgressLogMillis;
         public:
             mongo::mutex _mx; // protects _mmfs
         private:
@@ -55,6 +55,9 @@ namespace mongo {
                 unsigned long long _writeToJournalMicros;
                 unsigned long long _writeToDataFilesMicros;
                 unsigned long long _remapPrivateViewMicros;
+                unsigned long long _remapPrivateViewMaxMicros; // longest single REMAPPRIVATEVIEW
+                unsigned _remaps;                 // REMAPPRIVATEVIEW passes
+                unsigned long long _remappedBytes; // dirty chunks remapped, in bytes
 
                 // undesirable to be in write lock for the group commit (it can be done in a read lock), so good if we
                 // have visibility when this happens.  can happen for a couple reasons
@@ -63,7 +66,31 @@ namespace mongo {
                 // - data being written faster than the normal group commit interval
                 unsigned _commitsInWriteLock;
 
+                // sections whose basic writes were applied by more than one thread
+                unsigned _parallelWriteToDataFiles;
+
+                // commits whose WRITETODATAFILES was left to the DataFileWriter thread, and how
+                // long commits then waited for the previous one to be applied
+                unsigned _pipelinedCommits;
+                unsigned long long _pipelineWaitMicros;
+
+                // write intents merged with a neighbor they didn't overlap, and the journal bytes
+                // that saved (entry headers not written less the gap bytes journaled instead)
+                unsigned _coalescedWrites;
+                long long _coalescedBytesSaved;
+
                 unsigned _dtMillis;
+
+                // histograms, power of two buckets.  bucket i counts commits of less than
+                // 4KB << i (uncompressed) and of less than 1ms << i from commitingBegin() to
+                // the data being in the journal.  the last bucket takes everything bigger.
+                enum { SizeBuckets = 13, LatencyBuckets = 12 };
+                unsigned _commitSizeHistogram[SizeBuckets];
+                unsigned _commitLatencyHistogram[LatencyBuckets];
+                void noteCommit(unsigned bytes, unsigned long long micros);
+
+                unsigned _idleSkips;      // commit intervals with nothing to commit
+                unsigned _requestedCommits; // commits started early for a j:true waiter
             };
             S *curr;
         private:
@@ -73,5 +100,25 @@ namespace mongo {
         };
         extern Stats stats;
 
+        /** basic write bytes journaled for each database since startup, so that the database making
+            the group commits big can be found.  the commit thread notes each commit; reads are from
+            serverStatus.
+        */
+        class DbJournalStats : boost::noncopyable {
+        public:
+            DbJournalStats() : _m("DbJournalStats") { }
+            void note(const map<string, unsigned long long>& bytesByDb);
+            BSONObj asObj() const;
+        private:
+            struct Counts {
+                Counts() : bytes(0), commits(0) { }
+                unsigned long long bytes;
+                unsigned commits; // commits with writes to this database
+            };
+            mutable mongo::mutex _m;
+            map<string, Counts> _dbs;
+        };
+        extern DbJournalStats dbJournalStats;
+
     }
 }
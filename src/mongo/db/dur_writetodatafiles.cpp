@@ -84,8 +84,9 @@ namespace mongo {
             that which is going to be a remapped on its private view - but that might not be all
             views.
 
-            (2) todo should we do this using N threads?  would be quite easy
-                see Hackenberg paper table 5 and 6.  2 threads might be a good balance.
+            (2) big sections are applied using journalWriteToDataFilesThreads threads (default 2,
+                see Hackenberg paper table 5 and 6), partitioned by address range so that
+                overlapping writes stay in order.  see RecoveryJob::applyCopies().
 
             (3) with enough work, we could do this outside the read lock.  it's a bit tricky though.
                 - we couldn't do it from the private views then as they may be changing.  would have to then
@@ -45,6 +45,7 @@ namespace mongo {
     }
 
     PlanStage::StageState TwoD::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         if (isEOF()) { return PlanStage::IS_EOF; }
 
         if (!_initted) {
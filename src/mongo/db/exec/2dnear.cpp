@@ -48,6 +48,7 @@ namespace mongo {
     }
 
     PlanStage::StageState TwoDNear::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
         if (!_initted) {
             _initted = true;
@@ -91,10 +92,12 @@ namespace mongo {
                 member->obj = member->loc.obj();
                 member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
                 if (_params.addDistMeta) {
-                    member->addComputed(new GeoDistanceComputedData(it->_distance));
+                    member->addComputed(
+                        makeComputed<GeoDistanceComputedData>(_workingSet, it->_distance));
                 }
                 if (_params.addPointMeta) {
-                    member->addComputed(new GeoNearPointComputedData(it->_pt));
+                    member->addComputed(
+                        makeComputed<GeoNearPointComputedData>(_workingSet, it->_pt));
                 }
                 _results.push(Result(id, it->_distance));
                 _invalidationMap.insert(pair<DiskLoc, WorkingSetID>(it->_loc, id));
@@ -28,15 +28,75 @@
 
 #include "mongo/db/exec/and_hash.h"
 
+#include <algorithm>
+
 #include "mongo/db/exec/and_common-inl.h"
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/pdfile.h"
+#include "mongo/db/server_parameters.h"
 
 namespace mongo {
 
+    // How many bytes of WorkingSetMembers the first child's results may take up before the
+    // rest are only kept as DiskLocs.
+    MONGO_EXPORT_SERVER_PARAMETER(andHashMaxMemoryBytes, int, 32 * 1024 * 1024);
+
+    namespace {
+
+        // About a 3% false positive rate.
+        const size_t kBloomBitsPerEntry = 8;
+        const size_t kBloomHashes = 3;
+
+        uint64_t hashDiskLoc(const DiskLoc& dl) {
+            uint64_t x = (static_cast<uint64_t>(static_cast<uint32_t>(dl.a())) << 32)
+                         | static_cast<uint32_t>(dl.getOfs());
+            // The 64 bit finalizer of MurmurHash3.
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ULL;
+            x ^= x >> 33;
+            return x;
+        }
+
+        // The i-th bit for 'hash' in a filter of 'mask' + 1 bits, from two halves of the hash.
+        inline uint64_t bloomBit(uint64_t hash, size_t i, uint64_t mask) {
+            uint32_t h1 = static_cast<uint32_t>(hash);
+            uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+            return (h1 + i * h2) & mask;
+        }
+
+        void bloomAdd(vector<uint64_t>* bloom, const DiskLoc& dl) {
+            const uint64_t mask = bloom->size() * 64 - 1;
+            const uint64_t hash = hashDiskLoc(dl);
+            for (size_t i = 0; i < kBloomHashes; ++i) {
+                uint64_t bit = bloomBit(hash, i, mask);
+                (*bloom)[bit >> 6] |= 1ULL << (bit & 63);
+            }
+        }
+
+    }  // namespace
+
     AndHashStage::AndHashStage(WorkingSet* ws, const MatchExpression* filter)
         : _ws(ws), _filter(filter), _resultIterator(_dataMap.end()),
-          _shouldScanChildren(true), _currentChild(0) {}
+          _shouldScanChildren(true), _currentChild(0),
+          _memUsage(0), _maxMemUsage(std::max(andHashMaxMemoryBytes, 0)),
+          _memoryGrant(MemoryBroker::kHash),
+          _spilledSorted(false), _spilledPos(0), _idBeingPagedIn(WorkingSet::INVALID_ID) {
+
+        _specificStats.memLimit = _maxMemUsage;
+    }
+
+    AndHashStage::AndHashStage(WorkingSet* ws, const MatchExpression* filter, size_t maxMemUsage)
+        : _ws(ws), _filter(filter), _resultIterator(_dataMap.end()),
+          _shouldScanChildren(true), _currentChild(0),
+          _memUsage(0), _maxMemUsage(maxMemUsage),
+          _memoryGrant(MemoryBroker::kHash),
+          _spilledSorted(false), _spilledPos(0), _idBeingPagedIn(WorkingSet::INVALID_ID) {
+
+        _specificStats.memLimit = _maxMemUsage;
+    }
 
     AndHashStage::~AndHashStage() {
         for (size_t i = 0; i < _children.size(); ++i) { delete _children[i]; }
@@ -46,10 +106,69 @@ namespace mongo {
 
     bool AndHashStage::isEOF() {
         if (_shouldScanChildren) { return false; }
-        return _dataMap.end() == _resultIterator;
+        return _dataMap.end() == _resultIterator
+            && _spilled.size() == _spilledPos
+            && WorkingSet::INVALID_ID == _idBeingPagedIn;
+    }
+
+    // static
+    size_t AndHashStage::memUsage(const WorkingSetMember* member) {
+        size_t usage = sizeof(DataMap::value_type) + sizeof(WorkingSetMember);
+        if (member->obj.isOwned()) {
+            usage += member->obj.objsize();
+        }
+        for (size_t i = 0; i < member->keyData.size(); ++i) {
+            usage += member->keyData[i].keyData.objsize();
+        }
+        return usage;
+    }
+
+    size_t AndHashStage::findSpilled(const DiskLoc& dl) const {
+        vector<DiskLoc>::const_iterator it;
+        if (_spilledSorted) {
+            it = std::lower_bound(_spilled.begin(), _spilled.end(), dl);
+            if (_spilled.end() != it && *it != dl) {
+                it = _spilled.end();
+            }
+        }
+        else {
+            it = std::find(_spilled.begin(), _spilled.end(), dl);
+        }
+        return it - _spilled.begin();
+    }
+
+    void AndHashStage::rebuildBloom() {
+        const size_t entries = _dataMap.size() + _spilled.size();
+        size_t words = 1;
+        while (words * 64 < entries * kBloomBitsPerEntry) {
+            words *= 2;
+        }
+        _bloom.assign(words, 0);
+
+        for (DataMap::const_iterator it = _dataMap.begin(); it != _dataMap.end(); ++it) {
+            bloomAdd(&_bloom, it->first);
+        }
+        for (size_t i = 0; i < _spilled.size(); ++i) {
+            bloomAdd(&_bloom, _spilled[i]);
+        }
+    }
+
+    bool AndHashStage::bloomMayContain(const DiskLoc& dl) const {
+        if (_bloom.empty()) { return true; }
+
+        const uint64_t mask = _bloom.size() * 64 - 1;
+        const uint64_t hash = hashDiskLoc(dl);
+        for (size_t i = 0; i < kBloomHashes; ++i) {
+            uint64_t bit = bloomBit(hash, i, mask);
+            if (0 == (_bloom[bit >> 6] & (1ULL << (bit & 63)))) {
+                return false;
+            }
+        }
+        return true;
     }
 
     PlanStage::StageState AndHashStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
 
         if (isEOF()) { return PlanStage::IS_EOF; }
@@ -70,6 +189,11 @@ namespace mongo {
         // Returning results.
         verify(!_shouldScanChildren);
 
+        // What went into the hash table goes out first, then what didn't fit.
+        if (_dataMap.end() == _resultIterator) {
+            return returnSpilled(out);
+        }
+
         // Keep the thing we're returning so we can remove it from our internal map later.
         DataMap::iterator returnedIt = _resultIterator;
         ++_resultIterator;
@@ -93,6 +217,46 @@ namespace mongo {
         }
     }
 
+    PlanStage::StageState AndHashStage::returnSpilled(WorkingSetID* out) {
+        WorkingSetID id;
+        WorkingSetMember* member;
+
+        if (WorkingSet::INVALID_ID != _idBeingPagedIn) {
+            // We asked for this one to be paged in last time.
+            id = _idBeingPagedIn;
+            _idBeingPagedIn = WorkingSet::INVALID_ID;
+            member = _ws->get(id);
+        }
+        else {
+            // We don't have the index data of a spilled result, so its document stands in.
+            id = _ws->allocate();
+            member = _ws->get(id);
+            member->loc = _spilled[_spilledPos++];
+            member->state = WorkingSetMember::LOC_AND_IDX;
+
+            if (!Record::likelyInPhysicalMemory(member->loc.rec()->dataNoThrowing())) {
+                _idBeingPagedIn = id;
+                *out = id;
+                ++_commonStats.needFetch;
+                return PlanStage::NEED_FETCH;
+            }
+        }
+
+        member->obj = member->loc.obj();
+        member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+
+        if (Filter::passes(member, _filter)) {
+            *out = id;
+            ++_commonStats.advanced;
+            return PlanStage::ADVANCED;
+        }
+        else {
+            _ws->free(id);
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+    }
+
     PlanStage::StageState AndHashStage::readFirstChild(WorkingSetID* out) {
         verify(_currentChild == 0);
 
@@ -105,7 +269,20 @@ namespace mongo {
             verify(member->hasLoc());
             verify(_dataMap.end() == _dataMap.find(member->loc));
 
-            _dataMap[member->loc] = id;
+            if (_memUsage > _maxMemUsage || _memoryGrant.shouldSpillEarly()) {
+                // Out of room.  Keep the DiskLoc and let the member go.
+                _spilled.push_back(member->loc);
+                ++_specificStats.spilled;
+                _ws->free(id);
+            }
+            else {
+                _dataMap[member->loc] = id;
+                _memUsage += memUsage(member);
+                _memoryGrant.setBytes(_memUsage);
+                _specificStats.memUsage = std::max(_specificStats.memUsage,
+                                                   static_cast<uint64_t>(_memUsage));
+            }
+
             ++_commonStats.needTime;
             return PlanStage::NEED_TIME;
         }
@@ -114,13 +291,18 @@ namespace mongo {
             _currentChild = 1;
 
             // If our first child was empty, don't scan any others, no possible results.
-            if (_dataMap.empty()) {
+            if (_dataMap.empty() && _spilled.empty()) {
                 _shouldScanChildren = false;
                 return PlanStage::IS_EOF;
             }
 
+            std::sort(_spilled.begin(), _spilled.end());
+            _spilledSorted = true;
+            _spilledSeen.assign(_spilled.size(), false);
+            rebuildBloom();
+
             ++_commonStats.needTime;
-            _specificStats.mapAfterChild.push_back(_dataMap.size());
+            _specificStats.mapAfterChild.push_back(_dataMap.size() + _spilled.size());
 
             return PlanStage::NEED_TIME;
         }
@@ -146,14 +328,34 @@ namespace mongo {
         if (PlanStage::ADVANCED == childStatus) {
             WorkingSetMember* member = _ws->get(id);
             verify(member->hasLoc());
-            if (_dataMap.end() == _dataMap.find(member->loc)) {
-                // Ignore.  It's not in any previous child.
+
+            ++_specificStats.probes;
+            DataMap::iterator it;
+            size_t spilledPos;
+
+            if (!bloomMayContain(member->loc)) {
+                // Ignore.  It's certainly not in any previous child.
+                ++_specificStats.bloomRejected;
             }
-            else {
+            else if (_dataMap.end() != (it = _dataMap.find(member->loc))) {
                 // We have a hit.  Copy data into the WSM we already have.
+                ++_specificStats.probeHits;
                 _seenMap.insert(member->loc);
-                WorkingSetMember* olderMember = _ws->get(_dataMap[member->loc]);
+                WorkingSetMember* olderMember = _ws->get(it->second);
+                size_t before = memUsage(olderMember);
                 AndCommon::mergeFrom(olderMember, member);
+                _memUsage += memUsage(olderMember) - before;
+                _memoryGrant.setBytes(_memUsage);
+                _specificStats.memUsage = std::max(_specificStats.memUsage,
+                                                   static_cast<uint64_t>(_memUsage));
+            }
+            else if (_spilled.size() != (spilledPos = findSpilled(member->loc))) {
+                // A hit on something we have no member for.  It only needs marking.
+                ++_specificStats.probeHits;
+                _spilledSeen[spilledPos] = true;
+            }
+            else {
+                // Ignore.  It's not in any previous child.
             }
             _ws->free(id);
             ++_commonStats.needTime;
@@ -169,20 +371,32 @@ namespace mongo {
                 if (_seenMap.end() == _seenMap.find(it->first)) {
                     DataMap::iterator toErase = it;
                     ++it;
+                    _memUsage -= memUsage(_ws->get(toErase->second));
                     _ws->free(toErase->second);
                     _dataMap.erase(toErase);
                 }
                 else { ++it; }
             }
+            _memoryGrant.setBytes(_memUsage);
 
-            _specificStats.mapAfterChild.push_back(_dataMap.size());
+            // And the spilled ones that were seen.
+            size_t kept = 0;
+            for (size_t i = 0; i < _spilled.size(); ++i) {
+                if (_spilledSeen[i]) {
+                    _spilled[kept++] = _spilled[i];
+                }
+            }
+            _spilled.resize(kept);
+            _spilledSeen.assign(kept, false);
+
+            _specificStats.mapAfterChild.push_back(_dataMap.size() + _spilled.size());
 
             _seenMap.clear();
 
-            // _dataMap is now the intersection of the first _currentChild nodes.
+            // _dataMap and _spilled are now the intersection of the first _currentChild nodes.
 
             // If we have nothing to AND with after finishing any child, stop.
-            if (_dataMap.empty()) {
+            if (_dataMap.empty() && _spilled.empty()) {
                 _shouldScanChildren = false;
                 return PlanStage::IS_EOF;
             }
@@ -191,6 +405,11 @@ namespace mongo {
             if (_currentChild == _children.size()) {
                 _shouldScanChildren = false;
                 _resultIterator = _dataMap.begin();
+                _spilledPos = 0;
+            }
+            else {
+                // Fewer candidates, fewer false positives.
+                rebuildBloom();
             }
 
             ++_commonStats.needTime;
@@ -254,6 +473,10 @@ namespace mongo {
                 ++_specificStats.flaggedButPassed;
             }
 
+            // It stops counting against our memory once it leaves _dataMap.
+            _memUsage -= memUsage(member);
+            _memoryGrant.setBytes(_memUsage);
+
             // The loc is about to be invalidated.  Fetch it and clear the loc.
             WorkingSetCommon::fetchAndInvalidateLoc(member);
 
@@ -263,6 +486,41 @@ namespace mongo {
             // And don't return it.
             _dataMap.erase(it);
         }
+
+        // A spilled result we haven't returned yet is flagged the same way, with a member made
+        // for it now.
+        size_t pos = findSpilled(dl);
+        if (pos < _spilled.size() && (_shouldScanChildren || pos >= _spilledPos)) {
+            if (_shouldScanChildren) {
+                ++_specificStats.flaggedInProgress;
+            }
+            else {
+                ++_specificStats.flaggedButPassed;
+            }
+
+            WorkingSetID id = _ws->allocate();
+            WorkingSetMember* member = _ws->get(id);
+            member->loc = dl;
+            member->state = WorkingSetMember::LOC_AND_IDX;
+            WorkingSetCommon::fetchAndInvalidateLoc(member);
+            _ws->flagForReview(id);
+
+            _spilled.erase(_spilled.begin() + pos);
+            if (!_spilledSeen.empty()) {
+                _spilledSeen.erase(_spilledSeen.begin() + pos);
+            }
+        }
+
+        // Likewise the one being paged in.
+        if (WorkingSet::INVALID_ID != _idBeingPagedIn) {
+            WorkingSetMember* member = _ws->get(_idBeingPagedIn);
+            if (member->hasLoc() && member->loc == dl) {
+                ++_specificStats.flaggedButPassed;
+                WorkingSetCommon::fetchAndInvalidateLoc(member);
+                _ws->flagForReview(_idBeingPagedIn);
+                _idBeingPagedIn = WorkingSet::INVALID_ID;
+            }
+        }
     }
 
     PlanStageStats* AndHashStage::getStats() {
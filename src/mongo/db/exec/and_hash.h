@@ -35,6 +35,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/matcher/expression.h"
+#include "mongo/db/sorter/memory_broker.h"
 #include "mongo/platform/unordered_set.h"
 
 namespace mongo {
@@ -49,10 +50,17 @@ namespace mongo {
      * is fetched and added to the WorkingSet as "flagged for further review."  Because this stage
      * operates with DiskLocs, we are unable to evaluate the AND for the invalidated DiskLoc, and it
      * must be fully matched later.
+     *
+     * The hash table holds the WorkingSetMembers of the first child's results.  Once they take up
+     * more than 'maxMemUsage' bytes the rest of the first child's results are kept as bare
+     * DiskLocs in a sorted vector and their members are freed.  Their documents are read back
+     * from the collection when they are returned.  Probes go through a bloom filter over the
+     * DiskLocs still in the running before touching either.
      */
     class AndHashStage : public PlanStage {
     public:
         AndHashStage(WorkingSet* ws, const MatchExpression* filter);
+        AndHashStage(WorkingSet* ws, const MatchExpression* filter, size_t maxMemUsage);
         virtual ~AndHashStage();
 
         void addChild(PlanStage* child);
@@ -70,6 +78,18 @@ namespace mongo {
         StageState readFirstChild(WorkingSetID* out);
         StageState hashOtherChildren(WorkingSetID* out);
 
+        /** Return the next result from _spilled, reading its document from the collection. */
+        StageState returnSpilled(WorkingSetID* out);
+
+        /** @return the position of 'dl' in _spilled, or _spilled.size() if it isn't there */
+        size_t findSpilled(const DiskLoc& dl) const;
+
+        /** Rebuild _bloom over what is left in _dataMap and _spilled. */
+        void rebuildBloom();
+        bool bloomMayContain(const DiskLoc& dl) const;
+
+        static size_t memUsage(const WorkingSetMember* member);
+
         // Not owned by us.
         WorkingSet* _ws;
 
@@ -96,6 +116,25 @@ namespace mongo {
         // Which child are we currently working on?
         size_t _currentChild;
 
+        // How much the members in _dataMap take up, and how much they may.
+        size_t _memUsage;
+        size_t _maxMemUsage;
+        MemoryBroker::Grant _memoryGrant;
+
+        // The results of the first child that didn't fit in _dataMap.  Sorted once the first
+        // child is done, and _spilledSeen[i] is true if the current child has produced
+        // _spilled[i].  _spilledPos is the next one to return.
+        vector<DiskLoc> _spilled;
+        vector<bool> _spilledSeen;
+        bool _spilledSorted;
+        size_t _spilledPos;
+
+        // A spilled result whose record we asked to have paged in, or INVALID_ID.
+        WorkingSetID _idBeingPagedIn;
+
+        // Bits of the bloom filter, a power of two of them.  Empty until the first child is done.
+        vector<uint64_t> _bloom;
+
         // Stats
         CommonStats _commonStats;
         AndHashStats _specificStats;
@@ -46,9 +46,14 @@ namespace mongo {
         : _workingSet(workingSet),
           _filter(filter),
           _params(params),
-          _nsDropped(false) { }
+          _nsDropped(false) {
+        if (NULL != _filter) {
+            _filterProgram.reset(MatchProgram::compile(_filter));
+        }
+    }
 
     PlanStage::StageState CollectionScan::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
         if (_nsDropped) { return PlanStage::DEAD; }
 
@@ -59,9 +64,15 @@ namespace mongo {
                 return PlanStage::DEAD;
             }
 
-            _iter.reset( collection->getIterator( _params.start,
-                                                  _params.tailable,
-                                                  _params.direction ) );
+            if ( !_params.firstExtent.isNull() ) {
+                _iter.reset( collection->getExtentRangeIterator( _params.firstExtent,
+                                                                 _params.endExtent ) );
+            }
+            else {
+                _iter.reset( collection->getIterator( _params.start,
+                                                      _params.tailable,
+                                                      _params.direction ) );
+            }
 
             ++_commonStats.needTime;
             return PlanStage::NEED_TIME;
@@ -95,7 +106,7 @@ namespace mongo {
 
         ++_specificStats.docsTested;
 
-        if (Filter::passes(member, _filter)) {
+        if (Filter::passes(member, _filter, _filterProgram.get())) {
             *out = id;
             ++_commonStats.advanced;
             return PlanStage::ADVANCED;
@@ -107,6 +118,10 @@ namespace mongo {
         }
     }
 
+    PlanStage::StageState CollectionScan::workBatch(size_t maxResults, vector<WorkingSetID>* out) {
+        return workBatchOf(this, maxResults, out);
+    }
+
     bool CollectionScan::isEOF() {
         if ((0 != _params.maxScan) && (_specificStats.docsTested >= _params.maxScan)) {
             return true;
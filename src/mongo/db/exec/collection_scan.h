@@ -32,6 +32,7 @@
 #include "mongo/db/exec/collection_scan_common.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/match_program.h"
 #include "mongo/db/structure/collection_iterator.h"
 
 namespace mongo {
@@ -51,6 +52,8 @@ namespace mongo {
                        const MatchExpression* filter);
 
         virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t maxResults, std::vector<WorkingSetID>* out);
+        virtual bool supportsBatch() { return true; }
         virtual bool isEOF();
 
         virtual void invalidate(const DiskLoc& dl);
@@ -66,6 +69,9 @@ namespace mongo {
         // The filter is not owned by us.
         const MatchExpression* _filter;
 
+        // '_filter' compiled, or NULL if there is no filter.
+        scoped_ptr<MatchProgram> _filterProgram;
+
         scoped_ptr<CollectionIterator> _iter;
 
         CollectionScanParams _params;
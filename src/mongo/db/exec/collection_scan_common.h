@@ -57,6 +57,13 @@ namespace mongo {
 
         // If non-zero, how many documents will we look at?
         size_t maxScan;
+
+        // isNull by default.  If set, the scan (forwards over a non capped collection, from no
+        // particular start) only covers the extents from firstExtent up to but not including
+        // endExtent, or to the end of the collection if endExtent isNull.  These come from
+        // Collection::partitionExtents(...).
+        DiskLoc firstExtent;
+        DiskLoc endExtent;
     };
 
 }  // namespace mongo
@@ -0,0 +1,179 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/exec/count.h"
+
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/index/index_access_method.h"
+#include "mongo/db/index/index_cursor.h"
+#include "mongo/db/index/index_descriptor.h"
+
+namespace mongo {
+
+    Count::Count(const CountParams& params)
+        : _params(params),
+          _iam(params.descriptor->getIndexCatalog()->getBtreeIndex(params.descriptor)),
+          _range(0) {
+
+        _specificStats.indexName = _params.descriptor->indexName();
+        _specificStats.keyPattern = _params.descriptor->keyPattern();
+        _specificStats.isMultiKey = _params.isMultiKey;
+    }
+
+    void Count::seekRange() {
+        const IndexKeyRange& range = _params.ranges[_range];
+
+        // _btreeCursor points at the first key of the range, and _endCursor at the first key
+        // past its end.
+        _btreeCursor->seek(range.startKey, !range.startKeyInclusive);
+        _endCursor->seek(range.endKey, range.endKeyInclusive);
+        _specificStats.keysExamined += 2;
+    }
+
+    bool Count::atRangeEnd() const {
+        if (_btreeCursor->isEOF()) {
+            return true;
+        }
+        if (_endCursor->isEOF()) {
+            return false;
+        }
+        return _btreeCursor->getBucket() == _endCursor->getBucket()
+            && _btreeCursor->getKeyOfs() == _endCursor->getKeyOfs();
+    }
+
+    void Count::checkEnd() {
+        while (atRangeEnd()) {
+            // Keys come in index order, so when the index runs out so do all later ranges.
+            if (_btreeCursor->isEOF() || ++_range == _params.ranges.size()) {
+                _range = _params.ranges.size();
+                return;
+            }
+            seekRange();
+        }
+    }
+
+    PlanStage::StageState Count::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
+        ++_commonStats.works;
+
+        if (NULL == _btreeCursor.get()) {
+            if (_params.ranges.empty()) {
+                return PlanStage::IS_EOF;
+            }
+
+            CursorOptions cursorOptions;
+            cursorOptions.direction = CursorOptions::INCREASING;
+
+            IndexCursor* cursor;
+            verify(_iam->newCursor(&cursor).isOK());
+            _btreeCursor.reset(static_cast<BtreeIndexCursor*>(cursor));
+            _btreeCursor->setOptions(cursorOptions);
+
+            verify(_iam->newCursor(&cursor).isOK());
+            _endCursor.reset(static_cast<BtreeIndexCursor*>(cursor));
+            _endCursor->setOptions(cursorOptions);
+
+            seekRange();
+            checkEnd();
+
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+
+        if (isEOF()) { return PlanStage::IS_EOF; }
+
+        DiskLoc loc = _btreeCursor->getValue();
+        _btreeCursor->next();
+        ++_specificStats.keysExamined;
+        checkEnd();
+
+        if (_params.isMultiKey) {
+            if (!_returned.insert(loc).second) {
+                ++_specificStats.dupsDropped;
+                ++_commonStats.needTime;
+                return PlanStage::NEED_TIME;
+            }
+        }
+
+        *out = WorkingSet::INVALID_ID;
+        ++_commonStats.advanced;
+        return PlanStage::ADVANCED;
+    }
+
+    PlanStage::StageState Count::workBatch(size_t maxResults, vector<WorkingSetID>* out) {
+        return workBatchOf(this, maxResults, out);
+    }
+
+    bool Count::isEOF() {
+        return _params.ranges.empty() || _range == _params.ranges.size();
+    }
+
+    void Count::prepareToYield() {
+        ++_commonStats.yields;
+
+        // If we're not EOF _btreeCursor is at a key to count.  _endCursor is seeked again.
+        if (isEOF() || (NULL == _btreeCursor.get())) { return; }
+        _btreeCursor->savePosition();
+    }
+
+    void Count::recoverFromYield() {
+        ++_commonStats.unyields;
+
+        if (isEOF() || (NULL == _btreeCursor.get())) { return; }
+
+        // _btreeCursor comes back to its key or, if that has gone, to the next one.
+        if (!_btreeCursor->restorePosition().isOK()) {
+            _range = _params.ranges.size();
+            return;
+        }
+
+        // Keys may have come or gone around the end of the range, so find it again.
+        const IndexKeyRange& range = _params.ranges[_range];
+        _endCursor->seek(range.endKey, range.endKeyInclusive);
+        ++_specificStats.keysExamined;
+
+        checkEnd();
+    }
+
+    void Count::invalidate(const DiskLoc& dl) {
+        ++_commonStats.invalidates;
+
+        // The index cursors take care of themselves.  If we see 'dl' again it may not be the
+        // document we counted, so forget it.
+        _returned.erase(dl);
+    }
+
+    PlanStageStats* Count::getStats() {
+        _commonStats.isEOF = isEOF();
+        auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats, STAGE_COUNT));
+        ret->specific.reset(new CountStats(_specificStats));
+        return ret.release();
+    }
+
+}  // namespace mongo
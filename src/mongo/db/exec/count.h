@@ -0,0 +1,110 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/index/btree_index_cursor.h"
+#include "mongo/db/query/index_bounds.h"
+#include "mongo/platform/unordered_set.h"
+
+namespace mongo {
+
+    class IndexAccessMethod;
+    class IndexDescriptor;
+
+    struct CountParams {
+        CountParams() : descriptor(NULL), isMultiKey(false) { }
+
+        IndexDescriptor* descriptor;
+
+        // In index order.  See IndexBounds::toKeyRanges.
+        std::vector<IndexKeyRange> ranges;
+
+        // If a document can have more than one key in the ranges we dedup on DiskLoc.
+        bool isMultiKey;
+    };
+
+    /**
+     * Counts the keys of a btree in some contiguous key ranges, for a count whose predicate the
+     * bounds answer exactly.  No WorkingSetMember is made: every ADVANCED is one more key
+     * counted and *out is WorkingSet::INVALID_ID.
+     *
+     * Rather than comparing each key against the end of its range, a second cursor is put just
+     * past the end and we count until the first cursor gets to the same bucket and offset.
+     *
+     * Preconditions: None.  Is a leaf and consumes no stage data.
+     */
+    class Count : public PlanStage {
+    public:
+        explicit Count(const CountParams& params);
+        virtual ~Count() { }
+
+        virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t maxResults, std::vector<WorkingSetID>* out);
+        virtual bool supportsBatch() { return true; }
+        virtual bool isEOF();
+        virtual void prepareToYield();
+        virtual void recoverFromYield();
+        virtual void invalidate(const DiskLoc& dl);
+
+        virtual PlanStageStats* getStats();
+
+    private:
+        /** Position both cursors for the range _params.ranges[_range]. */
+        void seekRange();
+
+        /** Move on to the next non empty range if _btreeCursor is at the end of this one. */
+        void checkEnd();
+
+        /** Is _btreeCursor where _endCursor is, or off the end of the index? */
+        bool atRangeEnd() const;
+
+        CountParams _params;
+
+        // Owned by Collection -> IndexCatalog.
+        IndexAccessMethod* _iam;
+
+        // What we count with, and where it stops.
+        scoped_ptr<BtreeIndexCursor> _btreeCursor;
+        scoped_ptr<BtreeIndexCursor> _endCursor;
+
+        // Which of _params.ranges we are in.
+        size_t _range;
+
+        unordered_set<DiskLoc, DiskLoc::Hasher> _returned;
+
+        // Stats
+        CommonStats _commonStats;
+        CountStats _specificStats;
+    };
+
+}  // namespace mongo
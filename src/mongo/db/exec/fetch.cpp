@@ -31,6 +31,7 @@
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/storage/record_compression.h"
 #include "mongo/util/fail_point_service.h"
 
 namespace mongo {
@@ -39,8 +40,18 @@ namespace mongo {
     MONGO_FP_DECLARE(fetchInMemoryFail);
     MONGO_FP_DECLARE(fetchInMemorySucceed);
 
-    FetchStage::FetchStage(WorkingSet* ws, PlanStage* child, const MatchExpression* filter)
-        : _ws(ws), _child(child), _filter(filter), _idBeingPagedIn(WorkingSet::INVALID_ID) { }
+    FetchStage::FetchStage(WorkingSet* ws, PlanStage* child, const MatchExpression* filter,
+                           const vector<string>& fields)
+        : _ws(ws),
+          _child(child),
+          _filter(filter),
+          _fields(fields),
+          _idBeingPagedIn(WorkingSet::INVALID_ID),
+          _pendingPos(0) {
+        if (NULL != _filter) {
+            _filterProgram.reset(MatchProgram::compile(_filter));
+        }
+    }
 
     FetchStage::~FetchStage() { }
 
@@ -51,6 +62,10 @@ namespace mongo {
             return false;
         }
 
+        if (_pendingPos < _pending.size()) {
+            return false;
+        }
+
         return _child->isEOF();
     }
 
@@ -67,6 +82,7 @@ namespace mongo {
     }
 
     PlanStage::StageState FetchStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
 
         if (isEOF()) { return PlanStage::IS_EOF; }
@@ -76,42 +92,23 @@ namespace mongo {
             return fetchCompleted(out);
         }
 
+        // Left over results of a batch from our child come before any more from the child.
+        if (_pendingPos < _pending.size()) {
+            WorkingSetID id = _pending[_pendingPos++];
+            if (_pendingPos == _pending.size()) {
+                _pending.clear();
+                _pendingPos = 0;
+            }
+            return fetchOrMatch(id, true, out);
+        }
+
         // If we're here, we're not waiting for a DiskLoc to be fetched.  Get another to-be-fetched
         // result from our child.
         WorkingSetID id;
         StageState status = _child->work(&id);
 
         if (PlanStage::ADVANCED == status) {
-            WorkingSetMember* member = _ws->get(id);
-
-            // If there's an obj there, there is no fetching to perform.
-            if (member->hasObj()) {
-                ++_specificStats.alreadyHasObj;
-                return returnIfMatches(member, id, out);
-            }
-
-            // We need a valid loc to fetch from and this is the only state that has one.
-            verify(WorkingSetMember::LOC_AND_IDX == member->state);
-            verify(member->hasLoc());
-
-            Record* record = member->loc.rec();
-            const char* data = record->dataNoThrowing();
-
-            if (!recordInMemory(data)) {
-                // member->loc points to a record that's NOT in memory.  Pass a fetch request up.
-                verify(WorkingSet::INVALID_ID == _idBeingPagedIn);
-                _idBeingPagedIn = id;
-                *out = id;
-                ++_commonStats.needFetch;
-                return PlanStage::NEED_FETCH;
-            }
-            else {
-                // Don't need index data anymore as we have an obj.
-                member->keyData.clear();
-                member->obj = BSONObj(data);
-                member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
-                return returnIfMatches(member, id, out);
-            }
+            return fetchOrMatch(id, true, out);
         }
         else {
             if (PlanStage::NEED_FETCH == status) {
@@ -125,6 +122,122 @@ namespace mongo {
         }
     }
 
+    PlanStage::StageState FetchStage::workBatch(size_t maxResults, vector<WorkingSetID>* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
+        if (isEOF()) {
+            ++_commonStats.works;
+            return PlanStage::IS_EOF;
+        }
+
+        const size_t before = out->size();
+
+        if (WorkingSet::INVALID_ID != _idBeingPagedIn) {
+            ++_commonStats.works;
+            WorkingSetID id;
+            if (PlanStage::ADVANCED == fetchCompleted(&id)) {
+                out->push_back(id);
+            }
+        }
+
+        // Only go back to our child once everything it gave us has been passed up, and only with
+        // nothing appended yet, as it may have something other than results for us.
+        if (_pendingPos == _pending.size()) {
+            if (out->size() > before) {
+                return PlanStage::ADVANCED;
+            }
+
+            _pending.clear();
+            _pendingPos = 0;
+            StageState status = _child->workBatch(maxResults, &_pending);
+
+            if (PlanStage::ADVANCED != status) {
+                ++_commonStats.works;
+                if (PlanStage::NEED_FETCH == status) {
+                    out->push_back(_pending[0]);
+                    ++_commonStats.needFetch;
+                }
+                else if (PlanStage::NEED_TIME == status) {
+                    ++_commonStats.needTime;
+                }
+                _pending.clear();
+                return status;
+            }
+        }
+
+        while (_pendingPos < _pending.size() && out->size() - before < maxResults) {
+            // A page in has to be requested on its own, so one that comes up after some
+            // results waits for the next call.
+            const bool canRequestPageIn = (out->size() == before);
+
+            WorkingSetID id;
+            StageState status = fetchOrMatch(_pending[_pendingPos], canRequestPageIn, &id);
+            if (PlanStage::NEED_FETCH == status && !canRequestPageIn) {
+                break;
+            }
+
+            ++_pendingPos;
+            ++_commonStats.works;
+
+            if (PlanStage::ADVANCED == status || PlanStage::NEED_FETCH == status) {
+                out->push_back(id);
+            }
+            if (PlanStage::NEED_FETCH == status) {
+                break;
+            }
+        }
+
+        const bool fetchRequested = (WorkingSet::INVALID_ID != _idBeingPagedIn);
+
+        if (_pendingPos == _pending.size()) {
+            _pending.clear();
+            _pendingPos = 0;
+        }
+
+        if (fetchRequested) {
+            return PlanStage::NEED_FETCH;
+        }
+        return out->size() > before ? PlanStage::ADVANCED : PlanStage::NEED_TIME;
+    }
+
+    PlanStage::StageState FetchStage::fetchOrMatch(WorkingSetID memberID,
+                                                   bool canRequestPageIn,
+                                                   WorkingSetID* out) {
+        WorkingSetMember* member = _ws->get(memberID);
+
+        // If there's an obj there, there is no fetching to perform.
+        if (member->hasObj()) {
+            ++_specificStats.alreadyHasObj;
+            return returnIfMatches(member, memberID, out);
+        }
+
+        // We need a valid loc to fetch from and this is the only state that has one.
+        verify(WorkingSetMember::LOC_AND_IDX == member->state);
+        verify(member->hasLoc());
+
+        Record* record = member->loc.rec();
+        const char* data = record->dataNoThrowing();
+
+        if (!recordInMemory(data)) {
+            if (!canRequestPageIn) {
+                return PlanStage::NEED_FETCH;
+            }
+
+            // member->loc points to a record that's NOT in memory.  Pass a fetch request up.
+            verify(WorkingSet::INVALID_ID == _idBeingPagedIn);
+            _idBeingPagedIn = memberID;
+            *out = memberID;
+            ++_commonStats.needFetch;
+            return PlanStage::NEED_FETCH;
+        }
+        else {
+            // Don't need index data anymore as we have an obj.
+            member->keyData.clear();
+            member->obj = RecordCompression::toBSON(data);
+            member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+            return returnIfMatches(member, memberID, out);
+        }
+    }
+
     void FetchStage::prepareToYield() {
         ++_commonStats.yields;
         _child->prepareToYield();
@@ -153,6 +266,15 @@ namespace mongo {
                 _idBeingPagedIn = WorkingSet::INVALID_ID;
             }
         }
+
+        // Results of our child's last batch are ours to protect until we pass them up.
+        for (size_t i = _pendingPos; i < _pending.size(); ++i) {
+            WorkingSetMember* member = _ws->get(_pending[i]);
+            if (member->hasLoc() && member->loc == dl) {
+                WorkingSetCommon::fetchAndInvalidateLoc(member);
+                ++_specificStats.forcedFetches;
+            }
+        }
     }
 
     PlanStage::StageState FetchStage::fetchCompleted(WorkingSetID* out) {
@@ -172,15 +294,14 @@ namespace mongo {
         verify(member->hasLoc());
         verify(!member->hasObj());
 
-        // Make the (unowned) object.
+        // Make the object, unowned unless the record is compressed.
         Record* record = member->loc.rec();
         const char* data = record->dataNoThrowing();
-        member->obj = BSONObj(data);
+        member->obj = RecordCompression::toBSON(data);
 
         // Don't need index data anymore as we have an obj.
         member->keyData.clear();
         member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
-        verify(!member->obj.isOwned());
 
         // Return the obj if it passes our filter.
         WorkingSetID memberID = _idBeingPagedIn;
@@ -191,11 +312,31 @@ namespace mongo {
     PlanStage::StageState FetchStage::returnIfMatches(WorkingSetMember* member,
                                                       WorkingSetID memberID,
                                                       WorkingSetID* out) {
-        if (Filter::passes(member, _filter)) {
+        if (Filter::passes(member, _filter, _filterProgram.get())) {
             if (NULL != _filter) {
                 ++_specificStats.matchTested;
             }
 
+            if (!_fields.empty()) {
+                BSONObjBuilder bob;
+                BSONObjIterator it(member->obj);
+                while (it.more()) {
+                    BSONElement elt = it.next();
+                    for (size_t i = 0; i < _fields.size(); ++i) {
+                        if (_fields[i] == elt.fieldName()) {
+                            bob.append(elt);
+                            break;
+                        }
+                    }
+                }
+
+                // What's left is no longer the record, so the DiskLoc doesn't describe it.
+                member->obj = bob.obj();
+                member->loc = DiskLoc();
+                member->state = WorkingSetMember::OWNED_OBJ;
+                ++_specificStats.projected;
+            }
+
             *out = memberID;
 
             ++_commonStats.advanced;
@@ -28,10 +28,14 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "mongo/db/diskloc.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/match_program.h"
 
 namespace mongo {
 
@@ -41,15 +45,22 @@ namespace mongo {
      * In WorkingSetMember terms, it transitions from LOC_AND_IDX to LOC_AND_UNOWNED_OBJ by reading
      * the record at the provided loc.  Returns verbatim any data that already has an object.
      *
+     * If it is given 'fields', only those top-level fields of each document that passes the
+     * filter are kept, in an OWNED_OBJ.  Stages that buffer results, like a blocking sort under
+     * a projection, then hold a small copy of what's needed rather than the whole record.
+     *
      * Preconditions: Valid DiskLoc.
      */
     class FetchStage : public PlanStage {
     public:
-        FetchStage(WorkingSet* ws, PlanStage* child, const MatchExpression* filter);
+        FetchStage(WorkingSet* ws, PlanStage* child, const MatchExpression* filter,
+                   const std::vector<std::string>& fields = std::vector<std::string>());
         virtual ~FetchStage();
 
         virtual bool isEOF();
         virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t maxResults, std::vector<WorkingSetID>* out);
+        virtual bool supportsBatch() { return _child->supportsBatch(); }
 
         virtual void prepareToYield();
         virtual void recoverFromYield();
@@ -65,6 +76,13 @@ namespace mongo {
         StageState returnIfMatches(WorkingSetMember* member, WorkingSetID memberID,
                                    WorkingSetID* out);
 
+        /**
+         * Turn the child result 'memberID' into an object, or ask for it to be paged in if its
+         * record isn't in memory.  When 'canRequestPageIn' is false, just return NEED_FETCH for
+         * such a record without holding on to it.
+         */
+        StageState fetchOrMatch(WorkingSetID memberID, bool canRequestPageIn, WorkingSetID* out);
+
         /**
          * work(...) delegates to this when we're called after requesting a fetch.
          */
@@ -77,10 +95,21 @@ namespace mongo {
         // The filter is not owned by us.
         const MatchExpression* _filter;
 
+        // '_filter' compiled, or NULL if there is no filter.
+        scoped_ptr<MatchProgram> _filterProgram;
+
+        // If not empty, the only top-level fields of a result that we pass up.
+        std::vector<std::string> _fields;
+
         // If we're fetching a DiskLoc and it points at something that's not in memory, we return a
         // a "please page this in" result and hold on to the WSID until the next call to work(...).
         WorkingSetID _idBeingPagedIn;
 
+        // Results of our child's last workBatch(...) that we haven't looked at yet, from
+        // _pendingPos on.
+        std::vector<WorkingSetID> _pending;
+        size_t _pendingPos;
+
         // Stats
         CommonStats _commonStats;
         FetchStats _specificStats;
@@ -29,6 +29,7 @@
 #pragma once
 
 #include "mongo/db/exec/working_set.h"
+#include "mongo/db/matcher/match_program.h"
 #include "mongo/db/matcher/matchable.h"
 
 namespace mongo {
@@ -110,6 +111,18 @@ namespace mongo {
             WorkingSetMatchableDocument doc(wsm);
             return filter->matches(&doc, NULL);
         }
+
+        /**
+         * Same as above, but a member with an object is matched by 'program', which must be
+         * 'filter' compiled (or NULL if 'filter' is).  Members with only index keys go through
+         * 'filter'.
+         */
+        static bool passes(WorkingSetMember* wsm, const MatchExpression* filter,
+                           const MatchProgram* program) {
+            if (NULL == filter) { return true; }
+            if (wsm->hasObj()) { return program->matchesBSON(wsm->obj); }
+            return passes(wsm, filter);
+        }
     };
 
 }  // namespace mongo
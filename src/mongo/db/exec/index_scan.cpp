@@ -30,9 +30,12 @@
 
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/working_set_computed_data.h"
+#include "mongo/db/index/hash_table_index_cursor.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index/index_cursor.h"
 #include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/index/posting_index_cursor.h"
+#include "mongo/db/index_names.h"
 
 namespace {
 
@@ -51,18 +54,23 @@ namespace mongo {
                          const MatchExpression* filter)
         : _workingSet(workingSet), _descriptor(params.descriptor), _hitEnd(false), _filter(filter), 
           _shouldDedup(params.descriptor->isMultikey()), _yieldMovedCursor(false), _params(params),
-          _btreeCursor(NULL) {
+          _btreeCursor(NULL), _postingCursor(NULL), _hashTableCursor(NULL), _nextHash(0) {
 
-        string amName;
+        string amName = _descriptor->getIndexCatalog()->getAccessMethodName(
+            _descriptor->keyPattern());
 
+        // The btree keys of a posting index are blocks of records that only its own cursor can
+        // read, and that cursor handles complex bounds itself.  A hashtable index has no btree.
+        if (IndexNames::POSTING == amName || IndexNames::HASH_TABLE == amName) {
+            _iam = _descriptor->getIndexCatalog()->getIndex(_descriptor);
+        }
         // If the query is using complex bounds, we must use a Btree access method, since that's the
         // only one that handles complex bounds.
-        if (params.forceBtreeAccessMethod || !_params.bounds.isSimpleRange) {
+        else if (params.forceBtreeAccessMethod || !_params.bounds.isSimpleRange) {
             _iam = _descriptor->getIndexCatalog()->getBtreeIndex(_descriptor);
             amName = "";
         }
         else {
-            amName = _descriptor->getIndexCatalog()->getAccessMethodName(_descriptor->keyPattern());
             _iam = _descriptor->getIndexCatalog()->getIndex(_descriptor);
         }
 
@@ -85,6 +93,7 @@ namespace mongo {
     }
 
     PlanStage::StageState IndexScan::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
 
         if (NULL == _indexCursor.get()) {
@@ -94,6 +103,7 @@ namespace mongo {
             // The limit is *required* for 2d $near, which is the only index that pays attention to
             // it anyway.
             cursorOptions.numWanted = _params.limit;
+            cursorOptions.prefetchRecords = _params.prefetchRecords;
 
             if (1 == _params.direction) {
                 cursorOptions.direction = CursorOptions::INCREASING;
@@ -108,7 +118,45 @@ namespace mongo {
             _indexCursor.reset(cursor);
             _indexCursor->setOptions(cursorOptions);
 
-            if (_params.bounds.isSimpleRange) {
+            if (IndexNames::HASH_TABLE == _descriptor->getIndexCatalog()->getAccessMethodName(
+                    _descriptor->keyPattern())) {
+                _hashTableCursor = static_cast<HashTableIndexCursor*>(_indexCursor.get());
+
+                // Points are looked up one by one, anything else is a walk of every key.
+                const IndexBounds& bounds = _params.bounds;
+                bool walk = true;
+                if (bounds.isSimpleRange) {
+                    if (bounds.endKeyInclusive && bounds.startKey.firstElement().isNumber()
+                        && 0 == bounds.startKey.woCompare(bounds.endKey, BSONObj(), false)) {
+                        _hashes.push_back(bounds.startKey.firstElement().numberLong());
+                        walk = false;
+                    }
+                }
+                else if (1 == bounds.fields.size()) {
+                    const vector<Interval>& intervals = bounds.fields[0].intervals;
+                    walk = false;
+                    for (size_t i = 0; i < intervals.size(); ++i) {
+                        if (!intervals[i].isPoint() || !intervals[i].start.isNumber()) {
+                            _hashes.clear();
+                            walk = true;
+                            break;
+                        }
+                        _hashes.push_back(intervals[i].start.numberLong());
+                    }
+                }
+
+                if (walk) {
+                    _hashTableCursor->seekAll();
+                }
+                else if (_hashes.empty()) {
+                    _hitEnd = true;
+                }
+                else {
+                    _hashTableCursor->seekHash(_hashes[0]);
+                    _nextHash = 1;
+                }
+            }
+            else if (_params.bounds.isSimpleRange) {
                 // Start at one key, end at another.
                 Status status = _indexCursor->seek(_params.bounds.startKey);
                 if (!status.isOK()) {
@@ -126,7 +174,13 @@ namespace mongo {
             }
             else {
                 // "Fast" Btree-specific navigation.
-                _btreeCursor = static_cast<BtreeIndexCursor*>(_indexCursor.get());
+                if (IndexNames::POSTING == _descriptor->getIndexCatalog()->getAccessMethodName(
+                        _descriptor->keyPattern())) {
+                    _postingCursor = static_cast<PostingIndexCursor*>(_indexCursor.get());
+                }
+                else {
+                    _btreeCursor = static_cast<BtreeIndexCursor*>(_indexCursor.get());
+                }
                 _checker.reset(new IndexBoundsChecker(&_params.bounds,
                                                       _descriptor->keyPattern(),
                                                       _params.direction));
@@ -137,7 +191,12 @@ namespace mongo {
                 key.resize(nFields);
                 inc.resize(nFields);
                 if (_checker->getStartKey(&key, &inc)) {
-                    _btreeCursor->seek(key, inc);
+                    if (NULL != _postingCursor) {
+                        _postingCursor->seek(key, inc);
+                    }
+                    else {
+                        _btreeCursor->seek(key, inc);
+                    }
                     _keyElts.resize(nFields);
                     _keyEltsInc.resize(nFields);
                 }
@@ -192,7 +251,8 @@ namespace mongo {
             if (_params.addKeyMetadata) {
                 BSONObjBuilder bob;
                 bob.appendKeys(_descriptor->keyPattern(), ownedKeyObj);
-                member->addComputed(new IndexKeyComputedData(bob.obj()));
+                member->addComputed(
+                    makeComputed<IndexKeyComputedData>(_workingSet, bob.obj()));
             }
             *out = id;
             ++_commonStats.advanced;
@@ -204,6 +264,10 @@ namespace mongo {
         return PlanStage::NEED_TIME;
     }
 
+    PlanStage::StageState IndexScan::workBatch(size_t maxResults, vector<WorkingSetID>* out) {
+        return workBatchOf(this, maxResults, out);
+    }
+
     bool IndexScan::isEOF() {
         if (NULL == _indexCursor.get()) {
             // Have to call work() at least once.
@@ -267,6 +331,11 @@ namespace mongo {
     }
 
     void IndexScan::checkEnd() {
+        if (NULL != _hashTableCursor) {
+            checkHashTableEnd();
+            return;
+        }
+
         if (isEOF()) {
             _commonStats.isEOF = true;
             return;
@@ -274,7 +343,7 @@ namespace mongo {
 
         if (_params.bounds.isSimpleRange) {
             // "Normal" start -> end scanning.
-            verify(NULL == _btreeCursor);
+            verify(NULL == _btreeCursor && NULL == _postingCursor);
             verify(NULL == _checker.get());
 
             // If there is an empty endKey we will scan until we run out of index to scan over.
@@ -295,7 +364,7 @@ namespace mongo {
             }
         }
         else {
-            verify(NULL != _btreeCursor);
+            verify(NULL != _btreeCursor || NULL != _postingCursor);
             verify(NULL != _checker.get());
 
             // Use _checker to see how things are.
@@ -323,11 +392,18 @@ namespace mongo {
 
                 //cout << "skipping...\n";
                 verify(IndexBoundsChecker::MUST_ADVANCE == keyState);
-                _btreeCursor->skip(_indexCursor->getKey(), _keyEltsToUse, _movePastKeyElts,
-                                   _keyElts, _keyEltsInc);
+                ++_specificStats.seeks;
+                if (NULL != _postingCursor) {
+                    _postingCursor->skip(_indexCursor->getKey(), _keyEltsToUse,
+                                         _movePastKeyElts, _keyElts, _keyEltsInc);
+                }
+                else {
+                    _btreeCursor->skip(_indexCursor->getKey(), _keyEltsToUse, _movePastKeyElts,
+                                       _keyElts, _keyEltsInc);
+                }
 
                 // Must check underlying cursor EOF after every cursor movement.
-                if (_btreeCursor->isEOF()) {
+                if (_indexCursor->isEOF()) {
                     _hitEnd = true;
                     break;
                 }
@@ -338,6 +414,41 @@ namespace mongo {
         }
     }
 
+    void IndexScan::checkHashTableEnd() {
+        for (;;) {
+            // The cursor stops at the end of each hash, go on to the next one.
+            while (_indexCursor->isEOF() && _nextHash < _hashes.size()) {
+                _hashTableCursor->seekHash(_hashes[_nextHash++]);
+            }
+
+            if (isEOF()) {
+                _commonStats.isEOF = true;
+                return;
+            }
+
+            ++_specificStats.keysExamined;
+
+            if (!_hashes.empty() || !_params.bounds.isSimpleRange
+                || inSimpleRange(_indexCursor->getKey())) {
+                return;
+            }
+            _indexCursor->next();
+        }
+    }
+
+    bool IndexScan::inSimpleRange(const BSONObj& key) const {
+        const IndexBounds& bounds = _params.bounds;
+        int cmp = sgn(key.woCompare(bounds.startKey, BSONObj(), false));
+        if (cmp == -_params.direction) {
+            return false;
+        }
+        if (bounds.endKey.isEmpty()) {
+            return true;
+        }
+        cmp = sgn(bounds.endKey.woCompare(key, BSONObj(), false));
+        return cmp == _params.direction || (0 == cmp && bounds.endKeyInclusive);
+    }
+
     PlanStageStats* IndexScan::getStats() {
         _commonStats.isEOF = isEOF();
         auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats, STAGE_IXSCAN));
@@ -41,7 +41,9 @@ namespace mongo {
 
     class IndexAccessMethod;
     class IndexCursor;
+    class HashTableIndexCursor;
     class IndexDescriptor;
+    class PostingIndexCursor;
     class WorkingSet;
 
     struct IndexScanParams {
@@ -51,7 +53,8 @@ namespace mongo {
                             forceBtreeAccessMethod(false),
                             doNotDedup(false),
                             maxScan(0),
-                            addKeyMetadata(false) { }
+                            addKeyMetadata(false),
+                            prefetchRecords(false) { }
 
         IndexDescriptor* descriptor;
 
@@ -72,6 +75,9 @@ namespace mongo {
 
         // Do we want to add the key as metadata?
         bool addKeyMetadata;
+
+        // Will the records the keys point at be fetched?  If so the cursor hints them to the OS.
+        bool prefetchRecords;
     };
 
     /**
@@ -88,6 +94,8 @@ namespace mongo {
         virtual ~IndexScan() { }
 
         virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t maxResults, std::vector<WorkingSetID>* out);
+        virtual bool supportsBatch() { return true; }
         virtual bool isEOF();
         virtual void prepareToYield();
         virtual void recoverFromYield();
@@ -99,6 +107,12 @@ namespace mongo {
         /** See if the cursor is pointing at or past _endKey, if _endKey is non-empty. */
         void checkEnd();
 
+        /** checkEnd() for a hashtable index, which has no key order to stop on */
+        void checkHashTableEnd();
+
+        /** for a walk of a whole hashtable index, is 'key' within our simple range */
+        bool inSimpleRange(const BSONObj& key) const;
+
         // The WorkingSet we annotate with results.  Not owned by us.
         WorkingSet* _workingSet;
 
@@ -131,6 +145,13 @@ namespace mongo {
         // For our "fast" Btree-only navigation AKA the index bounds optimization.
         scoped_ptr<IndexBoundsChecker> _checker;
         BtreeIndexCursor* _btreeCursor;
+        // Or for a posting index, which steps through its blocks the same way.
+        PostingIndexCursor* _postingCursor;
+        // Or for a hashtable index, which looks up each hash in _hashes in turn.  If the bounds
+        // aren't all points _hashes is empty and it walks the whole index instead.
+        HashTableIndexCursor* _hashTableCursor;
+        vector<long long> _hashes;
+        size_t _nextHash;
         int _keyEltsToUse;
         bool _movePastKeyElts;
         vector<const BSONElement*> _keyElts;
@@ -55,6 +55,7 @@ namespace mongo {
     }
 
     PlanStage::StageState MergeSortStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
 
         if (isEOF()) { return PlanStage::IS_EOF; }
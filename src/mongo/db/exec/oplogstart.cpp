@@ -28,6 +28,8 @@
 
 #include "mongo/db/exec/oplogstart.h"
 
+#include <algorithm>
+
 #include "mongo/db/pdfile.h"
 #include "mongo/db/storage/extent.h"
 
@@ -35,7 +37,9 @@ namespace mongo {
 
     // Does not take ownership.
     OplogStart::OplogStart(const string& ns, MatchExpression* filter, WorkingSet* ws)
-        : _needInit(true),
+        : _searchLo(0),
+          _searchHi(0),
+          _needInit(true),
           _backwardsScanning(false),
           _extentHopping(false),
           _done(false),
@@ -79,24 +83,37 @@ namespace mongo {
     }
 
     PlanStage::StageState OplogStart::workExtentHopping(WorkingSetID* out) {
-        if (_curloc.isNull()) {
-            _done = true;
-            return PlanStage::IS_EOF;
+        if (_searchLo < _searchHi) {
+            // A secondary that is tailing usually wants the newest extent, so try it first.
+            size_t probe = 0;
+            if (_searchLo > 0) {
+                probe = _searchLo + (_searchHi - _searchLo) / 2;
+            }
+
+            if (_filter->matchesBSON(_extentStarts[probe].obj())) {
+                _searchLo = probe + 1;
+            }
+            else {
+                _searchHi = probe;
+            }
+
+            if (_searchLo < _searchHi) {
+                return PlanStage::NEED_TIME;
+            }
         }
 
-        if (!_filter->matchesBSON(_curloc.obj())) {
-            _done = true;
-            WorkingSetID id = _workingSet->allocate();
-            WorkingSetMember* member = _workingSet->get(id);
-            member->loc = _curloc;
-            member->obj = member->loc.obj();
-            member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
-            *out = id;
-            return PlanStage::ADVANCED;
+        _done = true;
+        if (_searchHi == _extentStarts.size()) {
+            return PlanStage::IS_EOF;
         }
 
-        _curloc = prevExtentFirstLoc(_nsd, _curloc);
-        return PlanStage::NEED_TIME;
+        WorkingSetID id = _workingSet->allocate();
+        WorkingSetMember* member = _workingSet->get(id);
+        member->loc = _extentStarts[_searchHi];
+        member->obj = member->loc.obj();
+        member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+        *out = id;
+        return PlanStage::ADVANCED;
     }
 
     void OplogStart::switchToExtentHopping() {
@@ -107,20 +124,28 @@ namespace mongo {
         // Toss the collection scan we were using.
         _cs.reset();
 
-        // Set up our extent hopping state.  Get the start of the extent that we were collection
-        // scanning.
-        Extent* e = _curloc.rec()->myExtent(_curloc);
-        if (!_nsd->capLooped() || (e->myLoc != _nsd->capExtent())) {
-            _curloc = e->firstRecord;
-        }
-        else {
-            // Direct quote:
-            // Likely we are on the fresh side of capExtent, so return first fresh
-            // record.  If we are on the stale side of capExtent, then the collection is
-            // small and it doesn't matter if we start the extent scan with
-            // capFirstNewRecord.
-            _curloc = _nsd->capFirstNewRecord();
+        // Set up our extent hopping state: the starts of the extent that we were collection
+        // scanning and of every extent before it.  Only extent headers are read here.
+        _extentStarts.clear();
+        for (DiskLoc loc = extentFirstLoc(_curloc); !loc.isNull();
+             loc = prevExtentFirstLoc(_nsd, loc)) {
+            _extentStarts.push_back(loc);
         }
+        _searchLo = 0;
+        _searchHi = _extentStarts.size();
+    }
+
+    DiskLoc OplogStart::extentFirstLoc(const DiskLoc& rec) const {
+        Extent* e = rec.rec()->myExtent(rec);
+        if (!_nsd->capLooped() || (e->myLoc != _nsd->capExtent())) {
+            return e->firstRecord;
+        }
+        // Direct quote:
+        // Likely we are on the fresh side of capExtent, so return first fresh
+        // record.  If we are on the stale side of capExtent, then the collection is
+        // small and it doesn't matter if we start the extent scan with
+        // capFirstNewRecord.
+        return _nsd->capFirstNewRecord();
     }
 
     PlanStage::StageState OplogStart::workBackwardsScan(WorkingSetID* out) {
@@ -159,8 +184,16 @@ namespace mongo {
         }
         else {
             verify(_extentHopping);
-            if (dl == _curloc) {
-                _curloc = DiskLoc();
+            // A capped collection deletes its oldest records first, so if one of the extent
+            // starts is going away the older ones have gone already.
+            vector<DiskLoc>::iterator it = std::find(_extentStarts.begin(),
+                                                     _extentStarts.end(),
+                                                     dl);
+            if (it != _extentStarts.end()) {
+                const size_t gone = it - _extentStarts.begin();
+                _extentStarts.erase(it, _extentStarts.end());
+                _searchLo = std::min(_searchLo, gone);
+                _searchHi = std::min(_searchHi, gone);
             }
         }
     }
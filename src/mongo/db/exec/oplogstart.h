@@ -51,7 +51,9 @@ namespace mongo {
      * normal reverse collection scan.  However, that's not fast enough.  Since we know all
      * documents are oriented on disk in insertion order, we know all documents in one extent were
      * inserted before documents in a subsequent extent.  As such we can skip through entire extents
-     * looking only at the first document.
+     * looking only at the first document.  The first documents of the extents, taken in insertion
+     * order, are sorted too, so rather than hop back one extent at a time we binary search them,
+     * reading O(log n) documents for an oplog of n extents.
      *
      * Why is this a stage?  Because we want to yield, and we want to be notified of DiskLoc
      * invalidations.  :(
@@ -80,6 +82,9 @@ namespace mongo {
         // Copied verbatim.
         static DiskLoc prevExtentFirstLoc(NamespaceDetails* nsd, const DiskLoc& rec);
 
+        // The first record of the extent holding 'rec', or of the fresh part of the cap extent.
+        DiskLoc extentFirstLoc(const DiskLoc& rec) const;
+
         StageState workBackwardsScan(WorkingSetID* out);
 
         void switchToExtentHopping();
@@ -89,10 +94,16 @@ namespace mongo {
         // If we're backwards scanning we just punt to a collscan.
         scoped_ptr<CollectionScan> _cs;
 
-        // What's our current DiskLoc?  Set by both collscan and extent hopping.
-        // Only written by collscan, read and written by extent hopping.
+        // What's our current DiskLoc?  Written by collscan, read when we start extent hopping.
         DiskLoc _curloc;
 
+        // Extent hopping searches the first records of the extents up to and including
+        // _curloc's, newest first.  Those before _searchLo match the filter, those from
+        // _searchHi on don't; the answer is the first that doesn't, or EOF if they all do.
+        vector<DiskLoc> _extentStarts;
+        size_t _searchLo;
+        size_t _searchHi;
+
         // Have we done our heavy init yet?
         bool _needInit;
 
@@ -45,6 +45,7 @@ namespace mongo {
     bool OrStage::isEOF() { return _currentChild >= _children.size(); }
 
     PlanStage::StageState OrStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
 
         if (isEOF()) { return PlanStage::IS_EOF; }
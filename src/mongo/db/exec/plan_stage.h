@@ -28,7 +28,10 @@
 
 #pragma once
 
+#include <vector>
+
 #include "mongo/db/exec/plan_stats.h"
+#include "mongo/db/exec/scoped_stage_timer.h"
 #include "mongo/db/exec/working_set.h"
 
 namespace mongo {
@@ -167,6 +170,40 @@ namespace mongo {
          */
         virtual StageState work(WorkingSetID* out) = 0;
 
+        //
+        // Batch execution:
+        //
+        // workBatch(...) hands up many results per call so that a deep plan pays its per-stage
+        // virtual call once per batch rather than once per document.  Every stage has a
+        // workBatch(...), but only stages that return true from supportsBatch() do better than
+        // a single unit of work per call.  The plan executor only runs a tree in batches if its
+        // root supports them, which a stage with children only claims if all of them do.
+        //
+
+        /**
+         * Perform up to 'maxResults' units of work, appending each result to *out.
+         *
+         * Returns ADVANCED if and only if at least one result was appended.  Any other state is
+         * only returned with nothing appended and means what it means for work(...); in the case
+         * of NEED_FETCH the WSID to page in is appended as the only entry of *out and is not a
+         * result.  A stage that runs into another state after appending results returns
+         * ADVANCED and must return that state on its next call instead.
+         */
+        virtual StageState workBatch(size_t maxResults, std::vector<WorkingSetID>* out) {
+            WorkingSetID id;
+            StageState state = work(&id);
+            if (ADVANCED == state || NEED_FETCH == state) {
+                out->push_back(id);
+            }
+            return state;
+        }
+
+        /**
+         * Returns true if this stage and all of its children do better than one unit of work per
+         * call to workBatch(...).
+         */
+        virtual bool supportsBatch() { return false; }
+
         /**
          * Returns true if no more work can be done on the query / out of results.
          */
@@ -218,4 +255,31 @@ namespace mongo {
         virtual PlanStageStats* getStats() = 0;
     };
 
+    /**
+     * workBatch(...) for a stage that never asks for a fetch: calls Stage::work(...) directly,
+     * without virtual dispatch, until it has done 'maxResults' units of work or runs into
+     * anything other than ADVANCED or NEED_TIME.  Such a state is dropped if results were
+     * appended, so it must be one the stage returns again on its next call (IS_EOF or DEAD).
+     */
+    template <typename Stage>
+    inline PlanStage::StageState workBatchOf(Stage* stage,
+                                             size_t maxResults,
+                                             std::vector<WorkingSetID>* out) {
+        const size_t before = out->size();
+        PlanStage::StageState state = PlanStage::NEED_TIME;
+
+        for (size_t i = 0; i < maxResults; ++i) {
+            WorkingSetID id;
+            state = stage->Stage::work(&id);
+            if (PlanStage::ADVANCED == state) {
+                out->push_back(id);
+            }
+            else if (PlanStage::NEED_TIME != state) {
+                break;
+            }
+        }
+
+        return out->size() > before ? PlanStage::ADVANCED : state;
+    }
+
 }  // namespace mongo
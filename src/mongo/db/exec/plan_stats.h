@@ -51,6 +51,7 @@ namespace mongo {
                         advanced(0),
                         needTime(0),
                         needFetch(0),
+                        executionCycles(0),
                         isEOF(false) { }
 
         // Count calls into the stage.
@@ -67,8 +68,9 @@ namespace mongo {
         // TODO: have some way of tracking WSM sizes (or really any series of #s).  We can measure
         // the size of our inputs and the size of our outputs.  We can do a lot with the WS here.
 
-        // TODO: once we've picked a plan, collect different (or additional) stats for display to
-        // the user, eg. time_t totalTimeSpent;
+        // Cycles spent in work(...), including the children's, if planStageTiming is on.
+        // See scoped_stage_timer.h.
+        uint64_t executionCycles;
 
         // TODO: keep track of total yield time / fetch time for a plan (done by runner)
 
@@ -117,7 +119,13 @@ namespace mongo {
 
     struct AndHashStats : public SpecificStats {
         AndHashStats() : flaggedButPassed(0),
-                         flaggedInProgress(0) { }
+                         flaggedInProgress(0),
+                         probes(0),
+                         bloomRejected(0),
+                         probeHits(0),
+                         spilled(0),
+                         memUsage(0),
+                         memLimit(0) { }
 
         virtual ~AndHashStats() { }
 
@@ -135,6 +143,20 @@ namespace mongo {
 
         // mapAfterChild[mapAfterChild.size() - 1] WSMswere match tested.
         // commonstats.advanced is how many passed.
+
+        // How many results of children after the first did we look up?  Of those, how many
+        // did the bloom filter turn away, and how many were in the intersection so far?  The
+        // hit ratio is probeHits / probes.
+        uint64_t probes;
+        uint64_t bloomRejected;
+        uint64_t probeHits;
+
+        // How many results of the first child were kept as bare DiskLocs rather than members?
+        uint64_t spilled;
+
+        // Bytes taken up by the members we hold, at most, and how many we allowed.
+        uint64_t memUsage;
+        uint64_t memLimit;
     };
 
     struct AndSortedStats : public SpecificStats {
@@ -153,10 +175,31 @@ namespace mongo {
         uint64_t matchTested;
     };
 
+    struct CountStats : public SpecificStats {
+        CountStats() : isMultiKey(false),
+                       keysExamined(0),
+                       dupsDropped(0) { }
+
+        virtual ~CountStats() { }
+
+        std::string indexName;
+
+        BSONObj keyPattern;
+
+        bool isMultiKey;
+
+        // Keys counted, plus one for each seek of a cursor.
+        uint64_t keysExamined;
+
+        // Keys not counted because their document already was.
+        uint64_t dupsDropped;
+    };
+
     struct FetchStats : public SpecificStats {
         FetchStats() : alreadyHasObj(0),
                        forcedFetches(0),
-                       matchTested(0) { }
+                       matchTested(0),
+                       projected(0) { }
 
         virtual ~FetchStats() { }
 
@@ -172,6 +215,9 @@ namespace mongo {
 
         // We know how many passed (it's the # of advanced) and therefore how many failed.
         uint64_t matchTested;
+
+        // How many results were cut down to the fields asked for?
+        uint64_t projected;
     };
 
     struct IndexScanStats : public SpecificStats {
@@ -181,7 +227,8 @@ namespace mongo {
                            dupsDropped(0),
                            seenInvalidated(0),
                            matchTested(0),
-                           keysExamined(0) { }
+                           keysExamined(0),
+                           seeks(0) { }
 
         virtual ~IndexScanStats() { }
 
@@ -217,6 +264,9 @@ namespace mongo {
         // Number of entries retrieved from the index during the scan.
         uint64_t keysExamined;
 
+        // Number of times the bounds sent the cursor forward to a key other than the next one.
+        uint64_t seeks;
+
     };
 
     struct OrStats : public SpecificStats {
@@ -236,13 +286,41 @@ namespace mongo {
         std::vector<uint64_t> matchTested;
     };
 
+    struct PrefetchStats : public SpecificStats {
+        PrefetchStats() : prefetched(0),
+                          inMemory(0),
+                          notReady(0),
+                          forcedFetches(0) { }
+
+        virtual ~PrefetchStats() { }
+
+        // How many records did we ask to be read in?
+        uint64_t prefetched;
+
+        // How many were in memory already?
+        uint64_t inMemory;
+
+        // How many results did we have to pass up before their record was in?
+        uint64_t notReady;
+
+        // How many records were we forced to fetch as the result of an invalidation?
+        uint64_t forcedFetches;
+    };
+
     struct SortStats : public SpecificStats {
-        SortStats() : forcedFetches(0) { }
+        SortStats() : forcedFetches(0), memUsage(0), spilled(0), spillFiles(0) { }
 
         virtual ~SortStats() { }
 
         // How many records were we forced to fetch as the result of an invalidation?
         uint64_t forcedFetches;
+
+        // The most bytes of results held in memory at once.
+        uint64_t memUsage;
+
+        // How many results went to the external sorter, and how many files did it write?
+        uint64_t spilled;
+        int spillFiles;
     };
 
     struct MergeSortStats : public SpecificStats {
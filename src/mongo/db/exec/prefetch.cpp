@@ -0,0 +1,161 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/exec/prefetch.h"
+
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/pdfile.h"
+#include "mongo/db/storage/extent_manager.h"
+#include "mongo/db/structure/collection.h"
+#include "mongo/util/fail_point_service.h"
+
+namespace mongo {
+
+    // Treat every record as not in memory, for testing.
+    MONGO_FP_DECLARE(prefetchRecordNotInMemory);
+
+    // Most documents fit in a page.  A bigger one is read in the rest of the way by the fetch.
+    static const int kRecordPrefetchBytes = 4096;
+
+    PrefetchStage::PrefetchStage(WorkingSet* ws, PlanStage* child, const Collection* collection,
+                                 size_t lookahead)
+        : _ws(ws),
+          _child(child),
+          _collection(collection),
+          _lookahead(lookahead) { }
+
+    PrefetchStage::~PrefetchStage() { }
+
+    bool PrefetchStage::isEOF() {
+        return _queue.empty() && _child->isEOF();
+    }
+
+    PlanStage::StageState PrefetchStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
+        ++_commonStats.works;
+
+        if (isEOF()) { return PlanStage::IS_EOF; }
+
+        if (_queue.size() < _lookahead && !_child->isEOF()) {
+            WorkingSetID id;
+            StageState status = _child->work(&id);
+
+            if (PlanStage::ADVANCED == status) {
+                prefetch(id);
+                _queue.push_back(id);
+            }
+            else if (PlanStage::NEED_FETCH == status) {
+                *out = id;
+                ++_commonStats.needFetch;
+                return status;
+            }
+            else if (PlanStage::FAILURE == status) {
+                return status;
+            }
+        }
+
+        // Hold on to the oldest result while we can still read further ahead and its record
+        // isn't in yet.
+        if (_queue.empty()
+            || (!frontIsReady() && _queue.size() < _lookahead && !_child->isEOF())) {
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+
+        if (!frontIsReady()) {
+            ++_specificStats.notReady;
+        }
+
+        *out = _queue.front();
+        _queue.pop_front();
+        ++_commonStats.advanced;
+        return PlanStage::ADVANCED;
+    }
+
+    void PrefetchStage::prefetch(WorkingSetID id) {
+        WorkingSetMember* member = _ws->get(id);
+        if (member->hasObj() || !member->hasLoc()) {
+            return;
+        }
+
+        if (!MONGO_FAIL_POINT(prefetchRecordNotInMemory)
+            && Record::likelyInPhysicalMemory(member->loc.rec()->dataNoThrowing())) {
+            ++_specificStats.inMemory;
+            return;
+        }
+
+        _collection->getExtentManager()->willNeed(member->loc, kRecordPrefetchBytes);
+        ++_specificStats.prefetched;
+    }
+
+    bool PrefetchStage::frontIsReady() {
+        WorkingSetMember* member = _ws->get(_queue.front());
+        if (member->hasObj() || !member->hasLoc()) {
+            return true;
+        }
+        if (MONGO_FAIL_POINT(prefetchRecordNotInMemory)) {
+            return false;
+        }
+        return Record::likelyInPhysicalMemory(member->loc.rec()->dataNoThrowing());
+    }
+
+    void PrefetchStage::prepareToYield() {
+        ++_commonStats.yields;
+        _child->prepareToYield();
+    }
+
+    void PrefetchStage::recoverFromYield() {
+        ++_commonStats.unyields;
+        _child->recoverFromYield();
+    }
+
+    void PrefetchStage::invalidate(const DiskLoc& dl) {
+        ++_commonStats.invalidates;
+        _child->invalidate(dl);
+
+        // What we're holding is ours to protect until we pass it up.
+        for (size_t i = 0; i < _queue.size(); ++i) {
+            WorkingSetMember* member = _ws->get(_queue[i]);
+            if (member->hasLoc() && member->loc == dl) {
+                WorkingSetCommon::fetchAndInvalidateLoc(member);
+                ++_specificStats.forcedFetches;
+            }
+        }
+    }
+
+    PlanStageStats* PrefetchStage::getStats() {
+        _commonStats.isEOF = isEOF();
+
+        auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats, STAGE_PREFETCH));
+        ret->specific.reset(new PrefetchStats(_specificStats));
+        ret->children.push_back(_child->getStats());
+        return ret.release();
+    }
+
+}  // namespace mongo
@@ -0,0 +1,93 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/db/exec/plan_stage.h"
+
+namespace mongo {
+
+    class Collection;
+
+    /**
+     * Sits under a FetchStage and reads ahead of it.  Up to 'lookahead' results of the child are
+     * held back; for each one whose record isn't in memory the OS is told it will be needed
+     * soon, so that the pages for several records are on their way in at once instead of the
+     * fetch faulting on them one at a time.  Results are passed up in the order the child gave
+     * them, as soon as the oldest one's record is in memory or we can't hold on to any more.
+     *
+     * Results are passed up unchanged.  Nothing is read from the records here, we only ask for
+     * them, so this never blocks on the disk.
+     */
+    class PrefetchStage : public PlanStage {
+    public:
+        PrefetchStage(WorkingSet* ws, PlanStage* child, const Collection* collection,
+                      size_t lookahead);
+        virtual ~PrefetchStage();
+
+        virtual bool isEOF();
+        virtual StageState work(WorkingSetID* out);
+
+        virtual void prepareToYield();
+        virtual void recoverFromYield();
+        virtual void invalidate(const DiskLoc& dl);
+
+        PlanStageStats* getStats();
+
+    private:
+        /**
+         * Ask for the record of the member 'id' if it has to be read in.
+         */
+        void prefetch(WorkingSetID id);
+
+        /**
+         * Is the oldest result we're holding ready to be fetched?
+         */
+        bool frontIsReady();
+
+        // _ws is not owned by us.
+        WorkingSet* _ws;
+        scoped_ptr<PlanStage> _child;
+
+        // Not owned by us.
+        const Collection* _collection;
+
+        size_t _lookahead;
+
+        // What we've read from the child and not yet passed up, oldest first.
+        std::deque<WorkingSetID> _queue;
+
+        // Stats
+        CommonStats _commonStats;
+        PrefetchStats _specificStats;
+    };
+
+}  // namespace mongo
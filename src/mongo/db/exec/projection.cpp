@@ -49,6 +49,7 @@ namespace mongo {
     bool ProjectionStage::isEOF() { return _child->isEOF(); }
 
     PlanStage::StageState ProjectionStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
 
         if (isEOF()) { return PlanStage::IS_EOF; }
@@ -76,6 +77,40 @@ namespace mongo {
         return status;
     }
 
+    PlanStage::StageState ProjectionStage::workBatch(size_t maxResults,
+                                                     vector<WorkingSetID>* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
+        if (isEOF()) {
+            ++_commonStats.works;
+            return PlanStage::IS_EOF;
+        }
+
+        const size_t before = out->size();
+        StageState status = _child->workBatch(maxResults, out);
+
+        if (PlanStage::ADVANCED == status) {
+            for (size_t i = before; i < out->size(); ++i) {
+                ++_commonStats.works;
+                Status projStatus = _exec->transform(_ws->get((*out)[i]));
+                if (!projStatus.isOK()) {
+                    warning() << "Couldn't execute projection, status = "
+                              << projStatus.toString() << endl;
+                    out->resize(before);
+                    return PlanStage::FAILURE;
+                }
+                ++_commonStats.advanced;
+            }
+        }
+        else {
+            ++_commonStats.works;
+            if (PlanStage::NEED_FETCH == status) {
+                ++_commonStats.needFetch;
+            }
+        }
+
+        return status;
+    }
+
     void ProjectionStage::prepareToYield() {
         ++_commonStats.yields;
         _child->prepareToYield();
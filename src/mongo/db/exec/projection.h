@@ -50,6 +50,8 @@ namespace mongo {
 
         virtual bool isEOF();
         virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t maxResults, std::vector<WorkingSetID>* out);
+        virtual bool supportsBatch() { return _child->supportsBatch(); }
 
         virtual void prepareToYield();
         virtual void recoverFromYield();
@@ -46,7 +46,9 @@ namespace mongo {
           _hasNonSimple(false),
           _hasDottedField(false),
           _queryExpression(NULL),
-          _hasReturnKey(false) { }
+          _hasReturnKey(false),
+          _extractSimpleFields(false),
+          _idSlot(0) { }
 
 
     ProjectionExec::ProjectionExec(const BSONObj& spec, const MatchExpression* queryExpression)
@@ -60,7 +62,9 @@ namespace mongo {
           _hasNonSimple(false),
           _hasDottedField(false),
           _queryExpression(queryExpression),
-          _hasReturnKey(false) {
+          _hasReturnKey(false),
+          _extractSimpleFields(false),
+          _idSlot(0) {
 
         // Are we including or excluding fields?
         // -1 when we haven't initialized it.
@@ -172,6 +176,27 @@ namespace mongo {
                 _arrayOpType = ARRAY_OP_POSITIONAL;
             }
         }
+
+        if (requiresDocument()) {
+            return;
+        }
+
+        _extractSimpleFields = true;
+        if (_includeID) {
+            _idSlot = _extractor.addPath("_id");
+        }
+        BSONObjIterator fieldIt(_source);
+        while (fieldIt.more()) {
+            const char* fieldName = fieldIt.next().fieldName();
+            if (mongoutils::str::equals("_id", fieldName)) {
+                continue;
+            }
+            // getFieldDotted looks into arrays for dotted fields, which FieldExtractor doesn't.
+            if (mongoutils::str::contains(fieldName, '.')) {
+                _extractSimpleFields = false;
+            }
+            _fieldSlots.push_back(_extractor.addPath(fieldName));
+        }
     }
 
     ProjectionExec::~ProjectionExec() {
@@ -251,15 +276,29 @@ namespace mongo {
 
         BSONObjBuilder bob;
         if (!requiresDocument()) {
-            // Go field by field.
+            // Go field by field.  If there is a document, find all the fields in one walk over it
+            // rather than scanning it once per field.
+            FieldExtractor::Slots slots;
+            const bool useSlots = _extractSimpleFields && member->hasObj();
+            if (useSlots) {
+                _extractor.extract(member->obj, &slots);
+            }
+
             if (_includeID) {
                 BSONElement elt;
+                if (useSlots) {
+                    elt = slots[_idSlot].element;
+                }
+                else {
+                    member->getFieldDotted("_id", &elt);
+                }
                 // Sometimes the _id field doesn't exist...
-                if (member->getFieldDotted("_id", &elt) && !elt.eoo()) {
+                if (!elt.eoo()) {
                     bob.appendAs(elt, "_id");
                 }
             }
 
+            size_t fieldNum = 0;
             BSONObjIterator it(_source);
             while (it.more()) {
                 BSONElement specElt = it.next();
@@ -268,8 +307,14 @@ namespace mongo {
                 }
 
                 BSONElement keyElt;
+                if (useSlots) {
+                    keyElt = slots[_fieldSlots[fieldNum++]].element;
+                }
+                else {
+                    member->getFieldDotted(specElt.fieldName(), &keyElt);
+                }
                 // We can project a field that doesn't exist.  We just ignore it.
-                if (member->getFieldDotted(specElt.fieldName(), &keyElt) && !keyElt.eoo()) {
+                if (!keyElt.eoo()) {
                     bob.appendAs(keyElt, specElt.fieldName());
                 }
             }
@@ -29,6 +29,7 @@
 #pragma once
 
 #include "mongo/db/exec/working_set.h"
+#include "mongo/db/field_extractor.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/expression.h"
 #include "mongo/util/string_map.h"
@@ -187,6 +188,19 @@ namespace mongo {
         // Do we have a returnKey projection?  If so we *only* output the index key metadata.  If
         // it's not found we output nothing.
         bool _hasReturnKey;
+
+        // If the projection doesn't require the document, but gets one anyway, the fields it
+        // projects are picked out of the document in one walk.  Set if every field is undotted.
+        bool _extractSimpleFields;
+
+        // The fields projected when not requiring the document.
+        FieldExtractor _extractor;
+
+        // The slot of _id, if included.
+        size_t _idSlot;
+
+        // The slots of the fields of _source but _id, in order.
+        vector<size_t> _fieldSlots;
     };
 
 }  // namespace mongo
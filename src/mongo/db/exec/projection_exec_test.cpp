@@ -127,6 +127,21 @@ namespace {
         }
     }
 
+    //
+    // Inclusion of top-level fields
+    //
+
+    TEST(ProjectionExecTest, TransformSimpleInclusion) {
+        const char* s = "{_id: 1, a: 1, b: {c: 2}, d: [3, 4], e: 5}";
+
+        // Fields come out in projection order, missing ones are left out.
+        testTransform("{a: 1, d: 1}", "{}", s, true, "{_id: 1, a: 1, d: [3, 4]}");
+        testTransform("{e: 1, b: 1}", "{}", s, true, "{_id: 1, e: 5, b: {c: 2}}");
+        testTransform("{z: 1, a: 1}", "{}", s, true, "{_id: 1, a: 1}");
+        testTransform("{_id: 0, b: 1, e: 1}", "{}", s, true, "{b: {c: 2}, e: 5}");
+        testTransform("{a: 1}", "{}", "{a: 2}", true, "{a: 2}");
+    }
+
     //
     // position $
     //
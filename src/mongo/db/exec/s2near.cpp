@@ -40,6 +40,27 @@
 
 namespace mongo {
 
+    namespace {
+
+        // How many results we'd like each annulus to hold.
+        const double kTargetResultsPerAnnulus = 400;
+
+        // How many documents' distances we remember, so as not to work them out again for every
+        // annulus whose covering overlaps the document.
+        const size_t kMaxSeenDistances = 100 * 1000;
+
+        /** The area of a cap of 'radius' meters, as a share of 2 pi R^2. */
+        double capArea(double radius) {
+            return 1 - cos(radius / kRadiusOfEarthInMeters);
+        }
+
+        /** The inverse of capArea(). */
+        double capRadius(double area) {
+            return acos(1 - min(2.0, area)) * kRadiusOfEarthInMeters;
+        }
+
+    }  // namespace
+
     S2NearStage::S2NearStage(const S2NearParams& params, WorkingSet* ws) {
         _params = params;
         _ws = ws;
@@ -88,6 +109,7 @@ namespace mongo {
     }
 
     PlanStage::StageState S2NearStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         if (_failed) { return PlanStage::FAILURE; }
         if (isEOF()) { return PlanStage::IS_EOF; }
         ++_commonStats.works;
@@ -161,9 +183,6 @@ namespace mongo {
         _annulus.Release(NULL);
         _annulus.Init(&regions);
 
-        _params.baseBounds.fields[_nearFieldIndex].intervals.clear();
-        ExpressionMapping::cover2dsphere(_annulus, &_params.baseBounds.fields[_nearFieldIndex]);
-
         // Step 3: Actually create the ixscan.
         // TODO: Cache params.
 
@@ -187,6 +206,12 @@ namespace mongo {
             _failed = true;
             return;
         }
+
+        // How the cells are keyed depends on the index's version.
+        _params.baseBounds.fields[_nearFieldIndex].intervals.clear();
+        ExpressionMapping::cover2dsphere(_annulus, params.descriptor->infoObj(),
+                                         &_params.baseBounds.fields[_nearFieldIndex]);
+
         params.bounds = _params.baseBounds;
         params.direction = 1;
         IndexScan* scan = new IndexScan(params, _ws, NULL);
@@ -202,14 +227,7 @@ namespace mongo {
         if (PlanStage::IS_EOF == state) {
             _child.reset();
 
-            // Adjust the annulus size depending on how many results we got.
-            if (_results.empty()) {
-                _radiusIncrement *= 2;
-            } else if (_results.size() < 300) {
-                _radiusIncrement *= 2;
-            } else if (_results.size() > 600) {
-                _radiusIncrement /= 2;
-            }
+            growRadiusIncrement(_results.size());
 
             // Make a new ixscan next time.
             return PlanStage::NEED_TIME;
@@ -230,6 +248,24 @@ namespace mongo {
         // Must have an object in order to get geometry out of it.
         verify(member->hasObj());
 
+        // An annulus' covering overlaps the annuli inside it, so we see documents again.  One we
+        // already know the distance of is either dropped or, unless we need its nearest point,
+        // queued without looking at its geometry again.
+        if (member->hasLoc()) {
+            unordered_map<DiskLoc, double, DiskLoc::Hasher>::const_iterator seen
+                = _seenDistances.find(member->loc);
+            if (_seenDistances.end() != seen) {
+                if (!inAnnulus(seen->second)) {
+                    _ws->free(*out);
+                    return PlanStage::NEED_TIME;
+                }
+                if (!_params.addPointMeta) {
+                    queueResult(*out, seen->second, BSONObj());
+                    return PlanStage::NEED_TIME;
+                }
+            }
+        }
+
         // Get all the fields with that name from the document.
         BSONElementSet geom;
         member->obj.getFieldsDotted(_params.nearQuery.field, geom, false);
@@ -254,25 +290,60 @@ namespace mongo {
             }
         }
 
+        if (member->hasLoc() && _seenDistances.size() < kMaxSeenDistances) {
+            _seenDistances[member->loc] = minDistance;
+        }
+
         // If the distance to the doc satisfies our distance criteria, add it to our buffered
         // results.
-        if (minDistance >= _innerRadius &&
-            (_outerRadiusInclusive ? minDistance <= _outerRadius : minDistance < _outerRadius)) {
-            _results.push(Result(*out, minDistance));
-            if (_params.addDistMeta) {
-                member->addComputed(new GeoDistanceComputedData(minDistance));
-            }
-            if (_params.addPointMeta) {
-                member->addComputed(new GeoNearPointComputedData(minDistanceObj));
-            }
-            if (member->hasLoc()) {
-                _invalidationMap[member->loc] = *out;
-            }
+        if (inAnnulus(minDistance)) {
+            queueResult(*out, minDistance, minDistanceObj);
+        }
+        else {
+            _ws->free(*out);
         }
 
         return PlanStage::NEED_TIME;
     }
 
+    bool S2NearStage::inAnnulus(double distance) const {
+        return distance >= _innerRadius &&
+            (_outerRadiusInclusive ? distance <= _outerRadius : distance < _outerRadius);
+    }
+
+    void S2NearStage::queueResult(WorkingSetID id, double distance, const BSONObj& nearestPoint) {
+        WorkingSetMember* member = _ws->get(id);
+        _results.push(Result(id, distance));
+        if (_params.addDistMeta) {
+            member->addComputed(
+                makeComputed<GeoDistanceComputedData>(_ws, distance));
+        }
+        if (_params.addPointMeta) {
+            member->addComputed(
+                makeComputed<GeoNearPointComputedData>(_ws, nearestPoint));
+        }
+        if (member->hasLoc()) {
+            _invalidationMap[member->loc] = id;
+        }
+    }
+
+    void S2NearStage::growRadiusIncrement(size_t numResults) {
+        if (0 == numResults) {
+            _radiusIncrement *= 2;
+            return;
+        }
+
+        // Assume the documents are as dense beyond the annulus as in it, and make the next
+        // annulus as large as should hold the number of results we'd like.  Density seen in few
+        // results is a poor guess, so the increment changes by a bounded factor.
+        const double outerArea = capArea(_outerRadius);
+        const double density = numResults / max(outerArea - capArea(_innerRadius),
+                                                numeric_limits<double>::min());
+        const double wantedIncrement =
+            capRadius(outerArea + kTargetResultsPerAnnulus / density) - _outerRadius;
+        _radiusIncrement = max(_radiusIncrement / 4, min(_radiusIncrement * 8, wantedIncrement));
+    }
+
     void S2NearStage::prepareToYield() {
         if (NULL != _child.get()) {
             _child->prepareToYield();
@@ -290,6 +361,9 @@ namespace mongo {
             _child->invalidate(dl);
         }
 
+        // The document may move, or another take its place.
+        _seenDistances.erase(dl);
+
         unordered_map<DiskLoc, WorkingSetID, DiskLoc::Hasher>::iterator it
             = _invalidationMap.find(dl);
 
@@ -78,6 +78,12 @@ namespace mongo {
         StageState addResultToQueue(WorkingSetID* out);
         void nextAnnulus();
 
+        bool inAnnulus(double distance) const;
+        void queueResult(WorkingSetID id, double distance, const BSONObj& nearestPoint);
+
+        // Sets _radiusIncrement from how many results the annulus just searched held.
+        void growRadiusIncrement(size_t numResults);
+
         bool _worked;
 
         S2NearParams _params;
@@ -117,6 +123,9 @@ namespace mongo {
         // For fast invalidation.  Perhaps not worth it.
         unordered_map<DiskLoc, WorkingSetID, DiskLoc::Hasher> _invalidationMap;
 
+        // The distance of each document looked at so far, up to kMaxSeenDistances of them.
+        unordered_map<DiskLoc, double, DiskLoc::Hasher> _seenDistances;
+
         // Geo-related variables.
         // At what min distance (arc length) do we start looking for results?
         double _minDistance;
@@ -130,8 +139,8 @@ namespace mongo {
         // True if we are looking at last annulus
         bool _outerRadiusInclusive;
 
-        // When we search the next annulus, what to adjust our radius by?  Grows when we search an
-        // annulus and find no results.
+        // When we search the next annulus, what to adjust our radius by?  Follows the density of
+        // the results found so far, and doubles when an annulus holds none.
         double _radiusIncrement;
 
         // Did we encounter an unrecoverable error?
@@ -0,0 +1,84 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "mongo/platform/cstdint.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif !defined(__i386__) && !defined(__x86_64__)
+#include "mongo/util/time_support.h"
+#endif
+
+namespace mongo {
+
+    // Server parameter: whether stages add the time they spend in work(...) to their stats.
+    extern bool planStageTiming;
+
+    /**
+     * The CPU's time stamp counter, which counts cycles at a constant rate and takes a few dozen
+     * cycles to read.  Elsewhere it falls back to the microsecond clock.
+     */
+    inline uint64_t readCycleCounter() {
+#if defined(_MSC_VER)
+        return __rdtsc();
+#elif defined(__i386__) || defined(__x86_64__)
+        uint32_t lo, hi;
+        __asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+        return (static_cast<uint64_t>(hi) << 32) | lo;
+#else
+        return curTimeMicros64();
+#endif
+    }
+
+    /**
+     * Adds the cycles from its construction to its destruction to *counter, if planStageTiming
+     * is on.  A stage starts one at the top of work(...) and workBatch(...) with its
+     * CommonStats::executionCycles, which then includes the time spent in its children.
+     */
+    class ScopedStageTimer {
+    public:
+        explicit ScopedStageTimer(uint64_t* counter)
+            : _counter(planStageTiming ? counter : NULL),
+              _start(_counter ? readCycleCounter() : 0) { }
+
+        ~ScopedStageTimer() {
+            if (_counter) {
+                *_counter += readCycleCounter() - _start;
+            }
+        }
+
+    private:
+        uint64_t* const _counter;
+        const uint64_t _start;
+    };
+
+}  // namespace mongo
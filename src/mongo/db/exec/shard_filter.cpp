@@ -28,20 +28,65 @@
 
 #include "mongo/db/exec/shard_filter.h"
 
+#include <algorithm>
+
+#include "mongo/db/index_names.h"
 #include "mongo/db/keypattern.h"
+#include "mongo/s/chunk_load_tracker.h"
 
 namespace mongo {
 
+    namespace {
+
+        // Orders by range min, for std::upper_bound.
+        template <class Range>
+        bool elementBeforeRange(const BSONElement& e, const Range& range) {
+            return e.woCompare(range.min, false) < 0;
+        }
+
+        // An interval of index values [lo, hi] or [lo, hi).
+        struct Span {
+            BSONElement lo;
+            BSONElement hi;
+            bool hiInclusive;
+        };
+
+        BSONObj keyOf(const string& field, const BSONElement& e) {
+            BSONObjBuilder bob;
+            bob.appendAs(e, field);
+            return bob.obj();
+        }
+
+    }  // namespace
+
     ShardFilterStage::ShardFilterStage(const CollectionMetadataPtr& metadata,
                                        WorkingSet* ws,
-                                       PlanStage* child)
-        : _ws(ws), _child(child), _metadata(metadata) { }
+                                       PlanStage* child,
+                                       bool childOnlyOwned)
+        : _ws(ws), _child(child), _metadata(metadata), _childOnlyOwned(childOnlyOwned) {
+
+        if (!_metadata || _childOnlyOwned) { return; }
+
+        const BSONObj keyPattern = _metadata->getKeyPattern();
+        if (keyPattern.nFields() != 1 || KeyPattern(keyPattern).isSpecial()) { return; }
+
+        _keyField = keyPattern.firstElement().fieldName();
+        const RangeMap& ranges = _metadata->getOwnedRanges();
+        _ownedRanges.reserve(ranges.size());
+        for (RangeMap::const_iterator it = ranges.begin(); it != ranges.end(); ++it) {
+            OwnedRange range;
+            range.min = it->first.firstElement();
+            range.max = it->second.firstElement();
+            _ownedRanges.push_back(range);
+        }
+    }
 
     ShardFilterStage::~ShardFilterStage() { }
 
     bool ShardFilterStage::isEOF() { return _child->isEOF(); }
 
     PlanStage::StageState ShardFilterStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
 
         // If we've returned as many results as we're limited to, isEOF will be true.
@@ -53,16 +98,20 @@ namespace mongo {
             // If we're sharded make sure that we don't return any data that hasn't been migrated
             // off of our shared yet.
             if (_metadata) {
-                KeyPattern kp(_metadata->getKeyPattern());
-
                 WorkingSetMember* member = _ws->get(*out);
 
-                // This performs excessive BSONObj creation but that's OK for now.
-                if (!_metadata->keyBelongsToMe(kp.extractSingleKey(member->obj))) {
+                if (!_childOnlyOwned && !belongsToMe(member->obj)) {
                     _ws->free(*out);
                     ++_specificStats.chunkSkips;
                     return PlanStage::NEED_TIME;
                 }
+
+                if (ChunkLoadTracker::isEnabled()) {
+                    KeyPattern kp(_metadata->getKeyPattern());
+                    chunkLoadTracker.noteRead(*_metadata,
+                                              kp.extractSingleKey(member->obj),
+                                              member->obj.objsize());
+                }
             }
 
             // If we're here either we have shard state and our doc passed, or we have no shard
@@ -80,6 +129,94 @@ namespace mongo {
         }
     }
 
+    bool ShardFilterStage::belongsToMe(const BSONObj& doc) const {
+        if (!_keyField.empty()) {
+            BSONElement e = doc.getFieldDotted(_keyField);
+            if (!e.eoo() && e.type() != Array) {
+                vector<OwnedRange>::const_iterator it =
+                    std::upper_bound(_ownedRanges.begin(), _ownedRanges.end(), e,
+                                     elementBeforeRange<OwnedRange>);
+                if (it == _ownedRanges.begin()) { return false; }
+                --it;
+                return e.woCompare(it->max, false) < 0;
+            }
+        }
+
+        // This performs excessive BSONObj creation but that's OK for now.
+        KeyPattern kp(_metadata->getKeyPattern());
+        return _metadata->keyBelongsToMe(kp.extractSingleKey(doc));
+    }
+
+    // static
+    bool ShardFilterStage::boundsOwned(const CollectionMetadata& metadata,
+                                       const BSONObj& indexKeyPattern,
+                                       const IndexBounds& bounds) {
+        const BSONObj shardKeyPattern = metadata.getKeyPattern();
+        if (shardKeyPattern.nFields() != 1) { return false; }
+
+        const BSONElement shardKeyElt = shardKeyPattern.firstElement();
+        const BSONElement indexElt = indexKeyPattern.firstElement();
+        if (indexElt.eoo() || !str::equals(indexElt.fieldName(), shardKeyElt.fieldName())) {
+            return false;
+        }
+
+        // The index must hold the same values as the shard key: both hashed or both plain.
+        const bool shardKeyHashed = KeyPattern(shardKeyPattern).isSpecial();
+        if (shardKeyHashed) {
+            if (indexElt.type() != String || IndexNames::HASHED != indexElt.valuestr()) {
+                return false;
+            }
+        }
+        else if (!indexElt.isNumber()) {
+            return false;
+        }
+
+        // Collect the intervals over the leading field in ascending order.
+        vector<Span> spans;
+        if (bounds.isSimpleRange) {
+            Span span;
+            span.lo = bounds.startKey.firstElement();
+            span.hi = bounds.endKey.firstElement();
+            // Later fields may extend the scan to the whole of the end value.
+            span.hiInclusive = true;
+            if (span.lo.eoo() || span.hi.eoo()) { return false; }
+            if (span.lo.woCompare(span.hi, false) > 0) { std::swap(span.lo, span.hi); }
+            spans.push_back(span);
+        }
+        else {
+            if (bounds.fields.empty()) { return false; }
+            const vector<Interval>& intervals = bounds.fields[0].intervals;
+            for (size_t i = 0; i < intervals.size(); ++i) {
+                Span span;
+                span.lo = intervals[i].start;
+                span.hi = intervals[i].end;
+                span.hiInclusive = intervals[i].endInclusive;
+                if (span.lo.woCompare(span.hi, false) > 0) {
+                    // Descending scan.
+                    std::swap(span.lo, span.hi);
+                    span.hiInclusive = intervals[i].startInclusive;
+                }
+                spans.push_back(span);
+            }
+        }
+
+        const string field = shardKeyElt.fieldName();
+        const RangeMap& ranges = metadata.getOwnedRanges();
+        for (size_t i = 0; i < spans.size(); ++i) {
+            // Each interval must sit inside a single owned range.
+            BSONObj lo = keyOf(field, spans[i].lo);
+            RangeMap::const_iterator it = ranges.upper_bound(lo);
+            if (it == ranges.begin()) { return false; }
+            --it;
+            if (!rangeContains(it->first, it->second, lo)) { return false; }
+
+            int cmp = keyOf(field, spans[i].hi).woCompare(it->second);
+            if (cmp > 0 || (cmp == 0 && spans[i].hiInclusive)) { return false; }
+        }
+
+        return true;
+    }
+
     void ShardFilterStage::prepareToYield() {
         ++_commonStats.yields;
         _child->prepareToYield();
@@ -31,6 +31,7 @@
 #include "mongo/db/diskloc.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/query/index_bounds.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/d_logic.h"
 #include "mongo/s/stale_exception.h"
@@ -71,10 +72,16 @@ namespace mongo {
      *
      * Preconditions: Child must be fetched.  TODO XXX: when covering analysis is in just build doc
      * and check that against shard key.
+     *
+     * If 'childOnlyOwned' is true the caller vouches that every document the child can return
+     * lies in a range the shard owns (see boundsOwned()), and the per-document check is skipped.
      */
     class ShardFilterStage : public PlanStage {
     public:
-        ShardFilterStage(const CollectionMetadataPtr& metadata, WorkingSet* ws, PlanStage* child);
+        ShardFilterStage(const CollectionMetadataPtr& metadata,
+                         WorkingSet* ws,
+                         PlanStage* child,
+                         bool childOnlyOwned = false);
         virtual ~ShardFilterStage();
 
         virtual bool isEOF();
@@ -86,7 +93,30 @@ namespace mongo {
 
         virtual PlanStageStats* getStats();
 
+        /**
+         * Returns true if every key an index scan over 'indexKeyPattern' with 'bounds' can visit
+         * falls in a range owned according to 'metadata'. Only answers for indexes leading with
+         * the field of a single-field shard key; returns false whenever in doubt.
+         */
+        static bool boundsOwned(const CollectionMetadata& metadata,
+                                const BSONObj& indexKeyPattern,
+                                const IndexBounds& bounds);
+
     private:
+        /**
+         * Checks whether 'doc' falls in an owned range. Reads a single-field shard key straight
+         * out of 'doc' and binary searches _ownedRanges, falling back to the metadata for
+         * compound or hashed shard keys.
+         */
+        bool belongsToMe(const BSONObj& doc) const;
+
+        // Owned range [min, max) of a single-field shard key. Both elements point into the
+        // RangeMap of _metadata, which outlives this stage's use of them.
+        struct OwnedRange {
+            BSONElement min;
+            BSONElement max;
+        };
+
         WorkingSet* _ws;
         scoped_ptr<PlanStage> _child;
 
@@ -97,6 +127,16 @@ namespace mongo {
         // Note: it is important that this is the metadata from the time this stage is constructed.
         // See class comment for details.
         const CollectionMetadataPtr _metadata;
+
+        // True if the child only produces documents in owned ranges.
+        const bool _childOnlyOwned;
+
+        // Dotted name of the shard key field when the key has a single, non-hashed field and the
+        // fast path applies; empty otherwise.
+        string _keyField;
+
+        // Owned ranges of _metadata sorted by min, for the fast path.
+        vector<OwnedRange> _ownedRanges;
     };
 
 }  // namespace mongo
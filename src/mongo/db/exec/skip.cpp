@@ -38,6 +38,7 @@ namespace mongo {
     bool SkipStage::isEOF() { return _child->isEOF(); }
 
     PlanStage::StageState SkipStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
 
         if (isEOF()) { return PlanStage::IS_EOF; }
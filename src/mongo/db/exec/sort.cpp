@@ -35,6 +35,8 @@
 #include "mongo/db/index/btree_key_generator.h"
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/query/query_planner.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage_options.h"
 
 namespace {
 
@@ -52,13 +54,54 @@ namespace {
         return memUsage;
     }
 
+    bool hasComputedData(const WorkingSetMember& member) {
+        typedef mongo::WorkingSetComputedDataType WSCD;
+        for (WSCD i = WSCD(0); i < mongo::WSM_COMPUTED_NUM_TYPES; i = WSCD(i + 1)) {
+            if (member.hasComputed(i)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
 } // namespace
 
 namespace mongo {
 
     using std::vector;
 
-    const size_t kMaxBytes = 32 * 1024 * 1024;
+    MONGO_EXPORT_SERVER_PARAMETER(sortStageMaxMemoryBytes, int, 32 * 1024 * 1024);
+
+    MONGO_EXPORT_SERVER_PARAMETER(sortStageAllowSpill, bool, true);
+
+    namespace {
+
+        // Orders what's spilled the same way WorkingSetComparator orders the buffer.
+        class SpillComparator {
+        public:
+            typedef std::pair<BSONObj, SortStageSpilledDoc> Data;
+
+            explicit SpillComparator(const BSONObj& pattern) : _pattern(pattern) { }
+
+            int operator()(const Data& lhs, const Data& rhs) const {
+                // False means ignore field names.
+                int result = lhs.first.woCompare(rhs.first, _pattern, false);
+                if (0 != result) {
+                    return result;
+                }
+                return lhs.second.loc.compare(rhs.second.loc);
+            }
+
+        private:
+            BSONObj _pattern;
+        };
+
+    }  // namespace
+
+    SortStageParams::SortStageParams()
+        : limit(0),
+          maxMemUsage(sortStageMaxMemoryBytes),
+          allowSpill(sortStageAllowSpill) { }
 
     SortStageKeyGenerator::SortStageKeyGenerator(const BSONObj& sortSpec, const BSONObj& queryObj) {
         _hasBounds = false;
@@ -276,9 +319,12 @@ namespace mongo {
           _pattern(params.pattern),
           _query(params.query),
           _limit(params.limit),
+          _maxMemUsage(params.maxMemUsage),
+          _allowSpill(params.allowSpill),
           _sorted(false),
           _resultIterator(_data.end()),
-          _memUsage(0) {
+          _memUsage(0),
+          _memoryGrant(MemoryBroker::kSort) {
         dassert(_limit >= 0);
     }
 
@@ -287,26 +333,27 @@ namespace mongo {
     bool SortStage::isEOF() {
         // We're done when our child has no more results, we've sorted the child's results, and
         // we've returned all sorted results.
-        return _child->isEOF() && _sorted && (_data.end() == _resultIterator);
+        if (!_child->isEOF() || !_sorted) {
+            return false;
+        }
+        if (NULL != _sorterIterator) {
+            return !_sorterIterator->more();
+        }
+        return _data.end() == _resultIterator;
     }
 
     PlanStage::StageState SortStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
 
         if (NULL == _sortKeyGen) {
             // This is heavy and should be done as part of work().
             _sortKeyGen.reset(new SortStageKeyGenerator(_pattern, _query));
             _sortKeyComparator.reset(new WorkingSetComparator(_sortKeyGen->getSortComparator()));
-            // If limit > 1, we need to initialize _dataSet here to maintain ordered
-            // set of data items while fetching from the child stage.
-            if (_limit > 1) {
-                const WorkingSetComparator& cmp = *_sortKeyComparator;
-                _dataSet.reset(new SortableDataItemSet(cmp));
-            }
             return PlanStage::NEED_TIME;
         }
 
-        if (_memUsage > kMaxBytes) {
+        if (_memUsage > _maxMemUsage) {
             return PlanStage::FAILURE;
         }
 
@@ -326,13 +373,6 @@ namespace mongo {
                 // Planner must put a fetch before we get here.
                 verify(member->hasObj());
 
-                // TODO: This should always be true...?
-                if (member->hasLoc()) {
-                    _wsidByDiskLoc[member->loc] = id;
-                }
-
-
-                // The data remains in the WorkingSet and we wrap the WSID with the sort key.
                 SortableDataItem item;
                 item.sortKey = _sortKeyGen->getSortKey(*member);
                 item.wsid = id;
@@ -341,7 +381,32 @@ namespace mongo {
                     item.loc = member->loc;
                 }
 
+                if (NULL != _sorter) {
+                    // We can't give computed data to the sorter, so we can't sort this.
+                    if (hasComputedData(*member)) {
+                        _ws->free(id);
+                        return PlanStage::FAILURE;
+                    }
+                    addToSorter(item);
+                    ++_commonStats.needTime;
+                    return PlanStage::NEED_TIME;
+                }
+
+                // TODO: This should always be true...?
+                if (member->hasLoc()) {
+                    _wsidByDiskLoc[member->loc] = id;
+                }
+
+                // The data remains in the WorkingSet and we wrap the WSID with the sort key.
                 addToBuffer(item);
+                _memoryGrant.setBytes(_memUsage);
+                _specificStats.memUsage = std::max(_specificStats.memUsage,
+                                                   static_cast<uint64_t>(_memUsage));
+
+                if (_allowSpill
+                        && (_memUsage > _maxMemUsage || _memoryGrant.shouldSpillEarly())) {
+                    spill();
+                }
 
                 ++_commonStats.needTime;
                 return PlanStage::NEED_TIME;
@@ -349,8 +414,14 @@ namespace mongo {
             else if (PlanStage::IS_EOF == code) {
                 // TODO: We don't need the lock for this.  We could ask for a yield and do this work
                 // unlocked.  Also, this is performing a lot of work for one call to work(...)
-                sortBuffer();
-                _resultIterator = _data.begin();
+                if (NULL != _sorter) {
+                    _sorterIterator.reset(_sorter->done());
+                    _specificStats.spillFiles = _sorter->numFiles();
+                }
+                else {
+                    sortBuffer();
+                    _resultIterator = _data.begin();
+                }
                 _sorted = true;
                 ++_commonStats.needTime;
                 return PlanStage::NEED_TIME;
@@ -368,8 +439,21 @@ namespace mongo {
         }
 
         // Returning results.
-        verify(_resultIterator != _data.end());
         verify(_sorted);
+
+        // What was spilled comes back as owned objects that no DiskLoc refers to any longer.
+        if (NULL != _sorterIterator) {
+            SpillComparator::Data next = _sorterIterator->next();
+            *out = _ws->allocate();
+            WorkingSetMember* member = _ws->get(*out);
+            member->obj = next.second.obj.getOwned();
+            member->state = WorkingSetMember::OWNED_OBJ;
+
+            ++_commonStats.advanced;
+            return PlanStage::ADVANCED;
+        }
+
+        verify(_resultIterator != _data.end());
         *out = _resultIterator->wsid;
         _resultIterator++;
 
@@ -450,10 +534,11 @@ namespace mongo {
      *                     Updates memory usage if item was replaced.
      *     sortBuffer() - Does nothing.
      * limit > 1:
-     *     addToBuffer() - Does not update vector. Adds item to set.
-     *                     If size of set exceeds limit, remove item from set
-     *                     with lowest key. Updates memory usage accordingly.
-     *     sortBuffer() - Copies items from set to vectors.
+     *     addToBuffer() - Keeps vector a max-heap of at most limit items.
+     *                     If limit is reached, the new item replaces the heap's
+     *                     front (the item with lowest key) if it is better.
+     *                     Updates memory usage accordingly.
+     *     sortBuffer() - Sorts the heap in place.
      */
     void SortStage::addToBuffer(const SortableDataItem& item) {
         // Holds ID of working set member to be freed at end of this function.
@@ -479,11 +564,12 @@ namespace mongo {
             }
         }
         else {
-            // Update data item set instead of vector
+            const WorkingSetComparator& cmp = *_sortKeyComparator;
             // Limit not reached - insert and return
             vector<SortableDataItem>::size_type limit(_limit);
-            if (_dataSet->size() < limit) {
-                _dataSet->insert(item);
+            if (_data.size() < limit) {
+                _data.push_back(item);
+                std::push_heap(_data.begin(), _data.end(), cmp);
                 _memUsage += getMemUsage(_ws, item.wsid);
                 return;
             }
@@ -491,18 +577,13 @@ namespace mongo {
             // If new item does not have a lower key value than last item,
             // do nothing.
             wsidToFree = item.wsid;
-            SortableDataItemSet::const_iterator lastItemIt = --(_dataSet->end());
-            const SortableDataItem& lastItem = *lastItemIt;
-            const WorkingSetComparator& cmp = *_sortKeyComparator;
-            if (cmp(item, lastItem)) {
+            if (cmp(item, _data.front())) {
+                std::pop_heap(_data.begin(), _data.end(), cmp);
+                SortableDataItem& lastItem = _data.back();
                 _memUsage += getMemUsage(_ws, item.wsid) - getMemUsage(_ws, lastItem.wsid);
                 wsidToFree = lastItem.wsid;
-                // According to std::set iterator validity rules,
-                // it does not matter which of erase()/insert() happens first.
-                // Here, we choose to erase first to release potential resources
-                // used by the last item and to keep the scope of the iterator to a minimum.
-                _dataSet->erase(lastItemIt);
-                _dataSet->insert(item);
+                lastItem = item;
+                std::push_heap(_data.begin(), _data.end(), cmp);
             }
         }
 
@@ -527,13 +608,54 @@ namespace mongo {
             return;
         }
         else {
-            // Set already contains items in sorted order, so we simply copy the items
-            // from the set to the vector.
-            // Release the memory for the set after the copy.
-            vector<SortableDataItem> newData(_dataSet->begin(), _dataSet->end());
-            _data.swap(newData);
-            _dataSet.reset();
+            const WorkingSetComparator& cmp = *_sortKeyComparator;
+            std::sort_heap(_data.begin(), _data.end(), cmp);
         }
     }
 
+    bool SortStage::spill() {
+        for (size_t i = 0; i < _data.size(); ++i) {
+            if (hasComputedData(*_ws->get(_data[i].wsid))) {
+                return false;
+            }
+        }
+
+        SortOptions opts;
+        opts.limit = _limit;
+        opts.maxMemoryUsageBytes = _maxMemUsage;
+        opts.extSortAllowed = true;
+        opts.tempDir = storageGlobalParams.dbpath + "/_tmp";
+        _sorter.reset(SpillSorter::make(opts,
+                                        SpillComparator(_sortKeyGen->getSortComparator())));
+
+        for (size_t i = 0; i < _data.size(); ++i) {
+            // Anything invalidated while buffered would have been dropped on the way out.
+            if (_ws->isFlagged(_data[i].wsid)) {
+                _ws->free(_data[i].wsid);
+                continue;
+            }
+            addToSorter(_data[i]);
+        }
+
+        _data.clear();
+        _wsidByDiskLoc.clear();
+        _memUsage = 0;
+        _memoryGrant.setBytes(0);
+        return true;
+    }
+
+    void SortStage::addToSorter(const SortableDataItem& item) {
+        WorkingSetMember* member = _ws->get(item.wsid);
+        if (member->hasLoc()) {
+            _wsidByDiskLoc.erase(member->loc);
+        }
+        _sorter->add(item.sortKey.getOwned(),
+                     SortStageSpilledDoc(member->obj.getOwned(), item.loc));
+        _ws->free(item.wsid);
+        ++_specificStats.spilled;
+    }
+
 }  // namespace mongo
+
+#include "mongo/db/sorter/sorter.cpp"
+MONGO_CREATE_SORTER(mongo::BSONObj, mongo::SortStageSpilledDoc, mongo::SpillComparator);
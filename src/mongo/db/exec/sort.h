@@ -30,7 +30,6 @@
 
 #include <boost/scoped_ptr.hpp>
 #include <vector>
-#include <set>
 
 #include "mongo/db/diskloc.h"
 #include "mongo/db/jsobj.h"
@@ -38,6 +37,8 @@
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/query/index_bounds.h"
+#include "mongo/db/sorter/memory_broker.h"
+#include "mongo/db/sorter/sorter.h"
 #include "mongo/platform/unordered_map.h"
 
 namespace mongo {
@@ -47,7 +48,9 @@ namespace mongo {
     // Parameters that must be provided to a SortStage
     class SortStageParams {
     public:
-        SortStageParams() : limit(0) { }
+        // Takes its memory settings from the sortStageMaxMemoryBytes and sortStageAllowSpill
+        // server parameters.
+        SortStageParams();
 
         // How we're sorting.
         BSONObj pattern;
@@ -57,6 +60,42 @@ namespace mongo {
 
         // Must be >= 0.  Equal to 0 for no limit.
         int limit;
+
+        // How many bytes of results we buffer in memory.
+        size_t maxMemUsage;
+
+        // Past maxMemUsage, do we sort externally using files in the dbpath or fail?
+        bool allowSpill;
+    };
+
+    /**
+     * What a SortStage hands to the external sorter for each result once it spills: an owned
+     * copy of the document and the DiskLoc that breaks ties between equal sort keys.
+     */
+    struct SortStageSpilledDoc {
+        SortStageSpilledDoc() { }
+        SortStageSpilledDoc(const BSONObj& o, const DiskLoc& l) : obj(o), loc(l) { }
+
+        struct SorterDeserializeSettings {}; // unused
+        void serializeForSorter(BufBuilder& buf) const {
+            loc.serializeForSorter(buf);
+            obj.serializeForSorter(buf);
+        }
+        static SortStageSpilledDoc deserializeForSorter(BufReader& buf,
+                                                        const SorterDeserializeSettings&) {
+            DiskLoc l = DiskLoc::deserializeForSorter(buf, DiskLoc::SorterDeserializeSettings());
+            BSONObj o = BSONObj::deserializeForSorter(buf, BSONObj::SorterDeserializeSettings());
+            return SortStageSpilledDoc(o, l);
+        }
+        int memUsageForSorter() const {
+            return loc.memUsageForSorter() + obj.memUsageForSorter();
+        }
+        SortStageSpilledDoc getOwned() const {
+            return SortStageSpilledDoc(obj.getOwned(), loc);
+        }
+
+        BSONObj obj;
+        DiskLoc loc;
     };
 
     /**
@@ -167,6 +206,10 @@ namespace mongo {
         // Must be >= 0.  Equal to 0 for no limit.
         int _limit;
 
+        // See SortStageParams.
+        size_t _maxMemUsage;
+        bool _allowSpill;
+
         //
         // Sort key generation
         //
@@ -190,7 +233,7 @@ namespace mongo {
             DiskLoc loc;
         };
 
-        // Comparison object for data buffers (vector and set).
+        // Comparison object for the data buffer.
         // Items are compared on (sortKey, loc). This is also how the items are
         // ordered in the indices.
         // Keys are compared using BSONObj::woCompare() with DiskLoc as a tie-breaker.
@@ -203,7 +246,7 @@ namespace mongo {
         };
 
         /**
-         * Inserts one item into data buffer (vector or set).
+         * Inserts one item into data buffer.
          * If limit is exceeded, remove item with lowest key.
          */
         void addToBuffer(const SortableDataItem& item);
@@ -211,11 +254,21 @@ namespace mongo {
         /**
          * Sorts data buffer.
          * Assumes no more items will be added to buffer.
-         * If data is stored in set, copy set
-         * contents to vector and clear set.
          */
         void sortBuffer();
 
+        /**
+         * Move everything buffered to an external sorter, which takes all later results too.
+         * Returns false, leaving the buffer as is, if the results carry computed data that the
+         * sorter can't hold on to.
+         */
+        bool spill();
+
+        /**
+         * Hand the result 'item' refers to to the external sorter and free its member.
+         */
+        void addToSorter(const SortableDataItem& item);
+
         // Comparator for data buffer
         // Initialization follows sort key generator
         scoped_ptr<WorkingSetComparator> _sortKeyComparator;
@@ -224,16 +277,18 @@ namespace mongo {
         // _data will contain sorted data when all data is gathered
         // and sorted.
         // When _limit is greater than 1 and not all data has been gathered from child stage,
-        // _dataSet is used instead to maintain an ordered set of the incomplete data set.
-        // When the data set is complete, we copy the items from _dataSet to _data which will
-        // be used to provide the results of this stage through _resultIterator.
+        // _data is a max-heap of the best _limit items so far, the worst of them in front.
         vector<SortableDataItem> _data;
-        typedef std::set<SortableDataItem, WorkingSetComparator> SortableDataItemSet;
-        scoped_ptr<SortableDataItemSet> _dataSet;
 
         // Iterates through _data post-sort returning it.
         vector<SortableDataItem>::iterator _resultIterator;
 
+        // Once more than _maxMemUsage is buffered (and we're allowed to), results go here
+        // instead of _data, and come back out of _sorterIterator once the child is done.
+        typedef Sorter<BSONObj, SortStageSpilledDoc> SpillSorter;
+        scoped_ptr<SpillSorter> _sorter;
+        scoped_ptr<SpillSorter::Iterator> _sorterIterator;
+
         // We buffer a lot of data and we want to look it up by DiskLoc quickly upon invalidation.
         typedef unordered_map<DiskLoc, WorkingSetID, DiskLoc::Hasher> DataMap;
         DataMap _wsidByDiskLoc;
@@ -247,6 +302,7 @@ namespace mongo {
 
         // The usage in bytes of all bufered data that we're sorting.
         size_t _memUsage;
+        MemoryBroker::Grant _memoryGrant;
     };
 
 }  // namespace mongo
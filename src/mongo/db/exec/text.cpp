@@ -27,6 +27,9 @@
  */
 
 #include "mongo/db/exec/text.h"
+
+#include <algorithm>
+
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/exec/working_set_computed_data.h"
@@ -35,6 +38,17 @@
 
 namespace mongo {
 
+    namespace {
+
+        // Candidates keep which terms they were seen with in a 64-bit mask.
+        const size_t kMaxTopTerms = 64;
+
+        // Keys read between checks for the top results, at the least.  Each check looks at every
+        // candidate, so with many candidates the checks are spaced further apart.
+        const size_t kMinKeysBetweenChecks = 128;
+
+    }  // namespace
+
     TextStage::TextStage(const TextStageParams& params,
                          WorkingSet* ws,
                          const MatchExpression* filter)
@@ -56,6 +70,7 @@ namespace mongo {
     }
 
     PlanStage::StageState TextStage::work(WorkingSetID* out) {
+        ScopedStageTimer timer(&_commonStats.executionCycles);
         ++_commonStats.works;
         if (isEOF()) { return PlanStage::IS_EOF; }
 
@@ -76,7 +91,8 @@ namespace mongo {
         member->loc = _results[_curResult].loc;
         member->obj = member->loc.obj();
         member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
-        member->addComputed(new TextScoreComputedData(_results[_curResult].score));
+        member->addComputed(makeComputed<TextScoreComputedData>(_ws,
+                                                                _results[_curResult].score));
 
         // Advance to next result.
         ++_curResult;
@@ -143,24 +159,43 @@ namespace mongo {
             scanners.push_back(ixscan);
         }
 
-        // For each index scan, read all results and store scores.
-        size_t currentIndexScanner = 0;
-        while (currentIndexScanner < scanners.size()) {
-            BSONObj keyObj;
-            DiskLoc loc;
+        PlanStage::StageState state;
+        if (_params.limit > 0 && !scanners.empty() && scanners.size() <= kMaxTopTerms) {
+            state = readTopResults(scanners);
+        }
+        else {
+            state = readAllResults(scanners);
+        }
 
+        for (size_t i=0; i<scanners.size(); ++i) { delete scanners[i]; }
+
+        if (PlanStage::FAILURE == state) {
+            return PlanStage::FAILURE;
+        }
+
+        _filledOutResults = true;
+
+        if (_results.size() == 0) {
+            return PlanStage::IS_EOF;
+        }
+        return PlanStage::NEED_TIME;
+    }
+
+    PlanStage::StageState TextStage::readKey(IndexScan* scanner, BSONObj* keyOut,
+                                             DiskLoc* locOut) {
+        while (true) {
             WorkingSetID id;
-            PlanStage::StageState state = scanners[currentIndexScanner]->work(&id);
+            PlanStage::StageState state = scanner->work(&id);
 
             if (PlanStage::ADVANCED == state) {
                 WorkingSetMember* wsm = _ws->get(id);
-                IndexKeyDatum& keyDatum = wsm->keyData.back();
-                filterAndScore(keyDatum.keyData, wsm->loc);
+                *keyOut = wsm->keyData.back().keyData;
+                *locOut = wsm->loc;
                 _ws->free(id);
+                return PlanStage::ADVANCED;
             }
             else if (PlanStage::IS_EOF == state) {
-                // Done with this scan.
-                ++currentIndexScanner;
+                return PlanStage::IS_EOF;
             }
             else if (PlanStage::NEED_FETCH == state) {
                 // We're calling work() on ixscans and they have no way to return a fetch.
@@ -172,12 +207,24 @@ namespace mongo {
             else {
                 verify(PlanStage::FAILURE == state);
                 warning() << "error from index scan during text stage: invalid FAILURE state";
-                for (size_t i=0; i<scanners.size(); ++i) { delete scanners[i]; }
                 return PlanStage::FAILURE;
             }
         }
+    }
 
-        for (size_t i=0; i<scanners.size(); ++i) { delete scanners[i]; }
+    PlanStage::StageState TextStage::readAllResults(const vector<IndexScan*>& scanners) {
+        // For each index scan, read all results and store scores.
+        for (size_t i = 0; i < scanners.size(); ++i) {
+            BSONObj key;
+            DiskLoc loc;
+            PlanStage::StageState state;
+            while (PlanStage::ADVANCED == (state = readKey(scanners[i], &key, &loc))) {
+                filterAndScore(key, loc);
+            }
+            if (PlanStage::FAILURE == state) {
+                return PlanStage::FAILURE;
+            }
+        }
 
         // Filter for phrases and negative terms, score and truncate.
         for (ScoreMap::iterator i = _scores.begin(); i != _scores.end(); ++i) {
@@ -199,12 +246,158 @@ namespace mongo {
             _results.push_back(ScoredLocation(loc, score));
         }
 
-        _filledOutResults = true;
+        return PlanStage::IS_EOF;
+    }
 
-        if (_results.size() == 0) {
-            return PlanStage::IS_EOF;
+    PlanStage::StageState TextStage::readTopResults(const vector<IndexScan*>& scanners) {
+        const size_t numTerms = scanners.size();
+
+        // No key still to be read for term i scores more than bounds[i].  As the keys come in
+        // descending order of score, that's the score of the last key read.
+        vector<double> bounds(numTerms, MAX_WEIGHT);
+        size_t termsLeft = numTerms;
+        size_t keysSinceCheck = 0;
+
+        while (termsLeft > 0) {
+            for (size_t i = 0; i < numTerms; ++i) {
+                if (0 == bounds[i]) {
+                    continue;
+                }
+
+                BSONObj key;
+                DiskLoc loc;
+                PlanStage::StageState state = readKey(scanners[i], &key, &loc);
+                if (PlanStage::FAILURE == state) {
+                    return PlanStage::FAILURE;
+                }
+                if (PlanStage::IS_EOF == state) {
+                    bounds[i] = 0;
+                    --termsLeft;
+                    continue;
+                }
+
+                ++_specificStats.keysExamined;
+                ++keysSinceCheck;
+                double termScore = keyScore(key);
+                // A term whose keys are all worth nothing can't change the ranking.
+                bounds[i] = termScore;
+                if (0 == bounds[i]) {
+                    --termsLeft;
+                }
+
+                Candidate& candidate = _candidates[loc];
+                if (candidate.score < 0) {
+                    continue;
+                }
+                if (0 == candidate.termsSeen) {
+                    // Rejecting a document now keeps it from taking the place of one that
+                    // matches among the top results.
+                    bool passes = passesFilter(key, loc);
+                    if (passes && _params.query.hasNonTermPieces()) {
+                        ++_specificStats.fetches;
+                        passes = _ftsMatcher.matchesNonTerm(loc.obj());
+                    }
+                    if (!passes) {
+                        candidate.score = -1;
+                        continue;
+                    }
+                }
+                candidate.score += termScore;
+                candidate.termsSeen |= 1ULL << i;
+            }
+
+            if (keysSinceCheck >= std::max(std::max(kMinKeysBetweenChecks, _params.limit),
+                                           _candidates.size() / 4)) {
+                keysSinceCheck = 0;
+                if (pickTopResults(bounds)) {
+                    break;
+                }
+            }
         }
-        return PlanStage::NEED_TIME;
+
+        if (_results.empty()) {
+            // Every scan ran out, so all the scores are complete.
+            pickTopResults(bounds);
+        }
+
+        // The scores of documents whose keys for some terms weren't reached are made whole
+        // from the documents themselves, which is how their keys were scored.
+        const unsigned long long allTerms = (numTerms == 64) ? ~0ULL : (1ULL << numTerms) - 1;
+        const vector<string>& terms = _params.query.getTerms();
+        for (size_t i = 0; i < _results.size(); ++i) {
+            if (!_params.query.hasNonTermPieces()) {
+                ++_specificStats.fetches;
+            }
+            const Candidate& candidate = _candidates[_results[i].loc];
+            if (candidate.termsSeen == allTerms) {
+                continue;
+            }
+            fts::TermFrequencyMap termFreqs;
+            _params.spec.scoreDocument(_results[i].loc.obj(), _params.spec.defaultLanguage(),
+                                       "", false, &termFreqs);
+            double score = 0;
+            for (size_t j = 0; j < terms.size(); ++j) {
+                fts::TermFrequencyMap::const_iterator it = termFreqs.find(terms[j]);
+                if (it != termFreqs.end()) {
+                    score += it->second;
+                }
+            }
+            _results[i].score = score;
+        }
+
+        _candidates.clear();
+        return PlanStage::IS_EOF;
+    }
+
+    bool TextStage::pickTopResults(const vector<double>& bounds) {
+        double unseenBound = 0;
+        for (size_t i = 0; i < bounds.size(); ++i) {
+            unseenBound += bounds[i];
+        }
+        const bool complete = (0 == unseenBound);
+
+        vector<ScoredLocation> scored;
+        scored.reserve(_candidates.size());
+        for (CandidateMap::const_iterator it = _candidates.begin(); it != _candidates.end(); ++it) {
+            if (it->second.score >= 0) {
+                scored.push_back(ScoredLocation(it->first, it->second.score));
+            }
+        }
+
+        if (scored.size() <= _params.limit) {
+            if (!complete) {
+                return false;
+            }
+            _results.swap(scored);
+            return true;
+        }
+
+        // ScoredLocation orders by descending score.
+        std::nth_element(scored.begin(), scored.begin() + (_params.limit - 1), scored.end());
+        const double lowestTopScore = scored[_params.limit - 1].score;
+
+        // A document not seen yet could still score up to the sum of the bounds...
+        if (unseenBound > lowestTopScore) {
+            return false;
+        }
+
+        // ...and one that was seen could still gain the bounds of the terms it wasn't seen with.
+        for (size_t i = _params.limit; i < scored.size(); ++i) {
+            const Candidate& candidate = _candidates[scored[i].loc];
+            double upperBound = candidate.score;
+            for (size_t j = 0; j < bounds.size(); ++j) {
+                if (!(candidate.termsSeen & (1ULL << j))) {
+                    upperBound += bounds[j];
+                }
+            }
+            if (upperBound > lowestTopScore) {
+                return false;
+            }
+        }
+
+        scored.resize(_params.limit);
+        _results.swap(scored);
+        return true;
     }
 
     class TextMatchableDocument : public MatchableDocument {
@@ -256,9 +449,7 @@ namespace mongo {
         bool* _fetched;
     };
 
-    void TextStage::filterAndScore(BSONObj key, DiskLoc loc) {
-        ++_specificStats.keysExamined;
-
+    double TextStage::keyScore(const BSONObj& key) const {
         // Locate score within possibly compound key: {prefix,term,score,suffix}.
         BSONObjIterator keyIt(key);
         for (unsigned i = 0; i < _params.spec.numExtraBefore(); i++) {
@@ -268,7 +459,31 @@ namespace mongo {
         keyIt.next(); // Skip past 'term'.
 
         BSONElement scoreElement = keyIt.next();
-        double documentTermScore = scoreElement.number();
+        return scoreElement.number();
+    }
+
+    bool TextStage::passesFilter(const BSONObj& key, const DiskLoc& loc) {
+        if (!_filter) {
+            return true;
+        }
+
+        bool fetched = false;
+        TextMatchableDocument tdoc(_params.index->keyPattern(), key, loc, &fetched);
+
+        if (!_filter->matches(&tdoc)) {
+            // We had to fetch but we're not going to return it.
+            if (fetched) {
+                ++_specificStats.fetches;
+            }
+            return false;
+        }
+        return true;
+    }
+
+    void TextStage::filterAndScore(BSONObj key, DiskLoc loc) {
+        ++_specificStats.keysExamined;
+
+        double documentTermScore = keyScore(key);
         double& documentAggregateScore = _scores[loc];
         
         // Handle filtering.
@@ -280,14 +495,7 @@ namespace mongo {
         if (documentAggregateScore == 0) {
             if (_filter) {
                 // We have not seen this document before and need to apply a filter.
-                bool fetched = false;
-                TextMatchableDocument tdoc(_params.index->keyPattern(), key, loc, &fetched);
-
-                if (!_filter->matches(&tdoc)) {
-                    // We had to fetch but we're not going to return it.
-                    if (fetched) {
-                        ++_specificStats.fetches;
-                    }
+                if (!passesFilter(key, loc)) {
                     documentAggregateScore = -1;
                     return;
                 }
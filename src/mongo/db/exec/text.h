@@ -52,8 +52,10 @@ namespace mongo {
     using fts::FTSSpec;
     using fts::MAX_WEIGHT;
 
+    class IndexScan;
+
     struct TextStageParams {
-        TextStageParams(const FTSSpec& s) : spec(s) {}
+        TextStageParams(const FTSSpec& s) : spec(s), limit(0) {}
 
         // Namespace.
         string ns;
@@ -69,6 +71,10 @@ namespace mongo {
 
         // The text query.
         FTSQuery query;
+
+        // If non-zero, only this many of the highest-scoring documents are wanted, and the
+        // stage may leave out the rest.
+        size_t limit;
     };
 
     /**
@@ -76,6 +82,11 @@ namespace mongo {
      *
      * Prerequisites: None; is a leaf node.
      * Output type: LOC_AND_OBJ_UNOWNED.
+     *
+     * Each term's keys are read in descending order of score.  Given a limit, the scans take
+     * turns and stop once no document, seen or not, can still overtake the best 'limit' ones:
+     * what a document has yet to gain from a term is at most the score of the last key read
+     * for it.
      */
     class TextStage : public PlanStage {
     public:
@@ -111,10 +122,41 @@ namespace mongo {
             }
         };
 
+        // A document seen by readTopResults().
+        struct Candidate {
+            Candidate() : score(0), termsSeen(0) {}
+
+            // Sum of the scores of the terms seen so far, or -1 if the document was rejected.
+            double score;
+
+            // Bit i is set once the document's key for term i was read.
+            unsigned long long termsSeen;
+        };
+
         // Helper for buffering results array.  Returns NEED_TIME (if any results were produced),
         // IS_EOF, or FAILURE.
         StageState fillOutResults();
 
+        // Scores every document that has any of the terms.  Returns IS_EOF or FAILURE.
+        StageState readAllResults(const std::vector<IndexScan*>& scanners);
+
+        // Finds the _params.limit highest-scoring documents.  Returns IS_EOF or FAILURE.
+        StageState readTopResults(const std::vector<IndexScan*>& scanners);
+
+        // Reads the next key of 'scanner'.  Returns ADVANCED, IS_EOF or FAILURE.
+        StageState readKey(IndexScan* scanner, BSONObj* keyOut, DiskLoc* locOut);
+
+        // Picks out of _candidates those whose score no other document can still beat, given
+        // that no document can gain more than 'bounds[i]' from term i.  Returns false, picking
+        // none, if there aren't _params.limit such documents yet.
+        bool pickTopResults(const std::vector<double>& bounds);
+
+        // The score of the term in a text index key.
+        double keyScore(const BSONObj& key) const;
+
+        // Whether the document of 'key' passes this stage's filter.
+        bool passesFilter(const BSONObj& key, const DiskLoc& loc);
+
         // Helper to update _scores with a new-found (term, score) pair for this document.  Also
         // rejects documents that don't match this stage's filter.
         void filterAndScore(BSONObj key, DiskLoc loc);
@@ -142,6 +184,10 @@ namespace mongo {
         typedef unordered_map<DiskLoc, double, DiskLoc::Hasher> ScoreMap;
         ScoreMap _scores;
 
+        // Map: diskloc -> what readTopResults() knows of the doc.
+        typedef unordered_map<DiskLoc, Candidate, DiskLoc::Hasher> CandidateMap;
+        CandidateMap _candidates;
+
         // Score-ordered result set of documents (as DiskLoc's).
         std::vector<ScoredLocation> _results;
 
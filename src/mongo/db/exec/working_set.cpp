@@ -35,11 +35,16 @@ namespace mongo {
     WorkingSet::MemberHolder::MemberHolder() : flagged(false), member(NULL) { }
     WorkingSet::MemberHolder::~MemberHolder() {}
 
-    WorkingSet::WorkingSet() : _freeList(INVALID_ID) { }
+    WorkingSet::WorkingSet() : _freeList(INVALID_ID), _spareMisses(0) { }
 
     WorkingSet::~WorkingSet() {
-        for (size_t i = 0; i < _data.size(); i++) {
-            delete _data[i].member;
+        for (size_t i = 0; i < _blocks.size(); i++) {
+            delete [] _blocks[i];
+        }
+        for (size_t i = 0; i < WSM_COMPUTED_NUM_TYPES; i++) {
+            for (size_t j = 0; j < _spareComputed[i].size(); j++) {
+                delete _spareComputed[i][j];
+            }
         }
     }
 
@@ -49,9 +54,12 @@ namespace mongo {
             // vector::resize being amortized O(1) for efficient allocation. Note that the free list
             // remains empty until something is returned by a call to free().
             WorkingSetID id = _data.size();
+            if (0 == id % MembersPerBlock) {
+                _blocks.push_back(new WorkingSetMember[MembersPerBlock]);
+            }
             _data.resize(_data.size() + 1);
             _data.back().nextFreeOrSelf = id;
-            _data.back().member = new WorkingSetMember();
+            _data.back().member = &_blocks.back()[id % MembersPerBlock];
             return id;
         }
 
@@ -67,12 +75,31 @@ namespace mongo {
         verify(i < _data.size()); // ID has been allocated.
         verify(holder.nextFreeOrSelf == i); // ID currently in use.
 
+        // Keep its computed data for the next member that needs the same kind.
+        for (size_t t = 0; t < WSM_COMPUTED_NUM_TYPES; t++) {
+            if (NULL != holder.member->_computed[t]) {
+                _spareComputed[t].push_back(holder.member->_computed[t]);
+                holder.member->_computed[t] = NULL;
+            }
+        }
+
         // Free resources and push this WSM to the head of the freelist.
         holder.member->clear();
         holder.nextFreeOrSelf = _freeList;
         _freeList = i;
     }
 
+    WorkingSetComputedData* WorkingSet::takeSpareComputed(WorkingSetComputedDataType type) {
+        vector<WorkingSetComputedData*>& spares = _spareComputed[type];
+        if (spares.empty()) {
+            ++_spareMisses;
+            return NULL;
+        }
+        WorkingSetComputedData* data = spares.back();
+        spares.pop_back();
+        return data;
+    }
+
     void WorkingSet::flagForReview(const WorkingSetID& i) {
         WorkingSetMember* member = get(i);
         verify(WorkingSetMember::OWNED_OBJ == member->state);
@@ -95,18 +122,31 @@ namespace mongo {
         return _data[id].flagged;
     }
 
-    WorkingSetMember::WorkingSetMember() : state(WorkingSetMember::INVALID) { }
+    WorkingSetMember::WorkingSetMember()
+        : state(WorkingSetMember::INVALID), _lastLookupObjData(NULL) {
+        for (size_t i = 0; i < WSM_COMPUTED_NUM_TYPES; i++) {
+            _computed[i] = NULL;
+        }
+    }
 
-    WorkingSetMember::~WorkingSetMember() { }
+    WorkingSetMember::~WorkingSetMember() {
+        for (size_t i = 0; i < WSM_COMPUTED_NUM_TYPES; i++) {
+            delete _computed[i];
+        }
+    }
 
     void WorkingSetMember::clear() {
         for (size_t i = 0; i < WSM_COMPUTED_NUM_TYPES; i++) {
-            _computed[i].reset();
+            delete _computed[i];
+            _computed[i] = NULL;
         }
 
         keyData.clear();
         obj = BSONObj();
         state = WorkingSetMember::INVALID;
+
+        _fieldIndex.clear();
+        _lastLookupObjData = NULL;
     }
 
     bool WorkingSetMember::hasLoc() const {
@@ -126,22 +166,36 @@ namespace mongo {
     }
 
     bool WorkingSetMember::hasComputed(const WorkingSetComputedDataType type) const {
-        return _computed[type];
+        return NULL != _computed[type];
     }
 
     const WorkingSetComputedData* WorkingSetMember::getComputed(const WorkingSetComputedDataType type) const {
         verify(_computed[type]);
-        return _computed[type].get();
+        return _computed[type];
     }
 
     void WorkingSetMember::addComputed(WorkingSetComputedData* data) {
         verify(!hasComputed(data->type()));
-        _computed[data->type()].reset(data);
+        _computed[data->type()] = data;
     }
 
     bool WorkingSetMember::getFieldDotted(const string& field, BSONElement* out) const {
         // If our state is such that we have an object, use it.
         if (hasObj()) {
+            if (_fieldIndex.isBuiltFor(obj)) {
+                *out = _fieldIndex.getFieldDotted(field);
+                return true;
+            }
+
+            // A second lookup into the same object suggests that more are coming, as when a
+            // merge sort compares it over and over, so hash its fields.
+            if (obj.objdata() == _lastLookupObjData) {
+                _fieldIndex.build(obj);
+                *out = _fieldIndex.getFieldDotted(field);
+                return true;
+            }
+
+            _lastLookupObjData = obj.objdata();
             *out = obj.getFieldDotted(field);
             return true;
         }
@@ -32,16 +32,39 @@
 #include <vector>
 
 #include "mongo/base/disallow_copying.h"
+#include "mongo/db/bson_field_index.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/platform/unordered_map.h"
 
 namespace mongo {
 
+    class WorkingSetComputedData;
     class WorkingSetMember;
 
     typedef size_t WorkingSetID;
 
+    /**
+     * What types of computed data can we have?
+     */
+    enum WorkingSetComputedDataType {
+        // What's the score of the document retrieved from a $text query?
+        WSM_COMPUTED_TEXT_SCORE = 0,
+
+        // What's the distance from a geoNear query point to the document?
+        WSM_COMPUTED_GEO_DISTANCE = 1,
+
+        // The index key used to retrieve the document, for $returnKey query option.
+        WSM_INDEX_KEY = 2,
+
+        // What point (of several possible points) was used to compute the distance to the document
+        // via geoNear?
+        WSM_GEO_NEAR_POINT = 3,
+
+        // Must be last.
+        WSM_COMPUTED_NUM_TYPES,
+    };
+
     /**
      * All data in use by a query.  Data is passed through the stage tree by referencing the ID of
      * an element of the working set.  Stages can add elements to the working set, delete elements
@@ -103,7 +126,24 @@ namespace mongo {
          */
         unordered_set<WorkingSetID> getFlagged() const;
 
+        /**
+         * Computed data of type 'type' that was attached to a member we've freed, for reuse by
+         * the caller, or NULL if there is none.  Use makeComputed(...) in
+         * working_set_computed_data.h rather than calling this directly.
+         */
+        WorkingSetComputedData* takeSpareComputed(WorkingSetComputedDataType type);
+
+        /**
+         * How many heap allocations of members and computed data we've caused: one per block of
+         * members, plus one per takeSpareComputed(...) that came up empty.
+         */
+        size_t allocations() const { return _blocks.size() + _spareMisses; }
+
     private:
+        // Members are carved out of blocks of this many so that most allocate()s don't go to the
+        // heap even before anything has been freed.
+        static const size_t MembersPerBlock = 64;
+
         struct MemberHolder {
             MemberHolder();
             ~MemberHolder();
@@ -111,7 +151,7 @@ namespace mongo {
             // Free list link if freed. Points to self if in use.
             WorkingSetID nextFreeOrSelf;
             bool flagged;
-            // Owning pointer
+            // Points into _blocks
             WorkingSetMember* member;
         };
 
@@ -123,6 +163,15 @@ namespace mongo {
         // link. INVALID_ID is the list terminator since 0 is a valid index.
         // If _freeList == INVALID_ID, the free list is empty and all elements in _data are in use.
         WorkingSetID _freeList;
+
+        // Owned arrays of MembersPerBlock members.  Member i is _blocks[i / MembersPerBlock][i %
+        // MembersPerBlock].
+        std::vector<WorkingSetMember*> _blocks;
+
+        // Owned computed data taken off members as they were freed, by type.  There are never
+        // more of a type than members, so this doesn't grow past the peak number of results.
+        std::vector<WorkingSetComputedData*> _spareComputed[WSM_COMPUTED_NUM_TYPES];
+        size_t _spareMisses;
     };
 
     /**
@@ -141,27 +190,6 @@ namespace mongo {
         BSONObj keyData;
     };
 
-    /**
-     * What types of computed data can we have?
-     */
-    enum WorkingSetComputedDataType {
-        // What's the score of the document retrieved from a $text query?
-        WSM_COMPUTED_TEXT_SCORE = 0,
-
-        // What's the distance from a geoNear query point to the document?
-        WSM_COMPUTED_GEO_DISTANCE = 1,
-
-        // The index key used to retrieve the document, for $returnKey query option.
-        WSM_INDEX_KEY = 2,
-
-        // What point (of several possible points) was used to compute the distance to the document
-        // via geoNear?
-        WSM_GEO_NEAR_POINT = 3,
-
-        // Must be last.
-        WSM_COMPUTED_NUM_TYPES,
-    };
-
     /**
      * Data that is a computed function of a WSM.
      */
@@ -244,11 +272,25 @@ namespace mongo {
          * object.  *out is set to the element if so.
          *
          * Returns false otherwise.  Returning false indicates a query planning error.
+         *
+         * Once asked for fields of the same object twice, hashes the object's fields so that
+         * later lookups don't scan it.
          */
         bool getFieldDotted(const string& field, BSONElement* out) const;
 
     private:
-        boost::scoped_ptr<WorkingSetComputedData> _computed[WSM_COMPUTED_NUM_TYPES];
+        // WorkingSet::free(...) takes our computed data for reuse.
+        friend class WorkingSet;
+
+        // Owned, NULL if we don't have that type.
+        WorkingSetComputedData* _computed[WSM_COMPUTED_NUM_TYPES];
+
+        // The fields of obj, hashed by getFieldDotted.  'obj' is public, so whether this is for
+        // the current obj is checked on every lookup.
+        mutable BSONFieldIndex _fieldIndex;
+
+        // The buffer of the obj the last unhashed getFieldDotted looked into.
+        mutable const char* _lastLookupObjData;
     };
 
 }  // namespace mongo
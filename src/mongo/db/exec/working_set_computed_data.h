@@ -34,12 +34,16 @@ namespace mongo {
 
     class TextScoreComputedData : public WorkingSetComputedData {
     public:
+        static const WorkingSetComputedDataType Type = WSM_COMPUTED_TEXT_SCORE;
+
         TextScoreComputedData(double score)
-            : WorkingSetComputedData(WSM_COMPUTED_TEXT_SCORE),
+            : WorkingSetComputedData(Type),
               _score(score) { }
 
         double getScore() const { return _score; }
 
+        void reset(double score) { _score = score; }
+
         virtual TextScoreComputedData* clone() const {
             return new TextScoreComputedData(_score);
         }
@@ -50,12 +54,16 @@ namespace mongo {
 
     class GeoDistanceComputedData : public WorkingSetComputedData {
     public:
+        static const WorkingSetComputedDataType Type = WSM_COMPUTED_GEO_DISTANCE;
+
         GeoDistanceComputedData(double dist)
-            : WorkingSetComputedData(WSM_COMPUTED_GEO_DISTANCE),
+            : WorkingSetComputedData(Type),
               _dist(dist) { }
 
         double getDist() const { return _dist; }
 
+        void reset(double dist) { _dist = dist; }
+
         virtual GeoDistanceComputedData* clone() const {
             return new GeoDistanceComputedData(_dist);
         }
@@ -66,12 +74,16 @@ namespace mongo {
 
     class IndexKeyComputedData : public WorkingSetComputedData {
     public:
+        static const WorkingSetComputedDataType Type = WSM_INDEX_KEY;
+
         IndexKeyComputedData(BSONObj key)
-            : WorkingSetComputedData(WSM_INDEX_KEY),
+            : WorkingSetComputedData(Type),
               _key(key.getOwned()) { }
 
         BSONObj getKey() const { return _key; }
 
+        void reset(BSONObj key) { _key = key.getOwned(); }
+
         virtual IndexKeyComputedData* clone() const {
             return new IndexKeyComputedData(_key);
         }
@@ -82,12 +94,16 @@ namespace mongo {
 
     class GeoNearPointComputedData : public WorkingSetComputedData {
     public:
+        static const WorkingSetComputedDataType Type = WSM_GEO_NEAR_POINT;
+
         GeoNearPointComputedData(BSONObj point)
-            : WorkingSetComputedData(WSM_GEO_NEAR_POINT),
+            : WorkingSetComputedData(Type),
               _point(point.getOwned()) { }
 
         BSONObj getPoint() const { return _point; }
 
+        void reset(BSONObj point) { _point = point.getOwned(); }
+
         virtual GeoNearPointComputedData* clone() const {
             return new GeoNearPointComputedData(_point);
         }
@@ -96,4 +112,19 @@ namespace mongo {
         BSONObj _point;
     };
 
+    /**
+     * Computed data of type T holding 'value' for a member of 'ws', reusing one that was attached
+     * to a member 'ws' has freed if there is one.  Caller owns the result until it's added to a
+     * member.
+     */
+    template <typename T, typename V>
+    T* makeComputed(WorkingSet* ws, const V& value) {
+        T* data = static_cast<T*>(ws->takeSpareComputed(T::Type));
+        if (NULL == data) {
+            return new T(value);
+        }
+        data->reset(value);
+        return data;
+    }
+
 }  // namespace mongo
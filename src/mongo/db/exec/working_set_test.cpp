@@ -33,6 +33,7 @@
 #include <boost/scoped_ptr.hpp>
 
 #include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_computed_data.h"
 #include "mongo/db/json.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/unittest/unittest.h"
@@ -108,6 +109,34 @@ namespace {
         ASSERT_EQUALS(elt.numberInt(), 5);
     }
 
+    TEST_F(WorkingSetFixture, getFieldsOfLargeObj) {
+        BSONObjBuilder bob;
+        for (int i = 0; i < 100; ++i) {
+            bob.append(string(mongoutils::str::stream() << "f" << i), i);
+        }
+        bob.append("sub", BSON("a" << 7));
+        member->obj = bob.obj();
+        member->state = WorkingSetMember::OWNED_OBJ;
+
+        // The second and later lookups go through a hash of the fields.
+        BSONElement elt;
+        for (int i = 99; i >= 0; i -= 9) {
+            ASSERT_TRUE(member->getFieldDotted(mongoutils::str::stream() << "f" << i, &elt));
+            ASSERT_EQUALS(elt.numberInt(), i);
+        }
+        ASSERT_TRUE(member->getFieldDotted("sub.a", &elt));
+        ASSERT_EQUALS(elt.numberInt(), 7);
+        ASSERT_TRUE(member->getFieldDotted("nope", &elt));
+        ASSERT_TRUE(elt.eoo());
+
+        // A new obj isn't looked up through the old one's hash.
+        member->obj = BSON("f5" << "new");
+        ASSERT_TRUE(member->getFieldDotted("f5", &elt));
+        ASSERT_EQUALS(elt.str(), "new");
+        ASSERT_TRUE(member->getFieldDotted("f6", &elt));
+        ASSERT_TRUE(elt.eoo());
+    }
+
     TEST_F(WorkingSetFixture, getFieldFromIndex) {
         string firstName = "x";
         int firstValue = 5;
@@ -147,4 +176,32 @@ namespace {
         ASSERT_FALSE(member->getFieldDotted("y", &elt));
     }
 
+    TEST_F(WorkingSetFixture, recycleComputed) {
+        // The fixture's member came out of the first block.
+        ASSERT_EQUALS(size_t(1), ws->allocations());
+
+        vector<WorkingSetID> ids;
+        for (int i = 0; i < 10; ++i) {
+            ids.push_back(ws->allocate());
+            ws->get(ids.back())->addComputed(
+                makeComputed<TextScoreComputedData>(ws.get(), double(i)));
+        }
+        ASSERT_EQUALS(size_t(11), ws->allocations());
+
+        for (size_t i = 0; i < ids.size(); ++i) {
+            ws->free(ids[i]);
+        }
+
+        // Freed members and their computed data all get used again.
+        for (int i = 0; i < 10; ++i) {
+            WorkingSetMember* m = ws->get(ws->allocate());
+            ASSERT_FALSE(m->hasComputed(WSM_COMPUTED_TEXT_SCORE));
+            m->addComputed(makeComputed<TextScoreComputedData>(ws.get(), 100.0 + i));
+            const TextScoreComputedData* score = static_cast<const TextScoreComputedData*>(
+                m->getComputed(WSM_COMPUTED_TEXT_SCORE));
+            ASSERT_EQUALS(100.0 + i, score->getScore());
+        }
+        ASSERT_EQUALS(size_t(11), ws->allocations());
+    }
+
 }  // namespace
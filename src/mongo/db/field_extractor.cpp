@@ -0,0 +1,173 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/field_extractor.h"
+
+#include <limits>
+
+#include "mongo/bson/bsonobjiterator.h"
+
+namespace mongo {
+
+    const size_t FieldExtractor::kNoSlot = std::numeric_limits<size_t>::max();
+
+    FieldExtractor::FieldExtractor() : _nodes(1), _numSlots(0), _emptyPathSlot(kNoSlot) {
+    }
+
+    size_t FieldExtractor::addPath(const FieldRef& path) {
+        if (path.empty()) {
+            if (kNoSlot == _emptyPathSlot) {
+                _emptyPathSlot = _numSlots++;
+            }
+            return _emptyPathSlot;
+        }
+
+        std::vector<size_t> nodesOnPath;
+        size_t nodeIdx = 0;
+        for (size_t part = 0; part < path.numParts(); ++part) {
+            StringData name = path.getPart(part);
+
+            size_t childIdx = kNoSlot;
+            const std::vector<size_t>& children = _nodes[nodeIdx].children;
+            for (size_t i = 0; i < children.size(); ++i) {
+                if (name == StringData(_nodes[children[i]].name)) {
+                    childIdx = children[i];
+                    break;
+                }
+            }
+
+            if (kNoSlot == childIdx) {
+                childIdx = _nodes.size();
+                _nodes.push_back(Node());
+                _nodes.back().name = name.toString();
+                _nodes.back().depth = part;
+                _nodes[nodeIdx].children.push_back(childIdx);
+            }
+
+            nodeIdx = childIdx;
+            nodesOnPath.push_back(nodeIdx);
+        }
+
+        Node& last = _nodes[nodeIdx];
+        if (kNoSlot != last.slot) {
+            return last.slot;
+        }
+
+        last.slot = _numSlots++;
+        for (size_t i = 0; i + 1 < nodesOnPath.size(); ++i) {
+            _nodes[nodesOnPath[i]].deeperSlots.push_back(last.slot);
+        }
+        return last.slot;
+    }
+
+    size_t FieldExtractor::addPath(const StringData& dottedPath) {
+        FieldRef path;
+        path.parse(dottedPath);
+        return addPath(path);
+    }
+
+    void FieldExtractor::extract(const BSONObj& doc, Slots* out) const {
+        // A slot not filled yet has an idxPath of kNoSlot.
+        Slot unresolved;
+        unresolved.idxPath = kNoSlot;
+        out->assign(_numSlots, unresolved);
+
+        if (kNoSlot != _emptyPathSlot) {
+            Slot& slot = (*out)[_emptyPathSlot];
+            slot.element = doc.getField("");
+            slot.idxPath = 0;
+        }
+
+        extractFrom(0, doc, out);
+    }
+
+    bool FieldExtractor::isResolved(const Node& node, const Slots& slots) const {
+        size_t slot = (kNoSlot != node.slot) ? node.slot : node.deeperSlots[0];
+        return kNoSlot != slots[slot].idxPath;
+    }
+
+    void FieldExtractor::extractFrom(size_t nodeIdx, const BSONObj& obj, Slots* out) const {
+        const std::vector<size_t>& children = _nodes[nodeIdx].children;
+
+        // Like getField, the first field with a given name is the one that counts.
+        size_t numUnresolved = children.size();
+        BSONObjIterator it(obj);
+        while (numUnresolved > 0 && it.more()) {
+            BSONElement e = it.next();
+            const char* fieldName = e.fieldName();
+            for (size_t i = 0; i < children.size(); ++i) {
+                const Node& child = _nodes[children[i]];
+                if (child.name != fieldName || isResolved(child, *out)) {
+                    continue;
+                }
+                resolve(children[i], e, out);
+                --numUnresolved;
+                break;
+            }
+        }
+
+        if (0 == numUnresolved) {
+            return;
+        }
+
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (!isResolved(_nodes[children[i]], *out)) {
+                resolve(children[i], BSONElement(), out);
+            }
+        }
+    }
+
+    void FieldExtractor::resolve(size_t nodeIdx, const BSONElement& e, Slots* out) const {
+        const Node& node = _nodes[nodeIdx];
+
+        if (kNoSlot != node.slot) {
+            Slot& slot = (*out)[node.slot];
+            slot.element = e;
+            slot.idxPath = (Object == e.type()) ? node.depth + 1 : node.depth;
+        }
+
+        if (node.deeperSlots.empty()) {
+            return;
+        }
+
+        if (Object == e.type()) {
+            extractFrom(nodeIdx, e.embeddedObject(), out);
+            return;
+        }
+
+        // An array stops the lookup of every deeper path here.  Anything else means they are
+        // missing.
+        BSONElement stop = (Array == e.type()) ? e : BSONElement();
+        for (size_t i = 0; i < node.deeperSlots.size(); ++i) {
+            Slot& slot = (*out)[node.deeperSlots[i]];
+            slot.element = stop;
+            slot.idxPath = node.depth;
+        }
+    }
+
+}  // namespace mongo
@@ -0,0 +1,132 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonelement.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/db/field_ref.h"
+
+namespace mongo {
+
+    /**
+     * A FieldExtractor looks up a fixed set of dotted paths in a document with a single walk
+     * over it, instead of scanning the document from the start once per path. Paths that share a
+     * prefix share the walk down to it, and each level stops as soon as every field it is looking
+     * for has been seen.
+     *
+     * Each path gets a slot, filled with what getFieldDottedOrArray would return for it: the
+     * element at the path, the first array on the way to it, or EOO if neither exists.
+     *
+     * Once the paths are added, extract() does not mutate the extractor, so one may be shared by
+     * concurrent callers.
+     */
+    class FieldExtractor {
+        MONGO_DISALLOW_COPYING(FieldExtractor);
+    public:
+        struct Slot {
+            Slot() : idxPath(0) { }
+
+            BSONElement element;
+
+            // The index of the path part 'element' is at, as getFieldDottedOrArray reports it.
+            // Only meaningful when 'element' is an array.
+            size_t idxPath;
+        };
+
+        typedef std::vector<Slot> Slots;
+
+        FieldExtractor();
+
+        /**
+         * Adds 'path' and returns its slot.  A path equal to one already added gets the same slot.
+         * The parts of 'path' are copied.
+         */
+        size_t addPath(const FieldRef& path);
+
+        size_t addPath(const StringData& dottedPath);
+
+        size_t numSlots() const { return _numSlots; }
+
+        /**
+         * Walks 'doc' once and fills '*out', resized to numSlots(), with every path's element.
+         * The elements point into 'doc'.
+         */
+        void extract(const BSONObj& doc, Slots* out) const;
+
+    private:
+        static const size_t kNoSlot;
+
+        // One field name along the paths.  Node 0 is the document itself.
+        struct Node {
+            Node() : depth(0), slot(kNoSlot) { }
+
+            std::string name;
+
+            // Which path part 'name' is.
+            size_t depth;
+
+            std::vector<size_t> children;
+
+            // The slot of the path ending here, if any.
+            size_t slot;
+
+            // The slots of the paths going deeper than here.
+            std::vector<size_t> deeperSlots;
+        };
+
+        /**
+         * Whether the walk has filled the slots of 'node' yet.
+         */
+        bool isResolved(const Node& node, const Slots& slots) const;
+
+        /**
+         * Fills the slots of the paths under 'nodeIdx' from the fields of 'obj'.
+         */
+        void extractFrom(size_t nodeIdx, const BSONObj& obj, Slots* out) const;
+
+        /**
+         * Fills the slots of the paths through node 'nodeIdx', whose field is 'e', or EOO if it
+         * is missing.
+         */
+        void resolve(size_t nodeIdx, const BSONElement& e, Slots* out) const;
+
+        std::vector<Node> _nodes;
+
+        size_t _numSlots;
+
+        // The slot of the empty path, which is looked up as the field "".
+        size_t _emptyPathSlot;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,127 @@
+/**
+ *    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/db/field_extractor.h"
+
+#include "mongo/db/field_ref.h"
+#include "mongo/db/json.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using mongo::BSONElement;
+    using mongo::BSONObj;
+    using mongo::FieldExtractor;
+    using mongo::FieldRef;
+    using mongo::fromjson;
+
+    /**
+     * Number of parts in the dotted path 'name'.
+     */
+    size_t numParts(const char* name) {
+        FieldRef path;
+        path.parse(name);
+        return path.numParts();
+    }
+
+    /**
+     * Checks that 'slot' holds what getFieldDottedOrArray finds for 'path' in 'doc'.
+     */
+    void assertSameAsLookup(const BSONObj& doc, const char* path,
+                            const FieldExtractor::Slot& slot) {
+        const char* rest = path;
+        BSONElement expected = doc.getFieldDottedOrArray(rest);
+
+        ASSERT_EQUALS(expected.eoo(), slot.element.eoo());
+        if (expected.eoo()) {
+            return;
+        }
+        ASSERT_EQUALS(expected.rawdata(), slot.element.rawdata());
+
+        if (mongo::Array == expected.type()) {
+            // The array is at the part just before what the lookup left over.
+            ASSERT_EQUALS(numParts(path) - numParts(rest) - 1, slot.idxPath);
+        }
+    }
+
+    TEST(FieldExtractor, MatchesLookupOneAtATime) {
+        const char* paths[] = { "a", "a.b", "a.c", "a.b.c", "b", "b.x", "c.0", "c.0.d",
+                                "d.e.f", "e", "_id", "z" };
+        const size_t numPaths = sizeof(paths) / sizeof(paths[0]);
+
+        const char* docs[] = {
+            "{}",
+            "{_id: 1, a: 1, b: 2}",
+            "{a: {b: 1, c: 2}, b: {x: 3}}",
+            "{a: {b: {c: 4}}, e: null}",
+            "{a: [{b: 1}, {b: 2}], b: 'str'}",
+            "{a: {b: [1, 2], c: {}}, c: [{d: 1}]}",
+            "{c: {'0': {d: 5}}, d: {e: {f: [1]}}}",
+            "{d: {e: 1}, a: {c: 1}, a: {b: 2}}",
+            "{z: {z: 1}, b: {y: 1}, a: 1, _id: {a: 1}}",
+        };
+        const size_t numDocs = sizeof(docs) / sizeof(docs[0]);
+
+        FieldExtractor extractor;
+        for (size_t i = 0; i < numPaths; ++i) {
+            ASSERT_EQUALS(i, extractor.addPath(paths[i]));
+        }
+        ASSERT_EQUALS(numPaths, extractor.numSlots());
+
+        for (size_t i = 0; i < numDocs; ++i) {
+            BSONObj doc = fromjson(docs[i]);
+            FieldExtractor::Slots slots;
+            extractor.extract(doc, &slots);
+            ASSERT_EQUALS(numPaths, slots.size());
+            for (size_t j = 0; j < numPaths; ++j) {
+                assertSameAsLookup(doc, paths[j], slots[j]);
+            }
+        }
+    }
+
+    TEST(FieldExtractor, SamePathSharesSlot) {
+        FieldExtractor extractor;
+        ASSERT_EQUALS(0U, extractor.addPath("a.b"));
+        ASSERT_EQUALS(1U, extractor.addPath("a"));
+        FieldRef aDotB;
+        aDotB.parse("a.b");
+        ASSERT_EQUALS(0U, extractor.addPath(aDotB));
+        ASSERT_EQUALS(2U, extractor.numSlots());
+    }
+
+    TEST(FieldExtractor, FirstOfDuplicateFields) {
+        FieldExtractor extractor;
+        extractor.addPath("a");
+        extractor.addPath("a.b");
+
+        BSONObj doc = fromjson("{a: {b: 1}, a: {b: 2}}");
+        FieldExtractor::Slots slots;
+        extractor.extract(doc, &slots);
+        ASSERT_EQUALS(1, slots[1].element.numberInt());
+        ASSERT_EQUALS(doc.firstElement().rawdata(), slots[0].element.rawdata());
+    }
+
+    TEST(FieldExtractor, EmptyPath) {
+        FieldExtractor extractor;
+        extractor.addPath("");
+
+        BSONObj doc = fromjson("{a: 1, '': 2}");
+        FieldExtractor::Slots slots;
+        extractor.extract(doc, &slots);
+        ASSERT_EQUALS(2, slots[0].element.numberInt());
+    }
+
+} // namespace
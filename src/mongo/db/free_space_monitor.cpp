@@ -0,0 +1,192 @@
+// free_space_monitor.cpp
+
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+#include "mongo/pch.h"
+
+#include "mongo/db/free_space_monitor.h"
+
+#include "mongo/base/counter.h"
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/fsync.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/database.h"
+#include "mongo/db/database_holder.h"
+#include "mongo/db/dur.h"
+#include "mongo/db/namespace_details.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/extent.h"
+#include "mongo/db/structure/collection.h"
+#include "mongo/util/background.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    Counter64 freeSpaceMonitorPasses;
+    Counter64 freeSpaceMonitorRecordsMerged;
+    Counter64 freeSpaceMonitorBytesMerged;
+    Counter64 freeSpaceMonitorExtentsFreed;
+
+    ServerStatusMetricField<Counter64> freeSpaceMonitorPassesDisplay(
+            "freeSpaceMonitor.passes", &freeSpaceMonitorPasses );
+    ServerStatusMetricField<Counter64> freeSpaceMonitorRecordsMergedDisplay(
+            "freeSpaceMonitor.recordsMerged", &freeSpaceMonitorRecordsMerged );
+    ServerStatusMetricField<Counter64> freeSpaceMonitorBytesMergedDisplay(
+            "freeSpaceMonitor.bytesMerged", &freeSpaceMonitorBytesMerged );
+    ServerStatusMetricField<Counter64> freeSpaceMonitorExtentsFreedDisplay(
+            "freeSpaceMonitor.extentsFreed", &freeSpaceMonitorExtentsFreed );
+
+    MONGO_EXPORT_SERVER_PARAMETER( freeSpaceMonitorEnabled, bool, false );
+
+    // longest we hold a database write lock in one go
+    MONGO_EXPORT_SERVER_PARAMETER( freeSpaceMonitorBudgetMillis, int, 10 );
+
+    // pause between passes over all databases
+    MONGO_EXPORT_SERVER_PARAMETER( freeSpaceMonitorSleepSecs, int, 60 );
+
+    class FreeSpaceMonitor : public BackgroundJob {
+    public:
+        FreeSpaceMonitor(){}
+        virtual ~FreeSpaceMonitor(){}
+
+        virtual string name() const { return "FreeSpaceMonitor"; }
+
+        virtual void run() {
+            Client::initThread( name().c_str() );
+            cc().getAuthorizationSession()->grantInternalAuthorization();
+
+            while ( ! inShutdown() ) {
+                sleepsecs( std::max( 1, static_cast<int>( freeSpaceMonitorSleepSecs ) ) );
+
+                LOG(3) << "FreeSpaceMonitor thread awake" << endl;
+
+                if ( !freeSpaceMonitorEnabled ) {
+                    LOG(3) << "FreeSpaceMonitor is disabled" << endl;
+                    continue;
+                }
+
+                if ( lockedForWriting() ) {
+                    LOG(3) << " locked for writing" << endl;
+                    continue;
+                }
+
+                set<string> dbs;
+                {
+                    Lock::DBRead lk( "local" );
+                    dbHolder().getAllShortNames( dbs );
+                }
+
+                freeSpaceMonitorPasses.increment();
+
+                for ( set<string>::const_iterator i=dbs.begin(); i!=dbs.end(); ++i ) {
+                    try {
+                        doDB( *i );
+                    }
+                    catch ( DBException& e ) {
+                        error() << "error reclaiming free space for db: " << *i << " " << e
+                                << endl;
+                    }
+                }
+            }
+        }
+
+    private:
+        void doDB( const string& dbName ) {
+            list<string> collections;
+            {
+                Lock::DBRead lk( dbName );
+                Database* db = dbHolder().get( dbName, storageGlobalParams.dbpath );
+                if ( !db )
+                    return;
+                db->namespaceIndex().getNamespaces( collections, /* onlyCollections */ true );
+            }
+
+            for ( list<string>::const_iterator i = collections.begin();
+                  i != collections.end() && !inShutdown();
+                  ++i ) {
+                NamespaceString ns( *i );
+                if ( ns.isSystem() )
+                    continue;
+                doCollection( *i );
+            }
+        }
+
+        void doCollection( const string& ns ) {
+            // extents are visited by position, the list may change whenever we let go of the lock
+            int position = 0;
+
+            while ( !inShutdown() && freeSpaceMonitorEnabled && !lockedForWriting() ) {
+                {
+                    Lock::DBWrite lk( ns );
+                    Database* db = dbHolder().get( ns, storageGlobalParams.dbpath );
+                    if ( !db )
+                        return;
+                    Client::Context ctx( ns, db );
+
+                    Collection* collection = db->getCollection( ns );
+                    if ( !collection || collection->isCapped() )
+                        return;
+
+                    DiskLoc extLoc = collection->details()->firstExtent();
+                    for ( int i = 0; i < position && !extLoc.isNull(); i++ )
+                        extLoc = extLoc.ext()->xnext;
+
+                    Timer t;
+                    while ( !extLoc.isNull() && t.millis() < freeSpaceMonitorBudgetMillis ) {
+                        const DiskLoc next = extLoc.ext()->xnext;
+
+                        RecordStore::CoalesceStats stats;
+                        collection->getRecordStore()->coalesceExtent( extLoc, &stats );
+                        freeSpaceMonitorRecordsMerged.increment( stats.recordsMerged );
+                        freeSpaceMonitorBytesMerged.increment( stats.bytesMerged );
+                        freeSpaceMonitorExtentsFreed.increment( stats.extentsFreed );
+
+                        if ( stats.extentsFreed == 0 )
+                            position++;
+                        extLoc = next;
+
+                        getDur().commitIfNeeded();
+                    }
+
+                    if ( extLoc.isNull() )
+                        return;
+                }
+
+                // give anyone waiting on the lock a turn
+                sleepmillis( 1 );
+            }
+        }
+    };
+
+    void startFreeSpaceMonitor() {
+        FreeSpaceMonitor* monitor = new FreeSpaceMonitor();
+        monitor->go();
+    }
+}
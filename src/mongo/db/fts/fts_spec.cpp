@@ -152,8 +152,9 @@ namespace mongo {
                                      bool isArray,
                                      TermFrequencyMap* term_freqs ) const {
             const FTSLanguage language = getLanguageToUse( obj, parentLanguage );
-            Stemmer stemmer( language );
-            Tools tools( language, &stemmer, StopWords::getStopWords( language ) );
+            Tools tools( language,
+                         StemCache::get( language ),
+                         StopWords::getStopWords( language ) );
 
             // Perform a depth-first traversal of obj, skipping fields not touched by this spec.
             BSONObjIterator j( obj );
@@ -252,19 +253,24 @@ namespace mongo {
 
             unsigned numTokens = 0;
 
+            // Reused from token to token, so that only a term not seen before allocates.
+            string word;
+            string stem;
+
             Tokenizer i( tools.language, raw );
             while ( i.more() ) {
                 Token t = i.next();
                 if ( t.type != Token::TEXT )
                     continue;
 
-                string term = t.data.toString();
-                makeLower( &term );
-                if ( tools.stopwords->isStopWord( term ) )
+                word.assign( t.data.rawData(), t.data.size() );
+                makeLower( &word );
+                if ( tools.stopwords->isStopWord( word ) )
                     continue;
-                term = tools.stemmer->stem( term );
+                const StringData stemmed = tools.stemmer->stem( word );
+                stem.assign( stemmed.rawData(), stemmed.size() );
 
-                ScoreHelperStruct& data = terms[term];
+                ScoreHelperStruct& data = terms[stem];
 
                 if ( data.exp )
                     data.exp *= 2;
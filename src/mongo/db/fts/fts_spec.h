@@ -56,14 +56,14 @@ namespace mongo {
 
             struct Tools {
                 Tools( const FTSLanguage _language,
-                       const Stemmer* _stemmer,
+                       StemCache* _stemmer,
                        const StopWords* _stopwords )
                     : language( _language )
                     , stemmer( _stemmer )
                     , stopwords( _stopwords ) {}
 
                 const FTSLanguage language;
-                const Stemmer* stemmer;
+                StemCache* stemmer;
                 const StopWords* stopwords;
             };
 
@@ -29,14 +29,40 @@
 */
 
 #include <cstdlib>
+#include <map>
 #include <string>
 
+#include <boost/thread/tss.hpp>
+
 #include "mongo/db/fts/stemmer.h"
 
 namespace mongo {
 
     namespace fts {
 
+        namespace {
+
+            // A cache past this many words is emptied; the frequent ones come back soon enough.
+            const size_t kMaxCachedStems = 10000;
+
+            /**
+             * A thread's StemCaches, by language name.
+             */
+            class ThreadStemCaches {
+            public:
+                ~ThreadStemCaches() {
+                    for ( Map::iterator i = caches.begin(); i != caches.end(); ++i )
+                        delete i->second;
+                }
+
+                typedef std::map<std::string, StemCache*> Map;
+                Map caches;
+            };
+
+            boost::thread_specific_ptr<ThreadStemCaches> threadStemCaches;
+
+        }
+
         Stemmer::Stemmer( const FTSLanguage language ) {
             _stemmer = NULL;
             if ( language.str() != "none" )
@@ -51,8 +77,12 @@ namespace mongo {
         }
 
         string Stemmer::stem( const StringData& word ) const {
+            return stemNoCopy( word ).toString();
+        }
+
+        StringData Stemmer::stemNoCopy( const StringData& word ) const {
             if ( !_stemmer )
-                return word.toString();
+                return word;
 
             const sb_symbol* sb_sym = sb_stemmer_stem( _stemmer,
                                                        (const sb_symbol*)word.rawData(),
@@ -63,7 +93,40 @@ namespace mongo {
                 abort();
             }
 
-            return string( (const char*)(sb_sym), sb_stemmer_length( _stemmer ) );
+            return StringData( (const char*)(sb_sym), sb_stemmer_length( _stemmer ) );
+        }
+
+        StemCache::StemCache( const FTSLanguage language )
+            : _stemmer( language ) {
+        }
+
+        StemCache::~StemCache() {
+        }
+
+        StemCache* StemCache::get( const FTSLanguage language ) {
+            ThreadStemCaches* mine = threadStemCaches.get();
+            if ( !mine ) {
+                mine = new ThreadStemCaches();
+                threadStemCaches.reset( mine );
+            }
+
+            StemCache*& cache = mine->caches[language.str()];
+            if ( !cache )
+                cache = new StemCache( language );
+            return cache;
+        }
+
+        StringData StemCache::stem( const StringData& word ) {
+            _word.assign( word.rawData(), word.size() );
+            StemMap::const_iterator i = _stems.find( _word );
+            if ( i != _stems.end() )
+                return i->second;
+
+            if ( _stems.size() >= kMaxCachedStems )
+                _stems.clear();
+
+            const StringData stemmed = _stemmer.stemNoCopy( word );
+            return _stems.insert( make_pair( _word, stemmed.toString() ) ).first->second;
         }
 
     }
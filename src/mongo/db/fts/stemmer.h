@@ -35,6 +35,7 @@
 
 #include "mongo/base/string_data.h"
 #include "mongo/db/fts/fts_language.h"
+#include "mongo/platform/unordered_map.h"
 #include "third_party/libstemmer_c/include/libstemmer.h"
 
 namespace mongo {
@@ -52,9 +53,48 @@ namespace mongo {
             ~Stemmer();
 
             std::string stem( const StringData& word ) const;
+
+            /**
+             * Like stem(), without a copy: the data is good until the next use of this stemmer.
+             */
+            StringData stemNoCopy( const StringData& word ) const;
         private:
             struct sb_stemmer* _stemmer;
         };
+
+        /**
+         * A thread's stemmer for a language, and the stems of the words it was asked about
+         * lately.  Text repeats the same few words, so looking up a stem is the common case,
+         * and it copies nothing.
+         */
+        class StemCache {
+        public:
+            /**
+             * The calling thread's cache for 'language', made on first use.  It lasts as long
+             * as the thread.
+             */
+            static StemCache* get( const FTSLanguage language );
+
+            ~StemCache();
+
+            /**
+             * Returns the stem of 'word'.  The data is good until the next call.
+             */
+            StringData stem( const StringData& word );
+
+            size_t size() const { return _stems.size(); }
+
+        private:
+            StemCache( const FTSLanguage language );
+
+            Stemmer _stemmer;
+
+            // 'word' is copied here to look it up, keeping its capacity from one word to the next.
+            std::string _word;
+
+            typedef unordered_map<std::string, std::string> StemMap;
+            StemMap _stems;
+        };
     }
 }
 
@@ -42,5 +42,22 @@ namespace mongo {
             ASSERT_EQUALS( "Run", s.stem( "Running" ) );
         }
 
+        TEST( English, StemCache ) {
+            const FTSLanguage english = FTSLanguage::makeFTSLanguage( "english" ).getValue();
+            StemCache* cache = StemCache::get( english );
+            ASSERT_EQUALS( "run", cache->stem( "running" ) );
+            size_t size = cache->size();
+            ASSERT_EQUALS( "run", cache->stem( "running" ) );
+            ASSERT_EQUALS( size, cache->size() );
+            ASSERT_EQUALS( "walk", cache->stem( "walking" ) );
+            ASSERT_EQUALS( "run", cache->stem( "running" ) );
+
+            // The same cache each time for a language, and another for another language
+            ASSERT( cache == StemCache::get( english ) );
+            StemCache* none = StemCache::get( FTSLanguage::makeFTSLanguage( "none" ).getValue() );
+            ASSERT( cache != none );
+            ASSERT_EQUALS( "running", none->stem( "running" ) );
+        }
+
     }
 }
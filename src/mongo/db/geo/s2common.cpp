@@ -43,17 +43,8 @@ namespace mongo {
         return ss.str();
     }
 
-    static void keysFromRegion(S2RegionCoverer *coverer, const S2Region &region,
-                               vector<string> *out) {
-        vector<S2CellId> covering;
-        coverer->GetCovering(region, &covering);
-        for (size_t i = 0; i < covering.size(); ++i) {
-            out->push_back(covering[i].toString());
-        }
-    }
-
     bool S2SearchUtil::getKeysForObject(const BSONObj& obj, const S2IndexingParams& params,
-                                        vector<string>* out) {
+                                        vector<S2CellId>* out) {
         S2RegionCoverer coverer;
         params.configureCoverer(&coverer);
 
@@ -61,11 +52,23 @@ namespace mongo {
         if (!geoContainer.parseFrom(obj)) { return false; }
         if (!geoContainer.hasS2Region()) { return false; }
 
-        keysFromRegion(&coverer, geoContainer.getRegion(), out);
+        coverer.GetCovering(geoContainer.getRegion(), out);
 
         return true;
     }
 
+    int S2SearchUtil::indexVersion(const BSONObj& indexInfo) {
+        BSONElement e = indexInfo["2dsphereIndexVersion"];
+        if (e.isNumber()) { return e.numberInt(); }
+        return S2_INDEX_VERSION_1;
+    }
+
+    int S2SearchUtil::coarsestIndexedLevel(const BSONObj& indexInfo) {
+        BSONElement e = indexInfo["coarsestIndexedLevel"];
+        if (e.isNumber()) { return e.numberInt(); }
+        return S2::kAvgEdge.GetClosestLevel(100 * 1000.0 / kRadiusOfEarthInMeters);
+    }
+
     double dist(const S2Point& a, const S2Point& b) {
         S1Angle angle(a, b);
         return angle.radians();
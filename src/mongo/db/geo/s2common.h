@@ -39,6 +39,14 @@
 
 namespace mongo {
 
+    // How a 2dsphere index keys its cells, set by the "2dsphereIndexVersion" of the index spec.
+    enum S2IndexVersion {
+        // Cells are strings of their face and quadrants, such as "1021", compared byte by byte.
+        S2_INDEX_VERSION_1 = 1,
+        // Cells are their 64-bit ids as NumberLongs, half the size and compared as one number.
+        S2_INDEX_VERSION_2 = 2
+    };
+
     struct S2IndexingParams {
         // Since we take the cartesian product when we generate keys for an insert,
         // we need a cap.
@@ -55,12 +63,15 @@ namespace mongo {
 
         double radius;
 
+        S2IndexVersion indexVersion;
+
         string toString() const {
             stringstream ss;
             ss << "maxKeysPerInsert: " << maxKeysPerInsert << endl;
             ss << "maxCellsInCovering: " << maxCellsInCovering << endl;
             ss << "finestIndexedLevel: " << finestIndexedLevel << endl;
             ss << "coarsestIndexedLevel: " << coarsestIndexedLevel << endl;
+            ss << "indexVersion: " << indexVersion << endl;
             return ss.str();
         }
 
@@ -80,7 +91,19 @@ namespace mongo {
                                    const int coarsestIndexedLevel);
         static void setCoverLimitsBasedOnArea(double area, S2RegionCoverer *coverer, int coarsestIndexedLevel);
         static bool getKeysForObject(const BSONObj& obj, const S2IndexingParams& params,
-                                     vector<string>* out);
+                                     vector<S2CellId>* out);
+
+        // The key of 'id' in an index of S2_INDEX_VERSION_2.  Cell ids are unsigned, so the top
+        // bit is flipped for the keys to sort as the cells do.
+        static long long cellIdToKey(const S2CellId& id) {
+            return static_cast<long long>(id.id() ^ (1ULL << 63));
+        }
+
+        // The 2dsphereIndexVersion of the index described by 'indexInfo', 1 if it has none.
+        static int indexVersion(const BSONObj& indexInfo);
+
+        // The coarsestIndexedLevel of the index described by 'indexInfo', or the default.
+        static int coarsestIndexedLevel(const BSONObj& indexInfo);
         static bool distanceBetween(const S2Point& us, const BSONObj& them, double *out);
     };
 
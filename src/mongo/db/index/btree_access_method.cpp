@@ -28,11 +28,13 @@
 
 #include "mongo/db/index/btree_access_method.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "mongo/base/status.h"
 #include "mongo/db/index/btree_index_cursor.h"
 #include "mongo/db/index/btree_interface.h"
+#include "mongo/db/index/index_delta_log.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/keypattern.h"
 #include "mongo/db/pdfile.h"
@@ -54,15 +56,28 @@ namespace mongo {
         *numInserted = 0;
 
         BSONObjSet keys;
+        unsigned multikeyFields;
         // Delegate to the subclass.
-        getKeys(obj, &keys);
+        getKeysAndMultikeyFields(obj, &keys, &multikeyFields);
+
+        if (IndexDeltaLog* log = deltaLog()) {
+            for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+                log->noteInsert(*i, loc);
+            }
+            *numInserted = keys.size();
+            if (multikeyFields) {
+                _descriptor->setMultikey(multikeyFields);
+            }
+            return Status::OK();
+        }
 
         Status ret = Status::OK();
 
         for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
             try {
-                _interface->bt_insert(_descriptor->getHead(), loc, *i, _ordering,
-                                      options.dupsAllowed, _descriptor->getOnDisk(), true);
+                _interface->bt_insertAppend(_descriptor->getHead(), &_rightEdge, loc, *i,
+                                            _ordering, options.dupsAllowed,
+                                            _descriptor->getOnDisk());
                 ++*numInserted;
             } catch (AssertionException& e) {
                 if (10287 == e.getCode() && _descriptor->isBackgroundIndex()) {
@@ -85,13 +100,27 @@ namespace mongo {
             }
         }
 
-        if (*numInserted > 1) {
-            _descriptor->setMultikey();
+        if (*numInserted > 0 && multikeyFields) {
+            _descriptor->setMultikey(multikeyFields);
         }
 
         return ret;
     }
 
+    void BtreeBasedAccessMethod::getKeysAndMultikeyFields(const BSONObj& obj, BSONObjSet* keys,
+                                                          unsigned* multikeyFields) {
+        getKeys(obj, keys);
+        *multikeyFields = keys->size() > 1 ? ~0u : 0;
+    }
+
+    IndexDeltaLog* BtreeBasedAccessMethod::deltaLog() const {
+        // only an index still being built can have one
+        if (!_descriptor->isBackgroundIndex()) {
+            return NULL;
+        }
+        return IndexDeltaLog::get(_descriptor->indexNamespace());
+    }
+
     bool BtreeBasedAccessMethod::removeOneKey(const BSONObj& key, const DiskLoc& loc) {
         bool ret = false;
 
@@ -118,6 +147,14 @@ namespace mongo {
         getKeys(obj, &keys);
         *numDeleted = 0;
 
+        if (IndexDeltaLog* log = deltaLog()) {
+            for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+                log->noteRemove(*i, loc);
+            }
+            *numDeleted = keys.size();
+            return Status::OK();
+        }
+
         for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
             bool thisKeyOK = removeOneKey(*i, loc);
 
@@ -132,6 +169,105 @@ namespace mongo {
         return Status::OK();
     }
 
+    namespace {
+        // Orders keys as the btree does: by key, then by the location they point to.
+        class KeyLocLess {
+        public:
+            KeyLocLess(const Ordering& ordering) : _ordering(ordering) { }
+
+            bool operator()(const pair<BSONObj, DiskLoc>& l,
+                            const pair<BSONObj, DiskLoc>& r) const {
+                int cmp = l.first.woCompare(r.first, _ordering, false);
+                return cmp < 0 || (0 == cmp && l.second < r.second);
+            }
+
+        private:
+            const Ordering& _ordering;
+        };
+    }
+
+    // Remove the keys of all the docs, in index order, so that neighbouring keys are removed
+    // from the same buckets one after the other rather than once per document.
+    Status BtreeBasedAccessMethod::removeBulk(const vector<pair<BSONObj, DiskLoc> >& docs,
+        const InsertDeleteOptions& options, int64_t* numDeleted) {
+
+        if (NULL != deltaLog()) {
+            return IndexAccessMethod::removeBulk(docs, options, numDeleted);
+        }
+
+        vector<pair<BSONObj, DiskLoc> > keys;
+        for (size_t i = 0; i < docs.size(); ++i) {
+            BSONObjSet docKeys;
+            getKeys(docs[i].first, &docKeys);
+            for (BSONObjSet::const_iterator j = docKeys.begin(); j != docKeys.end(); ++j) {
+                keys.push_back(make_pair(*j, docs[i].second));
+            }
+        }
+        std::sort(keys.begin(), keys.end(), KeyLocLess(_ordering));
+
+        int64_t removed = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (removeOneKey(keys[i].first, keys[i].second)) {
+                ++removed;
+            } else if (options.logIfError) {
+                log() << "unindex failed (key too big?) " << _descriptor->indexNamespace()
+                      << " key: " << keys[i].first << " " << keys[i].second.obj()["_id"] << endl;
+            }
+        }
+
+        if (NULL != numDeleted) { *numDeleted = removed; }
+        return Status::OK();
+    }
+
+    bool BtreeBasedAccessMethod::getKeysForBulkInsert(const BSONObj& obj, const DiskLoc& loc,
+        const InsertDeleteOptions& options, vector<pair<BSONObj, DiskLoc> >* keys) {
+
+        // Unique keys have to be checked as each document goes in, and the keys of an index
+        // being built in the background go to its delta log.
+        if (!options.dupsAllowed || NULL != deltaLog()) {
+            return false;
+        }
+
+        BSONObjSet docKeys;
+        unsigned multikeyFields;
+        getKeysAndMultikeyFields(obj, &docKeys, &multikeyFields);
+        for (BSONObjSet::const_iterator i = docKeys.begin(); i != docKeys.end(); ++i) {
+            keys->push_back(make_pair(*i, loc));
+        }
+        if (multikeyFields) {
+            _descriptor->setMultikey(multikeyFields);
+        }
+        return true;
+    }
+
+    // Insert in index order, each key starting from the bucket the previous one went into, so
+    // that a run of increasing keys fills a bucket without descending from the root each time.
+    Status BtreeBasedAccessMethod::insertKeysSorted(vector<pair<BSONObj, DiskLoc> >* keys,
+                                                    set<DiskLoc>* failed) {
+        std::sort(keys->begin(), keys->end(), KeyLocLess(_ordering));
+
+        Status ret = Status::OK();
+        DiskLoc hint;
+        for (size_t i = 0; i < keys->size(); ++i) {
+            const pair<BSONObj, DiskLoc>& key = (*keys)[i];
+            try {
+                _interface->bt_insertHinted(_descriptor->getHead(), &hint, key.second, key.first,
+                                            _ordering, _descriptor->getOnDisk());
+            } catch (AssertionException& e) {
+                problem() << " caught assertion insertKeysSorted "
+                          << _descriptor->indexNamespace()
+                          << key.second.obj()["_id"] << endl;
+                failed->insert(key.second);
+                if (ret.isOK()) {
+                    ret = Status(ErrorCodes::InternalError, e.what(), e.getCode());
+                }
+                hint = DiskLoc();
+            }
+        }
+
+        return ret;
+    }
+
     // Return keys in l that are not in r.
     // Lifted basically verbatim from elsewhere.
     static void setDifference(const BSONObjSet &l, const BSONObjSet &r, vector<BSONObj*> *diff) {
@@ -180,7 +316,7 @@ namespace mongo {
         status->_indexSpecificUpdateData.reset(data);
 
         getKeys(from, &data->oldKeys);
-        getKeys(to, &data->newKeys);
+        getKeysAndMultikeyFields(to, &data->newKeys, &data->newMultikeyFields);
         data->loc = record;
         data->dupsAllowed = options.dupsAllowed;
 
@@ -217,8 +353,19 @@ namespace mongo {
         BtreeBasedPrivateUpdateData* data =
             static_cast<BtreeBasedPrivateUpdateData*>(ticket._indexSpecificUpdateData.get());
 
-        if (data->oldKeys.size() + data->added.size() - data->removed.size() > 1) {
-            _descriptor->setMultikey();
+        if (data->newMultikeyFields) {
+            _descriptor->setMultikey(data->newMultikeyFields);
+        }
+
+        if (IndexDeltaLog* log = deltaLog()) {
+            for (size_t i = 0; i < data->added.size(); ++i) {
+                log->noteInsert(*data->added[i], data->loc);
+            }
+            for (size_t i = 0; i < data->removed.size(); ++i) {
+                log->noteRemove(*data->removed[i], data->loc);
+            }
+            *numUpdated = data->added.size();
+            return Status::OK();
         }
 
         for (size_t i = 0; i < data->added.size(); ++i) {
@@ -266,6 +413,11 @@ namespace mongo {
         _keyGenerator->getKeys(obj, keys);
     }
 
+    void BtreeAccessMethod::getKeysAndMultikeyFields(const BSONObj& obj, BSONObjSet* keys,
+                                                     unsigned* multikeyFields) {
+        _keyGenerator->getKeys(obj, keys, multikeyFields);
+    }
+
     Status BtreeAccessMethod::newCursor(IndexCursor** out) {
         *out = new BtreeIndexCursor(_descriptor, _ordering, _interface);
         return Status::OK();
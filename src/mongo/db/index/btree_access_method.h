@@ -62,6 +62,8 @@ namespace mongo {
 
     private:
         virtual void getKeys(const BSONObj& obj, BSONObjSet* keys);
+        virtual void getKeysAndMultikeyFields(const BSONObj& obj, BSONObjSet* keys,
+                                              unsigned* multikeyFields);
 
         // Our keys differ for V0 and V1.
         scoped_ptr<BtreeKeyGenerator> _keyGenerator;
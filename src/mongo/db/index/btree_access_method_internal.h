@@ -39,6 +39,8 @@
 
 namespace mongo {
 
+    class IndexDeltaLog;
+
     /**
      * Any access method that is Btree based subclasses from this.
      *
@@ -62,6 +64,18 @@ namespace mongo {
                               const InsertDeleteOptions& options,
                               int64_t* numDeleted);
 
+        virtual Status removeBulk(const vector<pair<BSONObj, DiskLoc> >& docs,
+                                  const InsertDeleteOptions& options,
+                                  int64_t* numDeleted);
+
+        virtual bool getKeysForBulkInsert(const BSONObj& obj,
+                                          const DiskLoc& loc,
+                                          const InsertDeleteOptions& options,
+                                          vector<pair<BSONObj, DiskLoc> >* keys);
+
+        virtual Status insertKeysSorted(vector<pair<BSONObj, DiskLoc> >* keys,
+                                        set<DiskLoc>* failed);
+
         virtual Status validateUpdate(const BSONObj& from,
                                       const BSONObj& to,
                                       const DiskLoc& loc,
@@ -85,6 +99,15 @@ namespace mongo {
 
         virtual void getKeys(const BSONObj &obj, BSONObjSet *keys) = 0;
 
+        /**
+         * getKeys(), also setting '*multikeyFields' to the index fields that make 'obj' multikey,
+         * bit j for field j (fields past the 32nd all share the top bit).  Here that is all of
+         * them once there is more than one key; btree key generation knows which paths go
+         * through an array, even to a single key.
+         */
+        virtual void getKeysAndMultikeyFields(const BSONObj& obj, BSONObjSet* keys,
+                                              unsigned* multikeyFields);
+
         IndexDescriptor* _descriptor;
         Ordering _ordering;
 
@@ -93,6 +116,12 @@ namespace mongo {
 
     private:
         bool removeOneKey(const BSONObj& key, const DiskLoc& loc);
+
+        /** where writes to an index being bulk loaded in the background go, NULL otherwise */
+        IndexDeltaLog* deltaLog() const;
+
+        // The right-most leaf, for insert() to append increasing keys to.
+        BtreeRightEdge _rightEdge;
     };
 
     /**
@@ -108,6 +137,9 @@ namespace mongo {
         // These point into the sets oldKeys and newKeys.
         vector<BSONObj*> removed, added;
 
+        // Of the new document, see getKeysAndMultikeyFields.
+        unsigned newMultikeyFields;
+
         DiskLoc loc;
         bool dupsAllowed;
     };
@@ -29,20 +29,39 @@
 #include "mongo/db/index/btree_based_builder.h"
 
 #include "mongo/db/btreebuilder.h"
+#include "mongo/db/db.h"
 #include "mongo/db/index/btree_access_method.h"
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/index/index_access_method.h"
+#include "mongo/db/index/index_delta_log.h"
+#include "mongo/db/index/posting_block.h"
+#include "mongo/db/index_names.h"
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/pdfile_private.h"
 #include "mongo/db/query/internal_plans.h"
+#include "mongo/db/query/runner_yield_policy.h"
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/sort_phase_one.h"
+#include "mongo/util/concurrency/work_stealing_pool.h"
 #include "mongo/util/processinfo.h"
 
 namespace mongo {
 
+    // threads to generate and sort the keys of a foreground btree index build with.  0 picks one
+    // per core (up to 8), 1 does it all on the building thread
+    MONGO_EXPORT_SERVER_PARAMETER(indexBuildKeyGenThreads, int, 0);
+
+    // memory for sorting the keys of an index build, and so the size of the runs spilled to
+    // disk.  Parallel key generation and multi-index builds split it between their sorters.
+    MONGO_EXPORT_SERVER_PARAMETER(indexBuildSortMaxMemoryBytes, int, 100 * 1024 * 1024);
+
+    // memory for the writes a background bulk load holds back while it builds the tree.  A
+    // build that takes more writes than this is abandoned.
+    MONGO_EXPORT_SERVER_PARAMETER(indexBuildDeltaLogMaxBytes, int, 256 * 1024 * 1024);
+
     int oldCompare(const BSONObj& l,const BSONObj& r, const Ordering &o); // key.cpp
 
     class ExternalSortComparisonV0 : public ExternalSortComparison {
@@ -59,6 +78,62 @@ namespace mongo {
         const Ordering _ordering;
     };
 
+    namespace {
+        /** the first 8 bytes of 'data' (zero padded) as a big endian number */
+        unsigned long long bigEndianPrefix(const char* data, int len) {
+            unsigned long long out = 0;
+            for (int i = 0; i < 8; i++)
+                out = (out << 8) | (i < len ? static_cast<unsigned char>(data[i]) : 0);
+            return out;
+        }
+
+        /**
+         * Orders like woCompare() of 'e' against other elements: the canonical type in the top
+         * byte and the start of the value, where comparing it is cheap, in the other 56 bits.
+         */
+        unsigned long long elementPrefix(const BSONElement& e) {
+            unsigned long long value = 0;
+            switch (e.type()) {
+            case NumberDouble:
+            case NumberInt:
+            case NumberLong: {
+                // doubles as bits that compare like the doubles, NaN lowest as in woCompare()
+                double d = e.number();
+                if (isNaN(d))
+                    break;
+                if (d == 0)
+                    d = 0; // no -0
+                memcpy(&value, &d, sizeof(value));
+                const unsigned long long sign = 1ULL << 63;
+                value = (value & sign) ? ~value : (value | sign);
+                break;
+            }
+            case Date:
+                value = static_cast<unsigned long long>(e.date().millis) ^ (1ULL << 63);
+                break;
+            case Timestamp:
+                value = e.timestampValue();
+                break;
+            case Bool:
+                value = static_cast<unsigned long long>(e.boolean()) << 56;
+                break;
+            case jstOID:
+                value = bigEndianPrefix(e.value(), 12);
+                break;
+            case String:
+            case Symbol:
+            case Code:
+                value = bigEndianPrefix(e.valuestr(), e.valuestrsize());
+                break;
+            default:
+                break; // type alone
+            }
+
+            // canonical types run from -1 (MinKey) to 127 (MaxKey)
+            return (static_cast<unsigned long long>(e.canonicalType() + 1) << 56) | (value >> 8);
+        }
+    }
+
     class ExternalSortComparisonV1 : public ExternalSortComparison {
     public:
         ExternalSortComparisonV1(const BSONObj& ordering) : _ordering(Ordering::make(ordering)) { }
@@ -69,10 +144,34 @@ namespace mongo {
             if (x) { return x; }
             return l.second.compare(r.second);
         }
+
+        virtual bool hasKeyPrefix() const { return true; }
+
+        /** by the first key field; an empty key, which is lowest either way, gets 0 */
+        virtual unsigned long long keyPrefix(const ExternalSortDatum& d) const {
+            const BSONElement first = d.first.firstElement();
+            if (first.eoo())
+                return 0;
+            const unsigned long long prefix = elementPrefix(first);
+            return _ordering.descending(1) ? ~prefix : prefix;
+        }
     private:
         const Ordering _ordering;
     };
 
+    /** add the sorted records 'locs' of 'value' to a posting index as block keys */
+    template< class V >
+    void addPostingBlocks( BtreeBuilder<V>& btBuilder,
+                           const BSONObj& value,
+                           vector<DiskLoc>* locs ) {
+        vector<BSONObj> keys;
+        PostingBlock::makeKeys(value.firstElement(), *locs, &keys);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            btBuilder.addKey(keys[i], PostingBlock::firstLoc(keys[i]));
+        }
+        locs->clear();
+    }
+
     template< class V >
     void buildBottomUpPhases2And3( bool dupsAllowed,
                                    IndexDescriptor* idx,
@@ -83,9 +182,16 @@ namespace mongo {
                                    SortPhaseOne* phase1,
                                    ProgressMeterHolder& pm,
                                    Timer& t,
-                                   bool mayInterrupt ) {
+                                   bool mayInterrupt,
+                                   RunnerYieldPolicy* yieldPolicy ) {
         BtreeBuilder<V> btBuilder(dupsAllowed, idx->getOnDisk());
+        btBuilder.setYieldPolicy(yieldPolicy);
         BSONObj keyLast;
+        // the sorted (key, record) stream of a posting index is grouped into blocks by key
+        const bool posting =
+            IndexNames::POSTING == IndexNames::findPluginName(idx->keyPattern());
+        BSONObj postingValue;
+        vector<DiskLoc> postingLocs;
         auto_ptr<BSONObjExternalSorter::Iterator> i = sorter.iterator();
         // verifies that pm and op refer to the same ProgressMeter
         verify(pm == op->setMessage("index: (2/3) btree bottom up",
@@ -96,6 +202,19 @@ namespace mongo {
             RARELY killCurrentOp.checkForInterrupt( !mayInterrupt );
             ExternalSortDatum d = i->next();
 
+            if ( posting ) {
+                if ( !postingLocs.empty() &&
+                     postingValue.firstElement().woCompare(d.first.firstElement(), false) ) {
+                    addPostingBlocks(btBuilder, postingValue, &postingLocs);
+                }
+                if ( postingLocs.empty() ) {
+                    postingValue = d.first.getOwned();
+                }
+                postingLocs.push_back(d.second);
+                pm.hit();
+                continue;
+            }
+
             try {
                 if ( !dupsAllowed && dropDups ) {
                     LastError::Disabled led( lastError.get() );
@@ -126,11 +245,14 @@ namespace mongo {
             }
             pm.hit();
         }
+        if ( !postingLocs.empty() ) {
+            addPostingBlocks(btBuilder, postingValue, &postingLocs);
+        }
         pm.finished();
         op->setMessage("index: (3/3) btree-middle", "Index: (3/3) BTree Middle Progress");
         LOG(t.seconds() > 10 ? 0 : 1 ) << "\t done building bottom layer, going to commit" << endl;
         btBuilder.commit( mayInterrupt );
-        if ( btBuilder.getn() != phase1->nkeys && ! dropDups ) {
+        if ( btBuilder.getn() != phase1->nkeys && ! dropDups && ! posting ) {
             warning() << "not all entries were added to the index, probably some "
                          "keys were too large" << endl;
         }
@@ -154,6 +276,144 @@ namespace mongo {
         }
     }
 
+    namespace {
+        // below this many documents it isn't worth starting threads
+        const long long MinParallelKeyGenRecords = 10000;
+        const size_t KeyGenBatchSize = 1000;
+
+        /**
+         * One thread's share of phase one: generates the keys of the documents it is handed and
+         * sorts them into its own sorter, which is merged with the others' afterwards.  Documents
+         * are unowned, which is fine as the building thread holds the write lock throughout.
+         */
+        class KeyGenWorker : boost::noncopyable {
+        public:
+            typedef boost::function<void (const BSONObj&, BSONObjSet*, unsigned*)> GetKeys;
+
+            KeyGenWorker(const GetKeys& getKeys, const ExternalSortComparison* cmp,
+                         long maxMemory)
+                : _getKeys(getKeys), _errorCode(0) {
+                _phase.sorter.reset(new BSONObjExternalSorter(cmp, maxMemory));
+            }
+
+            vector<pair<BSONObj, DiskLoc> >& batch() { return _batch; }
+
+            /** runs on a pool thread: no Client, so no interrupt checks in here */
+            void run() {
+                try {
+                    for (size_t i = 0; i < _batch.size() && !_errorCode; i++) {
+                        BSONObjSet keys;
+                        unsigned multikeyFields;
+                        _getKeys(_batch[i].first, &keys, &multikeyFields);
+                        _phase.addKeys(keys, multikeyFields, _batch[i].second,
+                                       /*mayInterrupt*/false);
+                    }
+                }
+                catch (DBException& e) {
+                    _errorCode = e.getCode();
+                    _errorMsg = e.what();
+                }
+                _batch.clear();
+            }
+
+            /** rethrow on the building thread what run() caught */
+            void checkError() const {
+                if (_errorCode)
+                    uasserted(_errorCode, _errorMsg);
+            }
+
+            SortPhaseOne& phase() { return _phase; }
+
+        private:
+            GetKeys _getKeys;
+            SortPhaseOne _phase;
+            vector<pair<BSONObj, DiskLoc> > _batch;
+            int _errorCode;
+            string _errorMsg;
+        };
+
+        void runKeyGenWorker(KeyGenWorker* w) { w->run(); }
+
+        int keyGenThreads(Collection* collection, IndexDescriptor* idx) {
+            if (collection->numRecords() < MinParallelKeyGenRecords)
+                return 1;
+            // plugin key generators are left alone; not all of them are known to be thread safe
+            if (!collection->getIndexCatalog()->getAccessMethodName(idx->keyPattern()).empty())
+                return 1;
+            int n = indexBuildKeyGenThreads;
+            if (n <= 0)
+                n = std::min(8, std::max(1, static_cast<int>(ProcessInfo().getNumCores())));
+            return n;
+        }
+    }
+
+    void BtreeBasedBuilder::addKeysToPhaseOneParallel(Collection* collection,
+                                                      IndexDescriptor* idx,
+                                                      SortPhaseOne* phaseOne,
+                                                      ProgressMeter* progressMeter,
+                                                      bool mayInterrupt,
+                                                      int nThreads) {
+        BtreeBasedAccessMethod* iam = collection->getIndexCatalog()->getBtreeBasedIndex( idx );
+        KeyGenWorker::GetKeys getKeys =
+            boost::bind(&BtreeBasedAccessMethod::getKeysAndMultikeyFields, iam, _1, _2, _3);
+
+        // the workers share the memory budget of a single sorter
+        const long maxMemory = std::max(static_cast<long>(indexBuildSortMaxMemoryBytes) / nThreads,
+                                        16L * 1024 * 1024);
+        vector<shared_ptr<KeyGenWorker> > workers;
+        for (int i = 0; i < nThreads; i++) {
+            workers.push_back(shared_ptr<KeyGenWorker>(
+                    new KeyGenWorker(getKeys, phaseOne->sortCmp.get(), maxMemory)));
+        }
+
+        // while the workers are busy with one round of batches we scan the next
+        vector<vector<pair<BSONObj, DiskLoc> > > next(nThreads);
+        TaskGroup tasks(WorkStealingPool::shared());
+
+        auto_ptr<Runner> runner(InternalPlanner::collectionScan(collection->ns().ns()));
+        BSONObj o;
+        DiskLoc loc;
+        Runner::RunnerState state;
+        size_t w = 0;
+        bool more = true;
+        while (more) {
+            state = runner->getNext(&o, &loc);
+            more = (Runner::RUNNER_ADVANCED == state);
+            if (more) {
+                RARELY killCurrentOp.checkForInterrupt( !mayInterrupt );
+                next[w].push_back(make_pair(o, loc));
+                progressMeter->hit();
+                if (next[w].size() < KeyGenBatchSize)
+                    continue;
+                if (++w < next.size())
+                    continue;
+            }
+
+            // a round is ready (or we're at the end): hand it over
+            tasks.join();
+            for (int i = 0; i < nThreads; i++) {
+                workers[i]->checkError();
+                workers[i]->batch().swap(next[i]);
+                next[i].clear();
+                tasks.schedule(boost::bind(runKeyGenWorker, workers[i].get()));
+            }
+            w = 0;
+        }
+        tasks.join();
+
+        for (int i = 0; i < nThreads; i++) {
+            workers[i]->checkError();
+            SortPhaseOne& p = workers[i]->phase();
+            phaseOne->n += p.n;
+            phaseOne->nkeys += p.nkeys;
+            phaseOne->multi = phaseOne->multi || p.multi;
+            phaseOne->multiFields |= p.multiFields;
+            phaseOne->sorter->mergeWith(p.sorter);
+        }
+
+        uassert(17392, "Internal error reading docs from collection", Runner::RUNNER_EOF == state);
+    }
+
     void BtreeBasedBuilder::addKeysToPhaseOne(Collection* collection,
                                               IndexDescriptor* idx,
                                               const BSONObj& order,
@@ -163,8 +423,15 @@ namespace mongo {
 
 
         phaseOne->sortCmp.reset(getComparison(idx->version(), idx->keyPattern()));
-        phaseOne->sorter.reset(new BSONObjExternalSorter(phaseOne->sortCmp.get()));
-        phaseOne->sorter->hintNumObjects( collection->numRecords() );
+        phaseOne->sorter.reset(new BSONObjExternalSorter(phaseOne->sortCmp.get(),
+                                                         indexBuildSortMaxMemoryBytes));
+
+        int nThreads = keyGenThreads(collection, idx);
+        if (nThreads > 1) {
+            addKeysToPhaseOneParallel(collection, idx, phaseOne, progressMeter, mayInterrupt,
+                                      nThreads);
+            return;
+        }
 
         BtreeBasedAccessMethod* iam =collection->getIndexCatalog()->getBtreeBasedIndex( idx );
 
@@ -175,8 +442,9 @@ namespace mongo {
         while (Runner::RUNNER_ADVANCED == (state = runner->getNext(&o, &loc))) {
             RARELY killCurrentOp.checkForInterrupt( !mayInterrupt );
             BSONObjSet keys;
-            iam->getKeys(o, &keys);
-            phaseOne->addKeys(keys, loc, mayInterrupt);
+            unsigned multikeyFields;
+            iam->getKeysAndMultikeyFields(o, &keys, &multikeyFields);
+            phaseOne->addKeys(keys, multikeyFields, loc, mayInterrupt);
             progressMeter->hit();
             if (logger::globalLogDomain()->shouldLog(logger::LogSeverity::Debug(2))
                 && phaseOne->n % 10000 == 0 ) {
@@ -218,7 +486,7 @@ namespace mongo {
         BSONObjExternalSorter& sorter = *(phase1.sorter);
 
         if( phase1.multi ) {
-            collection->getIndexCatalog()->markMultikey( idx );
+            collection->getIndexCatalog()->markMultikey( idx, true, phase1.multiFields );
         }
 
         if ( logger::globalLogDomain()->shouldLog(logger::LogSeverity::Debug(2) ) )
@@ -266,6 +534,244 @@ namespace mongo {
         return phase1.n;
     }
 
+    uint64_t BtreeBasedBuilder::fastBuildIndexes( Collection* collection,
+                                                  const vector<IndexDescriptor*>& idxs,
+                                                  bool mayInterrupt ) {
+        CurOp * op = cc().curop();
+
+        Timer t;
+
+        MONGO_TLOG(1) << "fastBuildIndexes " << collection->ns() << ' ' << idxs.size()
+                      << " indexes" << endl;
+
+        // the sorters share the memory budget of a single one
+        const long maxMemory = std::max(static_cast<long>(indexBuildSortMaxMemoryBytes)
+                                            / static_cast<long>(idxs.size()),
+                                        16L * 1024 * 1024);
+        vector<shared_ptr<SortPhaseOne> > phases;
+        vector<BtreeBasedAccessMethod*> iams;
+        for (size_t i = 0; i < idxs.size(); i++) {
+            IndexDescriptor* idx = idxs[i];
+            verify( !idx->dropDups() ); // dups are dropped one index at a time, see fastBuildIndex
+            getDur().writingDiskLoc(idx->getOnDisk().head).Null();
+
+            shared_ptr<SortPhaseOne> phase(new SortPhaseOne());
+            phase->sortCmp.reset(getComparison(idx->version(), idx->keyPattern()));
+            phase->sorter.reset(new BSONObjExternalSorter(phase->sortCmp.get(), maxMemory));
+            phases.push_back(phase);
+            iams.push_back(collection->getIndexCatalog()->getBtreeBasedIndex( idx ));
+        }
+
+        /* one scan, each index's keys into its own sorter ----- */
+        ProgressMeterHolder pm(op->setMessage("index: (1/3) external sort",
+                                              "Index: (1/3) External Sort Progress",
+                                              collection->numRecords(),
+                                              10));
+        uint64_t n = 0;
+        {
+            auto_ptr<Runner> runner(InternalPlanner::collectionScan(collection->ns().ns()));
+            BSONObj o;
+            DiskLoc loc;
+            Runner::RunnerState state;
+            while (Runner::RUNNER_ADVANCED == (state = runner->getNext(&o, &loc))) {
+                RARELY killCurrentOp.checkForInterrupt( !mayInterrupt );
+                for (size_t i = 0; i < iams.size(); i++) {
+                    BSONObjSet keys;
+                    unsigned multikeyFields;
+                    iams[i]->getKeysAndMultikeyFields(o, &keys, &multikeyFields);
+                    phases[i]->addKeys(keys, multikeyFields, loc, mayInterrupt);
+                }
+                n++;
+                pm.hit();
+            }
+            uassert(17323, "Internal error reading docs from collection",
+                    Runner::RUNNER_EOF == state);
+        }
+        pm.finished();
+
+        LOG(t.seconds() > 5 ? 0 : 1) << "\t external sort of " << idxs.size()
+                                     << " indexes took " << t.seconds() << " secs" << endl;
+
+        /* build each index from its sorted keys --- */
+        for (size_t i = 0; i < idxs.size(); i++) {
+            IndexDescriptor* idx = idxs[i];
+            SortPhaseOne& phase1 = *phases[i];
+            if( phase1.multi ) {
+                collection->getIndexCatalog()->markMultikey( idx, true, phase1.multiFields );
+            }
+            phase1.sorter->sort( mayInterrupt );
+
+            bool dupsAllowed = !idx->unique() || ignoreUniqueIndex(idx->getOnDisk());
+            set<DiskLoc> dupsToDrop; // stays empty: dropDups is false
+            if( idx->version() == 0 )
+                buildBottomUpPhases2And3<V0>(dupsAllowed, idx, *phase1.sorter, false, dupsToDrop,
+                                             op, &phase1, pm, t, mayInterrupt);
+            else if( idx->version() == 1 )
+                buildBottomUpPhases2And3<V1>(dupsAllowed, idx, *phase1.sorter, false, dupsToDrop,
+                                             op, &phase1, pm, t, mayInterrupt);
+            else
+                verify(false);
+
+            // let the sorter's memory and files go before sorting the next one
+            phases[i].reset();
+        }
+
+        return n;
+    }
+
+    /** a background bulk load can't finish once its delta log had to drop writes */
+    static void assertDeltaLogComplete( const IndexDeltaLog& deltaLog, IndexDescriptor* idx ) {
+        uassert( 17398, str::stream() << "background index build of " << idx->indexNamespace()
+                                      << " abandoned: more than " << indexBuildDeltaLogMaxBytes
+                                      << " bytes of concurrent writes to the index",
+                 !deltaLog.overflowed() );
+    }
+
+    uint64_t BtreeBasedBuilder::bulkLoadInBackground( Collection* collection,
+                                                      IndexDescriptor* idx,
+                                                      bool mayInterrupt ) {
+        CurOp * op = cc().curop();
+
+        Timer t;
+
+        verify( !idx->unique() && !idx->dropDups() );
+        MONGO_TLOG(1) << "bulkLoadInBackground " << collection->ns() << ' ' << idx->toString()
+                      << endl;
+
+        string ns = collection->ns().ns();
+        string idxName = idx->indexName();
+
+        // from here until we return, writes to the index are held back in here
+        IndexDeltaLog deltaLog( idx->indexNamespace(), indexBuildDeltaLogMaxBytes );
+
+        SortPhaseOne phase1;
+        phase1.sortCmp.reset(getComparison(idx->version(), idx->keyPattern()));
+        phase1.sorter.reset(new BSONObjExternalSorter(phase1.sortCmp.get(),
+                                                      indexBuildSortMaxMemoryBytes));
+
+        /* get the keys, yielding as we go ----- */
+        ProgressMeterHolder pm(op->setMessage("bg index build: (1/3) external sort",
+                                              "Background Index Build: (1/3) External Sort Progress",
+                                              collection->numRecords(),
+                                              10));
+        {
+            auto_ptr<Runner> runner(InternalPlanner::collectionScan(ns));
+
+            // We're not delegating yielding to the runner because idx has to be looked up again
+            // after each yield.
+            RunnerYieldPolicy yieldPolicy;
+
+            BtreeBasedAccessMethod* iam = collection->getIndexCatalog()->getBtreeBasedIndex( idx );
+            BSONObj o;
+            DiskLoc loc;
+            Runner::RunnerState state;
+            while (Runner::RUNNER_ADVANCED == (state = runner->getNext(&o, &loc))) {
+                RARELY killCurrentOp.checkForInterrupt( !mayInterrupt );
+                BSONObjSet keys;
+                unsigned multikeyFields;
+                iam->getKeysAndMultikeyFields(o, &keys, &multikeyFields);
+                phase1.addKeys(keys, multikeyFields, loc, mayInterrupt);
+                pm.hit();
+
+                if (yieldPolicy.shouldYield()) {
+                    if (!yieldPolicy.yieldAndCheckIfOK(runner.get())) {
+                        uasserted(17324, "cursor gone during bg index");
+                    }
+
+                    pm->setTotalWhileRunning( collection->numRecords() );
+                    // other indexes may have come or gone while we yielded
+                    idx = collection->getIndexCatalog()->findIndexByName( idxName, true );
+                    verify( idx );
+                    assertDeltaLogComplete( deltaLog, idx );
+                    iam = collection->getIndexCatalog()->getBtreeBasedIndex( idx );
+                }
+            }
+            uassert(17325, "Internal error reading docs from collection",
+                    Runner::RUNNER_EOF == state);
+        }
+        pm.finished();
+
+        assertDeltaLogComplete( deltaLog, idx );
+
+        if( phase1.multi ) {
+            collection->getIndexCatalog()->markMultikey( idx, true, phase1.multiFields );
+        }
+
+        /* the sort doesn't touch the database, so let everyone else in meanwhile ----- */
+        {
+            dbtempreleasecond unlock;
+            phase1.sorter->sort( mayInterrupt );
+        }
+        LOG(t.seconds() > 5 ? 0 : 1) << "\t external sort used : " << phase1.sorter->numFiles()
+                                     << " files " << " in " << t.seconds() << " secs" << endl;
+        idx = collection->getIndexCatalog()->findIndexByName( idxName, true );
+        verify( idx );
+
+        /* build the new tree in place of the empty one, yielding as we go.  Writers still go to
+           the delta log and the index isn't ready, so nobody else looks at it, and dropping it
+           waits for the BackgroundOperation of our caller. ----- */
+        RunnerYieldPolicy yieldPolicy;
+        DiskLoc emptyHead = idx->getHead();
+        set<DiskLoc> dupsToDrop; // stays empty: dropDups is false
+        if( idx->version() == 0 ) {
+            buildBottomUpPhases2And3<V0>(true, idx, *phase1.sorter, false, dupsToDrop,
+                                         op, &phase1, pm, t, mayInterrupt, &yieldPolicy);
+            emptyHead.btreemod<V0>()->deallocBucket( emptyHead, idx->getOnDisk() );
+        }
+        else if( idx->version() == 1 ) {
+            buildBottomUpPhases2And3<V1>(true, idx, *phase1.sorter, false, dupsToDrop,
+                                         op, &phase1, pm, t, mayInterrupt, &yieldPolicy);
+            emptyHead.btreemod<V1>()->deallocBucket( emptyHead, idx->getOnDisk() );
+        }
+        else
+            verify(false);
+        phase1.sorter.reset();
+        idx = collection->getIndexCatalog()->findIndexByName( idxName, true );
+        verify( idx );
+        assertDeltaLogComplete( deltaLog, idx );
+
+        /* replay what was written meanwhile, still yielding.  More may come in while we do;
+           only the writes that arrive after our last yield are replayed without one, and then
+           the log goes away under the same lock. --- */
+        BtreeBasedAccessMethod* iam = collection->getIndexCatalog()->getBtreeBasedIndex( idx );
+        size_t applied = 0;
+        while (applied < deltaLog.entries().size()) {
+            RARELY killCurrentOp.checkForInterrupt( !mayInterrupt );
+            // entries() may grow and move while we yield
+            const IndexDeltaLog::Entry& e = deltaLog.entries()[applied++];
+            if (e.insert) {
+                try {
+                    iam->_interface->bt_insert(idx->getHead(), e.loc, e.key, iam->_ordering,
+                                               true, idx->getOnDisk(), true);
+                }
+                catch (AssertionException& ae) {
+                    // 10287 is key+loc already in the index: the scan saw this write
+                    if (10287 != ae.getCode()) {
+                        problem() << " caught assertion applying bg index write "
+                                  << idx->indexNamespace() << ' ' << ae.what() << endl;
+                    }
+                }
+            }
+            else {
+                // false if the scan never saw the key, which is fine
+                iam->_interface->unindex(idx->getHead(), idx->getOnDisk(), e.key, e.loc);
+            }
+            getDur().commitIfNeeded();
+
+            if (yieldPolicy.shouldYield()) {
+                yieldPolicy.yield();
+                idx = collection->getIndexCatalog()->findIndexByName( idxName, true );
+                verify( idx );
+                assertDeltaLogComplete( deltaLog, idx );
+                iam = collection->getIndexCatalog()->getBtreeBasedIndex( idx );
+            }
+        }
+        LOG(applied == 0 ? 1 : 0) << "\t applied " << applied << " concurrent index writes ("
+                                  << deltaLog.bytes() / 1024 << "KB)" << endl;
+
+        return phase1.n;
+    }
+
     void BtreeBasedBuilder::doDropDups(Collection* collection,
                                        const set<DiskLoc>& dupsToDrop, bool mayInterrupt) {
         string ns = collection->ns().ns();
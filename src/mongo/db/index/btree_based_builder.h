@@ -35,6 +35,7 @@
 
 namespace IndexUpdateTests {
     class AddKeysToPhaseOne;
+    class AddKeysToPhaseOneParallel;
     class InterruptAddKeysToPhaseOne;
     class DoDropDups;
     class InterruptDoDropDups;
@@ -50,6 +51,7 @@ namespace mongo {
     class NamespaceDetails;
     class ProgressMeter;
     class ProgressMeterHolder;
+    class RunnerYieldPolicy;
     struct SortPhaseOne;
 
     class BtreeBasedBuilder {
@@ -59,11 +61,35 @@ namespace mongo {
          */
         static uint64_t fastBuildIndex(Collection* collection, IndexDescriptor* descriptor,
                                        bool mayInterrupt);
+
+        /**
+         * Build several indexes with a single scan of the collection, each index's keys going to
+         * its own sorter.  None may have dropDups set.  Throws DBException.
+         * @return number of records scanned
+         */
+        static uint64_t fastBuildIndexes(Collection* collection,
+                                         const vector<IndexDescriptor*>& descriptors,
+                                         bool mayInterrupt);
+
+        /**
+         * Background build of a non unique index that does not insert into the live tree: the
+         * keys are gathered with a yielding collection scan and sorted without the lock, while
+         * writes to the index are held in an IndexDeltaLog.  Then the tree is built bottom up in
+         * place of the current (empty) one and the held writes are replayed over it, both
+         * yielding; only the writes that come in after the last yield are replayed while we
+         * hold on to the lock.  Throws DBException, also when the held writes outgrow
+         * indexBuildDeltaLogMaxBytes.
+         * @return number of records scanned
+         */
+        static uint64_t bulkLoadInBackground(Collection* collection, IndexDescriptor* descriptor,
+                                             bool mayInterrupt);
+
         static DiskLoc makeEmptyIndex(const IndexDetails& idx);
         static ExternalSortComparison* getComparison(int version, const BSONObj& keyPattern);
 
     private:
         friend class IndexUpdateTests::AddKeysToPhaseOne;
+        friend class IndexUpdateTests::AddKeysToPhaseOneParallel;
         friend class IndexUpdateTests::InterruptAddKeysToPhaseOne;
         friend class IndexUpdateTests::DoDropDups;
         friend class IndexUpdateTests::InterruptDoDropDups;
@@ -73,6 +99,12 @@ namespace mongo {
                                       const BSONObj& order, SortPhaseOne* phaseOne,
                                       ProgressMeter* progressMeter, bool mayInterrupt );
 
+        /** addKeysToPhaseOne() with the key generation and sorting spread over 'nThreads' */
+        static void addKeysToPhaseOneParallel(Collection* collection, IndexDescriptor* idx,
+                                              SortPhaseOne* phaseOne,
+                                              ProgressMeter* progressMeter, bool mayInterrupt,
+                                              int nThreads);
+
         static void doDropDups(Collection* collection, const set<DiskLoc>& dupsToDrop,
                                bool mayInterrupt );
     };
@@ -88,6 +120,7 @@ namespace mongo {
                                    SortPhaseOne* phase1,
                                    ProgressMeterHolder& pm,
                                    Timer& t,
-                                   bool mayInterrupt );
+                                   bool mayInterrupt,
+                                   RunnerYieldPolicy* yieldPolicy = NULL );
 
 }  // namespace mongo
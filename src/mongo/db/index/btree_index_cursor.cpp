@@ -35,10 +35,24 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/index/index_cursor.h"
 #include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/pdfile.h"
+#include "mongo/db/storage/extent_manager.h"
+#include "mongo/db/structure/collection.h"
 #include "mongo/platform/unordered_set.h"
 
 namespace mongo {
 
+    namespace {
+        const int MinRunKeys = 4;
+        const int MaxRunKeys = 128;
+
+        // both btree formats use buckets of this size
+        const int BucketBytes = 8192;
+
+        // for a record we hint its first page or so; most are smaller than that
+        const int RecordPrefetchBytes = 4096;
+    }
+
     unordered_set<BtreeIndexCursor*> BtreeIndexCursor::_activeCursors;
     SimpleMutex BtreeIndexCursor::_activeCursorsMutex("active_btree_index_cursors");
 
@@ -46,7 +60,8 @@ namespace mongo {
     BtreeIndexCursor::BtreeIndexCursor(IndexDescriptor *descriptor, Ordering ordering,
                                        BtreeInterface *interface)
         : _direction(1), _descriptor(descriptor), _ordering(ordering), _interface(interface),
-          _bucket(descriptor->getHead()), _keyOffset(0) {
+          _bucket(descriptor->getHead()), _keyOffset(0), _runPos(0), _runMax(1),
+          _prefetchRecords(false) {
 
         SimpleMutex::scoped_lock lock(_activeCursorsMutex);
         _activeCursors.insert(this);
@@ -71,6 +86,7 @@ namespace mongo {
             BtreeIndexCursor* ic = *i;
             if (bucket == ic->_bucket) {
                 ic->_keyOffset = -1;
+                ic->clearRun();
             }
         }
     }
@@ -81,10 +97,18 @@ namespace mongo {
         } else {
             _direction = 1;
         }
+        _prefetchRecords = options.prefetchRecords;
+        clearRun();
         return Status::OK();
     }
 
     Status BtreeIndexCursor::seek(const BSONObj& position) {
+        return seek(position, false);
+    }
+
+    Status BtreeIndexCursor::seek(const BSONObj& position, bool afterKey) {
+        clearRun();
+        _runMax = 1;
         _keyOffset = 0;
 
         // Unused out parameter.
@@ -97,7 +121,8 @@ namespace mongo {
                 _ordering,
                 _keyOffset,
                 found,
-                1 == _direction ? minDiskLoc : maxDiskLoc,
+                // Equal keys are ordered by DiskLoc, so this is before or after all of them.
+                (1 == _direction) != afterKey ? minDiskLoc : maxDiskLoc,
                 _direction);
 
         skipUnusedKeys();
@@ -108,6 +133,8 @@ namespace mongo {
     Status BtreeIndexCursor::seek(const vector<const BSONElement*>& position,
                                   const vector<bool>& inclusive) {
         pair<DiskLoc, int> ignored;
+        clearRun();
+        _runMax = 1;
 
         // Bucket is modified by customLocate.  Seeks start @ the root, so we set _bucket to the
         // root here.
@@ -134,6 +161,7 @@ namespace mongo {
     Status BtreeIndexCursor::skip(const BSONObj &keyBegin, int keyBeginLen, bool afterKey,
                                   const vector<const BSONElement*>& keyEnd,
                                   const vector<bool>& keyEndInclusive) {
+        // keyBegin may be our own getKey(), so the run goes after we are done with it
         _interface->advanceTo(
             _bucket,
             _keyOffset,
@@ -144,6 +172,7 @@ namespace mongo {
             keyEndInclusive,
             _ordering,
             (int)_direction);
+        clearRun();
 
         skipUnusedKeys();
         return Status::OK();
@@ -151,17 +180,78 @@ namespace mongo {
 
     BSONObj BtreeIndexCursor::getKey() const {
         verify(!_bucket.isNull());
+        if (!_run.empty()) {
+            return _run[_runPos].key;
+        }
         return _interface->keyAt(_bucket, _keyOffset);
     }
 
     DiskLoc BtreeIndexCursor::getValue() const {
         verify(!_bucket.isNull());
+        if (!_run.empty()) {
+            return _run[_runPos].recordLoc;
+        }
         return _interface->recordAt(_bucket, _keyOffset);
     }
 
-    void BtreeIndexCursor::next() { advance("BtreeIndexCursor::next"); skipUnusedKeys(); }
+    void BtreeIndexCursor::next() {
+        if (!_run.empty() && _runPos + 1 < _run.size()) {
+            _keyOffset = _run[++_runPos].keyOffset;
+            return;
+        }
+        clearRun();
+        advance("BtreeIndexCursor::next");
+        skipUnusedKeys();
+        fillRun();
+    }
+
+    void BtreeIndexCursor::fillRun() {
+        _runMax = std::min(_runMax * 2, MaxRunKeys);
+        if (isEOF() || _runMax < MinRunKeys) {
+            return;
+        }
+
+        bool toEnd = _interface->keyRun(_bucket, _keyOffset, _direction, _runMax, &_run);
+        if (_run.empty() || _run[0].keyOffset != _keyOffset) {
+            // we aren't on a used key, let next() handle it the slow way
+            clearRun();
+            return;
+        }
+        _runPos = 0;
+
+        if (_prefetchRecords) {
+            for (size_t i = 0; i < _run.size(); ++i) {
+                prefetch(_run[i].recordLoc, RecordPrefetchBytes);
+            }
+        }
+
+        if (toEnd) {
+            // this bucket is done with after the run; the scan carries on through the parent
+            // into the bucket beside us
+            DiskLoc sibling = _interface->siblingBucket(_bucket, _direction);
+            if (!sibling.isNull() && sibling != _prefetchedSibling) {
+                _prefetchedSibling = sibling;
+                prefetch(sibling, BucketBytes);
+            }
+        }
+    }
+
+    void BtreeIndexCursor::clearRun() {
+        _run.clear();
+        _runPos = 0;
+    }
+
+    void BtreeIndexCursor::prefetch(const DiskLoc& loc, int len) const {
+        if (Record::likelyInPhysicalMemory(loc.rec()->dataNoThrowing())) {
+            return;
+        }
+        _descriptor->getIndexedCollection()->getExtentManager()->willNeed(loc, len);
+    }
 
     Status BtreeIndexCursor::savePosition() {
+        // the btree may change under us before restorePosition()
+        clearRun();
+        _runMax = 1;
         if (!isEOF()) {
             _savedKey = getKey().getOwned();
             _savedLoc = getValue();
@@ -58,6 +58,12 @@ namespace mongo {
 
         virtual Status seek(const BSONObj& position);
 
+        /**
+         * Seek to 'position', or if 'afterKey' is true just past every key equal to it, in the
+         * direction of the cursor.
+         */
+        Status seek(const BSONObj& position, bool afterKey);
+
         // Btree-specific seeking functions.
         Status seek(const vector<const BSONElement*>& position,
                     const vector<bool>& inclusive);
@@ -94,6 +100,13 @@ namespace mongo {
         // Move to the next/prev. key.  Used by normal getNext and also skipping unused keys.
         void advance(const char* caller);
 
+        // Pick up the keys ahead of us in this bucket so next() can step through them without
+        // going back to the btree, and hint the OS about what we will read after them.
+        void fillRun();
+        void clearRun();
+
+        void prefetch(const DiskLoc& loc, int len) const;
+
         // For saving/restoring position.
         BSONObj _savedKey;
         DiskLoc _savedLoc;
@@ -109,6 +122,19 @@ namespace mongo {
         DiskLoc _bucket;
         // And we look at an offset in the bucket.
         int _keyOffset;
+
+        // The keys next() will step through without leaving _bucket.  If not empty, _run[_runPos]
+        // is (_bucket, _keyOffset).  It is dropped whenever the cursor moves any other way or
+        // the btree may have changed, i.e. on savePosition().
+        vector<BtreeInterface::KeyRunEntry> _run;
+        size_t _runPos;
+
+        // How many keys the next run may hold.  Starts small after a seek, as most seeks are
+        // followed by only a next() or two, and doubles with each run.
+        int _runMax;
+
+        bool _prefetchRecords;
+        DiskLoc _prefetchedSibling;
     };
 
 }  // namespace mongo
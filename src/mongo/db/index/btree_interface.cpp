@@ -57,6 +57,32 @@ namespace mongo {
                 toplevel);
         }
 
+        virtual void bt_insertHinted(const DiskLoc thisLoc,
+                                     DiskLoc* hint,
+                                     const DiskLoc recordLoc,
+                                     const BSONObj& key,
+                                     const Ordering& order,
+                                     IndexDetails& idx) const {
+            thisLoc.btree<Version>()->bt_insertHinted(thisLoc, hint, recordLoc, key, order, idx);
+        }
+
+        virtual int bt_insertAppend(const DiskLoc thisLoc,
+                                    BtreeRightEdge* edge,
+                                    const DiskLoc recordLoc,
+                                    const BSONObj& key,
+                                    const Ordering& order,
+                                    bool dupsAllowed,
+                                    IndexDetails& idx) const {
+            return thisLoc.btree<Version>()->bt_insertAppend(
+                thisLoc,
+                edge,
+                recordLoc,
+                key,
+                order,
+                dupsAllowed,
+                idx);
+        }
+
         virtual bool unindex(const DiskLoc thisLoc,
                              IndexDetails& id,
                              const BSONObj& key,
@@ -182,6 +208,48 @@ namespace mongo {
             }
         }
 
+        virtual bool keyRun(DiskLoc bucket, int keyOffset, int direction, int maxKeys,
+                            vector<KeyRunEntry>* out) const {
+            const BtreeBucket<Version> *b = bucket.btree<Version>();
+            // one more than asked for, to know whether the run was cut short
+            vector<int> ofs;
+            b->inBucketRun(keyOffset, direction, maxKeys + 1, &ofs);
+            bool toEnd = static_cast<int>(ofs.size()) <= maxKeys;
+            if (!toEnd)
+                ofs.pop_back();
+
+            out->resize(ofs.size());
+            for (size_t i = 0; i < ofs.size(); ++i) {
+                const typename BtreeBucket<Version>::KeyNode kn = b->keyNode(ofs[i]);
+                (*out)[i].keyOffset = ofs[i];
+                (*out)[i].key = kn.key.toBson();
+                (*out)[i].recordLoc = kn.recordLoc;
+            }
+            return toEnd;
+        }
+
+        virtual DiskLoc siblingBucket(DiskLoc bucket, int direction) const {
+            return bucket.btree<Version>()->siblingBucket(bucket, direction);
+        }
+
+        virtual void bucketContents(DiskLoc bucket, vector<BSONObj>* keys,
+                                    vector<DiskLoc>* children) const {
+            const BtreeBucket<Version> *b = bucket.btree<Version>();
+            int n = b->getN();
+            if (n == b->INVALID_N_SENTINEL) {
+                throw UserException(deletedBucketCode, "bucketContents bucket deleted");
+            }
+
+            keys->resize(n);
+            children->resize(n + 1);
+            for (int i = 0; i < n; ++i) {
+                const typename BtreeBucket<Version>::KeyNode kn = b->keyNode(i);
+                (*keys)[i] = kn.key.toBson();
+                (*children)[i] = kn.prevChildBucket;
+            }
+            (*children)[n] = b->getNextChild();
+        }
+
         virtual string dupKeyError(DiskLoc bucket, const IndexDetails &idx,
                                    const BSONObj& keyObj) const {
             typename Version::KeyOwned key(keyObj);
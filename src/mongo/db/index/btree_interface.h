@@ -58,6 +58,21 @@ namespace mongo {
                               IndexDetails& idx,
                               bool toplevel = true) const = 0;
 
+        virtual void bt_insertHinted(const DiskLoc thisLoc,
+                                     DiskLoc* hint,
+                                     const DiskLoc recordLoc,
+                                     const BSONObj& key,
+                                     const Ordering& order,
+                                     IndexDetails& idx) const = 0;
+
+        virtual int bt_insertAppend(const DiskLoc thisLoc,
+                                    BtreeRightEdge* edge,
+                                    const DiskLoc recordLoc,
+                                    const BSONObj& key,
+                                    const Ordering& order,
+                                    bool dupsAllowed,
+                                    IndexDetails& idx) const = 0;
+
         virtual bool unindex(const DiskLoc thisLoc,
                              IndexDetails& id,
                              const BSONObj& key,
@@ -134,6 +149,33 @@ namespace mongo {
          */
         virtual void keyAndRecordAt(DiskLoc bucket, int keyOffset, BSONObj* keyOut,
                                     DiskLoc* recordOut) const = 0;
+
+        struct KeyRunEntry {
+            int keyOffset;
+            BSONObj key;
+            DiskLoc recordLoc;
+        };
+
+        /**
+         * The used keys a cursor at (bucket, keyOffset) steps through in 'direction' before it
+         * leaves the bucket, starting with keyOffset, at most maxKeys of them.
+         * @return true if the run goes up to where the cursor leaves the bucket
+         */
+        virtual bool keyRun(DiskLoc bucket, int keyOffset, int direction, int maxKeys,
+                            vector<KeyRunEntry>* out) const = 0;
+
+        /**
+         * The bucket next to 'bucket' under the same parent on the 'direction' side, or null.
+         */
+        virtual DiskLoc siblingBucket(DiskLoc bucket, int direction) const = 0;
+
+        /**
+         * All the keys of 'bucket', used or not, in order, and its children: children[i] is the
+         * bucket left of keys[i] and children.back() the one right of the last key.  The
+         * children of a leaf are null.
+         */
+        virtual void bucketContents(DiskLoc bucket, vector<BSONObj>* keys,
+                                    vector<DiskLoc>* children) const = 0;
     };
 
 }  // namespace mongo
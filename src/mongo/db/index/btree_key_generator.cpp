@@ -31,6 +31,15 @@
 
 namespace mongo {
 
+    namespace {
+
+        bool hasEmptyPart(const char* field) {
+            const size_t len = strlen(field);
+            return len > 0 && ('.' == field[0] || '.' == field[len - 1] || strstr(field, ".."));
+        }
+
+    }  // namespace
+
     // Used in scanandorder.cpp to inforatively error when we try to sort keys with parallel arrays.
     const int BtreeKeyGenerator::ParallelArraysCode = 10088;
 
@@ -48,18 +57,56 @@ namespace mongo {
         nullEltBuilder.appendNull("");
         _nullObj = nullEltBuilder.obj();
         _nullElt = _nullObj.firstElement();
+
+        // getFieldDottedOrArray reads a field with an empty part, like "a.", differently from
+        // how FieldRef parses it.  Indexes on those look their fields up one at a time.
+        _extractFields = true;
+        for (size_t i = 0; i < fieldNames.size(); ++i) {
+            if (hasEmptyPart(fieldNames[i])) {
+                _extractFields = false;
+            }
+            _fieldSlots.push_back(_extractor.addPath(fieldNames[i]));
+        }
     }
 
-    void BtreeKeyGenerator::getKeys(const BSONObj &obj, BSONObjSet *keys) const {
+    void BtreeKeyGenerator::getKeys(const BSONObj &obj, BSONObjSet *keys,
+                                    unsigned* arrayFields) const {
         // These are mutated as part of the getKeys call.  :|
         vector<const char*> fieldNames(_fieldNames);
         vector<BSONElement> fixed(_fixed);
-        getKeysImpl(fieldNames, fixed, obj, keys);
+
+        // Rather than scanning the document once per index field.
+        FieldExtractor::Slots slots;
+        if (_extractFields) {
+            _extractor.extract(obj, &slots);
+        }
+
+        if (arrayFields) {
+            *arrayFields = 0;
+        }
+        getKeysImpl(fieldNames, fixed, obj, keys, _extractFields ? &slots : NULL, arrayFields);
         if (keys->empty() && ! _isSparse) {
             keys->insert(_nullKey);
         }
     }
 
+    BSONElement BtreeKeyGenerator::extracted(const FieldExtractor::Slots& slots, unsigned i,
+                                             const char*& field) const {
+        const FieldExtractor::Slot& slot = slots[_fieldSlots[i]];
+        if (slot.element.type() != Array) {
+            // Only a lookup stopped by an array leaves anything of the field to expand.
+            field += strlen(field);
+            return slot.element;
+        }
+
+        // Step past the array's field name and those above it.
+        for (size_t part = 0; part <= slot.idxPath; ++part) {
+            const char* dot = strchr(field, '.');
+            field = dot ? dot + 1 : field + strlen(field);
+        }
+        return slot.element;
+    }
+
     static void assertParallelArrays( const char *first, const char *second ) {
         stringstream ss;
         ss << "cannot index parallel arrays [" << first << "] [" << second << "]";
@@ -71,7 +118,9 @@ namespace mongo {
             : BtreeKeyGenerator(fieldNames, fixed, isSparse) { }
         
     void BtreeKeyGeneratorV0::getKeysImpl(vector<const char*> fieldNames, vector<BSONElement> fixed,
-                                          const BSONObj &obj, BSONObjSet *keys) const {
+                                          const BSONObj &obj, BSONObjSet *keys,
+                                          const FieldExtractor::Slots* slots,
+                                          unsigned* arrayFields) const {
         BSONElement arrElt;
         unsigned arrIdx = ~0;
         unsigned numNotFound = 0;
@@ -80,7 +129,8 @@ namespace mongo {
             if ( *fieldNames[ i ] == '\0' )
                 continue;
 
-            BSONElement e = obj.getFieldDottedOrArray( fieldNames[ i ] );
+            BSONElement e = slots ? extracted( *slots, i, fieldNames[ i ] )
+                                  : obj.getFieldDottedOrArray( fieldNames[ i ] );
 
             if ( e.eoo() ) {
                 e = _nullElt; // no matching field
@@ -89,6 +139,8 @@ namespace mongo {
 
             if ( e.type() != Array )
                 fieldNames[ i ] = ""; // no matching field or non-array match
+            else
+                noteArray( arrayFields, i );
 
             if ( *fieldNames[ i ] == '\0' )
                 // no need for further object expansion (though array expansion still possible)
@@ -159,7 +211,8 @@ namespace mongo {
                 while( i.more() ) {
                     BSONElement e = i.next();
                     if ( e.type() == Object ) {
-                        getKeysImpl( fieldNames, fixed, e.embeddedObject(), keys );
+                        getKeysImpl( fieldNames, fixed, e.embeddedObject(), keys, NULL,
+                                     arrayFields );
                     }
                 }
             }
@@ -233,7 +286,8 @@ namespace mongo {
                                                   unsigned numNotFound,
                                                   const BSONElement &arrObjElt,
                                                   const set<unsigned> &arrIdxs,
-                                                  bool mayExpandArrayUnembedded) const {
+                                                  bool mayExpandArrayUnembedded,
+                                                  unsigned* arrayFields) const {
         // set up any terminal array values
         for( set<unsigned>::const_iterator j = arrIdxs.begin(); j != arrIdxs.end(); ++j ) {
             if ( *fieldNames[ *j ] == '\0' ) {
@@ -246,18 +300,22 @@ namespace mongo {
                              arrEntry.type() == Object ? arrEntry.embeddedObject() : BSONObj(),
                              keys,
                              numNotFound,
-                             arrObjElt.embeddedObject());
+                             arrObjElt.embeddedObject(),
+                             arrayFields);
     }
 
     void BtreeKeyGeneratorV1::getKeysImpl(vector<const char*> fieldNames, vector<BSONElement> fixed,
-                                          const BSONObj &obj, BSONObjSet *keys) const {
-        getKeysImplWithArray(fieldNames, fixed, obj, keys, 0, BSONObj());
+                                          const BSONObj &obj, BSONObjSet *keys,
+                                          const FieldExtractor::Slots* slots,
+                                          unsigned* arrayFields) const {
+        getKeysImplWithArray(fieldNames, fixed, obj, keys, 0, BSONObj(), arrayFields, slots);
     }
 
     void BtreeKeyGeneratorV1::getKeysImplWithArray(vector<const char*> fieldNames,
                                                    vector<BSONElement> fixed, const BSONObj &obj,
                                                    BSONObjSet *keys, unsigned numNotFound,
-                                                   const BSONObj &array) const {
+                                                   const BSONObj &array, unsigned* arrayFields,
+                                                   const FieldExtractor::Slots* slots) const {
         BSONElement arrElt;
         set<unsigned> arrIdxs;
         bool mayExpandArrayUnembedded = true;
@@ -266,9 +324,12 @@ namespace mongo {
                 continue;
             }
 
-            bool arrayNestedArray;
-            // Extract element matching fieldName[ i ] from object xor array.
-            BSONElement e = extractNextElement( obj, array, fieldNames[ i ], arrayNestedArray );
+            bool arrayNestedArray = false;
+            // Extract element matching fieldName[ i ] from object xor array.  There is no array
+            // at the top level, so there it is just the document's field.
+            BSONElement e = slots ? extracted( *slots, i, fieldNames[ i ] )
+                                  : extractNextElement( obj, array, fieldNames[ i ],
+                                                        arrayNestedArray );
 
             if ( e.eoo() ) {
                 // if field not present, set to null
@@ -279,6 +340,7 @@ namespace mongo {
             }
             else if ( e.type() == Array ) {
                 arrIdxs.insert( i );
+                noteArray( arrayFields, i );
                 if ( arrElt.eoo() ) {
                     // we only expand arrays on a single path -- track the path here
                     arrElt = e;
@@ -311,7 +373,7 @@ namespace mongo {
         else if ( arrElt.embeddedObject().firstElement().eoo() ) {
             // Empty array, so set matching fields to undefined.
             _getKeysArrEltFixed(fieldNames, fixed, _undefinedElt, keys, numNotFound, arrElt,
-                                arrIdxs, true );
+                                arrIdxs, true, arrayFields );
         }
         else {
             // Non empty array that can be expanded, so generate a key for each member.
@@ -319,7 +381,7 @@ namespace mongo {
             BSONObjIterator i( arrObj );
             while( i.more() ) {
                 _getKeysArrEltFixed(fieldNames, fixed, i.next(), keys, numNotFound, arrElt, arrIdxs,
-                        mayExpandArrayUnembedded );
+                        mayExpandArrayUnembedded, arrayFields );
             }
         }
     }
@@ -30,6 +30,7 @@
 
 #include <vector>
 #include <set>
+#include "mongo/db/field_extractor.h"
 #include "mongo/db/jsobj.h"
 
 namespace mongo {
@@ -43,11 +44,31 @@ namespace mongo {
         BtreeKeyGenerator(vector<const char*> fieldNames, vector<BSONElement> fixed, bool isSparse);
         virtual ~BtreeKeyGenerator() { }
 
-        void getKeys(const BSONObj &obj, BSONObjSet *keys) const;
+        /**
+         * @param arrayFields - if not NULL, set to the fields whose path in obj goes through an
+         *        array, bit j for field j (fields past the 32nd all share the top bit).  These
+         *        are what make an index multikey, even where they come to a single key.
+         */
+        void getKeys(const BSONObj &obj, BSONObjSet *keys, unsigned* arrayFields = NULL) const;
 
         static const int ParallelArraysCode;
 
     protected:
+        /**
+         * What obj.getFieldDottedOrArray(field) returns, for the top-level document 'obj' whose
+         * fields were picked out into 'slots', and the index field 'i' at 'field'.  Leaves 'field'
+         * where getFieldDottedOrArray would.
+         */
+        BSONElement extracted(const FieldExtractor::Slots& slots, unsigned i,
+                              const char*& field) const;
+
+        /** note in 'arrayFields', if any, that index field 'i' went through an array */
+        static void noteArray(unsigned* arrayFields, unsigned i) {
+            if (arrayFields) {
+                *arrayFields |= 1u << std::min(i, 31u);
+            }
+        }
+
         // These are used by the getKeysImpl(s) below.
         vector<const char*> _fieldNames;
         bool _isSparse;
@@ -57,9 +78,17 @@ namespace mongo {
         BSONSizeTracker _sizeTracker;
     private:
         // We have V0 and V1.  Sigh.
+        // 'slots' holds the index fields of 'obj' if it is the document itself, else it is NULL.
         virtual void getKeysImpl(vector<const char*> fieldNames, vector<BSONElement> fixed,
-                                 const BSONObj &obj, BSONObjSet *keys) const = 0;
+                                 const BSONObj &obj, BSONObjSet *keys,
+                                 const FieldExtractor::Slots* slots,
+                                 unsigned* arrayFields) const = 0;
         vector<BSONElement> _fixed;
+
+        // Picks all the index fields out of a document in one walk over it, if _extractFields.
+        bool _extractFields;
+        FieldExtractor _extractor;
+        vector<size_t> _fieldSlots;
     };
 
     class BtreeKeyGeneratorV0 : public BtreeKeyGenerator {
@@ -70,7 +99,9 @@ namespace mongo {
         
     private:
         virtual void getKeysImpl(vector<const char*> fieldNames, vector<BSONElement> fixed,
-                                 const BSONObj &obj, BSONObjSet *keys) const;
+                                 const BSONObj &obj, BSONObjSet *keys,
+                                 const FieldExtractor::Slots* slots,
+                                 unsigned* arrayFields) const;
     };
 
     class BtreeKeyGeneratorV1 : public BtreeKeyGenerator {
@@ -88,14 +119,19 @@ namespace mongo {
          * @param numNotFound - number of index fields that have already been identified as missing
          * @param array - array from which keys should be extracted, based on names in fieldNames
          *        If obj and array are both nonempty, obj will be one of the elements of array.
+         * @param slots - the index fields of obj, if obj is the document itself
+         * @param arrayFields - where to note the fields whose path goes through an array, or NULL
          */        
         virtual void getKeysImpl(vector<const char*> fieldNames, vector<BSONElement> fixed,
-                                 const BSONObj &obj, BSONObjSet *keys) const;
+                                 const BSONObj &obj, BSONObjSet *keys,
+                                 const FieldExtractor::Slots* slots,
+                                 unsigned* arrayFields) const;
 
         // These guys are called by getKeysImpl.
         void getKeysImplWithArray(vector<const char*> fieldNames, vector<BSONElement> fixed,
                                   const BSONObj &obj, BSONObjSet *keys, unsigned numNotFound,
-                                  const BSONObj &array) const;
+                                  const BSONObj &array, unsigned* arrayFields,
+                                  const FieldExtractor::Slots* slots = NULL) const;
         /**
          * @param arrayNestedArray - set if the returned element is an array nested directly
                                      within arr.
@@ -105,7 +141,8 @@ namespace mongo {
         void _getKeysArrEltFixed(vector<const char*> &fieldNames, vector<BSONElement> &fixed,
                                  const BSONElement &arrEntry, BSONObjSet *keys,
                                  unsigned numNotFound, const BSONElement &arrObjElt,
-                                 const set<unsigned> &arrIdxs, bool mayExpandArrayUnembedded) const;
+                                 const set<unsigned> &arrIdxs, bool mayExpandArrayUnembedded,
+                                 unsigned* arrayFields) const;
         
         BSONObj _undefinedObj;
         BSONElement _undefinedElt;
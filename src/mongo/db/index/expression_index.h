@@ -28,7 +28,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <utility>
+
 #include "mongo/db/jsobj.h"
+#include "mongo/db/geo/s2common.h"
 #include "mongo/db/hasher.h"
 #include "mongo/db/query/index_bounds_builder.h"
 
@@ -47,11 +51,14 @@ namespace mongo {
             return bob.obj();
         }
 
-        static void cover2dsphere(const S2Region& region, OrderedIntervalList* oilOut) {
-            // XXX: should grab coarsest level from the index since the user can possibly change it.
-            int coarsestIndexedLevel = 
-                        S2::kAvgEdge.GetClosestLevel(100 * 1000.0 / kRadiusOfEarthInMeters);
-
+        /**
+         * The bounds on the keys of the 2dsphere index described by 'indexInfo' of the cells
+         * that may intersect 'region'.
+         */
+        static void cover2dsphere(const S2Region& region,
+                                  const BSONObj& indexInfo,
+                                  OrderedIntervalList* oilOut) {
+            int coarsestIndexedLevel = S2SearchUtil::coarsestIndexedLevel(indexInfo);
 
             // The min level of our covering is the level whose cells are the closest match to the
             // *area* of the region (or the max indexed level, whichever is smaller) The max level
@@ -65,6 +72,11 @@ namespace mongo {
             vector<S2CellId> cover;
             coverer.GetCovering(region, &cover);
 
+            if (S2_INDEX_VERSION_2 == S2SearchUtil::indexVersion(indexInfo)) {
+                coverCellIds(cover, coarsestIndexedLevel, oilOut);
+                return;
+            }
+
             // Look at the cells we cover and all cells that are within our covering and finer.
             // Anything with our cover as a strict prefix is contained within the cover and should
             // be intersection tested.
@@ -149,6 +161,51 @@ namespace mongo {
                 verify(0);
             }
         }
+
+    private:
+        /**
+         * cover2dsphere() for an index of S2_INDEX_VERSION_2, whose keys are cell ids.  The ids of
+         * a cell and of all the cells within it make up one range, so each cell of 'cover' is a
+         * range of keys and each coarser cell containing one of them a point.  A cell's id falls
+         * between the ranges of its children, so these never overlap, and ranges that touch are
+         * merged to save the index scan a seek.
+         */
+        static void coverCellIds(const vector<S2CellId>& cover,
+                                 int coarsestIndexedLevel,
+                                 OrderedIntervalList* oilOut) {
+            typedef std::pair<long long, long long> KeyRange;
+            vector<KeyRange> ranges;
+            for (size_t i = 0; i < cover.size(); ++i) {
+                ranges.push_back(KeyRange(S2SearchUtil::cellIdToKey(cover[i].range_min()),
+                                          S2SearchUtil::cellIdToKey(cover[i].range_max())));
+                if (cover[i].level() > coarsestIndexedLevel) {
+                    for (S2CellId id = cover[i].parent(); id.level() >= coarsestIndexedLevel;
+                            id = id.parent()) {
+                        const long long key = S2SearchUtil::cellIdToKey(id);
+                        ranges.push_back(KeyRange(key, key));
+                    }
+                }
+            }
+            std::sort(ranges.begin(), ranges.end());
+
+            size_t i = 0;
+            while (i < ranges.size()) {
+                const long long start = ranges[i].first;
+                long long end = ranges[i].second;
+                // parents shared by several cells of the cover come up more than once
+                for (++i; i < ranges.size() && ranges[i].first <= end + 1; ++i) {
+                    end = std::max(end, ranges[i].second);
+                }
+                if (start == end) {
+                    oilOut->intervals.push_back(
+                        IndexBoundsBuilder::makePointInterval(BSON("" << start)));
+                }
+                else {
+                    oilOut->intervals.push_back(IndexBoundsBuilder::makeRangeInterval(
+                        BSON("" << start << "" << end), true, true));
+                }
+            }
+        }
     };
 
 }  // namespace mongo
@@ -0,0 +1,378 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#include "mongo/db/index/extendible_hash.h"
+
+#include <cstring>
+
+#include "mongo/db/dur.h"
+#include "mongo/db/pdfile.h"
+#include "mongo/db/storage/index_details.h"
+#include "mongo/db/storage/record.h"
+
+namespace mongo {
+
+    namespace {
+
+        const int BucketHeaderSize = sizeof( ExtendibleHashBucket ) - sizeof( ExtendibleHashEntry );
+
+        // don't start with a directory of more than 64K slots, however big the collection
+        const int MaxInitialDepth = 16;
+
+        unsigned long long lowBits( int depth ) {
+            return ( 1ULL << depth ) - 1;
+        }
+
+        unsigned long long reverseBits( unsigned long long x ) {
+            x = ( ( x >> 1 ) & 0x5555555555555555ULL ) | ( ( x & 0x5555555555555555ULL ) << 1 );
+            x = ( ( x >> 2 ) & 0x3333333333333333ULL ) | ( ( x & 0x3333333333333333ULL ) << 2 );
+            x = ( ( x >> 4 ) & 0x0f0f0f0f0f0f0f0fULL ) | ( ( x & 0x0f0f0f0f0f0f0f0fULL ) << 4 );
+            x = ( ( x >> 8 ) & 0x00ff00ff00ff00ffULL ) | ( ( x & 0x00ff00ff00ff00ffULL ) << 8 );
+            x = ( ( x >> 16 ) & 0x0000ffff0000ffffULL ) | ( ( x & 0x0000ffff0000ffffULL ) << 16 );
+            return ( x >> 32 ) | ( x << 32 );
+        }
+
+        const ExtendibleHashBucket* bucketAt( const DiskLoc& loc ) {
+            return reinterpret_cast<const ExtendibleHashBucket*>( loc.rec()->data() );
+        }
+
+        ExtendibleHashBucket* bucketForWriting( const DiskLoc& loc, int len ) {
+            return static_cast<ExtendibleHashBucket*>(
+                getDur().writingPtr( loc.rec()->data(), len ) );
+        }
+
+        void appendChain( DiskLoc cur, std::vector<ExtendibleHashEntry>* out ) {
+            while ( !cur.isNull() ) {
+                const ExtendibleHashBucket* b = bucketAt( cur );
+                out->insert( out->end(), b->entries, b->entries + b->n );
+                cur = b->overflow;
+            }
+        }
+
+    }  // namespace
+
+    // static
+    DiskLoc ExtendibleHash::create( const IndexDetails& idx, long long expectedEntries ) {
+        // leave room to grow before the first split
+        int depth = 0;
+        while ( depth < MaxInitialDepth &&
+                ( ( BucketCapacity * 7LL / 10 ) << depth ) < expectedEntries ) {
+            depth++;
+        }
+
+        ExtendibleHash table( idx );
+        string ns = idx.indexNamespace();
+
+        // the buckets go first so the index namespace gets a first extent sized for them
+        std::vector<DiskLoc> buckets;
+        for ( int i = 0; i < ( 1 << depth ); i++ ) {
+            buckets.push_back( table.allocBucket( depth ) );
+        }
+
+        int dirLen = sizeof( DiskLoc ) << depth;
+        DiskLoc dir = theDataFileMgr.insert( ns.c_str(), 0, dirLen, false, true );
+        DiskLoc* slots = static_cast<DiskLoc*>( getDur().writingPtr( dir.rec()->data(), dirLen ) );
+        for ( int i = 0; i < ( 1 << depth ); i++ ) {
+            slots[i] = buckets[i];
+        }
+
+        DiskLoc headLoc = theDataFileMgr.insert( ns.c_str(), 0, sizeof( ExtendibleHashHead ),
+                                                 false, true );
+        ExtendibleHashHead* h = getDur().writing(
+            reinterpret_cast<ExtendibleHashHead*>( headLoc.rec()->data() ) );
+        h->version = Version;
+        h->globalDepth = depth;
+        h->directory = dir;
+        h->reserved = 0;
+        return headLoc;
+    }
+
+    const ExtendibleHashHead* ExtendibleHash::head() const {
+        const ExtendibleHashHead* h =
+            reinterpret_cast<const ExtendibleHashHead*>( _idx.head.rec()->data() );
+        massert( 17333, str::stream() << "unknown hashtable index version " << h->version
+                                      << " in " << _idx.indexNamespace(),
+                 h->version == Version );
+        return h;
+    }
+
+    const DiskLoc* ExtendibleHash::directory() const {
+        return reinterpret_cast<const DiskLoc*>( head()->directory.rec()->data() );
+    }
+
+    DiskLoc ExtendibleHash::chainFor( long long hash ) const {
+        return directory()[ hash & lowBits( head()->globalDepth ) ];
+    }
+
+    bool ExtendibleHash::insert( long long hash, const DiskLoc& loc ) {
+        while ( true ) {
+            DiskLoc first = chainFor( hash );
+            DiskLoc room;
+            DiskLoc last;
+            for ( DiskLoc cur = first; !cur.isNull(); cur = bucketAt( cur )->overflow ) {
+                const ExtendibleHashBucket* b = bucketAt( cur );
+                for ( int i = 0; i < b->n; i++ ) {
+                    if ( b->entries[i].hash == hash && b->entries[i].loc == loc ) {
+                        // already there, i.e. bg indexing saw this record twice
+                        return false;
+                    }
+                }
+                if ( room.isNull() && b->n < BucketCapacity ) {
+                    room = cur;
+                }
+                last = cur;
+            }
+
+            if ( room.isNull() ) {
+                if ( canSplit( first, hash ) ) {
+                    split( first, hash );
+                    continue;
+                }
+                room = allocBucket( bucketAt( first )->localDepth );
+                getDur().writingDiskLoc( const_cast<DiskLoc&>( bucketAt( last )->overflow ) ) =
+                    room;
+            }
+
+            const ExtendibleHashBucket* b = bucketAt( room );
+            ExtendibleHashEntry* e =
+                getDur().writing( const_cast<ExtendibleHashEntry*>( &b->entries[b->n] ) );
+            e->hash = hash;
+            e->loc = loc;
+            getDur().writingInt( const_cast<int&>( b->n ) )++;
+            return true;
+        }
+    }
+
+    bool ExtendibleHash::remove( long long hash, const DiskLoc& loc ) {
+        DiskLoc prev;
+        for ( DiskLoc cur = chainFor( hash ); !cur.isNull(); cur = bucketAt( cur )->overflow ) {
+            const ExtendibleHashBucket* b = bucketAt( cur );
+            for ( int i = 0; i < b->n; i++ ) {
+                if ( b->entries[i].hash != hash || b->entries[i].loc != loc ) {
+                    continue;
+                }
+
+                // fill the hole from the end of the bucket
+                int last = b->n - 1;
+                if ( i != last ) {
+                    *getDur().writing( const_cast<ExtendibleHashEntry*>( &b->entries[i] ) ) =
+                        b->entries[last];
+                }
+                getDur().writingInt( const_cast<int&>( b->n ) ) = last;
+
+                // an empty overflow bucket comes off the chain, the first one of a slot stays
+                if ( 0 == last && !prev.isNull() ) {
+                    getDur().writingDiskLoc( const_cast<DiskLoc&>( bucketAt( prev )->overflow ) ) =
+                        b->overflow;
+                    freeRecord( cur );
+                }
+                return true;
+            }
+            prev = cur;
+        }
+        return false;
+    }
+
+    void ExtendibleHash::getChain( long long hash, std::vector<ExtendibleHashEntry>* out ) const {
+        appendChain( chainFor( hash ), out );
+    }
+
+    bool ExtendibleHash::getChainAt( unsigned long long order,
+                                     std::vector<ExtendibleHashEntry>* out,
+                                     unsigned long long* next ) const {
+        // walkOrder() is an involution on the bits that matter
+        DiskLoc first = chainFor( static_cast<long long>( reverseBits( order ) ) );
+        appendChain( first, out );
+
+        int localDepth = bucketAt( first )->localDepth;
+        if ( 0 == localDepth ) {
+            return false;
+        }
+        // the chain covers the walk orders sharing its top localDepth bits
+        unsigned long long span = 1ULL << ( 64 - localDepth );
+        *next = ( order & ~( span - 1 ) ) + span;
+        return 0 != *next;
+    }
+
+    // static
+    unsigned long long ExtendibleHash::walkOrder( long long hash ) {
+        return reverseBits( static_cast<unsigned long long>( hash ) );
+    }
+
+    bool ExtendibleHash::canSplit( const DiskLoc& first, long long hash ) const {
+        if ( bucketAt( first )->localDepth >= MaxDepth ) {
+            return false;
+        }
+        // everything on the chain agrees with 'hash' below localDepth, so any difference
+        // below MaxDepth is one a split can eventually use
+        for ( DiskLoc cur = first; !cur.isNull(); cur = bucketAt( cur )->overflow ) {
+            const ExtendibleHashBucket* b = bucketAt( cur );
+            for ( int i = 0; i < b->n; i++ ) {
+                if ( ( b->entries[i].hash ^ hash ) & lowBits( MaxDepth ) ) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void ExtendibleHash::split( const DiskLoc& first, long long hash ) {
+        int localDepth = bucketAt( first )->localDepth;
+        if ( localDepth == head()->globalDepth ) {
+            doubleDirectory();
+        }
+
+        std::vector<ExtendibleHashEntry> all;
+        appendChain( first, &all );
+
+        std::vector<ExtendibleHashEntry> stay;
+        std::vector<ExtendibleHashEntry> move;
+        for ( size_t i = 0; i < all.size(); i++ ) {
+            if ( ( all[i].hash >> localDepth ) & 1 ) {
+                move.push_back( all[i] );
+            }
+            else {
+                stay.push_back( all[i] );
+            }
+        }
+
+        DiskLoc sibling = allocBucket( localDepth + 1 );
+        fill( first, localDepth + 1, stay );
+        fill( sibling, localDepth + 1, move );
+
+        // point the slots whose next bit is set at the sibling
+        int globalDepth = head()->globalDepth;
+        const DiskLoc* slots = directory();
+        unsigned long long slot = ( hash & lowBits( localDepth ) ) | ( 1ULL << localDepth );
+        for ( ; slot < ( 1ULL << globalDepth ); slot += 1ULL << ( localDepth + 1 ) ) {
+            getDur().writingDiskLoc( const_cast<DiskLoc&>( slots[slot] ) ) = sibling;
+        }
+    }
+
+    void ExtendibleHash::doubleDirectory() {
+        const ExtendibleHashHead* h = head();
+        const int oldLen = sizeof( DiskLoc ) << h->globalDepth;
+
+        string ns = _idx.indexNamespace();
+        DiskLoc bigger = theDataFileMgr.insert( ns.c_str(), 0, oldLen * 2, false, true );
+        char* to = static_cast<char*>( getDur().writingPtr( bigger.rec()->data(), oldLen * 2 ) );
+        const char* from = h->directory.rec()->data();
+        memcpy( to, from, oldLen );
+        memcpy( to + oldLen, from, oldLen );
+
+        DiskLoc old = h->directory;
+        ExtendibleHashHead* w = getDur().writing( const_cast<ExtendibleHashHead*>( h ) );
+        w->directory = bigger;
+        w->globalDepth++;
+        freeRecord( old );
+    }
+
+    void ExtendibleHash::fill( const DiskLoc& first, int localDepth,
+                               const std::vector<ExtendibleHashEntry>& entries ) {
+        // free what the chain had beyond its first bucket, fill() allocates what it needs
+        DiskLoc extra = bucketAt( first )->overflow;
+        while ( !extra.isNull() ) {
+            DiskLoc next = bucketAt( extra )->overflow;
+            freeRecord( extra );
+            extra = next;
+        }
+
+        DiskLoc cur = first;
+        size_t done = 0;
+        while ( true ) {
+            size_t n = entries.size() - done;
+            if ( n > static_cast<size_t>( BucketCapacity ) ) {
+                n = BucketCapacity;
+            }
+            ExtendibleHashBucket* b = bucketForWriting( cur, BucketHeaderSize +
+                                                        n * sizeof( ExtendibleHashEntry ) );
+            b->localDepth = localDepth;
+            b->n = n;
+            b->overflow.Null();
+            if ( n ) {
+                memcpy( b->entries, &entries[done], n * sizeof( ExtendibleHashEntry ) );
+            }
+            done += n;
+            if ( done == entries.size() ) {
+                return;
+            }
+            cur = allocBucket( localDepth );
+            b->overflow = cur;
+        }
+    }
+
+    DiskLoc ExtendibleHash::allocBucket( int localDepth ) {
+        string ns = _idx.indexNamespace();
+        DiskLoc loc = theDataFileMgr.insert( ns.c_str(), 0, BucketSize, false, true );
+        ExtendibleHashBucket* b = bucketForWriting( loc, BucketHeaderSize );
+        b->localDepth = localDepth;
+        b->n = 0;
+        b->overflow.Null();
+        return loc;
+    }
+
+    void ExtendibleHash::freeRecord( const DiskLoc& loc ) {
+        string ns = _idx.indexNamespace();
+        theDataFileMgr._deleteRecord( nsdetails( ns ), ns, loc.rec(), loc );
+    }
+
+    long long ExtendibleHash::validate() const {
+        const int globalDepth = head()->globalDepth;
+        const DiskLoc* slots = directory();
+
+        long long n = 0;
+        for ( unsigned long long slot = 0; slot < ( 1ULL << globalDepth ); slot++ ) {
+            const int localDepth = bucketAt( slots[slot] )->localDepth;
+            massert( 17334, str::stream() << "hashtable slot " << slot << " has local depth "
+                                          << localDepth << " above " << globalDepth,
+                     localDepth <= globalDepth );
+            massert( 17335, str::stream() << "hashtable slot " << slot << " has the wrong chain",
+                     slots[slot] == slots[ slot & lowBits( localDepth ) ] );
+            if ( slot > lowBits( localDepth ) ) {
+                // counted at its lowest slot
+                continue;
+            }
+
+            for ( DiskLoc cur = slots[slot]; !cur.isNull(); cur = bucketAt( cur )->overflow ) {
+                const ExtendibleHashBucket* b = bucketAt( cur );
+                massert( 17336, str::stream() << "hashtable bucket " << cur.toString()
+                                              << " is corrupt",
+                         b->localDepth == localDepth && b->n >= 0 && b->n <= BucketCapacity );
+                for ( int i = 0; i < b->n; i++ ) {
+                    massert( 17337, str::stream() << "hashtable entry in the wrong chain: "
+                                                  << b->entries[i].hash,
+                             ( b->entries[i].hash & lowBits( localDepth ) ) == slot );
+                }
+                n += b->n;
+            }
+        }
+        return n;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,142 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+
+namespace mongo {
+
+    class IndexDetails;
+
+#pragma pack(1)
+    struct ExtendibleHashEntry {
+        long long hash;
+        DiskLoc loc;
+    };
+
+    /** IndexDetails::head of a hashtable index points at this record */
+    struct ExtendibleHashHead {
+        int version;
+        int globalDepth;
+        DiskLoc directory;      // 1 << globalDepth DiskLocs, the first bucket of each slot's chain
+        long long reserved;
+    };
+
+    struct ExtendibleHashBucket {
+        int localDepth;         // the chain holds every hash whose low localDepth bits match
+        int n;
+        DiskLoc overflow;       // next bucket of the chain, for hashes that won't split apart
+        ExtendibleHashEntry entries[1];
+    };
+#pragma pack()
+
+    /**
+     * The on disk structure of a "hashtable" index: an extendible hash table of (hash, DiskLoc)
+     * entries.  The low globalDepth bits of a hash pick a directory slot, and each slot points
+     * at a chain of buckets, so a lookup reads the directory and one bucket no matter how big
+     * the index gets.  A full bucket splits on its next hash bit, doubling the directory if it
+     * has to.  Entries that can't be split apart (the same hash, or MaxDepth reached) go into
+     * overflow buckets on the chain instead.  Buckets are never merged.
+     *
+     * Its records live in the index namespace, like btree buckets.  This holds no state of its
+     * own, so it is cheap to make one whenever it is needed.  Caller holds the write lock for
+     * anything that modifies the table.
+     */
+    class ExtendibleHash {
+    public:
+        static const int Version = 1;
+        static const int BucketSize = 8192;
+        static const int BucketCapacity =
+            ( BucketSize - sizeof( ExtendibleHashBucket ) + sizeof( ExtendibleHashEntry ) ) /
+            sizeof( ExtendibleHashEntry );
+        // so the largest directory is 8MB
+        static const int MaxDepth = 20;
+
+        explicit ExtendibleHash( const IndexDetails& idx ) : _idx( idx ) {}
+
+        /**
+         * Allocate an empty table with room for about 'expectedEntries' before its first split.
+         * @return where its head is, for IndexDetails::head
+         */
+        static DiskLoc create( const IndexDetails& idx, long long expectedEntries );
+
+        /** @return false if (hash, loc) was already there */
+        bool insert( long long hash, const DiskLoc& loc );
+
+        /** @return false if (hash, loc) wasn't there */
+        bool remove( long long hash, const DiskLoc& loc );
+
+        /** append the entries of the chain 'hash' belongs to, in no particular order */
+        void getChain( long long hash, std::vector<ExtendibleHashEntry>* out ) const;
+
+        /**
+         * Chains hold contiguous ranges of walkOrder(), so walking them in this order is not
+         * disturbed by splits.  Append the entries of the chain holding 'order' and set *next
+         * to where the next chain starts.
+         * @return false if this is the last chain.
+         */
+        bool getChainAt( unsigned long long order, std::vector<ExtendibleHashEntry>* out,
+                         unsigned long long* next ) const;
+
+        /** the low bits of a hash, most significant first */
+        static unsigned long long walkOrder( long long hash );
+
+        /**
+         * Check that every entry is in the chain its hash says it should be in.
+         * @return the number of entries
+         */
+        long long validate() const;
+
+    private:
+        const ExtendibleHashHead* head() const;
+        const DiskLoc* directory() const;
+        DiskLoc chainFor( long long hash ) const;
+
+        /** redistribute the chain starting at 'first' across it and a new sibling */
+        void split( const DiskLoc& first, long long hash );
+
+        /** @return true if splitting the chain 'hash' belongs to would separate anything */
+        bool canSplit( const DiskLoc& first, long long hash ) const;
+
+        void doubleDirectory();
+
+        /** rewrite the chain starting at 'first' to hold exactly 'entries' */
+        void fill( const DiskLoc& first, int localDepth,
+                   const std::vector<ExtendibleHashEntry>& entries );
+
+        DiskLoc allocBucket( int localDepth );
+        void freeRecord( const DiskLoc& loc );
+
+        const IndexDetails& _idx;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,172 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#include "mongo/db/index/hash_table_access_method.h"
+
+#include "mongo/db/hasher.h"
+#include "mongo/db/index/extendible_hash.h"
+#include "mongo/db/index/hash_access_method.h"
+#include "mongo/db/index/hash_table_index_cursor.h"
+#include "mongo/db/pdfile.h"
+
+namespace mongo {
+
+    class HashTableAccessMethod::HashTablePrivateUpdateData
+        : public UpdateTicket::PrivateUpdateData {
+    public:
+        virtual ~HashTablePrivateUpdateData() { }
+
+        BSONObjSet oldKeys, newKeys;
+        DiskLoc loc;
+    };
+
+    HashTableAccessMethod::HashTableAccessMethod(IndexDescriptor* descriptor)
+        : _descriptor(descriptor) {
+
+        uassert(17330, "Currently only single field hashtable index supported.",
+                1 == descriptor->getNumFields());
+        uassert(17331, "hashtable indexes cannot guarantee uniqueness. Use a regular index.",
+                !descriptor->unique());
+        // The query planner hashes values with the default seed.
+        uassert(17332, "hashtable indexes only use the default seed and hash version",
+                descriptor->getInfoElement("seed").eoo()
+                && descriptor->getInfoElement("hashVersion").eoo());
+
+        _hashedField = descriptor->keyPattern().firstElement().fieldName();
+    }
+
+    void HashTableAccessMethod::getKeys(const BSONObj& obj, BSONObjSet* keys) {
+        HashAccessMethod::getKeysImpl(obj, _hashedField, BSONElementHasher::DEFAULT_HASH_SEED,
+                                      0, _descriptor->isSparse(), keys);
+    }
+
+    Status HashTableAccessMethod::insert(const BSONObj& obj, const DiskLoc& loc,
+                                         const InsertDeleteOptions& options,
+                                         int64_t* numInserted) {
+        BSONObjSet keys;
+        getKeys(obj, &keys);
+        *numInserted = 0;
+
+        ExtendibleHash table(_descriptor->getOnDisk());
+        for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+            table.insert(i->firstElement().numberLong(), loc);
+            ++*numInserted;
+        }
+
+        return Status::OK();
+    }
+
+    Status HashTableAccessMethod::remove(const BSONObj& obj, const DiskLoc& loc,
+                                         const InsertDeleteOptions& options,
+                                         int64_t* numDeleted) {
+        BSONObjSet keys;
+        getKeys(obj, &keys);
+        *numDeleted = 0;
+
+        ExtendibleHash table(_descriptor->getOnDisk());
+        for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+            if (table.remove(i->firstElement().numberLong(), loc)) {
+                ++*numDeleted;
+            }
+            else if (options.logIfError) {
+                log() << "unindex failed " << _descriptor->indexNamespace()
+                      << " key: " << *i << " " << loc.obj()["_id"] << endl;
+            }
+        }
+
+        return Status::OK();
+    }
+
+    Status HashTableAccessMethod::validateUpdate(const BSONObj& from, const BSONObj& to,
+                                                 const DiskLoc& loc,
+                                                 const InsertDeleteOptions& options,
+                                                 UpdateTicket* ticket) {
+        HashTablePrivateUpdateData* data = new HashTablePrivateUpdateData();
+        ticket->_indexSpecificUpdateData.reset(data);
+
+        getKeys(from, &data->oldKeys);
+        getKeys(to, &data->newKeys);
+        data->loc = loc;
+
+        // nothing to check, we're never unique
+        ticket->_isValid = true;
+        return Status::OK();
+    }
+
+    Status HashTableAccessMethod::update(const UpdateTicket& ticket, int64_t* numUpdated) {
+        if (!ticket._isValid) {
+            return Status(ErrorCodes::InternalError, "Invalid updateticket in update");
+        }
+
+        HashTablePrivateUpdateData* data =
+            static_cast<HashTablePrivateUpdateData*>(ticket._indexSpecificUpdateData.get());
+
+        *numUpdated = 0;
+        ExtendibleHash table(_descriptor->getOnDisk());
+
+        for (BSONObjSet::const_iterator i = data->newKeys.begin(); i != data->newKeys.end(); ++i) {
+            if (!data->oldKeys.count(*i)) {
+                table.insert(i->firstElement().numberLong(), data->loc);
+                ++*numUpdated;
+            }
+        }
+
+        for (BSONObjSet::const_iterator i = data->oldKeys.begin(); i != data->oldKeys.end(); ++i) {
+            if (!data->newKeys.count(*i)) {
+                table.remove(i->firstElement().numberLong(), data->loc);
+            }
+        }
+
+        return Status::OK();
+    }
+
+    Status HashTableAccessMethod::newCursor(IndexCursor** out) {
+        *out = new HashTableIndexCursor(_descriptor);
+        return Status::OK();
+    }
+
+    Status HashTableAccessMethod::touch(const BSONObj& obj) {
+        BSONObjSet keys;
+        getKeys(obj, &keys);
+
+        ExtendibleHash table(_descriptor->getOnDisk());
+        for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+            vector<ExtendibleHashEntry> unused;
+            table.getChain(i->firstElement().numberLong(), &unused);
+        }
+
+        return Status::OK();
+    }
+
+    Status HashTableAccessMethod::validate(int64_t* numKeys) {
+        *numKeys = ExtendibleHash(_descriptor->getOnDisk()).validate();
+        return Status::OK();
+    }
+
+}  // namespace mongo
@@ -0,0 +1,91 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#pragma once
+
+#include <string>
+
+#include "mongo/base/status.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/db/index/index_access_method.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * The access method for "hashtable" indices, e.g. {user: "hashtable"}.  The keys are the
+     * same 64 bit hashes a "hashed" index has, but they go in an ExtendibleHash rather than a
+     * btree, so finding a value costs one directory slot and one bucket however big the index
+     * is.  There is no key order, so the only useful bounds are points.
+     *
+     * Meant for equality lookups on high cardinality fields: the records of one value all go
+     * in one chain of buckets, which a value with very many records makes long.
+     */
+    class HashTableAccessMethod : public IndexAccessMethod {
+    public:
+        HashTableAccessMethod(IndexDescriptor* descriptor);
+        virtual ~HashTableAccessMethod() { }
+
+        virtual Status insert(const BSONObj& obj,
+                              const DiskLoc& loc,
+                              const InsertDeleteOptions& options,
+                              int64_t* numInserted);
+
+        virtual Status remove(const BSONObj& obj,
+                              const DiskLoc& loc,
+                              const InsertDeleteOptions& options,
+                              int64_t* numDeleted);
+
+        virtual Status validateUpdate(const BSONObj& from,
+                                      const BSONObj& to,
+                                      const DiskLoc& loc,
+                                      const InsertDeleteOptions& options,
+                                      UpdateTicket* ticket);
+
+        virtual Status update(const UpdateTicket& ticket, int64_t* numUpdated);
+
+        virtual Status newCursor(IndexCursor** out);
+
+        virtual Status touch(const BSONObj& obj);
+
+        virtual Status validate(int64_t* numKeys);
+
+    private:
+        class HashTablePrivateUpdateData;
+
+        void getKeys(const BSONObj& obj, BSONObjSet* keys);
+
+        IndexDescriptor* _descriptor;
+
+        // Only one of our fields is hashed.  This is the field name for it.
+        string _hashedField;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,158 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#include "mongo/db/index/hash_table_index_cursor.h"
+
+#include <algorithm>
+
+namespace mongo {
+
+    namespace {
+
+        bool walksBefore(const ExtendibleHashEntry& a, const ExtendibleHashEntry& b) {
+            unsigned long long orderA = ExtendibleHash::walkOrder(a.hash);
+            unsigned long long orderB = ExtendibleHash::walkOrder(b.hash);
+            if (orderA != orderB) {
+                return orderA < orderB;
+            }
+            return a.loc < b.loc;
+        }
+
+    }  // namespace
+
+    HashTableIndexCursor::HashTableIndexCursor(IndexDescriptor* descriptor)
+        : _descriptor(descriptor), _oneHash(false), _hash(0), _pos(0), _moreChains(false),
+          _nextChain(0), _savedHash(0) { }
+
+    bool HashTableIndexCursor::isEOF() const { return _pos >= _entries.size(); }
+
+    Status HashTableIndexCursor::setOptions(const CursorOptions& options) {
+        return Status::OK();
+    }
+
+    Status HashTableIndexCursor::seek(const BSONObj& position) {
+        BSONElement hash = position.firstElement();
+        if (hash.isNumber()) {
+            seekHash(hash.numberLong());
+        }
+        else {
+            seekAll();
+        }
+        return Status::OK();
+    }
+
+    void HashTableIndexCursor::seekHash(long long hash) {
+        _oneHash = true;
+        _hash = hash;
+        locate(ExtendibleHash::walkOrder(hash), DiskLoc());
+    }
+
+    void HashTableIndexCursor::seekAll() {
+        _oneHash = false;
+        locate(0, DiskLoc());
+    }
+
+    void HashTableIndexCursor::locate(unsigned long long order, DiskLoc loc) {
+        ExtendibleHash table(_descriptor->getOnDisk());
+        _entries.clear();
+        _pos = 0;
+
+        while (true) {
+            vector<ExtendibleHashEntry> chain;
+            unsigned long long next = 0;
+            bool more = table.getChainAt(order, &chain, &next);
+
+            for (size_t i = 0; i < chain.size(); ++i) {
+                const ExtendibleHashEntry& e = chain[i];
+                if (_oneHash && e.hash != _hash) {
+                    continue;
+                }
+                unsigned long long entryOrder = ExtendibleHash::walkOrder(e.hash);
+                if (entryOrder < order || (entryOrder == order && e.loc < loc)) {
+                    continue;
+                }
+                _entries.push_back(e);
+            }
+
+            if (!_entries.empty() || _oneHash || !more) {
+                std::sort(_entries.begin(), _entries.end(), walksBefore);
+                _moreChains = more && !_oneHash;
+                _nextChain = next;
+                break;
+            }
+
+            // nothing left in this chain, try the next one
+            order = next;
+            loc = DiskLoc();
+        }
+
+        if (!isEOF()) {
+            _key = BSON("" << _entries[_pos].hash);
+        }
+    }
+
+    BSONObj HashTableIndexCursor::getKey() const {
+        verify(!isEOF());
+        return _key;
+    }
+
+    DiskLoc HashTableIndexCursor::getValue() const {
+        verify(!isEOF());
+        return _entries[_pos].loc;
+    }
+
+    void HashTableIndexCursor::next() {
+        verify(!isEOF());
+        if (++_pos < _entries.size()) {
+            _key = BSON("" << _entries[_pos].hash);
+        }
+        else if (_moreChains) {
+            locate(_nextChain, DiskLoc());
+        }
+    }
+
+    Status HashTableIndexCursor::savePosition() {
+        if (isEOF()) {
+            return Status(ErrorCodes::InternalError, "can't save position at EOF");
+        }
+        _savedHash = _entries[_pos].hash;
+        _savedLoc = _entries[_pos].loc;
+        return Status::OK();
+    }
+
+    Status HashTableIndexCursor::restorePosition() {
+        locate(ExtendibleHash::walkOrder(_savedHash), _savedLoc);
+        return Status::OK();
+    }
+
+    string HashTableIndexCursor::toString() {
+        return "HashTableIndexCursor";
+    }
+
+}  // namespace mongo
@@ -0,0 +1,109 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/status.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/db/index/extendible_hash.h"
+#include "mongo/db/index/index_cursor.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * Returns the { "": NumberLong(hash) } keys of a hashtable index, either all of those with
+     * one hash or every key in the index.  Keys don't come back in key order: a walk goes chain
+     * by chain in ExtendibleHash::walkOrder(), and within a hash keys are in DiskLoc order.
+     *
+     * Positions are always re-found from the saved (hash, record) on restore.  Chains only ever
+     * split into later parts of the walk, so that is enough to see every entry once.
+     */
+    class HashTableIndexCursor : public IndexCursor {
+    public:
+        virtual ~HashTableIndexCursor() { }
+
+        virtual bool isEOF() const;
+
+        // There is no order to go backwards in.
+        virtual Status setOptions(const CursorOptions& options);
+
+        /** a { "": NumberLong } position seeks that hash, anything else walks the whole index */
+        virtual Status seek(const BSONObj& position);
+
+        /** go to the first record whose key is 'hash' */
+        void seekHash(long long hash);
+
+        /** go to the first entry of the walk */
+        void seekAll();
+
+        virtual BSONObj getKey() const;
+        virtual DiskLoc getValue() const;
+        virtual void next();
+
+        virtual Status savePosition();
+
+        virtual Status restorePosition();
+
+        virtual string toString();
+
+    private:
+        // We keep the constructor private and only allow the AM to create us.
+        friend class HashTableAccessMethod;
+
+        HashTableIndexCursor(IndexDescriptor* descriptor);
+
+        /**
+         * Go to the first entry at or after (order, loc) in the walk, only looking at hash
+         * _hash if _oneHash.
+         */
+        void locate(unsigned long long order, DiskLoc loc);
+
+        IndexDescriptor* _descriptor;
+
+        bool _oneHash;
+        long long _hash;
+
+        // What's left of the chain we are on, in walk order, and where the next chain starts.
+        vector<ExtendibleHashEntry> _entries;
+        size_t _pos;
+        bool _moreChains;
+        unsigned long long _nextChain;
+
+        BSONObj _key;
+
+        // For saving/restoring position.
+        long long _savedHash;
+        DiskLoc _savedLoc;
+    };
+
+}  // namespace mongo
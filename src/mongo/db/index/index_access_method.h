@@ -79,6 +79,26 @@ namespace mongo {
                               const InsertDeleteOptions& options,
                               int64_t* numDeleted) = 0;
 
+        /**
+         * Remove the keys of each (document, location) pair in 'docs', as remove() would for each
+         * in turn.  If not NULL, numDeleted will be set to the number of keys removed in all.
+         * Access methods which can do better than a document at a time, e.g. by removing all the
+         * keys in index order, override this.
+         */
+        virtual Status removeBulk(const vector<pair<BSONObj, DiskLoc> >& docs,
+                                  const InsertDeleteOptions& options,
+                                  int64_t* numDeleted) {
+            int64_t total = 0;
+            for (size_t i = 0; i < docs.size(); ++i) {
+                int64_t removed = 0;
+                Status status = remove(docs[i].first, docs[i].second, options, &removed);
+                if (!status.isOK()) { return status; }
+                total += removed;
+            }
+            if (NULL != numDeleted) { *numDeleted = total; }
+            return Status::OK();
+        }
+
         /**
          * Checks whether the index entries for the document 'from', which is placed at location
          * 'loc' on disk, can be changed to the index entries for the doc 'to'. Provides a ticket
@@ -131,12 +151,33 @@ namespace mongo {
         virtual Status validate(int64_t* numKeys) = 0;
 
         //
-        // Bulk operations support (TODO)
+        // Bulk operations support
         //
 
-        // virtual Status insertBulk(BulkDocs arg) = 0;
+        /**
+         * For inserting the keys of a group of documents together, in index order rather than
+         * document by document: appends the keys of 'obj', each paired with 'loc', to 'keys'
+         * for a later insertKeysSorted().
+         *
+         * Return false if this index can't defer its keys, and 'obj' must be inserted with
+         * insert() instead.
+         */
+        virtual bool getKeysForBulkInsert(const BSONObj& obj,
+                                          const DiskLoc& loc,
+                                          const InsertDeleteOptions& options,
+                                          vector<pair<BSONObj, DiskLoc> >* keys) {
+            return false;
+        }
 
-        // virtual Status removeBulk(BulkDocs arg) = 0;
+        /**
+         * Sorts and inserts keys from getKeysForBulkInsert().  A key which can't be inserted
+         * doesn't stop the others: the location it points to is added to 'failed', and the
+         * first such error returned.
+         */
+        virtual Status insertKeysSorted(vector<pair<BSONObj, DiskLoc> >* keys,
+                                        set<DiskLoc>* failed) {
+            return Status(ErrorCodes::InternalError, "index can't insert keys in bulk");
+        }
     };
 
     /**
@@ -150,6 +191,8 @@ namespace mongo {
     protected:
         // These friends are the classes that actually fill out an UpdateStatus.
         friend class BtreeBasedAccessMethod;
+        friend class PostingAccessMethod;
+        friend class HashTableAccessMethod;
 
         class PrivateUpdateData;
 
@@ -138,6 +138,8 @@ namespace mongo {
 
     // All the options we might want to set on a cursor.
     struct CursorOptions {
+        CursorOptions() : direction(INCREASING), numWanted(0), prefetchRecords(false) { }
+
         // Set the direction of the scan.  Ignored if the cursor doesn't have directions (geo).
         enum Direction {
             DECREASING = -1,
@@ -149,6 +151,10 @@ namespace mongo {
         // 2d indices need to know exactly how many results you want beforehand.
         // Ignored by every other index.
         int numWanted;
+
+        // The caller will fetch the records the keys point at, so the cursor may ask the OS to
+        // start reading them in ahead of time.  Only a hint.
+        bool prefetchRecords;
     };
 
 }  // namespace mongo
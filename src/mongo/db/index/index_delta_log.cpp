@@ -0,0 +1,88 @@
+// index_delta_log.cpp
+
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#include "mongo/db/index/index_delta_log.h"
+
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    AtomicUInt32 IndexDeltaLog::_numActive;
+    std::map<std::string, IndexDeltaLog*> IndexDeltaLog::_active;
+    SimpleMutex IndexDeltaLog::_m("indexDeltaLog");
+
+    IndexDeltaLog::IndexDeltaLog(const StringData& indexNamespace, long long maxBytes)
+        : _indexNamespace(indexNamespace.toString()),
+          _bytes(0),
+          _maxBytes(maxBytes),
+          _overflowed(false) {
+        SimpleMutex::scoped_lock lk(_m);
+        verify(_active.count(_indexNamespace) == 0);
+        _active[_indexNamespace] = this;
+        _numActive.fetchAndAdd(1);
+    }
+
+    IndexDeltaLog::~IndexDeltaLog() {
+        SimpleMutex::scoped_lock lk(_m);
+        _active.erase(_indexNamespace);
+        _numActive.fetchAndSubtract(1);
+    }
+
+    void IndexDeltaLog::noteInsert(const BSONObj& key, const DiskLoc& loc) {
+        add(true, key, loc);
+    }
+
+    void IndexDeltaLog::noteRemove(const BSONObj& key, const DiskLoc& loc) {
+        add(false, key, loc);
+    }
+
+    void IndexDeltaLog::add(bool insert, const BSONObj& key, const DiskLoc& loc) {
+        if (_overflowed)
+            return;
+        _bytes += key.objsize() + sizeof(Entry);
+        if (_bytes > _maxBytes) {
+            _overflowed = true;
+            std::vector<Entry>().swap(_entries);
+            return;
+        }
+        _entries.push_back(Entry(insert, key.getOwned(), loc));
+    }
+
+    IndexDeltaLog* IndexDeltaLog::get(const StringData& indexNamespace) {
+        if (_numActive.load() == 0)
+            return NULL;
+        SimpleMutex::scoped_lock lk(_m);
+        std::map<std::string, IndexDeltaLog*>::const_iterator i =
+            _active.find(indexNamespace.toString());
+        return i == _active.end() ? NULL : i->second;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,106 @@
+// index_delta_log.h
+
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "mongo/base/string_data.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    /**
+     * The writes made to an index while a background build of it is gathering keys for a bottom
+     * up build.  While one of these exists for an index namespace, BtreeBasedAccessMethod records
+     * the keys it would have inserted into or removed from that index here instead of touching
+     * the tree, and the builder replays them in order over the tree it builds.
+     *
+     * Replaying is idempotent with respect to what the scan saw: inserting a key that is already
+     * there and removing one that is not are both no-ops, so a document written before or after
+     * the scan passed it ends up indexed the same way.
+     *
+     * Entries are added under the database write lock, as are all writes to the index.  The log
+     * keeps at most 'maxBytes' of them: past that it drops what it has and only notes that it
+     * overflowed, as a build that can't replay every write has to be abandoned anyway, and the
+     * writers must not fail on its account.
+     */
+    class IndexDeltaLog : boost::noncopyable {
+    public:
+        struct Entry {
+            Entry(bool insert_, const BSONObj& key_, const DiskLoc& loc_)
+                : insert(insert_), key(key_), loc(loc_) {}
+            bool insert;
+            BSONObj key;   // owned
+            DiskLoc loc;
+        };
+
+        /** start diverting writes to 'indexNamespace' into this log */
+        IndexDeltaLog(const StringData& indexNamespace, long long maxBytes);
+
+        /** writes go to the tree again */
+        ~IndexDeltaLog();
+
+        void noteInsert(const BSONObj& key, const DiskLoc& loc);
+        void noteRemove(const BSONObj& key, const DiskLoc& loc);
+
+        const std::vector<Entry>& entries() const { return _entries; }
+        long long bytes() const { return _bytes; }
+
+        /** true once more than maxBytes of writes came in, which entries() is then missing */
+        bool overflowed() const { return _overflowed; }
+
+        /** @return the log writes to 'indexNamespace' should go to, or NULL */
+        static IndexDeltaLog* get(const StringData& indexNamespace);
+
+    private:
+        std::string _indexNamespace;
+        std::vector<Entry> _entries;
+        long long _bytes;
+        const long long _maxBytes;
+        bool _overflowed;
+
+        void add(bool insert, const BSONObj& key, const DiskLoc& loc);
+
+        // lets writers skip the lookup when no build is using a log
+        static AtomicUInt32 _numActive;
+        static std::map<std::string, IndexDeltaLog*> _active;
+        static SimpleMutex _m;
+    };
+
+}  // namespace mongo
@@ -140,6 +140,13 @@ namespace mongo {
         // Is this index multikey?
         bool isMultikey() const { _checkOk(); return _collection->details()->isMultikey(_indexNumber); }
 
+        // Which key pattern fields make it so?  Bit i for field i, see
+        // NamespaceDetails::multikeyFields.
+        unsigned multikeyFields() const {
+            _checkOk();
+            return _collection->details()->multikeyFields(_indexNumber);
+        }
+
         bool isIdIndex() const { _checkOk(); return _isIdIndex; }
 
         //
@@ -166,9 +173,10 @@ namespace mongo {
         // Return the info object.
         const BSONObj& infoObj() const { _checkOk(); return _infoObj; }
 
-        // Set multikey attribute.  We never unset it.
-        void setMultikey() {
-            _collection->getIndexCatalog()->markMultikey( this );
+        // Set multikey attribute.  We never unset it.  'fields' are those whose path went
+        // through an array, see BtreeBasedAccessMethod::getKeysAndMultikeyFields.
+        void setMultikey(unsigned fields = ~0u) {
+            _collection->getIndexCatalog()->markMultikey( this, true, fields );
         }
 
         // Is this index being created in the background?
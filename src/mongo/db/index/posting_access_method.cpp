@@ -0,0 +1,277 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#include "mongo/db/index/posting_access_method.h"
+
+#include <algorithm>
+
+#include "mongo/db/index/btree_interface.h"
+#include "mongo/db/index/posting_block.h"
+#include "mongo/db/index/posting_index_cursor.h"
+#include "mongo/db/pdfile.h"
+
+namespace mongo {
+
+    namespace {
+
+        /** locate 'key' and step past unused keys in 'direction'.  @return false if EOF */
+        bool locateUsed(BtreeInterface* interface, IndexDescriptor* descriptor,
+                        const Ordering& ordering, const BSONObj& key, const DiskLoc& recordLoc,
+                        int direction, DiskLoc* bucket, int* keyOffset) {
+            bool found;
+            *keyOffset = 0;
+            *bucket = interface->locate(descriptor->getOnDisk(), descriptor->getHead(), key,
+                                        ordering, *keyOffset, found, recordLoc, direction);
+            while (!bucket->isNull() && !interface->keyIsUsed(*bucket, *keyOffset)) {
+                *bucket = interface->advance(*bucket, *keyOffset, direction,
+                                             "PostingAccessMethod::locateUsed");
+            }
+            return !bucket->isNull();
+        }
+
+        bool isBlockOf(BtreeInterface* interface, const DiskLoc& bucket, int keyOffset,
+                       const BSONElement& value) {
+            BSONObj key = interface->keyAt(bucket, keyOffset);
+            return 0 == key.firstElement().woCompare(value, false);
+        }
+
+    }  // namespace
+
+    PostingAccessMethod::PostingAccessMethod(IndexDescriptor* descriptor)
+        : BtreeBasedAccessMethod(descriptor) {
+
+        uassert(17326, "Currently only single field posting index supported.",
+                1 == descriptor->getNumFields());
+        uassert(17327, "Posting indexes cannot be unique.  Use a regular index.",
+                !descriptor->unique());
+
+        // The keys are those of a regular btree index over the same field.
+        vector<const char*> fieldNames;
+        vector<BSONElement> fixed;
+        fieldNames.push_back(_descriptor->keyPattern().firstElement().fieldName());
+        fixed.push_back(BSONElement());
+
+        if (0 == descriptor->version()) {
+            _keyGenerator.reset(new BtreeKeyGeneratorV0(fieldNames, fixed,
+                _descriptor->isSparse()));
+        } else {
+            _keyGenerator.reset(new BtreeKeyGeneratorV1(fieldNames, fixed,
+                _descriptor->isSparse()));
+        }
+    }
+
+    void PostingAccessMethod::getKeys(const BSONObj& obj, BSONObjSet* keys) {
+        _keyGenerator->getKeys(obj, keys);
+    }
+
+    void PostingAccessMethod::getKeysAndMultikeyFields(const BSONObj& obj, BSONObjSet* keys,
+                                                       unsigned* multikeyFields) {
+        _keyGenerator->getKeys(obj, keys, multikeyFields);
+    }
+
+    Status PostingAccessMethod::newCursor(IndexCursor** out) {
+        *out = new PostingIndexCursor(_descriptor, _ordering, _interface);
+        return Status::OK();
+    }
+
+    bool PostingAccessMethod::findBlock(const BSONElement& value, const DiskLoc& loc,
+                                        bool onlyIfFirstBefore, DiskLoc* bucket,
+                                        int* keyOffset) const {
+        if (locateUsed(_interface, _descriptor, _ordering, PostingBlock::searchKey(value, loc),
+                       maxDiskLoc, -1, bucket, keyOffset)
+            && isBlockOf(_interface, *bucket, *keyOffset, value)) {
+            return true;
+        }
+
+        if (onlyIfFirstBefore) {
+            return false;
+        }
+
+        return locateUsed(_interface, _descriptor, _ordering,
+                          PostingBlock::boundaryKey(value, false), minDiskLoc, 1,
+                          bucket, keyOffset)
+            && isBlockOf(_interface, *bucket, *keyOffset, value);
+    }
+
+    void PostingAccessMethod::rewriteBlock(const DiskLoc& bucket, int keyOffset,
+                                           const BSONElement& value,
+                                           const std::vector<DiskLoc>& locs) {
+        // unindex frees what the old key points into
+        BSONObj oldKey = _interface->keyAt(bucket, keyOffset).getOwned();
+        _interface->unindex(_descriptor->getHead(), _descriptor->getOnDisk(), oldKey,
+                            _interface->recordAt(bucket, keyOffset));
+
+        vector<BSONObj> keys;
+        PostingBlock::makeKeys(value, locs, &keys);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            _interface->bt_insert(_descriptor->getHead(), PostingBlock::firstLoc(keys[i]),
+                                  keys[i], _ordering, true, _descriptor->getOnDisk(), true);
+        }
+    }
+
+    void PostingAccessMethod::addRecord(const BSONElement& value, const DiskLoc& loc) {
+        DiskLoc bucket;
+        int keyOffset;
+        if (!findBlock(value, loc, false, &bucket, &keyOffset)) {
+            vector<BSONObj> keys;
+            PostingBlock::makeKeys(value, vector<DiskLoc>(1, loc), &keys);
+            _interface->bt_insert(_descriptor->getHead(), loc, keys[0], _ordering, true,
+                                  _descriptor->getOnDisk(), true);
+            return;
+        }
+
+        BSONObj key = _interface->keyAt(bucket, keyOffset);
+        BSONElement unused;
+        vector<DiskLoc> locs;
+        PostingBlock::parseKey(key, &unused, &locs);
+
+        vector<DiskLoc>::iterator it = std::lower_bound(locs.begin(), locs.end(), loc);
+        if (it != locs.end() && *it == loc) {
+            // already there, i.e. bg indexing saw this record twice
+            return;
+        }
+        locs.insert(it, loc);
+
+        BSONObj valueObj = value.wrap("");
+        rewriteBlock(bucket, keyOffset, valueObj.firstElement(), locs);
+    }
+
+    bool PostingAccessMethod::removeRecord(const BSONElement& value, const DiskLoc& loc) {
+        DiskLoc bucket;
+        int keyOffset;
+        if (!findBlock(value, loc, true, &bucket, &keyOffset)) {
+            return false;
+        }
+
+        BSONObj key = _interface->keyAt(bucket, keyOffset);
+        BSONElement unused;
+        vector<DiskLoc> locs;
+        PostingBlock::parseKey(key, &unused, &locs);
+
+        vector<DiskLoc>::iterator it = std::lower_bound(locs.begin(), locs.end(), loc);
+        if (it == locs.end() || *it != loc) {
+            return false;
+        }
+        locs.erase(it);
+
+        BSONObj valueObj = value.wrap("");
+        rewriteBlock(bucket, keyOffset, valueObj.firstElement(), locs);
+        return true;
+    }
+
+    Status PostingAccessMethod::insert(const BSONObj& obj, const DiskLoc& loc,
+                                       const InsertDeleteOptions& options,
+                                       int64_t* numInserted) {
+        *numInserted = 0;
+
+        BSONObjSet keys;
+        unsigned multikeyFields;
+        getKeysAndMultikeyFields(obj, &keys, &multikeyFields);
+
+        Status ret = Status::OK();
+
+        for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+            try {
+                addRecord(i->firstElement(), loc);
+                ++*numInserted;
+            } catch (AssertionException& e) {
+                problem() << " caught assertion addKeysToIndex "
+                          << _descriptor->indexNamespace()
+                          << obj["_id"] << endl;
+                ret = Status(ErrorCodes::InternalError, e.what(), e.getCode());
+            }
+        }
+
+        if (*numInserted > 0 && multikeyFields) {
+            _descriptor->setMultikey(multikeyFields);
+        }
+
+        return ret;
+    }
+
+    Status PostingAccessMethod::remove(const BSONObj& obj, const DiskLoc& loc,
+                                       const InsertDeleteOptions& options,
+                                       int64_t* numDeleted) {
+        BSONObjSet keys;
+        getKeys(obj, &keys);
+        *numDeleted = 0;
+
+        for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+            if (removeRecord(i->firstElement(), loc)) {
+                ++*numDeleted;
+            } else if (options.logIfError) {
+                log() << "unindex failed " << _descriptor->indexNamespace()
+                      << " key: " << *i << " " << loc.obj()["_id"] << endl;
+            }
+        }
+
+        return Status::OK();
+    }
+
+    Status PostingAccessMethod::update(const UpdateTicket& ticket, int64_t* numUpdated) {
+        if (!ticket._isValid) {
+            return Status(ErrorCodes::InternalError, "Invalid updateticket in update");
+        }
+
+        BtreeBasedPrivateUpdateData* data =
+            static_cast<BtreeBasedPrivateUpdateData*>(ticket._indexSpecificUpdateData.get());
+
+        if (data->newMultikeyFields) {
+            _descriptor->setMultikey(data->newMultikeyFields);
+        }
+
+        for (size_t i = 0; i < data->added.size(); ++i) {
+            addRecord(data->added[i]->firstElement(), data->loc);
+        }
+
+        for (size_t i = 0; i < data->removed.size(); ++i) {
+            removeRecord(data->removed[i]->firstElement(), data->loc);
+        }
+
+        *numUpdated = data->added.size();
+
+        return Status::OK();
+    }
+
+    Status PostingAccessMethod::validate(int64_t* numKeys) {
+        // checks the btree itself
+        BtreeBasedAccessMethod::validate(numKeys);
+
+        *numKeys = 0;
+        IndexCursor* raw;
+        newCursor(&raw);
+        auto_ptr<IndexCursor> cursor(raw);
+        cursor->seek(BSON("" << MINKEY));
+        for (; !cursor->isEOF(); cursor->next()) {
+            ++*numKeys;
+        }
+        return Status::OK();
+    }
+
+}  // namespace mongo
@@ -0,0 +1,100 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+#include "mongo/base/status.h"
+#include "mongo/db/index/btree_access_method_internal.h"
+#include "mongo/db/index/btree_key_generator.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * The access method for "posting" indices, e.g. {status: "posting"}.  Meant for fields
+     * with few distinct values: each value is stored once per block of up to a couple hundred
+     * records rather than once per record, see PostingBlock.  Cursors return one
+     * { "": value } key per record, in value and then DiskLoc order, like a regular btree.
+     */
+    class PostingAccessMethod : public BtreeBasedAccessMethod {
+    public:
+        using BtreeBasedAccessMethod::_descriptor;
+        using BtreeBasedAccessMethod::_interface;
+        using BtreeBasedAccessMethod::_ordering;
+
+        PostingAccessMethod(IndexDescriptor* descriptor);
+        virtual ~PostingAccessMethod() { }
+
+        virtual Status insert(const BSONObj& obj,
+                              const DiskLoc& loc,
+                              const InsertDeleteOptions& options,
+                              int64_t* numInserted);
+
+        virtual Status remove(const BSONObj& obj,
+                              const DiskLoc& loc,
+                              const InsertDeleteOptions& options,
+                              int64_t* numDeleted);
+
+        virtual Status update(const UpdateTicket& ticket, int64_t* numUpdated);
+
+        virtual Status newCursor(IndexCursor** out);
+
+        /** counts records, not block keys */
+        virtual Status validate(int64_t* numKeys);
+
+    private:
+        virtual void getKeys(const BSONObj& obj, BSONObjSet* keys);
+        virtual void getKeysAndMultikeyFields(const BSONObj& obj, BSONObjSet* keys,
+                                              unsigned* multikeyFields);
+
+        /**
+         * Find the block 'loc' belongs in under 'value': the last one whose first record is
+         * <= loc, or else the first one.
+         * @return false if value has no blocks, or 'onlyIfFirstBefore' and loc is before
+         *         all of them.
+         */
+        bool findBlock(const BSONElement& value, const DiskLoc& loc, bool onlyIfFirstBefore,
+                       DiskLoc* bucket, int* keyOffset) const;
+
+        /** replace the block at (bucket, keyOffset) with blocks holding 'locs', if any */
+        void rewriteBlock(const DiskLoc& bucket, int keyOffset, const BSONElement& value,
+                          const std::vector<DiskLoc>& locs);
+
+        void addRecord(const BSONElement& value, const DiskLoc& loc);
+
+        bool removeRecord(const BSONElement& value, const DiskLoc& loc);
+
+        scoped_ptr<BtreeKeyGenerator> _keyGenerator;
+    };
+
+}  // namespace mongo
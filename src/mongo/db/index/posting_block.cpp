@@ -0,0 +1,156 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#include "mongo/db/index/posting_block.h"
+
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    namespace {
+
+        void appendVarint(BufBuilder* b, unsigned long long v) {
+            while (v >= 0x80) {
+                b->appendUChar(static_cast<unsigned char>(v | 0x80));
+                v >>= 7;
+            }
+            b->appendUChar(static_cast<unsigned char>(v));
+        }
+
+        unsigned long long readVarint(const char*& p, const char* end) {
+            unsigned long long v = 0;
+            for (int shift = 0; ; shift += 7) {
+                massert(17328, "corrupt posting block", p < end && shift < 64);
+                unsigned char c = *p++;
+                v |= static_cast<unsigned long long>(c & 0x7f) << shift;
+                if (!(c & 0x80)) {
+                    return v;
+                }
+            }
+        }
+
+        void appendDelta(BufBuilder* b, const DiskLoc& prev, const DiskLoc& loc) {
+            if (loc.a() == prev.a()) {
+                appendVarint(b, static_cast<unsigned long long>(loc.getOfs() - prev.getOfs()) << 1);
+            }
+            else {
+                appendVarint(b, (static_cast<unsigned long long>(loc.a() - prev.a()) << 1) | 1);
+                appendVarint(b, static_cast<unsigned long long>(loc.getOfs()));
+            }
+        }
+
+        BSONObj makeKey(const BSONElement& value, const DiskLoc& first, const BufBuilder& rest) {
+            BSONObjBuilder b;
+            b.appendAs(value, "");
+            b.append("", PostingBlock::packLoc(first));
+            b.appendBinData("", rest.len(), BinDataGeneral, rest.buf());
+            return b.obj();
+        }
+
+    }  // namespace
+
+    // static
+    void PostingBlock::makeKeys(const BSONElement& value, const std::vector<DiskLoc>& locs,
+                                std::vector<BSONObj>* keys) {
+        // the value, the first record and the BinData header
+        const int overhead = value.size() - value.fieldNameSize() + 1 + 32;
+
+        size_t i = 0;
+        while (i < locs.size()) {
+            const DiskLoc first = locs[i++];
+            BufBuilder rest;
+            while (i < locs.size() && overhead + rest.len() + 10 <= MaxKeyBytes) {
+                dassert(locs[i - 1] < locs[i]);
+                appendDelta(&rest, locs[i - 1], locs[i]);
+                ++i;
+            }
+            keys->push_back(makeKey(value, first, rest));
+        }
+    }
+
+    // static
+    void PostingBlock::parseKey(const BSONObj& key, BSONElement* value,
+                                std::vector<DiskLoc>* locs) {
+        BSONObjIterator it(key);
+        *value = it.next();
+        BSONElement first = it.next();
+        BSONElement rest = it.next();
+        massert(17329, "corrupt posting block",
+                NumberLong == first.type() && BinData == rest.type());
+
+        locs->clear();
+        DiskLoc loc = unpackLoc(first.numberLong());
+        locs->push_back(loc);
+
+        int len;
+        const char* p = rest.binData(len);
+        const char* end = p + len;
+        while (p < end) {
+            unsigned long long v = readVarint(p, end);
+            if (v & 1) {
+                int a = loc.a() + static_cast<int>(v >> 1);
+                loc = DiskLoc(a, static_cast<int>(readVarint(p, end)));
+            }
+            else {
+                loc = DiskLoc(loc.a(), loc.getOfs() + static_cast<int>(v >> 1));
+            }
+            locs->push_back(loc);
+        }
+    }
+
+    // static
+    DiskLoc PostingBlock::firstLoc(const BSONObj& key) {
+        BSONObjIterator it(key);
+        it.next();
+        return unpackLoc(it.next().numberLong());
+    }
+
+    // static
+    BSONObj PostingBlock::searchKey(const BSONElement& value, const DiskLoc& loc) {
+        BSONObjBuilder b;
+        b.appendAs(value, "");
+        b.append("", packLoc(loc));
+        b.appendMaxKey("");
+        return b.obj();
+    }
+
+    // static
+    BSONObj PostingBlock::boundaryKey(const BSONElement& value, bool after) {
+        BSONObjBuilder b;
+        b.appendAs(value, "");
+        if (after) {
+            b.appendMaxKey("");
+        }
+        else {
+            b.appendMinKey("");
+        }
+        return b.obj();
+    }
+
+}  // namespace mongo
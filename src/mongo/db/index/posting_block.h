@@ -0,0 +1,90 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * The on disk layout of a posting index: rather than one btree key per document, the
+     * records that share a value are kept together in "blocks", each one btree key
+     *
+     *     { "": value, "": NumberLong(first record), "": BinData(the other records) }
+     *
+     * whose recordLoc is its first record.  The records in a block are sorted and all of them
+     * but the first are delta encoded as varints against the one before: varint(ofsDelta << 1)
+     * within the same file, varint((fileDelta << 1) | 1) followed by varint(ofs) otherwise.
+     * Blocks of a value are ordered by their first record and never overlap, so the records a
+     * value points at come out of the index in DiskLoc order.
+     */
+    class PostingBlock {
+    public:
+        // Keep block keys well under the btree's KeyMax, whatever the key version.
+        static const int MaxKeyBytes = 640;
+
+        /**
+         * Pack sorted, distinct 'locs' for 'value' into as few block keys as fit.
+         */
+        static void makeKeys(const BSONElement& value, const std::vector<DiskLoc>& locs,
+                             std::vector<BSONObj>* keys);
+
+        /**
+         * Unpack a block key.  *value points into 'key'.
+         */
+        static void parseKey(const BSONObj& key, BSONElement* value, std::vector<DiskLoc>* locs);
+
+        /** the first record of a block key, also its recordLoc in the btree */
+        static DiskLoc firstLoc(const BSONObj& key);
+
+        /**
+         * A key that sorts after every block of 'value' whose first record is <= 'loc' and
+         * before all the others.
+         */
+        static BSONObj searchKey(const BSONElement& value, const DiskLoc& loc);
+
+        /**
+         * A key that sorts before (after, if 'after') every block of 'value'.
+         */
+        static BSONObj boundaryKey(const BSONElement& value, bool after);
+
+        static long long packLoc(const DiskLoc& loc) {
+            return (static_cast<long long>(loc.a()) << 32) | static_cast<unsigned>(loc.getOfs());
+        }
+
+        static DiskLoc unpackLoc(long long packed) {
+            return DiskLoc(static_cast<int>(packed >> 32), static_cast<int>(packed & 0xffffffff));
+        }
+    };
+
+}  // namespace mongo
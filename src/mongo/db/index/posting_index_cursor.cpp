@@ -0,0 +1,185 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#include "mongo/db/index/posting_index_cursor.h"
+
+#include <algorithm>
+
+#include "mongo/db/index/posting_block.h"
+
+namespace mongo {
+
+    // Go forward by default.
+    PostingIndexCursor::PostingIndexCursor(IndexDescriptor* descriptor, Ordering ordering,
+                                           BtreeInterface* interface)
+        : _direction(1), _descriptor(descriptor), _ordering(ordering), _interface(interface),
+          _keyOffset(0), _locPos(0) { }
+
+    bool PostingIndexCursor::isEOF() const { return _bucket.isNull(); }
+
+    Status PostingIndexCursor::setOptions(const CursorOptions& options) {
+        if (CursorOptions::DECREASING == options.direction) {
+            _direction = -1;
+        } else {
+            _direction = 1;
+        }
+        return Status::OK();
+    }
+
+    Status PostingIndexCursor::seek(const BSONObj& position) {
+        seekValue(position.firstElement(), true);
+        return Status::OK();
+    }
+
+    Status PostingIndexCursor::seek(const vector<const BSONElement*>& position,
+                                    const vector<bool>& inclusive) {
+        seekValue(*position[0], inclusive[0]);
+        return Status::OK();
+    }
+
+    Status PostingIndexCursor::skip(const BSONObj &keyBegin, int keyBeginLen, bool afterKey,
+                                    const vector<const BSONElement*>& keyEnd,
+                                    const vector<bool>& keyEndInclusive) {
+        if (keyBeginLen > 0) {
+            seekValue(keyBegin.firstElement(), !afterKey);
+        }
+        else {
+            seekValue(*keyEnd[0], keyEndInclusive[0]);
+        }
+        return Status::OK();
+    }
+
+    BSONObj PostingIndexCursor::getKey() const {
+        verify(!_bucket.isNull());
+        return _value;
+    }
+
+    DiskLoc PostingIndexCursor::getValue() const {
+        verify(!_bucket.isNull());
+        return _locs[_locPos];
+    }
+
+    void PostingIndexCursor::next() {
+        if (1 == _direction) {
+            if (++_locPos < _locs.size()) { return; }
+        }
+        else if (_locPos > 0) {
+            --_locPos;
+            return;
+        }
+        advanceBlock(_direction);
+        loadBlock();
+    }
+
+    Status PostingIndexCursor::savePosition() {
+        if (isEOF()) {
+            return Status(ErrorCodes::IllegalOperation, "Can't save position when EOF");
+        }
+        _savedValue = _value;
+        _savedLoc = getValue();
+        return Status::OK();
+    }
+
+    Status PostingIndexCursor::restorePosition() {
+        verify(!_savedValue.isEmpty());
+        // The blocks may have been split, merged or re-keyed while we were away, so don't
+        // bother checking whether our old spot is still good.
+        seekRecord(_savedValue.firstElement(), _savedLoc);
+        return Status::OK();
+    }
+
+    string PostingIndexCursor::toString() { return "PostingIndexCursor"; }
+
+    void PostingIndexCursor::seekValue(const BSONElement& value, bool inclusive) {
+        // 'value' may point into _value, so make the key before we move
+        BSONObj key = PostingBlock::boundaryKey(value, (1 == _direction) != inclusive);
+        locateBlock(key, 1 == _direction ? minDiskLoc : maxDiskLoc, _direction);
+        loadBlock();
+    }
+
+    void PostingIndexCursor::seekRecord(const BSONElement& value, const DiskLoc& loc) {
+        BSONObj valueObj = value.wrap("");
+
+        // The last block whose first record is <= loc.  If it's not one of value's, either all
+        // of value's records are after loc or there are none.
+        locateBlock(PostingBlock::searchKey(valueObj.firstElement(), loc), maxDiskLoc, -1);
+        if (!loadBlock() || 0 != _value.firstElement().woCompare(valueObj.firstElement(), false)) {
+            seekValue(valueObj.firstElement(), 1 == _direction);
+            return;
+        }
+
+        if (1 == _direction) {
+            _locPos = std::lower_bound(_locs.begin(), _locs.end(), loc) - _locs.begin();
+            if (_locPos == _locs.size()) {
+                advanceBlock(1);
+                loadBlock();
+            }
+        }
+        else {
+            // the block's first record is <= loc so this is in range
+            _locPos = std::upper_bound(_locs.begin(), _locs.end(), loc) - _locs.begin() - 1;
+        }
+    }
+
+    void PostingIndexCursor::locateBlock(const BSONObj& key, const DiskLoc& recordLoc,
+                                         int direction) {
+        bool found;
+        _keyOffset = 0;
+        _bucket = _interface->locate(_descriptor->getOnDisk(), _descriptor->getHead(), key,
+                                     _ordering, _keyOffset, found, recordLoc, direction);
+        while (!_bucket.isNull() && !_interface->keyIsUsed(_bucket, _keyOffset)) {
+            _bucket = _interface->advance(_bucket, _keyOffset, direction,
+                                          "PostingIndexCursor::locateBlock");
+        }
+    }
+
+    void PostingIndexCursor::advanceBlock(int direction) {
+        do {
+            _bucket = _interface->advance(_bucket, _keyOffset, direction,
+                                          "PostingIndexCursor::advanceBlock");
+        } while (!_bucket.isNull() && !_interface->keyIsUsed(_bucket, _keyOffset));
+    }
+
+    bool PostingIndexCursor::loadBlock() {
+        if (_bucket.isNull()) {
+            _value = BSONObj();
+            _locs.clear();
+            _locPos = 0;
+            return false;
+        }
+
+        BSONObj key = _interface->keyAt(_bucket, _keyOffset);
+        BSONElement value;
+        PostingBlock::parseKey(key, &value, &_locs);
+        _value = value.wrap("");
+        _locPos = 1 == _direction ? 0 : _locs.size() - 1;
+        return true;
+    }
+
+}  // namespace mongo
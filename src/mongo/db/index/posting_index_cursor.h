@@ -0,0 +1,119 @@
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/status.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/index/btree_interface.h"
+#include "mongo/db/index/index_cursor.h"
+#include "mongo/db/index/index_descriptor.h"
+
+namespace mongo {
+
+    /**
+     * Steps through the records of a posting index one at a time, as if each had its own
+     * { "": value } key.  See PostingBlock for the layout.
+     *
+     * Positions are always re-found from the saved (value, record) on restore, so unlike
+     * BtreeIndexCursor we don't need to hear about bucket deletion.
+     */
+    class PostingIndexCursor : public IndexCursor {
+    public:
+        virtual ~PostingIndexCursor() { }
+
+        virtual bool isEOF() const;
+
+        virtual Status setOptions(const CursorOptions& options);
+
+        virtual Status seek(const BSONObj& position);
+
+        // The BtreeIndexCursor seeking functions IndexScan uses for complex bounds.  The index
+        // has one field, so these only ever look at its first element.
+        Status seek(const vector<const BSONElement*>& position,
+                    const vector<bool>& inclusive);
+
+        Status skip(const BSONObj &keyBegin, int keyBeginLen, bool afterKey,
+                    const vector<const BSONElement*>& keyEnd,
+                    const vector<bool>& keyEndInclusive);
+
+        virtual BSONObj getKey() const;
+        virtual DiskLoc getValue() const;
+        virtual void next();
+
+        virtual Status savePosition();
+
+        virtual Status restorePosition();
+
+        virtual string toString();
+
+    private:
+        // We keep the constructor private and only allow the AM to create us.
+        friend class PostingAccessMethod;
+
+        PostingIndexCursor(IndexDescriptor* descriptor, Ordering ordering,
+                           BtreeInterface* interface);
+
+        /** go to the first record of 'value', or past it if !inclusive, in our direction */
+        void seekValue(const BSONElement& value, bool inclusive);
+
+        /** go to 'loc' under 'value', or the record after where it would be */
+        void seekRecord(const BSONElement& value, const DiskLoc& loc);
+
+        /** locate the block key for 'key' and 'recordLoc' in 'direction', skipping unused keys */
+        void locateBlock(const BSONObj& key, const DiskLoc& recordLoc, int direction);
+
+        void advanceBlock(int direction);
+
+        /** decode the block we are on; false if EOF */
+        bool loadBlock();
+
+        int _direction;
+        IndexDescriptor* _descriptor;
+        Ordering _ordering;
+        BtreeInterface* _interface;
+
+        // The block key we are on.
+        DiskLoc _bucket;
+        int _keyOffset;
+
+        // What it holds, and which of its records we are on.
+        BSONObj _value;
+        vector<DiskLoc> _locs;
+        size_t _locPos;
+
+        // For saving/restoring position.
+        BSONObj _savedValue;
+        DiskLoc _savedLoc;
+    };
+
+}  // namespace mongo
@@ -56,13 +56,18 @@ namespace mongo {
         // These are not advisory.
         _params.finestIndexedLevel = configValueWithDefault(descriptor, "finestIndexedLevel",
             S2::kAvgEdge.GetClosestLevel(500.0 / _params.radius));
-        _params.coarsestIndexedLevel = configValueWithDefault(descriptor, "coarsestIndexedLevel",
-            S2::kAvgEdge.GetClosestLevel(100 * 1000.0 / _params.radius));
+        _params.coarsestIndexedLevel =
+            S2SearchUtil::coarsestIndexedLevel(descriptor->infoObj());
         uassert(16747, "coarsestIndexedLevel must be >= 0", _params.coarsestIndexedLevel >= 0);
         uassert(16748, "finestIndexedLevel must be <= 30", _params.finestIndexedLevel <= 30);
         uassert(16749, "finestIndexedLevel must be >= coarsestIndexedLevel",
                 _params.finestIndexedLevel >= _params.coarsestIndexedLevel);
 
+        const int version = S2SearchUtil::indexVersion(descriptor->infoObj());
+        uassert(17388, "2dsphereIndexVersion must be 1 or 2",
+                S2_INDEX_VERSION_1 == version || S2_INDEX_VERSION_2 == version);
+        _params.indexVersion = static_cast<S2IndexVersion>(version);
+
         int geoFields = 0;
 
         // Categorize the fields we're indexing and make sure we have a geo field.
@@ -150,7 +155,7 @@ namespace mongo {
                     i->isABSONObj());
             const BSONObj &geoObj = i->Obj();
 
-            vector<string> cells;
+            vector<S2CellId> cells;
             bool succeeded = S2SearchUtil::getKeysForObject(geoObj, _params, &cells);
             uassert(16755, "Can't extract geo keys from object, malformed geometry?: "
                            + document.toString(), succeeded);
@@ -159,9 +164,14 @@ namespace mongo {
                     + document.toString(),
                     cells.size() > 0);
 
-            for (vector<string>::const_iterator it = cells.begin(); it != cells.end(); ++it) {
+            for (vector<S2CellId>::const_iterator it = cells.begin(); it != cells.end(); ++it) {
                 BSONObjBuilder b;
-                b.append("", *it);
+                if (S2_INDEX_VERSION_2 == _params.indexVersion) {
+                    b.append("", S2SearchUtil::cellIdToKey(*it));
+                }
+                else {
+                    b.append("", it->toString());
+                }
                 out->insert(b.obj());
             }
         }
@@ -36,6 +36,8 @@ namespace mongo {
     const string IndexNames::GEO_2DSPHERE = "2dsphere";
     const string IndexNames::TEXT = "text";
     const string IndexNames::HASHED = "hashed";
+    const string IndexNames::POSTING = "posting";
+    const string IndexNames::HASH_TABLE = "hashtable";
 
     // static
     string IndexNames::findPluginName(const BSONObj& keyPattern) {
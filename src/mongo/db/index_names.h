@@ -47,6 +47,8 @@ namespace mongo {
         static const string GEO_2DSPHERE;
         static const string TEXT;
         static const string HASHED;
+        static const string POSTING;
+        static const string HASH_TABLE;
 
         /**
          * True if is a regular (non-plugin) index or uses a plugin that existed before 2.4.
@@ -66,13 +68,23 @@ namespace mongo {
          */
         static string findPluginName(const BSONObj& keyPattern);
 
+        /**
+         * True if plugin 'name' keeps its keys in a btree, as all but the hashtable index do.
+         * Only those can be walked bucket by bucket, by indexStats for one.
+         */
+        static bool isBtreeBased(const string& name) {
+            return name != IndexNames::HASH_TABLE;
+        }
+
         static bool isKnownName(const string& name) {
             return name.empty()
                    || name == IndexNames::GEO_2D
                    || name == IndexNames::GEO_2DSPHERE
                    || name == IndexNames::GEO_HAYSTACK
                    || name == IndexNames::TEXT
-                   || name == IndexNames::HASHED;
+                   || name == IndexNames::HASHED
+                   || name == IndexNames::POSTING
+                   || name == IndexNames::HASH_TABLE;
         }
     };
 
@@ -28,11 +28,18 @@
 
 #include "mongo/db/index_rebuilder.h"
 
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/base/counter.h"
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/auth/user_name.h"
 #include "mongo/db/client.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/repl/replication_server_status.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/util/scopeguard.h"
@@ -41,6 +48,25 @@ namespace mongo {
 
     IndexRebuilder indexRebuilder;
 
+    namespace {
+        // Walking databases is mostly waiting on disk, so a few threads at a time are enough
+        const unsigned kNumCheckThreads = 8;
+
+        // How often to log how far the walk has got
+        const unsigned kLogProgressEvery = 1000;
+
+        Counter64 databasesTotal;
+        Counter64 databasesChecked;
+        ServerStatusMetricField<Counter64> displayDatabasesTotal("startup.databasesTotal",
+                                                                 &databasesTotal);
+        ServerStatusMetricField<Counter64> displayDatabasesChecked("startup.databasesChecked",
+                                                                   &databasesChecked);
+
+        // Guards merging the checking threads' results
+        SimpleMutex checkMutex("IndexRebuilder");
+        bool checkFailed = false;
+    }
+
     IndexRebuilder::IndexRebuilder() {}
 
     std::string IndexRebuilder::name() const {
@@ -54,19 +80,28 @@ namespace mongo {
 
         std::vector<std::string> dbNames;
         getDatabaseNames(dbNames);
+        databasesTotal.increment(dbNames.size());
+
+        std::list<std::string> nsToCheck;
+        AtomicUInt32 next;
+        boost::thread_group threads;
+        const unsigned numThreads = std::min<size_t>(kNumCheckThreads, dbNames.size());
+        for (unsigned i = 0; i < numThreads; i++) {
+            threads.create_thread(boost::bind(&IndexRebuilder::checkDatabases, this,
+                                              &dbNames, &next, &nsToCheck));
+        }
+        threads.join_all();
+        LOG(1) << "checked " << databasesChecked.get() << " databases for interrupted index builds"
+               << endl;
 
         try {
-            std::list<std::string> collNames;
-            for (std::vector<std::string>::const_iterator dbName = dbNames.begin();
-                 dbName < dbNames.end();
-                 dbName++) {
-                Client::ReadContext ctx(*dbName);
-                Database* db = cc().database();
-                db->namespaceIndex().getNamespaces(collNames, /* onlyCollections */ true);
-            }
-            checkNS(collNames);
+            nsToCheck.sort();
+            checkNS(nsToCheck);
         }
         catch (const DBException&) {
+            checkFailed = true;
+        }
+        if (checkFailed) {
             warning() << "index rebuilding did not complete" << endl;
         }
         boost::unique_lock<boost::mutex> lk(ReplSet::rss.mtx);
@@ -75,6 +110,76 @@ namespace mongo {
         LOG(1) << "checking complete" << endl;
     }
 
+    void IndexRebuilder::checkDatabases(const std::vector<std::string>* dbNames,
+                                        AtomicUInt32* next,
+                                        std::list<std::string>* nsToCheck) {
+        Client::initThread(name().c_str());
+        ON_BLOCK_EXIT_OBJ(cc(), &Client::shutdown);
+        cc().getAuthorizationSession()->grantInternalAuthorization();
+
+        std::list<std::string> found;
+        bool failed = false;
+        for (unsigned i = next->fetchAndAdd(1); i < dbNames->size(); i = next->fetchAndAdd(1)) {
+            try {
+                checkDatabase((*dbNames)[i], &found);
+            }
+            catch (const DBException& e) {
+                log() << "failed to check database " << (*dbNames)[i] << " for interrupted "
+                      << "index builds: " << e.what() << endl;
+                failed = true;
+            }
+
+            databasesChecked.increment();
+            const unsigned long long checked = databasesChecked.get();
+            if (checked % kLogProgressEvery == 0) {
+                log() << "checked " << checked << " of " << dbNames->size()
+                      << " databases for interrupted index builds" << endl;
+            }
+        }
+
+        SimpleMutex::scoped_lock lk(checkMutex);
+        nsToCheck->splice(nsToCheck->end(), found);
+        checkFailed = checkFailed || failed;
+    }
+
+    void IndexRebuilder::checkDatabase(const std::string& dbName,
+                                       std::list<std::string>* nsToCheck) {
+        Client::ReadContext ctx(dbName);
+        Database* db = cc().database();
+
+        std::list<std::string> collNames;
+        db->namespaceIndex().getNamespaces(collNames, /* onlyCollections */ true);
+
+        // We only care about the _id index if we are in a replset, and not for anything in
+        // the local database
+        const bool checkIdIndexes = replSettings.usingReplSets() && dbName != "local";
+
+        for (std::list<std::string>::const_iterator it = collNames.begin();
+                it != collNames.end();
+                ++it) {
+            Collection* collection = db->getCollection(*it);
+            if (collection == NULL)
+                continue;
+
+            if (collection->getIndexCatalog()->numIndexesInProgress() > 0)
+                nsToCheck->push_back(*it);
+
+            if (!checkIdIndexes || NamespaceString(*it).isSystem())
+                continue;
+
+            if (collection->getIndexCatalog()->findIdIndex())
+                continue;
+
+            log() << "WARNING: the collection '" << *it
+                  << "' lacks a unique index on _id."
+                  << " This index is needed for replication to function properly"
+                  << startupWarningsLog;
+            log() << "\t To fix this, on the primary run 'db." << it->substr(it->find('.')+1)
+                  << ".createIndex({_id: 1}, {unique: true})'"
+                  << startupWarningsLog;
+        }
+    }
+
     void IndexRebuilder::checkNS(const std::list<std::string>& nsToCheck) {
         bool firstTime = true;
         for (std::list<std::string>::const_iterator it = nsToCheck.begin();
@@ -28,13 +28,21 @@
 
 #pragma once
 
+#include <list>
+#include <string>
+#include <vector>
+
 #include "mongo/db/namespace_details.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/util/background.h"
 
 namespace mongo {
 
     // This is a job that's only run at startup. It finds all incomplete indices and 
     // finishes rebuilding them. After they complete rebuilding, the thread terminates. 
+    // Databases are walked by a few threads at once, as walking a database's namespaces
+    // mostly waits on reading its .ns file.  On a replica set member the same walk warns
+    // about collections lacking an _id index.
     class IndexRebuilder : public BackgroundJob {
     public:
         IndexRebuilder();
@@ -43,6 +51,20 @@ namespace mongo {
         void run();
 
     private:
+        /**
+         * Run by each checking thread: takes databases off 'dbNames' at '*next' until none
+         * are left, adding the collections with in-progress index builds to 'nsToCheck'.
+         */
+        void checkDatabases(const std::vector<std::string>* dbNames,
+                            AtomicUInt32* next,
+                            std::list<std::string>* nsToCheck);
+
+        /**
+         * Adds to 'nsToCheck' the collections in 'dbName' with in-progress index builds,
+         * holding only a read lock on the database.
+         */
+        void checkDatabase(const std::string& dbName, std::list<std::string>* nsToCheck);
+
         /**
          * Check each collection in the passed in list to see if it has any in-progress index
          * builds that need to be retried.  If so, calls retryIndexBuild.
@@ -39,11 +39,16 @@
 #include <sys/wait.h>
 #endif
 
+#include "mongo/base/counter.h"
 #include "mongo/base/init.h"
 #include "mongo/client/sasl_client_authenticate.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_manager_global.h"
 #include "mongo/db/auth/security_key.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/logger/async_appender.h"
+#include "mongo/logger/async_log_writer.h"
 #include "mongo/logger/logger.h"
 #include "mongo/logger/console_appender.h"
 #include "mongo/logger/message_event.h"
@@ -186,6 +191,16 @@ namespace mongo {
             _exit(EXIT_FAILURE);
     }
 
+    // Whether lines for the log file are queued and written by a thread of their own
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(asyncLogging, bool, false);
+
+    // How many lines each thread may have queued, with asyncLogging, before more are dropped
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(asyncLoggingLinesPerThread, int, 1024);
+
+    static Counter64 logLinesDropped;
+    static ServerStatusMetricField<Counter64> displayLogLinesDropped("log.droppedLines",
+                                                                     &logLinesDropped);
+
     MONGO_INITIALIZER_GENERAL(ServerLogRedirection,
                               ("GlobalLogManager", "EndStartupOptionHandling", "ForkServer"),
                               ("default"))(
@@ -271,14 +286,32 @@ namespace mongo {
 
             LogManager* manager = logger::globalLogManager();
             manager->getGlobalDomain()->clearAppenders();
-            manager->getGlobalDomain()->attachAppender(
-                    MessageLogDomain::AppenderAutoPtr(
-                            new RotatableFileAppender<MessageEventEphemeral>(
-                                    new MessageEventDetailsEncoder, writer.getValue())));
-            manager->getNamedDomain("javascriptOutput")->attachAppender(
-                    MessageLogDomain::AppenderAutoPtr(
-                            new RotatableFileAppender<MessageEventEphemeral>(
-                                    new MessageEventDetailsEncoder, writer.getValue())));
+            if (asyncLogging) {
+                using logger::AsyncAppender;
+
+                // Never deleted, as threads may log until the process exits
+                logger::AsyncLogWriter* asyncWriter = new logger::AsyncLogWriter(
+                        writer.getValue(), std::max(1, asyncLoggingLinesPerThread),
+                        &logLinesDropped);
+                manager->getGlobalDomain()->attachAppender(
+                        MessageLogDomain::AppenderAutoPtr(
+                                new AsyncAppender<MessageEventEphemeral>(
+                                        new MessageEventDetailsEncoder, asyncWriter)));
+                manager->getNamedDomain("javascriptOutput")->attachAppender(
+                        MessageLogDomain::AppenderAutoPtr(
+                                new AsyncAppender<MessageEventEphemeral>(
+                                        new MessageEventDetailsEncoder, asyncWriter)));
+            }
+            else {
+                manager->getGlobalDomain()->attachAppender(
+                        MessageLogDomain::AppenderAutoPtr(
+                                new RotatableFileAppender<MessageEventEphemeral>(
+                                        new MessageEventDetailsEncoder, writer.getValue())));
+                manager->getNamedDomain("javascriptOutput")->attachAppender(
+                        MessageLogDomain::AppenderAutoPtr(
+                                new RotatableFileAppender<MessageEventEphemeral>(
+                                        new MessageEventDetailsEncoder, writer.getValue())));
+            }
 
             if (serverGlobalParams.logAppend && exists) {
                 log() << "***** SERVER RESTARTED *****" << endl;
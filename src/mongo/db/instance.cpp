@@ -72,7 +72,9 @@
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/stats/counters.h"
+#include "mongo/db/stats/query_shape_stats.h"
 #include "mongo/db/storage_options.h"
+#include "mongo/logger/async_log_writer.h"
 #include "mongo/platform/process_id.h"
 #include "mongo/s/d_logic.h"
 #include "mongo/s/stale_exception.h" // for SendStaleConfigException
@@ -435,6 +437,8 @@ namespace mongo {
 
         OpDebug& debug = currentOp.debug();
         debug.op = op;
+        if ( !nestedOp.get() && c.port() )
+            debug.recvMicros = c.port()->lastRecvMicros();
 
         long long logThreshold = serverGlobalParams.slowMS;
         bool shouldLog = logger::globalLogDomain()->shouldLog(logger::LogSeverity::Debug(1));
@@ -532,6 +536,23 @@ namespace mongo {
         }
 
         debug.recordStats();
+
+        if ( !debug.queryShape.empty() ) {
+            const LockStat& lockStat = currentOp.lockStat();
+            QueryShapeStats::Sample sample;
+            sample.micros = currentOp.totalTimeMicros();
+            sample.lockWaitMicros = lockStat.getTimeAcquiring( 'R' ) +
+                                    lockStat.getTimeAcquiring( 'W' ) +
+                                    lockStat.getTimeAcquiring( 'r' ) +
+                                    lockStat.getTimeAcquiring( 'w' );
+            sample.keysExamined = std::max( 0LL, debug.nscanned );
+            sample.docsExamined = std::max( 0LL, debug.nscannedObjects );
+            sample.nreturned = std::max( 0, debug.nreturned );
+            // a getMore has no query, so it can't bring back an evicted shape
+            queryShapeStats.record( debug.ns.toString(), debug.queryShape,
+                                    op == dbQuery ? debug.query : BSONObj(), sample );
+        }
+
         debug.reset();
     } /* assembleResponse() */
 
@@ -643,6 +664,7 @@ namespace mongo {
         }
 
         Lock::DBWrite lk(ns.ns());
+        Lock::CollectionLockStats lockStats( lk, ns.ns() );
 
         // void ReplSetImpl::relinquish() uses big write lock so this is thus
         // synchronized given our lock above.
@@ -694,6 +716,7 @@ namespace mongo {
         while ( 1 ) {
             try {
                 Lock::DBWrite lk(ns.ns());
+                Lock::CollectionLockStats lockStats( lk, ns.ns() );
                 
                 // writelock is used to synchronize stepdowns w/ writes
                 uassert( 10056 ,  "not master", isMasterNs( ns.ns().c_str() ) );
@@ -736,7 +759,9 @@ namespace mongo {
         int pass = 0;
         bool exhaust = false;
         QueryResult* msgdata = 0;
+        Message reply;
         OpTime last;
+        const bool isOplog = str::startsWith(ns, "local.oplog.");
         while( 1 ) {
             bool isCursorAuthorized = false;
             try {
@@ -748,18 +773,18 @@ namespace mongo {
                 audit::logGetMoreAuthzCheck(&cc(), nsString, cursorid, status.code());
                 uassertStatusOK(status);
 
-                if (str::startsWith(ns, "local.oplog.")){
+                if (isOplog){
                     while (MONGO_FAIL_POINT(rsStopGetMore)) {
                         sleepmillis(0);
                     }
 
-                    if (pass == 0) {
-                        mutex::scoped_lock lk(OpTime::m);
-                        last = OpTime::getLast(lk);
-                    }
-                    else {
+                    // Sleep until an op newer than any the last pass could have seen is
+                    // logged, then note the newest one for the next pass.
+                    if (pass > 0) {
                         last.waitForDifferent(1000/*ms*/);
                     }
+                    mutex::scoped_lock lk(OpTime::m);
+                    last = OpTime::getLast(lk);
                 }
 
                 msgdata = newGetMore(ns,
@@ -768,7 +793,8 @@ namespace mongo {
                                      curop,
                                      pass,
                                      exhaust,
-                                     &isCursorAuthorized);
+                                     &isCursorAuthorized,
+                                     reply);
             }
             catch ( AssertionException& e ) {
                 if ( isCursorAuthorized ) {
@@ -799,10 +825,13 @@ namespace mongo {
                     }
                 }
                 pass++;
-                if (debug)
-                    sleepmillis(20);
-                else
-                    sleepmillis(2);
+                // the oplog's next pass waits to be woken by a new op instead
+                if (!isOplog) {
+                    if (debug)
+                        sleepmillis(20);
+                    else
+                        sleepmillis(2);
+                }
                 
                 // note: the 1100 is beacuse of the waitForDifferent above
                 // should eventually clean this up a bit
@@ -827,7 +856,7 @@ namespace mongo {
         }
 
         Message *resp = new Message();
-        resp->setData(msgdata, true);
+        *resp = reply;
         curop.debug().responseLength = resp->header()->dataLen();
         curop.debug().nreturned = msgdata->nReturned;
 
@@ -886,7 +915,44 @@ namespace mongo {
         logOp("i", ns, js);
     }
 
+    /**
+     * Several index specs inserted into system.indexes in one message, all for the same
+     * collection, are built together with a single scan of it.
+     * @return false if the specs are not all for one collection
+     */
+    bool insertIndexesTogether(Client::Context& ctx, const char *ns, const vector<BSONObj>& objs) {
+        const string targetNS = objs[0]["ns"].str();
+        for ( size_t i = 1; i < objs.size(); i++ ) {
+            if ( objs[i]["ns"].str() != targetNS )
+                return false;
+        }
+        uassertStatusOK( userAllowedWriteNS( targetNS ) );
+
+        Collection* collection = ctx.db()->getCollection( targetNS );
+        if ( !collection ) {
+            // implicitly create
+            collection = ctx.db()->createCollection( targetNS );
+            verify( collection );
+        }
+
+        // see checkAndInsert()
+        bool mayInterrupt = cc().curop()->parent() == NULL;
+
+        uassertStatusOK( collection->getIndexCatalog()->createIndexes( objs, mayInterrupt ) );
+        for ( size_t i = 0; i < objs.size(); i++ ) {
+            logOp( "i", ns, objs[i] );
+        }
+        return true;
+    }
+
     NOINLINE_DECL void insertMulti(Client::Context& ctx, bool keepGoing, const char *ns, vector<BSONObj>& objs, CurOp& op) {
+        if ( nsToCollectionSubstring( ns ) == "system.indexes" &&
+             insertIndexesTogether( ctx, ns, objs ) ) {
+            globalOpCounters.incInsertInWriteLock(objs.size());
+            op.debug().ninserted = objs.size();
+            return;
+        }
+
         size_t i;
         for (i=0; i<objs.size(); i++){
             try {
@@ -934,6 +1000,7 @@ namespace mongo {
         while ( true ) {
             try {
                 Lock::DBWrite lk(ns);
+                Lock::CollectionLockStats lockStats( lk, ns );
                 
                 // CONCURRENCY TODO: is being read locked in big log sufficient here?
                 // writelock is used to synchronize stepdowns w/ writes
@@ -1201,6 +1268,7 @@ namespace {
                 stringstream ss;
                 ss << "dbexit: " << why << "; exiting immediately";
                 tryToOutputFatal( ss.str() );
+                logger::AsyncLogWriter::flushAll();
                 if ( c ) c->shutdown();
                 ::_exit( rc );
             }
@@ -1240,6 +1308,7 @@ namespace {
         }
 #endif
         tryToOutputFatal( "dbexit: really exiting now" );
+        logger::AsyncLogWriter::flushAll();
         if ( c ) c->shutdown();
         ::_exit(rc);
     }
@@ -66,17 +66,27 @@ namespace mongo {
     MinKeyLabeler MINKEY;
     MaxKeyLabeler MAXKEY;
 
+    string BSONElement::jsonString( JsonStringFormat format, bool includeFieldNames, int pretty ) const {
+        StringBuilder s;
+        jsonString( s, format, includeFieldNames, pretty );
+        return s.str();
+    }
+
     // need to move to bson/, but has dependency on base64 so move that to bson/util/ first.
-    inline string BSONElement::jsonString( JsonStringFormat format, bool includeFieldNames, int pretty ) const {
+    void BSONElement::jsonString( StringBuilder& s, JsonStringFormat format, bool includeFieldNames, int pretty ) const {
         int sign;
 
-        stringstream s;
-        if ( includeFieldNames )
-            s << '"' << escape( fieldName() ) << "\" : ";
+        if ( includeFieldNames ) {
+            s << '"';
+            escape( s, fieldName() );
+            s << "\" : ";
+        }
         switch ( type() ) {
         case mongo::String:
         case Symbol:
-            s << '"' << escape( string(valuestr(), valuestrsize()-1) ) << '"';
+            s << '"';
+            escape( s, StringData( valuestr(), valuestrsize()-1 ) );
+            s << '"';
             break;
         case NumberLong:
             if (format == TenGen) {
@@ -94,8 +104,10 @@ namespace mongo {
         case NumberDouble:
             if ( number() >= -numeric_limits< double >::max() &&
                     number() <= numeric_limits< double >::max() ) {
-                s.precision( 16 );
-                s << number();
+                // Same as a stream with precision 16.
+                char buf[32];
+                int len = snprintf( buf, sizeof(buf), "%.16g", number() );
+                s << StringData( buf, len );
             }
             else if ( mongo::isNaN(number()) ) {
                 s << "NaN";
@@ -125,7 +137,7 @@ namespace mongo {
             }
             break;
         case Object:
-            s << embeddedObject().jsonString( format, pretty );
+            embeddedObject().jsonString( s, format, pretty );
             break;
         case mongo::Array: {
             if ( embeddedObject().isEmpty() ) {
@@ -148,7 +160,7 @@ namespace mongo {
                         s << "undefined";
                     }
                     else {
-                        s << e.jsonString( format, false, pretty?pretty+1:0 );
+                        e.jsonString( s, format, false, pretty?pretty+1:0 );
                         e = i.next();
                     }
                     count++;
@@ -169,7 +181,7 @@ namespace mongo {
             s << '"' << valuestr() << "\", ";
             if ( format != TenGen )
                 s << "\"$id\" : ";
-            s << '"' << *x << "\" ";
+            s << '"' << x->str() << "\" ";
             if ( format == TenGen )
                 s << ')';
             else
@@ -183,7 +195,7 @@ namespace mongo {
             else {
                 s << "{ \"$oid\" : ";
             }
-            s << '"' << __oid() << '"';
+            s << '"' << __oid().str() << '"';
             if ( format == TenGen ) {
                 s << " )";
             }
@@ -198,11 +210,8 @@ namespace mongo {
             s << "{ \"$binary\" : \"";
             const char *start = reinterpret_cast<const char*>( value() ) + sizeof( int ) + 1;
             base64::encode( s , start , len );
-            s << "\", \"$type\" : \"" << hex;
-            s.width( 2 );
-            s.fill( '0' );
-            s << type << dec;
-            s << "\" }";
+            const char typeByte = type;
+            s << "\", \"$type\" : \"" << toHexLower( &typeByte, 1 ) << "\" }";
             break;
         }
         case mongo::Date:
@@ -238,11 +247,14 @@ namespace mongo {
             break;
         case RegEx:
             if ( format == Strict ) {
-                s << "{ \"$regex\" : \"" << escape( regex() );
+                s << "{ \"$regex\" : \"";
+                escape( s, regex() );
                 s << "\", \"$options\" : \"" << regexFlags() << "\" }";
             }
             else {
-                s << "/" << escape( regex() , true ) << "/";
+                s << "/";
+                escape( s, regex(), true );
+                s << "/";
                 // FIXME Worry about alpha order?
                 for ( const char *f = regexFlags(); *f; ++f ) {
                     switch ( *f ) {
@@ -260,14 +272,19 @@ namespace mongo {
         case CodeWScope: {
             BSONObj scope = codeWScopeObject();
             if ( ! scope.isEmpty() ) {
-                s << "{ \"$code\" : \"" << escape(_asCode()) << "\" , "
-                  << "\"$scope\" : " << scope.jsonString() << " }";
+                s << "{ \"$code\" : \"";
+                escape( s, _asCode() );
+                s << "\" , " << "\"$scope\" : ";
+                scope.jsonString( s );
+                s << " }";
                 break;
             }
         }
 
         case Code:
-            s << "\"" << escape(_asCode()) << "\"";
+            s << "\"";
+            escape( s, _asCode() );
+            s << "\"";
             break;
 
         case Timestamp:
@@ -294,7 +311,6 @@ namespace mongo {
             string message = ss.str();
             massert( 10312 ,  message.c_str(), false );
         }
-        return s.str();
     }
 
     int BSONElement::getGtLtOp( int def ) const {
@@ -465,16 +481,24 @@ namespace mongo {
     }
 
     string BSONObj::jsonString( JsonStringFormat format, int pretty ) const {
+        StringBuilder s;
+        jsonString( s, format, pretty );
+        return s.str();
+    }
 
-        if ( isEmpty() ) return "{}";
+    void BSONObj::jsonString( StringBuilder& s, JsonStringFormat format, int pretty ) const {
+
+        if ( isEmpty() ) {
+            s << "{}";
+            return;
+        }
 
-        StringBuilder s;
         s << "{ ";
         BSONObjIterator i(*this);
         BSONElement e = i.next();
         if ( !e.eoo() )
             while ( 1 ) {
-                s << e.jsonString( format, true, pretty?pretty+1:0 );
+                e.jsonString( s, format, true, pretty?pretty+1:0 );
                 e = i.next();
                 if ( e.eoo() )
                     break;
@@ -489,7 +513,6 @@ namespace mongo {
                 }
             }
         s << " }";
-        return s.str();
     }
 
     bool BSONObj::valid() const {
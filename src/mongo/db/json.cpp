@@ -42,8 +42,8 @@ namespace mongo {
         ID_RESERVE_SIZE = 64,
         PAT_RESERVE_SIZE = 4096,
         OPT_RESERVE_SIZE = 64,
-        FIELD_RESERVE_SIZE = 4096,
-        STRINGVAL_RESERVE_SIZE = 4096,
+        FIELD_RESERVE_SIZE = 64,
+        STRINGVAL_RESERVE_SIZE = 64,
         BINDATA_RESERVE_SIZE = 4096,
         BINDATATYPE_RESERVE_SIZE = 4096,
         NS_RESERVE_SIZE = 64,
@@ -78,7 +78,30 @@ namespace mongo {
 
     Status JParse::value(const StringData& fieldName, BSONObjBuilder& builder) {
         MONGO_JSON_DEBUG("fieldName: " << fieldName);
-        if (peekToken(LBRACE)) {
+        // Strings and numbers are the most common values and cannot start like any of the
+        // keywords below, so look at the next character before trying the keywords in turn.
+        const char* next = _input;
+        while (next < _input_end && isspace(*reinterpret_cast<const unsigned char*>(next))) {
+            ++next;
+        }
+        const char nextChar = next < _input_end ? *next : '\0';
+
+        if (nextChar == '"' || nextChar == '\'') {
+            std::string valueString;
+            valueString.reserve(STRINGVAL_RESERVE_SIZE);
+            Status ret = quotedString(&valueString);
+            if (ret != Status::OK()) {
+                return ret;
+            }
+            builder.append(fieldName, valueString);
+        }
+        else if (nextChar >= '0' && nextChar <= '9') {
+            Status ret = number(fieldName, builder);
+            if (ret != Status::OK()) {
+                return ret;
+            }
+        }
+        else if (peekToken(LBRACE)) {
             Status ret = object(fieldName, builder);
             if (ret != Status::OK()) {
                 return ret;
@@ -138,15 +161,6 @@ namespace mongo {
                 return ret;
             }
         }
-        else if (peekToken(DOUBLEQUOTE) || peekToken(SINGLEQUOTE)) {
-            std::string valueString;
-            valueString.reserve(STRINGVAL_RESERVE_SIZE);
-            Status ret = quotedString(&valueString);
-            if (ret != Status::OK()) {
-                return ret;
-            }
-            builder.append(fieldName, valueString);
-        }
         else if (readToken("true")) {
             builder.append(fieldName, true);
         }
@@ -918,10 +932,19 @@ namespace mongo {
             if (_input >= _input_end) {
                 return parseError("Field name expected");
             }
-            if (!match(*_input, ALPHA "_$")) {
+            if (!isFieldNameChar(*_input) || isdigit(*_input)) {
                 return parseError("First character in field must be [A-Za-z$_]");
             }
-            return chars(result, "", ALPHA DIGIT "_$");
+            const char* q = _input;
+            while (q < _input_end && isFieldNameChar(*q)) {
+                ++q;
+            }
+            if (q >= _input_end) {
+                return parseError("Unexpected end of input");
+            }
+            result->assign(_input, q - _input);
+            _input = q;
+            return Status::OK();
         }
     }
 
@@ -962,8 +985,23 @@ namespace mongo {
             return parseError("Unexpected end of input");
         }
         const char* q = _input;
+        // Quoted strings end at a single terminal character; copy the plain characters before
+        // it a run at a time and only look at escapes and control characters one by one.
+        const bool copyRuns = allowedSet == NULL && terminalSet[0] != '\0' &&
+                              terminalSet[1] == '\0';
         while (q < _input_end && !match(*q, terminalSet)) {
             MONGO_JSON_DEBUG("q: " << q);
+            if (copyRuns) {
+                const char* run = q;
+                while (q < _input_end && *q != *terminalSet && *q != '\\' &&
+                       !(0x00 <= *q && *q <= 0x1F)) {
+                    ++q;
+                }
+                result->append(run, q - run);
+                if (q >= _input_end || *q == *terminalSet) {
+                    break;
+                }
+            }
             if (allowedSet != NULL) {
                 if (!match(*q, allowedSet)) {
                     _input = q;
@@ -1096,6 +1134,11 @@ namespace mongo {
         return true;
     }
 
+    inline bool JParse::isFieldNameChar(char c) const {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+               c == '_' || c == '$';
+    }
+
     inline bool JParse::match(char matchChar, const char* matchSet) const {
         if (matchSet == NULL) {
             return true;
@@ -391,6 +391,11 @@ namespace mongo {
              */
             bool match(char matchChar, const char* matchSet) const;
 
+            /**
+             * @return true if c may appear in an unquoted field name, [A-Za-z0-9$_]
+             */
+            bool isFieldNameChar(char c) const;
+
             /**
              * @return true if every character in the string is a hex digit
              */
@@ -533,6 +533,33 @@ namespace mongo {
         return L.woCompare(R, order, /*considerfieldname*/false);
     }
 
+    inline unsigned sizeOfElement(const unsigned char *p);
+
+    /** n bytes at l and r are the same.  compares a word at a time */
+    inline bool sameBytes(const unsigned char *l, const unsigned char *r, unsigned n) {
+        while( n >= 8 ) {
+            unsigned long long L, R;
+            memcpy(&L, l, 8);
+            memcpy(&R, r, 8);
+            if( L != R )
+                return false;
+            l += 8; r += 8; n -= 8;
+        }
+        if( n >= 4 ) {
+            unsigned L, R;
+            memcpy(&L, l, 4);
+            memcpy(&R, r, 4);
+            if( L != R )
+                return false;
+            l += 4; r += 4; n -= 4;
+        }
+        while( n-- ) {
+            if( *l++ != *r++ )
+                return false;
+        }
+        return true;
+    }
+
     int KeyV1::woCompare(const KeyV1& right, const Ordering &order) const {
         const unsigned char *l = _keyData;
         const unsigned char *r = right._keyData;
@@ -544,6 +571,26 @@ namespace mongo {
         while( 1 ) { 
             char lval = *l; 
             char rval = *r;
+
+            // Leading elements are often the same, e.g. in compound keys or as a btree search
+            // closes in on its neighbours, and identical bytes always compare equal.  So try
+            // that a word at a time before the compare by type.  Only if the type bytes, and
+            // for strings and bindata the length bytes, match, so we never read past either
+            // element.
+            if( lval == rval ) {
+                int t = lval & cCANONTYPEMASK;
+                if( ( t != cstring && t != cbindata ) || l[1] == r[1] ) {
+                    unsigned sz = sizeOfElement(l);
+                    if( sameBytes(l, r, sz) ) {
+                        l += sz; r += sz;
+                        if( (lval & cHASMORE) == 0 )
+                            break;
+                        mask <<= 1;
+                        continue;
+                    }
+                }
+            }
+
             {
                 int x = compare(l, r); // updates l and r pointers
                 if( x ) {
@@ -114,8 +114,8 @@ namespace mongo {
         return le;
     }
 
-    void LastErrorHolder::release() {
-        _tl.release();
+    LastError* LastErrorHolder::release() {
+        return _tl.release();
     }
 
     /** ok to call more than once. */
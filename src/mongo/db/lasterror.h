@@ -139,7 +139,8 @@ namespace mongo {
 
         int getID();
         
-        void release();
+        /** takes the thread's LastError off it without deleting it */
+        LastError* release();
 
         /** when db receives a message/request, call this */
         LastError * startRequest( Message& m , LastError * connectionOwned );
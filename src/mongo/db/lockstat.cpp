@@ -34,9 +34,29 @@
 #include "mongo/db/lockstat.h"
 
 #include "mongo/db/jsobj.h"
+#include "mongo/util/histogram.h"
 
 namespace mongo { 
 
+    LockStat::LockStat( bool withHistograms ) {
+        for ( int i = 0; i < N; i++ ) {
+            acquireHistograms[i] = NULL;
+            if ( withHistograms ) {
+                // buckets up to 1, 2, 4, ... 2^22 micros (about 4 seconds), then the rest
+                Histogram::Options opts;
+                opts.numBuckets = 24;
+                opts.bucketSize = 1;
+                opts.exponential = true;
+                acquireHistograms[i] = new Histogram( opts );
+            }
+        }
+    }
+
+    LockStat::~LockStat() {
+        for ( int i = 0; i < N; i++ )
+            delete acquireHistograms[i];
+    }
+
     BSONObj LockStat::report() const { 
         BSONObjBuilder b;
 
@@ -47,10 +67,35 @@ namespace mongo {
         BSONObjBuilder a( b.subobjStart( "timeAcquiringMicros" ) );
         _append( a , timeAcquiring );
         a.done();
+
+        if ( acquireHistograms[0] ) {
+            BSONObjBuilder h( b.subobjStart( "acquireHistogramMicros" ) );
+            _appendHistograms( h );
+            h.done();
+        }
         
         return b.obj();
     }
 
+    // mode -> [ { upTo: <max micros in bucket>, count: n }, ... ], skipping empty buckets
+    void LockStat::_appendHistograms( BSONObjBuilder& builder ) const {
+        for ( int i = 0; i < N; i++ ) {
+            const Histogram& hist = *acquireHistograms[i];
+            BSONArrayBuilder buckets;
+            for ( uint32_t j = 0; j < hist.getBucketsNum(); j++ ) {
+                long long count = hist.getCount( j );
+                if ( count == 0 )
+                    continue;
+                buckets.append( BSON( "upTo" << static_cast<long long>( hist.getBoundary( j ) )
+                                   << "count" << count ) );
+            }
+            if ( buckets.arrSize() ) {
+                const char name[] = { nameFor( i ), '\0' };
+                builder.append( name , buckets.arr() );
+            }
+        }
+    }
+
     void LockStat::report( StringBuilder& builder ) const {
         bool prefixPrinted = false;
         for ( int i=0; i < N; i++ ) {
@@ -64,7 +109,20 @@ namespace mongo {
 
             builder << ' ' << nameFor( i ) << ':' << timeLocked[i].load();
         }
-        
+
+        // time spent waiting for locks, which is what shows an operation caught in a convoy
+        prefixPrinted = false;
+        for ( int i=0; i < N; i++ ) {
+            if ( timeAcquiring[i].load() == 0 )
+                continue;
+
+            if ( ! prefixPrinted ) {
+                builder << " acquiring(micros)";
+                prefixPrinted = true;
+            }
+
+            builder << ' ' << nameFor( i ) << ':' << timeAcquiring[i].load();
+        }
     }
 
     void LockStat::_append( BSONObjBuilder& builder, const AtomicInt64* data ) {
@@ -103,7 +161,12 @@ namespace mongo {
 
 
     void LockStat::recordAcquireTimeMicros( char type , long long micros ) {
-        timeAcquiring[mapNo(type)].fetchAndAdd( micros );
+        unsigned n = mapNo(type);
+        timeAcquiring[n].fetchAndAdd( micros );
+        if ( acquireHistograms[n] ) {
+            acquireHistograms[n]->insert( static_cast<uint32_t>(
+                    std::min( micros, static_cast<long long>( 0xffffffffLL ) ) ) );
+        }
     }
     void LockStat::recordLockTimeMicros( char type , long long micros ) {
         timeLocked[mapNo(type)].fetchAndAdd( micros );
@@ -31,16 +31,26 @@
 
 #pragma once
 
+#include <boost/noncopyable.hpp>
+
 #include "mongo/platform/atomic_word.h"
 #include "mongo/util/timer.h"
 
 namespace mongo { 
 
     class BSONObj;
+    class Histogram;
 
-    class LockStat { 
+    class LockStat : boost::noncopyable { 
         enum { N = 4 };
     public:
+        /**
+         * @param withHistograms also keep a histogram of acquisition times per lock mode. Meant
+         *        for the long lived stats of the locks themselves, not per operation ones.
+         */
+        explicit LockStat( bool withHistograms = false );
+        ~LockStat();
+
         void recordAcquireTimeMicros( char type , long long micros );
         void recordLockTimeMicros( char type , long long micros );
 
@@ -50,14 +60,20 @@ namespace mongo {
         void report( StringBuilder& builder ) const;
 
         long long getTimeLocked( char type ) const { return timeLocked[mapNo(type)].load(); }
+        long long getTimeAcquiring( char type ) const {
+            return timeAcquiring[mapNo(type)].load();
+        }
     private:
         static void _append( BSONObjBuilder& builder, const AtomicInt64* data );
+        void _appendHistograms( BSONObjBuilder& builder ) const;
         
         // RWrw
         // in micros
         AtomicInt64 timeAcquiring[N];
         AtomicInt64 timeLocked[N];
 
+        Histogram* acquireHistograms[N]; // null unless constructed withHistograms
+
         static unsigned mapNo(char type);
         static char nameFor(unsigned offset);
     };
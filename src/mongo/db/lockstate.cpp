@@ -40,6 +40,17 @@
 
 namespace mongo {
 
+    static AtomicInt32 readersPending;
+    static AtomicInt32 writersPending;
+
+    int LockState::numReadersPending() {
+        return readersPending.load();
+    }
+
+    int LockState::numWritersPending() {
+        return writersPending.load();
+    }
+
     LockState::LockState() 
         : _batchWriter(false),
           _recursive(0),
@@ -247,9 +258,13 @@ namespace mongo {
     Acquiring::Acquiring( Lock::ScopedLock* lock,  LockState& ls )
         : _lock( lock ), _ls( ls ){
         _ls._lockPending = true;
+        const char type = _lock ? _lock->type() : 'w';
+        _pendingCount = ( type == 'r' || type == 'R' ) ? &readersPending : &writersPending;
+        _pendingCount->fetchAndAdd( 1 );
     }
 
     Acquiring::~Acquiring() {
+        _pendingCount->fetchAndSubtract( 1 );
         _ls._lockPending = false;
         LockStat* stat = _ls.getRelevantLockStat();
         if ( stat && _lock )
@@ -259,9 +274,11 @@ namespace mongo {
     AcquiringParallelWriter::AcquiringParallelWriter( LockState& ls )
         : _ls( ls ) {
         _ls._lockPendingParallelWriter = true;
+        writersPending.fetchAndAdd( 1 );
     }
     
     AcquiringParallelWriter::~AcquiringParallelWriter() {
+        writersPending.fetchAndSubtract( 1 );
         _ls._lockPendingParallelWriter = false;
     }
 
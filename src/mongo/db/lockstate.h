@@ -32,6 +32,7 @@
 #pragma once
 
 #include "mongo/db/d_concurrency.h"
+#include "mongo/util/concurrency/synchronization.h"
 
 namespace mongo {
 
@@ -64,6 +65,14 @@ namespace mongo {
         /** pending means we are currently trying to get a lock */
         bool hasLockPending() const { return _lockPending || _lockPendingParallelWriter; }
 
+        /**
+         * Threads currently trying to get a read ('r', 'R') or write ('w', 'W', parallel batch
+         * writer) lock.  Cheap, unlike Client::recommendedYieldMicros(), which scans every
+         * client.
+         */
+        static int numReadersPending();
+        static int numWritersPending();
+
         // ----
 
 
@@ -91,6 +100,7 @@ namespace mongo {
         void lockedOther( const StringData& db , int type , WrapperForRWLock* lock );
         void lockedOther( int type );  // "same lock as last time" case 
         void unlockedOther();
+
         bool _batchWriter;
 
         LockStat* getRelevantLockStat();
@@ -125,13 +135,17 @@ namespace mongo {
 
     class WrapperForRWLock : boost::noncopyable { 
         SimpleRWLock r;
+        // Writers queue here, oldest first, and only the one at the head waits on 'r'.  With
+        // many writers blocked on a database each unlock then wakes a single thread instead of
+        // all of them racing for the lock.
+        FifoGate writers;
     public:
         string name() const { return r.name; }
         LockStat stats;
-        WrapperForRWLock(const StringData& name) : r(name) { }
-        void lock()          { r.lock(); }
+        WrapperForRWLock(const StringData& name) : r(name), stats(true) { }
+        void lock()          { writers.enter(); r.lock(); }
         void lock_shared()   { r.lock_shared(); }
-        void unlock()        { r.unlock(); }
+        void unlock()        { r.unlock(); writers.leave(); }
         void unlock_shared() { r.unlock_shared(); }
     };
 
@@ -144,6 +158,7 @@ namespace mongo {
     private:
         Lock::ScopedLock* _lock;
         LockState& _ls;
+        AtomicInt32* _pendingCount;
     };
         
     class AcquiringParallelWriter {
@@ -101,6 +101,8 @@ namespace mongo {
         if ( !_func )
             return Status( ErrorCodes::BadValue, "$where compile error" );
 
+        _scope->setBoolean( "fullObject" , true ); // this is a hack b/c fullObject used to be relevant
+
         return Status::OK();
     }
 
@@ -111,10 +113,8 @@ namespace mongo {
         if ( ! _userScope.isEmpty() ) {
             _scope->init( &_userScope );
         }
-        _scope->setObject( "obj", const_cast< BSONObj & >( obj ) );
-        _scope->setBoolean( "fullObject" , true ); // this is a hack b/c fullObject used to be relevant
-
-        int err = _scope->invoke( _func, 0, &obj, 1000 * 60, false );
+        // The document is both 'this' and 'obj'.
+        int err = _scope->invokeOnObject( _func, obj, "obj", 1000 * 60 );
         if ( err == -3 ) { // INVOKE_ERROR
             stringstream ss;
             ss << "error on invocation of $where function:\n"
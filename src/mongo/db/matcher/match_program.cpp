@@ -0,0 +1,469 @@
+// match_program.cpp
+
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/matcher/match_program.h"
+
+#include <algorithm>
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/db/matcher/expression_leaf.h"
+#include "mongo/db/matcher/matchable.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    namespace {
+
+        /**
+         * Leaves whose match on a single, non-array element is matchesSingleElement.
+         */
+        bool isPathLeaf(const MatchExpression* expr) {
+            switch (expr->matchType()) {
+            case MatchExpression::EQ:
+            case MatchExpression::LT:
+            case MatchExpression::LTE:
+            case MatchExpression::GT:
+            case MatchExpression::GTE:
+            case MatchExpression::REGEX:
+            case MatchExpression::MOD:
+            case MatchExpression::EXISTS:
+            case MatchExpression::MATCH_IN:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * Rough relative cost of testing one element against a leaf.
+         */
+        int leafCost(const MatchExpression* expr) {
+            switch (expr->matchType()) {
+            case MatchExpression::MATCH_IN:
+            case MatchExpression::MOD:
+                return 2;
+            case MatchExpression::REGEX:
+                return 8;
+            default:
+                return 1;
+            }
+        }
+
+        /**
+         * Rough relative cost of matching a document against 'expr'.
+         */
+        int nodeCost(const MatchExpression* expr) {
+            if (isPathLeaf(expr)) {
+                // The path lookup dominates.
+                return 2 + leafCost(expr);
+            }
+
+            switch (expr->matchType()) {
+            case MatchExpression::AND:
+            case MatchExpression::OR:
+            case MatchExpression::NOR:
+            case MatchExpression::NOT: {
+                int cost = 1;
+                for (size_t i = 0; i < expr->numChildren(); ++i) {
+                    cost += nodeCost(expr->getChild(i));
+                }
+                return cost;
+            }
+            case MatchExpression::ATOMIC:
+            case MatchExpression::ALWAYS_FALSE:
+                return 0;
+            case MatchExpression::GEO:
+                return 50;
+            case MatchExpression::WHERE:
+                return 1000;
+            default:
+                return 10;
+            }
+        }
+
+        // An $and child as the program tests it: either a group of leaves over one path, or any
+        // other node.
+        struct AndUnit {
+            AndUnit() : node(NULL), cost(0) { }
+
+            // Set if this is a path group.
+            StringData path;
+            std::vector<const MatchExpression*> leaves;
+
+            // Set otherwise.
+            const MatchExpression* node;
+
+            int cost;
+        };
+
+        bool leafCostLess(const MatchExpression* lhs, const MatchExpression* rhs) {
+            return leafCost(lhs) < leafCost(rhs);
+        }
+
+        bool nodeCostLess(const MatchExpression* lhs, const MatchExpression* rhs) {
+            return nodeCost(lhs) < nodeCost(rhs);
+        }
+
+        bool unitCostLess(const AndUnit& lhs, const AndUnit& rhs) {
+            return lhs.cost < rhs.cost;
+        }
+
+        /**
+         * Compares two numbers of the same type without going through compareElementValues.
+         * Returns false, leaving 'cmp' alone, if 'e' and 'rhs' are anything else.
+         */
+        inline bool compareSameTypeNumbers(const BSONElement& e, const BSONElement& rhs,
+                                           int* cmp) {
+            if (e.type() != rhs.type()) {
+                return false;
+            }
+
+            switch (e.type()) {
+            case NumberInt: {
+                int l = e._numberInt();
+                int r = rhs._numberInt();
+                *cmp = (l < r) ? -1 : (l > r ? 1 : 0);
+                return true;
+            }
+            case NumberLong: {
+                long long l = e._numberLong();
+                long long r = rhs._numberLong();
+                *cmp = (l < r) ? -1 : (l > r ? 1 : 0);
+                return true;
+            }
+            case NumberDouble: {
+                double l = e._numberDouble();
+                double r = rhs._numberDouble();
+                // compareElementValues orders NaN before every number.
+                if (l != l || r != r) {
+                    return false;
+                }
+                *cmp = (l < r) ? -1 : (l > r ? 1 : 0);
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+    }  // namespace
+
+    // static
+    MatchProgram* MatchProgram::compile(const MatchExpression* root) {
+        MatchProgram* program = new MatchProgram();
+        program->compileNode(root);
+        return program;
+    }
+
+    void MatchProgram::compileNode(const MatchExpression* expr) {
+        if (isPathLeaf(expr)) {
+            emitLoad(expr->path());
+            compileLeafTest(expr);
+            return;
+        }
+
+        switch (expr->matchType()) {
+        case MatchExpression::AND:
+            compileAnd(expr);
+            break;
+        case MatchExpression::OR:
+            compileOr(expr);
+            break;
+        case MatchExpression::NOR:
+            compileOr(expr);
+            _instructions.push_back(Instruction(NEGATE));
+            break;
+        case MatchExpression::NOT:
+            compileNode(expr->getChild(0));
+            _instructions.push_back(Instruction(NEGATE));
+            break;
+        default: {
+            Instruction test(TEST_EXPRESSION);
+            test.expr = expr;
+            _instructions.push_back(test);
+        }
+        }
+    }
+
+    void MatchProgram::compileAnd(const MatchExpression* expr) {
+        if (0 == expr->numChildren()) {
+            _instructions.push_back(Instruction(SET_TRUE));
+            return;
+        }
+
+        // Group the leaves by path, in the order the paths first appear.
+        std::vector<AndUnit> units;
+        for (size_t i = 0; i < expr->numChildren(); ++i) {
+            const MatchExpression* child = expr->getChild(i);
+            if (!isPathLeaf(child)) {
+                AndUnit unit;
+                unit.node = child;
+                unit.cost = nodeCost(child);
+                units.push_back(unit);
+                continue;
+            }
+
+            size_t j = 0;
+            while (j < units.size() && (NULL != units[j].node || units[j].path != child->path())) {
+                ++j;
+            }
+            if (units.size() == j) {
+                AndUnit unit;
+                unit.path = child->path();
+                unit.cost = 2;
+                units.push_back(unit);
+            }
+            units[j].leaves.push_back(child);
+            units[j].cost += leafCost(child);
+        }
+
+        // Cheap tests first, so that they can rule the document out before the expensive ones run.
+        for (size_t i = 0; i < units.size(); ++i) {
+            std::stable_sort(units[i].leaves.begin(), units[i].leaves.end(), leafCostLess);
+        }
+        std::stable_sort(units.begin(), units.end(), unitCostLess);
+
+        // Every test but the last one bails out of the $and on a mismatch.
+        std::vector<size_t> toPatch;
+        for (size_t i = 0; i < units.size(); ++i) {
+            const AndUnit& unit = units[i];
+            if (NULL != unit.node) {
+                compileNode(unit.node);
+                if (i + 1 < units.size()) {
+                    emitBranch(false, &toPatch);
+                }
+                continue;
+            }
+
+            emitLoad(unit.path);
+            for (size_t j = 0; j < unit.leaves.size(); ++j) {
+                compileLeafTest(unit.leaves[j]);
+                if (i + 1 < units.size() || j + 1 < unit.leaves.size()) {
+                    emitBranch(false, &toPatch);
+                }
+            }
+        }
+        patchBranches(toPatch);
+    }
+
+    void MatchProgram::compileOr(const MatchExpression* expr) {
+        if (0 == expr->numChildren()) {
+            _instructions.push_back(Instruction(SET_FALSE));
+            return;
+        }
+
+        std::vector<const MatchExpression*> children;
+        for (size_t i = 0; i < expr->numChildren(); ++i) {
+            children.push_back(expr->getChild(i));
+        }
+        std::stable_sort(children.begin(), children.end(), nodeCostLess);
+
+        // Every child but the last one bails out of the $or on a match.
+        std::vector<size_t> toPatch;
+        for (size_t i = 0; i < children.size(); ++i) {
+            compileNode(children[i]);
+            if (i + 1 < children.size()) {
+                emitBranch(true, &toPatch);
+            }
+        }
+        patchBranches(toPatch);
+    }
+
+    void MatchProgram::compileLeafTest(const MatchExpression* expr) {
+        OpCode op;
+        switch (expr->matchType()) {
+        case MatchExpression::EQ: op = TEST_EQ; break;
+        case MatchExpression::LT: op = TEST_LT; break;
+        case MatchExpression::LTE: op = TEST_LTE; break;
+        case MatchExpression::GT: op = TEST_GT; break;
+        case MatchExpression::GTE: op = TEST_GTE; break;
+        default: op = TEST_LEAF; break;
+        }
+
+        Instruction test(op);
+        test.expr = expr;
+        _instructions.push_back(test);
+    }
+
+    void MatchProgram::emitLoad(const StringData& path) {
+        ElementPath* elementPath = new ElementPath();
+        elementPath->init(path);
+        _paths.mutableVector().push_back(elementPath);
+
+        Instruction load(LOAD_PATH);
+        load.path = elementPath;
+        load.slot = _extractor.addPath(elementPath->fieldRef());
+        _instructions.push_back(load);
+    }
+
+    void MatchProgram::emitBranch(bool jumpWhen, std::vector<size_t>* toPatch) {
+        toPatch->push_back(_instructions.size());
+        Instruction branch(BRANCH);
+        branch.jumpWhen = jumpWhen;
+        _instructions.push_back(branch);
+    }
+
+    void MatchProgram::patchBranches(const std::vector<size_t>& toPatch) {
+        for (size_t i = 0; i < toPatch.size(); ++i) {
+            _instructions[toPatch[i]].target = _instructions.size();
+        }
+    }
+
+    // static
+    bool MatchProgram::matchesArray(const LeafMatchExpression* leaf, const ElementPath* path,
+                                    const BSONObj& doc, const FieldExtractor::Slot& loaded) {
+        // Same as LeafMatchExpression::matches, without looking the path up again.
+        BSONElementIterator it;
+        it.reset(path, doc, loaded.element, loaded.idxPath);
+        while (it.more()) {
+            if (leaf->matchesSingleElement(it.next().element())) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool MatchProgram::matchesBSON(const BSONObj& doc) const {
+        // Filled by the first LOAD_PATH.
+        FieldExtractor::Slots slots;
+
+        // Only made if some test has to fall back to the MatchExpression.
+        boost::scoped_ptr<BSONMatchableDocument> matchable;
+
+        const ElementPath* loadedPath = NULL;
+        const FieldExtractor::Slot* loaded = NULL;
+        bool result = true;
+
+        const size_t numInstructions = _instructions.size();
+        size_t pc = 0;
+        while (pc < numInstructions) {
+            const Instruction& ins = _instructions[pc];
+
+            if (BRANCH == ins.op) {
+                pc = (result == ins.jumpWhen) ? ins.target : pc + 1;
+                continue;
+            }
+
+            switch (ins.op) {
+            case LOAD_PATH:
+                if (slots.empty()) {
+                    _extractor.extract(doc, &slots);
+                }
+                loadedPath = ins.path;
+                loaded = &slots[ins.slot];
+                break;
+            case TEST_EQ:
+            case TEST_LT:
+            case TEST_LTE:
+            case TEST_GT:
+            case TEST_GTE: {
+                const ComparisonMatchExpression* cmpExpr =
+                    static_cast<const ComparisonMatchExpression*>(ins.expr);
+
+                if (Array == loaded->element.type()) {
+                    result = matchesArray(cmpExpr, loadedPath, doc, *loaded);
+                    break;
+                }
+
+                int cmp;
+                if (!compareSameTypeNumbers(loaded->element, cmpExpr->getData(), &cmp)) {
+                    result = cmpExpr->ComparisonMatchExpression::matchesSingleElement(
+                        loaded->element);
+                    break;
+                }
+
+                switch (ins.op) {
+                case TEST_EQ: result = (0 == cmp); break;
+                case TEST_LT: result = (cmp < 0); break;
+                case TEST_LTE: result = (cmp <= 0); break;
+                case TEST_GT: result = (cmp > 0); break;
+                default: result = (cmp >= 0); break;
+                }
+                break;
+            }
+            case TEST_LEAF: {
+                const LeafMatchExpression* leaf = static_cast<const LeafMatchExpression*>(ins.expr);
+                if (Array == loaded->element.type()) {
+                    result = matchesArray(leaf, loadedPath, doc, *loaded);
+                }
+                else {
+                    result = leaf->matchesSingleElement(loaded->element);
+                }
+                break;
+            }
+            case TEST_EXPRESSION:
+                if (!matchable) { matchable.reset(new BSONMatchableDocument(doc)); }
+                result = ins.expr->matches(matchable.get(), NULL);
+                break;
+            case SET_TRUE:
+                result = true;
+                break;
+            case SET_FALSE:
+                result = false;
+                break;
+            case NEGATE:
+                result = !result;
+                break;
+            case BRANCH:
+                verify(0);
+            }
+            ++pc;
+        }
+
+        return result;
+    }
+
+    std::string MatchProgram::toString() const {
+        mongoutils::str::stream ss;
+        for (size_t i = 0; i < _instructions.size(); ++i) {
+            const Instruction& ins = _instructions[i];
+            ss << i << ": ";
+            switch (ins.op) {
+            case LOAD_PATH: ss << "LOAD " << ins.path->fieldRef().dottedField() << "\n"; break;
+            case TEST_EQ: ss << "EQ " << ins.expr->toString(); break;
+            case TEST_LT: ss << "LT " << ins.expr->toString(); break;
+            case TEST_LTE: ss << "LTE " << ins.expr->toString(); break;
+            case TEST_GT: ss << "GT " << ins.expr->toString(); break;
+            case TEST_GTE: ss << "GTE " << ins.expr->toString(); break;
+            case TEST_LEAF: ss << "LEAF " << ins.expr->toString(); break;
+            case TEST_EXPRESSION: ss << "EXPRESSION " << ins.expr->toString(); break;
+            case SET_TRUE: ss << "SET_TRUE\n"; break;
+            case SET_FALSE: ss << "SET_FALSE\n"; break;
+            case NEGATE: ss << "NEGATE\n"; break;
+            case BRANCH:
+                ss << "BRANCH if " << (ins.jumpWhen ? "true" : "false") << " to " << ins.target
+                   << "\n";
+                break;
+            }
+        }
+        return ss;
+    }
+
+}  // namespace mongo
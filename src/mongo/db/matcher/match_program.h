@@ -0,0 +1,166 @@
+// match_program.h
+
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/owned_pointer_vector.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/db/field_extractor.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/path.h"
+
+namespace mongo {
+
+    class LeafMatchExpression;
+
+    /**
+     * A MatchExpression flattened into a program for a small interpreter, for matching many
+     * documents against the same expression.
+     *
+     * - All the paths are looked up in a single walk over the document, with a FieldExtractor.
+     * - The leaves of an $and that share a path are grouped, so that the path is loaded once
+     *   per document rather than once per leaf.
+     * - The children of an $and or $or are ordered so that cheap tests run, and can short-circuit,
+     *   before expensive ones such as $regex or $where.
+     * - Comparisons of two numbers of the same type skip the generic BSON comparison.
+     *
+     * A path that runs into an array is iterated with array semantics, picking up from the array
+     * the walk found, and a node the program doesn't know is not flattened but left to the
+     * original MatchExpression.  So the program matches exactly the documents the expression
+     * does.  The expression must outlive the program.
+     */
+    class MatchProgram {
+        MONGO_DISALLOW_COPYING(MatchProgram);
+    public:
+        /**
+         * Flattens 'root', which is not owned.  Never fails: anything that can't be flattened is
+         * run by the expression itself.  Caller owns the returned program.
+         */
+        static MatchProgram* compile(const MatchExpression* root);
+
+        /**
+         * Same as root->matchesBSON(doc), without details.
+         */
+        bool matchesBSON(const BSONObj& doc) const;
+
+        /**
+         * How many instructions the program has.  For tests.
+         */
+        size_t size() const { return _instructions.size(); }
+
+        std::string toString() const;
+
+    private:
+        enum OpCode {
+            // Looks the path up in the document.
+            LOAD_PATH,
+
+            // Tests the loaded element against a leaf.
+            TEST_EQ,
+            TEST_LT,
+            TEST_LTE,
+            TEST_GT,
+            TEST_GTE,
+            TEST_LEAF,
+
+            // Runs a whole subtree through the MatchExpression.
+            TEST_EXPRESSION,
+
+            // Sets the result.
+            SET_TRUE,
+            SET_FALSE,
+
+            // Negates the result.
+            NEGATE,
+
+            // Jumps to 'target' if the result is 'jumpWhen'.
+            BRANCH,
+        };
+
+        struct Instruction {
+            Instruction(OpCode op)
+                : op(op), expr(NULL), path(NULL), slot(0), target(0), jumpWhen(false) { }
+
+            OpCode op;
+
+            // For the tests: the expression to test.  Not owned.
+            const MatchExpression* expr;
+
+            // For LOAD_PATH.  Owned by the program.
+            const ElementPath* path;
+            size_t slot;
+
+            // For BRANCH.
+            size_t target;
+            bool jumpWhen;
+        };
+
+        MatchProgram() { }
+
+        /**
+         * Appends the instructions that leave in the result whether 'expr' matches.
+         */
+        void compileNode(const MatchExpression* expr);
+
+        void compileAnd(const MatchExpression* expr);
+
+        void compileOr(const MatchExpression* expr);
+
+        /**
+         * Appends a test of the element loaded from 'expr''s path.
+         */
+        void compileLeafTest(const MatchExpression* expr);
+
+        void emitLoad(const StringData& path);
+
+        /**
+         * Appends a BRANCH whose target is set later with patchBranches.
+         */
+        void emitBranch(bool jumpWhen, std::vector<size_t>* toPatch);
+
+        void patchBranches(const std::vector<size_t>& toPatch);
+
+        /**
+         * Whether 'leaf' matches any of the elements an array 'loaded' from 'path' stands for.
+         */
+        static bool matchesArray(const LeafMatchExpression* leaf, const ElementPath* path,
+                                 const BSONObj& doc, const FieldExtractor::Slot& loaded);
+
+        std::vector<Instruction> _instructions;
+
+        OwnedPointerVector<ElementPath> _paths;
+
+        FieldExtractor _extractor;
+    };
+
+}  // namespace mongo
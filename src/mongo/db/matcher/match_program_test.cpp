@@ -0,0 +1,147 @@
+// match_program_test.cpp
+
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/unittest/unittest.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/matcher/match_program.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    namespace {
+
+        const char* const kDocs[] = {
+            "{}",
+            "{a: 5}",
+            "{a: 5.5, b: 'x'}",
+            "{a: -3, b: 'y', c: true}",
+            "{a: NumberLong(5)}",
+            "{a: null}",
+            "{a: 'five'}",
+            "{a: [1, 5, 9]}",
+            "{a: [[5]]}",
+            "{a: {b: 3}}",
+            "{a: {b: [2, 3]}}",
+            "{a: [{b: 1}, {b: 7}]}",
+            "{a: {b: {c: 'z'}}, b: 'xyz'}",
+            "{a: 5, b: ['x', 'y']}",
+            "{b: 'abc', c: 12}",
+        };
+
+        const char* const kQueries[] = {
+            "{}",
+            "{a: 5}",
+            "{a: null}",
+            "{a: {$gt: 2, $lt: 6}}",
+            "{a: {$gte: 5, $lte: 5}}",
+            "{a: {$ne: 5}}",
+            "{a: {$in: [5, 'five']}}",
+            "{a: {$nin: [5, null]}}",
+            "{a: {$exists: true}, b: {$exists: false}}",
+            "{a: {$mod: [2, 1]}}",
+            "{b: /^x/}",
+            "{b: /^x/, a: {$lt: 10}}",
+            "{'a.b': 3}",
+            "{'a.b': {$gt: 1}}",
+            "{'a.b.c': 'z'}",
+            "{'a.1': 5}",
+            "{a: [5]}",
+            "{a: {$size: 3}}",
+            "{a: {$elemMatch: {$gt: 4, $lt: 6}}}",
+            "{a: {$all: [1, 5]}}",
+            "{a: {$type: 2}}",
+            "{$or: [{a: 5}, {b: 'x'}]}",
+            "{$or: [{b: /z$/}, {c: {$gte: 12}}]}",
+            "{$nor: [{a: 5}, {b: 'y'}]}",
+            "{$and: [{a: {$gt: 0}}, {$or: [{b: 'x'}, {b: 'y'}]}]}",
+            "{a: {$not: {$gt: 5}}}",
+            "{$and: [{$or: [{a: 5}, {'a.b': 3}]}, {b: {$ne: 'x'}}]}",
+            "{a: {$gt: 5}, b: /y/, c: true, 'a.b': {$exists: false}}",
+        };
+
+        /**
+         * The returned expression points into 'query', which must outlive it.
+         */
+        MatchExpression* parse(const BSONObj& query) {
+            StatusWithMatchExpression result = MatchExpressionParser::parse(query);
+            ASSERT_TRUE(result.isOK());
+            return result.getValue();
+        }
+
+    }  // namespace
+
+    TEST(MatchProgramTest, MatchesWhatTheExpressionMatches) {
+        for (size_t i = 0; i < sizeof(kQueries) / sizeof(kQueries[0]); ++i) {
+            BSONObj query = fromjson(kQueries[i]);
+            auto_ptr<MatchExpression> expr(parse(query));
+            auto_ptr<MatchProgram> program(MatchProgram::compile(expr.get()));
+
+            for (size_t j = 0; j < sizeof(kDocs) / sizeof(kDocs[0]); ++j) {
+                BSONObj doc = fromjson(kDocs[j]);
+                if (expr->matchesBSON(doc, NULL) != program->matchesBSON(doc)) {
+                    FAIL(mongoutils::str::stream() << kQueries[i] << " on " << kDocs[j]
+                                                   << " differs from\n" << program->toString());
+                }
+            }
+        }
+    }
+
+    TEST(MatchProgramTest, GroupsLeavesByPath) {
+        BSONObj query = fromjson("{a: {$gt: 1, $lt: 9}, b: 2, c: {$ne: 3}}");
+        auto_ptr<MatchExpression> expr(parse(query));
+        auto_ptr<MatchProgram> program(MatchProgram::compile(expr.get()));
+
+        // One load and one test with a branch for 'b', one load and two tests with branches for
+        // 'a', and a load, a test and a negation for the $ne.
+        ASSERT_EQUALS(11U, program->size());
+
+        std::string str = program->toString();
+        size_t numLoads = 0;
+        for (size_t pos = str.find("LOAD"); std::string::npos != pos;
+             pos = str.find("LOAD", pos + 1)) {
+            ++numLoads;
+        }
+        ASSERT_EQUALS(3U, numLoads);
+    }
+
+    TEST(MatchProgramTest, RunsCheapTestsFirst) {
+        BSONObj query = fromjson("{b: /x/, a: 1}");
+        auto_ptr<MatchExpression> expr(parse(query));
+        auto_ptr<MatchProgram> program(MatchProgram::compile(expr.get()));
+
+        std::string str = program->toString();
+        ASSERT_LESS_THAN(str.find("EQ"), str.find("LEAF"));
+    }
+
+}  // namespace mongo
@@ -50,13 +50,18 @@ namespace mongo {
                  result.isOK() );
 
         _expression.reset( result.getValue() );
+        _program.reset( MatchProgram::compile( _expression.get() ) );
     }
 
     bool Matcher2::matches(const BSONObj& doc, MatchDetails* details ) const {
         if ( !_expression )
             return true;
 
-        return _expression->matchesBSON( doc, details );
+        // Only the tree knows which array element matched.
+        if ( details && details->needRecord() )
+            return _expression->matchesBSON( doc, details );
+
+        return _program->matchesBSON( doc );
     }
 
 }  // namespace mongo
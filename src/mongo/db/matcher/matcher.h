@@ -37,6 +37,7 @@
 #include "mongo/bson/bsonobj.h"
 #include "mongo/db/matcher/expression.h"
 #include "mongo/db/matcher/match_details.h"
+#include "mongo/db/matcher/match_program.h"
 
 namespace mongo {
 
@@ -59,6 +60,9 @@ namespace mongo {
         BSONObj _pattern;
 
         boost::scoped_ptr<MatchExpression> _expression;
+
+        // '_expression' flattened, for when no details are recorded.
+        boost::scoped_ptr<MatchProgram> _program;
     };
 
 }  // namespace mongo
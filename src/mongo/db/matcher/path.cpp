@@ -87,11 +87,13 @@ namespace mongo {
     // ------
     BSONElementIterator::BSONElementIterator() {
         _path = NULL;
+        _haveFirst = false;
     }
 
     BSONElementIterator::BSONElementIterator( const ElementPath* path, const BSONObj& context )
         : _path( path ), _context( context ) {
         _state = BEGIN;
+        _haveFirst = false;
         //log() << "path: " << path.fieldRef().dottedField() << " context: " << context << endl;
     }
 
@@ -104,10 +106,20 @@ namespace mongo {
         _state = BEGIN;
         _next.reset();
 
+        _haveFirst = false;
+
         _subCursor.reset();
         _subCursorPath.reset();
     }
 
+    void BSONElementIterator::reset( const ElementPath* path, const BSONObj& context,
+                                     BSONElement first, size_t idxPath ) {
+        reset( path, context );
+        _haveFirst = true;
+        _first = first;
+        _firstIdxPath = idxPath;
+    }
+
 
     void BSONElementIterator::ArrayIterationState::reset( const FieldRef& ref, int start ) {
         restOfPath = ref.dottedField( start ).toString();
@@ -177,7 +189,14 @@ namespace mongo {
 
         if ( _state == BEGIN ) {
             size_t idxPath = 0;
-            BSONElement e = getFieldDottedOrArray( _context, _path->fieldRef(), &idxPath );
+            BSONElement e;
+            if ( _haveFirst ) {
+                e = _first;
+                idxPath = _firstIdxPath;
+            }
+            else {
+                e = getFieldDottedOrArray( _context, _path->fieldRef(), &idxPath );
+            }
 
             if ( e.type() != Array ) {
                 _next.reset( e, BSONElement(), false );
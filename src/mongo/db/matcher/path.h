@@ -122,6 +122,14 @@ namespace mongo {
 
         void reset( const ElementPath* path, const BSONObj& context );
 
+        /**
+         * Like reset( path, context ), for when the path was already looked up in 'context',
+         * e.g. by a FieldExtractor: 'first' and 'idxPath' are what getFieldDottedOrArray
+         * returns for it.
+         */
+        void reset( const ElementPath* path, const BSONObj& context,
+                    BSONElement first, size_t idxPath );
+
         bool more();
         Context next();
 
@@ -132,6 +140,11 @@ namespace mongo {
         enum State { BEGIN, IN_ARRAY, DONE } _state;
         Context _next;
 
+        // Set when the lookup of the path in _context is already done.
+        bool _haveFirst;
+        BSONElement _first;
+        size_t _firstIdxPath;
+
         struct ArrayIterationState {
 
             void reset( const FieldRef& ref, int start );
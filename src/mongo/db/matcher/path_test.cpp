@@ -31,6 +31,7 @@
 
 #include "mongo/unittest/unittest.h"
 
+#include "mongo/db/field_extractor.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/path.h"
 
@@ -311,6 +312,33 @@ namespace mongo {
         ASSERT( !cursor.more() );
     }
 
+    TEST( Path, StartFromExtractedField ) {
+        ElementPath p;
+        ASSERT( p.init( "x.a.b" ).isOK() );
+
+        BSONObj doc = BSON( "x" << BSON( "a" << BSON_ARRAY( BSON( "b" << 1 ) <<
+                                                            BSON( "b" << 2 ) ) ) );
+
+        FieldExtractor extractor;
+        extractor.addPath( p.fieldRef() );
+        FieldExtractor::Slots slots;
+        extractor.extract( doc, &slots );
+        ASSERT_EQUALS( 1U, slots[0].idxPath );
+
+        BSONElementIterator cursor;
+        cursor.reset( &p, doc, slots[0].element, slots[0].idxPath );
+
+        ASSERT( cursor.more() );
+        BSONElementIterator::Context e = cursor.next();
+        ASSERT_EQUALS( 1, e.element().numberInt() );
+
+        ASSERT( cursor.more() );
+        e = cursor.next();
+        ASSERT_EQUALS( 2, e.element().numberInt() );
+
+        ASSERT( !cursor.more() );
+    }
+
     TEST( SimpleArrayElementIterator, SimpleNoArrayLast1 ) {
         BSONObj obj = BSON( "a" << BSON_ARRAY( 5 << BSON( "x" << 6 ) << BSON_ARRAY( 7 << 9 ) << 11 ) );
         SimpleArrayElementIterator i( obj["a"], false );
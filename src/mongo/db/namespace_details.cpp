@@ -87,6 +87,7 @@ namespace mongo {
         _reservedA = 0;
         _extraOffset = 0;
         _indexBuildsInProgress = 0;
+        memset(_multikeyPaths, 0, sizeof(_multikeyPaths));
         memset(_reserved, 0, sizeof(_reserved));
     }
 
@@ -209,6 +210,11 @@ namespace mongo {
         if ( loc.isNull() )
             return loc;
 
+        return claimDeletedRecord(ns, loc, lenToAlloc);
+    }
+
+    DiskLoc NamespaceDetails::claimDeletedRecord(const StringData& ns, const DiskLoc& loc,
+                                                 int lenToAlloc) {
         DeletedRecord *r = loc.drec();
         //r = getDur().writing(r);
 
@@ -436,17 +442,38 @@ namespace mongo {
         return e;
     }
 
-    bool NamespaceDetails::setIndexIsMultikey(int i, bool multikey) {
+    unsigned NamespaceDetails::multikeyFields(int i) const {
+        if (!isMultikey(i)) {
+            return 0;
+        }
+        unsigned char paths = _multikeyPaths[i];
+        if (!(paths & MultikeyPathsKnown)) {
+            return ~0u;
+        }
+        return (paths & MultikeyPathsMask) | ~static_cast<unsigned>(MultikeyPathsMask);
+    }
+
+    bool NamespaceDetails::setIndexIsMultikey(int i, bool multikey, unsigned fields) {
         massert(16577, "index number greater than NIndexesMax", i < NIndexesMax );
 
         unsigned long long mask = 1ULL << i;
 
         if (multikey) {
-            // Shortcut if the bit is already set correctly
+            unsigned char paths = fields & MultikeyPathsMask;
+
             if (_multiKeyIndexBits & mask) {
-                return false;
+                // Shortcut if the bits are already set correctly.  If we didn't know the paths
+                // when the index became multikey we never will.
+                unsigned char known = _multikeyPaths[i];
+                if (!(known & MultikeyPathsKnown) || (known & paths) == paths) {
+                    return false;
+                }
+                *getDur().writing(&_multikeyPaths[i]) = known | paths;
+                return true;
             }
 
+            // Any document before this one had one value per field, so the paths are complete.
+            *getDur().writing(&_multikeyPaths[i]) = MultikeyPathsKnown | paths;
             *getDur().writing(&_multiKeyIndexBits) |= mask;
         }
         else {
@@ -458,6 +485,7 @@ namespace mongo {
             // Invert mask: all 1's except a 0 at the ith bit
             mask = ~mask;
             *getDur().writing(&_multiKeyIndexBits) &= mask;
+            *getDur().writing(&_multikeyPaths[i]) = 0;
         }
 
         return true;
@@ -725,6 +753,9 @@ namespace mongo {
 
         // fix the _multiKeyIndexBits, by moving all bits above me down one
         d->_multiKeyIndexBits = removeAndSlideBit(d->_multiKeyIndexBits, idxNumber);
+        memmove(&d->_multikeyPaths[idxNumber], &d->_multikeyPaths[idxNumber + 1],
+                NIndexesMax - idxNumber - 1);
+        d->_multikeyPaths[NIndexesMax - 1] = 0;
 
         if ( idxNumber >= _nIndexes )
             d->_indexBuildsInProgress--;
@@ -744,10 +775,14 @@ namespace mongo {
         *getDur().writing(&idx(a)) = idx(b);
         *getDur().writing(&idx(b)) = temp;
 
-        // flip multi key bits
+        // flip multi key bits, and the paths with them
         bool tempMultikey = isMultikey(a);
+        unsigned char pathsA = _multikeyPaths[a];
+        unsigned char pathsB = _multikeyPaths[b];
         setIndexIsMultikey( a, isMultikey(b) );
         setIndexIsMultikey( b, tempMultikey );
+        *getDur().writing(&_multikeyPaths[a]) = pathsB;
+        *getDur().writing(&_multikeyPaths[b]) = pathsA;
     }
 
     void NamespaceDetails::orphanDeletedList() {
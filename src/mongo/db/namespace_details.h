@@ -118,8 +118,15 @@ namespace mongo {
         int _indexBuildsInProgress;            // Number of indexes currently being built
 
         int _userFlags;
-        char _reserved[72];
+
+        // ofs 424.  For each multikey index, which fields of its key pattern have had more than
+        // one value in a document: bit j for field j < 7, and MultikeyPathsKnown if the bits are
+        // complete, i.e. they have been kept since the index first became multikey.
+        unsigned char _multikeyPaths[NIndexesMax];
+        char _reserved[8];
         /*-------- end data 496 bytes */
+        enum { MultikeyPathsKnown = 0x80, MultikeyPathsMask = 0x7f };
+
     public:
         explicit NamespaceDetails( const DiskLoc &loc, bool _capped );
 
@@ -225,6 +232,12 @@ namespace mongo {
         void cappedDumpDelInfo();
         bool capLooped() const { return _isCapped && _capFirstNewRecord.isValid();  }
         bool inCapExtent( const DiskLoc &dl ) const;
+        /**
+         * Grow the deleted record(s) of capExtent adjacent to the just unlinked record at
+         * 'dl' over it, instead of putting it on the deleted list for compact() to merge.
+         * @return false if nothing is adjacent and the caller should addDeletedRec() as usual
+         */
+        bool cappedMergeIntoWriteGap( const DiskLoc& dl, int lengthWithHeaders );
         void cappedCheckMigrate();
         /**
          * Truncate documents newer than the document at 'end' from the capped
@@ -253,7 +266,9 @@ namespace mongo {
         };
 
         enum UserFlags {
-            Flag_UsePowerOf2Sizes = 1 << 0
+            Flag_UsePowerOf2Sizes = 1 << 0,
+            Flag_NoScanReadahead = 1 << 1, // collection scans don't madvise() ahead of the cursor
+            Flag_CompressRecords = 1 << 2 // new records are stored compressed, see RecordCompression
         };
 
         IndexDetails& idx(int idxNo, bool missingExpected = false );
@@ -284,9 +299,17 @@ namespace mongo {
         bool isMultikey(int i) const { return (_multiKeyIndexBits & (((unsigned long long) 1) << i)) != 0; }
 
         /**
+         * Which fields of index i's key pattern may have more than one value in a document, bit j
+         * for field j.  0 if the index isn't multikey.  Fields we don't keep track of (those past
+         * the 7th, or all of them for indexes that were multikey before we started) are set.
+         */
+        unsigned multikeyFields(int i) const;
+
+        /**
+         * @param fields when setting, the fields that had more than one value, as above
          * @return - if any state was changed
          */
-        bool setIndexIsMultikey(int i, bool multikey = true);
+        bool setIndexIsMultikey(int i, bool multikey = true, unsigned fields = ~0u);
 
         /**
          * This fetches the IndexDetails for the next empty index slot. The caller must populate
@@ -441,6 +464,14 @@ namespace mongo {
         */
         DiskLoc alloc(const StringData& ns, int lenToAlloc);
 
+        /** finish an allocation out of a deleted record the caller has already unlinked from
+            the deleted lists, splitting any excess back onto them.  this is the second half of
+            alloc(), for allocators that find free space some other way.
+            @param lenToAlloc is WITH header and already aligned
+            @return loc
+        */
+        DiskLoc claimDeletedRecord(const StringData& ns, const DiskLoc& loc, int lenToAlloc);
+
         /* add a given record to the deleted chains for this NS */
         void addDeletedRec(DeletedRecord *d, DiskLoc dloc);
         void dumpDeleted(set<DiskLoc> *extents = 0);
@@ -32,6 +32,7 @@
 
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/query/get_runner.h"
+#include "mongo/db/query/query_planner_params.h"
 
 namespace mongo {
 
@@ -85,16 +86,16 @@ namespace mongo {
             return applySkipLimit(d->numRecords(), cmd);
         }
 
+        // Skip and limit are applied to the count rather than the query, so that the planner
+        // can count index keys when the index answers the query by itself.
         CanonicalQuery* cq;
-        // We pass -limit because a positive limit means 'batch size' but negative limit is a
-        // hard limit.
-        if (!CanonicalQuery::canonicalize(ns, query, skip, -limit, &cq).isOK()) {
+        if (!CanonicalQuery::canonicalize(ns, query, &cq).isOK()) {
             uasserted(17220, "could not canonicalize query " + query.toString());
             return -2;
         }
 
         Runner* rawRunner;
-        if (!getRunner(cq, &rawRunner).isOK()) {
+        if (!getRunner(cq, &rawRunner, QueryPlannerParams::PRIVATE_IS_COUNT).isOK()) {
             uasserted(17221, "could not get runner " + query.toString());
             return -2;
         }
@@ -107,14 +108,20 @@ namespace mongo {
             runner->setYieldPolicy(Runner::YIELD_AUTO);
             safety.reset(new DeregisterEvenIfUnderlyingCodeThrows(runner.get()));
 
+            // No need to count past what the limit lets through.
+            const long long enough = (limit > 0) ? std::max(skip, 0LL) + limit : 0;
+
             Runner::RunnerState state;
             while (Runner::RUNNER_ADVANCED == (state = runner->getNext(NULL, NULL))) {
                 ++count;
+                if (count == enough) {
+                    break;
+                }
             }
 
             // Emulate old behavior and return the count even if the runner was killed.  This
             // happens when the underlying collection is dropped.
-            return count;
+            return applySkipLimit(count, cmd);
         }
         catch (const DBException &e) {
             err = e.toString();
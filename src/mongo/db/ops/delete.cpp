@@ -32,18 +32,23 @@
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/query/get_runner.h"
 #include "mongo/db/query/query_planner_common.h"
+#include "mongo/db/query/runner_yield_policy.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/structure/collection.h"
 
 
 namespace mongo {
 
+    // Most documents a multi-delete collects before deleting them together; it doesn't yield
+    // while collecting them, so their locations stay valid.
+    static const size_t kMaxDeleteBatchSize = 100;
+
     /* ns:      namespace, e.g. <database>.<collection>
        pattern: the "where" clause / criteria
        justOne: stop after 1 match
        god:     allow access to system namespaces, and don't yield
     */
-    long long deleteObjects(const StringData& ns, BSONObj pattern, bool justOne, bool logop, bool god) {
+    void assertCanDeleteFrom(const StringData& ns, const NamespaceDetails* d, bool god) {
         if (!god) {
             if (ns.find( ".system.") != string::npos) {
                 // note a delete from system.indexes would corrupt the db if done here, as there are
@@ -57,15 +62,18 @@ namespace mongo {
             }
         }
 
+        uassert(10101,
+                str::stream() << "can't remove from a capped collection: " << ns,
+                NULL == d || !d->isCapped());
+    }
+
+    long long deleteObjects(const StringData& ns, BSONObj pattern, bool justOne, bool logop, bool god) {
         NamespaceDetails *d = nsdetails(ns);
+        assertCanDeleteFrom(ns, d, god);
         if (NULL == d) {
             return 0;
         }
 
-        uassert(10101,
-                str::stream() << "can't remove from a capped collection: " << ns,
-                !d->isCapped());
-
         string nsForLogOp = ns.toString(); // XXX-ERH
 
         long long nDeleted = 0;
@@ -87,18 +95,30 @@ namespace mongo {
         auto_ptr<Runner> runner(rawRunner);
         auto_ptr<DeregisterEvenIfUnderlyingCodeThrows> safety;
 
+        // The runner stays registered so that it hears of the deletes, but yields only between
+        // batches.
+        RunnerYieldPolicy yieldPolicy;
         if (canYield) {
             ClientCursor::registerRunner(runner.get());
-            runner->setYieldPolicy(Runner::YIELD_AUTO);
             safety.reset(new DeregisterEvenIfUnderlyingCodeThrows(runner.get()));
         }
 
-        DiskLoc rloc;
-        Runner::RunnerState state;
-        while (Runner::RUNNER_ADVANCED == (state = runner->getNext(NULL, &rloc))) {
-            if (logop) {
+        const size_t batchSize = justOne ? 1 : kMaxDeleteBatchSize;
+        vector<DiskLoc> batch;
+        Runner::RunnerState state = Runner::RUNNER_ADVANCED;
+        while (Runner::RUNNER_ADVANCED == state) {
+            batch.clear();
+
+            DiskLoc rloc;
+            while (batch.size() < batchSize &&
+                   Runner::RUNNER_ADVANCED == (state = runner->getNext(NULL, &rloc))) {
+                batch.push_back(rloc);
+            }
+            if (batch.empty()) { break; }
+
+            for (size_t i = 0; logop && i < batch.size(); ++i) {
                 BSONElement idElt;
-                if (BSONObj::make(rloc.rec()).getObjectID(idElt)) {
+                if (BSONObj::make(batch[i].rec()).getObjectID(idElt)) {
                     BSONObjBuilder bob;
                     bob.append(idElt);
                     bool replJustOne = true;
@@ -109,15 +129,18 @@ namespace mongo {
                 }
             }
 
-            // XXX: do we want to buffer docs and delete them in a group rather than
-            // saving/restoring state repeatedly?
             runner->saveState();
             Collection* collection = currentClient.get()->database()->getCollection(ns);
             verify( collection );
-            collection->deleteDocument(rloc);
-            runner->restoreState();
+            if (1 == batch.size()) {
+                collection->deleteDocument(batch[0]);
+            }
+            else {
+                collection->deleteDocuments(batch);
+            }
 
-            nDeleted++;
+            long long deletedBefore = nDeleted;
+            nDeleted += batch.size();
 
             if (justOne) { break; }
 
@@ -125,7 +148,12 @@ namespace mongo {
                 getDur().commitIfNeeded();
             }
 
-            if (debug && god && nDeleted == 100) {
+            if (canYield && yieldPolicy.shouldYield()) {
+                yieldPolicy.yield();
+            }
+            if (!runner->restoreState()) { break; }
+
+            if (debug && god && deletedBefore < 100 && nDeleted >= 100) {
                 // TODO: why does this use significant memory??
                 log() << "warning high number of deletes with god=true which could use significant memory" << endl;
             }
@@ -34,6 +34,15 @@
 
 namespace mongo {
 
+    class NamespaceDetails;
+
+    /**
+     * uasserts unless documents can be removed from ns: it must not be a system namespace or
+     * have a reserved $ in its name, unless god, nor be capped.  d may be NULL if ns doesn't
+     * exist.
+     */
+    void assertCanDeleteFrom(const StringData& ns, const NamespaceDetails* d, bool god = false);
+
     // If justOne is true, deletedId is set to the id of the deleted object.
     long long deleteObjects(const StringData& ns,
                             BSONObj pattern,
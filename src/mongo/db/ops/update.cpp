@@ -51,6 +51,7 @@
 #include "mongo/db/queryutil.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/storage/record.h"
+#include "mongo/db/storage/record_compression.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/platform/unordered_set.h"
 
@@ -416,6 +417,22 @@ namespace mongo {
             return Status::OK();
         }
 
+        /**
+         * Whether a multi-update with 'query' can walk the _id index, in _id order, without
+         * giving up a better index: true if the query has no predicate other than on _id.
+         */
+        bool canWalkIdIndex(Collection* collection, const BSONObj& query) {
+            if (!collection || collection->details()->isCapped() ||
+                    !collection->details()->haveIdIndex())
+                return false;
+
+            BSONForEach(e, query) {
+                if (!str::equals(e.fieldName(), idFieldName))
+                    return false;
+            }
+            return true;
+        }
+
     } // namespace
 
     UpdateResult update(const UpdateRequest& request, OpDebug* opDebug) {
@@ -465,8 +482,17 @@ namespace mongo {
             driver->refreshIndexKeys(indexes);
         }
 
+        // A multi-update which walks the _id index, as a $snapshot query does, sees every
+        // document in _id order.  A document moved by its update keeps its _id, so it can only
+        // come up again behind the last _id updated, and the last _id is all there is to keep
+        // to skip it; otherwise the new location of every moved document has to be kept.
+        const bool idOrdered = request.isMulti() && canWalkIdIndex(collection,
+                                                                   request.getQuery());
+
         CanonicalQuery* cq;
-        if (!CanonicalQuery::canonicalize(nsString, request.getQuery(), &cq).isOK()) {
+        if (!CanonicalQuery::canonicalize(nsString.ns(), request.getQuery(), request.getSort(),
+                                          BSONObj(), 0, 0, BSONObj(), BSONObj(), BSONObj(),
+                                          idOrdered /* snapshot */, &cq).isOK()) {
             uasserted(17242, "could not canonicalize query " + request.getQuery().toString());
         }
 
@@ -506,6 +532,9 @@ namespace mongo {
         // NOTE: We only store the locs of moved docs, since the runner will keep track of the rest
         unordered_set<DiskLoc, DiskLoc::Hasher> updatedLocs;
 
+        // When walking the _id index, the _id of the last document updated
+        BSONObj lastId;
+
         // Reset these counters on each call. We might re-enter this function to retry this
         // update if we throw a page fault exception below, and we rely on these counters
         // reflecting only the actions taken locally. In particlar, we must have the no-op
@@ -519,6 +548,10 @@ namespace mongo {
         // Used during iteration of docs
         BSONObj oldObj;
 
+        // Images of the document updated, if the request wants them
+        BSONObj oldDoc;
+        BSONObj newDoc;
+
         // Keep track if we have done a write in isolation mode, which will indicate we can't yield
         bool isolationModeWriteOccured = false;
 
@@ -564,9 +597,17 @@ namespace mongo {
             if (didYield)
                 uassertStatusOK(recoverFromYield(lifecycle, driver, collection, nsString));
 
+            if (idOrdered) {
+                // Anything not past the last _id updated has been updated already
+                BSONElement id = oldObj[idFieldName];
+                if (!lastId.isEmpty() && id.woCompare(lastId.firstElement(), false) <= 0) {
+                    continue;
+                }
+                lastId = id.wrap();
+            }
             // We fill this with the new locs of moved doc so we don't double-update.
             // NOTE: The runner will de-dup non-moved things.
-            if (updatedLocs.count(loc) > 0) {
+            else if (updatedLocs.count(loc) > 0) {
                 continue;
             }
 
@@ -579,6 +620,10 @@ namespace mongo {
             // Found a matching document
             numMatched++;
 
+            // Copy it before an update in place changes it under us
+            if (request.shouldStoreResultDocs())
+                oldDoc = oldObj.getOwned();
+
             // Ask the driver to apply the mods. It may be that the driver can apply those "in
             // place", that is, some values of the old document just get adjusted without any
             // change to the binary layout on the bson layer. It may be that a whole new
@@ -651,6 +696,11 @@ namespace mongo {
             // Save state before making changes
             runner->saveState();
 
+            // A compressed record's oldObj is a decompressed copy, so there is nothing on disk
+            // to apply the damages to.
+            if (inPlace && RecordCompression::isCompressed(loc.rec()->dataNoThrowing()))
+                inPlace = false;
+
             if (inPlace && !driver->modsAffectIndices()) {
 
                 // If a set of modifiers were all no-ops, we are still 'in place', but there is
@@ -676,19 +726,24 @@ namespace mongo {
             }
             else {
 
-                // The updates were not in place. Apply them through the file manager.
+                // The updates were not in place. Apply them through the file manager. The
+                // fields the mods touched tell the collection which indexes need new keys; a
+                // replacement can touch any of them.
+                const bool knownFields = !driver->isDocReplacement() && !updatedFields.empty();
                 newObj = doc.getObject();
                 StatusWith<DiskLoc> res = collection->updateDocument(loc,
                                                                      newObj,
                                                                      true,
-                                                                     opDebug);
+                                                                     opDebug,
+                                                                     knownFields ?
+                                                                         &updatedFields : NULL);
                 uassertStatusOK(res.getStatus());
                 DiskLoc newLoc = res.getValue();
 
                 // If we've moved this object to a new location, make sure we don't apply
                 // that update again if our traversal picks the object again.
                 // NOTE: The runner takes care of deduping non-moved docs.
-                if (newLoc != loc) {
+                if (newLoc != loc && !idOrdered) {
                     updatedLocs.insert(newLoc);
                 }
 
@@ -713,6 +768,9 @@ namespace mongo {
             if (docWasModified)
                 opDebug->nDocsModified++;
 
+            if (request.shouldStoreResultDocs())
+                newDoc = newObj.getOwned();
+
             if (!request.isMulti()) {
                 break;
             }
@@ -724,11 +782,14 @@ namespace mongo {
         // TODO: Can this be simplified?
         if ((numMatched > 0) || (numMatched == 0 && !request.isUpsert()) ) {
             opDebug->nupdated = numMatched;
-            return UpdateResult(numMatched > 0 /* updated existing object(s) */,
+            UpdateResult result(numMatched > 0 /* updated existing object(s) */,
                                 !driver->isDocReplacement() /* $mod or obj replacement */,
                                 opDebug->nDocsModified /* number of modified docs, no no-ops */,
                                 numMatched /* # of docs matched/updated, even no-ops */,
                                 BSONObj());
+            result.oldDoc = oldDoc;
+            result.newDoc = newDoc;
+            return result;
         }
 
         //
@@ -830,11 +891,14 @@ namespace mongo {
         }
 
         opDebug->nupdated = 1;
-        return UpdateResult(false /* updated a non existing document */,
+        UpdateResult result(false /* updated a non existing document */,
                             !driver->isDocReplacement() /* $mod or obj replacement? */,
                             1 /* docs written*/,
                             1 /* count of updated documents */,
                             newObj /* object that was upserted */ );
+        if (request.shouldStoreResultDocs())
+            result.newDoc = newObj;
+        return result;
     }
 
     BSONObj applyUpdateOperators(const BSONObj& from, const BSONObj& operators) {
@@ -50,6 +50,7 @@ namespace mongo {
             , _callLogOp(false)
             , _fromMigration(false)
             , _fromReplication(false)
+            , _storeResultDocs(false)
             , _lifecycle(NULL) {}
 
         const NamespaceString& getNamespaceString() const {
@@ -72,6 +73,14 @@ namespace mongo {
             return _updates;
         }
 
+        inline void setSort(const BSONObj& sort) {
+            _sort = sort;
+        }
+
+        inline const BSONObj& getSort() const {
+            return _sort;
+        }
+
         // Please see documentation on the private members matching these names for
         // explanations of the following fields.
 
@@ -123,6 +132,14 @@ namespace mongo {
             return _fromReplication;
         }
 
+        inline void setStoreResultDocs(bool value = true) {
+            _storeResultDocs = value;
+        }
+
+        bool shouldStoreResultDocs() const {
+            return _storeResultDocs;
+        }
+
         inline void setLifecycle(const UpdateLifecycle* value) {
             _lifecycle = value;
         }
@@ -135,12 +152,14 @@ namespace mongo {
             return str::stream()
                         << " query: " << _query
                         << " updated: " << _updates
+                        << " sort: " << _sort
                         << " god: " << _god
                         << " upsert: " << _upsert
                         << " multi: " << _multi
                         << " callLogOp: " << _callLogOp
                         << " fromMigration: " << _fromMigration
-                        << " fromReplications: " << _fromReplication;
+                        << " fromReplications: " << _fromReplication
+                        << " storeResultDocs: " << _storeResultDocs;
         }
     private:
 
@@ -152,6 +171,10 @@ namespace mongo {
         // Contains the modifiers to apply to matched objects, or a replacement document.
         BSONObj _updates;
 
+        // The order in which to consider the matching documents, e.g. for a single update of
+        // the first one.  Empty for any order.
+        BSONObj _sort;
+
         // Flags controlling the update.
 
         // God bypasses _id checking and index generation. It is only used on behalf of system
@@ -173,6 +196,10 @@ namespace mongo {
         // True if this update is being applied during the application for the oplog.
         bool _fromReplication;
 
+        // True if a single update should return the document as it was before and after being
+        // updated (or the document upserted) in the UpdateResult, as findAndModify does.
+        bool _storeResultDocs;
+
         // The lifecycle data, and events used during the update request.
         const UpdateLifecycle* _lifecycle;
     };
@@ -73,6 +73,11 @@ namespace mongo {
         // if something was upserted, the new _id of the object
         BSONObj upserted;
 
+        // if the request asked to store the result documents, the document updated as it was
+        // before the update (empty for an upsert) and as it is after it, or the one upserted
+        BSONObj oldDoc;
+        BSONObj newDoc;
+
         const std::string toString() const {
             return str::stream()
                         << " upserted: " << upserted
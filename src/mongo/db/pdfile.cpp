@@ -683,7 +683,7 @@ namespace mongo {
         /* add this record to our indexes */
         if ( d->getTotalIndexCount() > 0 ) {
             try {
-                BSONObj obj(r->data());
+                BSONObj obj = BSONObj::make(r);
                 collection->getIndexCatalog()->indexRecord(obj, loc);
             }
             catch( AssertionException& e ) {
@@ -803,6 +803,7 @@ namespace mongo {
         d = 0; // d is now deleted
 
         _deleteDataFiles( db.c_str() );
+        Lock::databaseDropped( db );
     }
 
     typedef boost::filesystem::path Path;
@@ -45,6 +45,7 @@
 #include "mongo/db/storage/data_file.h"
 #include "mongo/db/storage/durable_mapped_file.h"
 #include "mongo/db/storage/extent.h"
+#include "mongo/db/storage/record_compression.h"
 #include "mongo/db/namespace_details-inl.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/pdfile_version.h"
@@ -379,7 +380,7 @@ namespace mongo {
     }
 
     inline BSONObj BSONObj::make(const Record* r ) {
-        return BSONObj( r->data() );
+        return RecordCompression::toBSON( r->data() );
     }
 
     DiskLoc allocateSpaceForANewRecord(const char* ns,
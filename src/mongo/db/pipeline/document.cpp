@@ -40,10 +40,15 @@ namespace mongo {
     using namespace mongoutils;
 
     Position DocumentStorage::findField(StringData requested) const {
+        // only hash if findField would use the hash table
+        return findField(requested, _numFields >= HASH_TAB_MIN ? hashKey(requested) : 0);
+    }
+
+    Position DocumentStorage::findField(StringData requested, unsigned requestedHash) const {
         int reqSize = requested.size(); // get size calculation out of the way if needed
 
         if (_numFields >= HASH_TAB_MIN) { // hash lookup
-            const unsigned bucket = bucketForKey(requested);
+            const unsigned bucket = requestedHash & _hashTabMask;
 
             Position pos = _hashTab[bucket];
             while (pos.found()) {
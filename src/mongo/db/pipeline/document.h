@@ -77,6 +77,14 @@ namespace mongo {
         const Value operator[] (StringData key) const { return getField(key); }
         const Value getField(StringData key) const { return storage().getField(key); }
 
+        /** Look up a field by key name and its hashFieldName(key), for callers that look up the
+         *  same name in many Documents.
+         */
+        const Value getField(StringData key, unsigned keyHash) const {
+            return storage().getField(key, keyHash);
+        }
+        static unsigned hashFieldName(StringData key) { return DocumentStorage::hashKey(key); }
+
         /// Look up a field by Position. See positionOf and getNestedField.
         const Value operator[] (Position pos) const { return getField(pos); }
         const Value getField(Position pos) const { return storage().getField(pos).val; }
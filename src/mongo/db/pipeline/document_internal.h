@@ -190,6 +190,16 @@ namespace mongo {
         /// Returns the position of the named field (may be missing) or Position()
         Position findField(StringData name) const;
 
+        /// Same, with nameHash == hashKey(name) computed by the caller
+        Position findField(StringData name, unsigned nameHash) const;
+
+        static unsigned hashKey(StringData name) {
+            // TODO consider FNV-1a once we have a better benchmark corpus
+            unsigned out;
+            MurmurHash3_x86_32(name.rawData(), name.size(), 0, &out);
+            return out;
+        }
+
         // Document uses these
         const ValueElement& getField(Position pos) const {
             verify(pos.found());
@@ -201,6 +211,12 @@ namespace mongo {
                 return Value();
             return getField(pos).val;
         }
+        Value getField(StringData name, unsigned nameHash) const {
+            Position pos = findField(name, nameHash);
+            if (!pos.found())
+                return Value();
+            return getField(pos).val;
+        }
 
         // MutableDocument uses these
         ValueElement& getField(Position pos) {
@@ -277,13 +293,6 @@ namespace mongo {
         /// Initialize empty hash table
         void hashTabInit() { memset(_hashTab, -1, hashTabBytes()); }
 
-        static unsigned hashKey(StringData name) {
-            // TODO consider FNV-1a once we have a better benchmark corpus
-            unsigned out;
-            MurmurHash3_x86_32(name.rawData(), name.size(), 0, &out);
-            return out;
-        }
-
         unsigned bucketForKey(StringData name) const {
             return hashKey(name) & _hashTabMask;
         }
@@ -34,11 +34,27 @@
 
 namespace mongo {
 
+    const size_t DocumentSource::kBatchSize;
+
     DocumentSource::DocumentSource(const intrusive_ptr<ExpressionContext> &pCtx)
         : pSource(NULL)
         , pExpCtx(pCtx)
     {}
 
+    size_t DocumentSource::getNextBatch(vector<Document>* batch, size_t maxDocs) {
+        size_t n = 0;
+        while (n < maxDocs) {
+            boost::optional<Document> next = getNext();
+            if (!next)
+                break;
+
+            batch->push_back(Document());
+            batch->back().swap(*next);
+            n++;
+        }
+        return n;
+    }
+
     const char *DocumentSource::getSourceName() const {
         static const char unknown[] = "[UNKNOWN]";
         return unknown;
@@ -40,8 +40,10 @@
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/group_table.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/db/projection.h"
+#include "mongo/db/sorter/memory_broker.h"
 #include "mongo/db/sorter/sorter.h"
 #include "mongo/s/shard.h"
 #include "mongo/s/strategy.h"
@@ -65,6 +67,16 @@ namespace mongo {
          */
         virtual boost::optional<Document> getNext() = 0;
 
+        /** Appends up to maxDocs Documents to batch and returns how many were appended; 0 means
+         *  EOF. Stages that see every input document ($match, $project, $group, $sort) pass
+         *  blocks of documents through this rather than paying a virtual call per document.
+         *  The default implementation calls getNext().
+         */
+        virtual size_t getNextBatch(vector<Document>* batch, size_t maxDocs);
+
+        /// Number of Documents stages ask their source for at a time.
+        static const size_t kBatchSize = 128;
+
         /**
          * Inform the source that it is no longer needed and may release its resources.  After
          * dispose() is called the source must still be able to handle iteration requests, but may
@@ -351,6 +363,7 @@ namespace mongo {
         // virtuals from DocumentSource
         virtual ~DocumentSourceCursor();
         virtual boost::optional<Document> getNext();
+        virtual size_t getNextBatch(vector<Document>* batch, size_t maxDocs);
         virtual const char *getSourceName() const;
         virtual Value serialize(bool explain = false) const;
         virtual void setSource(DocumentSource *pSource);
@@ -493,6 +506,18 @@ namespace mongo {
         /// Tell this source if it is doing a merge from shards. Defaults to false.
         void setDoingMerge(bool doingMerge) { _doingMerge = doingMerge; }
 
+        /**
+         * Output each group's mergeable accumulator state, as on a shard, even outside of a
+         * shard. Defaults to false.
+         */
+        void setMergeableOutput(bool mergeableOutput) { _mergeableOutput = mergeableOutput; }
+
+        /**
+         * Converts a document in this group's mergeable output format to the document it would
+         * have been output as otherwise.
+         */
+        Document finalizeMergeable(const Document& mergeable) const;
+
         /**
           Create a grouping DocumentSource from BSON.
 
@@ -517,12 +542,34 @@ namespace mongo {
     private:
         DocumentSourceGroup(const intrusive_ptr<ExpressionContext> &pExpCtx);
 
-        /// Spill groups map to disk and returns an iterator to the file.
-        shared_ptr<Sorter<Value, Value>::Iterator> spill();
+        /// Spill 'table' to disk, emptying it, and returns an iterator to the file.
+        shared_ptr<Sorter<Value, Value>::Iterator> spill(GroupTable& table);
 
         // Only used by spill. Would be function-local if that were legal in C++03.
         class SpillSTLComparator;
 
+        /**
+         * Evaluates 'input' and adds it to its group in 'table', adjusting 'memoryUsageBytes'.
+         * @return true if this started a new group.
+         */
+        bool accumulate(GroupTable& table,
+                        Variables* variables,
+                        const Document& input,
+                        int* memoryUsageBytes);
+
+        /// true if combining partial groups built from any split of the input is always correct
+        bool canGroupInParallel() const;
+
+        /**
+         * populate() split across 'numThreads' threads, each grouping whole batches of the
+         * input into its own Partial; the partials are combined once the input is exhausted.
+         */
+        void populateParallel(size_t numThreads);
+
+        // Only used by populateParallel.
+        struct Partial;
+        void runPartial(Partial* partial);
+
         /*
           Before returning anything, this source must fetch everything from
           the underlying source and group it.  populate() is used to do that
@@ -532,11 +579,13 @@ namespace mongo {
         void populate();
         bool populated;
 
+        /// Sets up to return groups, merging 'sortedFiles' (if any) with what's left in groups.
+        void finishPopulate(vector<shared_ptr<Sorter<Value, Value>::Iterator> >& sortedFiles);
+
         intrusive_ptr<Expression> pIdExpression;
 
         typedef vector<intrusive_ptr<Accumulator> > Accumulators;
-        typedef boost::unordered_map<Value, Accumulators, Value::Hash> GroupsMap;
-        GroupsMap groups;
+        GroupTable groups;
 
         /*
           The field names for the result documents and the accumulator
@@ -555,16 +604,21 @@ namespace mongo {
         vector<intrusive_ptr<Expression> > vpExpression;
 
 
-        Document makeDocument(const Value& id, const Accumulators& accums, bool mergeableOutput);
+        /// 'accums' holds one accumulator per vFieldName entry.
+        Document makeDocument(const Value& id,
+                              const intrusive_ptr<Accumulator>* accums,
+                              bool mergeableOutput);
 
         bool _doingMerge;
+        bool _mergeableOutput;
         bool _spilled;
         const bool _extSortAllowed;
         const int _maxMemoryUsageBytes;
+        MemoryBroker::Grant _memoryGrant; // for groups while they are in memory
         boost::scoped_ptr<Variables> _variables;
 
-        // only used when !_spilled
-        GroupsMap::iterator groupsIterator;
+        // only used when !_spilled: the number of the next group to return
+        size_t _nextGroup;
 
         // only used when _spilled
         scoped_ptr<Sorter<Value, Value>::Iterator> _sorterIterator;
@@ -574,10 +628,88 @@ namespace mongo {
     };
 
 
+    /**
+     * {$incrementalGroup: {into: <collection>, trackBy: <field>, group: <$group spec>}}
+     *
+     * Outputs what the $group would over the whole input, but only reads the input documents
+     * added since the previous run. Each group's accumulator state is kept in the 'into'
+     * collection, along with the highest value of 'trackBy' (default "_id") read so far, and the
+     * new documents' partial groups are merged into those states. 'trackBy' must only increase
+     * as documents are inserted, like an oplog's ts; if the input isn't capped, it should also be
+     * indexed. Documents without it are never read.
+     *
+     * The updated states replace 'into' in a single rename once all groups have been output, so
+     * a failed or abandoned run leaves the previous states in place.
+     *
+     * Only $match stages may come before this one, and its input can't be sharded.
+     */
+    class DocumentSourceIncrementalGroup : public DocumentSource
+                                         , public DocumentSourceNeedsMongod {
+    public:
+        // virtuals from DocumentSource
+        virtual ~DocumentSourceIncrementalGroup();
+        virtual boost::optional<Document> getNext();
+        virtual const char* getSourceName() const;
+        virtual void setSource(DocumentSource* pSource);
+        virtual void optimize();
+        virtual GetDepsReturn getDependencies(set<string>& deps) const;
+        virtual void dispose();
+        virtual Value serialize(bool explain = false) const;
+
+        /**
+         * Returns the query for the input documents not read by a previous run: those with
+         * 'trackBy' above the saved position, up to the current highest value. PipelineD adds it
+         * to the initial query before creating the input cursor.
+         */
+        BSONObj prepareDeltaQuery();
+
+        static intrusive_ptr<DocumentSource> createFromBson(
+            BSONElement elem,
+            const intrusive_ptr<ExpressionContext> &pExpCtx);
+
+        static const char incrementalGroupName[];
+
+    private:
+        DocumentSourceIncrementalGroup(const NamespaceString& intoNs,
+                                       const string& trackBy,
+                                       const intrusive_ptr<DocumentSourceGroup>& group,
+                                       const intrusive_ptr<ExpressionContext>& pExpCtx);
+
+        // Sets up _merger and the temp collection for the new states.
+        void start();
+
+        // Inserts _bufferedStates into _tempNs.
+        void flushStates();
+
+        // Saves the new position and renames _tempNs over _intoNs.
+        void finish();
+
+        const NamespaceString _intoNs;
+        const string _trackBy;
+
+        // Groups the new input documents, outputting mergeable states.
+        intrusive_ptr<DocumentSourceGroup> _group;
+
+        // Merges the saved states with _group's output, again outputting mergeable states.
+        intrusive_ptr<DocumentSourceGroup> _merger;
+        intrusive_ptr<DocumentSource> _mergerInput;
+
+        bool _prepared; // prepareDeltaQuery() has been called
+        bool _started;
+        bool _done;
+        BSONObj _position; // {_id: marker, position: <highest trackBy read>}, or empty
+
+        NamespaceString _tempNs; // the new states go here until finish()
+        vector<BSONObj> _bufferedStates;
+        int _bufferedBytes;
+    };
+
+
     class DocumentSourceMatch : public DocumentSource {
     public:
         // virtuals from DocumentSource
         virtual boost::optional<Document> getNext();
+        virtual size_t getNextBatch(vector<Document>* batch, size_t maxDocs);
         virtual const char *getSourceName() const;
         virtual bool coalesce(const intrusive_ptr<DocumentSource>& nextSource);
         virtual Value serialize(bool explain = false) const;
@@ -644,20 +776,29 @@ namespace mongo {
 
         static const char name[];
 
+        /** A shard's cursor and the connection it is read over. */
+        class CursorAndConnection {
+        public:
+            CursorAndConnection(ConnectionString host, NamespaceString ns, CursorId id);
+
+            /** Returns the connection to the pool once the cursor is exhausted. */
+            bool more();
+
+            /** Throws if the shard returned an error in place of a document. */
+            Document next();
+
+            ScopedDbConnection connection;
+            DBClientCursor cursor;
+        };
+
         /** Returns non-owning pointers to cursors managed by this stage.
          *  Call this instead of getNext() if you want access to the raw streams.
          *  This method should only be called at most once.
          */
-        vector<DBClientCursor*> getCursors();
+        vector<CursorAndConnection*> getCursors();
 
     private:
 
-        struct CursorAndConnection {
-            CursorAndConnection(ConnectionString host, NamespaceString ns, CursorId id);
-            ScopedDbConnection connection;
-            DBClientCursor cursor;
-        };
-
         // using list to enable removing arbitrary elements
         typedef list<boost::shared_ptr<CursorAndConnection> > Cursors;
 
@@ -694,6 +835,23 @@ namespace mongo {
 
         const NamespaceString& getOutputNs() const { return _outputNs; }
 
+        /**
+         * Used by mongos when the output collection is sharded. Rather than filling a temp
+         * collection on the merging server, each document is inserted straight into the temp
+         * collection 'tempColl' on the shard owning its chunk of the output. 'chunks' is an array
+         * of {min, max, shard} for every chunk of the output, where shard is the owning shard's
+         * connection string. The router renames the temp collection over the output on each
+         * shard once this stage is done.
+         */
+        void setShardedOutput(const BSONObj& shardKey,
+                              const BSONArray& chunks,
+                              const string& tempColl);
+
+        bool isShardedOutput() const { return !_shardKey.isEmpty(); }
+
+        /** The temp collection written to on each shard; only valid if isShardedOutput(). */
+        const NamespaceString& getTempNs() const { return _tempNs; }
+
         /**
           Create a document source for output and pass-through.
 
@@ -719,10 +877,17 @@ namespace mongo {
 
         void spill(DBClientBase* conn, const vector<BSONObj>& toInsert);
 
+        // Inserts the output into _tempNs on the shards owning each document's chunk.
+        void writeToShards();
+
         bool _done;
 
         NamespaceString _tempNs; // output goes here as it is being processed.
         const NamespaceString _outputNs; // output will go here after all data is processed.
+
+        // Only set when writing to a sharded collection. See setShardedOutput().
+        BSONObj _shardKey;
+        BSONArray _chunks;
     };
 
     
@@ -731,6 +896,7 @@ namespace mongo {
     public:
         // virtuals from DocumentSource
         virtual boost::optional<Document> getNext();
+        virtual size_t getNextBatch(vector<Document>* batch, size_t maxDocs);
         virtual const char *getSourceName() const;
         virtual void optimize();
         virtual Value serialize(bool explain = false) const;
@@ -756,10 +922,18 @@ namespace mongo {
         /** projection as specified by the user */
         BSONObj getRaw() const { return _raw; }
 
+        /// true if the top-level field fieldName is output exactly as it was input
+        bool passesThroughField(const string& fieldName) const {
+            return pEO->passesThroughField(fieldName);
+        }
+
     private:
         DocumentSourceProject(const intrusive_ptr<ExpressionContext>& pExpCtx,
                               const intrusive_ptr<ExpressionObject>& exprObj);
 
+        /** Returns the projection of input. */
+        Document project(const Document& input);
+
         // configuration state
         boost::scoped_ptr<Variables> _variables;
         intrusive_ptr<ExpressionObject> pEO;
@@ -873,6 +1047,9 @@ namespace mongo {
         void populate();
         bool populated;
 
+        /// Sets up to return groups, merging 'sortedFiles' (if any) with what's left in groups.
+        void finishPopulate(vector<shared_ptr<Sorter<Value, Value>::Iterator> >& sortedFiles);
+
         SortOptions makeSortOptions() const;
 
         // These are used to merge pre-sorted results from a DocumentSourceMergeCursors or a
@@ -880,7 +1057,8 @@ namespace mongo {
         // not.
         class IteratorFromCursor;
         class IteratorFromBsonArray;
-        void populateFromCursors(const vector<DBClientCursor*>& cursors);
+        void populateFromCursors(
+                const vector<DocumentSourceMergeCursors::CursorAndConnection*>& cursors);
         void populateFromBsonArrays(const vector<BSONArray>& arrays);
 
         /* these two parallel each other */
@@ -1051,6 +1229,9 @@ namespace mongo {
 
         static const char unwindName[];
 
+        /// The field being unwound, without its "$" prefix.
+        string getUnwindPath() const { return _unwindPath->getPath(false); }
+
     private:
         DocumentSourceUnwind(const intrusive_ptr<ExpressionContext> &pExpCtx);
 
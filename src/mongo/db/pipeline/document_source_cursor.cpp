@@ -64,6 +64,25 @@ namespace mongo {
         return out;
     }
 
+    size_t DocumentSourceCursor::getNextBatch(vector<Document>* batch, size_t maxDocs) {
+        pExpCtx->checkForInterrupt();
+
+        if (_currentBatch.empty()) {
+            loadBatch();
+
+            if (_currentBatch.empty()) // exhausted the cursor
+                return 0;
+        }
+
+        const size_t n = std::min(maxDocs, _currentBatch.size());
+        for (size_t i = 0; i < n; i++) {
+            batch->push_back(Document());
+            batch->back().swap(_currentBatch.front());
+            _currentBatch.pop_front();
+        }
+        return n;
+    }
+
     void DocumentSourceCursor::dispose() {
         if (_cursorId) {
             ClientCursor::erase(_cursorId);
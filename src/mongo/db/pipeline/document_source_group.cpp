@@ -29,6 +29,7 @@
 #include "mongo/pch.h"
 
 
+#include "mongo/base/owned_pointer_vector.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/accumulator.h"
 #include "mongo/db/pipeline/document.h"
@@ -36,10 +37,18 @@
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/queue.h"
+#include "mongo/util/scopeguard.h"
 
 namespace mongo {
     const char DocumentSourceGroup::groupName[] = "$group";
 
+    // Threads used to group the input of a $group on mongod. Values above 1 only take effect
+    // when every accumulator gives the same result regardless of input order.
+    MONGO_EXPORT_SERVER_PARAMETER(aggregationGroupThreads, int, 1);
+
     const char *DocumentSourceGroup::getSourceName() const {
         return groupName;
     }
@@ -92,17 +101,19 @@ namespace mongo {
                 _firstPartOfNextGroup = _sorterIterator->next();
             }
 
-            return makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
+            return makeDocument(_currentId,
+                                _currentAccumulators.empty() ? NULL : &_currentAccumulators[0],
+                                _mergeableOutput || pExpCtx->inShard);
 
         } else {
             if (groups.empty())
                 return boost::none;
 
-            Document out = makeDocument(groupsIterator->first,
-                                        groupsIterator->second,
-                                        pExpCtx->inShard);
+            Document out = makeDocument(groups.id(_nextGroup),
+                                        groups.accumulators(_nextGroup),
+                                        _mergeableOutput || pExpCtx->inShard);
 
-            if (++groupsIterator == groups.end())
+            if (++_nextGroup == groups.size())
                 dispose();
 
             return out;
@@ -111,11 +122,12 @@ namespace mongo {
 
     void DocumentSourceGroup::dispose() {
         // free our resources
-        GroupsMap().swap(groups);
+        groups.clear();
+        _memoryGrant.setBytes(0);
         _sorterIterator.reset();
 
         // make us look done
-        groupsIterator = groups.end();
+        _nextGroup = 0;
 
         // free our source's resources
         pSource->dispose();
@@ -177,9 +189,12 @@ namespace mongo {
         : DocumentSource(pExpCtx)
         , populated(false)
         , _doingMerge(false)
+        , _mergeableOutput(false)
         , _spilled(false)
         , _extSortAllowed(pExpCtx->extSortAllowed && !pExpCtx->inRouter)
         , _maxMemoryUsageBytes(100*1024*1024)
+        , _memoryGrant(MemoryBroker::kGroup)
+        , _nextGroup(0)
     {}
 
     void DocumentSourceGroup::addAccumulator(
@@ -351,86 +366,121 @@ namespace mongo {
         };
     }
 
-    void DocumentSourceGroup::populate() {
+    bool DocumentSourceGroup::accumulate(GroupTable& table,
+                                         Variables* variables,
+                                         const Document& input,
+                                         int* memoryUsageBytes) {
         const size_t numAccumulators = vpAccumulatorFactory.size();
-        dassert(numAccumulators == vpExpression.size());
 
-        // pushed to on spill()
-        vector<shared_ptr<Sorter<Value, Value>::Iterator> > sortedFiles;
-        int memoryUsageBytes = 0;
+        variables->setRoot(input);
 
-        // This loop consumes all input from pSource and buckets it based on pIdExpression.
-        while (boost::optional<Document> input = pSource->getNext()) {
-            if (memoryUsageBytes > _maxMemoryUsageBytes) {
-                uassert(16945, "Exceeded memory limit for $group, but didn't allow external sort",
-                        _extSortAllowed);
-                sortedFiles.push_back(spill());
-                memoryUsageBytes = 0;
+        /* get the _id value */
+        Value id = pIdExpression->evaluate(variables);
+
+        /* treat missing values the same as NULL SERVER-4674 */
+        if (id.missing())
+            id = Value(BSONNULL);
+
+        /*
+          Look for the _id value in the map; if it's not there, add a
+          new entry with a blank accumulator.
+        */
+        bool inserted;
+        const size_t groupNum = table.findOrInsert(id, &inserted);
+        intrusive_ptr<Accumulator>* group = table.accumulators(groupNum);
+
+        if (inserted) {
+            *memoryUsageBytes += id.getApproximateSize();
+
+            // Add the accumulators
+            for (size_t i = 0; i < numAccumulators; i++) {
+                group[i] = vpAccumulatorFactory[i]();
             }
+        } else {
+            for (size_t i = 0; i < numAccumulators; i++) {
+                // subtract old mem usage. New usage added back after processing.
+                *memoryUsageBytes -= group[i]->memUsageForSorter();
+            }
+        }
 
-            _variables->setRoot(*input);
+        /* tickle all the accumulators for the group we found */
+        for (size_t i = 0; i < numAccumulators; i++) {
+            group[i]->process(vpExpression[i]->evaluate(variables), _doingMerge);
+            *memoryUsageBytes += group[i]->memUsageForSorter();
+        }
 
-            /* get the _id value */
-            Value id = pIdExpression->evaluate(_variables.get());
+        // We are done with the ROOT document so release it.
+        variables->clearRoot();
 
-            /* treat missing values the same as NULL SERVER-4674 */
-            if (id.missing())
-                id = Value(BSONNULL);
+        return inserted;
+    }
 
-            /*
-              Look for the _id value in the map; if it's not there, add a
-              new entry with a blank accumulator.
-            */
-            const size_t oldSize = groups.size();
-            vector<intrusive_ptr<Accumulator> >& group = groups[id];
-            const bool inserted = groups.size() != oldSize;
+    void DocumentSourceGroup::populate() {
+        const size_t numAccumulators = vpAccumulatorFactory.size();
+        dassert(numAccumulators == vpExpression.size());
+        groups.setNumAccumulators(numAccumulators);
 
-            if (inserted) {
-                memoryUsageBytes += id.getApproximateSize();
+        const int numThreads = aggregationGroupThreads;
+        if (numThreads > 1 && !pExpCtx->inRouter && canGroupInParallel()) {
+            populateParallel(numThreads);
+            return;
+        }
 
-                // Add the accumulators
-                group.reserve(numAccumulators);
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    group.push_back(vpAccumulatorFactory[i]());
-                }
-            } else {
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    // subtract old mem usage. New usage added back after processing.
-                    memoryUsageBytes -= group[i]->memUsageForSorter();
-                }
-            }
+        // pushed to on spill()
+        vector<shared_ptr<Sorter<Value, Value>::Iterator> > sortedFiles;
+        int memoryUsageBytes = 0;
 
-            /* tickle all the accumulators for the group we found */
-            dassert(numAccumulators == group.size());
-            for (size_t i = 0; i < numAccumulators; i++) {
-                group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
-                memoryUsageBytes += group[i]->memUsageForSorter();
-            }
+        // This loop consumes all input from pSource and buckets it based on pIdExpression.
+        vector<Document> batch;
+        batch.reserve(kBatchSize);
+        while (pSource->getNextBatch(&batch, kBatchSize)) {
+            for (vector<Document>::const_iterator input = batch.begin(); input != batch.end();
+                    ++input) {
+                if (memoryUsageBytes > _maxMemoryUsageBytes
+                        || (_extSortAllowed && _memoryGrant.shouldSpillEarly())) {
+                    uassert(16945,
+                            "Exceeded memory limit for $group, but didn't allow external sort",
+                            _extSortAllowed);
+                    sortedFiles.push_back(spill(groups));
+                    memoryUsageBytes = 0;
+                    _memoryGrant.setBytes(0);
+                }
 
-            // We are done with the ROOT document so release it.
-            _variables->clearRoot();
-
-            DEV {
-                // In debug mode, spill every time we have a duplicate id to stress merge logic.
-                if (!inserted // is a dup
-                        && !pExpCtx->inRouter // can't spill to disk in router
-                        && !_extSortAllowed // don't change behavior when testing external sort
-                        && sortedFiles.size() < 20 // don't open too many FDs
-                        ) {
-                    sortedFiles.push_back(spill());
+                const bool inserted = accumulate(groups, _variables.get(), *input,
+                                                 &memoryUsageBytes);
+                _memoryGrant.setBytes(memoryUsageBytes);
+
+                DEV {
+                    // In debug mode, spill every time we have a duplicate id to stress merge logic.
+                    if (!inserted // is a dup
+                            && !pExpCtx->inRouter // can't spill to disk in router
+                            && !_extSortAllowed // don't change behavior when testing external sort
+                            && sortedFiles.size() < 20 // don't open too many FDs
+                            ) {
+                        sortedFiles.push_back(spill(groups));
+                    }
                 }
             }
+            batch.clear();
         }
 
+        finishPopulate(sortedFiles);
+    }
+
+    void DocumentSourceGroup::finishPopulate(
+            vector<shared_ptr<Sorter<Value, Value>::Iterator> >& sortedFiles) {
+        const size_t numAccumulators = vpAccumulatorFactory.size();
+
         // These blocks do any final steps necessary to prepare to output results.
         if (!sortedFiles.empty()) {
             _spilled = true;
             if (!groups.empty()) {
-                sortedFiles.push_back(spill());
+                sortedFiles.push_back(spill(groups));
             }
 
             // We won't be using groups again so free its memory.
-            GroupsMap().swap(groups);
+            groups.clear();
+            _memoryGrant.setBytes(0);
 
             _sorterIterator.reset(
                     Sorter<Value,Value>::Iterator::merge(
@@ -446,61 +496,226 @@ namespace mongo {
             _firstPartOfNextGroup = _sorterIterator->next();
         } else {
             // start the group iterator
-            groupsIterator = groups.begin();
+            _nextGroup = 0;
         }
 
         populated = true;
     }
 
+    bool DocumentSourceGroup::canGroupInParallel() const {
+        // $first, $last and $push depend on the order of their input, which is lost once
+        // batches are handed out to different threads.
+        for (size_t i = 0; i < vpAccumulatorFactory.size(); i++) {
+            const StringData opName = vpAccumulatorFactory[i]()->getOpName();
+            if (opName != "$sum" && opName != "$avg" && opName != "$min" && opName != "$max"
+                    && opName != "$addToSet") {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct DocumentSourceGroup::Partial {
+        Partial(BlockingQueue<vector<Document>*>* batches, size_t numVars, int maxMemoryUsageBytes)
+            : batches(batches)
+            , variables(numVars)
+            , maxMemoryUsageBytes(maxMemoryUsageBytes)
+            , memoryGrant(MemoryBroker::kGroup)
+            , errorCode(0)
+        {}
+
+        // shared by all partials; a NULL batch means the input is exhausted
+        BlockingQueue<vector<Document>*>* const batches;
+
+        GroupTable groups;
+        Variables variables;
+        vector<shared_ptr<Sorter<Value, Value>::Iterator> > sortedFiles;
+        const int maxMemoryUsageBytes;
+        MemoryBroker::Grant memoryGrant;
+
+        // set if grouping failed; the rest of the input is then discarded
+        int errorCode;
+        string errorMessage;
+    };
+
+    namespace {
+        void stopPartials(BlockingQueue<vector<Document>*>* batches, size_t numThreads) {
+            for (size_t i = 0; i < numThreads; i++) {
+                batches->push(NULL);
+            }
+        }
+    }
+
+    void DocumentSourceGroup::runPartial(Partial* partial) {
+        int memoryUsageBytes = 0;
+        while (vector<Document>* batch = partial->batches->blockingPop()) {
+            boost::scoped_ptr<vector<Document> > batchOwner(batch);
+            if (partial->errorCode)
+                continue;
+
+            try {
+                for (size_t i = 0; i < batch->size(); i++) {
+                    if (memoryUsageBytes > partial->maxMemoryUsageBytes
+                            || (_extSortAllowed && partial->memoryGrant.shouldSpillEarly())) {
+                        uassert(17393,
+                                "Exceeded memory limit for $group, but didn't allow external sort",
+                                _extSortAllowed);
+                        partial->sortedFiles.push_back(spill(partial->groups));
+                        memoryUsageBytes = 0;
+                        partial->memoryGrant.setBytes(0);
+                    }
+
+                    accumulate(partial->groups, &partial->variables, (*batch)[i],
+                               &memoryUsageBytes);
+                    partial->memoryGrant.setBytes(memoryUsageBytes);
+                }
+            }
+            catch (const DBException& e) {
+                partial->errorCode = e.getCode();
+                partial->errorMessage = e.what();
+            }
+            catch (const std::exception& e) {
+                partial->errorCode = 17344;
+                partial->errorMessage = str::stream() << "$group failed: " << e.what();
+            }
+        }
+    }
+
+    void DocumentSourceGroup::populateParallel(size_t numThreads) {
+        const size_t numAccumulators = vpAccumulatorFactory.size();
+
+        // Keep only a couple of batches per thread in flight so a slow consumer can't buffer
+        // the whole input.
+        BlockingQueue<vector<Document>*> batches(2 * numThreads + 1);
+
+        OwnedPointerVector<Partial> partials;
+        for (size_t i = 0; i < numThreads; i++) {
+            Partial* partial = new Partial(&batches,
+                                           _variables->getNumVars(),
+                                           _maxMemoryUsageBytes / numThreads);
+            partial->groups.setNumAccumulators(numAccumulators);
+            partials.mutableVector().push_back(partial);
+        }
+
+        {
+            // stopPartials() runs before the pool's destructor joins the threads, so they always
+            // see the end of the input, even if reading it throws.
+            ThreadPool pool(numThreads);
+            ON_BLOCK_EXIT(stopPartials, &batches, numThreads);
+            for (size_t i = 0; i < numThreads; i++) {
+                pool.schedule(&DocumentSourceGroup::runPartial, this, partials.vector()[i]);
+            }
+
+            // Reading the input stays on this thread, which owns the operation's Client.
+            std::auto_ptr<vector<Document> > batch(new vector<Document>());
+            batch->reserve(kBatchSize);
+            while (pSource->getNextBatch(batch.get(), kBatchSize)) {
+                pExpCtx->checkForInterrupt();
+                batches.push(batch.release());
+                batch.reset(new vector<Document>());
+                batch->reserve(kBatchSize);
+            }
+        }
+
+        vector<shared_ptr<Sorter<Value, Value>::Iterator> > sortedFiles;
+        for (size_t i = 0; i < numThreads; i++) {
+            Partial* partial = partials.vector()[i];
+            if (partial->errorCode)
+                uasserted(partial->errorCode, partial->errorMessage);
+            sortedFiles.insert(sortedFiles.end(),
+                               partial->sortedFiles.begin(), partial->sortedFiles.end());
+        }
+
+        if (!sortedFiles.empty()) {
+            // The merge in finishPopulate() combines the partials along with what they spilled.
+            for (size_t i = 0; i < numThreads; i++) {
+                if (!partials.vector()[i]->groups.empty()) {
+                    sortedFiles.push_back(spill(partials.vector()[i]->groups));
+                }
+            }
+            finishPopulate(sortedFiles);
+            return;
+        }
+
+        // Nothing spilled, so the partials are small enough to combine in memory.
+        for (size_t i = 0; i < numThreads; i++) {
+            GroupTable& partialGroups = partials.vector()[i]->groups;
+            for (size_t g = 0; g < partialGroups.size(); g++) {
+                bool inserted;
+                const size_t groupNum = groups.findOrInsert(partialGroups.id(g), &inserted);
+                intrusive_ptr<Accumulator>* group = groups.accumulators(groupNum);
+                intrusive_ptr<Accumulator>* partialGroup = partialGroups.accumulators(g);
+                for (size_t j = 0; j < numAccumulators; j++) {
+                    if (inserted) {
+                        group[j] = partialGroup[j];
+                    }
+                    else {
+                        group[j]->process(partialGroup[j]->getValue(/*toBeMerged=*/true),
+                                          /*merging=*/true);
+                    }
+                }
+            }
+            partialGroups.clear();
+        }
+
+        finishPopulate(sortedFiles);
+    }
+
     class DocumentSourceGroup::SpillSTLComparator {
     public:
-        bool operator() (const GroupsMap::value_type* lhs, const GroupsMap::value_type* rhs) const {
-            return Value::compare(lhs->first, rhs->first) < 0;
+        explicit SpillSTLComparator(const GroupTable& groups) : _groups(groups) {}
+        bool operator() (size_t lhs, size_t rhs) const {
+            return Value::compare(_groups.id(lhs), _groups.id(rhs)) < 0;
         }
+    private:
+        const GroupTable& _groups;
     };
 
-    shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
-        vector<const GroupsMap::value_type*> ptrs; // using pointers to speed sorting
-        ptrs.reserve(groups.size());
-        for (GroupsMap::const_iterator it=groups.begin(), end=groups.end(); it != end; ++it) {
-            ptrs.push_back(&*it);
+    shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill(GroupTable& table) {
+        vector<size_t> order; // group numbers, to speed sorting
+        order.reserve(table.size());
+        for (size_t i = 0; i < table.size(); i++) {
+            order.push_back(i);
         }
 
-        stable_sort(ptrs.begin(), ptrs.end(), SpillSTLComparator());
+        stable_sort(order.begin(), order.end(), SpillSTLComparator(table));
 
         SortedFileWriter<Value, Value> writer(SortOptions().TempDir(pExpCtx->tempDir));
-        switch (vpAccumulatorFactory.size()) { // same as ptrs[i]->second.size() for all i.
+        const size_t numAccumulators = vpAccumulatorFactory.size();
+        switch (numAccumulators) {
         case 0: // no values, essentially a distinct
-            for (size_t i=0; i < ptrs.size(); i++) {
-                writer.addAlreadySorted(ptrs[i]->first, Value());
+            for (size_t i=0; i < order.size(); i++) {
+                writer.addAlreadySorted(table.id(order[i]), Value());
             }
             break;
 
         case 1: // just one value, use optimized serialization as single Value
-            for (size_t i=0; i < ptrs.size(); i++) {
-                writer.addAlreadySorted(ptrs[i]->first,
-                                        ptrs[i]->second[0]->getValue(/*toBeMerged=*/true));
+            for (size_t i=0; i < order.size(); i++) {
+                writer.addAlreadySorted(table.id(order[i]),
+                                        table.accumulators(order[i])[0]->getValue(
+                                            /*toBeMerged=*/true));
             }
             break;
 
         default: // multiple values, serialize as array-typed Value
-            for (size_t i=0; i < ptrs.size(); i++) {
+            for (size_t i=0; i < order.size(); i++) {
+                const intrusive_ptr<Accumulator>* group = table.accumulators(order[i]);
                 vector<Value> accums;
-                for (size_t j=0; j < ptrs[i]->second.size(); j++) {
-                    accums.push_back(ptrs[i]->second[j]->getValue(/*toBeMerged=*/true));
+                for (size_t j=0; j < numAccumulators; j++) {
+                    accums.push_back(group[j]->getValue(/*toBeMerged=*/true));
                 }
-                writer.addAlreadySorted(ptrs[i]->first, Value::consume(accums));
+                writer.addAlreadySorted(table.id(order[i]), Value::consume(accums));
             }
             break;
         }
 
-        groups.clear();
+        table.clear();
 
         return shared_ptr<Sorter<Value, Value>::Iterator>(writer.done());
     }
 
     Document DocumentSourceGroup::makeDocument(const Value& id,
-                                               const Accumulators& accums,
+                                               const intrusive_ptr<Accumulator>* accums,
                                                bool mergeableOutput) {
         const size_t n = vFieldName.size();
         MutableDocument out (1 + n);
@@ -523,6 +738,23 @@ namespace mongo {
         return out.freeze();
     }
 
+    Document DocumentSourceGroup::finalizeMergeable(const Document& mergeable) const {
+        const size_t n = vFieldName.size();
+        MutableDocument out (1 + n);
+
+        out.addField("_id", mergeable["_id"]);
+
+        for(size_t i = 0; i < n; ++i) {
+            intrusive_ptr<Accumulator> accum = vpAccumulatorFactory[i]();
+            accum->process(mergeable[vFieldName[i]], /*merging=*/true);
+            Value val = accum->getValue(/*toBeMerged=*/false);
+            // null rather than missing, as in makeDocument()
+            out.addField(vFieldName[i], val.missing() ? Value(BSONNULL) : val);
+        }
+
+        return out.freeze();
+    }
+
     intrusive_ptr<DocumentSource> DocumentSourceGroup::getShardSource() {
         return this; // No modifications necessary when on shard
     }
@@ -0,0 +1,303 @@
+/**
+ * Copyright (c) 2013 10gen Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/pipeline/document_source.h"
+
+namespace mongo {
+    const char DocumentSourceIncrementalGroup::incrementalGroupName[] = "$incrementalGroup";
+
+namespace {
+    // _id of the document in the states collection holding the position of the last run.
+    const char positionId[] = "$incrementalGroup";
+
+    /**
+     * Input for the merging group: the states saved by the previous run, then the partial
+     * groups of the new input documents.
+     */
+    class SavedStatesThenPartials : public DocumentSource {
+    public:
+        SavedStatesThenPartials(DBClientBase* conn,
+                                const NamespaceString& intoNs,
+                                const intrusive_ptr<DocumentSource>& partials,
+                                const intrusive_ptr<ExpressionContext>& pExpCtx)
+            : DocumentSource(pExpCtx)
+            , _saved(conn->query(intoNs.ns(), QUERY("_id" << NE << positionId)))
+            , _partials(partials) {
+            uassert(17350, str::stream() << "couldn't read $incrementalGroup states from "
+                                         << intoNs.ns(),
+                    _saved.get());
+        }
+
+        virtual boost::optional<Document> getNext() {
+            if (_saved.get()) {
+                if (_saved->more())
+                    return Document(_saved->nextSafe());
+                _saved.reset();
+            }
+
+            boost::optional<Document> partial = _partials->getNext();
+            uassert(17351, str::stream() << "$incrementalGroup can't store a group with _id "
+                                         << positionId,
+                    !partial || (*partial)["_id"] != Value(StringData(positionId)));
+            return partial;
+        }
+
+        virtual Value serialize(bool explain = false) const {
+            return Value(); // internal to DocumentSourceIncrementalGroup
+        }
+
+    private:
+        auto_ptr<DBClientCursor> _saved;
+        intrusive_ptr<DocumentSource> _partials;
+    };
+}
+
+    DocumentSourceIncrementalGroup::~DocumentSourceIncrementalGroup() {
+        DESTRUCTOR_GUARD(
+            // As in DocumentSourceOut, the temp collection is also dropped on restart if this
+            // fails.
+            if (_mongod && _tempNs.size())
+                _mongod->directClient()->dropCollection(_tempNs.ns());
+        )
+    }
+
+    const char* DocumentSourceIncrementalGroup::getSourceName() const {
+        return incrementalGroupName;
+    }
+
+    void DocumentSourceIncrementalGroup::setSource(DocumentSource* pSource) {
+        DocumentSource::setSource(pSource);
+        _group->setSource(pSource);
+    }
+
+    void DocumentSourceIncrementalGroup::optimize() {
+        _group->optimize();
+    }
+
+    DocumentSource::GetDepsReturn DocumentSourceIncrementalGroup::getDependencies(
+            set<string>& deps) const {
+        // trackBy is only needed by the query from prepareDeltaQuery()
+        return _group->getDependencies(deps);
+    }
+
+    void DocumentSourceIncrementalGroup::dispose() {
+        if (_merger)
+            _merger->dispose();
+        _group->dispose();
+    }
+
+    BSONObj DocumentSourceIncrementalGroup::prepareDeltaQuery() {
+        verify(_mongod);
+        DBClientBase* conn = _mongod->directClient();
+        _prepared = true;
+
+        const BSONObj saved = conn->findOne(_intoNs.ns(), QUERY("_id" << positionId));
+        _position = saved.getOwned();
+
+        // The end of this run's range is fixed here, so anything inserted from now on is left
+        // for the next run.
+        Query lastQuery;
+        if (_mongod->isCapped(pExpCtx->ns))
+            lastQuery.sort(BSON("$natural" << -1));
+        else
+            lastQuery.sort(BSON(_trackBy << -1));
+        const BSONObj trackByOnly = BSON(_trackBy << 1);
+        const BSONObj last = conn->findOne(pExpCtx->ns.ns(), lastQuery, &trackByOnly);
+        const BSONElement high = last.getFieldDotted(_trackBy);
+
+        const BSONElement savedHigh = saved["position"];
+        if (high.eoo() || (!savedHigh.eoo() && high.woCompare(savedHigh, false) <= 0)) {
+            // nothing new to read
+            return BSON(_trackBy << BSON("$in" << BSONArray()));
+        }
+
+        BSONObjBuilder position;
+        position.append("_id", positionId);
+        position.appendAs(high, "position");
+        _position = position.obj();
+
+        BSONObjBuilder range;
+        if (!savedHigh.eoo())
+            range.appendAs(savedHigh, "$gt");
+        range.appendAs(high, "$lte");
+        return BSON(_trackBy << range.obj());
+    }
+
+    static AtomicUInt32 aggIncrementalCounter;
+    void DocumentSourceIncrementalGroup::start() {
+        // PipelineD only prepares this stage when it reads a local collection directly.
+        uassert(17352, "$incrementalGroup can only read from an unsharded collection, and only "
+                       "after $match stages",
+                _prepared);
+
+        DBClientBase* conn = _mongod->directClient();
+
+        _mergerInput = new SavedStatesThenPartials(conn, _intoNs, _group, pExpCtx);
+        _merger = static_cast<DocumentSourceGroup*>(_group->getMergeSource().get());
+        _merger->setMergeableOutput(true);
+        _merger->setSource(_mergerInput.get());
+
+        _tempNs = StringData(str::stream() << _intoNs.db()
+                                           << ".tmp.agg_incremental."
+                                           << aggIncrementalCounter.addAndFetch(1)
+                                           );
+
+        BSONObj info;
+        bool ok = conn->runCommand(_intoNs.db().toString(),
+                                   BSON("create" << _tempNs.coll() << "temp" << true),
+                                   info);
+        uassert(17353, str::stream() << "failed to create temporary $incrementalGroup collection '"
+                                     << _tempNs.ns() << "': " << info.toString(),
+                ok);
+    }
+
+    void DocumentSourceIncrementalGroup::flushStates() {
+        if (_bufferedStates.empty())
+            return;
+
+        DBClientBase* conn = _mongod->directClient();
+        conn->insert(_tempNs.ns(), _bufferedStates);
+        BSONObj err = conn->getLastErrorDetailed();
+        uassert(17354, str::stream() << "insert for $incrementalGroup failed: " << err,
+                DBClientWithCommands::getLastErrorString(err).empty());
+
+        _bufferedStates.clear();
+        _bufferedBytes = 0;
+    }
+
+    void DocumentSourceIncrementalGroup::finish() {
+        if (!_position.isEmpty())
+            _bufferedStates.push_back(_position);
+        flushStates();
+
+        BSONObj rename = BSON("renameCollection" << _tempNs.ns()
+                           << "to" << _intoNs.ns()
+                           << "dropTarget" << true
+                           );
+        BSONObj info;
+        bool ok = _mongod->directClient()->runCommand("admin", rename, info);
+        uassert(17355, str::stream() << "renameCollection for $incrementalGroup failed: "
+                                     << info,
+                ok);
+
+        // We don't need to drop the temp collection in our destructor if the rename succeeded.
+        _tempNs = NamespaceString("");
+    }
+
+    boost::optional<Document> DocumentSourceIncrementalGroup::getNext() {
+        pExpCtx->checkForInterrupt();
+
+        if (_done)
+            return boost::none;
+
+        if (!_started) {
+            start();
+            _started = true;
+        }
+
+        boost::optional<Document> state = _merger->getNext();
+        if (!state) {
+            finish();
+            _done = true;
+            return boost::none;
+        }
+
+        BSONObj stateBson = state->toBson();
+        if (!_bufferedStates.empty()
+                && _bufferedBytes + stateBson.objsize() > BSONObjMaxUserSize) {
+            flushStates();
+        }
+        _bufferedStates.push_back(stateBson);
+        _bufferedBytes += stateBson.objsize();
+
+        return _group->finalizeMergeable(*state);
+    }
+
+    Value DocumentSourceIncrementalGroup::serialize(bool explain) const {
+        return Value(DOC(getSourceName() << DOC("into" << _intoNs.coll()
+                                             << "trackBy" << _trackBy
+                                             << "group" << _group->serialize(explain)
+                                                                 .getDocument()
+                                                                 [DocumentSourceGroup::groupName]
+                                             )));
+    }
+
+    DocumentSourceIncrementalGroup::DocumentSourceIncrementalGroup(
+            const NamespaceString& intoNs,
+            const string& trackBy,
+            const intrusive_ptr<DocumentSourceGroup>& group,
+            const intrusive_ptr<ExpressionContext>& pExpCtx)
+        : DocumentSource(pExpCtx)
+        , _intoNs(intoNs)
+        , _trackBy(trackBy)
+        , _group(group)
+        , _prepared(false)
+        , _started(false)
+        , _done(false)
+        , _tempNs("") // filled in by start()
+        , _bufferedBytes(0)
+    {}
+
+    intrusive_ptr<DocumentSource> DocumentSourceIncrementalGroup::createFromBson(
+            BSONElement elem,
+            const intrusive_ptr<ExpressionContext>& pExpCtx) {
+        uassert(17356, "$incrementalGroup specification must be an object",
+                elem.type() == Object);
+
+        string into;
+        string trackBy = "_id";
+        BSONElement groupSpec;
+        BSONForEach(field, elem.Obj()) {
+            const StringData name = field.fieldNameStringData();
+            if (name == "into" && field.type() == String) {
+                into = field.str();
+            }
+            else if (name == "trackBy" && field.type() == String) {
+                trackBy = field.str();
+            }
+            else if (name == "group" && field.type() == Object) {
+                groupSpec = field;
+            }
+            else {
+                uasserted(17357, str::stream() << "invalid $incrementalGroup field: " << field);
+            }
+        }
+
+        uassert(17358, "$incrementalGroup needs an 'into' collection and a 'group'",
+                !into.empty() && !groupSpec.eoo());
+
+        intrusive_ptr<DocumentSourceGroup> group = static_cast<DocumentSourceGroup*>(
+                DocumentSourceGroup::createFromBson(groupSpec, pExpCtx).get());
+        group->setMergeableOutput(true);
+
+        NamespaceString intoNs(pExpCtx->ns.db().toString() + '.' + into);
+        return new DocumentSourceIncrementalGroup(intoNs, trackBy, group, pExpCtx);
+    }
+}
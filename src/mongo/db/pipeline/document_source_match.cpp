@@ -66,6 +66,32 @@ namespace mongo {
         return boost::none;
     }
 
+    size_t DocumentSourceMatch::getNextBatch(vector<Document>* batch, size_t maxDocs) {
+        pExpCtx->checkForInterrupt();
+
+        massert(17343, "Should never call getNextBatch on a $match stage with $text clause",
+                !_isTextQuery);
+
+        // Filter each block from our source in place, until one has a match or we hit EOF.
+        const size_t start = batch->size();
+        while (pSource->getNextBatch(batch, maxDocs)) {
+            size_t kept = start;
+            for (size_t i = start; i < batch->size(); i++) {
+                if (!matcher->matches((*batch)[i].toBson()))
+                    continue;
+                if (kept != i)
+                    (*batch)[kept].swap((*batch)[i]);
+                kept++;
+            }
+            batch->resize(kept);
+
+            if (kept > start)
+                return kept - start;
+        }
+
+        return 0;
+    }
+
     bool DocumentSourceMatch::coalesce(const intrusive_ptr<DocumentSource>& nextSource) {
         DocumentSourceMatch* otherMatch = dynamic_cast<DocumentSourceMatch*>(nextSource.get());
         if (!otherMatch)
@@ -95,12 +95,35 @@ namespace mongo {
         , cursor(connection.get(), ns, id, 0, 0)
     {}
 
-    vector<DBClientCursor*> DocumentSourceMergeCursors::getCursors() {
+    bool DocumentSourceMergeCursors::CursorAndConnection::more() {
+        if (!connection.ok())
+            return false; // already exhausted and released
+
+        if (cursor.more())
+            return true;
+
+        // The shard has closed its cursor, so the connection can be reused right away rather
+        // than waiting for the whole merge to finish.
+        connection.done();
+        return false;
+    }
+
+    Document DocumentSourceMergeCursors::CursorAndConnection::next() {
+        BSONObj next = cursor.next();
+        uassert(17029, str::stream() << "Received error in response from "
+                                     << connection->toString()
+                                     << ": " << next,
+                !next.hasField("$err"));
+        return Document::fromBsonWithMetaData(next);
+    }
+
+    vector<DocumentSourceMergeCursors::CursorAndConnection*>
+    DocumentSourceMergeCursors::getCursors() {
         verify(_unstarted);
         start();
-        vector<DBClientCursor*> out;
+        vector<CursorAndConnection*> out;
         for (Cursors::const_iterator it = _cursors.begin(); it !=_cursors.end(); ++it) {
-            out.push_back(&((*it)->cursor));
+            out.push_back(it->get());
         }
 
         return out;
@@ -136,9 +159,8 @@ namespace mongo {
         if (_unstarted)
             start();
 
-        // purge eof cursors and release their connections
-        while (!_cursors.empty() && !(*_currentCursor)->cursor.more()) {
-            (*_currentCursor)->connection.done();
+        // purge eof cursors (more() releases their connections)
+        while (!_cursors.empty() && !(*_currentCursor)->more()) {
             _cursors.erase(_currentCursor);
             _currentCursor = _cursors.begin();
         }
@@ -146,17 +168,13 @@ namespace mongo {
         if (_cursors.empty())
             return boost::none;
 
-        BSONObj next = (*_currentCursor)->cursor.next();
-        uassert(17029, str::stream() << "Received error in response from "
-                                     << (*_currentCursor)->connection->toString()
-                                     << ": " << next,
-                !next.hasField("$err"));
+        const Document next = (*_currentCursor)->next();
 
         // advance _currentCursor, wrapping if needed
         if (++_currentCursor == _cursors.end())
             _currentCursor = _cursors.begin();
 
-        return Document::fromBsonWithMetaData(next);
+        return next;
     }
 
     void DocumentSourceMergeCursors::dispose() {
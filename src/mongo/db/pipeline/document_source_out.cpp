@@ -30,6 +30,10 @@
 
 #include "mongo/db/pipeline/document_source.h"
 
+#include "mongo/base/owned_pointer_vector.h"
+#include "mongo/client/connpool.h"
+#include "mongo/s/shardkey.h"
+
 namespace mongo {
     const char DocumentSourceOut::outName[] = "$out";
 
@@ -38,11 +42,105 @@ namespace mongo {
             // Make sure we drop the temp collection if anything goes wrong. Errors are ignored
             // here because nothing can be done about them. Additionally, if this fails and the
             // collection is left behind, it will be cleaned up next time the server is started.
-            if (_mongod && _tempNs.size())
+            // The router cleans up the temp collections for a sharded output.
+            if (_mongod && _tempNs.size() && !isShardedOutput())
                 _mongod->directClient()->dropCollection(_tempNs.ns());
         )
     }
 
+    namespace {
+        // Creates tempNs on conn's server with the same indexes as outputNs has there.
+        void createTempCollection(DBClientBase* conn,
+                                  const NamespaceString& tempNs,
+                                  const NamespaceString& outputNs) {
+            {
+                BSONObj info;
+                bool ok =conn->runCommand(outputNs.db().toString(),
+                                          BSON("create" << tempNs.coll() << "temp" << true),
+                                          info);
+                uassert(16994, str::stream() << "failed to create temporary $out collection '"
+                                             << tempNs.ns() << "': " << info.toString(),
+                        ok);
+            }
+
+            // copy indexes on outputNs to tempNs
+            scoped_ptr<DBClientCursor> indexes(conn->getIndexes(outputNs));
+            while (indexes->more()) {
+                MutableDocument index(Document(indexes->nextSafe()));
+                index.remove("_id"); // indexes shouldn't have _ids but some existing ones do
+                index["ns"] = Value(tempNs.ns());
+
+                BSONObj indexBson = index.freeze().toBson();
+                conn->insert(tempNs.getSystemIndexesCollection(), indexBson);
+                BSONObj err = conn->getLastErrorDetailed();
+                uassert(16995, str::stream() << "copying index for $out failed."
+                                             << " index: " << indexBson
+                                             << " error: " <<  err,
+                        DBClientWithCommands::getLastErrorString(err).empty());
+            }
+        }
+
+        /**
+         * Fills the temp collection on one shard of a sharded output collection. Batches are
+         * sent without waiting for the shard to apply them, so all the shards insert in
+         * parallel. A batch's result is checked just before the next batch goes to the same
+         * shard, and in done().
+         */
+        class ShardWriter {
+        public:
+            ShardWriter(const string& shard,
+                        const NamespaceString& tempNs,
+                        const NamespaceString& outputNs)
+                : _conn(shard)
+                , _tempNs(tempNs)
+                , _bufferedBytes(0)
+                , _unchecked(false) {
+                createTempCollection(_conn.get(), tempNs, outputNs);
+            }
+
+            void add(const BSONObj& obj) {
+                if (!_buffer.empty() && _bufferedBytes + obj.objsize() > BSONObjMaxUserSize)
+                    flush();
+                _buffer.push_back(obj);
+                _bufferedBytes += obj.objsize();
+            }
+
+            // Sends anything still buffered and waits for all of it to be inserted.
+            void done() {
+                flush();
+                checkLastInsert();
+                _conn.done();
+            }
+
+        private:
+            void flush() {
+                if (_buffer.empty())
+                    return;
+                checkLastInsert();
+                _conn->insert(_tempNs.ns(), _buffer);
+                _unchecked = true;
+                _buffer.clear();
+                _bufferedBytes = 0;
+            }
+
+            void checkLastInsert() {
+                if (!_unchecked)
+                    return;
+                _unchecked = false;
+                BSONObj err = _conn->getLastErrorDetailed();
+                uassert(17345, str::stream() << "insert for $out failed on shard "
+                                             << _conn.getHost() << ": " << err,
+                        DBClientWithCommands::getLastErrorString(err).empty());
+            }
+
+            ScopedDbConnection _conn;
+            const NamespaceString _tempNs;
+            vector<BSONObj> _buffer;
+            int _bufferedBytes;
+            bool _unchecked; // an insert was sent but we haven't looked at its result yet
+        };
+    }
+
     const char *DocumentSourceOut::getSourceName() const {
         return outName;
     }
@@ -69,31 +167,7 @@ namespace mongo {
                                            << aggOutCounter.addAndFetch(1)
                                            );
 
-        {
-            BSONObj info;
-            bool ok =conn->runCommand(_outputNs.db().toString(),
-                                      BSON("create" << _tempNs.coll() << "temp" << true),
-                                      info);
-            uassert(16994, str::stream() << "failed to create temporary $out collection '"
-                                         << _tempNs.ns() << "': " << info.toString(),
-                    ok);
-        }
-
-        // copy indexes on _outputNs to _tempNs
-        scoped_ptr<DBClientCursor> indexes(conn->getIndexes(_outputNs));
-        while (indexes->more()) {
-            MutableDocument index(Document(indexes->nextSafe()));
-            index.remove("_id"); // indexes shouldn't have _ids but some existing ones do
-            index["ns"] = Value(_tempNs.ns());
-
-            BSONObj indexBson = index.freeze().toBson();
-            conn->insert(_tempNs.getSystemIndexesCollection(), indexBson);
-            BSONObj err = conn->getLastErrorDetailed();
-            uassert(16995, str::stream() << "copying index for $out failed."
-                                         << " index: " << indexBson
-                                         << " error: " <<  err,
-                    DBClientWithCommands::getLastErrorString(err).empty());
-        }
+        createTempCollection(conn, _tempNs, _outputNs);
     }
 
     void DocumentSourceOut::spill(DBClientBase* conn, const vector<BSONObj>& toInsert) {
@@ -111,6 +185,11 @@ namespace mongo {
             return boost::none;
         _done = true;
 
+        if (isShardedOutput()) {
+            writeToShards();
+            return boost::none;
+        }
+
         verify(_mongod);
         DBClientBase* conn = _mongod->directClient();
 
@@ -155,6 +234,64 @@ namespace mongo {
         return boost::none;
     }
 
+    void DocumentSourceOut::writeToShards() {
+        const ShardKeyPattern shardKey(_shardKey);
+
+        // Each chunk's max, mapped to the writer for the shard that owns the chunk. As in
+        // ChunkManager, a key belongs to the first chunk whose max is greater than it.
+        typedef map<BSONObj, ShardWriter*, BSONObjCmp> ChunkMaxes;
+        ChunkMaxes chunkMaxes;
+        OwnedPointerVector<ShardWriter> writers;
+        map<string, ShardWriter*> shardWriters;
+        BSONForEach(chunkElem, _chunks) {
+            const BSONObj chunk = chunkElem.Obj();
+            const string shard = chunk["shard"].String();
+            ShardWriter*& writer = shardWriters[shard];
+            if (!writer) {
+                writer = new ShardWriter(shard, _tempNs, _outputNs);
+                writers.mutableVector().push_back(writer);
+            }
+            chunkMaxes[chunk["max"].Obj()] = writer;
+        }
+
+        while (boost::optional<Document> next = pSource->getNext()) {
+            BSONObj toInsert = next->toBson();
+
+            // Give the document the _id a shard would, since _id may be part of the shard key.
+            if (toInsert["_id"].eoo()) {
+                BSONObjBuilder withId;
+                withId.appendOID("_id", NULL, true);
+                withId.appendElements(toInsert);
+                toInsert = withId.obj();
+            }
+
+            uassert(17346, str::stream() << "$out document " << toInsert
+                                         << " does not contain shard key for pattern "
+                                         << _shardKey,
+                    shardKey.hasShardKey(toInsert));
+
+            ChunkMaxes::const_iterator chunk =
+                chunkMaxes.upper_bound(shardKey.extractKey(toInsert));
+            uassert(17347, str::stream() << "no chunk of " << _outputNs.ns()
+                                         << " holds $out document " << toInsert,
+                    chunk != chunkMaxes.end());
+
+            chunk->second->add(toInsert);
+        }
+
+        for (size_t i = 0; i < writers.size(); i++) {
+            writers.vector()[i]->done();
+        }
+    }
+
+    void DocumentSourceOut::setShardedOutput(const BSONObj& shardKey,
+                                             const BSONArray& chunks,
+                                             const string& tempColl) {
+        _shardKey = shardKey.getOwned();
+        _chunks = BSONArray(chunks.getOwned());
+        _tempNs = NamespaceString(_outputNs.db(), tempColl);
+    }
+
     DocumentSourceOut::DocumentSourceOut(const NamespaceString& outputNs,
                                          const intrusive_ptr<ExpressionContext>& pExpCtx)
         : DocumentSource(pExpCtx)
@@ -166,6 +303,24 @@ namespace mongo {
     intrusive_ptr<DocumentSource> DocumentSourceOut::createFromBson(
             BSONElement elem,
             const intrusive_ptr<ExpressionContext> &pExpCtx) {
+        if (elem.type() == Object) {
+            // {to: <collection>, shardKey: <pattern>, chunks: [...], tempColl: <collection>}
+            // is sent by mongos for a sharded output collection. See setShardedOutput().
+            BSONObj spec = elem.Obj();
+            uassert(17348, str::stream() << "invalid sharded $out specification: " << spec,
+                    spec["to"].type() == String
+                    && spec["shardKey"].type() == Object
+                    && spec["chunks"].type() == Array
+                    && spec["tempColl"].type() == String);
+
+            NamespaceString outputNs(pExpCtx->ns.db().toString() + '.' + spec["to"].str());
+            intrusive_ptr<DocumentSourceOut> out = new DocumentSourceOut(outputNs, pExpCtx);
+            out->setShardedOutput(spec["shardKey"].Obj(),
+                                  BSONArray(spec["chunks"].Obj()),
+                                  spec["tempColl"].str());
+            return out;
+        }
+
         uassert(16990, str::stream() << "$out only supports a string argument, not "
                                      << typeName(elem.type()),
                 elem.type() == String);
@@ -178,6 +333,13 @@ namespace mongo {
         massert(17000, "$out shouldn't have different db than input",
                 _outputNs.db() == pExpCtx->ns.db());
 
+        if (isShardedOutput()) {
+            return Value(DOC(getSourceName() << DOC("to" << _outputNs.coll()
+                                                 << "shardKey" << _shardKey
+                                                 << "chunks" << _chunks
+                                                 << "tempColl" << _tempNs.coll())));
+        }
+
         return Value(DOC(getSourceName() << _outputNs.coll()));
     }
 }
@@ -55,10 +55,26 @@ namespace mongo {
         if (!input)
             return boost::none;
 
+        return project(*input);
+    }
+
+    size_t DocumentSourceProject::getNextBatch(vector<Document>* batch, size_t maxDocs) {
+        pExpCtx->checkForInterrupt();
+
+        const size_t start = batch->size();
+        const size_t n = pSource->getNextBatch(batch, maxDocs);
+        for (size_t i = start; i < start + n; i++) {
+            Document out = project((*batch)[i]);
+            (*batch)[i].swap(out);
+        }
+        return n;
+    }
+
+    Document DocumentSourceProject::project(const Document& input) {
         /* create the result document */
         const size_t sizeHint = pEO->getSizeHint();
         MutableDocument out (sizeHint);
-        out.copyMetaDataFrom(*input);
+        out.copyMetaDataFrom(input);
 
         /*
           Use the ExpressionObject to create the base result.
@@ -66,15 +82,15 @@ namespace mongo {
           If we're excluding fields at the top level, leave out the _id if
           it is found, because we took care of it above.
         */
-        _variables->setRoot(*input);
-        pEO->addToDocument(out, *input, _variables.get());
+        _variables->setRoot(input);
+        pEO->addToDocument(out, input, _variables.get());
         _variables->clearRoot();
 
 #if defined(_DEBUG)
         if (!_simpleProjection.getSpec().isEmpty()) {
             // Make sure we return the same results as Projection class
 
-            BSONObj inputBson = input->toBson();
+            BSONObj inputBson = input.toBson();
             BSONObj outputBson = out.peek().toBson();
 
             BSONObj projected = _simpleProjection.transform(inputBson);
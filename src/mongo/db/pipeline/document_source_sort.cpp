@@ -229,8 +229,14 @@ namespace mongo {
             }
         } else {
             scoped_ptr<MySorter> sorter (MySorter::make(makeSortOptions(), Comparator(*this)));
-            while (boost::optional<Document> next = pSource->getNext()) {
-                sorter->add(extractKey(*next), *next);
+            vector<Document> batch;
+            batch.reserve(kBatchSize);
+            while (pSource->getNextBatch(&batch, kBatchSize)) {
+                for (vector<Document>::const_iterator next = batch.begin(); next != batch.end();
+                        ++next) {
+                    sorter->add(extractKey(*next), *next);
+                }
+                batch.clear();
             }
             _output.reset(sorter->done());
         }
@@ -239,22 +245,28 @@ namespace mongo {
 
     class DocumentSourceSort::IteratorFromCursor : public MySorter::Iterator {
     public:
-        IteratorFromCursor(DocumentSourceSort* sorter, DBClientCursor* cursor)
+        typedef DocumentSourceMergeCursors::CursorAndConnection CursorAndConnection;
+
+        IteratorFromCursor(DocumentSourceSort* sorter, CursorAndConnection* cursor)
             : _sorter(sorter)
             , _cursor(cursor)
         {}
 
         bool more() { return _cursor->more(); }
         Data next() {
-            const Document doc = Document::fromBsonWithMetaData(_cursor->next());
+            const Document doc = _cursor->next();
             return make_pair(_sorter->extractKey(doc), doc);
         }
     private:
         DocumentSourceSort* _sorter;
-        DBClientCursor* _cursor;
+        CursorAndConnection* _cursor;
     };
 
-    void DocumentSourceSort::populateFromCursors(const vector<DBClientCursor*>& cursors) {
+    void DocumentSourceSort::populateFromCursors(
+            const vector<DocumentSourceMergeCursors::CursorAndConnection*>& cursors) {
+        // Each shard's output is already sorted, so this is a streaming k-way merge: documents
+        // are returned as soon as every shard's head is known, reading further batches from a
+        // shard only as its documents are consumed.
         vector<boost::shared_ptr<MySorter::Iterator> > iterators;
         for (size_t i = 0; i < cursors.size(); i++) {
             iterators.push_back(boost::make_shared<IteratorFromCursor>(this, cursors[i]));
@@ -1145,6 +1145,16 @@ namespace {
         addField(theFieldPath, NULL);
     }
 
+    bool ExpressionObject::passesThroughField(const string& fieldName) const {
+        FieldMap::const_iterator it = _expressions.find(fieldName);
+        if (it == _expressions.end()) {
+            // see addToDocument()
+            return !_excludeId && _atRoot && fieldName == "_id";
+        }
+
+        return !it->second; // NULL means an inclusion
+    }
+
     Value ExpressionObject::serialize(bool explain) const {
         MutableDocument valBuilder;
         if (_excludeId)
@@ -1204,7 +1214,12 @@ namespace {
         , _baseVar(_fieldPath.getFieldName(0) == "CURRENT" ? CURRENT :
                    _fieldPath.getFieldName(0) == "ROOT" ?    ROOT :
                                                              OTHER)
-    {}
+    {
+        _fieldHashes.reserve(_fieldPath.getPathLength());
+        for (size_t i = 0; i < _fieldPath.getPathLength(); i++) {
+            _fieldHashes.push_back(Document::hashFieldName(_fieldPath.getFieldName(i)));
+        }
+    }
 
     intrusive_ptr<Expression> ExpressionFieldPath::optimize() {
         /* nothing can be done for these */
@@ -1245,10 +1260,10 @@ namespace {
 
         /* if we've hit the end of the path, stop */
         if (index == _fieldPath.getPathLength() - 1)
-            return input[_fieldPath.getFieldName(index)];
+            return input.getField(_fieldPath.getFieldName(index), _fieldHashes[index]);
 
         // Try to dive deeper
-        const Value val = input[_fieldPath.getFieldName(index)];
+        const Value val = input.getField(_fieldPath.getFieldName(index), _fieldHashes[index]);
         switch (val.getType()) {
         case Object:
             return evaluatePath(index+1, val.getDocument());
@@ -83,6 +83,8 @@ namespace mongo {
          */
         Document getDocument(Id id) const;
 
+        size_t getNumVars() const { return _numVars; }
+
     private:
         Document _root;
         const boost::scoped_array<Value> _rest;
@@ -587,6 +589,10 @@ namespace mongo {
         const FieldPath _fieldPath;
         const Variables::Id _variable;
         const BaseVar _baseVar; // TODO remove
+
+        // Document::hashFieldName() of each of _fieldPath's names, computed once here rather
+        // than for every Document the path is looked up in.
+        vector<unsigned> _fieldHashes;
     };
 
 
@@ -818,6 +824,9 @@ namespace mongo {
 
         void excludeId(bool b) { _excludeId = b; }
 
+        /// true if the (undotted) field fieldName is copied from the input unchanged and whole
+        bool passesThroughField(const string& fieldName) const;
+
     private:
         ExpressionObject(bool atRoot);
 
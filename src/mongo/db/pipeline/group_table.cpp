@@ -0,0 +1,95 @@
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/pipeline/group_table.h"
+
+namespace mongo {
+
+    namespace {
+        // Value::Hash of small numbers varies little in its low bits, which linear probing on a
+        // power of two table needs; scramble it with the MurmurHash3 finalizer.
+        size_t mixHash(size_t hash) {
+            uint64_t h = hash;
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+    }
+
+    size_t GroupTable::findOrInsert(const Value& id, bool* inserted) {
+        if ((_ids.size() + 1) * 2 > _slots.size())
+            grow();
+
+        const size_t hash = mixHash(Value::Hash()(id));
+        for (size_t slot = hash & _mask; ; slot = (slot + 1) & _mask) {
+            const uint32_t entry = _slots[slot];
+            if (entry == 0) {
+                const size_t group = _ids.size();
+                _slots[slot] = group + 1;
+                _ids.push_back(id);
+                _hashes.push_back(hash);
+                _accumulators.resize(_accumulators.size() + _numAccumulators);
+                *inserted = true;
+                return group;
+            }
+
+            const size_t group = entry - 1;
+            if (_hashes[group] == hash && _ids[group] == id) {
+                *inserted = false;
+                return group;
+            }
+        }
+    }
+
+    void GroupTable::grow() {
+        const size_t newSize = _slots.empty() ? 16 : _slots.size() * 2;
+        vector<uint32_t>(newSize, 0).swap(_slots);
+        _mask = newSize - 1;
+
+        for (size_t group = 0; group < _hashes.size(); group++) {
+            size_t slot = _hashes[group] & _mask;
+            while (_slots[slot] != 0)
+                slot = (slot + 1) & _mask;
+            _slots[slot] = group + 1;
+        }
+    }
+
+    void GroupTable::clear() {
+        vector<Value>().swap(_ids);
+        vector<size_t>().swap(_hashes);
+        vector<intrusive_ptr<Accumulator> >().swap(_accumulators);
+        vector<uint32_t>().swap(_slots);
+        _mask = 0;
+    }
+
+}
@@ -0,0 +1,90 @@
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    /**
+     * The hash table $group buckets its input in.
+     *
+     * Groups are numbered in insertion order and stored in flat arrays: their _id Values, the
+     * hashes of those, and every group's accumulators back to back. Lookups probe an open
+     * addressed (linear probing) index of group numbers, so adding a group costs no allocations
+     * beyond its accumulators, and growing the table never rehashes a Value.
+     */
+    class GroupTable {
+    public:
+        GroupTable() : _numAccumulators(0), _mask(0) {}
+
+        /** Must be called while empty. */
+        void setNumAccumulators(size_t numAccumulators) {
+            verify(empty());
+            _numAccumulators = numAccumulators;
+        }
+
+        /**
+         * Returns the number of the group whose _id is 'id', adding it if there isn't one.
+         * A new group's accumulators are NULL and must be filled in by the caller.
+         */
+        size_t findOrInsert(const Value& id, bool* inserted);
+
+        size_t size() const { return _ids.size(); }
+        bool empty() const { return _ids.empty(); }
+
+        const Value& id(size_t group) const { return _ids[group]; }
+
+        /** The group's accumulators, or NULL if there are none. */
+        intrusive_ptr<Accumulator>* accumulators(size_t group) {
+            return _numAccumulators ? &_accumulators[group * _numAccumulators] : NULL;
+        }
+
+        /** Removes all groups and releases their memory. */
+        void clear();
+
+    private:
+        void grow();
+
+        size_t _numAccumulators;
+        vector<Value> _ids;
+        vector<size_t> _hashes;
+        vector<intrusive_ptr<Accumulator> > _accumulators;
+
+        // Group number + 1 for each used slot, 0 for empty ones. The size is a power of two kept
+        // at least twice the number of groups.
+        vector<uint32_t> _slots;
+        size_t _mask;
+    };
+
+}
@@ -71,6 +71,8 @@ namespace mongo {
          DocumentSourceGeoNear::createFromBson},
         {DocumentSourceGroup::groupName,
          DocumentSourceGroup::createFromBson},
+        {DocumentSourceIncrementalGroup::incrementalGroupName,
+         DocumentSourceIncrementalGroup::createFromBson},
         {DocumentSourceLimit::limitName,
          DocumentSourceLimit::createFromBson},
         {DocumentSourceMatch::matchName,
@@ -210,7 +212,7 @@ namespace mongo {
 
         // The order in which optimizations are applied can have significant impact on the
         // efficiency of the final pipeline. Be Careful!
-        Optimizations::Local::moveMatchBeforeSort(pPipeline.get());
+        Optimizations::Local::moveMatchEarlier(pPipeline.get());
         Optimizations::Local::moveLimitBeforeSkip(pPipeline.get());
         Optimizations::Local::coalesceAdjacent(pPipeline.get());
         Optimizations::Local::optimizeEachDocumentSource(pPipeline.get());
@@ -219,22 +221,93 @@ namespace mongo {
         return pPipeline;
     }
 
-    void Pipeline::Optimizations::Local::moveMatchBeforeSort(Pipeline* pipeline) {
-        // TODO Keep moving matches across multiple sorts as moveLimitBeforeSkip does below.
+    namespace {
+        /**
+         * Adds the field paths 'query' filters on to 'paths'. Returns false if the query can
+         * depend on fields it doesn't name, as with $where.
+         */
+        bool getMatchPaths(const BSONObj& query, vector<string>* paths) {
+            BSONForEach(elem, query) {
+                const StringData name = elem.fieldNameStringData();
+                if (name[0] != '$') {
+                    paths->push_back(name.toString());
+                }
+                else if (name == "$and" || name == "$or" || name == "$nor") {
+                    if (elem.type() != Array)
+                        return false;
+
+                    BSONForEach(clause, elem.embeddedObject()) {
+                        if (clause.type() != Object)
+                            return false;
+                        if (!getMatchPaths(clause.embeddedObject(), paths))
+                            return false;
+                    }
+                }
+                else if (name != "$comment") {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /** true if 'lhs' and 'rhs' are the same path, or one is a prefix of the other. */
+        bool pathsOverlap(const string& lhs, const string& rhs) {
+            const string& shorter = lhs.size() < rhs.size() ? lhs : rhs;
+            const string& longer = lhs.size() < rhs.size() ? rhs : lhs;
+            return str::startsWith(longer, shorter)
+                && (longer.size() == shorter.size() || longer[shorter.size()] == '.');
+        }
+
+        /**
+         * true if a match on 'paths' accepts the same documents before 'stage' as after it.
+         * A NULL 'paths' means the match's fields aren't known.
+         */
+        bool canMoveMatchBefore(DocumentSource* stage, const vector<string>* paths) {
+            if (dynamic_cast<DocumentSourceSort*>(stage))
+                return true;
+
+            if (!paths)
+                return false;
+
+            if (DocumentSourceProject* project = dynamic_cast<DocumentSourceProject*>(stage)) {
+                for (size_t i = 0; i < paths->size(); i++) {
+                    const string& path = (*paths)[i];
+                    const string topLevel = path.substr(0, path.find('.'));
+                    if (!project->passesThroughField(topLevel))
+                        return false;
+                }
+                return true;
+            }
+
+            if (DocumentSourceUnwind* unwind = dynamic_cast<DocumentSourceUnwind*>(stage)) {
+                const string unwindPath = unwind->getUnwindPath();
+                for (size_t i = 0; i < paths->size(); i++) {
+                    if (pathsOverlap((*paths)[i], unwindPath))
+                        return false;
+                }
+                return true;
+            }
+
+            return false;
+        }
+    }
+
+    void Pipeline::Optimizations::Local::moveMatchEarlier(Pipeline* pipeline) {
         // TODO Check sort for limit. Not an issue currently due to order optimizations are applied,
         // but should be fixed.
         SourceContainer& sources = pipeline->sources;
         for (size_t srcn = sources.size(), srci = 1; srci < srcn; ++srci) {
-            intrusive_ptr<DocumentSource> &pSource = sources[srci];
-            DocumentSourceMatch* match = dynamic_cast<DocumentSourceMatch *>(pSource.get());
-            if (match && !match->isTextQuery()) {
-                intrusive_ptr<DocumentSource> &pPrevious = sources[srci - 1];
-                if (dynamic_cast<DocumentSourceSort *>(pPrevious.get())) {
-                    /* swap this item with the previous */
-                    intrusive_ptr<DocumentSource> pTemp(pPrevious);
-                    pPrevious = pSource;
-                    pSource = pTemp;
-                }
+            DocumentSourceMatch* match = dynamic_cast<DocumentSourceMatch*>(sources[srci].get());
+            if (!match || match->isTextQuery())
+                continue;
+
+            vector<string> paths;
+            const vector<string>* knownPaths =
+                getMatchPaths(match->getQuery(), &paths) ? &paths : NULL;
+
+            for (size_t i = srci; i > 0 && canMoveMatchBefore(sources[i - 1].get(), knownPaths);
+                    --i) {
+                swap(sources[i], sources[i - 1]);
             }
         }
     }
@@ -334,7 +407,15 @@ namespace mongo {
         BSONForEach(stageElem, pipeline) {
             BSONObj stage = stageElem.embeddedObjectUserCheck();
             if (str::equals(stage.firstElementFieldName(), "$out")) {
-                NamespaceString outputNs(db, stage.firstElement().str());
+                BSONElement outElem = stage.firstElement();
+                if (outElem.type() == Object) {
+                    // Writing straight into other shards' collections is only for mongos.
+                    out->push_back(Privilege(ResourcePattern::forClusterResource(),
+                                             ActionType::aggregateShardedOut));
+                    outElem = outElem.Obj()["to"];
+                }
+
+                NamespaceString outputNs(db, outElem.str());
                 uassert(17139,
                         mongoutils::str::stream() << "Invalid $out target namespace, " <<
                         outputNs.ns(),
@@ -345,6 +426,24 @@ namespace mongo {
                 actions.addAction(ActionType::insert);
                 out->push_back(Privilege(ResourcePattern::forExactNamespace(outputNs), actions));
             }
+            else if (str::equals(stage.firstElementFieldName(), "$incrementalGroup")) {
+                // The saved states are read back and then replaced.
+                BSONElement intoElem = stage.firstElement();
+                if (intoElem.type() == Object)
+                    intoElem = intoElem.Obj()["into"];
+
+                NamespaceString intoNs(db, intoElem.str());
+                uassert(17360,
+                        mongoutils::str::stream() << "Invalid $incrementalGroup target namespace, "
+                                                  << intoNs.ns(),
+                        intoNs.isValid());
+
+                ActionSet actions;
+                actions.addAction(ActionType::find);
+                actions.addAction(ActionType::remove);
+                actions.addAction(ActionType::insert);
+                out->push_back(Privilege(ResourcePattern::forExactNamespace(intoNs), actions));
+            }
         }
     }
 
@@ -461,16 +560,22 @@ namespace mongo {
         // cant use subArrayStart() due to error handling
         BSONArrayBuilder resultArray;
         DocumentSource* finalSource = sources.back().get();
-        while (boost::optional<Document> next = finalSource->getNext()) {
-            // add the document to the result set
-            BSONObjBuilder documentBuilder (resultArray.subobjStart());
-            next->toBson(&documentBuilder);
-            documentBuilder.doneFast();
-            // object will be too large, assert. the extra 1KB is for headers
-            uassert(16389,
-                    str::stream() << "aggregation result exceeds maximum document size ("
-                                  << BSONObjMaxUserSize / (1024 * 1024) << "MB)",
-                    resultArray.len() < BSONObjMaxUserSize - 1024);
+        vector<Document> batch;
+        batch.reserve(DocumentSource::kBatchSize);
+        while (finalSource->getNextBatch(&batch, DocumentSource::kBatchSize)) {
+            for (vector<Document>::const_iterator next = batch.begin(); next != batch.end();
+                    ++next) {
+                // add the document to the result set
+                BSONObjBuilder documentBuilder (resultArray.subobjStart());
+                next->toBson(&documentBuilder);
+                documentBuilder.doneFast();
+                // object will be too large, assert. the extra 1KB is for headers
+                uassert(16389,
+                        str::stream() << "aggregation result exceeds maximum document size ("
+                                      << BSONObjMaxUserSize / (1024 * 1024) << "MB)",
+                        resultArray.len() < BSONObjMaxUserSize - 1024);
+            }
+            batch.clear();
         }
 
         resultArray.done();
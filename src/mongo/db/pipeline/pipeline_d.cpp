@@ -31,11 +31,14 @@
 #include "mongo/db/pipeline/pipeline_d.h"
 
 #include "mongo/client/dbclientinterface.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/get_runner.h"
 #include "mongo/db/query/query_planner.h"
+#include "mongo/db/structure/collection.h"
 #include "mongo/s/d_logic.h"
 
 
@@ -60,6 +63,55 @@ namespace {
     private:
         DBDirectClient _client;
     };
+
+    /**
+     * Returns true if some index holds every field that 'projection' (as built by
+     * DocumentSource::depsToProjection) includes, in a way the query planner can cover: top
+     * level, ascending or descending, and not multikey. Handing such a projection to the query
+     * system lets it build results from index keys without fetching documents.
+     */
+    bool projectionIsCoverable(Collection* collection, const BSONObj& projection) {
+        if (!collection)
+            return false;
+
+        IndexCatalog* catalog = collection->getIndexCatalog();
+        for (int i = 0; i < catalog->numIndexesReady(); ++i) {
+            const IndexDescriptor* desc = catalog->getDescriptor(i);
+            const BSONObj& keyPattern = desc->keyPattern();
+            const unsigned multikeyFields = desc->isMultikey() ? desc->multikeyFields() : 0;
+
+            bool covered = true;
+            BSONObjIterator fields(projection);
+            while (covered && fields.more()) {
+                BSONElement field = fields.next();
+                if (!field.trueValue())
+                    continue; // {_id: 0}
+
+                if (field.type() == Object || strchr(field.fieldName(), '.')) {
+                    // $meta or a dotted path: the query system would fetch anyway.
+                    covered = false;
+                    break;
+                }
+
+                covered = false;
+                BSONObjIterator keys(keyPattern);
+                for (unsigned pos = 0; keys.more(); ++pos) {
+                    BSONElement key = keys.next();
+                    if (strcmp(key.fieldName(), field.fieldName()) != 0)
+                        continue;
+                    covered = key.isNumber()
+                           && (!desc->isMultikey()
+                               || (pos < 31 && !(multikeyFields & (1u << pos))));
+                    break;
+                }
+            }
+
+            if (covered)
+                return true;
+        }
+
+        return false;
+    }
 }
 
     void PipelineD::prepareCursorSource(
@@ -89,6 +141,27 @@ namespace {
             return; // don't need a cursor
         }
 
+        // An $incrementalGroup only reads the input documents added since its last run. It may
+        // only follow $match stages, so its range can become part of the initial query.
+        for (size_t i = 0; i < sources.size(); i++) {
+            DocumentSourceIncrementalGroup* incremental =
+                dynamic_cast<DocumentSourceIncrementalGroup*>(sources[i].get());
+            if (!incremental)
+                continue;
+
+            for (size_t j = 0; j < i; j++) {
+                uassert(17359, "$incrementalGroup may only be preceded by $match stages",
+                        dynamic_cast<DocumentSourceMatch*>(sources[j].get()));
+            }
+
+            const BSONObj delta = BSON("$match" << incremental->prepareDeltaQuery());
+            intrusive_ptr<DocumentSource> deltaMatch =
+                DocumentSourceMatch::createFromBson(delta.firstElement(), pExpCtx);
+            if (i == 0 || !sources.front()->coalesce(deltaMatch))
+                sources.push_front(deltaMatch);
+            break;
+        }
+
 
         // Look for an initial match. This works whether we got an initial query or not.
         // If not, it results in a "{}" query, which will be what we want in that case.
@@ -165,6 +238,15 @@ namespace {
         // Note: this may throw if the sharding version for this connection is out of date.
         Client::ReadContext context(fullName);
 
+        // If an index holds every field the pipeline needs, let the query system compute the
+        // projection so it can pick a covered plan; the cursor then builds Documents from the
+        // projected index keys instead of from fetched documents.
+        if (haveProjection && !needQueryProjection
+                && projectionIsCoverable(context.ctx().db()->getCollection(fullName),
+                                         projection)) {
+            needQueryProjection = true;
+        }
+
         // Create the Runner.
         //
         // If we try to create a Runner that includes both the match and the
@@ -192,8 +274,8 @@ namespace {
         bool sortInRunner = false;
         if (sortStage) {
             CanonicalQuery* cq;
-            // Passing an empty projection since it is faster to use documentFromBsonWithDeps.
-            // This will need to change to support covering indexes (SERVER-12015).
+            // Unless the projection can be covered, pass an empty one since it is faster to use
+            // documentFromBsonWithDeps.
             uassertStatusOK(
                 CanonicalQuery::canonicalize(pExpCtx->ns,
                                              queryObj,
@@ -43,14 +43,17 @@ namespace mongo {
      */
     class Pipeline::Optimizations::Local {
     public:
-        /** 
-         * Moves matches before any adjacent sort phases.
+        /**
+         * Moves each match as early as it can go: before any sorts, and before any projects and
+         * unwinds that leave the fields it filters on untouched.
          *
-         * This means we sort fewer items.  Neither sorts, nor matches (excluding $text)
-         * change the documents in the stream, so this transformation shouldn't affect
-         * the result.
+         * This means later stages see fewer documents, and a match that reaches the front of the
+         * pipeline becomes part of the initial query, where it can use an index. Neither sorts
+         * nor matches (excluding $text) change the documents in the stream. A project or unwind
+         * only changes fields the match doesn't look at, so the match accepts the same
+         * documents on either side of it.
          */
-        static void moveMatchBeforeSort(Pipeline* pipeline);
+        static void moveMatchEarlier(Pipeline* pipeline);
 
         /**
          * Moves limits before any adjacent skip phases.
@@ -30,6 +30,8 @@
 
 #include "mongo/db/prefetch.h"
 
+#include "mongo/base/counter.h"
+#include "mongo/db/database.h"
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/index/index_access_method.h"
@@ -40,6 +42,10 @@
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/stats/timer_stats.h"
 #include "mongo/db/commands/server_status.h"
+#include "mongo/db/index_names.h"
+#include "mongo/db/index_set.h"
+#include "mongo/db/pdfile.h"
+#include "mongo/db/storage/extent_manager.h"
 
 namespace mongo {
 
@@ -57,24 +63,124 @@ namespace mongo {
                                                     "repl.preload.docs",
                                                     &prefetchDocStats );
 
+    // What the prefetcher did, to tell whether it pays for itself: records that were already in
+    // memory needed no prefetch at all, and the indexes an update doesn't change keys in aren't
+    // touched.
+    static Counter64 prefetchDocsInMemory;
+    static ServerStatusMetricField<Counter64> displayPrefetchDocsInMemory(
+                                                    "repl.preload.docsInMemory",
+                                                    &prefetchDocsInMemory );
+    static Counter64 prefetchDocsHinted;
+    static ServerStatusMetricField<Counter64> displayPrefetchDocsHinted(
+                                                    "repl.preload.docsHinted",
+                                                    &prefetchDocsHinted );
+    static Counter64 prefetchIndexesSkipped;
+    static ServerStatusMetricField<Counter64> displayPrefetchIndexesSkipped(
+                                                    "repl.preload.indexesSkipped",
+                                                    &prefetchIndexesSkipped );
+
+    // Most documents fit in a page.  A bigger one is read in the rest of the way when applied.
+    static const int kRecordPrefetchBytes = 4096;
+
+    namespace {
+
+        /** whether applying 'updateObj' may change a document's keys in the index 'desc' */
+        bool updateMayChangeKeys(IndexDescriptor* desc, const BSONObj& updateObj) {
+            // a replacement may change anything
+            const BSONElement first = updateObj.firstElement();
+            if (first.eoo() || first.fieldName()[0] != '$')
+                return true;
+
+            // a text index's key pattern doesn't name the fields it indexes
+            if (IndexNames::findPluginName(desc->keyPattern()) == IndexNames::TEXT)
+                return true;
+
+            IndexPathSet indexed;
+            BSONForEach(e, desc->keyPattern()) {
+                indexed.addPath(e.fieldName());
+            }
+
+            BSONForEach(mod, updateObj) {
+                if (mod.type() != Object)
+                    return true;
+                BSONForEach(field, mod.Obj()) {
+                    if (indexed.mightBeIndexed(field.fieldName()))
+                        return true;
+                    // $rename also writes the field it names
+                    if (field.type() == String && indexed.mightBeIndexed(field.valuestr()))
+                        return true;
+                }
+            }
+            return false;
+        }
+
+        /** touches 'obj''s keys in 'desc' */
+        void touchIndex(Collection* collection, IndexDescriptor* desc, const BSONObj& obj) {
+            TimerHolder timer(&prefetchIndexStats);
+            try {
+                IndexAccessMethod* iam = collection->getIndexCatalog()->getIndex(desc);
+                verify(iam);
+                iam->touch(obj);
+            }
+            catch (const DBException& e) {
+                LOG(2) << "ignoring exception in prefetchIndexPages(): " << e.what() << endl;
+            }
+        }
+
+        /**
+         * prefetch for an update: the record, and the current keys of the indexes the update
+         * may change.  Other indexes are left alone, as an update that keeps their keys doesn't
+         * touch them.
+         */
+        void prefetchForUpdate(Collection* collection,
+                               const BSONObj& query,
+                               const BSONObj& update) {
+            vector<IndexDescriptor*> changed;
+            if (theReplSet->getIndexPrefetchConfig() == ReplSetImpl::PREFETCH_ALL) {
+                int indexCount = collection->getIndexCatalog()->numIndexesTotal();
+                for (int indexNo = 0; indexNo < indexCount; indexNo++) {
+                    IndexDescriptor* desc = collection->getIndexCatalog()->getDescriptor(indexNo);
+                    verify(desc);
+                    // findById() in prefetchRecordPages() touches the _id index
+                    if (desc->isIdIndex())
+                        continue;
+                    if (updateMayChangeKeys(desc, update))
+                        changed.push_back(desc);
+                    else
+                        prefetchIndexesSkipped.increment();
+                }
+            }
+
+            // capped collections typically do not have an _id index for findById() to use
+            if (collection->details()->isCapped())
+                return;
+
+            DiskLoc loc = prefetchRecordPages(collection, query);
+            if (loc.isNull() || changed.empty())
+                return;
+
+            // the old keys come from the document, so it is read in now rather than hinted
+            BSONObj current = loc.obj();
+            for (size_t i = 0; i < changed.size(); i++) {
+                touchIndex(collection, changed[i], current);
+            }
+        }
+
+    } // namespace
+
     // prefetch for an oplog operation
     void prefetchPagesForReplicatedOp(const BSONObj& op) {
-        const char *opField;
         const char *opType = op.getStringField("op");
         switch (*opType) {
         case 'i': // insert
         case 'd': // delete
-            opField = "o";
-            break;
         case 'u': // update
-            opField = "o2";
             break;
         default:
             // prefetch ignores other ops
             return;
         }
 
-        BSONObj obj = op.getObjectField(opField);
         const char *ns = op.getStringField("ns");
 
         Database* db = cc().database();
@@ -89,40 +195,24 @@ namespace mongo {
 
         DEV Lock::assertAtLeastReadLocked(ns);
 
-        // should we prefetch index pages on updates? if the update is in-place and doesn't change 
-        // indexed values, it is actually slower - a lot slower if there are a dozen indexes or 
-        // lots of multikeys.  possible variations (not all mutually exclusive):
-        //  1) current behavior: full prefetch
-        //  2) don't do it for updates
-        //  3) don't do multikey indexes for updates
-        //  4) don't prefetchIndexPages on some heuristic; e.g., if it's an $inc.
-        //  5) if not prefetching index pages (#2), we should do it if we are upsertings and it 
-        //     will be an insert. to do that we could do the prefetchRecordPage first and if DNE
-        //     then we do #1.
-        // 
-        // note that on deletes 'obj' does not have all the keys we would want to prefetch on.
-        // a way to achieve that would be to prefetch the record first, and then afterwards do 
-        // this part.
-        //
-        prefetchIndexPages(collection, obj);
-
-        // do not prefetch the data for inserts; it doesn't exist yet
-        // 
-        // we should consider doing the record prefetch for the delete op case as we hit the record
-        // when we delete.  note if done we only want to touch the first page.
-        // 
-        // update: do record prefetch. 
-        if ((*opType == 'u') &&
-            // do not prefetch the data for capped collections because
-            // they typically do not have an _id index for findById() to use.
-            !collection->details()->isCapped()) {
-            prefetchRecordPages(ns, obj);
+        switch (*opType) {
+        case 'i':
+            // the new keys go into every index; there is no record yet
+            prefetchIndexPages(collection, op.getObjectField("o"));
+            break;
+        case 'd':
+            // 'o' only has the _id, so no other index's keys can be found from it; they come
+            // from the record, which the delete reads first
+            if (!collection->details()->isCapped())
+                prefetchRecordPages(collection, op.getObjectField("o"));
+            break;
+        default:
+            prefetchForUpdate(collection, op.getObjectField("o2"), op.getObjectField("o"));
+            break;
         }
     }
 
     void prefetchIndexPages(Collection* collection, const BSONObj& obj) {
-        DiskLoc unusedDl; // unused
-        BSONObjSet unusedKeys;
         ReplSetImpl::IndexPrefetchConfig prefetchConfig = theReplSet->getIndexPrefetchConfig();
 
         // do we want prefetchConfig to be (1) as-is, (2) for update ops only, or (3) configured per op type?  
@@ -133,76 +223,61 @@ namespace mongo {
             return;
         case ReplSetImpl::PREFETCH_ID_ONLY:
         {
-            TimerHolder timer( &prefetchIndexStats);
             // on the update op case, the call to prefetchRecordPages will touch the _id index.
             // thus perhaps this option isn't very useful?
             int indexNo = collection->details()->findIdIndex();
             if (indexNo == -1) return;
-            try {
-                IndexDescriptor* desc = collection->getIndexCatalog()->getDescriptor(indexNo);
-                verify( desc );
-                IndexAccessMethod* iam = collection->getIndexCatalog()->getIndex( desc );
-                verify( iam );
-                iam->touch(obj);
-            }
-            catch (const DBException& e) {
-                LOG(2) << "ignoring exception in prefetchIndexPages(): " << e.what() << endl;
-            }
+            IndexDescriptor* desc = collection->getIndexCatalog()->getDescriptor(indexNo);
+            verify( desc );
+            touchIndex(collection, desc, obj);
             break;
         }
         case ReplSetImpl::PREFETCH_ALL:
-        {
-            // indexCount includes all indexes, including ones
-            // in the process of being built
-            int indexCount = collection->getIndexCatalog()->numIndexesTotal();
-            for ( int indexNo = 0; indexNo < indexCount; indexNo++ ) {
-                TimerHolder timer( &prefetchIndexStats);
-                // This will page in all index pages for the given object.
-                try {
-                    IndexDescriptor* desc = collection->getIndexCatalog()->getDescriptor(indexNo);
-                    verify( desc );
-                    IndexAccessMethod* iam = collection->getIndexCatalog()->getIndex( desc );
-                    verify( iam );
-                    iam->touch(obj);
-                }
-                catch (const DBException& e) {
-                    LOG(2) << "ignoring exception in prefetchIndexPages(): " << e.what() << endl;
-                }
-                unusedKeys.clear();
-            }
+            prefetchAllIndexPages(collection, obj);
             break;
-        }
         default:
             fassertFailed(16427);
         }
     }
 
+    void prefetchAllIndexPages(Collection* collection, const BSONObj& obj) {
+        // indexCount includes all indexes, including ones
+        // in the process of being built
+        int indexCount = collection->getIndexCatalog()->numIndexesTotal();
+        for ( int indexNo = 0; indexNo < indexCount; indexNo++ ) {
+            // This will page in all index pages for the given object.
+            IndexDescriptor* desc = collection->getIndexCatalog()->getDescriptor(indexNo);
+            verify( desc );
+            touchIndex(collection, desc, obj);
+        }
+    }
 
-    void prefetchRecordPages(const char* ns, const BSONObj& obj) {
+
+    DiskLoc prefetchRecordPages(Collection* collection, const BSONObj& obj) {
         BSONElement _id;
-        if( obj.getObjectID(_id) ) {
-            TimerHolder timer(&prefetchDocStats);
-            BSONObjBuilder builder;
-            builder.append(_id);
-            BSONObj result;
-            try {
-                // we can probably use Client::Context here instead of ReadContext as we
-                // have locked higher up the call stack already
-                Client::ReadContext ctx( ns );
-                if( Helpers::findById(cc(), ns, builder.done(), result) ) {
-                    // do we want to use Record::touch() here?  it's pretty similar.
-                    volatile char _dummy_char = '\0';
-                    // Touch the first word on every page in order to fault it into memory
-                    for (int i = 0; i < result.objsize(); i += g_minOSPageSizeBytes) {                        
-                        _dummy_char += *(result.objdata() + i); 
-                    }
-                    // hit the last page, in case we missed it above
-                    _dummy_char += *(result.objdata() + result.objsize() - 1);
-                }
+        if( !obj.getObjectID(_id) )
+            return DiskLoc();
+
+        TimerHolder timer(&prefetchDocStats);
+        try {
+            // finding the record walks the _id index, which the op will walk again
+            DiskLoc loc = Helpers::findById(collection->details(), _id.wrap());
+            if (loc.isNull())
+                return loc;
+
+            if (Record::likelyInPhysicalMemory(loc.rec()->dataNoThrowing())) {
+                prefetchDocsInMemory.increment();
             }
-            catch(const DBException& e) {
-                LOG(2) << "ignoring exception in prefetchRecordPages(): " << e.what() << endl;
+            else {
+                // only a hint: the OS reads the page in while this thread moves on
+                cc().database()->getExtentManager().willNeed(loc, kRecordPrefetchBytes);
+                prefetchDocsHinted.increment();
             }
+            return loc;
+        }
+        catch(const DBException& e) {
+            LOG(2) << "ignoring exception in prefetchRecordPages(): " << e.what() << endl;
         }
+        return DiskLoc();
     }
 }
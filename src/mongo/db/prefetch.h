@@ -38,6 +38,11 @@ namespace mongo {
     // page in pages needed for all index lookups on a given object
     void prefetchIndexPages(Collection *nsd, const BSONObj& obj);
 
-    // page in the data pages for a record associated with an object
-    void prefetchRecordPages(const char *ns, const BSONObj& obj);
+    // page in the pages of every index of the collection that inserting obj will walk, whatever
+    // the replica set's prefetch setting
+    void prefetchAllIndexPages(Collection* collection, const BSONObj& obj);
+
+    // find the record with obj's _id and ask the OS to read in its first page, unless it is
+    // in memory already; returns the record's location, or a null DiskLoc if there is none
+    DiskLoc prefetchRecordPages(Collection* collection, const BSONObj& obj);
 }
@@ -36,6 +36,7 @@
 #include "mongo/db/query/explain_plan.h"
 #include "mongo/db/query/plan_cache.h"
 #include "mongo/db/query/plan_executor.h"
+#include "mongo/db/query/qlog.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/type_explain.h"
 #include "mongo/db/structure/collection.h"
@@ -119,23 +120,24 @@ namespace mongo {
 
     void CachedPlanRunner::updateCache() {
         _updatedCache = true;
-#if 0
+
         Database* db = cc().database();
         verify(NULL != db);
         Collection* collection = db->getCollection(_canonicalQuery->ns());
         verify(NULL != collection);
         PlanCache* cache = collection->infoCache()->getPlanCache();
 
-        auto_ptr<CacheEntryFeedback> feedback(new CacheEntryFeedback());
+        std::auto_ptr<PlanCacheEntryFeedback> feedback(new PlanCacheEntryFeedback());
         // XXX: what else can we provide here?
         feedback->stats.reset(_exec->getStats());
-        Status fbs = cache->feedback(_solution->key, feedback.release());
 
+        // The cache may act on this: an entry that runs much worse than it did when it was
+        // picked is evicted, which makes the next query with its shape plan again.
+        Status fbs = cache->feedback(getPlanCacheKey(*_canonicalQuery), feedback.release());
         if (!fbs.isOK()) {
-            // XXX: probably not a warning, could happen.
-            warning() << "Failed to update cache: " << fbs.toString() << endl;
+            // The entry can be evicted or cleared while we run.
+            QLOG() << "Failed to update cache: " << fbs.toString() << endl;
         }
-#endif
     }
 
 } // namespace mongo
@@ -95,8 +95,6 @@ namespace mongo {
 
         // Have we updated the cache with our plan stats yet?
         bool _updatedCache;
-
-        // CacheKey _cacheKey;
     };
 
 }  // namespace mongo
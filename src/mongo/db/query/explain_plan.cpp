@@ -48,11 +48,79 @@ namespace mongo {
             }
         }
 
+        const char* stageTypeString(StageType stageType) {
+            switch (stageType) {
+            case STAGE_AND_HASH: return "AND_HASH";
+            case STAGE_AND_SORTED: return "AND_SORTED";
+            case STAGE_COLLSCAN: return "COLLSCAN";
+            case STAGE_COUNT: return "COUNT";
+            case STAGE_FETCH: return "FETCH";
+            case STAGE_GEO_2D: return "GEO_2D";
+            case STAGE_GEO_NEAR_2D: return "GEO_NEAR_2D";
+            case STAGE_GEO_NEAR_2DSPHERE: return "GEO_NEAR_2DSPHERE";
+            case STAGE_IXSCAN: return "IXSCAN";
+            case STAGE_LIMIT: return "LIMIT";
+            case STAGE_OR: return "OR";
+            case STAGE_PREFETCH: return "PREFETCH";
+            case STAGE_PROJECTION: return "PROJECTION";
+            case STAGE_SHARDING_FILTER: return "SHARDING_FILTER";
+            case STAGE_SKIP: return "SKIP";
+            case STAGE_SORT: return "SORT";
+            case STAGE_SORT_MERGE: return "SORT_MERGE";
+            case STAGE_TEXT: return "TEXT";
+            default: return "UNKNOWN";
+            }
+        }
+
+    }
+
+    void statsToBSON(const PlanStageStats& stats, BSONObjBuilder* bob) {
+        const CommonStats& common = stats.common;
+        bob->append("type", stageTypeString(stats.stageType));
+        // potential overflow because original counters are unsigned 64-bit values
+        bob->appendNumber("works", static_cast<long long>(common.works));
+        bob->appendNumber("advanced", static_cast<long long>(common.advanced));
+        bob->appendNumber("needTime", static_cast<long long>(common.needTime));
+        bob->appendNumber("needFetch", static_cast<long long>(common.needFetch));
+        bob->appendBool("isEOF", common.isEOF);
+
+        if (common.executionCycles > 0) {
+            uint64_t childCycles = 0;
+            for (size_t i = 0; i < stats.children.size(); ++i) {
+                childCycles += stats.children[i]->common.executionCycles;
+            }
+            bob->appendNumber("cycles", static_cast<long long>(common.executionCycles));
+            bob->appendNumber("selfCycles",
+                              static_cast<long long>(common.executionCycles > childCycles
+                                                     ? common.executionCycles - childCycles
+                                                     : 0));
+        }
+
+        if (STAGE_SORT == stats.stageType) {
+            const SortStats* sortStats = static_cast<const SortStats*>(stats.specific.get());
+            bob->appendNumber("memUsage", static_cast<long long>(sortStats->memUsage));
+        }
+        else if (STAGE_AND_HASH == stats.stageType) {
+            const AndHashStats* andStats = static_cast<const AndHashStats*>(stats.specific.get());
+            bob->appendNumber("memUsage", static_cast<long long>(andStats->memUsage));
+        }
+
+        BSONArrayBuilder children(bob->subarrayStart("children"));
+        for (size_t i = 0; i < stats.children.size(); ++i) {
+            BSONObjBuilder child(children.subobjStart());
+            statsToBSON(*stats.children[i], &child);
+        }
     }
 
     Status explainPlan(const PlanStageStats& stats, TypeExplain** explain, bool fullDetails) {
         auto_ptr<TypeExplain> res(new TypeExplain);
 
+        if (fullDetails) {
+            BSONObjBuilder statsBob;
+            statsToBSON(stats, &statsBob);
+            res->setStats(statsBob.obj());
+        }
+
         // Descend the plan looking for structural properties:
         // + is there any 'or's (TODO ands)? if so, prepare to explain each branch recursively
         // + is is a collection scan or a an index scan?
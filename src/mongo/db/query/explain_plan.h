@@ -46,10 +46,22 @@ namespace mongo {
      * 'nscannedObjectsAllPlans', 'nscannedAllPlans', 'scanAndOrder', 'indexOnly', 'nYields',
      * 'nChunkSkips', 'millis', 'allPlans', and 'oldPlan'.
      *
+     * With 'fullDetails' there is also 'stats', the tree statsToBSON() makes of 'stats'.
+     *
      * All these fields are documented in type_explain.h
      *
      * TODO: Currently, only working for single-leaf plans.
      */
     Status explainPlan(const PlanStageStats& stats, TypeExplain** explain, bool fullDetails);
 
+    /**
+     * Appends to 'bob' the type and counters of the root stage of 'stats' and, as 'children',
+     * the same for each of its children.  If the planStageTiming server parameter was on while
+     * the plan ran, 'cycles' is the time spent in a stage including its children and
+     * 'selfCycles' the time spent in the stage itself, which shows whether fetching, filtering
+     * or sorting dominates a slow query.  Stages that buffer results report the most bytes
+     * they held as 'memUsage'.
+     */
+    void statsToBSON(const PlanStageStats& stats, BSONObjBuilder* bob);
+
 } // namespace mongo
@@ -33,12 +33,16 @@
 #include "mongo/db/query/canonical_query.h"
 #include "mongo/db/query/eof_runner.h"
 #include "mongo/db/query/idhack_runner.h"
+#include "mongo/db/query/index_histogram.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/query/multi_plan_runner.h"
 #include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/plan_ranker.h"
+#include "mongo/db/query/planner_analysis.h"
 #include "mongo/db/query/qlog.h"
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/query/query_planner_common.h"
+#include "mongo/db/query/query_settings.h"
 #include "mongo/db/query/single_solution_runner.h"
 #include "mongo/db/query/stage_builder.h"
 #include "mongo/db/server_options.h"
@@ -47,7 +51,37 @@
 
 namespace mongo {
 
-    MONGO_EXPORT_SERVER_PARAMETER(enableIndexIntersection, bool, false);
+    MONGO_EXPORT_SERVER_PARAMETER(enableIndexIntersection, bool, true);
+
+    MONGO_EXPORT_SERVER_PARAMETER(enableIndexSkipScan, bool, false);
+
+    MONGO_EXPORT_SERVER_PARAMETER(enableCostBasedPlanSelection, bool, false);
+
+    MONGO_EXPORT_SERVER_PARAMETER(enableUniqueIndexLookup, bool, true);
+
+    /**
+     * Try to pick one of 'solutions' from index histograms instead of racing them.
+     */
+    static bool pickSolutionByCost(Collection* collection,
+                                   const vector<QuerySolution*>& solutions,
+                                   size_t* out) {
+        // Keeps the histograms alive while they're used.
+        vector<boost::shared_ptr<const IndexHistogram> > held;
+        IndexHistograms histograms;
+
+        IndexCatalog::IndexIterator ii = collection->getIndexCatalog()->getIndexIterator(false);
+        while (ii.more()) {
+            IndexDescriptor* desc = ii.next();
+            boost::shared_ptr<const IndexHistogram> histogram =
+                collection->infoCache()->getIndexHistogram(desc);
+            if (!histogram) { continue; }
+            held.push_back(histogram);
+            histograms.push_back(std::make_pair(desc->keyPattern(), histogram.get()));
+        }
+
+        return PlanRanker::pickByCost(solutions, histograms,
+                                      static_cast<double>(collection->numRecords()), out);
+    }
 
     // Copied verbatim from queryutil.cpp.
     static bool isSimpleIdQuery(const BSONObj& query) {
@@ -85,6 +119,81 @@ namespace mongo {
             && !query.getParsed().hasOption(QueryOption_CursorTailable);
     }
 
+    /**
+     * Is 'query' an equality on one field whose value only the one index key equal to it can
+     * match?  If so, sets 'fieldOut' to that field.  A regex matches more than itself, a null
+     * also matches a missing field, and an array also matches its elements, so those don't count.
+     */
+    static bool isSimplePointQuery(const BSONObj& query, StringData* fieldOut) {
+        BSONObjIterator it(query);
+        if (!it.more()) { return false; }
+
+        BSONElement elt = it.next();
+        if (it.more()) { return false; }
+
+        // Not a top-level operator such as $where.
+        if ('$' == elt.fieldName()[0]) { return false; }
+
+        switch (elt.type()) {
+        case RegEx:
+        case jstNULL:
+        case Undefined:
+        case Array:
+            return false;
+        case Object:
+            // Not something like { a : { $gt : ...
+            if ('$' == elt.Obj().firstElementFieldName()[0]) { return false; }
+            break;
+        default:
+            if (!elt.isSimpleType() && BinData != elt.type()) { return false; }
+        }
+
+        *fieldOut = elt.fieldNameStringData();
+        return true;
+    }
+
+    /**
+     * If 'query' is an equality on the one field of a unique, non-sparse btree index in
+     * 'indices', returns that index's key pattern.  Such a query finds at most one document with
+     * a single btree lookup, so it needn't be planned.  Otherwise returns an empty object.
+     */
+    static BSONObj getUniqueIndexForPointQuery(Collection* collection,
+                                               const CanonicalQuery& query,
+                                               const vector<IndexEntry>& indices) {
+        const LiteParsedQuery& pq = query.getParsed();
+        if (pq.isExplain() || pq.showDiskLoc() || pq.returnKey()
+            || pq.hasOption(QueryOption_CursorTailable)
+            || 0 != pq.getSkip()
+            || !pq.getHint().isEmpty() || !pq.getMin().isEmpty() || !pq.getMax().isEmpty()) {
+            return BSONObj();
+        }
+
+        StringData field;
+        if (!isSimplePointQuery(pq.getFilter(), &field)) {
+            return BSONObj();
+        }
+
+        for (size_t i = 0; i < indices.size(); ++i) {
+            const IndexEntry& entry = indices[i];
+            if (entry.sparse || 1 != entry.keyPattern.nFields()) {
+                continue;
+            }
+
+            BSONElement keyElt = entry.keyPattern.firstElement();
+            if (field != keyElt.fieldNameStringData() || !keyElt.isNumber()) {
+                continue;
+            }
+
+            IndexDescriptor* desc =
+                collection->getIndexCatalog()->findIndexByKeyPattern(entry.keyPattern);
+            if (NULL != desc && desc->unique()) {
+                return entry.keyPattern;
+            }
+        }
+
+        return BSONObj();
+    }
+
     /**
      * For a given query, get a runner.  The runner could be a SingleSolutionRunner, a
      * CachedQueryRunner, or a MultiPlanRunner, depending on the cache/query solver/etc.
@@ -118,7 +227,34 @@ namespace mongo {
             plannerParams.indices.push_back(IndexEntry(desc->keyPattern(),
                                                        desc->isMultikey(),
                                                        desc->isSparse(),
-                                                       desc->indexName()));
+                                                       desc->indexName(),
+                                                       desc->multikeyFields(),
+                                                       desc->infoObj()));
+        }
+
+        // An admin may have restricted the indexes that queries of this shape can use.  As with
+        // the plan cache, a hint, min or max takes precedence.
+        if (shouldCacheQuery(*canonicalQuery)) {
+            vector<BSONObj> allowedIndexKeyPatterns;
+            QuerySettings* querySettings = collection->infoCache()->getQuerySettings();
+            if (querySettings->getAllowedIndices(getPlanCacheKey(*canonicalQuery),
+                                                 &allowedIndexKeyPatterns)) {
+                QuerySettings::filterAllowedIndexEntries(allowedIndexKeyPatterns,
+                                                         &plannerParams.indices);
+                QLOG() << "index filter restricts query to " << plannerParams.indices.size()
+                       << " of the collection's indexes" << endl;
+            }
+        }
+
+        // An equality on the field of a unique index finds at most one document.  Look it up
+        // directly, like the idhack does for _id.
+        if (enableUniqueIndexLookup) {
+            BSONObj uniqueKeyPattern = getUniqueIndexForPointQuery(collection, *canonicalQuery,
+                                                                   plannerParams.indices);
+            if (!uniqueKeyPattern.isEmpty()) {
+                *out = new IDHackRunner(collection, canonicalQuery.release(), uniqueKeyPattern);
+                return Status::OK();
+            }
         }
 
         // Tailable: If the query requests tailable the collection must be capped.
@@ -177,11 +313,16 @@ namespace mongo {
         // TODO: Can the cache have negative data about a solution?
         CachedSolution* rawCS;
         if (collection->infoCache()->getPlanCache()->get(*canonicalQuery, &rawCS).isOK()) {
-            // We have a CachedSolution.  Have the planner turn it into a QuerySolution.
-            QuerySolution *qs;
-            Status status = QueryPlanner::planFromCache(*canonicalQuery, plannerParams, rawCS, &qs);
-            if (status.isOK()) {
-                // XXX: create new CachedSolutionRunner here.
+            auto_ptr<CachedSolution> cs(rawCS);
+            // The cache only records query shapes so far; entries carry no planner data yet.
+            if (NULL != cs->plannerData) {
+                // We have a CachedSolution.  Have the planner turn it into a QuerySolution.
+                QuerySolution *qs;
+                Status status = QueryPlanner::planFromCache(*canonicalQuery, plannerParams,
+                                                            cs.get(), &qs);
+                if (status.isOK()) {
+                    // XXX: create new CachedSolutionRunner here.
+                }
             }
         }
 
@@ -189,6 +330,10 @@ namespace mongo {
             plannerParams.options |= QueryPlannerParams::INDEX_INTERSECTION;
         }
 
+        if (enableIndexSkipScan) {
+            plannerParams.options |= QueryPlannerParams::INDEX_SKIP_SCAN;
+        }
+
         vector<QuerySolution*> solutions;
         Status status = QueryPlanner::plan(*canonicalQuery, plannerParams, &solutions);
         if (!status.isOK()) {
@@ -210,6 +355,27 @@ namespace mongo {
                           " No query solutions");
         }
 
+        // A count that an index answers by itself doesn't need to look at documents, so just
+        // count keys with the first such plan.
+        if (plannerParams.options & QueryPlannerParams::PRIVATE_IS_COUNT) {
+            for (size_t i = 0; i < solutions.size(); ++i) {
+                if (QueryPlannerAnalysis::turnIxscanIntoCount(solutions[i])) {
+                    for (size_t j = 0; j < solutions.size(); ++j) {
+                        if (j != i) {
+                            delete solutions[j];
+                        }
+                    }
+
+                    WorkingSet* ws;
+                    PlanStage* root;
+                    verify(StageBuilder::build(*solutions[i], &root, &ws));
+                    *out = new SingleSolutionRunner(canonicalQuery.release(), solutions[i],
+                                                    root, ws);
+                    return Status::OK();
+                }
+            }
+        }
+
         if (1 == solutions.size()) {
             // Only one possible plan.  Run it.  Build the stages from the solution.
             WorkingSet* ws;
@@ -221,6 +387,24 @@ namespace mongo {
             return Status::OK();
         }
         else {
+            // The histograms may tell us the best plan without having to race for it.
+            size_t cheapest;
+            if (enableCostBasedPlanSelection
+                && pickSolutionByCost(collection, solutions, &cheapest)) {
+                for (size_t i = 0; i < solutions.size(); ++i) {
+                    if (i != cheapest) {
+                        delete solutions[i];
+                    }
+                }
+
+                WorkingSet* ws;
+                PlanStage* root;
+                verify(StageBuilder::build(*solutions[cheapest], &root, &ws));
+                *out = new SingleSolutionRunner(canonicalQuery.release(), solutions[cheapest],
+                                                root, ws);
+                return Status::OK();
+            }
+
             // Many solutions.  Let the MultiPlanRunner pick the best, update the cache, and so on.
             auto_ptr<MultiPlanRunner> mpr(new MultiPlanRunner(canonicalQuery.release()));
             for (size_t i = 0; i < solutions.size(); ++i) {
@@ -48,6 +48,14 @@ namespace mongo {
           _killed(false),
           _done(false) { }
 
+    IDHackRunner::IDHackRunner(Collection* collection, CanonicalQuery* query,
+                               const BSONObj& indexKeyPattern)
+        : _collection(collection),
+          _query(query),
+          _indexKeyPattern(indexKeyPattern.getOwned()),
+          _killed(false),
+          _done(false) { }
+
     IDHackRunner::~IDHackRunner() { }
 
     Runner::RunnerState IDHackRunner::getNext(BSONObj* objOut, DiskLoc* dlOut) {
@@ -58,7 +66,9 @@ namespace mongo {
         IndexCatalog* catalog = _collection->getIndexCatalog();
 
         // Find the index we use.
-        IndexDescriptor* idDesc = catalog->findIdIndex();
+        IndexDescriptor* idDesc = _indexKeyPattern.isEmpty()
+                                  ? catalog->findIdIndex()
+                                  : catalog->findIndexByKeyPattern(_indexKeyPattern);
         if (NULL == idDesc) {
             _done = true;
             return Runner::RUNNER_EOF;
@@ -83,8 +93,9 @@ namespace mongo {
             return Runner::RUNNER_EOF;
         }
 
-        // Set out parameters and note that we're done w/lookup.
-        if (NULL != objOut) {
+        // Set out parameters and note that we're done w/lookup.  Outside of _id we check the
+        // document against the query, so we need it either way.
+        if (NULL != objOut || !_indexKeyPattern.isEmpty()) {
             Record* record = loc.rec();
 
             // If the record isn't in memory...
@@ -105,26 +116,36 @@ namespace mongo {
             }
 
             // Either the data was in memory or we paged it in.
-            *objOut = loc.obj();
+            BSONObj obj = loc.obj();
+
+            // The key matched, but the query may still be pickier than the index about what is
+            // equal.
+            if (!_indexKeyPattern.isEmpty() && !_query->root()->matchesBSON(obj)) {
+                return Runner::RUNNER_EOF;
+            }
 
             // If we're sharded make sure the key belongs to us.  We need the object to do this.
             if (shardingState.needCollectionMetadata(_query->ns())) {
                 CollectionMetadataPtr m = shardingState.getCollectionMetadata(_query->ns());
                 if (m) {
                     KeyPattern kp(m->getKeyPattern());
-                    if (!m->keyBelongsToMe( kp.extractSingleKey(*objOut))) {
+                    if (!m->keyBelongsToMe( kp.extractSingleKey(obj))) {
                         // We have something with a matching _id but it doesn't belong to me.
                         return Runner::RUNNER_EOF;
                     }
                 }
             }
 
-            // If there is a projection...
-            if (NULL != _query->getProj()) {
-                // Create something to execute it.
-                auto_ptr<ProjectionExec> projExec(new ProjectionExec(_query->getParsed().getProj(),
-                                                                     _query->root()));
-                projExec->transform(*objOut, objOut);
+            if (NULL != objOut) {
+                *objOut = obj;
+
+                // If there is a projection...
+                if (NULL != _query->getProj()) {
+                    // Create something to execute it.
+                    auto_ptr<ProjectionExec> projExec(
+                        new ProjectionExec(_query->getParsed().getProj(), _query->root()));
+                    projExec->transform(*objOut, objOut);
+                }
             }
         }
 
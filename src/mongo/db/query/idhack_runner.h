@@ -33,11 +33,11 @@
 
 #include "mongo/base/status.h"
 #include "mongo/db/diskloc.h"
+#include "mongo/db/jsobj.h"
 #include "mongo/db/query/runner.h"
 
 namespace mongo {
 
-    class BSONObj;
     class CanonicalQuery;
     class Collection;
     class DiskLoc;
@@ -45,13 +45,22 @@ namespace mongo {
     class TypeExplain;
 
     /**
+     * Answers a query that pins down at most one document through a unique index, by looking
+     * the key up in the btree and fetching what it points to.  No planning is involved.
      */
     class IDHackRunner : public Runner {
     public:
 
-        /** Takes ownership of all the arguments. */
+        /** Looks up the _id the query asks for.  Takes ownership of 'query'. */
         IDHackRunner(Collection* collection, CanonicalQuery* query);
 
+        /**
+         * Looks up the value the query asks for in the unique single-field index
+         * 'indexKeyPattern'.  Takes ownership of 'query'.
+         */
+        IDHackRunner(Collection* collection, CanonicalQuery* query,
+                     const BSONObj& indexKeyPattern);
+
         virtual ~IDHackRunner();
 
         Runner::RunnerState getNext(BSONObj* objOut, DiskLoc* dlOut);
@@ -82,6 +91,9 @@ namespace mongo {
         // this.
         boost::scoped_ptr<CanonicalQuery> _query;
 
+        // The unique index we look the key up in.  Empty for the _id index.
+        BSONObj _indexKeyPattern;
+
         // Are we allowed to release the lock?
         Runner::YieldPolicy _policy;
 
@@ -210,6 +210,106 @@ namespace mongo {
         return !it.more();
     }
 
+    //
+    // Splitting bounds into key ranges
+    //
+
+    namespace {
+
+        bool isAllValues(const Interval& ival) {
+            if (!ival.startInclusive || !ival.endInclusive) {
+                return false;
+            }
+            return (MinKey == ival.start.type() && MaxKey == ival.end.type())
+                || (MaxKey == ival.start.type() && MinKey == ival.end.type());
+        }
+
+        bool allPoints(const OrderedIntervalList& oil) {
+            for (size_t i = 0; i < oil.intervals.size(); ++i) {
+                if (!oil.intervals[i].isPoint()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    }  // namespace
+
+    bool IndexBounds::toKeyRanges(size_t maxRanges, vector<IndexKeyRange>* out) const {
+        out->clear();
+        if (isSimpleRange) {
+            return false;
+        }
+
+        // Fields [0, rangeField) are points, rangeField is anything and the rest take all values.
+        size_t rangeField = 0;
+        while (rangeField < fields.size() && allPoints(fields[rangeField])) {
+            ++rangeField;
+        }
+        for (size_t i = rangeField + 1; i < fields.size(); ++i) {
+            if (1 != fields[i].intervals.size() || !isAllValues(fields[i].intervals[0])) {
+                return false;
+            }
+        }
+
+        // How many ranges is that?  Every combination of an interval from each of the fields
+        // up to and including rangeField.
+        const size_t combined = std::min(rangeField + 1, fields.size());
+        size_t numRanges = 1;
+        for (size_t i = 0; i < combined; ++i) {
+            numRanges *= fields[i].intervals.size();
+            if (numRanges > maxRanges) {
+                return false;
+            }
+        }
+
+        // Walk the combinations in index order, the last combined field changing fastest.
+        vector<size_t> pos(combined, 0);
+        for (size_t n = 0; n < numRanges; ++n) {
+            const Interval* range = (rangeField < fields.size())
+                                    ? &fields[rangeField].intervals[pos[rangeField]]
+                                    : NULL;
+
+            IndexKeyRange keyRange;
+            keyRange.startKeyInclusive = (NULL == range) || range->startInclusive;
+            keyRange.endKeyInclusive = (NULL == range) || range->endInclusive;
+
+            // If the start is exclusive we have to start after all the keys that share it, so
+            // the fields that take all values start from their end, and vice versa.
+            BSONObjBuilder startBob;
+            BSONObjBuilder endBob;
+            for (size_t i = 0; i < fields.size(); ++i) {
+                if (i < rangeField) {
+                    const BSONElement& point = fields[i].intervals[pos[i]].start;
+                    startBob.appendAs(point, "");
+                    endBob.appendAs(point, "");
+                }
+                else if (i == rangeField) {
+                    startBob.appendAs(range->start, "");
+                    endBob.appendAs(range->end, "");
+                }
+                else {
+                    const Interval& all = fields[i].intervals[0];
+                    startBob.appendAs(keyRange.startKeyInclusive ? all.start : all.end, "");
+                    endBob.appendAs(keyRange.endKeyInclusive ? all.end : all.start, "");
+                }
+            }
+            keyRange.startKey = startBob.obj();
+            keyRange.endKey = endBob.obj();
+            out->push_back(keyRange);
+
+            // Next combination.
+            for (size_t i = combined; i > 0; --i) {
+                if (++pos[i - 1] < fields[i - 1].intervals.size()) {
+                    break;
+                }
+                pos[i - 1] = 0;
+            }
+        }
+
+        return true;
+    }
+
     //
     // Iteration over index bounds
     //
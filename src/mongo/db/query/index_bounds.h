@@ -53,6 +53,17 @@ namespace mongo {
         std::string toString() const;
     };
 
+    /**
+     * One contiguous stretch of an index, from startKey to endKey in index order.  The keys have
+     * empty field names, like the keys stored in the index.
+     */
+    struct IndexKeyRange {
+        BSONObj startKey;
+        bool startKeyInclusive;
+        BSONObj endKey;
+        bool endKeyInclusive;
+    };
+
     /**
      * Tied to an index.  Permissible values for all fields in the index.  Requires the index to
      * interpret.  Previously known as FieldRangeVector.
@@ -74,6 +85,16 @@ namespace mongo {
         // We can traverse this backwards if indexed descending.
         bool isValidFor(const BSONObj& keyPattern, int direction);
 
+        /**
+         * If the keys within these bounds are those of at most 'maxRanges' contiguous ranges of
+         * the index, put the ranges in index order into *out and return true.  That is the case
+         * when a (possibly empty) prefix of the fields are all points, followed by at most one
+         * field with any intervals, and every field after that takes all values.
+         *
+         * The bounds must be oriented for a forward traversal.  Simple ranges are not handled.
+         */
+        bool toKeyRanges(size_t maxRanges, vector<IndexKeyRange>* out) const;
+
         // Methods below used for debugging purpose only. Do not use outside testing code.
         size_t size() const;
         std::string getFieldName(size_t i) const;
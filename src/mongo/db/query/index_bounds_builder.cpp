@@ -179,17 +179,19 @@ namespace mongo {
 
     // static
     void IndexBoundsBuilder::translateAndIntersect(const MatchExpression* expr, const BSONElement& elt,
-                                                   OrderedIntervalList* oilOut, BoundsTightness* tightnessOut) {
+                                                   OrderedIntervalList* oilOut, BoundsTightness* tightnessOut,
+                                                   const BSONObj& indexInfo) {
         OrderedIntervalList arg;
-        translate(expr, elt, &arg, tightnessOut);
+        translate(expr, elt, &arg, tightnessOut, indexInfo);
         // translate outputs arg in sorted order.  intersectize assumes that its arguments are sorted.
         intersectize(arg, oilOut);
     }
 
     // static
     void IndexBoundsBuilder::translateAndUnion(const MatchExpression* expr, const BSONElement& elt,
-                                               OrderedIntervalList* oilOut, BoundsTightness* tightnessOut) {
-        translate(expr, elt, oilOut, tightnessOut);
+                                               OrderedIntervalList* oilOut, BoundsTightness* tightnessOut,
+                                               const BSONObj& indexInfo) {
+        translate(expr, elt, oilOut, tightnessOut, indexInfo);
         unionize(oilOut);
     }
 
@@ -204,11 +206,13 @@ namespace mongo {
 
     // static
     void IndexBoundsBuilder::translate(const MatchExpression* expr, const BSONElement& elt,
-                                       OrderedIntervalList* oilOut, BoundsTightness* tightnessOut) {
+                                       OrderedIntervalList* oilOut, BoundsTightness* tightnessOut,
+                                       const BSONObj& indexInfo) {
         oilOut->name = elt.fieldName();
 
         bool isHashed = false;
-        if (mongoutils::str::equals("hashed", elt.valuestrsafe())) {
+        if (mongoutils::str::equals("hashed", elt.valuestrsafe())
+            || mongoutils::str::equals("hashtable", elt.valuestrsafe())) {
             isHashed = true;
         }
 
@@ -219,12 +223,12 @@ namespace mongo {
 
         if (MatchExpression::ELEM_MATCH_VALUE == expr->matchType()) {
             OrderedIntervalList acc;
-            translate(expr->getChild(0), elt, &acc, tightnessOut);
+            translate(expr->getChild(0), elt, &acc, tightnessOut, indexInfo);
 
             for (size_t i = 1; i < expr->numChildren(); ++i) {
                 OrderedIntervalList next;
                 BoundsTightness tightness;
-                translate(expr->getChild(i), elt, &next, &tightness);
+                translate(expr->getChild(i), elt, &next, &tightness, indexInfo);
                 intersectize(next, &acc);
             }
 
@@ -427,7 +431,7 @@ namespace mongo {
             }
 
             const S2Region& region = gme->getGeoQuery().getRegion();
-            ExpressionMapping::cover2dsphere(region, oilOut);
+            ExpressionMapping::cover2dsphere(region, indexInfo, oilOut);
             *tightnessOut = IndexBoundsBuilder::INEXACT_FETCH;
         }
         else {
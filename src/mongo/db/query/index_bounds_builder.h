@@ -64,23 +64,29 @@ namespace mongo {
          *
          * The expression must be a predicate over one field.  That is, expr->isLeaf() or
          * expr->isArray() must be true, and expr->isLogical() must be false.  
+         *
+         * 'indexInfo' is the spec of the index, which decides how a 2dsphere index keys its
+         * cells; without it they're taken to be keyed as in S2_INDEX_VERSION_1.
          */
         static void translate(const MatchExpression* expr, const BSONElement& elt,
-                              OrderedIntervalList* oilOut, BoundsTightness* tightnessOut);
+                              OrderedIntervalList* oilOut, BoundsTightness* tightnessOut,
+                              const BSONObj& indexInfo = BSONObj());
 
         /**
          * Creates bounds for 'expr' (indexed according to 'elt').  Intersects those bounds
          * with the bounds in oilOut, which is an in/out parameter.
          */
         static void translateAndIntersect(const MatchExpression* expr, const BSONElement& elt,
-                                          OrderedIntervalList* oilOut, BoundsTightness* tightnessOut);
+                                          OrderedIntervalList* oilOut, BoundsTightness* tightnessOut,
+                                          const BSONObj& indexInfo = BSONObj());
 
         /**
          * Creates bounds for 'expr' (indexed according to 'elt').  Unions those bounds
          * with the bounds in oilOut, which is an in/out parameter.
          */
         static void translateAndUnion(const MatchExpression* expr, const BSONElement& elt,
-                                      OrderedIntervalList* oilOut, BoundsTightness* tightnessOut);
+                                      OrderedIntervalList* oilOut, BoundsTightness* tightnessOut,
+                                      const BSONObj& indexInfo = BSONObj());
 
         /**
          * Make a range interval from the provided object.
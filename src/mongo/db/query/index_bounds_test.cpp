@@ -586,4 +586,66 @@ namespace {
         ASSERT(movePastKeyElts);
     }
 
+    //
+    // Key ranges
+    //
+
+    TEST(IndexBoundsTest, KeyRangesPointsThenRange) {
+        OrderedIntervalList aList("a");
+        aList.intervals.push_back(Interval(BSON("" << 1 << "" << 1), true, true));
+        aList.intervals.push_back(Interval(BSON("" << 2 << "" << 2), true, true));
+        OrderedIntervalList bList("b");
+        bList.intervals.push_back(Interval(BSON("" << 5 << "" << 10), false, true));
+        OrderedIntervalList cList("c");
+        cList.intervals.push_back(Interval(BSON("" << MINKEY << "" << MAXKEY), true, true));
+        IndexBounds bounds;
+        bounds.fields.push_back(aList);
+        bounds.fields.push_back(bList);
+        bounds.fields.push_back(cList);
+
+        vector<IndexKeyRange> ranges;
+        ASSERT(bounds.toKeyRanges(10, &ranges));
+        ASSERT_EQUALS(ranges.size(), 2U);
+
+        // The start is exclusive so it has to be past every c for b = 5.
+        ASSERT_EQUALS(ranges[0].startKey, BSON("" << 1 << "" << 5 << "" << MAXKEY));
+        ASSERT_FALSE(ranges[0].startKeyInclusive);
+        ASSERT_EQUALS(ranges[0].endKey, BSON("" << 1 << "" << 10 << "" << MAXKEY));
+        ASSERT(ranges[0].endKeyInclusive);
+        ASSERT_EQUALS(ranges[1].startKey, BSON("" << 2 << "" << 5 << "" << MAXKEY));
+        ASSERT_EQUALS(ranges[1].endKey, BSON("" << 2 << "" << 10 << "" << MAXKEY));
+
+        // Too many.
+        ASSERT_FALSE(bounds.toKeyRanges(1, &ranges));
+    }
+
+    TEST(IndexBoundsTest, KeyRangesAllPoints) {
+        OrderedIntervalList aList("a");
+        aList.intervals.push_back(Interval(BSON("" << 3 << "" << 3), true, true));
+        IndexBounds bounds;
+        bounds.fields.push_back(aList);
+
+        vector<IndexKeyRange> ranges;
+        ASSERT(bounds.toKeyRanges(1, &ranges));
+        ASSERT_EQUALS(ranges.size(), 1U);
+        ASSERT_EQUALS(ranges[0].startKey, BSON("" << 3));
+        ASSERT_EQUALS(ranges[0].endKey, BSON("" << 3));
+        ASSERT(ranges[0].startKeyInclusive);
+        ASSERT(ranges[0].endKeyInclusive);
+    }
+
+    TEST(IndexBoundsTest, KeyRangesNotContiguous) {
+        // b is restricted after a range on a, so the keys are not one stretch of the index.
+        OrderedIntervalList aList("a");
+        aList.intervals.push_back(Interval(BSON("" << 1 << "" << 4), true, true));
+        OrderedIntervalList bList("b");
+        bList.intervals.push_back(Interval(BSON("" << 0 << "" << 3), true, true));
+        IndexBounds bounds;
+        bounds.fields.push_back(aList);
+        bounds.fields.push_back(bList);
+
+        vector<IndexKeyRange> ranges;
+        ASSERT_FALSE(bounds.toKeyRanges(10, &ranges));
+    }
+
 }  // namespace
@@ -39,24 +39,44 @@ namespace mongo {
      * This name sucks, but every name involving 'index' is used somewhere.
      */
     struct IndexEntry {
-        IndexEntry(const BSONObj& kp, bool mk, bool sp, const string& n)
-            : keyPattern(kp), multikey(mk), sparse(sp), name(n) { }
+        IndexEntry(const BSONObj& kp, bool mk, bool sp, const string& n,
+                   unsigned mkFields = ~0u, const BSONObj& io = BSONObj())
+            : keyPattern(kp), multikey(mk), multikeyFields(mkFields), sparse(sp), name(n),
+              infoObj(io) { }
 
         IndexEntry(const IndexEntry& other) {
             keyPattern = other.keyPattern;
             multikey = other.multikey;
+            multikeyFields = other.multikeyFields;
             sparse = other.sparse;
             name = other.name;
+            infoObj = other.infoObj;
+        }
+
+        /**
+         * May field 'pos' of the key pattern have more than one value in a document?  Bounds on
+         * the others can be intersected and compounded, and they can cover, even if the index
+         * is multikey.
+         */
+        bool isMultikeyField(size_t pos) const {
+            return multikey && (pos >= 31 || (multikeyFields & (1u << pos)));
         }
 
         BSONObj keyPattern;
 
         bool multikey;
 
+        // If multikey, bit i is set if field i may have more than one value in a document.
+        unsigned multikeyFields;
+
         bool sparse;
 
         string name;
 
+        // The whole index spec, for options of the access method such as how a 2dsphere index
+        // keys its cells.
+        BSONObj infoObj;
+
         std::string toString() const {
             stringstream ss;
             ss << keyPattern.toString();
@@ -0,0 +1,232 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/query/index_histogram.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+    using namespace mongo;
+
+    bool valueLessThan(const BSONObj& lhs, const BSONObj& rhs) {
+        return lhs.firstElement().woCompare(rhs.firstElement(), false) < 0;
+    }
+
+    /**
+     * An interval ordered from low to high, whichever way the index bounds had it.
+     */
+    struct Range {
+        Range(const Interval& interval) {
+            if (interval.start.woCompare(interval.end, false) <= 0) {
+                low = interval.start;
+                lowInclusive = interval.startInclusive;
+                high = interval.end;
+                highInclusive = interval.endInclusive;
+            }
+            else {
+                low = interval.end;
+                lowInclusive = interval.endInclusive;
+                high = interval.start;
+                highInclusive = interval.startInclusive;
+            }
+        }
+
+        bool contains(const BSONElement& value) const {
+            int cmpLow = value.woCompare(low, false);
+            if (cmpLow < 0 || (0 == cmpLow && !lowInclusive)) { return false; }
+            int cmpHigh = value.woCompare(high, false);
+            if (cmpHigh > 0 || (0 == cmpHigh && !highInclusive)) { return false; }
+            return true;
+        }
+
+        bool isPoint() const {
+            return lowInclusive && highInclusive && 0 == low.woCompare(high, false);
+        }
+
+        BSONElement low;
+        bool lowInclusive;
+        BSONElement high;
+        bool highInclusive;
+    };
+
+}  // namespace
+
+namespace mongo {
+
+    //
+    // Builder
+    //
+
+    IndexHistogram::Builder::Builder(size_t numBuckets)
+        : _numBuckets(std::max(static_cast<size_t>(1), numBuckets)) { }
+
+    void IndexHistogram::Builder::add(const BSONElement& leadingValue) {
+        BSONObjBuilder bob;
+        bob.appendAs(leadingValue, "");
+        _values.push_back(bob.obj());
+    }
+
+    IndexHistogram* IndexHistogram::Builder::done() {
+        IndexHistogram* histogram = new IndexHistogram();
+        histogram->_numKeys = _values.size();
+        if (_values.empty()) {
+            return histogram;
+        }
+
+        std::sort(_values.begin(), _values.end(), valueLessThan);
+        histogram->_min = _values.front();
+
+        const size_t depth = (_values.size() + _numBuckets - 1) / _numBuckets;
+        Bucket bucket;
+        bucket.count = 0;
+        bucket.distinct = 0;
+        for (size_t i = 0; i < _values.size(); ++i) {
+            if (0 == bucket.count || valueLessThan(_values[i - 1], _values[i])) {
+                ++bucket.distinct;
+            }
+            ++bucket.count;
+
+            // Close the bucket once it is deep enough, but never between two equal values.
+            bool last = (i + 1 == _values.size());
+            if (last || (bucket.count >= static_cast<long long>(depth)
+                         && valueLessThan(_values[i], _values[i + 1]))) {
+                bucket.upper = _values[i];
+                histogram->_buckets.push_back(bucket);
+                bucket.count = 0;
+                bucket.distinct = 0;
+            }
+        }
+
+        _values.clear();
+        return histogram;
+    }
+
+    //
+    // IndexHistogram
+    //
+
+    double IndexHistogram::estimate(const Interval& interval) const {
+        if (_buckets.empty()) {
+            return 0;
+        }
+
+        Range range(interval);
+        bool point = range.isPoint();
+
+        double total = 0;
+        for (size_t i = 0; i < _buckets.size(); ++i) {
+            const Bucket& bucket = _buckets[i];
+            BSONElement upper = bucket.upper.firstElement();
+            BSONElement lower = (0 == i) ? _min.firstElement()
+                                         : _buckets[i - 1].upper.firstElement();
+            bool lowerInclusive = (0 == i);
+
+            // Entirely below the range: keep going.
+            int cmpUpperLow = upper.woCompare(range.low, false);
+            if (cmpUpperLow < 0 || (0 == cmpUpperLow && !range.lowInclusive)) {
+                continue;
+            }
+
+            // Entirely above the range: done.
+            int cmpLowerHigh = lower.woCompare(range.high, false);
+            if (cmpLowerHigh > 0
+                || (0 == cmpLowerHigh && !(lowerInclusive && range.highInclusive))) {
+                break;
+            }
+
+            if (point) {
+                // The average number of keys per value of the one bucket that may hold it.
+                return static_cast<double>(bucket.count) / bucket.distinct;
+            }
+
+            if (1 == bucket.distinct) {
+                // Its only value is the upper bound.
+                if (range.contains(upper)) {
+                    total += bucket.count;
+                }
+                continue;
+            }
+
+            int cmpLowerLow = lower.woCompare(range.low, false);
+            bool startsInside = cmpLowerLow > 0
+                             || (0 == cmpLowerLow && (range.lowInclusive || !lowerInclusive));
+            int cmpUpperHigh = upper.woCompare(range.high, false);
+            bool endsInside = cmpUpperHigh < 0 || (0 == cmpUpperHigh && range.highInclusive);
+
+            if (startsInside && endsInside) {
+                total += bucket.count;
+            }
+            else {
+                // Partial overlap.  Assume half, but at least one value's worth.
+                total += std::max(static_cast<double>(bucket.count) / 2,
+                                  static_cast<double>(bucket.count) / bucket.distinct);
+            }
+        }
+
+        return total;
+    }
+
+    double IndexHistogram::estimate(const OrderedIntervalList& oil) const {
+        double total = 0;
+        for (size_t i = 0; i < oil.intervals.size(); ++i) {
+            total += estimate(oil.intervals[i]);
+        }
+        return std::min(total, static_cast<double>(_numKeys));
+    }
+
+    long long IndexHistogram::numDistinct() const {
+        long long distinct = 0;
+        for (size_t i = 0; i < _buckets.size(); ++i) {
+            distinct += _buckets[i].distinct;
+        }
+        return distinct;
+    }
+
+    size_t IndexHistogram::bytes() const {
+        size_t bytes = sizeof(IndexHistogram) + _min.objsize()
+                     + _buckets.capacity() * sizeof(Bucket);
+        for (size_t i = 0; i < _buckets.size(); ++i) {
+            bytes += _buckets[i].upper.objsize();
+        }
+        return bytes;
+    }
+
+    std::string IndexHistogram::toString() const {
+        std::stringstream ss;
+        ss << "keys: " << _numKeys << " distinct: " << numDistinct()
+           << " min: " << _min.toString() << " buckets:";
+        for (size_t i = 0; i < _buckets.size(); ++i) {
+            ss << " (" << _buckets[i].upper.firstElement().toString(false) << ", "
+               << _buckets[i].count << ", " << _buckets[i].distinct << ")";
+        }
+        return ss.str();
+    }
+
+}  // namespace mongo
@@ -0,0 +1,122 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/query/index_bounds.h"
+
+namespace mongo {
+
+    /**
+     * An equi-depth histogram over the values of the leading field of an index: each bucket
+     * covers about the same number of keys, and knows how many distinct values it holds, so
+     * the number of keys within an interval of the leading field can be estimated without
+     * reading the index.
+     *
+     * Immutable once built; built by IndexHistogram::Builder from the keys of the index.
+     */
+    class IndexHistogram {
+    public:
+        /**
+         * Collects the leading values of an index's keys, in any order, and partitions them.
+         */
+        class Builder {
+        public:
+            explicit Builder(size_t numBuckets);
+
+            /**
+             * Add the leading field of one index key.
+             */
+            void add(const BSONElement& leadingValue);
+
+            /**
+             * Number of values added so far.
+             */
+            size_t numKeys() const { return _values.size(); }
+
+            /**
+             * Build the histogram.  Caller owns it.  The builder is left empty.
+             */
+            IndexHistogram* done();
+
+        private:
+            size_t _numBuckets;
+            std::vector<BSONObj> _values;
+        };
+
+        /**
+         * One bucket: the keys whose leading value is above the upper bound of the previous
+         * bucket (or at least 'min' for the first) and at most 'upper'.  No value is split
+         * across two buckets.
+         */
+        struct Bucket {
+            BSONObj upper;
+            long long count;
+            long long distinct;
+        };
+
+        /**
+         * Estimated number of keys whose leading value is in 'interval'.  The interval may be
+         * in either direction.
+         */
+        double estimate(const Interval& interval) const;
+
+        /**
+         * Estimated number of keys whose leading value is in any of the intervals in 'oil'.
+         */
+        double estimate(const OrderedIntervalList& oil) const;
+
+        long long numKeys() const { return _numKeys; }
+
+        /**
+         * Number of distinct leading values.
+         */
+        long long numDistinct() const;
+
+        const std::vector<Bucket>& buckets() const { return _buckets; }
+
+        /**
+         * Estimated bytes used.
+         */
+        size_t bytes() const;
+
+        std::string toString() const;
+
+    private:
+        IndexHistogram() : _numKeys(0) { }
+
+        // Lowest value; empty if there are no keys.
+        BSONObj _min;
+        std::vector<Bucket> _buckets;
+        long long _numKeys;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,150 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file contains tests for mongo/db/query/index_histogram.h
+ */
+
+#include "mongo/db/query/index_histogram.h"
+
+#include <memory>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using namespace mongo;
+    using std::auto_ptr;
+
+    /**
+     * Values 0 .. n-1, each 'copies' times, added in descending order.
+     */
+    IndexHistogram* makeHistogram(int n, int copies, size_t numBuckets) {
+        IndexHistogram::Builder builder(numBuckets);
+        for (int i = n - 1; i >= 0; --i) {
+            for (int j = 0; j < copies; ++j) {
+                BSONObj key = BSON("" << i);
+                builder.add(key.firstElement());
+            }
+        }
+        return builder.done();
+    }
+
+    double estimate(const IndexHistogram& h, const BSONObj& bounds,
+                    bool startInclusive, bool endInclusive) {
+        return h.estimate(Interval(bounds, startInclusive, endInclusive));
+    }
+
+    TEST(IndexHistogramTest, Empty) {
+        IndexHistogram::Builder builder(10);
+        auto_ptr<IndexHistogram> h(builder.done());
+        ASSERT_EQUALS(h->numKeys(), 0);
+        ASSERT_EQUALS(h->numDistinct(), 0);
+        ASSERT_EQUALS(estimate(*h, BSON("" << 0 << "" << 10), true, true), 0);
+    }
+
+    TEST(IndexHistogramTest, BucketsAreEquiDepth) {
+        auto_ptr<IndexHistogram> h(makeHistogram(1000, 1, 10));
+        ASSERT_EQUALS(h->numKeys(), 1000);
+        ASSERT_EQUALS(h->numDistinct(), 1000);
+        ASSERT_EQUALS(h->buckets().size(), 10U);
+        for (size_t i = 0; i < h->buckets().size(); ++i) {
+            ASSERT_EQUALS(h->buckets()[i].count, 100);
+            ASSERT_EQUALS(h->buckets()[i].upper.firstElement().numberInt(),
+                          static_cast<int>(i * 100 + 99));
+        }
+    }
+
+    TEST(IndexHistogramTest, ValuesAreNotSplit) {
+        // One very frequent value.
+        IndexHistogram::Builder builder(10);
+        for (int i = 0; i < 100; ++i) {
+            builder.add(BSON("" << i).firstElement());
+        }
+        for (int i = 0; i < 500; ++i) {
+            builder.add(BSON("" << 50).firstElement());
+        }
+        auto_ptr<IndexHistogram> h(builder.done());
+        ASSERT_EQUALS(h->numKeys(), 600);
+        ASSERT_EQUALS(h->numDistinct(), 100);
+
+        long long total = 0;
+        for (size_t i = 0; i < h->buckets().size(); ++i) {
+            total += h->buckets()[i].count;
+            if (50 == h->buckets()[i].upper.firstElement().numberInt()) {
+                ASSERT_GREATER_THAN_OR_EQUALS(h->buckets()[i].count, 501);
+            }
+        }
+        ASSERT_EQUALS(total, 600);
+
+        // The frequent value shows.
+        ASSERT_GREATER_THAN(estimate(*h, BSON("" << 50 << "" << 50), true, true), 5);
+    }
+
+    TEST(IndexHistogramTest, PointEstimate) {
+        auto_ptr<IndexHistogram> h(makeHistogram(100, 7, 10));
+        ASSERT_EQUALS(estimate(*h, BSON("" << 42 << "" << 42), true, true), 7);
+        // Outside of the data.
+        ASSERT_EQUALS(estimate(*h, BSON("" << 1000 << "" << 1000), true, true), 0);
+        ASSERT_EQUALS(estimate(*h, BSON("" << "foo" << "" << "foo"), true, true), 0);
+    }
+
+    TEST(IndexHistogramTest, RangeEstimate) {
+        auto_ptr<IndexHistogram> h(makeHistogram(1000, 1, 10));
+        // Whole buckets.
+        ASSERT_EQUALS(estimate(*h, BSON("" << 0 << "" << 299), true, true), 300);
+        // Everything.
+        ASSERT_EQUALS(estimate(*h, BSON("" << MINKEY << "" << MAXKEY), true, true), 1000);
+        // Reversed, as for a descending index.
+        ASSERT_EQUALS(estimate(*h, BSON("" << 299 << "" << 0), true, true), 300);
+        // Partial buckets are within a bucket of the truth.
+        double e = estimate(*h, BSON("" << 150 << "" << 450), true, false);
+        ASSERT_GREATER_THAN_OR_EQUALS(e, 200);
+        ASSERT_LESS_THAN_OR_EQUALS(e, 400);
+        // Nothing there.
+        ASSERT_EQUALS(estimate(*h, BSON("" << 2000 << "" << 3000), true, true), 0);
+        ASSERT_EQUALS(estimate(*h, BSON("" << MINKEY << "" << 0), true, false), 0);
+    }
+
+    TEST(IndexHistogramTest, IntervalListEstimate) {
+        auto_ptr<IndexHistogram> h(makeHistogram(100, 3, 10));
+        OrderedIntervalList oil;
+        oil.intervals.push_back(Interval(BSON("" << 1 << "" << 1), true, true));
+        oil.intervals.push_back(Interval(BSON("" << 5 << "" << 5), true, true));
+        oil.intervals.push_back(Interval(BSON("" << 9 << "" << 9), true, true));
+        ASSERT_EQUALS(h->estimate(oil), 9);
+
+        // Never more than there is.
+        OrderedIntervalList all;
+        all.intervals.push_back(Interval(BSON("" << MINKEY << "" << MAXKEY), true, true));
+        all.intervals.push_back(Interval(BSON("" << MINKEY << "" << MAXKEY), true, true));
+        ASSERT_EQUALS(h->estimate(all), 300);
+    }
+
+}  // namespace
@@ -34,6 +34,7 @@
 #include "mongo/db/pdfile.h"   // for nsdetails(...)
 #include "mongo/db/query/eof_runner.h"
 #include "mongo/db/query/internal_runner.h"
+#include "mongo/db/structure/collection.h"
 
 namespace mongo {
 
@@ -83,6 +84,36 @@ namespace mongo {
             return new InternalRunner(ns.toString(), cs, ws);
         }
 
+        /**
+         * Return up to 'numScans' collection scans over disjoint parts of 'collection' which
+         * together cover all of it, and can be drained independently.  Caller owns the runners.
+         */
+        static void parallelCollectionScan(const Collection* collection,
+                                           size_t numScans,
+                                           std::vector<Runner*>* out) {
+            std::vector<DiskLoc> firstExtents;
+            collection->partitionExtents(numScans, &firstExtents);
+
+            if (firstExtents.empty()) {
+                out->push_back(collectionScan(collection->ns().ns()));
+                return;
+            }
+
+            for (size_t i = 0; i < firstExtents.size(); ++i) {
+                CollectionScanParams params;
+                params.ns = collection->ns().ns();
+                params.direction = CollectionScanParams::FORWARD;
+                params.firstExtent = firstExtents[i];
+                if (i + 1 < firstExtents.size()) {
+                    params.endExtent = firstExtents[i + 1];
+                }
+
+                WorkingSet* ws = new WorkingSet();
+                CollectionScan* cs = new CollectionScan(params, ws, NULL);
+                out->push_back(new InternalRunner(params.ns, cs, ws));
+            }
+        }
+
         /**
          * Return an index scan.  Caller owns returned pointer.
          */
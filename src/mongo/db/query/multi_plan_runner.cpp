@@ -39,14 +39,55 @@
 #include "mongo/db/query/qlog.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/type_explain.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/structure/collection.h"
+#include "mongo/util/timer.h"
+
+namespace {
+
+    // The competition works each plan this many times, unless it ends early.
+    const size_t kTimesEachPlanIsWorked = 100;
+
+    // A plan that has produced a full first batch has shown enough.
+    const size_t kEnoughResults = 101;
+
+    // A plan that advances on every work is worked this many times per round.
+    const size_t kMaxTimeSlice = 4;
+
+    // No plan is eliminated before it has been worked this many times...
+    const size_t kWarmupWorks = 20;
+
+    // ...unless the best live plan has produced at least this many results...
+    const size_t kMinResultsToEliminate = 10;
+
+    // ...at least this many times faster than it.
+    const double kEliminationRatio = 4.0;
+
+    double productivity(const mongo::CandidatePlan& candidate) {
+        if (0 == candidate.works) { return 0; }
+        return static_cast<double>(candidate.results.size()) / candidate.works;
+    }
+
+    /**
+     * How many times to work 'candidate' in a round: from 1 for a plan that hasn't produced
+     * anything up to kMaxTimeSlice for one that advances on every work.
+     */
+    size_t timeSlice(const mongo::CandidatePlan& candidate) {
+        return 1 + static_cast<size_t>(productivity(candidate) * (kMaxTimeSlice - 1) + 0.5);
+    }
+
+}  // namespace
 
 namespace mongo {
 
+    // Caps the wall time of the plan competition.  0 means no cap.
+    MONGO_EXPORT_SERVER_PARAMETER(multiPlanMaxTrialMillis, int, 200);
+
     MultiPlanRunner::MultiPlanRunner(CanonicalQuery* query)
         : _killed(false),
           _failure(false),
           _failureCount(0),
+          _numEliminated(0),
           _policy(Runner::YIELD_MANUAL),
           _query(query),
           _backupSolution(NULL),
@@ -283,12 +324,14 @@ namespace mongo {
     }
 
     bool MultiPlanRunner::pickBestPlan(size_t* out) {
-        static const int timesEachPlanIsWorked = 100;
-
-        // Run each plan some number of times.
-        for (int i = 0; i < timesEachPlanIsWorked; ++i) {
-            bool moreToDo = workAllPlans();
-            if (!moreToDo) { break; }
+        // Race the plans in rounds until one hits EOF or the trial has seen enough, dropping
+        // clear losers between rounds so that a wide set of candidates doesn't hold up the
+        // first batch.
+        Timer timer;
+        _numEliminated = 0;
+        while (workAllPlans()) {
+            if (trialIsDone(timer.millis())) { break; }
+            eliminateLosers();
         }
 
         if (_failure || _killed) { return false; }
@@ -359,80 +402,161 @@ namespace mongo {
 
         for (size_t i = 0; i < _candidates.size(); ++i) {
             CandidatePlan& candidate = _candidates[i];
-            if (candidate.failed) { continue; }
-
-            // Yield, if we can yield ourselves.
-            if (NULL != _yieldPolicy.get() && _yieldPolicy->shouldYield()) {
-                saveState();
-                _yieldPolicy->yield();
-                if (_failure || _killed) { return false; }
-                restoreState();
-            }
+            if (candidate.failed || candidate.eliminated) { continue; }
 
-            WorkingSetID id;
-            PlanStage::StageState state = candidate.root->work(&id);
+            const size_t slice = timeSlice(candidate);
+            for (size_t j = 0; j < slice && !candidate.failed; ++j) {
+                // Yield, if we can yield ourselves.
+                if (NULL != _yieldPolicy.get() && _yieldPolicy->shouldYield()) {
+                    saveState();
+                    _yieldPolicy->yield();
+                    if (_failure || _killed) { return false; }
+                    restoreState();
+                }
 
-            if (PlanStage::ADVANCED == state) {
-                // Save result for later.
-                candidate.results.push_back(id);
-            }
-            else if (PlanStage::NEED_TIME == state) {
-                // Fall through to yield check at end of large conditional.
-            }
-            else if (PlanStage::NEED_FETCH == state) {
-                // id has a loc and refers to an obj we need to fetch.
-                WorkingSetMember* member = candidate.ws->get(id);
+                WorkingSetID id;
+                PlanStage::StageState state = candidate.root->work(&id);
+                ++candidate.works;
 
-                // This must be true for somebody to request a fetch and can only change when an
-                // invalidation happens, which is when we give up a lock.  Don't give up the
-                // lock between receiving the NEED_FETCH and actually fetching(?).
-                verify(member->hasLoc());
+                if (PlanStage::ADVANCED == state) {
+                    // Save result for later.
+                    candidate.results.push_back(id);
+                }
+                else if (PlanStage::NEED_TIME == state) {
+                    // Fall through to yield check at end of large conditional.
+                }
+                else if (PlanStage::NEED_FETCH == state) {
+                    // id has a loc and refers to an obj we need to fetch.
+                    WorkingSetMember* member = candidate.ws->get(id);
+
+                    // This must be true for somebody to request a fetch and can only change when
+                    // an invalidation happens, which is when we give up a lock.  Don't give up
+                    // the lock between receiving the NEED_FETCH and actually fetching(?).
+                    verify(member->hasLoc());
+
+                    // Actually bring record into memory.
+                    Record* record = member->loc.rec();
+
+                    // If we're allowed to, go to disk outside of the lock.
+                    if (NULL != _yieldPolicy.get()) {
+                        saveState();
+                        _yieldPolicy->yield(record);
+                        if (_failure || _killed) { return false; }
+                        restoreState();
+                    }
+                    else {
+                        // We're set to manually yield.  We go to disk in the lock.
+                        record->touch();
+                    }
 
-                // Actually bring record into memory.
-                Record* record = member->loc.rec();
+                    // Record should be in memory now.  Log if it's not.
+                    if (!Record::likelyInPhysicalMemory(record->dataNoThrowing())) {
+                        OCCASIONALLY {
+                            warning() << "Record wasn't in memory immediately after fetch: "
+                                << member->loc.toString() << endl;
+                        }
+                    }
 
-                // If we're allowed to, go to disk outside of the lock.
-                if (NULL != _yieldPolicy.get()) {
-                    saveState();
-                    _yieldPolicy->yield(record);
-                    if (_failure || _killed) { return false; }
-                    restoreState();
+                    // Note that we're not freeing id.  Fetch semantics say that we shouldn't.
                 }
-                else {
-                    // We're set to manually yield.  We go to disk in the lock.
-                    record->touch();
+                else if (PlanStage::IS_EOF == state) {
+                    // First plan to hit EOF wins automatically.  Stop evaluating other plans.
+                    // Assumes that the ranking will pick this plan.
+                    planHitEOF = true;
                 }
+                else {
+                    // FAILURE or DEAD.  Do we want to just tank that plan and try the rest?  We
+                    // probably want to fail globally as this shouldn't happen anyway.
+
+                    candidate.failed = true;
+                    ++_failureCount;
 
-                // Record should be in memory now.  Log if it's not.
-                if (!Record::likelyInPhysicalMemory(record->dataNoThrowing())) {
-                    OCCASIONALLY {
-                        warning() << "Record wasn't in memory immediately after fetch: "
-                            << member->loc.toString() << endl;
+                    if (_failureCount == _candidates.size()) {
+                        _failure = true;
+                        return false;
                     }
                 }
 
-                // Note that we're not freeing id.  Fetch semantics say that we shouldn't.
+                // The rest of this plan's slice would be wasted.
+                if (PlanStage::IS_EOF == state) { break; }
             }
-            else if (PlanStage::IS_EOF == state) {
-                // First plan to hit EOF wins automatically.  Stop evaluating other plans.
-                // Assumes that the ranking will pick this plan.
-                planHitEOF = true;
+        }
+
+        return !planHitEOF;
+    }
+
+    bool MultiPlanRunner::trialIsDone(long long elapsedMillis) const {
+        size_t live = 0;
+        size_t totalWorks = 0;
+        bool allWorkedEnough = true;
+        for (size_t i = 0; i < _candidates.size(); ++i) {
+            const CandidatePlan& candidate = _candidates[i];
+            totalWorks += candidate.works;
+            if (candidate.failed || candidate.eliminated) { continue; }
+            ++live;
+
+            if (candidate.results.size() >= kEnoughResults) {
+                QLOG() << "Candidate " << i << " produced a full batch, ending trial\n";
+                return true;
             }
-            else {
-                // FAILURE or DEAD.  Do we want to just tank that plan and try the rest?  We
-                // probably want to fail globally as this shouldn't happen anyway.
+            if (candidate.works < kTimesEachPlanIsWorked) {
+                allWorkedEnough = false;
+            }
+        }
 
-                candidate.failed = true;
-                ++_failureCount;
+        if (allWorkedEnough) { return true; }
 
-                if (_failureCount == _candidates.size()) {
-                    _failure = true;
-                    return false;
-                }
+        // Productive plans get more works per round, so also bound the total.
+        if (totalWorks >= kTimesEachPlanIsWorked * _candidates.size()) { return true; }
+
+        // Everybody else failed or was eliminated.
+        if (1 == live && _candidates.size() > 1) {
+            QLOG() << "One candidate left, ending trial\n";
+            return true;
+        }
+
+        if (multiPlanMaxTrialMillis > 0 && elapsedMillis >= multiPlanMaxTrialMillis) {
+            QLOG() << "Trial took " << elapsedMillis << "ms, ending it\n";
+            return true;
+        }
+
+        return false;
+    }
+
+    void MultiPlanRunner::eliminateLosers() {
+        size_t live = 0;
+        size_t bestChild = _candidates.size();
+        double bestProductivity = 0;
+        for (size_t i = 0; i < _candidates.size(); ++i) {
+            const CandidatePlan& candidate = _candidates[i];
+            if (candidate.failed || candidate.eliminated) { continue; }
+            ++live;
+            if (candidate.works < kWarmupWorks
+                || candidate.results.size() < kMinResultsToEliminate) {
+                continue;
+            }
+            double p = productivity(candidate);
+            if (bestChild == _candidates.size() || p > bestProductivity) {
+                bestChild = i;
+                bestProductivity = p;
             }
         }
 
-        return !planHitEOF;
+        if (live < 2 || bestChild == _candidates.size()) { return; }
+
+        for (size_t i = 0; i < _candidates.size(); ++i) {
+            CandidatePlan& candidate = _candidates[i];
+            if (i == bestChild || candidate.failed || candidate.eliminated) { continue; }
+            if (candidate.works < kWarmupWorks) { continue; }
+            double p = productivity(candidate);
+            if (p * kEliminationRatio < bestProductivity) {
+                QLOG() << "Eliminating candidate " << i << " with productivity " << p
+                       << ", best is candidate " << bestChild << " with " << bestProductivity
+                       << endl;
+                candidate.eliminated = true;
+                ++_numEliminated;
+            }
+        }
     }
 
     void MultiPlanRunner::allPlansSaveState() {
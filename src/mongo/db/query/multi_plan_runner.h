@@ -83,6 +83,11 @@ namespace mongo {
          */
         bool pickBestPlan(size_t* out);
 
+        /**
+         * How many candidates the last pickBestPlan dropped before the end of the competition.
+         */
+        size_t numEliminated() const { return _numEliminated; }
+
         virtual void saveState();
         virtual bool restoreState();
         virtual void invalidate(const DiskLoc& dl);
@@ -104,9 +109,24 @@ namespace mongo {
 
     private:
         /**
-         * Have all our candidate plans do something.
+         * Have all our live candidate plans do something.  More productive candidates are
+         * worked more times per call, see timeSlice().
+         *
+         * Returns false if the competition is over: a plan hit EOF, all plans failed or we
+         * were killed.
          */
         bool workAllPlans();
+
+        /**
+         * Drop live candidates that, after a warmup, produce results at a small fraction of the
+         * rate of the best live candidate.  At least one candidate always stays live.
+         */
+        void eliminateLosers();
+
+        /**
+         * Has the competition seen enough?  See pickBestPlan for the rules.
+         */
+        bool trialIsDone(long long elapsedMillis) const;
         void allPlansSaveState();
         void allPlansRestoreState();
 
@@ -125,6 +145,9 @@ namespace mongo {
         // If everything fails during the plan competition, we can't pick one.
         size_t _failureCount;
 
+        // Candidates dropped early from the plan competition.
+        size_t _numEliminated;
+
         // We need to cache this so that when we switch from running our candidates to using a
         // PlanExecutor, we can set the right yielding policy on it.
         Runner::YieldPolicy _policy;
@@ -38,6 +38,7 @@
 #include "mongo/db/query/find_constants.h"
 #include "mongo/db/query/get_runner.h"
 #include "mongo/db/query/internal_plans.h"
+#include "mongo/db/query/plan_cache.h"
 #include "mongo/db/query/qlog.h"
 #include "mongo/db/query/query_planner_params.h"
 #include "mongo/db/query/single_solution_runner.h"
@@ -45,12 +46,15 @@
 #include "mongo/db/repl/repl_reads_ok.h"
 #include "mongo/db/server_options.h"
 #include "mongo/db/server_parameters.h"
+#include "mongo/db/stats/query_shape_stats.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/d_logic.h"
 #include "mongo/s/stale_exception.h"
+#include "mongo/util/buffer_pool.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/message_builder.h"
 
 namespace mongo {
     // The .h for this in find_constants.h.
@@ -90,6 +94,24 @@ namespace {
         return n >= pq.getNumToReturn();
     }
 
+    /**
+     * Keys and documents 'runner' has examined since it started, for query shape statistics.
+     * A runner that can't explain itself, as for an _id lookup, examined one of each per result.
+     */
+    void getExamined(const mongo::Runner* runner, long long results,
+                     long long* keysOut, long long* docsOut) {
+        mongo::TypeExplain* bareExplain;
+        if (!runner->getExplainPlan(&bareExplain).isOK()) {
+            *keysOut = results;
+            *docsOut = results;
+            return;
+        }
+
+        boost::scoped_ptr<mongo::TypeExplain> explain(bareExplain);
+        *keysOut = explain->isNScannedSet() ? explain->getNScanned() : 0;
+        *docsOut = explain->isNScannedObjectsSet() ? explain->getNScannedObjects() : 0;
+    }
+
 }  // namespace
 
 namespace mongo {
@@ -117,12 +139,10 @@ namespace mongo {
      * Also called by db/ops/query.cpp.  This is the new getMore entry point.
      */
     QueryResult* newGetMore(const char* ns, int ntoreturn, long long cursorid, CurOp& curop,
-                            int pass, bool& exhaust, bool* isCursorAuthorized) {
+                            int pass, bool& exhaust, bool* isCursorAuthorized, Message& result) {
         exhaust = false;
-        int bufSize = 512 + sizeof(QueryResult) + MaxBytesToReturnToClientAtOnce;
 
-        BufBuilder bb(bufSize);
-        bb.skip(sizeof(QueryResult));
+        MessageBuilder bb(sizeof(QueryResult), 32768);
 
         // This is a read lock.
         scoped_ptr<Client::ReadContext> ctx(new Client::ReadContext(ns));
@@ -222,6 +242,17 @@ namespace mongo {
                 return 0;
             }
 
+            // The cost of this batch goes to the query's shape.
+            if (!cc->queryShape().empty() && Runner::RUNNER_DEAD != state) {
+                long long keysExamined;
+                long long docsExamined;
+                getExamined(runner, startingResult + numResults, &keysExamined, &docsExamined);
+                curop.debug().queryShape = cc->queryShape();
+                curop.debug().nscanned = keysExamined - cc->keysExamined();
+                curop.debug().nscannedObjects = docsExamined - cc->docsExamined();
+                cc->setExamined(keysExamined, docsExamined);
+            }
+
             bool saveClientCursor = false;
 
             if (Runner::RUNNER_DEAD == state || Runner::RUNNER_ERROR == state) {
@@ -276,16 +307,15 @@ namespace mongo {
             }
         }
 
-        QueryResult* qr = reinterpret_cast<QueryResult*>(bb.buf());
-        qr->len = bb.len();
+        QueryResult* qr = static_cast<QueryResult*>(bb.header());
         qr->setOperation(opReply);
         qr->_resultFlags() = resultFlags;
         qr->cursorId = cursorid;
         qr->startingFrom = startingResult;
         qr->nReturned = numResults;
-        bb.decouple();
+        bb.transferTo(result);
         QLOG() << "getMore returned " << numResults << " results\n";
-        return qr;
+        return static_cast<QueryResult*>(result.header());
     }
 
     Status getOplogStartHack(CanonicalQuery* cq, Runner** runnerOut) {
@@ -349,10 +379,11 @@ namespace mongo {
 
             curop.markCommand();
 
-            BufBuilder bb;
+            PooledBufBuilder bb;
             bb.skip(sizeof(QueryResult));
 
-            BSONObjBuilder cmdResBuf;
+            PooledBufBuilder cmdResBufBuilder;
+            BSONObjBuilder cmdResBuf(cmdResBufBuilder);
             if (!runCommands(ns, q.query, curop, bb, cmdResBuf, false, q.queryOptions)) {
                 uasserted(13530, "bad or malformed command request?");
             }
@@ -458,8 +489,7 @@ namespace mongo {
         // bb is used to hold query results
         // this buffer should contain either requested documents per query or
         // explain information, but not both
-        BufBuilder bb(32768);
-        bb.skip(sizeof(QueryResult));
+        MessageBuilder bb(sizeof(QueryResult), 32768);
 
         // How many results have we obtained from the runner?
         int numResults = 0;
@@ -565,6 +595,19 @@ namespace mongo {
                                            shardingState.getVersion(pq.ns()));
         }
 
+        // Note the shape and cost of the query; assembleResponse records them in
+        // queryShapeStats once the latency of the operation is known.
+        std::string queryShape;
+        long long keysExamined = 0;
+        long long docsExamined = 0;
+        if (QueryShapeStats::isEnabled() && !isExplain) {
+            queryShape = getPlanCacheKey(*cq);
+            getExamined(runner.get(), numResults, &keysExamined, &docsExamined);
+            curop.debug().queryShape = queryShape;
+            curop.debug().nscanned = keysExamined;
+            curop.debug().nscannedObjects = docsExamined;
+        }
+
         // Append explain information to query results by asking the runner to produce them.
         if (isExplain) {
             TypeExplain* bareExplain;
@@ -635,6 +678,8 @@ namespace mongo {
             // Set attributes for getMore.
             cc->setCollMetadata(collMetadata);
             cc->setPos(numResults);
+            cc->setQueryShape(queryShape);
+            cc->setExamined(keysExamined, docsExamined);
 
             // If the query had a time limit, remaining time is "rolled over" to the cursor (for
             // use by future getmore ops).
@@ -645,8 +690,7 @@ namespace mongo {
         }
 
         // Add the results from the query into the output buffer.
-        result.appendData(bb.buf(), bb.len());
-        bb.decouple();
+        bb.transferTo(result);
 
         // Fill out the output buffer's header.
         QueryResult* qr = static_cast<QueryResult*>(result.header());
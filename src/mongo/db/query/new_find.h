@@ -40,10 +40,12 @@
 namespace mongo {
 
     /**
-     * Called from the getMore entry point in ops/query.cpp.
+     * Called from the getMore entry point in ops/query.cpp.  Places the reply in 'result' and
+     * returns its header, or returns NULL, leaving 'result' empty, when an awaitData cursor has
+     * nothing yet.
      */
     QueryResult* newGetMore(const char* ns, int ntoreturn, long long cursorid, CurOp& curop,
-                            int pass, bool& exhaust, bool* isCursorAuthorized);
+                            int pass, bool& exhaust, bool* isCursorAuthorized, Message& result);
 
     /**
      * Run the query 'q' and place the result in 'result'.
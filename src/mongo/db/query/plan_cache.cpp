@@ -33,10 +33,12 @@
 #include "mongo/db/query/plan_ranker.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/qlog.h"
+#include "mongo/util/hex.h"
+#include "mongo/util/log.h"
 
 namespace {
 
-    using std::ostream;
+    using std::auto_ptr;
     using std::string;
     using std::stringstream;
     using namespace mongo;
@@ -75,54 +77,40 @@ namespace {
         }
     }
 
+    // Tags for the directions in the sort part of the key.  They can't be confused with a match
+    // type since the sort is always preceded by a kSortTag.
+    const char kSortTag = '\xff';
+    const char kAscendingTag = 'a';
+    const char kDescendingTag = 'd';
+    const char kTextScoreTag = 't';
+
     /**
-     * 2-character encoding of MatchExpression::MatchType.
+     * Appends 'n' as a little endian base 128 varint, which is one byte for any realistic
+     * number of children.
      */
-    const char* encodeMatchType(MatchExpression::MatchType mt) {
-        switch(mt) {
-        case MatchExpression::AND: return "an"; break;
-        case MatchExpression::OR: return "or"; break;
-        case MatchExpression::NOR: return "nr"; break;
-        case MatchExpression::NOT: return "nt"; break;
-        case MatchExpression::ALL: return "al"; break;
-        case MatchExpression::ELEM_MATCH_OBJECT: return "eo"; break;
-        case MatchExpression::ELEM_MATCH_VALUE: return "ev"; break;
-        case MatchExpression::SIZE: return "sz"; break;
-        case MatchExpression::LTE: return "le"; break;
-        case MatchExpression::LT: return "lt"; break;
-        case MatchExpression::EQ: return "eq"; break;
-        case MatchExpression::GT: return "gt"; break;
-        case MatchExpression::GTE: return "ge"; break;
-        case MatchExpression::REGEX: return "re"; break;
-        case MatchExpression::MOD: return "mo"; break;
-        case MatchExpression::EXISTS: return "ex"; break;
-        case MatchExpression::MATCH_IN: return "in"; break;
-        case MatchExpression::NIN: return "ni"; break;
-        case MatchExpression::TYPE_OPERATOR: return "ty"; break;
-        case MatchExpression::GEO: return "go"; break;
-        case MatchExpression::WHERE: return "wh"; break;
-        case MatchExpression::ATOMIC: return "at"; break;
-        case MatchExpression::ALWAYS_FALSE: return "af"; break;
-        case MatchExpression::GEO_NEAR: return "gn"; break;
-        case MatchExpression::TEXT: return "te"; break;
+    void appendCount(size_t n, string* key) {
+        while (n >= 0x80) {
+            key->push_back(static_cast<char>((n & 0x7f) | 0x80));
+            n >>= 7;
         }
-        // Unreachable code.
-        // All MatchType values have been handled in switch().
-        verify(0);
-        return "";
+        key->push_back(static_cast<char>(n));
     }
 
     /**
      * Traverses expression tree pre-order.
-     * Appends an encoding of each node's match type and path name
-     * to the output stream.
+     * Appends, for each node, one byte of match type, the NUL terminated path and the number
+     * of children.  No literal value is encoded, so queries that differ only in their values
+     * share a key, and the child counts keep differently nested trees apart.
      */
-    void encodePlanCacheKeyTree(const MatchExpression* tree, ostream* os) {
-        // Encode match type and path.
-        *os << encodeMatchType(tree->matchType()) << tree->path();
+    void encodePlanCacheKeyTree(const MatchExpression* tree, string* key) {
+        key->push_back(static_cast<char>(tree->matchType()));
+        StringData path = tree->path();
+        key->append(path.rawData(), path.size());
+        key->push_back('\0');
+        appendCount(tree->numChildren(), key);
         // Traverse child nodes.
         for (size_t i = 0; i < tree->numChildren(); ++i) {
-            encodePlanCacheKeyTree(tree->getChild(i), os);
+            encodePlanCacheKeyTree(tree->getChild(i), key);
         }
     }
 
@@ -131,26 +119,61 @@ namespace {
      * Sort order is normalized because it provided by
      * LiteParsedQuery.
      */
-    void encodePlanCacheKeySort(const BSONObj& sortObj, ostream* os) {
+    void encodePlanCacheKeySort(const BSONObj& sortObj, string* key) {
+        key->push_back(kSortTag);
         BSONObjIterator it(sortObj);
         while (it.more()) {
             BSONElement elt = it.next();
             // $meta text score
             if (LiteParsedQuery::isTextScoreMeta(elt)) {
-                *os << "t";
+                key->push_back(kTextScoreTag);
             }
             // Ascending
             else if (elt.numberInt() == 1) {
-                *os << "a";
+                key->push_back(kAscendingTag);
             }
             // Descending
             else {
-                *os << "d";
+                key->push_back(kDescendingTag);
             }
-            *os << elt.fieldName();
+            key->append(elt.fieldName(), elt.fieldNameSize());
         }
     }
 
+    /**
+     * Rough memory use of a stats tree.  Specific stats are a handful of counters and are
+     * charged a flat amount per node.
+     */
+    size_t estimateStatsBytes(const PlanStageStats* stats) {
+        if (NULL == stats) {
+            return 0;
+        }
+        size_t bytes = sizeof(PlanStageStats) + 64
+                     + stats->children.capacity() * sizeof(PlanStageStats*);
+        for (size_t i = 0; i < stats->children.size(); ++i) {
+            bytes += estimateStatsBytes(stats->children[i]);
+        }
+        return bytes;
+    }
+
+    /**
+     * Rough memory use of 'entry' stored under 'key'.  The key is held by both the map and the
+     * LRU list.
+     */
+    size_t estimateEntryBytes(const PlanCacheKey& key, const PlanCacheEntry& entry) {
+        size_t bytes = sizeof(PlanCacheEntry) + 2 * (sizeof(PlanCacheKey) + key.capacity())
+                     + entry.query.objsize() + entry.sort.objsize() + entry.projection.objsize();
+        if (NULL != entry.decision.get()) {
+            bytes += sizeof(PlanRankingDecision)
+                   + estimateStatsBytes(entry.decision->statsOfWinner);
+        }
+        for (size_t i = 0; i < entry.feedback.size(); ++i) {
+            bytes += sizeof(PlanCacheEntryFeedback)
+                   + estimateStatsBytes(entry.feedback[i]->stats.get());
+        }
+        return bytes;
+    }
+
 } // namespace
 
 namespace mongo {
@@ -197,14 +220,15 @@ namespace mongo {
     }
 
     /**
-     * Cache key is a string-ified combination of the query and sort obfuscated
-     * for minimal user comprehension.
+     * Cache key is a binary encoding of the shape of the query and sort, built in a single
+     * pass over both.  Exact rather than hashed, so distinct shapes never share an entry.
      */
     PlanCacheKey getPlanCacheKey(const CanonicalQuery& query) {
-        stringstream ss;
-        encodePlanCacheKeyTree(query.root(), &ss);
-        encodePlanCacheKeySort(query.getParsed().getSort(), &ss);
-        PlanCacheKey key(ss.str());
+        const BSONObj& sortObj = query.getParsed().getSort();
+        PlanCacheKey key;
+        key.reserve(64 + sortObj.objsize());
+        encodePlanCacheKeyTree(query.root(), &key);
+        encodePlanCacheKeySort(sortObj, &key);
         return key;
     }
 
@@ -212,9 +236,10 @@ namespace mongo {
     // PlanCacheEntry
     //
 
-    PlanCacheEntry::PlanCacheEntry(const QuerySolution& s, PlanRankingDecision* d) {
+    PlanCacheEntry::PlanCacheEntry(const QuerySolution& s, PlanRankingDecision* d)
+        : plannerData(NULL), pinned(false), bytes(0), memoryUsage(MemoryUsage::kPlanCache),
+          hits(0) {
         decision.reset(d);
-        pinned = false;
         // XXX: pull things out of 's' that we need to inorder to recreate the same soln
     }
 
@@ -226,13 +251,15 @@ namespace mongo {
 
     string PlanCacheEntry::toString() const {
         stringstream ss;
-        ss << "pinned?: " << pinned << endl;
+        ss << "query: " << query.toString() << " sort: " << sort.toString()
+           << " projection: " << projection.toString()
+           << " pinned?: " << pinned << " bytes: " << bytes << " hits: " << hits << endl;
         return ss.str();
     }
 
     string CachedSolution::toString() const {
         stringstream ss;
-        ss << "key: " << key << endl;
+        ss << "key: " << toHex(key.data(), key.size()) << endl;
         return ss.str();
     }
 
@@ -240,27 +267,239 @@ namespace mongo {
     // PlanCache
     //
 
+    const size_t PlanCache::kMaxFeedback = 20;
+    const size_t PlanCache::kMinFeedbackToEvict = 3;
+
+    PlanCache::PlanCache(size_t maxEntries, size_t maxBytes, double evictionRatio)
+        : _maxEntries(maxEntries),
+          _maxBytes(maxBytes),
+          _evictionRatio(evictionRatio),
+          _mutex("PlanCache"),
+          _bytes(0),
+          _hits(0),
+          _misses(0),
+          _evictions(0),
+          _feedbackEvictions(0) { }
+
+    // static
+    double PlanCache::worksPerResult(const PlanStageStats* stats) {
+        if (NULL == stats) {
+            return 0;
+        }
+        return static_cast<double>(stats->common.works)
+             / std::max(static_cast<uint64_t>(1), stats->common.advanced);
+    }
+
     PlanCache::~PlanCache() { clear(); }
 
     Status PlanCache::add(const CanonicalQuery& query, const QuerySolution& soln,
                           PlanRankingDecision* why) {
-        return Status(ErrorCodes::BadValue, "not implemented yet");
+        auto_ptr<PlanCacheEntry> entry(new PlanCacheEntry(soln, why));
+        if (!shouldCacheQuery(query)) {
+            return Status(ErrorCodes::BadValue, "query is not cacheable");
+        }
+
+        const LiteParsedQuery& lpq = query.getParsed();
+        entry->query = lpq.getFilter().getOwned();
+        entry->sort = lpq.getSort().getOwned();
+        entry->projection = lpq.getProj().getOwned();
+
+        PlanCacheKey key = getPlanCacheKey(query);
+        entry->bytes = estimateEntryBytes(key, *entry);
+        entry->memoryUsage.set(entry->bytes);
+        if (entry->bytes > _maxBytes) {
+            return Status(ErrorCodes::BadValue, "plan cache entry is larger than the cache");
+        }
+
+        SimpleMutex::scoped_lock lk(_mutex);
+        if (_cache.end() != _cache.find(key)) {
+            return Status(ErrorCodes::BadValue, "query shape is already in the plan cache");
+        }
+
+        _lru.push_front(key);
+        Slot slot;
+        slot.entry = entry.release();
+        slot.lruPosition = _lru.begin();
+        _cache[key] = slot;
+        _bytes += slot.entry->bytes;
+
+        _evict(key);
+        return Status::OK();
     }
 
     Status PlanCache::get(const CanonicalQuery& query, CachedSolution** crOut) {
-        return Status(ErrorCodes::BadValue, "not implemented yet");
+        if (!shouldCacheQuery(query)) {
+            return Status(ErrorCodes::BadValue, "query is not cacheable");
+        }
+
+        PlanCacheKey key = getPlanCacheKey(query);
+
+        SimpleMutex::scoped_lock lk(_mutex);
+        EntryMap::iterator it = _cache.find(key);
+        if (_cache.end() == it) {
+            ++_misses;
+            return Status(ErrorCodes::NoSuchKey, "no such key in plan cache");
+        }
+
+        ++_hits;
+        PlanCacheEntry* entry = it->second.entry;
+        ++entry->hits;
+        _lru.splice(_lru.begin(), _lru, it->second.lruPosition);
+
+        CachedSolution* cs = new CachedSolution();
+        // XXX: copy the planner data once entries have any.
+        cs->plannerData = NULL;
+        cs->key = key;
+        *crOut = cs;
+        return Status::OK();
     }
 
     Status PlanCache::feedback(const PlanCacheKey& ck, PlanCacheEntryFeedback* feedback) {
-        return Status(ErrorCodes::BadValue, "not implemented yet");
+        auto_ptr<PlanCacheEntryFeedback> autoFeedback(feedback);
+
+        SimpleMutex::scoped_lock lk(_mutex);
+        EntryMap::iterator it = _cache.find(ck);
+        if (_cache.end() == it) {
+            return Status(ErrorCodes::NoSuchKey, "no such key in plan cache");
+        }
+
+        PlanCacheEntry* entry = it->second.entry;
+        entry->feedback.push_back(autoFeedback.release());
+        if (entry->feedback.size() > kMaxFeedback) {
+            delete entry->feedback.front();
+            entry->feedback.erase(entry->feedback.begin());
+        }
+
+        double runRatio;
+        double trialRatio;
+        if (_hasDegraded(*entry, &runRatio, &trialRatio)) {
+            log() << "plan cache: evicting query shape of " << entry->query.toString()
+                  << " sort " << entry->sort.toString() << " which ran at " << runRatio
+                  << " works per result over " << entry->feedback.size() << " runs, "
+                  << _evictionRatio << " times worse than the " << trialRatio
+                  << " it was picked with; the next such query will be planned again" << endl;
+            _erase(it);
+            ++_feedbackEvictions;
+            return Status::OK();
+        }
+
+        _bytes -= entry->bytes;
+        entry->bytes = estimateEntryBytes(ck, *entry);
+        entry->memoryUsage.set(entry->bytes);
+        _bytes += entry->bytes;
+
+        _evict(ck);
+        return Status::OK();
+    }
+
+    bool PlanCache::_hasDegraded(const PlanCacheEntry& entry, double* runRatio,
+                                 double* trialRatio) const {
+        if (entry.pinned || entry.feedback.size() < kMinFeedbackToEvict) {
+            return false;
+        }
+        if (NULL == entry.decision.get() || NULL == entry.decision->statsOfWinner) {
+            return false;
+        }
+
+        // Works per result over all the runs kept, so one odd run doesn't decide.
+        uint64_t works = 0;
+        uint64_t advanced = 0;
+        for (size_t i = 0; i < entry.feedback.size(); ++i) {
+            const PlanStageStats* stats = entry.feedback[i]->stats.get();
+            if (NULL == stats) {
+                continue;
+            }
+            works += stats->common.works;
+            advanced += stats->common.advanced;
+        }
+
+        *runRatio = static_cast<double>(works) / std::max(static_cast<uint64_t>(1), advanced);
+        *trialRatio = std::max(1.0, worksPerResult(entry.decision->statsOfWinner));
+        return *runRatio > _evictionRatio * *trialRatio;
     }
 
     Status PlanCache::remove(const PlanCacheKey& ck) {
-        return Status(ErrorCodes::BadValue, "not implemented yet");
+        SimpleMutex::scoped_lock lk(_mutex);
+        EntryMap::iterator it = _cache.find(ck);
+        if (_cache.end() == it) {
+            return Status(ErrorCodes::NoSuchKey, "no such key in plan cache");
+        }
+        _erase(it);
+        return Status::OK();
     }
 
     void PlanCache::clear() {
-        // XXX: implement
+        SimpleMutex::scoped_lock lk(_mutex);
+        for (EntryMap::iterator it = _cache.begin(); it != _cache.end(); ++it) {
+            delete it->second.entry;
+        }
+        _cache.clear();
+        _lru.clear();
+        _bytes = 0;
+    }
+
+    size_t PlanCache::size() const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        return _cache.size();
+    }
+
+    void PlanCache::appendShapes(BSONArrayBuilder* out) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        for (LRUList::const_iterator i = _lru.begin(); i != _lru.end(); ++i) {
+            const PlanCacheEntry* entry = _cache.find(*i)->second.entry;
+            BSONObjBuilder shape(out->subobjStart());
+            shape.append("query", entry->query);
+            shape.append("sort", entry->sort);
+            shape.append("projection", entry->projection);
+            shape.appendNumber("bytes", static_cast<long long>(entry->bytes));
+            shape.appendNumber("hits", entry->hits);
+            shape.appendNumber("feedback", static_cast<long long>(entry->feedback.size()));
+            if (NULL != entry->decision.get()) {
+                shape.append("trialWorksPerResult", worksPerResult(entry->decision->statsOfWinner));
+            }
+            shape.appendBool("pinned", entry->pinned);
+            shape.doneFast();
+        }
+    }
+
+    void PlanCache::appendStats(BSONObjBuilder* out) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        out->appendNumber("entries", static_cast<long long>(_cache.size()));
+        out->appendNumber("bytes", static_cast<long long>(_bytes));
+        out->appendNumber("maxEntries", static_cast<long long>(_maxEntries));
+        out->appendNumber("maxBytes", static_cast<long long>(_maxBytes));
+        out->append("evictionRatio", _evictionRatio);
+        out->appendNumber("hits", _hits);
+        out->appendNumber("misses", _misses);
+        out->appendNumber("evictions", _evictions);
+        out->appendNumber("feedbackEvictions", _feedbackEvictions);
+    }
+
+    void PlanCache::_erase(EntryMap::iterator it) {
+        _bytes -= it->second.entry->bytes;
+        _lru.erase(it->second.lruPosition);
+        delete it->second.entry;
+        _cache.erase(it);
+    }
+
+    void PlanCache::_evict(const PlanCacheKey& keep) {
+        LRUList::iterator candidate = _lru.end();
+        while ((_cache.size() > _maxEntries || _bytes > _maxBytes) && candidate != _lru.begin()) {
+            --candidate;
+            if (*candidate == keep) {
+                continue;
+            }
+            EntryMap::iterator it = _cache.find(*candidate);
+            if (it->second.entry->pinned) {
+                continue;
+            }
+            // Resume from the (already examined) entry after the victim.
+            LRUList::iterator next = candidate;
+            ++next;
+            _erase(it);
+            ++_evictions;
+            candidate = next;
+        }
     }
 
 }  // namespace mongo
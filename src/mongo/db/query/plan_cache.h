@@ -28,8 +28,12 @@
 
 #pragma once
 
+#include <list>
+
 #include "mongo/db/exec/plan_stats.h"
 #include "mongo/db/query/canonical_query.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/memory_usage.h"
 
 namespace mongo {
 
@@ -51,8 +55,6 @@ namespace mongo {
 
      * must cache query w/shape, not exact data.
 
-     * cache should be LRU with some cap on size
-
      * order doesn't matter: ensure that cache entry for query={a:1, b:1} same for query={b:1, a:1}
 
      * cache whenever possible
@@ -74,7 +76,7 @@ namespace mongo {
         boost::scoped_ptr<PlanStageStats> stats;
     };
 
-    // TODO: Is this binary data really?
+    // Binary and opaque, only meaningful within the lifetime of the server process.
     typedef std::string PlanCacheKey;
 
     /**
@@ -93,7 +95,8 @@ namespace mongo {
 
     /**
      * Generates a key for a normalized (for caching) canonical query
-     * from the match expression and sort order.
+     * from the shape of the match expression and the sort order.
+     * Literal values are not part of the key: {a: 5} and {a: 7} share it.
      */
     PlanCacheKey getPlanCacheKey(const CanonicalQuery& query);
 
@@ -150,8 +153,23 @@ namespace mongo {
         // runs when they complete.  TODO: How many of these do we really want to keep?
         std::vector<PlanCacheEntryFeedback*> feedback;
 
-        // Is this pinned in the cache?  If so, we will never remove it as a result of feedback.
+        // Is this pinned in the cache?  If so, we will never remove it as a result of feedback
+        // and it is never evicted to make room for other entries.
         bool pinned;
+
+        // The shape of the query this entry was made for, kept to list the cache contents.
+        BSONObj query;
+        BSONObj sort;
+        BSONObj projection;
+
+        // Estimated memory used by this entry, including its key.  Maintained by the PlanCache.
+        size_t bytes;
+
+        // Reports 'bytes' to the process-wide memory usage accounting while the entry exists.
+        MemoryUsageTracker memoryUsage;
+
+        // Number of times get(...) returned this entry.
+        long long hits;
     };
 
     /**
@@ -159,14 +177,22 @@ namespace mongo {
      * mapping, the cache contains information on why that mapping was made and statistics on the
      * cache entry's actual performance on subsequent runs.
      *
-     * XXX: lock in here!  this can be called by many threads at the same time since the only above-this
-     * locking required is a read lock on the ns.
+     * There is one cache per collection.  It holds at most 'maxEntries' entries using at most
+     * 'maxBytes' of (estimated) memory, evicting the least recently used unpinned entries to
+     * stay under both.
+     *
+     * All methods lock internally, since the only locking required above the cache is a read
+     * lock on the ns and many threads may use it at the same time.
      */
     class PlanCache {
     private:
         MONGO_DISALLOW_COPYING(PlanCache);
     public:
-        PlanCache() { }
+        /**
+         * An entry whose runs take more than 'evictionRatio' times as many works per result as
+         * its winning trial did is evicted on feedback, so that its shape is planned again.
+         */
+        PlanCache(size_t maxEntries, size_t maxBytes, double evictionRatio = 10.0);
 
         ~PlanCache();
 
@@ -206,6 +232,10 @@ namespace mongo {
          *
          * If the entry corresponding to 'ck' still exists, 'feedback' is added to the run
          * statistics about the plan.  Status::OK() is returned.
+         *
+         * Once an unpinned entry has kMinFeedbackToEvict runs, if the works per result over the
+         * runs it keeps is more than the eviction ratio times that of its trial, the cached plan
+         * has degraded (e.g. the data has shifted) and the entry is evicted.
          */
         Status feedback(const PlanCacheKey& ck, PlanCacheEntryFeedback* feedback);
 
@@ -220,8 +250,76 @@ namespace mongo {
          */
         void clear();
 
+        /**
+         * Number of entries in the cache.
+         */
+        size_t size() const;
+
+        /**
+         * Append one object per entry, most recently used first, describing the query shape
+         * and the memory use, hits and pinning of the entry.
+         */
+        void appendShapes(BSONArrayBuilder* out) const;
+
+        /**
+         * Append the size and limits of the cache and its hit, miss and eviction counters.
+         */
+        void appendStats(BSONObjBuilder* out) const;
+
+        // How many feedback objects an entry keeps.  Older ones are dropped first.
+        static const size_t kMaxFeedback;
+
+        // How many runs an entry needs before feedback can evict it.
+        static const size_t kMinFeedbackToEvict;
+
+        /**
+         * Works per result of a stats tree.  No results count as one, so a plan that does a lot
+         * of work to find nothing still scores badly.
+         */
+        static double worksPerResult(const PlanStageStats* stats);
+
     private:
-        unordered_map<PlanCacheKey, PlanCacheEntry*> _cache;
+        // Most recently used first.
+        typedef std::list<PlanCacheKey> LRUList;
+
+        struct Slot {
+            PlanCacheEntry* entry;
+            LRUList::iterator lruPosition;
+        };
+
+        typedef unordered_map<PlanCacheKey, Slot> EntryMap;
+
+        /**
+         * Remove the entry at 'it' from the map and the LRU list and delete it.
+         */
+        void _erase(EntryMap::iterator it);
+
+        /**
+         * Evict least recently used unpinned entries other than 'keep' until the cache is within
+         * its limits or nothing else can be evicted.
+         */
+        void _evict(const PlanCacheKey& keep);
+
+        /**
+         * Has 'entry' been running more than _evictionRatio times worse than its trial?
+         */
+        bool _hasDegraded(const PlanCacheEntry& entry, double* runRatio, double* trialRatio) const;
+
+        const size_t _maxEntries;
+        const size_t _maxBytes;
+        const double _evictionRatio;
+
+        // Protects everything below.
+        mutable SimpleMutex _mutex;
+
+        EntryMap _cache;
+        LRUList _lru;
+        size_t _bytes;
+
+        long long _hits;
+        long long _misses;
+        long long _evictions;
+        long long _feedbackEvictions;
     };
 
 }  // namespace mongo
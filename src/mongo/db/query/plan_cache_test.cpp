@@ -35,6 +35,8 @@
 #include <sstream>
 #include <memory>
 #include "mongo/db/json.h"
+#include "mongo/db/query/plan_ranker.h"
+#include "mongo/db/query/query_solution.h"
 #include "mongo/unittest/unittest.h"
 
 using namespace mongo;
@@ -233,31 +235,252 @@ namespace {
      * Test functions for getPlanCacheKey.
      * Cache keys are intentionally obfuscated and are meaningful only
      * within the current lifetime of the server process. Users should treat
-     * plan cache keys as opaque.
+     * plan cache keys as opaque, so these only compare keys with each other.
      */
-    void testGetPlanCacheKey(const char* queryStr, const char* sortStr,
-                             const char *expectedStr) {
+    PlanCacheKey makeKey(const char* queryStr, const char* sortStr) {
         auto_ptr<CanonicalQuery> cq(canonicalize(queryStr, sortStr, "{}"));
-        PlanCacheKey key = getPlanCacheKey(*cq);
-        PlanCacheKey expectedKey(expectedStr);
-        if (key == expectedKey) {
+        return getPlanCacheKey(*cq);
+    }
+
+    void assertSameKey(const char* queryA, const char* sortA,
+                       const char* queryB, const char* sortB) {
+        if (makeKey(queryA, sortA) == makeKey(queryB, sortB)) {
+            return;
+        }
+        stringstream ss;
+        ss << "Expected the same plan cache key for " << queryA << " sort " << sortA
+           << " and " << queryB << " sort " << sortB;
+        FAIL(ss.str());
+    }
+
+    void assertDifferentKey(const char* queryA, const char* sortA,
+                            const char* queryB, const char* sortB) {
+        if (makeKey(queryA, sortA) != makeKey(queryB, sortB)) {
             return;
         }
         stringstream ss;
-        ss << "Unexpected plan cache key. Expected: " << expectedKey << ". Actual: " << key
-           << ". Query: " << cq->toString();
+        ss << "Expected different plan cache keys for " << queryA << " sort " << sortA
+           << " and " << queryB << " sort " << sortB;
         FAIL(ss.str());
     }
 
-    TEST(PlanCacheTest, getPlanCacheKey) {
-        // Generated cache keys should be treated as opaque to the user.
-        // No sorts
-        testGetPlanCacheKey("{}", "{}", "an");
-        testGetPlanCacheKey("{$or: [{a: 1}, {b: 2}]}", "{}", "oreqaeqb");
-        // With sort
-        testGetPlanCacheKey("{}", "{a: 1}", "anaa");
-        testGetPlanCacheKey("{}", "{a: -1}", "anda");
-        testGetPlanCacheKey("{}", "{a: {$meta: 'textScore'}}", "anta");
+    TEST(PlanCacheTest, getPlanCacheKeyIgnoresLiterals) {
+        assertSameKey("{a: 5}", "{}", "{a: 7}", "{}");
+        assertSameKey("{a: 'foo'}", "{}", "{a: 7}", "{}");
+        assertSameKey("{a: {$gt: 1}, b: {$in: [1, 2, 3]}}", "{}",
+                      "{a: {$gt: 100}, b: {$in: [4, 5]}}", "{}");
+        assertSameKey("{$or: [{a: 1}, {b: 2}]}", "{a: 1}",
+                      "{$or: [{a: 3}, {b: 4}]}", "{a: 1}");
+        assertSameKey("{a: {$elemMatch: {b: 1}}}", "{}", "{a: {$elemMatch: {b: 2}}}", "{}");
+    }
+
+    TEST(PlanCacheTest, getPlanCacheKeyDistinguishesShapes) {
+        // Operator matters.
+        assertDifferentKey("{a: 1}", "{}", "{a: {$gt: 1}}", "{}");
+        // Path matters.
+        assertDifferentKey("{a: 1}", "{}", "{b: 1}", "{}");
+        assertDifferentKey("{ab: 1, c: 1}", "{}", "{a: 1, bc: 1}", "{}");
+        assertDifferentKey("{a: 1}", "{}", "{'a.b': 1}", "{}");
+        // Nesting matters.
+        assertDifferentKey("{$or: [{a: 1, b: 1}, {c: 1}]}", "{}",
+                           "{$or: [{a: 1}, {b: 1, c: 1}]}", "{}");
+        // Sort matters.
+        assertDifferentKey("{a: 1}", "{}", "{a: 1}", "{a: 1}");
+        assertDifferentKey("{a: 1}", "{a: 1}", "{a: 1}", "{a: -1}");
+        assertDifferentKey("{}", "{a: 1}", "{}", "{b: 1}");
+        assertDifferentKey("{}", "{a: 1, b: 1}", "{}", "{ab: 1}");
+        assertDifferentKey("{}", "{a: 1}", "{}", "{a: {$meta: 'textScore'}}");
+    }
+
+    //
+    // Bounded LRU cache
+    //
+
+    /**
+     * Adds 'queryStr' to 'cache' with an empty solution.
+     */
+    Status addToCache(PlanCache* cache, const char* queryStr) {
+        auto_ptr<CanonicalQuery> cq(canonicalize(queryStr));
+        QuerySolution soln;
+        return cache->add(*cq, soln, new PlanRankingDecision());
+    }
+
+    PlanStageStats* makeStats(uint64_t works, uint64_t advanced) {
+        CommonStats common;
+        common.works = works;
+        common.advanced = advanced;
+        return new PlanStageStats(common, STAGE_COLLSCAN);
+    }
+
+    /**
+     * Adds 'queryStr' to 'cache' as if its trial took 'works' works for 'advanced' results.
+     */
+    Status addToCacheWithTrial(PlanCache* cache, const char* queryStr,
+                               uint64_t works, uint64_t advanced) {
+        auto_ptr<CanonicalQuery> cq(canonicalize(queryStr));
+        QuerySolution soln;
+        PlanRankingDecision* why = new PlanRankingDecision();
+        why->statsOfWinner = makeStats(works, advanced);
+        return cache->add(*cq, soln, why);
+    }
+
+    Status giveFeedback(PlanCache* cache, const char* queryStr,
+                        uint64_t works, uint64_t advanced) {
+        auto_ptr<CanonicalQuery> cq(canonicalize(queryStr));
+        PlanCacheEntryFeedback* feedback = new PlanCacheEntryFeedback();
+        feedback->stats.reset(makeStats(works, advanced));
+        return cache->feedback(getPlanCacheKey(*cq), feedback);
+    }
+
+    bool isInCache(PlanCache* cache, const char* queryStr) {
+        auto_ptr<CanonicalQuery> cq(canonicalize(queryStr));
+        CachedSolution* rawCS;
+        if (!cache->get(*cq, &rawCS).isOK()) {
+            return false;
+        }
+        delete rawCS;
+        return true;
+    }
+
+    BSONObj getStats(const PlanCache& cache) {
+        BSONObjBuilder bob;
+        cache.appendStats(&bob);
+        return bob.obj();
+    }
+
+    TEST(PlanCacheTest, AddAndGet) {
+        PlanCache cache(10, 1024 * 1024);
+        ASSERT_FALSE(isInCache(&cache, "{a: 1}"));
+        ASSERT_OK(addToCache(&cache, "{a: 1}"));
+        ASSERT_EQUALS(cache.size(), 1U);
+        // Same shape.
+        ASSERT_TRUE(isInCache(&cache, "{a: 5}"));
+        ASSERT_FALSE(isInCache(&cache, "{b: 1}"));
+        // Adding the shape again is an error.
+        ASSERT_NOT_OK(addToCache(&cache, "{a: 2}"));
+
+        BSONObj stats = getStats(cache);
+        ASSERT_EQUALS(stats["entries"].numberLong(), 1);
+        ASSERT_EQUALS(stats["hits"].numberLong(), 1);
+        ASSERT_EQUALS(stats["misses"].numberLong(), 2);
+        ASSERT_EQUALS(stats["evictions"].numberLong(), 0);
+        ASSERT_GREATER_THAN(stats["bytes"].numberLong(), 0);
+    }
+
+    TEST(PlanCacheTest, UncacheableQueryNotAdded) {
+        PlanCache cache(10, 1024 * 1024);
+        ASSERT_NOT_OK(addToCache(&cache, "{}"));
+        ASSERT_EQUALS(cache.size(), 0U);
+    }
+
+    TEST(PlanCacheTest, EvictLeastRecentlyUsedByCount) {
+        PlanCache cache(2, 1024 * 1024);
+        ASSERT_OK(addToCache(&cache, "{a: 1}"));
+        ASSERT_OK(addToCache(&cache, "{b: 1}"));
+        // Touch {a} so that {b} is the least recently used.
+        ASSERT_TRUE(isInCache(&cache, "{a: 1}"));
+        ASSERT_OK(addToCache(&cache, "{c: 1}"));
+        ASSERT_EQUALS(cache.size(), 2U);
+        ASSERT_TRUE(isInCache(&cache, "{a: 1}"));
+        ASSERT_TRUE(isInCache(&cache, "{c: 1}"));
+        ASSERT_FALSE(isInCache(&cache, "{b: 1}"));
+        ASSERT_EQUALS(getStats(cache)["evictions"].numberLong(), 1);
+    }
+
+    TEST(PlanCacheTest, EvictByBytes) {
+        // Find out how big one entry is, then allow a little more than two.
+        long long entryBytes;
+        {
+            PlanCache cache(10, 1024 * 1024);
+            ASSERT_OK(addToCache(&cache, "{a: 1}"));
+            entryBytes = getStats(cache)["bytes"].numberLong();
+        }
+        PlanCache cache(10, entryBytes * 2 + entryBytes / 2);
+        ASSERT_OK(addToCache(&cache, "{a: 1}"));
+        ASSERT_OK(addToCache(&cache, "{b: 1}"));
+        ASSERT_OK(addToCache(&cache, "{c: 1}"));
+        ASSERT_EQUALS(cache.size(), 2U);
+        ASSERT_FALSE(isInCache(&cache, "{a: 1}"));
+        ASSERT_LESS_THAN_OR_EQUALS(getStats(cache)["bytes"].numberLong(), entryBytes * 2 + entryBytes / 2);
+
+        // An entry that can never fit isn't added.
+        PlanCache tiny(10, 1);
+        ASSERT_NOT_OK(addToCache(&tiny, "{a: 1}"));
+        ASSERT_EQUALS(tiny.size(), 0U);
+    }
+
+    TEST(PlanCacheTest, RemoveAndClear) {
+        PlanCache cache(10, 1024 * 1024);
+        ASSERT_OK(addToCache(&cache, "{a: 1}"));
+        ASSERT_OK(addToCache(&cache, "{b: 1}"));
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        ASSERT_OK(cache.remove(getPlanCacheKey(*cq)));
+        ASSERT_NOT_OK(cache.remove(getPlanCacheKey(*cq)));
+        ASSERT_EQUALS(cache.size(), 1U);
+        cache.clear();
+        ASSERT_EQUALS(cache.size(), 0U);
+        ASSERT_EQUALS(getStats(cache)["bytes"].numberLong(), 0);
+    }
+
+    TEST(PlanCacheTest, FeedbackIsBounded) {
+        PlanCache cache(10, 1024 * 1024);
+        ASSERT_OK(addToCache(&cache, "{a: 1}"));
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        PlanCacheKey key = getPlanCacheKey(*cq);
+        for (size_t i = 0; i < PlanCache::kMaxFeedback + 5; ++i) {
+            ASSERT_OK(cache.feedback(key, new PlanCacheEntryFeedback()));
+        }
+        ASSERT_NOT_OK(cache.feedback("nosuchkey", new PlanCacheEntryFeedback()));
+
+        BSONArrayBuilder arr;
+        cache.appendShapes(&arr);
+        BSONObj shapes = arr.arr();
+        ASSERT_EQUALS(shapes.nFields(), 1);
+        BSONObj shape = shapes.firstElement().Obj();
+        ASSERT_EQUALS(shape["query"].Obj(), fromjson("{a: 1}"));
+        ASSERT_EQUALS(shape["feedback"].numberLong(), static_cast<long long>(PlanCache::kMaxFeedback));
+    }
+
+    //
+    // Feedback driven eviction
+    //
+
+    TEST(PlanCacheTest, FeedbackKeepsPlanRunningAsTrialed) {
+        PlanCache cache(10, 1024 * 1024, 10.0);
+        ASSERT_OK(addToCacheWithTrial(&cache, "{a: 1}", 100, 50));
+        for (int i = 0; i < 10; ++i) {
+            // 5 works per result against 2 in the trial
+            ASSERT_OK(giveFeedback(&cache, "{a: 1}", 500, 100));
+        }
+        ASSERT_TRUE(isInCache(&cache, "{a: 1}"));
+        ASSERT_EQUALS(getStats(cache)["feedbackEvictions"].numberLong(), 0);
+    }
+
+    TEST(PlanCacheTest, FeedbackEvictsDegradedPlan) {
+        PlanCache cache(10, 1024 * 1024, 10.0);
+        ASSERT_OK(addToCacheWithTrial(&cache, "{a: 1}", 100, 50));
+        // Too few runs to decide.
+        for (size_t i = 0; i + 1 < PlanCache::kMinFeedbackToEvict; ++i) {
+            ASSERT_OK(giveFeedback(&cache, "{a: 1}", 10000, 10));
+        }
+        ASSERT_TRUE(isInCache(&cache, "{a: 1}"));
+
+        ASSERT_OK(giveFeedback(&cache, "{a: 1}", 10000, 10));
+        ASSERT_FALSE(isInCache(&cache, "{a: 1}"));
+        ASSERT_EQUALS(getStats(cache)["feedbackEvictions"].numberLong(), 1);
+
+        // The shape can be cached again.
+        ASSERT_OK(addToCacheWithTrial(&cache, "{a: 1}", 100, 50));
+        ASSERT_TRUE(isInCache(&cache, "{a: 1}"));
+    }
+
+    TEST(PlanCacheTest, FeedbackWithoutResultsCountsAsDegraded) {
+        PlanCache cache(10, 1024 * 1024, 10.0);
+        ASSERT_OK(addToCacheWithTrial(&cache, "{a: 1}", 100, 100));
+        for (size_t i = 0; i < PlanCache::kMinFeedbackToEvict; ++i) {
+            ASSERT_OK(giveFeedback(&cache, "{a: 1}", 5000, 0));
+        }
+        ASSERT_FALSE(isInCache(&cache, "{a: 1}"));
     }
 
 }  // namespace
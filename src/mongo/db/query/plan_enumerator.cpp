@@ -293,30 +293,31 @@ namespace mongo {
 
                 const IndexEntry& thisIndex = (*_indices)[it->first];
 
-                // If the index is multikey, we only assign one pred to it.  We also skip
-                // compounding.  TODO: is this also true for 2d and 2dsphere indices?  can they be
-                // multikey but still compoundable?  (How do we get covering for them?)
-                if (thisIndex.multikey) {
+                // If the first field is multikey, we only assign one pred to it.  Compounding
+                // stops at the first multikey field.  TODO: is this also true for 2d and 2dsphere
+                // indices?  can they be multikey but still compoundable?  (How do we get
+                // covering for them?)
+                if (thisIndex.isMultikeyField(0)) {
                     indexAssign.preds.push_back(it->second[0]);
                     indexAssign.positions.push_back(0);
                 }
                 else {
-                    // The index isn't multikey.  Assign all preds to it.  The planner will
+                    // The field isn't multikey.  Assign all preds to it.  The planner will
                     // do something smart with the bounds.
                     indexAssign.preds = it->second;
 
                     // Since everything in assign.preds prefixes the index, they all go
                     // at position '0' in the index, the first position.
                     indexAssign.positions.resize(indexAssign.preds.size(), 0);
+                }
 
-                    // And now we begin compound analysis.
+                // And now we begin compound analysis.
 
-                    // Find everything that could use assign.index but isn't a pred over
-                    // the first field of that index.
-                    IndexToPredMap::iterator compIt = idxToNotFirst.find(indexAssign.index);
-                    if (compIt != idxToNotFirst.end()) {
-                        compound(compIt->second, thisIndex, &indexAssign);
-                    }
+                // Find everything that could use assign.index but isn't a pred over
+                // the first field of that index.
+                IndexToPredMap::iterator compIt = idxToNotFirst.find(indexAssign.index);
+                if (compIt != idxToNotFirst.end()) {
+                    compound(compIt->second, thisIndex, &indexAssign);
                 }
 
                 AndEnumerableState state;
@@ -325,6 +326,87 @@ namespace mongo {
                 return true;
             }
 
+            // In the simplest case, an AndAssignment picks indices like a PredicateAssignment.  To
+            // be indexed we must only pick one index
+            //
+            // Complications:
+            //
+            // Some of our child predicates cannot be answered without an index.  As such, the
+            // indices that those predicates require must always be outputted.  We store these
+            // mandatory index assignments in 'mandatoryIndices'.
+            //
+            // Some of our children may not be predicates.  We may have ORs (or array operators) as
+            // children.  If one of these subtrees provides an index, the AND is indexed.  We store
+            // these subtree choices in 'subnodes'.
+            //
+            // With the above two cases out of the way, we can focus on the remaining case: what to
+            // do with our children that are leaf predicates.
+            //
+            // Guiding principles for index assignment to leaf predicates:
+            //
+            // 1. If we assign an index to {x:{$gt: 5}} we should assign the same index to
+            //    {x:{$lt: 50}}.  That is, an index assignment should include all predicates
+            //    over its leading field.
+            //
+            // 2. If we have the index {a:1, b:1} and we assign it to {a: 5} we should assign it
+            //    to {b:7}, since with a predicate over the first field of the compound index,
+            //    the second field can be bounded as well.  We may only assign indices to predicates
+            //    if all fields to the left of the index field are constrained.
+
+            // First, add the state of using each subnode.
+            for (size_t i = 0; i < subnodes.size(); ++i) {
+                AndEnumerableState aes;
+                aes.subnodesToIndex.push_back(subnodes[i]);
+                andAssignment->choices.push_back(aes);
+            }
+
+            // For each FIRST, we assign nodes to it.
+            for (IndexToPredMap::iterator it = idxToFirst.begin();
+                 it != idxToFirst.end(); ++it) {
+
+                // The assignment we're filling out.
+                OneIndexAssignment indexAssign;
+
+                // This is the index we assign to.
+                indexAssign.index = it->first;
+
+                const IndexEntry& thisIndex = (*_indices)[it->first];
+
+                // If the first field is multikey, we only assign one pred to it.  Compounding
+                // stops at the first multikey field.  TODO: is this also true for 2d and 2dsphere
+                // indices?  can they be multikey but still compoundable?
+                if (thisIndex.isMultikeyField(0)) {
+                    // TODO: could pick better pred than first but not too worried since we should
+                    // really be isecting indices here.  Just take the first pred.  We don't assign
+                    // any other preds to this field.  The planner will intersect the preds and this
+                    // enumeration strategy is just one index at a time.
+                    indexAssign.preds.push_back(it->second[0]);
+                    indexAssign.positions.push_back(0);
+                }
+                else {
+                    // The field isn't multikey.  Assign all preds to it.  The planner will
+                    // intersect the bounds.
+                    indexAssign.preds = it->second;
+
+                    // Since everything in assign.preds prefixes the index, they all go
+                    // at position '0' in the index, the first position.
+                    indexAssign.positions.resize(indexAssign.preds.size(), 0);
+                }
+
+                // Find everything that could use assign.index but isn't a pred over
+                // the first field of that index.
+                IndexToPredMap::iterator compIt = idxToNotFirst.find(indexAssign.index);
+                if (compIt != idxToNotFirst.end()) {
+                    compound(compIt->second, thisIndex, &indexAssign);
+                }
+
+                AndEnumerableState state;
+                state.assignments.push_back(indexAssign);
+                andAssignment->choices.push_back(state);
+            }
+
+            // Intersection plans come after the one index plans: the ranker breaks ties in favor
+            // of the first plan.
             if (_ixisect) {
                 // Hardcoded "look at all power sets of size 2" search.
                 for (IndexToPredMap::iterator firstIt = idxToFirst.begin();
@@ -343,21 +425,13 @@ namespace mongo {
                     // We create a scan per predicate so if we have >1 predicate we'll already
                     // have at least 2 scans (one predicate per scan as the planner can't
                     // intersect bounds when the index is multikey), so we stop here.
-                    if (firstIndex.multikey && firstAssign.preds.size() > 1) {
+                    if (firstIndex.isMultikeyField(0) && firstAssign.preds.size() > 1) {
                         AndEnumerableState state;
                         state.assignments.push_back(firstAssign);
                         andAssignment->choices.push_back(state);
                         continue;
                     }
 
-                    // Output (subnode, firstAssign) pairs.
-                    for (size_t i = 0; i < subnodes.size(); ++i) {
-                        AndEnumerableState indexAndSubnode;
-                        indexAndSubnode.assignments.push_back(firstAssign);
-                        indexAndSubnode.subnodesToIndex.push_back(subnodes[i]);
-                        andAssignment->choices.push_back(indexAndSubnode);
-                    }
-
                     // We keep track of what preds were compounded and we DO NOT let them become
                     // additional index assignments.  Example: what if firstAssign is the index (x,
                     // y) and we're considering index y?  We don't want to assign 'y' to anything we
@@ -368,8 +442,8 @@ namespace mongo {
                     IndexToPredMap::iterator firstIndexCompound =
                         idxToNotFirst.find(firstAssign.index);
 
-                    // Can't compound with multikey indices.
-                    if (!firstIndex.multikey && firstIndexCompound != idxToNotFirst.end()) {
+                    // Can't compound with multikey fields, compound() stops at them.
+                    if (firstIndexCompound != idxToNotFirst.end()) {
                         // Assigns MatchExpressions to compound idx.
                         compound(firstIndexCompound->second, firstIndex, &firstAssign);
                     }
@@ -379,6 +453,14 @@ namespace mongo {
                         predsAssigned.insert(firstAssign.preds[i]);
                     }
 
+                    // Output (subnode, firstAssign) pairs.
+                    for (size_t i = 0; i < subnodes.size(); ++i) {
+                        AndEnumerableState indexAndSubnode;
+                        indexAndSubnode.assignments.push_back(firstAssign);
+                        indexAndSubnode.subnodesToIndex.push_back(subnodes[i]);
+                        andAssignment->choices.push_back(indexAndSubnode);
+                    }
+
                     // Start looking at all other indices to find one that we want to bundle
                     // with firstAssign.
                     IndexToPredMap::iterator secondIt = firstIt;
@@ -390,7 +472,7 @@ namespace mongo {
                         // want to have it as an additional assignment.  Eventually, firstIt will be
                         // equal to the current value of secondIt and we'll assign every pred for
                         // this mapping to the index.
-                        if (secondIndex.multikey && secondIt->second.size() > 1) {
+                        if (secondIndex.isMultikeyField(0) && secondIt->second.size() > 1) {
                             continue;
                         }
 
@@ -411,7 +493,7 @@ namespace mongo {
                         IndexToPredMap::iterator secondIndexCompound =
                             idxToNotFirst.find(secondAssign.index);
 
-                        if (!secondIndex.multikey && secondIndexCompound != idxToNotFirst.end()) {
+                        if (secondIndexCompound != idxToNotFirst.end()) {
                             // We must remove any elements of 'predsAssigned' from consideration.
                             vector<MatchExpression*> tryCompound;
                             const vector<MatchExpression*>& couldCompound
@@ -449,87 +531,57 @@ namespace mongo {
                         andAssignment->choices.push_back(state);
                     }
                 }
-            }
 
-            // In the simplest case, an AndAssignment picks indices like a PredicateAssignment.  To
-            // be indexed we must only pick one index
-            //
-            // Complications:
-            //
-            // Some of our child predicates cannot be answered without an index.  As such, the
-            // indices that those predicates require must always be outputted.  We store these
-            // mandatory index assignments in 'mandatoryIndices'.
-            //
-            // Some of our children may not be predicates.  We may have ORs (or array operators) as
-            // children.  If one of these subtrees provides an index, the AND is indexed.  We store
-            // these subtree choices in 'subnodes'.
-            //
-            // With the above two cases out of the way, we can focus on the remaining case: what to
-            // do with our children that are leaf predicates.
-            //
-            // Guiding principles for index assignment to leaf predicates:
-            //
-            // 1. If we assign an index to {x:{$gt: 5}} we should assign the same index to
-            //    {x:{$lt: 50}}.  That is, an index assignment should include all predicates
-            //    over its leading field.
-            //
-            // 2. If we have the index {a:1, b:1} and we assign it to {a: 5} we should assign it
-            //    to {b:7}, since with a predicate over the first field of the compound index,
-            //    the second field can be bounded as well.  We may only assign indices to predicates
-            //    if all fields to the left of the index field are constrained.
-
-            // First, add the state of using each subnode.
-            for (size_t i = 0; i < subnodes.size(); ++i) {
-                AndEnumerableState aes;
-                aes.subnodesToIndex.push_back(subnodes[i]);
-                andAssignment->choices.push_back(aes);
-            }
-
-            // For each FIRST, we assign nodes to it.
-            for (IndexToPredMap::iterator it = idxToFirst.begin();
-                 it != idxToFirst.end(); ++it) {
-
-                // The assignment we're filling out.
-                OneIndexAssignment indexAssign;
-
-                // This is the index we assign to.
-                indexAssign.index = it->first;
-
-                const IndexEntry& thisIndex = (*_indices)[it->first];
-
-                // If the index is multikey, we only assign one pred to it.  We also skip
-                // compounding.  TODO: is this also true for 2d and 2dsphere indices?  can they be
-                // multikey but still compoundable?
-                if (thisIndex.multikey) {
-                    // TODO: could pick better pred than first but not too worried since we should
-                    // really be isecting indices here.  Just take the first pred.  We don't assign
-                    // any other preds to this index.  The planner will intersect the preds and this
-                    // enumeration strategy is just one index at a time.
-                    indexAssign.preds.push_back(it->second[0]);
-                    indexAssign.positions.push_back(0);
-                }
-                else {
-                    // The index isn't multikey.  Assign all preds to it.  The planner will
-                    // intersect the bounds.
-                    indexAssign.preds = it->second;
+                // Pairs don't get the most out of a conjunction over several single field
+                // indices, e.g. {a: 1, b: 1, c: 1} with indices on each of a, b and c.  Also
+                // output the intersection of every index that has a predicate no index before it
+                // took.
+                andAssignment->choices.push_back(AndEnumerableState());
+                AndEnumerableState& all = andAssignment->choices.back();
+                set<MatchExpression*> predsAssigned;
+                for (IndexToPredMap::iterator it = idxToFirst.begin();
+                     it != idxToFirst.end(); ++it) {
+                    const IndexEntry& thisIndex = (*_indices)[it->first];
+                    // As above, the multikey case is handled by assigning it all its preds.
+                    if (thisIndex.isMultikeyField(0) && it->second.size() > 1) {
+                        continue;
+                    }
 
-                    // Since everything in assign.preds prefixes the index, they all go
-                    // at position '0' in the index, the first position.
-                    indexAssign.positions.resize(indexAssign.preds.size(), 0);
+                    OneIndexAssignment indexAssign;
+                    indexAssign.index = it->first;
+                    for (size_t i = 0; i < it->second.size(); ++i) {
+                        if (predsAssigned.end() == predsAssigned.find(it->second[i])) {
+                            indexAssign.preds.push_back(it->second[i]);
+                            indexAssign.positions.push_back(0);
+                        }
+                    }
+                    if (indexAssign.preds.empty()) { continue; }
 
-                    // Find everything that could use assign.index but isn't a pred over
-                    // the first field of that index.
                     IndexToPredMap::iterator compIt = idxToNotFirst.find(indexAssign.index);
                     if (compIt != idxToNotFirst.end()) {
-                        compound(compIt->second, thisIndex, &indexAssign);
+                        vector<MatchExpression*> tryCompound;
+                        for (size_t i = 0; i < compIt->second.size(); ++i) {
+                            if (predsAssigned.end() == predsAssigned.find(compIt->second[i])) {
+                                tryCompound.push_back(compIt->second[i]);
+                            }
+                        }
+                        if (tryCompound.size()) {
+                            compound(tryCompound, thisIndex, &indexAssign);
+                        }
                     }
-                }
 
-                AndEnumerableState state;
-                state.assignments.push_back(indexAssign);
-                andAssignment->choices.push_back(state);
+                    for (size_t i = 0; i < indexAssign.preds.size(); ++i) {
+                        predsAssigned.insert(indexAssign.preds[i]);
+                    }
+                    all.assignments.push_back(indexAssign);
+                }
+                // Two or fewer were output above.
+                if (all.assignments.size() <= 2) {
+                    andAssignment->choices.pop_back();
+                }
             }
 
+
             return true;
         }
 
@@ -555,6 +607,9 @@ namespace mongo {
         while (kpIt.more()) {
             BSONElement keyElt = kpIt.next();
             ++posInIdx;
+            // Bounds on a field with more than one value per document can't be combined with
+            // those on the fields before it.
+            if (thisIndex.isMultikeyField(posInIdx)) { break; }
             // We must assign fields contiguously from the left.
             bool fieldAssigned = false;
             for (size_t j = 0; j < tryCompound.size(); ++j) {
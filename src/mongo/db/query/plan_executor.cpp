@@ -33,11 +33,25 @@
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/server_parameters.h"
 
 namespace mongo {
 
+    // How many results a plan whose stages all support it is asked for per call.  0 runs every
+    // plan a result at a time.
+    MONGO_EXPORT_SERVER_PARAMETER(planExecutorBatchSize, int, 64);
+
     PlanExecutor::PlanExecutor(WorkingSet* ws, PlanStage* rt)
-        : _workingSet(ws) , _root(rt) , _killed(false) {
+        : _workingSet(ws),
+          _root(rt),
+          _killed(false),
+          _maxBatchSize(0),
+          _batchSize(1),
+          _batchPos(0) {
+
+        if (planExecutorBatchSize > 0 && _root->supportsBatch()) {
+            _maxBatchSize = planExecutorBatchSize;
+        }
     }
 
     PlanExecutor::~PlanExecutor() {
@@ -63,7 +77,18 @@ namespace mongo {
     }
 
     void PlanExecutor::invalidate(const DiskLoc& dl) {
-        if (!_killed) { _root->invalidate(dl); }
+        if (_killed) { return; }
+
+        _root->invalidate(dl);
+
+        // Results of the last batch have left the tree, so protecting them is up to us.
+        for (size_t i = _batchPos; i < _batch.size(); ++i) {
+            if (WorkingSet::INVALID_ID == _batch[i]) { continue; }
+            WorkingSetMember* member = _workingSet->get(_batch[i]);
+            if (member->hasLoc() && member->loc == dl) {
+                WorkingSetCommon::fetchAndInvalidateLoc(member);
+            }
+        }
     }
 
     void PlanExecutor::setYieldPolicy(Runner::YieldPolicy policy) {
@@ -79,6 +104,11 @@ namespace mongo {
         if (_killed) { return Runner::RUNNER_DEAD; }
 
         for (;;) {
+            // What's left of the last batch goes out before any more work is done.
+            if (_batchPos < _batch.size()) {
+                return returnResult(_batch[_batchPos++], objOut, dlOut);
+            }
+
             // Yield, if we can yield ourselves.
             if (NULL != _yieldPolicy.get() && _yieldPolicy->shouldYield()) {
                 saveState();
@@ -88,39 +118,28 @@ namespace mongo {
             }
 
             WorkingSetID id;
-            PlanStage::StageState code = _root->work(&id);
-
-            if (PlanStage::ADVANCED == code) {
-                WorkingSetMember* member = _workingSet->get(id);
-
-                if (NULL != objOut) {
-                    if (WorkingSetMember::LOC_AND_IDX == member->state) {
-                        if (1 != member->keyData.size()) {
-                            _workingSet->free(id);
-                            return Runner::RUNNER_ERROR;
-                        }
-                        *objOut = member->keyData[0].keyData;
-                    }
-                    else if (member->hasObj()) {
-                        *objOut = member->obj;
-                    }
-                    else {
-                        _workingSet->free(id);
-                        return Runner::RUNNER_ERROR;
-                    }
+            PlanStage::StageState code;
+
+            if (_maxBatchSize > 0) {
+                _batch.clear();
+                _batchPos = 0;
+                code = _root->workBatch(_batchSize, &_batch);
+                _batchSize = std::min(2 * _batchSize, _maxBatchSize);
+                if (PlanStage::NEED_FETCH == code) {
+                    id = _batch[0];
+                    _batch.clear();
                 }
+            }
+            else {
+                code = _root->work(&id);
+            }
 
-                if (NULL != dlOut) {
-                    if (member->hasLoc()) {
-                        *dlOut = member->loc;
-                    }
-                    else {
-                        _workingSet->free(id);
-                        return Runner::RUNNER_ERROR;
-                    }
+            if (PlanStage::ADVANCED == code) {
+                if (_maxBatchSize > 0) {
+                    // Picked up at the top of the loop.
+                    continue;
                 }
-                _workingSet->free(id);
-                return Runner::RUNNER_ADVANCED;
+                return returnResult(id, objOut, dlOut);
             }
             else if (PlanStage::NEED_TIME == code) {
                 // Fall through to yield check at end of large conditional.
@@ -172,8 +191,49 @@ namespace mongo {
         }
     }
 
+    Runner::RunnerState PlanExecutor::returnResult(WorkingSetID id,
+                                                   BSONObj* objOut,
+                                                   DiskLoc* dlOut) {
+        // A stage that only counts, like Count, advances with no member and nothing to return.
+        if (WorkingSet::INVALID_ID == id) {
+            return (NULL == objOut && NULL == dlOut) ? Runner::RUNNER_ADVANCED
+                                                     : Runner::RUNNER_ERROR;
+        }
+
+        WorkingSetMember* member = _workingSet->get(id);
+
+        if (NULL != objOut) {
+            if (WorkingSetMember::LOC_AND_IDX == member->state) {
+                if (1 != member->keyData.size()) {
+                    _workingSet->free(id);
+                    return Runner::RUNNER_ERROR;
+                }
+                *objOut = member->keyData[0].keyData;
+            }
+            else if (member->hasObj()) {
+                *objOut = member->obj;
+            }
+            else {
+                _workingSet->free(id);
+                return Runner::RUNNER_ERROR;
+            }
+        }
+
+        if (NULL != dlOut) {
+            if (member->hasLoc()) {
+                *dlOut = member->loc;
+            }
+            else {
+                _workingSet->free(id);
+                return Runner::RUNNER_ERROR;
+            }
+        }
+        _workingSet->free(id);
+        return Runner::RUNNER_ADVANCED;
+    }
+
     bool PlanExecutor::isEOF() {
-        return _killed || _root->isEOF();
+        return _killed || (_batchPos == _batch.size() && _root->isEOF());
     }
 
     void PlanExecutor::kill() {
@@ -29,8 +29,10 @@
 #pragma once
 
 #include <boost/scoped_ptr.hpp>
+#include <vector>
 
 #include "mongo/base/status.h"
+#include "mongo/db/exec/working_set.h"
 #include "mongo/db/query/runner.h"
 #include "mongo/db/query/runner_yield_policy.h"
 
@@ -40,7 +42,6 @@ namespace mongo {
     class DiskLoc;
     class PlanStage;
     struct PlanStageStats;
-    class WorkingSet;
 
     /**
      * A PlanExecutor is the abstraction that knows how to crank a tree of stages into execution.
@@ -99,6 +100,12 @@ namespace mongo {
         void kill();
 
     private:
+        /**
+         * Hand the result 'id' from our root out through the out parameters of getNext(...)
+         * and free it.
+         */
+        Runner::RunnerState returnResult(WorkingSetID id, BSONObj* objOut, DiskLoc* dlOut);
+
         boost::scoped_ptr<WorkingSet> _workingSet;
         boost::scoped_ptr<PlanStage> _root;
         boost::scoped_ptr<RunnerYieldPolicy> _yieldPolicy;
@@ -106,6 +113,14 @@ namespace mongo {
         // Did somebody drop an index we care about or the namespace we're looking at?  If so,
         // we'll be killed.
         bool _killed;
+
+        // The most results to ask our root for at once, 0 if it can't do better than one.  We
+        // start at one and double, so that a caller that only wants a few results doesn't pay
+        // for a whole batch.  The results of the last batch go out from _batchPos on.
+        size_t _maxBatchSize;
+        size_t _batchSize;
+        std::vector<WorkingSetID> _batch;
+        size_t _batchPos;
     };
 
 }  // namespace mongo
@@ -32,6 +32,7 @@
 
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/exec/working_set.h"
+#include "mongo/db/query/index_histogram.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/qlog.h"
 
@@ -52,6 +53,10 @@ namespace mongo {
         double maxScore = 0;
         size_t bestChild = numeric_limits<size_t>::max();
         for (size_t i = 0; i < statTrees.size(); ++i) {
+            if (candidates[i].failed || candidates[i].eliminated) {
+                QLOG() << "not scoring plan " << i << ", it failed or was eliminated\n";
+                continue;
+            }
             QLOG() << "scoring plan " << i << ":\n" << candidates[i].solution->toString();
             double score = scoreTree(statTrees[i]);
             QLOG() << "score = " << score << endl;
@@ -80,6 +85,92 @@ namespace mongo {
         return bestChild;
     }
 
+    const double PlanRanker::kCostRatio = 100;
+
+    // static
+    double PlanRanker::estimateReads(const QuerySolutionNode* node,
+                                     const IndexHistograms& histograms,
+                                     double numRecords) {
+        if (STAGE_COLLSCAN == node->getType()) {
+            return numRecords;
+        }
+
+        if (STAGE_IXSCAN == node->getType()) {
+            const IndexScanNode* ixn = static_cast<const IndexScanNode*>(node);
+            if (ixn->bounds.isSimpleRange || ixn->bounds.fields.empty()) {
+                return -1;
+            }
+            for (size_t i = 0; i < histograms.size(); ++i) {
+                if (0 == histograms[i].first.woCompare(ixn->indexKeyPattern)) {
+                    // Only the leading field is known, so this can overestimate.
+                    return histograms[i].second->estimate(ixn->bounds.fields[0]);
+                }
+            }
+            return -1;
+        }
+
+        // Geo, text and the like.
+        if (node->children.empty()) {
+            return -1;
+        }
+
+        // Everything else reads what its children read.
+        double reads = 0;
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            double childReads = estimateReads(node->children[i], histograms, numRecords);
+            if (childReads < 0) {
+                return -1;
+            }
+            reads += childReads;
+        }
+        return reads;
+    }
+
+    // static
+    bool PlanRanker::pickByCost(const vector<QuerySolution*>& solutions,
+                                const IndexHistograms& histograms,
+                                double numRecords,
+                                size_t* out) {
+        if (solutions.size() < 2) {
+            return false;
+        }
+
+        vector<double> reads;
+        for (size_t i = 0; i < solutions.size(); ++i) {
+            double r = estimateReads(solutions[i]->root.get(), histograms, numRecords);
+            if (r < 0) {
+                QLOG() << "can't estimate the cost of plan " << i << endl;
+                return false;
+            }
+            QLOG() << "plan " << i << " is estimated to read " << r << endl;
+            reads.push_back(r);
+        }
+
+        size_t cheapest = 0;
+        for (size_t i = 1; i < reads.size(); ++i) {
+            if (reads[i] < reads[cheapest]) {
+                cheapest = i;
+            }
+        }
+
+        for (size_t i = 0; i < reads.size(); ++i) {
+            if (i == cheapest) { continue; }
+            // Add one so that estimates of nothing at all still need a margin.
+            if ((reads[cheapest] + 1) * kCostRatio > reads[i] + 1) {
+                return false;
+            }
+            // A blocking sort on a bad estimate could run out of memory where racing would
+            // have fallen back to a plan that doesn't sort.
+            if (solutions[cheapest]->hasSortStage && !solutions[i]->hasSortStage) {
+                return false;
+            }
+        }
+
+        QLOG() << "picking plan " << cheapest << " by cost" << endl;
+        *out = cheapest;
+        return true;
+    }
+
     // TODO: Move this out.  This is a signal for ranking but will become its own complicated
     // stats-collecting beast.
     double computeSelectivity(const PlanStageStats* stats) {
@@ -142,11 +233,20 @@ namespace mongo {
             noFetchBonus = 1 - 0.001;
         }
 
-        double score = baseScore + productivity + noFetchBonus;
+        // An intersection reads more than one index, and a hashed one buffers the whole of its
+        // first child, so when it is only as productive as a plan that uses one index we prefer
+        // the latter.
+        double noIxisectBonus = 0.001;
+        if (hasStage(STAGE_AND_HASH, stats) || hasStage(STAGE_AND_SORTED, stats)) {
+            noIxisectBonus = 0;
+        }
+
+        double score = baseScore + productivity + noFetchBonus + noIxisectBonus;
 
         QLOG() << "score (" << score << ") = baseScore (" << baseScore << ")"
                                      <<  " + productivity(" << productivity << ")"
                                      <<  " + noFetchBonus(" << noFetchBonus << ")"
+                                     <<  " + noIxisectBonus(" << noIxisectBonus << ")"
                                      << endl;
 
         return score;
@@ -39,20 +39,51 @@
 namespace mongo {
 
     struct CandidatePlan;
+    class IndexHistogram;
     struct PlanRankingDecision;
 
+    // Histograms of the leading fields of a collection's indexes, by index key pattern.
+    typedef std::vector<std::pair<BSONObj, const IndexHistogram*> > IndexHistograms;
+
     /**
      * Ranks 2 or more plans.
      */
     class PlanRanker {
     public:
         /**
-         * Returns index in 'candidates' of which plan is best.
+         * Returns index in 'candidates' of which plan is best.  Failed and eliminated candidates
+         * are never picked.
          * If 'why' is not NULL, populates it with information relevant to why that plan was picked.
          */
         static size_t pickBestPlan(const vector<CandidatePlan>& candidates,
                                    PlanRankingDecision* why);
+
+        /**
+         * Pick a plan without racing, from estimates of how many keys and documents each of
+         * 'solutions' reads: collection scans read 'numRecords' documents and index scans as
+         * many keys as 'histograms' give for the bounds of their leading field.
+         *
+         * If one solution is estimated to read at least kCostRatio times less than every other
+         * one, sets *out to its index and returns true.  Returns false, leaving the choice to
+         * racing, if any solution can't be estimated or none is that clearly cheaper.
+         */
+        static bool pickByCost(const vector<QuerySolution*>& solutions,
+                               const IndexHistograms& histograms,
+                               double numRecords,
+                               size_t* out);
+
+        // How much cheaper a plan has to be estimated to be to be picked without racing.
+        static const double kCostRatio;
+
     private:
+        /**
+         * Estimated keys and documents read by the subtree rooted at 'node', or a negative
+         * number if it can't be estimated.
+         */
+        static double estimateReads(const QuerySolutionNode* node,
+                                    const IndexHistograms& histograms,
+                                    double numRecords);
+
         /**
          * Assign the stats tree a 'goodness' score.  Used internally.
          */
@@ -65,7 +96,7 @@ namespace mongo {
      */
     struct CandidatePlan {
         CandidatePlan(QuerySolution* s, PlanStage* r, WorkingSet* w)
-            : solution(s), root(r), ws(w), failed(false) { }
+            : solution(s), root(r), ws(w), failed(false), eliminated(false), works(0) { }
 
         QuerySolution* solution;
         PlanStage* root;
@@ -75,6 +106,12 @@ namespace mongo {
         std::list<WorkingSetID> results;
 
         bool failed;
+
+        // Dropped from the competition early as a clear loser.  Not ranked.
+        bool eliminated;
+
+        // How many times the plan was worked during the competition.
+        size_t works;
     };
 
     /**
@@ -84,6 +121,8 @@ namespace mongo {
     struct PlanRankingDecision {
         PlanRankingDecision() : statsOfWinner(NULL), onlyOneSolution(false) { }
 
+        ~PlanRankingDecision() { delete statsOfWinner; }
+
         // Owned by us.
         PlanStageStats* statsOfWinner;
 
@@ -30,6 +30,7 @@
 
 #include <vector>
 
+#include "mongo/db/index_names.h"
 #include "mongo/db/matcher/expression_array.h"
 #include "mongo/db/matcher/expression_geo.h"
 #include "mongo/db/matcher/expression_text.h"
@@ -138,12 +139,13 @@ namespace mongo {
             IndexScanNode* isn = new IndexScanNode();
             isn->indexKeyPattern = index.keyPattern;
             isn->indexIsMultiKey = index.multikey;
+            isn->indexMultikeyFields = index.multikeyFields;
             isn->bounds.fields.resize(index.keyPattern.nFields());
             isn->maxScan = query.getParsed().getMaxScan();
             isn->addKeyMetadata = query.getParsed().returnKey();
 
             IndexBoundsBuilder::translate(expr, index.keyPattern.firstElement(),
-                                          &isn->bounds.fields[0], tightnessOut);
+                                          &isn->bounds.fields[0], tightnessOut, index.infoObj);
 
             // QLOG() << "bounds are " << isn->bounds.toString() << " exact " << *exact << endl;
             return isn;
@@ -198,15 +200,17 @@ namespace mongo {
         OrderedIntervalList* oil = &boundsToFillOut->fields[pos];
 
         if (boundsToFillOut->fields[pos].name.empty()) {
-            IndexBoundsBuilder::translate(expr, keyElt, oil, tightnessOut);
+            IndexBoundsBuilder::translate(expr, keyElt, oil, tightnessOut, index.infoObj);
         }
         else {
             if (MatchExpression::AND == mergeType) {
-                IndexBoundsBuilder::translateAndIntersect(expr, keyElt, oil, tightnessOut);
+                IndexBoundsBuilder::translateAndIntersect(expr, keyElt, oil, tightnessOut,
+                                                          index.infoObj);
             }
             else {
                 verify(MatchExpression::OR == mergeType);
-                IndexBoundsBuilder::translateAndUnion(expr, keyElt, oil, tightnessOut);
+                IndexBoundsBuilder::translateAndUnion(expr, keyElt, oil, tightnessOut,
+                                                      index.infoObj);
             }
         }
     }
@@ -421,7 +425,11 @@ namespace mongo {
             //    Therefore we can intersect bounds.
 
             // TODO: we should also merge if we're in an array operator, but only when we figure out index13.js.
-            if (NULL != currentScan.get() && (currentIndexNumber == ixtag->index) && !indices[currentIndexNumber].multikey) {
+            //
+            // 4. None of these apply to a field that never has more than one value in a document,
+            //    even if other fields of the index do.
+            if (NULL != currentScan.get() && (currentIndexNumber == ixtag->index)
+                && !indices[currentIndexNumber].isMultikeyField(ixtag->pos)) {
                 // The child uses the same index we're currently building a scan for.  Merge
                 // the bounds and filters.
                 verify(currentIndexNumber == ixtag->index);
@@ -662,31 +670,33 @@ namespace mongo {
 
             if (!query.getParsed().getSort().isEmpty()) {
                 const BSONObj& desiredSort = query.getParsed().getSort();
+                const BSONObj reverseSort = QueryPlannerCommon::reverseSortObj(desiredSort);
+
+                // We can merge the children if each provides the sort.  A child that provides
+                // the reverse of the sort can have its scans reversed.
+                vector<bool> reverseChild(ixscanNodes.size(), false);
+                shouldMergeSort = true;
+                for (size_t i = 0; i < ixscanNodes.size(); ++i) {
+                    ixscanNodes[i]->computeProperties();
+                    const BSONObjSet& sorts = ixscanNodes[i]->getSort();
+                    if (sorts.end() != sorts.find(desiredSort)) {
+                        continue;
+                    }
+                    if (sorts.end() != sorts.find(reverseSort)) {
+                        reverseChild[i] = true;
+                        continue;
+                    }
+                    shouldMergeSort = false;
+                    break;
+                }
 
-                // If there exists a sort order that is present in each child, we can merge them and
-                // maintain that sort order / those sort orders.
-                ixscanNodes[0]->computeProperties();
-                BSONObjSet sharedSortOrders = ixscanNodes[0]->getSort();
-
-                if (!sharedSortOrders.empty()) {
-                    for (size_t i = 1; i < ixscanNodes.size(); ++i) {
-                        ixscanNodes[i]->computeProperties();
-                        BSONObjSet isect;
-                        set_intersection(sharedSortOrders.begin(),
-                                sharedSortOrders.end(),
-                                ixscanNodes[i]->getSort().begin(),
-                                ixscanNodes[i]->getSort().end(),
-                                std::inserter(isect, isect.end()),
-                                BSONObjCmp());
-                        sharedSortOrders = isect;
-                        if (sharedSortOrders.empty()) {
-                            break;
+                if (shouldMergeSort) {
+                    for (size_t i = 0; i < ixscanNodes.size(); ++i) {
+                        if (reverseChild[i]) {
+                            QueryPlannerCommon::reverseScans(ixscanNodes[i]);
                         }
                     }
                 }
-
-                // XXX: consider reversing?
-                shouldMergeSort = (sharedSortOrders.end() != sharedSortOrders.find(desiredSort));
             }
 
             if (shouldMergeSort) {
@@ -844,6 +854,7 @@ namespace mongo {
         IndexScanNode* isn = new IndexScanNode();
         isn->indexKeyPattern = index.keyPattern;
         isn->indexIsMultiKey = index.multikey;
+        isn->indexMultikeyFields = index.multikeyFields;
         isn->bounds.fields.resize(index.keyPattern.nFields());
         isn->maxScan = query.getParsed().getMaxScan();
         isn->addKeyMetadata = query.getParsed().returnKey();
@@ -928,6 +939,7 @@ namespace mongo {
         IndexScanNode* isn = new IndexScanNode();
         isn->indexKeyPattern = index.keyPattern;
         isn->indexIsMultiKey = index.multikey;
+        isn->indexMultikeyFields = index.multikeyFields;
         isn->direction = 1;
         isn->maxScan = query.getParsed().getMaxScan();
         isn->addKeyMetadata = query.getParsed().returnKey();
@@ -956,4 +968,113 @@ namespace mongo {
         return solnRoot;
     }
 
+    namespace {
+
+        // The predicates a skip scan turns into bounds.  Anything else is left to the filter.
+        bool isSkipScanPredicate(const MatchExpression* expr) {
+            switch (expr->matchType()) {
+            case MatchExpression::EQ:
+            case MatchExpression::LT:
+            case MatchExpression::LTE:
+            case MatchExpression::GT:
+            case MatchExpression::GTE:
+            case MatchExpression::MATCH_IN:
+            case MatchExpression::REGEX:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+    }  // namespace
+
+    // static
+    QuerySolutionNode* QueryPlannerAccess::makeSkipScan(const IndexEntry& index,
+                                                        const CanonicalQuery& query,
+                                                        const QueryPlannerParams& params) {
+        // Seeking past a leading prefix relies on every field being stored in key order.
+        const string pluginName = IndexNames::findPluginName(index.keyPattern);
+        if (!pluginName.empty() && IndexNames::POSTING != pluginName) {
+            return NULL;
+        }
+
+        // A sparse index may be missing documents the filter would match.
+        if (index.sparse) {
+            return NULL;
+        }
+
+        // Only predicates AND-related at the top of the tree can bound the scan.
+        vector<const MatchExpression*> preds;
+        MatchExpression* root = query.root();
+        if (MatchExpression::AND == root->matchType()) {
+            for (size_t i = 0; i < root->numChildren(); ++i) {
+                preds.push_back(root->getChild(i));
+            }
+        }
+        else {
+            preds.push_back(root);
+        }
+
+        auto_ptr<IndexScanNode> isn(new IndexScanNode());
+        isn->indexKeyPattern = index.keyPattern;
+        isn->indexIsMultiKey = index.multikey;
+        isn->indexMultikeyFields = index.multikeyFields;
+        isn->bounds.fields.resize(index.keyPattern.nFields());
+        isn->maxScan = query.getParsed().getMaxScan();
+        isn->addKeyMetadata = query.getParsed().returnKey();
+
+        size_t boundedFields = 0;
+        BSONObjIterator it(isn->indexKeyPattern);
+        for (size_t field = 0; it.more(); ++field) {
+            BSONElement elt = it.next();
+            OrderedIntervalList* oil = &isn->bounds.fields[field];
+            bool bounded = false;
+
+            // The leading field is what we skip over.  With a multikey index bounds over more
+            // than one predicate may exclude matching documents, so only the first is used.
+            bool canBound = (field > 0) && !(index.multikey && boundedFields > 0);
+            for (size_t i = 0; canBound && i < preds.size(); ++i) {
+                const MatchExpression* pred = preds[i];
+                if (!pred->isLeaf() || !isSkipScanPredicate(pred)
+                    || pred->path() != StringData(elt.fieldName())) {
+                    continue;
+                }
+
+                IndexBoundsBuilder::BoundsTightness tightness;
+                if (!bounded) {
+                    IndexBoundsBuilder::translate(pred, elt, oil, &tightness, index.infoObj);
+                    bounded = true;
+                }
+                else {
+                    IndexBoundsBuilder::translateAndIntersect(pred, elt, oil, &tightness,
+                                                              index.infoObj);
+                }
+
+                if (index.multikey) {
+                    break;
+                }
+            }
+
+            if (bounded) {
+                ++boundedFields;
+            }
+            else {
+                IndexBoundsBuilder::allValuesForField(elt, oil);
+            }
+        }
+
+        if (0 == boundedFields) {
+            return NULL;
+        }
+
+        alignBounds(&isn->bounds, isn->indexKeyPattern);
+
+        // TODO: We may not need to do the fetch if the predicates in root are covered.  But
+        // for now it's safe (though *maybe* slower).
+        FetchNode* fetch = new FetchNode();
+        fetch->filter.reset(root->shallowClone());
+        fetch->children.push_back(isn.release());
+        return fetch;
+    }
+
 }  // namespace mongo
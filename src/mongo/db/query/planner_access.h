@@ -64,6 +64,19 @@ namespace mongo {
                                                 const BSONObj& startKey,
                                                 const BSONObj& endKey);
 
+        /**
+         * Return a plan that skip scans the provided index: the top-level predicates of 'query'
+         * bound the non-leading fields and the leading field takes all values, so the index
+         * scan seeks from one distinct leading prefix to the next instead of reading every key.
+         * The entire query is applied as a filter after the fetch.
+         *
+         * Returns NULL if no non-leading field of the index is constrained or if the index is
+         * not a plain (or posting) btree that isn't sparse.
+         */
+        static QuerySolutionNode* makeSkipScan(const IndexEntry& index,
+                                               const CanonicalQuery& query,
+                                               const QueryPlannerParams& params);
+
         //
         // Indexed Data Access methods.
         //
@@ -28,9 +28,12 @@
 
 #include "mongo/db/query/planner_analysis.h"
 
+#include <algorithm>
 #include <vector>
 
+#include "mongo/db/index_names.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/query/query_planner_common.h"
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/query/qlog.h"
@@ -89,6 +92,10 @@ namespace mongo {
                         QLOG() << "Reversing ixscan to provide sort.  Result: "
                                << solnRoot->toString() << endl;
                     }
+                    else if (explodeForSort(query, &solnRoot)) {
+                        QLOG() << "Exploded point prefixes to provide sort.  Result: "
+                               << solnRoot->toString() << endl;
+                    }
                     else {
                         // If we're not allowed to put a blocking sort in, bail out.
                         if (params.options & QueryPlannerParams::NO_BLOCKING_SORT) {
@@ -119,6 +126,16 @@ namespace mongo {
                         else {
                             sort->limit = 0;
                         }
+
+                        // Sorted by score alone, a text search need only find the top results.
+                        if (0 != sort->limit && STAGE_TEXT == solnRoot->getType()
+                            && 1 == sortObj.nFields()
+                            && Object == sortObj.firstElement().type()
+                            && sortObj.firstElement().Obj().getField("$meta").str()
+                               == LiteParsedQuery::metaTextScore) {
+                            static_cast<TextNode*>(solnRoot)->_limit = sort->limit;
+                        }
+
                         sort->children.push_back(solnRoot);
                         solnRoot = sort;
                         blockingSort = true;
@@ -162,6 +179,38 @@ namespace mongo {
                 }
             }
 
+            // A blocking sort buffers every result it's given.  If the projection only wants a
+            // few top-level fields, have the fetch under the sort keep just those and the ones
+            // we sort by.
+            if (blockingSort && !query.getProj()->requiresDocument()
+                && !query.getProj()->getRequiredFields().empty()) {
+
+                verify(STAGE_SORT == solnRoot->getType());
+                QuerySolutionNode* sortChild = solnRoot->children[0];
+                if (STAGE_FETCH == sortChild->getType()) {
+                    vector<string> fields = query.getProj()->getRequiredFields();
+                    bool canPushDown = true;
+
+                    BSONObjIterator sortIt(query.getParsed().getSort());
+                    while (sortIt.more()) {
+                        BSONElement elt = sortIt.next();
+                        if (!elt.isNumber()) {
+                            canPushDown = false;
+                            break;
+                        }
+                        string field = elt.fieldName();
+                        field = field.substr(0, field.find('.'));
+                        if (fields.end() == std::find(fields.begin(), fields.end(), field)) {
+                            fields.push_back(field);
+                        }
+                    }
+
+                    if (canPushDown) {
+                        static_cast<FetchNode*>(sortChild)->fields.swap(fields);
+                    }
+                }
+            }
+
             // We now know we have whatever data is required for the projection.
             ProjectionNode* projNode = new ProjectionNode();
             projNode->children.push_back(solnRoot);
@@ -203,4 +252,271 @@ namespace mongo {
         return soln.release();
     }
 
+    // Each exploded scan is a seek into the index and a slot in the merge's priority queue.
+    static const size_t kMaxScansToExplode = 200;
+
+    namespace {
+
+        /**
+         * Is 'node' a btree scan over compound bounds, possibly under a fetch?  If so, returns the
+         * scan.  Otherwise returns NULL.
+         */
+        IndexScanNode* getExplodableScan(QuerySolutionNode* node) {
+            if (STAGE_FETCH == node->getType()) {
+                if (1 != node->children.size()) {
+                    return NULL;
+                }
+                node = node->children[0];
+            }
+
+            if (STAGE_IXSCAN != node->getType()) {
+                return NULL;
+            }
+
+            IndexScanNode* isn = static_cast<IndexScanNode*>(node);
+            if (isn->bounds.isSimpleRange
+                || !IndexNames::findPluginName(isn->indexKeyPattern).empty()) {
+                return NULL;
+            }
+            return isn;
+        }
+
+        /**
+         * How many leading fields of 'bounds' are nothing but point intervals?
+         */
+        size_t numPointPrefixFields(const IndexBounds& bounds) {
+            size_t n = 0;
+            for (; n < bounds.fields.size(); ++n) {
+                const vector<Interval>& iv = bounds.fields[n].intervals;
+                if (iv.empty()) {
+                    break;
+                }
+                for (size_t i = 0; i < iv.size(); ++i) {
+                    if (!iv[i].isPoint()) {
+                        return n;
+                    }
+                }
+            }
+            return n;
+        }
+
+        /**
+         * A copy of 'isn' whose first 'prefixLen' fields are narrowed to the single points picked
+         * by 'choice'.  Caller owns the returned node.
+         */
+        IndexScanNode* makePointScan(const IndexScanNode* isn, const vector<size_t>& choice,
+                                     size_t prefixLen) {
+            IndexScanNode* child = new IndexScanNode();
+            child->indexKeyPattern = isn->indexKeyPattern;
+            child->indexIsMultiKey = isn->indexIsMultiKey;
+            child->indexMultikeyFields = isn->indexMultikeyFields;
+            child->limit = isn->limit;
+            child->direction = isn->direction;
+            child->maxScan = isn->maxScan;
+            child->addKeyMetadata = isn->addKeyMetadata;
+            child->bounds = isn->bounds;
+            for (size_t i = 0; i < prefixLen; ++i) {
+                vector<Interval>& iv = child->bounds.fields[i].intervals;
+                Interval point = iv[choice[i]];
+                iv.clear();
+                iv.push_back(point);
+            }
+            if (NULL != isn->filter) {
+                child->filter.reset(isn->filter->shallowClone());
+            }
+            child->computeProperties();
+            return child;
+        }
+
+        /**
+         * Wraps 'scan' in a copy of 'fetch', if there is one.
+         */
+        QuerySolutionNode* wrapInFetch(const QuerySolutionNode* fetch, QuerySolutionNode* scan) {
+            if (NULL == fetch) {
+                return scan;
+            }
+            FetchNode* newFetch = new FetchNode();
+            newFetch->fields = static_cast<const FetchNode*>(fetch)->fields;
+            if (NULL != fetch->filter) {
+                newFetch->filter.reset(fetch->filter->shallowClone());
+            }
+            newFetch->children.push_back(scan);
+            return newFetch;
+        }
+
+        // What it takes to turn one branch into scans that each provide the sort.
+        struct BranchExplosion {
+            // The FETCH above the scan, or NULL.
+            const QuerySolutionNode* fetch;
+            const IndexScanNode* isn;
+            // How many leading fields are split into one scan per point.
+            size_t prefixLen;
+            // The product of the number of points of those fields.
+            size_t numScans;
+            // Whether the resulting scans provide the reverse of the sort.
+            bool reverse;
+        };
+
+    }  // namespace
+
+    // static
+    bool QueryPlannerAnalysis::explodeForSort(const CanonicalQuery& query,
+                                              QuerySolutionNode** solnRoot) {
+        const BSONObj& sortObj = query.getParsed().getSort();
+        const BSONObj reverseSort = QueryPlannerCommon::reverseSortObj(sortObj);
+
+        // A FETCH on top filters without reordering, so it can stay above the merge.  We
+        // replace what is under it.
+        QuerySolutionNode* parent = NULL;
+        QuerySolutionNode* toReplace = *solnRoot;
+        if (STAGE_FETCH == toReplace->getType() && 1 == toReplace->children.size()) {
+            parent = toReplace;
+            toReplace = toReplace->children[0];
+        }
+
+        vector<QuerySolutionNode*> branches;
+        if (STAGE_OR == toReplace->getType()) {
+            branches = toReplace->children;
+        }
+        else if (STAGE_IXSCAN == toReplace->getType()) {
+            branches.push_back(toReplace);
+        }
+        else {
+            return false;
+        }
+
+        // For each branch, find the fewest leading point fields that have to be split out for
+        // the scans to provide the sort.  A branch that already provides it needs none.
+        vector<BranchExplosion> explosions;
+        size_t totalScans = 0;
+        for (size_t i = 0; i < branches.size(); ++i) {
+            IndexScanNode* isn = getExplodableScan(branches[i]);
+            if (NULL == isn) {
+                return false;
+            }
+
+            BranchExplosion be;
+            be.fetch = (STAGE_FETCH == branches[i]->getType()) ? branches[i] : NULL;
+            be.isn = isn;
+
+            const size_t maxPrefixLen = numPointPrefixFields(isn->bounds);
+            bool found = false;
+            size_t numScans = 1;
+            for (size_t prefixLen = 0; prefixLen <= maxPrefixLen; ++prefixLen) {
+                if (prefixLen > 0) {
+                    numScans *= isn->bounds.fields[prefixLen - 1].intervals.size();
+                }
+                if (totalScans + numScans > kMaxScansToExplode) {
+                    return false;
+                }
+
+                // Every scan split out at this length has the same shape, so the first one
+                // tells us what they all provide.
+                vector<size_t> first(prefixLen, 0);
+                auto_ptr<IndexScanNode> probe(makePointScan(isn, first, prefixLen));
+                const BSONObjSet& sorts = probe->getSort();
+                if (sorts.end() != sorts.find(sortObj)) {
+                    be.reverse = false;
+                    found = true;
+                }
+                else if (sorts.end() != sorts.find(reverseSort)) {
+                    be.reverse = true;
+                    found = true;
+                }
+
+                if (found) {
+                    be.prefixLen = prefixLen;
+                    be.numScans = numScans;
+                    break;
+                }
+            }
+
+            if (!found) {
+                return false;
+            }
+            totalScans += numScans;
+            explosions.push_back(be);
+        }
+
+        // Nothing to gain from merging one scan.
+        if (totalScans < 2) {
+            return false;
+        }
+
+        auto_ptr<MergeSortNode> merge(new MergeSortNode());
+        merge->sort = sortObj;
+        for (size_t i = 0; i < explosions.size(); ++i) {
+            const BranchExplosion& be = explosions[i];
+            const vector<OrderedIntervalList>& fields = be.isn->bounds.fields;
+
+            // One scan per element of the cartesian product of the point prefix.
+            for (size_t n = 0; n < be.numScans; ++n) {
+                vector<size_t> choice(be.prefixLen);
+                size_t rest = n;
+                for (size_t j = be.prefixLen; j > 0; --j) {
+                    const size_t numPoints = fields[j - 1].intervals.size();
+                    choice[j - 1] = rest % numPoints;
+                    rest /= numPoints;
+                }
+
+                QuerySolutionNode* scan = makePointScan(be.isn, choice, be.prefixLen);
+                if (be.reverse) {
+                    QueryPlannerCommon::reverseScans(scan);
+                }
+                merge->children.push_back(wrapInFetch(be.fetch, scan));
+            }
+        }
+        merge->computeProperties();
+
+        if (NULL == parent) {
+            *solnRoot = merge.release();
+        }
+        else {
+            parent->children[0] = merge.release();
+            parent->computeProperties();
+        }
+        delete toReplace;
+        return true;
+    }
+
+    // A COUNT seeks twice per range, which beats fetching as long as the ranges are not silly.
+    static const size_t kMaxCountRanges = 1000;
+
+    // static
+    bool QueryPlannerAnalysis::turnIxscanIntoCount(QuerySolution* soln) {
+        QuerySolutionNode* root = soln->root.get();
+
+        // A fetch with no filter doesn't change what is counted.
+        if (STAGE_FETCH == root->getType()) {
+            if (NULL != root->filter || 1 != root->children.size()) {
+                return false;
+            }
+            root = root->children[0];
+        }
+
+        if (STAGE_IXSCAN != root->getType() || NULL != root->filter) {
+            return false;
+        }
+
+        const IndexScanNode* isn = static_cast<const IndexScanNode*>(root);
+        if (1 != isn->direction || 0 != isn->maxScan || isn->addKeyMetadata) {
+            return false;
+        }
+
+        // Only a plain btree stores the keys the bounds are over.
+        if (!IndexNames::findPluginName(isn->indexKeyPattern).empty()) {
+            return false;
+        }
+
+        auto_ptr<CountNode> cn(new CountNode());
+        if (!isn->bounds.toKeyRanges(kMaxCountRanges, &cn->ranges)) {
+            return false;
+        }
+        cn->indexKeyPattern = isn->indexKeyPattern;
+        cn->indexIsMultiKey = isn->indexIsMultiKey;
+
+        soln->root.reset(cn.release());
+        return true;
+    }
+
 }  // namespace mongo
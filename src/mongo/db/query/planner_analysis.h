@@ -55,6 +55,27 @@ namespace mongo {
         static QuerySolution* analyzeDataAccess(const CanonicalQuery& query,
                                                 const QueryPlannerParams& params,
                                                 QuerySolutionNode* solnRoot);
+
+        /**
+         * If the data access under '*solnRoot' is a btree scan or an $or of btree scans (each
+         * possibly under a fetch), and splitting the leading point intervals of each scan into one
+         * scan per point makes every scan provide the query's sort (or its reverse), replace the
+         * scans with a MERGE_SORT over the split scans and return true.  For instance, with the
+         * index {a: 1, b: 1}, {a: {$in: [1, 2]}} sorted by {b: 1} becomes a merge of a scan for
+         * a == 1 and a scan for a == 2.
+         *
+         * Otherwise, or if that would take too many scans, leave '*solnRoot' alone and return
+         * false.
+         */
+        static bool explodeForSort(const CanonicalQuery& query, QuerySolutionNode** solnRoot);
+
+        /**
+         * For a count: if 'soln' is nothing but an index scan of a btree (possibly under a
+         * fetch) whose bounds answer the predicate exactly and are a few contiguous ranges of
+         * keys, replace it with a COUNT over those ranges and return true.  Otherwise leave
+         * 'soln' alone and return false.
+         */
+        static bool turnIxscanIntoCount(QuerySolution* soln);
     };
 
 }  // namespace mongo
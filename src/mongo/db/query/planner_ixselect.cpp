@@ -31,6 +31,7 @@
 #include <vector>
 
 #include "mongo/db/geo/core.h"
+#include "mongo/db/index_names.h"
 #include "mongo/db/matcher/expression_array.h"
 #include "mongo/db/matcher/expression_geo.h"
 #include "mongo/db/matcher/expression_text.h"
@@ -108,7 +109,8 @@ namespace mongo {
         MatchExpression::MatchType exprtype = node->matchType();
 
         // TODO: use indexnames
-        if ("" == ixtype) {
+        // A posting index holds the same keys as a btree index, just packed differently.
+        if ("" == ixtype || "posting" == ixtype) {
             if (index.sparse && exprtype == MatchExpression::EQ) {
                 // Can't check for null w/a sparse index.
                 const EqualityMatchExpression* expr
@@ -120,6 +122,30 @@ namespace mongo {
         else if ("hashed" == ixtype) {
             return exprtype == MatchExpression::MATCH_IN || exprtype == MatchExpression::EQ;
         }
+        else if (IndexNames::HASH_TABLE == ixtype) {
+            // Only the hash of a whole value can be looked up, not of an array's elements or of
+            // a regex.
+            if (exprtype == MatchExpression::EQ) {
+                const EqualityMatchExpression* expr
+                    = static_cast<const EqualityMatchExpression*>(node);
+                return Array != expr->getData().type();
+            }
+            if (exprtype == MatchExpression::MATCH_IN) {
+                const ArrayFilterEntries& entries
+                    = static_cast<const InMatchExpression*>(node)->getData();
+                if (0 != entries.numRegexes()) {
+                    return false;
+                }
+                for (BSONElementSet::const_iterator it = entries.equalities().begin();
+                     it != entries.equalities().end(); ++it) {
+                    if (Array == it->type()) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            return false;
+        }
         else if ("2dsphere" == ixtype) {
             if (exprtype == MatchExpression::GEO) {
                 // within or intersect.
@@ -85,7 +85,10 @@ namespace mongo {
             ss << "INCLUDE_SHARD_FILTER ";
         }
         if (options & QueryPlannerParams::NO_BLOCKING_SORT) {
-            ss << "NO_BLOCKING_SORT";
+            ss << "NO_BLOCKING_SORT ";
+        }
+        if (options & QueryPlannerParams::INDEX_SKIP_SCAN) {
+            ss << "INDEX_SKIP_SCAN";
         }
         return ss.str();
     }
@@ -523,6 +526,19 @@ namespace mongo {
         // scan the entire index to provide results and output that as our plan.  This is the
         // desired behavior when an index is hinted that is not relevant to the query.
         if (!hintIndex.isEmpty()) {
+            if (0 == out->size() && (params.options & QueryPlannerParams::INDEX_SKIP_SCAN)
+                && !QueryPlannerCommon::hasNode(query.root(), MatchExpression::TEXT)) {
+                QuerySolutionNode* solnRoot =
+                    QueryPlannerAccess::makeSkipScan(params.indices[hintIndexNumber], query, params);
+                if (NULL != solnRoot) {
+                    QuerySolution* soln =
+                        QueryPlannerAnalysis::analyzeDataAccess(query, params, solnRoot);
+                    if (NULL != soln) {
+                        QLOG() << "Planner: outputting skip scan over hinted index." << endl;
+                        out->push_back(soln);
+                    }
+                }
+            }
             if (0 == out->size()) {
                 QuerySolution* soln = buildWholeIXSoln(params.indices[hintIndexNumber], query, params);
                 verify(NULL != soln);
@@ -578,12 +594,50 @@ namespace mongo {
             }
         }
 
+        // An index whose first field has no predicate isn't relevant above, but if the query
+        // constrains one of its later fields we can skip scan it.  How many distinct leading
+        // prefixes there are decides whether that beats a collscan, so we offer both and let
+        // the plans compete.
+        bool outputSkipScan = false;
+        if ((params.options & QueryPlannerParams::INDEX_SKIP_SCAN)
+            && !QueryPlannerCommon::hasNode(query.root(), MatchExpression::GEO_NEAR)
+            && !QueryPlannerCommon::hasNode(query.root(), MatchExpression::TEXT)) {
+
+            for (size_t i = 0; i < params.indices.size(); ++i) {
+                const IndexEntry& index = params.indices[i];
+
+                bool isRelevant = false;
+                for (size_t j = 0; j < relevantIndices.size(); ++j) {
+                    if (0 == relevantIndices[j].keyPattern.woCompare(index.keyPattern)) {
+                        isRelevant = true;
+                        break;
+                    }
+                }
+                if (isRelevant) {
+                    continue;
+                }
+
+                QuerySolutionNode* solnRoot = QueryPlannerAccess::makeSkipScan(index, query, params);
+                if (NULL == solnRoot) {
+                    continue;
+                }
+
+                QuerySolution* soln = QueryPlannerAnalysis::analyzeDataAccess(query, params, solnRoot);
+                if (NULL != soln) {
+                    QLOG() << "Planner: outputting skip scan:\n" << soln->toString() << endl;
+                    out->push_back(soln);
+                    outputSkipScan = true;
+                }
+            }
+        }
+
         // TODO: Do we always want to offer a collscan solution?
         // XXX: currently disabling the always-use-a-collscan in order to find more planner bugs.
         if (    !QueryPlannerCommon::hasNode(query.root(), MatchExpression::GEO_NEAR)
              && !QueryPlannerCommon::hasNode(query.root(), MatchExpression::TEXT)
              && hintIndex.isEmpty()
-             && ((params.options & QueryPlannerParams::INCLUDE_COLLSCAN) || (0 == out->size() && canTableScan)))
+             && ((params.options & QueryPlannerParams::INCLUDE_COLLSCAN)
+                 || ((0 == out->size() || outputSkipScan) && canTableScan)))
         {
             QuerySolution* collscan = buildCollscanSoln(query, false, params);
             if (NULL != collscan) {
@@ -64,6 +64,14 @@ namespace mongo {
 
             // Set this if you want to turn on index intersection.
             INDEX_INTERSECTION = 1 << 4,
+
+            // Set this if the results are only going to be counted.  If an index answers the
+            // predicate exactly, getRunner(...) counts its keys instead of running the query.
+            PRIVATE_IS_COUNT = 1 << 5,
+
+            // Set this if you want indices whose first field has no predicate, but a later one
+            // does, to be considered for a skip scan over the distinct leading prefixes.
+            INDEX_SKIP_SCAN = 1 << 6,
         };
 
         // See Options enum above.
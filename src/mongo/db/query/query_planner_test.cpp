@@ -74,6 +74,11 @@ namespace {
                                                 "hari_king_of_the_stove"));
         }
 
+        void addIndexMultikeyFields(BSONObj keyPattern, unsigned multikeyFields) {
+            params.indices.push_back(IndexEntry(keyPattern, true, false,
+                                                "multikey_fields", multikeyFields));
+        }
+
         void addIndex(BSONObj keyPattern, bool multikey, bool sparse) {
             params.indices.push_back(IndexEntry(keyPattern, multikey, sparse,
                                                 "note_to_self_dont_break_build"));
@@ -1539,7 +1544,11 @@ namespace {
 
         assertSolutionExists("{sort: {pattern: {b: 1}, limit: 1, "
                              "node: {cscan: {dir: 1}}}}");
-        // TODO SERVER-1205 there should be a mergeSort solution
+        assertSolutionExists("{fetch: {filter: null, node: {mergeSort: {nodes: ["
+                                "{ixscan: {pattern: {a: 1, b: 1}, bounds: {a: [[1, 1, true, true]]}}}, "
+                                "{ixscan: {pattern: {a: 1, b: 1}, bounds: {a: [[3, 3, true, true]]}}}, "
+                                "{ixscan: {pattern: {a: 1, b: 1}, bounds: {a: [[8, 8, true, true]]}}}"
+                                "]}}}}");
     }
 
     //
@@ -1638,7 +1647,66 @@ namespace {
 
         ASSERT_EQUALS(getNumSolutions(), 2U);
         assertSolutionExists("{sort: {pattern: {b: 1}, limit: 0, node: {cscan: {dir: 1}}}}");
-        // TODO the second solution should be mergeSort rather than just sort
+        assertSolutionExists("{fetch: {filter: null, node: {mergeSort: {nodes: ["
+                                "{ixscan: {pattern: {a: 1, b: 1}, bounds: {a: [[1, 1, true, true]]}}}, "
+                                "{ixscan: {pattern: {a: 1, b: 1}, bounds: {a: [[7, 7, true, true]]}}}"
+                                "]}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, MergeSortReverseBranch) {
+        addIndex(BSON("a" << 1 << "c" << 1));
+        addIndex(BSON("b" << 1 << "c" << -1));
+        runQuerySortProj(fromjson("{$or: [{a:1}, {b:1}]}"), fromjson("{c:1}"), BSONObj());
+
+        ASSERT_EQUALS(getNumSolutions(), 2U);
+        assertSolutionExists("{sort: {pattern: {c: 1}, limit: 0, node: {cscan: {dir: 1}}}}");
+        assertSolutionExists("{fetch: {node: {mergeSort: {nodes: "
+                                "[{ixscan: {pattern: {a: 1, c: 1}, dir: 1}}, "
+                                "{ixscan: {pattern: {b: 1, c: -1}, dir: -1}}]}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, ExplodeOrBranchForSort) {
+        addIndex(BSON("a" << 1 << "c" << 1));
+        addIndex(BSON("b" << 1 << "c" << 1));
+        runQuerySortProj(fromjson("{$or: [{a: {$in: [1, 2]}}, {b: 3}]}"), fromjson("{c:1}"),
+                         BSONObj());
+
+        ASSERT_EQUALS(getNumSolutions(), 2U);
+        assertSolutionExists("{sort: {pattern: {c: 1}, limit: 0, node: {cscan: {dir: 1}}}}");
+        assertSolutionExists("{fetch: {filter: null, node: {mergeSort: {nodes: ["
+                                "{ixscan: {pattern: {a: 1, c: 1}, bounds: {a: [[1, 1, true, true]]}}}, "
+                                "{ixscan: {pattern: {a: 1, c: 1}, bounds: {a: [[2, 2, true, true]]}}}, "
+                                "{ixscan: {pattern: {b: 1, c: 1}, bounds: {b: [[3, 3, true, true]]}}}"
+                                "]}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, ExplodeTwoInsForSort) {
+        addIndex(BSON("a" << 1 << "b" << 1 << "c" << 1));
+        runQuerySortProj(fromjson("{a: {$in: [1, 2]}, b: {$in: [3, 4]}}"), fromjson("{c:1}"),
+                         BSONObj());
+
+        assertSolutionExists("{fetch: {filter: null, node: {mergeSort: {nodes: ["
+                                "{ixscan: {pattern: {a: 1, b: 1, c: 1}, "
+                                    "bounds: {a: [[1, 1, true, true]], b: [[3, 3, true, true]]}}}, "
+                                "{ixscan: {pattern: {a: 1, b: 1, c: 1}, "
+                                    "bounds: {a: [[1, 1, true, true]], b: [[4, 4, true, true]]}}}, "
+                                "{ixscan: {pattern: {a: 1, b: 1, c: 1}, "
+                                    "bounds: {a: [[2, 2, true, true]], b: [[3, 3, true, true]]}}}, "
+                                "{ixscan: {pattern: {a: 1, b: 1, c: 1}, "
+                                    "bounds: {a: [[2, 2, true, true]], b: [[4, 4, true, true]]}}}"
+                                "]}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, ExplodeForReverseSort) {
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuerySortProj(fromjson("{a: {$in: [1, 2]}}"), fromjson("{b: -1}"), BSONObj());
+
+        assertSolutionExists("{fetch: {filter: null, node: {mergeSort: {nodes: ["
+                                "{ixscan: {pattern: {a: 1, b: 1}, dir: -1, "
+                                    "bounds: {a: [[1, 1, true, true]]}}}, "
+                                "{ixscan: {pattern: {a: 1, b: 1}, dir: -1, "
+                                    "bounds: {a: [[2, 2, true, true]]}}}"
+                                "]}}}}");
     }
 
     TEST_F(QueryPlannerTest, ReverseScanForSort) {
@@ -2026,6 +2094,93 @@ namespace {
         assertHasOneSolutionOf(alternates);
     }
 
+    /**
+     * A field that never has more than one value in a document can compound with a multikey one.
+     */
+    TEST_F(QueryPlannerTest, MultikeyFieldsCompoundNonMultikeyField) {
+        // Only 'a' is multikey.
+        addIndexMultikeyFields(BSON("a" << 1 << "b" << 1), 1);
+        runQuery(fromjson("{a: 2, b: 3}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {filter: {$and: [{a: 2}, {b: 3}]}, dir: 1}}");
+        assertSolutionExists("{fetch: {filter: null, node: {ixscan: {filter: null, "
+                                "pattern: {a: 1, b: 1}, bounds: "
+                                "{a: [[2,2,true,true]], b: [[3,3,true,true]]}}}}}");
+    }
+
+    /**
+     * Bounds on a field that isn't multikey are intersected even if the index is.
+     */
+    TEST_F(QueryPlannerTest, MultikeyFieldsIntersectNonMultikeyField) {
+        // Only 'b' is multikey.
+        addIndexMultikeyFields(BSON("a" << 1 << "b" << 1), 2);
+        runQuery(fromjson("{a: {$gt: 0, $lt: 5}}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{fetch: {filter: null, node: {ixscan: {filter: null, "
+                                "pattern: {a: 1, b: 1}, bounds: "
+                                "{a: [[0,5,false,false]], b: [['MinKey','MaxKey',true,true]]}}}}}");
+    }
+
+    /**
+     * ...and they cover.
+     */
+    TEST_F(QueryPlannerTest, MultikeyFieldsCoverNonMultikeyField) {
+        // Only 'b' is multikey.
+        addIndexMultikeyFields(BSON("a" << 1 << "b" << 1), 2);
+        runQuerySortProj(fromjson("{a: {$gt: 1}}"), BSONObj(), fromjson("{_id: 0, a: 1}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: {ixscan: "
+                                "{filter: null, pattern: {a: 1, b: 1}}}}}");
+        assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: "
+                                "{cscan: {dir: 1, filter: {a:{$gt:1}}}}}}");
+    }
+
+    //
+    // hashtable indexes
+    //
+
+    TEST_F(QueryPlannerTest, HashTableEquality) {
+        addIndex(BSON("a" << "hashtable"));
+        runQuery(fromjson("{a: 5}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1, filter: {a: 5}}}");
+        assertSolutionExists("{fetch: {filter: {a: 5}, node: "
+                                "{ixscan: {filter: null, pattern: {a: 'hashtable'}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, HashTableIn) {
+        addIndex(BSON("a" << "hashtable"));
+        runQuery(fromjson("{a: {$in: [1, 'x']}}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1, filter: {a: {$in: [1, 'x']}}}}");
+        assertSolutionExists("{fetch: {filter: {a: {$in: [1, 'x']}}, node: "
+                                "{ixscan: {filter: null, pattern: {a: 'hashtable'}}}}}");
+    }
+
+    /**
+     * Only whole values can be looked up in a hashtable index.
+     */
+    TEST_F(QueryPlannerTest, HashTableNoRangesArraysOrRegexes) {
+        addIndex(BSON("a" << "hashtable"));
+
+        runQuery(fromjson("{a: {$gt: 5}}"));
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1, filter: {a: {$gt: 5}}}}");
+
+        runQuery(fromjson("{a: [1, 2]}"));
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1, filter: {a: [1, 2]}}}");
+
+        runQuery(fromjson("{a: {$in: [1, /x/]}}"));
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1, filter: {a: {$in: [1, /x/]}}}}");
+    }
+
     //
     // Index bounds related tests
     //
@@ -2226,4 +2381,120 @@ namespace {
                                          "{ixscan: {filter: null, pattern: {'a.c':1}}}]}}}}");
     }
 
+    TEST_F(QueryPlannerTest, IntersectThreeSingleFieldIndices) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN | QueryPlannerParams::INDEX_INTERSECTION;
+        addIndex(BSON("a" << 1));
+        addIndex(BSON("b" << 1));
+        addIndex(BSON("c" << 1));
+        runQuery(fromjson("{a: 1, b: 2, c: 3}"));
+
+        // One plan per index, one per pair and one that intersects all three.
+        assertNumSolutions(7U);
+        assertSolutionExists("{fetch: {filter: null, node: {andSorted: {nodes: ["
+                                    "{ixscan: {filter: null, pattern: {a:1}}},"
+                                    "{ixscan: {filter: null, pattern: {b:1}}},"
+                                    "{ixscan: {filter: null, pattern: {c:1}}}]}}}}");
+        assertSolutionExists("{fetch: {filter: {c: 3}, node: {andSorted: {nodes: ["
+                                    "{ixscan: {filter: null, pattern: {a:1}}},"
+                                    "{ixscan: {filter: null, pattern: {b:1}}}]}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, IntersectSubtreeAndCompoundPred) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN | QueryPlannerParams::INDEX_INTERSECTION;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        addIndex(BSON("c" << 1));
+        addIndex(BSON("d" << 1));
+        runQuery(fromjson("{a: 1, b: 2, $or: [{c: 1}, {d: 1}]}"));
+
+        // The compound index is used for both of its fields when intersected with the $or.
+        assertSolutionExists("{fetch: {filter: null, node: {andHash: {nodes:["
+                                    "{or: {nodes: [{ixscan:{filter:null, pattern:{c:1}}},"
+                                          "{ixscan:{filter:null, pattern:{d:1}}}]}},"
+                                    "{ixscan:{filter: null, pattern:{a:1, b:1}, bounds: "
+                                        "{a: [[1,1,true,true]], b: [[2,2,true,true]]}}}]}}}}");
+    }
+
+    //
+    // Skip scan.
+    //
+
+    TEST_F(QueryPlannerTest, SkipScanSecondField) {
+        params.options = QueryPlannerParams::INDEX_SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(fromjson("{b: 5}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {filter: {b: 5}, node: {ixscan: {filter: null, pattern: "
+                                "{a: 1, b: 1}, bounds: {a: [['MinKey','MaxKey',true,true]], "
+                                "b: [[5,5,true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanIntersectsPredsOnField) {
+        params.options = QueryPlannerParams::INDEX_SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1 << "c" << 1));
+        runQuery(fromjson("{b: {$gt: 2, $lt: 7}, c: {$in: [1, 3]}}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {node: {ixscan: {filter: null, pattern: "
+                                "{a: 1, b: 1, c: 1}, bounds: {a: [['MinKey','MaxKey',true,true]], "
+                                "b: [[2,7,false,false]], "
+                                "c: [[1,1,true,true],[3,3,true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanNotOfferedWhenLeadingFieldUsable) {
+        params.options = QueryPlannerParams::INDEX_SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(fromjson("{a: 1, b: 5}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{fetch: {filter: null, node: {ixscan: {filter: null, pattern: "
+                                "{a: 1, b: 1}, bounds: {a: [[1,1,true,true]], "
+                                "b: [[5,5,true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanNoPredOnIndex) {
+        params.options = QueryPlannerParams::INDEX_SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(fromjson("{c: 5}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanNotOfferedForSparseOrSpecialIndex) {
+        params.options = QueryPlannerParams::INDEX_SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1), false, true);
+        addIndex(BSON("x" << "hashed" << "b" << 1));
+        runQuery(fromjson("{b: 5}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanMultikeyBoundsOneField) {
+        params.options = QueryPlannerParams::INDEX_SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1 << "c" << 1), true);
+        runQuery(fromjson("{b: 5, c: 6}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {node: {ixscan: {filter: null, pattern: "
+                                "{a: 1, b: 1, c: 1}, bounds: {a: [['MinKey','MaxKey',true,true]], "
+                                "b: [[5,5,true,true]], "
+                                "c: [['MinKey','MaxKey',true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanHintedIndex) {
+        params.options = QueryPlannerParams::INDEX_SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQueryHint(fromjson("{b: 5}"), BSON("a" << 1 << "b" << 1));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{fetch: {filter: {b: 5}, node: {ixscan: {filter: null, pattern: "
+                                "{a: 1, b: 1}, bounds: {a: [['MinKey','MaxKey',true,true]], "
+                                "b: [[5,5,true,true]]}}}}}");
+    }
+
 }  // namespace
@@ -0,0 +1,106 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/query/query_settings.h"
+
+namespace mongo {
+
+    QuerySettings::QuerySettings() : _mutex("QuerySettings") { }
+
+    bool QuerySettings::getAllowedIndices(const PlanCacheKey& key,
+                                          std::vector<BSONObj>* indexKeyPatternsOut) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        AllowedIndicesMap::const_iterator it = _allowedIndices.find(key);
+        if (_allowedIndices.end() == it) {
+            return false;
+        }
+        *indexKeyPatternsOut = it->second.indexKeyPatterns;
+        return true;
+    }
+
+    void QuerySettings::setAllowedIndices(const CanonicalQuery& query,
+                                          const std::vector<BSONObj>& indexKeyPatterns) {
+        const LiteParsedQuery& lpq = query.getParsed();
+        AllowedIndices allowed;
+        allowed.query = lpq.getFilter().getOwned();
+        allowed.sort = lpq.getSort().getOwned();
+        allowed.projection = lpq.getProj().getOwned();
+        for (size_t i = 0; i < indexKeyPatterns.size(); ++i) {
+            allowed.indexKeyPatterns.push_back(indexKeyPatterns[i].getOwned());
+        }
+
+        PlanCacheKey key = getPlanCacheKey(query);
+        SimpleMutex::scoped_lock lk(_mutex);
+        _allowedIndices[key] = allowed;
+    }
+
+    bool QuerySettings::removeAllowedIndices(const PlanCacheKey& key) {
+        SimpleMutex::scoped_lock lk(_mutex);
+        return _allowedIndices.erase(key) > 0;
+    }
+
+    void QuerySettings::clearAllowedIndices() {
+        SimpleMutex::scoped_lock lk(_mutex);
+        _allowedIndices.clear();
+    }
+
+    void QuerySettings::appendAllowedIndices(BSONArrayBuilder* out) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        for (AllowedIndicesMap::const_iterator it = _allowedIndices.begin();
+             it != _allowedIndices.end(); ++it) {
+            const AllowedIndices& allowed = it->second;
+            BSONObjBuilder filter(out->subobjStart());
+            filter.append("query", allowed.query);
+            filter.append("sort", allowed.sort);
+            filter.append("projection", allowed.projection);
+            BSONArrayBuilder indexes(filter.subarrayStart("indexes"));
+            for (size_t i = 0; i < allowed.indexKeyPatterns.size(); ++i) {
+                indexes.append(allowed.indexKeyPatterns[i]);
+            }
+            indexes.doneFast();
+            filter.doneFast();
+        }
+    }
+
+    // static
+    void QuerySettings::filterAllowedIndexEntries(const std::vector<BSONObj>& indexKeyPatterns,
+                                                  std::vector<IndexEntry>* indexEntries) {
+        std::vector<IndexEntry> kept;
+        for (size_t i = 0; i < indexEntries->size(); ++i) {
+            const IndexEntry& entry = (*indexEntries)[i];
+            for (size_t j = 0; j < indexKeyPatterns.size(); ++j) {
+                if (0 == entry.keyPattern.woCompare(indexKeyPatterns[j])) {
+                    kept.push_back(entry);
+                    break;
+                }
+            }
+        }
+        indexEntries->swap(kept);
+    }
+
+}  // namespace mongo
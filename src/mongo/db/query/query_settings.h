@@ -0,0 +1,113 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/index_entry.h"
+#include "mongo/db/query/plan_cache.h"
+#include "mongo/platform/unordered_map.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    /**
+     * Settings an admin attaches to the query shapes of one collection, so that a bad plan can be
+     * fixed from the server without changing the application.
+     *
+     * For now that is index filters: the planner only considers the listed indexes (and the
+     * collection scan) for a query whose shape has one.  Queries with a hint, min or max aren't
+     * cacheable and aren't filtered.
+     *
+     * Settings only live in memory: they are lost on restart and aren't replicated.  All methods
+     * lock internally.
+     */
+    class QuerySettings {
+    private:
+        MONGO_DISALLOW_COPYING(QuerySettings);
+    public:
+        QuerySettings();
+
+        /**
+         * If the shape with key 'key' has an index filter, puts the key patterns of its indexes
+         * in *indexKeyPatternsOut and returns true.
+         */
+        bool getAllowedIndices(const PlanCacheKey& key,
+                               std::vector<BSONObj>* indexKeyPatternsOut) const;
+
+        /**
+         * Restrict queries of the shape of 'query' to the indexes with the key patterns in
+         * 'indexKeyPatterns', replacing any filter the shape had.
+         */
+        void setAllowedIndices(const CanonicalQuery& query,
+                               const std::vector<BSONObj>& indexKeyPatterns);
+
+        /**
+         * Remove the index filter of the shape with key 'key'.  Returns false if it had none.
+         */
+        bool removeAllowedIndices(const PlanCacheKey& key);
+
+        /**
+         * Remove all index filters.
+         */
+        void clearAllowedIndices();
+
+        /**
+         * Append one object per index filter with the shape's query, sort and projection and
+         * the filter's index key patterns.
+         */
+        void appendAllowedIndices(BSONArrayBuilder* out) const;
+
+        /**
+         * Remove from 'indexEntries' those whose key pattern isn't in 'indexKeyPatterns'.
+         */
+        static void filterAllowedIndexEntries(const std::vector<BSONObj>& indexKeyPatterns,
+                                              std::vector<IndexEntry>* indexEntries);
+
+    private:
+        struct AllowedIndices {
+            // The shape, to list the filters.
+            BSONObj query;
+            BSONObj sort;
+            BSONObj projection;
+
+            // Owned.
+            std::vector<BSONObj> indexKeyPatterns;
+        };
+
+        typedef unordered_map<PlanCacheKey, AllowedIndices> AllowedIndicesMap;
+
+        // Protects _allowedIndices.
+        mutable SimpleMutex _mutex;
+        AllowedIndicesMap _allowedIndices;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,127 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file contains tests for mongo/db/query/query_settings.h
+ */
+
+#include "mongo/db/query/query_settings.h"
+
+#include <memory>
+#include "mongo/db/json.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    using std::auto_ptr;
+    using std::vector;
+
+    static const char* ns = "somebogusns";
+
+    CanonicalQuery* canonicalize(const char* queryStr, const char* sortStr,
+                                 const char* projStr) {
+        CanonicalQuery* cq;
+        Status result = CanonicalQuery::canonicalize(ns, fromjson(queryStr), fromjson(sortStr),
+                                                     fromjson(projStr), &cq);
+        ASSERT_OK(result);
+        return cq;
+    }
+
+    vector<BSONObj> keyPatterns(const char* first, const char* second = NULL) {
+        vector<BSONObj> out;
+        out.push_back(fromjson(first));
+        if (NULL != second) {
+            out.push_back(fromjson(second));
+        }
+        return out;
+    }
+
+    TEST(QuerySettingsTest, SetAndGetAllowedIndices) {
+        QuerySettings settings;
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1, b: 1}", "{}", "{}"));
+        vector<BSONObj> allowed;
+        ASSERT_FALSE(settings.getAllowedIndices(getPlanCacheKey(*cq), &allowed));
+
+        settings.setAllowedIndices(*cq, keyPatterns("{a: 1}"));
+        ASSERT_TRUE(settings.getAllowedIndices(getPlanCacheKey(*cq), &allowed));
+        ASSERT_EQUALS(allowed.size(), 1U);
+        ASSERT_EQUALS(allowed[0], fromjson("{a: 1}"));
+
+        // The filter is by shape, not by value.
+        auto_ptr<CanonicalQuery> sameShape(canonicalize("{b: 5, a: 3}", "{}", "{}"));
+        ASSERT_TRUE(settings.getAllowedIndices(getPlanCacheKey(*sameShape), &allowed));
+        auto_ptr<CanonicalQuery> sorted(canonicalize("{a: 1, b: 1}", "{a: 1}", "{}"));
+        ASSERT_FALSE(settings.getAllowedIndices(getPlanCacheKey(*sorted), &allowed));
+
+        // Setting again replaces the filter.
+        settings.setAllowedIndices(*cq, keyPatterns("{b: 1}", "{a: 1, b: 1}"));
+        ASSERT_TRUE(settings.getAllowedIndices(getPlanCacheKey(*cq), &allowed));
+        ASSERT_EQUALS(allowed.size(), 2U);
+        ASSERT_EQUALS(allowed[0], fromjson("{b: 1}"));
+    }
+
+    TEST(QuerySettingsTest, RemoveAndClearAllowedIndices) {
+        QuerySettings settings;
+        auto_ptr<CanonicalQuery> first(canonicalize("{a: 1}", "{}", "{}"));
+        auto_ptr<CanonicalQuery> second(canonicalize("{b: 1}", "{}", "{_id: 0}"));
+        settings.setAllowedIndices(*first, keyPatterns("{a: 1}"));
+        settings.setAllowedIndices(*second, keyPatterns("{b: 1}"));
+
+        BSONArrayBuilder bab;
+        settings.appendAllowedIndices(&bab);
+        ASSERT_EQUALS(bab.arr().nFields(), 2);
+
+        vector<BSONObj> allowed;
+        ASSERT_TRUE(settings.removeAllowedIndices(getPlanCacheKey(*first)));
+        ASSERT_FALSE(settings.removeAllowedIndices(getPlanCacheKey(*first)));
+        ASSERT_FALSE(settings.getAllowedIndices(getPlanCacheKey(*first), &allowed));
+        ASSERT_TRUE(settings.getAllowedIndices(getPlanCacheKey(*second), &allowed));
+
+        settings.clearAllowedIndices();
+        ASSERT_FALSE(settings.getAllowedIndices(getPlanCacheKey(*second), &allowed));
+    }
+
+    TEST(QuerySettingsTest, FilterAllowedIndexEntries) {
+        vector<IndexEntry> entries;
+        entries.push_back(IndexEntry(fromjson("{a: 1}"), false, false, "a_1"));
+        entries.push_back(IndexEntry(fromjson("{b: 1}"), false, false, "b_1"));
+        entries.push_back(IndexEntry(fromjson("{a: 1, b: 1}"), false, false, "a_1_b_1"));
+
+        QuerySettings::filterAllowedIndexEntries(keyPatterns("{a: 1, b: 1}", "{c: 1}"),
+                                                 &entries);
+        ASSERT_EQUALS(entries.size(), 1U);
+        ASSERT_EQUALS(entries[0].name, "a_1_b_1");
+
+        // Key patterns must match exactly, including direction.
+        QuerySettings::filterAllowedIndexEntries(keyPatterns("{a: -1, b: 1}"), &entries);
+        ASSERT_TRUE(entries.empty());
+    }
+
+}  // namespace
@@ -27,6 +27,9 @@
  */
 
 #include "mongo/db/query/query_solution.h"
+
+#include <algorithm>
+
 #include "mongo/db/query/lite_parsed_query.h"
 
 namespace mongo {
@@ -70,6 +73,10 @@ namespace mongo {
         *ss << "query = " << _query << endl;
         addIndent(ss, indent + 1);
         *ss << "language = " << _language << endl;
+        if (0 != _limit) {
+            addIndent(ss, indent + 1);
+            *ss << "limit = " << _limit << endl;
+        }
         addCommon(ss, indent);
     }
 
@@ -297,18 +304,35 @@ namespace mongo {
             filter->debugString(sb, indent + 2);
             *ss << sb.str();
         }
+        if (!fields.empty()) {
+            addIndent(ss, indent + 1);
+            *ss << "fields =";
+            for (size_t i = 0; i < fields.size(); ++i) {
+                *ss << " " << fields[i];
+            }
+            *ss << endl;
+        }
         addCommon(ss, indent);
         addIndent(ss, indent + 1);
         *ss << "Child:" << endl;
         children[0]->appendToString(ss, indent + 2);
     }
 
+    bool FetchNode::hasField(const string& field) const {
+        if (fields.empty()) {
+            return true;
+        }
+
+        const string topLevel = field.substr(0, field.find('.'));
+        return fields.end() != std::find(fields.begin(), fields.end(), topLevel);
+    }
+
     //
     // IndexScanNode
     //
 
     IndexScanNode::IndexScanNode()
-        : indexIsMultiKey(false), limit(0), direction(1), maxScan(0), addKeyMetadata(false) { }
+        : indexIsMultiKey(false), indexMultikeyFields(0), limit(0), direction(1), maxScan(0), addKeyMetadata(false) { }
 
     void IndexScanNode::appendToString(stringstream* ss, int indent) const {
         addIndent(ss, indent);
@@ -329,14 +353,19 @@ namespace mongo {
     }
 
     bool IndexScanNode::hasField(const string& field) const {
-        // There is no covering in a multikey index because you don't know whether or not the field
-        // in the key was extracted from an array in the original document.
-        if (indexIsMultiKey) { return false; }
-
+        // There is no covering by a multikey field because you don't know whether or not the
+        // field in the key was extracted from an array in the original document.  Nor by a
+        // field that is only there as its hash.
         BSONObjIterator it(indexKeyPattern);
-        while (it.more()) {
-            if (field == it.next().fieldName()) {
-                return true;
+        for (unsigned pos = 0; it.more(); ++pos) {
+            BSONElement elt = it.next();
+            if (field == elt.fieldName()) {
+                if (mongoutils::str::equals("hashed", elt.valuestrsafe())
+                    || mongoutils::str::equals("hashtable", elt.valuestrsafe())) {
+                    return false;
+                }
+                return !indexIsMultiKey
+                    || (pos < 31 && !(indexMultikeyFields & (1u << pos)));
             }
         }
         return false;
@@ -599,4 +628,22 @@ namespace mongo {
         children[0]->appendToString(ss, indent + 2);
     }
 
+    //
+    // CountNode
+    //
+
+    void CountNode::appendToString(stringstream* ss, int indent) const {
+        addIndent(ss, indent);
+        *ss << "COUNT\n";
+        addIndent(ss, indent + 1);
+        *ss << "keyPattern = " << indexKeyPattern << endl;
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            addIndent(ss, indent + 1);
+            *ss << "range = " << (ranges[i].startKeyInclusive ? "[" : "(")
+                << ranges[i].startKey.toString() << ", " << ranges[i].endKey.toString()
+                << (ranges[i].endKeyInclusive ? "]" : ")") << endl;
+        }
+        addCommon(ss, indent);
+    }
+
 }  // namespace mongo
@@ -185,7 +185,7 @@ namespace mongo {
     };
 
     struct TextNode : public QuerySolutionNode {
-        TextNode() { }
+        TextNode() : _limit(0) { }
         virtual ~TextNode() { }
 
         virtual StageType getType() const { return STAGE_TEXT; }
@@ -203,6 +203,10 @@ namespace mongo {
         BSONObj  _indexKeyPattern;
         std::string _query;
         std::string _language;
+
+        // Set when the results are sorted by score and only this many are kept.  0 if all the
+        // results are wanted.
+        size_t _limit;
     };
 
     struct CollectionScanNode : public QuerySolutionNode {
@@ -323,11 +327,14 @@ namespace mongo {
         virtual void appendToString(stringstream* ss, int indent) const;
 
         bool fetched() const { return true; }
-        bool hasField(const string& field) const { return true; }
+        bool hasField(const string& field) const;
         bool sortedByDiskLoc() const { return children[0]->sortedByDiskLoc(); }
         const BSONObjSet& getSort() const { return children[0]->getSort(); }
 
         BSONObjSet _sorts;
+
+        // If not empty, only these top-level fields of each document are passed up.
+        vector<string> fields;
     };
 
     struct IndexScanNode : public QuerySolutionNode {
@@ -349,6 +356,8 @@ namespace mongo {
 
         BSONObj indexKeyPattern;
         bool indexIsMultiKey;
+        // See IndexEntry::multikeyFields.
+        unsigned indexMultikeyFields;
 
         // Only set for 2d.
         int limit;
@@ -566,4 +575,29 @@ namespace mongo {
         const BSONObjSet& getSort() const { return children[0]->getSort(); }
     };
 
+    /**
+     * Counts the keys of a btree in some key ranges.  Only makes sense for a count whose
+     * predicate is answered exactly by the index bounds.  See
+     * QueryPlannerAnalysis::turnIxscanIntoCount.
+     */
+    struct CountNode : public QuerySolutionNode {
+        CountNode() : indexIsMultiKey(false) { }
+        virtual ~CountNode() { }
+
+        virtual StageType getType() const { return STAGE_COUNT; }
+        virtual void appendToString(stringstream* ss, int indent) const;
+
+        bool fetched() const { return false; }
+        bool hasField(const string& field) const { return false; }
+        bool sortedByDiskLoc() const { return false; }
+        const BSONObjSet& getSort() const { return _sorts; }
+        BSONObjSet _sorts;
+
+        BSONObj indexKeyPattern;
+        bool indexIsMultiKey;
+
+        // In index order.
+        vector<IndexKeyRange> ranges;
+    };
+
 }  // namespace mongo
@@ -29,6 +29,8 @@
 #pragma once
 
 #include "mongo/db/clientcursor.h"
+#include "mongo/db/kill_current_op.h"
+#include "mongo/db/lockstate.h"
 #include "mongo/util/elapsed_tracker.h"
 
 namespace mongo {
@@ -45,8 +47,22 @@ namespace mongo {
             }
         }
 
+        /**
+         * Every so often, checks whether anyone is queued behind us: while we hold a read lock
+         * only a writer can be, otherwise any lock request can.  Nobody waiting means a yield
+         * would only cost us, so we carry on.  An interrupted operation always yields, as
+         * that's where it notices.
+         */
         bool shouldYield() {
-            return _elapsedTracker.intervalHasElapsed();
+            if (!_elapsedTracker.intervalHasElapsed()) {
+                return false;
+            }
+
+            int waiting = LockState::numWritersPending();
+            if (!Lock::isReadLocked()) {
+                waiting += LockState::numReadersPending();
+            }
+            return waiting > 0 || *killCurrentOp.checkForInterruptNoAssert();
         }
 
         /**
@@ -33,11 +33,13 @@
 #include "mongo/db/exec/and_hash.h"
 #include "mongo/db/exec/and_sorted.h"
 #include "mongo/db/exec/collection_scan.h"
+#include "mongo/db/exec/count.h"
 #include "mongo/db/exec/fetch.h"
 #include "mongo/db/exec/index_scan.h"
 #include "mongo/db/exec/limit.h"
 #include "mongo/db/exec/merge_sort.h"
 #include "mongo/db/exec/or.h"
+#include "mongo/db/exec/prefetch.h"
 #include "mongo/db/exec/projection.h"
 #include "mongo/db/exec/s2near.h"
 #include "mongo/db/exec/shard_filter.h"
@@ -46,10 +48,66 @@
 #include "mongo/db/exec/text.h"
 #include "mongo/db/index/fts_access_method.h"
 #include "mongo/db/namespace_details.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/structure/collection.h"
 
 namespace mongo {
 
+    MONGO_EXPORT_SERVER_PARAMETER(fetchPrefetchLookahead, int, 16);
+
+    static PlanStage* buildIndexScan(const QuerySolution& qsol, const IndexScanNode* ixn,
+                                     WorkingSet* ws, bool prefetchRecords) {
+        //
+        // XXX XXX
+        // Given that this grabs data from the catalog, we must do this inside of a lock.
+        // We should change this to take a (ns, index key pattern) pair so that the params
+        // don't involve any on-disk data, just descriptions thereof.
+        // XXX XXX
+        //
+        Database* db = cc().database();
+        Collection* collection = db ? db->getCollection(qsol.ns) : NULL;
+        if (NULL == collection) {
+            warning() << "Can't ixscan null ns " << qsol.ns << endl;
+            return NULL;
+        }
+        NamespaceDetails* nsd = collection->details();
+        int idxNo = nsd->findIndexByKeyPattern(ixn->indexKeyPattern);
+        if (-1 == idxNo) {
+            warning() << "Can't find idx " << ixn->indexKeyPattern.toString()
+                      << "in ns " << qsol.ns << endl;
+            return NULL;
+        }
+        IndexScanParams params;
+        params.descriptor = collection->getIndexCatalog()->getDescriptor( idxNo );
+        params.bounds = ixn->bounds;
+        params.direction = ixn->direction;
+        params.limit = ixn->limit;
+        params.maxScan = ixn->maxScan;
+        params.addKeyMetadata = ixn->addKeyMetadata;
+        params.prefetchRecords = prefetchRecords;
+        return new IndexScan(params, ws, ixn->filter.get());
+    }
+
+    static PlanStage* buildCount(const QuerySolution& qsol, const CountNode* cn) {
+        Database* db = cc().database();
+        Collection* collection = db ? db->getCollection(qsol.ns) : NULL;
+        if (NULL == collection) {
+            warning() << "Can't count null ns " << qsol.ns << endl;
+            return NULL;
+        }
+        int idxNo = collection->details()->findIndexByKeyPattern(cn->indexKeyPattern);
+        if (-1 == idxNo) {
+            warning() << "Can't find idx " << cn->indexKeyPattern.toString()
+                      << "in ns " << qsol.ns << endl;
+            return NULL;
+        }
+        CountParams params;
+        params.descriptor = collection->getIndexCatalog()->getDescriptor( idxNo );
+        params.ranges = cn->ranges;
+        params.isMultiKey = cn->indexIsMultiKey;
+        return new Count(params);
+    }
+
     PlanStage* buildStages(const QuerySolution& qsol, const QuerySolutionNode* root, WorkingSet* ws) {
         if (STAGE_COLLSCAN == root->getType()) {
             const CollectionScanNode* csn = static_cast<const CollectionScanNode*>(root);
@@ -62,41 +120,33 @@ namespace mongo {
             return new CollectionScan(params, ws, csn->filter.get());
         }
         else if (STAGE_IXSCAN == root->getType()) {
-            const IndexScanNode* ixn = static_cast<const IndexScanNode*>(root);
-            //
-            // XXX XXX
-            // Given that this grabs data from the catalog, we must do this inside of a lock.
-            // We should change this to take a (ns, index key pattern) pair so that the params
-            // don't involve any on-disk data, just descriptions thereof.
-            // XXX XXX
-            //
-            Database* db = cc().database();
-            Collection* collection = db ? db->getCollection(qsol.ns) : NULL;
-            if (NULL == collection) {
-                warning() << "Can't ixscan null ns " << qsol.ns << endl;
-                return NULL;
-            }
-            NamespaceDetails* nsd = collection->details();
-            int idxNo = nsd->findIndexByKeyPattern(ixn->indexKeyPattern);
-            if (-1 == idxNo) {
-                warning() << "Can't find idx " << ixn->indexKeyPattern.toString()
-                          << "in ns " << qsol.ns << endl;
-                return NULL;
-            }
-            IndexScanParams params;
-            params.descriptor = collection->getIndexCatalog()->getDescriptor( idxNo );
-            params.bounds = ixn->bounds;
-            params.direction = ixn->direction;
-            params.limit = ixn->limit;
-            params.maxScan = ixn->maxScan;
-            params.addKeyMetadata = ixn->addKeyMetadata;
-            return new IndexScan(params, ws, ixn->filter.get());
+            return buildIndexScan(qsol, static_cast<const IndexScanNode*>(root), ws, false);
+        }
+        else if (STAGE_COUNT == root->getType()) {
+            return buildCount(qsol, static_cast<const CountNode*>(root));
         }
         else if (STAGE_FETCH == root->getType()) {
             const FetchNode* fn = static_cast<const FetchNode*>(root);
-            PlanStage* childStage = buildStages(qsol, fn->children[0], ws);
+            PlanStage* childStage;
+            if (STAGE_IXSCAN == fn->children[0]->getType()) {
+                // every key the scan returns gets fetched, so it may as well start reading them in
+                childStage = buildIndexScan(qsol,
+                                            static_cast<const IndexScanNode*>(fn->children[0]),
+                                            ws, true);
+            }
+            else {
+                childStage = buildStages(qsol, fn->children[0], ws);
+
+                // Other children don't read ahead themselves, so have it done for them.
+                Database* db = cc().database();
+                Collection* collection = db ? db->getCollection(qsol.ns) : NULL;
+                if (NULL != childStage && NULL != collection && fetchPrefetchLookahead > 0) {
+                    childStage = new PrefetchStage(ws, childStage, collection,
+                                                   fetchPrefetchLookahead);
+                }
+            }
             if (NULL == childStage) { return NULL; }
-            return new FetchStage(ws, childStage, fn->filter.get());
+            return new FetchStage(ws, childStage, fn->filter.get(), fn->fields);
         }
         else if (STAGE_SORT == root->getType()) {
             const SortNode* sn = static_cast<const SortNode*>(root);
@@ -242,6 +292,7 @@ namespace mongo {
                 return NULL;
             }
             params.query = ftsq;
+            params.limit = node->_limit;
 
             return new TextStage(params, ws, node->filter.get());
         }
@@ -249,7 +300,21 @@ namespace mongo {
             const ShardingFilterNode* fn = static_cast<const ShardingFilterNode*>(root);
             PlanStage* childStage = buildStages(qsol, fn->children[0], ws);
             if (NULL == childStage) { return NULL; }
-            return new ShardFilterStage(shardingState.getCollectionMetadata(qsol.ns), ws, childStage);
+
+            CollectionMetadataPtr metadata = shardingState.getCollectionMetadata(qsol.ns);
+
+            // A fetch over an index scan whose bounds the shard owns outright can't produce
+            // orphans, so the filter needn't look at its documents.
+            bool childOnlyOwned = false;
+            const QuerySolutionNode* child = fn->children[0];
+            if (metadata && STAGE_FETCH == child->getType()
+                && STAGE_IXSCAN == child->children[0]->getType()) {
+                const IndexScanNode* ixn = static_cast<const IndexScanNode*>(child->children[0]);
+                childOnlyOwned = ShardFilterStage::boundsOwned(*metadata, ixn->indexKeyPattern,
+                                                               ixn->bounds);
+            }
+
+            return new ShardFilterStage(metadata, ws, childStage, childOnlyOwned);
         }
         else {
             stringstream ss;
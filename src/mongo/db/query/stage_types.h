@@ -37,6 +37,10 @@ namespace mongo {
         STAGE_AND_HASH,
         STAGE_AND_SORTED,
         STAGE_COLLSCAN,
+
+        // Counts index keys without making a WorkingSetMember for them.
+        STAGE_COUNT,
+
         STAGE_FETCH,
 
         // TODO: This is probably an expression index, but would take even more time than
@@ -49,6 +53,10 @@ namespace mongo {
         STAGE_IXSCAN,
         STAGE_LIMIT,
         STAGE_OR,
+
+        // Reads records in ahead of a fetch.  Only made by the stage builder.
+        STAGE_PREFETCH,
+
         STAGE_PROJECTION,
         STAGE_SHARDING_FILTER,
         STAGE_SKIP,
@@ -52,6 +52,7 @@ namespace mongo {
     const BSONField<std::vector<TypeExplain*> > TypeExplain::allPlans("allPlans");
     const BSONField<TypeExplain*> TypeExplain::oldPlan("oldPlan");
     const BSONField<std::string> TypeExplain::server("server");
+    const BSONField<BSONObj> TypeExplain::stats("stats");
 
     TypeExplain::TypeExplain() {
         clear();
@@ -158,6 +159,8 @@ namespace mongo {
 
         if (_isServerSet) builder.append(server(), _server);
 
+        if (_isStatsSet) builder.append(stats(), _stats);
+
         return builder.obj();
     }
 
@@ -243,6 +246,10 @@ namespace mongo {
         if (fieldState == FieldParser::FIELD_INVALID) return false;
         _isServerSet = fieldState == FieldParser::FIELD_SET;
 
+        fieldState = FieldParser::extract(source, stats, &_stats, errMsg);
+        if (fieldState == FieldParser::FIELD_INVALID) return false;
+        _isStatsSet = fieldState == FieldParser::FIELD_SET;
+
         return true;
     }
 
@@ -295,6 +302,9 @@ namespace mongo {
         _server.clear();
         _isServerSet = false;
 
+        _stats = BSONObj();
+        _isStatsSet = false;
+
     }
 
     void TypeExplain::cloneTo(TypeExplain* other) const {
@@ -370,6 +380,9 @@ namespace mongo {
 
         other->_server = _server;
         other->_isServerSet = _isServerSet;
+
+        other->_stats = _stats;
+        other->_isStatsSet = _isStatsSet;
     }
 
     std::string TypeExplain::toString() const {
@@ -743,4 +756,22 @@ namespace mongo {
         return _server;
     }
 
+    void TypeExplain::setStats(const BSONObj& stats) {
+        _stats = stats.getOwned();
+        _isStatsSet = true;
+    }
+
+    void TypeExplain::unsetStats() {
+         _isStatsSet = false;
+    }
+
+    bool TypeExplain::isStatsSet() const {
+         return _isStatsSet;
+    }
+
+    const BSONObj& TypeExplain::getStats() const {
+        dassert(_isStatsSet);
+        return _stats;
+    }
+
 } // namespace mongo
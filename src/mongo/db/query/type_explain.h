@@ -64,6 +64,7 @@ namespace mongo {
         static const BSONField<std::vector<TypeExplain*> > allPlans;
         static const BSONField<TypeExplain*> oldPlan;
         static const BSONField<std::string> server;
+        static const BSONField<BSONObj> stats;
 
         //
         // construction / destruction
@@ -180,6 +181,11 @@ namespace mongo {
         bool isServerSet() const;
         const std::string& getServer() const;
 
+        void setStats(const BSONObj& stats);
+        void unsetStats();
+        bool isStatsSet() const;
+        const BSONObj& getStats() const;
+
     private:
         // Convention: (M)andatory, (O)ptional
 
@@ -247,6 +253,10 @@ namespace mongo {
         // (O)  server's host:port against which the query ran
         std::string _server;
         bool _isServerSet;
+
+        // (O)  tree of the plan's stages and what each of them did
+        BSONObj _stats;
+        bool _isStatsSet;
     };
 
 } // namespace mongo
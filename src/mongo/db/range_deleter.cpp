@@ -315,11 +315,13 @@ namespace mongo {
             sleepmillis(checkIntervalMillis);
         }
 
+        long long deletedDocs = 0;
         bool result = _env->deleteRange(ns, min, max, shardKeyPattern,
-                                        secondaryThrottle, errMsg);
+                                        secondaryThrottle, &deletedDocs, errMsg);
 
         {
             scoped_lock sl(_queueMutex);
+            _stats->addDeletedDocs_inlock(deletedDocs);
             _deleteSet.erase(&deleteRange);
 
             _stats->decInProgressDeletes_inlock();
@@ -458,11 +460,13 @@ namespace mongo {
                 _stats->incInProgressDeletes_inlock();
             }
 
+            long long deletedDocs = 0;
             if (!_env->deleteRange(nextTask->ns,
                                    nextTask->min,
                                    nextTask->max,
                                    nextTask->shardKeyPattern,
                                    nextTask->secondaryThrottle,
+                                   &deletedDocs,
                                    &errMsg)) {
                 warning() << "Error encountered while trying to delete range: "
                           << errMsg << endl;
@@ -470,6 +474,7 @@ namespace mongo {
 
             {
                 scoped_lock sl(_queueMutex);
+                _stats->addDeletedDocs_inlock(deletedDocs);
 
                 NSMinMax setEntry(nextTask->ns, nextTask->min, nextTask->max);
                 deletePtrElement(&_deleteSet, &setEntry);
@@ -280,13 +280,15 @@ namespace mongo {
          * to be able to perform deletions.
          *
          * Must be a synchronous call. Docs should be deleted after call ends.
-         * Must not throw Exceptions.
+         * Must not throw Exceptions. Sets deletedDocs to the number of documents removed,
+         * even when the delete stops early.
          */
         virtual bool deleteRange(const StringData& ns,
                                  const BSONObj& inclusiveLower,
                                  const BSONObj& exclusiveUpper,
                                  const BSONObj& shardKeyPattern,
                                  bool secondaryThrottle,
+                                 long long* deletedDocs,
                                  std::string* errMsg) = 0;
 
         /**
@@ -53,7 +53,9 @@ namespace mongo {
                                         const BSONObj& exclusiveUpper,
                                         const BSONObj& keyPattern,
                                         bool secondaryThrottle,
+                                        long long* deletedDocs,
                                         std::string* errMsg) {
+        *deletedDocs = 0;
         const bool initiallyHaveClient = haveClient();
 
         if (!initiallyHaveClient) {
@@ -97,6 +99,8 @@ namespace mongo {
                     return false;
                 }
 
+                *deletedDocs = numDeleted;
+
                 log() << "rangeDeleter deleted " << numDeleted
                       << " documents for " << ns
                       << " from " << inclusiveLower
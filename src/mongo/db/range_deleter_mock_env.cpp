@@ -105,7 +105,9 @@ namespace mongo {
                                           const BSONObj& max,
                                           const BSONObj& shardKeyPattern,
                                           bool secondaryThrottle,
+                                          long long* deletedDocs,
                                           string* errMsg) {
+        *deletedDocs = 0;
 
         {
             scoped_lock sl(_pauseDeleteMutex);
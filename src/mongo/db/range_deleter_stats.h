@@ -52,6 +52,9 @@ namespace mongo {
         // Total number of deletes that are currently in progress.
         static const BSONField<int> InProgressDeletesField;
 
+        // Total number of documents removed by finished deletes.
+        static const BSONField<long long> DeletedDocsField;
+
         /**
          * Creates a stat object given the mutex from the RangeDeleter object
          * that this instance is keeping track of.
@@ -60,7 +63,8 @@ namespace mongo {
             _lockPtr(lockPtr),
             _totalDeletes(0),
             _pendingDeletes(0),
-            _inProgressDeletes(0) {
+            _inProgressDeletes(0),
+            _deletedDocs(0) {
         }
 
         /**
@@ -100,6 +104,10 @@ namespace mongo {
             _inProgressDeletes--;
         }
 
+        void addDeletedDocs_inlock(long long count) {
+            _deletedDocs += count;
+        }
+
         bool hasInProgress_inlock() {
             return _inProgressDeletes > 0;
         }
@@ -111,5 +119,6 @@ namespace mongo {
         int _totalDeletes;
         int _pendingDeletes;
         int _inProgressDeletes;
+        long long _deletedDocs;
     };
 }
@@ -33,6 +33,7 @@
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/replication_server_status.h"
 #include "mongo/db/repl/rs_sync.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/util/fail_point_service.h"
@@ -51,10 +52,9 @@ namespace replset {
     boost::mutex BackgroundSync::s_mutex;
 
     //The number and time spent reading batches off the network
-    static TimerStats getmoreReplStats;
     static ServerStatusMetricField<TimerStats> displayBatchesRecieved(
                                                     "repl.network.getmores",
-                                                    &getmoreReplStats );
+                                                    &replStageStats.fetch );
     //The oplog entries read via the oplog reader
     static Counter64 opsReadStats;
     static ServerStatusMetricField<Counter64> displayOpsRead( "repl.network.ops",
@@ -398,7 +398,7 @@ namespace replset {
 
                 {
                     //record time for each getmore
-                    TimerHolder batchTimer(&getmoreReplStats);
+                    TimerHolder batchTimer(&replStageStats.fetch);
                     
                     // This calls receiveMore() on the oplogreader cursor.
                     // It can wait up to five seconds for more data.
@@ -495,6 +495,10 @@ namespace replset {
         bufferSizeGauge.decrement(getSize(op));
     }
 
+    void BackgroundSync::peekAhead(size_t max, std::vector<BSONObj>* ops) {
+        _buffer.peekFront(max, ops);
+    }
+
     bool BackgroundSync::isStale(OplogReader& r, BSONObj& remoteOldestOp) {
         remoteOldestOp = r.findOne(rsoplog, Query());
         OpTime remoteTs = remoteOldestOp["ts"]._opTime();
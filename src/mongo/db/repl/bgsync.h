@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <boost/thread/mutex.hpp>
 
 #include "mongo/util/queue.h"
@@ -53,6 +55,10 @@ namespace replset {
         // called by sync thread after it has applied an op
         virtual void consume() = 0;
 
+        // Copies up to max ops from the head of the buffer into ops without removing them,
+        // for the sync thread to prefetch what it will apply next
+        virtual void peekAhead(size_t max, std::vector<BSONObj>* ops) = 0;
+
         // Returns the member we're currently syncing from (or NULL)
         virtual const Member* getSyncTarget() = 0;
 
@@ -147,6 +153,7 @@ namespace replset {
 
         virtual bool peek(BSONObj* op);
         virtual void consume();
+        virtual void peekAhead(size_t max, std::vector<BSONObj>* ops);
         virtual const Member* getSyncTarget();
         virtual void waitForMore();
 
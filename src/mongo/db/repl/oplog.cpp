@@ -128,20 +128,14 @@ namespace mongo {
         OpTime::setLast( ts );
     }
 
-    /** given a BSON object, create a new one at dst which is the existing (partial) object
-        with a new object element appended at the end with fieldname "o".
+    /** the size of the object append_O_Obj() builds */
+    static int o_ObjSize(const BSONObj& partial, const BSONObj& o) {
+        return partial.objsize() + o.objsize() + 1 + 2 /*o:*/;
+    }
 
-        @param partial already build object with everything except the o member.  e.g. something like:
-               { ts:..., ns:..., os2:... }
-        @param o a bson object to be added with fieldname "o"
-        @dst   where to put the newly built combined object.  e.g. ends up as something like:
-               { ts:..., ns:..., os2:..., o:... }
-    */
-    void append_O_Obj(char *dst, const BSONObj& partial, const BSONObj& o) {
+    /** as append_O_Obj(), where the caller has already declared the write to 'p' */
+    static void write_O_Obj(void *p, const BSONObj& partial, const BSONObj& o) {
         const int size1 = partial.objsize() - 1;  // less the EOO char
-        const int oOfs = size1+3;                 // 3 = byte BSONOBJTYPE + byte 'o' + byte \0
-
-        void *p = getDur().writingPtr(dst, oOfs+o.objsize()+1);
 
         memcpy(p, partial.objdata(), size1);
 
@@ -158,6 +152,19 @@ namespace mongo {
         *b = EOO;
     }
 
+    /** given a BSON object, create a new one at dst which is the existing (partial) object
+        with a new object element appended at the end with fieldname "o".
+
+        @param partial already build object with everything except the o member.  e.g. something like:
+               { ts:..., ns:..., os2:... }
+        @param o a bson object to be added with fieldname "o"
+        @dst   where to put the newly built combined object.  e.g. ends up as something like:
+               { ts:..., ns:..., os2:..., o:... }
+    */
+    void append_O_Obj(char *dst, const BSONObj& partial, const BSONObj& o) {
+        write_O_Obj(getDur().writingPtr(dst, o_ObjSize(partial, o)), partial, o);
+    }
+
     /* we write to local.oplog.rs:
          { ts : ..., h: ..., v: ..., op: ..., etc }
        ts: an OpTime timestamp
@@ -177,6 +184,23 @@ namespace mongo {
 
     */
 
+    /* todo: now() has code to handle clock skew.  but if the skew server to server is large it
+             will get unhappy.  this code (or code in now() maybe) should be improved.
+    */
+    static void checkOplogTimeOrder(const OpTime& ts) {
+        if( !(theReplSet->lastOpTimeWritten<ts) ) {
+            log() << "replication oplog stream went back in time. previous timestamp: "
+                  << theReplSet->lastOpTimeWritten << " newest timestamp: " << ts
+                  << ". attempting to sync directly from primary." << endl;
+            std::string errmsg;
+            BSONObjBuilder result;
+            if (!theReplSet->forceSyncFrom(theReplSet->box.getPrimary()->fullName(),
+                                           errmsg, result)) {
+                log() << "Can't sync from primary: " << errmsg << endl;
+            }
+        }
+    }
+
     // global is safe as we are in write lock. we put the static outside the function to avoid the implicit mutex 
     // the compiler would use if inside the function.  the reason this is static is to avoid a malloc/free for this
     // on every logop call.
@@ -239,21 +263,8 @@ namespace mongo {
             }
             Client::Context ctx(logns , localDB);
             r = theDataFileMgr.fast_oplog_insert(rsOplogDetails, logns, len);
-            /* todo: now() has code to handle clock skew.  but if the skew server to server is large it will get unhappy.
-                     this code (or code in now() maybe) should be improved.
-                     */
             if( theReplSet ) {
-                if( !(theReplSet->lastOpTimeWritten<ts) ) {
-                    log() << "replication oplog stream went back in time. previous timestamp: "
-                          << theReplSet->lastOpTimeWritten << " newest timestamp: " << ts
-                          << ". attempting to sync directly from primary." << endl;
-                    std::string errmsg;
-                    BSONObjBuilder result;
-                    if (!theReplSet->forceSyncFrom(theReplSet->box.getPrimary()->fullName(),
-                                                   errmsg, result)) {
-                        log() << "Can't sync from primary: " << errmsg << endl;
-                    }
-                }
+                checkOplogTimeOrder(ts);
                 theReplSet->lastOpTimeWritten = ts;
                 theReplSet->lastH = hashNew;
                 ctx.getClient()->setLastOp( ts );
@@ -265,6 +276,95 @@ namespace mongo {
         LOG( 6 ) << "logOp:" << BSONObj::make(r) << endl;
     }
 
+    /** fills in the entries [first, end) of _logInsertsRS(), which lie back to back in the
+        oplog, declaring them to the journal as a single write intent
+    */
+    static void writeOplogRun(const vector<Record*>& records,
+                              const vector<BSONObj>& partials,
+                              const vector<BSONObj>& docs,
+                              size_t first,
+                              size_t end) {
+        char *start = records[first]->data();
+        char *last = records[end-1]->data() + o_ObjSize(partials[end-1], docs[end-1]);
+        char *p = static_cast<char*>(getDur().writingPtr(start, last - start));
+        for ( size_t i = first; i < end; i++ )
+            write_O_Obj(p + (records[i]->data() - start), partials[i], docs[i]);
+    }
+
+    /** _logOpRS() for the inserts of 'docs' into 'ns'.  The entries are allocated one after
+        another under a single lock and usually land back to back in the capped extent, so
+        rather than one journal write intent per entry there is one per contiguous run.
+    */
+    static void _logInsertsRS(const char *ns, const vector<BSONObj>& docs) {
+        Lock::DBWrite lk1("local");
+
+        if ( strncmp(ns, "local.", 6) == 0 ) {
+            if ( strncmp(ns, "local.slaves", 12) == 0 )
+                resetSlaveCache();
+            return;
+        }
+
+        mutex::scoped_lock lk2(OpTime::m);
+
+        massert(17369, "replSet error : logOp() but not primary?",
+                theReplSet && theReplSet->box.getState().primary());
+
+        const char *logns = rsoplog;
+        if ( rsOplogDetails == 0 ) {
+            Client::Context ctx(logns, storageGlobalParams.dbpath);
+            localDB = ctx.db();
+            verify( localDB );
+            rsOplogDetails = nsdetails(logns);
+            massert(17370, "local.oplog.rs missing. did you drop it? if so restart server",
+                    rsOplogDetails);
+        }
+        Client::Context ctx(logns , localDB);
+
+        vector<BSONObj> partials;
+        vector<Record*> records;
+        partials.reserve(docs.size());
+        records.reserve(docs.size());
+
+        OpTime ts;
+        long long hashNew = theReplSet->lastH;
+        size_t first = 0;
+        for ( size_t i = 0; i < docs.size(); i++ ) {
+            ts = OpTime::now(lk2);
+            hashNew = (hashNew * 131 + ts.asLL()) * 17 + theReplSet->selfId();
+
+            BSONObjBuilder b;
+            b.appendTimestamp("ts", ts.asDate());
+            b.append("h", hashNew);
+            b.append("v", OPLOG_VERSION);
+            b.append("op", "i");
+            b.append("ns", ns);
+            partials.push_back(b.obj());
+
+            if ( i == 0 )
+                checkOplogTimeOrder(ts);
+            records.push_back(theDataFileMgr.fast_oplog_insert(rsOplogDetails, logns,
+                                                               o_ObjSize(partials[i], docs[i])));
+
+            // a run ends where the oplog wraps; fill it in now, as allocating past the wrap
+            // reclaims the oldest records and must never get around to unwritten ones
+            if ( i > 0 ) {
+                const char *prevEnd = reinterpret_cast<char*>(records[i-1]) +
+                                      records[i-1]->lengthWithHeaders();
+                if ( reinterpret_cast<char*>(records[i]) != prevEnd ) {
+                    writeOplogRun(records, partials, docs, first, i);
+                    first = i;
+                }
+            }
+        }
+        writeOplogRun(records, partials, docs, first, records.size());
+
+        theReplSet->lastOpTimeWritten = ts;
+        theReplSet->lastH = hashNew;
+        ctx.getClient()->setLastOp( ts );
+
+        LOG( 6 ) << "logInsertOps: " << docs.size() << " ops on " << ns << endl;
+    }
+
     static void _logOpOld(const char *opstr, const char *ns, const char *logNS, const BSONObj& obj, BSONObj *o2, bool *bb, bool fromMigrate ) {
         Lock::DBWrite lk("local");
         static BufBuilder bufbuilder(8*1024); // todo there is likely a mutex on this constructor
@@ -377,6 +477,31 @@ namespace mongo {
 
     }
 
+    void logInsertOps(const char* ns, const vector<BSONObj>& docs) {
+        if ( docs.empty() )
+            return;
+
+        if ( replSettings.master ) {
+            if ( _logOp == _logOpRS ) {
+                _logInsertsRS(ns, docs);
+            }
+            else {
+                for ( size_t i = 0; i < docs.size(); i++ )
+                    _logOp("i", ns, 0, docs[i], 0, 0, false);
+            }
+        }
+
+        for ( size_t i = 0; i < docs.size(); i++ ) {
+            logOpForSharding("i", ns, docs[i], NULL, NULL, false);
+            logOpForDbHash("i", ns, docs[i], NULL, NULL, false);
+            getGlobalAuthorizationManager()->logOp("i", ns, docs[i], NULL, NULL);
+        }
+
+        if ( strstr( ns, ".system.js" ) ) {
+            Scope::storedFuncMod(); // this is terrible
+        }
+    }
+
     void createOplog() {
         Lock::GlobalWrite lk;
 
@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <vector>
+
 namespace mongo {
 
     class BSONObj;
@@ -70,6 +72,13 @@ namespace mongo {
                 BSONObj *patt = NULL, bool *b = NULL, bool fromMigrate = false,
                 const BSONObj* fullObj = NULL );
 
+    /**
+     * logOp("i", ns, docs[i]) for each of 'docs', in order, for a caller that inserted them all
+     * under one write lock.  On a replica set primary the entries are written in one pass,
+     * with a journal write intent per contiguous run of them rather than one per entry.
+     */
+    void logInsertOps( const char* ns, const std::vector<BSONObj>& docs );
+
     // Log an empty no-op operation to the local oplog
     void logKeepalive();
 
@@ -42,6 +42,7 @@
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/db/wire_version.h"
+#include "mongo/util/net/message_compression.h"
 
 namespace mongo {
 
@@ -49,6 +50,18 @@ namespace mongo {
     // our config from command line etc.
     ReplSettings replSettings;
 
+    ReplStageStats replStageStats;
+
+    static ServerStatusMetricField<TimerStats> displayFetchStage( "repl.stages.fetch",
+                                                                  &replStageStats.fetch );
+    static ServerStatusMetricField<TimerStats> displayPrefetchStage( "repl.stages.prefetch",
+                                                                     &replStageStats.prefetch );
+    static ServerStatusMetricField<TimerStats> displayApplyStage( "repl.stages.apply",
+                                                                  &replStageStats.apply );
+    static ServerStatusMetricField<TimerStats> displayOplogWriteStage(
+                                                    "repl.stages.oplogWrite",
+                                                    &replStageStats.oplogWrite );
+
     bool anyReplEnabled() {
         return replSettings.slave || replSettings.master || theReplSet;
     }
@@ -181,6 +194,7 @@ namespace mongo {
             result.appendDate("localTime", jsTime());
             result.append("maxWireVersion", maxWireVersion);
             result.append("minWireVersion", minWireVersion);
+            negotiateCompression(cmdObj, cc().port(), &result);
             return true;
         }
     } cmdismaster;
@@ -32,6 +32,7 @@
 #include <string>
 
 #include "mongo/db/jsobj.h"
+#include "mongo/db/stats/timer_stats.h"
 #include "mongo/util/concurrency/mutex.h"
 
 
@@ -96,4 +97,19 @@ namespace mongo {
     };
 
     extern ReplSettings replSettings;
+
+    /**
+     * The time a secondary spends in each stage of replication: each getmore fetching ops from
+     * its sync source, and per batch of ops, prefetching what the batch touches once applying
+     * waits on it, applying the batch and writing it to the local oplog.  Reported under
+     * serverStatus' metrics.repl.stages.
+     */
+    struct ReplStageStats {
+        TimerStats fetch;
+        TimerStats prefetch;
+        TimerStats apply;
+        TimerStats oplogWrite;
+    };
+
+    extern ReplStageStats replStageStats;
 }
@@ -549,8 +549,8 @@ namespace mongo {
         friend class Consensus;
 
     private:
-        bool _syncDoInitialSync_clone(Cloner &cloner, const char *master,
-                                      const list<string>& dbs, bool dataPass);
+        bool _syncDoInitialSync_clone(const char *master, const list<string>& dbs,
+                                      bool dataPass);
         bool _syncDoInitialSync_applyToHead( replset::SyncTail& syncer, OplogReader* r ,
                                              const Member* source, const BSONObj& lastOp,
                                              BSONObj& minValidOut);
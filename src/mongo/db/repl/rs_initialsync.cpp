@@ -30,6 +30,8 @@
 
 #include "mongo/db/repl/rs.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_manager_global.h"
 #include "mongo/db/client.h"
@@ -41,6 +43,7 @@
 #include "mongo/bson/optime.h"
 #include "mongo/db/repl/replication_server_status.h"  // replSettings
 #include "mongo/db/repl/rs_sync.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
@@ -81,44 +84,126 @@ namespace mongo {
         fassert( 16233, failedAttempts < maxFailedAttempts);
     }
 
-    bool ReplSetImpl::_syncDoInitialSync_clone(Cloner& cloner, const char *master,
-                                               const list<string>& dbs, bool dataPass) {
-
-        for( list<string>::const_iterator i = dbs.begin(); i != dbs.end(); i++ ) {
-            string db = *i;
-            if( db == "local" ) 
-                continue;
-            
-            if ( dataPass )
-                sethbmsg( str::stream() << "initial sync cloning db: " << db , 0);
-            else
-                sethbmsg( str::stream() << "initial sync cloning indexes for : " << db , 0);
-
-            Client::WriteContext ctx(db);
-
-            string err;
-            int errCode;
-            CloneOptions options;
-            options.fromDB = db;
-            options.logForRepl = false;
-            options.slaveOk = true;
-            options.useReplAuth = true;
-            options.snapshot = false;
-            options.mayYield = true;
-            options.mayBeInterrupted = false;
-            options.syncData = dataPass;
-            options.syncIndexes = ! dataPass;
-
-            if (!cloner.go(master, options, err, &errCode)) {
-                sethbmsg(str::stream() << "initial sync: error while "
-                                       << (dataPass ? "cloning " : "indexing ") << db
-                                       << ".  " << (err.empty() ? "" : err + ".  ")
-                                       << "sleeping 5 minutes" ,0);
+    // databases cloned at once, each by a thread with its own connection to the sync source.
+    // 1 for the old serial behavior
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(initialSyncCloneThreads, int, 4);
+
+    namespace {
+
+        /**
+         * Clones the databases in a list shared by its threads, each taking the next database
+         * and write locking only that one.  A clone that fails stops the others from starting
+         * on another database; an exception is passed on to the caller once all have stopped.
+         */
+        class ParallelClone : boost::noncopyable {
+        public:
+            ParallelClone(const char* master, const list<string>& dbs, bool dataPass)
+                : _master(master), _dataPass(dataPass),
+                  _mutex("ParallelClone"), _dbs(dbs), _failed(false), _errCode(0) {
+            }
+
+            bool run(int nThreads) {
+                boost::thread_group threads;
+                for (int i = 0; i < std::max(nThreads, 1); i++) {
+                    threads.create_thread(boost::bind(&ParallelClone::cloneThread, this, i));
+                }
+                threads.join_all();
+
+                if (!_exception.empty()) {
+                    throw DBException(_exception, _errCode);
+                }
+                return !_failed;
+            }
+
+        private:
+            void cloneThread(int id) {
+                const string name = str::stream() << "initial sync clone " << id;
+                Client::initThread(name.c_str());
+                replLocalAuth();
+
+                Cloner cloner;
+                string db;
+                try {
+                    while (next(&db) && cloneDatabase(cloner, db))
+                        ;
+                }
+                catch (const DBException& e) {
+                    log() << "replSet initial sync exception cloning " << db << ": "
+                          << e.toString() << rsLog;
+                    scoped_lock lk(_mutex);
+                    _failed = true;
+                    if (_exception.empty()) {
+                        _exception = e.what();
+                        _errCode = e.getCode();
+                    }
+                }
+                cc().shutdown();
+            }
+
+            /** @return false once the list is done or a clone has failed */
+            bool next(string* db) {
+                scoped_lock lk(_mutex);
+                while (!_failed && !_dbs.empty()) {
+                    *db = _dbs.front();
+                    _dbs.pop_front();
+                    if (*db != "local")
+                        return true;
+                }
                 return false;
             }
-        }
 
-        return true;
+            bool cloneDatabase(Cloner& cloner, const string& db) {
+                if ( _dataPass )
+                    theReplSet->sethbmsg( str::stream() << "initial sync cloning db: " << db , 0);
+                else
+                    theReplSet->sethbmsg( str::stream() << "initial sync cloning indexes for : "
+                                                        << db , 0);
+
+                Client::WriteContext ctx(db);
+
+                string err;
+                int errCode;
+                CloneOptions options;
+                options.fromDB = db;
+                options.logForRepl = false;
+                options.slaveOk = true;
+                options.useReplAuth = true;
+                options.snapshot = false;
+                options.mayYield = true;
+                options.mayBeInterrupted = false;
+                options.syncData = _dataPass;
+                options.syncIndexes = ! _dataPass;
+
+                if (!cloner.go(_master, options, err, &errCode)) {
+                    theReplSet->sethbmsg(str::stream() << "initial sync: error while "
+                                                       << (_dataPass ? "cloning " : "indexing ")
+                                                       << db << ".  "
+                                                       << (err.empty() ? "" : err + ".  ")
+                                                       << "sleeping 5 minutes" ,0);
+                    scoped_lock lk(_mutex);
+                    _failed = true;
+                    return false;
+                }
+                return true;
+            }
+
+            const char* const _master;
+            const bool _dataPass;
+
+            mongo::mutex _mutex;
+            // guarded by _mutex
+            list<string> _dbs;
+            bool _failed;
+            string _exception;
+            int _errCode;
+        };
+
+    } // namespace
+
+    bool ReplSetImpl::_syncDoInitialSync_clone(const char *master, const list<string>& dbs,
+                                               bool dataPass) {
+        ParallelClone clone(master, dbs, dataPass);
+        return clone.run(initialSyncCloneThreads);
     }
 
     void _logOpObjRS(const BSONObj& op);
@@ -410,8 +495,7 @@ namespace mongo {
 
             list<string> dbs = r.conn()->getDatabaseNames();
 
-            Cloner cloner;
-            if (!_syncDoInitialSync_clone(cloner, sourceHostname.c_str(), dbs, true)) {
+            if (!_syncDoInitialSync_clone(sourceHostname.c_str(), dbs, true)) {
                 veto(source->fullName(), 600);
                 sleepsecs(300);
                 return;
@@ -438,7 +522,7 @@ namespace mongo {
             lastOp = minValid;
 
             sethbmsg("initial sync building indexes",0);
-            if (!_syncDoInitialSync_clone(cloner, sourceHostname.c_str(), dbs, false)) {
+            if (!_syncDoInitialSync_clone(sourceHostname.c_str(), dbs, false)) {
                 veto(source->fullName(), 600);
                 sleepsecs(300);
                 return;
@@ -199,6 +199,14 @@ namespace mongo {
                          o["usePowerOf2Sizes"].type() == Bool ) {
                         log() << "replSet not rolling back change of usePowerOf2Sizes: " << o;
                     }
+                    else if ( o.nFields() == 2 &&
+                              o["scanReadahead"].type() == Bool ) {
+                        log() << "replSet not rolling back change of scanReadahead: " << o;
+                    }
+                    else if ( o.nFields() == 2 &&
+                              o["compressRecords"].type() == Bool ) {
+                        log() << "replSet not rolling back change of compressRecords: " << o;
+                    }
                     else {
                         log() << "replSet error cannot rollback a collMod command: " << o;
                         throw rsfatal();
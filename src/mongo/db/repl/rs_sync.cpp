@@ -37,13 +37,19 @@
 #include "mongo/db/client.h"
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/d_concurrency.h"
+#include "mongo/db/database_holder.h"
+#include "mongo/db/hasher.h"
+#include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/prefetch.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rs_sync.h"
+#include "mongo/db/repl/replication_server_status.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
+#include "mongo/db/structure/collection.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/stats/timer_stats.h"
@@ -67,11 +73,16 @@ namespace replset {
 
     MONGO_FP_DECLARE(rsSyncApplyStop);
 
+    // Spread the ops on one collection over the writers by _id; see fillWriterVectors()
+    MONGO_EXPORT_SERVER_PARAMETER(replApplyByDocument, bool, true);
+
+    // How long applying a batch should take; see SyncTail::adjustBatchLimit()
+    MONGO_EXPORT_SERVER_PARAMETER(replBatchTargetMillis, int, 200);
+
     // Number and time of each ApplyOps worker pool round
-    static TimerStats applyBatchStats;
     static ServerStatusMetricField<TimerStats> displayOpBatchesApplied(
                                                     "repl.apply.batches",
-                                                    &applyBatchStats );
+                                                    &replStageStats.apply );
     //The oplog entries applied
     static Counter64 opsAppliedStats;
     static ServerStatusMetricField<Counter64> displayOpsApplied( "repl.apply.ops",
@@ -79,7 +90,8 @@ namespace replset {
 
 
     SyncTail::SyncTail(BackgroundSyncInterface *q) :
-        Sync(""), oplogVersion(0), _networkQueue(q)
+        Sync(""), oplogVersion(0), _batchLimitOperations(replBatchLimitOperations),
+        _networkQueue(q)
     {}
 
     SyncTail::~SyncTail() {}
@@ -131,6 +143,9 @@ namespace replset {
     void initializePrefetchThread() {
         if (!ClientBasic::getCurrent()) {
             Client::initThread("repl prefetch worker");
+            // prefetch the next batch while the writers apply this one; readers of the
+            // prefetched pages never see them
+            Lock::ParallelBatchWriterMode::iAmABatchParticipant();
             replLocalAuth();
         }
     }
@@ -224,22 +239,43 @@ namespace replset {
         }
     }
 
-    // Doles out all the work to the reader pool threads and waits for them to complete
+    // Doles out all the work to the reader pool threads and waits for them to complete.
+    // Ops prefetchAhead() already handed out aren't handed out again; since those may not
+    // be done either, this waits for them too.
     void SyncTail::prefetchOps(const std::deque<BSONObj>& ops) {
         threadpool::ThreadPool& prefetcherPool = theReplSet->getPrefetchPool();
+        TimerHolder timer(&replStageStats.prefetch);
         for (std::deque<BSONObj>::const_iterator it = ops.begin();
              it != ops.end();
              ++it) {
-            prefetcherPool.schedule(&prefetchOp, *it);
+            if ((*it)["ts"]._opTime() > _prefetchedThrough) {
+                prefetcherPool.schedule(&prefetchOp, *it);
+            }
         }
         prefetcherPool.join();
     }
+
+    // Only a hint: an op still gets applied if it wasn't prefetched, so after a rollback
+    // leaves _prefetchedThrough ahead of the ops fetched next, they just go without.
+    void SyncTail::prefetchAhead() {
+        std::vector<BSONObj> next;
+        _networkQueue->peekAhead(_batchLimitOperations, &next);
+
+        threadpool::ThreadPool& prefetcherPool = theReplSet->getPrefetchPool();
+        for (std::vector<BSONObj>::const_iterator it = next.begin(); it != next.end(); ++it) {
+            const OpTime ts = (*it)["ts"]._opTime();
+            if (ts > _prefetchedThrough) {
+                prefetcherPool.schedule(&prefetchOp, *it);
+                _prefetchedThrough = ts;
+            }
+        }
+    }
     
     // Doles out all the work to the writer pool threads and waits for them to complete
     void SyncTail::applyOps(const std::vector< std::vector<BSONObj> >& writerVectors, 
                                      MultiSyncApplyFunc applyFunc) {
         ThreadPool& writerPool = theReplSet->getWriterPool();
-        TimerHolder timer(&applyBatchStats);
+        TimerHolder timer(&replStageStats.apply);
         for (std::vector< std::vector<BSONObj> >::const_iterator it = writerVectors.begin();
              it != writerVectors.end();
              ++it) {
@@ -247,11 +283,31 @@ namespace replset {
                 writerPool.schedule(applyFunc, boost::cref(*it), this);
             }
         }
+        prefetchAhead();
         writerPool.join();
     }
 
+    // Batches that apply well within replBatchTargetMillis grow, so each round of the writer
+    // pool (and each time readers are held off) covers more ops; batches that take much longer
+    // shrink, unless they were small already (a command or an index build is a batch of its
+    // own).  The byte limit still caps batches of large ops.
+    void SyncTail::adjustBatchLimit(size_t batchOps, int applyMillis) {
+        const int target = replBatchTargetMillis;
+        if (batchOps >= _batchLimitOperations && applyMillis < target / 2) {
+            _batchLimitOperations = std::min(_batchLimitOperations * 2, replBatchMaxOperations);
+        }
+        else if (applyMillis > target * 2 && batchOps > replBatchMinOperations) {
+            _batchLimitOperations = std::max(_batchLimitOperations / 2, replBatchMinOperations);
+        }
+        else {
+            return;
+        }
+        LOG(2) << "replSet batches are now up to " << _batchLimitOperations << " ops" << rsLog;
+    }
+
     // Doles out all the work to the writer pool threads and waits for them to complete
     void SyncTail::multiApply( std::deque<BSONObj>& ops, MultiSyncApplyFunc applyFunc ) {
+        Timer batchTimer;
 
         // Use a ThreadPool to prefetch all the operations in a batch.
         prefetchOps(ops);
@@ -268,11 +324,84 @@ namespace replset {
         Lock::ParallelBatchWriterMode pbwm;
 
         applyOps(writerVectors, applyFunc);
+
+        adjustBatchLimit(ops.size(), batchTimer.millis());
     }
 
 
+    namespace {
+
+        /**
+         * The _id of the document an insert, update or delete op applies to; eoo for any
+         * other op.  An update's o2 is the query, which names the _id when it was logged
+         * for a document.
+         */
+        BSONElement opDocumentId(const BSONObj& op) {
+            const char* opType = op["op"].valuestrsafe();
+            if (opType[0] == '\0' || opType[1] != '\0')
+                return BSONElement();
+            switch (opType[0]) {
+            case 'i':
+            case 'd':
+                return op.getObjectField("o")["_id"];
+            case 'u':
+                return op.getObjectField("o2")["_id"];
+            default:
+                return BSONElement();
+            }
+        }
+
+        /**
+         * Whether ops on different documents of 'ns' may be applied in any order relative to
+         * each other.  Not so for a capped collection, whose documents must be inserted in
+         * oplog order, nor with a unique index besides _id's, whose keys may pass from one
+         * document to another within a batch.  A collection that doesn't exist yet is left
+         * to a single writer, which creates it.
+         */
+        bool canApplyByDocument(const StringData& ns) {
+            Lock::DBRead lk(ns);
+            Database* db = dbHolder().get(ns.toString(), storageGlobalParams.dbpath);
+            if (!db)
+                return false;
+            Collection* collection = db->getCollection(ns);
+            if (!collection || collection->isCapped())
+                return false;
+
+            IndexCatalog::IndexIterator ii =
+                collection->getIndexCatalog()->getIndexIterator(true);
+            while (ii.more()) {
+                IndexDescriptor* desc = ii.next();
+                if (desc->unique() && !desc->isIdIndex())
+                    return false;
+            }
+            return true;
+        }
+
+    } // namespace
+
+    // Ops on one namespace go to one writer, in order, unless they can go by document: then
+    // all ops on one _id go to one writer, in order, and a hot collection keeps every writer
+    // busy.  Commands and index builds are always in batches of their own (see
+    // tryPopAndWaitForMore()), so nothing else needs ordering against them.
     void SyncTail::fillWriterVectors(const std::deque<BSONObj>& ops, 
                                               std::vector< std::vector<BSONObj> >* writerVectors) {
+        // every op on a namespace must name its document for the namespace to go by document
+        std::map<std::string, bool> byDocument;
+        if (replApplyByDocument) {
+            for (std::deque<BSONObj>::const_iterator it = ops.begin();
+                 it != ops.end();
+                 ++it) {
+                const char* ns = it->getStringField("ns");
+                std::map<std::string, bool>::iterator i = byDocument.find(ns);
+                if (i == byDocument.end()) {
+                    const bool ok = *ns != '\0' && canApplyByDocument(ns);
+                    i = byDocument.insert(std::make_pair(std::string(ns), ok)).first;
+                }
+                if (i->second && opDocumentId(*it).eoo())
+                    i->second = false;
+            }
+        }
+
         for (std::deque<BSONObj>::const_iterator it = ops.begin();
              it != ops.end();
              ++it) {
@@ -283,6 +412,14 @@ namespace replset {
             uint32_t hash = 0;
             MurmurHash3_x86_32( ns, len, 0, &hash);
 
+            if (replApplyByDocument && byDocument[ns]) {
+                // hashed like a hashed index key, so equal _ids of different numeric types
+                // land together
+                const long long idHash = BSONElementHasher::hash64(
+                        opDocumentId(*it), BSONElementHasher::DEFAULT_HASH_SEED);
+                MurmurHash3_x86_32( &idHash, sizeof(idHash), hash, &hash);
+            }
+
             (*writerVectors)[hash % writerVectors->size()].push_back(*it);
         }
     }
@@ -322,7 +459,7 @@ namespace replset {
                 if (!ops.empty()) {
                     if (now > replBatchLimitSeconds)
                         break;
-                    if (ops.getDeque().size() > replBatchLimitOperations)
+                    if (ops.getDeque().size() > _batchLimitOperations)
                         break;
                 }
             }
@@ -408,7 +545,7 @@ namespace replset {
                 if (!ops.empty()) {
                     if (now > replBatchLimitSeconds)
                         break;
-                    if (ops.getDeque().size() > replBatchLimitOperations)
+                    if (ops.getDeque().size() > _batchLimitOperations)
                         break;
                 }
                 // occasionally check some things
@@ -568,6 +705,7 @@ namespace replset {
 
     void SyncTail::applyOpsToOplog(std::deque<BSONObj>* ops) {
         {
+            TimerHolder timer(&replStageStats.oplogWrite);
             Lock::DBWrite lk("local");
             while (!ops->empty()) {
                 const BSONObj& op = ops->front();
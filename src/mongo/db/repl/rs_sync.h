@@ -112,14 +112,25 @@ namespace replset {
         static const unsigned int replBatchLimitBytes = dur::UncommittedBytesLimit;
         static const int replBatchLimitSeconds = 1;
         static const unsigned int replBatchLimitOperations = 5000;
+        // bounds for _batchLimitOperations
+        static const unsigned int replBatchMinOperations = 500;
+        static const unsigned int replBatchMaxOperations = 50000;
 
         // Prefetch and write a deque of operations, using the supplied function.
         // Initial Sync and Sync Tail each use a different function.
         void multiApply(std::deque<BSONObj>& ops, MultiSyncApplyFunc applyFunc);
 
+        // Splits a batch among the writers
+        void fillWriterVectors(const std::deque<BSONObj>& ops,
+                               std::vector< std::vector<BSONObj> >* writerVectors);
+
         // The version of the last op to be read
         int oplogVersion;
 
+        // Ops in a batch, at most; starts at replBatchLimitOperations and follows how fast
+        // batches are applied, see adjustBatchLimit()
+        unsigned int _batchLimitOperations;
+
     private:
         BackgroundSyncInterface* _networkQueue;
 
@@ -127,13 +138,19 @@ namespace replset {
         void prefetchOps(const std::deque<BSONObj>& ops);
         // Used by the thread pool readers to prefetch an op
         static void prefetchOp(const BSONObj& op);
+        // Has the reader pool prefetch the ops waiting to make up the next batch, without
+        // waiting for it
+        void prefetchAhead();
+        // The last op prefetchAhead() handed to the reader pool
+        OpTime _prefetchedThrough;
+
+        // Grows or shrinks the next batch after one of batchOps ops took applyMillis
+        void adjustBatchLimit(size_t batchOps, int applyMillis);
 
         // Doles out all the work to the writer pool threads and waits for them to complete
         void applyOps(const std::vector< std::vector<BSONObj> >& writerVectors, 
                       MultiSyncApplyFunc applyFunc);
 
-        void fillWriterVectors(const std::deque<BSONObj>& ops, 
-                               std::vector< std::vector<BSONObj> >* writerVectors);
         void handleSlaveDelay(const BSONObj& op);
         void setOplogVersion(const BSONObj& op);
     };
@@ -118,8 +118,6 @@ namespace mongo {
                     db.update( NS , i->first , i->second , true );
                 }
                 _currentlyUpdatingCache = false;
-
-                _threadsWaitingForReplication.notify_all();
             }
         }
 
@@ -128,6 +126,16 @@ namespace mongo {
                 return;
             scoped_lock mylk(_mutex);
             _slaves.clear();
+
+            // e.g. on stepping down: let everyone look again
+            for ( map<int,WaiterQueue>::iterator i = _waitersForNum.begin();
+                  i != _waitersForNum.end(); ++i ) {
+                _wake( i->second, i->second.end() );
+            }
+            for ( map<string,WaiterQueue>::iterator i = _waitersForMode.begin();
+                  i != _waitersForMode.end(); ++i ) {
+                _wake( i->second, i->second.end() );
+            }
         }
 
         bool update( const BSONObj& rid , const BSONObj config , const string& ns , OpTime last ) {
@@ -153,7 +161,7 @@ namespace mongo {
                     go();
                 }
 
-                _threadsWaitingForReplication.notify_all();
+                _wakeWaiters_inlock();
             }
             return true;
         }
@@ -209,25 +217,67 @@ namespace mongo {
             if ( w <= 1 )
                 return true;
 
-            w--; // now this is the # of slaves i need
-
-            boost::xtime xt;
-            boost::xtime_get(&xt, MONGO_BOOST_TIME_UTC);
-            xt.sec += maxSecondsToWait;
-            
-            scoped_lock mylk(_mutex);
-            while ( ! _replicatedToNum_slaves_locked( op, w ) ) {
-                if ( ! _threadsWaitingForReplication.timed_wait( mylk.boost() , xt ) ) {
-                    massert(noLongerMasterAssertCode,
-                            "waitForReplication called but not master anymore", _isMaster());
+            Timer t;
+            while ( ! replicatedToNum( op, w ) ) {
+                const long long left = maxSecondsToWait * 1000LL - t.millis();
+                if ( left <= 0 )
                     return false;
-                }
+                waitForProgress( op, w, "", static_cast<int>( left ) );
                 massert(noLongerMasterAssertCode, 
                         "waitForReplication called but not master anymore", _isMaster());
             }
             return true;
         }
 
+        /**
+         * Sleeps until 'op' has made it to w servers, or with w 0 to those getLastError mode
+         * 'wMode' asks for, or for maxMillis at most.  The caller checks which.
+         */
+        void waitForProgress(OpTime op, int w, const string& wMode, int maxMillis) {
+            if ( wMode == "majority" ) {
+                if ( !theReplSet )
+                    return;
+                w = theReplSet->config().getMajority();
+            }
+
+            scoped_lock mylk(_mutex);
+
+            WaiterQueue* queue;
+            if ( w > 0 ) {
+                if ( w <= 1 || _replicatedToNum_slaves_locked( op, w - 1 ) )
+                    return;
+                queue = &_waitersForNum[w - 1];
+            }
+            else {
+                if ( !theReplSet )
+                    return;
+                const map<string,ReplSetConfig::TagRule*>& rules = theReplSet->config().rules;
+                map<string,ReplSetConfig::TagRule*>::const_iterator it = rules.find( wMode );
+                if ( it == rules.end() || op <= it->second->last )
+                    return;
+                queue = &_waitersForMode[wMode];
+            }
+
+            Waiter waiter;
+            WaiterQueue::iterator pos = queue->insert( make_pair( op, &waiter ) );
+
+            boost::xtime xt;
+            boost::xtime_get(&xt, MONGO_BOOST_TIME_UTC);
+            xt.sec += maxMillis / 1000;
+            xt.nsec += ( maxMillis % 1000 ) * 1000000;
+            if ( xt.nsec >= 1000000000 ) {
+                xt.nsec -= 1000000000;
+                xt.sec++;
+            }
+
+            while ( ! waiter.woken ) {
+                if ( ! waiter.cond.timed_wait( mylk.boost(), xt ) )
+                    break;
+            }
+            if ( ! waiter.woken )
+                queue->erase( pos );
+        }
+
         bool _replicatedToNum_slaves_locked(OpTime& op, int numSlaves ) {
             for ( map<Ident,OpTime>::iterator i=_slaves.begin(); i!=_slaves.end(); i++) {
                 OpTime s = i->second;
@@ -263,9 +313,73 @@ namespace mongo {
             return _slaves.size();
         }
 
+    private:
+        /** a thread in waitForProgress() */
+        struct Waiter {
+            Waiter() : woken(false) {}
+            boost::condition cond;
+            bool woken;
+        };
+
+        /** waiters by the op each waits for, so those an update lets go are at the front */
+        typedef multimap<OpTime,Waiter*> WaiterQueue;
+
+        /** wakes and dequeues the waiters before 'end' */
+        static void _wake( WaiterQueue& queue, WaiterQueue::iterator end ) {
+            for ( WaiterQueue::iterator i = queue.begin(); i != end; ++i ) {
+                i->second->woken = true;
+                i->second->cond.notify_one();
+            }
+            queue.erase( queue.begin(), end );
+        }
+
+        /**
+         * Wakes the waiters whose op has now replicated far enough, and only those: for each
+         * number of slaves waited for, the newest op that many have, and for each
+         * getLastError mode, the newest op its tag rule has seen.
+         */
+        void _wakeWaiters_inlock() {
+            bool anyForNum = false;
+            for ( map<int,WaiterQueue>::iterator i = _waitersForNum.begin();
+                  i != _waitersForNum.end(); ++i ) {
+                anyForNum = anyForNum || !i->second.empty();
+            }
+            if ( anyForNum ) {
+                // newest first
+                vector<OpTime> synced;
+                for ( map<Ident,OpTime>::iterator i = _slaves.begin(); i != _slaves.end(); ++i )
+                    synced.push_back( i->second );
+                sort( synced.begin(), synced.end() );
+                reverse( synced.begin(), synced.end() );
+
+                for ( map<int,WaiterQueue>::iterator i = _waitersForNum.begin();
+                      i != _waitersForNum.end(); ++i ) {
+                    const size_t numSlaves = i->first;
+                    if ( i->second.empty() || numSlaves > synced.size() )
+                        continue;
+                    _wake( i->second, i->second.upper_bound( synced[numSlaves - 1] ) );
+                }
+            }
+
+            if ( !_waitersForMode.empty() && theReplSet ) {
+                const map<string,ReplSetConfig::TagRule*>& rules = theReplSet->config().rules;
+                for ( map<string,WaiterQueue>::iterator i = _waitersForMode.begin();
+                      i != _waitersForMode.end(); ++i ) {
+                    map<string,ReplSetConfig::TagRule*>::const_iterator it =
+                        rules.find( i->first );
+                    if ( i->second.empty() || it == rules.end() )
+                        continue;
+                    _wake( i->second, i->second.upper_bound( it->second->last ) );
+                }
+            }
+        }
+
         // need to be careful not to deadlock with this
         mutable mongo::mutex _mutex;
-        boost::condition _threadsWaitingForReplication;
+
+        // entries stay once made; there are only so many w values and modes
+        map<int,WaiterQueue> _waitersForNum;         // by the number of slaves needed
+        map<string,WaiterQueue> _waitersForMode;     // by getLastError mode
 
         map<Ident,OpTime> _slaves;
         bool _dirty;
@@ -348,6 +462,10 @@ namespace mongo {
         return slaveTracking.waitForReplication( op, w, maxSecondsToWait );
     }
 
+    void waitForReplicationProgress( OpTime op , int w , const string& wMode , int maxMillis ) {
+        slaveTracking.waitForProgress( op, w, wMode, maxMillis );
+    }
+
     vector<BSONObj> getHostsWrittenTo( const OpTime& op ) {
         return slaveTracking.getHostsAtOp(op);
     }
@@ -52,6 +52,14 @@ namespace mongo {
 
     bool waitForReplication( OpTime op , int w , int maxSecondsToWait );
 
+    /**
+     * Sleeps until op may have made it to w servers, or with w 0 to those getLastError mode
+     * wMode asks for, or for maxMillis at most.  Waiters are queued by the op they wait for and
+     * only woken once replication gets there (or slave tracking is reset), so many waiting
+     * writes don't all wake on every secondary's progress.
+     */
+    void waitForReplicationProgress( OpTime op , int w , const string& wMode , int maxMillis );
+
     std::vector<BSONObj> getHostsWrittenTo( const OpTime& op );
 
     void resetSlaveCache();
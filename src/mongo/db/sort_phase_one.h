@@ -38,6 +38,7 @@ namespace mongo {
             n = 0;
             nkeys = 0;
             multi = false;
+            multiFields = 0;
         }
         shared_ptr<BSONObjExternalSorter> sorter;
         shared_ptr<ExternalSortComparison> sortCmp;
@@ -45,9 +46,15 @@ namespace mongo {
         unsigned long long n; // # of records
         unsigned long long nkeys;
         bool multi; // multikey index
+        unsigned multiFields; // and the fields that make it so
 
-        void addKeys(const BSONObjSet& keys, const DiskLoc& loc, bool mayInterrupt) {
-            multi = multi || (keys.size() > 1);
+        /** 'multikeyFields' as from BtreeBasedAccessMethod::getKeysAndMultikeyFields */
+        void addKeys(const BSONObjSet& keys, unsigned multikeyFields, const DiskLoc& loc,
+                     bool mayInterrupt) {
+            if (multikeyFields) {
+                multi = true;
+                multiFields |= multikeyFields;
+            }
             for (BSONObjSet::iterator it = keys.begin(); it != keys.end(); ++it) {
                 sorter->add(*it, loc, mayInterrupt);
                 ++nkeys;
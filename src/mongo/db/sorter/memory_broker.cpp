@@ -0,0 +1,113 @@
+/*
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#include "mongo/db/sorter/memory_broker.h"
+
+#include "mongo/db/server_parameters.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/memory_usage.h"
+
+namespace mongo {
+
+    // memory all Grants together may hold before those that can spill are asked to; 0 for no limit
+    MONGO_EXPORT_SERVER_PARAMETER(spillableMemoryLimitBytes, long long, 1024 * 1024 * 1024);
+
+namespace {
+    // changes smaller than this aren't reported to the shared counters right away
+    const size_t kReportGranularityBytes = 64 * 1024;
+
+    // operations holding less than this are never asked to spill early
+    const size_t kMinimumGrantBytes = 1024 * 1024;
+
+    AtomicInt64 totalBytesHeld;
+    AtomicInt64 bytesHeld[MemoryBroker::kNumConsumers];
+    AtomicInt64 earlySpillCount;
+}
+
+    MemoryBroker::Grant::Grant(Consumer consumer)
+        : _consumer(consumer)
+        , _reported(0) {
+        if (_consumer == kSort)
+            MemoryUsage::note(MemoryUsage::kSorter, 1, 0);
+    }
+
+    MemoryBroker::Grant::~Grant() {
+        setBytes(0);
+        if (_consumer == kSort)
+            MemoryUsage::note(MemoryUsage::kSorter, -1, 0);
+    }
+
+    void MemoryBroker::Grant::setBytes(size_t bytes) {
+        if (bytes == _reported)
+            return;
+
+        const size_t change = bytes > _reported ? bytes - _reported : _reported - bytes;
+        if (change < kReportGranularityBytes && bytes != 0)
+            return;
+
+        const long long delta = static_cast<long long>(bytes) - static_cast<long long>(_reported);
+        totalBytesHeld.fetchAndAdd(delta);
+        bytesHeld[_consumer].fetchAndAdd(delta);
+        if (_consumer == kSort)
+            MemoryUsage::note(MemoryUsage::kSorter, 0, delta);
+        _reported = bytes;
+    }
+
+    bool MemoryBroker::Grant::shouldSpillEarly() const {
+        const long long limit = spillableMemoryLimitBytes;
+        if (limit <= 0 || _reported < kMinimumGrantBytes || totalBytesHeld.load() <= limit)
+            return false;
+
+        earlySpillCount.fetchAndAdd(1);
+        return true;
+    }
+
+    long long MemoryBroker::totalBytes() {
+        return totalBytesHeld.load();
+    }
+
+    long long MemoryBroker::bytes(Consumer consumer) {
+        return bytesHeld[consumer].load();
+    }
+
+    long long MemoryBroker::earlySpills() {
+        return earlySpillCount.load();
+    }
+
+    const char* MemoryBroker::consumerName(Consumer consumer) {
+        switch (consumer) {
+        case kSort: return "sort";
+        case kGroup: return "group";
+        case kHash: return "hash";
+        case kNumConsumers: break;
+        }
+        return "unknown";
+    }
+
+} // namespace mongo
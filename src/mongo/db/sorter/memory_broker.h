@@ -0,0 +1,93 @@
+/*
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+
+#include "mongo/base/disallow_copying.h"
+
+namespace mongo {
+
+    /**
+     * Process-wide accounting of the memory held by operations that buffer data in memory: sorts,
+     * groups and hash intersections.
+     *
+     * Each operation keeps its own limit. On top of that, once all of them together hold more than
+     * the spillableMemoryLimitBytes server parameter, operations that are able to spill are asked
+     * to do so as soon as they hold more than a small minimum, rather than waiting for their own
+     * limit.
+     */
+    class MemoryBroker {
+    public:
+        enum Consumer {
+            kSort,
+            kGroup,
+            kHash,
+            kNumConsumers
+        };
+
+        /**
+         * The memory one operation holds. Whatever it still holds is given back when the Grant
+         * goes away.
+         */
+        class Grant {
+            MONGO_DISALLOW_COPYING(Grant);
+        public:
+            explicit Grant(Consumer consumer);
+            ~Grant();
+
+            /**
+             * Records that the operation now holds 'bytes'. Small changes are batched up before
+             * they reach the shared counters.
+             */
+            void setBytes(size_t bytes);
+
+            /**
+             * Returns true if the process is over its limit and this operation holds enough that
+             * it should spill now, even though it is within its own limit.
+             */
+            bool shouldSpillEarly() const;
+
+        private:
+            const Consumer _consumer;
+            size_t _reported; // what the shared counters include for this Grant
+        };
+
+        /** Bytes held by all Grants, as of their last report. */
+        static long long totalBytes();
+        static long long bytes(Consumer consumer);
+
+        /** Times an operation was told to spill early. */
+        static long long earlySpills();
+
+        static const char* consumerName(Consumer consumer);
+    };
+
+} // namespace mongo
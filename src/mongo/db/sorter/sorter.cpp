@@ -53,9 +53,11 @@
 #include "mongo/base/string_data.h"
 #include "mongo/bson/util/atomic_int.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/sorter/memory_broker.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/bufreader.h"
+#include "mongo/util/checksum.h"
 #include "mongo/util/goodies.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
@@ -107,6 +109,15 @@ namespace mongo {
 #endif
         }
 
+        /**
+         * Spill files are a sequence of blocks, each an int32 size (negative if the block is
+         * snappy compressed), a Checksum of the stored bytes, then the bytes themselves.
+         */
+        const int kSpillBlockSize = 64 * 1024; // uncompressed
+
+        // buffered by each FileIterator, so it reads ahead a few compressed blocks at a time
+        const int kReadAheadBytes = 2 * kSpillBlockSize;
+
         /** Ensures a named file is deleted when this object goes out of scope */
         class FileDeleter {
         public:
@@ -163,8 +174,11 @@ namespace mongo {
                 , _done(false)
                 , _fileName(fileName)
                 , _fileDeleter(fileDeleter)
-                , _file(_fileName.c_str(), std::ios::in | std::ios::binary)
+                , _readAheadBuffer(new char[kReadAheadBytes])
             {
+                // must be set up before opening
+                _file.rdbuf()->pubsetbuf(_readAheadBuffer.get(), kReadAheadBytes);
+                _file.open(_fileName.c_str(), std::ios::in | std::ios::binary);
                 massert(16814, str::stream() << "error opening file \"" << _fileName << "\": "
                                              << myErrnoWithDescription(),
                         _file.good());
@@ -207,10 +221,20 @@ namespace mongo {
                 const bool compressed = rawSize < 0;
                 const int32_t blockSize = std::abs(rawSize);
 
+                Checksum stored;
+                read(&stored, sizeof(stored));
+                massert(17361, "file too short?", !_done);
+
                 _buffer.reset(new char[blockSize]);
                 read(_buffer.get(), blockSize);
                 massert(16816, "file too short?", !_done);
 
+                Checksum actual;
+                actual.gen(_buffer.get(), blockSize);
+                massert(17362, str::stream() << "checksum mismatch in sort file \"" << _fileName
+                                             << "\"",
+                        actual == stored);
+
                 if (!compressed) {
                     _reader.reset(new BufReader(_buffer.get(), blockSize));
                     return;
@@ -255,6 +279,7 @@ namespace mongo {
             boost::scoped_ptr<BufReader> _reader;
             string _fileName;
             boost::shared_ptr<FileDeleter> _fileDeleter; // Must outlive _file
+            boost::scoped_array<char> _readAheadBuffer; // Must outlive _file
             std::ifstream _file;
         };
 
@@ -397,6 +422,7 @@ namespace mongo {
                 , _settings(settings)
                 , _opts(opts)
                 , _memUsed(0)
+                , _grant(MemoryBroker::kSort)
             { verify(_opts.limit == 0); }
 
             void add(const Key& key, const Value& val) {
@@ -405,7 +431,9 @@ namespace mongo {
                 _memUsed += key.memUsageForSorter();
                 _memUsed += val.memUsageForSorter();
 
-                if (_memUsed > _opts.maxMemoryUsageBytes)
+                _grant.setBytes(_memUsed);
+                if (_memUsed > _opts.maxMemoryUsageBytes
+                        || (_opts.extSortAllowed && _grant.shouldSpillEarly()))
                     spill();
             }
 
@@ -435,13 +463,78 @@ namespace mongo {
                 const Comparator& _comp;
             };
 
+            typedef std::pair<unsigned long long, size_t> PrefixedIndex;
+
+            class IndexComparator {
+            public:
+                IndexComparator(const Comparator& comp, const std::deque<Data>& data)
+                    : _comp(comp), _data(data) {}
+                bool operator () (const PrefixedIndex& lhs, const PrefixedIndex& rhs) const {
+                    return _comp(_data[lhs.second], _data[rhs.second]) < 0;
+                }
+            private:
+                const Comparator& _comp;
+                const std::deque<Data>& _data;
+            };
+
             void sort() {
-                STLComparator less(_comp);
-                std::stable_sort(_data.begin(), _data.end(), less);
+                // not worth the extra pass and memory for small inputs
+                if (_data.size() < 1024 || !SorterKeyPrefix<Comparator>::enabled(_comp)) {
+                    STLComparator less(_comp);
+                    std::stable_sort(_data.begin(), _data.end(), less);
 
-                // Does 2x more compares than stable_sort
-                // TODO test on windows
-                //std::sort(_data.begin(), _data.end(), comp);
+                    // Does 2x more compares than stable_sort
+                    // TODO test on windows
+                    //std::sort(_data.begin(), _data.end(), comp);
+                    return;
+                }
+
+                const size_t n = _data.size();
+                std::vector<PrefixedIndex> keys(n);
+                for (size_t i = 0; i < n; i++)
+                    keys[i] = PrefixedIndex(SorterKeyPrefix<Comparator>::get(_comp, _data[i]), i);
+
+                radixSortByPrefix(&keys);
+
+                // only elements with equal prefixes still need comparing
+                IndexComparator less(_comp, _data);
+                for (size_t start = 0; start < n; ) {
+                    size_t end = start + 1;
+                    while (end < n && keys[end].first == keys[start].first)
+                        end++;
+                    if (end - start > 1)
+                        std::stable_sort(keys.begin() + start, keys.begin() + end, less);
+                    start = end;
+                }
+
+                std::deque<Data> sorted;
+                for (size_t i = 0; i < n; i++) {
+                    dassert(i == 0 || !less(keys[i], keys[i - 1]));
+                    sorted.push_back(_data[keys[i].second]);
+                }
+                _data.swap(sorted);
+            }
+
+            /** stable LSD radix sort, a byte at a time, skipping bytes that all keys share */
+            static void radixSortByPrefix(std::vector<PrefixedIndex>* keys) {
+                std::vector<PrefixedIndex> scratch(keys->size());
+                for (int shift = 0; shift < 64; shift += 8) {
+                    size_t counts[256] = {0};
+                    for (size_t i = 0; i < keys->size(); i++)
+                        counts[((*keys)[i].first >> shift) & 0xff]++;
+                    if (counts[((*keys)[0].first >> shift) & 0xff] == keys->size())
+                        continue;
+
+                    size_t offsets[256];
+                    size_t total = 0;
+                    for (int b = 0; b < 256; b++) {
+                        offsets[b] = total;
+                        total += counts[b];
+                    }
+                    for (size_t i = 0; i < keys->size(); i++)
+                        scratch[offsets[((*keys)[i].first >> shift) & 0xff]++] = (*keys)[i];
+                    keys->swap(scratch);
+                }
             }
 
             void spill() {
@@ -464,12 +557,14 @@ namespace mongo {
                 _iters.push_back(boost::shared_ptr<Iterator>(writer.done()));
 
                 _memUsed = 0;
+                _grant.setBytes(0);
             }
 
             const Comparator _comp;
             const Settings _settings;
             SortOptions _opts;
             size_t _memUsed;
+            MemoryBroker::Grant _grant;
             std::deque<Data> _data; // the "current" data
             std::vector<boost::shared_ptr<Iterator> > _iters; // data that has already been spilled
         };
@@ -536,6 +631,7 @@ namespace mongo {
                 , _settings(settings)
                 , _opts(opts)
                 , _memUsed(0)
+                , _grant(MemoryBroker::kSort)
                 , _haveCutoff(false)
                 , _worstCount(0)
                 , _medianCount(0)
@@ -567,7 +663,9 @@ namespace mongo {
                     if (_data.size() == _opts.limit)
                         std::make_heap(_data.begin(), _data.end(), less);
 
-                    if (_memUsed > _opts.maxMemoryUsageBytes)
+                    _grant.setBytes(_memUsed);
+                    if (_memUsed > _opts.maxMemoryUsageBytes
+                            || (_opts.extSortAllowed && _grant.shouldSpillEarly()))
                         spill();
 
                     return;
@@ -590,7 +688,9 @@ namespace mongo {
                 _data.back() = contender;
                 std::push_heap(_data.begin(), _data.end(), less);
 
-                if (_memUsed > _opts.maxMemoryUsageBytes)
+                _grant.setBytes(_memUsed);
+                if (_memUsed > _opts.maxMemoryUsageBytes
+                        || (_opts.extSortAllowed && _grant.shouldSpillEarly()))
                     spill();
             }
 
@@ -733,12 +833,14 @@ namespace mongo {
                 _iters.push_back(boost::shared_ptr<Iterator>(writer.done()));
 
                 _memUsed = 0;
+                _grant.setBytes(0);
             }
 
             const Comparator _comp;
             const Settings _settings;
             SortOptions _opts;
             size_t _memUsed;
+            MemoryBroker::Grant _grant;
             std::vector<Data> _data; // the "current" data. Organized as max-heap if size == limit.
             std::vector<boost::shared_ptr<Iterator> > _iters; // data that has already been spilled
 
@@ -801,7 +903,7 @@ namespace mongo {
         key.serializeForSorter(_buffer);
         val.serializeForSorter(_buffer);
 
-        if (_buffer.len() > 64*1024)
+        if (_buffer.len() > sorter::kSpillBlockSize)
             spill();
     }
 
@@ -816,16 +918,18 @@ namespace mongo {
         snappy::Compress(_buffer.buf(), _buffer.len(), &compressed);
         verify(compressed.size() <= size_t(std::numeric_limits<int32_t>::max()));
 
+        const bool useCompressed = compressed.size() < size_t(_buffer.len()/10*9);
+        const char* block = useCompressed ? compressed.data() : _buffer.buf();
+        const int32_t blockSize = useCompressed ? compressed.size() : _buffer.len();
+        const int32_t size = useCompressed ? -blockSize : blockSize; // negative means compressed
+
+        Checksum checksum;
+        checksum.gen(block, blockSize);
+
         try {
-            if (compressed.size() < size_t(_buffer.len()/10*9)) {
-                const int32_t size = -int32_t(compressed.size()); // negative means compressed
-                _file.write(reinterpret_cast<const char*>(&size), sizeof(size));
-                _file.write(compressed.data(), compressed.size());
-            } else {
-                const int32_t size = _buffer.len();
-                _file.write(reinterpret_cast<const char*>(&size), sizeof(size));
-                _file.write(_buffer.buf(), _buffer.len());
-            }
+            _file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            _file.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+            _file.write(block, blockSize);
         } catch (const std::exception&) {
             msgasserted(16821, str::stream() << "error writing to file \"" << _fileName << "\": "
                                              << sorter::myErrnoWithDescription());
@@ -128,6 +128,20 @@ namespace mongo {
         }
     };
 
+    /**
+     * Comparators may specialize this to let the Sorter order its in-memory data by a 64-bit
+     * prefix of each element, computed once per element, and only call the comparator to break
+     * ties between equal prefixes.  Prefixes must agree with the comparator: if
+     * get(comp, a) < get(comp, b) then comp(a, b) < 0.
+     */
+    template <typename Comparator>
+    struct SorterKeyPrefix {
+        static bool enabled(const Comparator& comp) { return false; }
+
+        template <typename Data>
+        static unsigned long long get(const Comparator& comp, const Data& data) { return 0; }
+    };
+
     /// This is the output from the sorting framework
     template <typename Key, typename Value>
     class SortIteratorInterface {
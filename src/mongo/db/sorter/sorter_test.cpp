@@ -246,6 +246,31 @@ namespace mongo {
         }
     };
 
+    class FileIteratorDetectsCorruption {
+    public:
+        void run() {
+            unittest::TempDir tempDir("fileIteratorCorruptionTests");
+            SortedFileWriter<IntWrapper, IntWrapper> sorter(SortOptions().TempDir(tempDir.path()));
+            for (int i=0; i < 100*1000; i++)
+                sorter.addAlreadySorted(i,-i);
+            boost::shared_ptr<IWIterator> iter(sorter.done());
+
+            // flip a byte somewhere past the first block header
+            const std::string fileName =
+                boost::filesystem::directory_iterator(tempDir.path())->path().string();
+            {
+                std::fstream file(fileName.c_str(),
+                                  std::ios::in | std::ios::out | std::ios::binary);
+                file.seekg(1000);
+                char c = file.get();
+                file.seekp(1000);
+                file.put(c ^ 0x55);
+            }
+
+            ASSERT_THROWS(while (iter->more()) iter->next(), MsgAssertionException);
+        }
+    };
+
 
 
     class MergeIteratorTests {
@@ -304,6 +329,50 @@ namespace mongo {
         }
     };
 
+    // Compares keys only; its prefix is a key's high bits, so many keys tie on it.
+    class CoarsePrefixComparator {
+    public:
+        int operator() (const IWPair& lhs, const IWPair& rhs) const {
+            if (lhs.first == rhs.first) return 0;
+            return lhs.first < rhs.first ? -1 : 1;
+        }
+    };
+
+    template <>
+    struct SorterKeyPrefix<CoarsePrefixComparator> {
+        static bool enabled(const CoarsePrefixComparator& comp) { return true; }
+        static unsigned long long get(const CoarsePrefixComparator& comp, const IWPair& data) {
+            return (static_cast<unsigned>(static_cast<int>(data.first)) ^ 0x80000000u) >> 10;
+        }
+    };
+
+    class PrefixSortTests {
+    public:
+        void run() {
+            boost::scoped_ptr<IWSorter> sorter(IWSorter::make(SortOptions(),
+                                                              CoarsePrefixComparator()));
+            std::vector<int> keys;
+            for (int i = 0; i < 20*1000; i++) {
+                const int key = (i * 7919) % 50000 - 25000; // negatives, and each key twice
+                keys.push_back(key);
+                sorter->add(key, i);
+            }
+            std::sort(keys.begin(), keys.end());
+
+            boost::scoped_ptr<IWIterator> it(sorter->done());
+            int prevValue = -1;
+            for (size_t i = 0; i < keys.size(); i++) {
+                ASSERT(it->more());
+                const IWPair pair = it->next();
+                ASSERT_EQUALS(keys[i], pair.first);
+                if (i > 0 && keys[i] == keys[i - 1])
+                    ASSERT_LESS_THAN(prevValue, pair.second); // stable
+                prevValue = pair.second;
+            }
+            ASSERT(!it->more());
+        }
+    };
+
     namespace SorterTests {
         class Basic {
         public:
@@ -531,7 +600,9 @@ namespace mongo {
         void setupTests() {
             add<InMemIterTests>();
             add<SortedFileWriterAndFileIteratorTests>();
+            add<FileIteratorDetectsCorruption>();
             add<MergeIteratorTests>();
+            add<PrefixSortTests>();
             add<SorterTests::Basic>();
             add<SorterTests::Limit>();
             add<SorterTests::Dupes>();
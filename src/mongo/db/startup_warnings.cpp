@@ -33,6 +33,7 @@
 
 #include "mongo/db/storage_options.h"
 #include "mongo/util/log.h"
+#include "mongo/util/numa.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/version.h"
 
@@ -87,7 +88,8 @@ namespace mongo {
             warned = true;
         }
 
-        if (boost::filesystem::exists("/sys/devices/system/node/node1")){
+        // with numaPlacement on we place memory ourselves, and don't need numactl
+        if (!numa::enabled() && boost::filesystem::exists("/sys/devices/system/node/node1")){
             // We are on a box with a NUMA enabled kernel and more than 1 numa node (they start at
             // node0)
             // Now we look at the first line of /proc/self/numa_maps
@@ -128,6 +130,8 @@ namespace mongo {
                               << "performance problems:" << startupWarningsLog;
                         log() << "**              numactl --interleave=all mongod [other options]"
                               << startupWarningsLog;
+                        log() << "**          or with --setParameter numaPlacement=true"
+                              << startupWarningsLog;
                         warned = true;
                     }
                 }
@@ -33,6 +33,7 @@
 #include "mongo/db/stats/counters.h"
 
 #include "mongo/db/jsobj.h"
+#include "mongo/util/net/message_compression.h"
 
 namespace mongo {
     OpCounters::OpCounters() {}
@@ -59,38 +60,83 @@ namespace mongo {
         }
     }
 
+    unsigned OpCounters::_get( Counter counter ) const {
+        unsigned n = 0;
+        for ( int i = 0; i < NumStripes; i++ )
+            n += _stripes[i].n[counter].load();
+        return n;
+    }
+
     void OpCounters::_checkWrap() {
         const unsigned MAX = 1 << 30;
         
-        bool wrap =
-            _insert.get() > MAX ||
-            _query.get() > MAX ||
-            _update.get() > MAX ||
-            _delete.get() > MAX ||
-            _getmore.get() > MAX ||
-            _command.get() > MAX;
+        bool wrap = false;
+        for ( int c = 0; c < NumCounters; c++ )
+            wrap = wrap || _get( static_cast<Counter>( c ) ) > MAX;
         
         if ( wrap ) {
-            _insert.zero();
-            _query.zero();
-            _update.zero();
-            _delete.zero();
-            _getmore.zero();
-            _command.zero();
+            for ( int i = 0; i < NumStripes; i++ ) {
+                for ( int c = 0; c < NumCounters; c++ )
+                    _stripes[i].n[c].store( 0 );
+            }
         }
     }
 
     BSONObj OpCounters::getObj() const {
         BSONObjBuilder b;
-        b.append( "insert" , _insert.get() );
-        b.append( "query" , _query.get() );
-        b.append( "update" , _update.get() );
-        b.append( "delete" , _delete.get() );
-        b.append( "getmore" , _getmore.get() );
-        b.append( "command" , _command.get() );
+        b.append( "insert" , getInsert() );
+        b.append( "query" , getQuery() );
+        b.append( "update" , getUpdate() );
+        b.append( "delete" , getDelete() );
+        b.append( "getmore" , getGetMore() );
+        b.append( "command" , getCommand() );
         return b.obj();
     }
 
+    NetworkCounter::NetworkCounter()
+        : _bytesIn(0), _bytesOut(0), _requests(0), _overflows(0),
+          _recvMicros( timingOptions() ), _replyMicros( timingOptions() ) {
+    }
+
+    Histogram::Options NetworkCounter::timingOptions() {
+        // 8us up to about 4s
+        Histogram::Options opts;
+        opts.numBuckets = 20;
+        opts.bucketSize = 8;
+        opts.exponential = true;
+        return opts;
+    }
+
+    namespace {
+
+        uint32_t clampMicros( long long micros ) {
+            if ( micros < 0 )
+                return 0;
+            return static_cast<uint32_t>( std::min( micros, 0xffffffffLL ) );
+        }
+
+        /** the non-empty buckets as [ { micros: <upper bound>, count: <n> }, ... ] */
+        void appendHistogram( BSONObjBuilder& b, const char* name, const Histogram& h ) {
+            BSONArrayBuilder buckets( b.subarrayStart( name ) );
+            for ( uint32_t i = 0; i < h.getBucketsNum(); i++ ) {
+                const long long count = h.getCount( i );
+                if ( count == 0 )
+                    continue;
+                BSONObjBuilder bucket( buckets.subobjStart() );
+                bucket.appendNumber( "micros", static_cast<long long>( h.getBoundary( i ) ) );
+                bucket.appendNumber( "count", count );
+                bucket.done();
+            }
+            buckets.done();
+        }
+
+    } // namespace
+
+    void NetworkCounter::hitTiming( long long recvMicros , long long replyMicros ) {
+        _recvMicros.insert( clampMicros( recvMicros ) );
+        _replyMicros.insert( clampMicros( replyMicros ) );
+    }
+
     void NetworkCounter::hit( long long bytesIn , long long bytesOut ) {
         const long long MAX = 1ULL << 60;
 
@@ -120,6 +166,24 @@ namespace mongo {
         b.appendNumber( "bytesOut" , _bytesOut );
         b.appendNumber( "numRequests" , _requests );
         _lock.unlock();
+
+        BSONObjBuilder compression( b.subobjStart( "compression" ) );
+        const long long wireIn = messageCompressionCounters.wireIn.get();
+        const long long uncompressedIn = messageCompressionCounters.uncompressedIn.get();
+        const long long wireOut = messageCompressionCounters.wireOut.get();
+        const long long uncompressedOut = messageCompressionCounters.uncompressedOut.get();
+        compression.appendNumber( "bytesIn" , wireIn );
+        compression.appendNumber( "uncompressedBytesIn" , uncompressedIn );
+        compression.appendNumber( "bytesOut" , wireOut );
+        compression.appendNumber( "uncompressedBytesOut" , uncompressedOut );
+        compression.append( "ratioIn" , wireIn ? double(uncompressedIn) / wireIn : 0.0 );
+        compression.append( "ratioOut" , wireOut ? double(uncompressedOut) / wireOut : 0.0 );
+        compression.done();
+
+        BSONObjBuilder timing( b.subobjStart( "timing" ) );
+        appendHistogram( timing , "recvMicros" , _recvMicros );
+        appendHistogram( timing , "replyMicros" , _replyMicros );
+        timing.done();
     }
 
 
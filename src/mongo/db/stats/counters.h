@@ -34,50 +34,62 @@
 #include "../../util/net/message.h"
 #include "../../util/processinfo.h"
 #include "../../util/concurrency/spin_lock.h"
+#include "mongo/util/concurrency/thread_stripe.h"
+#include "mongo/util/histogram.h"
 #include "mongo/db/pdfile.h"
 
 namespace mongo {
 
     /**
      * for storing operation counters
-     * note: not thread safe.  ok with that for speed
+     *
+     * Each thread counts in a stripe of its own (see threadStripe()) and readers sum the
+     * stripes, so operations on different cores don't fight over the counters' cache line.
+     * A read racing with increments may miss some of them.
      */
     class OpCounters {
     public:
 
         OpCounters();
-        void incInsertInWriteLock(int n) { _insert.x += n; }
-        void gotInsert() { _insert++; }
-        void gotQuery() { _query++; }
-        void gotUpdate() { _update++; }
-        void gotDelete() { _delete++; }
-        void gotGetMore() { _getmore++; }
-        void gotCommand() { _command++; }
+        void incInsertInWriteLock(int n) { _inc( Insert, n ); }
+        void gotInsert() { _inc( Insert, 1 ); }
+        void gotQuery() { _inc( Query, 1 ); }
+        void gotUpdate() { _inc( Update, 1 ); }
+        void gotDelete() { _inc( Delete, 1 ); }
+        void gotGetMore() { _inc( GetMore, 1 ); }
+        void gotCommand() { _inc( Command, 1 ); }
 
         void gotOp( int op , bool isCommand );
 
         BSONObj getObj() const;
         
         // thse are used by snmp, and other things, do not remove
-        const AtomicUInt * getInsert() const { return &_insert; }
-        const AtomicUInt * getQuery() const { return &_query; }
-        const AtomicUInt * getUpdate() const { return &_update; }
-        const AtomicUInt * getDelete() const { return &_delete; }
-        const AtomicUInt * getGetMore() const { return &_getmore; }
-        const AtomicUInt * getCommand() const { return &_command; }
+        unsigned getInsert() const { return _get( Insert ); }
+        unsigned getQuery() const { return _get( Query ); }
+        unsigned getUpdate() const { return _get( Update ); }
+        unsigned getDelete() const { return _get( Delete ); }
+        unsigned getGetMore() const { return _get( GetMore ); }
+        unsigned getCommand() const { return _get( Command ); }
 
 
     private:
+        enum Counter { Insert, Query, Update, Delete, GetMore, Command, NumCounters };
+
+        enum { NumStripes = 64 };
+        struct Stripe {
+            AtomicUInt32 n[NumCounters];
+            char pad[StripeAlignment - NumCounters * sizeof(AtomicUInt32)];
+        };
+
+        void _inc( Counter counter , unsigned n ) {
+            _stripes[threadStripe() % NumStripes].n[counter].fetchAndAdd( n );
+        }
+
+        unsigned _get( Counter counter ) const;
+
         void _checkWrap();
         
-        // todo: there will be a lot of cache line contention on these.  need to do something 
-        //       else eventually.
-        AtomicUInt _insert;
-        AtomicUInt _query;
-        AtomicUInt _update;
-        AtomicUInt _delete;
-        AtomicUInt _getmore;
-        AtomicUInt _command;
+        Stripe _stripes[NumStripes];
     };
 
     extern OpCounters globalOpCounters;
@@ -85,16 +97,28 @@ namespace mongo {
 
     class NetworkCounter {
     public:
-        NetworkCounter() : _bytesIn(0), _bytesOut(0), _requests(0), _overflows(0) {}
+        NetworkCounter();
         void hit( long long bytesIn , long long bytesOut );
+
+        /**
+         * records how long a request took to read off the wire and its replies to go out,
+         * from AbstractMessagingPort::lastRecvMicros() and lastReplyMicros()
+         */
+        void hitTiming( long long recvMicros , long long replyMicros );
+
         void append( BSONObjBuilder& b );
     private:
+        static Histogram::Options timingOptions();
+
         long long _bytesIn;
         long long _bytesOut;
         long long _requests;
 
         long long _overflows;
 
+        Histogram _recvMicros;
+        Histogram _replyMicros;
+
         SpinLock _lock;
     };
 
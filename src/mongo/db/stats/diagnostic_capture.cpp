@@ -0,0 +1,281 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/db/stats/diagnostic_capture.h"
+
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/repl/replication_server_status.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/stats/diagnostic_chunk.h"
+#include "mongo/db/storage_options.h"
+#include "mongo/util/background.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCaptureEnabled, bool, true);
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCapturePeriodMillis, int, 1000);
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCaptureFileSizeMB, int, 10);
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCaptureDirectorySizeMB, int, 100);
+
+    namespace {
+
+        // a minute of samples at the default period
+        const size_t kSamplesPerChunk = 60;
+
+        const char kDirectoryName[] = "diagnostic.data";
+        const char kFilePrefix[] = "metrics.";
+
+        const long long kMB = 1024 * 1024;
+
+        /**
+         * Appends chunks to the newest metrics file, starting a new one when it's full and
+         * removing the oldest ones past the directory size limit.
+         */
+        class DiagnosticDataFiles {
+        public:
+            DiagnosticDataFiles() : _fileSize(0) {}
+
+            void write(const BSONObj& chunk) {
+                if (_file.is_open() &&
+                    _fileSize >= std::max(1, diagnosticDataCaptureFileSizeMB) * kMB) {
+                    _file.close();
+                }
+                if (!_file.is_open()) {
+                    _open();
+                    _removeOldFiles();
+                }
+
+                _file.write(chunk.objdata(), chunk.objsize());
+                _file.flush();
+                massert(17387, str::stream() << "error writing " << _fileName << ": "
+                                             << errnoWithDescription(),
+                        _file.good());
+                _fileSize += chunk.objsize();
+            }
+
+        private:
+            void _open() {
+                const boost::filesystem::path dir =
+                    boost::filesystem::path(storageGlobalParams.dbpath) / kDirectoryName;
+                boost::filesystem::create_directories(dir);
+
+                // named by the time it was started, so that the names sort oldest first
+                _fileName = (dir / (kFilePrefix + terseCurrentTime(false))).string();
+                _file.clear();
+                _file.open(_fileName.c_str(), std::ios::binary | std::ios::out | std::ios::app);
+                massert(17386, str::stream() << "error opening " << _fileName << ": "
+                                             << errnoWithDescription(),
+                        _file.good());
+                _fileSize = 0;
+            }
+
+            void _removeOldFiles() {
+                const boost::filesystem::path dir =
+                    boost::filesystem::path(_fileName).parent_path();
+
+                std::vector<std::string> names;
+                boost::filesystem::directory_iterator end;
+                for (boost::filesystem::directory_iterator it(dir); it != end; ++it) {
+                    const std::string name = it->path().filename().string();
+                    if (name.compare(0, strlen(kFilePrefix), kFilePrefix) == 0 &&
+                        boost::filesystem::is_regular_file(it->status())) {
+                        names.push_back(name);
+                    }
+                }
+                std::sort(names.begin(), names.end());
+
+                const long long maxSize =
+                    std::max(1, diagnosticDataCaptureDirectorySizeMB) * kMB;
+                long long total = 0;
+                // keep the newest files that fit, always including the one just started
+                for (size_t i = names.size(); i-- > 0; ) {
+                    const boost::filesystem::path path = dir / names[i];
+                    total += boost::filesystem::file_size(path);
+                    if (total > maxSize && path.string() != _fileName) {
+                        LOG(1) << "removing old diagnostic data file " << path.string();
+                        boost::filesystem::remove(path);
+                    }
+                }
+            }
+
+            std::string _fileName;
+            std::ofstream _file;
+            long long _fileSize;
+        };
+
+        /** Runs the no-lock command 'name' as this thread and appends its result as 'name'. */
+        void appendCommandResult(const std::string& name, BSONObjBuilder* sample) {
+            Command* c = Command::findCommand(name);
+            verify(c);
+            verify(c->locktype() == Command::NONE);
+
+            BSONObj cmdObj = BSON(name << 1);
+            std::string errmsg;
+            BSONObjBuilder result;
+            if (!c->run("admin", cmdObj, 0, errmsg, result, false)) {
+                result.append("errmsg", errmsg);
+            }
+            sample->append(name, result.obj());
+        }
+
+        class DiagnosticCaptureThread : public BackgroundJob {
+        public:
+            DiagnosticCaptureThread()
+                : _chunk(kSamplesPerChunk),
+                  _mutex("DiagnosticCaptureThread") {
+            }
+
+            virtual std::string name() const { return "DiagnosticCapture"; }
+
+            virtual void run() {
+                Client::initThread(name().c_str());
+                cc().getAuthorizationSession()->grantInternalAuthorization();
+
+                while (!inShutdown()) {
+                    Timer t;
+                    try {
+                        if (diagnosticDataCaptureEnabled) {
+                            _capture();
+                        }
+                        else {
+                            _flush();
+                        }
+                    }
+                    catch (const std::exception& e) {
+                        error() << "error in " << name() << ": " << e.what();
+                    }
+
+                    const int periodMillis = std::max(100, diagnosticDataCapturePeriodMillis);
+                    sleepmillis(std::max(0, periodMillis - t.millis()));
+                }
+
+                try {
+                    _flush();
+                }
+                catch (const std::exception& e) {
+                    error() << "error in " << name() << ": " << e.what();
+                }
+                cc().shutdown();
+            }
+
+            BSONObj latest() const {
+                SimpleMutex::scoped_lock lk(_mutex);
+                return _latest;
+            }
+
+        private:
+            void _capture() {
+                BSONObjBuilder b;
+                const Date_t start = jsTime();
+                b.appendDate("start", start);
+                appendCommandResult("serverStatus", &b);
+                if (replSettings.usingReplSets()) {
+                    appendCommandResult("replSetGetStatus", &b);
+                }
+                b.appendDate("end", jsTime());
+                const BSONObj sample = b.obj();
+
+                {
+                    SimpleMutex::scoped_lock lk(_mutex);
+                    _latest = sample;
+                }
+
+                if (!_chunk.add(sample, start)) {
+                    // its shape changed
+                    _flush();
+                    _chunk.add(sample, start);
+                }
+                if (_chunk.size() >= kSamplesPerChunk) {
+                    _flush();
+                }
+            }
+
+            void _flush() {
+                if (!_chunk.empty()) {
+                    _files.write(_chunk.finish());
+                }
+            }
+
+            DiagnosticChunkBuilder _chunk;
+            DiagnosticDataFiles _files;
+
+            mutable SimpleMutex _mutex;  // protects _latest
+            BSONObj _latest;
+        };
+
+        DiagnosticCaptureThread diagnosticCaptureThread;
+
+    }  // namespace
+
+    void startDiagnosticDataCapture() {
+        diagnosticCaptureThread.go();
+    }
+
+    class GetDiagnosticDataCmd : public Command {
+    public:
+        GetDiagnosticDataCmd() : Command("getDiagnosticData") {}
+
+        virtual bool slaveOk() const { return true; }
+        virtual bool adminOnly() const { return true; }
+        virtual LockType locktype() const { return NONE; }
+        virtual void help(stringstream& help) const {
+            help << "the latest sample taken by diagnostic data capture\n"
+                 << " { getDiagnosticData : 1 }";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::serverStatus);
+            actions.addAction(ActionType::replSetGetStatus);
+            out->push_back(Privilege(ResourcePattern::forClusterResource(), actions));
+        }
+        virtual bool run(const string& , BSONObj& cmdObj, int, string& errmsg,
+                         BSONObjBuilder& result, bool fromRepl) {
+            result.appendBool("enabled", diagnosticDataCaptureEnabled);
+            result.append("data", diagnosticCaptureThread.latest());
+            return true;
+        }
+
+    } getDiagnosticDataCmd;
+
+}  // namespace mongo
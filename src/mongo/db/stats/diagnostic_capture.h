@@ -0,0 +1,51 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+namespace mongo {
+
+    /**
+     * Starts the thread that keeps diagnostic data on disk at all times, so that there is
+     * something to look at after an incident.
+     *
+     * Every diagnosticDataCapturePeriodMillis (a second by default) it runs serverStatus, which
+     * includes the lock stats, and, in a replica set, replSetGetStatus, and keeps the results as
+     * one sample.  Samples are packed sixty at a time by DiagnosticChunkBuilder, which keeps only
+     * the changes of their numbers, and the chunks appended to <dbpath>/diagnostic.data/metrics.*
+     * files, each a run of BSON documents that bsondump can read.  A new file is started once the
+     * current one reaches diagnosticDataCaptureFileSizeMB, and the oldest files are removed once
+     * all of them together pass diagnosticDataCaptureDirectorySizeMB.  The commands are run
+     * in this thread without going through the network layer, so they add nothing to the
+     * opcounters, the profiler or the log.
+     *
+     * The getDiagnosticData command returns the latest sample.
+     */
+    void startDiagnosticDataCapture();
+
+}  // namespace mongo
@@ -0,0 +1,318 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/db/stats/diagnostic_chunk.h"
+
+#include <cstring>
+#include <limits>
+
+#include "mongo/util/compress.h"
+
+namespace mongo {
+
+    namespace {
+
+        bool isMetric(BSONType type) {
+            switch (type) {
+            case NumberInt:
+            case NumberLong:
+            case NumberDouble:
+            case Bool:
+            case Date:
+            case Timestamp:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        long long metricValue(const BSONElement& e) {
+            switch (e.type()) {
+            case NumberDouble: {
+                const double d = e.numberDouble();
+                if (!(d > std::numeric_limits<long long>::min()))  // NaN too
+                    return d > 0 ? std::numeric_limits<long long>::max()
+                                 : std::numeric_limits<long long>::min();
+                if (d >= std::numeric_limits<long long>::max())
+                    return std::numeric_limits<long long>::max();
+                return static_cast<long long>(d);
+            }
+            case Bool:
+                return e.boolean() ? 1 : 0;
+            case Date:
+                return static_cast<long long>(e.date().millis);
+            case Timestamp:
+                return static_cast<long long>(e.timestampValue());
+            default:
+                return e.numberLong();
+            }
+        }
+
+        /** Appends the metrics of 'obj' and its subobjects to 'metrics', in document order. */
+        void extractMetrics(const BSONObj& obj, std::vector<long long>* metrics) {
+            BSONObjIterator it(obj);
+            while (it.more()) {
+                const BSONElement e = it.next();
+                if (e.isABSONObj()) {
+                    extractMetrics(e.Obj(), metrics);
+                }
+                else if (isMetric(e.type())) {
+                    metrics->push_back(metricValue(e));
+                }
+            }
+        }
+
+        bool sameShape(const BSONObj& a, const BSONObj& b) {
+            BSONObjIterator i(a);
+            BSONObjIterator j(b);
+            while (i.more() && j.more()) {
+                const BSONElement x = i.next();
+                const BSONElement y = j.next();
+                if (x.type() != y.type() || strcmp(x.fieldName(), y.fieldName()) != 0)
+                    return false;
+                if (x.isABSONObj()) {
+                    if (!sameShape(x.Obj(), y.Obj()))
+                        return false;
+                }
+                else if (!isMetric(x.type()) && !x.valuesEqual(y)) {
+                    return false;
+                }
+            }
+            return !i.more() && !j.more();
+        }
+
+        /** Appends to 'b' the fields of 'reference' with the metrics taken from 'metrics'. */
+        void rebuild(const BSONObj& reference, const long long*& metrics, BSONObjBuilder* b) {
+            BSONObjIterator it(reference);
+            while (it.more()) {
+                const BSONElement e = it.next();
+                switch (e.type()) {
+                case Object: {
+                    BSONObjBuilder sub(b->subobjStart(e.fieldName()));
+                    rebuild(e.Obj(), metrics, &sub);
+                    break;
+                }
+                case Array: {
+                    BSONObjBuilder sub(b->subarrayStart(e.fieldName()));
+                    rebuild(e.Obj(), metrics, &sub);
+                    break;
+                }
+                case NumberInt:
+                    b->append(e.fieldName(), static_cast<int>(*metrics++));
+                    break;
+                case NumberLong:
+                    b->append(e.fieldName(), *metrics++);
+                    break;
+                case NumberDouble:
+                    b->append(e.fieldName(), static_cast<double>(*metrics++));
+                    break;
+                case Bool:
+                    b->appendBool(e.fieldName(), *metrics++ != 0);
+                    break;
+                case Date:
+                    b->appendDate(e.fieldName(),
+                                  Date_t(static_cast<unsigned long long>(*metrics++)));
+                    break;
+                case Timestamp:
+                    b->appendTimestamp(e.fieldName(), static_cast<unsigned long long>(*metrics++));
+                    break;
+                default:
+                    b->append(e);
+                }
+            }
+        }
+
+        long long delta(long long from, long long to) {
+            // wraps instead of overflowing
+            return static_cast<long long>(static_cast<unsigned long long>(to) -
+                                          static_cast<unsigned long long>(from));
+        }
+
+        long long applyDelta(long long from, long long d) {
+            return static_cast<long long>(static_cast<unsigned long long>(from) +
+                                          static_cast<unsigned long long>(d));
+        }
+
+        unsigned long long zigzag(long long v) {
+            return (static_cast<unsigned long long>(v) << 1) ^
+                   static_cast<unsigned long long>(v >> 63);
+        }
+
+        long long unzigzag(unsigned long long v) {
+            return static_cast<long long>((v >> 1) ^ (0ULL - (v & 1)));
+        }
+
+        void appendVarint(BufBuilder* b, unsigned long long v) {
+            while (v >= 0x80) {
+                b->appendUChar(static_cast<unsigned char>(v | 0x80));
+                v >>= 7;
+            }
+            b->appendUChar(static_cast<unsigned char>(v));
+        }
+
+        bool readVarint(const char*& p, const char* end, unsigned long long* v) {
+            *v = 0;
+            for (int shift = 0; p < end && shift < 64; shift += 7) {
+                unsigned char c = *p++;
+                *v |= static_cast<unsigned long long>(c & 0x7f) << shift;
+                if (!(c & 0x80)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool readUnsigned(const char*& p, const char* end, unsigned* v) {
+            if (end - p < static_cast<int>(sizeof(*v)))
+                return false;
+            memcpy(v, p, sizeof(*v));
+            p += sizeof(*v);
+            return true;
+        }
+
+        Status corrupt(const std::string& why) {
+            return Status(ErrorCodes::FailedToParse, "corrupt diagnostic chunk: " + why);
+        }
+
+    }  // namespace
+
+    DiagnosticChunkBuilder::DiagnosticChunkBuilder(size_t maxSamples)
+        : _maxSamples(maxSamples),
+          _count(0) {
+    }
+
+    bool DiagnosticChunkBuilder::add(const BSONObj& sample, Date_t when) {
+        if (_count == 0) {
+            _first = when;
+            _reference = sample.getOwned();
+            _prev.clear();
+            extractMetrics(_reference, &_prev);
+            _count = 1;
+            return true;
+        }
+
+        if (_count >= _maxSamples || !sameShape(_reference, sample))
+            return false;
+
+        std::vector<long long> metrics;
+        metrics.reserve(_prev.size());
+        extractMetrics(sample, &metrics);
+        for (size_t i = 0; i < metrics.size(); ++i) {
+            _deltas.push_back(delta(_prev[i], metrics[i]));
+        }
+        _prev.swap(metrics);
+        _count++;
+        return true;
+    }
+
+    BSONObj DiagnosticChunkBuilder::finish() {
+        const unsigned numMetrics = _prev.size();
+        const unsigned numDeltas = _count ? _count - 1 : 0;
+
+        BufBuilder raw;
+        raw.appendBuf(_reference.objdata(), _reference.objsize());
+        raw.appendNum(numMetrics);
+        raw.appendNum(numDeltas);
+        // a metric's changes side by side, as most of them are the same small number
+        for (unsigned m = 0; m < numMetrics; ++m) {
+            for (unsigned s = 0; s < numDeltas; ++s) {
+                appendVarint(&raw, zigzag(_deltas[s * numMetrics + m]));
+            }
+        }
+
+        std::string compressed;
+        compress(raw.buf(), raw.len(), &compressed);
+
+        BSONObjBuilder b;
+        b.appendDate("_id", _first);
+        b.append("count", static_cast<int>(_count));
+        b.appendBinData("data", compressed.size(), BinDataGeneral, compressed.data());
+
+        _count = 0;
+        _reference = BSONObj();
+        _prev.clear();
+        _deltas.clear();
+        return b.obj();
+    }
+
+    Status DiagnosticChunkBuilder::decode(const BSONObj& chunk, std::vector<BSONObj>* samples) {
+        const BSONElement dataElt = chunk["data"];
+        if (dataElt.type() != BinData)
+            return corrupt("no data");
+        int len;
+        const char* data = dataElt.binData(len);
+
+        std::string raw;
+        if (!uncompress(data, len, &raw))
+            return corrupt("bad compression");
+
+        const char* p = raw.data();
+        const char* end = p + raw.size();
+        if (end - p < 5)
+            return corrupt("no reference sample");
+        int refSize;
+        memcpy(&refSize, p, sizeof(refSize));
+        if (refSize < 5 || refSize > end - p)
+            return corrupt("bad reference sample size");
+        const BSONObj reference(p);
+        p += refSize;
+
+        std::vector<long long> metrics;
+        extractMetrics(reference, &metrics);
+
+        unsigned numMetrics;
+        unsigned numDeltas;
+        if (!readUnsigned(p, end, &numMetrics) || !readUnsigned(p, end, &numDeltas))
+            return corrupt("truncated header");
+        if (numMetrics != metrics.size())
+            return corrupt("wrong number of metrics");
+
+        std::vector<long long> deltas(static_cast<size_t>(numMetrics) * numDeltas);
+        for (unsigned m = 0; m < numMetrics; ++m) {
+            for (unsigned s = 0; s < numDeltas; ++s) {
+                unsigned long long v;
+                if (!readVarint(p, end, &v))
+                    return corrupt("truncated deltas");
+                deltas[s * numMetrics + m] = unzigzag(v);
+            }
+        }
+
+        samples->push_back(reference.getOwned());
+        for (unsigned s = 0; s < numDeltas; ++s) {
+            for (unsigned m = 0; m < numMetrics; ++m) {
+                metrics[m] = applyDelta(metrics[m], deltas[s * numMetrics + m]);
+            }
+            const long long* next = metrics.empty() ? NULL : &metrics[0];
+            BSONObjBuilder b;
+            rebuild(reference, next, &b);
+            samples->push_back(b.obj());
+        }
+        return Status::OK();
+    }
+
+}  // namespace mongo
@@ -0,0 +1,83 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/status.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * Packs a run of samples of the same shape, such as one serverStatus document a second,
+     * into a single chunk document small enough to keep on disk all the time:
+     *
+     *     { _id : <Date of the first sample>, count : <samples>, data : <BinData> }
+     *
+     * data is snappy compressed and holds the first sample as is, followed by every number of
+     * the later samples as the zigzag varint of its change from the sample before, one metric
+     * after another.  Counters that rarely move thus cost about a byte per sample before
+     * compression.  Numbers, bools, dates and timestamps are metrics; doubles are kept to their
+     * integer part.  Two samples have the same shape if they have the same fields, of the same
+     * types, in the same order, and the same values for everything that isn't a metric.
+     */
+    class DiagnosticChunkBuilder {
+    public:
+        explicit DiagnosticChunkBuilder(size_t maxSamples);
+
+        /**
+         * Adds 'sample', taken at 'when', to the chunk.  Returns false, adding nothing, if the
+         * chunk already holds maxSamples samples or 'sample' has a shape other than theirs; the
+         * caller should then finish() this chunk and start the next one with 'sample'.
+         */
+        bool add(const BSONObj& sample, Date_t when);
+
+        /** The chunk document for the samples added since the last finish(), then empties. */
+        BSONObj finish();
+
+        size_t size() const { return _count; }
+        bool empty() const { return _count == 0; }
+
+        /** Appends to 'samples' the samples packed into 'chunk' by finish(). */
+        static Status decode(const BSONObj& chunk, std::vector<BSONObj>* samples);
+
+    private:
+        const size_t _maxSamples;
+
+        size_t _count;
+        Date_t _first;
+        BSONObj _reference;
+        std::vector<long long> _prev;
+
+        // the changes of all the metrics of each sample after the first, sample by sample
+        std::vector<long long> _deltas;
+    };
+
+}  // namespace mongo
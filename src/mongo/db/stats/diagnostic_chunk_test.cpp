@@ -0,0 +1,115 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/db/stats/diagnostic_chunk.h"
+
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+    BSONObj sample(int i) {
+        BSONObjBuilder b;
+        b.append("host", "localhost");
+        b.append("uptime", static_cast<double>(i));
+        b.appendDate("localTime", Date_t(1000000ULL + 1000 * i));
+        {
+            BSONObjBuilder opcounters(b.subobjStart("opcounters"));
+            opcounters.append("insert", 10 * i);
+            opcounters.append("query", 5LL - i);
+            opcounters.appendBool("even", i % 2 == 0);
+        }
+        b.append("members", BSON_ARRAY(BSON("state" << 1 << "optime" << i * i)));
+        b.appendTimestamp("ts", 1000ULL * (100 + i), i);
+        return b.obj();
+    }
+
+    TEST(DiagnosticChunkTest, RoundTrip) {
+        DiagnosticChunkBuilder builder(10);
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(builder.add(sample(i), Date_t(5000 + i)));
+        }
+        ASSERT_EQUALS(10U, builder.size());
+        ASSERT_FALSE(builder.add(sample(10), Date_t(5010)));
+
+        const BSONObj chunk = builder.finish();
+        ASSERT_TRUE(builder.empty());
+        ASSERT_EQUALS(Date_t(5000), chunk["_id"].date());
+        ASSERT_EQUALS(10, chunk["count"].numberInt());
+
+        std::vector<BSONObj> samples;
+        ASSERT_OK(DiagnosticChunkBuilder::decode(chunk, &samples));
+        ASSERT_EQUALS(10U, samples.size());
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_EQUALS(sample(i), samples[i]);
+            ASSERT_EQUALS(sample(i).toString(), samples[i].toString());
+        }
+    }
+
+    TEST(DiagnosticChunkTest, ShapeChange) {
+        DiagnosticChunkBuilder builder(100);
+        ASSERT_TRUE(builder.add(BSON("a" << 1 << "s" << "x"), Date_t(1)));
+        ASSERT_TRUE(builder.add(BSON("a" << 2 << "s" << "x"), Date_t(2)));
+        // a new field, a new type and a changed string each start a new chunk
+        ASSERT_FALSE(builder.add(BSON("a" << 3 << "s" << "x" << "b" << 1), Date_t(3)));
+        ASSERT_FALSE(builder.add(BSON("a" << 3LL << "s" << "x"), Date_t(3)));
+        ASSERT_FALSE(builder.add(BSON("a" << 3 << "s" << "y"), Date_t(3)));
+        ASSERT_EQUALS(2U, builder.size());
+
+        std::vector<BSONObj> samples;
+        ASSERT_OK(DiagnosticChunkBuilder::decode(builder.finish(), &samples));
+        ASSERT_EQUALS(2U, samples.size());
+        ASSERT_EQUALS(BSON("a" << 2 << "s" << "x"), samples[1]);
+
+        ASSERT_TRUE(builder.add(BSON("a" << 3 << "s" << "y"), Date_t(3)));
+    }
+
+    TEST(DiagnosticChunkTest, Wraparound) {
+        DiagnosticChunkBuilder builder(3);
+        const long long big = std::numeric_limits<long long>::max();
+        ASSERT_TRUE(builder.add(BSON("n" << -big), Date_t(1)));
+        ASSERT_TRUE(builder.add(BSON("n" << big), Date_t(2)));
+        ASSERT_TRUE(builder.add(BSON("n" << 0LL), Date_t(3)));
+
+        std::vector<BSONObj> samples;
+        ASSERT_OK(DiagnosticChunkBuilder::decode(builder.finish(), &samples));
+        ASSERT_EQUALS(3U, samples.size());
+        ASSERT_EQUALS(big, samples[1]["n"].numberLong());
+        ASSERT_EQUALS(0LL, samples[2]["n"].numberLong());
+    }
+
+    TEST(DiagnosticChunkTest, Corrupt) {
+        std::vector<BSONObj> samples;
+        ASSERT_NOT_OK(DiagnosticChunkBuilder::decode(BSONObj(), &samples));
+        ASSERT_NOT_OK(DiagnosticChunkBuilder::decode(
+                          BSON("data" << BSONBinData("junk", 4, BinDataGeneral)), &samples));
+        ASSERT_TRUE(samples.empty());
+    }
+
+}  // namespace
+}  // namespace mongo
@@ -0,0 +1,261 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/db/stats/query_shape_stats.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/histogram.h"
+
+namespace mongo {
+
+    // Off by default: every query then explains its runner and takes the mutex below.
+    MONGO_EXPORT_SERVER_PARAMETER(trackQueryShapes, bool, false);
+
+    MONGO_EXPORT_SERVER_PARAMETER(queryShapeStatsMaxShapes, int, 1000);
+
+    QueryShapeStats queryShapeStats;
+
+    namespace {
+
+        // Latency buckets double from 1 micro, the last one holding all above 2^30 micros.
+        const uint32_t kNumLatencyBuckets = 32;
+
+        Histogram* newLatencyHistogram() {
+            Histogram::Options opts;
+            opts.numBuckets = kNumLatencyBuckets;
+            opts.bucketSize = 1;
+            opts.exponential = true;
+            return new Histogram(opts);
+        }
+
+        /**
+         * Upper bound of the latency below which 'percent' of the 'count' latencies in
+         * 'histogram' fall, no more than 'maxMicros'.
+         */
+        long long percentile(const Histogram& histogram,
+                             long long count,
+                             long long maxMicros,
+                             int percent) {
+            const long long rank = std::max(1LL, (count * percent + 99) / 100);
+            long long seen = 0;
+            for (uint32_t i = 0; i < histogram.getBucketsNum(); ++i) {
+                seen += histogram.getCount(i);
+                if (seen >= rank) {
+                    return std::min(maxMicros, static_cast<long long>(histogram.getBoundary(i)));
+                }
+            }
+            return maxMicros;
+        }
+
+        std::string makeMapKey(const StringData& ns, const std::string& shape) {
+            // namespaces hold no NUL, so the shape, which may, can follow one
+            std::string key;
+            key.reserve(ns.size() + 1 + shape.size());
+            key.append(ns.rawData(), ns.size());
+            key.push_back('\0');
+            key.append(shape);
+            return key;
+        }
+
+    }  // namespace
+
+    QueryShapeStats::ShapeData::ShapeData()
+        : count(0),
+          totalMicros(0),
+          maxMicros(0),
+          lockWaitMicros(0),
+          keysExamined(0),
+          docsExamined(0),
+          nreturned(0),
+          latencies(newLatencyHistogram()) {
+    }
+
+    QueryShapeStats::ShapeData::~ShapeData() {
+        delete latencies;
+    }
+
+    QueryShapeStats::QueryShapeStats() : _mutex("QueryShapeStats") {
+    }
+
+    QueryShapeStats::~QueryShapeStats() {
+        clear();
+    }
+
+    bool QueryShapeStats::isEnabled() {
+        return trackQueryShapes;
+    }
+
+    void QueryShapeStats::record(const StringData& ns,
+                                 const std::string& shape,
+                                 const BSONObj& example,
+                                 const Sample& sample) {
+        const std::string key = makeMapKey(ns, shape);
+
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        ShapeMap::iterator it = _shapes.find(key);
+        if (it == _shapes.end()) {
+            if (example.isEmpty())
+                return;
+
+            _evict(std::max(0, queryShapeStatsMaxShapes - 1));
+
+            Slot slot;
+            slot.data = new ShapeData();
+            slot.data->ns = ns.toString();
+            slot.data->example = example.getOwned();
+            slot.lruPosition = _lru.insert(_lru.begin(), key);
+            it = _shapes.insert(make_pair(key, slot)).first;
+        }
+        else {
+            _lru.splice(_lru.begin(), _lru, it->second.lruPosition);
+        }
+
+        ShapeData& data = *it->second.data;
+        data.count++;
+        data.totalMicros += sample.micros;
+        data.maxMicros = std::max(data.maxMicros, sample.micros);
+        data.lockWaitMicros += sample.lockWaitMicros;
+        data.keysExamined += sample.keysExamined;
+        data.docsExamined += sample.docsExamined;
+        data.nreturned += sample.nreturned;
+        data.latencies->insert(static_cast<uint32_t>(
+            std::min(sample.micros,
+                     static_cast<long long>(std::numeric_limits<uint32_t>::max()))));
+    }
+
+    namespace {
+        typedef std::pair<long long, BSONObj> ReportedShape;
+
+        bool moreTotalTime(const ReportedShape& a, const ReportedShape& b) {
+            return a.first > b.first;
+        }
+    }
+
+    void QueryShapeStats::report(BSONArrayBuilder* shapes) const {
+        std::vector<ReportedShape> reported;
+        {
+            SimpleMutex::scoped_lock lk(_mutex);
+            reported.reserve(_shapes.size());
+            for (ShapeMap::const_iterator it = _shapes.begin(); it != _shapes.end(); ++it) {
+                BSONObjBuilder b;
+                _appendShape(*it->second.data, &b);
+                reported.push_back(make_pair(it->second.data->totalMicros, b.obj()));
+            }
+        }
+
+        std::stable_sort(reported.begin(), reported.end(), moreTotalTime);
+        for (size_t i = 0; i < reported.size(); ++i) {
+            shapes->append(reported[i].second);
+        }
+    }
+
+    void QueryShapeStats::_appendShape(const ShapeData& data, BSONObjBuilder* out) {
+        out->append("ns", data.ns);
+        out->append("example", data.example);
+        out->appendNumber("count", data.count);
+        out->appendNumber("totalMicros", data.totalMicros);
+        out->appendNumber("maxMicros", data.maxMicros);
+        {
+            BSONObjBuilder percentiles(out->subobjStart("micros"));
+            percentiles.appendNumber("p50",
+                                     percentile(*data.latencies, data.count, data.maxMicros, 50));
+            percentiles.appendNumber("p95",
+                                     percentile(*data.latencies, data.count, data.maxMicros, 95));
+            percentiles.appendNumber("p99",
+                                     percentile(*data.latencies, data.count, data.maxMicros, 99));
+        }
+        out->appendNumber("lockWaitMicros", data.lockWaitMicros);
+        out->appendNumber("keysExamined", data.keysExamined);
+        out->appendNumber("docsExamined", data.docsExamined);
+        out->appendNumber("nreturned", data.nreturned);
+    }
+
+    void QueryShapeStats::clear() {
+        SimpleMutex::scoped_lock lk(_mutex);
+        _evict(0);
+    }
+
+    size_t QueryShapeStats::size() const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        return _shapes.size();
+    }
+
+    void QueryShapeStats::_evict(size_t maxShapes) {
+        while (_shapes.size() > maxShapes) {
+            ShapeMap::iterator it = _shapes.find(_lru.back());
+            delete it->second.data;
+            _shapes.erase(it);
+            _lru.pop_back();
+        }
+    }
+
+    class QueryShapeStatsCmd : public Command {
+    public:
+        QueryShapeStatsCmd() : Command("queryShapeStats") {}
+
+        virtual bool slaveOk() const { return true; }
+        virtual bool adminOnly() const { return true; }
+        virtual LockType locktype() const { return NONE; }
+        virtual void help(stringstream& help) const {
+            help << "count, latency and examined documents of each query shape, the costliest\n"
+                 << "first; needs the trackQueryShapes server parameter\n"
+                 << " { queryShapeStats : 1 [, reset : true] }";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::top);
+            out->push_back(Privilege(ResourcePattern::forClusterResource(), actions));
+        }
+        virtual bool run(const string& , BSONObj& cmdObj, int, string& errmsg,
+                         BSONObjBuilder& result, bool fromRepl) {
+            result.appendBool("tracking", QueryShapeStats::isEnabled());
+
+            BSONArrayBuilder shapes(result.subarrayStart("shapes"));
+            queryShapeStats.report(&shapes);
+            shapes.done();
+
+            if (cmdObj["reset"].trueValue()) {
+                queryShapeStats.clear();
+            }
+            return true;
+        }
+
+    } queryShapeStatsCmd;
+
+}  // namespace mongo
@@ -0,0 +1,143 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    class Histogram;
+
+    /**
+     * Aggregates, for each query shape of each collection, how often queries of that shape ran
+     * and what they cost, so that the costliest shapes can be found without the profiler.
+     *
+     * A shape is the plan cache key of the query (see getPlanCacheKey), so queries differing only
+     * in their values share it.  A query and the getMores of its cursor are each counted as an
+     * operation.  At most queryShapeStatsMaxShapes shapes are kept; the least recently seen one
+     * makes room for a new one.  Nothing is recorded unless the trackQueryShapes server
+     * parameter is set.
+     */
+    class QueryShapeStats {
+        MONGO_DISALLOW_COPYING(QueryShapeStats);
+    public:
+        /** What one operation on a shape cost. */
+        struct Sample {
+            Sample() : micros(0), lockWaitMicros(0), keysExamined(0), docsExamined(0),
+                       nreturned(0) {}
+
+            long long micros;
+            long long lockWaitMicros;
+            long long keysExamined;
+            long long docsExamined;
+            long long nreturned;
+        };
+
+        QueryShapeStats();
+        ~QueryShapeStats();
+
+        /** whether queries should note their shape for record() */
+        static bool isEnabled();
+
+        /**
+         * Adds 'sample' to the statistics of 'shape' on 'ns'.  'example' is kept as an instance
+         * of the shape if it is new.  A sample without an example, as for a getMore, is dropped
+         * if its shape has been evicted meanwhile.
+         */
+        void record(const StringData& ns,
+                    const std::string& shape,
+                    const BSONObj& example,
+                    const Sample& sample);
+
+        /**
+         * Appends one object per shape to 'shapes', the most total time first, with its
+         * namespace, example query, operation count, latencies and examined and returned
+         * counts.
+         */
+        void report(BSONArrayBuilder* shapes) const;
+
+        /** Forgets all shapes. */
+        void clear();
+
+        /** Number of shapes kept. */
+        size_t size() const;
+
+    private:
+        struct ShapeData {
+            ShapeData();
+            ~ShapeData();
+
+            std::string ns;
+            BSONObj example;
+
+            long long count;
+            long long totalMicros;
+            long long maxMicros;
+            long long lockWaitMicros;
+            long long keysExamined;
+            long long docsExamined;
+            long long nreturned;
+
+            // of 'micros', for percentiles
+            Histogram* latencies;
+        };
+
+        // Most recently seen first.
+        typedef std::list<std::string> LRUList;
+
+        struct Slot {
+            ShapeData* data;
+            LRUList::iterator lruPosition;
+        };
+
+        // by namespace and shape
+        typedef std::map<std::string, Slot> ShapeMap;
+
+        static void _appendShape(const ShapeData& data, BSONObjBuilder* out);
+
+        /** Drops least recently seen shapes until at most 'maxShapes' are left. */
+        void _evict(size_t maxShapes);
+
+        // protects everything below
+        mutable SimpleMutex _mutex;
+
+        ShapeMap _shapes;
+        LRUList _lru;
+    };
+
+    extern QueryShapeStats queryShapeStats;
+
+}  // namespace mongo
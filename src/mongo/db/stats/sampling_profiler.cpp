@@ -0,0 +1,468 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/db/stats/sampling_profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <cxxabi.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <ucontext.h>
+#define MONGO_SAMPLING_PROFILER_WALKS_FRAMES
+#endif
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/curop.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/backtrace.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/log.h"
+#include "mongo/util/net/message.h"
+
+namespace mongo {
+
+    namespace {
+
+        int samplingProfilerHz = 0;
+
+        // Protects 'started' and the arming of the timer.
+        SimpleMutex profilerMutex("samplingProfiler");
+        bool started = false;
+
+#ifndef _WIN32
+        const int kMaxFrames = 32;
+
+        const size_t kNsBytes = 64;
+
+        // About 80 seconds of CPU time at 100 samples a second.
+        const size_t kRingSize = 8192;
+
+        /**
+         * A sample is written by the signal handler of the thread it interrupted, and read by
+         * the samplingProfile command, which takes it only if 'seq' shows it complete and
+         * unchanged while copied.
+         */
+        struct Sample {
+            // 2 * ticket + 1 while the sample of 'ticket' is written, 2 * ticket + 2 after
+            AtomicUInt64 seq;
+            int op;           // 0 outside of an operation
+            bool command;
+            int numFrames;
+            char ns[kNsBytes];
+            void* frames[kMaxFrames];
+        };
+
+        struct SampleCopy {
+            int op;
+            bool command;
+            int numFrames;
+            char ns[kNsBytes];
+            void* frames[kMaxFrames];
+        };
+
+        // Allocated when the profiler is first armed, before the handler is installed, and
+        // never freed, as a signal may still be on its way.
+        Sample* ring = NULL;
+
+        AtomicUInt64 nextTicket;
+
+        // Samples with an earlier ticket were reported with a reset.
+        AtomicUInt64 firstUnreported;
+
+#ifdef MONGO_SAMPLING_PROFILER_WALKS_FRAMES
+        long pageSize = 0; // set before the handler is installed
+
+        /**
+         * Copies 'len' bytes at 'address' of our own memory to 'out', or returns false if they
+         * can't be read, without faulting: the frame pointer chain may run into code built
+         * without frame pointers, and so into garbage.  Kernels before 3.2 can't, so there
+         * samples stop at the interrupted function.
+         */
+        bool readOwnMemory(uintptr_t address, void* out, size_t len) {
+#ifdef SYS_process_vm_readv
+            struct iovec local = { out, len };
+            struct iovec remote = { reinterpret_cast<void*>(address), len };
+            return syscall(SYS_process_vm_readv, getpid(), &local, 1UL, &remote, 1UL, 0UL) ==
+                static_cast<long>(len);
+#else
+            return false;
+#endif
+        }
+
+        /**
+         * Fills 'frames' with the interrupted pc and the return addresses found by following
+         * the frame pointer chain from 'context'.  Unlike backtrace(), which goes through the
+         * unwinder and its locks, this is safe in a signal handler.  A frame pointer has to
+         * lie above the previous one, and is read through readOwnMemory() unless it is on the
+         * page the last one was read from.
+         * @return the number of frames
+         */
+        int walkFrames(void* context, void** frames, int maxFrames) {
+            const mcontext_t& mc = static_cast<ucontext_t*>(context)->uc_mcontext;
+#if defined(__x86_64__)
+            const uintptr_t pc = mc.gregs[REG_RIP];
+            uintptr_t fp = mc.gregs[REG_RBP];
+            uintptr_t low = mc.gregs[REG_RSP];
+#else
+            const uintptr_t pc = mc.gregs[REG_EIP];
+            uintptr_t fp = mc.gregs[REG_EBP];
+            uintptr_t low = mc.gregs[REG_ESP];
+#endif
+            int n = 0;
+            frames[n++] = reinterpret_cast<void*>(pc);
+
+            uintptr_t checkedPage = 0;
+            while (n < maxFrames) {
+                // [0] is the caller's frame pointer, [1] the return address
+                uintptr_t frame[2];
+                if (fp < low || fp % sizeof(uintptr_t) != 0)
+                    break;
+                const uintptr_t page = fp & ~(pageSize - 1);
+                const bool samePage = page == checkedPage &&
+                    (fp + sizeof(frame) - 1) / pageSize == fp / pageSize;
+                if (samePage) {
+                    memcpy(frame, reinterpret_cast<const void*>(fp), sizeof(frame));
+                }
+                else {
+                    if (!readOwnMemory(fp, frame, sizeof(frame)))
+                        break;
+                    checkedPage = page;
+                }
+                if (frame[1] == 0)
+                    break;
+                frames[n++] = reinterpret_cast<void*>(frame[1]);
+                low = fp + sizeof(frame);
+                fp = frame[0];
+            }
+            return n;
+        }
+#endif
+
+        /**
+         * SIGPROF handler.  Only async-signal-safe work here: no locks and no allocation.
+         */
+        void onProfilingSignal(int, siginfo_t*, void* context) {
+            const int savedErrno = errno;
+
+            const unsigned long long ticket = nextTicket.fetchAndAdd(1);
+            Sample& sample = ring[ticket % kRingSize];
+            sample.seq.store(2 * ticket + 1);
+
+            sample.op = 0;
+            sample.command = false;
+            sample.ns[0] = '\0';
+            Client* client = currentClient.get();
+            CurOp* curop = client ? client->curop() : NULL;
+            if (curop && curop->active()) {
+                sample.op = curop->getOp();
+                sample.command = curop->isCommand();
+                strncpy(sample.ns, curop->getNS(), kNsBytes - 1);
+                sample.ns[kNsBytes - 1] = '\0';
+            }
+#ifdef MONGO_SAMPLING_PROFILER_WALKS_FRAMES
+            sample.numFrames = walkFrames(context, sample.frames, kMaxFrames);
+#else
+            // no safe way to walk the stack here, so these samples only tell the operations
+            sample.numFrames = 0;
+#endif
+
+            sample.seq.store(2 * ticket + 2);
+            errno = savedErrno;
+        }
+
+        /** Sets the SIGPROF timer to 'hz', or stops it if 0.  Needs profilerMutex. */
+        Status armProfiler(int hz) {
+            if (hz > 0 && ring == NULL) {
+#ifdef MONGO_SAMPLING_PROFILER_WALKS_FRAMES
+                pageSize = sysconf(_SC_PAGESIZE);
+#endif
+                ring = new Sample[kRingSize];
+
+                struct sigaction action;
+                memset(&action, 0, sizeof(action));
+                action.sa_sigaction = onProfilingSignal;
+                sigemptyset(&action.sa_mask);
+                action.sa_flags = SA_RESTART | SA_SIGINFO;
+                if (sigaction(SIGPROF, &action, NULL) != 0) {
+                    return Status(ErrorCodes::InternalError,
+                                  "can't install the profiling signal handler: " +
+                                  errnoWithDescription());
+                }
+            }
+
+            struct itimerval timer;
+            memset(&timer, 0, sizeof(timer));
+            if (hz > 0) {
+                timer.it_interval.tv_usec = 1000 * 1000 / hz;
+                timer.it_value = timer.it_interval;
+            }
+            if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+                return Status(ErrorCodes::InternalError,
+                              "can't set the profiling timer: " + errnoWithDescription());
+            }
+            return Status::OK();
+        }
+
+        /** Strips the parameter list, and any const, from a demangled function name. */
+        std::string stripParameters(const std::string& name) {
+            size_t end = name.rfind(')');
+            if (end == std::string::npos)
+                return name;
+
+            int depth = 0;
+            for (size_t i = end + 1; i-- > 0;) {
+                if (name[i] == ')') {
+                    depth++;
+                }
+                else if (name[i] == '(' && --depth == 0) {
+                    return i > 0 ? name.substr(0, i) : name;
+                }
+            }
+            return name;
+        }
+
+        /** "module(mangled+0x1f) [0x...]", as backtrace_symbols() gives it, to a short name. */
+        std::string frameName(const char* symbol, void* address) {
+            const char* open = strchr(symbol, '(');
+            const char* close = open ? strpbrk(open, "+)") : NULL;
+            if (open && close && close > open + 1) {
+                std::string mangled(open + 1, close);
+                int status = 0;
+                char* demangled = abi::__cxa_demangle(mangled.c_str(), NULL, NULL, &status);
+                if (demangled) {
+                    std::string name = stripParameters(demangled);
+                    free(demangled);
+                    return name;
+                }
+                return mangled;
+            }
+
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%p", address);
+            return buf;
+        }
+
+        /** Copies the complete samples taken since the last reset into 'out'. */
+        void copySamples(std::vector<SampleCopy>* out) {
+            if (ring == NULL)
+                return;
+
+            const unsigned long long first = firstUnreported.load();
+            for (size_t i = 0; i < kRingSize; ++i) {
+                const Sample& sample = ring[i];
+                const unsigned long long seq = sample.seq.load();
+                if (seq == 0 || seq % 2 == 1 || seq / 2 - 1 < first)
+                    continue;
+
+                SampleCopy copy;
+                copy.op = sample.op;
+                copy.command = sample.command;
+                copy.numFrames = std::min(std::max(sample.numFrames, 0), kMaxFrames);
+                memcpy(copy.ns, sample.ns, kNsBytes);
+                copy.ns[kNsBytes - 1] = '\0';
+                memcpy(copy.frames, sample.frames, sizeof(copy.frames));
+
+                if (sample.seq.load() == seq)
+                    out->push_back(copy);
+            }
+        }
+
+        bool moreFrequent(const std::pair<long long, std::string>& a,
+                          const std::pair<long long, std::string>& b) {
+            return a.first > b.first;
+        }
+#endif
+
+        class SamplingProfilerHzParameter : public ExportedServerParameter<int> {
+        public:
+            SamplingProfilerHzParameter()
+                : ExportedServerParameter<int>(ServerParameterSet::getGlobal(),
+                                               "samplingProfilerHz",
+                                               &samplingProfilerHz,
+                                               true,
+                                               true) {}
+
+            using ExportedServerParameter<int>::set;
+
+            virtual Status set(const int& newValue) {
+                Status status = ExportedServerParameter<int>::set(newValue);
+                if (!status.isOK())
+                    return status;
+
+#ifndef _WIN32
+                SimpleMutex::scoped_lock lk(profilerMutex);
+                if (started)
+                    return armProfiler(newValue);
+#endif
+                return Status::OK();
+            }
+
+        protected:
+            virtual Status validate(const int& potentialNewValue) {
+                if (potentialNewValue < 0 || potentialNewValue > 1000) {
+                    return Status(ErrorCodes::BadValue,
+                                  "samplingProfilerHz must be between 0 and 1000");
+                }
+#ifdef _WIN32
+                if (potentialNewValue != 0) {
+                    return Status(ErrorCodes::IllegalOperation,
+                                  "the sampling profiler is not available on Windows");
+                }
+#endif
+                return Status::OK();
+            }
+        } samplingProfilerHzParameter;
+
+    }  // namespace
+
+    void startSamplingProfiler() {
+        SimpleMutex::scoped_lock lk(profilerMutex);
+        started = true;
+#ifndef _WIN32
+        if (samplingProfilerHz > 0) {
+            Status status = armProfiler(samplingProfilerHz);
+            if (!status.isOK())
+                warning() << "sampling profiler not started: " << status.reason() << endl;
+        }
+#endif
+    }
+
+    void appendSamplingProfile(bool reset, BSONObjBuilder* result) {
+        result->append("hz", samplingProfilerHz);
+
+        BSONArrayBuilder folded(result->subarrayStart("folded"));
+#ifndef _WIN32
+        const unsigned long long taken = nextTicket.load();
+        std::vector<SampleCopy> samples;
+        copySamples(&samples);
+        if (reset)
+            firstUnreported.store(taken);
+
+        // symbolize each address once
+        std::map<void*, std::string> names;
+        for (size_t i = 0; i < samples.size(); ++i) {
+            for (int f = 0; f < samples[i].numFrames; ++f)
+                names[samples[i].frames[f]];
+        }
+        std::vector<void*> addresses;
+        for (std::map<void*, std::string>::iterator it = names.begin(); it != names.end(); ++it)
+            addresses.push_back(it->first);
+        char** symbols = addresses.empty() ? NULL :
+            backtrace_symbols(&addresses[0], static_cast<int>(addresses.size()));
+        for (size_t i = 0; i < addresses.size(); ++i) {
+            names[addresses[i]] = symbols ? frameName(symbols[i], addresses[i])
+                                          : frameName("", addresses[i]);
+        }
+        free(symbols);
+
+        std::map<std::string, long long> stacks;
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const SampleCopy& sample = samples[i];
+            std::string stack = sample.command ? "command" :
+                                sample.op ? opToString(sample.op) : "none";
+            stack += ';';
+            stack += sample.ns[0] ? sample.ns : "-";
+            for (int f = sample.numFrames - 1; f >= 0; --f) {
+                stack += ';';
+                stack += names[sample.frames[f]];
+            }
+            stacks[stack]++;
+        }
+
+        std::vector<std::pair<long long, std::string> > byCount;
+        for (std::map<std::string, long long>::iterator it = stacks.begin();
+             it != stacks.end(); ++it) {
+            byCount.push_back(std::make_pair(it->second, it->first));
+        }
+        std::stable_sort(byCount.begin(), byCount.end(), moreFrequent);
+
+        bool truncated = false;
+        for (size_t i = 0; i < byCount.size(); ++i) {
+            if (folded.len() > BSONObjMaxUserSize / 2) {
+                truncated = true;
+                break;
+            }
+            folded.append(str::stream() << byCount[i].second << ' ' << byCount[i].first);
+        }
+        folded.done();
+
+        result->appendNumber("samples", static_cast<long long>(samples.size()));
+        if (truncated)
+            result->appendBool("truncated", true);
+#else
+        folded.done();
+        result->appendNumber("samples", 0LL);
+#endif
+    }
+
+    class SamplingProfileCommand : public Command {
+    public:
+        SamplingProfileCommand() : Command("samplingProfile") {}
+
+        virtual bool slaveOk() const { return true; }
+        virtual bool adminOnly() const { return true; }
+        virtual LockType locktype() const { return NONE; }
+        virtual void help(stringstream& help) const {
+            help << "stacks sampled while samplingProfilerHz is set, folded for flamegraph.pl\n"
+                 << " { samplingProfile : 1 [, reset : true] }";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::cpuProfiler);
+            out->push_back(Privilege(ResourcePattern::forClusterResource(), actions));
+        }
+        virtual bool run(const string& , BSONObj& cmdObj, int, string& errmsg,
+                         BSONObjBuilder& result, bool fromRepl) {
+            appendSamplingProfile(cmdObj["reset"].trueValue(), &result);
+            return true;
+        }
+
+    } samplingProfileCommand;
+
+}  // namespace mongo
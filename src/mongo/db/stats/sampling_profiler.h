@@ -0,0 +1,63 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/status.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * A sampling profiler meant to be left running in production.
+     *
+     * While the samplingProfilerHz server parameter is above 0, a SIGPROF timer interrupts
+     * whichever thread is using the CPU that many times per CPU second.  The interrupted thread
+     * notes its stack and the type and namespace of its current operation in a fixed size ring
+     * of recent samples; nothing is allocated or locked.  The samplingProfile command folds the
+     * ring into "op;namespace;outermost frame;...;innermost frame count" lines, the input of
+     * flamegraph.pl.  Plan stages show up as the work() frames of their stage classes.
+     *
+     * Not available on Windows.
+     */
+
+    /**
+     * Arms the profiler at the rate of samplingProfilerHz.  Until this is called, at the end of
+     * startup, setting the parameter only records the rate, as a timer set before the server
+     * forks wouldn't survive it.
+     */
+    void startSamplingProfiler();
+
+    /**
+     * Appends to 'result' the rate, how many samples the ring holds, and 'folded', the folded
+     * stacks with their counts, most frequent first.  With 'reset' the samples reported aren't
+     * reported again.
+     */
+    void appendSamplingProfile(bool reset, BSONObjBuilder* result);
+
+}  // namespace mongo
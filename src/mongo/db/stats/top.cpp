@@ -60,21 +60,34 @@ namespace mongo {
 
     }
 
+    void Top::CollectionData::add( const CollectionData& other ) {
+        total.add( other.total );
+        readLock.add( other.readLock );
+        writeLock.add( other.writeLock );
+        queries.add( other.queries );
+        getmore.add( other.getmore );
+        insert.add( other.insert );
+        update.add( other.update );
+        remove.add( other.remove );
+        commands.add( other.commands );
+    }
+
     void Top::record( const StringData& ns , int op , int lockType , long long micros , bool command ) {
         if ( ns[0] == '?' )
             return;
 
         //cout << "record: " << ns << "\t" << op << "\t" << command << endl;
-        SimpleMutex::scoped_lock lk(_lock);
+        Stripe& stripe = _myStripe();
+        SimpleMutex::scoped_lock lk( stripe.lock );
 
-        if ( ( command || op == dbQuery ) && ns == _lastDropped ) {
-            _lastDropped = "";
+        if ( ( command || op == dbQuery ) && ns == stripe.lastDropped ) {
+            stripe.lastDropped = "";
             return;
         }
 
-        CollectionData& coll = _usage[ns];
+        CollectionData& coll = stripe.usage[ns];
         _record( coll , op , lockType , micros , command );
-        _record( _global , op , lockType , micros , command );
+        _record( stripe.global , op , lockType , micros , command );
     }
 
     void Top::_record( CollectionData& c , int op , int lockType , long long micros , bool command ) {
@@ -120,19 +133,42 @@ namespace mongo {
     }
 
     void Top::collectionDropped( const StringData& ns ) {
-        SimpleMutex::scoped_lock lk(_lock);
-        _usage.erase(ns);
-        _lastDropped = ns.toString();
+        Stripe& mine = _myStripe();
+        for ( int i = 0; i < NumStripes; i++ ) {
+            Stripe& stripe = _stripes[i];
+            SimpleMutex::scoped_lock lk( stripe.lock );
+            stripe.usage.erase( ns );
+            if ( &stripe == &mine )
+                stripe.lastDropped = ns.toString();
+        }
     }
 
     void Top::cloneMap(Top::UsageMap& out) const {
-        SimpleMutex::scoped_lock lk(_lock);
-        out = _usage;
+        out = UsageMap();
+        for ( int i = 0; i < NumStripes; i++ ) {
+            Stripe& stripe = _stripes[i];
+            SimpleMutex::scoped_lock lk( stripe.lock );
+            for ( UsageMap::const_iterator it = stripe.usage.begin();
+                  it != stripe.usage.end(); ++it ) {
+                out[it->first].add( it->second );
+            }
+        }
+    }
+
+    Top::CollectionData Top::getGlobalData() const {
+        CollectionData global;
+        for ( int i = 0; i < NumStripes; i++ ) {
+            Stripe& stripe = _stripes[i];
+            SimpleMutex::scoped_lock lk( stripe.lock );
+            global.add( stripe.global );
+        }
+        return global;
     }
 
     void Top::append( BSONObjBuilder& b ) {
-        SimpleMutex::scoped_lock lk( _lock );
-        _appendToUsageMap( b , _usage );
+        UsageMap usage;
+        cloneMap( usage );
+        _appendToUsageMap( b , usage );
     }
 
     void Top::_appendToUsageMap( BSONObjBuilder& b , const UsageMap& map ) const {
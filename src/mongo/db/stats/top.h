@@ -20,17 +20,21 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/thread_stripe.h"
 #include "mongo/util/string_map.h"
 
 namespace mongo {
 
     /**
      * tracks usage by collection
+     *
+     * Each thread records into a stripe of its own (see threadStripe()), with its own mutex,
+     * and readers merge the stripes, so operations on different cores don't serialize here.
      */
     class Top {
 
     public:
-        Top() : _lock("Top") { }
+        Top() { }
 
         struct UsageData {
             UsageData() : time(0) , count(0) {}
@@ -42,6 +46,11 @@ namespace mongo {
                 count++;
                 time += micros;
             }
+
+            void add( const UsageData& other ) {
+                count += other.count;
+                time += other.time;
+            }
         };
 
         struct CollectionData {
@@ -51,6 +60,8 @@ namespace mongo {
             CollectionData() {}
             CollectionData( const CollectionData& older , const CollectionData& newer );
 
+            void add( const CollectionData& other );
+
             UsageData total;
 
             UsageData readLock;
@@ -70,7 +81,7 @@ namespace mongo {
         void record( const StringData& ns , int op , int lockType , long long micros , bool command );
         void append( BSONObjBuilder& b );
         void cloneMap(UsageMap& out) const;
-        CollectionData getGlobalData() const { return _global; }
+        CollectionData getGlobalData() const;
         void collectionDropped( const StringData& ns );
 
     public: // static stuff
@@ -81,10 +92,22 @@ namespace mongo {
         void _appendStatsEntry( BSONObjBuilder& b , const char * statsName , const UsageData& map ) const;
         void _record( CollectionData& c , int op , int lockType , long long micros , bool command );
 
-        mutable SimpleMutex _lock;
-        CollectionData _global;
-        UsageMap _usage;
-        string _lastDropped;
+        enum { NumStripes = 16 };
+
+        // what the threads of one stripe have recorded
+        struct Stripe {
+            Stripe() : lock( "Top" ) { }
+
+            SimpleMutex lock;
+            CollectionData global;
+            UsageMap usage;
+            // dropped by a thread of this stripe, whose next query or command on it is skipped
+            string lastDropped;
+        };
+
+        Stripe& _myStripe() { return _stripes[ threadStripe() % NumStripes ]; }
+
+        mutable Stripe _stripes[NumStripes];
     };
 
 } // namespace mongo
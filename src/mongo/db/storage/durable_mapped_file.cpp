@@ -42,6 +42,7 @@
 #include "mongo/db/dur_journalformat.h"
 #include "mongo/db/memconcept.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/numa.h"
 
 using namespace mongoutils;
 
@@ -57,6 +58,67 @@ namespace mongo {
         _view_private = remapPrivateView(_view_private);
         //privateViews.add(_view_private, this);
         fassert( 16112, _view_private == old );
+        // the new mapping replaced the old one along with its memory policy
+        numa::interleave( _view_private, length() );
+    }
+
+    void DurableMappedFile::noteDirty(size_t ofs, unsigned len) {
+        if( _dirty.empty() )
+            _dirty.resize( ( length() + RemapChunkSize - 1 ) / RemapChunkSize );
+        size_t last = std::min( ( ofs + std::max( len, 1U ) - 1 ) / RemapChunkSize,
+                                _dirty.size() - 1 );
+        for( size_t c = ofs / RemapChunkSize; c <= last; c++ ) {
+            if( !_dirty[c] ) {
+                _dirty[c] = true;
+                _nDirtyChunks++;
+            }
+        }
+    }
+
+    unsigned DurableMappedFile::remapDirtyChunks(unsigned maxChunks) {
+        verify(storageGlobalParams.dur);
+#ifdef _WIN32
+        // no way to remap part of a view here, so it is all or nothing
+        (void) maxChunks;
+        unsigned n = _nDirtyChunks;
+        remapThePrivateView();
+        _dirty.assign( _dirty.size(), false );
+        _nDirtyChunks = 0;
+        _willNeedRemap = false;
+        return n;
+#else
+        // written before we tracked chunks (or to a file with no length)?  do it all
+        if( _nDirtyChunks == 0 ) {
+            remapThePrivateView();
+            _willNeedRemap = false;
+            return 0;
+        }
+
+        unsigned done = 0;
+        size_t c = 0;
+        while( c < _dirty.size() && done < maxChunks ) {
+            if( !_dirty[c] ) {
+                c++;
+                continue;
+            }
+            // remap the whole run of dirty chunks starting here with one call
+            size_t end = c;
+            while( end < _dirty.size() && _dirty[end] && done < maxChunks ) {
+                _dirty[end] = false;
+                end++;
+                done++;
+            }
+            unsigned long long ofs = (unsigned long long) c * RemapChunkSize;
+            unsigned long long len = std::min( (unsigned long long) end * RemapChunkSize,
+                                               length() ) - ofs;
+            remapPrivateViewRange( _view_private, ofs, len );
+            numa::interleave( static_cast<char*>( _view_private ) + ofs, len );
+            c = end;
+        }
+        _nDirtyChunks -= done;
+        _willNeedRemap = _nDirtyChunks > 0;
+        return done;
+#endif
     }
 
     /** register view. threadsafe */
@@ -165,12 +227,16 @@ namespace mongo {
             else {
                 _view_private = _view_write;
             }
+            // every thread reads the data files, so no node should hold all of them
+            numa::interleave( _view_write, length() );
+            if( _view_private != _view_write )
+                numa::interleave( _view_private, length() );
             return true;
         }
         return false;
     }
 
-    DurableMappedFile::DurableMappedFile() : _willNeedRemap(false) {
+    DurableMappedFile::DurableMappedFile() : _willNeedRemap(false), _nDirtyChunks(0) {
         _view_write = _view_private = 0;
     }
 
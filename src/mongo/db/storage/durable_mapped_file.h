@@ -31,6 +31,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "mongo/util/mmap.h"
 #include "mongo/util/paths.h"
 
@@ -97,6 +99,23 @@ namespace mongo {
 
         void remapThePrivateView();
 
+        // granularity of the dirty tracking for remapping
+        static const unsigned RemapChunkSize = 1024 * 1024;
+
+        /** note a write to [ofs, ofs+len) of the private view; in PREPLOGBUFFER, along with
+            willNeedRemap()
+        */
+        void noteDirty(size_t ofs, unsigned len);
+
+        /** chunks written since they were last remapped */
+        unsigned dirtyChunks() const { return _nDirtyChunks; }
+
+        /** remap up to 'maxChunks' of the dirty chunks of the private view and leave the rest for
+            later.  clears willNeedRemap() once nothing is left.
+            @return chunks remapped
+        */
+        unsigned remapDirtyChunks(unsigned maxChunks);
+
         virtual bool isDurableMappedFile() { return true; }
 
     private:
@@ -104,6 +123,8 @@ namespace mongo {
         void *_view_write;
         void *_view_private;
         bool _willNeedRemap;
+        std::vector<bool> _dirty; // by RemapChunkSize chunk of the file
+        unsigned _nDirtyChunks;
         RelativePath _p;   // e.g. "somepath/dbname"
         int _fileSuffixNo;  // e.g. 3.  -1="ns"
 
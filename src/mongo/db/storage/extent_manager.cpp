@@ -33,6 +33,7 @@
 #include <boost/filesystem/operations.hpp>
 
 #include "mongo/db/client.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/memconcept.h"
 #include "mongo/db/namespace_details.h"
@@ -41,9 +42,16 @@
 #include "mongo/db/storage/extent_manager.h"
 
 #include "mongo/db/pdfile.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/file_allocator.h"
+#include "mongo/util/mmap.h"
 
 namespace mongo {
 
+    // 1 keeps the historical behaviour of only ever preallocating the next file
+    MONGO_EXPORT_SERVER_PARAMETER( preallocateMaxFilesAhead, int, 1 );
+    MONGO_EXPORT_SERVER_PARAMETER( preallocateLookaheadSecs, int, 60 );
+
     ExtentManager::ExtentManager( const StringData& dbname,
                                   const StringData& path,
                                   NamespaceDetails* freeListDetails,
@@ -51,7 +59,9 @@ namespace mongo {
         : _dbname( dbname.toString() ),
           _path( path.toString() ),
           _freeListDetails( freeListDetails ),
-          _directoryPerDB( directoryPerDB ) {
+          _directoryPerDB( directoryPerDB ),
+          _lastFileAddMillis( 0 ),
+          _growthBytesPerSec( 0 ) {
     }
 
     ExtentManager::~ExtentManager() {
@@ -63,6 +73,8 @@ namespace mongo {
             delete _files[i];
         }
         _files.clear();
+        _lastFileAddMillis = 0;
+        _growthBytesPerSec = 0;
     }
 
     boost::filesystem::path ExtentManager::fileName( int n ) const {
@@ -149,7 +161,7 @@ namespace mongo {
             string fullNameString = fullName.string();
             p = new DataFile(n);
             int minSize = 0;
-            if ( n != 0 && _files[ n - 1 ] )
+            if ( n != 0 && n - 1 < static_cast<int>( _files.size() ) && _files[ n - 1 ] )
                 minSize = _files[ n - 1 ]->getHeader()->fileLength;
             if ( sizeNeeded + DataFileHeader::HeaderSize > minSize )
                 minSize = sizeNeeded + DataFileHeader::HeaderSize;
@@ -173,10 +185,37 @@ namespace mongo {
         int n = (int) _files.size();
         DataFile *ret = getFile( n, sizeNeeded );
         if ( preallocateNextFile )
-            preallocateAFile();
+            preallocateAhead();
         return ret;
     }
 
+    void ExtentManager::preallocateAhead() {
+        DEV Lock::assertWriteLocked( _dbname );
+        int n = (int) _files.size();
+        long long now = curTimeMillis64();
+
+        // the previous file filled up in (now - _lastFileAddMillis), which gives a growth rate
+        if ( _lastFileAddMillis != 0 && n >= 2 && _files[ n - 2 ] ) {
+            long long elapsed = std::max( now - _lastFileAddMillis, 1LL );
+            double rate = _files[ n - 2 ]->getHeader()->fileLength * 1000.0 / elapsed;
+            _growthBytesPerSec = _growthBytesPerSec == 0 ? rate
+                                                         : 0.5 * _growthBytesPerSec + 0.5 * rate;
+        }
+        _lastFileAddMillis = now;
+
+        int ahead = 1;
+        int maxAhead = preallocateMaxFilesAhead;
+        if ( maxAhead > 1 && n > 0 && _files[ n - 1 ] ) {
+            double fileLength = _files[ n - 1 ]->getHeader()->fileLength;
+            double expected = _growthBytesPerSec * preallocateLookaheadSecs / fileLength;
+            ahead = static_cast<int>( std::min( 1 + expected, static_cast<double>( maxAhead ) ) );
+        }
+        ahead = std::min( ahead, DiskLoc::MaxFiles - n );
+
+        for ( int i = 0; i < ahead; i++ )
+            getFile( n + i, 0, true );
+    }
+
     size_t ExtentManager::numFiles() const {
         DEV Lock::assertAtLeastReadLocked( _dbname );
         return _files.size();
@@ -283,6 +322,16 @@ namespace mongo {
         return e->lastRecord;
     }
 
+    void ExtentManager::willNeed( const DiskLoc& loc, int len ) const {
+        loc.assertOk();
+        const DataFile* df = _getOpenFile( loc.a() );
+        unsigned long long ofs = loc.getOfs();
+        unsigned long long end = std::min( df->length(), ofs + len );
+        if ( end <= ofs )
+            return;
+        MAdvise::willNeed( df->p() + ofs, static_cast<unsigned>( end - ofs ) );
+    }
+
     Extent* ExtentManager::getNextExtent( Extent* e ) const {
         if ( e->xnext.isNull() )
             return NULL;
@@ -585,5 +634,27 @@ namespace mongo {
         log() << "end freelist" << endl;
     }
 
+    namespace {
+
+        class FileAllocatorSSS : public ServerStatusSection {
+        public:
+            FileAllocatorSSS() : ServerStatusSection( "fileAllocator" ){}
+            virtual bool includeByDefault() const { return true; }
+
+            BSONObj generateSection(const BSONElement& configElement) const {
+                FileAllocator::Stats stats = FileAllocator::get()->getStats();
+                BSONObjBuilder b;
+                b.appendNumber( "allocations", stats.allocations );
+                b.appendNumber( "allocationMillis", stats.allocationMicros / 1000 );
+                b.appendNumber( "waits", stats.waits );
+                b.appendNumber( "waitMillis", stats.waitMicros / 1000 );
+                b.appendNumber( "pending", stats.pending );
+                b.appendNumber( "inProgress", stats.inProgress );
+                return b.obj();
+            }
+
+        } fileAllocatorSSS;
+
+    }
 
 }
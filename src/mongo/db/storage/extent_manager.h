@@ -97,6 +97,13 @@ namespace mongo {
 
         void preallocateAFile() { getFile( numFiles() , 0, true ); }// XXX-ERH
 
+        /**
+         * queue preallocation of the files after the last one, as many as the observed growth
+         * rate says will be needed within preallocateLookaheadSecs (at least one, at most
+         * preallocateMaxFilesAhead)
+         */
+        void preallocateAhead();
+
         void flushFiles( bool sync );
 
         /* allocate a new Extent, does not check free list
@@ -159,6 +166,12 @@ namespace mongo {
 
         DiskLoc getPrevRecordInExtent( const DiskLoc& loc ) const;
 
+        /**
+         * hint to the os that [loc, loc + len) will be read soon, clamped to the end of the file.
+         * does not touch the range, so is cheap to call on cold data.
+         */
+        void willNeed( const DiskLoc& loc, int len ) const;
+
         /**
          * quantizes extent size to >= min + page boundary
          */
@@ -185,6 +198,10 @@ namespace mongo {
         //   to others and we are in the dbholder lock then.
         std::vector<DataFile*> _files;
 
+        // for predicting how many files to preallocate, only touched under the write lock
+        long long _lastFileAddMillis;
+        double _growthBytesPerSec; // moving average
+
     };
 
 }
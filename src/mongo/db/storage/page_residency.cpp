@@ -0,0 +1,282 @@
+// page_residency.cpp
+
+/**
+*    Copyright (C) 2008 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/storage/page_residency.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/bits.h"
+#include "mongo/util/concurrency/threadlocal.h"
+#include "mongo/util/net/listen.h"
+#include "mongo/util/processinfo.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    namespace {
+
+        const int PageShift = 12;
+        const int ChunkShift = 32; // 4GB of address space per chunk
+        const size_t PagesPerChunk = size_t(1) << ( ChunkShift - PageShift );
+        const size_t WordsPerChunk = PagesPerChunk / 64;
+
+#if defined(MONGO_PLATFORM_64)
+        const int AddressBits = 47; // user space on every 64 bit platform we support
+#else
+        const int AddressBits = 32;
+#endif
+        const size_t NumChunks = size_t(1) << ( AddressBits - ChunkShift );
+
+        // same as the rotation time of the old tracker
+        const long long MaxAgeMillis = 90 * 1000;
+
+        // one in this many positive answers is checked against the system
+        const unsigned SampleEvery = 64;
+
+        struct Chunk {
+            Chunk() : lastReset( Listener::getElapsedTimeMillis() ) {}
+            AtomicInt64 lastReset;
+            AtomicUInt64 words[WordsPerChunk];
+        };
+
+        // chunks are never freed, there are at most NumChunks of them and only ranges we have
+        // mapped ever get one
+        AtomicWord<size_t> chunks[NumChunks];
+
+        struct Stats {
+            AtomicInt64 hits;                 // answered yes from the bitmap (in SampleEvery steps)
+            AtomicInt64 sampledHits;          // of those, how many were checked
+            AtomicInt64 sampledFalsePositives;// ... and turned out not to be resident
+            AtomicInt64 misses;               // bit not set
+            AtomicInt64 missesResident;       // ... but the system said it was resident
+            AtomicInt64 chunksAllocated;
+            AtomicInt64 chunkResets;
+        } stats;
+
+        // must stay a POD: with __thread it cannot have a constructor; thread-local storage
+        // starts zeroed
+        struct ThreadState {
+            unsigned hits;
+        };
+
+    }
+
+    // These need to be outside the anonymous namespace due to the way they are defined
+#if defined(MONGO_HAVE___THREAD)
+    __thread ThreadState _pageResidencyThreadState;
+    static ThreadState* threadState() {
+        return &_pageResidencyThreadState;
+    }
+#elif defined(MONGO_HAVE___DECLSPEC_THREAD)
+    __declspec( thread ) ThreadState _pageResidencyThreadState;
+    static ThreadState* threadState() {
+        return &_pageResidencyThreadState;
+    }
+#else
+    TSP_DEFINE(ThreadState, _pageResidencyThreadState);
+    static ThreadState* threadState() {
+        return _pageResidencyThreadState.getMake();
+    }
+#endif
+
+    namespace {
+
+        Chunk* chunkFor( size_t addr, bool create ) {
+            size_t n = addr >> ChunkShift;
+            if ( n >= NumChunks )
+                return NULL;
+
+            size_t c = chunks[n].load();
+            if ( c || !create )
+                return reinterpret_cast<Chunk*>( c );
+
+            Chunk* mine = new Chunk();
+            c = chunks[n].compareAndSwap( 0, reinterpret_cast<size_t>( mine ) );
+            if ( c ) {
+                // lost the race
+                delete mine;
+                return reinterpret_cast<Chunk*>( c );
+            }
+            stats.chunksAllocated.fetchAndAdd( 1 );
+            return mine;
+        }
+
+        inline size_t pageOf( size_t addr ) {
+            return ( addr >> PageShift ) & ( PagesPerChunk - 1 );
+        }
+
+        inline unsigned long long bitOf( size_t addr ) {
+            return 1ULL << ( pageOf( addr ) & 63 );
+        }
+
+        inline AtomicUInt64& wordOf( Chunk* c, size_t addr ) {
+            return c->words[ pageOf( addr ) >> 6 ];
+        }
+
+        inline void setBit( AtomicUInt64& word, unsigned long long bit ) {
+            unsigned long long old = word.loadRelaxed();
+            while ( !( old & bit ) ) {
+                unsigned long long prev = word.compareAndSwap( old, old | bit );
+                if ( prev == old )
+                    return;
+                old = prev;
+            }
+        }
+
+        /** clear the chunk if it is old enough that pages could have been evicted since */
+        void ageIfNeeded( Chunk* c ) {
+            const long long now = Listener::getElapsedTimeMillis();
+            const long long last = c->lastReset.loadRelaxed();
+            if ( MONGO_likely( now - last <= MaxAgeMillis ) )
+                return;
+            if ( c->lastReset.compareAndSwap( last, now ) != last )
+                return; // someone else is doing it
+
+            // racing setBit()s may be lost, which only costs a system call later
+            for ( size_t i = 0; i < WordsPerChunk; i++ )
+                c->words[i].store( 0 );
+            stats.chunkResets.fetchAndAdd( 1 );
+        }
+
+        /** @return true if this hit should be checked against the system */
+        inline bool countHit() {
+            ThreadState* t = threadState();
+            if ( MONGO_likely( ++t->hits % SampleEvery ) )
+                return false;
+            stats.hits.fetchAndAdd( SampleEvery );
+            return true;
+        }
+
+        int popcount( unsigned long long v ) {
+            int n = 0;
+            for ( ; v; v &= v - 1 )
+                n++;
+            return n;
+        }
+
+    }
+
+    bool PageResidency::likelyResident( const void* p, bool canAskSystem ) {
+        const size_t addr = reinterpret_cast<size_t>( p );
+        Chunk* c = chunkFor( addr, true );
+        if ( !c ) {
+            // outside the range we track, can't happen for a file mapping
+            return canAskSystem ? ProcessInfo::blockInMemory( p ) : false;
+        }
+
+        ageIfNeeded( c );
+
+        AtomicUInt64& word = wordOf( c, addr );
+        const unsigned long long bit = bitOf( addr );
+
+        if ( word.loadRelaxed() & bit ) {
+            if ( !countHit() || !canAskSystem )
+                return true;
+
+            stats.sampledHits.fetchAndAdd( 1 );
+            if ( ProcessInfo::blockInMemory( p ) )
+                return true;
+
+            // evicted since we saw it.  eviction is roughly lru so the neighbours probably
+            // went too; forget the whole word rather than just this page
+            stats.sampledFalsePositives.fetchAndAdd( 1 );
+            word.store( 0 );
+            return false;
+        }
+
+        stats.misses.fetchAndAdd( 1 );
+
+        // either it is resident now, or the caller is about to fault it in
+        setBit( word, bit );
+
+        if ( !canAskSystem ) {
+            // possible we yield too much - but better than not yielding through a fault
+            return false;
+        }
+
+        if ( ProcessInfo::blockInMemory( p ) ) {
+            stats.missesResident.fetchAndAdd( 1 );
+            return true;
+        }
+        return false;
+    }
+
+    void PageResidency::markResident( const void* p ) {
+        const size_t addr = reinterpret_cast<size_t>( p );
+        Chunk* c = chunkFor( addr, true );
+        if ( c )
+            setBit( wordOf( c, addr ), bitOf( addr ) );
+    }
+
+    void PageResidency::appendStats( BSONObjBuilder* b ) {
+        long long sampledHits = stats.sampledHits.load();
+        long long sampledFalsePositives = stats.sampledFalsePositives.load();
+        long long misses = stats.misses.load();
+        long long missesResident = stats.missesResident.load();
+
+        BSONObjBuilder sub( b->subobjStart( "pageResidency" ) );
+        sub.appendNumber( "hits", stats.hits.load() );
+        sub.appendNumber( "sampledHits", sampledHits );
+        sub.appendNumber( "sampledFalsePositives", sampledFalsePositives );
+        sub.appendNumber( "misses", misses );
+        sub.appendNumber( "missesResident", missesResident );
+        sub.append( "falsePositiveRate",
+                    sampledHits ? static_cast<double>( sampledFalsePositives ) / sampledHits : 0 );
+        sub.append( "falseNegativeRate",
+                    misses ? static_cast<double>( missesResident ) / misses : 0 );
+        sub.appendNumber( "chunks", stats.chunksAllocated.load() );
+        sub.appendNumber( "chunkResets", stats.chunkResets.load() );
+        sub.done();
+    }
+
+    void PageResidency::appendWorkingSetInfo( BSONObjBuilder* b ) {
+        Timer t;
+        long long pages = 0;
+        long long oldest = Listener::getElapsedTimeMillis();
+
+        for ( size_t n = 0; n < NumChunks; n++ ) {
+            Chunk* c = reinterpret_cast<Chunk*>( chunks[n].loadRelaxed() );
+            if ( !c )
+                continue;
+            oldest = std::min( oldest, c->lastReset.load() );
+            for ( size_t i = 0; i < WordsPerChunk; i++ )
+                pages += popcount( c->words[i].loadRelaxed() );
+        }
+
+        b->append( "note", "thisIsAnEstimate" );
+        b->appendNumber( "pagesInMemory", pages );
+        b->appendNumber( "computationTimeMicros", static_cast<long long>(t.micros()) );
+        b->append( "overSeconds",
+                   static_cast<int>( ( Listener::getElapsedTimeMillis() - oldest ) / 1000 ) );
+    }
+
+}
@@ -0,0 +1,70 @@
+// page_residency.h
+
+/**
+*    Copyright (C) 2008 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#pragma once
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * Tracks which pages of the memory mapped files we believe are in physical memory, so that
+     * Record::likelyInPhysicalMemory() can answer without a system call.
+     *
+     * The tracker is a bitmap with one bit per 4KB page, kept in lazily allocated chunks that
+     * each cover 4GB of address space.  A datafile is one contiguous mapping, so each one ends
+     * up with its own exact bitmap.  There is no hashing and nothing is dropped when it fills
+     * up, unlike the sliced hash table this replaced.  All updates are lock free.
+     *
+     * Bits are set when a page is seen resident (or is about to be faulted in), every chunk is
+     * cleared after a while so eviction is noticed, and a sample of positive answers is
+     * checked against the system (mincore) to measure and correct false positives.
+     */
+    class PageResidency {
+    public:
+        /**
+         * @param canAskSystem whether ProcessInfo::blockInMemory() may be used for pages we
+         *        know nothing about, and to check the sample
+         * @return whether the page holding 'p' is believed to be in physical memory.  After
+         *         this call the page is assumed to be, since the caller is about to touch it.
+         */
+        static bool likelyResident( const void* p, bool canAskSystem );
+
+        /** the page holding 'p' has just been accessed, so is resident */
+        static void markResident( const void* p );
+
+        /** hit/miss and accuracy counters, for serverStatus */
+        static void appendStats( BSONObjBuilder* b );
+
+        /** estimate of the working set from the bitmaps */
+        static void appendWorkingSetInfo( BSONObjBuilder* b );
+    };
+
+}
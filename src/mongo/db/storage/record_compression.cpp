@@ -0,0 +1,106 @@
+// record_compression.cpp
+
+/**
+*    Copyright (C) 2008 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/storage/record_compression.h"
+
+#include "mongo/base/counter.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/util/compress.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    namespace {
+
+        // small documents don't compress well enough to pay for the header and the copy
+        const int MinSizeToCompress = 128;
+
+        Counter64 decompressCounter;
+        Counter64 decompressMicrosCounter;
+        ServerStatusMetricField<Counter64> decompressCounterDisplay(
+            "record.compression.decompressed", &decompressCounter );
+        ServerStatusMetricField<Counter64> decompressMicrosCounterDisplay(
+            "record.compression.decompressMicros", &decompressMicrosCounter );
+
+    }
+
+    bool RecordCompression::compress( const BSONObj& obj, std::string* out ) {
+        const int size = obj.objsize();
+        if ( size < MinSizeToCompress )
+            return false;
+
+        std::string buf( sizeof(Header) + maxCompressedLength( size ), '\0' );
+        size_t compressedLength;
+        rawCompress( obj.objdata(), size, &buf[ sizeof(Header) ], &compressedLength );
+
+        const int storedSize = static_cast<int>( sizeof(Header) + compressedLength );
+
+        // at least 1/8 smaller, or it isn't worth decompressing on every read
+        if ( storedSize > size - size / 8 )
+            return false;
+
+        Header* h = reinterpret_cast<Header*>( &buf[0] );
+        h->marker = Marker;
+        h->storedSize = storedSize;
+        buf.resize( storedSize );
+        out->swap( buf );
+        return true;
+    }
+
+    BSONObj RecordCompression::decompress( const char* data ) {
+        Timer t;
+        const Header* h = reinterpret_cast<const Header*>( data );
+        const char* compressed = data + sizeof(Header);
+        const size_t compressedLength = h->storedSize - sizeof(Header);
+
+        size_t length;
+        massert( 17317, "corrupt compressed record",
+                 h->storedSize > static_cast<int>( sizeof(Header) ) &&
+                 uncompressedLength( compressed, compressedLength, &length ) &&
+                 length >= 5 && length <= static_cast<size_t>( BSONObjMaxInternalSize ) );
+
+        // laid out as a BSONObj::Holder: refcount then the document
+        char* buf = static_cast<char*>( malloc( sizeof(unsigned) + length ) );
+        verify( buf );
+        memset( buf, 0, sizeof(unsigned) );
+        if ( !rawUncompress( compressed, compressedLength, buf + sizeof(unsigned) ) ) {
+            free( buf );
+            msgasserted( 17318, "corrupt compressed record" );
+        }
+
+        BSONObj obj( reinterpret_cast<BSONObj::Holder*>( buf ) );
+        decompressCounter.increment();
+        decompressMicrosCounter.increment( t.micros() );
+        return obj;
+    }
+
+}
@@ -0,0 +1,94 @@
+// record_compression.h
+
+/**
+*    Copyright (C) 2008 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#pragma once
+
+#include <string>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * On disk format of compressed records, for collections with
+     * NamespaceDetails::Flag_CompressRecords.
+     *
+     * The record data starts with a Header instead of a BSON length, followed by the snappy
+     * compressed document.  The marker is negative so can never be mistaken for a BSON
+     * document, and differs from the deleted record marker.  Records in the same collection
+     * may be compressed or not, so turning the flag on or off needs no rewrite.
+     *
+     * Readers go through BSONObj::make( Record* ), which hands back an owned decompressed
+     * copy; anything that writes into a record's data in place must check isCompressed()
+     * first.
+     */
+    class RecordCompression {
+    public:
+#pragma pack(1)
+        struct Header {
+            int marker;
+            int storedSize; // including this header
+        };
+#pragma pack()
+
+        static const int Marker = static_cast<int>( 0xc0dec0de );
+
+        static bool isCompressed( const char* data ) {
+            return reinterpret_cast<const Header*>( data )->marker == Marker;
+        }
+
+        /** @return the number of bytes of record data in use */
+        static int storedSize( const char* data ) {
+            return reinterpret_cast<const Header*>( data )->storedSize;
+        }
+
+        /**
+         * @param out set to the record data (header included) to store for 'obj'
+         * @return false, leaving 'out' alone, if compression doesn't save enough to be worth
+         *         paying for on every read
+         */
+        static bool compress( const BSONObj& obj, std::string* out );
+
+        /** @return an owned copy of the document in compressed record data 'data' */
+        static BSONObj decompress( const char* data );
+
+        /**
+         * @return the document in record data 'data': an owned decompressed copy if it is
+         *         compressed, otherwise an unowned view of it.  For callers that read a record
+         *         they know to be in memory through Record::dataNoThrowing().
+         */
+        static BSONObj toBSON( const char* data ) {
+            if ( MONGO_unlikely( isCompressed( data ) ) )
+                return decompress( data );
+            return BSONObj( data );
+        }
+    };
+
+}
@@ -30,15 +30,22 @@
 
 #include "mongo/db/structure/collection.h"
 
+#include <algorithm>
+
 #include "mongo/base/counter.h"
+#include "mongo/bson/mutable/damage_vector.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/database.h"
+#include "mongo/db/field_ref_set.h"
 #include "mongo/db/index/index_access_method.h"
+#include "mongo/db/index_names.h"
+#include "mongo/db/index_set.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/storage/extent.h"
 #include "mongo/db/storage/extent_manager.h"
+#include "mongo/db/storage/record_compression.h"
 #include "mongo/db/structure/collection_iterator.h"
 
 #include "mongo/db/pdfile.h" // XXX-ERH
@@ -102,12 +109,41 @@ namespace mongo {
         return new FlatIterator( this, start, dir );
     }
 
+    CollectionIterator* Collection::getExtentRangeIterator( const DiskLoc& firstExtent,
+                                                            const DiskLoc& endExtent ) const {
+        verify( ok() );
+        verify( !_details->isCapped() );
+        return new FlatIterator( this, firstExtent, endExtent );
+    }
+
+    void Collection::partitionExtents( size_t n, std::vector<DiskLoc>* firstExtents ) const {
+        firstExtents->clear();
+        if ( _details->isCapped() || _details->firstExtent().isNull() || n == 0 )
+            return;
+
+        const ExtentManager* em = getExtentManager();
+        long long total = 0;
+        for ( Extent* e = em->getExtent( _details->firstExtent() ); e; e = em->getNextExtent( e ) )
+            total += e->length;
+
+        // an extent starts a new range once the ranges before it have had their share
+        long long seen = 0;
+        for ( Extent* e = em->getExtent( _details->firstExtent() ); e; e = em->getNextExtent( e ) ) {
+            long long size = static_cast<long long>( firstExtents->size() );
+            if ( firstExtents->size() < n && seen >= total * size / static_cast<long long>( n ) )
+                firstExtents->push_back( e->myLoc );
+            seen += e->length;
+        }
+    }
+
     BSONObj Collection::docFor( const DiskLoc& loc ) {
         Record* rec = getExtentManager()->recordFor( loc );
         return BSONObj::make( rec->accessed() );
     }
 
-    StatusWith<DiskLoc> Collection::insertDocument( const BSONObj& docToInsert, bool enforceQuota ) {
+    StatusWith<DiskLoc> Collection::insertDocument( const BSONObj& docToInsert,
+                                                    bool enforceQuota,
+                                                    DeferredIndexInserts* deferred ) {
         if ( _indexCatalog.findIdIndex() ) {
             if ( docToInsert["_id"].eoo() ) {
                 return StatusWith<DiskLoc>( ErrorCodes::InternalError,
@@ -122,7 +158,11 @@ namespace mongo {
                 return StatusWith<DiskLoc>( ret );
         }
 
-        StatusWith<DiskLoc> status = _insertDocument( docToInsert, enforceQuota );
+        // capped inserts may delete documents to make room, which must be fully indexed
+        if ( _details->isCapped() )
+            deferred = NULL;
+
+        StatusWith<DiskLoc> status = _insertDocument( docToInsert, enforceQuota, deferred );
         if ( status.isOK() ) {
             _details->paddingFits();
         }
@@ -130,10 +170,20 @@ namespace mongo {
         return status;
     }
 
-    StatusWith<DiskLoc> Collection::_insertDocument( const BSONObj& docToInsert, bool enforceQuota ) {
+    StatusWith<DiskLoc> Collection::_insertDocument( const BSONObj& docToInsert,
+                                                     bool enforceQuota,
+                                                     DeferredIndexInserts* deferred ) {
+
+        std::string compressed;
+        const char* data = docToInsert.objdata();
+        int dataSize = docToInsert.objsize();
+        if ( _recordStore.compressRecord( docToInsert, &compressed ) ) {
+            data = compressed.data();
+            dataSize = compressed.size();
+        }
 
-        int lenWHdr = _details->getRecordAllocationSize( docToInsert.objsize() + Record::HeaderSize );
-        fassert( 17208, lenWHdr >= ( docToInsert.objsize() + Record::HeaderSize ) );
+        int lenWHdr = _recordStore.getRecordAllocationSize( dataSize + Record::HeaderSize );
+        fassert( 17208, lenWHdr >= ( dataSize + Record::HeaderSize ) );
 
         // TODO: for now, capped logic lives inside NamespaceDetails, which is hidden
         //       under the RecordStore, this feels broken since that should be a
@@ -148,7 +198,7 @@ namespace mongo {
 
         // copy the data
         r = reinterpret_cast<Record*>( getDur().writingPtr(r, lenWHdr) );
-        memcpy( r->data(), docToInsert.objdata(), docToInsert.objsize() );
+        memcpy( r->data(), data, dataSize );
 
         addRecordToRecListInExtent(r, loc.getValue()); // XXX move down into record store
 
@@ -157,7 +207,7 @@ namespace mongo {
         _infoCache.notifyOfWriteOp();
 
         try {
-            _indexCatalog.indexRecord( docToInsert, loc.getValue() );
+            _indexCatalog.indexRecord( docToInsert, loc.getValue(), deferred );
         }
         catch ( AssertionException& e ) {
             if ( _details->isCapped() ) {
@@ -176,6 +226,18 @@ namespace mongo {
         return loc;
     }
 
+    Status Collection::flushDeferredInserts( DeferredIndexInserts* deferred,
+                                             size_t* firstFailed ) {
+        Status status = _indexCatalog.flushDeferredInserts( deferred, firstFailed );
+        if ( !status.isOK() ) {
+            const std::vector<DiskLoc>& locs = deferred->locs();
+            deleteDocuments( std::vector<DiskLoc>( locs.begin() + *firstFailed, locs.end() ),
+                             true );
+        }
+        deferred->clear();
+        return status;
+    }
+
     void Collection::deleteDocument( const DiskLoc& loc, bool cappedOK, bool noWarn,
                                      BSONObj* deletedId ) {
         if ( _details->isCapped() && !cappedOK ) {
@@ -205,13 +267,70 @@ namespace mongo {
         _infoCache.notifyOfWriteOp();
     }
 
+    void Collection::deleteDocuments( const std::vector<DiskLoc>& locs, bool noWarn ) {
+        uassert( 17397,  "cannot remove from a capped collection", !_details->isCapped() );
+
+        std::vector<DiskLoc> sorted( locs );
+        std::sort( sorted.begin(), sorted.end() );
+
+        std::vector< std::pair<BSONObj, DiskLoc> > docs;
+        docs.reserve( sorted.size() );
+        for ( size_t i = 0; i < sorted.size(); i++ ) {
+            ClientCursor::aboutToDelete( _ns.ns(), _details, sorted[i] );
+            docs.push_back( std::make_pair( docFor( sorted[i] ), sorted[i] ) );
+        }
+
+        _indexCatalog.unindexRecords( docs, noWarn );
+
+        for ( size_t i = 0; i < sorted.size(); i++ ) {
+            _recordStore.deallocRecord( sorted[i], getExtentManager()->recordFor( sorted[i] ) );
+        }
+
+        _infoCache.notifyOfWriteOp();
+    }
+
     Counter64 moveCounter;
     ServerStatusMetricField<Counter64> moveCounterDisplay( "record.moves", &moveCounter );
 
+    Counter64 partialUpdateCounter;
+    ServerStatusMetricField<Counter64> partialUpdateCounterDisplay( "record.partialUpdates",
+                                                                    &partialUpdateCounter );
+
+    // Unchanged runs shorter than this are journaled along with the changes around them rather
+    // than paying for another write intent, and an update that would need more than
+    // kMaxPartialUpdateRanges intents journals the whole document instead.
+    const size_t kPartialUpdateMinGap = 16;
+    const size_t kMaxPartialUpdateRanges = 16;
+
+    Counter64 keyGenSkippedCounter;
+    ServerStatusMetricField<Counter64> keyGenSkippedCounterDisplay( "index.keyGenerationsSkipped",
+                                                                    &keyGenSkippedCounter );
+
+    namespace {
+        /**
+         * @return false if no key of 'descriptor' can depend on any of the 'changed' paths
+         */
+        bool keysMightChange( const IndexDescriptor* descriptor, const IndexPathSet& changed ) {
+            BSONObj keyPattern = descriptor->keyPattern();
+
+            // a text index's key pattern names _fts and _ftsx, not the fields it indexes
+            if ( IndexNames::findPluginName( keyPattern ) == IndexNames::TEXT )
+                return true;
+
+            BSONObjIterator i( keyPattern );
+            while ( i.more() ) {
+                if ( changed.mightBeIndexed( i.next().fieldName() ) )
+                    return true;
+            }
+            return false;
+        }
+    }
+
     StatusWith<DiskLoc> Collection::updateDocument( const DiskLoc& oldLocation,
                                                     const BSONObj& objNew,
                                                     bool enforceQuota,
-                                                    OpDebug* debug ) {
+                                                    OpDebug* debug,
+                                                    const FieldRefSet* updatedFields ) {
 
         Record* oldRecord = getExtentManager()->recordFor( oldLocation );
         BSONObj objOld = BSONObj::make( oldRecord );
@@ -233,13 +352,31 @@ namespace mongo {
                 return StatusWith<DiskLoc>( s );
         }
 
+        // the keys of an index over none of the updated paths are the same for both versions
+        // of the document, so don't generate them; such an index gets no ticket below
+        IndexPathSet changedPaths;
+        if ( updatedFields ) {
+            for ( FieldRefSet::const_iterator it = updatedFields->begin();
+                  it != updatedFields->end();
+                  ++it ) {
+                changedPaths.addPath( (*it)->dottedField() );
+            }
+        }
+
         /* duplicate key check. we descend the btree twice - once for this check, and once for the actual inserts, further
            below.  that is suboptimal, but it's pretty complicated to do it the other way without rollbacks...
         */
         OwnedPointerVector<UpdateTicket> updateTickets;
         updateTickets.mutableVector().resize(_indexCatalog.numIndexesTotal());
+        int keyGensSkipped = 0;
         for (int i = 0; i < _indexCatalog.numIndexesTotal(); ++i) {
             IndexDescriptor* descriptor = _indexCatalog.getDescriptor( i );
+
+            if ( updatedFields && !keysMightChange( descriptor, changedPaths ) ) {
+                keyGensSkipped++;
+                continue;
+            }
+
             IndexAccessMethod* iam = _indexCatalog.getIndex( descriptor );
 
             InsertDeleteOptions options;
@@ -255,7 +392,22 @@ namespace mongo {
             }
         }
 
-        if ( oldRecord->netLength() < objNew.objsize() ) {
+        std::string compressed;
+        const char* data = objNew.objdata();
+        int dataSize = objNew.objsize();
+        if ( _recordStore.compressRecord( objNew, &compressed ) ) {
+            data = compressed.data();
+            dataSize = compressed.size();
+        }
+
+        const int oldDataSize = RecordCompression::isCompressed( oldRecord->data() ) ?
+            RecordCompression::storedSize( oldRecord->data() ) : objOld.objsize();
+        const bool fits = oldRecord->netLength() >= dataSize;
+        _recordStore.recordUpdate( oldDataSize + Record::HeaderSize,
+                                   dataSize + Record::HeaderSize,
+                                   !fits );
+
+        if ( !fits ) {
             // doesn't fit, have to move to new location
 
             if ( _details->isCapped() )
@@ -296,10 +448,16 @@ namespace mongo {
         _infoCache.notifyOfWriteOp();
         _details->paddingFits();
 
+        // only now are the skipped indexes really skipped: a move above regenerates every key
+        keyGenSkippedCounter.increment( keyGensSkipped );
+
         if ( debug )
             debug->keyUpdates = 0;
 
         for (int i = 0; i < _indexCatalog.numIndexesTotal(); ++i) {
+            if ( !updateTickets.vector()[i] )
+                continue;
+
             IndexDescriptor* descriptor = _indexCatalog.getDescriptor( i );
             IndexAccessMethod* iam = _indexCatalog.getIndex( descriptor );
 
@@ -312,8 +470,27 @@ namespace mongo {
         }
 
         //  update in place
-        int sz = objNew.objsize();
-        memcpy(getDur().writingPtr(oldRecord->data(), sz), objNew.objdata(), sz);
+        if ( data == objNew.objdata() && !RecordCompression::isCompressed( oldRecord->data() ) ) {
+            // Growing a document in its padding, e.g. by pushing onto an array, or shrinking a
+            // value usually leaves most of its bytes where they were, so only journal the ranges
+            // that changed.
+            mutablebson::DamageVector damages;
+            mutablebson::computeDamages( objOld.objdata(), objOld.objsize(), data, dataSize,
+                                         kPartialUpdateMinGap, &damages );
+            if ( damages.size() <= kMaxPartialUpdateRanges ) {
+                for ( mutablebson::DamageVector::const_iterator it = damages.begin();
+                      it != damages.end();
+                      ++it ) {
+                    void* target = getDur().writingPtr( oldRecord->data() + it->targetOffset,
+                                                        it->size );
+                    memcpy( target, data + it->sourceOffset, it->size );
+                }
+                partialUpdateCounter.increment();
+                return StatusWith<DiskLoc>( oldLocation );
+            }
+        }
+
+        memcpy(getDur().writingPtr(oldRecord->data(), dataSize), data, dataSize);
         return StatusWith<DiskLoc>( oldLocation );
     }
 
@@ -31,6 +31,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "mongo/base/string_data.h"
 #include "mongo/db/catalog/index_catalog.h"
@@ -47,6 +48,7 @@ namespace mongo {
     class ExtentManager;
     class NamespaceDetails;
     class IndexCatalog;
+    class FieldRefSet;
 
     class CollectionIterator;
     class FlatIterator;
@@ -88,27 +90,65 @@ namespace mongo {
         CollectionIterator* getIterator( const DiskLoc& start, bool tailable,
                                          const CollectionScanParams::Direction& dir) const;
 
+        /**
+         * forward iterator over the extents from firstExtent up to but not including endExtent
+         * (null for the end of the collection), for scanning one part of partitionExtents(...)
+         */
+        CollectionIterator* getExtentRangeIterator( const DiskLoc& firstExtent,
+                                                    const DiskLoc& endExtent ) const;
+
+        /**
+         * Split the extent list into at most n contiguous ranges of about the same allocated
+         * size, so they can be scanned independently.  Range i runs from (*firstExtents)[i] to
+         * (*firstExtents)[i+1], the last one to the end of the collection.
+         * Capped and empty collections are not split: *firstExtents is left empty and the
+         * collection should be scanned in one go.
+         */
+        void partitionExtents( size_t n, std::vector<DiskLoc>* firstExtents ) const;
+
         void deleteDocument( const DiskLoc& loc,
                              bool cappedOK = false,
                              bool noWarn = false,
                              BSONObj* deletedId = 0 );
 
+        /**
+         * Deletes the documents at locs, which must all be distinct, as deleteDocument() would
+         * one at a time.  Each index removes all their keys in key order, and then the records
+         * are freed in disk order, so each bucket and extent is visited as few times as may be.
+         */
+        void deleteDocuments( const std::vector<DiskLoc>& locs, bool noWarn = false );
+
         /**
          * this does NOT modify the doc before inserting
          * i.e. will not add an _id field for documents that are missing it
+         * @param deferred if not NULL, the keys of indexes which can take them in bulk are held
+         *        there, and the document isn't fully indexed until flushDeferredInserts()
          */
-        StatusWith<DiskLoc> insertDocument( const BSONObj& doc, bool enforceQuota );
+        StatusWith<DiskLoc> insertDocument( const BSONObj& doc,
+                                            bool enforceQuota,
+                                            DeferredIndexInserts* deferred = NULL );
+
+        /**
+         * Inserts the index keys of the documents inserted with 'deferred', and empties it.
+         * If some keys can't be inserted, the documents from the first one they belong to on
+         * are deleted again, and the error is returned with 'firstFailed' set to the position
+         * of that document in deferred->locs().
+         */
+        Status flushDeferredInserts( DeferredIndexInserts* deferred, size_t* firstFailed );
 
         /**
          * updates the document @ oldLocation with newDoc
          * if the document fits in the old space, it is put there
          * if not, it is moved
+         * @param updatedFields if not NULL, the only paths the update can have changed; the keys
+         *        of indexes over none of them are neither regenerated nor rewritten
          * @return the post update location of the doc (may or may not be the same as oldLocation)
          */
         StatusWith<DiskLoc> updateDocument( const DiskLoc& oldLocation,
                                             const BSONObj& newDoc,
                                             bool enforceQuota,
-                                            OpDebug* debug );
+                                            OpDebug* debug,
+                                            const FieldRefSet* updatedFields = NULL );
 
         int64_t storageSize( int* numExtents = NULL, BSONArrayBuilder* extentInfo = NULL ) const;
 
@@ -130,6 +170,9 @@ namespace mongo {
 
         uint64_t dataSize() const;
 
+        RecordStore* getRecordStore() { return &_recordStore; }
+        const RecordStore* getRecordStore() const { return &_recordStore; }
+
         int averageObjectSize() const {
             uint64_t n = numRecords();
             if ( n == 0 )
@@ -143,7 +186,9 @@ namespace mongo {
          *  - some user error checks
          *  - adjust padding
          */
-        StatusWith<DiskLoc> _insertDocument( const BSONObj& doc, bool enforceQuota );
+        StatusWith<DiskLoc> _insertDocument( const BSONObj& doc,
+                                             bool enforceQuota,
+                                             DeferredIndexInserts* deferred = NULL );
 
         // @return 0 for inf., otherwise a number of files
         int largestFileNumberInQuota() const;
@@ -164,6 +209,8 @@ namespace mongo {
         friend class FlatIterator;
         friend class CappedIterator;
         friend class IndexCatalog;
+        friend class BtreeIndexCursor;
+        friend class PrefetchStage;
     };
 
 }
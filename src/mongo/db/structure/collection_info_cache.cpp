@@ -30,10 +30,18 @@
 
 #include "mongo/db/structure/collection_info_cache.h"
 
+#include <algorithm>
+
 #include "mongo/db/d_concurrency.h"
+#include "mongo/db/dbhelpers.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/keypattern.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/namespace_details-inl.h"
+#include "mongo/db/query/index_histogram.h"
+#include "mongo/db/query/internal_plans.h"
 #include "mongo/db/query/plan_cache.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/util/debug_util.h"
 
@@ -42,16 +50,70 @@
 
 namespace mongo {
 
+    // Limits of the plan cache of each collection, read when the collection is opened.
+    MONGO_EXPORT_SERVER_PARAMETER(planCacheMaxEntries, int, 200);
+    MONGO_EXPORT_SERVER_PARAMETER(planCacheMaxBytes, int, 4 * 1024 * 1024);
+
+    // How many times worse than its trial a cached plan may run before it is evicted.
+    MONGO_EXPORT_SERVER_PARAMETER(planCacheEvictionRatio, double, 10.0);
+
+    // Index histograms: how many keys an index may have to get one, and how finely.
+    MONGO_EXPORT_SERVER_PARAMETER(indexStatsMaxKeysScanned, int, 100000);
+    MONGO_EXPORT_SERVER_PARAMETER(indexStatsNumBuckets, int, 64);
+
+    namespace {
+
+        // A histogram is rebuilt after this many writes, or a tenth of its keys if more.
+        const long long kMinWriteOpsToRebuild = 1000;
+
+        /**
+         * Read every key of a plain btree index into a histogram of its leading field.
+         * @return NULL if the index is special or has more than 'maxKeys' keys
+         */
+        IndexHistogram* buildIndexHistogram(IndexDescriptor* descriptor, size_t maxKeys) {
+            KeyPattern kp(descriptor->keyPattern());
+            if (kp.isSpecial()) {
+                return NULL;
+            }
+
+            BSONObj min = Helpers::toKeyFormat(kp.extendRangeBound(BSONObj(), false));
+            BSONObj max = Helpers::toKeyFormat(kp.extendRangeBound(BSONObj(), true));
+            std::auto_ptr<Runner> runner(InternalPlanner::indexScan(descriptor, min, max, true));
+
+            IndexHistogram::Builder builder(std::max(1, indexStatsNumBuckets));
+            BSONObj key;
+            Runner::RunnerState state;
+            while (Runner::RUNNER_ADVANCED == (state = runner->getNext(&key, NULL))) {
+                if (builder.numKeys() >= maxKeys) {
+                    return NULL;
+                }
+                builder.add(key.firstElement());
+            }
+            if (Runner::RUNNER_EOF != state) {
+                return NULL;
+            }
+            return builder.done();
+        }
+
+    }  // namespace
+
     CollectionInfoCache::CollectionInfoCache( Collection* collection )
         : _collection( collection ),
           _keysComputed( false ),
-          _planCache(new PlanCache()) { }
+          _planCache(new PlanCache(std::max(0, planCacheMaxEntries),
+                                   std::max(0, planCacheMaxBytes),
+                                   planCacheEvictionRatio)),
+          _querySettings(new QuerySettings()),
+          _histogramMutex( "CollectionInfoCache::_histogramMutex" ),
+          _writeOps( 0 ) { }
 
     void CollectionInfoCache::reset() {
         Lock::assertWriteLocked( _collection->ns().ns() );
         clearQueryCache();
         _keysComputed = false;
-        _planCache->clear();
+
+        SimpleMutex::scoped_lock lk( _histogramMutex );
+        _histograms.clear();
     }
 
     void CollectionInfoCache::computeIndexKeys() {
@@ -75,14 +137,42 @@ namespace mongo {
 
     void CollectionInfoCache::notifyOfWriteOp() {
         // TODO: hook up w/new cache when impl
+        ++_writeOps;
     }
 
     void CollectionInfoCache::clearQueryCache() {
-        // TODO: hook up w/new cache when impl
+        _planCache->clear();
     }
 
     PlanCache* CollectionInfoCache::getPlanCache() const {
         return _planCache.get();
     }
 
+    QuerySettings* CollectionInfoCache::getQuerySettings() const {
+        return _querySettings.get();
+    }
+
+    boost::shared_ptr<const IndexHistogram> CollectionInfoCache::getIndexHistogram(
+            IndexDescriptor* descriptor ) {
+        SimpleMutex::scoped_lock lk( _histogramMutex );
+
+        std::map<std::string, HistogramEntry>::iterator it =
+            _histograms.find( descriptor->indexName() );
+        if ( it != _histograms.end() ) {
+            const HistogramEntry& entry = it->second;
+            long long keys = entry.histogram ? entry.histogram->numKeys() : 0;
+            long long allowed = std::max( kMinWriteOpsToRebuild, keys / 10 );
+            if ( _writeOps - entry.writeOpsAtBuild < allowed ) {
+                return entry.histogram;
+            }
+        }
+
+        HistogramEntry entry;
+        entry.histogram.reset( buildIndexHistogram( descriptor,
+                                                    std::max( 0, indexStatsMaxKeysScanned ) ) );
+        entry.writeOpsAtBuild = _writeOps;
+        _histograms[descriptor->indexName()] = entry;
+        return entry.histogram;
+    }
+
 }
@@ -31,13 +31,19 @@
 #pragma once
 
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <map>
 
 #include "mongo/db/index_set.h"
 #include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/query_settings.h"
+#include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
 
     class Collection;
+    class IndexDescriptor;
+    class IndexHistogram;
 
     /**
      * this is for storing things that you want to cache about a single collection
@@ -62,6 +68,22 @@ namespace mongo {
          */
         PlanCache* getPlanCache() const;
 
+        /**
+         * Get the QuerySettings for this collection.  Unlike the plan cache they are kept
+         * across reset(), so index filters survive index builds and drops.
+         */
+        QuerySettings* getQuerySettings() const;
+
+        /**
+         * Get a histogram of the leading field of the index described by 'descriptor', reading
+         * the index to build one if there is none yet or the one there is has seen too many
+         * writes since.  Returns an empty pointer if the index gets none: special (hashed, geo,
+         * text...) indexes and indexes with more than indexStatsMaxKeysScanned keys.
+         *
+         * Needs at least a read lock on the collection.
+         */
+        boost::shared_ptr<const IndexHistogram> getIndexHistogram(IndexDescriptor* descriptor);
+
         // -------------------
 
         /* get set of index keys for this namespace.  handy to quickly check if a given
@@ -96,6 +118,24 @@ namespace mongo {
         // A cache for query plans.
         boost::scoped_ptr<PlanCache> _planCache;
 
+        // Admin settings for query shapes, e.g. index filters.
+        boost::scoped_ptr<QuerySettings> _querySettings;
+
+        // --- index histograms, by index name
+
+        struct HistogramEntry {
+            // Empty if the index gets no histogram.
+            boost::shared_ptr<const IndexHistogram> histogram;
+            long long writeOpsAtBuild;
+        };
+
+        // Protects _histograms; readers build them concurrently.
+        SimpleMutex _histogramMutex;
+        std::map<std::string, HistogramEntry> _histograms;
+
+        // Only changed under the write lock.
+        long long _writeOps;
+
         void computeIndexKeys();
     };
 
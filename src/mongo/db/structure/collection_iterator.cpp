@@ -29,12 +29,18 @@
 #include "mongo/db/structure/collection_iterator.h"
 
 #include "mongo/db/namespace_details.h"
+#include "mongo/db/pdfile.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/extent.h"
 #include "mongo/db/storage/extent_manager.h"
 #include "mongo/db/structure/collection.h"
+#include "mongo/util/mmap.h"
 
 namespace mongo {
 
+    // how much of the next extent to ask the os for when a scan enters an extent, 0 disables
+    MONGO_EXPORT_SERVER_PARAMETER( collectionScanReadaheadKB, int, 4096 );
+
     //
     // Regular / non-capped collection traversal
     //
@@ -44,6 +50,9 @@ namespace mongo {
                                const CollectionScanParams::Direction& dir)
         : _curr(start), _collection(collection), _direction(dir) {
 
+        _readahead = collectionScanReadaheadKB > 0 &&
+            !_collection->_details->isUserFlagSet( NamespaceDetails::Flag_NoScanReadahead );
+
         if (_curr.isNull()) {
 
             const ExtentManager* em = _collection->getExtentManager();
@@ -81,6 +90,36 @@ namespace mongo {
                 _curr = e->lastRecord;
             }
         }
+
+        adviseExtent();
+    }
+
+    FlatIterator::FlatIterator(const Collection* collection,
+                               const DiskLoc& firstExtent,
+                               const DiskLoc& endExtent)
+        : _collection(collection),
+          _direction(CollectionScanParams::FORWARD),
+          _endExtent(endExtent) {
+
+        _readahead = collectionScanReadaheadKB > 0 &&
+            !_collection->_details->isUserFlagSet( NamespaceDetails::Flag_NoScanReadahead );
+
+        const Extent* e = _collection->getExtentManager()->getExtent( firstExtent );
+        _curr = e->firstRecord.isNull() ? firstRecordAfter( e ) : e->firstRecord;
+
+        adviseExtent();
+    }
+
+    FlatIterator::~FlatIterator() { }
+
+    DiskLoc FlatIterator::firstRecordAfter(const Extent* e) const {
+        const ExtentManager* em = _collection->getExtentManager();
+        while ( !e->xnext.isNull() && e->xnext != _endExtent ) {
+            e = em->getExtent( e->xnext );
+            if ( !e->firstRecord.isNull() )
+                return e->firstRecord;
+        }
+        return DiskLoc();
     }
 
     bool FlatIterator::isEOF() {
@@ -93,16 +132,53 @@ namespace mongo {
         // Move to the next thing.
         if (!isEOF()) {
             if (CollectionScanParams::FORWARD == _direction) {
-                _curr = _collection->getExtentManager()->getNextRecord( _curr );
+                const ExtentManager* em = _collection->getExtentManager();
+                DiskLoc next = em->getNextRecordInExtent( _curr );
+                _curr = next.isNull() ? firstRecordAfter( em->extentFor( _curr ) ) : next;
             }
             else {
                 _curr = _collection->getExtentManager()->getPrevRecord( _curr );
             }
+            adviseExtent();
         }
 
         return ret;
     }
 
+    void FlatIterator::adviseExtent() {
+        if ( !_readahead || _curr.isNull() )
+            return;
+
+        const ExtentManager* em = _collection->getExtentManager();
+
+        // the record header is about to be read anyway, so this costs no extra fault
+        DiskLoc extLoc( _curr.a(), em->recordFor( _curr )->extentOfs() );
+        if ( extLoc == _advisedExtent )
+            return;
+        _advisedExtent = extLoc;
+
+        Extent* e = em->getExtent( extLoc );
+        int window = static_cast<int>( std::min( collectionScanReadaheadKB * 1024LL,
+                                                 static_cast<long long>( Extent::maxSize() ) ) );
+
+        if ( CollectionScanParams::FORWARD == _direction ) {
+            // the kernel only reads ahead forwards, so sequential is pointless the other way
+            _sequential.reset();
+            _sequential.reset( new MAdvise( e, e->length, MAdvise::Sequential ) );
+
+            // the next extent's header is cold, so hint from its start without reading it
+            if ( !e->xnext.isNull() && e->xnext != _endExtent )
+                em->willNeed( e->xnext, window );
+        }
+        else if ( !e->xprev.isNull() ) {
+            // going backwards we start at the end of the previous extent; its header is a
+            // single page, which is worth one fault to know where that end is
+            Extent* prev = em->getExtent( e->xprev );
+            int len = std::min( window, prev->length );
+            em->willNeed( DiskLoc( e->xprev.a(), e->xprev.getOfs() + prev->length - len ), len );
+        }
+    }
+
     void FlatIterator::invalidate(const DiskLoc& dl) {
         verify( _collection->ok() );
 
@@ -115,6 +191,9 @@ namespace mongo {
     }
 
     void FlatIterator::prepareToYield() {
+        // extents can be freed while we are yielded; re-advise from scratch afterwards
+        _sequential.reset();
+        _advisedExtent = DiskLoc();
     }
 
     bool FlatIterator::recoverFromYield() {
@@ -28,13 +28,17 @@
 
 #pragma once
 
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/db/diskloc.h"
 #include "mongo/db/exec/collection_scan_common.h"
 
 namespace mongo {
 
     class Collection;
-    class DiskLoc;
+    class Extent;
     class ExtentManager;
+    class MAdvise;
     class NamespaceDetails;
 
     /**
@@ -67,12 +71,24 @@ namespace mongo {
      * The collection must exist when the constructor is called.
      *
      * If start is not DiskLoc(), the iteration begins at that DiskLoc.
+     *
+     * Each time the iteration enters a new extent, the next extent in scan order is madvise()d
+     * WILLNEED so it is being read in while we work through this one, and when going forwards
+     * the current extent is marked MADV_SEQUENTIAL for more aggressive kernel readahead.  This
+     * is off for collections with Flag_NoScanReadahead, or if collectionScanReadaheadKB is 0.
      */
     class FlatIterator : public CollectionIterator {
     public:
         FlatIterator(const Collection* collection, const DiskLoc& start,
                      const CollectionScanParams::Direction& dir);
-        virtual ~FlatIterator() { }
+
+        /**
+         * Iterate forwards over the extents from 'firstExtent' up to but not including
+         * 'endExtent', or to the end of the collection if that isNull.
+         */
+        FlatIterator(const Collection* collection, const DiskLoc& firstExtent,
+                     const DiskLoc& endExtent);
+        virtual ~FlatIterator();
 
         virtual bool isEOF();
         virtual DiskLoc getNext();
@@ -88,6 +104,23 @@ namespace mongo {
         const Collection* _collection;
 
         CollectionScanParams::Direction _direction;
+
+        // Null if we go to the end of the collection.
+        DiskLoc _endExtent;
+
+        // The first record of an extent after 'e' and before _endExtent, null if there is none.
+        DiskLoc firstRecordAfter(const Extent* e) const;
+
+        // Issue readahead hints if _curr has moved to a different extent.
+        void adviseExtent();
+
+        bool _readahead;
+
+        // The extent holding _curr when we last advised, null if we haven't.
+        DiskLoc _advisedExtent;
+
+        // MADV_SEQUENTIAL over _advisedExtent, reset to normal on destruction.
+        boost::scoped_ptr<MAdvise> _sequential;
     };
 
     /**
@@ -0,0 +1,112 @@
+// padding_model.cpp
+
+/**
+*    Copyright (C) 2008 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/structure/padding_model.h"
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    namespace {
+        const double MaxFactor = 2.0;
+
+        // same steps as NamespaceDetails::paddingFits/paddingTooSmall, which only apply them
+        // one time in four
+        const double FitsStep = 0.001;
+        const double MoveStep = 0.01;
+    }
+
+    PaddingModel::PaddingModel()
+        : _updates( 0 ),
+          _moves( 0 ),
+          _movesAvoided( 0 ),
+          _paddingBytes( 0 ),
+          _extraPaddingBytes( 0 ) {
+    }
+
+    int PaddingModel::bucketFor( int size ) {
+        int b = 0;
+        for ( unsigned s = static_cast<unsigned>( size ) >> 1; s && b < NumBuckets - 1; s >>= 1 )
+            b++;
+        return b;
+    }
+
+    double PaddingModel::factorFor( int size ) const {
+        const Bucket& b = _buckets[ bucketFor( size ) ];
+        return b.updates ? b.factor : 0;
+    }
+
+    void PaddingModel::allocated( int size, int allocated, int collectionAllocated ) {
+        _paddingBytes += allocated - size;
+        _extraPaddingBytes += allocated - collectionAllocated;
+    }
+
+    void PaddingModel::updated( int oldSize, int newSize, bool moved, double collectionFactor ) {
+        Bucket& b = _buckets[ bucketFor( oldSize ) ];
+        if ( b.updates++ == 0 )
+            b.factor = collectionFactor;
+        _updates++;
+
+        if ( moved ) {
+            _moves++;
+            double growth = static_cast<double>( newSize ) / oldSize;
+            b.factor = std::min( MaxFactor,
+                                 std::max( b.factor + MoveStep, ( b.factor + growth ) / 2 ) );
+        }
+        else {
+            if ( newSize > oldSize * collectionFactor )
+                _movesAvoided++;
+            b.factor = std::max( 1.0, b.factor - FitsStep );
+        }
+    }
+
+    void PaddingModel::appendStats( BSONObjBuilder* b ) const {
+        BSONObjBuilder sub( b->subobjStart( "paddingModel" ) );
+        sub.appendNumber( "updates", _updates );
+        sub.appendNumber( "moves", _moves );
+        sub.appendNumber( "movesAvoided", _movesAvoided );
+        sub.appendNumber( "paddingBytes", _paddingBytes );
+        sub.appendNumber( "extraPaddingBytes", _extraPaddingBytes );
+
+        BSONArrayBuilder factors( sub.subarrayStart( "factors" ) );
+        for ( int i = 0; i < NumBuckets; i++ ) {
+            if ( !_buckets[i].updates )
+                continue;
+            factors.append( BSON( "minSize" << ( i ? 1LL << i : 0LL )
+                                  << "factor" << _buckets[i].factor
+                                  << "updates" << _buckets[i].updates ) );
+        }
+        factors.done();
+        sub.done();
+    }
+
+}
@@ -0,0 +1,90 @@
+// padding_model.h
+
+/**
+*    Copyright (C) 2008 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#pragma once
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * Learns how much documents of different sizes grow, so that the padding given to a new
+     * record depends on its size rather than on the single NamespaceDetails::paddingFactor.
+     * In a collection where small documents grow a lot and big ones never change, one factor
+     * has to choose between moving the small ones and wasting space on the big ones.
+     *
+     * Records are bucketed by power of two of their size.  Each bucket keeps its own factor,
+     * adjusted like the collection's (down a little on every update that fits, up on every
+     * move) except that a move also pulls the factor halfway towards the growth actually
+     * seen.  A bucket with no updates yet has no opinion, and the collection factor is used.
+     *
+     * Not persisted; on restart it starts learning again from the collection factor.
+     * Must be used under the database write lock.
+     */
+    class PaddingModel {
+    public:
+        static const int NumBuckets = 32;
+
+        PaddingModel();
+
+        /** @return the factor for a new record of 'size' bytes, or 0 if nothing is known */
+        double factorFor( int size ) const;
+
+        /**
+         * a record of 'size' bytes was given 'allocated' bytes by the model, where the
+         * collection factor would have given 'collectionAllocated'
+         */
+        void allocated( int size, int allocated, int collectionAllocated );
+
+        /** an update changed a record from 'oldSize' to 'newSize' bytes */
+        void updated( int oldSize, int newSize, bool moved, double collectionFactor );
+
+        void appendStats( BSONObjBuilder* b ) const;
+
+        static int bucketFor( int size );
+
+    private:
+        struct Bucket {
+            Bucket() : factor( 0 ), updates( 0 ) {}
+            double factor;
+            long long updates;
+        };
+
+        Bucket _buckets[NumBuckets];
+
+        // stats
+        long long _updates;
+        long long _moves;
+        long long _movesAvoided;      // fit, but would have moved with the collection factor
+        long long _paddingBytes;      // padding handed out by the model
+        long long _extraPaddingBytes; // compared to the collection factor, negative if saved
+    };
+
+}
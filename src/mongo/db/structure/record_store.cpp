@@ -30,14 +30,29 @@
 
 #include "mongo/db/structure/record_store.h"
 
+#include "mongo/db/jsobj.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/extent.h"
+#include "mongo/db/storage/record_compression.h"
+#include "mongo/util/timer.h"
 
 #include "mongo/db/pdfile.h" // XXX-ERH
 
 namespace mongo {
 
+    // find free space with SizeClassFreeList rather than walking the deleted lists
+    MONGO_EXPORT_SERVER_PARAMETER( useSizeClassFreeLists, bool, true );
+
+    // pad new records by what PaddingModel learned for their size
+    MONGO_EXPORT_SERVER_PARAMETER( usePaddingModel, bool, true );
+
     RecordStore::RecordStore( const StringData& ns )
-        : _ns( ns.toString() ) {
+        : _ns( ns.toString() ),
+          _compressAttempts( 0 ),
+          _compressedRecords( 0 ),
+          _compressBytesIn( 0 ),
+          _compressBytesOut( 0 ),
+          _compressMicros( 0 ) {
         _extentManager = NULL;
         _details = NULL;
     }
@@ -51,7 +66,7 @@ namespace mongo {
     }
 
     StatusWith<DiskLoc> RecordStore::allocRecord( int lengthWithHeaders, int quotaMax ) {
-        DiskLoc loc = _details->alloc( _ns, lengthWithHeaders );
+        DiskLoc loc = _allocFromFreeList( lengthWithHeaders );
         if ( !loc.isNull() )
             return StatusWith<DiskLoc>( loc );
 
@@ -66,7 +81,7 @@ namespace mongo {
                                                                    _details->lastExtentSize()),
                                              quotaMax );
 
-        loc = _details->alloc( _ns, lengthWithHeaders );
+        loc = _allocFromFreeList( lengthWithHeaders );
         if ( !loc.isNull() ) {
             // got on first try
             return StatusWith<DiskLoc>( loc );
@@ -84,7 +99,7 @@ namespace mongo {
                                                                        _details->lastExtentSize()),
                                                  quotaMax );
 
-            loc = _details->alloc( _ns, lengthWithHeaders);
+            loc = _allocFromFreeList( lengthWithHeaders );
             if ( ! loc.isNull() )
                 return StatusWith<DiskLoc>( loc );
         }
@@ -92,6 +107,191 @@ namespace mongo {
         return StatusWith<DiskLoc>( ErrorCodes::InternalError, "cannot allocate space" );
     }
 
+    int RecordStore::getRecordAllocationSize( int minRecordSize ) {
+        const int collectionSize = _details->getRecordAllocationSize( minRecordSize );
+
+        if ( !usePaddingModel ||
+             _isSystemIndexes ||
+             _details->isCapped() ||
+             _details->isUserFlagSet( NamespaceDetails::Flag_UsePowerOf2Sizes ) )
+            return collectionSize;
+
+        double factor = _paddingModel.factorFor( minRecordSize );
+        if ( factor == 0 )
+            return collectionSize;
+
+        const int size = static_cast<int>( minRecordSize * factor );
+        _paddingModel.allocated( minRecordSize, size, collectionSize );
+        return size;
+    }
+
+    void RecordStore::recordUpdate( int oldSize, int newSize, bool moved ) {
+        if ( _details->isCapped() )
+            return;
+        _paddingModel.updated( oldSize, newSize, moved, _details->paddingFactor() );
+    }
+
+    void RecordStore::appendPaddingStats( BSONObjBuilder* result ) const {
+        _paddingModel.appendStats( result );
+    }
+
+    DiskLoc RecordStore::_allocFromFreeList( int lengthWithHeaders ) {
+        if ( !useSizeClassFreeLists || _details->isCapped() )
+            return _details->alloc( _ns, lengthWithHeaders );
+
+        // same alignment as NamespaceDetails::alloc
+        const int lenToAlloc = ( lengthWithHeaders + 3 ) & 0xfffffffc;
+
+        DiskLoc loc;
+        if ( !_freeList.unlinkFit( _details, lenToAlloc, &loc ) ) {
+            // too much of the deleted lists is unknown to the cache, do it the old way
+            return _details->alloc( _ns, lengthWithHeaders );
+        }
+
+        if ( loc.isNull() )
+            return loc;
+
+        return _details->claimDeletedRecord( _ns, loc, lenToAlloc );
+    }
+
+    void RecordStore::appendFreeListStats( BSONObjBuilder* result ) const {
+        BSONObjBuilder b( result->subobjStart( "freeList" ) );
+        b.append( "enabled", useSizeClassFreeLists && !_details->isCapped() );
+        _freeList.appendStats( &b );
+        b.done();
+    }
+
+    bool RecordStore::compressRecord( const BSONObj& doc, std::string* out ) {
+        if ( !_details->isUserFlagSet( NamespaceDetails::Flag_CompressRecords ) ||
+             _details->isCapped() )
+            return false;
+
+        Timer t;
+        bool compressed = RecordCompression::compress( doc, out );
+        _compressMicros += t.micros();
+        _compressAttempts++;
+
+        if ( compressed ) {
+            _compressedRecords++;
+            _compressBytesIn += doc.objsize();
+            _compressBytesOut += out->size();
+        }
+        return compressed;
+    }
+
+    void RecordStore::appendCompressionStats( BSONObjBuilder* result ) const {
+        BSONObjBuilder b( result->subobjStart( "compression" ) );
+        b.append( "enabled", _details->isUserFlagSet( NamespaceDetails::Flag_CompressRecords ) );
+        b.appendNumber( "attempts", _compressAttempts );
+        b.appendNumber( "compressed", _compressedRecords );
+        b.appendNumber( "bytesIn", _compressBytesIn );
+        b.appendNumber( "bytesOut", _compressBytesOut );
+        b.append( "ratio", _compressBytesOut ?
+                  static_cast<double>( _compressBytesIn ) / _compressBytesOut : 1.0 );
+        b.appendNumber( "compressMicros", _compressMicros );
+        b.done();
+    }
+
+    namespace {
+        // how many more deleted records to cache per coalesceExtent() call
+        const int kCoalesceIndexBudget = 10000;
+
+        // written by NamespaceDetails::addDeletedRec into every deleted record
+        const unsigned kDeletedRecordMarker = 0xeeeeeeee;
+    }
+
+    void RecordStore::coalesceExtent( const DiskLoc& extLoc, CoalesceStats* stats ) {
+        verify( !_details->isCapped() );
+
+        _freeList.indexChains( _details, kCoalesceIndexBudget );
+
+        Extent* e = _extentManager->getExtent( extLoc );
+        const int begin = extLoc.getOfs() + Extent::HeaderSize();
+        const int end = extLoc.getOfs() + e->length;
+
+        // walk the extent in physical order; records and deleted records tile it
+        std::vector< std::pair<DiskLoc, bool> > spans; // loc, looks deleted
+        for ( int ofs = begin; ofs < end; ) {
+            DiskLoc loc( extLoc.a(), ofs );
+            Record* r = _extentManager->recordFor( loc );
+            const int len = r->lengthWithHeaders();
+            if ( len <= 0 || len > end - ofs ) {
+                // not what we expect, leave this extent alone
+                LOG(1) << "coalesceExtent: unexpected record length " << len << " at " << loc;
+                return;
+            }
+            const bool deleted =
+                reinterpret_cast<const unsigned*>( r->data() )[0] == kDeletedRecordMarker;
+            spans.push_back( std::make_pair( loc, deleted ) );
+            ofs += len;
+        }
+
+        // merge each run, but only through records we can actually take off the chains
+        size_t i = 0;
+        while ( i < spans.size() ) {
+            if ( !spans[i].second ) {
+                i++;
+                continue;
+            }
+
+            size_t j = i + 1;
+            while ( j < spans.size() && spans[j].second )
+                j++;
+
+            if ( j - i > 1 ) {
+                DiskLoc head;
+                for ( size_t k = i; k < j; k++ ) {
+                    const DiskLoc& loc = spans[k].first;
+                    if ( !_freeList.unlink( _details, loc ) ) {
+                        if ( !head.isNull() ) {
+                            _details->addDeletedRec( head.drec(), head );
+                            head = DiskLoc();
+                        }
+                        continue;
+                    }
+                    if ( head.isNull() ) {
+                        head = loc;
+                        continue;
+                    }
+                    const int len = loc.drec()->lengthWithHeaders();
+                    getDur().writingInt( head.drec()->lengthWithHeaders() ) += len;
+                    stats->recordsMerged++;
+                    stats->bytesMerged += len;
+                }
+                if ( !head.isNull() )
+                    _details->addDeletedRec( head.drec(), head );
+            }
+
+            i = j;
+        }
+
+        if ( !e->firstRecord.isNull() )
+            return;
+
+        // empty: hand it back, unless it is all the collection has
+        if ( _details->firstExtent() == extLoc && _details->lastExtent() == extLoc )
+            return;
+
+        DiskLoc whole( extLoc.a(), begin );
+        Record* r = _extentManager->recordFor( whole );
+        if ( r->lengthWithHeaders() != end - begin || !_freeList.unlink( _details, whole ) )
+            return;
+
+        if ( e->xprev.isNull() )
+            _details->setFirstExtent( e->xnext );
+        else
+            getDur().writingDiskLoc( _extentManager->getExtent( e->xprev )->xnext ) = e->xnext;
+
+        if ( e->xnext.isNull() )
+            _details->setLastExtent( e->xprev );
+        else
+            getDur().writingDiskLoc( _extentManager->getExtent( e->xnext )->xprev ) = e->xprev;
+
+        getDur().writing( e )->markEmpty();
+        _extentManager->freeExtents( extLoc, extLoc );
+        stats->extentsFreed++;
+    }
+
     void RecordStore::deallocRecord( const DiskLoc& dl, Record* todelete ) {
 
         /* remove ourself from the record next/prev chain */
@@ -144,7 +344,9 @@ namespace mongo {
                     unsigned long long *p = reinterpret_cast<unsigned long long *>( todelete->data() );
                     *getDur().writing(p) = 0;
                 }
-                _details->addDeletedRec((DeletedRecord*)todelete, dl);
+                if ( !_details->isCapped() ||
+                     !_details->cappedMergeIntoWriteGap( dl, todelete->lengthWithHeaders() ) )
+                    _details->addDeletedRec((DeletedRecord*)todelete, dl);
             }
         }
 
@@ -31,9 +31,13 @@
 #pragma once
 
 #include "mongo/db/diskloc.h"
+#include "mongo/db/structure/padding_model.h"
+#include "mongo/db/structure/size_class_free_list.h"
 
 namespace mongo {
 
+    class BSONObj;
+    class BSONObjBuilder;
     class ExtentManager;
     class NamespaceDetails;
     class Record;
@@ -50,11 +54,71 @@ namespace mongo {
 
         StatusWith<DiskLoc> allocRecord( int lengthWithHeaders, int quotaMax );
 
+        /**
+         * @return the size to allocate for a new record of 'minRecordSize' bytes, with
+         *         padding from the PaddingModel where it has learned something, otherwise
+         *         from NamespaceDetails::getRecordAllocationSize()
+         */
+        int getRecordAllocationSize( int minRecordSize );
+
+        /**
+         * tell the padding model about an update that took a record from 'oldSize' to
+         * 'newSize' bytes (both with headers), and whether it had to move
+         */
+        void recordUpdate( int oldSize, int newSize, bool moved );
+
+        /** for collStats */
+        void appendPaddingStats( BSONObjBuilder* result ) const;
+
+        /** for collStats */
+        void appendFreeListStats( BSONObjBuilder* result ) const;
+
+        /**
+         * For collections with Flag_CompressRecords, fill 'out' with the record data to store
+         * for 'doc' if compressing it is worthwhile.
+         * @return false if 'doc' should be stored as is
+         */
+        bool compressRecord( const BSONObj& doc, std::string* out );
+
+        /** for collStats */
+        void appendCompressionStats( BSONObjBuilder* result ) const;
+
+        struct CoalesceStats {
+            CoalesceStats() : recordsMerged( 0 ), bytesMerged( 0 ), extentsFreed( 0 ) {}
+            long long recordsMerged;
+            long long bytesMerged;
+            long long extentsFreed;
+        };
+
+        /**
+         * Merge runs of physically adjacent deleted records in the extent at 'extLoc' and, if
+         * that leaves the extent with no records at all, unlink it from the collection and
+         * give it back to the ExtentManager free list.  Only deleted records the free list
+         * cache can unlink safely are touched, so partial progress is normal.
+         * Non capped collections only, caller must hold the database write lock.
+         */
+        void coalesceExtent( const DiskLoc& extLoc, CoalesceStats* stats );
+
     private:
+        /**
+         * allocate from the deleted lists only, using the size class cache when enabled.
+         * @return null if there is no room and a new extent is needed
+         */
+        DiskLoc _allocFromFreeList( int lengthWithHeaders );
+
         std::string _ns;
         NamespaceDetails* _details;
         ExtentManager* _extentManager;
         bool _isSystemIndexes;
+        SizeClassFreeList _freeList;
+        PaddingModel _paddingModel;
+
+        // compression stats, since this collection was opened
+        long long _compressAttempts;
+        long long _compressedRecords;
+        long long _compressBytesIn;  // of the records that were compressed
+        long long _compressBytesOut;
+        long long _compressMicros;  // including attempts that weren't worth it
     };
 
 }
@@ -0,0 +1,379 @@
+// size_class_free_list.cpp
+
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/db/structure/size_class_free_list.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/bits.h"
+
+#include "mongo/db/pdfile.h" // XXX-ERH
+
+namespace mongo {
+
+    namespace {
+        // deleted records we are willing to touch on disk for one allocation
+        const int kProbeBudget = 64;
+
+        // how far down a chain we follow records pushed onto it by other code paths before
+        // giving up on the cached state for that chain
+        const int kMaxCatchUp = 64;
+
+        // members of the requested size class may be too small, only look at a few
+        const int kSameClassProbes = 4;
+
+        // same defensive check as NamespaceDetails::__stdAlloc
+        bool plausibleLink( const DiskLoc& loc ) {
+            return loc.a() >= -1 && loc.a() < 100000 && loc.getOfs() >= 0;
+        }
+    }
+
+    SizeClassFreeList::SizeClassFreeList()
+        : _allocations( 0 ), _probes( 0 ), _fallbacks( 0 ), _chainResets( 0 ) {
+        memset( _nonEmpty, 0, sizeof( _nonEmpty ) );
+    }
+
+    int SizeClassFreeList::sizeClass( int len ) {
+        if ( len < ( 1 << 5 ) )
+            return 0;
+        if ( len >= ( 1 << 25 ) )
+            return NumSizeClasses - 1;
+        int p = 5;
+        while ( len >> ( p + 1 ) )
+            p++;
+        const int quarter = ( len >> ( p - 2 ) ) & 3;
+        return ( p - 5 ) * 4 + quarter;
+    }
+
+    int SizeClassFreeList::sizeClassMinLength( int sizeClass ) {
+        const int p = 5 + sizeClass / 4;
+        return ( 1 << p ) + ( sizeClass % 4 ) * ( 1 << ( p - 2 ) );
+    }
+
+    void SizeClassFreeList::reset() {
+        _entries.clear();
+        for ( int i = 0; i < NumSizeClasses; i++ )
+            _classes[i].clear();
+        memset( _nonEmpty, 0, sizeof( _nonEmpty ) );
+        for ( int b = 0; b < Buckets; b++ )
+            _chains[b] = Chain();
+    }
+
+    bool SizeClassFreeList::unlinkFit( NamespaceDetails* details, int len, DiskLoc* out ) {
+        const int firstBucket = NamespaceDetails::bucket( len );
+        for ( int b = firstBucket; b < Buckets; b++ )
+            _catchUp( details, b );
+
+        int budget = kProbeBudget;
+        while ( budget > 0 ) {
+            DiskLoc loc = _findCandidate( len );
+            if ( !loc.isNull() ) {
+                budget--;
+                if ( _verifyAndUnlink( details, loc ) ) {
+                    _allocations++;
+                    *out = loc;
+                    return true;
+                }
+                // the chain it was on has been dropped, look again
+                continue;
+            }
+
+            // nothing cached fits, index more of the smallest chain that might hold a fit
+            int b = firstBucket;
+            while ( b < Buckets && _chains[b].complete )
+                b++;
+            if ( b == Buckets ) {
+                // we have seen every deleted record that could fit and none does
+                *out = DiskLoc();
+                return true;
+            }
+            budget -= std::max( 1, _explore( details, b, budget ) );
+        }
+
+        _fallbacks++;
+        return false;
+    }
+
+    bool SizeClassFreeList::unlink( NamespaceDetails* details, const DiskLoc& loc ) {
+        if ( _entries.find( loc ) == _entries.end() )
+            return false;
+        return _verifyAndUnlink( details, loc );
+    }
+
+    bool SizeClassFreeList::indexChains( NamespaceDetails* details, int budget ) {
+        bool complete = true;
+        for ( int b = 0; b < Buckets; b++ ) {
+            _catchUp( details, b );
+            while ( budget > 0 && !_chains[b].complete )
+                budget -= std::max( 1, _explore( details, b, budget ) );
+            complete = complete && _chains[b].complete;
+        }
+        return complete;
+    }
+
+    DiskLoc SizeClassFreeList::_findCandidate( int len ) const {
+        const int cls = sizeClass( len );
+
+        const std::vector<DiskLoc>& same = _classes[cls];
+        for ( size_t i = same.size(), n = 0; i > 0 && n < kSameClassProbes; i--, n++ ) {
+            EntryMap::const_iterator it = _entries.find( same[i - 1] );
+            if ( it->second.length >= len )
+                return it->first;
+        }
+
+        // everything in a larger class fits
+        for ( int c = cls + 1; c < NumSizeClasses; ) {
+            const unsigned long long word = _nonEmpty[c / 64] >> ( c % 64 );
+            if ( word == 0 ) {
+                c = ( c / 64 + 1 ) * 64;
+                continue;
+            }
+            c += firstBitSet( word ) - 1;
+            return _classes[c].back();
+        }
+
+        return DiskLoc();
+    }
+
+    bool SizeClassFreeList::_verifyAndUnlink( NamespaceDetails* details, const DiskLoc& loc ) {
+        const int b = _entries.find( loc )->second.bucket;
+        _catchUp( details, b );
+
+        EntryMap::iterator it = _entries.find( loc );
+        if ( it == _entries.end() ) {
+            // catching up dropped the chain
+            return false;
+        }
+
+        const Entry e = it->second;
+        _probes++;
+        DiskLoc& link = e.prev.isNull() ? details->deletedListEntry( b )
+                                        : e.prev.drec()->nextDeleted();
+        DeletedRecord* d = loc.drec();
+        if ( link != loc ||
+             d->lengthWithHeaders() != e.length ||
+             d->extentOfs() >= loc.getOfs() ) {
+            _resetChain( b );
+            return false;
+        }
+
+        const DiskLoc next = d->nextDeleted();
+
+        // unlink ourself from the deleted list
+        getDur().writingDiskLoc( link ) = next;
+        d->nextDeleted().writing().setInvalid(); // defensive.
+
+        Chain& c = _chains[b];
+        bool consistent = true;
+        if ( loc == c.frontier ) {
+            c.frontier = e.prev;
+        }
+        else {
+            EntryMap::iterator n = _entries.find( next );
+            if ( n == _entries.end() || n->second.prev != loc )
+                consistent = false;
+            else
+                n->second.prev = e.prev;
+        }
+        if ( loc == c.head )
+            c.head = next;
+
+        _remove( it );
+
+        if ( !consistent )
+            _resetChain( b );
+        return true;
+    }
+
+    void SizeClassFreeList::_catchUp( NamespaceDetails* details, int b ) {
+        Chain& c = _chains[b];
+        const DiskLoc diskHead = details->deletedListEntry( b );
+
+        if ( c.indexed == 0 ) {
+            // nothing cached, _explore() starts from the disk head anyway
+            c.complete = diskHead.isNull();
+            return;
+        }
+
+        if ( diskHead == c.head )
+            return;
+
+        std::vector<DiskLoc> pushed;
+        std::vector<int> lengths;
+        DiskLoc cur = diskHead;
+        while ( cur != c.head ) {
+            if ( cur.isNull() ||
+                 !plausibleLink( cur ) ||
+                 static_cast<int>( pushed.size() ) >= kMaxCatchUp ) {
+                _resetChain( b );
+                c.complete = diskHead.isNull();
+                return;
+            }
+
+            EntryMap::const_iterator known = _entries.find( cur );
+            if ( known != _entries.end() ) {
+                // moved here from elsewhere without us seeing it
+                const int other = known->second.bucket;
+                _resetChain( b );
+                if ( other != b )
+                    _resetChain( other );
+                return;
+            }
+
+            DeletedRecord* d = cur.drec();
+            _probes++;
+            pushed.push_back( cur );
+            lengths.push_back( d->lengthWithHeaders() );
+            cur = d->nextDeleted();
+        }
+
+        _entries.find( c.head )->second.prev = pushed.back();
+        for ( size_t i = 0; i < pushed.size(); i++ )
+            _add( pushed[i], i == 0 ? DiskLoc() : pushed[i - 1], lengths[i], b );
+        c.head = diskHead;
+    }
+
+    int SizeClassFreeList::_explore( NamespaceDetails* details, int b, int budget ) {
+        Chain& c = _chains[b];
+        if ( c.complete )
+            return 0;
+
+        DiskLoc prev;
+        DiskLoc cur = details->deletedListEntry( b );
+        int probes = 0;
+
+        if ( c.indexed > 0 ) {
+            // make sure the frontier is still where we left it before following it
+            const Entry& f = _entries.find( c.frontier )->second;
+            const DiskLoc& link = f.prev.isNull() ? details->deletedListEntry( b )
+                                                  : f.prev.drec()->nextDeleted();
+            probes++;
+            if ( link != c.frontier ) {
+                _resetChain( b );
+                _probes += probes;
+                return probes;
+            }
+            prev = c.frontier;
+            cur = c.frontier.drec()->nextDeleted();
+        }
+
+        while ( probes < budget ) {
+            if ( cur.isNull() ) {
+                c.complete = true;
+                break;
+            }
+            if ( !plausibleLink( cur ) || _entries.count( cur ) ) {
+                // leave it to __stdAlloc to complain about a corrupt list
+                _resetChain( b );
+                probes++;
+                break;
+            }
+
+            DeletedRecord* d = cur.drec();
+            probes++;
+            _add( cur, prev, d->lengthWithHeaders(), b );
+            if ( prev.isNull() )
+                c.head = cur;
+            c.frontier = cur;
+            prev = cur;
+            cur = d->nextDeleted();
+        }
+
+        _probes += probes;
+        return probes;
+    }
+
+    void SizeClassFreeList::_add( const DiskLoc& loc, const DiskLoc& prev, int length, int b ) {
+        Entry e;
+        e.prev = prev;
+        e.length = length;
+        e.bucket = b;
+        e.sizeClass = sizeClass( length );
+
+        std::vector<DiskLoc>& members = _classes[e.sizeClass];
+        e.pos = members.size();
+        members.push_back( loc );
+        _nonEmpty[e.sizeClass / 64] |= 1ULL << ( e.sizeClass % 64 );
+
+        _entries[loc] = e;
+        _chains[b].indexed++;
+    }
+
+    void SizeClassFreeList::_remove( EntryMap::iterator it ) {
+        const Entry& e = it->second;
+
+        std::vector<DiskLoc>& members = _classes[e.sizeClass];
+        if ( e.pos != members.size() - 1 ) {
+            members[e.pos] = members.back();
+            _entries.find( members[e.pos] )->second.pos = e.pos;
+        }
+        members.pop_back();
+        if ( members.empty() )
+            _nonEmpty[e.sizeClass / 64] &= ~( 1ULL << ( e.sizeClass % 64 ) );
+
+        _chains[e.bucket].indexed--;
+        _entries.erase( it );
+    }
+
+    void SizeClassFreeList::_resetChain( int b ) {
+        _chainResets++;
+        std::vector<DiskLoc> doomed;
+        for ( EntryMap::const_iterator it = _entries.begin(); it != _entries.end(); ++it ) {
+            if ( it->second.bucket == b )
+                doomed.push_back( it->first );
+        }
+        for ( size_t i = 0; i < doomed.size(); i++ )
+            _remove( _entries.find( doomed[i] ) );
+        _chains[b] = Chain();
+    }
+
+    void SizeClassFreeList::appendStats( BSONObjBuilder* b ) const {
+        b->appendNumber( "allocations", _allocations );
+        b->appendNumber( "probes", _probes );
+        b->append( "avgProbesPerAllocation",
+                   _allocations ? static_cast<double>( _probes ) / _allocations : 0.0 );
+        b->appendNumber( "fallbacks", _fallbacks );
+        b->appendNumber( "chainResets", _chainResets );
+        b->appendNumber( "cachedRecords", static_cast<long long>( _entries.size() ) );
+
+        BSONArrayBuilder chains( b->subarrayStart( "chains" ) );
+        for ( int i = 0; i < Buckets; i++ ) {
+            const Chain& c = _chains[i];
+            if ( c.indexed == 0 )
+                continue;
+            BSONObjBuilder chain( chains.subobjStart() );
+            chain.append( "bucketSize", bucketSizes[i] );
+            chain.appendNumber( "length", c.indexed );
+            chain.append( "complete", c.complete );
+            chain.done();
+        }
+        chains.done();
+    }
+
+}
@@ -0,0 +1,144 @@
+// size_class_free_list.h
+
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/db/namespace_details.h"
+#include "mongo/platform/unordered_map.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * An in memory index over the on disk deleted record chains of a single non capped
+     * collection.  The on disk format (NamespaceDetails::_deletedList[Buckets], singly linked
+     * through DeletedRecord::nextDeleted()) is unchanged; this only caches what has been seen
+     * of those chains, bucketed into finer size classes (4 per power of two) with a bitmap of
+     * non empty classes, so finding a fit is a bit scan rather than a walk over cold pages.
+     *
+     * The cache indexes a prefix of each chain and only ever extends it by a bounded number of
+     * records per allocation.  Writers that bypass it (capped code, compact, the legacy
+     * DataFileMgr paths) are tolerated: pushes onto a chain head are caught up on the next
+     * allocation, and every cached link is re-verified against disk before it is used.  Any
+     * disagreement just drops the cached state for that chain.
+     *
+     * Must be used under the database write lock, like the deleted lists themselves.
+     */
+    class SizeClassFreeList {
+    public:
+        // 4 classes for each power of two from 2^5 to 2^24, the top one unbounded
+        static const int NumSizeClasses = 80;
+
+        SizeClassFreeList();
+
+        /**
+         * Find a deleted record of at least 'lenToAlloc' bytes and unlink it from the on disk
+         * deleted lists of 'details'.
+         * @param lenToAlloc is WITH header and already aligned
+         * @return false if the cache could not decide within its probe budget, in which case
+         *         the caller should fall back to NamespaceDetails::alloc().  Otherwise *out is
+         *         the unlinked record, or null if no deleted record in the collection fits.
+         */
+        bool unlinkFit( NamespaceDetails* details, int lenToAlloc, DiskLoc* out );
+
+        /**
+         * Unlink the specific deleted record at 'loc' from the on disk deleted lists.
+         * @return false if 'loc' is not cached or its cached link turned out to be stale, in
+         *         which case nothing was changed on disk.
+         */
+        bool unlink( NamespaceDetails* details, const DiskLoc& loc );
+
+        /**
+         * Extend the cached prefix of every chain by up to 'budget' records in total.
+         * @return true if every chain is now cached in full
+         */
+        bool indexChains( NamespaceDetails* details, int budget );
+
+        /** forget everything cached, e.g. when the collection has been truncated */
+        void reset();
+
+        /** for collStats */
+        void appendStats( BSONObjBuilder* b ) const;
+
+        static int sizeClass( int len );
+        static int sizeClassMinLength( int sizeClass );
+
+    private:
+        struct Entry {
+            DiskLoc prev;      // null if this is the head of its chain
+            int length;
+            int bucket;        // which on disk chain we are in
+            int sizeClass;
+            unsigned pos;      // index into _classes[sizeClass]
+        };
+
+        struct Chain {
+            Chain() : indexed( 0 ), complete( false ) {}
+            DiskLoc head;      // first indexed record, only meaningful if indexed > 0
+            DiskLoc frontier;  // last indexed record, only meaningful if indexed > 0
+            long long indexed;
+            bool complete;     // frontier is the end of the on disk chain
+        };
+
+        typedef unordered_map<DiskLoc, Entry, DiskLoc::Hasher> EntryMap;
+
+        /** pick up records pushed onto the head of chain 'b' behind our back */
+        void _catchUp( NamespaceDetails* details, int b );
+
+        /** index up to 'budget' more records of chain 'b'. @return disk probes used */
+        int _explore( NamespaceDetails* details, int b, int budget );
+
+        /** @return a cached candidate of at least len bytes, or null */
+        DiskLoc _findCandidate( int len ) const;
+
+        /** check that the cached link to 'loc' still matches disk, and unlink it if so */
+        bool _verifyAndUnlink( NamespaceDetails* details, const DiskLoc& loc );
+
+        void _add( const DiskLoc& loc, const DiskLoc& prev, int length, int b );
+        void _remove( EntryMap::iterator it );
+        void _resetChain( int b );
+
+        EntryMap _entries;
+        std::vector<DiskLoc> _classes[NumSizeClasses];
+        unsigned long long _nonEmpty[ ( NumSizeClasses + 63 ) / 64 ];
+        Chain _chains[Buckets];
+
+        // stats
+        long long _allocations;
+        long long _probes;
+        long long _fallbacks;
+        long long _chainResets;
+    };
+
+}
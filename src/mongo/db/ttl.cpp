@@ -40,30 +40,176 @@
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/database_holder.h"
 #include "mongo/db/instance.h"
-#include "mongo/db/ops/delete.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/is_master.h"
+#include "mongo/db/repl/oplog.h"
 #include "mongo/db/server_parameters.h"
+#include "mongo/db/stats/timer_stats.h"
+#include "mongo/db/structure/collection.h"
 #include "mongo/util/background.h"
 
 namespace mongo {
 
     Counter64 ttlPasses;
     Counter64 ttlDeletedDocuments;
+    TimerStats ttlPassTime;
+
+    // Set at the end of each pass, for the pass.
+    long long ttlLastPassDeletedDocuments = 0;
+    long long ttlLastPassMillis = 0;
+    // How long past its expiry the oldest document the pass deleted was.
+    long long ttlLastPassMaxLagMillis = 0;
 
     ServerStatusMetricField<Counter64> ttlPassesDisplay("ttl.passes", &ttlPasses);
     ServerStatusMetricField<Counter64> ttlDeletedDocumentsDisplay("ttl.deletedDocuments", &ttlDeletedDocuments);
+    ServerStatusMetricField<TimerStats> ttlPassTimeDisplay("ttl.passTime", &ttlPassTime);
+    ServerStatusMetricField<long long> ttlLastPassDeletedDocumentsDisplay(
+            "ttl.lastPass.deletedDocuments", &ttlLastPassDeletedDocuments);
+    ServerStatusMetricField<long long> ttlLastPassMillisDisplay("ttl.lastPass.millis",
+                                                                &ttlLastPassMillis);
+    ServerStatusMetricField<long long> ttlLastPassMaxLagMillisDisplay(
+            "ttl.lastPass.maxLagMillis", &ttlLastPassMaxLagMillis);
 
     MONGO_EXPORT_SERVER_PARAMETER( ttlMonitorEnabled, bool, true );
+
+    // Seconds between passes, how many documents each write lock deletes, and the most a pass
+    // deletes per second (0 for no limit), so that expiring a backlog doesn't flood the disks
+    // and the secondaries.
+    MONGO_EXPORT_SERVER_PARAMETER( ttlMonitorSleepSecs, int, 60 );
+    MONGO_EXPORT_SERVER_PARAMETER( ttlDeleteBatchSize, int, 100 );
+    MONGO_EXPORT_SERVER_PARAMETER( ttlMaxDeletesPerSecond, int, 0 );
     
     class TTLMonitor : public BackgroundJob {
     public:
-        TTLMonitor(){}
+        TTLMonitor() : _passDeleted( 0 ), _passMaxLagMillis( 0 ) {}
         virtual ~TTLMonitor(){}
 
         virtual string name() const { return "TTLMonitor"; }
         
         static string secondsExpireField;
-        
+
+        /**
+         * @return whether a pass should stop deleting for now
+         */
+        static bool shouldStop() {
+            return inShutdown() || !ttlMonitorEnabled || lockedForWriting();
+        }
+
+        /**
+         * Deletes the documents of ns which the ttl index over key says have expired, oldest
+         * first.  They are found by scanning the index, and deleted in batches of
+         * ttlDeleteBatchSize, each under its own write lock, paced to ttlMaxDeletesPerSecond.
+         * @return how many were deleted
+         */
+        long long expireForIndex( const string& ns, const BSONObj& key,
+                                  long long expireAfterSeconds ) {
+            const long long cutoff = curTimeMillis64() - 1000 * expireAfterSeconds;
+
+            BSONObj startKey;
+            {
+                BSONObjBuilder b;
+                b.appendMinForType( "", Date );
+                startKey = b.obj();
+            }
+            BSONObj endKey;
+            {
+                BSONObjBuilder b;
+                b.appendDate( "", cutoff );
+                endKey = b.obj();
+            }
+            // oldest first whichever the order of the index
+            InternalPlanner::Direction direction = key.firstElement().number() < 0 ?
+                InternalPlanner::BACKWARD : InternalPlanner::FORWARD;
+
+            // read once, so that a change made while we run doesn't skew the batches
+            const size_t batchSize = std::max( 1, static_cast<int>( ttlDeleteBatchSize ) );
+            const int maxDeletesPerSecond = ttlMaxDeletesPerSecond;
+
+            long long numDeleted = 0;
+            bool done = false;
+            while ( !done && !shouldStop() ) {
+                // Scoping for write lock.
+                {
+                    Client::WriteContext ctx( ns );
+                    Collection* collection = ctx.ctx().db()->getCollection( ns );
+                    if ( !collection || !isMasterNs( ns.c_str() ) ) {
+                        // collection was dropped, or we stepped down
+                        break;
+                    }
+                    IndexDescriptor* desc =
+                        collection->getIndexCatalog()->findIndexByKeyPattern( key );
+                    if ( !desc ) {
+                        break;
+                    }
+
+                    // The batch is read without yielding, so its locations stay valid until it
+                    // is deleted under the same lock.
+                    vector<DiskLoc> batch;
+                    {
+                        auto_ptr<Runner> runner( InternalPlanner::indexScan( desc,
+                                                                             startKey,
+                                                                             endKey,
+                                                                             false,
+                                                                             direction ) );
+                        BSONObj keyObj;
+                        DiskLoc loc;
+                        while ( batch.size() < batchSize &&
+                                Runner::RUNNER_ADVANCED == runner->getNext( &keyObj, &loc ) ) {
+                            BSONElement e = keyObj.firstElement();
+                            // the start key is the greatest boolean, which doesn't expire
+                            if ( e.type() != Date ) {
+                                continue;
+                            }
+                            if ( 0 == numDeleted && batch.empty() ) {
+                                _passMaxLagMillis =
+                                    std::max( _passMaxLagMillis,
+                                              cutoff - static_cast<long long>( e.date() ) );
+                            }
+                            batch.push_back( loc );
+                        }
+                    }
+                    done = batch.size() < batchSize;
+                    if ( batch.empty() ) {
+                        break;
+                    }
+
+                    for ( size_t i = 0; i < batch.size(); i++ ) {
+                        BSONElement idElt;
+                        if ( BSONObj::make( batch[i].rec() ).getObjectID( idElt ) ) {
+                            BSONObjBuilder bob;
+                            bob.append( idElt );
+                            bool replJustOne = true;
+                            logOp( "d", ns.c_str(), bob.done(), 0, &replJustOne );
+                        }
+                        else {
+                            problem() << "deleted object without id, not logging" << endl;
+                        }
+                    }
+                    collection->deleteDocuments( batch );
+
+                    numDeleted += batch.size();
+                    _passDeleted += batch.size();
+                    ttlDeletedDocuments.increment( batch.size() );
+                }
+
+                // let other operations in between batches, and hold the rate of deletion to
+                // at most maxDeletesPerSecond over the pass
+                long long micros = 2 * Client::recommendedYieldMicros();
+                if ( maxDeletesPerSecond > 0 ) {
+                    long long behind = _passDeleted * 1000000LL / maxDeletesPerSecond -
+                                       _passTimer.micros();
+                    micros = std::max( micros, behind );
+                }
+                if ( !done && micros > 0 ) {
+                    sleepmicros( micros );
+                }
+            }
+
+            return numDeleted;
+        }
+
         void doTTLForDB( const string& dbName ) {
 
             bool isMaster = isMasterNs( dbName.c_str() );
@@ -99,18 +245,10 @@ namespace mongo {
                     continue;
                 }
 
-                BSONObj query;
-                {
-                    BSONObjBuilder b;
-                    b.appendDate( "$lt" , curTimeMillis64() - ( 1000 * idx[secondsExpireField].numberLong() ) );
-                    query = BSON( key.firstElement().fieldName() << b.obj() );
-                }
-                
-                LOG(1) << "TTL: " << key << " \t " << query << endl;
+                LOG(1) << "TTL: " << key << " \t " << idx[secondsExpireField] << endl;
                 
-                long long n = 0;
+                string ns = idx["ns"].String();
                 {
-                    string ns = idx["ns"].String();
                     Client::WriteContext ctx( ns );
                     NamespaceDetails* nsd = nsdetails( ns );
                     if ( ! nsd ) {
@@ -120,15 +258,15 @@ namespace mongo {
                     if ( nsd->setUserFlag( NamespaceDetails::Flag_UsePowerOf2Sizes ) ) {
                         nsd->syncUserFlags( ns );
                     }
-                    // only do deletes if on master
-                    if ( ! isMaster ) {
-                        continue;
-                    }
+                }
 
-                    n = deleteObjects( ns , query , false , true );
-                    ttlDeletedDocuments.increment( n );
+                // only do deletes if on master
+                if ( ! isMaster ) {
+                    continue;
                 }
 
+                long long n = expireForIndex( ns, key, idx[secondsExpireField].numberLong() );
+
                 LOG(1) << "\tTTL deleted: " << n << endl;
             }
             
@@ -140,7 +278,7 @@ namespace mongo {
             cc().getAuthorizationSession()->grantInternalAuthorization();
 
             while ( ! inShutdown() ) {
-                sleepsecs( 60 );
+                sleepsecs( std::max( 1, static_cast<int>( ttlMonitorSleepSecs ) ) );
                 
                 LOG(3) << "TTLMonitor thread awake" << endl;
 
@@ -167,6 +305,9 @@ namespace mongo {
                 }
                 
                 ttlPasses.increment();
+                _passTimer.reset();
+                _passDeleted = 0;
+                _passMaxLagMillis = 0;
 
                 for ( set<string>::const_iterator i=dbs.begin(); i!=dbs.end(); ++i ) {
                     string db = *i;
@@ -178,10 +319,20 @@ namespace mongo {
                     }
                 }
 
+                ttlPassTime.recordMillis( _passTimer.millis() );
+                ttlLastPassDeletedDocuments = _passDeleted;
+                ttlLastPassMillis = _passTimer.millis();
+                ttlLastPassMaxLagMillis = _passMaxLagMillis;
+
             }
         }
 
         DBDirectClient db;
+
+        // for the pass under way
+        Timer _passTimer;
+        long long _passDeleted;
+        long long _passMaxLagMillis;
     };
 
     void startTTLBackgroundJob() {
@@ -0,0 +1,376 @@
+// warm_cache.cpp
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/warm_cache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <boost/filesystem/operations.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mongo/base/counter.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage_options.h"
+#include "mongo/util/background.h"
+#include "mongo/util/mmap.h"
+#include "mongo/util/processinfo.h"
+#include "mongo/util/timer.h"
+#include "mongo/util/touch_pages.h"
+
+namespace mongo {
+
+    Counter64 warmCacheSnapshots;
+    Counter64 warmCachePagesRestored;
+
+    ServerStatusMetricField<Counter64> warmCacheSnapshotsDisplay( "warmCache.snapshots",
+                                                                  &warmCacheSnapshots );
+    ServerStatusMetricField<Counter64> warmCachePagesRestoredDisplay( "warmCache.pagesRestored",
+                                                                      &warmCachePagesRestored );
+
+    // pause between snapshots of the resident pages, 0 for none
+    MONGO_EXPORT_SERVER_PARAMETER( warmCacheSnapshotSecs, int, 0 );
+
+    // whether to read the pages of the last snapshot back in at startup
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER( warmCacheRestore, bool, true );
+
+    namespace {
+
+        const char kSnapshotFileName[] = "warm_cache.bson";
+
+        // Files are looked at, and read back in, through mappings of at most this much at a time
+        const unsigned long long kWindowBytes = 1024ULL * 1024 * 1024;
+
+        // Keeps the snapshot well under the largest BSON object
+        const size_t kMaxRanges = 1000000;
+
+        boost::filesystem::path snapshotPath() {
+            return boost::filesystem::path( storageGlobalParams.dbpath ) / kSnapshotFileName;
+        }
+
+#ifndef _WIN32
+
+        /** the resident pages of one file, as (first page, number of pages) pairs */
+        struct FileSnapshot {
+            FileSnapshot() : isNs( false ), totalPages( 0 ), residentPages( 0 ) {}
+
+            /** .ns files first, then files with the largest part of their pages resident */
+            bool operator<( const FileSnapshot& other ) const {
+                if ( isNs != other.isNs )
+                    return isNs;
+                return residentPages * other.totalPages > other.residentPages * totalPages;
+            }
+
+            string name;
+            bool isNs;
+            unsigned long long totalPages;
+            unsigned long long residentPages;
+            vector<unsigned> ranges;
+        };
+
+        struct CollectFileNames {
+            CollectFileNames( vector<string>* names ) : _names( names ) {}
+            void operator()( MongoFile* mf ) {
+                if ( !mf->filename().empty() )
+                    _names->push_back( mf->filename() );
+            }
+            vector<string>* _names;
+        };
+
+        /** fills in 'out' from a mapping of its own of file 'out->name' */
+        bool snapshotFile( FileSnapshot* out ) {
+            const unsigned long long pageSize = ProcessInfo::getPageSize();
+
+            int fd = open( out->name.c_str(), O_RDONLY );
+            if ( fd < 0 )
+                return false;
+            struct stat st;
+            if ( fstat( fd, &st ) != 0 ) {
+                close( fd );
+                return false;
+            }
+            const unsigned long long length = st.st_size;
+            out->totalPages = ( length + pageSize - 1 ) / pageSize;
+
+            vector<char> resident;
+            bool inRange = false;
+            for ( unsigned long long offset = 0; offset < length; offset += kWindowBytes ) {
+                const size_t windowLength = std::min( kWindowBytes, length - offset );
+                void* p = mmap( NULL, windowLength, PROT_READ, MAP_SHARED, fd, offset );
+                if ( p == MAP_FAILED ) {
+                    close( fd );
+                    return false;
+                }
+                const size_t numPages = ( windowLength + pageSize - 1 ) / pageSize;
+                const bool ok = ProcessInfo::pagesInMemory( p, numPages, &resident );
+                munmap( p, windowLength );
+                if ( !ok ) {
+                    close( fd );
+                    return false;
+                }
+
+                const unsigned firstPage = offset / pageSize;
+                for ( size_t i = 0; i < numPages; i++ ) {
+                    if ( !( resident[i] & 0x1 ) ) {
+                        inRange = false;
+                        continue;
+                    }
+                    out->residentPages++;
+                    if ( inRange ) {
+                        out->ranges.back()++;
+                    }
+                    else {
+                        out->ranges.push_back( firstPage + i );
+                        out->ranges.push_back( 1 );
+                        inRange = true;
+                    }
+                }
+            }
+            close( fd );
+            return true;
+        }
+
+        void writeSnapshot() {
+            vector<string> names;
+            MongoFile::forEach( CollectFileNames( &names ) );
+            std::sort( names.begin(), names.end() );
+            names.erase( std::unique( names.begin(), names.end() ), names.end() );
+
+            vector<FileSnapshot> files;
+            for ( size_t i = 0; i < names.size() && !inShutdown(); i++ ) {
+                FileSnapshot file;
+                file.name = names[i];
+                file.isNs = str::endsWith( names[i], ".ns" );
+                if ( snapshotFile( &file ) && file.residentPages > 0 )
+                    files.push_back( file );
+            }
+            std::sort( files.begin(), files.end() );
+
+            BSONObjBuilder b;
+            b.append( "pageSize", static_cast<long long>( ProcessInfo::getPageSize() ) );
+            b.appendDate( "ts", jsTime() );
+            BSONArrayBuilder filesBuilder( b.subarrayStart( "files" ) );
+            size_t numRanges = 0;
+            for ( size_t i = 0; i < files.size(); i++ ) {
+                const FileSnapshot& file = files[i];
+                numRanges += file.ranges.size() / 2;
+                if ( numRanges > kMaxRanges )
+                    break;
+                BSONObjBuilder fileBuilder( filesBuilder.subobjStart() );
+                fileBuilder.append( "name", file.name );
+                fileBuilder.append( "residentPages", static_cast<long long>( file.residentPages ) );
+                fileBuilder.appendBinData( "ranges", file.ranges.size() * sizeof( unsigned ),
+                                           BinDataGeneral, &file.ranges[0] );
+                fileBuilder.done();
+            }
+            filesBuilder.done();
+            BSONObj snapshot = b.obj();
+
+            // Written beside the old snapshot and renamed over it, so a crash leaves one or the
+            // other
+            const boost::filesystem::path path = snapshotPath();
+            const boost::filesystem::path tmpPath = path.string() + ".tmp";
+            {
+                std::ofstream out( tmpPath.string().c_str(), std::ios::out | std::ios::binary |
+                                                             std::ios::trunc );
+                out.write( snapshot.objdata(), snapshot.objsize() );
+                if ( !out.good() ) {
+                    warning() << "couldn't write " << tmpPath.string() << endl;
+                    return;
+                }
+            }
+            boost::filesystem::rename( tmpPath, path );
+            warmCacheSnapshots.increment();
+        }
+
+        /**
+         * Touches the pages of 'file' in 'ranges', mapping the file a window at a time.
+         * @return the number of pages touched
+         */
+        unsigned long long restoreFile( const string& file, unsigned long long pageSize,
+                                        const unsigned* ranges, size_t numRanges ) {
+            int fd = open( file.c_str(), O_RDONLY );
+            if ( fd < 0 )
+                return 0;
+            struct stat st;
+            if ( fstat( fd, &st ) != 0 ) {
+                close( fd );
+                return 0;
+            }
+            const unsigned long long length = st.st_size;
+
+            unsigned long long touched = 0;
+            char* window = NULL;
+            unsigned long long windowStart = 0;
+            size_t windowLength = 0;
+            for ( size_t i = 0; i < numRanges && !inShutdown(); i++ ) {
+                unsigned long long start = ranges[2 * i] * pageSize;
+                const unsigned long long end = std::min( length,
+                                                         start + ranges[2 * i + 1] * pageSize );
+                while ( start < end ) {
+                    if ( !window || start < windowStart || start >= windowStart + windowLength ) {
+                        if ( window )
+                            munmap( window, windowLength );
+                        windowStart = start - start % kWindowBytes;
+                        windowLength = std::min( kWindowBytes, length - windowStart );
+                        void* p = mmap( NULL, windowLength, PROT_READ, MAP_SHARED, fd,
+                                        windowStart );
+                        if ( p == MAP_FAILED ) {
+                            close( fd );
+                            return touched;
+                        }
+                        window = static_cast<char*>( p );
+                    }
+                    const unsigned long long stop = std::min( end, windowStart + windowLength );
+                    touch_pages( window + ( start - windowStart ), stop - start );
+                    touched += ( stop - start + pageSize - 1 ) / pageSize;
+                    start = stop;
+                }
+            }
+            if ( window )
+                munmap( window, windowLength );
+            close( fd );
+            return touched;
+        }
+
+        void restoreSnapshot() {
+            const boost::filesystem::path path = snapshotPath();
+            if ( !boost::filesystem::exists( path ) )
+                return;
+
+            const unsigned long long fileSize = boost::filesystem::file_size( path );
+            if ( fileSize > static_cast<unsigned long long>( BSONObjMaxUserSize ) ) {
+                warning() << "ignoring " << path.string() << ", it is too large" << endl;
+                return;
+            }
+            std::ifstream in( path.string().c_str(), std::ios::in | std::ios::binary );
+            vector<char> buf( fileSize );
+            in.read( &buf[0], fileSize );
+            if ( fileSize < 5 || !in.good() ||
+                    *reinterpret_cast<const int*>( &buf[0] ) != static_cast<int>( fileSize ) ) {
+                warning() << "ignoring " << path.string() << ", it is truncated" << endl;
+                return;
+            }
+            BSONObj snapshot( &buf[0] );
+            if ( !snapshot.valid() ) {
+                warning() << "ignoring " << path.string() << ", it is corrupt" << endl;
+                return;
+            }
+
+            log() << "reading back the pages in memory at " << snapshot["ts"].Date().toString()
+                  << endl;
+            Timer t;
+            const unsigned long long pageSize = snapshot["pageSize"].numberLong();
+            unsigned long long touched = 0;
+            BSONObjIterator files( snapshot["files"].Obj() );
+            while ( files.more() && !inShutdown() ) {
+                const BSONObj file = files.next().Obj();
+                int len;
+                const char* ranges = file["ranges"].binData( len );
+                const unsigned long long n =
+                    restoreFile( file["name"].String(), pageSize,
+                                 reinterpret_cast<const unsigned*>( ranges ),
+                                 len / ( 2 * sizeof( unsigned ) ) );
+                warmCachePagesRestored.increment( n );
+                touched += n;
+            }
+            log() << "read back " << touched << " pages in " << t.millis() << "ms" << endl;
+        }
+
+#endif  // _WIN32
+
+        class WarmCacheSnapshotter : public BackgroundJob {
+        public:
+            virtual string name() const { return "WarmCacheSnapshotter"; }
+
+            virtual void run() {
+                Client::initThread( name().c_str() );
+                while ( !inShutdown() ) {
+                    sleepsecs( std::max( 1, static_cast<int>( warmCacheSnapshotSecs ) ) );
+                    if ( warmCacheSnapshotSecs <= 0 || inShutdown() )
+                        continue;
+#ifndef _WIN32
+                    try {
+                        writeSnapshot();
+                    }
+                    catch ( const std::exception& e ) {
+                        warning() << "couldn't snapshot the pages in memory: " << e.what() << endl;
+                    }
+#endif
+                }
+                cc().shutdown();
+            }
+        };
+
+        class WarmCacheRestorer : public BackgroundJob {
+        public:
+            WarmCacheRestorer() : BackgroundJob( true /* selfDelete */ ) {}
+
+            virtual string name() const { return "WarmCacheRestorer"; }
+
+            virtual void run() {
+#ifndef _WIN32
+                try {
+                    restoreSnapshot();
+                }
+                catch ( const std::exception& e ) {
+                    warning() << "couldn't read back the pages in memory: " << e.what() << endl;
+                }
+#endif
+            }
+        };
+
+    }  // namespace
+
+    void startWarmCacheSnapshots() {
+        if ( !ProcessInfo::blockCheckSupported() )
+            return;
+        WarmCacheSnapshotter* snapshotter = new WarmCacheSnapshotter();
+        snapshotter->go();
+    }
+
+    void startWarmCacheRestore() {
+        if ( !warmCacheRestore )
+            return;
+        WarmCacheRestorer* restorer = new WarmCacheRestorer();
+        restorer->go();
+    }
+
+}
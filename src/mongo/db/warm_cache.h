@@ -0,0 +1,49 @@
+// warm_cache.h
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+#pragma once
+
+namespace mongo {
+
+    /**
+     * Starts a background job that, every warmCacheSnapshotSecs, asks the system (mincore) which
+     * pages of every mapped file are in physical memory, and writes them as page ranges to
+     * warm_cache.bson in the dbpath.  .ns files come first in the snapshot, then datafiles with
+     * the most of their pages in memory.  Disabled while warmCacheSnapshotSecs is 0.
+     */
+    void startWarmCacheSnapshots();
+
+    /**
+     * Starts a background job that reads the pages of the last snapshot back into memory, in
+     * the snapshot's order, touching one byte a page of a read only mapping of each file.  The
+     * databases needn't be open and no locks are taken, so it runs alongside the first clients.
+     * Does nothing without a snapshot or when warmCacheRestore is false.
+     */
+    void startWarmCacheRestore();
+}
@@ -51,12 +51,15 @@ namespace mongo {
         AGG_RETURNS_CURSORS = 1,
 
         // insert, update, and delele batch command
-        BATCH_COMMANDS = 2
+        BATCH_COMMANDS = 2,
+
+        // mongos streams exhaust query results instead of rejecting or mangling them
+        MONGOS_EXHAUST_QUERIES = 3
     };
 
     // Latest version that the server accepts. This should always be at the latest entry in
     // WireVersion.
-    static const int maxWireVersion = BATCH_COMMANDS;
+    static const int maxWireVersion = MONGOS_EXHAUST_QUERIES;
 
     // Minimum version that the server accepts. We should bump this whenever we don't want
     // to allow communication with too old agents.
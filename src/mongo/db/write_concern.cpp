@@ -225,7 +225,15 @@ namespace mongo {
                                "waiting for replication timed out" );
             }
 
-            sleepmillis(1);
+            // woken once replication gets there; looks again every so often for a stepdown,
+            // a reconfig or a kill
+            int waitMillis = 100;
+            if ( writeConcern.wTimeout > 0 ) {
+                waitMillis = std::min( waitMillis,
+                                       writeConcern.wTimeout - gleTimerHolder->millis() );
+            }
+            waitForReplicationProgress( replOpTime, writeConcern.wNumNodes, writeConcern.wMode,
+                                        waitMillis );
             killCurrentOp.checkForInterrupt();
         }
 
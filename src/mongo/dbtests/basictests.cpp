@@ -32,6 +32,7 @@
 #include "mongo/pch.h"
 
 #include "mongo/db/db.h"
+#include "mongo/db/storage/page_residency.h"
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/util/array.h"
 #include "mongo/util/base64.h"
@@ -511,6 +512,15 @@ namespace BasicTests {
             ASSERT( ! q.blockingPop( x , 5 ) );
             ASSERT( t.seconds() > 3 && t.seconds() < 9 );
 
+            for ( int i = 0; i < 3; i++ )
+                q.push( i );
+            vector<int> front;
+            q.peekFront( 2 , &front );
+            ASSERT_EQUALS( 2U , front.size() );
+            ASSERT_EQUALS( 1 , front[1] );
+            ASSERT_EQUALS( 3 , q.count() );
+            ASSERT( q.tryPop( x ) );
+            ASSERT_EQUALS( 0 , x );
         }
     };
 
@@ -569,6 +579,30 @@ namespace BasicTests {
         }
     } ctest1;
 
+    class PageResidencyTest {
+    public:
+        void run() {
+            // a page we have never told the tracker about, further into the buffer than any
+            // other test could have reached
+            boost::scoped_array<char> buf( new char[ 64 * 4096 ] );
+            const char* p = buf.get() + 32 * 4096;
+
+            // the first question is a miss, after which the page is assumed resident
+            ASSERT( !PageResidency::likelyResident( p, false ) );
+            ASSERT( PageResidency::likelyResident( p, false ) );
+
+            const char* q = p + 4096;
+            PageResidency::markResident( q );
+            ASSERT( PageResidency::likelyResident( q, false ) );
+
+            BSONObjBuilder b;
+            PageResidency::appendStats( &b );
+            BSONObj stats = b.obj()["pageResidency"].Obj();
+            ASSERT( stats["misses"].numberLong() >= 1 );
+            ASSERT( stats["chunks"].numberLong() >= 1 );
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "basic" ) {
@@ -607,6 +641,8 @@ namespace BasicTests {
 
             add< CompressionTest1 >();
 
+            add< PageResidencyTest >();
+
         }
     } myall;
 
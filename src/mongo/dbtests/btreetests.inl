@@ -308,6 +308,54 @@
         }
     };
 
+    class AppendRightEdge : public Base {
+    public:
+        void run() {
+            BtreeRightEdge edge;
+            for ( long long i = 0; i < 2000; i += 2 ) {
+                append( &edge, i );
+            }
+            checkValid( 1000 );
+            ASSERT( edge.head == dl() );
+            ASSERT( edge.leaf == rightMost() );
+
+            // a key which doesn't go at the end is inserted where it belongs
+            append( &edge, 1 );
+            checkValid( 1001 );
+            BSONObj k = key( 1 );
+            ASSERT( present( k, 1 ) );
+
+            // freeing buckets leaves the edge stale
+            for ( long long i = 2; i < 1800; i += 2 ) {
+                k = key( i );
+                ASSERT( unindex( k ) );
+            }
+            checkValid( 102 );
+            for ( long long i = 2000; i < 2500; ++i ) {
+                append( &edge, i );
+            }
+            checkValid( 602 );
+            ASSERT( edge.leaf == rightMost() );
+        }
+    private:
+        static BSONObj key( long long i ) {
+            return BSON( "a" << bigNumString( i, 40 ) );
+        }
+        void append( BtreeRightEdge* edge, long long i ) {
+            BSONObj k = key( i );
+            bt()->bt_insertAppend( dl(), edge, recordLoc(), k, Ordering::make( order() ), true,
+                                   id() );
+            getDur().commitIfNeeded();
+        }
+        DiskLoc rightMost() {
+            DiskLoc loc = dl();
+            while ( !loc.btree()->getNextChild().isNull() ) {
+                loc = loc.btree()->getNextChild();
+            }
+            return loc;
+        }
+    };
+
 /*
 // QUERY_MIGRATION: port later
     class PackUnused : public Base {
@@ -1645,6 +1693,7 @@
             add< MissingLocateMultiBucket >();
             add< SERVER983 >();
             add< DontReuseUnused >();
+            add< AppendRightEdge >();
             // QUERY_MIGRATION
             // add< PackUnused >();
             // add< DontDropReferenceKey >();
@@ -0,0 +1,135 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/pch.h"
+
+#include "mongo/client/bulk_operation_builder.h"
+#include "mongo/dbtests/dbtests.h"
+
+namespace BulkOperationBuilderTests {
+
+    static const char* const ns = "unittests.bulk_operation_builder";
+
+    class Base {
+    public:
+        Base() {
+            _client.dropCollection( ns );
+        }
+
+        virtual ~Base() {
+            _client.dropCollection( ns );
+        }
+
+    protected:
+        DBDirectClient _client;
+    };
+
+    class OrderedStopsAtFirstError : public Base {
+    public:
+        void run() {
+            BulkOperationBuilder bulk( &_client, ns, true );
+            bulk.insert( BSON( "_id" << 1 ) );
+            bulk.insert( BSON( "_id" << 1 ) );
+            bulk.insert( BSON( "_id" << 2 ) );
+            ASSERT_EQUALS( 3U, bulk.size() );
+
+            BatchedCommandResponse response;
+            bulk.execute( BSONObj(), &response );
+            ASSERT_EQUALS( 0U, bulk.size() );
+
+            ASSERT_EQUALS( 1, response.getOk() );
+            ASSERT_EQUALS( 1, response.getN() );
+            ASSERT_EQUALS( 1U, response.sizeErrDetails() );
+            ASSERT_EQUALS( 1, response.getErrDetailsAt( 0 )->getIndex() );
+            ASSERT_EQUALS( 1U, _client.count( ns ) );
+        }
+    };
+
+    class UnorderedReportsOriginalIndexes : public Base {
+    public:
+        void run() {
+            BulkOperationBuilder bulk( &_client, ns, false );
+            bulk.insert( BSON( "_id" << 1 ) );
+            bulk.update( BSON( "_id" << 5 ), BSON( "$set" << BSON( "x" << 1 ) ), true );
+            bulk.insert( BSON( "_id" << 1 ) );
+            bulk.remove( BSON( "_id" << 1 ) );
+            bulk.insert( BSON( "_id" << 3 ) );
+
+            BatchedCommandResponse response;
+            bulk.execute( BSONObj(), &response );
+
+            // both good inserts, the upsert and the delete
+            ASSERT_EQUALS( 1, response.getOk() );
+            ASSERT_EQUALS( 4, response.getN() );
+            ASSERT_EQUALS( 1U, response.sizeErrDetails() );
+            ASSERT_EQUALS( 2, response.getErrDetailsAt( 0 )->getIndex() );
+            ASSERT_EQUALS( 1U, response.sizeUpsertDetails() );
+            ASSERT_EQUALS( 1, response.getUpsertDetailsAt( 0 )->getIndex() );
+
+            ASSERT_EQUALS( 2U, _client.count( ns ) );
+            ASSERT( _client.findOne( ns, BSON( "_id" << 1 ) ).isEmpty() );
+        }
+    };
+
+    class SplitsLargeBatches : public Base {
+    public:
+        void run() {
+            const int numDocs = 2 * BulkOperationBuilder::kMaxWriteBatchSize + 10;
+            const string pad( 1024 * 1024, 'x' );
+
+            BulkOperationBuilder bulk( &_client, ns, true );
+            for ( int i = 0; i < numDocs; ++i ) {
+                bulk.insert( BSON( "_id" << i ) );
+            }
+            // more than fit in one command by size
+            for ( int i = 0; i < 20; ++i ) {
+                bulk.insert( BSON( "_id" << numDocs + i << "pad" << pad ) );
+            }
+
+            BatchedCommandResponse response;
+            bulk.execute( BSON( "w" << 1 ), &response );
+            ASSERT_EQUALS( 1, response.getOk() );
+            ASSERT_EQUALS( numDocs + 20, response.getN() );
+            ASSERT_EQUALS( 0U, response.sizeErrDetails() );
+            ASSERT_EQUALS( static_cast<unsigned long long>( numDocs + 20 ), _client.count( ns ) );
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite( "bulk_operation_builder" ) {
+        }
+
+        void setupTests() {
+            add< OrderedStopsAtFirstError >();
+            add< UnorderedReportsOriginalIndexes >();
+            add< SplitsLargeBatches >();
+        }
+    } myall;
+}
@@ -32,40 +32,9 @@
 
 #include "mongo/db/json.h"
 #include "mongo/dbtests/dbtests.h"
+#include "mongo/dbtests/testable_chunk_manager.h"
 #include "mongo/s/chunk.h"
 
-namespace mongo {
-
-    class TestableChunkManager : public ChunkManager {
-    public:
-        void setShardKey( const BSONObj &keyPattern ) {
-            const_cast<ShardKeyPattern&>(_key) = ShardKeyPattern( keyPattern );
-        }
-        void setSingleChunkForShards( const vector<BSONObj> &splitPoints ) {
-            ChunkMap &chunkMap = const_cast<ChunkMap&>( _chunkMap );
-            ChunkRangeManager &chunkRanges = const_cast<ChunkRangeManager&>( _chunkRanges );
-            set<Shard> &shards = const_cast<set<Shard>&>( _shards );
-            
-            vector<BSONObj> mySplitPoints( splitPoints );
-            mySplitPoints.insert( mySplitPoints.begin(), _key.globalMin() );
-            mySplitPoints.push_back( _key.globalMax() );
-            
-            for( unsigned i = 1; i < mySplitPoints.size(); ++i ) {
-                string name = str::stream() << (i-1);
-                Shard shard( name, name );
-                shards.insert( shard );
-                
-                ChunkPtr chunk( new Chunk( this, mySplitPoints[ i-1 ], mySplitPoints[ i ],
-                                          shard ) );
-                chunkMap[ mySplitPoints[ i ] ] = chunk;
-            }
-            
-            chunkRanges.reloadAll( chunkMap );
-        }
-    };
-    
-} // namespace mongo
-
 namespace ChunkTests {
 
     namespace ChunkManagerTests {
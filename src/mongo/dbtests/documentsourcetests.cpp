@@ -185,6 +185,28 @@ namespace DocumentSourceTests {
             }
         };
 
+        /** Iterate a DocumentSourceCursor in batches. */
+        class IterateBatches : public Base {
+        public:
+            void run() {
+                client.insert( ns, BSON( "a" << 1 ) );
+                client.insert( ns, BSON( "a" << 2 ) );
+                client.insert( ns, BSON( "a" << 3 ) );
+                createSource();
+                // Batches hold at most the requested number of documents, and are appended.
+                vector<Document> batch;
+                ASSERT_EQUALS( 2U, source()->getNextBatch( &batch, 2 ) );
+                ASSERT_EQUALS( 1U, source()->getNextBatch( &batch, 2 ) );
+                ASSERT_EQUALS( 3U, batch.size() );
+                ASSERT_EQUALS( Value( 1 ), batch[0].getField( "a" ) );
+                ASSERT_EQUALS( Value( 3 ), batch[2].getField( "a" ) );
+                // There are no more results.
+                ASSERT_EQUALS( 0U, source()->getNextBatch( &batch, 2 ) );
+                ASSERT( !source()->getNext() );
+                ASSERT( !Lock::isReadLocked() );
+            }
+        };
+
         /** Dispose of a DocumentSourceCursor. */
         class Dispose : public Base {
         public:
@@ -1023,6 +1045,32 @@ namespace DocumentSourceTests {
             }
         };
 
+        /** Documents are matched and projected in batches. */
+        class MatchedBatch : public Base {
+        public:
+            void run() {
+                for ( int i = 0; i < 10; ++i ) {
+                    client.insert( ns, BSON( "_id" << i << "a" << i << "b" << i % 2 ) );
+                }
+                createSource();
+                BSONObj spec = BSON( "$match" << BSON( "b" << 1 ) );
+                intrusive_ptr<DocumentSource> match =
+                        DocumentSourceMatch::createFromBson( spec.firstElement(), ctx() );
+                match->setSource( source() );
+                createProject();
+                project()->setSource( match.get() );
+
+                vector<Document> batch;
+                while ( project()->getNextBatch( &batch, 3 ) ) {}
+                ASSERT_EQUALS( 5U, batch.size() );
+                for ( size_t i = 0; i < batch.size(); ++i ) {
+                    ASSERT_EQUALS( int( 2 * i + 1 ), batch[i].getField( "a" ).getInt() );
+                    ASSERT( batch[i].getField( "b" ).missing() );
+                }
+                assertExhausted();
+            }
+        };
+
         /** List of dependent field paths. */
         class Dependencies : public Base {
         public:
@@ -1882,6 +1930,7 @@ namespace DocumentSourceTests {
 
             add<DocumentSourceCursor::Create>();
             add<DocumentSourceCursor::Iterate>();
+            add<DocumentSourceCursor::IterateBatches>();
             add<DocumentSourceCursor::Dispose>();
             add<DocumentSourceCursor::IterateDispose>();
             add<DocumentSourceCursor::Yield>();
@@ -1934,6 +1983,7 @@ namespace DocumentSourceTests {
             add<DocumentSourceProject::TopLevelDollar>();
             add<DocumentSourceProject::InvalidSpec>();
             add<DocumentSourceProject::TwoDocuments>();
+            add<DocumentSourceProject::MatchedBatch>();
             add<DocumentSourceProject::Dependencies>();
 
             add<DocumentSourceSort::Empty>();
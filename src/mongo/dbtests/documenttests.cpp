@@ -126,6 +126,25 @@ namespace DocumentTests {
             }
         };
 
+        /** Get Document values using precomputed field name hashes. */
+        class GetValueHashed {
+        public:
+            void run() {
+                // Small documents are scanned and larger ones use their hash table.
+                Document small = fromBson( BSON( "a" << 1 << "b" << 2 ) );
+                Document large = fromBson( BSON( "a" << 1 << "b" << 2 << "c" << 3 <<
+                                                 "d" << 4 << "e" << 5 ) );
+                const unsigned aHash = mongo::Document::hashFieldName( "a" );
+                const unsigned eHash = mongo::Document::hashFieldName( "e" );
+                const unsigned zHash = mongo::Document::hashFieldName( "z" );
+                ASSERT_EQUALS( 1, small.getField( "a", aHash ).getInt() );
+                ASSERT( small.getField( "z", zHash ).missing() );
+                ASSERT_EQUALS( 1, large.getField( "a", aHash ).getInt() );
+                ASSERT_EQUALS( 5, large.getField( "e", eHash ).getInt() );
+                ASSERT( large.getField( "z", zHash ).missing() );
+            }
+        };
+
         /** Get Document fields. */
         class SetField {
         public:
@@ -1419,6 +1438,7 @@ namespace DocumentTests {
             add<Document::CreateFromBsonObj>();
             add<Document::AddField>();
             add<Document::GetValue>();
+            add<Document::GetValueHashed>();
             add<Document::SetField>();
             add<Document::Compare>();
             add<Document::CompareNamedNull>();
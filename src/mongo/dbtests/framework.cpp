@@ -100,6 +100,7 @@ namespace mongo {
             frameworkGlobalParams.perfHist = 1;
             frameworkGlobalParams.seed = time( 0 );
             frameworkGlobalParams.runsPerTest = 1;
+            frameworkGlobalParams.benchReps = 0;
 
             Client::initThread("testsuite");
             acquirePathLock();
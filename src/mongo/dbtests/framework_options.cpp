@@ -77,6 +77,12 @@ namespace mongo {
         options->addOptionChaining("perfHist", "perfHist", moe::Unsigned,
                 "number of back runs of perf stats to display");
 
+        options->addOptionChaining("benchReps", "benchReps", moe::Int,
+                "number of timed repetitions of each microbench benchmark");
+
+        options->addOptionChaining("benchJson", "benchJson", moe::String,
+                "file to write microbench results to, as JSON");
+
 
         options->addOptionChaining("suites", "suites", moe::StringVector, "test suites to run")
                                   .hidden()
@@ -136,6 +142,14 @@ namespace mongo {
             frameworkGlobalParams.perfHist = params["perfHist"].as<unsigned>();
         }
 
+        if (params.count("benchReps")) {
+            frameworkGlobalParams.benchReps = params["benchReps"].as<int>();
+        }
+
+        if (params.count("benchJson")) {
+            frameworkGlobalParams.benchJson = params["benchJson"].as<string>();
+        }
+
         bool nodur = false;
         if( params.count("nodur") ) {
             nodur = true;
@@ -49,6 +49,8 @@ namespace mongo {
         std::string dbpathSpec;
         std::vector<std::string> suites;
         std::string filter;
+        int benchReps;          // microbench repetitions per benchmark, 0 for each one's own
+        std::string benchJson;  // file the microbench suite writes its results to, if set
     };
 
     extern FrameworkGlobalParams frameworkGlobalParams;
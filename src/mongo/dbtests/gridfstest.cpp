@@ -33,8 +33,11 @@
 #include "mongo/util/assert_util.h"
 
 using mongo::DBDirectClient;
+using mongo::GridFile;
+using mongo::GridFileReader;
 using mongo::GridFS;
 using mongo::MsgAssertionException;
+using mongo::UserException;
 
 namespace {
     DBDirectClient _client;
@@ -53,6 +56,45 @@ namespace {
         virtual ~SetChunkSizeTest() {}
     };
 
+    class ReadChunksInOrderTest {
+    public:
+        virtual void run() {
+            GridFS grid( _client, "gridtest" );
+            grid.setChunkSize( 5 );
+
+            const string data = "abcdefghijklmnopqrstuvwxyz";
+            grid.storeFile( data.c_str(), data.size(), "alphabet" );
+
+            GridFile file = grid.findFile( "alphabet" );
+            ASSERT( file.exists() );
+            ASSERT_EQUALS( 6, file.getNumChunks() );
+
+            // reads spanning several chunks
+            GridFileReader reader( file );
+            string read;
+            char buf[7];
+            int len;
+            while ( ( len = reader.read( buf, sizeof( buf ) ) ) > 0 ) {
+                read.append( buf, len );
+            }
+            ASSERT_EQUALS( data, read );
+
+            stringstream out;
+            ASSERT_EQUALS( data.size(), file.write( out ) );
+            ASSERT_EQUALS( data, out.str() );
+
+            // a missing chunk is reported rather than skipped
+            _client.remove( "gridtest.fs.chunks", BSON( "files_id" << file.getFileField( "_id" )
+                                                        << "n" << 2 ) );
+            stringstream truncated;
+            ASSERT_THROWS( file.write( truncated ), UserException );
+
+            grid.removeFile( "alphabet" );
+        }
+
+        virtual ~ReadChunksInOrderTest() {}
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "gridfs" ) {
@@ -60,6 +102,7 @@ namespace {
 
         void setupTests() {
             add< SetChunkSizeTest >();
+            add< ReadChunksInOrderTest >();
         }
     } myall;
 }
@@ -120,6 +120,43 @@ namespace IndexUpdateTests {
         }
     };
 
+    /** addKeysToPhaseOneParallel() sorts every key, in order, across its worker threads. */
+    class AddKeysToPhaseOneParallel : public IndexBuildBase {
+    public:
+        void run() {
+            int32_t nDocs = 5000;
+            for( int32_t i = 0; i < nDocs; ++i ) {
+                _client.insert( _ns, BSON( "a" << ( nDocs - 1 - i ) ) );
+            }
+
+            IndexDescriptor* id = addIndexWithInfo();
+            SortPhaseOne phaseOne;
+            phaseOne.sortCmp.reset( BtreeBasedBuilder::getComparison( 1, BSON( "a" << 1 ) ) );
+            phaseOne.sorter.reset( new BSONObjExternalSorter( phaseOne.sortCmp.get() ) );
+            ProgressMeterHolder pm (cc().curop()->setMessage("AddKeysToPhaseOneParallel",
+                                                             "AddKeysToPhaseOneParallel Progress",
+                                                             nDocs,
+                                                             nDocs));
+            BtreeBasedBuilder::addKeysToPhaseOneParallel( collection(),
+                                                          id,
+                                                          &phaseOne,
+                                                          pm.get(),
+                                                          true,
+                                                          3 );
+            ASSERT_EQUALS( static_cast<uint64_t>( nDocs ), phaseOne.n );
+            ASSERT_EQUALS( static_cast<uint64_t>( nDocs ), phaseOne.nkeys );
+            ASSERT( !phaseOne.multi );
+
+            // The merged iterator returns the keys of all the workers in order.
+            auto_ptr<BSONObjExternalSorter::Iterator> i = phaseOne.sorter->iterator();
+            for( int32_t expected = 0; expected < nDocs; ++expected ) {
+                ASSERT( i->more() );
+                ASSERT_EQUALS( expected, i->next().first.firstElement().numberInt() );
+            }
+            ASSERT( !i->more() );
+        }
+    };
+
     /** addKeysToPhaseOne() aborts if the current operation is killed. */
     class InterruptAddKeysToPhaseOne : public IndexBuildBase {
     public:
@@ -442,6 +479,42 @@ namespace IndexUpdateTests {
         }
     };
 
+    /** createIndexes() builds several indexes together and skips ones that exist. */
+    class CreateIndexesOnePass : public IndexBuildBase {
+    public:
+        void run() {
+            Database* db = _ctx.ctx().db();
+            db->dropCollection( _ns );
+            Collection* coll = db->createCollection( _ns );
+            int32_t nDocs = 1000;
+            for( int32_t i = 0; i < nDocs; ++i ) {
+                coll->insertDocument( BSON( "a" << i << "b" << -i << "c" << BSON_ARRAY( i << i + 1 ) ),
+                                      true );
+            }
+            int nBefore = coll->getIndexCatalog()->numIndexesReady();
+
+            vector<BSONObj> specs;
+            specs.push_back( BSON( "key" << BSON( "a" << 1 ) << "ns" << _ns << "name" << "a_1" ) );
+            specs.push_back( BSON( "key" << BSON( "b" << -1 ) << "ns" << _ns << "name" << "b_-1" ) );
+            specs.push_back( BSON( "key" << BSON( "c" << 1 ) << "ns" << _ns << "name" << "c_1" ) );
+            // Listed twice; the second is skipped.
+            specs.push_back( BSON( "key" << BSON( "a" << 1 ) << "ns" << _ns << "name" << "a_1" ) );
+            Status status = coll->getIndexCatalog()->createIndexes( specs, false );
+            ASSERT_OK( status.code() );
+
+            ASSERT_EQUALS( nBefore + 3, coll->getIndexCatalog()->numIndexesReady() );
+            ASSERT_EQUALS( 0, coll->getIndexCatalog()->numIndexesInProgress() );
+            // Every index got every document.
+            ASSERT_EQUALS( nDocs, _client.query( _ns, Query().hint( BSON( "a" << 1 ) ) )->itcount() );
+            ASSERT_EQUALS( nDocs, _client.query( _ns, Query().hint( BSON( "b" << -1 ) ) )->itcount() );
+            ASSERT_EQUALS( nDocs, _client.query( _ns, Query().hint( BSON( "c" << 1 ) ) )->itcount() );
+            // The multikey index was noticed as one.
+            IndexDescriptor* c = coll->getIndexCatalog()->findIndexByName( "c_1" );
+            ASSERT( c );
+            ASSERT( c->isMultikey() );
+        }
+    };
+
     /** Index creation is killed when building the _id index. */
     class InsertBuildIdIndexInterrupt : public IndexBuildBase {
     public:
@@ -772,6 +845,7 @@ namespace IndexUpdateTests {
 
         void setupTests() {
             add<AddKeysToPhaseOne>();
+            add<AddKeysToPhaseOneParallel>();
             add<InterruptAddKeysToPhaseOne>( false );
             add<InterruptAddKeysToPhaseOne>( true );
             // QUERY_MIGRATION
@@ -783,6 +857,7 @@ namespace IndexUpdateTests {
             add<InterruptDoDropDups>( true );
             add<InsertBuildIndexInterrupt>();
             add<InsertBuildIndexInterruptDisallowed>();
+            add<CreateIndexesOnePass>();
             add<InsertBuildIdIndexInterrupt>();
             add<InsertBuildIdIndexInterruptDisallowed>();
             add<DirectClientEnsureIndexInterruptDisallowed>();
@@ -534,6 +534,36 @@ namespace JsonTests {
             }
         };
 
+        class AppendToBuilder {
+        public:
+            void run() {
+                BSONObj o = BSON( "a" << 1 << "b" << BSON( "c" << "d\"e" ) <<
+                                  "f" << BSON_ARRAY( 1.5 << BSONObj() ) );
+                StringBuilder s;
+                s << "prefix ";
+                o.jsonString( s, TenGen, 1 );
+                ASSERT_EQUALS( "prefix " + o.jsonString( TenGen, 1 ), s.str() );
+
+                s.reset();
+                o["b"].jsonString( s, Strict );
+                ASSERT_EQUALS( o["b"].jsonString( Strict ), s.str() );
+            }
+        };
+
+        class LongEscapedString {
+        public:
+            void run() {
+                string value( 1000, 'x' );
+                value[ 10 ] = '"';
+                value[ 500 ] = '\n';
+                value[ 999 ] = '\\';
+                BSONObj o = BSON( "a" << value );
+                string json = o.jsonString( Strict );
+                ASSERT_EQUALS( 1000U + 3U + 12U, json.size() );
+                ASSERT_EQUALS( o, fromjson( json ) );
+            }
+        };
+
     } // namespace JsonStringTests
 
     namespace FromJsonTests {
@@ -2614,6 +2644,8 @@ namespace JsonTests {
             add< JsonStringTests::TimestampTests >();
             add< JsonStringTests::NullString >();
             add< JsonStringTests::AllTypes >();
+            add< JsonStringTests::AppendToBuilder >();
+            add< JsonStringTests::LongEscapedString >();
 
             add< FromJsonTests::Empty >();
             add< FromJsonTests::EmptyWithSpace >();
@@ -0,0 +1,457 @@
+/** @file microbenchtests.cpp : microbenchmarks for hot paths
+
+          Each benchmark times a small operation over warmup repetitions that are thrown away and
+          then several timed repetitions, and reports nanoseconds per operation as min, median,
+          mean, standard deviation and max across the repetitions, so a change can be compared
+          against the spread rather than against a single run.
+
+          Run with "test microbench".  --benchReps overrides the number of timed repetitions and
+          --benchJson <file> writes the results, with the build they came from, to a file.
+*/
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "mongo/db/d_concurrency.h"
+#include "mongo/db/dur.h"
+#include "mongo/db/dur_stats.h"
+#include "mongo/db/json.h"
+#include "mongo/db/key.h"
+#include "mongo/db/matcher/matcher.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/dbtests/dbtests.h"
+#include "mongo/dbtests/framework_options.h"
+#include "mongo/dbtests/testable_chunk_manager.h"
+#include "mongo/util/net/sock.h"
+#include "mongo/util/timer.h"
+#include "mongo/util/version.h"
+
+namespace MicroBenchTests {
+
+    /** results of the benchmarks run so far, for --benchJson */
+    static vector<BSONObj> results;
+
+    static void writeResults() {
+        const string& fn = frameworkGlobalParams.benchJson;
+        if( fn.empty() )
+            return;
+
+        BSONObjBuilder b;
+        b.append("host", getHostName());
+        b.appendTimeT("when", time(0));
+        b.append("version", versionString);
+        b.append("git", gitVersion());
+        b.append("bits", (int) (sizeof(void*) * 8));
+        DEV b.append("DEBUG", true);
+        b.append("dur", storageGlobalParams.dur);
+        BSONArrayBuilder arr( b.subarrayStart("benchmarks") );
+        for( vector<BSONObj>::const_iterator i = results.begin(); i != results.end(); ++i ) {
+            arr.append(*i);
+        }
+        arr.done();
+
+        // rewritten after every benchmark so that a run that dies part way still leaves the
+        // results it got
+        ofstream f(fn.c_str(), ios_base::out | ios_base::trunc);
+        f << b.obj().jsonString(Strict, 1) << endl;
+        if( !f.good() ) {
+            warning() << "couldn't write microbench results to " << fn << endl;
+        }
+    }
+
+    /**
+     * A benchmark: op() is the operation measured.  Subclasses doing setup that shouldn't be
+     * timed do it in prep().
+     */
+    class Bench {
+    public:
+        Bench() : _sink(0) { }
+        virtual ~Bench() { }
+
+        void run() {
+            if( !enabled() ) {
+                cout << "microbench " << name() << " skipped" << endl;
+                return;
+            }
+            prep();
+
+            const unsigned ops = opsPerRep();
+            const unsigned nReps = frameworkGlobalParams.benchReps > 0 ?
+                                   (unsigned) frameworkGlobalParams.benchReps : reps();
+
+            for( unsigned i = 0; i < warmupReps(); i++ ) {
+                timeRep(ops);
+            }
+
+            vector<double> nsPerOp;
+            for( unsigned i = 0; i < nReps; i++ ) {
+                nsPerOp.push_back( (double) timeRep(ops) / ops );
+            }
+
+            if( !nsPerOp.empty() )
+                report(ops, nsPerOp);
+        }
+
+    protected:
+        virtual string name() = 0;
+
+        /** false if the benchmark doesn't apply to this run's configuration */
+        virtual bool enabled() { return true; }
+
+        /** anything you want to do before being timed */
+        virtual void prep() { }
+
+        /** one operation.  feed what it computes to sink() so it isn't optimized away. */
+        virtual void op() = 0;
+
+        virtual unsigned opsPerRep() { return 20000; }
+        virtual unsigned warmupReps() { return 2; }
+        virtual unsigned reps() { return 10; }
+
+        /**
+         * @return nanoseconds taken by one repetition of 'ops' operations.  Benchmarks timing
+         * only one phase of what op() does override this.
+         */
+        virtual unsigned long long timeRep(unsigned ops) {
+            Timer t;
+            for( unsigned i = 0; i < ops; i++ ) {
+                op();
+            }
+            return t.micros() * 1000;
+        }
+
+        void sink(long long x) { _sink += x; }
+
+    private:
+        void report(unsigned ops, vector<double>& nsPerOp) {
+            sort(nsPerOp.begin(), nsPerOp.end());
+            const size_t n = nsPerOp.size();
+            const double median = n % 2 ? nsPerOp[n / 2] :
+                                  (nsPerOp[n / 2 - 1] + nsPerOp[n / 2]) / 2;
+            double sum = 0;
+            for( size_t i = 0; i < n; i++ ) {
+                sum += nsPerOp[i];
+            }
+            const double mean = sum / n;
+            double sq = 0;
+            for( size_t i = 0; i < n; i++ ) {
+                sq += (nsPerOp[i] - mean) * (nsPerOp[i] - mean);
+            }
+            const double stddev = n > 1 ? sqrt(sq / (n - 1)) : 0;
+
+            cout << "microbench " << setw(36) << left << name() << right << fixed
+                 << setprecision(1)
+                 << " median " << setw(10) << median << "ns"
+                 << " min " << setw(10) << nsPerOp.front() << "ns"
+                 << " mean " << setw(10) << mean << "ns"
+                 << " +/- " << setw(5) << (mean ? 100 * stddev / mean : 0) << '%'
+                 << " max " << setw(10) << nsPerOp.back() << "ns"
+                 << "  (" << n << " x " << ops << " ops)" << endl;
+
+            BSONObjBuilder b;
+            b.append("name", name());
+            b.append("reps", (int) n);
+            b.append("opsPerRep", (int) ops);
+            {
+                BSONObjBuilder ns( b.subobjStart("nsPerOp") );
+                ns.append("min", nsPerOp.front());
+                ns.append("median", median);
+                ns.append("mean", mean);
+                ns.append("stddev", stddev);
+                ns.append("max", nsPerOp.back());
+                ns.done();
+            }
+            b.append("opsPerSec", median ? 1e9 / median : 0.0);
+            results.push_back(b.obj());
+            writeResults();
+        }
+
+        long long _sink;
+    };
+
+    /** the harness's own cost per op, to read the other results against */
+    class Empty : public Bench {
+        string name() { return "empty"; }
+        void op() { sink(1); }
+    };
+
+    static BSONObj sampleDoc() {
+        BSONObj sub = BSON( "t" << Date_t(1392328200000ULL) << "abool" << true << "anull" << BSONNULL );
+        return BSON( "_id" << OID("52a1c87e1e0f283cda3b3c8c") << "x" << 3 << "yaaaaaa" << 3.00009 <<
+                     "zz" << 1 << "q" << false << "obj" << sub <<
+                     "zzzzzzz" << "a string a string" <<
+                     "arr" << BSON_ARRAY( sub << sub << 1 << "b" ) <<
+                     "a_somewhat_longer_field_name" << 4 );
+    }
+
+    class BSONBuild : public Bench {
+        string name() { return "bson-build"; }
+        void op() {
+            BSONObjBuilder b;
+            b.append("_id", 12345).append("name", "a string value").append("x", 3.5);
+            b.append("flag", true);
+            {
+                BSONObjBuilder sub( b.subobjStart("sub") );
+                sub.append("a", 1).append("b", "two");
+                sub.done();
+            }
+            sink( b.done().objsize() );
+        }
+    };
+
+    class BSONIterate : public Bench {
+        BSONObj _doc;
+        string name() { return "bson-iterate"; }
+        void prep() { _doc = sampleDoc(); }
+        void op() {
+            BSONObjIterator i(_doc);
+            while( i.more() ) {
+                sink( i.next().type() );
+            }
+        }
+    };
+
+    class BSONGetField : public Bench {
+        BSONObj _doc;
+        string name() { return "bson-getfield-last"; }
+        void prep() { _doc = sampleDoc(); }
+        void op() { sink( _doc["a_somewhat_longer_field_name"].numberInt() ); }
+    };
+
+    template< int Kind >
+    class KeyV1Compare : public Bench {
+        KeyV1Owned _a, _b;
+        Ordering _o;
+    public:
+        KeyV1Compare() : _a(make(1)), _b(make(2)), _o(Ordering::make(BSONObj())) { }
+    private:
+        string name() {
+            switch( Kind ) {
+            case 0: return "keyv1-compare-int";
+            case 1: return "keyv1-compare-string";
+            default: return "keyv1-compare-oid";
+            }
+        }
+        void op() { sink( _a.woCompare(_b, _o) ); }
+        static BSONObj make(int last) {
+            BSONObjBuilder bb;
+            switch( Kind ) {
+            case 0: bb.append("", 12345).append("", 67890); break;
+            case 1: bb.append("", "customer/region/emea").append("", "status/active"); break;
+            default: bb.append("", OID("52a1c87e1e0f283cda3b3c8c")); break;
+            }
+            bb.append("", last);
+            return bb.obj();
+        }
+    };
+
+    class MatcherBase : public Bench {
+        scoped_ptr<Matcher2> _matcher;
+        BSONObj _doc;
+        void prep() {
+            _doc = sampleDoc();
+            _matcher.reset( new Matcher2( fromjson( query() ) ) );
+        }
+        void op() { sink( _matcher->matches(_doc) ); }
+    protected:
+        virtual const char* query() = 0;
+    };
+
+    class MatcherEquality : public MatcherBase {
+        string name() { return "matcher-equality"; }
+        const char* query() { return "{x: 3, q: false}"; }
+    };
+
+    class MatcherRangeIn : public MatcherBase {
+        string name() { return "matcher-range-in"; }
+        const char* query() {
+            return "{yaaaaaa: {$gt: 1, $lt: 5}, zzzzzzz: {$in: ['a', 'b', 'a string a string']}}";
+        }
+    };
+
+    class MatcherDottedArray : public MatcherBase {
+        string name() { return "matcher-dotted-array"; }
+        const char* query() { return "{'arr.abool': true, 'obj.anull': null}"; }
+    };
+
+    class DocumentFromBson : public Bench {
+        BSONObj _doc;
+        string name() { return "document-from-bson"; }
+        void prep() { _doc = sampleDoc(); }
+        void op() { sink( Document(_doc).size() ); }
+    };
+
+    class DocumentToBson : public Bench {
+        Document _doc;
+        string name() { return "document-to-bson"; }
+        void prep() { _doc = Document( sampleDoc() ); }
+        void op() { sink( _doc.toBson().objsize() ); }
+    };
+
+    class DocumentGetField : public Bench {
+        Document _doc;
+        string name() { return "document-getfield"; }
+        void prep() { _doc = Document( sampleDoc() ); }
+        void op() { sink( _doc["a_somewhat_longer_field_name"].getInt() ); }
+    };
+
+    class DocumentSetField : public Bench {
+        Document _doc;
+        string name() { return "document-setfield"; }
+        void prep() { _doc = Document( sampleDoc() ); }
+        void op() {
+            MutableDocument md(_doc);
+            md.setField("x", Value(4));
+            md.addField("added", Value(5));
+            sink( md.freeze().size() );
+        }
+    };
+
+    class ValueCompare : public Bench {
+        Value _a, _b;
+        string name() { return "value-compare-object"; }
+        void prep() {
+            _a = Value( sampleDoc() );
+            MutableDocument md( _a.getDocument() );
+            md.setField("a_somewhat_longer_field_name", Value(5));
+            _b = Value( md.freeze() );
+        }
+        void op() { sink( Value::compare(_a, _b) ); }
+    };
+
+    /** lookups against a collection split into 1000 chunks over 10 shards */
+    class ChunkManagerBase : public Bench {
+    protected:
+        TestableChunkManager _manager;
+        void prep() {
+            _manager.setShardKey( BSON( "a" << 1 ) );
+            vector<BSONObj> splitPoints;
+            for( int i = 1; i < 1000; i++ ) {
+                splitPoints.push_back( BSON( "a" << i * 1000 ) );
+            }
+            _manager.setSingleChunkForShards( splitPoints );
+        }
+    };
+
+    class ChunkManagerFindChunk : public ChunkManagerBase {
+        int _i;
+    public:
+        ChunkManagerFindChunk() : _i(0) { }
+    private:
+        string name() { return "chunkmanager-find-chunk"; }
+        void op() {
+            _i = ( _i + 7919 ) % 1000000;
+            sink( _manager.findIntersectingChunk( BSON( "a" << _i ) )->getMin().objsize() );
+        }
+    };
+
+    class ChunkManagerShardsForQuery : public ChunkManagerBase {
+        BSONObj _query;
+        string name() { return "chunkmanager-shards-for-range"; }
+        void prep() {
+            ChunkManagerBase::prep();
+            _query = fromjson( "{a: {$gte: 250000, $lt: 260000}}" );
+        }
+        unsigned opsPerRep() { return 2000; }
+        void op() {
+            set<Shard> shards;
+            _manager.getShardsForQuery( shards, _query );
+            sink( shards.size() );
+        }
+    };
+
+    /**
+     * PREPLOGBUFFER, the group commit phase that builds the journal section from the write
+     * intents.  An op is the insert of one document; only the time the commits spent preparing
+     * the journal buffer is counted.
+     */
+    class JournalPrep : public Bench {
+        static DBDirectClient _client;
+        BSONObj _doc;
+        string name() { return "journal-prep-insert"; }
+        bool enabled() { return storageGlobalParams.dur; }
+        unsigned opsPerRep() { return 1000; }
+        void prep() {
+            _client.dropCollection("microbench.journalprep");
+            _doc = sampleDoc().removeField("_id");
+        }
+        void op() { }
+        unsigned long long timeRep(unsigned ops) {
+            // keep the commit thread from rotating the stats out from under us
+            unsigned interval = dur::stats._intervalMicros;
+            dur::stats._intervalMicros = 0;
+            unsigned long long before = dur::stats.curr->_prepLogBufferMicros;
+            for( unsigned i = 0; i < ops; i++ ) {
+                _client.insert("microbench.journalprep", _doc);
+            }
+            {
+                Lock::GlobalWrite lk;
+                getDur().commitNow();
+            }
+            unsigned long long micros = dur::stats.curr->_prepLogBufferMicros - before;
+            dur::stats._intervalMicros = interval;
+            return micros * 1000;
+        }
+    };
+    DBDirectClient JournalPrep::_client;
+
+    class All : public Suite {
+    public:
+        All() : Suite( "microbench" ) { }
+
+        void setupTests() {
+            results.clear();
+            add< Empty >();
+            add< BSONBuild >();
+            add< BSONIterate >();
+            add< BSONGetField >();
+            add< KeyV1Compare<0> >();
+            add< KeyV1Compare<1> >();
+            add< KeyV1Compare<2> >();
+            add< MatcherEquality >();
+            add< MatcherRangeIn >();
+            add< MatcherDottedArray >();
+            add< DocumentFromBson >();
+            add< DocumentToBson >();
+            add< DocumentGetField >();
+            add< DocumentSetField >();
+            add< ValueCompare >();
+            add< ChunkManagerFindChunk >();
+            add< ChunkManagerShardsForQuery >();
+            add< JournalPrep >();
+        }
+    } myall;
+
+} // namespace MicroBenchTests
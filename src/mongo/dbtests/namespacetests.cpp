@@ -40,7 +40,10 @@
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/queryutil.h"
 #include "mongo/db/catalog/ondisk/namespace.h"
+#include "mongo/db/storage/record_compression.h"
 #include "mongo/db/structure/collection.h"
+#include "mongo/db/structure/padding_model.h"
+#include "mongo/db/structure/size_class_free_list.h"
 #include "mongo/dbtests/dbtests.h"
 
 
@@ -1218,6 +1221,35 @@ namespace NamespaceTests {
         };
 
 
+        /**
+         * Once a capped collection loops, evicting the oldest records should grow the write
+         * gap in place, leaving capExtent with no adjacent deleted records to compact.
+         */
+        class CappedWriteGap : public Base {
+        public:
+            void run() {
+                create();
+                for ( int i = 0; i < 200; ++i ) {
+                    ASSERT( collection()->insertDocument( bigObj(), true ).isOK() );
+
+                    vector<DiskLoc> drecs;
+                    for ( DiskLoc d = nsd()->cappedListOfAllDeletedRecords(); !d.isNull();
+                          d = d.drec()->nextDeleted() ) {
+                        drecs.push_back( d );
+                    }
+                    std::sort( drecs.begin(), drecs.end() );
+                    for ( unsigned j = 1; j < drecs.size(); ++j ) {
+                        ASSERT( drecs[j-1].getOfs() + drecs[j-1].drec()->lengthWithHeaders()
+                                != drecs[j].getOfs() );
+                    }
+                    // the gap and at most a sliver at the end of the extent
+                    ASSERT( drecs.size() <= 2 );
+                }
+                ASSERT( nsd()->capLooped() );
+                ASSERT( nRecords() > 0 );
+            }
+        };
+
         /**
          * Test  Quantize record allocation size for various buckets
          *       @see NamespaceDetails::quantizeAllocationSpace()
@@ -1596,6 +1628,142 @@ namespace NamespaceTests {
             virtual string spec() const { return ""; }
         };
         
+        /** Size classes split each power of two into quarters. */
+        class SizeClassBoundaries : public Base {
+        public:
+            void run() {
+                ASSERT_EQUALS( 0, SizeClassFreeList::sizeClass( 1 ) );
+                ASSERT_EQUALS( 0, SizeClassFreeList::sizeClass( 32 ) );
+                ASSERT_EQUALS( 1, SizeClassFreeList::sizeClass( 40 ) );
+                ASSERT_EQUALS( 3, SizeClassFreeList::sizeClass( 63 ) );
+                ASSERT_EQUALS( 4, SizeClassFreeList::sizeClass( 64 ) );
+                ASSERT_EQUALS( SizeClassFreeList::NumSizeClasses - 1,
+                               SizeClassFreeList::sizeClass( 0x7fffffff ) );
+                for ( int c = 0; c < SizeClassFreeList::NumSizeClasses; c++ ) {
+                    int min = SizeClassFreeList::sizeClassMinLength( c );
+                    ASSERT_EQUALS( c, SizeClassFreeList::sizeClass( min ) );
+                    if ( c > 0 )
+                        ASSERT_EQUALS( c - 1, SizeClassFreeList::sizeClass( min - 1 ) );
+                }
+            }
+        };
+
+        /** PaddingModel learns separate factors for small growing and large static records. */
+        class PaddingModelPerSize : public Base {
+        public:
+            void run() {
+                PaddingModel model;
+                ASSERT_EQUALS( 0, model.factorFor( 100 ) );
+                ASSERT_EQUALS( PaddingModel::bucketFor( 100 ), PaddingModel::bucketFor( 127 ) );
+                ASSERT( PaddingModel::bucketFor( 100 ) != PaddingModel::bucketFor( 128 ) );
+
+                // small records keep growing by half and moving
+                for ( int i = 0; i < 10; i++ )
+                    model.updated( 100, 150, true, 1.0 );
+                // large records are rewritten at the same size
+                for ( int i = 0; i < 10; i++ )
+                    model.updated( 10000, 10000, false, 1.0 );
+
+                ASSERT( model.factorFor( 100 ) >= 1.4 );
+                ASSERT_EQUALS( 1.0, model.factorFor( 10000 ) );
+                ASSERT_EQUALS( 0, model.factorFor( 1000000 ) );
+            }
+        };
+
+        /** SizeClassFreeList finds and unlinks the same record a deleted list walk would. */
+        class SizeClassFreeListUnlink : public Base {
+        public:
+            void run() {
+                create();
+                cookDeletedList( 310 );
+                DiskLoc expectedLocation = smallestDeletedRecord();
+
+                SizeClassFreeList freeList;
+                DiskLoc loc;
+                ASSERT( freeList.unlinkFit( nsd(), 300, &loc ) );
+                ASSERT_EQUALS( expectedLocation, loc );
+                ASSERT_EQUALS( DiskLoc(), smallestDeletedRecord() );
+
+                // Nothing else fits, and the cache knows it without falling back.
+                DiskLoc none;
+                ASSERT( freeList.unlinkFit( nsd(), 300, &none ) );
+                ASSERT( none.isNull() );
+
+                // A record freed behind the cache's back is picked up from the chain head.
+                nsd()->addDeletedRec( loc.drec(), loc );
+                DiskLoc again;
+                ASSERT( freeList.unlinkFit( nsd(), 300, &again ) );
+                ASSERT_EQUALS( loc, again );
+            }
+            virtual string spec() const { return ""; }
+        };
+
+        /** RecordStore::coalesceExtent() merges physically adjacent deleted records. */
+        class CoalesceAdjacentDeletedRecords : public Base {
+        public:
+            void run() {
+                create();
+                DiskLoc l[ 3 ];
+                for ( int i = 0; i < 3; ++i ) {
+                    StatusWith<DiskLoc> status = collection()->insertDocument( bigObj(), true );
+                    ASSERT( status.isOK() );
+                    l[ i ] = status.getValue();
+                }
+                ASSERT_EQUALS( l[ 0 ].a(), l[ 1 ].a() );
+                ASSERT_EQUALS( l[ 0 ].getOfs() + l[ 0 ].rec()->lengthWithHeaders(),
+                               l[ 1 ].getOfs() );
+                const int merged = l[ 0 ].rec()->lengthWithHeaders() +
+                                   l[ 1 ].rec()->lengthWithHeaders();
+
+                collection()->deleteDocument( l[ 0 ] );
+                collection()->deleteDocument( l[ 1 ] );
+
+                RecordStore::CoalesceStats stats;
+                collection()->getRecordStore()->coalesceExtent( nsd()->firstExtent(), &stats );
+                ASSERT_EQUALS( 1, stats.recordsMerged );
+                ASSERT_EQUALS( 0, stats.extentsFreed );
+                ASSERT_EQUALS( merged, l[ 0 ].drec()->lengthWithHeaders() );
+                ASSERT_EQUALS( 1, nRecords() );
+            }
+            virtual string spec() const { return ""; }
+        };
+
+        class CompressedRecords : public Base {
+        public:
+            void run() {
+                create();
+                nsd()->setUserFlag( NamespaceDetails::Flag_CompressRecords );
+
+                BSONObj b = bigObj();
+                StatusWith<DiskLoc> status = collection()->insertDocument( b, true );
+                ASSERT( status.isOK() );
+                DiskLoc loc = status.getValue();
+                ASSERT( RecordCompression::isCompressed( loc.rec()->data() ) );
+                ASSERT( loc.rec()->netLength() < b.objsize() );
+                ASSERT_EQUALS( b, loc.obj() );
+                ASSERT( loc.obj().isOwned() );
+
+                // still compressed after being rewritten in place
+                BSONObjBuilder bb;
+                bb.append( b["_id"] );
+                bb.append( "a", string( 187, 'b' ) );
+                BSONObj updated = bb.obj();
+                status = collection()->updateDocument( loc, updated, true, NULL );
+                ASSERT( status.isOK() );
+                ASSERT_EQUALS( loc, status.getValue() );
+                ASSERT( RecordCompression::isCompressed( loc.rec()->data() ) );
+                ASSERT_EQUALS( updated, loc.obj() );
+
+                // documents that don't shrink enough are stored as is
+                BSONObj small = BSON( "_id" << 1 << "x" << 2 );
+                status = collection()->insertDocument( small, true );
+                ASSERT( status.isOK() );
+                ASSERT( !RecordCompression::isCompressed( status.getValue().rec()->data() ) );
+                ASSERT_EQUALS( small, status.getValue().obj() );
+            }
+            virtual string spec() const { return ""; }
+        };
+
         /* test  NamespaceDetails::cappedTruncateAfter(const char *ns, DiskLoc loc)
         */
         class TruncateCapped : public Base {
@@ -1771,6 +1939,45 @@ namespace NamespaceTests {
 
     } // namespace NamespaceDetailsTests
 
+    namespace DatabaseTests {
+
+        /** collections looked up again come from the client's cache until one is deleted */
+        class CollectionLookupCache {
+        public:
+            void run() {
+                const char* ns = "unittests.DatabaseTests_CollectionLookupCache";
+                const char* renamed = "unittests.DatabaseTests_CollectionLookupCache_renamed";
+                Lock::GlobalWrite lk;
+                Client::Context ctx( ns );
+                Database* db = ctx.db();
+                db->dropCollection( ns );
+                db->dropCollection( renamed );
+
+                Collection* created = db->createCollection( ns );
+                ASSERT( created );
+                ASSERT_EQUALS( created, db->getCollection( ns ) );
+                ASSERT_EQUALS( created, db->getCollection( ns ) );
+
+                const unsigned long long epoch = Database::collectionEpoch();
+                ASSERT_OK( db->dropCollection( ns ) );
+                ASSERT_LESS_THAN( epoch, Database::collectionEpoch() );
+                ASSERT( !db->getCollection( ns ) );
+
+                created = db->createCollection( ns );
+                ASSERT_EQUALS( created, db->getCollection( ns ) );
+                ASSERT_OK( db->renameCollection( ns, renamed, false ) );
+                ASSERT( !db->getCollection( ns ) );
+                Collection* moved = db->getCollection( renamed );
+                ASSERT( moved );
+                ASSERT_EQUALS( string( renamed ), moved->ns().ns() );
+                ASSERT_EQUALS( moved, db->getCollection( renamed ) );
+
+                ASSERT_OK( db->dropCollection( renamed ) );
+            }
+        };
+
+    } // namespace DatabaseTests
+
     class All : public Suite {
     public:
         All() : Suite( "namespace" ) {
@@ -1835,12 +2042,19 @@ namespace NamespaceTests {
             add< NamespaceDetailsTests::AllocQuantizedWithoutExtra >();
             add< NamespaceDetailsTests::AllocNotQuantizedNearDeletedSize >();
             add< NamespaceDetailsTests::AllocFailsWithTooSmallDeletedRecord >();
+            add< NamespaceDetailsTests::SizeClassBoundaries >();
+            add< NamespaceDetailsTests::SizeClassFreeListUnlink >();
+            add< NamespaceDetailsTests::PaddingModelPerSize >();
+            add< NamespaceDetailsTests::CoalesceAdjacentDeletedRecords >();
+            add< NamespaceDetailsTests::CompressedRecords >();
             add< NamespaceDetailsTests::TwoExtent >();
+            add< NamespaceDetailsTests::CappedWriteGap >();
             add< NamespaceDetailsTests::TruncateCapped >();
             add< NamespaceDetailsTests::Migrate >();
             add< NamespaceDetailsTests::SwapIndexEntriesTest >();
             //            add< NamespaceDetailsTests::BigCollection >();
             add< NamespaceDetailsTests::Size >();
+            add< DatabaseTests::CollectionLookupCache >();
             add< MissingFieldTests::BtreeIndexMissingField >();
             add< MissingFieldTests::TwoDIndexMissingField >();
             add< MissingFieldTests::HashedIndexMissingField >();
@@ -200,13 +200,15 @@ namespace OplogStartTests {
             // the backwards scan
             ASSERT_EQUALS(_stage->work(&id), PlanStage::NEED_TIME);
             ASSERT(_stage->isBackwardsScanning());
-            // hop back extent by extent
-            for (int i = 0; i < numHops(); i++) {
-                ASSERT_EQUALS(_stage->work(&id), PlanStage::NEED_TIME);
+            // search the extents, never taking more steps than hopping back one by one would
+            int hops = 0;
+            PlanStage::StageState state;
+            while (PlanStage::NEED_TIME == (state = _stage->work(&id))) {
                 ASSERT(_stage->isExtentHopping());
+                hops++;
+                ASSERT(hops <= maxHops());
             }
-            // find the right loc without hopping again
-            ASSERT_EQUALS(_stage->work(&id), finalState());
+            ASSERT_EQUALS(state, finalState());
 
             int startDocId = tsGte() - 1;
             if (startDocId >= 0) {
@@ -239,7 +241,7 @@ namespace OplogStartTests {
         // to be defined by subclasses
         virtual BSONArray extentSizes() const = 0;
         virtual int numDocs() const = 0;
-        virtual int numHops() const = 0;
+        virtual int maxHops() const = 0;
         virtual PlanStage::StageState finalState() const { return PlanStage::ADVANCED; }
         virtual int tsGte() const { return 1; }
     };
@@ -254,7 +256,7 @@ namespace OplogStartTests {
      */
     class OplogStartOneEmptyExtent : public SizedExtentHopBase {
         virtual int numDocs() const { return 2; }
-        virtual int numHops() const { return 1; }
+        virtual int maxHops() const { return 1; }
         virtual BSONArray extentSizes() const {
             return BSON_ARRAY( fitsOne() << tooSmall() << fitsOne() );
         }
@@ -270,7 +272,7 @@ namespace OplogStartTests {
      */
     class OplogStartTwoEmptyExtents : public SizedExtentHopBase {
         virtual int numDocs() const { return 2; }
-        virtual int numHops() const { return 1; }
+        virtual int maxHops() const { return 1; }
         virtual BSONArray extentSizes() const {
             return BSON_ARRAY( fitsOne() << tooSmall() << tooSmall() << fitsOne() );
         }
@@ -282,7 +284,7 @@ namespace OplogStartTests {
      */
     class OplogStartTwoFullExtents : public SizedExtentHopBase {
         virtual int numDocs() const { return 10; }
-        virtual int numHops() const { return 1; }
+        virtual int maxHops() const { return 1; }
         virtual BSONArray extentSizes() const {
             return BSON_ARRAY( fitsMany() << fitsMany() );
         }
@@ -295,7 +297,7 @@ namespace OplogStartTests {
      */
     class OplogStartThreeFullOneEmpty : public SizedExtentHopBase {
         virtual int numDocs() const { return 14; }
-        virtual int numHops() const { return 2; }
+        virtual int maxHops() const { return 2; }
         virtual BSONArray extentSizes() const {
             return BSON_ARRAY( fitsMany() << fitsMany() << tooSmall() << fitsMany() );
         }
@@ -307,7 +309,7 @@ namespace OplogStartTests {
      */
     class OplogStartOneFullExtent : public SizedExtentHopBase {
         virtual int numDocs() const { return 4; }
-        virtual int numHops() const { return 0; }
+        virtual int maxHops() const { return 0; }
         virtual BSONArray extentSizes() const {
             return BSON_ARRAY( fitsMany() );
         }
@@ -321,7 +323,7 @@ namespace OplogStartTests {
      */
     class OplogStartFirstExtentEmpty : public SizedExtentHopBase {
         virtual int numDocs() const { return 2; }
-        virtual int numHops() const { return 1; }
+        virtual int maxHops() const { return 1; }
         virtual BSONArray extentSizes() const {
             return BSON_ARRAY( tooSmall() << fitsOne() << fitsOne() );
         }
@@ -338,7 +340,7 @@ namespace OplogStartTests {
      */
      class OplogStartEOF : public SizedExtentHopBase {
         virtual int numDocs() const { return 2; }
-        virtual int numHops() const { return 2; }
+        virtual int maxHops() const { return 2; }
         virtual BSONArray extentSizes() const {
             return BSON_ARRAY( fitsOne() << fitsOne() );
         }
@@ -346,6 +348,23 @@ namespace OplogStartTests {
         virtual int tsGte() const { return 0; }
      };
 
+    /**
+     * Sixteen extents of one document each.  Hopping back one extent at a time would take
+     * thirteen steps; the binary search takes O(log n).
+     */
+    class OplogStartManyExtents : public SizedExtentHopBase {
+        virtual int numDocs() const { return 16; }
+        virtual int maxHops() const { return 5; }
+        virtual BSONArray extentSizes() const {
+            BSONArrayBuilder sizes;
+            for (int i = 0; i < numDocs(); i++) {
+                sizes.append(fitsOne());
+            }
+            return sizes.arr();
+        }
+        virtual int tsGte() const { return 3; }
+    };
+
     class All : public Suite {
     public:
         All() : Suite("oplogstart") { }
@@ -361,6 +380,7 @@ namespace OplogStartTests {
             add< OplogStartOneFullExtent >();
             add< OplogStartFirstExtentEmpty >();
             add< OplogStartEOF >();
+            add< OplogStartManyExtents >();
         }
     } oplogStart;
 
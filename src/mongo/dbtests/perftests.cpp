@@ -40,12 +40,19 @@
 #include <boost/thread/thread.hpp>
 #include <fstream>
 
+#include "mongo/bson/bson_validate.h"
 #include "mongo/db/db.h"
 #include "mongo/db/dur_stats.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_computed_data.h"
+#include "mongo/db/fts/fts_spec.h"
 #include "mongo/db/instance.h"
+#include "mongo/db/interrupt_status_mongod.h"
 #include "mongo/db/json.h"
 #include "mongo/db/key.h"
 #include "mongo/db/lasterror.h"
+#include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/taskqueue.h"
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/dbtests/framework_options.h"
@@ -485,6 +492,113 @@ namespace PerfTests {
         }
     };
 
+    /** the objcheck validation run on each inbound insert */
+    class BSONValidate : public NonDurTest {
+    public:
+        int n;
+        bo b;
+        string name() { return "BSONValidate"; }
+        BSONValidate() {
+            n = 0;
+            bo sub = bob().appendTimeT("t", time(0)).appendBool("abool", true).appendBinData("somebin", 3, BinDataGeneral, "abc").appendNull("anullone").obj();
+            b = BSON( "_id" << OID() << "x" << 3 << "yaaaaaa" << 3.00009 << "zz" << 1 << "q" << false << "obj" << sub << "zzzzzzz" << "a string a string" << "arr" << BSON_ARRAY( sub << sub << 1 << "b" ) << "a_somewhat_longer_field_name" << 4 );
+        }
+        void timed() {
+            if( validateBSON(b.objdata(), b.objsize()).isOK() )
+                n++;
+        }
+    };
+
+    /** $group over 10000 documents in 1000 groups, with two accumulators */
+    class AggregateGroup : public NonDurTest {
+    public:
+        int n;
+        BSONObj docs;
+        BSONObj spec;
+        intrusive_ptr<ExpressionContext> ctx;
+        string name() { return "AggregateGroup"; }
+        virtual int howLongMillis() { return 3000; }
+        AggregateGroup() : n(0) {
+            BSONArrayBuilder arr;
+            for( int i = 0; i < 10000; i++ ) {
+                arr.append( BSON( "_id" << i << "k" << i % 1000 << "x" << i ) );
+            }
+            docs = arr.obj();
+            spec = fromjson( "{$group: {_id: '$k', total: {$sum: '$x'}, n: {$sum: 1}}}" );
+            ctx = new ExpressionContext( InterruptStatusMongod::status,
+                                         NamespaceString( "perftest.group" ) );
+        }
+        void timed() {
+            intrusive_ptr<DocumentSource> source = DocumentSourceBsonArray::create( docs, ctx );
+            intrusive_ptr<DocumentSource> group =
+                DocumentSourceGroup::createFromBson( spec.firstElement(), ctx );
+            group->setSource( source.get() );
+            while( group->getNext() )
+                n++;
+        }
+    };
+
+    /** Evaluating field paths, top level and nested, against a document with many fields */
+    class AggregateFieldPath : public NonDurTest {
+    public:
+        int n;
+        Document doc;
+        scoped_ptr<Variables> vars;
+        intrusive_ptr<Expression> topLevel;
+        intrusive_ptr<Expression> nested;
+        string name() { return "AggregateFieldPath"; }
+        virtual int howLongMillis() { return 3000; }
+        AggregateFieldPath() : n(0) {
+            BSONObjBuilder inner;
+            for( int i = 0; i < 10; i++ ) {
+                inner.append( string( str::stream() << "inner" << i ), i );
+            }
+            BSONObjBuilder outer;
+            for( int i = 0; i < 12; i++ ) {
+                outer.append( string( str::stream() << "field" << i ), i );
+            }
+            outer.append( "sub", inner.obj() );
+            doc = Document( outer.obj() );
+
+            VariablesIdGenerator idGenerator;
+            VariablesParseState vps( &idGenerator );
+            topLevel = ExpressionFieldPath::parse( "$field9", vps );
+            nested = ExpressionFieldPath::parse( "$sub.inner5", vps );
+            vars.reset( new Variables( idGenerator.getIdCount(), doc ) );
+        }
+        void timed() {
+            n += topLevel->evaluate( vars.get() ).getInt();
+            n += nested->evaluate( vars.get() ).getInt();
+        }
+    };
+
+    /** Scoring a document's text for a text index, as each insert into one does. */
+    class FTSScoreDocument : public NonDurTest {
+    public:
+        size_t n;
+        fts::FTSSpec spec;
+        BSONObj doc;
+        string name() { return "FTSScoreDocument"; }
+        FTSScoreDocument()
+            : n(0),
+              spec(fts::FTSSpec::fixSpec(BSON("key" << BSON("title" << "text"
+                                                                << "body" << "text")))) {
+            const char* words[] = { "the", "running", "walked", "database", "indexes", "quickly",
+                                    "brown", "foxes", "jumping", "over", "lazy", "dogs" };
+            const size_t numWords = sizeof(words) / sizeof(words[0]);
+            StringBuilder body;
+            for( size_t i = 0; i < 200; i++ ) {
+                body << words[(i * 7) % numWords] << ( i % 10 == 9 ? ". " : " " );
+            }
+            doc = BSON("title" << "Running Quickly" << "body" << body.str());
+        }
+        void timed() {
+            fts::TermFrequencyMap terms;
+            spec.scoreDocument(doc, spec.defaultLanguage(), "", false, &terms);
+            n += terms.size();
+        }
+    };
+
     class KeyTest : public B {
     public:
         KeyV1Owned a,b,c;
@@ -502,6 +616,79 @@ namespace PerfTests {
         }
     };
 
+    /** woCompare of keys that share their leading elements, the common case in a btree */
+    template< int Kind >
+    class KeyCompare : public B {
+    public:
+        KeyV1Owned a,b;
+        Ordering o;
+        int n;
+        string name() {
+            switch( Kind ) {
+            case 0: return "Key-wocompare-int";
+            case 1: return "Key-wocompare-string";
+            default: return "Key-wocompare-oid";
+            }
+        }
+        virtual int howLongMillis() { return 3000; }
+        KeyCompare() : a(make(1)), b(make(2)), o(Ordering::make(BSONObj())), n(0) { }
+        virtual bool showDurStats() { return false; }
+        void timed() {
+            if( a.woCompare(b, o) < 0 )
+                n++;
+            if( b.woCompare(a, o) > 0 )
+                n++;
+        }
+    private:
+        static BSONObj make(int last) {
+            OID oid;
+            oid.init("52a1c87e1e0f283cda3b3c8c");
+            BSONObjBuilder bb;
+            switch( Kind ) {
+            case 0: bb.append("a", 12345).append("b", 67890).append("c", 3); break;
+            case 1: bb.append("a", "customer/region/emea").append("b", "status/active"); break;
+            default: bb.append("a", oid).append("b", oid); break;
+            }
+            bb.append("z", last);
+            return bb.obj();
+        }
+    };
+
+    /**
+     * A working set's life under a stage that buffers: a batch of results with index key
+     * metadata is allocated, then all of it freed.  Reports how many heap allocations the
+     * working set caused per result.
+     */
+    class WorkingSetCycle : public B {
+    public:
+        WorkingSetCycle() : key(BSON("" << 1 << "" << "abc")), results(0) { }
+        string name() { return "WorkingSet-allocate-free"; }
+        virtual int howLongMillis() { return 3000; }
+        virtual bool showDurStats() { return false; }
+        void timed() {
+            WorkingSetID ids[Results];
+            for( int i = 0; i < Results; i++ ) {
+                ids[i] = ws.allocate();
+                WorkingSetMember* member = ws.get(ids[i]);
+                member->state = WorkingSetMember::OWNED_OBJ;
+                member->obj = key;
+                member->addComputed(makeComputed<IndexKeyComputedData>(&ws, key));
+            }
+            for( int i = 0; i < Results; i++ )
+                ws.free(ids[i]);
+            results += Results;
+        }
+        void post() {
+            cout << "      working set allocations per result: "
+                 << ((double)ws.allocations()) / results << endl;
+        }
+    private:
+        static const int Results = 100;
+        WorkingSet ws;
+        BSONObj key;
+        unsigned long long results;
+    };
+
     unsigned long long aaa;
 
     class Timer : public B {
@@ -1417,11 +1604,19 @@ namespace PerfTests {
                 add< CTM >();
                 add< CTMicros >();
                 add< KeyTest >();
+                add< KeyCompare<0> >();
+                add< KeyCompare<1> >();
+                add< KeyCompare<2> >();
+                add< WorkingSetCycle >();
                 add< Bldr >();
                 add< StkBldr >();
                 add< BSONIter >();
                 add< BSONGetFields1 >();
                 add< BSONGetFields2 >();
+                add< BSONValidate >();
+                add< AggregateGroup >();
+                add< AggregateFieldPath >();
+                add< FTSScoreDocument >();
                 //add< TaskQueueTest >();
                 add< InsertDup >();
                 add< Insert1 >();
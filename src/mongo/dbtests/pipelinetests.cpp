@@ -235,6 +235,109 @@ namespace PipelineTests {
     namespace Optimizations {
         using namespace mongo;
 
+        namespace Local {
+            class Base {
+            public:
+                // These return json arrays of pipeline operators
+                virtual string inputPipeJson() = 0;
+                virtual string outputPipeJson() = 0;
+
+                BSONObj pipelineFromJsonArray(const string& array) {
+                    return fromjson("{pipeline: " + array + "}");
+                }
+                virtual void run() {
+                    const BSONObj inputBson = pipelineFromJsonArray(inputPipeJson());
+                    const BSONObj outputPipeExpected = pipelineFromJsonArray(outputPipeJson());
+
+                    intrusive_ptr<ExpressionContext> ctx =
+                        new ExpressionContext(InterruptStatusMongod::status,
+                                              NamespaceString("a.collection"));
+                    string errmsg;
+                    intrusive_ptr<Pipeline> outputPipe =
+                        Pipeline::parseCommand(errmsg, inputBson, ctx);
+                    ASSERT_EQUALS(errmsg, "");
+                    ASSERT(outputPipe != NULL);
+
+                    ASSERT_EQUALS(outputPipe->serialize()["pipeline"],
+                                  Value(outputPipeExpected["pipeline"]));
+                }
+
+                virtual ~Base() {};
+            };
+
+            namespace moveMatchEarlier {
+
+                class BeforeSort : public Base {
+                    string inputPipeJson() { return "[{$sort: {b: 1}}, {$match: {a: 1}}]"; }
+                    string outputPipeJson() { return "[{$match: {a: 1}}, {$sort: {b: 1}}]"; }
+                };
+
+                class BeforeProject : public Base {
+                    string inputPipeJson() {
+                        return "[{$project: {a: true, b: true}}, {$match: {a: 1, _id: 2}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$match: {a: 1, _id: 2}}, {$project: {a: true, b: true}}]";
+                    }
+                };
+
+                class NotBeforeComputedField : public Base {
+                    string inputPipeJson() { return "[{$project: {a: '$b'}}, {$match: {a: 1}}]"; }
+                    string outputPipeJson() { return "[{$project: {a: '$b'}}, {$match: {a: 1}}]"; }
+                };
+
+                class NotBeforeNestedInclusion : public Base {
+                    string inputPipeJson() {
+                        return "[{$project: {a: {b: true}}}, {$match: {'a.b': 1}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$project: {a: {b: true}}}, {$match: {'a.b': 1}}]";
+                    }
+                };
+
+                class NotBeforeExcludedId : public Base {
+                    string inputPipeJson() {
+                        return "[{$project: {_id: false, a: true}}, {$match: {_id: 1}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$project: {_id: false, a: true}}, {$match: {_id: 1}}]";
+                    }
+                };
+
+                class BeforeUnwind : public Base {
+                    string inputPipeJson() { return "[{$unwind: '$a'}, {$match: {ab: 1}}]"; }
+                    string outputPipeJson() { return "[{$match: {ab: 1}}, {$unwind: '$a'}]"; }
+                };
+
+                class NotBeforeUnwindOfSameField : public Base {
+                    string inputPipeJson() { return "[{$unwind: '$a'}, {$match: {'a.b': 1}}]"; }
+                    string outputPipeJson() { return "[{$unwind: '$a'}, {$match: {'a.b': 1}}]"; }
+                };
+
+                class PastSeveralStages : public Base {
+                    string inputPipeJson() {
+                        return "[{$unwind: '$a'}, {$sort: {b: 1}}, {$project: {a: true, b: true}},"
+                               " {$match: {$or: [{b: 1}, {b: 2}]}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$match: {$or: [{b: 1}, {b: 2}]}}, {$unwind: '$a'},"
+                               " {$sort: {b: 1}}, {$project: {a: true, b: true}}]";
+                    }
+                };
+
+                class StopsAtFieldInOr : public Base {
+                    string inputPipeJson() {
+                        return "[{$project: {b: true}}, {$unwind: '$a'},"
+                               " {$match: {$or: [{b: 1}, {a: 2}]}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$project: {b: true}}, {$unwind: '$a'},"
+                               " {$match: {$or: [{b: 1}, {a: 2}]}}]";
+                    }
+                };
+            } // namespace moveMatchEarlier
+        } // namespace Local
+
         namespace Sharded {
             class Base {
             public:
@@ -333,6 +436,15 @@ namespace PipelineTests {
             add<FieldPath::Tail>();
             add<FieldPath::TailThreeFields>();
 
+            add<Optimizations::Local::moveMatchEarlier::BeforeSort>();
+            add<Optimizations::Local::moveMatchEarlier::BeforeProject>();
+            add<Optimizations::Local::moveMatchEarlier::NotBeforeComputedField>();
+            add<Optimizations::Local::moveMatchEarlier::NotBeforeNestedInclusion>();
+            add<Optimizations::Local::moveMatchEarlier::NotBeforeExcludedId>();
+            add<Optimizations::Local::moveMatchEarlier::BeforeUnwind>();
+            add<Optimizations::Local::moveMatchEarlier::NotBeforeUnwindOfSameField>();
+            add<Optimizations::Local::moveMatchEarlier::PastSeveralStages>();
+            add<Optimizations::Local::moveMatchEarlier::StopsAtFieldInOr>();
             add<Optimizations::Sharded::Empty>();
             add<Optimizations::Sharded::moveFinalUnwindFromShardsToMerger::OneUnwind>();
             add<Optimizations::Sharded::moveFinalUnwindFromShardsToMerger::TwoUnwind>();
@@ -141,12 +141,118 @@ namespace QueryMultiPlanRunner {
         }
     };
 
+    // A wide set of candidates: one selective index scan and many collection scans that each
+    // produce a result only every tenth work.  The collection scans are dropped early and the
+    // index scan still wins with all of its results.
+    class MPREliminatesClearLosers : public MultiPlanRunnerBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+
+            const int N = 5000;
+            for (int i = 0; i < N; ++i) {
+                insert(BSON("foo" << (i % 10)));
+            }
+
+            addIndex(BSON("foo" << 1));
+
+            CanonicalQuery* cq = NULL;
+            verify(CanonicalQuery::canonicalize(ns(), BSON("foo" << 7), &cq).isOK());
+            verify(NULL != cq);
+            MultiPlanRunner mpr(cq);
+
+            IndexScanParams ixparams;
+            ixparams.descriptor = getIndex(BSON("foo" << 1));
+            ixparams.bounds.isSimpleRange = true;
+            ixparams.bounds.startKey = BSON("" << 7);
+            ixparams.bounds.endKey = BSON("" << 7);
+            ixparams.bounds.endKeyInclusive = true;
+            ixparams.direction = 1;
+            WorkingSet* ixWs = new WorkingSet();
+            IndexScan* ix = new IndexScan(ixparams, ixWs, NULL);
+            mpr.addPlan(new QuerySolution(), new FetchStage(ixWs, ix, NULL), ixWs);
+
+            BSONObj filterObj = BSON("foo" << 7);
+            StatusWithMatchExpression swme = MatchExpressionParser::parse(filterObj);
+            verify(swme.isOK());
+            auto_ptr<MatchExpression> filter(swme.getValue());
+
+            const size_t numCollScans = 10;
+            for (size_t i = 0; i < numCollScans; ++i) {
+                CollectionScanParams csparams;
+                csparams.ns = ns();
+                csparams.direction = CollectionScanParams::FORWARD;
+                WorkingSet* ws = new WorkingSet();
+                mpr.addPlan(new QuerySolution(), new CollectionScan(csparams, ws, filter.get()),
+                            ws);
+            }
+
+            size_t best;
+            ASSERT(mpr.pickBestPlan(&best));
+            ASSERT_EQUALS(size_t(0), best);
+            ASSERT_EQUALS(numCollScans, mpr.numEliminated());
+
+            int results = 0;
+            BSONObj obj;
+            while (Runner::RUNNER_ADVANCED == mpr.getNext(&obj, NULL)) {
+                ASSERT_EQUALS(obj["foo"].numberInt(), 7);
+                ++results;
+            }
+            ASSERT_EQUALS(results, N / 10);
+        }
+    };
+
+    // Candidates that do equally well are all kept until the end of the trial.
+    class MPRKeepsCloseCandidates : public MultiPlanRunnerBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+
+            const int N = 5000;
+            for (int i = 0; i < N; ++i) {
+                insert(BSON("foo" << (i % 10)));
+            }
+
+            CanonicalQuery* cq = NULL;
+            verify(CanonicalQuery::canonicalize(ns(), BSON("foo" << 7), &cq).isOK());
+            verify(NULL != cq);
+            MultiPlanRunner mpr(cq);
+
+            BSONObj filterObj = BSON("foo" << 7);
+            StatusWithMatchExpression swme = MatchExpressionParser::parse(filterObj);
+            verify(swme.isOK());
+            auto_ptr<MatchExpression> filter(swme.getValue());
+
+            for (size_t i = 0; i < 3; ++i) {
+                CollectionScanParams csparams;
+                csparams.ns = ns();
+                csparams.direction = CollectionScanParams::FORWARD;
+                WorkingSet* ws = new WorkingSet();
+                mpr.addPlan(new QuerySolution(), new CollectionScan(csparams, ws, filter.get()),
+                            ws);
+            }
+
+            size_t best;
+            ASSERT(mpr.pickBestPlan(&best));
+            ASSERT_EQUALS(size_t(0), mpr.numEliminated());
+
+            int results = 0;
+            BSONObj obj;
+            while (Runner::RUNNER_ADVANCED == mpr.getNext(&obj, NULL)) {
+                ++results;
+            }
+            ASSERT_EQUALS(results, N / 10);
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "query_multi_plan_runner" ) { }
 
         void setupTests() {
             add<MPRCollectionScanVsHighlySelectiveIXScan>();
+            add<MPREliminatesClearLosers>();
+            add<MPRKeepsCloseCandidates>();
         }
     }  queryMultiPlanRunnerAll;
 
@@ -400,6 +400,82 @@ namespace QueryStageAnd {
         }
     };
 
+    /**
+     * With next to no memory the first child's results are kept as DiskLocs.  The AND comes out
+     * the same, with the documents standing in for the index data.
+     */
+    class QueryStageAndHashSpill : public QueryStageAndBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+
+            for (int i = 0; i < 50; ++i) {
+                insert(BSON("foo" << i << "bar" << i << "baz" << i));
+            }
+
+            addIndex(BSON("foo" << 1));
+            addIndex(BSON("bar" << 1));
+            addIndex(BSON("baz" << 1));
+
+            WorkingSet ws;
+            BSONObj filter = BSON("baz" << BSON("$ne" << 30));
+            StatusWithMatchExpression swme = MatchExpressionParser::parse(filter);
+            verify(swme.isOK());
+            auto_ptr<MatchExpression> filterExpr(swme.getValue());
+            scoped_ptr<AndHashStage> ah(new AndHashStage(&ws, filterExpr.get(), 1));
+
+            // foo <= 40
+            IndexScanParams params;
+            params.descriptor = getIndex(BSON("foo" << 1), coll);
+            params.bounds.isSimpleRange = true;
+            params.bounds.startKey = BSON("" << 40);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = -1;
+            ah->addChild(new IndexScan(params, &ws, NULL));
+
+            // bar >= 20
+            params.descriptor = getIndex(BSON("bar" << 1), coll);
+            params.bounds.startKey = BSON("" << 20);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = 1;
+            ah->addChild(new IndexScan(params, &ws, NULL));
+
+            // baz >= 25
+            params.descriptor = getIndex(BSON("baz" << 1), coll);
+            params.bounds.startKey = BSON("" << 25);
+            ah->addChild(new IndexScan(params, &ws, NULL));
+
+            // 25 <= foo <= 40, but not 30.
+            int count = 0;
+            while (!ah->isEOF()) {
+                WorkingSetID id;
+                PlanStage::StageState status = ah->work(&id);
+                if (PlanStage::ADVANCED != status) { continue; }
+                WorkingSetMember* member = ws.get(id);
+                int foo = member->loc.obj()["foo"].numberInt();
+                ASSERT_GREATER_THAN_OR_EQUALS(foo, 25);
+                ASSERT_LESS_THAN_OR_EQUALS(foo, 40);
+                ASSERT_NOT_EQUALS(foo, 30);
+                ws.free(id);
+                ++count;
+            }
+            ASSERT_EQUALS(15, count);
+
+            scoped_ptr<PlanStageStats> stats(ah->getStats());
+            const AndHashStats* ahStats = static_cast<const AndHashStats*>(stats->specific.get());
+            ASSERT_EQUALS(40U, ahStats->spilled);
+            ASSERT_EQUALS(30U + 25U, ahStats->probes);
+            ASSERT_EQUALS(21U + 16U, ahStats->probeHits);
+        }
+    };
+
     //
     // Sorted AND tests
     //
@@ -720,6 +796,7 @@ namespace QueryStageAnd {
             add<QueryStageAndHashWithNothing>();
             add<QueryStageAndHashProducesNothing>();
             add<QueryStageAndHashWithMatcher>();
+            add<QueryStageAndHashSpill>();
             add<QueryStageAndSortedInvalidation>();
             add<QueryStageAndSortedThreeLeaf>();
             add<QueryStageAndSortedWithNothing>();
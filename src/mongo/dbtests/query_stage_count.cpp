@@ -0,0 +1,242 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+/**
+ * This file tests db/exec/count.cpp
+ */
+
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/db/database.h"
+#include "mongo/db/exec/count.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/json.h"
+#include "mongo/db/query/index_bounds_builder.h"
+#include "mongo/db/structure/collection.h"
+#include "mongo/dbtests/dbtests.h"
+
+namespace QueryStageCount {
+
+    class CountBase {
+    public:
+        CountBase() { }
+
+        virtual ~CountBase() {
+            Client::WriteContext ctx(ns());
+            _client.dropCollection(ns());
+        }
+
+        void addIndex(const BSONObj& obj) {
+            _client.ensureIndex(ns(), obj);
+        }
+
+        void insert(const BSONObj& obj) {
+            _client.insert(ns(), obj);
+        }
+
+        void remove(const BSONObj& obj) {
+            _client.remove(ns(), obj);
+        }
+
+        IndexDescriptor* getIndex(Database* db, const BSONObj& obj) {
+            Collection* collection = db->getCollection(ns());
+            int idxNo = collection->details()->findIndexByKeyPattern(obj);
+            return collection->getIndexCatalog()->getDescriptor(idxNo);
+        }
+
+        static IndexKeyRange makeRange(const BSONObj& start, bool startInclusive,
+                                       const BSONObj& end, bool endInclusive) {
+            IndexKeyRange range;
+            range.startKey = start;
+            range.startKeyInclusive = startInclusive;
+            range.endKey = end;
+            range.endKeyInclusive = endInclusive;
+            return range;
+        }
+
+        /** work 'count' until it's EOF, yielding every 'yieldEvery' results if non-zero */
+        static int runCount(Count* count, int yieldEvery = 0) {
+            int n = 0;
+            while (!count->isEOF()) {
+                WorkingSetID id;
+                PlanStage::StageState state = count->work(&id);
+                if (PlanStage::ADVANCED == state) {
+                    ASSERT_EQUALS(WorkingSet::INVALID_ID, id);
+                    ++n;
+                    if (yieldEvery > 0 && 0 == n % yieldEvery) {
+                        count->prepareToYield();
+                        count->recoverFromYield();
+                    }
+                }
+            }
+            return n;
+        }
+
+        static const char* ns() { return "unittests.QueryStageCount"; }
+
+    protected:
+        static DBDirectClient _client;
+    };
+
+    DBDirectClient CountBase::_client;
+
+    /**
+     * Inclusive and exclusive ends of a single range.
+     */
+    class QueryStageCountSingleRange : public CountBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            for (int i = 0; i < 100; ++i) {
+                // Two of each.
+                insert(BSON("a" << i / 2));
+            }
+            addIndex(BSON("a" << 1));
+
+            CountParams params;
+            params.descriptor = getIndex(ctx.ctx().db(), BSON("a" << 1));
+
+            // [10, 20]
+            params.ranges.push_back(makeRange(BSON("" << 10), true, BSON("" << 20), true));
+            {
+                Count count(params);
+                ASSERT_EQUALS(22, runCount(&count));
+            }
+
+            // (10, 20)
+            params.ranges[0] = makeRange(BSON("" << 10), false, BSON("" << 20), false);
+            {
+                Count count(params);
+                ASSERT_EQUALS(18, runCount(&count));
+            }
+
+            // Past the end of the index.
+            params.ranges[0] = makeRange(BSON("" << 45), true, BSON("" << 1000), true);
+            {
+                Count count(params);
+                ASSERT_EQUALS(10, runCount(&count, 3));
+            }
+
+            // Nothing there.
+            params.ranges[0] = makeRange(BSON("" << 10.5), true, BSON("" << 10.7), true);
+            {
+                Count count(params);
+                ASSERT_EQUALS(0, runCount(&count));
+            }
+        }
+    };
+
+    /**
+     * Several ranges over a multikey compound index count each document once.
+     */
+    class QueryStageCountRangesMultiKey : public CountBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            for (int i = 0; i < 50; ++i) {
+                insert(BSON("a" << (i % 5) << "b" << BSON_ARRAY(i << i + 1 << i + 2)));
+            }
+            addIndex(BSON("a" << 1 << "b" << 1));
+
+            // a in [1, 3], b > 10
+            OrderedIntervalList aList("a");
+            aList.intervals.push_back(IndexBoundsBuilder::makePointInterval(BSON("" << 1)));
+            aList.intervals.push_back(IndexBoundsBuilder::makePointInterval(BSON("" << 3)));
+            OrderedIntervalList bList("b");
+            bList.intervals.push_back(IndexBoundsBuilder::makeRangeInterval(
+                BSON("" << 10 << "" << MAXKEY), false, true));
+            IndexBounds bounds;
+            bounds.fields.push_back(aList);
+            bounds.fields.push_back(bList);
+
+            CountParams params;
+            params.descriptor = getIndex(ctx.ctx().db(), BSON("a" << 1 << "b" << 1));
+            params.isMultiKey = true;
+            ASSERT(bounds.toKeyRanges(10, &params.ranges));
+            ASSERT_EQUALS(2U, params.ranges.size());
+
+            int expected = 0;
+            for (int i = 0; i < 50; ++i) {
+                if ((i % 5 == 1 || i % 5 == 3) && i + 2 > 10) {
+                    ++expected;
+                }
+            }
+
+            Count count(params);
+            ASSERT_EQUALS(expected, runCount(&count, 7));
+        }
+    };
+
+    /**
+     * Keys removed while the count is yielded, including the one it is on, aren't counted.
+     */
+    class QueryStageCountRemoveDuringYield : public CountBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            for (int i = 0; i < 100; ++i) {
+                insert(BSON("a" << i));
+            }
+            addIndex(BSON("a" << 1));
+
+            CountParams params;
+            params.descriptor = getIndex(ctx.ctx().db(), BSON("a" << 1));
+            params.ranges.push_back(makeRange(BSON("" << 0), true, BSON("" << 49), true));
+
+            Count count(params);
+            int n = 0;
+            WorkingSetID id;
+            while (n < 10) {
+                if (PlanStage::ADVANCED == count.work(&id)) {
+                    ++n;
+                }
+            }
+
+            // The count is on a = 10 now.  Take out 10 through 19 and the end of the range.
+            count.prepareToYield();
+            remove(BSON("a" << BSON("$gte" << 10 << "$lt" << 20)));
+            remove(BSON("a" << 49));
+            count.recoverFromYield();
+
+            ASSERT_EQUALS(10 + 29, n + runCount(&count));
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite("query_stage_count") { }
+
+        void setupTests() {
+            add<QueryStageCountSingleRange>();
+            add<QueryStageCountRangesMultiKey>();
+            add<QueryStageCountRemoveDuringYield>();
+        }
+    } queryStageCountAll;
+
+}  // namespace QueryStageCount
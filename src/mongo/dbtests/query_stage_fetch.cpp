@@ -35,6 +35,7 @@
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/database.h"
 #include "mongo/db/exec/fetch.h"
+#include "mongo/db/exec/index_scan.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/exec/mock_stage.h"
 #include "mongo/db/instance.h"
@@ -76,6 +77,29 @@ namespace QueryStageFetch {
             _client.remove(ns(), obj);
         }
 
+        void addIndex(const BSONObj& obj) {
+            _client.ensureIndex(ns(), obj);
+        }
+
+        IndexDescriptor* getIndex(const BSONObj& obj, Collection* coll) {
+            int idxNo = coll->details()->findIndexByKeyPattern(obj);
+            return coll->getIndexCatalog()->getDescriptor(idxNo);
+        }
+
+        DiskLoc locOf(int foo, Collection* coll) {
+            CollectionIterator* it = coll->getIterator(DiskLoc(), false,
+                                                       CollectionScanParams::FORWARD);
+            DiskLoc found;
+            while (!it->isEOF()) {
+                DiskLoc nextLoc = it->getNext();
+                if (foo == nextLoc.obj()["foo"].numberInt()) {
+                    found = nextLoc;
+                }
+            }
+            delete it;
+            return found;
+        }
+
         static const char* ns() { return "unittests.QueryStageFetch"; }
 
     private:
@@ -427,6 +451,158 @@ namespace QueryStageFetch {
         }
     };
 
+    //
+    // Test that a fetch told which fields are wanted passes up an owned object with only those
+    // fields, after the filter has seen the whole document.
+    //
+    class FetchStageFields : public QueryStageFetchBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+            WorkingSet ws;
+
+            insert(BSON("_id" << 1 << "a" << 2 << "big" << string(1000, 'x') << "c" << 3));
+            set<DiskLoc> locs;
+            getLocs(&locs, coll);
+            ASSERT_EQUALS(size_t(1), locs.size());
+
+            auto_ptr<MockStage> mockStage(new MockStage(&ws));
+            {
+                WorkingSetMember mockMember;
+                mockMember.state = WorkingSetMember::LOC_AND_IDX;
+                mockMember.loc = *locs.begin();
+                mockStage->pushBack(mockMember);
+            }
+
+            // The filter is over a field that isn't kept.
+            BSONObj filterObj = BSON("big" << BSON("$exists" << true));
+            StatusWithMatchExpression swme = MatchExpressionParser::parse(filterObj);
+            verify(swme.isOK());
+            auto_ptr<MatchExpression> filterExpr(swme.getValue());
+
+            vector<string> fields;
+            fields.push_back("c");
+            fields.push_back("a");
+            auto_ptr<FetchStage> fetchStage(new FetchStage(&ws, mockStage.release(),
+                                                           filterExpr.get(), fields));
+
+            FailPointRegistry* reg = getGlobalFailPointRegistry();
+            FailPoint* fetchInMemorySucceed = reg->getFailPoint("fetchInMemorySucceed");
+            fetchInMemorySucceed->setMode(FailPoint::alwaysOn);
+
+            WorkingSetID id;
+            ASSERT_EQUALS(PlanStage::ADVANCED, fetchStage->work(&id));
+
+            // The document's order is kept, not the order the fields were asked for in.
+            WorkingSetMember* member = ws.get(id);
+            ASSERT_EQUALS(WorkingSetMember::OWNED_OBJ, member->state);
+            ASSERT_FALSE(member->hasLoc());
+            ASSERT(member->obj.isOwned());
+            ASSERT_EQUALS(BSON("a" << 2 << "c" << 3), member->obj);
+
+            ASSERT_EQUALS(PlanStage::IS_EOF, fetchStage->work(&id));
+
+            fetchInMemorySucceed->setMode(FailPoint::off);
+        }
+    };
+
+    //
+    // Test that a batch stops at a record that isn't in memory and asks for it on its own, and
+    // that the rest of the child's batch is held on to across the fetch.
+    //
+    class FetchStageBatch : public QueryStageFetchBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+            WorkingSet ws;
+
+            for (int i = 0; i < 10; ++i) {
+                insert(BSON("foo" << i));
+            }
+            addIndex(BSON("foo" << 1));
+
+            IndexScanParams params;
+            params.descriptor = getIndex(BSON("foo" << 1), coll);
+            params.bounds.isSimpleRange = true;
+            params.bounds.startKey = BSON("" << 0);
+            params.bounds.endKey = BSON("" << 100);
+            params.bounds.endKeyInclusive = true;
+            params.direction = 1;
+
+            auto_ptr<FetchStage> fetchStage(new FetchStage(&ws, new IndexScan(params, &ws, NULL),
+                                                           NULL));
+            ASSERT_TRUE(fetchStage->supportsBatch());
+
+            FailPointRegistry* reg = getGlobalFailPointRegistry();
+            FailPoint* fetchInMemoryFail = reg->getFailPoint("fetchInMemoryFail");
+            FailPoint* fetchInMemorySucceed = reg->getFailPoint("fetchInMemorySucceed");
+
+            // The first record isn't in memory, so that's all we get.
+            fetchInMemoryFail->setMode(FailPoint::alwaysOn);
+            vector<WorkingSetID> batch;
+            ASSERT_EQUALS(PlanStage::NEED_FETCH, fetchStage->workBatch(5, &batch));
+            ASSERT_EQUALS(size_t(1), batch.size());
+            ASSERT_FALSE(ws.get(batch[0])->hasObj());
+
+            // The fetched record and the other four from the index.
+            fetchInMemoryFail->setMode(FailPoint::off);
+            fetchInMemorySucceed->setMode(FailPoint::alwaysOn);
+            batch.clear();
+            ASSERT_EQUALS(PlanStage::ADVANCED, fetchStage->workBatch(5, &batch));
+            ASSERT_EQUALS(size_t(5), batch.size());
+            for (size_t i = 0; i < batch.size(); ++i) {
+                WorkingSetMember* member = ws.get(batch[i]);
+                ASSERT_EQUALS(WorkingSetMember::LOC_AND_UNOWNED_OBJ, member->state);
+                ASSERT_EQUALS(int(i), member->obj["foo"].numberInt());
+                ws.free(batch[i]);
+            }
+
+            // Ask for a fetch of foo 5, leaving 6 to 9 from the index pending.  Invalidating
+            // one of those has to keep its object.
+            fetchInMemorySucceed->setMode(FailPoint::off);
+            fetchInMemoryFail->setMode(FailPoint::alwaysOn);
+            batch.clear();
+            ASSERT_EQUALS(PlanStage::NEED_FETCH, fetchStage->workBatch(5, &batch));
+            ASSERT_EQUALS(size_t(1), batch.size());
+
+            fetchStage->prepareToYield();
+            fetchStage->invalidate(locOf(7, coll));
+            fetchStage->recoverFromYield();
+
+            fetchInMemoryFail->setMode(FailPoint::off);
+            fetchInMemorySucceed->setMode(FailPoint::alwaysOn);
+            batch.clear();
+            ASSERT_EQUALS(PlanStage::ADVANCED, fetchStage->workBatch(10, &batch));
+            ASSERT_EQUALS(size_t(5), batch.size());
+            for (size_t i = 0; i < batch.size(); ++i) {
+                WorkingSetMember* member = ws.get(batch[i]);
+                ASSERT_EQUALS(int(i + 5), member->obj["foo"].numberInt());
+                if (7 == i + 5) {
+                    ASSERT_EQUALS(WorkingSetMember::OWNED_OBJ, member->state);
+                }
+                else {
+                    ASSERT_EQUALS(WorkingSetMember::LOC_AND_UNOWNED_OBJ, member->state);
+                }
+            }
+
+            batch.clear();
+            ASSERT_EQUALS(PlanStage::IS_EOF, fetchStage->workBatch(10, &batch));
+            ASSERT_TRUE(batch.empty());
+
+            fetchInMemorySucceed->setMode(FailPoint::off);
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "query_stage_fetch" ) { }
@@ -437,6 +613,8 @@ namespace QueryStageFetch {
             add<FetchStageAlreadyFetched>();
             add<FetchStageInvalidation>();
             add<FetchStageFilter>();
+            add<FetchStageFields>();
+            add<FetchStageBatch>();
         }
     }  queryStageFetchAll;
 
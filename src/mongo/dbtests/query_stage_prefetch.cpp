@@ -0,0 +1,210 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file tests db/exec/prefetch.cpp.  It looks at records on disk so we cannot test outside
+ * of a dbtest.
+ */
+
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/db/database.h"
+#include "mongo/db/exec/mock_stage.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/exec/prefetch.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/structure/collection.h"
+#include "mongo/db/structure/collection_iterator.h"
+#include "mongo/dbtests/dbtests.h"
+#include "mongo/util/fail_point.h"
+#include "mongo/util/fail_point_registry.h"
+#include "mongo/util/fail_point_service.h"
+
+namespace QueryStagePrefetch {
+
+    class QueryStagePrefetchBase {
+    public:
+        QueryStagePrefetchBase() { }
+
+        virtual ~QueryStagePrefetchBase() {
+            _client.dropCollection(ns());
+        }
+
+        void insert(const BSONObj& obj) {
+            _client.insert(ns(), obj);
+        }
+
+        // In the order a collection scan sees them.
+        void getLocs(vector<DiskLoc>* out, Collection* coll) {
+            CollectionIterator* it = coll->getIterator(DiskLoc(), false,
+                                                       CollectionScanParams::FORWARD);
+            while (!it->isEOF()) {
+                out->push_back(it->getNext());
+            }
+            delete it;
+        }
+
+        MockStage* mockLocs(WorkingSet* ws, const vector<DiskLoc>& locs) {
+            MockStage* ms = new MockStage(ws);
+            for (size_t i = 0; i < locs.size(); ++i) {
+                WorkingSetMember member;
+                member.state = WorkingSetMember::LOC_AND_IDX;
+                member.loc = locs[i];
+                ms->pushBack(member);
+            }
+            return ms;
+        }
+
+        static const char* ns() { return "unittests.QueryStagePrefetch"; }
+
+    private:
+        static DBDirectClient _client;
+    };
+
+    DBDirectClient QueryStagePrefetchBase::_client;
+
+    //
+    // Test that cold records are held back until the lookahead is full, and that they come out
+    // in the order the child gave them.
+    //
+    class PrefetchStageLookahead : public QueryStagePrefetchBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+
+            for (int i = 0; i < 5; ++i) {
+                insert(BSON("foo" << i));
+            }
+            vector<DiskLoc> locs;
+            getLocs(&locs, coll);
+            ASSERT_EQUALS(size_t(5), locs.size());
+
+            WorkingSet ws;
+            auto_ptr<PrefetchStage> ps(new PrefetchStage(&ws, mockLocs(&ws, locs), coll, 3));
+
+            FailPointRegistry* reg = getGlobalFailPointRegistry();
+            FailPoint* notInMemory = reg->getFailPoint("prefetchRecordNotInMemory");
+            notInMemory->setMode(FailPoint::alwaysOn);
+
+            // The first two are held back while we read ahead.
+            WorkingSetID id;
+            ASSERT_EQUALS(PlanStage::NEED_TIME, ps->work(&id));
+            ASSERT_EQUALS(PlanStage::NEED_TIME, ps->work(&id));
+
+            // From then on we're full, so each call passes the oldest up.
+            for (size_t i = 0; i < locs.size(); ++i) {
+                ASSERT_EQUALS(PlanStage::ADVANCED, ps->work(&id));
+                WorkingSetMember* member = ws.get(id);
+                ASSERT_EQUALS(WorkingSetMember::LOC_AND_IDX, member->state);
+                ASSERT_EQUALS(locs[i], member->loc);
+            }
+
+            ASSERT_EQUALS(PlanStage::IS_EOF, ps->work(&id));
+
+            notInMemory->setMode(FailPoint::off);
+
+            auto_ptr<PlanStageStats> stats(ps->getStats());
+            const PrefetchStats* specific =
+                static_cast<const PrefetchStats*>(stats->specific.get());
+            ASSERT_EQUALS(uint64_t(5), specific->prefetched);
+            ASSERT_EQUALS(uint64_t(5), specific->notReady);
+        }
+    };
+
+    //
+    // Test that a held back result whose DiskLoc is invalidated is fetched before it goes away.
+    //
+    class PrefetchStageInvalidation : public QueryStagePrefetchBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+
+            for (int i = 0; i < 3; ++i) {
+                insert(BSON("foo" << i));
+            }
+            vector<DiskLoc> locs;
+            getLocs(&locs, coll);
+            ASSERT_EQUALS(size_t(3), locs.size());
+
+            WorkingSet ws;
+            auto_ptr<PrefetchStage> ps(new PrefetchStage(&ws, mockLocs(&ws, locs), coll, 10));
+
+            FailPointRegistry* reg = getGlobalFailPointRegistry();
+            FailPoint* notInMemory = reg->getFailPoint("prefetchRecordNotInMemory");
+            notInMemory->setMode(FailPoint::alwaysOn);
+
+            WorkingSetID id;
+            ASSERT_EQUALS(PlanStage::NEED_TIME, ps->work(&id));
+            ASSERT_EQUALS(PlanStage::NEED_TIME, ps->work(&id));
+
+            ps->prepareToYield();
+            ps->invalidate(locs[1]);
+            ps->recoverFromYield();
+
+            // Once the child is done everything held comes out, ready or not.
+            for (int i = 0; i < 3; ++i) {
+                PlanStage::StageState state = ps->work(&id);
+                while (PlanStage::NEED_TIME == state) {
+                    state = ps->work(&id);
+                }
+                ASSERT_EQUALS(PlanStage::ADVANCED, state);
+                WorkingSetMember* member = ws.get(id);
+                if (1 == i) {
+                    ASSERT_EQUALS(WorkingSetMember::OWNED_OBJ, member->state);
+                    ASSERT_EQUALS(1, member->obj["foo"].numberInt());
+                }
+                else {
+                    ASSERT_EQUALS(locs[i], member->loc);
+                }
+            }
+
+            ASSERT_EQUALS(PlanStage::IS_EOF, ps->work(&id));
+            notInMemory->setMode(FailPoint::off);
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite( "query_stage_prefetch" ) { }
+
+        void setupTests() {
+            add<PrefetchStageLookahead>();
+            add<PrefetchStageInvalidation>();
+        }
+    }  queryStagePrefetchAll;
+
+}  // namespace QueryStagePrefetch
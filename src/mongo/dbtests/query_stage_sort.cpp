@@ -118,6 +118,7 @@ namespace QueryStageSortTests {
             SortStageParams params;
             params.pattern = BSON("foo" << direction);
             params.limit = limit();
+            params.maxMemUsage = maxMemUsage();
 
             // Must fetch so we can look at the doc as a BSONObj.
             PlanExecutor runner(ws, new FetchStage(ws, new SortStage(params, ws, ms), NULL));
@@ -163,6 +164,9 @@ namespace QueryStageSortTests {
         // Leave as 0 to disable limit.
         virtual int limit() const { return 0; };
 
+        // How much the sort may buffer before it has to spill to disk.
+        virtual size_t maxMemUsage() const { return SortStageParams().maxMemUsage; }
+
 
         static const char* ns() { return "unittests.QueryStageSort"; }
     private:
@@ -234,6 +238,14 @@ namespace QueryStageSortTests {
         }
     };
 
+    // Sort more than fits in memory, so that the sort has to spill to disk to finish.
+    template <int LIMIT>
+    class QueryStageSortSpill : public QueryStageSortExt {
+    public:
+        virtual int limit() const { return LIMIT; }
+        virtual size_t maxMemUsage() const { return 16 * 1024; }
+    };
+
     // Invalidation of everything fed to sort.
     class QueryStageSortInvalidation : public QueryStageSortTestBase {
     public:
@@ -334,6 +346,8 @@ namespace QueryStageSortTests {
             // and a special case for limit == 1
             add<QueryStageSortDecWithLimit<1> >();
             add<QueryStageSortExt>();
+            add<QueryStageSortSpill<0> >();
+            add<QueryStageSortSpill<5000> >();
             add<QueryStageSortInvalidation>();
             add<QueryStageSortInvalidationWithLimit<10> >();
             add<QueryStageSortInvalidationWithLimit<1> >();
@@ -206,6 +206,58 @@ namespace QueryStageTests {
         }
     };
 
+    // Long enough a scan to walk runs of keys out of many buckets: every key comes back once, in
+    // order, both ways and across yields.
+    class QueryStageIXScanLongRange : public IndexScanBase {
+    public:
+        virtual ~QueryStageIXScanLongRange() { }
+
+        void run() {
+            const int nMore = 5000;
+            {
+                Client::WriteContext ctx(ns());
+                DBDirectClient client;
+                for (int i = numObj(); i < numObj() + nMore; ++i) {
+                    client.insert(ns(), BSON("foo" << i << "baz" << i << "bar" << 0));
+                }
+            }
+            const int n = numObj() + nMore;
+
+            for (int direction = -1; direction <= 1; direction += 2) {
+                IndexScanParams params;
+                params.descriptor = getIndex(BSON("foo" << 1));
+                params.bounds.isSimpleRange = true;
+                params.bounds.startKey = BSON("" << (direction > 0 ? 0 : n - 1));
+                params.bounds.endKey = BSON("" << (direction > 0 ? n - 1 : 0));
+                params.bounds.endKeyInclusive = true;
+                params.direction = direction;
+                params.prefetchRecords = true;
+
+                Client::ReadContext ctx(ns());
+                WorkingSet ws;
+                IndexScan scan(params, &ws, NULL);
+                int count = 0;
+                int last = direction > 0 ? -1 : n;
+                while (!scan.isEOF()) {
+                    WorkingSetID id;
+                    if (PlanStage::ADVANCED != scan.work(&id)) {
+                        continue;
+                    }
+                    int foo = ws.get(id)->keyData[0].keyData.firstElement().numberInt();
+                    ASSERT_EQUALS(last + direction, foo);
+                    last = foo;
+                    ws.free(id);
+
+                    if (++count % 37 == 0) {
+                        scan.prepareToYield();
+                        scan.recoverFromYield();
+                    }
+                }
+                ASSERT_EQUALS(n, count);
+            }
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "query_stage_tests" ) { }
@@ -216,6 +268,7 @@ namespace QueryStageTests {
             add<QueryStageIXScanLowerUpperIncl>();
             add<QueryStageIXScanLowerUpperInclFilter>();
             add<QueryStageIXScanCantMatch>();
+            add<QueryStageIXScanLongRange>();
         }
     }  queryStageTestsAll;
 
@@ -37,6 +37,7 @@
 #include "mongo/dbtests/mock/mock_conn_registry.h"
 #include "mongo/dbtests/mock/mock_replica_set.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/timer.h"
 
 #include <vector>
 
@@ -1593,6 +1594,82 @@ namespace mongo_test {
         monitor->check();
     }
 
+    TEST_F(ReplicaSetMonitorTest, CheckProbesMembersInParallel) {
+        MockReplicaSet* replSet = getReplSet();
+        const string replSetName(replSet->getSetName());
+        vector<HostAndPort> seedList;
+        seedList.push_back(HostAndPort(replSet->getPrimary()));
+        ReplicaSetMonitor::createIfNeeded(replSetName, seedList);
+        ReplicaSetMonitorPtr monitor = ReplicaSetMonitor::get(replSetName);
+
+        // Both secondaries answer slowly: checked one after the other they would take
+        // twice the delay.
+        const long long delayMillis = 2000;
+        const vector<string> secondaries = replSet->getSecondaries();
+        for (vector<string>::const_iterator iter = secondaries.begin();
+                iter != secondaries.end(); ++iter) {
+            replSet->getNode(*iter)->setDelay(delayMillis);
+        }
+
+        mongo::Timer timer;
+        monitor->check();
+        ASSERT_LESS_THAN(timer.millis(), delayMillis * 2 - 500);
+        ASSERT_EQUALS(replSet->getPrimary(), monitor->getMaster().toString());
+    }
+
+    TEST_F(ReplicaSetMonitorTest, SelectOtherSecondary) {
+        MockReplicaSet* replSet = getReplSet();
+        const string replSetName(replSet->getSetName());
+        vector<HostAndPort> seedList;
+        seedList.push_back(HostAndPort(replSet->getPrimary()));
+        ReplicaSetMonitor::createIfNeeded(replSetName, seedList);
+        ReplicaSetMonitorPtr monitor = ReplicaSetMonitor::get(replSetName);
+        monitor->check();
+
+        const vector<string> secondaries = replSet->getSecondaries();
+        TagSet tags;
+        HostAndPort other = monitor->selectOtherSecondary(mongo::ReadPreference_Nearest, tags,
+                                                          HostAndPort(secondaries[0]));
+        ASSERT_EQUALS(secondaries[1], other.toString(true));
+
+        other = monitor->selectOtherSecondary(mongo::ReadPreference_SecondaryPreferred, tags,
+                                              HostAndPort(secondaries[1]));
+        ASSERT_EQUALS(secondaries[0], other.toString(true));
+
+        // never the primary, even when no other secondary is up
+        replSet->kill(secondaries[1]);
+        monitor->check();
+        other = monitor->selectOtherSecondary(mongo::ReadPreference_SecondaryPreferred, tags,
+                                              HostAndPort(secondaries[0]));
+        ASSERT(other.empty());
+    }
+
+    TEST_F(ReplicaSetMonitorTest, SecondaryReadPercentile) {
+        MockReplicaSet* replSet = getReplSet();
+        const string replSetName(replSet->getSetName());
+        vector<HostAndPort> seedList;
+        seedList.push_back(HostAndPort(replSet->getPrimary()));
+        ReplicaSetMonitor::createIfNeeded(replSetName, seedList);
+        ReplicaSetMonitorPtr monitor = ReplicaSetMonitor::get(replSetName);
+
+        // too few reads to tell
+        monitor->noteSecondaryReadMicros(1000);
+        ASSERT_EQUALS(-1, monitor->secondaryReadPercentileMicros(95));
+
+        for (int i = 2; i <= 100; i++) {
+            monitor->noteSecondaryReadMicros(i * 1000);
+        }
+        ASSERT_EQUALS(96000, monitor->secondaryReadPercentileMicros(95));
+        ASSERT_EQUALS(51000, monitor->secondaryReadPercentileMicros(50));
+        ASSERT_EQUALS(100000, monitor->secondaryReadPercentileMicros(100));
+
+        // only the most recent reads count
+        for (int i = 0; i < 1000; i++) {
+            monitor->noteSecondaryReadMicros(500);
+        }
+        ASSERT_EQUALS(500, monitor->secondaryReadPercentileMicros(100));
+    }
+
     // Stress test case for a node that is previously a primary being removed from the set.
     // This test goes through configurations with different positions for the primary node
     // in the host list returned from the isMaster command. The test here is to make sure
@@ -115,6 +115,9 @@ namespace ReplSetTests {
         virtual void consume() {
             _queue.pop();
         }
+        virtual void peekAhead(size_t max, std::vector<BSONObj>* ops) {
+            return;
+        }
         virtual Member* getSyncTarget() {
             return 0;
         }
@@ -1160,6 +1163,66 @@ namespace ReplSetTests {
         }
     };
 
+    class TestWriterVectors : public Base {
+        class Tailer : public replset::SyncTail {
+        public:
+            Tailer() : SyncTail(NULL) {}
+            using SyncTail::fillWriterVectors;
+        };
+
+        static BSONObj op(const char* opType, const BSONObj& o, const BSONObj& o2 = BSONObj()) {
+            BSONObjBuilder b;
+            b.append("op", opType);
+            b.append("ns", ns());
+            b.append("o", o);
+            if (!o2.isEmpty())
+                b.append("o2", o2);
+            return b.obj();
+        }
+
+        // the number of writers given ops, checking that each document's ops stay in order
+        static int fill(const std::deque<BSONObj>& ops) {
+            std::vector< std::vector<BSONObj> > writerVectors(8);
+            Tailer().fillWriterVectors(ops, &writerVectors);
+            int writers = 0;
+            for (size_t i = 0; i < writerVectors.size(); i++) {
+                const std::vector<BSONObj>& v = writerVectors[i];
+                if (!v.empty())
+                    writers++;
+                for (size_t j = 0; j < v.size(); j++) {
+                    if (v[j]["op"].String() == "u") {
+                        ASSERT(j > 0);
+                        ASSERT_EQUALS("i", v[j - 1]["op"].String());
+                        ASSERT_EQUALS(v[j - 1]["o"]["_id"].numberInt(),
+                                      v[j]["o2"]["_id"].numberInt());
+                    }
+                }
+            }
+            return writers;
+        }
+
+    public:
+        void run() {
+            drop();
+            insert(BSON("_id" << -1));
+
+            std::deque<BSONObj> ops;
+            for (int i = 0; i < 100; i++) {
+                ops.push_back(op("i", BSON("_id" << i)));
+                ops.push_back(op("u", BSON("$set" << BSON("x" << i)), BSON("_id" << i)));
+            }
+
+            // one collection's ops are shared by the writers
+            ASSERT(fill(ops) > 1);
+
+            // but not once a unique index might order them
+            client()->ensureIndex(ns(), BSON("x" << 1), true);
+            ASSERT_EQUALS(1, fill(ops));
+
+            drop();
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "replset" ) {
@@ -1173,6 +1236,7 @@ namespace ReplSetTests {
             add< CappedUpdate >();
             add< CappedInsert >();
             add< TestRSSync >();
+            add< TestWriterVectors >();
             add< TestDropDB >();
             add< TestDrop >();
             add< TestDropIndexes >();
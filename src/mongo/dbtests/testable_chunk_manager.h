@@ -0,0 +1,66 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/s/chunk.h"
+
+namespace mongo {
+
+    /**
+     * A ChunkManager whose shard key and chunks are set directly, without a config server.
+     */
+    class TestableChunkManager : public ChunkManager {
+    public:
+        void setShardKey( const BSONObj &keyPattern ) {
+            const_cast<ShardKeyPattern&>(_key) = ShardKeyPattern( keyPattern );
+        }
+        void setSingleChunkForShards( const vector<BSONObj> &splitPoints ) {
+            ChunkMap &chunkMap = const_cast<ChunkMap&>( _chunkMap );
+            ChunkRangeManager &chunkRanges = const_cast<ChunkRangeManager&>( _chunkRanges );
+            set<Shard> &shards = const_cast<set<Shard>&>( _shards );
+            
+            vector<BSONObj> mySplitPoints( splitPoints );
+            mySplitPoints.insert( mySplitPoints.begin(), _key.globalMin() );
+            mySplitPoints.push_back( _key.globalMax() );
+            
+            for( unsigned i = 1; i < mySplitPoints.size(); ++i ) {
+                string name = str::stream() << (i-1);
+                Shard shard( name, name );
+                shards.insert( shard );
+                
+                ChunkPtr chunk( new Chunk( this, mySplitPoints[ i-1 ], mySplitPoints[ i ],
+                                          shard ) );
+                chunkMap[ mySplitPoints[ i ] ] = chunk;
+            }
+            
+            chunkRanges.reloadAll( chunkMap );
+        }
+    };
+    
+} // namespace mongo
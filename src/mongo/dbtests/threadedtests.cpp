@@ -36,6 +36,8 @@
 
 #include "mongo/bson/util/atomic_int.h"
 #include "mongo/db/d_concurrency.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/db/stats/top.h"
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/util/concurrency/mvar.h"
@@ -45,6 +47,7 @@
 #include "mongo/util/concurrency/synchronization.h"
 #include "mongo/util/concurrency/qlock.h"
 #include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/concurrency/work_stealing_pool.h"
 #include "mongo/server.h"
 
 namespace mongo { 
@@ -339,6 +342,40 @@ namespace ThreadedTests {
         }
     };
 
+    // More threads than stripes, so some share one
+    class StripedStatsTest : public ThreadedTest<20> {
+        static const int iterations = 10000;
+        OpCounters counters;
+        Top top;
+
+        void subthread(int remaining) {
+            for (int i = 0; i < iterations; i++) {
+                counters.gotQuery();
+                top.record("test.striped", dbQuery, -1, 2, false);
+            }
+            if (remaining % 2)
+                counters.incInsertInWriteLock(remaining);
+        }
+        void validate() {
+            ASSERT_EQUALS(unsigned(nthreads * iterations), counters.getQuery());
+            ASSERT_EQUALS(unsigned(nthreads * nthreads / 4), counters.getInsert());
+            ASSERT_EQUALS(0u, counters.getUpdate());
+            ASSERT_EQUALS(nthreads * iterations, counters.getObj()["query"].numberInt());
+
+            Top::CollectionData global = top.getGlobalData();
+            ASSERT_EQUALS(nthreads * iterations, global.queries.count);
+            ASSERT_EQUALS(2LL * nthreads * iterations, global.readLock.time);
+
+            Top::UsageMap usage;
+            top.cloneMap(usage);
+            ASSERT_EQUALS(nthreads * iterations, usage["test.striped"].total.count);
+
+            top.collectionDropped("test.striped");
+            top.cloneMap(usage);
+            ASSERT(usage.find("test.striped") == usage.end());
+        }
+    };
+
     class MVarTest : public ThreadedTest<> {
         static const int iterations = 10000;
         MVar<int> target;
@@ -385,6 +422,84 @@ namespace ThreadedTests {
         }
     };
 
+    class WorkStealingPoolTest {
+        static const unsigned iterations = 10000;
+
+        WorkStealingPool pool;
+        AtomicUInt32 counter;
+        mongo::mutex m;
+        set<boost::thread::id> pinnedThreads;
+
+        void increment(unsigned n) {
+            for (unsigned i=0; i<n; i++) {
+                counter.fetchAndAdd(1);
+            }
+        }
+
+        /** schedules and joins a group of its own from inside a task */
+        void nested() {
+            TaskGroup inner(pool);
+            for (unsigned i=0; i < 10; i++) {
+                inner.schedule(boost::bind(&WorkStealingPoolTest::increment, this, 1));
+            }
+            inner.join();
+        }
+
+        void recordThread() {
+            scoped_lock lk(m);
+            pinnedThreads.insert(boost::this_thread::get_id());
+        }
+
+        static void fail() {
+            uasserted(12345, "task failed");
+        }
+
+    public:
+        WorkStealingPoolTest() : pool(4), m("WorkStealingPoolTest") { }
+
+        void run() {
+            {
+                TaskGroup group(pool);
+                for (unsigned i=0; i < iterations; i++) {
+                    group.schedule(boost::bind(&WorkStealingPoolTest::increment, this, 2));
+                }
+                group.join();
+                ASSERT_EQUALS(counter.load(), iterations * 2);
+                ASSERT_EQUALS(group.pending(), 0);
+            }
+
+            counter.store(0);
+            {
+                TaskGroup group(pool);
+                for (unsigned i=0; i < 100; i++) {
+                    group.schedule(boost::bind(&WorkStealingPoolTest::nested, this));
+                }
+                group.join();
+                ASSERT_EQUALS(counter.load(), 1000U);
+            }
+
+            {
+                TaskGroup group(pool);
+                for (unsigned i=0; i < 100; i++) {
+                    group.schedulePinned(1, boost::bind(&WorkStealingPoolTest::recordThread,
+                                                        this));
+                }
+                group.join();
+                ASSERT_EQUALS(pinnedThreads.size(), 1U);
+            }
+
+            {
+                TaskGroup group(pool);
+                group.schedule(boost::bind(&WorkStealingPoolTest::increment, this, 1));
+                group.schedule(&WorkStealingPoolTest::fail);
+                ASSERT_THROWS(group.join(), UserException);
+
+                // the error is reported once
+                group.join();
+            }
+        }
+    };
+
     class LockTest {
     public:
         void run() {
@@ -907,6 +1022,118 @@ namespace ThreadedTests {
         }
     };
 
+    // Many threads taking QLock in 'r' at once while a global writer cuts in now and then. The
+    // writer must never overlap a reader; the read rate is logged so that read scalability can
+    // be compared between builds.
+    class QLockReadScalability : public ThreadedTest<64> {
+    public:
+        QLockReadScalability() : _writes(0) { }
+    private:
+        enum { N = 20000, Writes = 50 };
+        QLock _q;
+        AtomicInt32 _readersInside;
+        int _writes;
+        Timer _t;
+
+        virtual void setup() { _t.reset(); }
+
+        virtual void subthread(int x) {
+            if( x == 1 ) {
+                for( int i = 0; i < Writes; i++ ) {
+                    _q.lock_W();
+                    ASSERT_EQUALS( 0, _readersInside.load() );
+                    _writes++;
+                    _q.unlock_W();
+                    sleepmillis(1);
+                }
+                return;
+            }
+            for( int i = 0; i < N; i++ ) {
+                _q.lock_r();
+                _readersInside.fetchAndAdd(1);
+                _readersInside.fetchAndSubtract(1);
+                _q.unlock_r();
+            }
+        }
+
+        virtual void validate() {
+            ASSERT_EQUALS( Writes, _writes );
+            long long micros = std::max( static_cast<long long>( _t.micros() ), 1LL );
+            mongo::unittest::log() << "QLockReadScalability " << nthreads - 1 << " readers: "
+                                   << (nthreads - 1) * N * 1000000LL / micros << " r/s" << endl;
+        }
+    };
+
+    // Only one thread at a time gets through a FifoGate, and each leave() lets the next one in
+    class FifoGateTest : public ThreadedTest<10> {
+        static const int N = 1000;
+
+        FifoGate _gate;
+        int _inside;    // only touched inside the gate
+        int _entries;
+
+        virtual void setup() {
+            _inside = 0;
+            _entries = 0;
+        }
+
+        virtual void subthread(int) {
+            for( int i = 0; i < N; i++ ) {
+                _gate.enter();
+                ASSERT_EQUALS( ++_inside, 1 );
+                _entries++;
+                if( i % 100 == 0 )
+                    sleepmicros(10);
+                _inside--;
+                _gate.leave();
+            }
+        }
+
+        virtual void validate() {
+            ASSERT_EQUALS( _entries, nthreads * N );
+            ASSERT_EQUALS( _gate.nWaiting(), 0U );
+        }
+    };
+
+    // A waiter is released by the first notifyAll() of an event at least as late as the one it
+    // waits for, and not before
+    class NotifyAllTest : public ThreadedTest<10> {
+        static const int N = 200;
+
+        NotifyAll _notify;
+        AtomicUInt64 _lastNotified;
+        AtomicUInt32 _waitersDone;
+
+        virtual void setup() {
+            _lastNotified.store( 0 );
+            _waitersDone.store( 0 );
+        }
+
+        virtual void subthread(int remaining) {
+            if( remaining == 1 ) {
+                // the notifier, like the commit thread
+                while( _waitersDone.load() < unsigned( nthreads - 1 ) ) {
+                    NotifyAll::When e = _notify.now();
+                    _lastNotified.store( e );
+                    _notify.notifyAll( e );
+                    sleepmicros( 100 );
+                }
+                return;
+            }
+
+            for( int i = 0; i < N; i++ ) {
+                NotifyAll::When w = _notify.now();
+                _notify.waitFor( w + 1 );
+                ASSERT( _lastNotified.load() >= w + 1 );
+            }
+            _waitersDone.fetchAndAdd( 1 );
+        }
+
+        virtual void validate() {
+            ASSERT_EQUALS( _notify.nWaiting(), 0U );
+        }
+    };
+
     // Tests waiting on the TicketHolder by running many more threads than can fit into the "hotel", but only
     // max _nRooms threads should ever get in at once
     class TicketHolderWaits : public ThreadedTest<10> {
@@ -989,6 +1216,7 @@ namespace ThreadedTests {
             add< WriteLocksAreGreedy >();
             add< QLockTest >();
             add< QLockTest >();
+            add< QLockReadScalability >();
 
             // Slack is a test to see how long it takes for another thread to pick up
             // and begin work after another relinquishes the lock.  e.g. a spin lock 
@@ -1005,8 +1233,10 @@ namespace ThreadedTests {
             add< IsAtomicUIntAtomic >();
             add< IsAtomicWordAtomic<AtomicUInt32> >();
             add< IsAtomicWordAtomic<AtomicUInt64> >();
+            add< StripedStatsTest >();
             add< MVarTest >();
             add< ThreadPoolTest >();
+            add< WorkStealingPoolTest >();
             add< LockTest >();
 
 
@@ -1017,6 +1247,8 @@ namespace ThreadedTests {
 
             add< MongoMutexTest >();
             add< TicketHolderWaits >();
+            add< FifoGateTest >();
+            add< NotifyAllTest >();
         }
     } myall;
 }
@@ -0,0 +1,233 @@
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/logger/async_log_writer.h"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "mongo/logger/rotatable_file_writer.h"
+
+namespace mongo {
+namespace logger {
+
+namespace {
+
+    // How long the writing thread sleeps when nobody wakes it
+    const int kWriteIntervalMillis = 10;
+
+    struct QueuedLine {
+        QueuedLine() : sequence(0) {}
+
+        bool operator<(const QueuedLine& other) const { return sequence < other.sequence; }
+
+        unsigned long long sequence;
+        std::string line;
+    };
+
+    // Every AsyncLogWriter, for flushAll()
+    boost::mutex allWritersMutex;
+    std::vector<AsyncLogWriter*> allWriters;
+
+    unsigned roundUpToPowerOf2(size_t n) {
+        unsigned size = 1;
+        while (size < n)
+            size *= 2;
+        return size;
+    }
+
+}  // namespace
+
+    /**
+     * A ring of lines with one thread adding to it and one taking from it.  The adding thread
+     * only moves _tail and the taking thread only moves _head, so neither locks.
+     */
+    class AsyncLogWriter::ThreadBuffer {
+        MONGO_DISALLOW_COPYING(ThreadBuffer);
+    public:
+        explicit ThreadBuffer(unsigned size) : _lines(size), _mask(size - 1) {}
+
+        /**
+         * Adds "line" if there is room.  Sets "*halfFull" when this leaves the ring half full.
+         */
+        bool push(unsigned long long sequence, std::string* line, bool* halfFull) {
+            const unsigned tail = _tail.load();
+            const unsigned size = tail - _head.load();
+            if (size > _mask)
+                return false;
+            QueuedLine& queued = _lines[tail & _mask];
+            queued.sequence = sequence;
+            queued.line.swap(*line);
+            _tail.store(tail + 1);
+            *halfFull = size + 1 == (_mask + 1) / 2;
+            return true;
+        }
+
+        /**
+         * Moves every line in the ring to the end of "out".
+         */
+        void takeAll(std::vector<QueuedLine>* out) {
+            const unsigned head = _head.load();
+            const unsigned tail = _tail.load();
+            for (unsigned i = head; i != tail; ++i) {
+                QueuedLine& queued = _lines[i & _mask];
+                out->push_back(QueuedLine());
+                out->back().sequence = queued.sequence;
+                out->back().line.swap(queued.line);
+            }
+            _head.store(tail);
+        }
+
+        // Whether a living thread owns this ring
+        AtomicUInt32 inUse;
+
+    private:
+        std::vector<QueuedLine> _lines;
+        const unsigned _mask;
+        AtomicUInt32 _head;
+        AtomicUInt32 _tail;
+    };
+
+    AsyncLogWriter::AsyncLogWriter(RotatableFileWriter* writer,
+                                   size_t linesPerThread,
+                                   Counter64* dropped) :
+        _writer(writer),
+        _linesPerThread(roundUpToPowerOf2(std::max<size_t>(linesPerThread, 2))),
+        _dropped(dropped),
+        _shutdown(false),
+        _threadBuffer(&AsyncLogWriter::_releaseThreadBuffer) {
+
+        _thread.reset(new boost::thread(boost::bind(&AsyncLogWriter::_run, this)));
+
+        boost::lock_guard<boost::mutex> lk(allWritersMutex);
+        allWriters.push_back(this);
+    }
+
+    AsyncLogWriter::~AsyncLogWriter() {
+        {
+            boost::lock_guard<boost::mutex> lk(allWritersMutex);
+            allWriters.erase(std::find(allWriters.begin(), allWriters.end(), this));
+        }
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            _shutdown = true;
+        }
+        _wake.notify_one();
+        _thread->join();
+        _writeQueued(NULL);
+
+        _threadBuffer.release();
+        for (size_t i = 0; i < _buffers.size(); ++i) {
+            delete _buffers[i];
+        }
+    }
+
+    bool AsyncLogWriter::write(std::string* line) {
+        bool halfFull = false;
+        if (!_getThreadBuffer()->push(_nextSequence.fetchAndAdd(1), line, &halfFull)) {
+            if (_dropped)
+                _dropped->increment();
+            return false;
+        }
+        if (halfFull)
+            _wake.notify_one();
+        return true;
+    }
+
+    Status AsyncLogWriter::writeNow(const std::string& line) {
+        return _writeQueued(&line);
+    }
+
+    Status AsyncLogWriter::flush() {
+        return _writeQueued(NULL);
+    }
+
+    void AsyncLogWriter::flushAll() {
+        boost::lock_guard<boost::mutex> lk(allWritersMutex);
+        for (size_t i = 0; i < allWriters.size(); ++i) {
+            allWriters[i]->flush();
+        }
+    }
+
+    AsyncLogWriter::ThreadBuffer* AsyncLogWriter::_getThreadBuffer() {
+        ThreadBuffer* buffer = _threadBuffer.get();
+        if (buffer)
+            return buffer;
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        for (size_t i = 0; i < _buffers.size(); ++i) {
+            if (_buffers[i]->inUse.compareAndSwap(0, 1) == 0) {
+                buffer = _buffers[i];
+                break;
+            }
+        }
+        if (!buffer) {
+            buffer = new ThreadBuffer(_linesPerThread);
+            buffer->inUse.store(1);
+            _buffers.push_back(buffer);
+        }
+        _threadBuffer.reset(buffer);
+        return buffer;
+    }
+
+    void AsyncLogWriter::_releaseThreadBuffer(ThreadBuffer* buffer) {
+        // The ring keeps its lines, which the writing thread still writes
+        buffer->inUse.store(0);
+    }
+
+    void AsyncLogWriter::_run() {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        while (!_shutdown) {
+            _wake.timed_wait(lk, boost::posix_time::milliseconds(kWriteIntervalMillis));
+            lk.unlock();
+            _writeQueued(NULL);
+            lk.lock();
+        }
+    }
+
+    Status AsyncLogWriter::_writeQueued(const std::string* last) {
+        boost::lock_guard<boost::mutex> writeLock(_writeMutex);
+
+        std::vector<ThreadBuffer*> buffers;
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            buffers = _buffers;
+        }
+        std::vector<QueuedLine> lines;
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            buffers[i]->takeAll(&lines);
+        }
+        if (lines.empty() && !last)
+            return Status::OK();
+        std::sort(lines.begin(), lines.end());
+
+        RotatableFileWriter::Use useWriter(_writer);
+        Status status = useWriter.status();
+        if (!status.isOK())
+            return status;
+        for (size_t i = 0; i < lines.size(); ++i) {
+            useWriter.stream() << lines[i].line;
+        }
+        if (last)
+            useWriter.stream() << *last;
+        useWriter.stream().flush();
+        return useWriter.status();
+    }
+
+}  // namespace logger
+}  // namespace mongo
@@ -0,0 +1,122 @@
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <string>
+#include <vector>
+
+#include "mongo/base/counter.h"
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+namespace logger {
+
+    class RotatableFileWriter;
+
+    /**
+     * Writes lines to a RotatableFileWriter from a thread of its own, so that the threads
+     * logging never wait on the file or on each other.
+     *
+     * Each thread queues its lines in a ring of its own, which only it adds to and only the
+     * writing thread takes from, so queueing takes no lock.  The writing thread wakes up every
+     * few milliseconds, or sooner when a ring is half full, and writes what every ring holds in
+     * the order the lines were queued.  When a thread's ring is full its lines are dropped and
+     * counted instead of waiting for room.
+     *
+     * An AsyncLogWriter must outlive every thread that writes to it.
+     */
+    class AsyncLogWriter {
+        MONGO_DISALLOW_COPYING(AsyncLogWriter);
+    public:
+        /**
+         * Starts the writing thread.  Does not own "writer", which must outlive this.  Each
+         * thread may have up to "linesPerThread" lines queued, rounded up to a power of 2.
+         * Dropped lines are counted in "dropped", which may be NULL.
+         */
+        AsyncLogWriter(RotatableFileWriter* writer, size_t linesPerThread, Counter64* dropped);
+
+        /**
+         * Stops the writing thread, after it has written everything queued.
+         */
+        ~AsyncLogWriter();
+
+        /**
+         * Queues "line", which is taken by swapping it with an empty string.  Returns false if
+         * the calling thread's ring is full and the line was dropped.
+         */
+        bool write(std::string* line);
+
+        /**
+         * Writes every line queued so far, then "line", and returns once they are written.
+         */
+        Status writeNow(const std::string& line);
+
+        /**
+         * Writes every line queued so far from the calling thread, and returns once they are
+         * written.
+         */
+        Status flush();
+
+        /**
+         * Flushes every AsyncLogWriter in the process, for use just before exiting.
+         */
+        static void flushAll();
+
+    private:
+        class ThreadBuffer;
+
+        /**
+         * Returns the calling thread's ring, taking one whose thread exited, or adding a new
+         * one, the first time a thread writes.
+         */
+        ThreadBuffer* _getThreadBuffer();
+
+        // Body of the writing thread
+        void _run();
+
+        // Takes every queued line and writes them in order, followed by "last" if not NULL
+        Status _writeQueued(const std::string* last);
+
+        static void _releaseThreadBuffer(ThreadBuffer* buffer);
+
+        RotatableFileWriter* const _writer;
+        const unsigned _linesPerThread;
+        Counter64* const _dropped;
+        AtomicUInt64 _nextSequence;
+
+        // Guards _buffers and _shutdown
+        boost::mutex _mutex;
+        boost::condition_variable _wake;
+        std::vector<ThreadBuffer*> _buffers;
+        bool _shutdown;
+
+        // Held while lines are taken from the rings and written, so that they are taken by one
+        // thread at a time and written in order
+        boost::mutex _writeMutex;
+
+        boost::thread_specific_ptr<ThreadBuffer> _threadBuffer;
+        boost::scoped_ptr<boost::thread> _thread;
+    };
+
+}  // namespace logger
+}  // namespace mongo
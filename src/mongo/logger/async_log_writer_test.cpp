@@ -0,0 +1,131 @@
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "mongo/logger/async_log_writer.h"
+#include "mongo/logger/rotatable_file_writer.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+    using namespace mongo;
+    using namespace mongo::logger;
+
+    const std::string logFileName("LogTest_AsyncLogWriter.txt");
+
+    class AsyncLogWriterTest : public mongo::unittest::Test {
+    public:
+        AsyncLogWriterTest() {
+            unlink(logFileName.c_str());
+            RotatableFileWriter::Use writerUse(&_fileWriter);
+            ASSERT_OK(writerUse.setFileName(logFileName, false));
+        }
+
+        virtual ~AsyncLogWriterTest() {
+            unlink(logFileName.c_str());
+        }
+
+        std::vector<std::string> readLines() {
+            std::vector<std::string> lines;
+            std::ifstream ifs(logFileName.c_str());
+            std::string line;
+            while (std::getline(ifs, line))
+                lines.push_back(line);
+            return lines;
+        }
+
+    protected:
+        RotatableFileWriter _fileWriter;
+    };
+
+    void writeLines(AsyncLogWriter* writer, int thread, int numLines) {
+        for (int i = 0; i < numLines; i++) {
+            std::ostringstream os;
+            os << thread << ' ' << i << '\n';
+            std::string line = os.str();
+            writer->write(&line);
+        }
+    }
+
+    TEST_F(AsyncLogWriterTest, WritesEachThreadsLinesInOrder) {
+        const int numThreads = 4;
+        const int numLines = 1000;
+        Counter64 dropped;
+        AsyncLogWriter writer(&_fileWriter, 64, &dropped);
+
+        boost::thread_group threads;
+        for (int i = 0; i < numThreads; i++) {
+            threads.create_thread(boost::bind(&writeLines, &writer, i, numLines));
+        }
+        threads.join_all();
+        ASSERT_OK(writer.flush());
+
+        // Every line written, or dropped, and those written in the order their thread queued
+        // them
+        std::vector<std::string> lines = readLines();
+        ASSERT_EQUALS(static_cast<size_t>(numThreads * numLines),
+                      lines.size() + dropped.get());
+        std::map<int, int> lastLine;
+        for (size_t i = 0; i < lines.size(); i++) {
+            std::istringstream is(lines[i]);
+            int thread, line;
+            is >> thread >> line;
+            if (lastLine.count(thread))
+                ASSERT_LESS_THAN(lastLine[thread], line);
+            lastLine[thread] = line;
+        }
+    }
+
+    TEST_F(AsyncLogWriterTest, WriteNowFollowsQueuedLines) {
+        AsyncLogWriter writer(&_fileWriter, 16, NULL);
+        std::string line("first\n");
+        ASSERT_TRUE(writer.write(&line));
+        ASSERT_EQUALS("", line);
+        ASSERT_OK(writer.writeNow("second\n"));
+
+        std::vector<std::string> lines = readLines();
+        ASSERT_EQUALS(2U, lines.size());
+        ASSERT_EQUALS("first", lines[0]);
+        ASSERT_EQUALS("second", lines[1]);
+    }
+
+    TEST_F(AsyncLogWriterTest, DestructorWritesQueuedLines) {
+        {
+            AsyncLogWriter writer(&_fileWriter, 16, NULL);
+            writeLines(&writer, 0, 10);
+        }
+        ASSERT_EQUALS(10U, readLines().size());
+    }
+
+    TEST_F(AsyncLogWriterTest, WritesLinesOfExitedThreads) {
+        AsyncLogWriter writer(&_fileWriter, 16, NULL);
+        for (int i = 0; i < 20; i++) {
+            boost::thread thread(boost::bind(&writeLines, &writer, i, 1));
+            thread.join();
+        }
+        ASSERT_OK(writer.flush());
+        std::vector<std::string> lines = readLines();
+        ASSERT_EQUALS(20U, lines.size());
+        ASSERT_EQUALS("0 0", lines[0]);
+        ASSERT_EQUALS("19 0", lines[19]);
+    }
+
+}  // namespace
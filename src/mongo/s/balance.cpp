@@ -30,6 +30,8 @@
 
 #include "mongo/s/balance.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/client/distlock.h"
 #include "mongo/db/jsobj.h"
@@ -55,84 +57,139 @@ namespace mongo {
     Balancer::~Balancer() {
     }
 
+    struct Balancer::MoveTask {
+        const CandidateChunk* chunkInfo;
+        bool secondaryThrottle;
+        bool waitForDelete;
+        int moved;
+    };
+
+    void Balancer::_runMoveTask( MoveTask* task ) {
+        try {
+            task->moved = _moveChunk( *task->chunkInfo,
+                                      task->secondaryThrottle,
+                                      task->waitForDelete );
+        }
+        catch ( const std::exception& e ) {
+            warning() << "could not move chunk " << task->chunkInfo->chunk.toString()
+                      << ", continuing balancing round" << causedBy( e.what() ) << endl;
+            task->moved = 0;
+        }
+    }
+
     int Balancer::_moveChunks(const vector<CandidateChunkPtr>* candidateChunks,
                               bool secondaryThrottle,
                               bool waitForDelete)
     {
         int movedCount = 0;
 
-        for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
-            const CandidateChunk& chunkInfo = *it->get();
+        // A shard can only be in one migration at a time, and the policy proposes at most one
+        // migration per collection, so each wave of migrations between disjoint shards runs at
+        // once, each holding its own collection's lock.
+        vector<CandidateChunkPtr> remaining( *candidateChunks );
+        while ( ! remaining.empty() ) {
+            vector<CandidateChunkPtr> wave;
+            BalancerPolicy::pickNonConflicting( &remaining, &wave );
+
+            vector<MoveTask> tasks( wave.size() );
+            for ( unsigned i = 0; i < wave.size(); i++ ) {
+                tasks[i].chunkInfo = wave[i].get();
+                tasks[i].secondaryThrottle = secondaryThrottle;
+                tasks[i].waitForDelete = waitForDelete;
+                tasks[i].moved = 0;
+            }
 
-            // Changes to metadata, borked metadata, and connectivity problems should cause us to
-            // abort this chunk move, but shouldn't cause us to abort the entire round of chunks.
-            // TODO: Handle all these things more cleanly, since they're expected problems
-            try {
+            if ( tasks.size() == 1 ) {
+                _runMoveTask( &tasks[0] );
+            }
+            else {
+                LOG(1) << "moving " << tasks.size() << " chunks at once" << endl;
+
+                boost::thread_group threads;
+                for ( unsigned i = 0; i < tasks.size(); i++ ) {
+                    threads.create_thread( boost::bind( &Balancer::_runMoveTask, &tasks[i] ) );
+                }
+                threads.join_all();
+            }
+
+            for ( unsigned i = 0; i < tasks.size(); i++ ) {
+                movedCount += tasks[i].moved;
+            }
+        }
 
-                DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
-                verify( cfg );
+        return movedCount;
+    }
+
+    int Balancer::_moveChunk( const CandidateChunk& chunkInfo,
+                              bool secondaryThrottle,
+                              bool waitForDelete ) {
+        // Changes to metadata, borked metadata, and connectivity problems should cause us to
+        // abort this chunk move, but shouldn't cause us to abort the entire round of chunks.
+        // TODO: Handle all these things more cleanly, since they're expected problems
+        try {
 
-                // NOTE: We purposely do not reload metadata here, since _doBalanceRound already
-                // tried to do so once.
-                ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+            DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
+            verify( cfg );
+
+            // NOTE: We purposely do not reload metadata here, since _doBalanceRound already
+            // tried to do so once.
+            ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+            verify( cm );
+
+            ChunkPtr c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+            if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
+                // likely a split happened somewhere
+                cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
                 verify( cm );
 
-                ChunkPtr c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+                c = cm->findIntersectingChunk( chunkInfo.chunk.min );
                 if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
-                    // likely a split happened somewhere
-                    cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
-                    verify( cm );
-
-                    c = cm->findIntersectingChunk( chunkInfo.chunk.min );
-                    if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
-                        log() << "chunk mismatch after reload, ignoring will retry issue " << chunkInfo.chunk.toString() << endl;
-                        continue;
-                    }
+                    log() << "chunk mismatch after reload, ignoring will retry issue " << chunkInfo.chunk.toString() << endl;
+                    return 0;
                 }
+            }
 
-                BSONObj res;
-                if (c->moveAndCommit(Shard::make(chunkInfo.to),
-                                     Chunk::MaxChunkSize,
-                                     secondaryThrottle,
-                                     waitForDelete,
-                                     0, /* maxTimeMS */
-                                     res)) {
-                    movedCount++;
-                    continue;
-                }
+            BSONObj res;
+            if (c->moveAndCommit(Shard::make(chunkInfo.to),
+                                 Chunk::MaxChunkSize,
+                                 secondaryThrottle,
+                                 waitForDelete,
+                                 0, /* maxTimeMS */
+                                 res)) {
+                return 1;
+            }
 
-                // the move requires acquiring the collection metadata's lock, which can fail
-                log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
-                      << " chunk: " << chunkInfo.chunk << endl;
+            // the move requires acquiring the collection metadata's lock, which can fail
+            log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
+                  << " chunk: " << chunkInfo.chunk << endl;
 
-                if ( res["chunkTooBig"].trueValue() ) {
-                    // reload just to be safe
-                    cm = cfg->getChunkManager( chunkInfo.ns );
-                    verify( cm );
-                    c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+            if ( res["chunkTooBig"].trueValue() ) {
+                // reload just to be safe
+                cm = cfg->getChunkManager( chunkInfo.ns );
+                verify( cm );
+                c = cm->findIntersectingChunk( chunkInfo.chunk.min );
 
-                    log() << "forcing a split because migrate failed for size reasons" << endl;
+                log() << "forcing a split because migrate failed for size reasons" << endl;
 
-                    res = BSONObj();
-                    c->singleSplit( true , res );
-                    log() << "forced split results: " << res << endl;
-
-                    if ( ! res["ok"].trueValue() ) {
-                        log() << "marking chunk as jumbo: " << c->toString() << endl;
-                        c->markAsJumbo();
-                        // we increment moveCount so we do another round right away
-                        movedCount++;
-                    }
+                res = BSONObj();
+                c->singleSplit( true , res );
+                log() << "forced split results: " << res << endl;
 
+                if ( ! res["ok"].trueValue() ) {
+                    log() << "marking chunk as jumbo: " << c->toString() << endl;
+                    c->markAsJumbo();
+                    // we count it as moved so we do another round right away
+                    return 1;
                 }
-            }
-            catch( const DBException& ex ) {
-                warning() << "could not move chunk " << chunkInfo.chunk.toString()
-                          << ", continuing balancing round" << causedBy( ex ) << endl;
+
             }
         }
+        catch( const DBException& ex ) {
+            warning() << "could not move chunk " << chunkInfo.chunk.toString()
+                      << ", continuing balancing round" << causedBy( ex ) << endl;
+        }
 
-        return movedCount;
+        return 0;
     }
 
     void Balancer::_ping( DBClientBase& conn, bool waiting ) {
@@ -201,7 +258,44 @@ namespace mongo {
         }        
     }
 
-    void Balancer::_doBalanceRound( DBClientBase& conn, vector<CandidateChunkPtr>* candidateChunks ) {
+    void Balancer::_getChunkLoads( const string& ns,
+                                   const ShardToChunksMap& shardToChunksMap,
+                                   ChunkLoadMap* loads ) {
+        for ( ShardToChunksMap::const_iterator i = shardToChunksMap.begin();
+              i != shardToChunksMap.end();
+              ++i ) {
+            if ( i->second.empty() )
+                continue;
+
+            BSONObj res;
+            try {
+                res = Shard::make( i->first ).runCommand( "admin", BSON( "getChunkLoad" << ns ) );
+            }
+            catch ( const DBException& ex ) {
+                warning() << "could not get the chunk load of " << ns << " from " << i->first
+                          << causedBy( ex ) << endl;
+                continue;
+            }
+
+            if ( ! res["tracking"].trueValue() ) {
+                LOG(1) << i->first << " doesn't track chunk load, set trackChunkLoad on it"
+                       << endl;
+            }
+
+            BSONObjIterator it( res.getObjectField( "chunks" ) );
+            while ( it.more() ) {
+                BSONObj chunk = it.next().Obj();
+                ChunkLoad& load = (*loads)[chunk["min"].Obj().getOwned()];
+                load.reads = chunk["reads"].numberLong();
+                load.writes = chunk["writes"].numberLong();
+                load.bytes = chunk["bytes"].numberLong();
+            }
+        }
+    }
+
+    void Balancer::_doBalanceRound( DBClientBase& conn,
+                                    bool balanceByLoad,
+                                    vector<CandidateChunkPtr>* candidateChunks ) {
         verify( candidateChunks );
 
         //
@@ -368,6 +462,29 @@ namespace mongo {
                 continue;
             }
 
+            if ( balanceByLoad ) {
+                ChunkLoadMap loads;
+                _getChunkLoads( ns, shardToChunksMap, &loads );
+
+                BSONObj chunkToSplit;
+                CandidateChunk* p = _policy->balanceByLoad( ns, status, loads, &chunkToSplit );
+                if ( p ) candidateChunks->push_back( CandidateChunkPtr( p ) );
+
+                if ( ! chunkToSplit.isEmpty() ) {
+                    ChunkPtr c = cm->findIntersectingChunk( chunkToSplit[ChunkType::min()].Obj() );
+
+                    BSONObj res;
+                    c->singleSplit( true , res );
+                    if ( ! res["ok"].trueValue() ) {
+                        error() << "split of busy chunk failed: " << res << endl;
+                    }
+                    else {
+                        LOG(1) << "split of busy chunk worked: " << res << endl;
+                    }
+                }
+                continue;
+            }
+
             CandidateChunk* p = _policy->balance( ns, status, _balancedLastTime );
             if ( p ) candidateChunks->push_back( CandidateChunkPtr( p ) );
         }
@@ -492,11 +609,16 @@ namespace mongo {
                         secondaryThrottle = balancerConfig[SettingsType::secondaryThrottle()].trueValue();
                     }
 
+                    // even out the operations shards serve, as the shards count them, rather
+                    // than the chunks they hold
+                    bool balanceByLoad = balancerConfig["balanceByLoad"].trueValue();
+
                     LOG(1) << "waitForDelete: " << waitForDelete << endl;
                     LOG(1) << "secondaryThrottle: " << secondaryThrottle << endl;
+                    LOG(1) << "balanceByLoad: " << balanceByLoad << endl;
 
                     vector<CandidateChunkPtr> candidateChunks;
-                    _doBalanceRound( conn.conn() , &candidateChunks );
+                    _doBalanceRound( conn.conn() , balanceByLoad, &candidateChunks );
                     if ( candidateChunks.size() == 0 ) {
                         LOG(1) << "no need to move any chunk" << endl;
                         _balancedLastTime = 0;
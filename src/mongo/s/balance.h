@@ -45,7 +45,7 @@ namespace mongo {
      *
      * The balancer does act continuously but in "rounds". At a given round, it would decide if there is an imbalance by
      * checking the difference in chunks between the most and least loaded shards. It would issue a request for a chunk
-     * migration per round, if it found so.
+     * migration per collection per round, if it found so. Migrations between disjoint pairs of shards run at once.
      */
     class Balancer : public BackgroundJob {
     public:
@@ -88,12 +88,23 @@ namespace mongo {
          * be moved.
          *
          * @param conn is the connection with the config server(s)
+         * @param balanceByLoad whether to even out the load of shards rather than their chunks
          * @param candidateChunks (IN/OUT) filled with candidate chunks, one per collection, that could possibly be moved
          */
-        void _doBalanceRound( DBClientBase& conn, vector<CandidateChunkPtr>* candidateChunks );
+        void _doBalanceRound( DBClientBase& conn,
+                              bool balanceByLoad,
+                              vector<CandidateChunkPtr>* candidateChunks );
 
         /**
-         * Issues chunk migration request, one at a time.
+         * Asks the shards that hold chunks of 'ns' how busy each chunk has been lately.  A shard
+         * that can't tell is left out, as if its chunks had no load.
+         */
+        static void _getChunkLoads( const string& ns,
+                                    const ShardToChunksMap& shardToChunksMap,
+                                    ChunkLoadMap* loads );
+
+        /**
+         * Issues chunk migration requests, at once for those between disjoint pairs of shards.
          *
          * @param candidateChunks possible chunks to move
          * @param secondaryThrottle wait for secondaries to catch up before pushing more deletes
@@ -104,6 +115,19 @@ namespace mongo {
                         bool secondaryThrottle,
                         bool waitForDelete);
 
+        // a migration run by _moveChunks, in its own thread if others run with it
+        struct MoveTask;
+        static void _runMoveTask( MoveTask* task );
+
+        /**
+         * Issues the migration request of a chunk.  Failures are logged, not thrown.
+         *
+         * @return 1 if the chunk moved, or was marked jumbo after failing to move, else 0
+         */
+        static int _moveChunk( const CandidateChunk& chunkInfo,
+                               bool secondaryThrottle,
+                               bool waitForDelete );
+
         /**
          * Marks this balancer as being live on the config server(s).
          *
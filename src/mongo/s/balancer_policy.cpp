@@ -231,6 +231,26 @@ namespace mongo {
         }
         return false;
     }
+    void BalancerPolicy::pickNonConflicting( vector<shared_ptr<MigrateInfo> >* candidates,
+                                             vector<shared_ptr<MigrateInfo> >* wave ) {
+        set<string> busy;
+        vector<shared_ptr<MigrateInfo> > later;
+
+        for ( unsigned i = 0; i < candidates->size(); i++ ) {
+            const shared_ptr<MigrateInfo>& migrate = (*candidates)[i];
+            if ( busy.count( migrate->from ) || busy.count( migrate->to ) ) {
+                later.push_back( migrate );
+                continue;
+            }
+
+            busy.insert( migrate->from );
+            busy.insert( migrate->to );
+            wave->push_back( migrate );
+        }
+
+        candidates->swap( later );
+    }
+
     MigrateInfo* BalancerPolicy::balance( const string& ns,
                                           const DistributionStatus& distribution,
                                           int balancedLastTime ) {
@@ -243,6 +263,94 @@ namespace mongo {
 
         // ----
 
+        // 1) and 2), things we have to move
+        MigrateInfo* required = _requiredMove( ns, distribution );
+        if ( required )
+            return required;
+
+        // 3) for each tag balance
+
+        int threshold = 8;
+        if ( balancedLastTime || distribution.totalChunks() < 20 )
+            threshold = 2;
+        else if ( distribution.totalChunks() < 80 )
+            threshold = 4;
+
+        // randomize the order in which we balance the tags
+        // this is so that one bad tag doesn't prevent others from getting balanced
+        vector<string> tags;
+        {
+            set<string> t = distribution.tags();
+            for ( set<string>::const_iterator i = t.begin(); i != t.end(); ++i )
+                tags.push_back( *i );
+            tags.push_back( "" );
+
+            std::random_shuffle( tags.begin(), tags.end() );
+        }
+
+        for ( unsigned i=0; i<tags.size(); i++ ) {
+            string tag = tags[i];
+
+            string from = distribution.getMostOverloadedShard( tag );
+            if ( from.size() == 0 )
+                continue;
+
+            unsigned max = distribution.numberOfChunksInShardWithTag( from, tag );
+            if ( max == 0 )
+                continue;
+
+            string to = distribution.getBestReceieverShard( tag );
+            if ( to.size() == 0 ) {
+                log() << "no available shards to take chunks for tag [" << tag << "]" << endl;
+                return NULL;
+            }
+
+            unsigned min = distribution.numberOfChunksInShardWithTag( to, tag );
+
+            const int imbalance = max - min;
+
+            LOG(1) << "collection : " << ns << endl;
+            LOG(1) << "donor      : " << from << " chunks on " << max << endl;
+            LOG(1) << "receiver   : " << to << " chunks on " << min << endl;
+            LOG(1) << "threshold  : " << threshold << endl;
+
+            if ( imbalance < threshold )
+                continue;
+
+            const vector<BSONObj>& chunks = distribution.getChunks( from );
+            unsigned numJumboChunks = 0;
+            for ( unsigned j = 0; j < chunks.size(); j++ ) {
+                if ( distribution.getTagForChunk( chunks[j] ) != tag )
+                    continue;
+
+                if ( _isJumbo( chunks[j] ) ) {
+                    numJumboChunks++;
+                    continue;
+                }
+
+                log() << " ns: " << ns << " going to move " << chunks[j]
+                      << " from: " << from << " to: " << to << " tag [" << tag << "]"
+                      << endl;
+                return new MigrateInfo( ns, to, from, chunks[j] );
+            }
+
+            if ( numJumboChunks ) {
+                error() << "shard: " << from << "ns: " << ns
+                        << "has too many chunks, but they are all jumbo "
+                        << " numJumboChunks: " << numJumboChunks
+                        << endl;
+                continue;
+            }
+
+            verify( false ); // should be impossible
+        }
+
+        // Everything is balanced here!
+        return NULL;
+    }
+
+    MigrateInfo* BalancerPolicy::_requiredMove( const string& ns,
+                                                const DistributionStatus& distribution ) {
         // 1) check things we have to move
         {
             const set<string>& shards = distribution.shards();
@@ -333,84 +441,116 @@ namespace mongo {
             }
         }
 
-        // 3) for each tag balance
-
-        int threshold = 8;
-        if ( balancedLastTime || distribution.totalChunks() < 20 )
-            threshold = 2;
-        else if ( distribution.totalChunks() < 80 )
-            threshold = 4;
-
-        // randomize the order in which we balance the tags
-        // this is so that one bad tag doesn't prevent others from getting balanced
-        vector<string> tags;
-        {
-            set<string> t = distribution.tags();
-            for ( set<string>::const_iterator i = t.begin(); i != t.end(); ++i )
-                tags.push_back( *i );
-            tags.push_back( "" );
-
-            std::random_shuffle( tags.begin(), tags.end() );
-        }
+        return NULL;
+    }
 
-        for ( unsigned i=0; i<tags.size(); i++ ) {
-            string tag = tags[i];
+    // Below this many operations on its busiest shard, a collection's load says too little about
+    // where the load will be next to move chunks for it.
+    static const long long kMinLoadToBalance = 1000;
+
+    MigrateInfo* BalancerPolicy::balanceByLoad( const string& ns,
+                                                const DistributionStatus& distribution,
+                                                const ChunkLoadMap& loads,
+                                                BSONObj* chunkToSplit ) {
+        MigrateInfo* required = _requiredMove( ns, distribution );
+        if ( required )
+            return required;
+
+        // Like balance(), tags are balanced one at a time, in random order.
+        vector<string> tags( distribution.tags().begin(), distribution.tags().end() );
+        tags.push_back( "" );
+        std::random_shuffle( tags.begin(), tags.end() );
+
+        const set<string>& shards = distribution.shards();
+        for ( unsigned i = 0; i < tags.size(); i++ ) {
+            const string& tag = tags[i];
+
+            string from;
+            string to;
+            long long maxLoad = -1;
+            long long minLoad = numeric_limits<long long>::max();
+            for ( set<string>::const_iterator s = shards.begin(); s != shards.end(); ++s ) {
+                const ShardInfo& info = distribution.shardInfo( *s );
+                if ( ! info.hasTag( tag ) )
+                    continue;
 
-            string from = distribution.getMostOverloadedShard( tag );
-            if ( from.size() == 0 )
-                continue;
+                long long load = 0;
+                const vector<BSONObj>& chunks = distribution.getChunks( *s );
+                for ( unsigned j = 0; j < chunks.size(); j++ ) {
+                    if ( distribution.getTagForChunk( chunks[j] ) != tag )
+                        continue;
+                    ChunkLoadMap::const_iterator it =
+                        loads.find( chunks[j][ChunkType::min()].Obj() );
+                    if ( it != loads.end() )
+                        load += it->second.ops();
+                }
 
-            unsigned max = distribution.numberOfChunksInShardWithTag( from, tag );
-            if ( max == 0 )
-                continue;
+                if ( load > maxLoad && ! info.hasOpsQueued() ) {
+                    maxLoad = load;
+                    from = *s;
+                }
 
-            string to = distribution.getBestReceieverShard( tag );
-            if ( to.size() == 0 ) {
-                log() << "no available shards to take chunks for tag [" << tag << "]" << endl;
-                return NULL;
+                if ( load < minLoad && ! info.isSizeMaxed() && ! info.isDraining() &&
+                     ! info.hasOpsQueued() ) {
+                    minLoad = load;
+                    to = *s;
+                }
             }
 
-            unsigned min = distribution.numberOfChunksInShardWithTag( to, tag );
+            if ( from.empty() || to.empty() || from == to )
+                continue;
 
-            const int imbalance = max - min;
+            // within a quarter of each other is balanced enough
+            const long long imbalance = maxLoad - minLoad;
 
             LOG(1) << "collection : " << ns << endl;
-            LOG(1) << "donor      : " << from << " chunks on " << max << endl;
-            LOG(1) << "receiver   : " << to << " chunks on " << min << endl;
-            LOG(1) << "threshold  : " << threshold << endl;
+            LOG(1) << "donor      : " << from << " operations " << maxLoad << endl;
+            LOG(1) << "receiver   : " << to << " operations " << minLoad << endl;
 
-            if ( imbalance < threshold )
+            if ( maxLoad < kMinLoadToBalance || imbalance * 4 <= maxLoad )
                 continue;
 
+            // Moving a chunk busier than half the imbalance would leave the receiver busier
+            // than the donor is left.
+            BSONObj best;
+            long long bestLoad = 0;
+            BSONObj busiest;
+            long long busiestLoad = 0;
             const vector<BSONObj>& chunks = distribution.getChunks( from );
-            unsigned numJumboChunks = 0;
             for ( unsigned j = 0; j < chunks.size(); j++ ) {
-                if ( distribution.getTagForChunk( chunks[j] ) != tag )
+                if ( distribution.getTagForChunk( chunks[j] ) != tag || _isJumbo( chunks[j] ) )
                     continue;
 
-                if ( _isJumbo( chunks[j] ) ) {
-                    numJumboChunks++;
-                    continue;
+                ChunkLoadMap::const_iterator it = loads.find( chunks[j][ChunkType::min()].Obj() );
+                const long long load = it == loads.end() ? 0 : it->second.ops();
+
+                if ( load > busiestLoad ) {
+                    busiest = chunks[j];
+                    busiestLoad = load;
                 }
 
-                log() << " ns: " << ns << " going to move " << chunks[j]
-                      << " from: " << from << " to: " << to << " tag [" << tag << "]"
-                      << endl;
-                return new MigrateInfo( ns, to, from, chunks[j] );
+                if ( load > bestLoad && load * 2 <= imbalance ) {
+                    best = chunks[j];
+                    bestLoad = load;
+                }
             }
 
-            if ( numJumboChunks ) {
-                error() << "shard: " << from << "ns: " << ns
-                        << "has too many chunks, but they are all jumbo "
-                        << " numJumboChunks: " << numJumboChunks
-                        << endl;
-                continue;
+            if ( ! best.isEmpty() ) {
+                log() << " ns: " << ns << " going to move " << best << " with " << bestLoad
+                      << " operations from: " << from << " to: " << to << " tag [" << tag << "]"
+                      << endl;
+                return new MigrateInfo( ns, to, from, best );
             }
 
-            verify( false ); // should be impossible
+            if ( ! busiest.isEmpty() ) {
+                log() << " ns: " << ns << " chunk " << busiest << " on " << from
+                      << " is too busy to move, with " << busiestLoad << " operations"
+                      << ", going to split it" << endl;
+                *chunkToSplit = busiest.getOwned();
+                return NULL;
+            }
         }
 
-        // Everything is balanced here!
         return NULL;
     }
 
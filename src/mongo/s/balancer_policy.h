@@ -127,6 +127,22 @@ namespace mongo {
     typedef map< string,ShardInfo > ShardInfoMap;
     typedef map< string,vector<BSONObj> > ShardToChunksMap;
 
+    /**
+     * Documents read from and written to a chunk, as its shard counted them lately.
+     */
+    struct ChunkLoad {
+        ChunkLoad() : reads( 0 ), writes( 0 ), bytes( 0 ) {}
+
+        long long ops() const { return reads + writes; }
+
+        long long reads;
+        long long writes;
+        long long bytes;
+    };
+
+    // by chunk min
+    typedef map< BSONObj,ChunkLoad > ChunkLoadMap;
+
     class DistributionStatus : boost::noncopyable {
     public:
         DistributionStatus( const ShardInfoMap& shardInfo,
@@ -209,7 +225,39 @@ namespace mongo {
                                      const DistributionStatus& distribution,
                                      int balancedLastTime );
 
+        /**
+         * Like balance(), but once no chunk has to move off a draining shard or a shard without
+         * its tag, evens out the operations each shard serves rather than its chunk count.
+         *
+         * The chunk moved is the busiest one of the busiest shard that doesn't carry more load
+         * than would swap which shard is busiest.  When every chunk that would help is too busy
+         * for that, there is no move, and 'chunkToSplit' is set to the busiest chunk instead,
+         * to be split so that its halves can go separate ways.
+         *
+         * @param loads the load of the collection's chunks; a chunk missing has no load.
+         */
+        static MigrateInfo* balanceByLoad( const string& ns,
+                                           const DistributionStatus& distribution,
+                                           const ChunkLoadMap& loads,
+                                           BSONObj* chunkToSplit );
+
+        /**
+         * Moves to 'wave' the migrations in 'candidates', in order, that share neither their
+         * donor nor their recipient with one taken before them.  A shard can only be in one
+         * migration at a time, so the migrations of a wave can all run at once; the rest are
+         * left in 'candidates' for a later wave.
+         */
+        static void pickNonConflicting( vector<shared_ptr<MigrateInfo> >* candidates,
+                                        vector<shared_ptr<MigrateInfo> >* wave );
+
     private:
+        /**
+         * Returns a move off a draining shard or a shard without the chunk's tag, or NULL if
+         * there is nothing of the sort to do.
+         */
+        static MigrateInfo* _requiredMove( const string& ns,
+                                           const DistributionStatus& distribution );
+
         static bool _isJumbo( const BSONObj& chunk );
     };
 
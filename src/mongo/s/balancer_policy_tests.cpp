@@ -507,5 +507,138 @@ namespace mongo {
                 }
             }
         }
+
+        TEST( BalancerPolicyTests, PickNonConflicting ) {
+            BSONObj chunk = BSON( ChunkType::min( BSON( "x" << 0 ) ) <<
+                                  ChunkType::max( BSON( "x" << 10 ) ) );
+
+            vector<shared_ptr<MigrateInfo> > candidates;
+            candidates.push_back( shared_ptr<MigrateInfo>(
+                    new MigrateInfo( "a.a", "shard1", "shard0", chunk ) ) );
+            // shares its donor with the first
+            candidates.push_back( shared_ptr<MigrateInfo>(
+                    new MigrateInfo( "a.b", "shard2", "shard0", chunk ) ) );
+            candidates.push_back( shared_ptr<MigrateInfo>(
+                    new MigrateInfo( "a.c", "shard3", "shard2", chunk ) ) );
+            // sends to the first's donor
+            candidates.push_back( shared_ptr<MigrateInfo>(
+                    new MigrateInfo( "a.d", "shard0", "shard4", chunk ) ) );
+            candidates.push_back( shared_ptr<MigrateInfo>(
+                    new MigrateInfo( "a.e", "shard5", "shard4", chunk ) ) );
+
+            vector<shared_ptr<MigrateInfo> > wave;
+            BalancerPolicy::pickNonConflicting( &candidates, &wave );
+            ASSERT_EQUALS( 3U, wave.size() );
+            ASSERT_EQUALS( "a.a", wave[0]->ns );
+            ASSERT_EQUALS( "a.c", wave[1]->ns );
+            ASSERT_EQUALS( "a.e", wave[2]->ns );
+            ASSERT_EQUALS( 2U, candidates.size() );
+            ASSERT_EQUALS( "a.b", candidates[0]->ns );
+            ASSERT_EQUALS( "a.d", candidates[1]->ns );
+
+            // which still share shard0
+            wave.clear();
+            BalancerPolicy::pickNonConflicting( &candidates, &wave );
+            ASSERT_EQUALS( 1U, wave.size() );
+            ASSERT_EQUALS( "a.b", wave[0]->ns );
+            ASSERT_EQUALS( 1U, candidates.size() );
+        }
+
+        BSONObj loadTestChunk( int min, int max ) {
+            return BSON( ChunkType::min( BSON( "x" << min ) ) <<
+                         ChunkType::max( BSON( "x" << max ) ) );
+        }
+
+        void setLoad( ChunkLoadMap* loads, int min, long long reads, long long writes ) {
+            ChunkLoad& load = (*loads)[BSON( "x" << min )];
+            load.reads = reads;
+            load.writes = writes;
+        }
+
+        TEST( BalancerPolicyTests, BalanceByLoad ) {
+            // equal chunk counts, but shard0 serves most of the operations
+            ShardToChunksMap chunkMap;
+            chunkMap["shard0"].push_back( loadTestChunk( 0, 10 ) );
+            chunkMap["shard0"].push_back( loadTestChunk( 10, 20 ) );
+            chunkMap["shard0"].push_back( loadTestChunk( 20, 30 ) );
+            chunkMap["shard1"].push_back( loadTestChunk( 30, 40 ) );
+            chunkMap["shard1"].push_back( loadTestChunk( 40, 50 ) );
+            chunkMap["shard1"].push_back( loadTestChunk( 50, 60 ) );
+
+            ShardInfoMap info;
+            info["shard0"] = ShardInfo( 0, 0, false, false );
+            info["shard1"] = ShardInfo( 0, 0, false, false );
+            DistributionStatus status( info, chunkMap );
+
+            ASSERT( ! BalancerPolicy::balance( "ns", status, 0 ) );
+
+            ChunkLoadMap loads;
+            setLoad( &loads, 0, 4000, 1000 );
+            setLoad( &loads, 10, 2000, 0 );
+            setLoad( &loads, 20, 500, 0 );
+            setLoad( &loads, 30, 1000, 0 );
+
+            // the imbalance is 6500, so {x: 0} would swap which shard is busiest
+            BSONObj chunkToSplit;
+            scoped_ptr<MigrateInfo> m( BalancerPolicy::balanceByLoad( "ns", status, loads,
+                                                                      &chunkToSplit ) );
+            ASSERT( m );
+            ASSERT( chunkToSplit.isEmpty() );
+            ASSERT_EQUALS( "shard0", m->from );
+            ASSERT_EQUALS( "shard1", m->to );
+            ASSERT_EQUALS( BSON( "x" << 10 ), m->chunk.min );
+
+            // close enough
+            setLoad( &loads, 30, 6000, 0 );
+            m.reset( BalancerPolicy::balanceByLoad( "ns", status, loads, &chunkToSplit ) );
+            ASSERT( ! m );
+            ASSERT( chunkToSplit.isEmpty() );
+
+            // too little load to go by
+            ChunkLoadMap light;
+            setLoad( &light, 0, 500, 0 );
+            m.reset( BalancerPolicy::balanceByLoad( "ns", status, light, &chunkToSplit ) );
+            ASSERT( ! m );
+            ASSERT( chunkToSplit.isEmpty() );
+        }
+
+        TEST( BalancerPolicyTests, BalanceByLoadSplitsHotChunk ) {
+            ShardToChunksMap chunkMap;
+            chunkMap["shard0"].push_back( loadTestChunk( 0, 10 ) );
+            chunkMap["shard1"].push_back( loadTestChunk( 10, 20 ) );
+
+            ShardInfoMap info;
+            info["shard0"] = ShardInfo( 0, 0, false, false );
+            info["shard1"] = ShardInfo( 0, 0, false, false );
+            DistributionStatus status( info, chunkMap );
+
+            ChunkLoadMap loads;
+            setLoad( &loads, 0, 10000, 0 );
+            setLoad( &loads, 10, 100, 0 );
+
+            BSONObj chunkToSplit;
+            scoped_ptr<MigrateInfo> m( BalancerPolicy::balanceByLoad( "ns", status, loads,
+                                                                      &chunkToSplit ) );
+            ASSERT( ! m );
+            ASSERT_EQUALS( loadTestChunk( 0, 10 ), chunkToSplit );
+        }
+
+        TEST( BalancerPolicyTests, BalanceByLoadDrainsFirst ) {
+            ShardToChunksMap chunkMap;
+            chunkMap["shard0"].push_back( loadTestChunk( 0, 10 ) );
+            chunkMap["shard1"];
+
+            ShardInfoMap info;
+            info["shard0"] = ShardInfo( 0, 0, true, false );
+            info["shard1"] = ShardInfo( 0, 0, false, false );
+            DistributionStatus status( info, chunkMap );
+
+            BSONObj chunkToSplit;
+            scoped_ptr<MigrateInfo> m( BalancerPolicy::balanceByLoad( "ns", status,
+                                                                      ChunkLoadMap(),
+                                                                      &chunkToSplit ) );
+            ASSERT( m );
+            ASSERT_EQUALS( "shard1", m->to );
+        }
     }
 }
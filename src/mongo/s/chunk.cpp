@@ -34,8 +34,10 @@
 
 #include "mongo/client/connpool.h"
 #include "mongo/client/dbclientcursor.h"
+#include "mongo/db/hasher.h"
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/queryutil.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/platform/random.h"
 #include "mongo/s/chunk_diff.h"
 #include "mongo/s/chunk_version.h"
@@ -154,6 +156,10 @@ namespace mongo {
         return _manager->getShardKey().extractKey( end );
     }
 
+    // Whether to ask shards for split points estimated from the shard key index's upper levels,
+    // which reads a few buckets instead of every key of the chunk.
+    MONGO_EXPORT_SERVER_PARAMETER(sampleSplitPoints, bool, false);
+
     void Chunk::pickMedianKey( BSONObj& medianKey ) const {
         // Ask the mongod holding this chunk to figure out the split points.
         ScopedDbConnection conn(getShard().getConnString());
@@ -164,6 +170,8 @@ namespace mongo {
         cmd.append( "min" , getMin() );
         cmd.append( "max" , getMax() );
         cmd.appendBool( "force" , true );
+        if ( sampleSplitPoints )
+            cmd.appendBool( "sampled" , true );
         BSONObj cmdObj = cmd.obj();
 
         if ( ! conn->runCommand( "admin" , cmdObj , result )) {
@@ -193,6 +201,8 @@ namespace mongo {
         cmd.append( "maxChunkSizeBytes" , chunkSize );
         cmd.append( "maxSplitPoints" , maxPoints );
         cmd.append( "maxChunkObjects" , maxObjs );
+        if ( sampleSplitPoints )
+            cmd.appendBool( "sampled" , true );
         BSONObj cmdObj = cmd.obj();
 
         if ( ! conn->runCommand( "admin" , cmdObj , result )) {
@@ -610,11 +620,20 @@ namespace mongo {
 
     AtomicUInt ChunkManager::NextSequenceNumber = 1;
 
+    static string hashedFieldOf( const ShardKeyPattern& key ) {
+        BSONObj pattern = key.key();
+        if ( pattern.nFields() != 1 || ! str::equals( pattern.firstElement().valuestrsafe(),
+                                                      "hashed" ) )
+            return "";
+        return pattern.firstElementFieldName();
+    }
+
     ChunkManager::ChunkManager( const string& ns, const ShardKeyPattern& pattern , bool unique ) :
         _ns( ns ),
         _key( pattern ),
         _unique( unique ),
         _chunkRanges(),
+        _hashedField( hashedFieldOf( _key ) ),
         _mutex("ChunkManager"),
         _sequenceNumber(++NextSequenceNumber)
     {
@@ -634,6 +653,7 @@ namespace mongo {
                                                         BSONObj()),
         _unique(collDoc[CollectionType::unique()].trueValue()),
         _chunkRanges(),
+        _hashedField( hashedFieldOf( _key ) ),
         _mutex("ChunkManager"),
         // The shard versioning mechanism hinges on keeping track of the number of times we reloaded ChunkManager's.
         // Increasing this number here will prompt checkShardVersion() to refresh the connection-level versions to
@@ -656,6 +676,7 @@ namespace mongo {
         _key( oldManager->getShardKey() ),
         _unique( oldManager->isUnique() ),
         _chunkRanges(),
+        _hashedField( hashedFieldOf( _key ) ),
         _mutex("ChunkManager"),
         _sequenceNumber(++NextSequenceNumber)
     {
@@ -697,6 +718,7 @@ namespace mongo {
                     const_cast<set<Shard>&>(_shards).swap(shards);
                     const_cast<ShardVersionMap&>(_shardVersions).swap(shardVersions);
                     const_cast<ChunkRangeManager&>(_chunkRanges).reloadAll(_chunkMap);
+                    _loadChunkBounds();
 
                     // Once we load data, clear reference to old manager
                     _oldManager.reset();
@@ -779,11 +801,13 @@ namespace mongo {
             shardVersions = oldManager->_shardVersions;
 
             // Load a copy of the chunk map, replacing the chunk manager with our own
-            const ChunkMap& oldChunkMap = oldManager->getChunkMap();
+            const ChunkMap& oldChunkMap = oldManager->_chunkMap;
 
             // Could be v.expensive
             // TODO: If chunks were immutable and didn't reference the manager, we could do more
             // interesting things here
+            // The old map is already in order, so every insert goes at the end without a search
+            // and only the ranges the diff below touches are compared against.
             for( ChunkMap::const_iterator it = oldChunkMap.begin(); it != oldChunkMap.end(); it++ ){
 
                 ChunkPtr oldC = it->second;
@@ -794,7 +818,7 @@ namespace mongo {
 
                 c->setBytesWritten( oldC->getBytesWritten() );
 
-                chunkMap.insert( make_pair( oldC->getMax(), c ) );
+                chunkMap.insert( chunkMap.end(), make_pair( oldC->getMax(), c ) );
             }
 
             // Also get any minor versions stored for reload
@@ -1067,7 +1091,28 @@ namespace mongo {
         _version = ChunkVersion( 0, version.epoch() );
     }
 
+    void ChunkManager::_loadChunkBounds() {
+        vector<ChunkPtr>& chunks = const_cast<vector<ChunkPtr>&>(_chunksByMax);
+        chunks.clear();
+        chunks.reserve(_chunkMap.size());
+
+        vector<BSONObj> maxes;
+        maxes.reserve(_chunkMap.size());
+        for (ChunkMap::const_iterator it = _chunkMap.begin(); it != _chunkMap.end(); ++it) {
+            chunks.push_back(it->second);
+            maxes.push_back(it->first);
+        }
+        const_cast<ChunkBoundsIndex&>(_chunkBounds).reset(maxes);
+    }
+
     ChunkPtr ChunkManager::findIntersectingChunk( const BSONObj& point ) const {
+        int pos = _chunkBounds.find( point );
+        if ( pos >= 0 ) {
+            const ChunkPtr& c = _chunksByMax[pos];
+            dassert( c->containsPoint( point ) );
+            return c;
+        }
+
         {
             BSONObj foo;
             ChunkPtr c;
@@ -1102,6 +1147,16 @@ namespace mongo {
     }
 
     ChunkPtr ChunkManager::findChunkForDoc( const BSONObj& doc ) const {
+        // Hashed shard keys are always split on their hashes, so once the bounds are indexed
+        // the hash needn't be built into a key object and compared as one
+        if ( ! _hashedField.empty() && _chunkBounds.isUsable() ) {
+            long long hash = BSONElementHasher::hash64( doc.getFieldDotted( _hashedField ),
+                                                        BSONElementHasher::DEFAULT_HASH_SEED );
+            const ChunkPtr& c = _chunksByMax[_chunkBounds.find( hash )];
+            dassert( c->containsPoint( _key.extractKey( doc ) ) );
+            return c;
+        }
+
         BSONObj key = _key.extractKey( doc );
         return findIntersectingChunk( key );
     }
@@ -1170,6 +1225,62 @@ namespace mongo {
         }
     }
 
+    bool ChunkManager::restrictInToShard( const BSONObj& query, const Shard& shard,
+                                          BSONObj* restricted ) const {
+        const BSONElement keyField = _key.key().firstElement();
+        if ( _key.key().nFields() != 1 || ! keyField.isNumber() )
+            return false;
+
+        const BSONElement pred = query[keyField.fieldName()];
+        if ( pred.type() != Object )
+            return false;
+        const BSONObj predObj = pred.Obj();
+        if ( predObj.nFields() != 1 || ! str::equals( predObj.firstElementFieldName(), "$in" ) ||
+                predObj.firstElement().type() != Array )
+            return false;
+
+        BSONArrayBuilder values;
+        int numValues = 0;
+        int numKept = 0;
+        BSONForEach( value, predObj.firstElement().Obj() ) {
+            // a regex matches by pattern and an array by its elements, so they can't be placed
+            // by value; MinKey and MaxKey aren't inside any chunk
+            if ( value.type() == RegEx || value.type() == Array ||
+                    value.type() == MinKey || value.type() == MaxKey )
+                return false;
+
+            numValues++;
+            BSONObjBuilder point;
+            point.appendAs( value, keyField.fieldName() );
+            if ( findIntersectingChunk( point.obj() )->getShard() != shard )
+                continue;
+
+            values.append( value );
+            numKept++;
+        }
+
+        // the shard was targeted through FieldRangeSet bounds; if none of the values land on it
+        // after all, send the query as it is rather than an empty $in
+        if ( numKept == numValues || numKept == 0 )
+            return false;
+
+        BSONObjBuilder b;
+        bool replaced = false;
+        BSONForEach( e, query ) {
+            if ( ! replaced && str::equals( e.fieldName(), keyField.fieldName() ) ) {
+                BSONObjBuilder in( b.subobjStart( e.fieldName() ) );
+                in.append( "$in", values.arr() );
+                in.done();
+                replaced = true;
+            }
+            else {
+                b.append( e );
+            }
+        }
+        *restricted = b.obj();
+        return true;
+    }
+
     void ChunkManager::getShardsForRange( set<Shard>& shards,
                                           const BSONObj& min,
                                           const BSONObj& max ) const {
@@ -1373,7 +1484,7 @@ namespace mongo {
             }
 
             // Make sure we match the original chunks
-            const ChunkMap chunks = _ranges.begin()->second->getManager()->_chunkMap;
+            const ChunkMap& chunks = _ranges.begin()->second->getManager()->_chunkMap;
             for ( ChunkMap::const_iterator i=chunks.begin(); i!=chunks.end(); ++i ) {
                 const ChunkPtr chunk = i->second;
 
@@ -1414,7 +1525,7 @@ namespace mongo {
                 ++begin;
 
             shared_ptr<ChunkRange> cr (new ChunkRange(first, begin));
-            _ranges[cr->getMax()] = cr;
+            _ranges.insert(_ranges.end(), make_pair(cr->getMax(), cr));
         }
     }
 
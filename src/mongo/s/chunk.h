@@ -33,6 +33,7 @@
 #include "mongo/base/string_data.h"
 #include "mongo/bson/util/atomic_int.h"
 #include "mongo/client/distlock.h"
+#include "mongo/s/chunk_bounds_index.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/shard.h"
 #include "mongo/s/shardkey.h"
@@ -420,11 +421,22 @@ namespace mongo {
         ChunkPtr findChunkOnServer( const Shard& shard ) const;
 
         void getShardsForQuery( set<Shard>& shards , const BSONObj& query ) const;
+
+        /**
+         * If 'query' has a top level { <shard key>: { $in: [...] } } over a single field, ranged
+         * shard key, sets 'restricted' to the query with only the $in values whose chunks are on
+         * 'shard' -- the only ones that can match documents there.
+         * @return false, leaving 'restricted' alone, if there's nothing to cut out
+         */
+        bool restrictInToShard( const BSONObj& query, const Shard& shard,
+                                BSONObj* restricted ) const;
         void getAllShards( set<Shard>& all ) const;
         /** @param shards set to the shards covered by the interval [min, max], see SERVER-4791 */
         void getShardsForRange( set<Shard>& shards, const BSONObj& min, const BSONObj& max ) const;
 
-        ChunkMap getChunkMap() const { return _chunkMap; }
+        // the map is const for the life of the manager, so callers holding a ChunkManagerPtr
+        // can iterate it without a copy
+        const ChunkMap& getChunkMap() const { return _chunkMap; }
 
         /**
          * Returns true if, for this shard, the chunks are identical in both chunk managers
@@ -466,6 +478,9 @@ namespace mongo {
                                     ShardVersionMap& shardVersions, ChunkManagerPtr oldManager);
         static bool _isValid(const ChunkMap& chunks);
 
+        // builds _chunkBounds and _chunksByMax from _chunkMap
+        void _loadChunkBounds();
+
         // end helpers
 
         // All members should be const for thread-safety
@@ -476,6 +491,15 @@ namespace mongo {
         const ChunkMap _chunkMap;
         const ChunkRangeManager _chunkRanges;
 
+        // Routes the shard keys it can without going through _chunkMap; the chunks, in the
+        // same order as their bounds there
+        const ChunkBoundsIndex _chunkBounds;
+        const vector<ChunkPtr> _chunksByMax;
+
+        // the field of a single field hashed shard key, whose hashes are routed through
+        // _chunkBounds without building the key; empty for other shard keys
+        const string _hashedField;
+
         const set<Shard> _shards;
 
         const ShardVersionMap _shardVersions; // max version per shard
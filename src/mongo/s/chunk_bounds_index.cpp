@@ -0,0 +1,99 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/s/chunk_bounds_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mongo {
+
+    ChunkBoundsIndex::ChunkBoundsIndex() : _usable(false) {
+    }
+
+    void ChunkBoundsIndex::reset(const std::vector<BSONObj>& maxes) {
+        _bounds.clear();
+        _usable = false;
+
+        if (maxes.empty() || maxes.back().nFields() != 1 ||
+                maxes.back().firstElement().type() != MaxKey)
+            return;
+
+        std::vector<long long> bounds;
+        bounds.reserve(maxes.size() - 1);
+        for (size_t i = 0; i + 1 < maxes.size(); i++) {
+            long long bound;
+            if (!toIntegralKey(maxes[i], &bound))
+                return;
+            bounds.push_back(bound);
+        }
+
+        _bounds.swap(bounds);
+        _usable = true;
+    }
+
+    int ChunkBoundsIndex::find(const BSONObj& point) const {
+        long long key;
+        if (!_usable || !toIntegralKey(point, &key))
+            return -1;
+        return find(key);
+    }
+
+    int ChunkBoundsIndex::find(long long key) const {
+        // a chunk contains keys from its min up to, but not including, its max
+        return std::upper_bound(_bounds.begin(), _bounds.end(), key) - _bounds.begin();
+    }
+
+    bool ChunkBoundsIndex::toIntegralKey(const BSONObj& key, long long* out) {
+        if (key.nFields() != 1)
+            return false;
+
+        const BSONElement e = key.firstElement();
+        switch (e.type()) {
+        case NumberInt:
+            *out = e._numberInt();
+            return true;
+        case NumberLong:
+            *out = e._numberLong();
+            return true;
+        case NumberDouble: {
+            // Only doubles holding an integer convert.  BSON compares a double with a long by
+            // converting the long to a double, which rounds longs beyond 2^53; a double below
+            // that in magnitude still orders against them as the exact integers would.
+            const double d = e._numberDouble();
+            if (!(std::fabs(d) < 9007199254740992.0) || d != std::floor(d))
+                return false;
+            *out = static_cast<long long>(d);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+} // namespace mongo
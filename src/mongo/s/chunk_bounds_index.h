@@ -0,0 +1,89 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * The upper bounds of a collection's chunks, in shard key order, for routing a shard key to
+     * its chunk without BSONObj::woCompare.
+     *
+     * Routing a bulk insert through a collection of many chunks used to cost a ChunkMap lookup
+     * per document, each comparing whole BSONObjs a few dozen times.  When the shard key has a
+     * single field and the chunks are split on integral numbers (every hashed shard key, and
+     * the usual numeric ones), the bounds are kept here as a plain sorted array of long longs,
+     * and a key is routed with a binary search over it.  Other shard keys, and keys that aren't
+     * integral numbers, aren't handled here and go through the ChunkMap as before.
+     */
+    class ChunkBoundsIndex {
+    public:
+        ChunkBoundsIndex();
+
+        /**
+         * Indexes the upper bounds 'maxes' of a collection's chunks, in order.  The last bound
+         * must be MaxKey.  Leaves the index empty unless every other bound is a single integral
+         * number.
+         */
+        void reset(const std::vector<BSONObj>& maxes);
+
+        /** whether reset() indexed the bounds */
+        bool isUsable() const { return _usable; }
+
+        /**
+         * @return the position, in the bounds given to reset(), of the chunk containing the
+         *         shard key 'point', or -1 if 'point' isn't an integral number the index can
+         *         route, or the index isn't usable.
+         */
+        int find(const BSONObj& point) const;
+
+        /**
+         * @return the position of the chunk containing the integral shard key 'key', which
+         *         needn't be built into a BSONObj first, e.g. the hash of a hashed shard key.
+         *         Only valid if the index is usable.
+         */
+        int find(long long key) const;
+
+        /**
+         * Converts a single field key holding an int, a long, or a double with an integral
+         * value under 2^53 in magnitude, to that number.  The conversion preserves the keys'
+         * BSON order.
+         */
+        static bool toIntegralKey(const BSONObj& key, long long* out);
+
+    private:
+        // all the bounds but the last, MaxKey
+        std::vector<long long> _bounds;
+        bool _usable;
+    };
+
+} // namespace mongo
@@ -0,0 +1,135 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/s/chunk_bounds_index.h"
+
+#include <limits>
+#include <vector>
+
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using mongo::BSONObj;
+    using mongo::ChunkBoundsIndex;
+    using mongo::MAXKEY;
+    using mongo::MINKEY;
+    using std::vector;
+
+    // bounds for chunks [MinKey, -100) [-100, 0) [0, 100) [100, 1<<40) [1<<40, MaxKey)
+    vector<BSONObj> numericMaxes() {
+        vector<BSONObj> maxes;
+        maxes.push_back(BSON("x" << -100));
+        maxes.push_back(BSON("x" << 0.0));
+        maxes.push_back(BSON("x" << 100LL));
+        maxes.push_back(BSON("x" << (1LL << 40)));
+        maxes.push_back(BSON("x" << MAXKEY));
+        return maxes;
+    }
+
+    TEST(ChunkBoundsIndex, RoutesIntegralKeys) {
+        ChunkBoundsIndex index;
+        index.reset(numericMaxes());
+        ASSERT_TRUE(index.isUsable());
+
+        ASSERT_EQUALS(0, index.find(BSON("x" << -101)));
+        ASSERT_EQUALS(1, index.find(BSON("x" << -100)));
+        ASSERT_EQUALS(1, index.find(BSON("x" << -1LL)));
+        ASSERT_EQUALS(2, index.find(BSON("x" << 0)));
+        ASSERT_EQUALS(2, index.find(BSON("x" << 99.0)));
+        ASSERT_EQUALS(3, index.find(BSON("x" << 100)));
+        ASSERT_EQUALS(3, index.find(BSON("x" << ((1LL << 40) - 1))));
+        ASSERT_EQUALS(4, index.find(BSON("x" << (1LL << 40))));
+        ASSERT_EQUALS(4, index.find(BSON("x" << (1LL << 62))));
+    }
+
+    TEST(ChunkBoundsIndex, RoutesRawKeys) {
+        ChunkBoundsIndex index;
+        index.reset(numericMaxes());
+
+        ASSERT_EQUALS(0, index.find(-101LL));
+        ASSERT_EQUALS(1, index.find(-100LL));
+        ASSERT_EQUALS(2, index.find(0LL));
+        ASSERT_EQUALS(3, index.find((1LL << 40) - 1));
+        ASSERT_EQUALS(4, index.find(std::numeric_limits<long long>::max()));
+        ASSERT_EQUALS(0, index.find(std::numeric_limits<long long>::min()));
+    }
+
+    TEST(ChunkBoundsIndex, LeavesOtherKeysToTheCaller) {
+        ChunkBoundsIndex index;
+        index.reset(numericMaxes());
+
+        ASSERT_EQUALS(-1, index.find(BSON("x" << 1.5)));
+        ASSERT_EQUALS(-1, index.find(BSON("x" << 1e300)));
+        ASSERT_EQUALS(-1, index.find(BSON("x" << "a")));
+        ASSERT_EQUALS(-1, index.find(BSON("x" << MINKEY)));
+        ASSERT_EQUALS(-1, index.find(BSON("x" << 1 << "y" << 1)));
+    }
+
+    TEST(ChunkBoundsIndex, SingleChunk) {
+        vector<BSONObj> maxes;
+        maxes.push_back(BSON("x" << MAXKEY));
+
+        ChunkBoundsIndex index;
+        index.reset(maxes);
+        ASSERT_TRUE(index.isUsable());
+        ASSERT_EQUALS(0, index.find(BSON("x" << 5)));
+    }
+
+    TEST(ChunkBoundsIndex, UnusableForOtherBounds) {
+        ChunkBoundsIndex index;
+
+        vector<BSONObj> strings;
+        strings.push_back(BSON("x" << "m"));
+        strings.push_back(BSON("x" << MAXKEY));
+        index.reset(strings);
+        ASSERT_FALSE(index.isUsable());
+        ASSERT_EQUALS(-1, index.find(BSON("x" << 1)));
+
+        vector<BSONObj> compound;
+        compound.push_back(BSON("x" << 1 << "y" << 1));
+        compound.push_back(BSON("x" << MAXKEY << "y" << MAXKEY));
+        index.reset(compound);
+        ASSERT_FALSE(index.isUsable());
+
+        // becomes usable again with integral bounds
+        index.reset(numericMaxes());
+        ASSERT_TRUE(index.isUsable());
+    }
+
+    TEST(ChunkBoundsIndex, DoublesOrderAsBSONDoes) {
+        long long key;
+        ASSERT_TRUE(ChunkBoundsIndex::toIntegralKey(BSON("x" << -0.0), &key));
+        ASSERT_EQUALS(0LL, key);
+        ASSERT_TRUE(ChunkBoundsIndex::toIntegralKey(BSON("x" << 9007199254740991.0), &key));
+        ASSERT_EQUALS(9007199254740991LL, key);
+        // BSON compares longs with doubles this big through rounding
+        ASSERT_FALSE(ChunkBoundsIndex::toIntegralKey(BSON("x" << 9007199254740992.0), &key));
+    }
+
+} // namespace
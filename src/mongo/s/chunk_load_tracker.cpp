@@ -0,0 +1,127 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/s/chunk_load_tracker.h"
+
+#include "mongo/db/server_parameters.h"
+#include "mongo/s/collection_metadata.h"
+
+namespace mongo {
+
+    // Off by default: every counted document takes the tracker's mutex.
+    MONGO_EXPORT_SERVER_PARAMETER(trackChunkLoad, bool, false);
+
+    ChunkLoadTracker chunkLoadTracker;
+
+    ChunkLoadTracker::ChunkLoadTracker() : _mutex("ChunkLoadTracker") {
+    }
+
+    bool ChunkLoadTracker::isEnabled() {
+        return trackChunkLoad;
+    }
+
+    void ChunkLoadTracker::noteRead(const CollectionMetadata& metadata,
+                                    const BSONObj& key,
+                                    int bytes) {
+        if (!isEnabled())
+            return;
+
+        BSONObj chunkMin = metadata.getChunkMinFor(key);
+        if (!chunkMin.isEmpty())
+            _note(metadata.getCollVersion().epoch(), chunkMin, bytes, false);
+    }
+
+    void ChunkLoadTracker::noteWrite(const CollectionMetadata& metadata,
+                                     const BSONObj& key,
+                                     int bytes) {
+        if (!isEnabled())
+            return;
+
+        BSONObj chunkMin = metadata.getChunkMinFor(key);
+        if (!chunkMin.isEmpty())
+            _note(metadata.getCollVersion().epoch(), chunkMin, bytes, true);
+    }
+
+    void ChunkLoadTracker::noteRead(const OID& epoch, const BSONObj& chunkMin, int bytes) {
+        if (isEnabled())
+            _note(epoch, chunkMin, bytes, false);
+    }
+
+    void ChunkLoadTracker::noteWrite(const OID& epoch, const BSONObj& chunkMin, int bytes) {
+        if (isEnabled())
+            _note(epoch, chunkMin, bytes, true);
+    }
+
+    void ChunkLoadTracker::_note(const OID& epoch,
+                                 const BSONObj& chunkMin,
+                                 int bytes,
+                                 bool isWrite) {
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        ChunkLoads& chunks = _collections[epoch];
+        ChunkLoads::iterator it = chunks.find(chunkMin);
+        if (it == chunks.end()) {
+            // the min belongs to the metadata of a query that may outlive it
+            it = chunks.insert(make_pair(chunkMin.getOwned(), Load())).first;
+        }
+
+        if (isWrite)
+            it->second.writes++;
+        else
+            it->second.reads++;
+        it->second.bytes += bytes;
+    }
+
+    void ChunkLoadTracker::report(const OID& epoch, BSONArrayBuilder* chunks) {
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        CollectionLoads::iterator coll = _collections.find(epoch);
+        if (coll == _collections.end())
+            return;
+
+        for (ChunkLoads::iterator it = coll->second.begin(); it != coll->second.end();) {
+            ChunkLoads::iterator current = it++;
+            Load& load = current->second;
+
+            chunks->append(BSON("min" << current->first <<
+                                "reads" << load.reads <<
+                                "writes" << load.writes <<
+                                "bytes" << load.bytes));
+
+            load.reads /= 2;
+            load.writes /= 2;
+            load.bytes /= 2;
+            if (load.reads == 0 && load.writes == 0)
+                coll->second.erase(current);
+        }
+
+        if (coll->second.empty())
+            _collections.erase(coll);
+    }
+
+}  // namespace mongo
@@ -0,0 +1,98 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <map>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/bson/oid.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    class CollectionMetadata;
+
+    /**
+     * Counts, for each chunk this shard owns, the documents read from and written to it and
+     * their bytes, so that the balancer can spread load across shards rather than chunks.
+     *
+     * Reads are counted as they pass the shard filter of a versioned query, and writes as
+     * inserts and updates are logged; deletes only log the _id, so they aren't counted.
+     * Counters are kept per collection epoch, so a dropped or resharded collection starts
+     * anew.  Nothing is counted unless the trackChunkLoad server parameter is set.
+     */
+    class ChunkLoadTracker {
+        MONGO_DISALLOW_COPYING(ChunkLoadTracker);
+    public:
+        ChunkLoadTracker();
+
+        /** whether noteRead and noteWrite count anything */
+        static bool isEnabled();
+
+        /** counts a document read from the chunk of 'metadata' holding the shard key 'key' */
+        void noteRead(const CollectionMetadata& metadata, const BSONObj& key, int bytes);
+
+        /** counts a document written to the chunk of 'metadata' holding the shard key 'key' */
+        void noteWrite(const CollectionMetadata& metadata, const BSONObj& key, int bytes);
+
+        void noteRead(const OID& epoch, const BSONObj& chunkMin, int bytes);
+        void noteWrite(const OID& epoch, const BSONObj& chunkMin, int bytes);
+
+        /**
+         * Appends { min: ..., reads: ..., writes: ..., bytes: ... } to 'chunks' for each chunk
+         * of the collection with 'epoch' that saw any load, then halves the counters, so that
+         * load a report has seen fades over the next few.
+         */
+        void report(const OID& epoch, BSONArrayBuilder* chunks);
+
+    private:
+        struct Load {
+            Load() : reads(0), writes(0), bytes(0) {}
+
+            long long reads;
+            long long writes;
+            long long bytes;
+        };
+
+        // by chunk min
+        typedef std::map<BSONObj, Load> ChunkLoads;
+        typedef std::map<OID, ChunkLoads> CollectionLoads;
+
+        void _note(const OID& epoch, const BSONObj& chunkMin, int bytes, bool isWrite);
+
+        // protects everything below
+        SimpleMutex _mutex;
+
+        CollectionLoads _collections;
+    };
+
+    extern ChunkLoadTracker chunkLoadTracker;
+
+}  // namespace mongo
@@ -0,0 +1,101 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/s/chunk_load_tracker.h"
+
+#include "mongo/db/server_parameters.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using mongo::BSONArrayBuilder;
+    using mongo::BSONObj;
+    using mongo::ChunkLoadTracker;
+    using mongo::OID;
+    using mongo::ServerParameterSet;
+
+    void setTracking(bool enabled) {
+        const ServerParameterSet::Map& params = ServerParameterSet::getGlobal()->getMap();
+        ServerParameterSet::Map::const_iterator it = params.find("trackChunkLoad");
+        ASSERT(it != params.end());
+        ASSERT_OK(it->second->setFromString(enabled ? "true" : "false"));
+    }
+
+    BSONObj report(ChunkLoadTracker* tracker, const OID& epoch) {
+        BSONArrayBuilder chunks;
+        tracker->report(epoch, &chunks);
+        return chunks.arr();
+    }
+
+    TEST(ChunkLoadTracker, CountsNothingWhenDisabled) {
+        setTracking(false);
+        ChunkLoadTracker tracker;
+        OID epoch = OID::gen();
+        tracker.noteRead(epoch, BSON("x" << 0), 100);
+        tracker.noteWrite(epoch, BSON("x" << 0), 100);
+        ASSERT(report(&tracker, epoch).isEmpty());
+    }
+
+    TEST(ChunkLoadTracker, CountsPerChunk) {
+        setTracking(true);
+        ChunkLoadTracker tracker;
+        OID epoch = OID::gen();
+        tracker.noteRead(epoch, BSON("x" << 0), 100);
+        tracker.noteRead(epoch, BSON("x" << 0), 50);
+        tracker.noteWrite(epoch, BSON("x" << 0), 10);
+        tracker.noteWrite(epoch, BSON("x" << 10), 20);
+
+        // other collections don't show
+        tracker.noteWrite(OID::gen(), BSON("x" << 0), 20);
+
+        BSONObj chunks = report(&tracker, epoch);
+        ASSERT_EQUALS(BSON_ARRAY(BSON("min" << BSON("x" << 0) << "reads" << 2LL <<
+                                      "writes" << 1LL << "bytes" << 160LL) <<
+                                 BSON("min" << BSON("x" << 10) << "reads" << 0LL <<
+                                      "writes" << 1LL << "bytes" << 20LL)),
+                      chunks);
+        setTracking(false);
+    }
+
+    TEST(ChunkLoadTracker, ReportsFade) {
+        setTracking(true);
+        ChunkLoadTracker tracker;
+        OID epoch = OID::gen();
+        for (int i = 0; i < 4; i++)
+            tracker.noteRead(epoch, BSON("x" << 0), 10);
+
+        ASSERT_EQUALS(4, report(&tracker, epoch)[0]["reads"].numberLong());
+        ASSERT_EQUALS(2, report(&tracker, epoch)[0]["reads"].numberLong());
+        ASSERT_EQUALS(1, report(&tracker, epoch)[0]["reads"].numberLong());
+
+        // nothing left to report
+        ASSERT(report(&tracker, epoch).isEmpty());
+        setTracking(false);
+    }
+
+}  // namespace
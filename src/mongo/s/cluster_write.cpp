@@ -40,6 +40,7 @@
 #include "mongo/s/dbclient_multi_command.h"
 #include "mongo/s/dbclient_shard_resolver.h"
 #include "mongo/s/grid.h"
+#include "mongo/s/query_result_cache.h"
 #include "mongo/s/write_ops/batch_write_exec.h"
 #include "mongo/s/write_ops/config_coordinator.h"
 #include "mongo/util/net/hostandport.h"
@@ -279,6 +280,8 @@ namespace mongo {
             return;
         }
 
+        QueryResultCache::WriteScope cacheWrite( &queryResultCache, ns.ns() );
+
         // Config writes and shard writes are done differently
         string dbName = ns.db().toString();
         if ( dbName == "config" || dbName == "admin" ) {
@@ -466,6 +466,17 @@ namespace mongo {
         return good;
     }
 
+    BSONObj CollectionMetadata::getChunkMinFor( const BSONObj& key ) const {
+        if ( _chunksMap.empty() ) {
+            return BSONObj();
+        }
+
+        RangeMap::const_iterator it = _chunksMap.upper_bound( key );
+        if ( it != _chunksMap.begin() ) it--;
+
+        return rangeContains( it->first, it->second, key ) ? it->first : BSONObj();
+    }
+
     bool CollectionMetadata::keyIsPending( const BSONObj& key ) const {
         // If we aren't sharded, then the key is never pending (though it belongs-to-me)
         if ( _keyPattern.isEmpty() ) {
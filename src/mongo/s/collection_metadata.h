@@ -150,6 +150,12 @@ namespace mongo {
          */
         bool keyIsPending( const BSONObj& key ) const;
 
+        /**
+         * Returns the min of the chunk of this shard that 'key' falls in, or an empty object if
+         * no chunk does.  Key must be the full shard key.
+         */
+        BSONObj getChunkMinFor( const BSONObj& key ) const;
+
         /**
          * Given a key 'lookupKey' in the shard key range, get the next chunk which overlaps or is
          * greater than this key.  Returns true if a chunk exists, false otherwise.
@@ -191,6 +197,14 @@ namespace mongo {
             return _keyPattern;
         }
 
+        /**
+         * Returns the ranges of contiguous chunks this shard owns, keyed by their min. Pending
+         * chunks are not included.
+         */
+        const RangeMap& getOwnedRanges() const {
+            return _rangesMap;
+        }
+
         const std::vector<FieldRef*>& getKeyPatternFields() const {
             return _keyFields.vector();
         }
@@ -1131,6 +1131,15 @@ namespace {
         ASSERT_FALSE( getCollMetadata().keyBelongsToMe(BSON("a" << MAXKEY)) );
     }
 
+    TEST_F(ThreeChunkWithRangeGapFixture, ChunkMinForKey) {
+        ASSERT_EQUALS( BSON("a" << MINKEY), getCollMetadata().getChunkMinFor(BSON("a" << 5)) );
+        ASSERT_EQUALS( BSON("a" << 10), getCollMetadata().getChunkMinFor(BSON("a" << 10)) );
+        ASSERT_EQUALS( BSON("a" << 10), getCollMetadata().getChunkMinFor(BSON("a" << 19)) );
+        ASSERT_EQUALS( BSON("a" << 30), getCollMetadata().getChunkMinFor(BSON("a" << 40)) );
+        ASSERT( getCollMetadata().getChunkMinFor(BSON("a" << 25)).isEmpty() );
+        ASSERT( getCollMetadata().getChunkMinFor(BSON("a" << MAXKEY)).isEmpty() );
+    }
+
     TEST_F(ThreeChunkWithRangeGapFixture, GetNextFromEmpty) {
         ChunkType nextChunk;
         ASSERT( getCollMetadata().getNextChunk( getCollMetadata().getMinKey(), &nextChunk ) );
@@ -0,0 +1,821 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include <boost/thread/thread.hpp>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mongo/base/init.h"
+#include "mongo/client/connpool.h"
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/client/distlock.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/index_names.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/s/chunk.h"
+#include "mongo/s/cluster_write.h"
+#include "mongo/s/config.h"
+#include "mongo/s/grid.h"
+#include "mongo/s/shard.h"
+#include "mongo/s/shard_key_pattern.h"
+#include "mongo/s/type_chunk.h"
+#include "mongo/s/type_collection.h"
+#include "mongo/s/type_tags.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    namespace {
+
+        // Documents copied to the new collection per write through the cluster
+        const size_t kCopyBatchDocs = 1000;
+        const int kCopyBatchBytes = 8 * 1024 * 1024;
+
+        // Writes per batch when applying the donors' changes
+        const size_t kApplyBatchOps = 1000;
+
+        // Rounds of catching up with the donors' changes before the cutover, and how few
+        // changes a round must find for the cutover to go ahead early
+        const int kMaxCatchUpRounds = 10;
+        const long long kCutoverMaxChanges = 100;
+
+        bool writeOk( const BatchedCommandResponse& response,
+                      bool ignoreDuplicates,
+                      string* errMsg ) {
+            if ( !response.getOk() ) {
+                *errMsg = response.getErrMessage();
+                return false;
+            }
+
+            if ( response.isErrDetailsSet() ) {
+                const vector<WriteErrorDetail*>& errors = response.getErrDetails();
+                for ( size_t i = 0; i < errors.size(); ++i ) {
+                    if ( ignoreDuplicates && errors[i]->getErrCode() == ErrorCodes::DuplicateKey )
+                        continue;
+                    *errMsg = errors[i]->getErrMessage();
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * Inserts 'docs' through the cluster. A document copied twice by a scan that saw it
+         * move is a duplicate _id and may be ignored; the donor's changes fix it up later.
+         */
+        bool insertThroughCluster( const string& ns,
+                                   const vector<BSONObj>& docs,
+                                   bool ignoreDuplicates,
+                                   string* errMsg ) {
+            for ( size_t i = 0; i < docs.size(); i += kApplyBatchOps ) {
+                auto_ptr<BatchedInsertRequest> insert( new BatchedInsertRequest() );
+                for ( size_t j = i; j < docs.size() && j < i + kApplyBatchOps; ++j ) {
+                    insert->addToDocuments( docs[j] );
+                }
+
+                BatchedCommandRequest request( insert.release() );
+                request.setNS( ns );
+                request.setOrdered( false );
+
+                BatchedCommandResponse response;
+                clusterWrite( request, &response, true /* autoSplit */ );
+                if ( !writeOk( response, ignoreDuplicates, errMsg ) )
+                    return false;
+            }
+
+            return true;
+        }
+
+        /** Deletes every document with one of the _ids 'ids' through the cluster. */
+        bool removeThroughCluster( const string& ns,
+                                   const vector<BSONObj>& ids,
+                                   string* errMsg ) {
+            for ( size_t i = 0; i < ids.size(); i += kApplyBatchOps ) {
+                auto_ptr<BatchedDeleteRequest> deleteRequest( new BatchedDeleteRequest() );
+                for ( size_t j = i; j < ids.size() && j < i + kApplyBatchOps; ++j ) {
+                    auto_ptr<BatchedDeleteDocument> deleteDoc( new BatchedDeleteDocument() );
+                    deleteDoc->setQuery( ids[j] );
+                    // without the new shard key an _id can't be targeted to one shard
+                    deleteDoc->setLimit( 0 );
+                    deleteRequest->addToDeletes( deleteDoc.release() );
+                }
+
+                BatchedCommandRequest request( deleteRequest.release() );
+                request.setNS( ns );
+                request.setOrdered( false );
+
+                BatchedCommandResponse response;
+                clusterWrite( request, &response, false );
+                if ( !writeOk( response, false, errMsg ) )
+                    return false;
+            }
+
+            return true;
+        }
+
+        bool runOnShard( const Shard& shard, const BSONObj& cmdObj, BSONObj* res ) {
+            ScopedDbConnection conn( shard.getConnString() );
+            bool ok = conn->runCommand( "admin", cmdObj, *res );
+            conn.done();
+            return ok;
+        }
+
+        /**
+         * Copies the documents one donor owns in the collection being resharded to the new
+         * collection. Donors are copied from at once, each by its own thread.
+         */
+        struct CopyTask {
+            CopyTask() : docsCopied( 0 ) {}
+
+            Shard donor;
+            string ns;
+            string shadowNs;
+            ChunkManagerPtr manager;
+
+            long long docsCopied;
+            string errmsg;
+        };
+
+        bool flushCopyBatch( CopyTask* task, vector<BSONObj>* batch, int* batchBytes ) {
+            if ( !insertThroughCluster( task->shadowNs, *batch, true, &task->errmsg ) )
+                return false;
+
+            task->docsCopied += batch->size();
+            batch->clear();
+            *batchBytes = 0;
+            return true;
+        }
+
+        void runCopyTask( CopyTask* task ) {
+            try {
+                ScopedDbConnection conn( task->donor.getConnString() );
+
+                // Not versioned, so orphans show up too and are skipped below
+                auto_ptr<DBClientCursor> cursor = conn->query( task->ns,
+                                                               Query().snapshot(),
+                                                               0,
+                                                               0,
+                                                               NULL,
+                                                               QueryOption_NoCursorTimeout );
+                if ( !cursor.get() ) {
+                    task->errmsg = str::stream() << "could not query " << task->ns << " on "
+                                                 << task->donor.getName();
+                    return;
+                }
+
+                vector<BSONObj> batch;
+                int batchBytes = 0;
+                while ( cursor->more() ) {
+                    BSONObj doc = cursor->nextSafe().getOwned();
+                    if ( task->manager->findChunkForDoc( doc )->getShard() != task->donor )
+                        continue;
+
+                    batch.push_back( doc );
+                    batchBytes += doc.objsize();
+                    if ( batch.size() >= kCopyBatchDocs || batchBytes >= kCopyBatchBytes ) {
+                        if ( !flushCopyBatch( task, &batch, &batchBytes ) )
+                            return;
+                    }
+                }
+
+                if ( !batch.empty() && !flushCopyBatch( task, &batch, &batchBytes ) )
+                    return;
+
+                conn.done();
+            }
+            catch ( const DBException& e ) {
+                task->errmsg = e.toString();
+            }
+        }
+
+        /**
+         * Applies to the new collection the changes a shard has remembered since last asked,
+         * until there are none left. Adds the number of changes applied to 'numChanges'.
+         */
+        bool catchUp( const Shard& shard,
+                      const string& ns,
+                      const string& shadowNs,
+                      long long* numChanges,
+                      string* errMsg ) {
+            while ( true ) {
+                BSONObj res;
+                if ( !runOnShard( shard, BSON( "_reshardDonorMods" << ns ), &res ) ) {
+                    *errMsg = str::stream() << "could not get the changes to " << ns
+                                            << " from " << shard.getName()
+                                            << causedBy( res["errmsg"].str() );
+                    return false;
+                }
+
+                vector<BSONObj> deletedIds;
+                BSONForEach( e, res["deleted"].Obj() ) {
+                    deletedIds.push_back( e.Obj() );
+                }
+
+                // a written document replaces whatever copy there is
+                vector<BSONObj> reloadIds;
+                vector<BSONObj> reloadDocs;
+                BSONForEach( e, res["reload"].Obj() ) {
+                    reloadDocs.push_back( e.Obj() );
+                    reloadIds.push_back( e.Obj()["_id"].wrap() );
+                }
+
+                if ( deletedIds.empty() && reloadDocs.empty() )
+                    return true;
+
+                if ( !removeThroughCluster( shadowNs, deletedIds, errMsg ) ||
+                     !removeThroughCluster( shadowNs, reloadIds, errMsg ) ||
+                     !insertThroughCluster( shadowNs, reloadDocs, false, errMsg ) ) {
+                    return false;
+                }
+
+                *numChanges += deletedIds.size() + reloadDocs.size();
+            }
+        }
+
+        bool catchUpAll( const vector<Shard>& shards,
+                         const string& ns,
+                         const string& shadowNs,
+                         long long* numChanges,
+                         string* errMsg ) {
+            for ( size_t i = 0; i < shards.size(); ++i ) {
+                if ( !catchUp( shards[i], ns, shadowNs, numChanges, errMsg ) )
+                    return false;
+            }
+            return true;
+        }
+
+        /** Copies the index specs of 'ns' on 'shard' other than _id's into 'indexes'. */
+        bool getIndexes( const Shard& shard,
+                         const string& ns,
+                         vector<BSONObj>* indexes,
+                         string* errMsg ) {
+            ScopedDbConnection conn( shard.getConnString() );
+            auto_ptr<DBClientCursor> cursor =
+                    conn->query( nsToDatabase( ns ) + ".system.indexes", BSON( "ns" << ns ) );
+            if ( !cursor.get() ) {
+                *errMsg = str::stream() << "could not list the indexes of " << ns;
+                return false;
+            }
+
+            while ( cursor->more() ) {
+                BSONObj idx = cursor->nextSafe().getOwned();
+                if ( !str::equals( idx["key"].Obj().firstElementFieldName(), "_id" ) )
+                    indexes->push_back( idx );
+            }
+
+            conn.done();
+            return true;
+        }
+
+        /**
+         * Points the config metadata of 'ns' at the chunks of 'shadowNs', under the shard key
+         * and epoch of 'shadowManager', and forgets 'shadowNs'.
+         */
+        bool commitMetadata( const string& ns,
+                             const string& shadowNs,
+                             const ChunkManager& shadowManager,
+                             string* errMsg ) {
+            ScopedDbConnection conn( configServer.modelServer(), 30.0 );
+
+            vector<BSONObj> chunks;
+            auto_ptr<DBClientCursor> cursor =
+                    conn->query( ChunkType::ConfigNS, BSON( ChunkType::ns( shadowNs ) ) );
+            while ( cursor.get() && cursor->more() ) {
+                chunks.push_back( cursor->nextSafe().getOwned() );
+            }
+
+            // the old chunks go first, their _ids may be the same as the new ones'
+            conn->remove( ChunkType::ConfigNS, BSON( ChunkType::ns( ns ) ) );
+            string error = conn->getLastError();
+
+            for ( size_t i = 0; error.empty() && i < chunks.size(); ++i ) {
+                BSONObjBuilder chunk;
+                chunk.append( ChunkType::name(),
+                              Chunk::genID( ns, chunks[i][ChunkType::min()].Obj() ) );
+                chunk.append( ChunkType::ns(), ns );
+                BSONForEach( e, chunks[i] ) {
+                    if ( !str::equals( e.fieldName(), ChunkType::name().c_str() ) &&
+                         !str::equals( e.fieldName(), ChunkType::ns().c_str() ) ) {
+                        chunk.append( e );
+                    }
+                }
+                conn->insert( ChunkType::ConfigNS, chunk.obj() );
+                error = conn->getLastError();
+            }
+
+            if ( error.empty() ) {
+                BSONObjBuilder coll;
+                coll.append( CollectionType::ns(), ns );
+                coll.appendDate( CollectionType::DEPRECATED_lastmod(), jsTime() );
+                coll.appendBool( CollectionType::dropped(), false );
+                // the key, uniqueness and epoch
+                shadowManager.getInfo( coll );
+                conn->update( CollectionType::ConfigNS,
+                              BSON( CollectionType::ns( ns ) ),
+                              coll.obj(),
+                              true );
+                error = conn->getLastError();
+            }
+
+            if ( error.empty() ) {
+                conn->remove( ChunkType::ConfigNS, BSON( ChunkType::ns( shadowNs ) ) );
+                // tag ranges are in terms of the old shard key
+                conn->remove( TagsType::ConfigNS, BSON( TagsType::ns( ns ) ) );
+                error = conn->getLastError();
+            }
+
+            conn.done();
+
+            if ( !error.empty() ) {
+                *errMsg = str::stream() << "could not update the config metadata of " << ns
+                                        << causedBy( error );
+                return false;
+            }
+
+            return true;
+        }
+
+    }  // namespace
+
+    /**
+     * Changes the shard key of a sharded collection while it stays online.
+     *
+     * A shadow collection sharded on the new key is made and every shard starts remembering
+     * the documents written to the collection. The documents each shard owns are copied to
+     * the shadow collection through the cluster, from all shards at once, and then the changes
+     * since are applied, a round at a time, until few are left. For the cutover the shards stop
+     * taking writes to the collection, the last changes are applied, each shard's shadow
+     * collection is renamed over the old one and the config metadata is swapped to the
+     * shadow's chunks.
+     *
+     * The collection's distributed lock is held throughout, so its chunks don't move or split
+     * meanwhile. Zone ranges of the old key are dropped.
+     */
+    class ClusterReshardCollectionCommand : public Command {
+    public:
+        ClusterReshardCollectionCommand() : Command( "reshardCollection" ) {}
+
+        virtual void help( stringstream& h ) const {
+            h << "Change the shard key of a sharded collection while it stays online\n"
+              << "usage: { reshardCollection : <ns>, key : <new shard key>"
+              << " [, unique : <bool>] }";
+        }
+
+        virtual Status checkAuthForCommand( ClientBasic* client,
+                                            const std::string& dbname,
+                                            const BSONObj& cmdObj ) {
+            if ( !client->getAuthorizationSession()->isAuthorizedForActionsOnResource(
+                    ResourcePattern::forExactNamespace( NamespaceString( parseNs( dbname,
+                                                                                 cmdObj ) ) ),
+                    ActionType::enableSharding ) ) {
+                return Status( ErrorCodes::Unauthorized, "Unauthorized" );
+            }
+            return Status::OK();
+        }
+
+        virtual std::string parseNs( const std::string& dbname, const BSONObj& cmdObj ) const {
+            return parseNsFullyQualified( dbname, cmdObj );
+        }
+
+        virtual bool adminOnly() const { return true; }
+        virtual bool slaveOk() const { return false; }
+        virtual LockType locktype() const { return NONE; }
+
+        bool run( const string& dbname,
+                  BSONObj& cmdObj,
+                  int,
+                  string& errmsg,
+                  BSONObjBuilder& result,
+                  bool ) {
+
+            const string ns = parseNs( dbname, cmdObj );
+            const NamespaceString nss( ns );
+            if ( ns.empty() || !nss.isValid() ) {
+                errmsg = str::stream() << "bad ns[" << ns << "]";
+                return false;
+            }
+
+            DBConfigPtr config = grid.getDBConfig( ns );
+            if ( !config->isSharded( ns ) ) {
+                errmsg = str::stream() << ns << " is not sharded";
+                return false;
+            }
+
+            BSONObj proposedKey = cmdObj.getObjectField( "key" ).getOwned();
+            const bool unique = cmdObj["unique"].trueValue();
+            if ( !checkShardKey( proposedKey, unique, &errmsg ) )
+                return false;
+
+            string configErr;
+            if ( !configServer.allUp( configErr ) ) {
+                errmsg = str::stream() << "not all config servers are up: " << configErr;
+                return false;
+            }
+
+            const string shadowNs = nss.db().toString() + ".tmp.reshard." + nss.coll().toString();
+            if ( config->isSharded( shadowNs ) ) {
+                errmsg = str::stream() << shadowNs << " exists, " << ns
+                                       << " may already be being resharded";
+                return false;
+            }
+
+            DistributedLock nsLock( ConnectionString( configServer.modelServer(),
+                                                      ConnectionString::SYNC ),
+                                    ns );
+            dist_lock_try dlk;
+            try {
+                dlk = dist_lock_try( &nsLock, "reshardCollection" );
+            }
+            catch ( LockException& e ) {
+                errmsg = str::stream() << "error locking distributed lock for " << ns
+                                       << causedBy( e );
+                return false;
+            }
+
+            if ( !dlk.got() ) {
+                errmsg = "collection's metadata is undergoing changes. Please try again.";
+                return false;
+            }
+
+            // no chunk of the collection moves from here on
+            ChunkManagerPtr manager = config->getChunkManager( ns, true );
+            if ( manager->getShardKey().key().binaryEqual( proposedKey ) ) {
+                errmsg = str::stream() << ns << " is already sharded on " << proposedKey;
+                return false;
+            }
+
+            set<Shard> donors;
+            manager->getAllShards( donors );
+            verify( !donors.empty() );
+
+            vector<BSONObj> indexes;
+            if ( !getIndexes( *donors.begin(), ns, &indexes, &errmsg ) )
+                return false;
+
+            ShardKeyPattern proposedShardKey( proposedKey );
+            for ( size_t i = 0; i < indexes.size(); ++i ) {
+                BSONObj indexKey = indexes[i]["key"].Obj();
+                if ( indexes[i]["unique"].trueValue() &&
+                     !proposedShardKey.isUniqueIndexCompatible( indexKey ) ) {
+                    errmsg = str::stream() << "can't reshard collection '" << ns << "' "
+                                           << "with unique index on " << indexKey << " "
+                                           << "and proposed shard key " << proposedKey << ". "
+                                           << "Uniqueness can't be maintained unless "
+                                           << "shard key is a prefix";
+                    return false;
+                }
+            }
+
+            vector<Shard> shards;
+            Shard::getAllShards( shards );
+
+            MONGO_TLOG(0) << "CMD: reshardCollection: " << cmdObj << endl;
+            configServer.logChange( "reshardCollection.start", ns,
+                                    BSON( "from" << manager->getShardKey().key()
+                                          << "to" << proposedKey ) );
+
+            vector<Shard> tracking;
+            Stats stats;
+            bool committing = false;
+            try {
+                if ( _reshard( ns, shadowNs, config, manager, proposedKey, unique, indexes,
+                               shards, &tracking, &committing, &stats,
+                               &errmsg ) ) {
+                    result.append( "docsCopied", stats.docsCopied );
+                    result.append( "changesApplied", stats.changesApplied );
+                    result.append( "criticalSectionMillis", stats.criticalSectionMillis );
+                    configServer.logChange( "reshardCollection", ns,
+                                            BSON( "key" << proposedKey
+                                                  << "docsCopied" << stats.docsCopied
+                                                  << "changesApplied"
+                                                  << stats.changesApplied ) );
+                    return true;
+                }
+            }
+            catch ( const DBException& e ) {
+                errmsg = e.toString();
+            }
+
+            if ( committing ) {
+                // Past the point of no return: the shards stay in the critical section so that
+                // no write lands under the old shard key.
+                errmsg = str::stream() << "resharding " << ns << " failed during the cutover, "
+                                       << "writes to it stay blocked until it is repaired"
+                                       << causedBy( errmsg );
+                error() << errmsg << endl;
+                return false;
+            }
+
+            warning() << "resharding " << ns << " failed, rolling back" << causedBy( errmsg )
+                      << endl;
+            _abort( ns, shadowNs, config, tracking );
+            return false;
+        }
+
+    private:
+
+        struct Stats {
+            Stats() : docsCopied( 0 ), changesApplied( 0 ), criticalSectionMillis( 0 ) {}
+
+            long long docsCopied;
+            long long changesApplied;
+            long long criticalSectionMillis;
+        };
+
+        static bool checkShardKey( const BSONObj& proposedKey, bool unique, string* errMsg ) {
+            if ( proposedKey.isEmpty() ) {
+                *errMsg = "no shard key";
+                return false;
+            }
+
+            if ( IndexNames::findPluginName( proposedKey ) == IndexNames::HASHED ) {
+                if ( proposedKey.nFields() > 1 ) {
+                    *errMsg = "hashed shard keys currently only support single field keys";
+                    return false;
+                }
+                if ( unique ) {
+                    *errMsg = "hashed shard keys cannot be declared unique.";
+                    return false;
+                }
+                return true;
+            }
+
+            BSONForEach( e, proposedKey ) {
+                if ( !e.isNumber() || e.number() != 1.0 ) {
+                    *errMsg = str::stream() << "Unsupported shard key pattern.  Pattern must"
+                                            << " either be a single hashed field, or a list"
+                                            << " of ascending fields.";
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        static bool _reshard( const string& ns,
+                              const string& shadowNs,
+                              DBConfigPtr config,
+                              ChunkManagerPtr manager,
+                              const BSONObj& proposedKey,
+                              bool unique,
+                              const vector<BSONObj>& indexes,
+                              const vector<Shard>& shards,
+                              vector<Shard>* tracking,
+                              bool* committing,
+                              Stats* stats,
+                              string* errMsg ) {
+
+            // 1. The shadow collection, sharded on the new key and with the same indexes
+            {
+                ScopedDbConnection conn( config->getPrimary().getConnString() );
+                if ( conn->count( shadowNs ) != 0 ) {
+                    conn.done();
+                    *errMsg = str::stream() << shadowNs << " is not empty";
+                    return false;
+                }
+                bool ensured = conn->ensureIndex( shadowNs, proposedKey, unique, "", false );
+                conn.done();
+                if ( !ensured ) {
+                    *errMsg = "ensureIndex failed to create index on primary shard";
+                    return false;
+                }
+            }
+
+            vector<BSONObj> initSplits;
+            config->shardCollection( shadowNs, proposedKey, unique, &initSplits );
+
+            for ( size_t i = 0; i < indexes.size(); ++i ) {
+                BSONObjBuilder spec;
+                BSONForEach( e, indexes[i] ) {
+                    if ( str::equals( e.fieldName(), "ns" ) )
+                        spec.append( "ns", shadowNs );
+                    else
+                        spec.append( e );
+                }
+
+                BatchedCommandResponse response;
+                clusterInsert( nsToDatabase( ns ) + ".system.indexes",
+                               spec.obj(),
+                               BSONObj(),
+                               &response );
+                if ( !writeOk( response, false, errMsg ) )
+                    return false;
+            }
+
+            // 2. Every shard remembers what is written from here on
+            for ( size_t i = 0; i < shards.size(); ++i ) {
+                BSONObj res;
+                if ( !runOnShard( shards[i], BSON( "_reshardDonorStart" << ns ), &res ) ) {
+                    *errMsg = str::stream() << "could not start resharding on "
+                                            << shards[i].getName()
+                                            << causedBy( res["errmsg"].str() );
+                    return false;
+                }
+                tracking->push_back( shards[i] );
+            }
+
+            // 3. The documents each donor owns are copied, from all donors at once
+            set<Shard> donors;
+            manager->getAllShards( donors );
+
+            vector<CopyTask> tasks( donors.size() );
+            {
+                size_t i = 0;
+                for ( set<Shard>::const_iterator it = donors.begin(); it != donors.end();
+                      ++it, ++i ) {
+                    tasks[i].donor = *it;
+                    tasks[i].ns = ns;
+                    tasks[i].shadowNs = shadowNs;
+                    tasks[i].manager = manager;
+                }
+            }
+
+            boost::thread_group threads;
+            for ( size_t i = 0; i < tasks.size(); ++i ) {
+                threads.create_thread( boost::bind( &runCopyTask, &tasks[i] ) );
+            }
+            threads.join_all();
+
+            for ( size_t i = 0; i < tasks.size(); ++i ) {
+                if ( !tasks[i].errmsg.empty() ) {
+                    *errMsg = str::stream() << "copying from " << tasks[i].donor.getName()
+                                            << " failed" << causedBy( tasks[i].errmsg );
+                    return false;
+                }
+                stats->docsCopied += tasks[i].docsCopied;
+            }
+
+            LOG(0) << "resharding " << ns << ": copied " << stats->docsCopied << " documents"
+                   << endl;
+
+            // 4. The changes since are applied until few enough are left
+            for ( int round = 0; round < kMaxCatchUpRounds; ++round ) {
+                long long numChanges = 0;
+                if ( !catchUpAll( shards, ns, shadowNs, &numChanges, errMsg ) )
+                    return false;
+                stats->changesApplied += numChanges;
+                if ( numChanges <= kCutoverMaxChanges )
+                    break;
+            }
+
+            // 5. The shadow's chunks stop moving too. A migration of one of them may be under
+            //    way, so the lock can take a while.
+            DistributedLock shadowLock( ConnectionString( configServer.modelServer(),
+                                                          ConnectionString::SYNC ),
+                                        shadowNs );
+            dist_lock_try shadowDlk;
+            for ( int attempt = 0; attempt < 30 && !shadowDlk.got(); ++attempt ) {
+                if ( attempt > 0 )
+                    sleepsecs( 1 );
+                shadowDlk = dist_lock_try( &shadowLock, "reshardCollection" );
+            }
+
+            if ( !shadowDlk.got() ) {
+                *errMsg = str::stream() << "could not lock " << shadowNs;
+                return false;
+            }
+
+            // 6. Critical section: writes are turned away and the last changes applied
+            Timer criticalSectionTimer;
+            for ( size_t i = 0; i < shards.size(); ++i ) {
+                BSONObj res;
+                if ( !runOnShard( shards[i],
+                                  BSON( "_reshardDonorCriticalSection" << ns ),
+                                  &res ) ) {
+                    *errMsg = str::stream() << "could not enter the critical section on "
+                                            << shards[i].getName()
+                                            << causedBy( res["errmsg"].str() );
+                    return false;
+                }
+            }
+
+            if ( !catchUpAll( shards, ns, shadowNs, &stats->changesApplied, errMsg ) )
+                return false;
+
+            // 7. Cutover: the shadow collection takes the place of the old one
+            *committing = true;
+            ChunkManagerPtr shadowManager = config->getChunkManager( shadowNs, true );
+
+            for ( size_t i = 0; i < shards.size(); ++i ) {
+                ScopedDbConnection conn( shards[i].getConnString() );
+                BSONObj res;
+                bool ok = true;
+                if ( conn->exists( shadowNs ) ) {
+                    ok = conn->runCommand( "admin",
+                                           BSON( "renameCollection" << shadowNs
+                                                 << "to" << ns
+                                                 << "dropTarget" << true ),
+                                           res );
+                }
+                else if ( conn->exists( ns ) ) {
+                    ok = conn->dropCollection( ns, &res );
+                }
+                conn.done();
+
+                if ( !ok ) {
+                    *errMsg = str::stream() << "could not replace " << ns << " on "
+                                            << shards[i].getName() << ": " << res;
+                    return false;
+                }
+            }
+
+            if ( !commitMetadata( ns, shadowNs, *shadowManager, errMsg ) )
+                return false;
+
+            config->removeSharding( shadowNs );
+            config->reload();
+            config->getChunkManager( ns, true );
+
+            // 8. The shards reload the metadata and take writes again
+            *committing = false;
+            for ( size_t i = 0; i < shards.size(); ++i ) {
+                BSONObj res;
+                if ( !runOnShard( shards[i],
+                                  BSON( "_reshardDonorDone" << ns << "shadow" << shadowNs ),
+                                  &res ) ) {
+                    warning() << "could not finish resharding " << ns << " on "
+                              << shards[i].getName() << causedBy( res["errmsg"].str() )
+                              << endl;
+                }
+            }
+            tracking->clear();
+
+            stats->criticalSectionMillis = criticalSectionTimer.millis();
+            return true;
+        }
+
+        /** Undoes a resharding that didn't reach the cutover. */
+        static void _abort( const string& ns,
+                            const string& shadowNs,
+                            DBConfigPtr config,
+                            const vector<Shard>& tracking ) {
+            for ( size_t i = 0; i < tracking.size(); ++i ) {
+                try {
+                    BSONObj res;
+                    runOnShard( tracking[i],
+                                BSON( "_reshardDonorDone" << ns << "abort" << true ),
+                                &res );
+                }
+                catch ( const DBException& e ) {
+                    warning() << "could not stop resharding " << ns << " on "
+                              << tracking[i].getName() << causedBy( e ) << endl;
+                }
+            }
+
+            try {
+                if ( config->isSharded( shadowNs ) ) {
+                    ChunkManagerPtr shadowManager = config->getChunkManager( shadowNs );
+                    shadowManager->drop( shadowManager );
+                    config->removeSharding( shadowNs );
+                }
+                else {
+                    ScopedDbConnection conn( config->getPrimary().getConnString() );
+                    conn->dropCollection( shadowNs );
+                    conn.done();
+                }
+            }
+            catch ( const DBException& e ) {
+                warning() << "could not drop " << shadowNs << " after failing to reshard "
+                          << ns << causedBy( e ) << endl;
+            }
+        }
+    };
+
+    MONGO_INITIALIZER(InitReshardCollectionCommand)(InitializerContext* context) {
+        // Leaked intentionally: a Command registers itself when constructed.
+        new ClusterReshardCollectionCommand();
+        return Status::OK();
+    }
+
+}  // namespace mongo
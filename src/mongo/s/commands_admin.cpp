@@ -57,6 +57,7 @@
 #include "mongo/s/writeback_listener.h"
 #include "mongo/util/net/listen.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/ramlog.h"
 #include "mongo/util/stringutils.h"
@@ -747,7 +748,7 @@ namespace mongo {
                     // Reload the new config info.  If we created more than one initial chunk, then
                     // we need to move them around to balance.
                     ChunkManagerPtr chunkManager = config->getChunkManager( ns , true );
-                    ChunkMap chunkMap = chunkManager->getChunkMap();
+                    const ChunkMap& chunkMap = chunkManager->getChunkMap();
                     // 2. Move and commit each "big chunk" to a different shard.
                     int i = 0;
                     for ( ChunkMap::const_iterator c = chunkMap.begin(); c != chunkMap.end(); ++c,++i ){
@@ -1436,6 +1437,8 @@ namespace mongo {
                 result.append("maxWireVersion", maxWireVersion);
                 result.append("minWireVersion", minWireVersion);
 
+                negotiateCompression(cmdObj, ClientBasic::getCurrent()->port(), &result);
+
                 return true;
             }
         } ismaster;
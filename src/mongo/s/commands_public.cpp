@@ -43,6 +43,7 @@
 #include "mongo/db/commands/find_and_modify.h"
 #include "mongo/db/commands/mr.h"
 #include "mongo/db/commands/rename_collection.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/lasterror.h"
@@ -57,6 +58,7 @@
 #include "mongo/s/cursors.h"
 #include "mongo/s/grid.h"
 #include "mongo/s/interrupt_status_mongos.h"
+#include "mongo/s/query_result_cache.h"
 #include "mongo/s/strategy.h"
 #include "mongo/s/version_manager.h"
 #include "mongo/scripting/engine.h"
@@ -102,6 +104,59 @@ namespace mongo {
                 return commonErrCode;
             }
 
+            /**
+             * How long each shard took to answer the commands fanned out to it, reported in
+             * serverStatus as shardLatency: { <host>: { num, totalMillis } }.
+             */
+            class ShardLatencyStats : public ServerStatusSection {
+            public:
+                ShardLatencyStats() : ServerStatusSection( "shardLatency" ),
+                                      _mutex( "ShardLatencyStats" ) {
+                }
+
+                virtual bool includeByDefault() const { return true; }
+
+                void record( const string& server, int millis ) {
+                    scoped_lock lk( _mutex );
+                    Totals& totals = _servers[server];
+                    totals.num++;
+                    totals.totalMillis += millis;
+                }
+
+                virtual BSONObj generateSection( const BSONElement& configElement ) const {
+                    BSONObjBuilder b;
+                    scoped_lock lk( _mutex );
+                    for ( map<string, Totals>::const_iterator it = _servers.begin();
+                          it != _servers.end(); ++it ) {
+                        BSONObjBuilder sub( b.subobjStart( it->first ) );
+                        sub.appendNumber( "num", it->second.num );
+                        sub.appendNumber( "totalMillis", it->second.totalMillis );
+                        sub.done();
+                    }
+                    return b.obj();
+                }
+
+            private:
+                struct Totals {
+                    Totals() : num( 0 ), totalMillis( 0 ) {}
+                    long long num;
+                    long long totalMillis;
+                };
+
+                mutable mongo::mutex _mutex;
+                map<string, Totals> _servers;
+            } shardLatencyStats;
+
+            /**
+             * Waits for a command spawned on a shard and records how long the shard took.
+             * @return the command's ok
+             */
+            bool joinShardCommand( const shared_ptr<Future::CommandResult>& res ) {
+                bool ok = res->join();
+                shardLatencyStats.record( res->getServer(), res->millis() );
+                return ok;
+            }
+
         } // namespace
 
         class PublicGridCommand : public Command {
@@ -191,7 +246,7 @@ namespace mongo {
                 int commonErrCode = -1;
                 for ( list< shared_ptr<Future::CommandResult> >::iterator i=futures.begin(); i!=futures.end(); i++ ) {
                     shared_ptr<Future::CommandResult> res = *i;
-                    if ( ! res->join() ) {
+                    if ( ! joinShardCommand( res ) ) {
 
                         BSONObj result = res->result();
 
@@ -478,6 +533,7 @@ namespace mongo {
                 string fullns = dbName + "." + collection;
 
                 DBConfigPtr conf = grid.getDBConfig( dbName , false );
+                QueryResultCache::WriteScope cacheWrite( &queryResultCache, fullns );
 
                 log() << "DROP: " << fullns << endl;
 
@@ -574,6 +630,8 @@ namespace mongo {
                 if ( ! confCopy.dropDatabase( errmsg ) )
                     return false;
 
+                queryResultCache.invalidateDatabase( dbName );
+
                 result.append( "dropped" , dbName );
                 return true;
             }
@@ -600,6 +658,8 @@ namespace mongo {
                 string fullnsTo = cmdObj["to"].valuestrsafe();
                 string dbNameTo = nsToDatabase( fullnsTo );
                 DBConfigPtr confTo = grid.getDBConfig( dbNameTo , false );
+                QueryResultCache::WriteScope cacheWriteFrom( &queryResultCache, fullnsFrom );
+                QueryResultCache::WriteScope cacheWriteTo( &queryResultCache, fullnsTo );
 
                 uassert(13140, "Don't recognize source or target DB", confFrom && confTo);
                 uassert(13138, "You can't rename a sharded collection", !confFrom->isSharded(fullnsFrom));
@@ -811,18 +871,25 @@ namespace mongo {
                 */
                 int nindexes=0;
                 bool warnedAboutIndexes = false;
+
+                vector< shared_ptr<Future::CommandResult> > futures;
                 for ( set<Shard>::iterator i=servers.begin(); i!=servers.end(); i++ ) {
-                    BSONObj res;
-                    {
-                        ScopedDbConnection conn(i->getConnString());
-                        if ( ! conn->runCommand( dbName , cmdObj , res ) ) {
-                            if ( !res["code"].eoo() ) {
-                                result.append( res["code"] );
-                            }
-                            errmsg = "failed on shard: " + res.toString();
-                            return false;
+                    futures.push_back( Future::spawnCommand( i->getConnString(), dbName,
+                                                             cmdObj, 0 ) );
+                }
+                for ( size_t i = 0; i < futures.size(); i++ ) {
+                    joinShardCommand( futures[i] );
+                }
+
+                size_t shardIndex = 0;
+                for ( set<Shard>::iterator i=servers.begin(); i!=servers.end(); i++ ) {
+                    BSONObj res = futures[shardIndex++]->result();
+                    if ( ! res["ok"].trueValue() ) {
+                        if ( !res["code"].eoo() ) {
+                            result.append( res["code"] );
                         }
-                        conn.done();
+                        errmsg = "failed on shard: " + res.toString();
+                        return false;
                     }
                     
                     BSONObjIterator j( res );
@@ -922,6 +989,7 @@ namespace mongo {
                 string fullns = dbName + "." + collection;
 
                 DBConfigPtr conf = grid.getDBConfig( dbName , false );
+                QueryResultCache::WriteScope cacheWrite( &queryResultCache, fullns );
 
                 if ( ! conf || ! conf->isShardingEnabled() || ! conf->isSharded( fullns ) ) {
                     return passthrough( conf , cmdObj , result);
@@ -998,13 +1066,20 @@ namespace mongo {
 
                 set<Shard> shards;
                 cm->getShardsForRange(shards, min, max);
+
+                vector< shared_ptr<Future::CommandResult> > futures;
                 for ( set<Shard>::iterator i=shards.begin(), end=shards.end() ; i != end; ++i ) {
-                    ScopedDbConnection conn(i->getConnString());
-                    BSONObj res;
-                    bool ok = conn->runCommand( conf->getName() , cmdObj , res );
-                    conn.done();
+                    futures.push_back( Future::spawnCommand( i->getConnString(), conf->getName(),
+                                                             cmdObj, 0 ) );
+                }
+                for ( size_t i = 0; i < futures.size(); i++ ) {
+                    joinShardCommand( futures[i] );
+                }
 
-                    if ( ! ok ) {
+                for ( size_t i = 0; i < futures.size(); i++ ) {
+                    BSONObj res = futures[i]->result();
+
+                    if ( ! res["ok"].trueValue() ) {
                         result.appendElements( res );
                         return false;
                     }
@@ -1119,19 +1194,19 @@ namespace mongo {
                 massert( 10420 ,  "how could chunk manager be null!" , cm );
 
                 BSONObj query = getQuery(cmdObj);
-                set<Shard> shards;
-                cm->getShardsForQuery(shards, query);
+
+                // sent to all the shards at once, versioned like count
+                vector<Strategy::CommandResult> results;
+                SHARDED->commandOp( dbName, cmdObj, options, fullns, query, &results );
 
                 set<BSONObj,BSONObjCmp> all;
                 int size = 32;
 
-                for ( set<Shard>::iterator i=shards.begin(), end=shards.end() ; i != end; ++i ) {
-                    ShardConnection conn( *i , fullns );
-                    BSONObj res;
-                    bool ok = conn->runCommand( conf->getName() , cmdObj , res, options );
-                    conn.done();
+                for ( vector<Strategy::CommandResult>::const_iterator i = results.begin();
+                      i != results.end(); ++i ) {
+                    const BSONObj& res = i->result;
 
-                    if ( ! ok ) {
+                    if ( ! res["ok"].trueValue() ) {
                         result.appendElements( res );
                         return false;
                     }
@@ -1329,7 +1404,7 @@ namespace mongo {
                 double objectsLoaded = 0;
                 for ( list< shared_ptr<Future::CommandResult> >::iterator i=futures.begin(); i!=futures.end(); i++ ) {
                     shared_ptr<Future::CommandResult> res = *i;
-                    if ( ! res->join() ) {
+                    if ( ! joinShardCommand( res ) ) {
                         errmsg = res->result()["errmsg"].String();
                         if (res->result().hasField("code")) {
                             result.append(res->result()["code"]);
@@ -1894,12 +1969,33 @@ namespace mongo {
                              BSONObjBuilder &result, bool fromRepl);
 
         private:
+            // Runs a parsed pipeline. cmdObj must match pPipeline for any unsharded input.
+            bool runPipeline(DBConfigPtr conf,
+                             intrusive_ptr<Pipeline> pPipeline,
+                             const string& dbName,
+                             const string& fullns,
+                             BSONObj cmdObj,
+                             int options,
+                             BSONObjBuilder& result);
+
+            // Runs a pipeline ending in an $out to a sharded collection.
+            bool runWithShardedOutput(DBConfigPtr conf,
+                                      intrusive_ptr<Pipeline> pPipeline,
+                                      DocumentSourceOut* out,
+                                      const string& dbName,
+                                      const string& fullns,
+                                      BSONObj cmdObj,
+                                      int options,
+                                      string& errmsg,
+                                      BSONObjBuilder& result);
+
             DocumentSourceMergeCursors::CursorIds parseCursors(
                 const vector<Strategy::CommandResult>& shardResults,
                 const string& fullns);
 
             void storePossibleCursor(const string& server, BSONObj cmdResult) const;
             void killAllCursors(const vector<Strategy::CommandResult>& shardResults);
+            void dropShardedOutputTemps(const set<Shard>& shards, const string& tempNs);
             bool doAnyShardsNotSupportCursors(const vector<Strategy::CommandResult>& shardResults);
             bool wasMergeCursorsSupported(BSONObj cmdResult);
             void uassertCanMergeInMongos(intrusive_ptr<Pipeline> mergePipeline, BSONObj cmdObj);
@@ -1959,13 +2055,134 @@ namespace mongo {
             if (!pPipeline.get())
                 return false; // there was some parsing error
 
+            DBConfigPtr conf = grid.getDBConfig(dbName , true);
+            massert(17015, "getDBConfig shouldn't return NULL",
+                    conf);
+
+            DocumentSourceOut* out = dynamic_cast<DocumentSourceOut*>(pPipeline->output());
+            if (out && !pPipeline->isExplain()
+                    && conf->isShardingEnabled() && conf->isSharded(out->getOutputNs().ns())) {
+                return runWithShardedOutput(
+                        conf, pPipeline, out, dbName, fullns, cmdObj, options, errmsg, result);
+            }
+
+            return runPipeline(conf, pPipeline, dbName, fullns, cmdObj, options, result);
+        }
+
+        bool PipelineCommand::runWithShardedOutput(DBConfigPtr conf,
+                                                   intrusive_ptr<Pipeline> pPipeline,
+                                                   DocumentSourceOut* out,
+                                                   const string& dbName,
+                                                   const string& fullns,
+                                                   BSONObj cmdObj,
+                                                   int options,
+                                                   string& errmsg,
+                                                   BSONObjBuilder& result) {
+            const string outputNs = out->getOutputNs().ns();
+
+            // take distributed lock to prevent split / migration while the shards fill their
+            // parts of the output
+            DistributedLock lockSetup(configServer.getConnectionString(), outputNs);
+            dist_lock_try dlk;
+            try {
+                int tryc = 0;
+                while (!dlk.got()) {
+                    dlk = dist_lock_try(&lockSetup, (string)"aggregate-out");
+                    if (!dlk.got()) {
+                        if (++tryc % 100 == 0)
+                            warning() << "the collection metadata could not be locked for $out, "
+                                      << "already locked by " << dlk.other() << endl;
+                        sleepmillis(100);
+                    }
+                }
+            }
+            catch (LockException& e) {
+                errmsg = str::stream() << "error locking distributed lock for $out "
+                                       << causedBy(e);
+                return false;
+            }
+
+            // Every document goes straight to the shard owning its chunk, so the chunk map has
+            // to be current as of taking the lock.
+            ChunkManagerPtr cm = conf->getChunkManager(outputNs, true);
+            const ChunkMap& chunkMap = cm->getChunkMap();
+            BSONArrayBuilder chunks;
+            set<Shard> shards;
+            for (ChunkMap::const_iterator it = chunkMap.begin(); it != chunkMap.end(); ++it) {
+                const ChunkPtr& chunk = it->second;
+                chunks.append(BSON("min" << chunk->getMin()
+                                << "max" << chunk->getMax()
+                                << "shard" << chunk->getShard().getConnString()));
+                shards.insert(chunk->getShard());
+            }
+
+            const string tempColl = str::stream() << "tmp.agg_out." << OID::gen();
+            out->setShardedOutput(cm->getShardKey().key(), chunks.arr(), tempColl);
+            const string tempNs = out->getTempNs().ns();
+
+            // An unsharded input sends cmdObj as is, so it needs the new $out spec too. $out is
+            // always the last stage.
+            BSONObjBuilder shardedOutCmd;
+            BSONForEach(cmdElem, cmdObj) {
+                if (!str::equals(cmdElem.fieldName(), "pipeline")) {
+                    shardedOutCmd.append(cmdElem);
+                    continue;
+                }
+
+                BSONArrayBuilder stages(shardedOutCmd.subarrayStart("pipeline"));
+                vector<BSONElement> rawStages = cmdElem.Array();
+                for (size_t i = 0; i + 1 < rawStages.size(); i++)
+                    stages.append(rawStages[i]);
+                stages.append(out->serialize().getDocument().toBson());
+                stages.done();
+            }
+
+            bool ok = false;
+            BSONObjBuilder pipelineResult;
+            try {
+                ok = runPipeline(conf, pPipeline, dbName, fullns, shardedOutCmd.obj(), options,
+                                 pipelineResult);
+
+                // Now that every shard has all of its output, replace the old output on each of
+                // them. Each shard's rename is atomic, but they don't all happen at once.
+                for (set<Shard>::const_iterator it = shards.begin(); ok && it != shards.end();
+                        ++it) {
+                    ScopedDbConnection conn(it->getConnString());
+                    BSONObj info;
+                    bool renamed = conn->runCommand("admin",
+                                                    BSON("renameCollection" << tempNs
+                                                      << "to" << outputNs
+                                                      << "dropTarget" << true),
+                                                    info);
+                    conn.done();
+                    uassert(17349, str::stream() << "renameCollection for $out failed on shard "
+                                                 << it->getName() << ": " << info,
+                            renamed);
+                }
+            }
+            catch (...) {
+                dropShardedOutputTemps(shards, tempNs);
+                throw;
+            }
+
+            if (!ok)
+                dropShardedOutputTemps(shards, tempNs);
+
+            result.appendElements(pipelineResult.obj());
+            return ok;
+        }
+
+        bool PipelineCommand::runPipeline(DBConfigPtr conf,
+                                          intrusive_ptr<Pipeline> pPipeline,
+                                          const string& dbName,
+                                          const string& fullns,
+                                          BSONObj cmdObj,
+                                          int options,
+                                          BSONObjBuilder& result) {
             /*
               If the system isn't running sharded, or the target collection
               isn't sharded, pass this on to a mongod.
             */
-            DBConfigPtr conf = grid.getDBConfig(dbName , true);
-            massert(17015, "getDBConfig shouldn't return NULL",
-                    conf);
             if (!conf->isShardingEnabled() || !conf->isSharded(fullns))
                 return aggPassthrough(conf, cmdObj, result, options);
 
@@ -2017,7 +2234,8 @@ namespace mongo {
             }
 
             DocumentSourceMergeCursors::CursorIds cursorIds = parseCursors(shardResults, fullns);
-            pPipeline->addInitialSource(DocumentSourceMergeCursors::create(cursorIds, pExpCtx));
+            pPipeline->addInitialSource(
+                    DocumentSourceMergeCursors::create(cursorIds, pPipeline->getContext()));
 
             MutableDocument mergeCmd(pPipeline->serialize());
 
@@ -2063,6 +2281,23 @@ namespace mongo {
             return ok;
         }
 
+        void PipelineCommand::dropShardedOutputTemps(const set<Shard>& shards,
+                                                     const string& tempNs) {
+            // Best effort, like killAllCursors(). Anything left behind is a temp collection, so
+            // it is dropped when its shard restarts.
+            for (set<Shard>::const_iterator it = shards.begin(); it != shards.end(); ++it) {
+                try {
+                    ScopedDbConnection conn(it->getConnString());
+                    conn->dropCollection(tempNs);
+                    conn.done();
+                }
+                catch (const DBException& e) {
+                    log() << "Couldn't drop $out temp collection " << tempNs << " on shard "
+                          << it->getName() << causedBy(e);
+                }
+            }
+        }
+
         void PipelineCommand::uassertCanMergeInMongos(intrusive_ptr<Pipeline> mergePipeline,
                                                       BSONObj cmdObj) {
             uassert(17020, "All shards must support cursors to get a cursor back from aggregation",
@@ -58,12 +58,33 @@ namespace mongo {
 
     /* --- DBConfig --- */
 
-    DBConfig::CollectionInfo::CollectionInfo( const BSONObj& in ) {
+    DBConfig::CollectionInfo::CollectionInfo( const BSONObj& in, ChunkManagerPtr oldManager ) {
         _dirty = false;
         _dropped = in[CollectionType::dropped()].trueValue();
 
         if ( in[CollectionType::keyPattern()].isABSONObj() ) {
-            shard( new ChunkManager( in ) );
+
+            OID epoch = ChunkVersion::fromBSON( in ).epoch();
+            bool sameCollection = oldManager &&
+                epoch.isSet() && oldManager->getVersion().epoch() == epoch &&
+                oldManager->getShardKey().key().woCompare(
+                        in[CollectionType::keyPattern()].Obj() ) == 0 &&
+                oldManager->isUnique() == in[CollectionType::unique()].trueValue();
+
+            if ( sameCollection ) {
+                shard( new ChunkManager( oldManager ) );
+
+                // Keep the manager we had if nothing changed, so connections already versioned
+                // with it don't need to be set again
+                if ( _cm && _cm->getVersion().isEquivalentTo( oldManager->getVersion() ) ) {
+                    _cm = oldManager;
+                }
+            }
+
+            // A diff that came back empty may just be an inconsistent read, load from scratch
+            if ( ! _cm ) {
+                shard( new ChunkManager( in ) );
+            }
         }
 
         _dirty = false;
@@ -534,7 +555,12 @@ namespace mongo {
                 numCollsErased++;
             }
             else{
-                _collections[ collName ] = CollectionInfo( collObj );
+                // Collections we already have chunks for only need what changed since
+                Collections::iterator old = _collections.find( collName );
+                ChunkManagerPtr oldManager;
+                if ( old != _collections.end() ) oldManager = old->second.getCM();
+
+                _collections[ collName ] = CollectionInfo( collObj, oldManager );
                 if( _collections[ collName ].isSharded() ) numCollsSharded++;
             }
         }
@@ -61,7 +61,12 @@ namespace mongo {
                 _dropped = false;
             }
 
-            CollectionInfo( const BSONObj& in );
+            /**
+             * Builds the info from a config.collections entry.  If the collection was already
+             * sharded with the same epoch and key under oldManager, only the chunks that changed
+             * since are read from the config server, and oldManager itself is kept if none did.
+             */
+            CollectionInfo( const BSONObj& in, ChunkManagerPtr oldManager = ChunkManagerPtr() );
 
             bool isSharded() const {
                 return _cm.get();
@@ -53,7 +53,8 @@ namespace mongo {
 
     // --------  ShardedCursor -----------
 
-    ShardedClientCursor::ShardedClientCursor( QueryMessage& q , ClusteredCursor * cursor ) {
+    ShardedClientCursor::ShardedClientCursor( QueryMessage& q , ClusteredCursor * cursor )
+        : _memoryUsage( MemoryUsage::kCursors, sizeof( ShardedClientCursor ) ) {
         verify( cursor );
         _cursor = cursor;
 
@@ -125,6 +126,7 @@ namespace mongo {
         // (one is assumed to be a single doc return, with no cursor)
         bool sendMore = ntoreturn == 0 || ntoreturn > 1;
         ntoreturn = abs( ntoreturn );
+        bool filledBatch = false;
 
         while ( _cursor->more() ) {
             BSONObj o = _cursor->next();
@@ -138,6 +140,7 @@ namespace mongo {
 
             if ( docCount == ntoreturn ) {
                 // soft limit aka batch size
+                filledBatch = true;
                 break;
             }
 
@@ -147,7 +150,11 @@ namespace mongo {
             }
         }
 
-        bool hasMore = sendMore && _cursor->more();
+        // A full batch keeps the cursor open without asking the merge for another document:
+        // that could mean a getMore to the shard which supplied this batch, and a client with a
+        // limit of ntoreturn won't read any further.  If there's nothing left, the client's next
+        // getMore gets an empty batch and a closed cursor.
+        bool hasMore = sendMore && ( filledBatch || _cursor->more() );
 
         LOG(5) << "\t hasMore: " << hasMore
                << " sendMore: " << sendMore
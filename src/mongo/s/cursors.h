@@ -39,6 +39,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/platform/random.h"
 #include "mongo/s/request.h"
+#include "mongo/util/memory_usage.h"
 
 namespace mongo {
 
@@ -97,6 +98,7 @@ namespace mongo {
         long long _id;
         long long _lastAccessMillis; // 0 means no timeout
 
+        MemoryUsageTracker _memoryUsage;
     };
 
     typedef boost::shared_ptr<ShardedClientCursor> ShardedClientCursorPtr;
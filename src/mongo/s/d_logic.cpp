@@ -46,8 +46,10 @@
 #include "mongo/db/commands.h"
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/s/d_reshard.h"
 #include "mongo/s/d_writeback.h"
 #include "mongo/s/shard.h"
+#include "mongo/util/mongoutils/str.h"
 #include "mongo/util/queue.h"
 
 using namespace std;
@@ -70,7 +72,12 @@ namespace mongo {
         // We don't care about the version here, since we're returning it later in the writeback
         ChunkVersion received, wanted;
         if ( shardVersionOk( ns , errmsg, received, wanted ) ) {
-            return false;
+            // A collection being resharded takes no versioned writes while it's cut over
+            bool isWrite = op == dbInsert || op == dbUpdate || op == dbDelete;
+            if ( ! isWrite || ! received.isSet() || ! inReshardingCriticalSection( ns ) ) {
+                return false;
+            }
+            errmsg = str::stream() << "collection " << ns << " is being resharded";
         }
 
         bool getsAResponse = doesOpGetAResponse( op );
@@ -291,6 +291,10 @@ namespace mongo {
 
         static ShardedConnectionInfo* get( bool create );
         static void reset();
+
+        /** takes the thread's info off it, for Client::detachFromThread() */
+        static ShardedConnectionInfo* detach();
+        static void attach( ShardedConnectionInfo* info );
         static void addHook();
 
         bool inForceVersionOkMode() const {
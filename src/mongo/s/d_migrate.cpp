@@ -67,11 +67,14 @@
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rs_config.h"
 #include "mongo/db/repl/write_concern.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/logger/ramlog.h"
 #include "mongo/s/chunk.h"
+#include "mongo/s/chunk_load_tracker.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/config.h"
 #include "mongo/s/d_logic.h"
+#include "mongo/s/d_reshard.h"
 #include "mongo/s/shard.h"
 #include "mongo/s/type_chunk.h"
 #include "mongo/util/assert_util.h"
@@ -188,6 +191,12 @@ namespace mongo {
 
     };
 
+    // Before the donor enters the critical section, the recipient gets up to
+    // migrateCatchUpRounds more polls to bring the mods not yet transferred down to
+    // migrateCatchUpMaxPendingMods, so that little is left to drain while writes are blocked.
+    MONGO_EXPORT_SERVER_PARAMETER(migrateCatchUpRounds, int, 10);
+    MONGO_EXPORT_SERVER_PARAMETER(migrateCatchUpMaxPendingMods, int, 100);
+
     bool isInRange( const BSONObj& obj ,
                     const BSONObj& min ,
                     const BSONObj& max ,
@@ -566,6 +575,12 @@ namespace mongo {
 
         long long mbUsed() const { return _memoryUsed / ( 1024 * 1024 ); }
 
+        /** @return the number of deletes and writes not yet transferred */
+        std::size_t pendingMods() {
+            scoped_spinlock lk( _trackerLocks );
+            return _deleted.size() + _reload.size();
+        }
+
         bool getInCriticalSection() const {
             scoped_lock l(_mutex);
             return _inCriticalSection;
@@ -658,6 +673,26 @@ namespace mongo {
                           bool notInActiveChunk) {
         // TODO: include fullObj?
         migrateFromStatus.logOp(opstr, ns, obj, patt, notInActiveChunk);
+        logOpForResharding(opstr, ns, obj, patt, notInActiveChunk);
+
+        // an insert logs the document and an update its new version; migrations don't count
+        if ( ChunkLoadTracker::isEnabled() && !notInActiveChunk && shardingState.enabled() ) {
+            const BSONObj* doc = NULL;
+            if ( opstr[0] == 'i' && opstr[1] == '\0' )
+                doc = &obj;
+            else if ( opstr[0] == 'u' && fullObj )
+                doc = fullObj;
+
+            if ( doc ) {
+                CollectionMetadataPtr metadata = shardingState.getCollectionMetadata( ns );
+                if ( metadata ) {
+                    KeyPattern kp( metadata->getKeyPattern() );
+                    chunkLoadTracker.noteWrite( *metadata,
+                                                kp.extractSingleKey( *doc ),
+                                                doc->objsize() );
+                }
+            }
+        }
     }
 
     void aboutToDeleteForSharding( const StringData& ns,
@@ -1056,6 +1091,7 @@ namespace mongo {
 
             // Track last result from TO shard for sanity check
             BSONObj res;
+            int catchUpRounds = 0;
             for ( int i=0; i<86400; i++ ) { // don't want a single chunk move to take more than a day
                 verify( !Lock::isLocked() );
                 // Exponential sleep backoff, up to 1024ms. Don't sleep much on the first few
@@ -1102,8 +1138,19 @@ namespace mongo {
                     return false;
                 }
 
-                if ( res["state"].String() == "steady" )
-                    break;
+                if ( res["state"].String() == "steady" ) {
+                    // The recipient keeps draining mods while steady. While too many are
+                    // pending, give it more time so the critical section stays short.
+                    std::size_t pendingMods = migrateFromStatus.pendingMods();
+                    if ( pendingMods <= static_cast<std::size_t>( migrateCatchUpMaxPendingMods ) ||
+                         catchUpRounds >= migrateCatchUpRounds ) {
+                        break;
+                    }
+
+                    ++catchUpRounds;
+                    LOG(0) << "moveChunk waiting for the recipient to catch up on " << pendingMods
+                           << " mods before entering the critical section" << migrateLog;
+                }
 
                 if ( migrateFromStatus.mbUsed() > (500 * 1024 * 1024) ) {
                     // this is too much memory for us to use for this
@@ -1162,6 +1209,7 @@ namespace mongo {
             }
 
             log() << "About to enter migrate critical section" << endl;
+            Timer criticalSectionTimer;
 
             {
                 // 5.a
@@ -1425,12 +1473,17 @@ namespace mongo {
                 }
 
                 migrateFromStatus.setInCriticalSection( false );
+                const int criticalSectionMillis = criticalSectionTimer.millis();
+                log() << "moveChunk left the critical section after " << criticalSectionMillis
+                      << "ms" << migrateLog;
 
                 // 5.d
                 BSONObjBuilder commitInfo;
                 commitInfo.appendElements( chunkInfo );
                 if ( res["counts"].type() == Object )
                     commitInfo.appendElements( res["counts"].Obj() );
+                commitInfo.append( "catchUpRounds" , catchUpRounds );
+                commitInfo.append( "criticalSectionMillis" , criticalSectionMillis );
                 configServer.logChange( "moveChunk.commit" , ns , commitInfo.obj() );
             }
 
@@ -1508,6 +1561,54 @@ namespace mongo {
     MONGO_FP_DECLARE(migrateThreadHangAtStep4);
     MONGO_FP_DECLARE(migrateThreadHangAtStep5);
 
+    /**
+     * Asks the donor for the next batch of the initial clone in the background, so that it
+     * reads and sends the batch while the one before it is being applied.
+     */
+    class CloneBatchPrefetcher : boost::noncopyable {
+    public:
+        explicit CloneBatchPrefetcher( DBClientBase* conn ) : _conn( conn ), _ok( false ) {}
+
+        ~CloneBatchPrefetcher() {
+            if ( _thread )
+                _thread->join();
+        }
+
+        void start() {
+            verify( ! _thread );
+            _thread.reset( new boost::thread( boost::bind( &CloneBatchPrefetcher::_run,
+                                                           this ) ) );
+        }
+
+        /** waits for the batch start() asked for; false if the command failed */
+        bool wait( BSONObj* res ) {
+            verify( _thread );
+            _thread->join();
+            _thread.reset();
+            *res = _res;
+            return _ok;
+        }
+
+    private:
+        void _run() {
+            try {
+                _ok = _conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , _res );
+            }
+            catch ( const std::exception& e ) {
+                _ok = false;
+                _res = BSON( "errmsg" << e.what() );
+            }
+        }
+
+        DBClientBase* const _conn;
+        scoped_ptr<boost::thread> _thread;
+        bool _ok;
+        BSONObj _res;
+    };
+
+    // the most cloned documents applied under one write lock, when not throttled by secondaries
+    const size_t kCloneDocsPerWriteLock = 64;
+
     class MigrateStatus {
     public:
         
@@ -1689,9 +1790,13 @@ namespace mongo {
                 // 3. initial bulk clone
                 state = CLONE;
 
+                // gets arrays of objects to copy, in disk order
+                CloneBatchPrefetcher prefetcher( conn.get() );
+                prefetcher.start();
+
                 while ( true ) {
                     BSONObj res;
-                    if ( ! conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , res ) ) {  // gets array of objects to copy, in disk order
+                    if ( ! prefetcher.wait( &res ) ) {
                         state = FAIL;
                         errmsg = "_migrateClone failed: ";
                         errmsg += res.toString();
@@ -1701,32 +1806,51 @@ namespace mongo {
                     }
 
                     BSONObj arr = res["objects"].Obj();
-                    int thisTime = 0;
+                    if ( arr.isEmpty() )
+                        break;
+
+                    prefetcher.start();
 
+                    vector<BSONObj> docs;
                     BSONObjIterator i( arr );
                     while( i.more() ) {
-                        BSONObj o = i.next().Obj();
+                        docs.push_back( i.next().Obj() );
+                    }
+
+                    // Without secondaryThrottle the documents are applied a group at a time
+                    // rather than taking the write lock for each.  Upserts are idempotent, so
+                    // a page fault just retries from the document that faulted.
+                    const size_t perLock = secondaryThrottle ? 1 : kCloneDocsPerWriteLock;
+                    size_t next = 0;
+                    while ( next < docs.size() ) {
                         {
                             PageFaultRetryableSection pgrs;
                             while ( 1 ) {
                                 try {
                                     Client::WriteContext cx( ns );
 
-                                    BSONObj localDoc;
-                                    if ( willOverrideLocalId( o, &localDoc ) ) {
-                                        string errMsg =
-                                            str::stream() << "cannot migrate chunk, local document "
-                                                          << localDoc
-                                                          << " has same _id as cloned "
-                                                          << "remote document " << o;
+                                    const size_t end = std::min( docs.size(), next + perLock );
+                                    for ( ; next < end; next++ ) {
+                                        const BSONObj& o = docs[next];
 
-                                        warning() << errMsg << endl;
+                                        BSONObj localDoc;
+                                        if ( willOverrideLocalId( o, &localDoc ) ) {
+                                            string errMsg =
+                                                str::stream() << "cannot migrate chunk, local "
+                                                              << "document " << localDoc
+                                                              << " has same _id as cloned "
+                                                              << "remote document " << o;
 
-                                        // Exception will abort migration cleanly
-                                        uasserted( 16976, errMsg );
-                                    }
+                                            warning() << errMsg << endl;
+
+                                            // Exception will abort migration cleanly
+                                            uasserted( 16976, errMsg );
+                                        }
 
-                                    Helpers::upsert( ns, o, true );
+                                        Helpers::upsert( ns, o, true );
+                                        numCloned++;
+                                        clonedBytes += o.objsize();
+                                    }
                                     break;
                                 }
                                 catch ( PageFaultException& e ) {
@@ -1734,19 +1858,13 @@ namespace mongo {
                                 }
                             }
                         }
-                        thisTime++;
-                        numCloned++;
-                        clonedBytes += o.objsize();
 
-                        if ( secondaryThrottle && thisTime > 0 ) {
+                        if ( secondaryThrottle ) {
                             if ( ! waitForReplication( cc().getLastOp(), 2, 60 /* seconds to wait */ ) ) {
                                 warning() << "secondaryThrottle on, but doc insert timed out after 60 seconds, continuing" << endl;
                             }
                         }
                     }
-
-                    if ( thisTime == 0 )
-                        break;
                 }
 
                 timing.done(3);
@@ -0,0 +1,391 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/s/d_reshard.h"
+
+#include <list>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/d_concurrency.h"
+#include "mongo/db/dbhelpers.h"
+#include "mongo/db/range_deleter_service.h"
+#include "mongo/s/d_logic.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    namespace {
+
+        // Beyond this much memory for remembered _ids the resharding is given up, as a migration
+        // would be
+        const long long kMaxMemoryUsed = 500 * 1024 * 1024;
+
+        // Rough size of one batch of changes handed to the resharding mongos
+        const long long kMaxModsBatchSize = 1024 * 1024;
+
+    }  // namespace
+
+    class ReshardDonorStatus {
+    public:
+
+        ReshardDonorStatus() : _mutex( "ReshardDonorStatus" ) {
+            _active = false;
+            _inCriticalSection = false;
+            _overflowed = false;
+            _memoryUsed = 0;
+        }
+
+        bool start( const string& ns, string* errMsg ) {
+            scoped_lock lk( _mutex );
+
+            if ( _active ) {
+                *errMsg = str::stream() << "shard is already resharding " << _ns;
+                return false;
+            }
+
+            verify( _deleted.empty() );
+            verify( _reload.empty() );
+
+            _ns = ns;
+            _active = true;
+            _inCriticalSection = false;
+            _overflowed = false;
+            _memoryUsed = 0;
+            return true;
+        }
+
+        void logOp( const char* opstr,
+                    const char* ns,
+                    const BSONObj& obj,
+                    BSONObj* patt,
+                    bool notInActiveChunk ) {
+
+            // migrations and orphan cleanup don't change the collection's contents
+            if ( notInActiveChunk )
+                return;
+
+            char op = opstr[0];
+            if ( op == 'n' || op =='c' || ( op == 'd' && opstr[1] == 'b' ) )
+                return;
+
+            scoped_lock lk( _mutex );
+
+            if ( ! _active || _ns != ns )
+                return;
+
+            BSONElement ide = patt ? patt->getField( "_id" ) : obj["_id"];
+            if ( ide.eoo() ) {
+                warning() << "logOpForResharding got mod with no _id, ignoring obj: " << obj
+                          << endl;
+                return;
+            }
+
+            if ( _memoryUsed > kMaxMemoryUsed ) {
+                _overflowed = true;
+                return;
+            }
+
+            if ( op == 'd' )
+                _deleted.push_back( ide.wrap() );
+            else
+                _reload.push_back( ide.wrap() );
+            _memoryUsed += ide.size() + 5;
+        }
+
+        /**
+         * Hands out the _ids of the documents deleted and the current version of the documents
+         * written since the last call. Deletes come first, so that applying a batch in order
+         * leaves the copy as the collection was when the batch was built.
+         */
+        bool transferMods( const string& ns, string* errMsg, BSONObjBuilder* result ) {
+            {
+                scoped_lock lk( _mutex );
+                if ( ! _isResharding_inlock( ns, errMsg ) )
+                    return false;
+            }
+
+            long long size = 0;
+            {
+                // writes to 'ns' log under the write lock, so the lists hold still in here
+                Client::ReadContext ctx( ns );
+
+                BSONArrayBuilder deletedArr( result->subarrayStart( "deleted" ) );
+                BSONObj id;
+                while ( size < kMaxModsBatchSize && _popFront( &_deleted, &id ) ) {
+                    deletedArr.append( id );
+                    size += id.objsize();
+                }
+                deletedArr.done();
+
+                BSONArrayBuilder reloadArr( result->subarrayStart( "reload" ) );
+                while ( size < kMaxModsBatchSize && _popFront( &_reload, &id ) ) {
+                    BSONObj doc;
+                    if ( Helpers::findById( cc(), ns.c_str(), id, doc ) ) {
+                        reloadArr.append( doc );
+                        size += doc.objsize();
+                    }
+                    else {
+                        // deleted since, and queued as such
+                        size += id.objsize();
+                    }
+                }
+                reloadArr.done();
+            }
+
+            result->append( "size", size );
+            return true;
+        }
+
+        bool enterCriticalSection( const string& ns, string* errMsg ) {
+            // writes already under way finish first; later ones see the critical section
+            Lock::DBWrite lk( ns );
+            scoped_lock l( _mutex );
+
+            if ( ! _isResharding_inlock( ns, errMsg ) )
+                return false;
+
+            _inCriticalSection = true;
+            return true;
+        }
+
+        void done( const string& ns ) {
+            scoped_lock lk( _mutex );
+
+            if ( ! _active || _ns != ns )
+                return;
+
+            _deleted.clear();
+            _reload.clear();
+            _memoryUsed = 0;
+            _active = false;
+            _inCriticalSection = false;
+            _inCriticalSectionCV.notify_all();
+        }
+
+        bool inCriticalSection( const StringData& ns ) const {
+            scoped_lock lk( _mutex );
+            return _inCriticalSection && ns == _ns;
+        }
+
+        bool waitTillNotInCriticalSection( const StringData& ns, int maxSecondsToWait ) {
+            boost::xtime xt;
+            boost::xtime_get( &xt, MONGO_BOOST_TIME_UTC );
+            xt.sec += maxSecondsToWait;
+
+            scoped_lock lk( _mutex );
+            while ( _inCriticalSection && ns == _ns ) {
+                if ( ! _inCriticalSectionCV.timed_wait( lk.boost(), xt ) )
+                    return false;
+            }
+
+            return true;
+        }
+
+    private:
+
+        bool _isResharding_inlock( const string& ns, string* errMsg ) const {
+            if ( ! _active || _ns != ns ) {
+                *errMsg = str::stream() << "shard is not resharding " << ns;
+                return false;
+            }
+
+            if ( _overflowed ) {
+                *errMsg = str::stream() << "too many changes to " << ns
+                                        << " to keep track of while resharding";
+                return false;
+            }
+
+            return true;
+        }
+
+        bool _popFront( list<BSONObj>* l, BSONObj* id ) {
+            scoped_lock lk( _mutex );
+            if ( l->empty() )
+                return false;
+            *id = l->front();
+            l->pop_front();
+            _memoryUsed -= id->objsize() + 5;
+            return true;
+        }
+
+        // protects all the state below
+        mutable mongo::mutex _mutex;
+        boost::condition _inCriticalSectionCV;
+
+        string _ns;
+        bool _active;
+        bool _inCriticalSection;
+
+        // _ids of the documents deleted and written
+        list<BSONObj> _deleted;
+        list<BSONObj> _reload;
+        long long _memoryUsed;
+
+        // set once the _ids outgrow kMaxMemoryUsed; the resharding must be given up
+        bool _overflowed;
+
+    } reshardDonorStatus;
+
+    void logOpForResharding( const char* opstr,
+                             const char* ns,
+                             const BSONObj& obj,
+                             BSONObj* patt,
+                             bool notInActiveChunk ) {
+        reshardDonorStatus.logOp( opstr, ns, obj, patt, notInActiveChunk );
+    }
+
+    bool inReshardingCriticalSection( const StringData& ns ) {
+        return reshardDonorStatus.inCriticalSection( ns );
+    }
+
+    bool waitTillNotInReshardingCriticalSection( const StringData& ns, int maxSecondsToWait ) {
+        return reshardDonorStatus.waitTillNotInCriticalSection( ns, maxSecondsToWait );
+    }
+
+    class ReshardCommandHelper : public Command {
+    public:
+        ReshardCommandHelper( const char * name ) : Command( name ) {}
+
+        virtual void help( stringstream& help ) const {
+            help << "internal - should not be called directly";
+        }
+        virtual bool slaveOk() const { return false; }
+        virtual bool adminOnly() const { return true; }
+        virtual LockType locktype() const { return NONE; }
+        virtual void addRequiredPrivileges( const std::string& dbname,
+                                            const BSONObj& cmdObj,
+                                            std::vector<Privilege>* out ) {
+            ActionSet actions;
+            actions.addAction( ActionType::_transferMods );
+            out->push_back( Privilege( ResourcePattern::forClusterResource(), actions ) );
+        }
+    };
+
+    /**
+     * { _reshardDonorStart : <ns> }
+     * Starts remembering the documents written to <ns>.
+     */
+    class ReshardDonorStartCommand : public ReshardCommandHelper {
+    public:
+        ReshardDonorStartCommand() : ReshardCommandHelper( "_reshardDonorStart" ) {}
+
+        bool run( const string&, BSONObj& cmdObj, int, string& errmsg,
+                  BSONObjBuilder& result, bool ) {
+            const string ns = cmdObj.firstElement().str();
+            if ( ns.empty() ) {
+                errmsg = "no ns";
+                return false;
+            }
+
+            // a pending range deletion would run against the resharded collection with the
+            // old shard key
+            int numDeletes = getDeleter()->getStats()->getCurrentDeletes();
+            if ( numDeletes > 0 ) {
+                errmsg = str::stream() << "can't reshard because there are still " << numDeletes
+                                       << " deletes from previous migrations";
+                return false;
+            }
+
+            return reshardDonorStatus.start( ns, &errmsg );
+        }
+    } reshardDonorStartCmd;
+
+    /**
+     * { _reshardDonorMods : <ns> }
+     * Returns { deleted : [ <_id> ... ], reload : [ <doc> ... ], size : <bytes> }.
+     */
+    class ReshardDonorModsCommand : public ReshardCommandHelper {
+    public:
+        ReshardDonorModsCommand() : ReshardCommandHelper( "_reshardDonorMods" ) {}
+
+        bool run( const string&, BSONObj& cmdObj, int, string& errmsg,
+                  BSONObjBuilder& result, bool ) {
+            return reshardDonorStatus.transferMods( cmdObj.firstElement().str(),
+                                                    &errmsg,
+                                                    &result );
+        }
+    } reshardDonorModsCmd;
+
+    /**
+     * { _reshardDonorCriticalSection : <ns> }
+     * Turns versioned writes to <ns> away until _reshardDonorDone.
+     */
+    class ReshardDonorCriticalSectionCommand : public ReshardCommandHelper {
+    public:
+        ReshardDonorCriticalSectionCommand()
+            : ReshardCommandHelper( "_reshardDonorCriticalSection" ) {}
+
+        bool run( const string&, BSONObj& cmdObj, int, string& errmsg,
+                  BSONObjBuilder& result, bool ) {
+            return reshardDonorStatus.enterCriticalSection( cmdObj.firstElement().str(),
+                                                            &errmsg );
+        }
+    } reshardDonorCriticalSectionCmd;
+
+    /**
+     * { _reshardDonorDone : <ns>, shadow : <ns>, abort : <bool> }
+     * Stops tracking <ns> and leaves the critical section. Unless aborting, the metadata of
+     * <ns> and of the shadow collection is first reloaded from the config servers, so that
+     * versions from before the cutover are stale from then on.
+     */
+    class ReshardDonorDoneCommand : public ReshardCommandHelper {
+    public:
+        ReshardDonorDoneCommand() : ReshardCommandHelper( "_reshardDonorDone" ) {}
+
+        bool run( const string&, BSONObj& cmdObj, int, string& errmsg,
+                  BSONObjBuilder& result, bool ) {
+            const string ns = cmdObj.firstElement().str();
+
+            if ( ! cmdObj["abort"].trueValue() && shardingState.enabled() ) {
+                ChunkVersion shardVersion;
+                Status status = shardingState.refreshMetadataNow( ns, &shardVersion );
+                if ( ! status.isOK() ) {
+                    // without metadata any versioned request is stale and reloads it
+                    warning() << "could not refresh metadata for resharded collection " << ns
+                              << causedBy( status.reason() ) << endl;
+                    shardingState.resetMetadata( ns );
+                }
+
+                const string shadowNs = cmdObj["shadow"].str();
+                if ( ! shadowNs.empty() ) {
+                    shardingState.refreshMetadataNow( shadowNs, &shardVersion );
+                }
+            }
+
+            reshardDonorStatus.done( ns );
+            return true;
+        }
+    } reshardDonorDoneCmd;
+
+}  // namespace mongo
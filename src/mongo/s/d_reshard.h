@@ -0,0 +1,71 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "mongo/base/string_data.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * Shard side of resharding a collection (see the mongos reshardCollection command).
+     *
+     * While a collection is being resharded, every shard remembers the _ids of the documents
+     * written to it, the way the donor of a migration does, so that the resharding mongos can
+     * copy them again into the collection sharded on the new key. For the cutover the shard
+     * enters a critical section in which versioned writes to the collection are turned away
+     * as stale.
+     *
+     * A shard takes part in at most one resharding at a time.
+     */
+
+    /**
+     * Called for each op the shard logs. Remembers the _id of the document touched if 'ns' is
+     * being resharded.
+     */
+    void logOpForResharding( const char* opstr,
+                             const char* ns,
+                             const BSONObj& obj,
+                             BSONObj* patt,
+                             bool notInActiveChunk );
+
+    /**
+     * @return true if versioned writes to 'ns' must be held off for a resharding cutover
+     */
+    bool inReshardingCriticalSection( const StringData& ns );
+
+    /**
+     * Waits for 'ns' to leave the resharding critical section, if it is in one.
+     * @return true if we are NOT in the critical section
+     */
+    bool waitTillNotInReshardingCriticalSection( const StringData& ns, int maxSecondsToWait );
+
+}  // namespace mongo
@@ -44,7 +44,9 @@
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/index/btree_interface.h"
 #include "mongo/db/index_legacy.h"
+#include "mongo/db/index_names.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/query/internal_plans.h"
@@ -207,6 +209,120 @@ namespace mongo {
         return key.replaceFieldNames(keyPattern).clientReadable();
     }
 
+    // How many keys in the range a btree level must hold for splitVector to sample it rather
+    // than descend further.
+    static const size_t kSplitSampleResolution = 1000;
+
+    /**
+     * Estimates the keys of a subtree by following its middle children down to a leaf and
+     * assuming every bucket on a level is as full as the one read.
+     */
+    static long long estimateSubtreeKeys(const BtreeInterface* bt, const DiskLoc& bucket) {
+        vector<BSONObj> keys;
+        vector<DiskLoc> children;
+        bt->bucketContents(bucket, &keys, &children);
+
+        const DiskLoc child = children[children.size() / 2];
+        if (child.isNull())
+            return keys.size();
+        return keys.size() + children.size() * estimateSubtreeKeys(bt, child);
+    }
+
+    /**
+     * Samples the keys of a btree index in [min, max) without reading each of them.  Descends
+     * a level at a time, reading only the buckets that overlap the range, until a level holds
+     * kSplitSampleResolution keys in the range or is made of leaves.
+     *
+     * Fills 'samples' with that level's keys in the range, in order, and returns roughly how
+     * many index keys there are from one sample up to the next.
+     */
+    static long long sampleIndexKeys(const IndexDescriptor* idx,
+                                     const BSONObj& min,
+                                     const BSONObj& max,
+                                     vector<BSONObj>* samples) {
+        const BtreeInterface* bt = BtreeInterface::interfaces[idx->version()];
+        const Ordering order = Ordering::make(idx->keyPattern());
+
+        vector<DiskLoc> level(1, idx->getHead());
+        vector<BSONObj> keys;
+        vector<DiskLoc> children;
+        while (true) {
+            samples->clear();
+            vector<DiskLoc> below;
+            for (size_t b = 0; b < level.size(); b++) {
+                bt->bucketContents(level[b], &keys, &children);
+                for (size_t i = 0; i < children.size(); i++) {
+                    // children[i] holds the keys between keys[i - 1] and keys[i], both
+                    // inclusive since equal keys are ordered by record
+                    const bool startsBeforeMax =
+                        i == 0 || keys[i - 1].woCompare(max, order, false) < 0;
+                    const bool endsAfterMin =
+                        i == keys.size() || keys[i].woCompare(min, order, false) >= 0;
+                    if (startsBeforeMax && endsAfterMin && !children[i].isNull())
+                        below.push_back(children[i]);
+
+                    if (i < keys.size() && keys[i].woCompare(min, order, false) >= 0 &&
+                            keys[i].woCompare(max, order, false) < 0)
+                        samples->push_back(keys[i]);
+                }
+            }
+
+            if (below.empty())
+                return 1;
+            if (samples->size() >= kSplitSampleResolution)
+                return estimateSubtreeKeys(bt, below[below.size() / 2]) + 1;
+            level.swap(below);
+        }
+    }
+
+    /**
+     * The sampling flavor of splitVector: picks split points among the keys sampleIndexKeys
+     * finds, as if every sample stood for the keys up to the next one.
+     */
+    static void sampleSplitKeys(const IndexDescriptor* idx,
+                                const BSONObj& keyPattern,
+                                const BSONObj& min,
+                                const BSONObj& max,
+                                long long keyCount,
+                                bool forceMedianSplit,
+                                long long maxSplitPoints,
+                                vector<BSONObj>* splitKeys) {
+        vector<BSONObj> samples;
+        const long long keysPerSample = sampleIndexKeys(idx, min, max, &samples);
+        LOG(1) << "splitVector sampled " << samples.size() << " keys, each standing for about "
+               << keysPerSample << " keys" << endl;
+
+        if (forceMedianSplit) {
+            keyCount = samples.size() * keysPerSample / 2;
+        }
+
+        // Like the full scan, the first key of the chunk is a sentinel: splitting there would
+        // leave an empty chunk.
+        splitKeys->push_back(prettyKey(idx->keyPattern(), min).extractFields(keyPattern));
+
+        long long currCount = 0;
+        for (size_t i = 0; i < samples.size(); i++) {
+            currCount += keysPerSample;
+            if (currCount <= keyCount)
+                continue;
+
+            BSONObj currKey = prettyKey(idx->keyPattern(), samples[i]).extractFields(keyPattern);
+            if (currKey.woCompare(splitKeys->back()) == 0)
+                continue;
+
+            splitKeys->push_back(currKey.getOwned());
+            currCount = 0;
+            LOG(4) << "picked a sampled split key: " << currKey << endl;
+
+            if (forceMedianSplit)
+                break;
+            if (maxSplitPoints && (long long)splitKeys->size() - 1 >= maxSplitPoints)
+                break;
+        }
+
+        splitKeys->erase(splitKeys->begin());
+    }
+
     class SplitVector : public Command {
     public:
         SplitVector() : Command( "splitVector" , false ) {}
@@ -222,6 +338,8 @@ namespace mongo {
                  "  \n"
                  "  { splitVector : \"blog.post\" , keyPattern:{x:1} , min:{x:10} , max:{x:20}, force: true }\n"
                  "  'force' will produce one split point even if data is small; defaults to false\n"
+                 "  'sampled' estimates split points from the index's upper levels instead of\n"
+                 "  counting every key; defaults to false\n"
                  "NOTE: This command may take a while to run";
         }
         virtual Status checkAuthForCommand(ClientBasic* client,
@@ -365,6 +483,26 @@ namespace mongo {
                     keyCount = maxChunkObjects;
                 }
                 
+                // Sampling reads btree buckets directly, so it is only for btree-backed indexes.
+                const string indexType = IndexNames::findPluginName(idx->keyPattern());
+                if (jsobj["sampled"].trueValue() &&
+                        (indexType.empty() || indexType == IndexNames::HASHED)) {
+                    Timer timer;
+                    sampleSplitKeys(idx, keyPattern, min, max, keyCount, forceMedianSplit,
+                                    maxSplitPoints, &splitKeys);
+
+                    if (timer.millis() > serverGlobalParams.slowMS) {
+                        warning() << "Sampling the split vector for " << ns << " over "
+                                  << keyPattern << " keyCount: " << keyCount
+                                  << " numSplits: " << splitKeys.size()
+                                  << " took " << timer.millis() << "ms" << endl;
+                    }
+
+                    result.append( "timeMillis", timer.millis() );
+                    result.append( "splitKeys" , splitKeys );
+                    return true;
+                }
+
                 //
                 // 2. Traverse the index and add the keyCount-th key to the result vector. If that key
                 //    appeared in the vector before, we omit it. The invariant here is that all the
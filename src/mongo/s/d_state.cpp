@@ -51,6 +51,7 @@
 #include "mongo/db/wire_version.h"
 #include "mongo/db/repl/is_master.h"
 #include "mongo/client/connpool.h"
+#include "mongo/s/chunk_load_tracker.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/config.h"
 #include "mongo/s/d_logic.h"
@@ -728,6 +729,15 @@ namespace mongo {
         _tl.reset();
     }
 
+    ShardedConnectionInfo* ShardedConnectionInfo::detach() {
+        return _tl.release();
+    }
+
+    void ShardedConnectionInfo::attach( ShardedConnectionInfo* info ) {
+        verify( _tl.get() == 0 );
+        _tl.reset( info );
+    }
+
     const ChunkVersion ShardedConnectionInfo::getVersion( const string& ns ) const {
         NSVersionMap::const_iterator it = _versions.find( ns );
         if ( it != _versions.end() ) {
@@ -1177,6 +1187,54 @@ namespace mongo {
 
     } getShardVersion;
 
+    class GetChunkLoad : public MongodShardCommand {
+    public:
+        GetChunkLoad() : MongodShardCommand("getChunkLoad") {}
+
+        virtual void help( stringstream& help ) const {
+            help << "Internal command.\n"
+                 << "documents read and written per chunk since the last call, halved by each\n"
+                 << "call; needs the trackChunkLoad server parameter\n"
+                 << " example: { getChunkLoad : 'alleyinsider.foo' } ";
+        }
+
+        virtual LockType locktype() const { return NONE; }
+
+        virtual Status checkAuthForCommand(ClientBasic* client,
+                                           const std::string& dbname,
+                                           const BSONObj& cmdObj) {
+            if (!client->getAuthorizationSession()->isAuthorizedForActionsOnResource(
+                    ResourcePattern::forExactNamespace(NamespaceString(parseNs(dbname, cmdObj))),
+                    ActionType::getShardVersion)) {
+                return Status(ErrorCodes::Unauthorized, "Unauthorized");
+            }
+            return Status::OK();
+        }
+        virtual std::string parseNs(const std::string& dbname, const BSONObj& cmdObj) const {
+            return parseNsFullyQualified(dbname, cmdObj);
+        }
+
+        bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool) {
+            string ns = cmdObj["getChunkLoad"].valuestrsafe();
+            if ( ns.size() == 0 ) {
+                errmsg = "need to specify full namespace";
+                return false;
+            }
+
+            result.appendBool( "tracking" , ChunkLoadTracker::isEnabled() );
+
+            BSONArrayBuilder chunks( result.subarrayStart( "chunks" ) );
+            CollectionMetadataPtr metadata = shardingState.getCollectionMetadata( ns );
+            if ( metadata ) {
+                chunkLoadTracker.report( metadata->getCollVersion().epoch(), &chunks );
+            }
+            chunks.done();
+
+            return true;
+        }
+
+    } getChunkLoad;
+
     class ShardingStateCmd : public MongodShardCommand {
     public:
         ShardingStateCmd() : MongodShardCommand( "shardingState" ) {}
@@ -145,7 +145,9 @@ namespace mongo {
             it != _pendingCommands.end(); ++it ) {
 
             PendingCommand* command = *it;
-            dassert( NULL == command->conn );
+
+            // Sent by an earlier sendAll, or failed to send
+            if ( NULL != command->conn || !command->status.isOK() ) continue;
 
             try {
                 dassert( command->endpoint.type() == ConnectionString::MASTER ||
@@ -174,7 +176,8 @@ namespace mongo {
                     // invalidate other connections which might be bad.  But if the connection
                     // doesn't seem bad, don't send it back, because we don't want to reuse it.
                     if ( !command->conn->isFailed() ) {
-                        delete command->conn;
+                        shardConnectionPool.discard( command->endpoint.toString(),
+                                                     command->conn );
                     }
                     else {
                         shardConnectionPool.release( command->endpoint.toString(), command->conn );
@@ -231,7 +234,7 @@ namespace mongo {
             // invalidate other connections which might be bad.  But if the connection doesn't seem
             // bad, don't send it back, because we don't want to reuse it.
             if ( !command->conn->isFailed() ) {
-                delete command->conn;
+                shardConnectionPool.discard( command->endpoint.toString(), command->conn );
             }
             else {
                 shardConnectionPool.release( command->endpoint.toString(), command->conn );
@@ -252,7 +255,9 @@ namespace mongo {
 
             PendingCommand* command = *it;
 
-            if ( NULL != command->conn ) delete command->conn;
+            if ( NULL != command->conn ) {
+                shardConnectionPool.discard( command->endpoint.toString(), command->conn );
+            }
             delete command;
             command = NULL;
         }
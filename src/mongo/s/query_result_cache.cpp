@@ -0,0 +1,232 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/s/query_result_cache.h"
+
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    QueryResultCache queryResultCache;
+
+    QueryResultCache::QueryResultCache()
+        : _mutex("QueryResultCache"),
+          _bytes(0),
+          _hits(0),
+          _misses(0),
+          _inserts(0),
+          _evictions(0),
+          _invalidations(0) {
+    }
+
+    QueryResultCache::WriteScope::WriteScope(QueryResultCache* cache, const std::string& ns)
+        : _cache(cache), _ns(ns) {
+        _cache->invalidate(_ns);
+    }
+
+    QueryResultCache::WriteScope::~WriteScope() {
+        _cache->invalidate(_ns);
+    }
+
+    void QueryResultCache::setNamespaces(const std::set<std::string>& namespaces) {
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        for (NamespaceMap::iterator it = _namespaces.begin(); it != _namespaces.end();) {
+            NamespaceMap::iterator current = it++;
+            if (namespaces.count(current->first))
+                continue;
+
+            NamespaceCache& nsCache = current->second;
+            while (!nsCache.entries.empty())
+                _erase(&nsCache, nsCache.entries.begin());
+            _namespaces.erase(current);
+        }
+
+        for (std::set<std::string>::const_iterator it = namespaces.begin();
+                it != namespaces.end(); ++it) {
+            _namespaces[*it];
+        }
+
+        _numNamespaces.store(_namespaces.size());
+    }
+
+    std::set<std::string> QueryResultCache::getNamespaces() const {
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        std::set<std::string> namespaces;
+        for (NamespaceMap::const_iterator it = _namespaces.begin(); it != _namespaces.end(); ++it)
+            namespaces.insert(it->first);
+        return namespaces;
+    }
+
+    bool QueryResultCache::isEnabled(const std::string& ns) const {
+        if (_numNamespaces.load() == 0)
+            return false;
+
+        SimpleMutex::scoped_lock lk(_mutex);
+        return _namespaces.count(ns) > 0;
+    }
+
+    std::string QueryResultCache::makeKey(const BSONObj& query, const BSONObj& fields,
+                                          int ntoskip, int ntoreturn, int queryOptions) {
+        BufBuilder b;
+        b.appendNum(ntoskip);
+        b.appendNum(ntoreturn);
+        b.appendNum(queryOptions);
+        b.appendBuf(query.objdata(), query.objsize());
+        if (!fields.isEmpty())
+            b.appendBuf(fields.objdata(), fields.objsize());
+        return std::string(b.buf(), b.len());
+    }
+
+    bool QueryResultCache::get(const std::string& ns, const std::string& key,
+                               const ChunkVersion& version, long long maxAgeMillis,
+                               std::string* data, int* nReturned) {
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        NamespaceMap::iterator nsIt = _namespaces.find(ns);
+        if (nsIt == _namespaces.end())
+            return false;
+
+        NamespaceCache& nsCache = nsIt->second;
+        KeyMap::iterator it = nsCache.entries.find(key);
+        if (it == nsCache.entries.end()) {
+            _misses++;
+            return false;
+        }
+
+        const Entry& entry = *it->second;
+        if (!entry.version.isEquivalentTo(version) ||
+                curTimeMillis64() - entry.created > static_cast<unsigned long long>(maxAgeMillis)) {
+            _erase(&nsCache, it);
+            _misses++;
+            return false;
+        }
+
+        *data = entry.data;
+        *nReturned = entry.nReturned;
+        _lru.splice(_lru.end(), _lru, it->second);
+        _hits++;
+        return true;
+    }
+
+    unsigned long long QueryResultCache::getGeneration(const std::string& ns) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        NamespaceMap::const_iterator nsIt = _namespaces.find(ns);
+        return nsIt == _namespaces.end() ? 0 : nsIt->second.generation;
+    }
+
+    void QueryResultCache::put(const std::string& ns, const std::string& key,
+                               const ChunkVersion& version, unsigned long long generation,
+                               const char* data, int size, int nReturned, long long maxBytes) {
+        if (size > maxBytes)
+            return;
+
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        NamespaceMap::iterator nsIt = _namespaces.find(ns);
+        if (nsIt == _namespaces.end() || nsIt->second.generation != generation)
+            return;
+
+        NamespaceCache& nsCache = nsIt->second;
+        KeyMap::iterator it = nsCache.entries.find(key);
+        if (it != nsCache.entries.end())
+            _erase(&nsCache, it);
+
+        while (!_lru.empty() && _bytes + size > maxBytes) {
+            const Entry& oldest = _lru.front();
+            NamespaceCache& oldestNs = _namespaces[oldest.ns];
+            _erase(&oldestNs, oldestNs.entries.find(oldest.key));
+            _evictions++;
+        }
+
+        Entry entry;
+        entry.ns = ns;
+        entry.key = key;
+        entry.version = version;
+        entry.created = curTimeMillis64();
+        entry.data.assign(data, size);
+        entry.nReturned = nReturned;
+
+        nsCache.entries[key] = _lru.insert(_lru.end(), entry);
+        _bytes += size;
+        _inserts++;
+    }
+
+    void QueryResultCache::invalidate(const std::string& ns) {
+        if (_numNamespaces.load() == 0)
+            return;
+
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        NamespaceMap::iterator nsIt = _namespaces.find(ns);
+        if (nsIt == _namespaces.end())
+            return;
+
+        NamespaceCache& nsCache = nsIt->second;
+        nsCache.generation++;
+        if (nsCache.entries.empty())
+            return;
+
+        while (!nsCache.entries.empty())
+            _erase(&nsCache, nsCache.entries.begin());
+        _invalidations++;
+    }
+
+    void QueryResultCache::invalidateDatabase(const std::string& db) {
+        std::set<std::string> namespaces = getNamespaces();
+        for (std::set<std::string>::const_iterator it = namespaces.begin();
+                it != namespaces.end(); ++it) {
+            if (it->compare(0, db.size() + 1, db + ".") == 0)
+                invalidate(*it);
+        }
+    }
+
+    void QueryResultCache::_erase(NamespaceCache* nsCache, KeyMap::iterator it) {
+        _bytes -= it->second->data.size();
+        _lru.erase(it->second);
+        nsCache->entries.erase(it);
+    }
+
+    void QueryResultCache::appendStats(BSONObjBuilder* b) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        b->appendNumber("namespaces", static_cast<long long>(_namespaces.size()));
+        b->appendNumber("entries", static_cast<long long>(_lru.size()));
+        b->appendNumber("bytes", _bytes);
+        b->appendNumber("hits", _hits);
+        b->appendNumber("misses", _misses);
+        b->append("hitRatio", _hits + _misses == 0 ? 0.0 :
+                              static_cast<double>(_hits) / (_hits + _misses));
+        b->appendNumber("inserts", _inserts);
+        b->appendNumber("evictions", _evictions);
+        b->appendNumber("invalidations", _invalidations);
+    }
+
+} // namespace mongo
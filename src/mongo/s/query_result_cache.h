@@ -0,0 +1,163 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/s/chunk_version.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    /**
+     * Replies to queries on read-mostly collections, kept in mongos so that repeating a query
+     * doesn't go to the shards again.
+     *
+     * Only collections named with setNamespaces() are cached, and only queries whose whole
+     * result came back in the first reply, with no cursor left open.  An entry is keyed by the
+     * query, projection, skip, limit and options, and is used only while
+     *  - it is younger than the maximum age the caller gives, which bounds how stale a result
+     *    can be after a write made through another mongos,
+     *  - no write has gone through this mongos to the collection since the query started
+     *    (see WriteScope), and
+     *  - the collection's chunk version is the one it was cached under.
+     * The least recently used entries are dropped to keep the cache under its size limit.
+     */
+    class QueryResultCache {
+    public:
+        QueryResultCache();
+
+        /**
+         * Marks a write to 'ns' for as long as it is in scope.  Cached results of 'ns' are
+         * dropped at both ends, and a query running at either point won't cache its result.
+         */
+        class WriteScope {
+            MONGO_DISALLOW_COPYING(WriteScope);
+        public:
+            WriteScope(QueryResultCache* cache, const std::string& ns);
+            ~WriteScope();
+
+        private:
+            QueryResultCache* const _cache;
+            const std::string _ns;
+        };
+
+        /** sets the collections whose query results are cached, dropping the rest */
+        void setNamespaces(const std::set<std::string>& namespaces);
+        std::set<std::string> getNamespaces() const;
+
+        /** whether queries on 'ns' are cached */
+        bool isEnabled(const std::string& ns) const;
+
+        /** @return the key of a query within its collection */
+        static std::string makeKey(const BSONObj& query, const BSONObj& fields,
+                                   int ntoskip, int ntoreturn, int queryOptions);
+
+        /**
+         * Looks up the result of the query 'key' on 'ns'.  Copies the reply's documents to
+         * 'data' and their number to 'nReturned' if there is one cached under 'version' and
+         * not older than 'maxAgeMillis'.
+         */
+        bool get(const std::string& ns, const std::string& key, const ChunkVersion& version,
+                 long long maxAgeMillis, std::string* data, int* nReturned);
+
+        /**
+         * @return the count of writes to 'ns' so far, to pass to put() once the query taken at
+         *         that point is answered
+         */
+        unsigned long long getGeneration(const std::string& ns) const;
+
+        /**
+         * Caches 'size' bytes of documents at 'data' as the result of the query 'key' on 'ns',
+         * unless a write to 'ns' has started since 'generation'.  Drops the least recently
+         * used entries until the cache holds at most 'maxBytes'.
+         */
+        void put(const std::string& ns, const std::string& key, const ChunkVersion& version,
+                 unsigned long long generation, const char* data, int size, int nReturned,
+                 long long maxBytes);
+
+        /** drops the cached results of 'ns', and any query on it still running won't cache */
+        void invalidate(const std::string& ns);
+
+        /** invalidates every collection of the database 'db' */
+        void invalidateDatabase(const std::string& db);
+
+        void appendStats(BSONObjBuilder* b) const;
+
+    private:
+        struct Entry {
+            std::string ns;
+            std::string key;
+            ChunkVersion version;
+            unsigned long long created;
+            std::string data;
+            int nReturned;
+        };
+
+        // most recently used last
+        typedef std::list<Entry> EntryList;
+        typedef std::map<std::string, EntryList::iterator> KeyMap;
+
+        struct NamespaceCache {
+            NamespaceCache() : generation(0) {}
+
+            KeyMap entries;
+            unsigned long long generation;
+        };
+
+        typedef std::map<std::string, NamespaceCache> NamespaceMap;
+
+        // must hold _mutex
+        void _erase(NamespaceCache* nsCache, KeyMap::iterator it);
+
+        mutable SimpleMutex _mutex;
+        NamespaceMap _namespaces;
+        EntryList _lru;
+        long long _bytes;
+
+        // the number of namespaces cached, read without the mutex so that writes to other
+        // collections don't take it
+        AtomicUInt32 _numNamespaces;
+
+        long long _hits;
+        long long _misses;
+        long long _inserts;
+        long long _evictions;
+        long long _invalidations;
+    };
+
+    extern QueryResultCache queryResultCache;
+
+} // namespace mongo
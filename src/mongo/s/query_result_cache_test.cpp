@@ -0,0 +1,164 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/s/query_result_cache.h"
+
+#include <set>
+#include <string>
+
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using mongo::BSONObj;
+    using mongo::ChunkVersion;
+    using mongo::OID;
+    using mongo::QueryResultCache;
+    using std::set;
+    using std::string;
+
+    const long long kMaxAge = 60 * 1000;
+    const long long kMaxBytes = 1024 * 1024;
+
+    set<string> namespaces(const string& ns) {
+        set<string> result;
+        result.insert(ns);
+        return result;
+    }
+
+    string key(int x) {
+        return QueryResultCache::makeKey(BSON("x" << x), BSONObj(), 0, 0, 0);
+    }
+
+    void put(QueryResultCache* cache, const string& ns, const string& k, const string& data,
+             const ChunkVersion& version = ChunkVersion(0, OID())) {
+        cache->put(ns, k, version, cache->getGeneration(ns), data.data(), data.size(), 1,
+                   kMaxBytes);
+    }
+
+    bool get(QueryResultCache* cache, const string& ns, const string& k, string* data,
+             const ChunkVersion& version = ChunkVersion(0, OID())) {
+        int nReturned;
+        return cache->get(ns, k, version, kMaxAge, data, &nReturned);
+    }
+
+    TEST(QueryResultCache, OnlyEnabledNamespaces) {
+        QueryResultCache cache;
+        cache.setNamespaces(namespaces("test.ref"));
+        ASSERT(cache.isEnabled("test.ref"));
+        ASSERT(!cache.isEnabled("test.other"));
+
+        string data;
+        put(&cache, "test.other", key(1), "abc");
+        ASSERT(!get(&cache, "test.other", key(1), &data));
+
+        put(&cache, "test.ref", key(1), "abc");
+        ASSERT(get(&cache, "test.ref", key(1), &data));
+        ASSERT_EQUALS("abc", data);
+        ASSERT(!get(&cache, "test.ref", key(2), &data));
+
+        cache.setNamespaces(set<string>());
+        ASSERT(!get(&cache, "test.ref", key(1), &data));
+    }
+
+    TEST(QueryResultCache, KeyCoversQueryShape) {
+        ASSERT_NOT_EQUALS(key(1), key(2));
+        ASSERT_NOT_EQUALS(QueryResultCache::makeKey(BSON("x" << 1), BSONObj(), 0, 0, 0),
+                          QueryResultCache::makeKey(BSON("x" << 1), BSONObj(), 0, 1, 0));
+        ASSERT_NOT_EQUALS(QueryResultCache::makeKey(BSON("x" << 1), BSONObj(), 0, 0, 0),
+                          QueryResultCache::makeKey(BSON("x" << 1), BSON("x" << 1), 0, 0, 0));
+        ASSERT_NOT_EQUALS(QueryResultCache::makeKey(BSON("x" << 1), BSONObj(), 0, 0, 0),
+                          QueryResultCache::makeKey(BSON("x" << 1), BSONObj(), 0, 0, 4));
+    }
+
+    TEST(QueryResultCache, WriteInvalidates) {
+        QueryResultCache cache;
+        cache.setNamespaces(namespaces("test.ref"));
+
+        string data;
+        put(&cache, "test.ref", key(1), "abc");
+        cache.invalidate("test.ref");
+        ASSERT(!get(&cache, "test.ref", key(1), &data));
+    }
+
+    TEST(QueryResultCache, QueryOverlappingWriteNotCached) {
+        QueryResultCache cache;
+        cache.setNamespaces(namespaces("test.ref"));
+
+        string data;
+        unsigned long long generation = cache.getGeneration("test.ref");
+        {
+            QueryResultCache::WriteScope write(&cache, "test.ref");
+        }
+        cache.put("test.ref", key(1), ChunkVersion(0, OID()), generation, "abc", 3, 1,
+                  kMaxBytes);
+        ASSERT(!get(&cache, "test.ref", key(1), &data));
+
+        // a query started during a write isn't cached after it
+        {
+            QueryResultCache::WriteScope write(&cache, "test.ref");
+            generation = cache.getGeneration("test.ref");
+        }
+        cache.put("test.ref", key(1), ChunkVersion(0, OID()), generation, "abc", 3, 1,
+                  kMaxBytes);
+        ASSERT(!get(&cache, "test.ref", key(1), &data));
+    }
+
+    TEST(QueryResultCache, ChunkVersionChangeMisses) {
+        QueryResultCache cache;
+        cache.setNamespaces(namespaces("test.ref"));
+
+        OID epoch = OID::gen();
+        string data;
+        put(&cache, "test.ref", key(1), "abc", ChunkVersion(1, 0, epoch));
+        ASSERT(get(&cache, "test.ref", key(1), &data, ChunkVersion(1, 0, epoch)));
+        ASSERT(!get(&cache, "test.ref", key(1), &data, ChunkVersion(2, 0, epoch)));
+    }
+
+    TEST(QueryResultCache, EvictsLeastRecentlyUsed) {
+        QueryResultCache cache;
+        cache.setNamespaces(namespaces("test.ref"));
+
+        string data;
+        string block(kMaxBytes / 2, 'x');
+        put(&cache, "test.ref", key(1), block);
+        put(&cache, "test.ref", key(2), block);
+        ASSERT(get(&cache, "test.ref", key(1), &data));
+
+        put(&cache, "test.ref", key(3), block);
+        ASSERT(get(&cache, "test.ref", key(1), &data));
+        ASSERT(!get(&cache, "test.ref", key(2), &data));
+        ASSERT(get(&cache, "test.ref", key(3), &data));
+
+        // a result bigger than the whole cache isn't kept
+        put(&cache, "test.ref", key(4), string(kMaxBytes + 1, 'x'));
+        ASSERT(!get(&cache, "test.ref", key(4), &data));
+        ASSERT(get(&cache, "test.ref", key(1), &data));
+    }
+
+} // namespace
@@ -49,6 +49,7 @@
 #include "mongo/db/instance.h"
 #include "mongo/db/lasterror.h"
 #include "mongo/db/log_process_details.h"
+#include "mongo/logger/async_log_writer.h"
 #include "mongo/platform/process_id.h"
 #include "mongo/s/balance.h"
 #include "mongo/s/chunk.h"
@@ -521,5 +522,6 @@ void mongo::dbexit( ExitCode rc, const char *why ) {
           << " " << ( why ? why : "" )
           << endl;
     flushForGcov();
+    logger::AsyncLogWriter::flushAll();
     ::_exit(rc);
 }
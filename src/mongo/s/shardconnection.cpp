@@ -32,9 +32,11 @@
 
 #include <set>
 
+#include "mongo/client/dbclient_rs.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/client.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/lasterror.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/s/config.h"
@@ -210,7 +212,7 @@ namespace mongo {
                 }
 
                 if (!isConnGood) {
-                    delete s->avail;
+                    shardConnectionPool.discard(addr, s->avail);
                     s->avail = NULL;
                 }
 
@@ -258,15 +260,14 @@ namespace mongo {
 
                 Shard& shard = all[i];
                 try {
-                    string sconnString = shard.getConnString();
-                    Status* s = _getStatus( sconnString );
-
-                    if( ! s->avail ) {
-                        s->avail = shardConnectionPool.get( sconnString );
-                        s->created++; // After, so failed creation doesn't get counted
-                    }
-
-                    versionManager.checkShardVersionCB( s->avail, ns, false, 1 );
+                    // Only version the connections this thread already holds.  Taking one to
+                    // every shard here made each client thread hold a connection per shard,
+                    // while a connection taken later is versioned when it's handed out anyway.
+                    HostMap::const_iterator it = _hosts.find( shard.getConnString() );
+                    if ( it == _hosts.end() || ! it->second->avail )
+                        continue;
+
+                    versionManager.checkShardVersionCB( it->second->avail, ns, false, 1 );
                 }
                 catch ( const DBException& ex ) {
 
@@ -335,7 +336,7 @@ namespace mongo {
         void clearPool() {
             for(HostMap::iterator iter = _hosts.begin(); iter != _hosts.end(); ++iter) {
                 if (iter->second->avail != NULL) {
-                    delete iter->second->avail;
+                    shardConnectionPool.discard(iter->first, iter->second->avail);
                 }
             }
 
@@ -443,7 +444,7 @@ namespace mongo {
                 ClientConnections::threadInstance()->done(_addr, _conn);
             }
             else {
-                delete _conn;
+                shardConnectionPool.discard(_addr, _conn);
             }
 
             _conn = 0;
@@ -504,6 +505,79 @@ namespace mongo {
         true
     );
 
+    // Limits of shardConnectionPool and of the global pool, see PoolForHost
+    ExportedServerParameter<int> ConnPoolMaxInUseConnsPerHost(
+        ServerParameterSet::getGlobal(),
+        "connPoolMaxInUseConnsPerHost",
+        &PoolForHost::maxInUsePerHost,
+        true,
+        true
+    );
+
+    ExportedServerParameter<int> ConnPoolMaxWaitTimeMillis(
+        ServerParameterSet::getGlobal(),
+        "connPoolMaxWaitTimeMillis",
+        &PoolForHost::maxWaitTimeMillis,
+        true,
+        true
+    );
+
+    ExportedServerParameter<int> ConnPoolIdleTimeoutSecs(
+        ServerParameterSet::getGlobal(),
+        "connPoolIdleTimeoutSecs",
+        &PoolForHost::idleTimeoutSecs,
+        true,
+        true
+    );
+
+    ExportedServerParameter<int> ConnPoolMinIdleConnsPerHost(
+        ServerParameterSet::getGlobal(),
+        "connPoolMinIdleConnsPerHost",
+        &PoolForHost::minIdlePerHost,
+        true,
+        true
+    );
+
+    // Hedged reads to secondaries, see DBClientReplicaSet
+    ExportedServerParameter<bool> HedgedReads(
+        ServerParameterSet::getGlobal(),
+        "hedgedReads",
+        &DBClientReplicaSet::hedgedReads,
+        true,
+        true
+    );
+
+    class HedgedReadsPercentileParameter : public ExportedServerParameter<int> {
+    public:
+        HedgedReadsPercentileParameter() :
+            ExportedServerParameter<int>(ServerParameterSet::getGlobal(),
+                                         "hedgedReadsPercentile",
+                                         &DBClientReplicaSet::hedgedReadsPercentile,
+                                         true,
+                                         true) {}
+
+        virtual Status validate( const int& potentialNewValue ) {
+            if ( potentialNewValue < 1 || potentialNewValue > 100 ) {
+                return Status( ErrorCodes::BadValue,
+                               "hedgedReadsPercentile must be between 1 and 100" );
+            }
+            return Status::OK();
+        }
+    } hedgedReadsPercentileParameter;
+
+    ExportedServerParameter<int> HedgedReadsMinDelayMillis(
+        ServerParameterSet::getGlobal(),
+        "hedgedReadsMinDelayMillis",
+        &DBClientReplicaSet::hedgedReadsMinDelayMillis,
+        true,
+        true
+    );
+
+    ServerStatusMetricField<Counter64> displayHedgedReadsSent(
+        "hedgedReads.sent", &DBClientReplicaSet::hedgedReadsSent );
+    ServerStatusMetricField<Counter64> displayHedgedReadsWon(
+        "hedgedReads.won", &DBClientReplicaSet::hedgedReadsWon );
+
     void ShardConnection::releaseMyConnections() {
         ClientConnections::threadInstance()->releaseAll();
     }
@@ -39,6 +39,7 @@
 #include "mongo/db/auth/action_type.h"
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/max_time.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/index_details.h"
@@ -51,10 +52,13 @@
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/cursors.h"
 #include "mongo/s/grid.h"
+#include "mongo/s/query_result_cache.h"
 #include "mongo/s/request.h"
 #include "mongo/s/version_manager.h"
 #include "mongo/s/write_ops/batch_upconvert.h"
+#include "mongo/util/buffer_pool.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/stringutils.h"
 
 // error codes 8010-8040
 
@@ -67,6 +71,74 @@ namespace mongo {
                                                             true /* startup param */,
                                                             true /* runtime param */);
 
+    // How stale a cached query result may be, which bounds how long a write through another
+    // mongos can go unseen, and how much memory the cached results may take.
+    MONGO_EXPORT_SERVER_PARAMETER(queryResultCacheMaxAgeMillis, int, 1000);
+    MONGO_EXPORT_SERVER_PARAMETER(queryResultCacheSizeMB, int, 64);
+
+    /**
+     * The collections whose query results are cached, as a comma separated list of namespaces.
+     * Empty by default, which caches nothing.
+     */
+    class QueryResultCacheNamespaces : public ServerParameter {
+    public:
+        QueryResultCacheNamespaces()
+            : ServerParameter( ServerParameterSet::getGlobal(), "queryResultCacheNamespaces" ) {
+        }
+
+        virtual void append( BSONObjBuilder& b, const string& name ) {
+            std::set<string> namespaces = queryResultCache.getNamespaces();
+            string joined;
+            joinStringDelim( vector<string>( namespaces.begin(), namespaces.end() ),
+                             &joined, ',' );
+            b.append( name, joined );
+        }
+
+        virtual Status set( const BSONElement& newValueElement ) {
+            if ( newValueElement.type() != String ) {
+                return Status( ErrorCodes::BadValue,
+                               "queryResultCacheNamespaces must be a comma separated string" );
+            }
+            return setFromString( newValueElement.String() );
+        }
+
+        virtual Status setFromString( const string& str ) {
+            vector<string> parts;
+            splitStringDelim( str, &parts, ',' );
+
+            std::set<string> namespaces;
+            for ( vector<string>::const_iterator it = parts.begin(); it != parts.end(); ++it ) {
+                string ns = str::ltrim( *it );
+                while ( !ns.empty() && ns[ns.size() - 1] == ' ' )
+                    ns.erase( ns.size() - 1 );
+                if ( ns.empty() )
+                    continue;
+                if ( !NamespaceString( ns ).isValid() ) {
+                    return Status( ErrorCodes::BadValue,
+                                   str::stream() << "invalid namespace to cache: " << ns );
+                }
+                namespaces.insert( ns );
+            }
+
+            queryResultCache.setNamespaces( namespaces );
+            return Status::OK();
+        }
+    } queryResultCacheNamespaces;
+
+    class QueryResultCacheStats : public ServerStatusSection {
+    public:
+        QueryResultCacheStats() : ServerStatusSection( "queryResultCache" ) {}
+
+        virtual bool includeByDefault() const { return true; }
+
+        virtual BSONObj generateSection( const BSONElement& configElement ) const {
+            BSONObjBuilder b;
+            queryResultCache.appendStats( &b );
+            b.appendNumber( "maxBytes", queryResultCacheSizeMB * 1024LL * 1024 );
+            return b.obj();
+        }
+    } queryResultCacheStats;
+
     class ShardStrategy : public Strategy {
 
         bool _isSystemIndexes( const char* ns ) {
@@ -94,7 +166,10 @@ namespace mongo {
             if ( q.ntoreturn == 1 && strstr(q.ns, ".$cmd") )
                 throw UserException( 8010 , "something is wrong, shouldn't see a command here" );
 
-            QuerySpec qSpec( (string)q.ns, q.query, q.fields, q.ntoskip, q.ntoreturn, q.queryOptions );
+            // exhaust streams from here; the shards just see an ordinary query
+            const bool exhaust = q.queryOptions & QueryOption_Exhaust;
+            QuerySpec qSpec( (string)q.ns, q.query, q.fields, q.ntoskip, q.ntoreturn,
+                             q.queryOptions & ~QueryOption_Exhaust );
 
             // Parse "$maxTimeMS".
             StatusWith<int> maxTimeMS = LiteParsedQuery::parseMaxTimeMSQuery( q.query );
@@ -121,6 +196,32 @@ namespace mongo {
                 return;
             }
             
+            // Results of queries on collections opted into the cache may be answered from it,
+            // and are kept for next time when they fit in the first reply
+            const bool cacheable = ! exhaust && ! qSpec.isExplain() &&
+                ! ( q.queryOptions & QueryOption_CursorTailable ) &&
+                queryResultCache.isEnabled( q.ns );
+            string cacheKey;
+            ChunkVersion cacheVersion;
+            unsigned long long cacheGeneration = 0;
+            if ( cacheable ) {
+                ChunkManagerPtr cm = r.getChunkManager();
+                if ( cm )
+                    cacheVersion = cm->getVersion();
+                cacheKey = QueryResultCache::makeKey( q.query, q.fields, q.ntoskip, q.ntoreturn,
+                                                      q.queryOptions );
+
+                string data;
+                int nReturned;
+                if ( queryResultCache.get( q.ns, cacheKey, cacheVersion,
+                                           queryResultCacheMaxAgeMillis, &data, &nReturned ) ) {
+                    replyToQuery( 0, r.p(), r.m(), const_cast<char*>( data.data() ),
+                                  data.size(), nReturned );
+                    return;
+                }
+                cacheGeneration = queryResultCache.getGeneration( q.ns );
+            }
+
             ParallelSortClusteredCursor * cursor = new ParallelSortClusteredCursor( qSpec, CommandInfo() );
             verify( cursor );
 
@@ -145,10 +246,15 @@ namespace mongo {
                 throw;
             }
 
-            if( cursor->isSharded() ){
+            if ( exhaust ) {
+                ShardedClientCursorPtr cc( new ShardedClientCursor( q , cursor ) );
+                streamExhaustBatches( r, cc.get(), q.ntoreturn, maxTimeMS.getValue(),
+                                      queryTimer );
+            }
+            else if( cursor->isSharded() ){
                 ShardedClientCursorPtr cc (new ShardedClientCursor( q , cursor ));
 
-                BufBuilder buffer( ShardedClientCursor::INIT_REPLY_BUFFER_SIZE );
+                PooledBufBuilder buffer( ShardedClientCursor::INIT_REPLY_BUFFER_SIZE );
                 int docCount = 0;
                 const int startFrom = cc->getTotalSent();
                 bool hasMore = cc->sendNextBatch( r, q.ntoreturn, buffer, docCount );
@@ -166,6 +272,11 @@ namespace mongo {
 
                     cursorCache.store( cc, cursorLeftoverMillis );
                 }
+                else if ( cacheable ) {
+                    queryResultCache.put( q.ns, cacheKey, cacheVersion, cacheGeneration,
+                                          buffer.buf(), buffer.len(), docCount,
+                                          queryResultCacheSizeMB * 1024LL * 1024 );
+                }
 
                 replyToQuery( 0, r.p(), r.m(), buffer.buf(), buffer.len(), docCount,
                         startFrom, hasMore ? cc->getId() : 0 );
@@ -180,6 +291,19 @@ namespace mongo {
                 verify( primary.get() );
                 DBClientCursorPtr shardCursor = cursor->getShardCursor( *primary );
 
+                if ( cacheable ) {
+                    QueryResult* qr =
+                        reinterpret_cast<QueryResult*>( shardCursor->getMessage()->singleData() );
+                    if ( qr->cursorId == 0 &&
+                         ! ( qr->resultFlags() & ( ResultFlag_ErrSet |
+                                                   ResultFlag_ShardConfigStale ) ) ) {
+                        queryResultCache.put( q.ns, cacheKey, cacheVersion, cacheGeneration,
+                                              qr->data(), qr->len - sizeof( QueryResult ),
+                                              qr->nReturned,
+                                              queryResultCacheSizeMB * 1024LL * 1024 );
+                    }
+                }
+
                 // Implicitly stores the cursor in the cache
                 r.reply( *(shardCursor->getMessage()) , shardCursor->originalHost() );
 
@@ -188,6 +312,63 @@ namespace mongo {
             }
         }
 
+        /**
+         * Sends all of an exhaust query's results without waiting for getMores.  As on mongod
+         * (see MyMessageHandler::process), each batch answers the one before it, so the client
+         * just keeps reading until a batch comes with cursor id 0.  The cursor is never stored:
+         * nothing can ask for it again.
+         */
+        void streamExhaustBatches( Request& r, ShardedClientCursor* cc, int ntoreturn,
+                                   int maxTimeMS, const Timer& queryTimer ) {
+            int responseTo = r.m().header()->id;
+            bool first = true;
+            bool hasMore = true;
+            while ( hasMore ) {
+                // the batch is built behind its header and sent as it is
+                PooledBufBuilder buffer( ShardedClientCursor::INIT_REPLY_BUFFER_SIZE );
+                buffer.skip( sizeof( QueryResult ) );
+                int docCount = 0;
+                int flags = 0;
+                const int startFrom = cc->getTotalSent();
+
+                try {
+                    if ( maxTimeMS > 0 && queryTimer.millis() >= maxTimeMS ) {
+                        uasserted( ErrorCodes::ExceededTimeLimit,
+                                   "operation exceeded time limit" );
+                    }
+                    hasMore = cc->sendNextBatch( r, ntoreturn, buffer, docCount );
+                }
+                catch ( const DBException& e ) {
+                    // until something is sent the error is the request's, and may be retried
+                    if ( first )
+                        throw;
+
+                    // later, the client is waiting for another batch; end the stream with it
+                    BSONObj err = BSON( "$err" << e.what() << "code" << e.getCode() );
+                    buffer.reset();
+                    buffer.skip( sizeof( QueryResult ) );
+                    buffer.appendBuf( err.objdata(), err.objsize() );
+                    docCount = 1;
+                    flags = ResultFlag_ErrSet;
+                    hasMore = false;
+                }
+
+                QueryResult* qr = reinterpret_cast<QueryResult*>( buffer.buf() );
+                qr->_resultFlags() = flags;
+                qr->len = buffer.len();
+                qr->setOperation( opReply );
+                qr->cursorId = hasMore ? cc->getId() : 0;
+                qr->startingFrom = startFrom;
+                qr->nReturned = docCount;
+                buffer.decouple();
+
+                Message reply( qr, true );
+                r.p()->reply( r.m(), reply, responseTo );
+                responseTo = reply.header()->id;
+                first = false;
+            }
+        }
+
         virtual void commandOp( const string& db,
                                 const BSONObj& command,
                                 int options,
@@ -283,7 +464,7 @@ namespace mongo {
                 }
 
                 // TODO: Try to match logic of mongod, where on subsequent getMore() we pull lots more data?
-                BufBuilder buffer( ShardedClientCursor::INIT_REPLY_BUFFER_SIZE );
+                PooledBufBuilder buffer( ShardedClientCursor::INIT_REPLY_BUFFER_SIZE );
                 int docCount = 0;
                 const int startFrom = cursor->getTotalSent();
                 bool hasMore = cursor->sendNextBatch( r, ntoreturn, buffer, docCount );
@@ -1373,6 +1554,7 @@ namespace mongo {
             }
 
             const char *ns = r.getns();
+            QueryResultCache::WriteScope cacheWrite( &queryResultCache, ns );
 
             // TODO: Index write logic needs to be audited
             bool isIndexWrite = _isSystemIndexes( ns );
@@ -28,6 +28,8 @@
 
 #include "mongo/s/write_ops/batch_write_exec.h"
 
+#include <deque>
+
 #include "mongo/base/error_codes.h"
 #include "mongo/base/status.h"
 #include "mongo/client/dbclientinterface.h" // ConnectionString (header-only)
@@ -53,7 +55,11 @@ namespace mongo {
         //
 
         // TODO: Unordered map?
-        typedef map<ConnectionString, TargetedWriteBatch*, ConnectionStringComp> HostBatchMap;
+        typedef map<ConnectionString, deque<TargetedWriteBatch*>, ConnectionStringComp>
+            HostBatchMap;
+
+        // How many child batches of an unordered write may be out to one host at once
+        const size_t kMaxUnorderedBatchesInFlight = 4;
     }
 
     static void buildErrorFrom( const Status& status, WriteErrorDetail* error ) {
@@ -70,6 +76,47 @@ namespace mongo {
         }
     }
 
+    // Helper to dispatch a host's waiting batches until it has maxInFlight of them pending,
+    // returns whether any were added to the dispatcher
+    static bool sendWaitingBatches( const ConnectionString& shardHost,
+                                    size_t maxInFlight,
+                                    const BatchedCommandRequest& clientRequest,
+                                    const BatchWriteOp& batchOp,
+                                    MultiCommandDispatch* dispatcher,
+                                    HostBatchMap* waitingBatches,
+                                    HostBatchMap* pendingBatches ) {
+
+        HostBatchMap::iterator waitingIt = waitingBatches->find( shardHost );
+        if ( waitingIt == waitingBatches->end() ) return false;
+
+        deque<TargetedWriteBatch*>& waiting = waitingIt->second;
+        deque<TargetedWriteBatch*>& pending = ( *pendingBatches )[shardHost];
+
+        bool added = false;
+        while ( !waiting.empty() && pending.size() < maxInFlight ) {
+
+            TargetedWriteBatch* nextBatch = waiting.front();
+            waiting.pop_front();
+
+            BatchedCommandRequest request( clientRequest.getBatchType() );
+            batchOp.buildBatchRequest( *nextBatch, &request );
+
+            // Internally we use full namespaces for request/response, but we send the
+            // command to a database with the collection name in the request.
+            NamespaceString nss( request.getNS() );
+            request.setNS( nss.coll() );
+
+            dispatcher->addCommand( shardHost, nss.db(), request );
+
+            // Recv-side is responsible for cleaning up the nextBatch when used
+            pending.push_back( nextBatch );
+            added = true;
+        }
+
+        if ( waiting.empty() ) waitingBatches->erase( waitingIt );
+        return added;
+    }
+
     void BatchWriteExec::executeBatch( const BatchedCommandRequest& clientRequest,
                                        BatchedCommandResponse* clientResponse ) {
 
@@ -139,132 +186,113 @@ namespace mongo {
             // Send all child batches
             //
 
-            size_t numSent = 0;
-            size_t numToSend = childBatches.size();
-            while ( numSent != numToSend ) {
-
-                // Collect batches out on the network, mapped by endpoint
-                HostBatchMap pendingBatches;
-
-                //
-                // Send side
-                //
-
-                // Get as many batches as we can at once
-                for ( vector<TargetedWriteBatch*>::iterator it = childBatches.begin();
-                    it != childBatches.end(); ++it ) {
-
-                    //
-                    // Collect the info needed to dispatch our targeted batch
-                    //
-
-                    TargetedWriteBatch* nextBatch = *it;
-                    // If the batch is NULL, we sent it previously, so skip
-                    if ( nextBatch == NULL ) continue;
-
-                    // Figure out what host we need to dispatch our targeted batch
-                    ConnectionString shardHost;
-                    Status resolveStatus = _resolver->chooseWriteHost( nextBatch->getEndpoint()
-                                                                           .shardName,
-                                                                       &shardHost );
-                    if ( !resolveStatus.isOK() ) {
-
-                        ++numResolveFailures;
-
-                        // Record a resolve failure
-                        // TODO: It may be necessary to refresh the cache if stale, or maybe just
-                        // cancel and retarget the batch
-                        WriteErrorDetail error;
-                        buildErrorFrom( resolveStatus, &error );
-                        batchOp.noteBatchError( *nextBatch, error );
-
-                        // We're done with this batch
-                        *it = NULL;
-                        --numToSend;
-                        continue;
-                    }
-
-                    // If we already have a batch for this host, wait until the next time
-                    HostBatchMap::iterator pendingIt = pendingBatches.find( shardHost );
-                    if ( pendingIt != pendingBatches.end() ) continue;
+            // Batches waiting for their host, and batches out on the network, in the order they
+            // were sent.  The dispatcher hands back one host's responses in that order too.
+            HostBatchMap waitingBatches;
+            HostBatchMap pendingBatches;
 
-                    //
-                    // We now have all the info needed to dispatch the batch
-                    //
+            for ( vector<TargetedWriteBatch*>::iterator it = childBatches.begin();
+                it != childBatches.end(); ++it ) {
 
-                    BatchedCommandRequest request( clientRequest.getBatchType() );
-                    batchOp.buildBatchRequest( *nextBatch, &request );
+                TargetedWriteBatch* nextBatch = *it;
 
-                    // Internally we use full namespaces for request/response, but we send the
-                    // command to a database with the collection name in the request.
-                    NamespaceString nss( request.getNS() );
-                    request.setNS( nss.coll() );
+                // Figure out what host we need to dispatch our targeted batch
+                ConnectionString shardHost;
+                Status resolveStatus = _resolver->chooseWriteHost( nextBatch->getEndpoint()
+                                                                       .shardName,
+                                                                   &shardHost );
+                if ( !resolveStatus.isOK() ) {
 
-                    _dispatcher->addCommand( shardHost, nss.db(), request );
+                    ++numResolveFailures;
 
-                    // Indicate we're done by setting the batch to NULL
-                    // We'll only get duplicate hostEndpoints if we have broadcast and non-broadcast
-                    // endpoints for the same host, so this should be pretty efficient without
-                    // moving stuff around.
-                    *it = NULL;
+                    // Record a resolve failure
+                    // TODO: It may be necessary to refresh the cache if stale, or maybe just
+                    // cancel and retarget the batch
+                    WriteErrorDetail error;
+                    buildErrorFrom( resolveStatus, &error );
+                    batchOp.noteBatchError( *nextBatch, error );
 
-                    // Recv-side is responsible for cleaning up the nextBatch when used
-                    pendingBatches.insert( make_pair( shardHost, nextBatch ) );
+                    // We're done with this batch
+                    delete nextBatch;
+                    continue;
                 }
 
-                // Send them all out
-                _dispatcher->sendAll();
-                numSent += pendingBatches.size();
+                waitingBatches[shardHost].push_back( nextBatch );
+            }
 
-                //
-                // Recv side
-                //
+            // Ordered batches go out one at a time.  Unordered ones are pipelined: a host gets
+            // its next batch as soon as one of its earlier ones comes back, without waiting for
+            // the other hosts.
+            const size_t maxInFlight =
+                clientRequest.getOrdered() ? 1 : kMaxUnorderedBatchesInFlight;
+
+            for ( HostBatchMap::iterator it = waitingBatches.begin();
+                it != waitingBatches.end(); ) {
+                // Sending may erase the host's entry
+                ConnectionString shardHost = ( it++ )->first;
+                sendWaitingBatches( shardHost, maxInFlight, clientRequest, batchOp, _dispatcher,
+                                    &waitingBatches, &pendingBatches );
+            }
+            _dispatcher->sendAll();
 
-                while ( _dispatcher->numPending() > 0 ) {
+            //
+            // Recv side
+            //
 
-                    // Get the response
-                    ConnectionString shardHost;
-                    BatchedCommandResponse response;
-                    Status dispatchStatus = _dispatcher->recvAny( &shardHost, &response );
+            while ( _dispatcher->numPending() > 0 ) {
 
-                    // Get the TargetedWriteBatch to find where to put the response
-                    dassert( pendingBatches.find( shardHost ) != pendingBatches.end() );
-                    TargetedWriteBatch* batchRaw = pendingBatches.find( shardHost )->second;
-                    scoped_ptr<TargetedWriteBatch> batch( batchRaw );
+                // Get the response
+                ConnectionString shardHost;
+                BatchedCommandResponse response;
+                Status dispatchStatus = _dispatcher->recvAny( &shardHost, &response );
 
-                    if ( dispatchStatus.isOK() ) {
+                // Get the TargetedWriteBatch to find where to put the response
+                dassert( pendingBatches.find( shardHost ) != pendingBatches.end() );
+                deque<TargetedWriteBatch*>& hostPending = pendingBatches[shardHost];
+                dassert( !hostPending.empty() );
+                scoped_ptr<TargetedWriteBatch> batch( hostPending.front() );
+                hostPending.pop_front();
 
-                        TrackedErrors trackedErrors;
-                        trackedErrors.startTracking( ErrorCodes::StaleShardVersion );
+                if ( dispatchStatus.isOK() ) {
 
-                        // Dispatch was ok, note response
-                        batchOp.noteBatchResponse( *batch, response, &trackedErrors );
+                    TrackedErrors trackedErrors;
+                    trackedErrors.startTracking( ErrorCodes::StaleShardVersion );
 
-                        // Note if anything was stale
-                        const vector<ShardError*>& staleErrors =
-                            trackedErrors.getErrors( ErrorCodes::StaleShardVersion );
+                    // Dispatch was ok, note response
+                    batchOp.noteBatchResponse( *batch, response, &trackedErrors );
 
-                        if ( staleErrors.size() > 0 ) {
-                            noteStaleResponses( staleErrors, _targeter );
-                            ++numStaleBatches;
-                        }
+                    // Note if anything was stale
+                    const vector<ShardError*>& staleErrors =
+                        trackedErrors.getErrors( ErrorCodes::StaleShardVersion );
 
-                        // Remember that we successfully wrote to this shard
-                        // NOTE: This will record lastOps for shards where we actually didn't update
-                        // or delete any documents, which preserves old behavior but is conservative
-                        _stats->noteWriteAt( shardHost,
-                                             response.isLastOpSet() ? 
-                                             response.getLastOp() : OpTime() );
+                    if ( staleErrors.size() > 0 ) {
+                        noteStaleResponses( staleErrors, _targeter );
+                        ++numStaleBatches;
                     }
-                    else {
 
-                        // Error occurred dispatching, note it
-                        WriteErrorDetail error;
-                        buildErrorFrom( dispatchStatus, &error );
-                        batchOp.noteBatchError( *batch, error );
-                    }
+                    // Remember that we successfully wrote to this shard
+                    // NOTE: This will record lastOps for shards where we actually didn't update
+                    // or delete any documents, which preserves old behavior but is conservative
+                    _stats->noteWriteAt( shardHost,
+                                         response.isLastOpSet() ?
+                                         response.getLastOp() : OpTime() );
+                }
+                else {
+
+                    // Error occurred dispatching, note it
+                    WriteErrorDetail error;
+                    buildErrorFrom( dispatchStatus, &error );
+                    batchOp.noteBatchError( *batch, error );
+                }
+
+                // Keep the host busy with whatever it has left
+                if ( sendWaitingBatches( shardHost, maxInFlight, clientRequest, batchOp,
+                                         _dispatcher, &waitingBatches, &pendingBatches ) ) {
+                    _dispatcher->sendAll();
                 }
             }
+
+            dassert( waitingBatches.empty() );
         }
 
         batchOp.buildClientResponse( clientResponse );
@@ -279,7 +307,9 @@ namespace mongo {
     }
 
     void BatchWriteExecStats::noteWriteAt( const ConnectionString& host, OpTime opTime ) {
-        _writeOpTimes[host] = opTime;
+        // Pipelined batches to one host may come back in any order
+        OpTime& lastOpTime = _writeOpTimes[host];
+        if ( lastOpTime < opTime ) lastOpTime = opTime;
     }
 
     const HostOpTimeMap& BatchWriteExecStats::getWriteOpTimes() const {
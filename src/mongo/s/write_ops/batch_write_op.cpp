@@ -110,6 +110,11 @@ namespace mongo {
         };
 
         typedef std::map<const ShardEndpoint*, TargetedWriteBatch*, EndpointComp> TargetedBatchMap;
+
+        // Unordered writes to one endpoint are cut into child batches of at most this many, so
+        // the exec can keep several in flight to the shard and it starts applying the first
+        // while the rest are still on the wire.
+        const size_t kMaxUnorderedChildBatchWrites = 250;
     }
 
     // Helper function to cancel all the write ops of targeted batch.
@@ -164,6 +169,9 @@ namespace mongo {
                                       vector<TargetedWriteBatch*>* targetedBatches ) {
 
         TargetedBatchMap batchMap;
+        // Unordered child batches which reached kMaxUnorderedChildBatchWrites
+        OwnedPointerVector<TargetedWriteBatch> fullBatchesOwned;
+        vector<TargetedWriteBatch*>& fullBatches = fullBatchesOwned.mutableVector();
         int numTargetErrors = 0;
 
         size_t numWriteOps = _clientRequest->sizeWriteOps();
@@ -207,6 +215,10 @@ namespace mongo {
                     // Cancel current batch state with an error
                     cancelBatches( targetError, _writeOps, &batchMap );
                     dassert( batchMap.empty() );
+                    for ( vector<TargetedWriteBatch*>::iterator it = fullBatches.begin();
+                        it != fullBatches.end(); ++it ) {
+                        cancelBatch( **it, _writeOps, targetError );
+                    }
                     return targetStatus;
                 }
             }
@@ -228,6 +240,13 @@ namespace mongo {
 
                 TargetedWriteBatch* batch = seenIt->second;
                 batch->addWrite( write );
+
+                if ( !_clientRequest->getOrdered()
+                     && batch->getWrites().size() >= kMaxUnorderedChildBatchWrites ) {
+                    // The next write to this endpoint starts a new batch
+                    batchMap.erase( seenIt );
+                    fullBatches.push_back( batch );
+                }
             }
 
             // Relinquish ownership of TargetedWrites, now the TargetedBatches own them
@@ -238,6 +257,16 @@ namespace mongo {
         // Send back our targeted batches
         //
 
+        for ( vector<TargetedWriteBatch*>::iterator it = fullBatches.begin();
+            it != fullBatches.end(); ++it ) {
+
+            TargetedWriteBatch* batch = *it;
+
+            _targeted.insert( batch );
+            targetedBatches->push_back( batch );
+        }
+        fullBatches.clear();
+
         for ( TargetedBatchMap::iterator it = batchMap.begin(); it != batchMap.end(); ++it ) {
 
             TargetedWriteBatch* batch = it->second;
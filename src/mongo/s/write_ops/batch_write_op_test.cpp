@@ -225,6 +225,66 @@ namespace {
         ASSERT( clientResponse.getOk() );
     }
 
+    TEST(WriteOpTests, TargetUnorderedSameShardSplit) {
+
+        //
+        // Large unordered batch to one shard is cut into several child batches
+        //
+
+        NamespaceString nss( "foo.bar" );
+
+        ShardEndpoint endpoint( "shard", ChunkVersion::IGNORED() );
+
+        vector<MockRange*> mockRanges;
+        mockRanges.push_back( new MockRange( endpoint,
+                                             nss,
+                                             BSON( "x" << MINKEY ),
+                                             BSON( "x" << MAXKEY ) ) );
+
+        BatchedCommandRequest request( BatchedCommandRequest::BatchType_Insert );
+        request.setNS( nss.ns() );
+        request.setOrdered( false );
+        request.setWriteConcern( BSONObj() );
+
+        for ( int i = 0; i < 600; i++ ) {
+            request.getInsertRequest()->addToDocuments( BSON( "x" << i ) );
+        }
+
+        BatchWriteOp batchOp;
+        batchOp.initClientRequest( &request );
+
+        MockNSTargeter targeter;
+        targeter.init( mockRanges );
+
+        OwnedPointerVector<TargetedWriteBatch> targetedOwned;
+        vector<TargetedWriteBatch*>& targeted = targetedOwned.mutableVector();
+        Status status = batchOp.targetBatch( targeter, false, &targeted );
+
+        ASSERT( status.isOK() );
+        ASSERT_EQUALS( targeted.size(), 3u );
+
+        size_t numWrites = 0;
+        for ( vector<TargetedWriteBatch*>::iterator it = targeted.begin(); it != targeted.end();
+            ++it ) {
+            assertEndpointsEqual( ( *it )->getEndpoint(), endpoint );
+            ASSERT_LESS_THAN_OR_EQUALS( ( *it )->getWrites().size(), 250u );
+            numWrites += ( *it )->getWrites().size();
+        }
+        ASSERT_EQUALS( numWrites, 600u );
+
+        BatchedCommandResponse response;
+        response.setOk( true );
+        response.setN( 0 );
+        ASSERT( response.isValid( NULL ) );
+
+        for ( vector<TargetedWriteBatch*>::iterator it = targeted.begin(); it != targeted.end();
+            ++it ) {
+            ASSERT( !batchOp.isFinished() );
+            batchOp.noteBatchResponse( **it, response, NULL );
+        }
+        ASSERT( batchOp.isFinished() );
+    }
+
     struct EndpointComp {
         bool operator()( const TargetedWriteBatch* writeA,
                          const TargetedWriteBatch* writeB ) const {
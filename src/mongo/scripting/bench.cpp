@@ -34,7 +34,10 @@
 
 #include "mongo/scripting/bench.h"
 
+#include <algorithm>
 #include <boost/thread/thread.hpp>
+#include <cmath>
+#include <limits>
 
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/scripting/bson_template_evaluator.h"
@@ -68,6 +71,99 @@ namespace {
 
 namespace mongo {
 
+    namespace {
+        // Values below kLinearBuckets get a bucket each.  Above, every power of two range is
+        // split into kSubBuckets buckets, up to values of 2^(kSubBucketBits + kMaxShift + 1).
+        const size_t kLinearBuckets = 128;
+        const size_t kSubBucketBits = 6;
+        const size_t kSubBuckets = 1 << kSubBucketBits;
+        const size_t kMaxShift = 40;
+        const size_t kNumBuckets = kLinearBuckets + kMaxShift * kSubBuckets;
+    }  // namespace
+
+    BenchRunLatencyHistogram::BenchRunLatencyHistogram() : _buckets(kNumBuckets) {
+        reset();
+    }
+
+    void BenchRunLatencyHistogram::reset() {
+        std::fill(_buckets.begin(), _buckets.end(), 0);
+        _count = 0;
+        _max = 0;
+    }
+
+    size_t BenchRunLatencyHistogram::bucketFor(unsigned long long micros) {
+        if (micros < kLinearBuckets)
+            return static_cast<size_t>(micros);
+
+        // keep the top kSubBucketBits + 1 bits of the value
+        size_t shift = 0;
+        while ((micros >> shift) >= 2 * kSubBuckets)
+            ++shift;
+        if (shift > kMaxShift)
+            return kNumBuckets - 1;
+
+        return kLinearBuckets + (shift - 1) * kSubBuckets +
+            static_cast<size_t>((micros >> shift) - kSubBuckets);
+    }
+
+    unsigned long long BenchRunLatencyHistogram::bucketTop(size_t bucket) {
+        if (bucket < kLinearBuckets)
+            return bucket;
+
+        size_t shift = (bucket - kLinearBuckets) / kSubBuckets + 1;
+        unsigned long long sub = (bucket - kLinearBuckets) % kSubBuckets + kSubBuckets;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    void BenchRunLatencyHistogram::record(unsigned long long micros) {
+        ++_buckets[bucketFor(micros)];
+        ++_count;
+        _max = std::max(_max, micros);
+    }
+
+    void BenchRunLatencyHistogram::updateFrom(const BenchRunLatencyHistogram &other) {
+        for (size_t i = 0; i < kNumBuckets; ++i)
+            _buckets[i] += other._buckets[i];
+        _count += other._count;
+        _max = std::max(_max, other._max);
+    }
+
+    unsigned long long BenchRunLatencyHistogram::getPercentile(double percent) const {
+        if (_count == 0)
+            return 0;
+
+        unsigned long long rank =
+            static_cast<unsigned long long>(std::ceil(percent / 100 * _count));
+        rank = std::max(1ULL, std::min(rank, _count));
+
+        unsigned long long seen = 0;
+        for (size_t i = 0; i < kNumBuckets; ++i) {
+            seen += _buckets[i];
+            if (seen >= rank)
+                return std::min(bucketTop(i), _max);
+        }
+        return _max;
+    }
+
+    void BenchRunLatencyHistogram::appendPercentiles(BSONObjBuilder &b) const {
+        b.append("p50", static_cast<long long>(getPercentile(50)));
+        b.append("p90", static_cast<long long>(getPercentile(90)));
+        b.append("p99", static_cast<long long>(getPercentile(99)));
+        b.append("p999", static_cast<long long>(getPercentile(99.9)));
+        b.append("max", static_cast<long long>(_max));
+    }
+
+    void BenchRunLatencyHistogram::appendBuckets(BSONArrayBuilder &b) const {
+        for (size_t i = 0; i < kNumBuckets; ++i) {
+            if (_buckets[i] == 0)
+                continue;
+            BSONArrayBuilder pair(b.subarrayStart());
+            pair.append(static_cast<long long>(std::min(bucketTop(i), _max)));
+            pair.append(static_cast<long long>(_buckets[i]));
+            pair.done();
+        }
+    }
+
     BenchRunEventCounter::BenchRunEventCounter() {
         reset();
     }
@@ -77,11 +173,52 @@ namespace mongo {
     void BenchRunEventCounter::reset() {
         _numEvents = 0;
         _totalTimeMicros = 0;
+        _latencies.reset();
+        _seconds.clear();
+    }
+
+    void BenchRunEventCounter::countOne(unsigned long long timeMicros) {
+        ++_numEvents;
+        _totalTimeMicros += timeMicros;
+        _latencies.record(timeMicros);
+
+        // a clock stepping back charges the events to the latest second seen
+        long long now = curTimeMillis64() / 1000;
+        if (_seconds.empty() || _seconds.back().time < now)
+            _seconds.push_back(Second(now));
+        Second &second = _seconds.back();
+        ++second.numEvents;
+        second.totalTimeMicros += timeMicros;
+        second.maxTimeMicros = std::max(second.maxTimeMicros, timeMicros);
     }
 
     void BenchRunEventCounter::updateFrom(const BenchRunEventCounter &other) {
         _numEvents += other._numEvents;
         _totalTimeMicros += other._totalTimeMicros;
+        _latencies.updateFrom(other._latencies);
+
+        // both are in order: merge them
+        std::vector<Second> merged;
+        merged.reserve(_seconds.size() + other._seconds.size());
+        std::vector<Second>::const_iterator i = _seconds.begin();
+        std::vector<Second>::const_iterator j = other._seconds.begin();
+        while (i != _seconds.end() || j != other._seconds.end()) {
+            if (j == other._seconds.end() || (i != _seconds.end() && i->time < j->time)) {
+                merged.push_back(*i++);
+            }
+            else if (i == _seconds.end() || j->time < i->time) {
+                merged.push_back(*j++);
+            }
+            else {
+                Second second = *i++;
+                second.numEvents += j->numEvents;
+                second.totalTimeMicros += j->totalTimeMicros;
+                second.maxTimeMicros = std::max(second.maxTimeMicros, j->maxTimeMicros);
+                ++j;
+                merged.push_back(second);
+            }
+        }
+        _seconds.swap(merged);
     }
 
     BenchRunStats::BenchRunStats() {
@@ -143,6 +280,10 @@ namespace mongo {
 
         throwGLE = false;
         breakOnTrap = true;
+
+        opsPerSecond = 0;
+        timeSeries = false;
+        reportHistograms = false;
     }
 
     BenchRunConfig *BenchRunConfig::createFromBson( const BSONObj &args ) {
@@ -177,6 +318,12 @@ namespace mongo {
             this->throwGLE = args["throwGLE"].trueValue();
         if ( ! args["breakOnTrap"].eoo() )
             this->breakOnTrap = args["breakOnTrap"].trueValue();
+        if ( args["opsPerSecond"].isNumber() )
+            this->opsPerSecond = args["opsPerSecond"].number();
+        if ( ! args["timeSeries"].eoo() )
+            this->timeSeries = args["timeSeries"].trueValue();
+        if ( ! args["reportHistograms"].eoo() )
+            this->reportHistograms = args["reportHistograms"].trueValue();
 
         uassert(16164, "loopCommands config not supported", args["loopCommands"].eoo());
 
@@ -328,6 +475,11 @@ namespace mongo {
         long long count = 0;
         mongo::Timer timer;
 
+        // with a target rate each worker starts its share of the operations on a fixed schedule
+        const double intervalMicros =
+            _config->opsPerSecond > 0 ? 1000000.0 * _config->parallel / _config->opsPerSecond : 0;
+        long long numScheduled = 0;
+
         BsonTemplateEvaluator bsonTemplateEvaluator;
 
         while ( !shouldStop() ) {
@@ -338,6 +490,17 @@ namespace mongo {
 
                 BSONElement e = i.next();
 
+                unsigned long long queuedMicros = 0;
+                if ( intervalMicros > 0 ) {
+                    long long scheduled =
+                        static_cast<long long>( intervalMicros * numScheduled++ );
+                    long long now = timer.micros();
+                    if ( now < scheduled )
+                        sleepmicros( scheduled - now );
+                    else
+                        queuedMicros = now - scheduled;
+                }
+
                 string ns = e["ns"].String();
                 string op = e["op"].String();
 
@@ -384,7 +547,7 @@ namespace mongo {
 
                         BSONObj result;
                         {
-                            BenchRunEventTrace _bret(&_stats.findOneCounter);
+                            BenchRunEventTrace _bret(&_stats.findOneCounter, queuedMicros);
                             result = conn->findOne( ns , fixQuery( e["query"].Obj(),
                                                                    bsonTemplateEvaluator ) );
                         }
@@ -439,12 +602,12 @@ namespace mongo {
 
                         // use special query function for exhaust query option
                         if (options & QueryOption_Exhaust) {
-                            BenchRunEventTrace _bret(&_stats.queryCounter);
+                            BenchRunEventTrace _bret(&_stats.queryCounter, queuedMicros);
                             boost::function<void (const BSONObj&)> castedDoNothing(doNothing);
                             count =  conn->query(castedDoNothing, ns, fixedQuery, &filter, options);
                         }
                         else {
-                            BenchRunEventTrace _bret(&_stats.queryCounter);
+                            BenchRunEventTrace _bret(&_stats.queryCounter, queuedMicros);
                             cursor = conn->query(ns, fixedQuery, limit, skip, &filter, options,
                                                  batchSize);
                             count = cursor->itcount();
@@ -480,7 +643,7 @@ namespace mongo {
                         bool safe = e["safe"].trueValue();
 
                         {
-                            BenchRunEventTrace _bret(&_stats.updateCounter);
+                            BenchRunEventTrace _bret(&_stats.updateCounter, queuedMicros);
                             conn->update( ns, fixQuery( query, bsonTemplateEvaluator ), update,
                                           upsert , multi );
                             if (safe)
@@ -510,7 +673,7 @@ namespace mongo {
                         bool safe = e["safe"].trueValue();
                         BSONObj result;
                         {
-                            BenchRunEventTrace _bret(&_stats.insertCounter);
+                            BenchRunEventTrace _bret(&_stats.insertCounter, queuedMicros);
                             conn->insert( ns, fixQuery( e["doc"].Obj(), bsonTemplateEvaluator ) );
                             if (safe)
                                 result = conn->getLastErrorDetailed();
@@ -543,7 +706,7 @@ namespace mongo {
                         BSONObj result;
 
                         {
-                            BenchRunEventTrace _bret(&_stats.deleteCounter);
+                            BenchRunEventTrace _bret(&_stats.deleteCounter, queuedMicros);
                             conn->remove( ns, fixQuery( query, bsonTemplateEvaluator ), ! multi );
                             if (safe)
                                 result = conn->getLastErrorDetailed();
@@ -744,7 +907,8 @@ namespace mongo {
 
      BenchRunner* BenchRunner::get( OID oid ) {
          boost::mutex::scoped_lock lk(_staticMutex);
-         return _activeRuns[ oid ];
+         map< OID, BenchRunner* >::const_iterator it = _activeRuns.find( oid );
+         return it == _activeRuns.end() ? NULL : it->second;
      }
 
     void BenchRunner::populateStats( BenchRunStats *stats ) {
@@ -773,6 +937,77 @@ namespace mongo {
                         static_cast<double>(counter.getTotalTimeMicros()) / counter.getNumEvents());
      }
 
+     static void appendPercentilesIfAvailable(
+             BSONObjBuilder &buf, const std::string &name, const BenchRunEventCounter &counter) {
+
+         if (counter.getNumEvents() > 0) {
+             BSONObjBuilder sub(buf.subobjStart(name));
+             counter.getLatencies().appendPercentiles(sub);
+             sub.done();
+         }
+     }
+
+     static void appendSecond(BSONObjBuilder &buf,
+                              const std::string &name,
+                              const BenchRunEventCounter::Second &second) {
+
+         BSONObjBuilder sub(buf.subobjStart(name));
+         sub.append("ops", static_cast<long long>(second.numEvents));
+         sub.append("latencyAverageMicros",
+                    static_cast<double>(second.totalTimeMicros) / second.numEvents);
+         sub.append("latencyMaxMicros", static_cast<long long>(second.maxTimeMicros));
+         sub.done();
+     }
+
+     static void appendHistogramIfAvailable(
+             BSONObjBuilder &buf, const std::string &name, const BenchRunEventCounter &counter) {
+
+         if (counter.getNumEvents() > 0) {
+             BSONArrayBuilder sub(buf.subarrayStart(name));
+             counter.getLatencies().appendBuckets(sub);
+             sub.done();
+         }
+     }
+
+     /**
+      * Append the operations of each second of the run, as an array of
+      * { second : <seconds since the epoch>, <op> : { ops, latencyAverageMicros, ... }, ... }
+      */
+     static void appendTimeSeries(BSONObjBuilder &buf, const BenchRunStats &stats) {
+         const char *names[] = { "findOne", "insert", "delete", "update", "query" };
+         const BenchRunEventCounter *counters[] = { &stats.findOneCounter,
+                                                    &stats.insertCounter,
+                                                    &stats.deleteCounter,
+                                                    &stats.updateCounter,
+                                                    &stats.queryCounter };
+         const size_t numCounters = sizeof(counters) / sizeof(counters[0]);
+
+         std::vector<BenchRunEventCounter::Second>::const_iterator pos[numCounters];
+         for (size_t c = 0; c < numCounters; ++c)
+             pos[c] = counters[c]->getSeconds().begin();
+
+         BSONArrayBuilder series(buf.subarrayStart("timeSeries"));
+         while (true) {
+             // the earliest second not yet reported by any counter
+             long long time = std::numeric_limits<long long>::max();
+             for (size_t c = 0; c < numCounters; ++c) {
+                 if (pos[c] != counters[c]->getSeconds().end())
+                     time = std::min(time, pos[c]->time);
+             }
+             if (time == std::numeric_limits<long long>::max())
+                 break;
+
+             BSONObjBuilder entry(series.subobjStart());
+             entry.append("second", time);
+             for (size_t c = 0; c < numCounters; ++c) {
+                 if (pos[c] != counters[c]->getSeconds().end() && pos[c]->time == time)
+                     appendSecond(entry, names[c], *pos[c]++);
+             }
+             entry.done();
+         }
+         series.done();
+     }
+
      BSONObj BenchRunner::finish( BenchRunner* runner ) {
 
          runner->stop();
@@ -799,6 +1034,20 @@ namespace mongo {
          appendAverageMicrosIfAvailable(buf, "deleteLatencyAverageMicros", stats.deleteCounter);
          appendAverageMicrosIfAvailable(buf, "updateLatencyAverageMicros", stats.updateCounter);
          appendAverageMicrosIfAvailable(buf, "queryLatencyAverageMicros", stats.queryCounter);
+         appendPercentilesIfAvailable(buf, "findOneLatencyPercentilesMicros", stats.findOneCounter);
+         appendPercentilesIfAvailable(buf, "insertLatencyPercentilesMicros", stats.insertCounter);
+         appendPercentilesIfAvailable(buf, "deleteLatencyPercentilesMicros", stats.deleteCounter);
+         appendPercentilesIfAvailable(buf, "updateLatencyPercentilesMicros", stats.updateCounter);
+         appendPercentilesIfAvailable(buf, "queryLatencyPercentilesMicros", stats.queryCounter);
+         if (runner->_config->timeSeries)
+             appendTimeSeries(buf, stats);
+         if (runner->_config->reportHistograms) {
+             appendHistogramIfAvailable(buf, "findOneLatencyHistogramMicros", stats.findOneCounter);
+             appendHistogramIfAvailable(buf, "insertLatencyHistogramMicros", stats.insertCounter);
+             appendHistogramIfAvailable(buf, "deleteLatencyHistogramMicros", stats.deleteCounter);
+             appendHistogramIfAvailable(buf, "updateLatencyHistogramMicros", stats.updateCounter);
+             appendHistogramIfAvailable(buf, "queryLatencyHistogramMicros", stats.queryCounter);
+         }
 
          {
              BSONObjIterator i( after );
@@ -857,6 +1106,7 @@ namespace mongo {
 
         // Get new BenchRunner object
         BenchRunner* runner = BenchRunner::get( oid );
+        uassert( 17384, str::stream() << "no benchRun with id " << oid, runner );
 
         BSONObj finalObj = BenchRunner::finish( runner );
 
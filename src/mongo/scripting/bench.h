@@ -17,6 +17,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/thread/condition.hpp>
@@ -110,11 +111,73 @@ namespace mongo {
         bool throwGLE;
         bool breakOnTrap;
 
+        /**
+         * Total rate, over all threads, at which to start operations, or 0 to start each as
+         * soon as the previous one finished.
+         *
+         * With a rate, the workers generate load on a fixed schedule whatever the response
+         * times, and an operation started late is charged the delay since its scheduled start.
+         * This keeps a server stall from hiding the latency of the operations it holds back
+         * ("coordinated omission").
+         */
+        double opsPerSecond;
+
+        /// Whether to report the number and latency of operations for every second of the run.
+        bool timeSeries;
+
+        /**
+         * Whether to report the latency histograms themselves, so that they can be merged with
+         * those of runs driven from other hosts.
+         */
+        bool reportHistograms;
+
     private:
         /// Initialize a config object to its default values.
         void initializeToDefaults();
     };
 
+    /**
+     * Histogram of durations in microseconds, with buckets no wider than 1/64th of the values
+     * they hold (as in HdrHistogram), so that percentiles are reported within 1.6% for a fixed
+     * cost per recorded value.
+     *
+     * Not thread safe.
+     */
+    class BenchRunLatencyHistogram {
+    public:
+        BenchRunLatencyHistogram();
+
+        void reset();
+
+        void record(unsigned long long micros);
+
+        /// Adds the values recorded in "other" into this.
+        void updateFrom(const BenchRunLatencyHistogram &other);
+
+        unsigned long long getCount() const { return _count; }
+        unsigned long long getMax() const { return _max; }
+
+        /**
+         * Get the value below which "percent" percent of the recorded values fall, rounded up to
+         * the top of its bucket. 0 if nothing was recorded.
+         */
+        unsigned long long getPercentile(double percent) const;
+
+        /// Append the usual percentiles, and the max, to "b".
+        void appendPercentiles(BSONObjBuilder &b) const;
+
+        /// Append a [ <bucket top>, <count> ] pair to "b" for every bucket holding any value.
+        void appendBuckets(BSONArrayBuilder &b) const;
+
+    private:
+        static size_t bucketFor(unsigned long long micros);
+        static unsigned long long bucketTop(size_t bucket);
+
+        std::vector<unsigned long long> _buckets;
+        unsigned long long _count;
+        unsigned long long _max;
+    };
+
     /**
      * An event counter for events that have an associated duration.
      *
@@ -139,10 +202,7 @@ namespace mongo {
         /**
          * Count one instance of the event, which took "timeMicros" microseconds.
          */
-        void countOne(unsigned long long timeMicros) {
-            ++_numEvents;
-            _totalTimeMicros += timeMicros;
-        }
+        void countOne(unsigned long long timeMicros);
 
         /**
          * Get the total number of microseconds ellapsed during all observed events.
@@ -154,9 +214,28 @@ namespace mongo {
          */
         unsigned long long getNumEvents() const { return _numEvents; }
 
+        const BenchRunLatencyHistogram &getLatencies() const { return _latencies; }
+
+        /**
+         * Events counted during one second of wall clock time.
+         */
+        struct Second {
+            Second(long long t) : time(t), numEvents(0), totalTimeMicros(0), maxTimeMicros(0) {}
+
+            long long time; // seconds since the epoch
+            unsigned long long numEvents;
+            unsigned long long totalTimeMicros;
+            unsigned long long maxTimeMicros;
+        };
+
+        /// The events counted in each second in which any happened, in order.
+        const std::vector<Second> &getSeconds() const { return _seconds; }
+
     private:
         unsigned long long _numEvents;
         unsigned long long _totalTimeMicros;
+        BenchRunLatencyHistogram _latencies;
+        std::vector<Second> _seconds;
     };
 
     /**
@@ -174,18 +253,24 @@ namespace mongo {
      */
     class BenchRunEventTrace : private boost::noncopyable {
     public:
-        explicit BenchRunEventTrace(BenchRunEventCounter *eventCounter) {
-            initialize(eventCounter, eventCounter, false);
+        /**
+         * "queuedMicros" is how long the event waited past its scheduled start, and is
+         * counted as part of its duration.
+         */
+        explicit BenchRunEventTrace(BenchRunEventCounter *eventCounter,
+                                    unsigned long long queuedMicros=0) {
+            initialize(eventCounter, eventCounter, false, queuedMicros);
         }
 
         BenchRunEventTrace(BenchRunEventCounter *successCounter,
                            BenchRunEventCounter *failCounter,
                            bool defaultToFailure=true) {
-            initialize(successCounter, failCounter, defaultToFailure);
+            initialize(successCounter, failCounter, defaultToFailure, 0);
         }
 
         ~BenchRunEventTrace() {
-            (_succeeded ? _successCounter : _failCounter)->countOne(_timer.micros());
+            (_succeeded ? _successCounter : _failCounter)->countOne(_timer.micros() +
+                                                                    _queuedMicros);
         }
 
         void succeed() { _succeeded = true; }
@@ -194,16 +279,19 @@ namespace mongo {
     private:
         void initialize(BenchRunEventCounter *successCounter,
                         BenchRunEventCounter *failCounter,
-                        bool defaultToFailure) {
+                        bool defaultToFailure,
+                        unsigned long long queuedMicros) {
             _successCounter = successCounter;
             _failCounter = failCounter;
             _succeeded = !defaultToFailure;
+            _queuedMicros = queuedMicros;
         }
 
         Timer _timer;
         BenchRunEventCounter *_successCounter;
         BenchRunEventCounter *_failCounter;
         bool _succeeded;
+        unsigned long long _queuedMicros;
     };
 
     /**
@@ -352,7 +440,7 @@ namespace mongo {
         static BenchRunner* createWithConfig( const BSONObj &configArgs );
 
         /**
-         * Look up a bench runner object by OID.
+         * Look up a bench runner object by OID.  Returns NULL if there is no such runner.
          *
          * TODO: Same todo as for "createWithConfig".
          */
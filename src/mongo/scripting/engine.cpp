@@ -54,7 +54,8 @@ namespace mongo {
     Scope::Scope() : _localDBName(""),
                      _loadedVersion(0),
                      _numTimesUsed(0),
-                     _lastRetIsNativeCode(false) {
+                     _lastRetIsNativeCode(false),
+                     _memoryUsage(MemoryUsage::kJsScopes) {
     }
 
     Scope::~Scope() {
@@ -106,6 +107,12 @@ namespace mongo {
         return invoke(func, args, recv, timeoutMs);
     }
 
+    int Scope::invokeOnObject(ScriptingFunction func, const BSONObj& obj,
+                              const char* globalName, int timeoutMs) {
+        setObject(globalName, obj);
+        return invoke(func, 0, &obj, timeoutMs);
+    }
+
     bool Scope::execFile(const string& filename, bool printResult, bool reportError,
                          int timeoutMs) {
 #ifdef _WIN32
@@ -300,6 +307,9 @@ namespace {
             if (scope->getTimesUsed() > kMaxScopeReuse)
                 return; // used too many times to save
 
+            if (scope->getNumCachedFunctions() > kMaxCachedFunctions)
+                return; // holding on to too much compiled code
+
             if (!scope->getError().empty())
                 return; // not saving errored scopes
 
@@ -336,7 +346,12 @@ namespace {
 
         // Note: if these numbers change, reconsider choice of datastructure for _pools
         static const unsigned kMaxPoolSize = 10;
-        static const int kMaxScopeReuse = 10;
+
+        // A new scope runs all the shell's core files and recompiles every function it's given,
+        // so scopes are kept for many uses; the JS heap and the functions they've cached bound
+        // what they may grow to.
+        static const int kMaxScopeReuse = 100;
+        static const size_t kMaxCachedFunctions = 1000;
 
         typedef deque<ScopeAndPool> Pools; // More-recently used Scopes are kept at the front.
         Pools _pools;    // protected by _mutex
@@ -393,6 +408,10 @@ namespace {
             return _real->invoke(func, args, recv, timeoutMs, ignoreReturn,
                                  readOnlyArgs, readOnlyRecv);
         }
+        int invokeOnObject(ScriptingFunction func, const BSONObj& obj, const char* globalName,
+                           int timeoutMs) {
+            return _real->invokeOnObject(func, obj, globalName, timeoutMs);
+        }
         bool exec(const StringData& code, const string& name, bool printResult, bool reportError,
                   bool assertOnError, int timeoutMs = 0) {
             return _real->exec(code, name, printResult, reportError, assertOnError, timeoutMs);
@@ -18,11 +18,13 @@
 #pragma once
 
 #include "mongo/db/jsobj.h"
+#include "mongo/platform/unordered_map.h"
+#include "mongo/util/memory_usage.h"
 
 namespace mongo {
     typedef unsigned long long ScriptingFunction;
     typedef BSONObj (*NativeFunction)(const BSONObj& args, void* data);
-    typedef map<string, ScriptingFunction> FunctionCacheMap;
+    typedef unordered_map<string, ScriptingFunction> FunctionCacheMap;
 
     class DBClientWithCommands;
 
@@ -89,6 +91,14 @@ namespace mongo {
                            int timeoutMs = 0, bool ignoreReturn = false, bool readOnlyArgs = false,
                            bool readOnlyRecv = false) = 0;
 
+        /**
+         * Calls 'func' with 'obj' as 'this', and as the global 'globalName' too.  The scope
+         * may make one JS object serve as both.
+         * @return 0 on success
+         */
+        virtual int invokeOnObject(ScriptingFunction func, const BSONObj& obj,
+                                   const char* globalName, int timeoutMs = 0);
+
         void invokeSafe(ScriptingFunction func, const BSONObj* args, const BSONObj* recv,
                         int timeoutMs = 0, bool ignoreReturn = false, bool readOnlyArgs = false,
                         bool readOnlyRecv = false) {
@@ -140,6 +150,9 @@ namespace mongo {
         /** gets the number of times a scope was used */
         int getTimesUsed() { return _numTimesUsed; }
 
+        /** gets the number of functions compiled and kept by createFunction() */
+        size_t getNumCachedFunctions() { return getFunctionCache().size(); }
+
         /** return true if last invoke() return'd native code */
         virtual bool isLastRetNativeCode() { return _lastRetIsNativeCode; }
 
@@ -170,6 +183,7 @@ namespace mongo {
         FunctionCacheMap _cachedFunctions;
         int _numTimesUsed;
         bool _lastRetIsNativeCode; // v8 only: set to true if eval'd script returns a native func
+        MemoryUsageTracker _memoryUsage; // implementations set it to the size of their heap
     };
 
     class ScriptEngine : boost::noncopyable {
@@ -545,6 +545,8 @@ namespace mongo {
         // install global utility functions
         installGlobalUtils(*this);
 
+        noteHeapSize();
+
         // Don't add anything that can throw after this line otherwise we won't be unregistered.
         registerOpId();
     }
@@ -866,7 +868,7 @@ namespace mongo {
             // find the source script based on the resource name supplied to v8::Script::Compile().
             // this is accomplished by converting the integer after the '_funcs' prefix.
             unsigned int funcNum = str::toUnsigned(resourceNameString.substr(6));
-            for (map<string, ScriptingFunction>::iterator it = getFunctionCache().begin();
+            for (FunctionCacheMap::iterator it = getFunctionCache().begin();
                  it != getFunctionCache().end();
                  ++it) {
                 if (it->second == funcNum) {
@@ -997,6 +999,26 @@ namespace mongo {
     int V8Scope::invoke(ScriptingFunction func, const BSONObj* argsObject, const BSONObj* recv,
                         int timeoutMs, bool ignoreReturn, bool readOnlyArgs, bool readOnlyRecv) {
         V8_SIMPLE_HEADER
+        v8::Handle<v8::Object> v8recv;
+        if (recv != 0)
+            v8recv = mongoToLZV8(*recv, readOnlyRecv);
+        else
+            v8recv = _global;
+
+        return invokeOn(func, argsObject, v8recv, timeoutMs, ignoreReturn, readOnlyArgs);
+    }
+
+    int V8Scope::invokeOnObject(ScriptingFunction func, const BSONObj& obj,
+                                const char* globalName, int timeoutMs) {
+        V8_SIMPLE_HEADER
+        v8::Handle<v8::Object> v8obj = mongoToLZV8(obj, false);
+        _global->ForceSet(v8StringData(globalName), v8obj);
+        return invokeOn(func, 0, v8obj, timeoutMs, false, false);
+    }
+
+    int V8Scope::invokeOn(ScriptingFunction func, const BSONObj* argsObject,
+                          v8::Handle<v8::Object> v8recv, int timeoutMs, bool ignoreReturn,
+                          bool readOnlyArgs) {
         v8::Handle<v8::Value> funcValue = _funcs[func-1];
         v8::TryCatch try_catch;
         v8::Local<v8::Value> result;
@@ -1016,12 +1038,6 @@ namespace mongo {
             }
         }
 
-        v8::Handle<v8::Object> v8recv;
-        if (recv != 0)
-            v8recv = mongoToLZV8(*recv, readOnlyRecv);
-        else
-            v8recv = _global;
-
         if (!nativeEpilogue()) {
             _error = "JavaScript execution terminated";
             log() << _error << endl;
@@ -1304,9 +1320,17 @@ namespace mongo {
         _error = "";
         _pendingKill = false;
         _inNativeExecution = true;
+        noteHeapSize();
         registerOpId();
     }
 
+    void V8Scope::noteHeapSize() {
+        // each scope has its own isolate, so this is the heap of this scope alone
+        v8::HeapStatistics stats;
+        v8::V8::GetHeapStatistics(&stats);
+        _memoryUsage.set(sizeof(V8Scope) + stats.total_heap_size());
+    }
+
     v8::Local<v8::Value> V8Scope::newFunction(const StringData& code) {
         v8::HandleScope handle_scope;
         v8::TryCatch try_catch;
@@ -197,6 +197,9 @@ namespace mongo {
                            int timeoutMs = 0, bool ignoreReturn = false,
                            bool readOnlyArgs = false, bool readOnlyRecv = false);
 
+        virtual int invokeOnObject(ScriptingFunction func, const BSONObj& obj,
+                                   const char* globalName, int timeoutMs = 0);
+
         virtual bool exec(const StringData& code, const string& name, bool printResult,
                           bool reportError, bool assertOnError, int timeoutMs);
 
@@ -349,6 +352,14 @@ namespace mongo {
          */
         void wrapBSONObject(v8::Handle<v8::Object> obj, BSONObj data, bool readOnly);
 
+        /**
+         * Calls func with 'v8recv' as 'this'.  The caller must have entered the isolate and
+         * context, as V8_SIMPLE_HEADER does.
+         */
+        int invokeOn(ScriptingFunction func, const BSONObj* argsObject,
+                     v8::Handle<v8::Object> v8recv, int timeoutMs, bool ignoreReturn,
+                     bool readOnlyArgs);
+
         /**
          * Trampoline to call a c++ function with a specific signature (V8Scope*, v8::Arguments&).
          * Handles interruption, exceptions, etc.
@@ -383,6 +394,12 @@ namespace mongo {
          */
         bool nativeEpilogue();
 
+        /**
+         * Report the size of this scope's heap to the memory usage accounting.  The caller must
+         * have entered the isolate.
+         */
+        void noteHeapSize();
+
         /**
          * Register this scope with the mongo op id.  If executing outside the
          * context of a mongo operation (e.g. from the shell), killOp will not
@@ -292,7 +292,7 @@ DBQuery.prototype.comment = function (comment) {
 }
 
 DBQuery.prototype.explain = function (verbose) {
-    /* verbose=true --> include allPlans, oldPlan fields */
+    /* verbose=true --> include allPlans, oldPlan, stats fields */
     var n = this.clone();
     n._addSpecial( "$explain", true );
     n._limit = Math.abs(n._limit) * -1;
@@ -305,6 +305,7 @@ DBQuery.prototype.explain = function (verbose) {
 
         delete obj.allPlans;
         delete obj.oldPlan;
+        delete obj.stats;
 
         if (typeof(obj.length) == 'number'){
             for (var i=0; i < obj.length; i++){
@@ -988,6 +988,133 @@ Math.sigFig = function( x , N ){
     return Math.round(x*p)/p;
 }
 
+/**
+ * Run the benchRun activity described by "args" from each of "agents" at once, and return the
+ * combined results.  The agents are mongods (host strings or connections) started with
+ * enableTestCommands, which generate the load with the benchRunStart and benchRunFinish commands;
+ * many of them can load a cluster far past what the threads of a single shell can.
+ *
+ * The result has the fields of benchRun()'s, with the latencies of all the agents' operations
+ * and the rates of operations seen by args.host, plus the agents' own results in "agents".
+ * With opsPerSecond, each agent starts that many operations per second.
+ */
+benchRunDistributed = function( args , agents ) {
+    var opNames = [ "findOne" , "insert" , "delete" , "update" , "query" ];
+    var numericOrder = function( a , b ) { return a - b; };
+
+    var agentArgs = Object.extend( Object.extend( {} , args ) , { reportHistograms : true } );
+    var seconds = args.seconds || 1;
+
+    var target = new Mongo( args.host || "localhost" ).getDB( args.db || "test" );
+    if ( args.username )
+        target.auth( args.username , args.password );
+    var opcounters = function() {
+        var status = target.serverStatus();
+        assert.commandWorked( status );
+        return status.opcounters;
+    };
+
+    var admins = agents.map( function( agent ) {
+        return ( typeof( agent ) == "string" ? new Mongo( agent ) : agent ).getDB( "admin" );
+    } );
+
+    var before = opcounters();
+    var ids = admins.map( function( admin ) {
+        var res = admin.runCommand( { benchRunStart : agentArgs } );
+        assert.commandWorked( res , "benchRunStart on " + admin.getMongo() );
+        return res.id;
+    } );
+    sleep( 1000 * seconds );
+    var results = admins.map( function( admin , i ) {
+        var res = admin.runCommand( { benchRunFinish : ids[i] } );
+        assert.commandWorked( res , "benchRunFinish on " + admin.getMongo() );
+        return res.results;
+    } );
+    var after = opcounters();
+
+    var merged = { note : "values per second" , errCount : 0 , agents : results };
+    results.forEach( function( res ) {
+        if ( res.err )
+            merged.err = res.err;
+        merged.errCount += Number( res.errCount || 0 );
+    } );
+
+    opNames.forEach( function( op ) {
+        // [ <bucket top> , <count> ] pairs, as the agents report them, summed by bucket
+        var counts = {};
+        var count = 0;
+        var totalMicros = 0;
+        var max = 0;
+        results.forEach( function( res ) {
+            var buckets = res[ op + "LatencyHistogramMicros" ];
+            if ( ! buckets )
+                return;
+            var n = 0;
+            buckets.forEach( function( b ) {
+                var top = Number( b[0] );
+                counts[top] = ( counts[top] || 0 ) + Number( b[1] );
+                n += Number( b[1] );
+                max = Math.max( max , top );
+            } );
+            count += n;
+            totalMicros += res[ op + "LatencyAverageMicros" ] * n;
+            delete res[ op + "LatencyHistogramMicros" ];
+        } );
+        if ( count == 0 )
+            return;
+
+        var tops = Object.keySet( counts ).map( Number ).sort( numericOrder );
+        var percentile = function( percent ) {
+            var rank = Math.max( 1 , Math.min( count , Math.ceil( percent / 100 * count ) ) );
+            var seen = 0;
+            for ( var i = 0; i < tops.length; i++ ) {
+                seen += counts[ tops[i] ];
+                if ( seen >= rank )
+                    return tops[i];
+            }
+            return max;
+        };
+
+        merged[ op + "LatencyAverageMicros" ] = totalMicros / count;
+        merged[ op + "LatencyPercentilesMicros" ] = { p50 : percentile( 50 ) ,
+                                                      p90 : percentile( 90 ) ,
+                                                      p99 : percentile( 99 ) ,
+                                                      p999 : percentile( 99.9 ) ,
+                                                      max : max };
+    } );
+
+    if ( args.timeSeries ) {
+        var bySecond = {};
+        results.forEach( function( res ) {
+            ( res.timeSeries || [] ).forEach( function( s ) {
+                var m = bySecond[ s.second ] = bySecond[ s.second ] || { second : s.second };
+                opNames.forEach( function( op ) {
+                    if ( ! s[op] )
+                        return;
+                    var o = m[op] = m[op] || { ops : 0 , latencyAverageMicros : 0 ,
+                                               latencyMaxMicros : 0 };
+                    var ops = o.ops + Number( s[op].ops );
+                    o.latencyAverageMicros = ( o.latencyAverageMicros * o.ops +
+                                               s[op].latencyAverageMicros * s[op].ops ) / ops;
+                    o.latencyMaxMicros = Math.max( o.latencyMaxMicros ,
+                                                   Number( s[op].latencyMaxMicros ) );
+                    o.ops = ops;
+                } );
+            } );
+        } );
+        merged.timeSeries = Object.keySet( bySecond ).map( Number ).sort( numericOrder ).map(
+            function( s ) {
+                return bySecond[s];
+            } );
+    }
+
+    for ( var name in after ) {
+        merged[name] = ( after[name] - before[name] ) / seconds;
+    }
+
+    return merged;
+}
+
 Random = function() {}
 
 // set random seed
@@ -30,16 +30,20 @@
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/convenience.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
 #include <fcntl.h>
 #include <fstream>
 #include <map>
 
+#include "mongo/client/dbclient_rs.h"
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/db.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/tools/mongodump_options.h"
 #include "mongo/tools/tool.h"
+#include "mongo/util/compress.h"
 #include "mongo/util/options_parser/option_section.h"
 
 using namespace mongo;
@@ -54,7 +58,7 @@ class Dump : public Tool {
         FILE* _f;
     };
 public:
-    Dump() : Tool() { }
+    Dump() : Tool(), _useExhaust(false), _isMongos(false) { }
 
     virtual void printHelp(ostream& out) {
         printMongoDumpHelp(&out);
@@ -85,47 +89,341 @@ public:
         ProgressMeter* _m;
     };
 
-    void doCollection( const string coll , FILE* out , ProgressMeter *m ) {
+    /**
+     * The .bson file of one collection.  It is opened when the first of its readers starts and
+     * closed when the last one finishes, so a parallel dump only holds open the files it is
+     * writing.  Readers hand it whole documents a batch at a time; with --compress each batch
+     * is stored as one block of <int32 compressed size><snappy compressed batch>.
+     */
+    class CollectionFile : boost::noncopyable {
+    public:
+        CollectionFile(const string& ns, const boost::filesystem::path& path, long long count,
+                       int numReaders, bool compress)
+            : _mutex("CollectionFile"), _ns(ns), _path(path), _count(count),
+              _numReaders(numReaders), _compress(compress), _out(NULL), _ownsFile(true) {}
+
+        /** writes to an already open file, such as stdout */
+        explicit CollectionFile(FILE* out)
+            : _mutex("CollectionFile"), _count(0), _numReaders(1), _compress(false), _out(out),
+              _ownsFile(false) {}
+
+        ~CollectionFile() {
+            if (_out && _ownsFile)
+                fclose(_out);
+        }
+
+        void readerStarted() {
+            scoped_lock lk(_mutex);
+            if (_out)
+                return;
+
+            toolInfoLog() << "\t" << _ns << " to " << _path.string() << std::endl;
+            _out = fopen(_path.string().c_str(), "wb");
+            uassert(10262, errnoWithPrefix("couldn't open file"), _out);
+
+            _meter.reset(new ProgressMeter(_count));
+            _meter->setName("Collection File Writing Progress");
+            _meter->setUnits("objects");
+        }
+
+        void write(const char* data, size_t len, int numObjs) {
+            // compress outside the lock, other readers of the collection may be waiting
+            string compressed;
+            if (_compress) {
+                mongo::compress(data, len, &compressed);
+            }
+
+            scoped_lock lk(_mutex);
+            if (_compress) {
+                int size = compressed.size();
+                _write(reinterpret_cast<const char*>(&size), sizeof(size));
+                _write(compressed.data(), compressed.size());
+            }
+            else {
+                _write(data, len);
+            }
+
+            if (_meter) {
+                _meter->hit(numObjs);
+            }
+        }
+
+        void readerDone() {
+            scoped_lock lk(_mutex);
+            if (--_numReaders > 0)
+                return;
+
+            if (_meter) {
+                toolInfoLog() << "\t\t " << _meter->done() << " objects" << std::endl;
+            }
+            if (_ownsFile) {
+                fclose(_out);
+                _out = NULL;
+            }
+            else {
+                fflush(_out);
+            }
+        }
+
+    private:
+        void _write(const char* data, size_t toWrite) {
+            size_t written = 0;
+            while (toWrite) {
+                size_t ret = fwrite(data + written, 1, toWrite, _out);
+                uassert(17395, errnoWithPrefix("couldn't write to file"), ret);
+                toWrite -= ret;
+                written += ret;
+            }
+        }
+
+        mongo::mutex _mutex;
+        const string _ns;
+        const boost::filesystem::path _path;
+        const long long _count;
+        int _numReaders;
+        const bool _compress;
+        FILE* _out;
+        const bool _ownsFile;
+        scoped_ptr<ProgressMeter> _meter;
+    };
+
+    // This is a functor that gathers the documents of a cursor into large writes
+    class BatchWriter : boost::noncopyable {
+    public:
+        static const int kBatchBytes = 8 * 1024 * 1024;
+
+        explicit BatchWriter(CollectionFile* out) : _out(out), _numObjs(0) {}
+
+        void operator () (const BSONObj& obj) {
+            if (_numObjs && _buf.len() + obj.objsize() > kBatchBytes) {
+                flush();
+            }
+            _buf.appendBuf(obj.objdata(), obj.objsize());
+            _numObjs++;
+        }
+
+        void flush() {
+            if (!_numObjs)
+                return;
+            _out->write(_buf.buf(), _buf.len(), _numObjs);
+            _buf.reset();
+            _numObjs = 0;
+        }
+
+    private:
+        CollectionFile* _out;
+        BufBuilder _buf;
+        int _numObjs;
+    };
+
+    /** One cursor's worth of a dump: a whole collection, or one _id range of it. */
+    struct DumpJob {
+        string ns;
+        BSONObj min; // empty for no lower bound
+        BSONObj max; // empty for no upper bound
+        boost::shared_ptr<CollectionFile> out;
+    };
+
+    /** The cursors left to read, shared by the workers of a parallel dump. */
+    class DumpQueue : boost::noncopyable {
+    public:
+        DumpQueue() : _mutex("DumpQueue") {}
+
+        void push(const DumpJob& job) {
+            scoped_lock lk(_mutex);
+            _jobs.push_back(job);
+        }
+
+        /** @return false once the queue is empty or a worker has failed */
+        bool next(DumpJob* job) {
+            scoped_lock lk(_mutex);
+            if (_jobs.empty() || !_error.empty())
+                return false;
+            *job = _jobs.front();
+            _jobs.pop_front();
+            return true;
+        }
+
+        void fail(const string& error) {
+            scoped_lock lk(_mutex);
+            if (_error.empty())
+                _error = error;
+        }
+
+        string error() {
+            scoped_lock lk(_mutex);
+            return _error;
+        }
+
+    private:
+        mongo::mutex _mutex;
+        std::deque<DumpJob> _jobs;
+        string _error;
+    };
+
+    void doCollection( DBClientBase& connBase , const DumpJob& job ) {
         Query q = _query;
 
         int queryOptions = QueryOption_SlaveOk | QueryOption_NoCursorTimeout;
-        if (startsWith(coll.c_str(), "local.oplog."))
+        if (startsWith(job.ns.c_str(), "local.oplog."))
             queryOptions |= QueryOption_OplogReplay;
+        else if (!job.min.isEmpty() || !job.max.isEmpty()) {
+            // walking the _id index also keeps a document that moves from being seen twice
+            q.hint(BSON("_id" << 1));
+            if (!job.min.isEmpty())
+                q.minKey(job.min);
+            if (!job.max.isEmpty())
+                q.maxKey(job.max);
+        }
         else if (mongoDumpGlobalParams.snapShotQuery) {
             q.snapshot();
         }
-        
-        DBClientBase& connBase = conn(true);
-        Writer writer(out, m);
+
+        job.out->readerStarted();
+        BatchWriter writer(job.out.get());
 
         // use low-latency "exhaust" mode if going over the network
-        if (!_usingMongos && typeid(connBase) == typeid(DBClientConnection&)) {
+        if (_useExhaust && typeid(connBase) == typeid(DBClientConnection&)) {
             DBClientConnection& conn = static_cast<DBClientConnection&>(connBase);
-            boost::function<void(const BSONObj&)> castedWriter(writer); // needed for overload resolution
-            conn.query( castedWriter, coll.c_str() , q , NULL, queryOptions | QueryOption_Exhaust);
+            // needed for overload resolution
+            boost::function<void(const BSONObj&)> castedWriter(boost::ref(writer));
+            conn.query( castedWriter, job.ns.c_str() , q , NULL,
+                        queryOptions | QueryOption_Exhaust);
         }
         else {
-            //This branch should only be taken with DBDirectClient or mongos which doesn't support exhaust mode
-            scoped_ptr<DBClientCursor> cursor(connBase.query( coll.c_str() , q , 0 , 0 , 0 , queryOptions ));
+            //This branch should only be taken with DBDirectClient or an older mongos which
+            //doesn't support exhaust mode
+            scoped_ptr<DBClientCursor> cursor(connBase.query( job.ns.c_str() , q , 0 , 0 , 0 ,
+                                                              queryOptions ));
             while ( cursor->more() ) {
                 writer(cursor->next());
             }
         }
+
+        writer.flush();
+        job.out->readerDone();
     }
 
-    void writeCollectionFile( const string coll , boost::filesystem::path outputFile ) {
-        toolInfoLog() << "\t" << coll << " to " << outputFile.string() << std::endl;
+    /** runs on each thread of a parallel dump, over a connection of its own */
+    void dumpWorker( DumpQueue* queue ) {
+        try {
+            scoped_ptr<DBClientBase> c(newConnection());
+            DBClientBase* connBase = c.get();
+            if (c->type() == ConnectionString::SET) {
+                connBase = &static_cast<DBClientReplicaSet*>(c.get())->slaveConn();
+            }
 
-        FilePtr f (fopen(outputFile.string().c_str(), "wb"));
-        uassert(10262, errnoWithPrefix("couldn't open file"), f);
+            DumpJob job;
+            while (queue->next(&job)) {
+                doCollection(*connBase, job);
+            }
+        }
+        catch (const DBException& e) {
+            queue->fail(e.toString());
+        }
+        catch (const std::exception& e) {
+            queue->fail(e.what());
+        }
+    }
 
-        ProgressMeter m(conn(true).count(coll.c_str(), BSONObj(), QueryOption_SlaveOk));
-        m.setName("Collection File Writing Progress");
-        m.setUnits("objects");
+    /**
+     * Reads the collections in the queue with --numParallelCollections workers, or as many as
+     * --numRangePartitions if that is more.  Reading through a data directory is done here,
+     * one cursor at a time.
+     */
+    void runDumpJobs( DumpQueue* queue ) {
+        const int numWorkers = std::max(mongoDumpGlobalParams.numParallelCollections,
+                                        mongoDumpGlobalParams.numRangePartitions);
+
+        if (numWorkers == 1 || toolGlobalParams.useDirectClient) {
+            DumpJob job;
+            while (queue->next(&job)) {
+                doCollection(conn(true), job);
+            }
+            return;
+        }
 
-        doCollection(coll, f, &m);
+        boost::thread_group workers;
+        for (int i = 0; i < numWorkers; i++) {
+            workers.create_thread(boost::bind(&Dump::dumpWorker, this, queue));
+        }
+        workers.join_all();
 
-        toolInfoLog() << "\t\t " << m.done() << " objects" << std::endl;
+        const string error = queue->error();
+        uassert(17376, "parallel dump failed: " + error, error.empty());
+    }
+
+    /**
+     * For a collection of at least --rangePartitionMinMB, the _id values that split it into
+     * --numRangePartitions ranges of about the same size.  Empty when the collection is to be
+     * read with a single cursor.
+     */
+    vector<BSONObj> rangeSplitPoints( const string& ns ) {
+        vector<BSONObj> splitPoints;
+        const int numRanges = mongoDumpGlobalParams.numRangePartitions;
+        if (numRanges < 2 || toolGlobalParams.useDirectClient || _isMongos) {
+            return splitPoints;
+        }
+
+        BSONObj stats;
+        const string db = nsToDatabase(ns);
+        if (!conn(true).runCommand(db, BSON("collStats" << ns.substr(db.size() + 1)), stats) ||
+                stats["capped"].trueValue()) {
+            return splitPoints;
+        }
+
+        const long long size = stats["size"].numberLong();
+        if (size < mongoDumpGlobalParams.rangePartitionMinMB * 1024LL * 1024) {
+            return splitPoints;
+        }
+
+        BSONObj res;
+        if (!conn(true).runCommand("admin",
+                                   BSON("splitVector" << ns
+                                        << "keyPattern" << BSON("_id" << 1)
+                                        << "maxChunkSizeBytes" << 2 * size / numRanges
+                                        << "maxSplitPoints" << numRanges - 1
+                                        << "sampled" << true),
+                                   res)) {
+            toolInfoLog() << "\tcouldn't split " << ns << " into ranges, reading it whole: "
+                          << res["errmsg"].str() << std::endl;
+            return splitPoints;
+        }
+
+        BSONObjIterator it(res["splitKeys"].Obj());
+        while (it.more()) {
+            splitPoints.push_back(it.next().Obj().getOwned());
+        }
+        return splitPoints;
+    }
+
+    /** queues the collection to be read in one cursor or, when large, in several _id ranges */
+    void queueCollection( DumpQueue* queue , const string& coll ,
+                          const boost::filesystem::path& outputFile , bool compress ) {
+        const vector<BSONObj> splitPoints = rangeSplitPoints(coll);
+        long long count = conn(true).count(coll.c_str(), BSONObj(), QueryOption_SlaveOk);
+
+        DumpJob job;
+        job.ns = coll;
+        job.out.reset(new CollectionFile(coll, outputFile, count, splitPoints.size() + 1,
+                                         compress));
+        for (size_t i = 0; i < splitPoints.size(); i++) {
+            job.max = splitPoints[i];
+            queue->push(job);
+            job.min = job.max;
+        }
+        job.max = BSONObj();
+        queue->push(job);
+    }
+
+    void writeCollectionFile( const string coll , boost::filesystem::path outputFile ) {
+        DumpJob job;
+        job.ns = coll;
+        job.out.reset(new CollectionFile(coll, outputFile,
+                                         conn(true).count(coll.c_str(), BSONObj(),
+                                                          QueryOption_SlaveOk),
+                                         1, false));
+        doCollection(conn(true), job);
     }
 
     void writeMetadataFile( const string coll, boost::filesystem::path outputFile, 
@@ -163,7 +461,10 @@ public:
 
 
     void writeCollectionStdout( const string coll ) {
-        doCollection(coll, stdout, NULL);
+        DumpJob job;
+        job.ns = coll;
+        job.out.reset(new CollectionFile(stdout));
+        doCollection(conn(true), job);
     }
 
     void go( const string db , const boost::filesystem::path outdir ) {
@@ -229,12 +530,21 @@ public:
             collections.push_back(name);
         }
         
+        DumpQueue queue;
         for (vector<string>::iterator it = collections.begin(); it != collections.end(); ++it) {
             string name = *it;
             const string filename = name.substr( db.size() + 1 );
-            writeCollectionFile( name , outdir / ( filename + ".bson" ) );
+
+            // system collections stay uncompressed, mongorestore recognizes them by file name
+            if (mongoDumpGlobalParams.compress && !NamespaceString(name).isSystem()) {
+                queueCollection( &queue , name , outdir / ( filename + ".bson.snappy" ) , true );
+            }
+            else {
+                queueCollection( &queue , name , outdir / ( filename + ".bson" ) , false );
+            }
             writeMetadataFile( name, outdir / (filename + ".metadata.json"), collectionOptions, indexes);
         }
+        runDumpJobs( &queue );
 
     }
 
@@ -610,7 +920,8 @@ public:
             }
         }
 
-        _usingMongos = isMongos();
+        _useExhaust = supportsExhaust();
+        _isMongos = !toolGlobalParams.useDirectClient && isMongos();
 
         boost::filesystem::path root(mongoDumpGlobalParams.outputDirectory);
 
@@ -665,7 +976,8 @@ public:
         return 0;
     }
 
-    bool _usingMongos;
+    bool _useExhaust;
+    bool _isMongos;
     BSONObj _query;
 };
 
@@ -197,6 +197,8 @@ public:
         if (mongoExportGlobalParams.jsonArray)
             out << '[';
 
+        // Reused across documents so each one is serialized into the same buffer.
+        StringBuilder json;
         long long num = 0;
         while ( cursor->more() ) {
             num++;
@@ -217,7 +219,9 @@ public:
                 if (mongoExportGlobalParams.jsonArray && num != 1)
                     out << ',';
 
-                out << obj.jsonString();
+                json.reset();
+                obj.jsonString( json );
+                out << json.stringData();
 
                 if (!mongoExportGlobalParams.jsonArray)
                     out << endl;
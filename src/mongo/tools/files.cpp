@@ -67,6 +67,10 @@ public:
         }
 
         GridFS g(conn(), toolGlobalParams.db);
+        if (!toolGlobalParams.useDirectClient) {
+            // overlap the local file i/o with the transfer of the chunks
+            g.setMaxChunksInFlight(8);
+        }
 
         if (mongoFilesGlobalParams.command == "list") {
             BSONObjBuilder b;
@@ -30,14 +30,18 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/thread/thread.hpp>
 #include <fstream>
 #include <iostream>
 
 #include "mongo/base/initializer.h"
 #include "mongo/db/json.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/wire_version.h"
 #include "mongo/tools/mongoimport_options.h"
 #include "mongo/tools/tool.h"
 #include "mongo/util/options_parser/option_section.h"
+#include "mongo/util/queue.h"
 #include "mongo/util/text.h"
 
 using namespace mongo;
@@ -52,6 +56,9 @@ class Import : public Tool {
     const char * _sep;
     static const int BUF_SIZE;
 
+    // Line buffer for parseRow, allocated on first use rather than once per row.
+    boost::scoped_array<char> _rowBuffer;
+
     void csvTokenizeRow(const string& row, vector<string>& tokens) {
         bool inQuotes = false;
         bool prevWasQuote = false;
@@ -183,13 +190,15 @@ class Import : public Tool {
     }
 
     /*
-     * Parses one object from the input file.  This usually corresponds to one line in the input
-     * file, unless the file is a CSV and contains a newline within a quoted string entry.
-     * Returns a true if a BSONObj was successfully created and false if not.
+     * Reads the text of one object from the input file.  This usually corresponds to one line in
+     * the input file, unless the file is a CSV and contains a newline within a quoted string
+     * entry.  Returns false if there was nothing to read.
      */
-    bool parseRow(istream* in, BSONObj& o, int& numBytesRead) {
-        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
-        char* line = buffer.get();
+    bool readRow(istream* in, string& row, int& numBytesRead) {
+        if (!_rowBuffer) {
+            _rowBuffer.reset(new char[BUF_SIZE+2]);
+        }
+        char* line = _rowBuffer.get();
 
         numBytesRead = getLine(in, line);
         line += numBytesRead;
@@ -206,17 +215,12 @@ class Import : public Tool {
                 *end = 0;
                 end--;
             }
-            try {
-                o = fromjson( line );
-            } catch ( MsgAssertionException& e ) {
-                uasserted(13504, string("BSON representation of supplied JSON is too large: ") + e.what());
-            }
+            row = line;
             return true;
         }
 
-        vector<string> tokens;
         if (_type == CSV) {
-            string row;
+            row.clear();
             bool inside_quotes = false;
             size_t last_quote = 0;
             while (true) {
@@ -244,14 +248,36 @@ class Import : public Tool {
             }
             // now 'row' is string corresponding to one row of the CSV file
             // (which may span multiple lines) and represents one BSONObj
-            csvTokenizeRow(row, tokens);
         }
         else {  // _type == TSV
             while (line[0] != '\t' && isspace(line[0])) { // Strip leading whitespace, but not tabs
                 line++;
             }
+            row = line;
+        }
+        return true;
+    }
+
+    /*
+     * Creates the object for a row returned by readRow().  A CSV or TSV header row gives the
+     * field names instead, and an empty object.  Only reads shared state otherwise, so rows can
+     * be parsed on several threads.
+     */
+    BSONObj parseRowText(const string& row) {
+        if (_type == JSON) {
+            try {
+                return fromjson( row );
+            } catch ( MsgAssertionException& e ) {
+                uasserted(13504, string("BSON representation of supplied JSON is too large: ") + e.what());
+            }
+        }
 
-            boost::split(tokens, line, boost::is_any_of(_sep));
+        vector<string> tokens;
+        if (_type == CSV) {
+            csvTokenizeRow(row, tokens);
+        }
+        else {  // _type == TSV
+            boost::split(tokens, row, boost::is_any_of(_sep));
         }
 
         // Now that the row is tokenized, create a BSONObj out of it.
@@ -277,12 +303,26 @@ class Import : public Tool {
                 _append( b , name , token );
             }
         }
-        o = b.obj();
+        return b.obj();
+    }
+
+    /*
+     * Parses one object from the input file.
+     * Returns a true if a BSONObj was successfully created and false if not.
+     */
+    bool parseRow(istream* in, BSONObj& o, int& numBytesRead) {
+        string row;
+        if (!readRow(in, row, numBytesRead)) {
+            return false;
+        }
+        o = parseRowText(row);
         return true;
     }
 
+    bool _useWriteCommands;
+
 public:
-    Import() : Tool() {
+    Import() : Tool(), _useWriteCommands(false) {
         _type = JSON;
     }
 
@@ -333,6 +373,220 @@ public:
         }
     }
 
+    /**
+     * Inserts one batch, through the insert command where the server has it.
+     * @return the number of documents that failed for a reason other than a duplicate key,
+     *         at least 1 if an older server only reports that the batch had an error
+     */
+    int insertBatch(DBClientBase& c, const string& ns, const vector<BSONObj>& docs) {
+        const string db = nsToDatabase(ns);
+
+        if (!_useWriteCommands) {
+            c.insert(ns, docs, InsertOption_ContinueOnError);
+            string err = c.getLastError(db);
+            if (err.empty())
+                return 0;
+            if (str::contains(err, "uplicate")) {
+                toolInfoLog() << err << endl;
+                return 0;
+            }
+            toolInfoLog() << "error: " << err << endl;
+            return 1;
+        }
+
+        BSONObjBuilder cmd;
+        cmd.append("insert", nsToCollectionSubstring(ns));
+        cmd.append("documents", docs);
+        cmd.append("ordered", false);
+
+        BSONObj res;
+        if (!c.runCommand(db, cmd.done(), res)) {
+            toolInfoLog() << "error: " << res["errmsg"].str() << endl;
+            return docs.size();
+        }
+        if (res["writeErrors"].type() != Array)
+            return 0;
+
+        // we don't want to return an error from the mongoimport process for dup key errors
+        int failed = 0;
+        vector<BSONElement> errors = res["writeErrors"].Array();
+        for (size_t i = 0; i < errors.size(); i++) {
+            BSONObj error = errors[i].Obj();
+            const int code = error["code"].numberInt();
+            if (code == 11000 || code == 11001) {
+                toolInfoLog() << error["errmsg"].str() << endl;
+            }
+            else {
+                toolInfoLog() << "error: " << error["errmsg"].str() << endl;
+                failed++;
+            }
+        }
+        return failed;
+    }
+
+    /**
+     * Parses and inserts the rows read on the main thread: --numDecodingWorkers threads turn
+     * chunks of rows into batches of documents, and --numInsertionWorkers threads insert the
+     * batches unordered, each over a connection of its own.
+     */
+    class ImportPipeline : boost::noncopyable {
+    public:
+        static const size_t kRowsPerChunk = 1000;
+        static const size_t kMaxBatchDocs = 1000;
+        static const int kMaxBatchBytes = 8 * 1024 * 1024;
+
+        ImportPipeline(Import* tool, const string& ns)
+            : _tool(tool), _ns(ns), _chunk(new vector<string>()),
+              _chunks(mongoImportGlobalParams.numDecodingWorkers * 2 + 1),
+              _batches(mongoImportGlobalParams.numInsertionWorkers * 2 + 1),
+              _mutex("ImportPipeline"), _numParsed(0), _numFailed(0), _numErrors(0),
+              _stopped(false) {
+            for (int i = 0; i < mongoImportGlobalParams.numDecodingWorkers; i++) {
+                _parsers.create_thread(boost::bind(&ImportPipeline::_parser, this));
+            }
+            for (int i = 0; i < mongoImportGlobalParams.numInsertionWorkers; i++) {
+                _inserters.create_thread(boost::bind(&ImportPipeline::_inserter, this));
+            }
+        }
+
+        ~ImportPipeline() {
+            finish();
+        }
+
+        void addRow(const string& row) {
+            _chunk->push_back(row);
+            if (_chunk->size() == kRowsPerChunk) {
+                _chunks.push(_chunk);
+                _chunk.reset(new vector<string>());
+            }
+        }
+
+        /** whether --stopOnError should stop the reading */
+        bool stopped() {
+            scoped_lock lk(_mutex);
+            return _stopped;
+        }
+
+        /** hands over the last rows and waits until everything is inserted */
+        void finish() {
+            if (!_chunk)
+                return;
+            if (!_chunk->empty())
+                _chunks.push(_chunk);
+            _chunk.reset();
+
+            // an empty chunk or batch tells a worker to stop
+            for (size_t i = 0; i < _parsers.size(); i++)
+                _chunks.push(Chunk());
+            _parsers.join_all();
+            for (size_t i = 0; i < _inserters.size(); i++)
+                _batches.push(Batch());
+            _inserters.join_all();
+        }
+
+        /** documents parsed and not refused by the server */
+        long long numImported() {
+            scoped_lock lk(_mutex);
+            return _numParsed - _numFailed;
+        }
+
+        long long numErrors() {
+            scoped_lock lk(_mutex);
+            return _numErrors;
+        }
+
+        long long numFailedInserts() {
+            scoped_lock lk(_mutex);
+            return _numFailed;
+        }
+
+    private:
+        typedef boost::shared_ptr<vector<string> > Chunk;
+        typedef boost::shared_ptr<vector<BSONObj> > Batch;
+
+        void _parser() {
+            Batch batch(new vector<BSONObj>());
+            int batchBytes = 0;
+            for (Chunk chunk = _chunks.blockingPop(); chunk; chunk = _chunks.blockingPop()) {
+                long long parsed = 0;
+                for (size_t i = 0; i < chunk->size(); i++) {
+                    BSONObj o;
+                    try {
+                        o = _tool->parseRowText((*chunk)[i]);
+                    }
+                    catch (const std::exception& e) {
+                        toolError() << "exception:" << e.what() << std::endl;
+                        _parseError();
+                        continue;
+                    }
+
+                    if (!batch->empty() && (batch->size() == kMaxBatchDocs ||
+                                            batchBytes + o.objsize() > kMaxBatchBytes)) {
+                        _batches.push(batch);
+                        batch.reset(new vector<BSONObj>());
+                        batchBytes = 0;
+                    }
+                    batch->push_back(o);
+                    batchBytes += o.objsize();
+                    parsed++;
+                }
+
+                scoped_lock lk(_mutex);
+                _numParsed += parsed;
+            }
+            if (!batch->empty())
+                _batches.push(batch);
+        }
+
+        void _inserter() {
+            scoped_ptr<DBClientBase> conn;
+            try {
+                conn.reset(_tool->newConnection());
+            }
+            catch (const DBException& e) {
+                toolError() << "exception:" << e.what() << std::endl;
+            }
+
+            // keep taking batches after an error, the parsers may be waiting on a full queue
+            for (Batch batch = _batches.blockingPop(); batch; batch = _batches.blockingPop()) {
+                int failed = batch->size();
+                if (conn) {
+                    try {
+                        failed = _tool->insertBatch(*conn, _ns, *batch);
+                    }
+                    catch (const DBException& e) {
+                        toolError() << "exception:" << e.what() << std::endl;
+                    }
+                }
+                if (failed) {
+                    scoped_lock lk(_mutex);
+                    _numFailed += std::min(size_t(failed), batch->size());
+                    _numErrors++;
+                    _stopped = _stopped || mongoImportGlobalParams.stopOnError;
+                }
+            }
+        }
+
+        void _parseError() {
+            scoped_lock lk(_mutex);
+            _numErrors++;
+            _stopped = _stopped || mongoImportGlobalParams.stopOnError;
+        }
+
+        Import* const _tool;
+        const string _ns;
+        Chunk _chunk;
+        BlockingQueue<Chunk> _chunks;
+        BlockingQueue<Batch> _batches;
+        boost::thread_group _parsers;
+        boost::thread_group _inserters;
+        mongo::mutex _mutex;
+        long long _numParsed;
+        long long _numFailed;
+        long long _numErrors;
+        bool _stopped;
+    };
+
     int run() {
         long long fileSize = 0;
         int headerRows = 0;
@@ -357,6 +611,12 @@ public:
             return -1;
         }
 
+        if (!toolGlobalParams.useDirectClient) {
+            BSONObj isMaster;
+            conn().simpleCommand("admin", &isMaster, "ismaster");
+            _useWriteCommands = isMaster["maxWireVersion"].numberInt() >= BATCH_COMMANDS;
+        }
+
         string ns;
 
         try {
@@ -518,6 +778,49 @@ public:
                 }
             }
         }
+        else if (!mongoImportGlobalParams.upsert && mongoImportGlobalParams.doimport &&
+                 !toolGlobalParams.useDirectClient) {
+            // only the reading happens here, see ImportPipeline
+            ImportPipeline pipeline(this, ns);
+            string row;
+            while (in->rdstate() == 0 && !pipeline.stopped()) {
+                try {
+                    if (!readRow(in, row, len)) {
+                        continue;
+                    }
+
+                    if (mongoImportGlobalParams.headerLine) {
+                        parseRowText(row);
+                        mongoImportGlobalParams.headerLine = false;
+                    }
+                    else {
+                        pipeline.addRow(row);
+                    }
+
+                    num++;
+                }
+                catch ( const std::exception& e ) {
+                    toolError() << "exception:" << e.what() << std::endl;
+                    errors++;
+
+                    if (mongoImportGlobalParams.stopOnError)
+                        break;
+                }
+
+                if (!toolGlobalParams.quiet) {
+                    if (pm.hit(len + 1)) {
+                        log() << "\t\t\t" << num << "\t" << (num / (time(0) - start)) << "/second"
+                              << std::endl;
+                    }
+                }
+            }
+            pipeline.finish();
+
+            // the pipeline has already reported the errors it found
+            num = headerRows + pipeline.numImported();
+            errors += pipeline.numErrors();
+            lastNumChecked = num - 1;
+        }
         else {
             while (in->rdstate() == 0) {
                 try {
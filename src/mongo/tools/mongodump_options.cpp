@@ -72,6 +72,21 @@ namespace mongo {
         options->addOptionChaining("forceTableScan", "forceTableScan", moe::Switch,
                 "force a table scan (do not use $snapshot)");
 
+        options->addOptionChaining("numParallelCollections", "numParallelCollections,j", moe::Int,
+                "number of collections to dump in parallel, default 1")
+                                  .setDefault(moe::Value(1));
+
+        options->addOptionChaining("numRangePartitions", "numRangePartitions", moe::Int,
+                "number of _id ranges to read a large collection in at once, default 1")
+                                  .setDefault(moe::Value(1));
+
+        options->addOptionChaining("rangePartitionMinMB", "rangePartitionMinMB", moe::Int,
+                "only collections at least this large are read in _id ranges, default 1024")
+                                  .setDefault(moe::Value(1024));
+
+        options->addOptionChaining("compress", "compress", moe::Switch,
+                "snappy-compress the collection files, written as <collection>.bson.snappy");
+
         options->addOptionChaining("listExtents", "listExtents", moe::Switch,
                 "list extents for given db collection").requires("dbpath")
                                   .requires("collection").requires("db").hidden();
@@ -139,6 +154,15 @@ namespace mongo {
         mongoDumpGlobalParams.listExtents = hasParam("listExtents");
         mongoDumpGlobalParams.dumpExtent = hasParam("dumpExtent");
         mongoDumpGlobalParams.diskLoc = getParam("diskLoc");
+        mongoDumpGlobalParams.numParallelCollections = getParam("numParallelCollections", 1);
+        mongoDumpGlobalParams.numRangePartitions = getParam("numRangePartitions", 1);
+        mongoDumpGlobalParams.rangePartitionMinMB = getParam("rangePartitionMinMB", 1024);
+        mongoDumpGlobalParams.compress = hasParam("compress");
+        if (mongoDumpGlobalParams.numParallelCollections < 1 ||
+                mongoDumpGlobalParams.numRangePartitions < 1) {
+            return Status(ErrorCodes::BadValue,
+                          "numParallelCollections and numRangePartitions must be at least 1");
+        }
 
         // Make the default db "" if it was not explicitly set
         if (!params.count("db")) {
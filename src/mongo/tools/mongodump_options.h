@@ -46,6 +46,10 @@ namespace mongo {
         bool listExtents;
         bool dumpExtent;
         std::string diskLoc;
+        int numParallelCollections;
+        int numRangePartitions;
+        int rangePartitionMinMB;
+        bool compress;
     };
 
     extern MongoDumpGlobalParams mongoDumpGlobalParams;
@@ -90,6 +90,14 @@ namespace mongo {
         options->addOptionChaining("jsonArray", "jsonArray", moe::Switch,
                 "load a json array, not one item per line. Currently limited to 16MB.");
 
+        options->addOptionChaining("numDecodingWorkers", "numDecodingWorkers", moe::Int,
+                "number of threads parsing the input, default 1")
+                                  .setDefault(moe::Value(1));
+
+        options->addOptionChaining("numInsertionWorkers", "numInsertionWorkers", moe::Int,
+                "number of insert connections to use, default 1")
+                                  .setDefault(moe::Value(1));
+
 
         options->addOptionChaining("noimport", "noimport", moe::Switch,
                 "don't actually import. useful for benchmarking parser")
@@ -155,6 +163,13 @@ namespace mongo {
         mongoImportGlobalParams.jsonArray = hasParam("jsonArray");
         mongoImportGlobalParams.headerLine = hasParam("headerline");
         mongoImportGlobalParams.stopOnError = hasParam("stopOnError");
+        mongoImportGlobalParams.numDecodingWorkers = getParam("numDecodingWorkers", 1);
+        mongoImportGlobalParams.numInsertionWorkers = getParam("numInsertionWorkers", 1);
+        if (mongoImportGlobalParams.numDecodingWorkers < 1 ||
+                mongoImportGlobalParams.numInsertionWorkers < 1) {
+            return Status(ErrorCodes::BadValue,
+                          "numDecodingWorkers and numInsertionWorkers must be at least 1");
+        }
 
         return Status::OK();
     }
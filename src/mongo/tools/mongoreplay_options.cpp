@@ -0,0 +1,111 @@
+/*
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/tools/mongoreplay_options.h"
+
+#include "mongo/base/status.h"
+#include "mongo/util/options_parser/startup_options.h"
+
+namespace mongo {
+
+    MongoReplayGlobalParams mongoReplayGlobalParams;
+
+    Status addMongoReplayOptions(moe::OptionSection* options) {
+        Status ret = addGeneralToolOptions(options);
+        if (!ret.isOK()) {
+            return ret;
+        }
+
+        ret = addRemoteServerToolOptions(options);
+        if (!ret.isOK()) {
+            return ret;
+        }
+
+        options->addOptionChaining("speed", "speed", moe::Double,
+                "replay speed relative to the recording, 0 for as fast as possible")
+                                  .setDefault(moe::Value(1.0));
+
+        options->addOptionChaining("threads", "threads", moe::Int,
+                "number of threads to replay the recorded connections on, "
+                "0 for one per connection")
+                                  .setDefault(moe::Value(0));
+
+        options->addOptionChaining("file", "file", moe::String,
+                "recording made with mongosniff --record")
+                                  .hidden()
+                                  .setSources(moe::SourceCommandLine)
+                                  .positional(1, 1);
+
+        return Status::OK();
+    }
+
+    void printMongoReplayHelp(std::ostream* out) {
+        *out << "Usage: mongoreplay [options] <recording>\n\n"
+             << "Replay requests recorded with mongosniff --record and report their latencies.\n"
+             << std::endl;
+        *out << moe::startupOptions.helpString();
+        *out << std::flush;
+    }
+
+    bool handlePreValidationMongoReplayOptions(const moe::Environment& params) {
+        if (!handlePreValidationGeneralToolOptions(params)) {
+            return false;
+        }
+        if (params.count("help")) {
+            printMongoReplayHelp(&std::cout);
+            return false;
+        }
+        return true;
+    }
+
+    Status storeMongoReplayOptions(const moe::Environment& params,
+                                   const std::vector<std::string>& args) {
+        Status ret = storeGeneralToolOptions(params, args);
+        if (!ret.isOK()) {
+            return ret;
+        }
+
+        if (!params.count("file")) {
+            return Status(ErrorCodes::BadValue, "need a recording to replay");
+        }
+        mongoReplayGlobalParams.file = params["file"].as<string>();
+
+        mongoReplayGlobalParams.speed = params["speed"].as<double>();
+        if (mongoReplayGlobalParams.speed < 0) {
+            return Status(ErrorCodes::BadValue, "--speed can't be negative");
+        }
+
+        mongoReplayGlobalParams.threads = params["threads"].as<int>();
+        if (mongoReplayGlobalParams.threads < 0) {
+            return Status(ErrorCodes::BadValue, "--threads can't be negative");
+        }
+
+        return Status::OK();
+    }
+
+}
@@ -84,6 +84,15 @@ namespace mongo {
         options->addOptionChaining("w", "w", moe::Int, "minimum number of replicas per write")
                                   .setDefault(moe::Value(0));
 
+        options->addOptionChaining("numParallelCollections", "numParallelCollections,j", moe::Int,
+                "number of collections to restore in parallel, default 1")
+                                  .setDefault(moe::Value(1));
+
+        options->addOptionChaining("numInsertionWorkersPerCollection",
+                "numInsertionWorkersPerCollection", moe::Int,
+                "number of insert connections to use per collection, default 1")
+                                  .setDefault(moe::Value(1));
+
         options->addOptionChaining("dir", "dir", moe::String, "directory to restore from")
                                   .hidden()
                                   .setDefault(moe::Value(std::string("dump")))
@@ -136,6 +145,14 @@ namespace mongo {
         mongoRestoreGlobalParams.restoreOptions = !hasParam("noOptionsRestore");
         mongoRestoreGlobalParams.restoreIndexes = !hasParam("noIndexRestore");
         mongoRestoreGlobalParams.w = getParam( "w" , 0 );
+        mongoRestoreGlobalParams.numParallelCollections = getParam("numParallelCollections", 1);
+        mongoRestoreGlobalParams.numInsertionWorkers =
+            getParam("numInsertionWorkersPerCollection", 1);
+        if (mongoRestoreGlobalParams.numParallelCollections < 1 ||
+                mongoRestoreGlobalParams.numInsertionWorkers < 1) {
+            return Status(ErrorCodes::BadValue, "numParallelCollections and "
+                          "numInsertionWorkersPerCollection must be at least 1");
+        }
         mongoRestoreGlobalParams.oplogReplay = hasParam("oplogReplay");
         mongoRestoreGlobalParams.oplogLimit = getParam("oplogLimit", "");
 
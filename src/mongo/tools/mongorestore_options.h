@@ -46,6 +46,8 @@ namespace mongo {
         bool restoreIndexes;
         int w;
         std::string restoreDirectory;
+        int numParallelCollections;
+        int numInsertionWorkers;
     };
 
     extern MongoRestoreGlobalParams mongoRestoreGlobalParams;
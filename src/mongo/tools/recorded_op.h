@@ -0,0 +1,53 @@
+/*
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/db/dbmessage.h"
+#include "mongo/util/net/message.h"
+
+namespace mongo {
+
+    /**
+     * mongosniff --record writes the client requests it sees to a file, each as one of these
+     * headers followed by the message as it went over the wire.  mongoreplay plays the file back.
+     *
+     * Replies are recorded too, so that mongoreplay can match the cursor ids in getMores and
+     * killCursors to the cursors the replayed queries open, but only their first
+     * kReplyRecordLen bytes (through nReturned, no documents) with len set to match.
+     */
+#pragma pack(1)
+    struct RecordedOpHeader {
+        long long micros;      // time the message was seen, from the first one recorded
+        unsigned connection;   // client connection it was on, numbered from 0 as first seen
+    };
+#pragma pack()
+
+    const int kReplyRecordLen = sizeof(QueryResult);
+
+} // namespace mongo
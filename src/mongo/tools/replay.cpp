@@ -0,0 +1,334 @@
+/**
+*    Copyright (C) 2014 MongoDB Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects
+*    for all of the code used other than as permitted herein. If you modify
+*    file(s) with this exception, you may extend this exception to your
+*    version of the file(s), but you are not obligated to do so. If you do not
+*    wish to do so, delete this exception statement from your version. If you
+*    delete this exception statement from all source files in the program,
+*    then also delete it in the license file.
+*/
+
+#include "mongo/pch.h"
+
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <iomanip>
+#include <iostream>
+
+#include "mongo/client/dbclientinterface.h"
+#include "mongo/db/dbmessage.h"
+#include "mongo/tools/mongoreplay_options.h"
+#include "mongo/tools/recorded_op.h"
+#include "mongo/tools/tool.h"
+#include "mongo/util/buffer_pool.h"
+#include "mongo/util/mmap.h"
+#include "mongo/util/time_support.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    /**
+     * Plays back a recording made with mongosniff --record.  Each recorded client connection
+     * gets a connection of its own and sends its requests in the order and, scaled by --speed,
+     * at the times they were recorded.  Connections are spread over --threads threads; ones
+     * sharing a thread can only go as fast as each other's replies.
+     *
+     * Cursor ids in getMores and killCursors are translated to the cursors the replayed queries
+     * opened.  Authentication in the recording isn't replayed successfully (the nonces differ),
+     * so the connections authenticate with the credentials given to mongoreplay instead.
+     *
+     * Writes are sent without waiting for a reply, so their latencies are only the time to send
+     * them; the getLastError commands that follow them in the recording time the writes.
+     */
+    class ReplayTool : public Tool {
+    public:
+        virtual void printHelp( ostream& out ) {
+            printMongoReplayHelp(&out);
+        }
+
+        int run() {
+            MemoryMappedFile f;
+            unsigned long long len = 0;
+            const char* p = static_cast<const char*>(
+                    f.map(mongoReplayGlobalParams.file.c_str(), len, MemoryMappedFile::SEQUENTIAL));
+            if ( !p ) {
+                toolError() << "couldn't open " << mongoReplayGlobalParams.file << endl;
+                return -1;
+            }
+            load(p, len);
+            if ( _ops.empty() ) {
+                toolError() << "nothing to replay in " << mongoReplayGlobalParams.file << endl;
+                return -1;
+            }
+
+            unsigned numThreads = _numConnections;
+            if ( mongoReplayGlobalParams.threads > 0 )
+                numThreads = std::min(numThreads, (unsigned) mongoReplayGlobalParams.threads);
+
+            toolInfoLog() << "replaying " << _ops.size() << " requests on " << _numConnections
+                          << " connections over " << numThreads << " threads" << endl;
+
+            vector< boost::shared_ptr<Worker> > workers;
+            for ( unsigned i = 0; i < numThreads; i++ ) {
+                workers.push_back( boost::shared_ptr<Worker>( new Worker() ) );
+            }
+            for ( vector<ReplayOp>::const_iterator i = _ops.begin(); i != _ops.end(); ++i ) {
+                workers[i->connection % numThreads]->ops.push_back(&*i);
+            }
+
+            const unsigned long long start = curTimeMicros64();
+            boost::thread_group threads;
+            for ( unsigned i = 0; i < numThreads; i++ ) {
+                threads.create_thread( boost::bind(&ReplayTool::replay, this, start,
+                                                   workers[i].get()) );
+            }
+            threads.join_all();
+            const unsigned long long elapsed = curTimeMicros64() - start;
+
+            report(workers, elapsed);
+            return 0;
+        }
+
+    private:
+        enum OpKind { Query, Command, GetMore, Insert, Update, Delete, KillCursors, NumOpKinds };
+
+        struct ReplayOp {
+            long long micros;
+            unsigned connection;
+            const MsgData* msg;
+        };
+
+        /** the connections given to one thread, and what it measured */
+        struct Worker {
+            Worker() : errors(0), maxLagMicros(0) { }
+            vector<const ReplayOp*> ops;
+            vector<unsigned> micros[NumOpKinds];
+            unsigned long long errors;
+            long long maxLagMicros;
+        };
+
+        typedef pair<unsigned, MSGID> RequestKey;  // connection, request id
+
+        vector<ReplayOp> _ops;
+        unsigned _numConnections;
+        long long _recordedMicros;
+
+        // the cursor each recorded query or getMore left open, from the recorded replies
+        map<RequestKey, long long> _recordedCursors;
+
+        void load( const char* p, unsigned long long len ) {
+            _numConnections = 0;
+            _recordedMicros = 0;
+            const char* end = p + len;
+            while ( p < end ) {
+                uassert(17390, "recording is truncated",
+                        end - p >= (long long) (sizeof(RecordedOpHeader) + sizeof(MsgData) - 4));
+                const RecordedOpHeader* h = reinterpret_cast<const RecordedOpHeader*>(p);
+                const MsgData* msg = reinterpret_cast<const MsgData*>(p + sizeof(*h));
+                uassert(17391, "invalid message in recording",
+                        const_cast<MsgData*>(msg)->valid() &&
+                        msg->len <= end - p - (long long) sizeof(*h));
+                p += sizeof(*h) + msg->len;
+
+                if ( msg->operation() == opReply ) {
+                    if ( msg->len >= kReplyRecordLen ) {
+                        const QueryResult* r = reinterpret_cast<const QueryResult*>(msg);
+                        if ( r->cursorId )
+                            _recordedCursors[RequestKey(h->connection, msg->responseTo)] =
+                                r->cursorId;
+                    }
+                    continue;
+                }
+
+                ReplayOp op;
+                op.micros = h->micros;
+                op.connection = h->connection;
+                op.msg = msg;
+                _ops.push_back(op);
+                _numConnections = std::max(_numConnections, h->connection + 1);
+                _recordedMicros = std::max(_recordedMicros, h->micros);
+            }
+        }
+
+        static OpKind kindOf( Message& m ) {
+            switch ( m.operation() ) {
+            case dbQuery: {
+                DbMessage d(m);
+                return str::endsWith(d.getns(), ".$cmd") ? Command : Query;
+            }
+            case dbGetMore: return GetMore;
+            case dbInsert: return Insert;
+            case dbUpdate: return Update;
+            case dbDelete: return Delete;
+            case dbKillCursors: return KillCursors;
+            default: return NumOpKinds;
+            }
+        }
+
+        static const char* kindName( int kind ) {
+            static const char* names[NumOpKinds] =
+                    { "query", "command", "getmore", "insert", "update", "delete", "killcursors" };
+            return names[kind];
+        }
+
+        void replay( unsigned long long start, Worker* w ) {
+            map< unsigned, boost::shared_ptr<DBClientBase> > conns;
+            map< unsigned, map<long long, long long> > cursors;  // recorded -> replayed ids
+            const double speed = mongoReplayGlobalParams.speed;
+
+            for ( vector<const ReplayOp*>::const_iterator i = w->ops.begin();
+                  i != w->ops.end(); ++i ) {
+                const ReplayOp& op = **i;
+
+                if ( speed > 0 ) {
+                    const long long due = start + (long long) (op.micros / speed);
+                    const long long now = curTimeMicros64();
+                    if ( due > now )
+                        sleepmicros(due - now);
+                    else
+                        w->maxLagMicros = std::max(w->maxLagMicros, now - due);
+                }
+
+                // copied, as ids get rewritten and sending sets the request id
+                Message m;
+                int capacity;
+                char* buf = BufferPool::allocate(op.msg->len, &capacity);
+                memcpy(buf, op.msg, op.msg->len);
+                m.setData(reinterpret_cast<MsgData*>(buf), true);
+
+                const OpKind kind = kindOf(m);
+                if ( kind == NumOpKinds )
+                    continue;
+
+                map<long long, long long>& cursorMap = cursors[op.connection];
+                long long recordedGetMoreCursor = 0;
+                if ( kind == GetMore ) {
+                    DbMessage d(m);
+                    d.pullInt();
+                    long long& id = d.pullInt64();
+                    recordedGetMoreCursor = id;
+                    map<long long, long long>::const_iterator c = cursorMap.find(id);
+                    if ( c != cursorMap.end() )
+                        id = c->second;
+                }
+                else if ( kind == KillCursors ) {
+                    int* x = reinterpret_cast<int*>(m.singleData()->_data);
+                    x++; // reserved
+                    const int n = *x++;
+                    long long* ids = reinterpret_cast<long long*>(x);
+                    for ( int j = 0; j < n; j++ ) {
+                        map<long long, long long>::iterator c = cursorMap.find(ids[j]);
+                        if ( c != cursorMap.end() ) {
+                            ids[j] = c->second;
+                            cursorMap.erase(c);
+                        }
+                    }
+                }
+
+                try {
+                    boost::shared_ptr<DBClientBase>& conn = conns[op.connection];
+                    if ( !conn )
+                        conn.reset(newConnection());
+
+                    Timer t;
+                    if ( kind == Query || kind == Command || kind == GetMore ) {
+                        Message response;
+                        if ( !conn->call(m, response, false) ) {
+                            w->errors++;
+                            conn.reset();
+                            continue;
+                        }
+                        w->micros[kind].push_back(t.micros());
+
+                        const QueryResult* r =
+                                reinterpret_cast<const QueryResult*>(response.singleData());
+                        map<RequestKey, long long>::const_iterator recorded =
+                                _recordedCursors.find(RequestKey(op.connection, op.msg->id));
+                        if ( recorded != _recordedCursors.end() && r->cursorId )
+                            cursorMap[recorded->second] = r->cursorId;
+                        if ( kind == GetMore && !r->cursorId )
+                            cursorMap.erase(recordedGetMoreCursor);
+                    }
+                    else {
+                        conn->say(m);
+                        w->micros[kind].push_back(t.micros());
+                    }
+                }
+                catch ( const DBException& e ) {
+                    LOG(1) << "replaying request failed: " << e.toString() << endl;
+                    w->errors++;
+                    conns.erase(op.connection);
+                }
+            }
+        }
+
+        static double percentile( const vector<unsigned>& sorted, double p ) {
+            size_t i = std::min(sorted.size() - 1, (size_t) (p * sorted.size()));
+            return sorted[i] / 1000.0;
+        }
+
+        void report( const vector< boost::shared_ptr<Worker> >& workers,
+                     unsigned long long elapsed ) {
+            unsigned long long errors = 0;
+            long long maxLag = 0;
+            vector<unsigned> all[NumOpKinds];
+            for ( unsigned i = 0; i < workers.size(); i++ ) {
+                errors += workers[i]->errors;
+                maxLag = std::max(maxLag, workers[i]->maxLagMicros);
+                for ( int k = 0; k < NumOpKinds; k++ ) {
+                    all[k].insert(all[k].end(), workers[i]->micros[k].begin(),
+                                  workers[i]->micros[k].end());
+                }
+            }
+
+            cout << "recorded " << _recordedMicros / 1000 << "ms, replayed in " << elapsed / 1000
+                 << "ms, " << (unsigned long long) (_ops.size() * 1000000.0 / (elapsed ? elapsed : 1))
+                 << " requests/s, " << errors << " errors, max lag behind schedule "
+                 << maxLag / 1000 << "ms" << endl;
+            cout << "latency in ms" << endl;
+            cout << setw(12) << left << "op" << right << setw(10) << "count" << setw(10) << "mean"
+                 << setw(10) << "50%" << setw(10) << "90%" << setw(10) << "99%"
+                 << setw(10) << "99.9%" << setw(10) << "max" << endl;
+
+            for ( int k = 0; k < NumOpKinds; k++ ) {
+                vector<unsigned>& v = all[k];
+                if ( v.empty() )
+                    continue;
+                std::sort(v.begin(), v.end());
+                unsigned long long sum = 0;
+                for ( unsigned i = 0; i < v.size(); i++ )
+                    sum += v[i];
+
+                cout << setw(12) << left << kindName(k) << right << setw(10) << v.size()
+                     << fixed << setprecision(2)
+                     << setw(10) << sum / 1000.0 / v.size()
+                     << setw(10) << percentile(v, 0.5)
+                     << setw(10) << percentile(v, 0.9)
+                     << setw(10) << percentile(v, 0.99)
+                     << setw(10) << percentile(v, 0.999)
+                     << setw(10) << v.back() / 1000.0 << endl;
+            }
+        }
+    };
+
+    REGISTER_MONGO_TOOL(ReplayTool);
+
+}
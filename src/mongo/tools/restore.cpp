@@ -32,6 +32,7 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
 #include <fcntl.h>
 #include <fstream>
 #include <set>
@@ -39,9 +40,11 @@
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/json.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/wire_version.h"
 #include "mongo/tools/mongorestore_options.h"
 #include "mongo/tools/tool.h"
 #include "mongo/util/mmap.h"
+#include "mongo/util/queue.h"
 #include "mongo/util/options_parser/option_section.h"
 #include "mongo/util/stringutils.h"
 
@@ -54,6 +57,126 @@ namespace {
 class Restore : public BSONTool {
 public:
 
+    /** A collection file whose documents are inserted once drillDown() has seen all files. */
+    struct RestoreJob {
+        string ns;
+        boost::filesystem::path file;
+        vector<BSONObj> indexes; // specs already pointing at 'ns'
+    };
+
+    /**
+     * Inserts the documents of one collection in batches, through the insert command where the
+     * server has it.  With --numInsertionWorkersPerCollection above 1 the batches are handed
+     * to threads with connections of their own while the file is still being read.
+     */
+    class CollectionInserter : boost::noncopyable {
+    public:
+        static const size_t kMaxBatchDocs = 1000;
+        static const int kMaxBatchBytes = 8 * 1024 * 1024;
+
+        CollectionInserter(Restore* tool, DBClientBase* conn, const string& ns, int numWorkers)
+            : _tool(tool), _conn(conn), _ns(ns), _batchBytes(0), _queue(numWorkers * 2 + 1),
+              _errorMutex("CollectionInserter"), _finished(false) {
+            for (int i = 0; numWorkers > 1 && i < numWorkers; i++) {
+                _workers.create_thread(boost::bind(&CollectionInserter::_worker, this));
+            }
+        }
+
+        ~CollectionInserter() {
+            _stopWorkers();
+        }
+
+        void insert(const BSONObj& obj) {
+            if (!_batch.empty() && (_batch.size() == kMaxBatchDocs ||
+                                    _batchBytes + obj.objsize() > kMaxBatchBytes)) {
+                _flush();
+            }
+            // processFile() reuses its buffer
+            _batch.push_back(obj.getOwned());
+            _batchBytes += obj.objsize();
+        }
+
+        /** inserts what is left and waits for the workers, throws the first error they had */
+        void finish() {
+            _flush();
+            _stopWorkers();
+
+            scoped_lock lk(_errorMutex);
+            uassert(17377, "inserting into " + _ns + " failed: " + _error, _error.empty());
+        }
+
+    private:
+        typedef boost::shared_ptr<vector<BSONObj> > Batch;
+
+        void _flush() {
+            if (_batch.empty())
+                return;
+
+            if (_workers.size() == 0) {
+                _tool->insertBatch(*_conn, _ns, _batch);
+            }
+            else {
+                Batch batch(new vector<BSONObj>());
+                batch->swap(_batch);
+                _queue.push(batch);
+            }
+            _batch.clear();
+            _batchBytes = 0;
+        }
+
+        void _stopWorkers() {
+            if (_finished)
+                return;
+            _finished = true;
+
+            // an empty batch tells a worker to stop
+            for (size_t i = 0; i < _workers.size(); i++) {
+                _queue.push(Batch());
+            }
+            _workers.join_all();
+        }
+
+        void _worker() {
+            scoped_ptr<DBClientBase> conn;
+            try {
+                conn.reset(_tool->newConnection());
+            }
+            catch (const DBException& e) {
+                _fail(e.toString());
+            }
+
+            // keep taking batches after an error, the reader may be waiting on a full queue
+            for (Batch batch = _queue.blockingPop(); batch; batch = _queue.blockingPop()) {
+                if (!conn)
+                    continue;
+                try {
+                    _tool->insertBatch(*conn, _ns, *batch);
+                }
+                catch (const DBException& e) {
+                    _fail(e.toString());
+                    conn.reset();
+                }
+            }
+        }
+
+        void _fail(const string& error) {
+            scoped_lock lk(_errorMutex);
+            if (_error.empty())
+                _error = error;
+        }
+
+        Restore* const _tool;
+        DBClientBase* const _conn;
+        const string _ns;
+        vector<BSONObj> _batch;
+        int _batchBytes;
+        BlockingQueue<Batch> _queue;
+        boost::thread_group _workers;
+        mongo::mutex _errorMutex;
+        string _error;
+        bool _finished;
+    };
+
     string _curns;
     string _curdb;
     string _curcoll;
@@ -62,7 +185,12 @@ public:
     scoped_ptr<OpTime> _oplogLimitTS; // for oplog replay (limit)
     int _oplogEntrySkips; // oplog entries skipped
     int _oplogEntryApplies; // oplog entries applied
-    Restore() : BSONTool() { }
+    bool _useWriteCommands;
+    vector<RestoreJob> _jobs; // collections drillDown() found, loaded by runRestoreJobs()
+    mongo::mutex _jobsMutex; // guards the two below when restoring in parallel
+    size_t _nextJob;
+    string _jobsError;
+    Restore() : BSONTool(), _useWriteCommands(false), _jobsMutex("Restore jobs"), _nextJob(0) { }
 
     virtual void printHelp(ostream& out) {
         printMongoRestoreHelp(&out);
@@ -82,6 +210,12 @@ public:
             return -1;
         }
 
+        if (!toolGlobalParams.useDirectClient) {
+            BSONObj isMaster;
+            conn().simpleCommand("admin", &isMaster, "ismaster");
+            _useWriteCommands = isMaster["maxWireVersion"].numberInt() >= BATCH_COMMANDS;
+        }
+
         if (mongoRestoreGlobalParams.oplogReplay) {
             // fail early if errors
 
@@ -181,6 +315,7 @@ public:
          */
         drillDown(root, toolGlobalParams.db != "", toolGlobalParams.coll != "",
                   !(_oplogLimitTS.get() == NULL), true);
+        runRestoreJobs();
 
         // should this happen for oplog replay as well?
         string err = conn().getLastError(toolGlobalParams.db == "" ? "admin" : toolGlobalParams.db);
@@ -262,6 +397,8 @@ public:
             }
 
             if (!indexes.empty() && !json_metadata) {
+                // the collections have to be there before their indexes are
+                runRestoreJobs();
                 drillDown(indexes, use_db, use_coll, oplogReplayLimit);
             }
 
@@ -274,6 +411,7 @@ public:
         }
 
         if ( ! ( endsWith( root.string().c_str() , ".bson" ) ||
+                 endsWith( root.string().c_str() , ".bson.snappy" ) ||
                  endsWith( root.string().c_str() , ".bin" ) ) ) {
             toolError() << "don't know what to do with file [" << root.string() << "]" << std::endl;
             return;
@@ -299,6 +437,10 @@ public:
         verify( ns.size() );
 
         string oldCollName = root.leaf().string(); // Name of the collection that was dumped from
+        if ( endsWith( oldCollName.c_str() , ".snappy" ) ) {
+            // written by mongodump --compress
+            oldCollName = oldCollName.substr( 0 , oldCollName.size() - strlen( ".snappy" ) );
+        }
         oldCollName = oldCollName.substr( 0 , oldCollName.find_last_of( "." ) );
         if (use_coll) {
             ns += "." + toolGlobalParams.coll;
@@ -366,6 +508,21 @@ public:
             createCollectionWithOptions(metadataObject["options"].Obj());
         }
 
+        if (root.leaf() != "system.indexes.bson" && root.leaf() != "system.users.bson") {
+            // loaded with the others by runRestoreJobs()
+            RestoreJob job;
+            job.ns = _curns;
+            job.file = root;
+            if (mongoRestoreGlobalParams.restoreIndexes && metadataObject.hasField("indexes")) {
+                vector<BSONElement> indexes = metadataObject["indexes"].Array();
+                for (size_t i = 0; i < indexes.size(); i++) {
+                    job.indexes.push_back(renameIndexSpec(indexes[i].Obj(), false));
+                }
+            }
+            _jobs.push_back(job);
+            return;
+        }
+
         processFile( root );
         if (mongoRestoreGlobalParams.drop && root.leaf() == "system.users.bson") {
             // Delete any users that used to exist but weren't in the dump file
@@ -436,8 +593,122 @@ public:
         }
     }
 
+    void insertBatch(DBClientBase& c, const string& ns, const vector<BSONObj>& docs) {
+        const string db = nsToDatabase(ns);
+
+        if (!_useWriteCommands) {
+            c.insert(ns, docs, InsertOption_ContinueOnError);
+
+            // wait for insert to propagate to "w" nodes (doesn't warn if w used without replset)
+            if (mongoRestoreGlobalParams.w > 0) {
+                string err = c.getLastError(db, false, false, mongoRestoreGlobalParams.w);
+                if (!err.empty()) {
+                    toolError() << err << std::endl;
+                }
+            }
+            return;
+        }
+
+        BSONObjBuilder cmd;
+        cmd.append("insert", nsToCollectionSubstring(ns));
+        cmd.append("documents", docs);
+        cmd.append("ordered", false);
+        if (mongoRestoreGlobalParams.w > 0) {
+            cmd.append("writeConcern", BSON("w" << mongoRestoreGlobalParams.w));
+        }
+
+        BSONObj res;
+        if (!c.runCommand(db, cmd.done(), res)) {
+            toolError() << "error inserting into " << ns << ": " << res["errmsg"].str()
+                        << std::endl;
+            return;
+        }
+
+        // like the inserts above, only report failed documents when waiting for replication
+        if (mongoRestoreGlobalParams.w > 0) {
+            if (res["writeErrors"].type() == Array) {
+                vector<BSONElement> errors = res["writeErrors"].Array();
+                toolError() << errors.size() << " documents not inserted into " << ns
+                            << ", first error: " << errors[0]["errmsg"].str() << std::endl;
+            }
+            if (res["writeConcernError"].isABSONObj()) {
+                toolError() << res["writeConcernError"]["errmsg"].str() << std::endl;
+            }
+        }
+    }
+
 private:
 
+    /**
+     * Inserts the collections queued by drillDown(), --numParallelCollections at a time, and
+     * builds the indexes of each right after its documents.
+     */
+    void runRestoreJobs() {
+        size_t numThreads = std::min(_jobs.size(),
+                                     size_t(mongoRestoreGlobalParams.numParallelCollections));
+        if (toolGlobalParams.useDirectClient || numThreads <= 1) {
+            for (size_t i = 0; i < _jobs.size(); i++) {
+                restoreCollection(conn(), _jobs[i]);
+            }
+        }
+        else {
+            _nextJob = 0;
+            _jobsError.clear();
+
+            boost::thread_group threads;
+            for (size_t i = 0; i < numThreads; i++) {
+                threads.create_thread(boost::bind(&Restore::restoreWorker, this));
+            }
+            threads.join_all();
+            uassert(17378, "parallel restore failed: " + _jobsError, _jobsError.empty());
+        }
+        _jobs.clear();
+    }
+
+    void restoreWorker() {
+        try {
+            scoped_ptr<DBClientBase> c(newConnection());
+            while (RestoreJob* job = nextJob()) {
+                restoreCollection(*c, *job);
+            }
+        }
+        catch (const DBException& e) {
+            failJobs(e.toString());
+        }
+        catch (const std::exception& e) {
+            failJobs(e.what());
+        }
+    }
+
+    void failJobs(const string& error) {
+        scoped_lock lk(_jobsMutex);
+        if (_jobsError.empty())
+            _jobsError = error;
+    }
+
+    /** @return NULL once all jobs are taken or one of them failed */
+    RestoreJob* nextJob() {
+        scoped_lock lk(_jobsMutex);
+        if (_nextJob == _jobs.size() || !_jobsError.empty())
+            return NULL;
+        return &_jobs[_nextJob++];
+    }
+
+    void restoreCollection(DBClientBase& c, const RestoreJob& job) {
+        toolInfoLog() << "	inserting into " << job.ns << " from " << job.file.string()
+                      << std::endl;
+
+        const int numWorkers = toolGlobalParams.useDirectClient ?
+                1 : mongoRestoreGlobalParams.numInsertionWorkers;
+        CollectionInserter inserter(this, &c, job.ns, numWorkers);
+        processFile(job.file, boost::bind(&CollectionInserter::insert, &inserter, _1));
+        inserter.finish();
+
+        if (!job.indexes.empty()) {
+            createIndexes(c, nsToDatabase(job.ns), job.indexes);
+        }
+    }
+
     BSONObj parseMetadataFile(string filePath) {
         long long fileSize = boost::filesystem::file_size(filePath);
         ifstream file(filePath.c_str(), ios_base::in);
@@ -528,7 +799,7 @@ private:
     /* We must handle if the dbname or collection name is different at restore time than what was dumped.
        If keepCollName is true, however, we keep the same collection name that's in the index object.
      */
-    void createIndex(BSONObj indexObj, bool keepCollName) {
+    BSONObj renameIndexSpec(BSONObj indexObj, bool keepCollName) {
         BSONObjBuilder bo;
         BSONObjIterator i(indexObj);
         while ( i.more() ) {
@@ -543,14 +814,27 @@ private:
                 bo.append(e);
             }
         }
-        BSONObj o = bo.obj();
+        return bo.obj();
+    }
+
+    void createIndex(BSONObj indexObj, bool keepCollName) {
+        createIndexes(conn(), _curdb, vector<BSONObj>(1, renameIndexSpec(indexObj, keepCollName)));
+    }
+
+    /**
+     * Inserts the specs in one message, so the server builds the ones for the same collection
+     * with a single scan of it.
+     */
+    void createIndexes(DBClientBase& c, const string& db, const vector<BSONObj>& specs) {
         if (logger::globalLogDomain()->shouldLog(logger::LogSeverity::Debug(0))) {
-            toolInfoLog() << "\tCreating index: " << o << std::endl;
+            for (size_t i = 0; i < specs.size(); i++) {
+                toolInfoLog() << "\tCreating index: " << specs[i] << std::endl;
+            }
         }
-        conn().insert( _curdb + ".system.indexes" ,  o );
+        c.insert( db + ".system.indexes" ,  specs );
 
         // We're stricter about errors for indexes than for regular data
-        BSONObj err = conn().getLastErrorDetailed(_curdb, false, false, mongoRestoreGlobalParams.w);
+        BSONObj err = c.getLastErrorDetailed(db, false, false, mongoRestoreGlobalParams.w);
 
         if (err.hasField("err") && !err["err"].isNull()) {
             if (err["err"].str() == "norepl" && mongoRestoreGlobalParams.w > 1) {
@@ -563,7 +847,7 @@ private:
                     errCode = str::stream() << err["code"].numberInt();
                 }
 
-                toolError() << "Error creating index " << o["ns"].String() << ": "
+                toolError() << "Error creating index " << specs[0]["ns"].String() << ": "
                           << errCode << " " << err["err"] << std::endl;
             }
 
@@ -65,6 +65,7 @@
 #include "mongo/bson/util/builder.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/dbmessage.h"
+#include "mongo/tools/recorded_op.h"
 #include "mongo/util/net/message.h"
 #include "mongo/util/mmap.h"
 #include "mongo/util/text.h"
@@ -78,6 +79,7 @@ using mongo::BufBuilder;
 using mongo::DBClientConnection;
 using mongo::QueryResult;
 using mongo::MemoryMappedFile;
+using mongo::RecordedOpHeader;
 
 #define SNAP_LEN 65535
 
@@ -168,8 +170,46 @@ map< Connection, boost::shared_ptr<DBClientConnection> > forwarder;
 map< Connection, long long > lastCursor;
 map< Connection, map< long long, long long > > mapCursor;
 
+FILE *recordFile = 0;
+map< Connection, unsigned > recordedConnection; // keyed by the client to server direction
+long long firstRecordedMicros = -1;
+
 void processMessage( Connection& c , Message& d );
 
+/** writes 'm' to the --record file.  'toServer' is false for replies. */
+void recordMessage( const Connection& c , bool toServer , long long micros , Message& m ) {
+    Connection client = toServer ? c : c.reverse();
+    map< Connection, unsigned >::iterator i = recordedConnection.find( client );
+    if ( i == recordedConnection.end() ) {
+        // a reply on a connection we haven't seen a request on has nothing to match
+        if ( !toServer )
+            return;
+        unsigned n = recordedConnection.size();
+        i = recordedConnection.insert( make_pair( client, n ) ).first;
+    }
+
+    if ( firstRecordedMicros < 0 )
+        firstRecordedMicros = micros;
+
+    RecordedOpHeader h;
+    h.micros = micros - firstRecordedMicros;
+    h.connection = i->second;
+
+    MsgData *d = m.singleData();
+    int len = d->len;
+    if ( !toServer ) {
+        if ( len < mongo::kReplyRecordLen )
+            return;
+        len = mongo::kReplyRecordLen;
+    }
+
+    fwrite( &h, sizeof( h ), 1, recordFile );
+    fwrite( &len, sizeof( len ), 1, recordFile );
+    fwrite( (const char *) d + sizeof( len ), len - sizeof( len ), 1, recordFile );
+    // mongosniff runs until it is killed, so don't leave anything in the buffer
+    fflush( recordFile );
+}
+
 void got_packet(u_char *args, const struct pcap_pkthdr *header, const u_char *packet) {
 
     const struct sniff_ip* ip = (struct sniff_ip*)(packet + captureHeaderSize);
@@ -263,6 +303,11 @@ void got_packet(u_char *args, const struct pcap_pkthdr *header, const u_char *pa
           << "  " << m.header()->len << " bytes "
           << " id:" << hex << m.header()->id << dec << "\t" << m.header()->id;
 
+    if ( recordFile ) {
+        recordMessage( c , serverPorts.count( ntohs( tcp->th_dport ) ) ,
+                       header->ts.tv_sec * 1000000LL + header->ts.tv_usec , m );
+    }
+
     processMessage( c , m );
 }
 
@@ -423,6 +468,10 @@ void processDiagLog( const char * file ) {
         DbMessage d(m);
         cout << len << " " << d.getns() << endl;
 
+        // a diaglog has no timing, so a recording of one replays as fast as it can
+        if ( recordFile && m.operation() != mongo::opReply )
+            recordMessage( c , true , 0 , m );
+
         processMessage( c , m );
 
         read += len;
@@ -434,9 +483,11 @@ void processDiagLog( const char * file ) {
 
 void usage() {
     cout <<
-         "Usage: mongosniff [--help] [--forward host:port] [--source (NET <interface> | (FILE | DIAGLOG) <filename>)] [<port0> <port1> ... ]\n"
+         "Usage: mongosniff [--help] [--forward host:port] [--record <filename>] [--source (NET <interface> | (FILE | DIAGLOG) <filename>)] [<port0> <port1> ... ]\n"
          "--forward       Forward all parsed request messages to mongod instance at \n"
          "                specified host:port\n"
+         "--record        Write the requests seen, with their timing, to a file that\n"
+         "                mongoreplay can play back against another server.\n"
          "--source        Source of traffic to sniff, either a network interface or a\n"
          "                file containing previously captured packets in pcap format,\n"
          "                or a file containing output from mongod's --diaglog option.\n"
@@ -475,6 +526,7 @@ int toolMain(int argc, char **argv, char** envp) {
     bool replay = false;
     bool diaglog = false;
     const char *file = 0;
+    const char *recordTo = 0;
 
     vector< const char * > args;
     for( int i = 1; i < argc; ++i )
@@ -490,6 +542,10 @@ int toolMain(int argc, char **argv, char** envp) {
             else if ( arg == string( "--forward" ) ) {
                 forwardAddress = args[ ++i ];
             }
+            else if ( arg == string( "--record" ) ) {
+                uassert( 17389 ,  "--record needs a filename" , args.size() > i + 1 );
+                recordTo = args[ ++i ];
+            }
             else if ( arg == string( "--source" ) ) {
                 uassert( 10266 ,  "can't use --source twice" , source == false );
                 uassert( 10267 ,  "source needs more args" , args.size() > i + 2);
@@ -518,6 +574,14 @@ int toolMain(int argc, char **argv, char** envp) {
     if ( !serverPorts.size() )
         serverPorts.insert( 27017 );
 
+    if ( recordTo ) {
+        recordFile = fopen( recordTo , "wb" );
+        if ( !recordFile ) {
+            cerr << "error opening record file " << recordTo << ": " << strerror( errno ) << endl;
+            return -1;
+        }
+    }
+
     if ( diaglog ) {
         processDiagLog( file );
         return 0;
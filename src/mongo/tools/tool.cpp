@@ -43,7 +43,9 @@
 #include "mongo/db/json.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/storage_options.h"
+#include "mongo/db/wire_version.h"
 #include "mongo/platform/posix_fadvise.h"
+#include "mongo/util/compress.h"
 #include "mongo/util/file_allocator.h"
 #include "mongo/util/options_parser/option_section.h"
 #include "mongo/util/password.h"
@@ -190,6 +192,28 @@ namespace mongo {
         return *_conn;
     }
 
+    DBClientBase* Tool::newConnection() {
+        string errmsg;
+        ConnectionString cs = ConnectionString::parse(toolGlobalParams.connectionString, errmsg);
+        uassert(17371, str::stream() << "invalid hostname [" << toolGlobalParams.connectionString
+                                     << "] " << errmsg,
+                cs.isValid());
+
+        auto_ptr<DBClientBase> c(cs.connect(errmsg));
+        uassert(17372, str::stream() << "couldn't connect to ["
+                                     << toolGlobalParams.connectionString << "] " << errmsg,
+                c.get());
+
+        if (!toolGlobalParams.username.empty()) {
+            c->auth(BSON(saslCommandUserDBFieldName << getAuthenticationDatabase() <<
+                         saslCommandUserFieldName << toolGlobalParams.username <<
+                         saslCommandPasswordFieldName << toolGlobalParams.password  <<
+                         saslCommandMechanismFieldName <<
+                         toolGlobalParams.authenticationMechanism));
+        }
+        return c.release();
+    }
+
     bool Tool::isMaster() {
         if (toolGlobalParams.useDirectClient) {
             return true;
@@ -210,12 +234,21 @@ namespace mongo {
     }
 
     bool Tool::isMongos() {
-        // TODO: when mongos supports QueryOption_Exaust add a version check (SERVER-2628)
         BSONObj isdbgrid;
         conn("true").simpleCommand("admin", &isdbgrid, "isdbgrid");
         return isdbgrid["isdbgrid"].trueValue();
     }
 
+    bool Tool::supportsExhaust() {
+        if (!isMongos())
+            return true;
+
+        // older mongoses pass the flag on to the shards and mangle the results (SERVER-2628)
+        BSONObj isMaster;
+        conn(true).simpleCommand("admin", &isMaster, "ismaster");
+        return isMaster["maxWireVersion"].numberInt() >= MONGOS_EXHAUST_QUERIES;
+    }
+
     std::string Tool::getAuthenticationDatabase() {
         if (!toolGlobalParams.authenticationDatabase.empty()) {
             return toolGlobalParams.authenticationDatabase;
@@ -262,7 +295,39 @@ namespace mongo {
         return doRun();
     }
 
+    bool BSONTool::_processObject( const BSONObj& o,
+                                   const boost::function<void (const BSONObj&)>& handler ) {
+        if (bsonToolGlobalParams.objcheck && !o.valid()) {
+            toolError() << "INVALID OBJECT - going to try and print out " << std::endl;
+            toolError() << "size: " << o.objsize() << std::endl;
+            BSONObjIterator i(o);
+            while ( i.more() ) {
+                BSONElement e = i.next();
+                try {
+                    e.validate();
+                }
+                catch ( ... ) {
+                    toolError() << "\t\t NEXT ONE IS INVALID" << std::endl;
+                }
+                toolError() << "\t name : " << e.fieldName() << " " << typeName(e.type())
+                            << std::endl;
+                toolError() << "\t " << e << std::endl;
+            }
+        }
+
+        if (!bsonToolGlobalParams.hasFilter || _matcher->matches(o)) {
+            handler( o );
+            return true;
+        }
+        return false;
+    }
+
     long long BSONTool::processFile( const boost::filesystem::path& root ) {
+        return processFile( root, boost::bind( &BSONTool::gotObject, this, _1 ) );
+    }
+
+    long long BSONTool::processFile( const boost::filesystem::path& root,
+                                     const boost::function<void (const BSONObj&)>& handler ) {
         std::string fileName = root.string();
 
         unsigned long long fileLength = file_size( root );
@@ -301,6 +366,43 @@ namespace mongo {
             m.setUnits( "bytes" );
         }
 
+        if (endsWith(fileName.c_str(), ".snappy")) {
+            // mongodump --compress writes blocks of whole documents, each one stored as
+            // <int32 compressed size><snappy compressed data>
+            string compressed;
+            string block;
+            while ( read < fileLength ) {
+                int size;
+                size_t amt = fread(&size, 1, 4, file);
+                verify( amt == 4 );
+                uassert(17373, str::stream() << "invalid compressed block size: " << size,
+                        size > 0 && read + 4 + size <= fileLength);
+
+                compressed.resize(size);
+                amt = fread(&compressed[0], 1, size, file);
+                verify( amt == (size_t)size );
+                uassert(17374, "couldn't uncompress block",
+                        uncompress(compressed.data(), size, &block));
+
+                size_t pos = 0;
+                while ( pos < block.size() ) {
+                    int objSize = ((const int*)(block.data() + pos))[0];
+                    uassert(17375, str::stream() << "invalid object size: " << objSize,
+                            objSize >= 5 && pos + objSize <= block.size());
+
+                    if ( _processObject( BSONObj( block.data() + pos ), handler ) )
+                        processed++;
+                    pos += objSize;
+                    num++;
+                }
+
+                read += 4 + size;
+                if (!toolGlobalParams.quiet) {
+                    m.hit(4 + size);
+                }
+            }
+        }
+
         while ( read < fileLength ) {
             size_t amt = fread(buf, 1, 4, file);
             verify( amt == 4 );
@@ -312,28 +414,8 @@ namespace mongo {
             verify( amt == (size_t)( size - 4 ) );
 
             BSONObj o( buf );
-            if (bsonToolGlobalParams.objcheck && !o.valid()) {
-                toolError() << "INVALID OBJECT - going to try and print out " << std::endl;
-                toolError() << "size: " << size << std::endl;
-                BSONObjIterator i(o);
-                while ( i.more() ) {
-                    BSONElement e = i.next();
-                    try {
-                        e.validate();
-                    }
-                    catch ( ... ) {
-                        toolError() << "\t\t NEXT ONE IS INVALID" << std::endl;
-                    }
-                    toolError() << "\t name : " << e.fieldName() << " " << typeName(e.type())
-                                << std::endl;
-                    toolError() << "\t " << e << std::endl;
-                }
-            }
-
-            if (!bsonToolGlobalParams.hasFilter || _matcher->matches(o)) {
-                gotObject( o );
+            if ( _processObject( o, handler ) )
                 processed++;
-            }
 
             read += o.objsize();
             num++;
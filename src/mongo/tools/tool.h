@@ -30,6 +30,7 @@
 
 #pragma once
 
+#include <boost/function.hpp>
 #include <string>
 
 #if defined(_WIN32)
@@ -68,6 +69,9 @@ namespace mongo {
         bool isMaster();
         bool isMongos();
 
+        /** whether the server streams the results of QueryOption_Exhaust queries */
+        bool supportsExhaust();
+
         virtual int run() = 0;
 
         virtual void printHelp(ostream &out) = 0;
@@ -76,6 +80,12 @@ namespace mongo {
 
         mongo::DBClientBase &conn( bool slaveIfPaired = false );
 
+        /**
+         * Opens and authenticates another connection to the server given on the command line,
+         * for tools that read over several connections at once.  The caller owns the result.
+         */
+        mongo::DBClientBase* newConnection();
+
         bool _autoreconnect;
 
     protected:
@@ -100,6 +110,14 @@ namespace mongo {
 
         long long processFile( const boost::filesystem::path& file );
 
+        /** like processFile(), but hands the objects to 'handler' rather than to gotObject() */
+        long long processFile( const boost::filesystem::path& file,
+                               const boost::function<void (const BSONObj&)>& handler );
+
+    private:
+        /** checks and filters one object from a file, returns whether it was passed on */
+        bool _processObject( const BSONObj& o,
+                             const boost::function<void (const BSONObj&)>& handler );
     };
 
 }
@@ -25,43 +25,54 @@ namespace mongo {
 
         Alphabet alphabet;
 
-        void encode( stringstream& ss , const char * data , int size ) {
-            for ( int i=0; i<size; i+=3 ) {
-                int left = size - i;
-                const unsigned char * start = (const unsigned char*)data + i;
-
-                // byte 0
-                ss << alphabet.e(start[0]>>2);
-
-                // byte 1
-                unsigned char temp = ( start[0] << 4 );
-                if ( left == 1 ) {
+        namespace {
+            template <typename Stream>
+            void encodeTo( Stream& ss , const char * data , int size ) {
+                for ( int i=0; i<size; i+=3 ) {
+                    int left = size - i;
+                    const unsigned char * start = (const unsigned char*)data + i;
+
+                    // byte 0
+                    ss << alphabet.e(start[0]>>2);
+
+                    // byte 1
+                    unsigned char temp = ( start[0] << 4 );
+                    if ( left == 1 ) {
+                        ss << alphabet.e(temp);
+                        break;
+                    }
+                    temp |= ( ( start[1] >> 4 ) & 0xF );
                     ss << alphabet.e(temp);
-                    break;
-                }
-                temp |= ( ( start[1] >> 4 ) & 0xF );
-                ss << alphabet.e(temp);
 
-                // byte 2
-                temp = ( start[1] & 0xF ) << 2;
-                if ( left == 2 ) {
+                    // byte 2
+                    temp = ( start[1] & 0xF ) << 2;
+                    if ( left == 2 ) {
+                        ss << alphabet.e(temp);
+                        break;
+                    }
+                    temp |= ( ( start[2] >> 6 ) & 0x3 );
                     ss << alphabet.e(temp);
-                    break;
+
+                    // byte 3
+                    ss << alphabet.e(start[2] & 0x3f);
                 }
-                temp |= ( ( start[2] >> 6 ) & 0x3 );
-                ss << alphabet.e(temp);
 
-                // byte 3
-                ss << alphabet.e(start[2] & 0x3f);
+                int mod = size % 3;
+                if ( mod == 1 ) {
+                    ss << "==";
+                }
+                else if ( mod == 2 ) {
+                    ss << "=";
+                }
             }
+        } // namespace
 
-            int mod = size % 3;
-            if ( mod == 1 ) {
-                ss << "==";
-            }
-            else if ( mod == 2 ) {
-                ss << "=";
-            }
+        void encode( stringstream& ss , const char * data , int size ) {
+            encodeTo( ss , data , size );
+        }
+
+        void encode( StringBuilder& sb , const char * data , int size ) {
+            encodeTo( sb , data , size );
         }
 
 
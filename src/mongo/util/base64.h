@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include "mongo/bson/util/builder.h"
+
 namespace mongo {
     namespace base64 {
 
@@ -56,6 +58,7 @@ namespace mongo {
 
 
         void encode( stringstream& ss , const char * data , int size );
+        void encode( StringBuilder& sb , const char * data , int size );
         string encode( const char * data , int size );
         string encode( const string& s );
 
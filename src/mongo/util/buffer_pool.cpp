@@ -0,0 +1,206 @@
+// buffer_pool.cpp
+
+/*
+ *    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/buffer_pool.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <cstdlib>
+#include <vector>
+
+#include "mongo/util/assert_util.h"
+#include "mongo/util/memory_usage.h"
+#include "mongo/util/numa.h"
+
+namespace mongo {
+
+    Counter64 BufferPool::hits;
+    Counter64 BufferPool::misses;
+
+    namespace {
+
+        // kMinBufferSize << (kNumClasses - 1) == kMaxBufferSize
+        const int kNumClasses = 9;
+
+        inline int classSize( int c ) {
+            return BufferPool::kMinBufferSize << c;
+        }
+
+        /**
+         * Buffers left behind by exited threads that were placed on a NUMA node, so that the
+         * next thread on that node reuses memory that is local to it.
+         */
+        class NodeArena {
+        public:
+            NodeArena() : _bytes( 0 ) {}
+
+            char* pop( int c ) {
+                boost::mutex::scoped_lock lk( _mutex );
+                if ( _bufs[c].empty() )
+                    return 0;
+                char* buf = _bufs[c].back();
+                _bufs[c].pop_back();
+                _bytes -= classSize( c );
+                MemoryUsage::note( MemoryUsage::kConnectionBuffers, -1, -classSize( c ) );
+                return buf;
+            }
+
+            bool push( int c, char* buf ) {
+                boost::mutex::scoped_lock lk( _mutex );
+                if ( _bytes + classSize( c ) > BufferPool::kMaxNodeArenaBytes )
+                    return false;
+                _bufs[c].push_back( buf );
+                _bytes += classSize( c );
+                MemoryUsage::note( MemoryUsage::kConnectionBuffers, 1, classSize( c ) );
+                return true;
+            }
+
+        private:
+            boost::mutex _mutex;
+            std::vector<char*> _bufs[kNumClasses];
+            long long _bytes;
+        };
+
+        NodeArena nodeArenas[numa::kMaxNodes];
+
+        // the arena of the node this thread was placed on, or NULL
+        NodeArena* threadArena() {
+            const int node = numa::threadNode();
+            return node >= 0 ? &nodeArenas[node] : 0;
+        }
+
+        class ThreadCache {
+        public:
+            ThreadCache() : _bytes( 0 ) {
+                for ( int i = 0; i < kNumClasses; i++ )
+                    _counts[i] = 0;
+            }
+
+            ~ThreadCache() {
+                NodeArena* arena = threadArena();
+                for ( int i = 0; i < kNumClasses; i++ ) {
+                    for ( int j = 0; j < _counts[i]; j++ ) {
+                        MemoryUsage::note( MemoryUsage::kConnectionBuffers, -1, -classSize( i ) );
+                        if ( !arena || !arena->push( i, _bufs[i][j] ) )
+                            free( _bufs[i][j] );
+                    }
+                }
+            }
+
+            char* pop( int c ) {
+                if ( _counts[c] == 0 )
+                    return 0;
+                _bytes -= classSize( c );
+                MemoryUsage::note( MemoryUsage::kConnectionBuffers, -1, -classSize( c ) );
+                return _bufs[c][--_counts[c]];
+            }
+
+            bool push( int c, char* buf ) {
+                if ( _counts[c] == BufferPool::kBuffersPerClass ||
+                     _bytes + classSize( c ) > BufferPool::kMaxThreadCacheBytes )
+                    return false;
+                _bytes += classSize( c );
+                _bufs[c][_counts[c]++] = buf;
+                MemoryUsage::note( MemoryUsage::kConnectionBuffers, 1, classSize( c ) );
+                return true;
+            }
+
+        private:
+            char* _bufs[kNumClasses][BufferPool::kBuffersPerClass];
+            int _counts[kNumClasses];
+            int _bytes;
+        };
+
+        boost::thread_specific_ptr<ThreadCache> threadCache;
+
+        ThreadCache* getThreadCache() {
+            ThreadCache* cache = threadCache.get();
+            if ( !cache ) {
+                cache = new ThreadCache();
+                threadCache.reset( cache );
+            }
+            return cache;
+        }
+
+        // smallest class holding at least 'size' bytes; 'size' <= kMaxBufferSize
+        inline int classAtLeast( int size ) {
+            int c = 0;
+            while ( classSize( c ) < size )
+                c++;
+            return c;
+        }
+
+        // largest class no bigger than 'size'; 'size' >= kMinBufferSize
+        inline int classAtMost( int size ) {
+            int c = kNumClasses - 1;
+            while ( classSize( c ) > size )
+                c--;
+            return c;
+        }
+
+    } // namespace
+
+    // static
+    char* BufferPool::allocate( int size, int* capacity ) {
+        if ( size < kMinBufferSize || size > kMaxBufferSize ) {
+            char* buf = static_cast<char*>( malloc( size ) );
+            if ( !buf )
+                msgasserted( 17341, "out of memory BufferPool::allocate" );
+            *capacity = size;
+            return buf;
+        }
+
+        const int c = classAtLeast( size );
+        *capacity = classSize( c );
+
+        char* buf = getThreadCache()->pop( c );
+        if ( buf ) {
+            hits.increment();
+            return buf;
+        }
+
+        misses.increment();
+        NodeArena* arena = threadArena();
+        if ( arena && ( buf = arena->pop( c ) ) )
+            return buf;
+
+        buf = static_cast<char*>( malloc( *capacity ) );
+        if ( !buf )
+            msgasserted( 17342, "out of memory BufferPool::allocate" );
+        return buf;
+    }
+
+    // static
+    void BufferPool::release( void* buf, int size ) {
+        if ( !buf )
+            return;
+        // a much larger buffer is not worth keeping in place of a kMaxBufferSize one
+        if ( size < kMinBufferSize || size > 2 * kMaxBufferSize ||
+             !getThreadCache()->push( classAtMost( size ), static_cast<char*>( buf ) ) ) {
+            free( buf );
+        }
+    }
+
+    // static
+    void BufferPool::clearThreadCache() {
+        threadCache.reset();
+    }
+
+} // namespace mongo
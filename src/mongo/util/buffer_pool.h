@@ -0,0 +1,89 @@
+// buffer_pool.h
+
+/*
+ *    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include "mongo/base/counter.h"
+#include "mongo/bson/util/builder.h"
+
+namespace mongo {
+
+    /**
+     * A per-thread cache of recently freed buffers, for the large, short lived buffers that
+     * replies and received messages are built in.
+     *
+     * Buffers are plain malloc() blocks, so a buffer obtained from the pool may always be
+     * handed to free() instead of release() (e.g. when it is decoupled into a BSONObj), and any
+     * malloc() block may be given to release() as long as 'size' does not exceed its allocation.
+     *
+     * Sizes between kMinBufferSize and kMaxBufferSize are rounded up to a power of two; each
+     * thread keeps at most kBuffersPerClass buffers of each size and kMaxThreadCacheBytes in all.
+     * Smaller and larger requests go straight to malloc().
+     *
+     * Threads placed on a NUMA node (see numa.h) hand their cache to a per-node arena of up to
+     * kMaxNodeArenaBytes when they exit, and refill from it before going to malloc(), so that
+     * buffers stay on the node whose threads use them.
+     *
+     * The buffers held for reuse are counted under MemoryUsage::kConnectionBuffers.
+     */
+    class BufferPool {
+    public:
+        static const int kMinBufferSize = 4 * 1024;
+        static const int kMaxBufferSize = 1024 * 1024;
+        static const int kBuffersPerClass = 2;
+        static const int kMaxThreadCacheBytes = 2 * 1024 * 1024;
+        static const int kMaxNodeArenaBytes = 32 * 1024 * 1024;
+
+        /**
+         * @return a buffer of at least 'size' bytes, and its actual size in 'capacity'.
+         * Throws on allocation failure.
+         */
+        static char* allocate(int size, int* capacity);
+
+        /** Returns 'buf', of at least 'size' bytes, to this thread's cache (or frees it). */
+        static void release(void* buf, int size);
+
+        /** Frees this thread's cached buffers. */
+        static void clearThreadCache();
+
+        /** poolable allocate() calls satisfied from the cache, and ones that went to malloc(). */
+        static Counter64 hits;
+        static Counter64 misses;
+    };
+
+    /**
+     * A BufBuilder whose initial buffer comes from the BufferPool and is returned to it on
+     * destruction, unless it was decouple()d.
+     */
+    class PooledBufBuilder : public BufBuilder {
+    public:
+        explicit PooledBufBuilder(int initsize = BufferPool::kMinBufferSize) : BufBuilder(0) {
+            int capacity;
+            char* buf = BufferPool::allocate(initsize, &capacity);
+            adopt(buf, capacity);
+        }
+
+        ~PooledBufBuilder() {
+            if ( buf() ) {
+                BufferPool::release(buf(), getSize());
+                decouple();
+            }
+        }
+    };
+
+} // namespace mongo
@@ -0,0 +1,157 @@
+/* Copyright 2013 10gen Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/buffer_pool.h"
+
+#include <cstdlib>
+
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/memory_usage.h"
+
+namespace {
+
+    using mongo::BufferPool;
+    using mongo::MemoryUsage;
+    using mongo::PooledBufBuilder;
+
+    TEST(BufferPool, RoundsUpToSizeClass) {
+        BufferPool::clearThreadCache();
+        int capacity;
+        char* buf = BufferPool::allocate(5000, &capacity);
+        ASSERT_EQUALS(8192, capacity);
+        BufferPool::release(buf, capacity);
+    }
+
+    TEST(BufferPool, ReusesReleasedBuffer) {
+        BufferPool::clearThreadCache();
+        int capacity;
+        char* buf = BufferPool::allocate(32768, &capacity);
+        BufferPool::release(buf, capacity);
+
+        const long long hits = BufferPool::hits.get();
+        char* again = BufferPool::allocate(20000, &capacity);
+        ASSERT_EQUALS(static_cast<void*>(buf), static_cast<void*>(again));
+        ASSERT_EQUALS(32768, capacity);
+        ASSERT_EQUALS(hits + 1, BufferPool::hits.get());
+        BufferPool::release(again, capacity);
+    }
+
+    TEST(BufferPool, SmallAndLargeBypassCache) {
+        BufferPool::clearThreadCache();
+        const long long hits = BufferPool::hits.get();
+        const long long misses = BufferPool::misses.get();
+
+        int capacity;
+        char* small = BufferPool::allocate(100, &capacity);
+        ASSERT_EQUALS(100, capacity);
+        BufferPool::release(small, capacity);
+
+        char* large = BufferPool::allocate(BufferPool::kMaxBufferSize + 1, &capacity);
+        ASSERT_EQUALS(BufferPool::kMaxBufferSize + 1, capacity);
+        BufferPool::release(large, capacity);
+
+        ASSERT_EQUALS(hits, BufferPool::hits.get());
+        ASSERT_EQUALS(misses, BufferPool::misses.get());
+    }
+
+    TEST(BufferPool, ReleaseFilesUnderSmallerClass) {
+        BufferPool::clearThreadCache();
+        // Any malloc()ed block may be released; it is only ever reused for sizes it can hold.
+        char* buf = static_cast<char*>(malloc(6000));
+        BufferPool::release(buf, 6000);
+
+        int capacity;
+        char* again = BufferPool::allocate(4096, &capacity);
+        ASSERT_EQUALS(static_cast<void*>(buf), static_cast<void*>(again));
+        BufferPool::release(again, 6000);
+
+        char* other = BufferPool::allocate(4097, &capacity);
+        ASSERT_NOT_EQUALS(static_cast<void*>(buf), static_cast<void*>(other));
+        BufferPool::release(other, capacity);
+    }
+
+    TEST(BufferPool, CacheIsBounded) {
+        BufferPool::clearThreadCache();
+        const int n = BufferPool::kBuffersPerClass + 1;
+        char* bufs[n];
+        int capacity;
+        for (int i = 0; i < n; i++)
+            bufs[i] = BufferPool::allocate(4096, &capacity);
+        for (int i = 0; i < n; i++)
+            BufferPool::release(bufs[i], capacity);
+
+        const long long misses = BufferPool::misses.get();
+        for (int i = 0; i < n; i++)
+            bufs[i] = BufferPool::allocate(4096, &capacity);
+        ASSERT_EQUALS(misses + 1, BufferPool::misses.get());
+        for (int i = 0; i < n; i++)
+            BufferPool::release(bufs[i], capacity);
+    }
+
+    TEST(PooledBufBuilder, ReturnsBufferOnDestruction) {
+        BufferPool::clearThreadCache();
+        const char* first;
+        {
+            PooledBufBuilder b(8192);
+            b.appendStr("hello");
+            first = b.buf();
+        }
+        PooledBufBuilder b(8192);
+        ASSERT_EQUALS(static_cast<const void*>(first), static_cast<const void*>(b.buf()));
+        ASSERT_EQUALS(0, b.len());
+    }
+
+    TEST(BufferPool, CachedBuffersAreAccounted) {
+        BufferPool::clearThreadCache();
+        const long long objects = MemoryUsage::objects(MemoryUsage::kConnectionBuffers);
+        const long long bytes = MemoryUsage::bytes(MemoryUsage::kConnectionBuffers);
+
+        int capacity;
+        char* buf = BufferPool::allocate(8192, &capacity);
+        BufferPool::release(buf, capacity);
+        ASSERT_EQUALS(objects + 1, MemoryUsage::objects(MemoryUsage::kConnectionBuffers));
+        ASSERT_EQUALS(bytes + 8192, MemoryUsage::bytes(MemoryUsage::kConnectionBuffers));
+
+        BufferPool::clearThreadCache();
+        ASSERT_EQUALS(objects, MemoryUsage::objects(MemoryUsage::kConnectionBuffers));
+        ASSERT_EQUALS(bytes, MemoryUsage::bytes(MemoryUsage::kConnectionBuffers));
+    }
+
+    TEST(PooledBufBuilder, DecoupledBufferIsNotReturned) {
+        BufferPool::clearThreadCache();
+        char* first;
+        {
+            PooledBufBuilder b;
+            b.appendNum(1);
+            first = b.buf();
+            b.decouple();
+        }
+        PooledBufBuilder b;
+        ASSERT_NOT_EQUALS(static_cast<void*>(first), static_cast<void*>(b.buf()));
+        free(first);
+    }
+
+    TEST(PooledBufBuilder, Grows) {
+        PooledBufBuilder b;
+        for (int i = 0; i < BufferPool::kMinBufferSize; i++)
+            b.appendNum(i);
+        ASSERT_EQUALS(static_cast<int>(BufferPool::kMinBufferSize * sizeof(int)), b.len());
+        ASSERT_EQUALS(BufferPool::kMinBufferSize - 1,
+                      reinterpret_cast<const int*>(b.buf())[BufferPool::kMinBufferSize - 1]);
+    }
+
+} // namespace
@@ -33,6 +33,8 @@
 #include <boost/noncopyable.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition.hpp>
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/thread_stripe.h"
 #include "../assert_util.h"
 #include "../time_support.h"
 
@@ -66,6 +68,13 @@ namespace mongo {
         ^
         lock we are requesting
 
+        'r' is by far the most frequently requested state, so readers don't take the mutex unless
+        something blocks them. Each reader increments a counter in one of several cache line
+        sized stripes, picked per thread, and then checks _readerGate, which is nonzero whenever
+        W, X or a pending global write blocks 'r'. States that wait for readers to drain set the
+        gate (under the mutex) before summing the stripes, so one side always sees the other.
+        A reader that finds the gate set backs out and waits on the mutex as before.
+
         NOTE(!): The "X" state can only be reached from the "w" state.  A thread successfully
         transitions from "w" to "X" when w_to_X() returns true, and fails to transition to that
         state (remaining in "w") when that function returns false.  For one thread to successfully
@@ -80,17 +89,37 @@ namespace mongo {
             int n;
         };
         boost::mutex m;
-        Z r,w,R,W,U,X;
+        Z r,w,R,W,U,X;     // r.n is unused; readers are counted in _readerStripes
+
+        enum { NumReaderStripes = 16 };
+        struct ReaderStripe {
+            ReaderStripe() : n(0) { }
+            AtomicInt32 n;
+            char pad[StripeAlignment - sizeof(AtomicInt32)];
+        };
+        ReaderStripe _readerStripes[NumReaderStripes];
+        AtomicUInt32 _readerGate;  // W.n + X.n + numPendingGlobalWrites, written under m
+
         int numPendingGlobalWrites;  // >0 if someone wants to acquire a write lock
         long long generationX;
         long long generationXExit;
         void _lock_W();
         void _unlock_R();
+
+        int readers() const {
+            int n = 0;
+            for ( int i = 0; i < NumReaderStripes; i++ )
+                n += _readerStripes[i].n.load();
+            return n;
+        }
+        AtomicInt32& myReaderStripe();
+        void setReaderGate() { _readerGate.swap(W.n + X.n + numPendingGlobalWrites); }
+        void readerLeft();
         bool _areQueueJumpingGlobalWritesPending() const {
             return numPendingGlobalWrites > 0;
         }
 
-        bool W_legal() const { return r.n + w.n + R.n + W.n + X.n == 0; }
+        bool W_legal() const { return readers() + w.n + R.n + W.n + X.n == 0; }
         bool R_legal_ignore_greed() const { return w.n + W.n + X.n == 0; }
         bool r_legal_ignore_greed() const { return W.n + X.n == 0; }
         bool w_legal_ignore_greed() const { return R.n + W.n + X.n == 0; }
@@ -107,7 +136,7 @@ namespace mongo {
             return !_areQueueJumpingGlobalWritesPending() && r_legal_ignore_greed();
         }
 
-        bool X_legal() const { return w.n + r.n + R.n + W.n == 0; }
+        bool X_legal() const { return w.n + readers() + R.n + W.n == 0; }
 
         void notifyWeUnlocked(char me);
         static bool i_block(char me, char them);
@@ -153,7 +182,7 @@ namespace mongo {
         }
         if( U.n ) {
             // U is highest priority
-            if( (r.n + w.n + W.n + X.n == 0) && (R.n == 1) ) {
+            if( (readers() + w.n + W.n + X.n == 0) && (R.n == 1) ) {
                 U.c.notify_one();
                 return;
             }
@@ -177,14 +206,35 @@ namespace mongo {
         }
     }
 
+    inline AtomicInt32& QLock::myReaderStripe() {
+        return _readerStripes[threadStripe() % NumReaderStripes].n;
+    }
+
+    // a reader has left; wake anyone waiting for the readers to drain
+    inline void QLock::readerLeft() {
+        if ( _readerGate.load() == 0 )
+            return; // nothing is waiting on readers
+        boost::mutex::scoped_lock lk(m);
+        if ( W.n == 0 )
+            notifyWeUnlocked('r');
+    }
+
     // "i will be reading. i promise to coordinate my activities with w's as i go with more 
     //  granular locks."
     inline void QLock::lock_r() {
+        AtomicInt32& stripe = myReaderStripe();
+        stripe.fetchAndAdd(1);
+        if ( _readerGate.load() == 0 )
+            return;
+
+        stripe.fetchAndSubtract(1);
+        readerLeft();
+
         boost::mutex::scoped_lock lk(m);
         while( !r_legal() ) {
             r.c.wait(m);
         }
-        r.n++;
+        stripe.fetchAndAdd(1);
     }
 
     // "i will be writing. i promise to coordinate my activities with w's and r's as i go with more 
@@ -225,6 +275,7 @@ namespace mongo {
         boost::mutex::scoped_lock lk(m);
 
         ++numPendingGlobalWrites;
+        setReaderGate();
         while (!W_legal() && curTimeMillis64() < end) {
             W.c.timed_wait(m, boost::posix_time::milliseconds(millis));
         }
@@ -232,10 +283,12 @@ namespace mongo {
 
         if (W_legal()) {
             W.n++;
+            setReaderGate();
             fassert( 16202, W.n == 1 );
             return true;
         }
 
+        setReaderGate();
         return false;
     }
 
@@ -248,6 +301,7 @@ namespace mongo {
         fassert(16205, U.n == 0);
         W.n = 0;
         R.n = 1;
+        setReaderGate();
         notifyWeUnlocked('W');
     }
 
@@ -270,8 +324,9 @@ namespace mongo {
         U.n = 1;
 
         ++numPendingGlobalWrites;
+        setReaderGate();
 
-        while( W.n + R.n + w.n + r.n > 1 ) {
+        while( W.n + R.n + w.n + readers() > 1 ) {
             U.c.wait(m);
         }
         --numPendingGlobalWrites;
@@ -283,6 +338,7 @@ namespace mongo {
         R.n = 0;
         W.n = 1;
         U.n = 0;
+        setReaderGate();
     }
 
     inline bool QLock::w_to_X() {
@@ -292,6 +348,7 @@ namespace mongo {
 
         ++X.n;
         --w.n;
+        setReaderGate();
 
         long long myGeneration = generationX;
 
@@ -324,6 +381,7 @@ namespace mongo {
 
         w.n = X.n;
         X.n = 0;
+        setReaderGate();
         ++generationXExit;
         notifyWeUnlocked('X');
     }
@@ -331,11 +389,13 @@ namespace mongo {
     // "i will be writing. i will coordinate with no one. you better stop them all"
     inline void QLock::_lock_W() {
         ++numPendingGlobalWrites;
+        setReaderGate();
         while( !W_legal() ) {
             W.c.wait(m);
         }
         --numPendingGlobalWrites;
         W.n++;
+        setReaderGate();
     }
     inline void QLock::lock_W() {
         boost::mutex::scoped_lock lk(m);
@@ -343,10 +403,8 @@ namespace mongo {
     }
 
     inline void QLock::unlock_r() {
-        boost::mutex::scoped_lock lk(m);
-        fassert(16137, r.n > 0);
-        --r.n;
-        notifyWeUnlocked('r');
+        myReaderStripe().fetchAndSubtract(1);
+        readerLeft();
     }
     inline void QLock::unlock_w() {
         boost::mutex::scoped_lock lk(m);
@@ -370,6 +428,7 @@ namespace mongo {
         boost::mutex::scoped_lock lk(m);
         fassert(16140, W.n == 1);
         --W.n;
+        setReaderGate();
         notifyWeUnlocked('W');
     }
 
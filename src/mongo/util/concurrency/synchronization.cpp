@@ -53,28 +53,86 @@ namespace mongo {
         return ++_lastReturned;
     }
 
-    void NotifyAll::waitFor(When e) {
-        scoped_lock lock( _mutex );
+    struct NotifyAll::Waiter {
+        Waiter() : done(false) { }
+        boost::condition condition;
+        bool done;
+    };
+
+    void NotifyAll::_waitUntilDone(scoped_lock& lock, When e) {
+        if( _lastDone >= e )
+            return;
+
+        // notifyAll() takes us out of _waiters when it sets done
+        Waiter me;
+        _waiters.insert( std::make_pair( e, &me ) );
         ++_nWaiting;
-        while( _lastDone < e ) {
-            _condition.wait( lock.boost() );
+        while( !me.done ) {
+            me.condition.wait( lock.boost() );
         }
     }
 
+    void NotifyAll::waitFor(When e) {
+        scoped_lock lock( _mutex );
+        _waitUntilDone( lock, e );
+    }
+
     void NotifyAll::awaitBeyondNow() { 
         scoped_lock lock( _mutex );
-        ++_nWaiting;
         When e = ++_lastReturned;
-        while( _lastDone <= e ) {
-            _condition.wait( lock.boost() );
-        }
+        _waitUntilDone( lock, e + 1 );
     }
 
     void NotifyAll::notifyAll(When e) {
         scoped_lock lock( _mutex );
         _lastDone = e;
-        _nWaiting = 0;
-        _condition.notify_all();
+
+        std::multimap<When, Waiter*>::iterator end = _waiters.upper_bound( e );
+        for( std::multimap<When, Waiter*>::iterator i = _waiters.begin(); i != end; ++i ) {
+            i->second->done = true;
+            i->second->condition.notify_one();
+        }
+        _waiters.erase( _waiters.begin(), end );
+        _nWaiting = _waiters.size();
+    }
+
+    struct FifoGate::Waiter {
+        Waiter() : admitted(false) { }
+        boost::condition condition;
+        bool admitted;
+    };
+
+    FifoGate::FifoGate() : _mutex( "FifoGate" ), _busy( false ), _nWaiting( 0 ) { }
+
+    void FifoGate::enter() {
+        scoped_lock lock( _mutex );
+        if ( !_busy ) {
+            _busy = true;
+            return;
+        }
+
+        Waiter me;
+        _queue.push_back( &me );
+        ++_nWaiting;
+        while ( !me.admitted ) {
+            me.condition.wait( lock.boost() );
+        }
+        --_nWaiting;
+    }
+
+    void FifoGate::leave() {
+        scoped_lock lock( _mutex );
+        verify( _busy );
+        if ( _queue.empty() ) {
+            _busy = false;
+            return;
+        }
+
+        // the gate stays busy: it goes straight to the next waiter
+        Waiter* next = _queue.front();
+        _queue.pop_front();
+        next->admitted = true;
+        next->condition.notify_one();
     }
 
 } // namespace mongo
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <deque>
+#include <map>
 #include <boost/thread/condition.hpp>
 #include "mutex.h"
 
@@ -51,6 +53,10 @@ namespace mongo {
 
     /** establishes a synchronization point between threads. N threads are waits and one is notifier.
         threadsafe.
+
+        each waiter sleeps on a condition of its own, so that notifyAll(e) wakes exactly the
+        threads waiting for e or earlier, together, and leaves those waiting for a later event
+        asleep.
     */
     class NotifyAll : boost::noncopyable {
     public:
@@ -75,10 +81,44 @@ namespace mongo {
         unsigned nWaiting() const { return _nWaiting; }
 
     private:
+        struct Waiter;
+
+        /** waits, with _mutex held, until _lastDone reaches e */
+        void _waitUntilDone(scoped_lock& lock, When e);
+
         mongo::mutex _mutex;
-        boost::condition _condition;
         When _lastDone;
         When _lastReturned;
+        std::multimap<When, Waiter*> _waiters;  // by the event each one waits for
+        unsigned _nWaiting;
+    };
+
+    /**
+     * Lets one thread through at a time, in the order they arrived.  Each waiter sleeps on a
+     * condition of its own and leave() hands the gate straight to the oldest one, so that a
+     * release wakes exactly one thread however many are queued.
+     *
+     * This class is thread-safe.
+     */
+    class FifoGate : boost::noncopyable {
+    public:
+        FifoGate();
+
+        /** blocks until every thread that called enter() before us has called leave() */
+        void enter();
+
+        /** must be called by the thread that entered */
+        void leave();
+
+        /** indicates how many threads are queued in enter() */
+        unsigned nWaiting() const { return _nWaiting; }
+
+    private:
+        struct Waiter;
+
+        mongo::mutex _mutex;          // protects state below
+        bool _busy;
+        std::deque<Waiter*> _queue;
         unsigned _nWaiting;
     };
 
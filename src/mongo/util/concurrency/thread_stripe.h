@@ -0,0 +1,59 @@
+// @file thread_stripe.h
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects
+*    for all of the code used other than as permitted herein. If you modify
+*    file(s) with this exception, you may extend this exception to your
+*    version of the file(s), but you are not obligated to do so. If you do not
+*    wish to do so, delete this exception statement from your version. If you
+*    delete this exception statement from all source files in the program,
+*    then also delete it in the license file.
+*/
+
+#pragma once
+
+#include <boost/thread/tss.hpp>
+
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    /** Size, in bytes, to pad a stripe to so that no two stripes share a cache line. */
+    const unsigned StripeAlignment = 64;
+
+    /**
+     * A number for the calling thread, handed out round-robin on its first call and the same
+     * for the rest of its life.  Counters that many threads update can be split into stripes,
+     * each thread updating stripe threadStripe() % numStripes and readers summing them all, so
+     * threads on different cores don't keep taking the same cache line from one another.
+     */
+    inline unsigned threadStripe() {
+        static boost::thread_specific_ptr<unsigned> stripe;
+        static AtomicUInt32 nextStripe;
+        unsigned* i = stripe.get();
+        if ( !i ) {
+            i = new unsigned( nextStripe.fetchAndAdd(1) );
+            stripe.reset(i);
+        }
+        return *i;
+    }
+
+}  // namespace mongo
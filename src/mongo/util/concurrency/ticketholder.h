@@ -49,14 +49,15 @@ namespace mongo {
             _newTicket.notify_one();
         }
 
-        void resize( int newSize ) {
+        /** @return false, leaving the size as it was, if more than newSize are in use */
+        bool resize( int newSize ) {
             {
                 scoped_lock lk( _mutex );
 
                 int used = _outof - _num;
                 if ( used > newSize ) {
                     std::cout << "can't resize since we're using (" << used << ") more than newSize(" << newSize << ")" << std::endl;
-                    return;
+                    return false;
                 }
 
                 _outof = newSize;
@@ -65,6 +66,7 @@ namespace mongo {
 
             // Potentially wasteful, but easier to see is correct
             _newTicket.notify_all();
+            return true;
         }
 
         int available() const {
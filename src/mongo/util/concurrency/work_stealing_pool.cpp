@@ -0,0 +1,280 @@
+// work_stealing_pool.cpp
+
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/concurrency/work_stealing_pool.h"
+
+#include <deque>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "mongo/util/assert_util.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+    struct WorkStealingPool::Worker {
+        Worker() { }
+
+        boost::mutex mutex;             // protects the deques
+        std::deque<Task> tasks;         // back: the worker's own end; front: thieves' end
+        std::deque<Task> pinned;
+        AtomicInt32 numPinned;
+        boost::scoped_ptr<boost::thread> thread;
+    };
+
+namespace {
+    struct CurrentWorker {
+        const WorkStealingPool* pool;
+        int index;
+    };
+    boost::thread_specific_ptr<CurrentWorker> currentWorkerSlot;
+
+    void runLoggingErrors(const WorkStealingPool::Task& task) {
+        try {
+            task();
+        }
+        catch (DBException& e) {
+            log() << "Unhandled DBException in pool task: " << e.toString() << endl;
+        }
+        catch (std::exception& e) {
+            log() << "Unhandled std::exception in pool task: " << e.what() << endl;
+        }
+        catch (...) {
+            log() << "Unhandled non-exception in pool task" << endl;
+        }
+    }
+}
+
+    WorkStealingPool::WorkStealingPool(int nThreads) : _shutdown(false) {
+        verify(nThreads > 0);
+        for (int i = 0; i < nThreads; i++)
+            _workers.push_back(new Worker());
+        for (int i = 0; i < nThreads; i++)
+            _workers[i]->thread.reset(new boost::thread(
+                    boost::bind(&WorkStealingPool::workerLoop, this, i)));
+    }
+
+    WorkStealingPool::~WorkStealingPool() {
+        {
+            boost::mutex::scoped_lock lk(_idleMutex);
+            _shutdown = true;
+        }
+        _idle.notify_all();
+
+        for (size_t i = 0; i < _workers.size(); i++) {
+            _workers[i]->thread->join();
+            delete _workers[i];
+        }
+    }
+
+    WorkStealingPool& WorkStealingPool::shared() {
+        static WorkStealingPool* pool =
+            new WorkStealingPool(std::max(1u, boost::thread::hardware_concurrency()));
+        return *pool;
+    }
+
+    int WorkStealingPool::currentWorker() const {
+        const CurrentWorker* current = currentWorkerSlot.get();
+        if (!current || current->pool != this)
+            return -1;
+        return current->index;
+    }
+
+    void WorkStealingPool::schedule(const Task& task) {
+        int target = currentWorker();
+        if (target < 0)
+            target = _nextWorker.fetchAndAdd(1) % _workers.size();
+        push(target, false, task);
+    }
+
+    void WorkStealingPool::schedulePinned(int worker, const Task& task) {
+        push(worker % _workers.size(), true, task);
+    }
+
+    void WorkStealingPool::push(int worker, bool pinned, const Task& task) {
+        Worker& w = *_workers[worker];
+        {
+            boost::mutex::scoped_lock lk(w.mutex);
+            if (pinned)
+                w.pinned.push_back(task);
+            else
+                w.tasks.push_back(task);
+        }
+
+        // Counted under _idleMutex so a worker can't go to sleep in between. The counts can
+        // briefly go negative when the task is taken before it is counted.
+        {
+            boost::mutex::scoped_lock lk(_idleMutex);
+            if (pinned)
+                w.numPinned.fetchAndAdd(1);
+            else
+                _stealable.fetchAndAdd(1);
+        }
+        if (pinned)
+            _idle.notify_all();
+        else
+            _idle.notify_one();
+    }
+
+    bool WorkStealingPool::runOne(int self) {
+        Task task;
+        bool found = false;
+
+        if (self >= 0) {
+            Worker& me = *_workers[self];
+            boost::mutex::scoped_lock lk(me.mutex);
+            if (!me.pinned.empty()) {
+                task.swap(me.pinned.front());
+                me.pinned.pop_front();
+                me.numPinned.fetchAndSubtract(1);
+                found = true;
+            }
+            else if (!me.tasks.empty()) {
+                task.swap(me.tasks.back());
+                me.tasks.pop_back();
+                _stealable.fetchAndSubtract(1);
+                found = true;
+            }
+        }
+
+        // steal from the others, starting after ourselves so thieves spread out
+        const int n = _workers.size();
+        for (int i = 1; i <= n && !found; i++) {
+            Worker& victim = *_workers[(self + i + n) % n];
+            boost::mutex::scoped_lock lk(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task.swap(victim.tasks.front());
+                victim.tasks.pop_front();
+                _stealable.fetchAndSubtract(1);
+                found = true;
+            }
+        }
+
+        if (!found)
+            return false;
+
+        runLoggingErrors(task);
+        return true;
+    }
+
+    void WorkStealingPool::workerLoop(int self) {
+        CurrentWorker* current = new CurrentWorker();
+        current->pool = this;
+        current->index = self;
+        currentWorkerSlot.reset(current);
+
+        Worker& me = *_workers[self];
+        while (true) {
+            if (runOne(self))
+                continue;
+
+            boost::mutex::scoped_lock lk(_idleMutex);
+            while (_stealable.load() <= 0 && me.numPinned.load() <= 0) {
+                if (_shutdown)
+                    return;
+                _idle.wait(lk);
+            }
+        }
+    }
+
+    TaskGroup::TaskGroup(WorkStealingPool& pool) : _pool(pool), _errorCode(0) { }
+
+    TaskGroup::~TaskGroup() {
+        wait();
+    }
+
+    void TaskGroup::schedule(const WorkStealingPool::Task& task) {
+        _pending.fetchAndAdd(1);
+        _pool.schedule(boost::bind(&TaskGroup::run, this, task));
+    }
+
+    void TaskGroup::schedulePinned(int worker, const WorkStealingPool::Task& task) {
+        _pending.fetchAndAdd(1);
+        _pool.schedulePinned(worker, boost::bind(&TaskGroup::run, this, task));
+    }
+
+    void TaskGroup::run(const WorkStealingPool::Task& task) {
+        int code = 0;
+        string message;
+        try {
+            task();
+        }
+        catch (const DBException& e) {
+            code = e.getCode();
+            message = e.what();
+        }
+        catch (const std::exception& e) {
+            code = 17366;
+            message = e.what();
+        }
+        catch (...) {
+            code = 17366;
+            message = "unknown exception";
+        }
+
+        // Finishing under the mutex: once wait() has taken it after seeing no pending tasks,
+        // nothing here touches the group any more.
+        boost::mutex::scoped_lock lk(_mutex);
+        if (code && !_errorCode) {
+            _errorCode = code;
+            _errorMessage = message;
+        }
+        if (_pending.subtractAndFetch(1) == 0)
+            _done.notify_all();
+    }
+
+    void TaskGroup::wait() {
+        const int self = _pool.currentWorker();
+        while (_pending.load() > 0) {
+            // A worker helps with whatever is queued, which may be what we're waiting for.
+            if (self >= 0 && _pool.runOne(self))
+                continue;
+
+            boost::mutex::scoped_lock lk(_mutex);
+            if (_pending.load() == 0)
+                break;
+            if (self >= 0) {
+                // our tasks may schedule more for us to help with
+                _done.timed_wait(lk, boost::posix_time::milliseconds(1));
+            }
+            else {
+                _done.wait(lk);
+            }
+        }
+        boost::mutex::scoped_lock lk(_mutex);
+    }
+
+    void TaskGroup::join() {
+        wait();
+
+        int code;
+        string message;
+        {
+            boost::mutex::scoped_lock lk(_mutex);
+            code = _errorCode;
+            message = _errorMessage;
+            _errorCode = 0;
+            _errorMessage.clear();
+        }
+        if (code)
+            uasserted(code, message);
+    }
+
+} // namespace mongo
@@ -0,0 +1,128 @@
+// work_stealing_pool.h
+
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    /**
+     * A fixed set of worker threads for subsystems that split their work into short tasks
+     * (parallel scans, index key generation, validation...), so they share one set of threads
+     * instead of each starting their own.
+     *
+     * Each worker has its own deque.  A task scheduled from a worker goes on the back of that
+     * worker's deque and the worker takes it back from there (newest first, so nested work
+     * stays cache warm), while idle workers steal from the front of the other deques.  Tasks
+     * scheduled from other threads are spread round-robin over the deques.  Pinned tasks always
+     * run on the worker they were given to.
+     *
+     * Tasks run without a Client and must not block on anything but TaskGroup::join(), which
+     * runs other tasks while it waits.  Long running or blocking consumers should keep using a
+     * ThreadPool of their own.
+     */
+    class WorkStealingPool : boost::noncopyable {
+    public:
+        typedef boost::function<void()> Task;
+
+        explicit WorkStealingPool(int nThreads);
+
+        /** runs whatever is still queued, then stops the workers */
+        ~WorkStealingPool();
+
+        int numThreads() const { return _workers.size(); }
+
+        void schedule(const Task& task);
+
+        /** runs 'task' on worker number 'worker' % numThreads(); it is never stolen */
+        void schedulePinned(int worker, const Task& task);
+
+        /** the process wide pool, with a worker per core */
+        static WorkStealingPool& shared();
+
+    private:
+        friend class TaskGroup;
+        struct Worker;
+
+        /** @return this thread's worker number in this pool, or -1 */
+        int currentWorker() const;
+
+        /**
+         * Runs one queued task that 'self' may run: its pinned tasks, then its own deque, then
+         * stolen ones.  @return false if there was none.
+         */
+        bool runOne(int self);
+
+        void workerLoop(int self);
+        void push(int worker, bool pinned, const Task& task);
+
+        std::vector<Worker*> _workers;
+        AtomicUInt32 _nextWorker;   // round-robin target for schedule() from other threads
+
+        // idle workers sleep here until there is something for them
+        boost::mutex _idleMutex;
+        boost::condition _idle;
+        AtomicInt32 _stealable;     // tasks queued on any deque
+        bool _shutdown;
+    };
+
+    /**
+     * Tasks scheduled on a WorkStealingPool that are waited for together.  If a task throws,
+     * join() throws the first such error once every task of the group has finished.
+     */
+    class TaskGroup : boost::noncopyable {
+    public:
+        explicit TaskGroup(WorkStealingPool& pool);
+
+        /** waits for the group's tasks, but doesn't throw their errors */
+        ~TaskGroup();
+
+        void schedule(const WorkStealingPool::Task& task);
+        void schedulePinned(int worker, const WorkStealingPool::Task& task);
+
+        /**
+         * Waits until every task scheduled so far has finished.  On a worker thread this runs
+         * queued tasks meanwhile, so tasks can themselves start and join groups.
+         */
+        void join();
+
+        /** tasks scheduled but not yet finished */
+        int pending() const { return _pending.load(); }
+
+    private:
+        void run(const WorkStealingPool::Task& task);
+        void wait();
+
+        WorkStealingPool& _pool;
+        AtomicInt32 _pending;
+
+        boost::mutex _mutex;        // protects the fields below
+        boost::condition _done;
+        int _errorCode;
+        std::string _errorMessage;
+    };
+
+} // namespace mongo
@@ -83,8 +83,20 @@ namespace mongo {
     }
 
 
+    namespace {
+        // files of different databases are allocated concurrently by this many threads
+        const int kNumWorkers = 4;
+
+        // "/data/db/foo.3" and "/data/db/foo.ns" both belong to "/data/db/foo"
+        string databasePrefix( const string& name ) {
+            return name.substr( 0, name.rfind( '.' ) );
+        }
+    }
+
     void FileAllocator::start() {
-        boost::thread t( boost::bind( &FileAllocator::run , this ) );
+        for ( int i = 0; i < kNumWorkers; i++ ) {
+            boost::thread t( boost::bind( &FileAllocator::run , this ) );
+        }
     }
 
     void FileAllocator::requestAllocation( const string &name, long &size ) {
@@ -111,20 +123,22 @@ namespace mongo {
         }
         checkFailure();
         _pendingSize[ name ] = size;
-        if ( _pending.size() == 0 )
-            _pending.push_back( name );
-        else if ( _pending.front() != name ) {
+        if ( _allocating.count( name ) == 0 ) {
+            // jump the queue; workers skip anything already claimed
             _pending.remove( name );
-            list< string >::iterator i = _pending.begin();
-            ++i;
-            _pending.insert( i, name );
+            _pending.push_front( name );
         }
         _pendingUpdated.notify_all();
+        if ( !inProgress( name ) )
+            return;
+
+        Timer t;
+        _stats.waits++;
         while( inProgress( name ) ) {
             checkFailure();
             _pendingUpdated.wait( lk.boost() );
         }
-
+        _stats.waitMicros += t.micros();
     }
 
     void FileAllocator::waitUntilFinished() const {
@@ -166,6 +180,16 @@ namespace mongo {
         }
 #endif
 
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+        // the file is new, so plain fallocate() already hands back zeroed (unwritten) extents;
+        // FALLOC_FL_ZERO_RANGE would buy nothing.  try it before posix_fallocate() as glibc
+        // emulates the latter by writing every block on filesystems without support.
+        if ( fallocate(fd, 0, 0, size) == 0 )
+            return;
+
+        LOG(1) << "FileAllocator: fallocate failed: " << errnoWithDescription() << endl;
+#endif
+
 #if defined(__linux__)
         int ret = posix_fallocate(fd,0,size);
         if ( ret == 0 )
@@ -210,6 +234,14 @@ namespace mongo {
         return _failed;
     }
 
+    FileAllocator::Stats FileAllocator::getStats() const {
+        scoped_lock lk( _pendingMutex );
+        Stats stats = _stats;
+        stats.pending = _pending.size();
+        stats.inProgress = _allocating.size();
+        return stats;
+    }
+
     void FileAllocator::checkFailure() {
         if (_failed) {
             // we want to log the problem (diskfull.js expects it) but we do not want to dump a stack tracke
@@ -233,6 +265,21 @@ namespace mongo {
         return false;
     }
 
+    // caller must hold _pendingMutex lock.
+    bool FileAllocator::nextAllocation( string* name ) const {
+        set< string > busy;
+        for( set< string >::const_iterator i = _allocating.begin(); i != _allocating.end(); ++i )
+            busy.insert( databasePrefix( *i ) );
+
+        for( list< string >::const_iterator i = _pending.begin(); i != _pending.end(); ++i ) {
+            if ( _allocating.count( *i ) || busy.count( databasePrefix( *i ) ) )
+                continue;
+            *name = *i;
+            return true;
+        }
+        return false;
+    }
+
     string FileAllocator::makeTempFileName( boost::filesystem::path root ) {
         while( 1 ) {
             boost::filesystem::path p = root / "_tmp";
@@ -260,104 +307,113 @@ namespace mongo {
             // initialize unique temporary file name counter
             // TODO: SERVER-6055 -- Unify temporary file name selection
             SimpleMutex::scoped_lock lk(_uniqueNumberMutex);
-            _uniqueNumber = curTimeMicros64();
+            if ( _uniqueNumber == 0 )
+                _uniqueNumber = curTimeMicros64();
         }
         while( 1 ) {
+            string name;
+            long size = 0;
             {
                 scoped_lock lk( fa->_pendingMutex );
-                if ( fa->_pending.size() == 0 )
+                while ( !fa->nextAllocation( &name ) )
                     fa->_pendingUpdated.wait( lk.boost() );
+                size = fa->_pendingSize[ name ];
+                fa->_allocating.insert( name );
             }
-            while( 1 ) {
-                string name;
-                long size = 0;
-                {
-                    scoped_lock lk( fa->_pendingMutex );
-                    if ( fa->_pending.size() == 0 )
-                        break;
-                    name = fa->_pending.front();
-                    size = fa->_pendingSize[ name ];
-                }
 
-                string tmp;
-                long fd = 0;
-                try {
-                    log() << "allocating new datafile " << name << ", filling with zeroes..." << endl;
-                    
-                    boost::filesystem::path parent = ensureParentDirCreated(name);
-                    tmp = fa->makeTempFileName( parent );
-                    ensureParentDirCreated(tmp);
+            string tmp;
+            long fd = 0;
+            try {
+                log() << "allocating new datafile " << name << ", filling with zeroes..." << endl;
+                
+                boost::filesystem::path parent = ensureParentDirCreated(name);
+                tmp = fa->makeTempFileName( parent );
+                ensureParentDirCreated(tmp);
 
 #if defined(_WIN32)
-                    fd = _open( tmp.c_str(), _O_RDWR | _O_CREAT | O_NOATIME, _S_IREAD | _S_IWRITE );
+                fd = _open( tmp.c_str(), _O_RDWR | _O_CREAT | O_NOATIME, _S_IREAD | _S_IWRITE );
 #else
-                    fd = open(tmp.c_str(), O_CREAT | O_RDWR | O_NOATIME, S_IRUSR | S_IWUSR);
+                fd = open(tmp.c_str(), O_CREAT | O_RDWR | O_NOATIME, S_IRUSR | S_IWUSR);
 #endif
-                    if ( fd < 0 ) {
-                        log() << "FileAllocator: couldn't create " << name << " (" << tmp << ") " << errnoWithDescription() << endl;
-                        uasserted(10439, "");
-                    }
+                if ( fd < 0 ) {
+                    log() << "FileAllocator: couldn't create " << name << " (" << tmp << ") " << errnoWithDescription() << endl;
+                    uasserted(10439, "");
+                }
 
 #if defined(POSIX_FADV_DONTNEED)
-                    if( posix_fadvise(fd, 0, size, POSIX_FADV_DONTNEED) ) {
-                        log() << "warning: posix_fadvise fails " << name << " (" << tmp << ") " << errnoWithDescription() << endl;
-                    }
+                if( posix_fadvise(fd, 0, size, POSIX_FADV_DONTNEED) ) {
+                    log() << "warning: posix_fadvise fails " << name << " (" << tmp << ") " << errnoWithDescription() << endl;
+                }
 #endif
 
-                    Timer t;
+                Timer t;
+
+                /* make sure the file is the full desired length */
+                ensureLength( fd , size );
 
-                    /* make sure the file is the full desired length */
-                    ensureLength( fd , size );
+                close( fd );
+                fd = 0;
 
+                if( rename(tmp.c_str(), name.c_str()) ) {
+                    const string& errStr = errnoWithDescription();
+                    const string& errMessage = str::stream()
+                            << "error: couldn't rename " << tmp
+                            << " to " << name << ' ' << errStr;
+                    msgasserted(13653, errMessage);
+                }
+                flushMyDirectory(name);
+
+                log() << "done allocating datafile " << name << ", "
+                      << "size: " << size/1024/1024 << "MB, "
+                      << " took " << ((double)t.millis())/1000.0 << " secs"
+                      << endl;
+
+                {
+                    scoped_lock lk( fa->_pendingMutex );
+                    fa->_stats.allocations++;
+                    fa->_stats.allocationMicros += t.micros();
+                }
+
+                // no longer in a failed state. allow new writers.
+                fa->_failed = false;
+            }
+            catch ( const std::exception& e ) {
+                log() << "error: failed to allocate new file: " << name
+                      << " size: " << size << ' ' << e.what()
+                      << ".  will try again in 10 seconds" << endl;
+                if ( fd > 0 )
                     close( fd );
-                    fd = 0;
-
-                    if( rename(tmp.c_str(), name.c_str()) ) {
-                        const string& errStr = errnoWithDescription();
-                        const string& errMessage = str::stream()
-                                << "error: couldn't rename " << tmp
-                                << " to " << name << ' ' << errStr;
-                        msgasserted(13653, errMessage);
-                    }
-                    flushMyDirectory(name);
-
-                    log() << "done allocating datafile " << name << ", "
-                          << "size: " << size/1024/1024 << "MB, "
-                          << " took " << ((double)t.millis())/1000.0 << " secs"
-                          << endl;
-
-                    // no longer in a failed state. allow new writers.
-                    fa->_failed = false;
+                try {
+                    if ( ! tmp.empty() )
+                        boost::filesystem::remove( tmp );
+                    boost::filesystem::remove( name );
+                } catch ( const std::exception& e ) {
+                    log() << "error removing files: " << e.what() << endl;
                 }
-                catch ( const std::exception& e ) {
-                    log() << "error: failed to allocate new file: " << name
-                          << " size: " << size << ' ' << e.what()
-                          << ".  will try again in 10 seconds" << endl;
-                    if ( fd > 0 )
-                        close( fd );
-                    try {
-                        if ( ! tmp.empty() )
-                            boost::filesystem::remove( tmp );
-                        boost::filesystem::remove( name );
-                    } catch ( const std::exception& e ) {
-                        log() << "error removing files: " << e.what() << endl;
-                    }
+                {
                     scoped_lock lk( fa->_pendingMutex );
                     fa->_failed = true;
                     // not erasing from pending
                     fa->_pendingUpdated.notify_all();
-                    
-                    
-                    sleepsecs(10);
-                    continue;
                 }
 
+                sleepsecs(10);
+
                 {
+                    // still claimed while we slept, so nobody retried it any sooner
                     scoped_lock lk( fa->_pendingMutex );
-                    fa->_pendingSize.erase( name );
-                    fa->_pending.pop_front();
+                    fa->_allocating.erase( name );
                     fa->_pendingUpdated.notify_all();
                 }
+                continue;
+            }
+
+            {
+                scoped_lock lk( fa->_pendingMutex );
+                fa->_pendingSize.erase( name );
+                fa->_pending.remove( name );
+                fa->_allocating.erase( name );
+                fa->_pendingUpdated.notify_all();
             }
         }
     }
@@ -18,6 +18,7 @@
 #include "mongo/pch.h"
 
 #include <list>
+#include <set>
 #include <boost/filesystem/path.hpp>
 #include <boost/thread/condition.hpp>
 
@@ -27,7 +28,8 @@ namespace mongo {
 
     /*
      * Handles allocation of contiguous files on disk.  Allocation may be
-     * requested asynchronously or synchronously.
+     * requested asynchronously or synchronously.  Files of different databases
+     * are allocated in parallel by a small pool of worker threads.
      * singleton
      */
     class FileAllocator : boost::noncopyable {
@@ -56,6 +58,19 @@ namespace mongo {
         
         bool hasFailed() const;
 
+        struct Stats {
+            Stats() : allocations( 0 ), allocationMicros( 0 ), waits( 0 ), waitMicros( 0 ),
+                      pending( 0 ), inProgress( 0 ) {}
+            long long allocations;      // files created
+            long long allocationMicros; // time spent creating them
+            long long waits;            // allocateAsap() calls that had to wait
+            long long waitMicros;       // time those callers were blocked
+            long long pending;          // requests not yet finished
+            long long inProgress;       // requests a worker is filling right now
+        };
+
+        Stats getStats() const;
+
         static void ensureLength(int fd, long size);
 
         /** @return the singleton */
@@ -74,7 +89,15 @@ namespace mongo {
         // caller must hold pendingMutex_ lock.
         bool inProgress( const string &name ) const;
 
-        /** called from the worked thread */
+        /**
+         * Pick the next pending file no worker has claimed, skipping files of a database that
+         * already has an allocation running so that each database's files are created in order.
+         * caller must hold pendingMutex_ lock.
+         * @return false if there is nothing a worker may start now
+         */
+        bool nextAllocation( string* name ) const;
+
+        /** called from the worker threads */
         static void run( FileAllocator * fa );
 
         // generate a unique name for temporary files
@@ -83,9 +106,15 @@ namespace mongo {
         mutable mongo::mutex _pendingMutex;
         mutable boost::condition _pendingUpdated;
 
+        // requested and not finished, whether or not a worker is on it yet
         std::list< string > _pending;
         mutable map< string, long > _pendingSize;
 
+        // members of _pending a worker is filling right now
+        std::set< string > _allocating;
+
+        Stats _stats;
+
         // unique number for temporary files
         static unsigned long long _uniqueNumber;
 
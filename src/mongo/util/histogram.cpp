@@ -42,7 +42,7 @@ namespace mongo {
         : _initialValue( opts.initialValue )
         , _numBuckets( opts.numBuckets )
         , _boundaries( new uint32_t[_numBuckets] )
-        , _buckets( new uint64_t[_numBuckets] ) {
+        , _buckets( new AtomicUInt64[_numBuckets] ) {
 
         // TODO more sanity checks
         // + not too few buckets
@@ -64,9 +64,6 @@ namespace mongo {
         }
         _boundaries[ _numBuckets-1 ] = std::numeric_limits<uint32_t>::max();
 
-        for ( uint32_t i = 0; i < _numBuckets; i++ ) {
-            _buckets[i] = 0;
-        }
     }
 
     Histogram::~Histogram() {
@@ -77,14 +74,14 @@ namespace mongo {
     void Histogram::insert( uint32_t element ) {
         if ( element < _initialValue) return;
 
-        _buckets[ _findBucket(element) ] += 1;
+        _buckets[ _findBucket(element) ].fetchAndAdd(1);
     }
 
     std::string Histogram::toHTML() const {
         uint64_t max = 0;
         for ( uint32_t i = 0; i < _numBuckets; i++ ) {
-            if ( _buckets[i] > max ) {
-                max = _buckets[i];
+            if ( _buckets[i].load() > max ) {
+                max = _buckets[i].load();
             }
         }
         if ( max == 0 ) {
@@ -95,7 +92,7 @@ namespace mongo {
         const int maxBar = 20;
         ostringstream ss;
         for ( uint32_t i = 0; i < _numBuckets; i++ ) {
-            int barSize = _buckets[i] * maxBar / max;
+            int barSize = _buckets[i].load() * maxBar / max;
             ss << std::string( barSize,'*' )
                << setfill(' ') << setw( maxBar-barSize + 12 )
                << _boundaries[i] << '\n';
@@ -107,7 +104,7 @@ namespace mongo {
     uint64_t Histogram::getCount( uint32_t bucket ) const {
         if ( bucket >= _numBuckets ) return 0;
 
-        return _buckets[ bucket ];
+        return _buckets[ bucket ].load();
     }
 
     uint32_t Histogram::getBoundary( uint32_t bucket ) const {
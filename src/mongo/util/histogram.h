@@ -32,6 +32,8 @@
 #include <string>
 #include <stdint.h>
 
+#include "mongo/platform/atomic_word.h"
+
 namespace mongo {
 
     /**
@@ -83,7 +85,8 @@ namespace mongo {
         ~Histogram();
 
         /**
-         * Find the bucket that 'element' falls into and increment its count.
+         * Find the bucket that 'element' falls into and increment its count. Safe to call
+         * from several threads at once.
          */
         void insert( uint32_t element );
 
@@ -124,7 +127,7 @@ namespace mongo {
 
         // all below owned here
         uint32_t* _boundaries;    // maximum element of each bucket
-        uint64_t* _buckets;       // current count of each bucket
+        AtomicUInt64* _buckets;   // current count of each bucket
 
         Histogram( const Histogram& );
         Histogram& operator=( const Histogram& );
@@ -126,6 +126,8 @@ namespace mongo {
         }
     }
 
+    void LogFile::useAsyncIO(unsigned queueDepth) { }
+
     void LogFile::synchronousAppend(const void *_buf, size_t _len) {
         const size_t BlockSize = 8 * 1024 * 1024;
         verify(_fd);
@@ -161,9 +163,18 @@ namespace mongo {
 #include <fcntl.h>
 #include "paths.h"
 
+#if defined(__linux__)
+#include <linux/aio_abi.h>
+#include <sys/syscall.h>
+#endif
+
 namespace mongo {
 
     LogFile::LogFile(const std::string& name, bool readwrite) : _name(name) {
+#if defined(__linux__)
+        _aioContext = 0;
+        _queueDepth = 0;
+#endif
         int options = O_CREAT
                     | (readwrite?O_RDWR:O_WRONLY)
 #if defined(O_DIRECT)
@@ -195,11 +206,106 @@ namespace mongo {
     }
 
     LogFile::~LogFile() {
+#if defined(__linux__)
+        if( _aioContext )
+            syscall(SYS_io_destroy, (aio_context_t) _aioContext);
+#endif
         if( _fd >= 0 )
             close(_fd);
         _fd = -1;
     }
 
+#if defined(__linux__)
+    namespace {
+        // each request in flight writes this much.  a multiple of any direct i/o alignment
+        const size_t AsyncChunkSize = 1024 * 1024;
+    }
+
+    void LogFile::useAsyncIO(unsigned queueDepth) {
+        if( !_direct || queueDepth < 2 || _aioContext )
+            return;
+        aio_context_t ctx = 0;
+        if( syscall(SYS_io_setup, queueDepth, &ctx) != 0 ) {
+            log() << "async i/o not available for " << _name << ", using synchronous writes "
+                  << errnoWithDescription() << endl;
+            return;
+        }
+        _aioContext = ctx;
+        _queueDepth = queueDepth;
+    }
+
+    /** write all of buf at the current position, keeping the queue full, and move the position
+        past it.  doesn't sync.
+    */
+    void LogFile::_asyncAppend(const char *buf, size_t len) {
+        const aio_context_t ctx = _aioContext;
+        const off_t pos = lseek(_fd, 0, SEEK_CUR); // doesn't actually seek
+        const size_t nChunks = (len + AsyncChunkSize - 1) / AsyncChunkSize;
+
+        std::vector<struct iocb> cbs(_queueDepth);
+        std::vector<struct iocb*> idle;
+        for( unsigned i = 0; i < _queueDepth; i++ )
+            idle.push_back(&cbs[i]);
+        std::vector<struct io_event> events(_queueDepth);
+
+        size_t submitted = 0;
+        size_t completed = 0;
+        while( completed < nChunks ) {
+            // hand the kernel as many chunks as there are idle slots
+            std::vector<struct iocb*> batch;
+            while( submitted + batch.size() < nChunks && !idle.empty() ) {
+                struct iocb *cb = idle.back();
+                idle.pop_back();
+                const size_t ofs = (submitted + batch.size()) * AsyncChunkSize;
+                memset(cb, 0, sizeof(*cb));
+                cb->aio_fildes = _fd;
+                cb->aio_lio_opcode = IOCB_CMD_PWRITE;
+                cb->aio_buf = reinterpret_cast<unsigned long long>(buf + ofs);
+                cb->aio_nbytes = std::min(AsyncChunkSize, len - ofs);
+                cb->aio_offset = pos + ofs;
+                batch.push_back(cb);
+            }
+            size_t b = 0;
+            while( b < batch.size() ) {
+                long n = syscall(SYS_io_submit, ctx, (long) (batch.size() - b), &batch[b]);
+                if( n <= 0 ) {
+                    if( n < 0 && errno == EINTR )
+                        continue;
+                    log() << "LogFile::_asyncAppend io_submit failed " << _name << ' '
+                          << errnoWithDescription() << std::endl;
+                    fassertFailed( 17320 );
+                }
+                b += n;
+            }
+            submitted += batch.size();
+
+            long got = syscall(SYS_io_getevents, ctx, 1L, (long) events.size(), &events[0], (struct timespec*) 0);
+            if( got < 0 ) {
+                if( errno == EINTR )
+                    continue;
+                log() << "LogFile::_asyncAppend io_getevents failed " << _name << ' '
+                      << errnoWithDescription() << std::endl;
+                fassertFailed( 17321 );
+            }
+            for( long i = 0; i < got; i++ ) {
+                struct iocb *cb = reinterpret_cast<struct iocb*>(events[i].obj);
+                if( events[i].res != (long long) cb->aio_nbytes ) {
+                    log() << "LogFile::_asyncAppend async write failed " << _name << " at "
+                          << cb->aio_offset << " wrote " << (long long) events[i].res << " of "
+                          << cb->aio_nbytes << " bytes" << std::endl;
+                    fassertFailed( 17322 );
+                }
+                idle.push_back(cb);
+                completed++;
+            }
+        }
+
+        lseek(_fd, pos + len, SEEK_SET);
+    }
+#else
+    void LogFile::useAsyncIO(unsigned queueDepth) { }
+#endif
+
     void LogFile::truncate() {
         verify(_fd >= 0);
 
@@ -244,6 +350,14 @@ namespace mongo {
         const off_t pos = lseek(_fd, 0, SEEK_CUR); // doesn't actually seek, just get current position
 #endif
 
+#if defined(__linux__)
+        // a single chunk gains nothing from going through the kernel's aio queue
+        if ( _aioContext && len >= 2 * AsyncChunkSize ) {
+            _asyncAppend( buf, len );
+            charsToWrite = 0;
+        }
+#endif
+
         while ( charsToWrite > 0 ) {
             const ssize_t written = write( _fd, buf, static_cast<size_t>( charsToWrite ) );
             if ( -1 == written ) {
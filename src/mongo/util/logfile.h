@@ -48,6 +48,12 @@ namespace mongo {
         */
         void synchronousAppend(const void *buf, size_t len);
 
+        /** have synchronousAppend() split big appends into chunks and keep up to 'queueDepth' of them
+            in flight at once.  linux with direct i/o only; a no-op elsewhere or if the kernel
+            doesn't support it.  not thread safe.
+        */
+        void useAsyncIO(unsigned queueDepth);
+
         /** write at specified offset. must be aligned.  noreturn until physically written. thread safe */
         void writeAt(unsigned long long offset, const void *_bug, size_t _len);
 
@@ -65,6 +71,11 @@ namespace mongo {
 #endif
         fd_type _fd;
         bool _direct; // are we using direct I/O
+#if defined(__linux__)
+        void _asyncAppend(const char *buf, size_t len);
+        unsigned long _aioContext; // aio_context_t, 0 if not using async i/o
+        unsigned _queueDepth;
+#endif
     };
 
 }
@@ -0,0 +1,65 @@
+/*
+ *    Copyright 2014 MongoDB Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/memory_usage.h"
+
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+namespace {
+    AtomicInt64 objectsHeld[MemoryUsage::kNumTags];
+    AtomicInt64 bytesHeld[MemoryUsage::kNumTags];
+}
+
+    void MemoryUsage::note(Tag tag, long long objects, long long bytes) {
+        if (objects)
+            objectsHeld[tag].fetchAndAdd(objects);
+        if (bytes)
+            bytesHeld[tag].fetchAndAdd(bytes);
+    }
+
+    long long MemoryUsage::objects(Tag tag) {
+        return objectsHeld[tag].load();
+    }
+
+    long long MemoryUsage::bytes(Tag tag) {
+        return bytesHeld[tag].load();
+    }
+
+    long long MemoryUsage::totalBytes() {
+        long long total = 0;
+        for (int i = 0; i < kNumTags; i++)
+            total += bytesHeld[i].load();
+        return total;
+    }
+
+    const char* MemoryUsage::tagName(Tag tag) {
+        switch (tag) {
+        case kPlanCache: return "planCache";
+        case kCursors: return "cursors";
+        case kSorter: return "sorter";
+        case kJsScopes: return "jsScopes";
+        case kConnectionBuffers: return "connectionBuffers";
+        case kAuthUserCache: return "authUserCache";
+        case kNumTags: break;
+        }
+        return "unknown";
+    }
+
+} // namespace mongo
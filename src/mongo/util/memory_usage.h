@@ -0,0 +1,87 @@
+/*
+ *    Copyright 2014 MongoDB Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include "mongo/base/disallow_copying.h"
+
+namespace mongo {
+
+    /**
+     * Process-wide accounting of the heap held by the subsystems whose memory use grows with the
+     * workload, so that it can be told apart in serverStatus from the allocator's totals.
+     *
+     * The figures are kept by the subsystems themselves, from the sizes of what they allocate
+     * (or an estimate of it), at the points where they allocate and free; they are not taken from
+     * the allocator.
+     */
+    class MemoryUsage {
+    public:
+        enum Tag {
+            kPlanCache,         // plan cache entries
+            kCursors,           // open client cursors
+            kSorter,            // in-memory sort buffers
+            kJsScopes,          // JavaScript scopes and their heaps
+            kConnectionBuffers, // message buffers the BufferPool keeps for reuse
+            kAuthUserCache,     // cached users and their privileges
+            kNumTags
+        };
+
+        /**
+         * Counts 'objects' more objects of 'tag', holding 'bytes' more between them.  Either may
+         * be negative.
+         */
+        static void note(Tag tag, long long objects, long long bytes);
+
+        static long long objects(Tag tag);
+        static long long bytes(Tag tag);
+        static long long totalBytes();
+
+        static const char* tagName(Tag tag);
+    };
+
+    /**
+     * Accounts for one object of a tag for as long as it lives, holding the last size given to
+     * set().
+     */
+    class MemoryUsageTracker {
+        MONGO_DISALLOW_COPYING(MemoryUsageTracker);
+    public:
+        explicit MemoryUsageTracker(MemoryUsage::Tag tag, long long bytes = 0)
+            : _tag(tag)
+            , _bytes(bytes) {
+            MemoryUsage::note(_tag, 1, _bytes);
+        }
+
+        ~MemoryUsageTracker() {
+            MemoryUsage::note(_tag, -1, -_bytes);
+        }
+
+        void set(long long bytes) {
+            if (bytes == _bytes)
+                return;
+            MemoryUsage::note(_tag, 0, bytes - _bytes);
+            _bytes = bytes;
+        }
+
+        long long bytes() const { return _bytes; }
+
+    private:
+        const MemoryUsage::Tag _tag;
+        long long _bytes;
+    };
+
+} // namespace mongo
@@ -0,0 +1,44 @@
+/*
+ *    Copyright 2014 MongoDB Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/util/memory_usage.h"
+
+namespace mongo {
+
+    class MemoryUsageServerStatus : public ServerStatusSection {
+    public:
+        MemoryUsageServerStatus() : ServerStatusSection("memoryUsage") {}
+        virtual bool includeByDefault() const { return true; }
+
+        BSONObj generateSection(const BSONElement& configElement) const {
+            BSONObjBuilder b;
+            b.appendNumber("totalBytes", MemoryUsage::totalBytes());
+            for (int i = 0; i < MemoryUsage::kNumTags; i++) {
+                const MemoryUsage::Tag tag = static_cast<MemoryUsage::Tag>(i);
+                BSONObjBuilder sub(b.subobjStart(MemoryUsage::tagName(tag)));
+                sub.appendNumber("objects", MemoryUsage::objects(tag));
+                sub.appendNumber("bytes", MemoryUsage::bytes(tag));
+                sub.done();
+            }
+            return b.obj();
+        }
+    } memoryUsageServerStatus;
+
+} // namespace mongo
@@ -0,0 +1,57 @@
+/*
+ *    Copyright 2014 MongoDB Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/memory_usage.h"
+
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using mongo::MemoryUsage;
+    using mongo::MemoryUsageTracker;
+
+    TEST(MemoryUsage, TrackerCountsObjectAndBytes) {
+        const long long objects = MemoryUsage::objects(MemoryUsage::kCursors);
+        const long long bytes = MemoryUsage::bytes(MemoryUsage::kCursors);
+        {
+            MemoryUsageTracker tracker(MemoryUsage::kCursors, 100);
+            ASSERT_EQUALS(objects + 1, MemoryUsage::objects(MemoryUsage::kCursors));
+            ASSERT_EQUALS(bytes + 100, MemoryUsage::bytes(MemoryUsage::kCursors));
+
+            tracker.set(250);
+            ASSERT_EQUALS(objects + 1, MemoryUsage::objects(MemoryUsage::kCursors));
+            ASSERT_EQUALS(bytes + 250, MemoryUsage::bytes(MemoryUsage::kCursors));
+
+            tracker.set(50);
+            ASSERT_EQUALS(bytes + 50, MemoryUsage::bytes(MemoryUsage::kCursors));
+        }
+        ASSERT_EQUALS(objects, MemoryUsage::objects(MemoryUsage::kCursors));
+        ASSERT_EQUALS(bytes, MemoryUsage::bytes(MemoryUsage::kCursors));
+    }
+
+    TEST(MemoryUsage, TagsAreSeparate) {
+        const long long sorter = MemoryUsage::bytes(MemoryUsage::kSorter);
+        const long long total = MemoryUsage::totalBytes();
+        MemoryUsage::note(MemoryUsage::kPlanCache, 1, 1000);
+        ASSERT_EQUALS(sorter, MemoryUsage::bytes(MemoryUsage::kSorter));
+        ASSERT_EQUALS(total + 1000, MemoryUsage::totalBytes());
+        MemoryUsage::note(MemoryUsage::kPlanCache, -1, -1000);
+        ASSERT_EQUALS(total, MemoryUsage::totalBytes());
+    }
+
+} // namespace
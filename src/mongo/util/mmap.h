@@ -38,6 +38,10 @@ namespace mongo {
         enum Advice { Sequential=1 , Random=2 };
         MAdvise(void *p, unsigned len, Advice a); 
         ~MAdvise(); // destructor resets the range to MADV_NORMAL
+
+        /** ask the os to start reading the range in now (MADV_WILLNEED).  only a hint, there
+            is nothing to reset afterwards. */
+        static void willNeed(const void *p, unsigned len);
     };
 
     // lock order: lock dbMutex before this if you lock both
@@ -228,6 +232,13 @@ namespace mongo {
 
         /** close the current private view and open a new replacement */
         void* remapPrivateView(void *oldPrivateAddr);
+
+#ifndef _WIN32
+        /** replace just [ofs, ofs+len) of the private view with fresh pages from the file.
+            ofs and len must be page aligned.
+        */
+        void remapPrivateViewRange(void *privateAddr, unsigned long long ofs, unsigned long long len);
+#endif
     };
 
     /** p is called from within a mutex that MongoFile uses.  so be careful not to deadlock. */
@@ -70,6 +70,7 @@ namespace mongo {
 #if defined(__sunos__)
     MAdvise::MAdvise(void *,unsigned, Advice) { }
     MAdvise::~MAdvise() { }
+    void MAdvise::willNeed(const void *, unsigned) { }
 #else
     MAdvise::MAdvise(void *p, unsigned len, Advice a) {
         
@@ -92,6 +93,13 @@ namespace mongo {
     MAdvise::~MAdvise() { 
         madvise(_p,_len,MADV_NORMAL);
     }
+    void MAdvise::willNeed(const void *p, unsigned len) {
+        void *start = (void*)((long)p & ~(g_minOSPageSizeBytes-1));
+        len += (unsigned long long)p-(unsigned long long)start;
+        if ( madvise(start,len,MADV_WILLNEED) ) {
+            LOG(1) << "madvise WILLNEED failed: " << errnoWithDescription() << endl;
+        }
+    }
 #endif
 
     void* MemoryMappedFile::map(const char *filename, unsigned long long &length, int options) {
@@ -195,6 +203,26 @@ namespace mongo {
         return x;
     }
 
+    void MemoryMappedFile::remapPrivateViewRange(void *privateAddr, unsigned long long ofs,
+                                                 unsigned long long rangeLen) {
+#if defined(__sunos__) // SERVER-8795
+        verify( Lock::isW() );
+        LockMongoFilesExclusive lockMongoFiles;
+#endif
+        verify( ofs + rangeLen <= len );
+        void *addr = (char*) privateAddr + ofs;
+        void *x = mmap( addr, rangeLen, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_NORESERVE|MAP_FIXED,
+                        fd, ofs );
+        if( x == MAP_FAILED ) {
+            int err = errno;
+            error()  << "17319 Couldn't remap private view range: " << errnoWithDescription(err) << endl;
+            log() << "aborting" << endl;
+            printMemInfo();
+            abort();
+        }
+        verify( x == addr );
+    }
+
     void MemoryMappedFile::flush(bool sync) {
         if ( views.empty() || fd == 0 )
             return;
@@ -66,8 +66,12 @@ namespace mongo {
 
         bool isLocalHost() const;
 
+        /** true if host() is the path of a unix domain socket, e.g. /tmp/mongodb-27017.sock */
+        bool isUnixSocket() const { return !_host.empty() && _host[0] == '/'; }
+
         /**
-         * @param includePort host:port if true, host otherwise
+         * @param includePort host:port if true, host otherwise.  A unix domain socket is its
+         *                    path either way.
          */
         string toString( bool includePort=true ) const;
 
@@ -136,6 +140,10 @@ namespace mongo {
     inline void HostAndPort::append( StringBuilder& ss ) const {
         ss << host();
 
+        // the port means nothing to a socket file, and would be taken for part of its name
+        if ( isUnixSocket() )
+            return;
+
         int p = port();
 
         if ( p != -1 ) {
@@ -161,7 +169,7 @@ namespace mongo {
                || mongoutils::str::startsWith(_host.c_str(), "127.")
                || _host == "::1"
                || _host == "anonymous unix socket"
-               || _host.c_str()[0] == '/' // unix socket
+               || isUnixSocket()
                );
     }
 
@@ -281,6 +281,8 @@ namespace mongo {
                 }
                 if (from.getType() != AF_UNIX)
                     disableNagle(s);
+                else
+                    globalUnixSocketConnectionNumber.addAndFetch(1);
 
 #ifdef SO_NOSIGPIPE
                 // ignore SIGPIPE signals on osx, to avoid process exit
@@ -565,4 +567,5 @@ namespace mongo {
 
     TicketHolder Listener::globalTicketHolder(DEFAULT_MAX_CONN);
     AtomicInt64 Listener::globalConnectionNumber;
+    AtomicInt64 Listener::globalUnixSocketConnectionNumber;
 }
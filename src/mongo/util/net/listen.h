@@ -97,6 +97,9 @@ namespace mongo {
         /** the "next" connection number.  every connection to this process has a unique number */
         static AtomicInt64 globalConnectionNumber;
 
+        /** how many of those came in over a unix domain socket */
+        static AtomicInt64 globalUnixSocketConnectionNumber;
+
         /** keeps track of how many allowed connections there are and how many are being used*/
         static TicketHolder globalTicketHolder;
 
@@ -17,9 +17,11 @@
 
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include "mongo/bson/util/atomic_int.h"
+#include "mongo/util/buffer_pool.h"
 #include "mongo/util/goodies.h"
 #include "mongo/util/net/hostandport.h"
 #include "mongo/util/net/sock.h"
@@ -46,7 +48,8 @@ namespace mongo {
         dbQuery = 2004,
         dbGetMore = 2005,
         dbDelete = 2006,
-        dbKillCursors = 2007
+        dbKillCursors = 2007,
+        dbCompressed = 2012 /* envelope for another message, see message_compression.h */
     };
 
     bool doesOpGetAResponse( int op );
@@ -62,6 +65,7 @@ namespace mongo {
         case dbGetMore: return "getmore";
         case dbDelete: return "remove";
         case dbKillCursors: return "killcursors";
+        case dbCompressed: return "compressed";
         default:
             massert( 16141, str::stream() << "cannot translate opcode " << op, !op );
             return "";
@@ -180,6 +184,18 @@ namespace mongo {
 
         bool empty() const { return !_buf && _data.empty(); }
 
+        /** @return the whole message in one block: its only buffer, or a copy in 'scratch' */
+        const char* contiguousData( std::string* scratch ) const {
+            if ( _buf ) {
+                return reinterpret_cast<const char*>( _buf );
+            }
+            scratch->clear();
+            for (MsgVec::const_iterator it = _data.begin(); it != _data.end(); ++it) {
+                scratch->append( it->first, it->second );
+            }
+            return scratch->data();
+        }
+
         int size() const {
             int res = 0;
             if ( _buf ) {
@@ -208,7 +224,8 @@ namespace mongo {
                  i != _data.end(); ++i) {
                 totalSize += i->second;
             }
-            char *buf = (char*)malloc( totalSize );
+            int capacity;
+            char *buf = BufferPool::allocate( totalSize, &capacity );
             char *p = buf;
             for (std::vector< std::pair< char *, int > >::const_iterator i = _data.begin();
                  i != _data.end(); ++i) {
@@ -236,11 +253,11 @@ namespace mongo {
         void reset() {
             if ( _freeIt ) {
                 if ( _buf ) {
-                    free( _buf );
+                    BufferPool::release( _buf, _buf->len );
                 }
                 for (std::vector< std::pair< char *, int > >::const_iterator i = _data.begin();
                      i != _data.end(); ++i) {
-                    free(i->first);
+                    BufferPool::release( i->first, i->second );
                 }
             }
             _buf = 0;
@@ -280,7 +297,8 @@ namespace mongo {
         void setData(int operation, const char *msgdata, size_t len) {
             verify( empty() );
             size_t dataLen = len + sizeof(MsgData) - 4;
-            MsgData *d = (MsgData *) malloc(dataLen);
+            int capacity;
+            MsgData *d = (MsgData *) BufferPool::allocate(dataLen, &capacity);
             memcpy(d->_data, msgdata, len);
             d->len = fixEndian(dataLen);
             d->setOperation(operation);
@@ -0,0 +1,76 @@
+// message_builder.cpp
+
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/net/message_builder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "mongo/util/buffer_pool.h"
+
+namespace mongo {
+
+    MessageBuilder::MessageBuilder(int headerSize, int initialSize) : _capacity(0), _len(0) {
+        newChunk(std::max(headerSize, initialSize));
+        memset(_chunks.back().first, 0, headerSize);
+        _chunks.back().second = headerSize;
+        _len = headerSize;
+    }
+
+    MessageBuilder::~MessageBuilder() {
+        for (size_t i = 0; i < _chunks.size(); i++) {
+            const int size = i + 1 == _chunks.size() ? _capacity : _chunks[i].second;
+            BufferPool::release(_chunks[i].first, size);
+        }
+    }
+
+    void MessageBuilder::newChunk(int size) {
+        int capacity;
+        char* buf = BufferPool::allocate(size, &capacity);
+        _chunks.push_back(std::make_pair(buf, 0));
+        _capacity = capacity;
+    }
+
+    void MessageBuilder::appendBuf(const void* src, int len) {
+        const char* p = static_cast<const char*>(src);
+        while (len > 0) {
+            std::pair<char*, int>& chunk = _chunks.back();
+            int n = std::min(len, _capacity - chunk.second);
+            if (n == 0) {
+                newChunk(std::min(_capacity * 2, static_cast<int>(BufferPool::kMaxBufferSize)));
+                continue;
+            }
+            memcpy(chunk.first + chunk.second, p, n);
+            chunk.second += n;
+            _len += n;
+            p += n;
+            len -= n;
+        }
+    }
+
+    void MessageBuilder::transferTo(Message& m) {
+        verify(m.empty());
+        header()->len = _len;
+        // a chunk is only started for data that follows, so none is empty
+        for (size_t i = 0; i < _chunks.size(); i++)
+            m.appendData(_chunks[i].first, _chunks[i].second);
+        _chunks.clear();
+    }
+
+} // namespace mongo
@@ -0,0 +1,67 @@
+// message_builder.h
+
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "mongo/util/net/message.h"
+
+namespace mongo {
+
+    /**
+     * Builds a message in a list of BufferPool chunks instead of one contiguous buffer, and
+     * hands the chunks to a Message, which sends them with a single scatter/gather write.
+     *
+     * A growing BufBuilder copies everything appended so far each time it reallocates, so a
+     * 4MB reply batch was copied about twice over before reaching the socket; here each
+     * document is copied exactly once.  Chunks grow from 'initialSize' up to
+     * BufferPool::kMaxBufferSize and documents may span chunks, so nothing is wasted.
+     */
+    class MessageBuilder : boost::noncopyable {
+    public:
+        /**
+         * Reserves 'headerSize' zeroed bytes at the start of the message, to be filled in
+         * through header() once the body is built.
+         */
+        MessageBuilder(int headerSize, int initialSize);
+
+        /** releases the chunks unless they were handed to a Message */
+        ~MessageBuilder();
+
+        MsgData* header() const { return reinterpret_cast<MsgData*>(_chunks.front().first); }
+
+        void appendBuf(const void* src, int len);
+
+        /** bytes in the message, header included */
+        int len() const { return _len; }
+
+        /** Sets header()->len and hands the chunks to 'm', which must be empty. */
+        void transferTo(Message& m);
+
+    private:
+        void newChunk(int size);
+
+        std::vector<std::pair<char*, int> > _chunks;    // buffer, bytes used
+        int _capacity;                                  // of the last chunk
+        int _len;
+    };
+
+} // namespace mongo
@@ -0,0 +1,84 @@
+/* Copyright 2014 10gen Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_builder.h"
+
+#include <string>
+
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/buffer_pool.h"
+
+namespace {
+
+    using mongo::BufferPool;
+    using mongo::Message;
+    using mongo::MessageBuilder;
+    using mongo::MsgData;
+
+    // the message's body, read back across its buffers
+    std::string body(Message& m) {
+        m.concat();
+        MsgData* md = m.singleData();
+        return std::string(md->_data, md->dataLen());
+    }
+
+    TEST(MessageBuilder, FitsInFirstChunk) {
+        MessageBuilder b(sizeof(MsgData) - 4, 4096);
+        b.appendBuf("abc", 3);
+        ASSERT_EQUALS(static_cast<int>(sizeof(MsgData) - 4 + 3), b.len());
+
+        Message m;
+        b.transferTo(m);
+        ASSERT_EQUALS(b.len(), m.header()->len);
+        ASSERT_EQUALS("abc", body(m));
+    }
+
+    TEST(MessageBuilder, SpansChunks) {
+        std::string expected;
+        MessageBuilder b(sizeof(MsgData) - 4, 4096);
+        for (int i = 0; i < 1000; i++) {
+            std::string doc(1 + i % 777, 'a' + i % 26);
+            b.appendBuf(doc.data(), doc.size());
+            expected += doc;
+        }
+
+        Message m;
+        b.transferTo(m);
+        ASSERT_EQUALS(static_cast<int>(sizeof(MsgData) - 4 + expected.size()), m.header()->len);
+        ASSERT_EQUALS(m.header()->len, m.size());
+        ASSERT_EQUALS(expected, body(m));
+    }
+
+    TEST(MessageBuilder, LargerThanMaxChunk) {
+        std::string big(3 * BufferPool::kMaxBufferSize + 5, 'x');
+        MessageBuilder b(sizeof(MsgData) - 4, 4096);
+        b.appendBuf(big.data(), big.size());
+
+        Message m;
+        b.transferTo(m);
+        ASSERT_EQUALS(big, body(m));
+    }
+
+    TEST(MessageBuilder, ReleasesChunksWhenNotTransferred) {
+        MessageBuilder b(sizeof(MsgData) - 4, 4096);
+        std::string doc(100000, 'y');
+        b.appendBuf(doc.data(), doc.size());
+    }
+
+} // namespace
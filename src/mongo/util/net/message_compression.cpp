@@ -0,0 +1,170 @@
+// message_compression.cpp
+
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/net/message_compression.h"
+
+#include <string>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/util/buffer_pool.h"
+#include "mongo/util/compress.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+
+namespace mongo {
+
+    bool messageCompressionEnabled = false;
+
+    MessageCompressionCounters messageCompressionCounters;
+
+    namespace {
+
+#pragma pack(1)
+        struct CompressedHeader {
+            int originalOpcode;
+            int uncompressedSize;
+            unsigned char compressorId;
+        };
+#pragma pack()
+
+        const int kEnvelopeHeaderSize = sizeof(MSGHEADER) + sizeof(CompressedHeader);
+
+        const char kSnappyName[] = "snappy";
+
+    } // namespace
+
+    bool compressMessage(MessageCompressor compressor, const Message& m, Message* out) {
+        verify(compressor == kSnappyCompressor);
+        verify(out->empty());
+
+        const int size = m.size();
+        if (size < kMinCompressibleMessageSize)
+            return false;
+
+        std::string scratch;
+        const MsgData* original = reinterpret_cast<const MsgData*>(m.contiguousData(&scratch));
+        const char* body = reinterpret_cast<const char*>(original) + sizeof(MSGHEADER);
+        const size_t bodyLen = size - sizeof(MSGHEADER);
+
+        int capacity;
+        char* buf = BufferPool::allocate(kEnvelopeHeaderSize + maxCompressedLength(bodyLen),
+                                         &capacity);
+        size_t compressedLen;
+        rawCompress(body, bodyLen, buf + kEnvelopeHeaderSize, &compressedLen);
+
+        const int len = kEnvelopeHeaderSize + compressedLen;
+        if (len >= size) {
+            BufferPool::release(buf, capacity);
+            return false;
+        }
+
+        MsgData* md = reinterpret_cast<MsgData*>(buf);
+        md->len = len;
+        md->id = original->id;
+        md->responseTo = original->responseTo;
+        md->setOperation(dbCompressed);
+
+        CompressedHeader* ch = reinterpret_cast<CompressedHeader*>(buf + sizeof(MSGHEADER));
+        ch->originalOpcode = original->operation();
+        ch->uncompressedSize = bodyLen;
+        ch->compressorId = compressor;
+
+        out->setData(md, true);
+        return true;
+    }
+
+    bool decompressMessage(const Message& m, Message* out) {
+        verify(out->empty());
+
+        const MsgData* envelope = m.header();
+        verify(envelope->operation() == dbCompressed);
+        if (envelope->len < kEnvelopeHeaderSize)
+            return false;
+
+        std::string scratch;
+        const char* data = m.contiguousData(&scratch);
+        const CompressedHeader* ch =
+            reinterpret_cast<const CompressedHeader*>(data + sizeof(MSGHEADER));
+        if (ch->compressorId != kSnappyCompressor || ch->uncompressedSize < 0 ||
+                ch->uncompressedSize > MaxMessageSizeBytes - static_cast<int>(sizeof(MSGHEADER)))
+            return false;
+
+        const char* compressed = data + kEnvelopeHeaderSize;
+        const size_t compressedLen = envelope->len - kEnvelopeHeaderSize;
+        size_t uncompressedLen;
+        if (!uncompressedLength(compressed, compressedLen, &uncompressedLen) ||
+                uncompressedLen != static_cast<size_t>(ch->uncompressedSize))
+            return false;
+
+        const int len = sizeof(MSGHEADER) + uncompressedLen;
+        int capacity;
+        char* buf = BufferPool::allocate(len, &capacity);
+        if (!rawUncompress(compressed, compressedLen, buf + sizeof(MSGHEADER))) {
+            BufferPool::release(buf, capacity);
+            return false;
+        }
+
+        MsgData* md = reinterpret_cast<MsgData*>(buf);
+        md->len = len;
+        md->id = envelope->id;
+        md->responseTo = envelope->responseTo;
+        md->setOperation(ch->originalOpcode);
+
+        out->setData(md, true);
+        return true;
+    }
+
+    void appendCompressionOffer(BSONObjBuilder* isMasterCmd) {
+        BSONArrayBuilder offer(isMasterCmd->subarrayStart("compression"));
+        offer.append(kSnappyName);
+        offer.done();
+    }
+
+    MessageCompressor compressorFromReply(const BSONObj& isMasterReply) {
+        BSONElement e = isMasterReply["compression"];
+        if (e.type() != Array)
+            return kNoCompressor;
+
+        BSONForEach(name, e.Obj()) {
+            if (name.type() == String && name.String() == kSnappyName)
+                return kSnappyCompressor;
+        }
+        return kNoCompressor;
+    }
+
+    void negotiateCompression(const BSONObj& isMasterCmd,
+                              AbstractMessagingPort* port,
+                              BSONObjBuilder* result) {
+        if (!port || !isMasterCmd.hasField("compression"))
+            return;
+
+        // the offer has the same shape as the answer
+        MessageCompressor compressor = kNoCompressor;
+        if (messageCompressionEnabled)
+            compressor = compressorFromReply(isMasterCmd);
+
+        if (compressor == kSnappyCompressor) {
+            BSONArrayBuilder answer(result->subarrayStart("compression"));
+            answer.append(kSnappyName);
+            answer.done();
+        }
+        port->setCompressor(compressor);
+    }
+
+} // namespace mongo
@@ -0,0 +1,94 @@
+// message_compression.h
+
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include "mongo/base/counter.h"
+
+namespace mongo {
+
+    class AbstractMessagingPort;
+    class BSONObj;
+    class BSONObjBuilder;
+    class Message;
+
+    /**
+     * Wire protocol compression.  A compressed message is a dbCompressed message whose body is
+     *
+     *     int32 originalOpcode
+     *     int32 uncompressedSize     // of the original body, header excluded
+     *     uint8 compressorId         // a MessageCompressor
+     *     compressed original body
+     *
+     * with the original message's id and responseTo.  A client offers the compressors it has in
+     * isMaster's "compression" array and the server answers with the one it picked, after which
+     * either side may compress what it sends; MessagingPort::say() and recv() do the work, so
+     * everything above them only ever sees plain messages.
+     */
+    enum MessageCompressor {
+        kNoCompressor = 0,
+        kSnappyCompressor = 1
+    };
+
+    /**
+     * Whether this process offers compression on the connections it opens and accepts it on the
+     * ones it serves.  The netCompression server parameter.
+     */
+    extern bool messageCompressionEnabled;
+
+    /** smaller messages are sent as they are */
+    const int kMinCompressibleMessageSize = 512;
+
+    /**
+     * Compresses the whole message 'm' into an envelope in 'out', which must be empty.
+     * @return false, leaving 'out' empty, if 'm' is too small or doesn't shrink.
+     */
+    bool compressMessage(MessageCompressor compressor, const Message& m, Message* out);
+
+    /**
+     * Unpacks the dbCompressed message 'm' into 'out', which must be empty.
+     * @return false, leaving 'out' empty, if the envelope or its contents are malformed.
+     */
+    bool decompressMessage(const Message& m, Message* out);
+
+    /** client side: adds the compressors we have to an isMaster command */
+    void appendCompressionOffer(BSONObjBuilder* isMasterCmd);
+
+    /** client side: the compressor the server picked in its isMaster reply */
+    MessageCompressor compressorFromReply(const BSONObj& isMasterReply);
+
+    /**
+     * server side: picks a compressor from the client's isMaster offer for 'port' to use, and
+     * adds it to the reply.  An isMaster without an offer (e.g. a replica set monitor's) leaves
+     * the port as it is; 'port' may be NULL for a direct client.
+     */
+    void negotiateCompression(const BSONObj& isMasterCmd,
+                              AbstractMessagingPort* port,
+                              BSONObjBuilder* result);
+
+    /** bytes sent and received in compressed messages, on the wire and uncompressed */
+    struct MessageCompressionCounters {
+        Counter64 wireIn;
+        Counter64 uncompressedIn;
+        Counter64 wireOut;
+        Counter64 uncompressedOut;
+    };
+
+    /** all connections' counters, reported in serverStatus' network section */
+    extern MessageCompressionCounters messageCompressionCounters;
+
+} // namespace mongo
@@ -0,0 +1,132 @@
+/* Copyright 2014 10gen Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_compression.h"
+
+#include <cstring>
+#include <string>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+
+namespace {
+
+    using namespace mongo;
+
+    void makeMessage(const std::string& body, Message* m) {
+        m->setData(dbQuery, body.data(), body.size());
+        m->header()->id = 17;
+        m->header()->responseTo = 4;
+    }
+
+    std::string repetitive(int size) {
+        std::string s;
+        while (static_cast<int>(s.size()) < size)
+            s += "{ some: 'compressible', document: 1234 } ";
+        s.resize(size);
+        return s;
+    }
+
+    TEST(MessageCompression, RoundTrip) {
+        const std::string body = repetitive(100000);
+        Message m;
+        makeMessage(body, &m);
+
+        Message compressed;
+        ASSERT_TRUE(compressMessage(kSnappyCompressor, m, &compressed));
+        ASSERT_EQUALS(dbCompressed, compressed.operation());
+        ASSERT_LESS_THAN(compressed.size(), m.size());
+        ASSERT_EQUALS(17U, compressed.header()->id);
+        ASSERT_EQUALS(4U, compressed.header()->responseTo);
+
+        Message uncompressed;
+        ASSERT_TRUE(decompressMessage(compressed, &uncompressed));
+        ASSERT_EQUALS(dbQuery, uncompressed.operation());
+        ASSERT_EQUALS(m.size(), uncompressed.size());
+        ASSERT_EQUALS(17U, uncompressed.header()->id);
+        ASSERT_EQUALS(4U, uncompressed.header()->responseTo);
+        ASSERT_EQUALS(0, memcmp(m.header(), uncompressed.header(), m.size()));
+    }
+
+    TEST(MessageCompression, SmallMessageIsSentAsIs) {
+        Message m;
+        makeMessage(repetitive(100), &m);
+        Message compressed;
+        ASSERT_FALSE(compressMessage(kSnappyCompressor, m, &compressed));
+        ASSERT_TRUE(compressed.empty());
+    }
+
+    TEST(MessageCompression, IncompressibleMessageIsSentAsIs) {
+        std::string body(4096, 0);
+        unsigned x = 12345;
+        for (size_t i = 0; i < body.size(); i++) {
+            x = x * 1103515245 + 12345;
+            body[i] = static_cast<char>(x >> 16);
+        }
+        Message m;
+        makeMessage(body, &m);
+        Message compressed;
+        ASSERT_FALSE(compressMessage(kSnappyCompressor, m, &compressed));
+        ASSERT_TRUE(compressed.empty());
+    }
+
+    TEST(MessageCompression, RejectsCorruptEnvelope) {
+        Message m;
+        makeMessage(repetitive(10000), &m);
+        Message compressed;
+        ASSERT_TRUE(compressMessage(kSnappyCompressor, m, &compressed));
+
+        // claims a different uncompressed size
+        char* envelope = reinterpret_cast<char*>(compressed.header());
+        int* uncompressedSize = reinterpret_cast<int*>(envelope + sizeof(MSGHEADER) + 4);
+        *uncompressedSize += 1;
+
+        Message uncompressed;
+        ASSERT_FALSE(decompressMessage(compressed, &uncompressed));
+        ASSERT_TRUE(uncompressed.empty());
+    }
+
+    TEST(MessageCompression, Negotiation) {
+        BSONObjBuilder cmd;
+        cmd.append("isMaster", 1);
+        appendCompressionOffer(&cmd);
+        const BSONObj offer = cmd.obj();
+
+        MessagingPort port;
+        messageCompressionEnabled = true;
+        BSONObjBuilder reply;
+        negotiateCompression(offer, &port, &reply);
+        ASSERT_EQUALS(kSnappyCompressor, port.getCompressor());
+        ASSERT_EQUALS(kSnappyCompressor, compressorFromReply(reply.obj()));
+
+        // a monitor's isMaster leaves it alone
+        BSONObjBuilder monitorReply;
+        negotiateCompression(BSON("isMaster" << 1), &port, &monitorReply);
+        ASSERT_EQUALS(kSnappyCompressor, port.getCompressor());
+        ASSERT_EQUALS(kNoCompressor, compressorFromReply(monitorReply.obj()));
+
+        messageCompressionEnabled = false;
+        BSONObjBuilder disabledReply;
+        negotiateCompression(offer, &port, &disabledReply);
+        ASSERT_EQUALS(kNoCompressor, port.getCompressor());
+        ASSERT_EQUALS(kNoCompressor, compressorFromReply(disabledReply.obj()));
+    }
+
+} // namespace
@@ -19,10 +19,17 @@
 
 #include "mongo/util/net/message_port.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
 #include <fcntl.h>
 #include <time.h>
 
 #include "mongo/util/background.h"
+#include "mongo/util/buffer_pool.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/thread_name.h"
 #include "mongo/util/goodies.h"
 #include "mongo/util/net/listen.h"
 #include "mongo/util/net/message.h"
@@ -93,6 +100,112 @@ namespace mongo {
         char * _cur;
     };
 
+    bool pipelinedReplies = true;
+
+    /**
+     * Sends a connection's pipelined replies on a thread of its own, in the order they were
+     * queued.  Started by the first reply that is left to it and stopped with the port.
+     */
+    class MessagingPort::ReplyWriter : boost::noncopyable {
+    public:
+        explicit ReplyWriter( MessagingPort* port )
+            : _port( port ),
+              _mutex( "ReplyWriter" ),
+              _pending( 0 ),
+              _failed( false ),
+              _stop( false ),
+              _thread( boost::bind( &ReplyWriter::run, this ) ) {
+        }
+
+        /** the port's socket must already be shut down, so a blocked send returns */
+        ~ReplyWriter() {
+            {
+                scoped_lock lk( _mutex );
+                _stop = true;
+                _cond.notify_all();
+            }
+            _thread.join();
+            for ( std::deque<Queued>::iterator i = _queue.begin(); i != _queue.end(); ++i )
+                delete i->first;
+        }
+
+        /** true while replies are queued or being sent */
+        bool busy() {
+            scoped_lock lk( _mutex );
+            return _pending > 0;
+        }
+
+        /** takes 'response's data */
+        void queue( Message& response, int responseTo ) {
+            Message* m = new Message();
+            *m = response;
+            scoped_lock lk( _mutex );
+            if ( _failed ) {
+                delete m;
+                throw SocketException( SocketException::SEND_ERROR, _port->psock->remoteString() );
+            }
+            _queue.push_back( Queued( m, responseTo ) );
+            _pending++;
+            _cond.notify_all();
+        }
+
+        void waitUntilIdle() {
+            scoped_lock lk( _mutex );
+            while ( _pending > 0 )
+                _cond.wait( lk.boost() );
+            if ( _failed )
+                throw SocketException( SocketException::SEND_ERROR, _port->psock->remoteString() );
+        }
+
+    private:
+        typedef std::pair<Message*, int> Queued;
+
+        void run() {
+            setThreadName( "replyWriter" );
+            while ( true ) {
+                Queued next;
+                bool failed;
+                {
+                    scoped_lock lk( _mutex );
+                    while ( _queue.empty() && !_stop )
+                        _cond.wait( lk.boost() );
+                    if ( _stop )
+                        return;
+                    next = _queue.front();
+                    _queue.pop_front();
+                    failed = _failed;
+                }
+
+                // once a reply is lost the rest are dropped; the client can't make sense of them
+                if ( !failed ) {
+                    try {
+                        _port->say( *next.first, next.second );
+                    }
+                    catch ( const std::exception& e ) {
+                        LOG(1) << "couldn't send a pipelined reply to "
+                               << _port->psock->remoteString() << causedBy( e ) << endl;
+                        failed = true;
+                    }
+                }
+                delete next.first;
+
+                scoped_lock lk( _mutex );
+                _failed = _failed || failed;
+                _pending--;
+                _cond.notify_all();
+            }
+        }
+
+        MessagingPort* const _port;
+        mongo::mutex _mutex;
+        boost::condition _cond;
+        std::deque<Queued> _queue;
+        int _pending;           // queued plus the one being sent
+        bool _failed;
+        bool _stop;
+        boost::thread _thread;  // last, so it starts once the rest is set up
+    };
+
     class Ports {
         set<MessagingPort*> ports;
         mongo::mutex m;
@@ -149,12 +262,34 @@ namespace mongo {
     }
 
     MessagingPort::~MessagingPort() {
+        if ( _compressionStats.wireIn || _compressionStats.wireOut ) {
+            LOG(1) << "compressed messages with " << psock->remoteString()
+                   << ": received " << _compressionStats.wireIn << " bytes for "
+                   << _compressionStats.uncompressedIn << ", sent " << _compressionStats.wireOut
+                   << " bytes for " << _compressionStats.uncompressedOut << endl;
+        }
         if ( piggyBackData )
             delete( piggyBackData );
         shutdown();
+        _replyWriter.reset();
         ports.erase(this);
     }
     
+    namespace {
+
+        /** adds the micros until it goes out of scope to 'total' */
+        class ElapsedMicros : boost::noncopyable {
+        public:
+            explicit ElapsedMicros( long long* total )
+                : _total( total ), _start( curTimeMicros64() ) {}
+            ~ElapsedMicros() { *_total += curTimeMicros64() - _start; }
+        private:
+            long long* _total;
+            unsigned long long _start;
+        };
+
+    } // namespace
+
     bool MessagingPort::recv(Message& m) {
         try {
 again:
@@ -209,11 +344,10 @@ again:
             }
 
             psock->setHandshakeReceived();
-            int z = (len+1023)&0xfffffc00;
-            verify(z>=len);
-            MsgData *md = (MsgData *) malloc(z);
-            ScopeGuard guard = MakeGuard(free, md);
-            verify(md);
+            const unsigned long long start = curTimeMicros64();
+            int capacity;
+            MsgData *md = (MsgData *) BufferPool::allocate(len, &capacity);
+            ScopeGuard guard = MakeGuard(BufferPool::release, md, capacity);
 
             memcpy(md, &header, headerLen);
             int left = len - headerLen;
@@ -222,6 +356,23 @@ again:
 
             guard.Dismiss();
             m.setData(md, true);
+
+            if ( md->operation() == dbCompressed ) {
+                Message uncompressed;
+                if ( ! decompressMessage( m, &uncompressed ) ) {
+                    LOG(0) << "recv(): invalid compressed message from " << remote() << endl;
+                    m.reset();
+                    return false;
+                }
+                _compressionStats.wireIn += len;
+                _compressionStats.uncompressedIn += uncompressed.size();
+                messageCompressionCounters.wireIn.increment( len );
+                messageCompressionCounters.uncompressedIn.increment( uncompressed.size() );
+                m.reset();
+                m = uncompressed;
+            }
+            _lastRecvMicros = curTimeMicros64() - start;
+            _lastReplyMicros = 0;
             return true;
 
         }
@@ -236,13 +387,46 @@ again:
     }
 
     void MessagingPort::reply(Message& received, Message& response) {
+        ElapsedMicros elapsed( &_lastReplyMicros );
+        waitForPipelinedReplies();
         say(/*received.from, */response, received.header()->id);
     }
 
     void MessagingPort::reply(Message& received, Message& response, MSGID responseTo) {
+        ElapsedMicros elapsed( &_lastReplyMicros );
+        waitForPipelinedReplies();
         say(/*received.from, */response, responseTo);
     }
 
+    void MessagingPort::replyPipelined(Message& received, Message& response, MSGID responseTo) {
+        ElapsedMicros elapsed( &_lastReplyMicros );
+        if ( _replyWriter ) {
+            if ( _replyWriter->busy() ) {
+                // behind replies that haven't gone yet
+                _replyWriter->queue( response, responseTo );
+                return;
+            }
+            _replyWriter->waitUntilIdle(); // throws if an earlier reply was lost
+        }
+
+        // OpenSSL can't read and write one connection from two threads, and with nothing
+        // pipelined there's nothing to overlap the send with
+        if ( !pipelinedReplies || !response.doIFreeIt() || psock->isSecure() ||
+             psock->bytesAvailable() == 0 ) {
+            say( response, responseTo );
+            return;
+        }
+
+        if ( !_replyWriter )
+            _replyWriter.reset( new ReplyWriter( this ) );
+        _replyWriter->queue( response, responseTo );
+    }
+
+    void MessagingPort::waitForPipelinedReplies() {
+        if ( _replyWriter )
+            _replyWriter->waitUntilIdle();
+    }
+
     bool MessagingPort::call(Message& toSend, Message& response) {
         mmm( log() << "*call()" << endl; )
         say(toSend);
@@ -279,20 +463,30 @@ again:
         toSend.header()->id = nextMessageId();
         toSend.header()->responseTo = responseTo;
 
+        Message compressed;
+        if ( getCompressor() != kNoCompressor &&
+             compressMessage( getCompressor(), toSend, &compressed ) ) {
+            _compressionStats.wireOut += compressed.size();
+            _compressionStats.uncompressedOut += toSend.size();
+            messageCompressionCounters.wireOut.increment( compressed.size() );
+            messageCompressionCounters.uncompressedOut.increment( toSend.size() );
+        }
+        Message& out = compressed.empty() ? toSend : compressed;
+
         if ( piggyBackData && piggyBackData->len() ) {
             mmm( log() << "*     have piggy back" << endl; )
-            if ( ( piggyBackData->len() + toSend.header()->len ) > 1300 ) {
+            if ( ( piggyBackData->len() + out.header()->len ) > 1300 ) {
                 // won't fit in a packet - so just send it off
                 piggyBackData->flush();
             }
             else {
-                piggyBackData->append( toSend );
+                piggyBackData->append( out );
                 piggyBackData->flush();
                 return;
             }
         }
 
-        toSend.send( *this, "say" );
+        out.send( *this, "say" );
     }
 
     void MessagingPort::piggyBack( Message& toSend , int responseTo ) {
@@ -19,7 +19,10 @@
 
 #include <vector>
 
+#include <boost/scoped_ptr.hpp>
+
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/net/sock.h"
 
 namespace mongo {
@@ -29,13 +32,30 @@ namespace mongo {
 
     typedef AtomicUInt MSGID;
 
+    /**
+     * Whether a server connection may send a reply in the background while it reads and runs
+     * the client's next, already pipelined, request.  The pipelinedReplies server parameter.
+     */
+    extern bool pipelinedReplies;
+
     class AbstractMessagingPort : boost::noncopyable {
     public:
-        AbstractMessagingPort() : tag(0), _connectionId(0) {}
+        AbstractMessagingPort() : tag(0), _lastRecvMicros(0), _lastReplyMicros(0),
+                                  _connectionId(0), _compressor(kNoCompressor) {}
         virtual ~AbstractMessagingPort() { }
         virtual void reply(Message& received, Message& response, MSGID responseTo) = 0; // like the reply below, but doesn't rely on received.data still being available
         virtual void reply(Message& received, Message& response) = 0;
 
+        /**
+         * Like reply(), for a server answering a connection's requests in turn.  If the client
+         * has already sent its next request the reply may be left to a background writer while
+         * that request runs; replies still go out in the order they were made.  That takes
+         * 'response's data, so 'response' must own it and mustn't be looked at afterwards.
+         */
+        virtual void replyPipelined(Message& received, Message& response, MSGID responseTo) {
+            reply(received, response, responseTo);
+        }
+
         virtual HostAndPort remote() const = 0;
         virtual unsigned remotePort() const = 0;
         virtual SockAddr remoteAddr() const = 0;
@@ -52,15 +72,36 @@ namespace mongo {
         long long connectionId() const { return _connectionId; }
         void setConnectionId( long long connectionId );
 
+        /** what say() compresses messages with, once negotiated; see message_compression.h */
+        MessageCompressor getCompressor() const { return _compressor; }
+        void setCompressor( MessageCompressor compressor ) { _compressor = compressor; }
+
+        /**
+         * Micros the last request took to arrive once its header had, decompression included;
+         * the wait for the header itself is the client's think time and isn't counted.
+         */
+        long long lastRecvMicros() const { return _lastRecvMicros; }
+
+        /**
+         * Micros spent in reply() and replyPipelined() since the last request arrived.  A
+         * pipelined reply left to the background writer only counts the handoff.
+         */
+        long long lastReplyMicros() const { return _lastReplyMicros; }
+
     public:
         // TODO make this private with some helpers
 
         /* ports can be tagged with various classes.  see closeAllSockets(tag). defaults to 0. */
         unsigned tag;
 
+    protected:
+        long long _lastRecvMicros;
+        long long _lastReplyMicros;
+
     private:
         long long _connectionId;
         std::string _x509SubjectName;
+        MessageCompressor _compressor;
     };
 
     class MessagingPort : public AbstractMessagingPort {
@@ -87,6 +128,7 @@ namespace mongo {
         bool recv(Message& m);
         void reply(Message& received, Message& response, MSGID responseTo);
         void reply(Message& received, Message& response);
+        void replyPipelined(Message& received, Message& response, MSGID responseTo);
         bool call(Message& toSend, Message& response);
 
         void say(Message& toSend, int responseTo = 0);
@@ -141,7 +183,26 @@ namespace mongo {
             return psock->getSockCreationMicroSec();
         }
 
+        /** this connection's share of messageCompressionCounters */
+        struct CompressionStats {
+            CompressionStats() : wireIn(0), uncompressedIn(0), wireOut(0), uncompressedOut(0) {}
+            long long wireIn;
+            long long uncompressedIn;
+            long long wireOut;
+            long long uncompressedOut;
+        };
+        const CompressionStats& compressionStats() const { return _compressionStats; }
+
     private:
+        class ReplyWriter;
+
+        /** waits for replies left to the writer; throws SocketException if one couldn't go */
+        void waitForPipelinedReplies();
+
+        CompressionStats _compressionStats;
+
+        // started by the first replyPipelined() that doesn't send inline
+        boost::scoped_ptr<ReplyWriter> _replyWriter;
         
         PiggyBackData * piggyBackData;
 
@@ -47,6 +47,22 @@ namespace mongo {
          * called once when a socket is disconnected
          */
         virtual void disconnected( AbstractMessagingPort* p ) = 0;
+
+        /**
+         * Whether connections may be served by a pool of worker threads, where each message can
+         * run on a different thread.  The pool calls detach() after connected() and after each
+         * process(), and attach() with what it returned before the next process() or
+         * disconnected().  Otherwise each connection gets a thread of its own.
+         */
+        virtual bool supportsWorkerPool() const { return false; }
+
+        /**
+         * takes the connection's per-thread state off the calling thread
+         * @param closing true after disconnected(): free the state instead of returning it
+         */
+        virtual void* detach( AbstractMessagingPort* p , bool closing ) { return 0; }
+
+        virtual void attach( AbstractMessagingPort* p , void* state ) { }
     };
 
     class MessageServer {
@@ -64,6 +80,9 @@ namespace mongo {
         virtual void setupSockets() = 0;
     };
 
-    // TODO use a factory here to decide between port and asio variations
+    /**
+     * Creates a server with a thread per connection or, when netWorkerThreads is set and the
+     * handler supports it, one that serves every connection from that many worker threads.
+     */
     MessageServer * createServer( const MessageServer::Options& opts , MessageHandler * handler );
 }
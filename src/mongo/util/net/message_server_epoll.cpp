@@ -0,0 +1,332 @@
+// message_server_epoll.cpp
+
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include <boost/thread/thread.hpp>
+
+#include "mongo/db/lasterror.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/net/listen.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/message_server.h"
+#include "mongo/util/numa.h"
+
+namespace mongo {
+
+    /**
+     * Serves every connection from a fixed pool of worker threads.  One thread waits in epoll
+     * for connections that have a whole message buffered and hands them to a worker, which
+     * reads and processes their messages until they have none left, then detaches the
+     * connection's state (see MessageHandler::supportsWorkerPool()) and goes back to the pool.
+     * Idle connections cost a socket and a few hundred bytes instead of a thread.
+     *
+     * A request that waits for another connection (w:2 getLastError, awaitData getMores...)
+     * holds its worker meanwhile, so the pool must be sized for those.
+     */
+    class EpollMessageServer : public MessageServer , public Listener {
+    public:
+        EpollMessageServer( const MessageServer::Options& opts,
+                            MessageHandler* handler,
+                            int nWorkers ) :
+            Listener( "" , opts.ipList, opts.port ),
+            _handler( handler ),
+            _epfd( -1 ),
+            _workers( nWorkers ),
+            _closedMutex( "EpollMessageServer::closed" ) {
+        }
+
+        virtual void acceptedMP( MessagingPort* p ) {
+            if ( ! Listener::globalTicketHolder.tryAcquire() ) {
+                log() << "connection refused because too many open connections: "
+                      << Listener::globalTicketHolder.used() << endl;
+                p->shutdown();
+                delete p;
+                sleepmillis(2); // otherwise we'll hard loop
+                return;
+            }
+
+            p->psock->setLogLevel(logger::LogSeverity::Debug(1));
+            Connection* c = new Connection( p );
+
+            // Edge triggered: we hear about each arrival of data, and look at the connection
+            // again only once there could be a whole message.
+            struct epoll_event event;
+            memset( &event, 0, sizeof(event) );
+            event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+            event.data.ptr = c;
+            if ( c->pollFd < 0 || epoll_ctl( _epfd, EPOLL_CTL_ADD, c->pollFd, &event ) != 0 ) {
+                log() << "can't poll new connection, closing it: " << errnoWithDescription()
+                      << endl;
+                p->shutdown();
+                delete c;
+                Listener::globalTicketHolder.release();
+                return;
+            }
+
+            // busy from the start, so connected() runs before anything else
+            _workers.schedule( &EpollMessageServer::serve, this, c );
+        }
+
+        virtual void setAsTimeTracker() {
+            Listener::setAsTimeTracker();
+        }
+
+        virtual void setupSockets() {
+            Listener::setupSockets();
+        }
+
+        void run() {
+            _epfd = epoll_create( 1024 );
+            massert( 17367,
+                     str::stream() << "epoll_create failed: " << errnoWithDescription(),
+                     _epfd >= 0 );
+            boost::thread poller( boost::bind( &EpollMessageServer::pollLoop, this ) );
+            initAndListen();
+        }
+
+        virtual bool useUnixSockets() const { return true; }
+
+    private:
+        struct Connection {
+            Connection( MessagingPort* p ) :
+                port( p ),
+                pollFd( dup( p->psock->rawFD() ) ),
+                lastError( new LastError() ),
+                state( 0 ),
+                connected( false ),
+                mutex( "EpollMessageServer::Connection" ),
+                busy( true ),
+                readyWhileBusy( false ) {
+            }
+
+            ~Connection() {
+                if ( pollFd >= 0 )
+                    ::close( pollFd );
+            }
+
+            scoped_ptr<MessagingPort> port;
+
+            // Our own descriptor for the socket, so that MessagingPort::closeAllSockets() closing
+            // the port's doesn't drop it from epoll: we hear about the hangup instead, and the
+            // number can't be reused by another connection while we still have it registered.
+            int pollFd;
+
+            LastError* lastError;   // owned by the thread or the detached state once connected
+            void* state;            // from MessageHandler::detach()
+            bool connected;
+
+            SimpleMutex mutex;      // protects the fields below
+            bool busy;              // queued for or running on a worker
+            bool readyWhileBusy;    // data arrived while busy
+        };
+
+        /**
+         * @return true if a recv() on 'fd' would not wait long: a whole message, or the first
+         * part of one that is too big to be buffered whole, is waiting, or the peer is gone.
+         * Special and invalid lengths are left to recv() to deal with.
+         */
+        static bool messageWaiting( int fd ) {
+            int len;
+            int n = ::recv( fd, &len, sizeof(len), MSG_PEEK | MSG_DONTWAIT );
+            if ( n == 0 )
+                return true;
+            if ( n < 0 )
+                return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+            if ( n < static_cast<int>( sizeof(len) ) )
+                return false;
+            if ( len < static_cast<int>( sizeof(MSGHEADER) ) || len > MaxMessageSizeBytes )
+                return true;
+
+            int avail = 0;
+            if ( ioctl( fd, FIONREAD, &avail ) != 0 )
+                return true;
+            return avail >= std::min( len, 16 * 1024 );
+        }
+
+        void pollLoop() {
+            setThreadName( "netPoll" );
+
+            const int maxEvents = 256;
+            struct epoll_event events[maxEvents];
+            while ( ! inShutdown() ) {
+                deleteClosed();
+
+                int n = epoll_wait( _epfd, events, maxEvents, 1000 );
+                if ( n < 0 ) {
+                    if ( errno == EINTR )
+                        continue;
+                    error() << "epoll_wait failed: " << errnoWithDescription() << endl;
+                    fassertFailed( 17368 );
+                }
+
+                for ( int i = 0; i < n; i++ ) {
+                    Connection* c = static_cast<Connection*>( events[i].data.ptr );
+                    const bool hangup = events[i].events & ( EPOLLRDHUP | EPOLLHUP | EPOLLERR );
+                    {
+                        SimpleMutex::scoped_lock lk( c->mutex );
+                        if ( c->busy ) {
+                            c->readyWhileBusy = true;
+                            continue;
+                        }
+                        if ( ! hangup && ! messageWaiting( c->pollFd ) )
+                            continue;
+                        c->busy = true;
+                    }
+                    _workers.schedule( &EpollMessageServer::serve, this, c );
+                }
+            }
+        }
+
+        /** runs on a worker: handles 'c's messages until it has none waiting */
+        void serve( Connection* c ) {
+            numa::placeThisThread();
+
+            MessagingPort* p = c->port.get();
+            bool open = true;
+
+            Message m;
+            try {
+                if ( ! c->connected ) {
+                    lastError.reset( c->lastError );
+                    _handler->connected( p );
+                    c->connected = true;
+                }
+                else {
+                    _handler->attach( p , c->state );
+                }
+
+                while ( ! inShutdown() ) {
+                    if ( ! messageWaiting( c->pollFd ) ) {
+                        c->state = _handler->detach( p , false );
+                        setThreadName( "netWorker" );
+                        {
+                            SimpleMutex::scoped_lock lk( c->mutex );
+                            if ( ! c->readyWhileBusy ) {
+                                c->busy = false;
+                                return;
+                            }
+                            c->readyWhileBusy = false;
+                        }
+                        _handler->attach( p , c->state );
+                        continue;
+                    }
+
+                    m.reset();
+                    p->psock->clearCounters();
+
+                    if ( ! p->recv(m) ) {
+                        if (!serverGlobalParams.quiet) {
+                            int conns = Listener::globalTicketHolder.used()-1;
+                            const char* word = (conns == 1 ? " connection" : " connections");
+                            log() << "end connection " << p->psock->remoteString()
+                                  << " (" << conns << word << " now open)" << endl;
+                        }
+                        p->shutdown();
+                        open = false;
+                        break;
+                    }
+
+                    _handler->process( m , p , c->lastError );
+                    networkCounter.hit( p->psock->getBytesIn() , p->psock->getBytesOut() );
+                    networkCounter.hitTiming( p->lastRecvMicros() , p->lastReplyMicros() );
+                }
+            }
+            catch ( AssertionException& e ) {
+                log() << "AssertionException handling request, closing client connection: "
+                      << e << endl;
+                p->shutdown();
+                open = false;
+            }
+            catch ( SocketException& e ) {
+                log() << "SocketException handling request, closing client connection: "
+                      << e << endl;
+                p->shutdown();
+                open = false;
+            }
+            catch ( const DBException& e ) {
+                log() << "DBException handling request, closing client connection: "
+                      << e << endl;
+                p->shutdown();
+                open = false;
+            }
+            catch ( std::exception &e ) {
+                error() << "Uncaught std::exception: " << e.what() << ", terminating" << endl;
+                dbexit( EXIT_UNCAUGHT );
+            }
+            catch ( ... ) {
+                error() << "Uncaught exception, terminating" << endl;
+                dbexit( EXIT_UNCAUGHT );
+            }
+
+            if ( open ) {
+                // shutting down: leave the connection to the process exit, like a connection
+                // thread would
+                return;
+            }
+
+            _handler->disconnected( p );
+            _handler->detach( p , true );
+            setThreadName( "netWorker" );
+
+            epoll_ctl( _epfd, EPOLL_CTL_DEL, c->pollFd, NULL );
+            Listener::globalTicketHolder.release();
+
+            // the poll thread may still hold an event for the connection: it deletes it once
+            // it is done with the events it has
+            SimpleMutex::scoped_lock lk( _closedMutex );
+            _closed.push_back( c );
+        }
+
+        void deleteClosed() {
+            vector<Connection*> closed;
+            {
+                SimpleMutex::scoped_lock lk( _closedMutex );
+                closed.swap( _closed );
+            }
+            for ( size_t i = 0; i < closed.size(); i++ )
+                delete closed[i];
+        }
+
+        MessageHandler* _handler;
+        int _epfd;
+        ThreadPool _workers;
+
+        SimpleMutex _closedMutex;
+        vector<Connection*> _closed;
+    };
+
+    MessageServer* createEpollServer( const MessageServer::Options& opts,
+                                      MessageHandler* handler,
+                                      int nWorkers ) {
+        return new EpollMessageServer( opts , handler , nWorkers );
+    }
+
+} // namespace mongo
+
+#endif // __linux__
@@ -23,14 +23,18 @@
 
 
 #include "mongo/db/lasterror.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/concurrency/thread_name.h"
 #include "mongo/util/net/listen.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/net/message_port.h"
 #include "mongo/util/net/message_server.h"
 #include "mongo/util/net/ssl_manager.h"
+#include "mongo/util/net/ssl_options.h"
+#include "mongo/util/numa.h"
 
 #ifdef __linux__  // TODO: consider making this ifndef _WIN32
 # include <sys/resource.h>
@@ -170,6 +174,8 @@ namespace mongo {
             MessagingPort* inPort = himArg->inPort;
             MessageHandler* handler = himArg->handler;
 
+            numa::placeThisThread();
+
             {
                 string threadName = "conn";
                 if ( inPort->connectionId() > 0 )
@@ -208,6 +214,7 @@ namespace mongo {
 
                     handler->process( m , p.get() , le );
                     networkCounter.hit( p->psock->getBytesIn() , p->psock->getBytesOut() );
+                    networkCounter.hitTiming( p->lastRecvMicros() , p->lastReplyMicros() );
                 }
             }
             catch ( AssertionException& e ) {
@@ -244,7 +251,47 @@ namespace mongo {
     };
 
 
+#ifdef __linux__
+    MessageServer* createEpollServer( const MessageServer::Options& opts,
+                                      MessageHandler* handler,
+                                      int nWorkers ); // from message_server_epoll.cpp
+#endif
+
+    // 0: a thread per connection.  Otherwise connections are served by this many workers.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(netWorkerThreads, int, 0);
+
+    // Offer compression to the servers we connect to and accept it from clients that offer it.
+    ExportedServerParameter<bool> netCompressionParameter(ServerParameterSet::getGlobal(),
+                                                          "netCompression",
+                                                          &messageCompressionEnabled,
+                                                          true,
+                                                          true);
+
+    // Send a reply in the background when the client has already sent its next request.
+    ExportedServerParameter<bool> pipelinedRepliesParameter(ServerParameterSet::getGlobal(),
+                                                            "pipelinedReplies",
+                                                            &pipelinedReplies,
+                                                            true,
+                                                            true);
+
     MessageServer * createServer( const MessageServer::Options& opts , MessageHandler * handler ) {
+#ifdef __linux__
+        // SSL connections can have data buffered in OpenSSL that epoll doesn't know about.
+        bool ssl = false;
+#ifdef MONGO_SSL
+        ssl = sslGlobalParams.sslMode.load() != SSLGlobalParams::SSLMode_disabled;
+#endif
+        if ( netWorkerThreads > 0 ) {
+            if ( handler->supportsWorkerPool() && !ssl ) {
+                log() << "serving connections from " << netWorkerThreads << " worker threads"
+                      << endl;
+                return createEpollServer( opts , handler , netWorkerThreads );
+            }
+            warning() << "netWorkerThreads is not supported "
+                      << ( ssl ? "with SSL" : "by this server" )
+                      << ", using a thread per connection" << endl;
+        }
+#endif
         return new PortMessageServer( opts , handler );
     }
 
@@ -28,6 +28,7 @@
 # include <arpa/inet.h>
 # include <errno.h>
 # include <netdb.h>
+# include <sys/ioctl.h>
 # if defined(__openbsd__)
 #  include <sys/uio.h>
 # endif
@@ -796,6 +797,27 @@ namespace mongo {
     // while we aren't looking.
     // TODO: Remove when better async changes come.
     //
+    int Socket::bytesAvailable() const {
+#ifdef _WIN32
+        u_long n = 0;
+        if ( ioctlsocket( _fd, FIONREAD, &n ) != 0 )
+            return 0;
+#else
+        int n = 0;
+        if ( ioctl( _fd, FIONREAD, &n ) != 0 )
+            return 0;
+#endif
+        return n;
+    }
+
+    bool Socket::isSecure() const {
+#ifdef MONGO_SSL
+        return _sslConnection.get() != NULL;
+#else
+        return false;
+#endif
+    }
+
     // isStillConnected() polls the socket at max every Socket::errorPollIntervalSecs to determine
     // if any disconnection-type events have happened on the socket.
     bool Socket::isStillConnected() {
@@ -228,6 +228,12 @@ namespace mongo {
         void setTimeout( double secs );
         bool isStillConnected();
 
+        /** bytes already received and waiting to be read, 0 if that can't be told */
+        int bytesAvailable() const;
+
+        /** true once secure(), secureAccepted() or doSSLHandshake() has set up SSL */
+        bool isSecure() const;
+
         void setHandshakeReceived() {
             _awaitingHandshake = false;
         }
@@ -19,6 +19,7 @@
 
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/thread/tss.hpp>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -124,6 +125,12 @@ namespace mongo {
         ////////////////////////////////////////////////////////////////
 
         SimpleMutex sslManagerMtx("SSL Manager");
+
+        // sessions a server will let clients resume are tied to this
+        const char kSessionIdContext[] = "mongodb";
+
+        // most servers a client keeps a session to resume for
+        const size_t kMaxClientSessions = 1024;
         SSLManagerInterface* theSSLManager = NULL;
         static const int BUFFER_SIZE = 8*1024;
 
@@ -207,6 +214,11 @@ namespace mongo {
             std::string _serverSubjectName;
             std::string _clientSubjectName;
 
+            // the last session with each server connect()ed to, by address
+            typedef std::map<std::string, SSL_SESSION*> SessionMap;
+            SimpleMutex _clientSessionsMutex;
+            SessionMap _clientSessions;
+
             /**
              * creates an SSL object to be used for this file descriptor.
              * caller must SSL_free it.
@@ -256,6 +268,13 @@ namespace mongo {
              */
             bool _doneWithSSLOp(SSLConnection* conn, int status);
 
+            /*
+             * Offer the session last used with the server at 'key' for 'conn' to resume, and
+             * keep the one 'conn' ended up with for next time
+             */
+            void _resumeClientSession(SSLConnection* conn, const std::string& key);
+            void _saveClientSession(SSLConnection* conn, const std::string& key);
+
             /*
              * Send and receive network data
              */
@@ -367,7 +386,8 @@ namespace mongo {
     SSLManager::SSLManager(const Params& params, bool isServer) :
         _validateCertificates(false),
         _weakValidation(params.weakCertificateValidation),
-        _allowInvalidCertificates(params.allowInvalidCertificates) {
+        _allowInvalidCertificates(params.allowInvalidCertificates),
+        _clientSessionsMutex("SSL client sessions") {
 
         SSL_library_init();
         SSL_load_error_strings();
@@ -436,6 +456,9 @@ namespace mongo {
         if (NULL != _clientContext) {
             SSL_CTX_free(_clientContext);
         }
+        for (SessionMap::iterator i = _clientSessions.begin(); i != _clientSessions.end(); ++i) {
+            SSL_SESSION_free(i->second);
+        }
     }
 
     int SSLManager::password_cb(char *buf,int num, int rwflag,void *userdata) {
@@ -537,8 +560,19 @@ namespace mongo {
         // Note: this is for blocking sockets only.
         SSL_CTX_set_mode(*context, SSL_MODE_AUTO_RETRY);
 
-        // Disable session caching (see SERVER-10261)
-        SSL_CTX_set_session_cache_mode(*context, SSL_SESS_CACHE_OFF);
+        if (context == &_serverContext) {
+            // Let a reconnecting client resume its session, from a ticket or the cache, and skip
+            // the key exchange and certificate checks of a full handshake.  Resumption needs a
+            // session id context once client certificates are asked for (see SERVER-10261).
+            SSL_CTX_set_session_cache_mode(*context, SSL_SESS_CACHE_SERVER);
+            SSL_CTX_set_session_id_context(*context,
+                    reinterpret_cast<const unsigned char*>(kSessionIdContext),
+                    sizeof(kSessionIdContext) - 1);
+        }
+        else {
+            // connect() keeps the sessions it resumes itself
+            SSL_CTX_set_session_cache_mode(*context, SSL_SESS_CACHE_OFF);
+        }
  
         // Use the clusterfile for internal outgoing SSL connections if specified 
         if (context == &_clientContext && !params.clusterfile.empty()) {
@@ -732,10 +766,42 @@ namespace mongo {
         }
     }
 
+    void SSLManager::_resumeClientSession(SSLConnection* conn, const std::string& key) {
+        SimpleMutex::scoped_lock lk(_clientSessionsMutex);
+        SessionMap::const_iterator i = _clientSessions.find(key);
+        if (i != _clientSessions.end()) {
+            // takes its own reference; a session the server no longer knows just means a full
+            // handshake
+            SSL_set_session(conn->ssl, i->second);
+        }
+    }
+
+    void SSLManager::_saveClientSession(SSLConnection* conn, const std::string& key) {
+        SSL_SESSION* session = SSL_get1_session(conn->ssl);
+        if (!session)
+            return;
+
+        SimpleMutex::scoped_lock lk(_clientSessionsMutex);
+        SessionMap::iterator i = _clientSessions.find(key);
+        if (i != _clientSessions.end()) {
+            SSL_SESSION_free(i->second);
+            i->second = session;
+            return;
+        }
+        if (_clientSessions.size() >= kMaxClientSessions) {
+            SSL_SESSION_free(_clientSessions.begin()->second);
+            _clientSessions.erase(_clientSessions.begin());
+        }
+        _clientSessions[key] = session;
+    }
+
     SSLConnection* SSLManager::connect(Socket* socket) {
         SSLConnection* sslConn = new SSLConnection(_clientContext, socket, NULL, 0);
         ScopeGuard sslGuard = MakeGuard(::SSL_free, sslConn->ssl);
         ScopeGuard bioGuard = MakeGuard(::BIO_free, sslConn->networkBIO);
+
+        const std::string sessionKey = socket->remoteString();
+        _resumeClientSession(sslConn, sessionKey);
  
         int ret;
         do {
@@ -744,6 +810,11 @@ namespace mongo {
  
         if (ret != 1)
             _handleSSLError(SSL_get_error(sslConn, ret), ret);
+
+        if (SSL_session_reused(sslConn->ssl)) {
+            LOG(2) << "resumed SSL session with " << sessionKey << endl;
+        }
+        _saveClientSession(sslConn, sessionKey);
  
         sslGuard.Dismiss();
         bioGuard.Dismiss();
@@ -0,0 +1,272 @@
+/*
+ *    Copyright 2014 MongoDB Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/numa.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+namespace numa {
+
+    using std::endl;
+
+#ifdef __linux__
+
+    namespace {
+
+        // from <numaif.h>
+        const int kMpolPreferred = 1;
+        const int kMpolInterleave = 3;
+
+        const int kBitsPerLong = 8 * sizeof(unsigned long);
+        const int kMaskLongs = ( kMaxNodes + kBitsPerLong - 1 ) / kBitsPerLong;
+
+        bool _enabled = false;
+        int _numNodes = 1;
+        std::vector<int> _nodeCpus[kMaxNodes];
+
+        AtomicUInt32 _nextNode;
+        AtomicUInt64 _threadsPlaced[kMaxNodes];
+        AtomicUInt64 _interleavedRanges;
+        AtomicUInt64 _interleaveFailures;
+
+        /** "0-7,16-23" -> 0,1,...,7,16,...,23 */
+        std::vector<int> parseCpuList( const std::string& s ) {
+            std::vector<int> cpus;
+            const char* p = s.c_str();
+            while ( *p ) {
+                char* end;
+                long first = strtol( p, &end, 10 );
+                if ( end == p )
+                    break;
+                long last = first;
+                p = end;
+                if ( *p == '-' ) {
+                    last = strtol( p + 1, &end, 10 );
+                    p = end;
+                }
+                for ( long cpu = first; cpu <= last; cpu++ )
+                    cpus.push_back( static_cast<int>( cpu ) );
+                if ( *p != ',' )
+                    break;
+                p++;
+            }
+            return cpus;
+        }
+
+        std::string readLine( const std::string& fname ) {
+            char buf[4096] = { 0 };
+            FILE* f = fopen( fname.c_str(), "r" );
+            if ( f ) {
+                if ( fgets( buf, sizeof(buf), f ) )
+                    buf[strcspn( buf, "\n" )] = '\0';
+                fclose( f );
+            }
+            return buf;
+        }
+
+        std::string nodeDir( int node ) {
+            char buf[64];
+            snprintf( buf, sizeof(buf), "/sys/devices/system/node/node%d", node );
+            return buf;
+        }
+
+        void discover() {
+            _numNodes = 0;
+            while ( _numNodes < kMaxNodes &&
+                    access( nodeDir( _numNodes ).c_str(), F_OK ) == 0 ) {
+                _nodeCpus[_numNodes] = parseCpuList( readLine( nodeDir( _numNodes ) + "/cpulist" ) );
+                _numNodes++;
+            }
+            if ( _numNodes == 0 )
+                _numNodes = 1;
+        }
+
+        void setNode( unsigned long* mask, int node ) {
+            mask[node / kBitsPerLong] |= 1UL << ( node % kBitsPerLong );
+        }
+
+        // our placement of the calling thread: -1 when not placed, 'tried' once we've looked
+        __thread int _threadNode = -1;
+        __thread bool _threadPlacementTried = false;
+
+    } // namespace
+
+    bool enable() {
+        discover();
+        if ( _numNodes < 2 ) {
+            log() << "numaPlacement: this machine has one NUMA node, nothing to place" << endl;
+            return false;
+        }
+        _enabled = true;
+        log() << "numaPlacement: placing connection threads on " << _numNodes
+              << " NUMA nodes and interleaving the data files across them" << endl;
+        return true;
+    }
+
+    bool enabled() {
+        return _enabled;
+    }
+
+    int numNodes() {
+        return _numNodes;
+    }
+
+    void placeThisThread() {
+        if ( !_enabled || _threadPlacementTried )
+            return;
+        _threadPlacementTried = true;
+
+        // the next node in turn that has CPUs (a node can have memory only)
+        int node = -1;
+        for ( int i = 0; i < _numNodes && node < 0; i++ ) {
+            int n = _nextNode.fetchAndAdd( 1 ) % _numNodes;
+            if ( !_nodeCpus[n].empty() )
+                node = n;
+        }
+        if ( node < 0 )
+            return;
+
+        cpu_set_t cpus;
+        CPU_ZERO( &cpus );
+        for ( size_t i = 0; i < _nodeCpus[node].size(); i++ ) {
+            if ( _nodeCpus[node][i] < CPU_SETSIZE )
+                CPU_SET( _nodeCpus[node][i], &cpus );
+        }
+        if ( sched_setaffinity( 0, sizeof(cpus), &cpus ) != 0 ) {
+            LOG(1) << "numaPlacement: couldn't pin thread to node " << node << ": "
+                   << errnoWithDescription() << endl;
+            return;
+        }
+
+        // preferred rather than bound, so that a full node spills over instead of failing
+        unsigned long mask[kMaskLongs] = { 0 };
+        setNode( mask, node );
+        if ( syscall( SYS_set_mempolicy, kMpolPreferred, mask, kMaxNodes + 1 ) != 0 ) {
+            LOG(1) << "numaPlacement: couldn't set memory policy for node " << node << ": "
+                   << errnoWithDescription() << endl;
+        }
+
+        _threadNode = node;
+        _threadsPlaced[node].fetchAndAdd( 1 );
+    }
+
+    int threadNode() {
+        return _threadNode;
+    }
+
+    unsigned long long threadsPlaced( int node ) {
+        return node >= 0 && node < kMaxNodes ? _threadsPlaced[node].load() : 0;
+    }
+
+    void interleave( void* p, size_t len ) {
+        if ( !_enabled || len == 0 )
+            return;
+
+        static const size_t pageSize = sysconf( _SC_PAGESIZE );
+        char* start = reinterpret_cast<char*>(
+                reinterpret_cast<size_t>( p ) & ~( pageSize - 1 ) );
+        len += static_cast<char*>( p ) - start;
+
+        unsigned long mask[kMaskLongs] = { 0 };
+        for ( int i = 0; i < _numNodes; i++ )
+            setNode( mask, i );
+
+        if ( syscall( SYS_mbind, start, len, kMpolInterleave, mask, kMaxNodes + 1, 0 ) != 0 ) {
+            _interleaveFailures.fetchAndAdd( 1 );
+            LOG(1) << "numaPlacement: mbind of " << len << " bytes failed: "
+                   << errnoWithDescription() << endl;
+            return;
+        }
+        _interleavedRanges.fetchAndAdd( 1 );
+    }
+
+    unsigned long long interleavedRanges() {
+        return _interleavedRanges.load();
+    }
+
+    unsigned long long interleaveFailures() {
+        return _interleaveFailures.load();
+    }
+
+    bool allocationCounts( int node, unsigned long long* local, unsigned long long* other ) {
+        FILE* f = fopen( ( nodeDir( node ) + "/numastat" ).c_str(), "r" );
+        if ( !f )
+            return false;
+        bool gotLocal = false;
+        bool gotOther = false;
+        char name[64];
+        unsigned long long value;
+        while ( fscanf( f, "%63s %llu", name, &value ) == 2 ) {
+            if ( strcmp( name, "local_node" ) == 0 ) {
+                *local = value;
+                gotLocal = true;
+            }
+            else if ( strcmp( name, "other_node" ) == 0 ) {
+                *other = value;
+                gotOther = true;
+            }
+        }
+        fclose( f );
+        return gotLocal && gotOther;
+    }
+
+#else // __linux__
+
+    bool enable() {
+        log() << "numaPlacement is not supported on this platform" << endl;
+        return false;
+    }
+
+    bool enabled() { return false; }
+
+    int numNodes() { return 1; }
+
+    void placeThisThread() { }
+
+    int threadNode() { return -1; }
+
+    unsigned long long threadsPlaced( int node ) { return 0; }
+
+    void interleave( void* p, size_t len ) { }
+
+    unsigned long long interleavedRanges() { return 0; }
+
+    unsigned long long interleaveFailures() { return 0; }
+
+    bool allocationCounts( int node, unsigned long long* local, unsigned long long* other ) {
+        return false;
+    }
+
+#endif // __linux__
+
+} // namespace numa
+} // namespace mongo
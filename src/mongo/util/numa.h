@@ -0,0 +1,79 @@
+/*
+ *    Copyright 2014 MongoDB Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace mongo {
+
+    /**
+     * Placement of threads and memory on the NUMA nodes of a multi-socket machine, for running
+     * without numactl --interleave=all (which makes most memory accesses remote):
+     *
+     *  - threads that serve connections are pinned to the nodes in turn with placeThisThread(),
+     *    and allocate from their own node, so their buffers and per-thread state are local
+     *  - the data file mappings, which every thread reads, are interleaved across the nodes
+     *    with interleave()
+     *
+     * Does nothing until enable() is called, on a machine with more than one node.  Only
+     * implemented on Linux, through the raw system calls so that libnuma isn't needed.
+     */
+    namespace numa {
+
+        const int kMaxNodes = 64;
+
+        /**
+         * Turns placement on if the machine has more than one node.
+         * @return whether it is on
+         */
+        bool enable();
+
+        bool enabled();
+
+        /** nodes on the machine, 1 if it isn't NUMA or we can't tell */
+        int numNodes();
+
+        /**
+         * Pins the calling thread to the CPUs of the next node in turn and has it allocate
+         * from that node.  A thread is placed once; later calls do nothing.
+         */
+        void placeThisThread();
+
+        /** node the calling thread was placed on, or -1 */
+        int threadNode();
+
+        /** threads placed on 'node' so far */
+        unsigned long long threadsPlaced(int node);
+
+        /** spreads the pages of [p, p+len) over all nodes, round robin */
+        void interleave(void* p, size_t len);
+
+        /** ranges interleave() was applied to, and how many it failed on */
+        unsigned long long interleavedRanges();
+        unsigned long long interleaveFailures();
+
+        /**
+         * Page allocation counts kept by the kernel for 'node', from its numastat: pages
+         * allocated on the node for a thread running on it (local) and for one running
+         * elsewhere (other).  Machine wide, since boot.
+         * @return false if they aren't available
+         */
+        bool allocationCounts(int node, unsigned long long* local, unsigned long long* other);
+
+    } // namespace numa
+
+} // namespace mongo
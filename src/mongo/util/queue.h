@@ -19,8 +19,10 @@
 
 #include "mongo/pch.h"
 
+#include <deque>
 #include <limits>
 #include <queue>
+#include <vector>
 
 #include <boost/thread/condition.hpp>
 
@@ -64,7 +66,7 @@ namespace mongo {
             while (_currentSize + tSize >= _maxSize) {
                 _cvNoLongerFull.wait( l.boost() );
             }
-            _queue.push( t );
+            _queue.push_back( t );
             _currentSize += tSize;
             _cvNoLongerEmpty.notify_one();
         }
@@ -99,7 +101,7 @@ namespace mongo {
 
         void clear() {
             scoped_lock l(_lock);
-            _queue = std::queue<T>();
+            _queue.clear();
             _currentSize = 0;
         }
 
@@ -109,7 +111,7 @@ namespace mongo {
                 return false;
 
             t = _queue.front();
-            _queue.pop();
+            _queue.pop_front();
             _currentSize -= _getSize(t);
             _cvNoLongerFull.notify_one();
 
@@ -123,7 +125,7 @@ namespace mongo {
                 _cvNoLongerEmpty.wait( l.boost() );
 
             T t = _queue.front();
-            _queue.pop();
+            _queue.pop_front();
             _currentSize -= _getSize(t);
             _cvNoLongerFull.notify_one();
 
@@ -151,7 +153,7 @@ namespace mongo {
             }
 
             t = _queue.front();
-            _queue.pop();
+            _queue.pop_front();
             _currentSize -= _getSize(t);
             _cvNoLongerFull.notify_one();
             return true;
@@ -189,9 +191,19 @@ namespace mongo {
             return true;
         }
 
+        /**
+         * Copies up to 'max' items from the front of the queue into 'out', leaving them queued.
+         * Like peek(), only for a single consumer.
+         */
+        void peekFront(size_t max, std::vector<T>* out) const {
+            scoped_lock l( _lock );
+            const size_t n = std::min(max, _queue.size());
+            out->insert(out->end(), _queue.begin(), _queue.begin() + n);
+        }
+
     private:
         mutable mongo::mutex _lock;
-        std::queue<T> _queue;
+        std::deque<T> _queue;
         const size_t _maxSize;
         size_t _currentSize;
         getSizeFunc _getSize;